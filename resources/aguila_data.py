@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""
+Client of the Aguila data channel.
+
+Aguila publishes the baseband FFT frames and the I/Q of the demodulator
+channel on a local socket, see data-channel.txt. Unlike the remote control,
+which answers one text line per command, this gives scripts the actual
+data at the full frame rate:
+
+    from resources.aguila_data import DataChannel
+
+    with DataChannel(fft=True) as channel:
+        for frame in channel:
+            levels = frame.dbfs()
+            print(frame.center_freq, levels.max())
+
+Payloads are numpy arrays if numpy is installed, else array.array.
+"""
+
+import array
+import os
+import socket
+import struct
+import sys
+import tempfile
+from typing import Iterator, Optional
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+DEFAULT_NAME = "aguila-data"
+
+MAGIC = 0x31444741
+HEADER = struct.Struct("=IHHQQqddII8x")
+TYPE_FFT = 1
+TYPE_IQ = 2
+
+
+def default_path(name: str = DEFAULT_NAME) -> str:
+    """Path of the socket for a server name, as QLocalServer makes it."""
+    if os.path.isabs(name):
+        return name
+    return os.path.join(tempfile.gettempdir(), name)
+
+
+class Frame:
+    """One FFT frame or block of I/Q samples."""
+
+    __slots__ = ("kind", "seq", "sample_index", "timestamp", "center_freq",
+                 "sample_rate", "dropped", "data")
+
+    def __init__(self, kind, seq, sample_index, timestamp, center_freq,
+                 sample_rate, dropped, data):
+        self.kind = kind                # "fft" or "iq"
+        self.seq = seq                  # frame number of the stream
+        self.sample_index = sample_index
+        self.timestamp = timestamp      # seconds since the epoch
+        self.center_freq = center_freq  # Hz
+        self.sample_rate = sample_rate  # Hz
+        self.dropped = dropped          # frames lost before this one
+        self.data = data                # linear power, or complex I/Q
+
+    def dbfs(self):
+        """Levels of an FFT frame in dBFS, as shown by the plotter."""
+        if self.kind != "fft":
+            raise ValueError("dbfs() needs an FFT frame")
+        n = len(self.data)
+        scale = 1.0 / (n * n)
+        if numpy is not None:
+            return 10.0 * numpy.log10(numpy.maximum(self.data * scale, 1e-20))
+        import math
+        return [10.0 * math.log10(max(p * scale, 1e-20)) for p in self.data]
+
+    def frequencies(self):
+        """Absolute frequency of each bin of an FFT frame in Hz."""
+        n = len(self.data)
+        step = self.sample_rate / n
+        start = self.center_freq - self.sample_rate / 2.0
+        if numpy is not None:
+            return start + step * numpy.arange(n)
+        return [start + step * i for i in range(n)]
+
+
+class DataChannel:
+    """Connection to the data channel of a running Aguila."""
+
+    def __init__(self, fft: bool = True, iq: bool = False,
+                 path: Optional[str] = None, timeout: Optional[float] = 5.0):
+        self._socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._socket.settimeout(timeout)
+        self._socket.connect(path or default_path())
+        self.subscribe(fft, iq)
+
+    def subscribe(self, fft: bool = True, iq: bool = False):
+        """Choose the streams, replacing the last choice."""
+        streams = [name for name, wanted in (("fft", fft), ("iq", iq)) if wanted]
+        self._socket.sendall((" ".join(streams) + "\n").encode())
+
+    def close(self):
+        self._socket.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __iter__(self) -> Iterator[Frame]:
+        while True:
+            yield self.read()
+
+    def _read_exactly(self, size: int) -> memoryview:
+        # Large reads straight into one buffer, without joining chunks
+        data = bytearray(size)
+        view = memoryview(data)
+        got = 0
+        while got < size:
+            n = self._socket.recv_into(view[got:], size - got)
+            if n == 0:
+                raise ConnectionError("Aguila closed the data channel")
+            got += n
+        return view
+
+    def read(self) -> Frame:
+        """Wait for the next frame."""
+        (magic, kind, item_size, seq, sample_index, timestamp_ns, center_freq,
+         sample_rate, count, dropped) = HEADER.unpack(self._read_exactly(HEADER.size))
+        if magic != MAGIC:
+            raise ValueError("Not a data channel frame, lost sync")
+
+        payload = self._read_exactly(count * item_size)
+        if kind == TYPE_FFT:
+            name, dtype = "fft", "float32"
+        elif kind == TYPE_IQ:
+            name, dtype = "iq", "complex64"
+        else:
+            raise ValueError("Unknown frame type %d" % kind)
+
+        if numpy is not None:
+            data = numpy.frombuffer(payload, dtype=dtype)
+        else:
+            data = array.array("f")     # I/Q interleaved
+            data.frombytes(payload)
+
+        return Frame(name, seq, sample_index, timestamp_ns / 1e9, center_freq,
+                     sample_rate, dropped, data)
+
+
+if __name__ == "__main__":
+    # Print a line per FFT frame, or per I/Q block with "iq"
+    want_iq = "iq" in sys.argv[1:]
+    with DataChannel(fft=not want_iq, iq=want_iq) as channel:
+        for frame in channel:
+            if frame.kind == "fft":
+                levels = frame.dbfs()
+                print("fft %d: %.6f MHz, %d bins, peak %.1f dBFS, dropped %d" %
+                      (frame.seq, frame.center_freq / 1e6, len(frame.data),
+                       max(levels), frame.dropped))
+            else:
+                print("iq %d: %.6f MHz, %d samples at %.0f Hz, dropped %d" %
+                      (frame.seq, frame.center_freq / 1e6, len(frame.data),
+                       frame.sample_rate, frame.dropped))
@@ -8,16 +8,21 @@ from langchain.agents import AgentExecutor, create_react_agent
 from langchain_anthropic import ChatAnthropic
 from langchain.prompts import ChatPromptTemplate, MessagesPlaceholder
 from langchain.tools import tool
-from typing import Dict, List, Optional
+from typing import Any, Dict, List, Optional
+from concurrent.futures import ThreadPoolExecutor
 import os
 from dotenv import load_dotenv
 import sys
 from pathlib import Path
 import re
-from .tuning_tool import GqrxTuningTool
+import json
+from .tuning_tool import GqrxTuningTool, GqrxSignalLevelTool
 import logging
 from langchain.callbacks import tracing_v2_enabled
 
+# Tool calls of one wave that run at the same time
+MAX_PARALLEL_TOOLS = 8
+
 # Find and load the .env file
 def setup_environment():
     """Find and load the .env file from the project root"""
@@ -68,18 +73,23 @@ class ChatCoordinator:
         )
         
         # Create the agent with our custom prompt
+        self.tools = self._get_tools()
         self.agent = create_react_agent(
             llm=self.llm,
-            tools=self._get_tools(),
+            tools=self.tools,
             prompt=self._get_prompt()
         )
         
         self.executor = AgentExecutor(
             agent=self.agent,
-            tools=self._get_tools(),
+            tools=self.tools,
             verbose=True,
             handle_parsing_errors=True
         )
+        # Radio tools block on a remote control roundtrip, so independent
+        # calls run in threads
+        self.tool_pool = ThreadPoolExecutor(max_workers=MAX_PARALLEL_TOOLS,
+                                            thread_name_prefix="coordinator-tool")
         
         # Set up tracing tags
         self.trace_tags = ["aguila", "chat_coordinator", project_name]
@@ -87,6 +97,7 @@ class ChatCoordinator:
     def _get_tools(self) -> List:
         """Define the tools available to the coordinator"""
         self.tuning_tool = GqrxTuningTool()
+        self.level_tool = GqrxSignalLevelTool()
         
         @tool
         def analyze_tuning_request(request: str) -> Dict:
@@ -106,7 +117,37 @@ class ChatCoordinator:
                 "request_type": "direct"  # Will be classified by LLM
             }
         
-        return [analyze_tuning_request, self.tuning_tool]
+        return [analyze_tuning_request, self.tuning_tool, self.level_tool]
+
+    def run_tools(self, calls: List[Dict[str, Any]]) -> List[Dict[str, Any]]:
+        """Run independent tool calls at the same time.
+
+        Args:
+            calls: Dicts with the tool "name" and its "args", e.g.
+                {"name": "read_signal_level", "args": {}}
+
+        Returns:
+            One dict per call, in the order of the calls, with the "name" and
+            either the tool "output" or an "error". A failing call does not
+            stop the others.
+        """
+        tools = {t.name: t for t in self.tools}
+
+        def run(call):
+            tool = tools.get(call.get("name"))
+            if tool is None:
+                raise KeyError(f"Unknown tool {call.get('name')}")
+            return tool.run(call.get("args") or {})
+
+        futures = [self.tool_pool.submit(run, call) for call in calls]
+        results = []
+        for call, future in zip(calls, futures):
+            try:
+                results.append({"name": call.get("name"), "output": future.result()})
+            except Exception as e:
+                logging.error(f'Tool {call.get("name")} failed: {e}')
+                results.append({"name": call.get("name"), "error": str(e)})
+        return results
     
     def _get_prompt(self) -> ChatPromptTemplate:
         """Create the prompt template for the coordinator"""
@@ -274,19 +315,27 @@ class ChatCoordinator:
                     ("human", f"What might we find at {freq_mhz} MHz?")
                 ])
                 
+                # Tune while the explanation is generated, the roundtrip and
+                # the settling time overlap with the LLM call. The LLM call
+                # stays in this thread, inside the tracing context.
+                tuning = self.tool_pool.submit(self.tuning_tool.run, {"frequency": freq})
+
                 with tracing_v2_enabled():
                     chain = explain_prompt | self.llm
                     response = chain.invoke({"input": message}, config={"timeout": 3.0})
                     explanation = response.content if hasattr(response, 'content') else str(response)
-                
-                # Do the actual tuning
-                self.tuning_tool.run({"frequency": freq})
+
+                try:
+                    tool_results = [{"name": self.tuning_tool.name, "output": tuning.result()}]
+                except Exception as e:
+                    tool_results = [{"name": self.tuning_tool.name, "error": str(e)}]
                 
                 return {
                     "requires_tuning": "true",
                     "frequency_mentioned": str(freq),
                     "confidence": "high",
                     "tuning_result": f"Exploring {freq_mhz:.3f} MHz. {explanation}",
+                    "tool_results": tool_results,
                     "success": True
                 }
             
@@ -308,8 +357,55 @@ class ChatCoordinator:
                 "success": False
             }
 
+def serve():
+    """
+    Answer classification requests from Aguila over stdin/stdout.
+
+    Aguila keeps this process running, so the interpreter start and the
+    LangChain imports are paid once. Each request is one line of JSON,
+    {"id": n, "message": "..."}, answered by one line {"id": n, "result": {...}}.
+    {"id": n, "tools": [{"name": "...", "args": {...}}, ...]} runs the tool
+    calls at the same time and answers {"id": n, "results": [...]}, see
+    ChatCoordinator.run_tools().
+    A {"ready": true} line is written once the coordinator is created.
+    Anything else printed goes to stderr so it cannot corrupt the replies.
+    """
+    out = sys.stdout
+    sys.stdout = sys.stderr
+
+    def reply(obj):
+        out.write(json.dumps(obj) + "\n")
+        out.flush()
+
+    try:
+        coordinator = ChatCoordinator()
+    except Exception as e:
+        reply({"ready": False, "error": str(e)})
+        sys.exit(1)
+    reply({"ready": True})
+
+    for line in sys.stdin:
+        line = line.strip()
+        if not line:
+            continue
+        try:
+            request = json.loads(line)
+        except ValueError as e:
+            reply({"id": None, "error": str(e)})
+            continue
+        if "tools" in request:
+            results = coordinator.run_tools(list(request.get("tools") or []))
+            reply({"id": request.get("id"), "results": results})
+            continue
+        result = coordinator.evaluate_request(str(request.get("message", "")))
+        reply({"id": request.get("id"), "result": result})
+
 # Example usage
 if __name__ == "__main__":
+    if "--serve" in sys.argv[1:]:
+        serve()
+        sys.exit(0)
+
     # Set up environment before anything else
     setup_environment()
     
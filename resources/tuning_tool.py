@@ -27,48 +27,41 @@ class GqrxTuningTool(BaseTool):
     host: str = Field(default="127.0.0.1")
     port: int = Field(default=7356)
 
-    def __init__(self, **kwargs):
-        super().__init__(**kwargs)
-        self._socket = None
+    def _connect(self) -> Optional[socket.socket]:
+        """Connect to GQRX's remote control interface.
 
-    def _connect(self) -> bool:
-        """Connect to GQRX's remote control interface"""
+        Every call uses its own connection, so the tool can run in several
+        threads at once.
+        """
         try:
-            self._socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-            self._socket.connect((self.host, self.port))
-            return True
-        except Exception as e:
-            return False
-
-    def _disconnect(self):
-        """Close the connection"""
-        if self._socket:
-            self._socket.close()
-            self._socket = None
-
-    def _send_command(self, command: str) -> Optional[str]:
+            return socket.create_connection((self.host, self.port), timeout=5.0)
+        except Exception:
+            return None
+
+    def _send_command(self, sock: socket.socket, command: str) -> Optional[str]:
         """Send a command to GQRX and get the response"""
         try:
-            self._socket.send((command + '\n').encode())
-            return self._socket.recv(1024).decode().strip()
+            sock.sendall((command + '\n').encode())
+            return sock.recv(1024).decode().strip()
         except Exception:
             return None
 
     def _run(self, frequency: int) -> str:
         """Run the tool with the specified frequency"""
         # Connect to GQRX
-        if not self._connect():
+        sock = self._connect()
+        if sock is None:
             return "Failed to connect to GQRX. Is it running with remote control enabled?"
 
         try:
             # Set frequency
-            response = self._send_command(f"F {frequency}")
+            response = self._send_command(sock, f"F {frequency}")
             if response != "RPRT 0":
                 return f"Failed to set frequency: {response}"
 
             # Verify frequency
             time.sleep(0.5)  # Give GQRX time to tune
-            current_freq = self._send_command("f")
+            current_freq = self._send_command(sock, "f")
             
             try:
                 current_freq = int(current_freq)
@@ -80,13 +73,40 @@ class GqrxTuningTool(BaseTool):
                 return f"Failed to verify frequency: {current_freq}"
 
         finally:
-            self._disconnect()
+            sock.close()
 
     async def _arun(self, frequency: int) -> str:
         """Async implementation of the tool"""
         # For now, just call the sync version
         return self._run(frequency)
 
+class ReadSignalLevelInput(BaseModel):
+    """Input for the signal level tool, it takes no arguments"""
+
+class GqrxSignalLevelTool(GqrxTuningTool):
+    name: Literal["read_signal_level"] = "read_signal_level"
+    description: str = """
+    Reads the signal strength of the demodulator channel in dBFS.
+    Takes no input. It does not change any receiver setting.
+    """
+    args_schema: Type[BaseModel] = ReadSignalLevelInput
+
+    def _run(self) -> str:
+        sock = self._connect()
+        if sock is None:
+            return "Failed to connect to GQRX. Is it running with remote control enabled?"
+        try:
+            level = self._send_command(sock, "l STRENGTH")
+            try:
+                return f"Signal level {float(level):.1f} dBFS"
+            except (TypeError, ValueError):
+                return f"Failed to read the signal level: {level}"
+        finally:
+            sock.close()
+
+    async def _arun(self) -> str:
+        return self._run()
+
 # Example usage:
 if __name__ == "__main__":
     # Create tool instance
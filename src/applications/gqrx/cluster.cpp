@@ -0,0 +1,494 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include <QDateTime>
+#include <QDebug>
+#include <QHostInfo>
+
+#include "applications/gqrx/cluster.h"
+
+ClusterMember::ClusterMember(receiver *rx, QObject *parent) :
+    QObject(parent),
+    cl_rx(rx),
+    cl_port(0),
+    cl_rc_port(0),
+    cl_lnb_lo(0.0)
+{
+    cl_timer.setInterval(CLUSTER_HEARTBEAT_MS);
+    connect(&cl_timer, SIGNAL(timeout()), this, SLOT(heartbeat()));
+    connect(&cl_socket, SIGNAL(connected()), this, SLOT(heartbeat()));
+    // The replies are not needed
+    connect(&cl_socket, &QTcpSocket::readyRead, this, [this]() { cl_socket.readAll(); });
+}
+
+/*!
+ * \brief Read the coordinator to join.
+ *
+ * Only set in the configuration file, in the [cluster] group:
+ * join=<host>:<port> of the remote control of the coordinator, and
+ * name=<name> of this node, the host name by default.
+ */
+void ClusterMember::readSettings(QSettings *settings)
+{
+    const QString join = settings->value("cluster/join", "").toString();
+    cl_name = settings->value("cluster/name", QHostInfo::localHostName()).toString()
+              .simplified().replace(' ', '_');
+    cl_host = join.section(':', 0, -2);
+    cl_port = join.section(':', -1).toInt();
+
+    cl_socket.abort();
+    if (cl_host.isEmpty() || cl_port <= 0 || cl_name.isEmpty())
+    {
+        cl_host.clear();
+        cl_timer.stop();
+        return;
+    }
+    cl_timer.start();
+    heartbeat();
+}
+
+void ClusterMember::setLnbLo(double freq_mhz)
+{
+    cl_lnb_lo = freq_mhz * 1.0e6;
+}
+
+void ClusterMember::heartbeat()
+{
+    if (cl_host.isEmpty())
+        return;
+
+    if (cl_socket.state() == QAbstractSocket::UnconnectedState)
+    {
+        // Joins once connected
+        cl_socket.connectToHost(cl_host, cl_port);
+        return;
+    }
+    if (cl_socket.state() != QAbstractSocket::ConnectedState)
+        return;
+
+    iq_fft_frame_sptr frame = cl_rx->get_iq_fft_frame();
+    if (!frame || cl_rc_port <= 0)
+        return;
+    cl_socket.write(QString("CLUSTER JOIN %1 %2 %3 %4\n").arg(cl_name).arg(cl_rc_port)
+                    .arg((qint64)(frame->center_freq + cl_lnb_lo))
+                    .arg((qint64)frame->sample_rate).toLatin1());
+}
+
+ClusterCoordinator::ClusterCoordinator(QObject *parent) :
+    QObject(parent),
+    cl_summary_ms(0)
+{
+    cl_timer.setInterval(1000);
+    connect(&cl_timer, SIGNAL(timeout()), this, SLOT(tick()));
+    cl_timer.start();
+}
+
+ClusterCoordinator::~ClusterCoordinator()
+{
+    for (Node *node : cl_nodes)
+    {
+        delete node->socket;
+        delete node;
+    }
+}
+
+/*! \brief Add a node or renew its heartbeat, from CLUSTER JOIN. */
+void ClusterCoordinator::join(const QString &host, const QString &name, int port,
+                              double center, double bandwidth)
+{
+    Node *node = cl_nodes.value(name, nullptr);
+    const bool added = !node;
+    if (added)
+    {
+        node = new Node();
+        node->name = name;
+        node->port = 0;
+        node->center = 0.0;
+        node->bandwidth = 0.0;
+        node->socket = nullptr;
+        node->pending = -1;
+        cl_nodes.insert(name, node);
+        qInfo() << "Cluster node" << name << "joined from" << host;
+    }
+
+    const bool moved = node->center != center || node->bandwidth != bandwidth;
+    node->center = center;
+    node->bandwidth = bandwidth;
+    node->seen_ms = QDateTime::currentMSecsSinceEpoch();
+    if (node->host != host || node->port != port)
+    {
+        // Another instance took the name, or the node moved
+        endDetections(node, true);
+        node->host = host;
+        node->port = port;
+        connectNode(node);
+    }
+
+    if (added || moved)
+    {
+        rebalance();
+        assignVfos();
+        publish();
+    }
+}
+
+/*! \brief Set the coverage from the lines of CLUSTER RANGE and split it again. */
+void ClusterCoordinator::setRanges(const QString &ranges)
+{
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+    cl_ranges = ranges.split('\n', QString::SkipEmptyParts);
+#else
+    cl_ranges = ranges.split('\n', Qt::SkipEmptyParts);
+#endif
+    rebalance();
+    publish();
+}
+
+/*! \brief Add a VFO, or change the mode of the one at freq, from CLUSTER VFO. */
+void ClusterCoordinator::requestVfo(qint64 freq, const QString &mode, int passband)
+{
+    for (Vfo &vfo : cl_vfos)
+    {
+        if (vfo.freq != freq)
+            continue;
+        vfo.mode = mode;
+        vfo.passband = passband;
+        if (!vfo.node.isEmpty())
+            send(cl_nodes.value(vfo.node), vfoCommand(vfo));
+        publish();
+        return;
+    }
+
+    cl_vfos.append({freq, mode, passband, QString(), 0});
+    assignVfos();
+    publish();
+}
+
+void ClusterCoordinator::removeVfo(qint64 freq)
+{
+    for (int i = 0; i < cl_vfos.size(); i++)
+    {
+        if (cl_vfos[i].freq != freq)
+            continue;
+        if (!cl_vfos[i].node.isEmpty())
+            send(cl_nodes.value(cl_vfos[i].node), QString("VFO %1 OFF\n").arg(cl_vfos[i].n));
+        cl_vfos.remove(i);
+        publish();
+        return;
+    }
+}
+
+/*! \brief Drop the nodes without heartbeat, reconnect and fetch the summaries. */
+void ClusterCoordinator::tick()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QStringList expired;
+    for (Node *node : cl_nodes)
+    {
+        if (now - node->seen_ms > CLUSTER_NODE_TIMEOUT_MS)
+            expired.append(node->name);
+        else if (node->socket->state() == QAbstractSocket::UnconnectedState)
+            connectNode(node);
+    }
+    for (const QString &name : expired)
+        dropNode(name);
+    if (!expired.isEmpty())
+    {
+        rebalance();
+        assignVfos();
+        publish();
+    }
+
+    if (now - cl_summary_ms < CLUSTER_SUMMARY_MS)
+        return;
+    cl_summary_ms = now;
+    for (Node *node : cl_nodes)
+        send(node, "SUMMARY\n");
+}
+
+void ClusterCoordinator::connectNode(Node *node)
+{
+    if (node->socket)
+    {
+        node->socket->disconnect(this);
+        node->socket->abort();
+        node->socket->deleteLater();
+    }
+    node->socket = new QTcpSocket(this);
+    node->input.clear();
+    node->pending = -1;
+
+    const QString name = node->name;
+    QTcpSocket *socket = node->socket;
+    connect(socket, &QTcpSocket::connected, this, [this, name]() { nodeConnected(name); });
+    connect(socket, &QTcpSocket::readyRead, this, [this, name]() { readNode(name); });
+    socket->connectToHost(node->host, node->port);
+}
+
+/*! \brief Subscribe to the detections of a node and send its assignments. */
+void ClusterCoordinator::nodeConnected(const QString &name)
+{
+    Node *node = cl_nodes.value(name, nullptr);
+    if (!node)
+        return;
+
+    send(node, "SUBSCRIBE DETECTIONS\n");
+    sendRanges(node);
+    for (const Vfo &vfo : cl_vfos)
+        if (vfo.node == name)
+            send(node, vfoCommand(vfo));
+    publish();
+}
+
+void ClusterCoordinator::readNode(const QString &name)
+{
+    Node *node = cl_nodes.value(name, nullptr);
+    if (!node)
+        return;
+
+    node->input += node->socket->readAll();
+    int end;
+    while ((end = node->input.indexOf('\n')) >= 0)
+    {
+        const QString line = QString::fromUtf8(node->input.left(end)).trimmed();
+        node->input.remove(0, end + 1);
+        readLine(node, line);
+    }
+}
+
+/*
+ * Handle a line from a node: the DETECTIONS lists and the SUMMARY replies.
+ * The replies to the commands sent are RPRT lines, which are skipped; a
+ * node without the sigint dock answers SURVEY with RPRT 1 and only gets
+ * VFOs.
+ */
+void ClusterCoordinator::readLine(Node *node, const QString &line)
+{
+    if (line.startsWith('{'))
+    {
+        if (line != node->summary)
+        {
+            node->summary = line;
+            emit summaryChanged(node->name, line);
+        }
+        return;
+    }
+
+    const QStringList words = line.simplified().split(' ');
+    if (words.size() == 3 && words[1] == "DETECTIONS")
+    {
+        // ! DETECTIONS <count>, the signals follow
+        node->pending = words[2].toInt();
+        node->listed.clear();
+        if (node->pending <= 0)
+            endDetections(node, false);
+    }
+    else if (words.size() >= 8 && words[1] == "DETECTION" && node->pending > 0)
+    {
+        // ! DETECTION <id> <center Hz> <bandwidth Hz> <peak dBFS> <SNR dB> <start time>
+        const qint64 id = words[2].toLongLong();
+        const Detection detection = { words[7].toDouble(), words[3].toDouble(),
+                                      words[4].toDouble(), words[5].toDouble() };
+        auto it = node->open.find(id);
+        if (it == node->open.end())
+        {
+            node->open.insert(id, detection);
+        }
+        else
+        {
+            it->center_freq = detection.center_freq;
+            it->bandwidth = detection.bandwidth;
+            it->peak_db = std::max(it->peak_db, detection.peak_db);
+        }
+        node->listed.insert(id);
+        if (--node->pending == 0)
+            endDetections(node, false);
+    }
+}
+
+/*! \brief End the open signals of a node that are not listed, or all of them. */
+void ClusterCoordinator::endDetections(Node *node, bool all)
+{
+    const double now = QDateTime::currentMSecsSinceEpoch() / 1000.0;
+    for (auto it = node->open.begin(); it != node->open.end();)
+    {
+        if (!all && node->listed.contains(it.key()))
+        {
+            ++it;
+            continue;
+        }
+        emit emissionEnded(node->name, it->start_time, now, it->center_freq, it->bandwidth,
+                           it->peak_db);
+        it = node->open.erase(it);
+    }
+    node->listed.clear();
+    node->pending = -1;
+}
+
+void ClusterCoordinator::dropNode(const QString &name)
+{
+    Node *node = cl_nodes.take(name);
+    if (!node)
+        return;
+
+    qInfo() << "Cluster node" << name << "left";
+    endDetections(node, true);
+    node->socket->disconnect(this);
+    node->socket->abort();
+    node->socket->deleteLater();
+    if (!node->summary.isEmpty())
+        emit summaryChanged(name, QString());
+    delete node;
+
+    for (Vfo &vfo : cl_vfos)
+        if (vfo.node == name)
+            vfo.node.clear();
+}
+
+void ClusterCoordinator::send(Node *node, const QString &lines)
+{
+    if (node && node->socket && node->socket->state() == QAbstractSocket::ConnectedState)
+        node->socket->write(lines.toLatin1());
+}
+
+void ClusterCoordinator::sendRanges(Node *node)
+{
+    QString lines("SURVEY CLEAR\n");
+    for (const QString &range : node->ranges)
+        lines += QString("SURVEY %1\n").arg(range);
+    send(node, lines);
+}
+
+QString ClusterCoordinator::vfoCommand(const Vfo &vfo) const
+{
+    return QString("VFO %1 %2 %3 %4\n").arg(vfo.n).arg(vfo.freq).arg(vfo.mode).arg(vfo.passband);
+}
+
+/* VFOs of the node, plus the span of its survey pieces in bandwidths */
+double ClusterCoordinator::load(const Node *node) const
+{
+    double span = 0.0;
+    for (const QString &range : node->ranges)
+        span += range.section(' ', 1, 1).toDouble() - range.section(' ', 0, 0).toDouble();
+
+    int vfos = 0;
+    for (const Vfo &vfo : cl_vfos)
+        vfos += vfo.node == node->name;
+    return vfos + span / node->bandwidth;
+}
+
+/*! \brief Split the coverage in proportion to the bandwidths of the nodes. */
+void ClusterCoordinator::rebalance()
+{
+    double total = 0.0;
+    for (const Node *node : cl_nodes)
+        total += node->bandwidth;
+
+    QHash<QString, QStringList> pieces;
+    for (const QString &range : cl_ranges)
+    {
+        const QStringList words = range.split(' ');
+        const double start = words.value(0).toDouble();
+        const double end = words.value(1).toDouble();
+        double pos = start;
+        int i = 0;
+        for (const Node *node : cl_nodes)
+        {
+            const double next = ++i == cl_nodes.size() ? end
+                                : pos + (end - start) * node->bandwidth / total;
+            if ((qint64)next > (qint64)pos)
+                pieces[node->name].append(QString("%1 %2 %3").arg((qint64)pos).arg((qint64)next)
+                                          .arg(words.value(2)));
+            pos = next;
+        }
+    }
+
+    for (Node *node : cl_nodes)
+    {
+        const QStringList ranges = pieces.value(node->name);
+        if (ranges == node->ranges)
+            continue;
+        node->ranges = ranges;
+        sendRanges(node);
+    }
+}
+
+/*! \brief Give the VFOs without a node to the least loaded node that covers them. */
+void ClusterCoordinator::assignVfos()
+{
+    for (Vfo &vfo : cl_vfos)
+    {
+        if (!vfo.node.isEmpty())
+            continue;
+
+        Node *best = nullptr;
+        double best_load = 0.0;
+        for (Node *node : cl_nodes)
+        {
+            if (std::abs(vfo.freq - node->center) > node->bandwidth * CLUSTER_VFO_USABLE_FRACTION / 2.0)
+                continue;
+            const double node_load = load(node);
+            if (!best || node_load < best_load)
+            {
+                best = node;
+                best_load = node_load;
+            }
+        }
+        if (!best)
+            continue;
+
+        int n = CLUSTER_VFO_MAX;
+        for (bool used = true; used && n > 0; )
+        {
+            used = false;
+            for (const Vfo &other : cl_vfos)
+                if (other.node == best->name && other.n == n)
+                    used = true;
+            if (used)
+                n--;
+        }
+        if (n == 0)
+            continue;
+
+        vfo.node = best->name;
+        vfo.n = n;
+        send(best, vfoCommand(vfo));
+    }
+}
+
+void ClusterCoordinator::publish()
+{
+    QString nodes;
+    for (const Node *node : cl_nodes)
+        nodes += QString("%1 %2 %3 %4 %5 %6 %7 %8\n").arg(node->name).arg(node->host)
+                 .arg(node->port).arg((qint64)node->center).arg((qint64)node->bandwidth)
+                 .arg(load(node), 0, 'f', 2).arg(node->ranges.size())
+                 .arg(node->socket->state() == QAbstractSocket::ConnectedState);
+
+    QString vfos;
+    for (const Vfo &vfo : cl_vfos)
+        vfos += QString("%1 %2 %3 %4 %5\n").arg(vfo.freq).arg(vfo.mode).arg(vfo.passband)
+                .arg(vfo.node.isEmpty() ? QString("-") : vfo.node).arg(vfo.n);
+    emit statusChanged(nodes, vfos);
+}
@@ -0,0 +1,200 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QSettings>
+#include <QString>
+#include <QStringList>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QVector>
+#include "applications/gqrx/receiver.h"
+
+/* Interval of the CLUSTER JOIN of a node */
+#define CLUSTER_HEARTBEAT_MS       10000
+
+/* A node whose last CLUSTER JOIN is older than this is dropped */
+#define CLUSTER_NODE_TIMEOUT_MS    30000
+
+/* Interval of the SUMMARY the coordinator asks every node for */
+#define CLUSTER_SUMMARY_MS         10000
+
+/* Part of the band of a node a VFO has to be in to be given to it */
+#define CLUSTER_VFO_USABLE_FRACTION 0.9
+
+/* VFO numbers the coordinator uses on a node, counted down from the highest */
+#define CLUSTER_VFO_MAX            8
+
+/*! \brief Joins this instance to the cluster of a coordinator.
+ *
+ * Every CLUSTER_HEARTBEAT_MS the member sends
+ *
+ *   CLUSTER JOIN <name> <port> <center Hz> <bandwidth Hz>
+ *
+ * to the remote control of the coordinator, with the port of its own
+ * remote control and the band of the last FFT frame, so nothing is sent
+ * while the receiver is stopped. The coordinator connects back to that
+ * port, so the remote control of the node has to allow the host of the
+ * coordinator, and the one of the coordinator the host of the node.
+ */
+class ClusterMember : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ClusterMember(receiver *rx, QObject *parent = 0);
+
+    void readSettings(QSettings *settings);
+    void setRemotePort(int port)
+    {
+        cl_rc_port = port;
+    }
+
+public slots:
+    void setLnbLo(double freq_mhz);
+
+private slots:
+    void heartbeat();
+
+private:
+    receiver   *cl_rx;
+    QTcpSocket  cl_socket;         /*!< To the remote control of the coordinator. */
+    QTimer      cl_timer;
+    QString     cl_host;           /*!< Of the coordinator, empty to stay alone. */
+    int         cl_port;
+    QString     cl_name;           /*!< Of this node. */
+    int         cl_rc_port;        /*!< Of the remote control of this node. */
+    double      cl_lnb_lo;         /*!< LNB LO [Hz], added to the band. */
+};
+
+/*! \brief Shares the work of a cluster of instances between them.
+ *
+ * Nodes join with CLUSTER JOIN, see ClusterMember, and the coordinator
+ * drives each of them through its remote control with the commands any
+ * client could send:
+ *
+ *  - The coverage, set with CLUSTER RANGE, is split between the nodes in
+ *    proportion to their bandwidths and handed out with SURVEY. Each node
+ *    gets one contiguous piece of every range, so a new node shrinks the
+ *    pieces of all the others and the same revisit interval covers more.
+ *  - Each VFO requested with CLUSTER VFO goes to the least loaded node with
+ *    the frequency in its band, as VFO <n> with n counted down from
+ *    CLUSTER_VFO_MAX. The load of a node is its VFOs plus the span of its
+ *    survey pieces in bandwidths. VFOs that no band covers wait for a node.
+ *  - The detections of every node come in by SUBSCRIBE DETECTIONS, and a
+ *    signal that leaves the list is emitted with emissionEnded() for the
+ *    sigint database.
+ *  - Every CLUSTER_SUMMARY_MS the SUMMARY of each node is fetched and
+ *    emitted with summaryChanged() when it changes.
+ *
+ * When a node leaves or stops sending its heartbeat, its open signals are
+ * ended, its survey pieces go to the others and its VFOs to other nodes
+ * that cover them. The assignments are sent again when a node reconnects.
+ */
+class ClusterCoordinator : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ClusterCoordinator(QObject *parent = 0);
+    ~ClusterCoordinator();
+
+public slots:
+    void join(const QString &host, const QString &name, int port, double center,
+              double bandwidth);
+    void setRanges(const QString &ranges);
+    void requestVfo(qint64 freq, const QString &mode, int passband);
+    void removeVfo(qint64 freq);
+
+signals:
+    /*! \brief Lines of CLUSTER and CLUSTER VFO. */
+    void statusChanged(const QString &nodes, const QString &vfos);
+    /*! \brief New SUMMARY of a node, empty when the node is gone. */
+    void summaryChanged(const QString &node, const QString &summary);
+    /*! \brief A signal of a node has ended, times in seconds since the epoch. */
+    void emissionEnded(const QString &node, double start_time, double stop_time,
+                       double center_freq, double bandwidth, double peak_db);
+
+private slots:
+    void tick();
+
+private:
+    /*! \brief Signal in the DETECTIONS of a node. */
+    struct Detection {
+        double      start_time;
+        double      center_freq;
+        double      bandwidth;
+        double      peak_db;       /*!< Highest level seen. */
+    };
+
+    struct Node {
+        QString     name;
+        QString     host;
+        int         port;          /*!< Of its remote control. */
+        double      center;        /*!< Band of the last JOIN [Hz]. */
+        double      bandwidth;
+        qint64      seen_ms;       /*!< Time of the last JOIN. */
+        QTcpSocket *socket;
+        QByteArray  input;         /*!< Received, not a whole line yet. */
+        int         pending;       /*!< DETECTION lines to come, -1 outside a list. */
+        QSet<qint64> listed;       /*!< Ids in the list being read. */
+        QHash<qint64, Detection> open; /*!< Signals by the id of the node. */
+        QStringList ranges;        /*!< Survey pieces, "<start> <end> <interval>". */
+        QString     summary;
+    };
+
+    /*! \brief VFO requested with CLUSTER VFO. */
+    struct Vfo {
+        qint64      freq;
+        QString     mode;
+        int         passband;
+        QString     node;          /*!< Empty until a node covers it. */
+        int         n;             /*!< VFO number on the node. */
+    };
+
+    void        connectNode(Node *node);
+    void        nodeConnected(const QString &name);
+    void        readNode(const QString &name);
+    void        readLine(Node *node, const QString &line);
+    void        endDetections(Node *node, bool all);
+    void        dropNode(const QString &name);
+    void        send(Node *node, const QString &lines);
+    void        sendRanges(Node *node);
+    QString     vfoCommand(const Vfo &vfo) const;
+    double      load(const Node *node) const;
+    void        rebalance();
+    void        assignVfos();
+    void        publish();
+
+    QMap<QString, Node *> cl_nodes;  /*!< By name, in the order the ranges are split. */
+    QStringList cl_ranges;         /*!< Coverage, "<start> <end> <interval>". */
+    QVector<Vfo> cl_vfos;
+    QTimer      cl_timer;
+    qint64      cl_summary_ms;     /*!< Time of the last SUMMARY round. */
+};
+
+#endif // CLUSTER_H
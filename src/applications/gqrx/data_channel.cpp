@@ -0,0 +1,334 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <chrono>
+#include <cstring>
+#include <QDebug>
+#include "data_channel.h"
+
+#define DEFAULT_DC_NAME     "aguila-data"
+
+/* Magic number at the start of every frame, "AGD1" on little endian hosts */
+#define DC_MAGIC            0x31444741
+#define DC_HEADER_SIZE      64
+#define DC_TYPE_FFT         1
+#define DC_TYPE_IQ          2
+
+/* Bytes queued for a client before its frames are dropped */
+#define DC_MAX_QUEUED       (16 * 1024 * 1024)
+
+/* Interval of the I/Q reads in ms, and size of the sniffer buffer in samples */
+#define DC_IQ_MS            20
+#define DC_IQ_BUFFER        1048576
+
+/* Store a value in the frame header at offset */
+template <typename T>
+static void put(char *header, int offset, T value)
+{
+    memcpy(header + offset, &value, sizeof(T));
+}
+
+DataChannel::DataChannel(receiver *rx, QObject *parent) :
+    QObject(parent),
+    dc_rx(rx),
+    dc_name(DEFAULT_DC_NAME),
+    dc_fft_sub(0),
+    dc_iq_reader(0),
+    dc_iq_seq(0),
+    dc_iq_index(0),
+    dc_iq_overruns(0)
+{
+    // Only the user running Gqrx may connect
+    dc_server.setSocketOptions(QLocalServer::UserAccessOption);
+    dc_iq_timer.setInterval(DC_IQ_MS);
+
+    connect(&dc_server, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+    connect(&dc_iq_timer, SIGNAL(timeout()), this, SLOT(readIq()));
+}
+
+DataChannel::~DataChannel()
+{
+    stop_server();
+}
+
+/*! \brief Start the server. */
+void DataChannel::start_server()
+{
+    if (dc_server.isListening())
+        return;
+
+    // A socket file left by a crashed instance would block listen(), but
+    // the socket of another running instance must be left alone. A local
+    // connect succeeds or fails at once.
+    QLocalSocket probe;
+    probe.connectToServer(dc_name);
+    if (probe.waitForConnected(100))
+    {
+        qWarning() << "Data channel:" << dc_name << "is used by another instance";
+        return;
+    }
+    QLocalServer::removeServer(dc_name);
+    if (!dc_server.listen(dc_name))
+        qWarning() << "Data channel:" << dc_server.errorString();
+}
+
+/*! \brief Stop the server and disconnect all clients. */
+void DataChannel::stop_server()
+{
+    for (Client &client : dc_clients)
+    {
+        disconnect(client.socket, 0, this, 0);
+        client.socket->abort();
+        client.socket->deleteLater();
+    }
+    dc_clients.clear();
+    updateStreams();
+
+    if (dc_server.isListening())
+        dc_server.close();
+}
+
+/*! \brief Read settings, and start or stop the server accordingly. */
+void DataChannel::readSettings(QSettings *settings)
+{
+    if (!settings)
+        return;
+
+    settings->beginGroup("data_channel");
+
+    const QString name = settings->value("name", DEFAULT_DC_NAME).toString();
+    if (name != dc_name)
+    {
+        stop_server();
+        dc_name = name;
+    }
+
+    if (settings->value("enabled", true).toBool())
+        start_server();
+    else
+        stop_server();
+
+    settings->endGroup();
+}
+
+void DataChannel::saveSettings(QSettings *settings) const
+{
+    if (!settings)
+        return;
+
+    settings->beginGroup("data_channel");
+
+    if (dc_server.isListening())
+        settings->remove("enabled");
+    else
+        settings->setValue("enabled", false);
+
+    if (dc_name != DEFAULT_DC_NAME)
+        settings->setValue("name", dc_name);
+    else
+        settings->remove("name");
+
+    settings->endGroup();
+}
+
+/*! \brief Accept new connections. They get nothing until they subscribe. */
+void DataChannel::acceptConnection()
+{
+    while (dc_server.hasPendingConnections())
+    {
+        QLocalSocket *socket = dc_server.nextPendingConnection();
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readSubscription()));
+        // Queued, a failed write must not remove a client while frames are sent
+        connect(socket, SIGNAL(disconnected()), this, SLOT(clientDisconnected()),
+                Qt::QueuedConnection);
+        dc_clients.append({socket, false, false, 0, 0});
+    }
+}
+
+/*! \brief Read the subscription lines of a client, the last one counts. */
+void DataChannel::readSubscription()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    for (Client &client : dc_clients)
+    {
+        if (client.socket != socket)
+            continue;
+
+        while (socket->canReadLine())
+        {
+            const QStringList streams = QString(socket->readLine()).toLower()
+                                        .split(' ', Qt::SkipEmptyParts);
+            client.fft = false;
+            client.iq = false;
+            for (const QString &stream : streams)
+            {
+                if (stream.trimmed() == "fft")
+                    client.fft = true;
+                else if (stream.trimmed() == "iq")
+                    client.iq = true;
+            }
+        }
+        break;
+    }
+    updateStreams();
+}
+
+void DataChannel::clientDisconnected()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    for (int i = 0; i < dc_clients.size(); i++)
+    {
+        if (dc_clients[i].socket == socket)
+        {
+            dc_clients.removeAt(i);
+            socket->deleteLater();
+            break;
+        }
+    }
+    updateStreams();
+}
+
+/*! \brief Subscribe to the FFT frames and read the I/Q sniffer while clients want them. */
+void DataChannel::updateStreams()
+{
+    bool fft = false;
+    bool iq = false;
+    for (const Client &client : dc_clients)
+    {
+        fft |= client.fft;
+        iq |= client.iq;
+    }
+
+    // Frames are published from the GUI thread, where this object lives
+    if (fft && !dc_fft_sub)
+        dc_fft_sub = dc_rx->subscribe_iq_fft([this](const iq_fft_frame_sptr &frame) {
+            publishFft(frame);
+        });
+    else if (!fft && dc_fft_sub)
+    {
+        dc_rx->unsubscribe_iq_fft(dc_fft_sub);
+        dc_fft_sub = 0;
+    }
+
+    if (iq && !dc_iq_reader)
+    {
+        dc_iq_reader = dc_rx->start_iq_sniffer(DC_IQ_BUFFER);
+        dc_iq_overruns = 0;
+        dc_iq_timer.start();
+    }
+    else if (!iq && dc_iq_reader)
+    {
+        dc_iq_timer.stop();
+        dc_rx->stop_iq_sniffer(dc_iq_reader);
+        dc_iq_reader = 0;
+    }
+}
+
+void DataChannel::publishFft(const iq_fft_frame_sptr &frame)
+{
+    const qint64 timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    frame->timestamp.time_since_epoch()).count();
+    for (Client &client : dc_clients)
+    {
+        if (client.fft)
+            send(client, DC_TYPE_FFT, frame->seq, frame->sample_index, timestamp_ns,
+                 frame->center_freq, frame->sample_rate,
+                 (const char *)frame->data.data(), frame->data.size(), sizeof(float),
+                 client.fft_dropped);
+    }
+}
+
+/*! \brief Send the I/Q samples collected since the last call. */
+void DataChannel::readIq()
+{
+    const gr_complex *samples = nullptr;
+    const unsigned int num = dc_rx->peek_iq_sniffer_data(dc_iq_reader, samples, DC_IQ_BUFFER);
+    if (num == 0)
+        return;
+
+    // Samples the sniffer dropped leave a gap in the sample index
+    const quint64 overruns = dc_rx->get_iq_sniffer_overruns(dc_iq_reader);
+    dc_iq_index += overruns - dc_iq_overruns;
+    dc_iq_overruns = overruns;
+
+    const double rate = dc_rx->get_demod_rate();
+    const double center = dc_rx->get_rf_freq() + dc_rx->get_filter_offset();
+    // Time of the first sample, the last one has just arrived
+    const qint64 timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::system_clock::now().time_since_epoch()).count()
+                              - (qint64)(1e9 * num / rate);
+
+    for (Client &client : dc_clients)
+    {
+        if (client.iq)
+            send(client, DC_TYPE_IQ, dc_iq_seq, dc_iq_index, timestamp_ns, center, rate,
+                 (const char *)samples, num, sizeof(gr_complex),
+                 client.iq_dropped);
+    }
+    dc_rx->release_iq_sniffer_data(dc_iq_reader, num);
+    dc_iq_seq++;
+    dc_iq_index += num;
+}
+
+/*! \brief Write one frame to a client, or drop it if the client is behind.
+ *
+ * The header fields are in the byte order of the host, which is also the
+ * byte order of the client since the socket is local:
+ *
+ *   0  uint32  magic, DC_MAGIC
+ *   4  uint16  type, 1 for FFT and 2 for I/Q
+ *   6  uint16  item size in bytes, 4 for FFT and 8 for I/Q
+ *   8  uint64  frame number of the stream
+ *  16  uint64  index of the first sample, at the FFT input or quadrature rate
+ *  24  int64   time of that sample in ns since the epoch
+ *  32  double  center frequency in Hz
+ *  40  double  sample rate in Hz
+ *  48  uint32  number of items in the payload
+ *  52  uint32  frames of this stream dropped before this one
+ *  56  8 bytes reserved, zero
+ */
+void DataChannel::send(Client &client, quint16 type, quint64 seq, quint64 sample_index,
+                       qint64 timestamp_ns, double center_freq, double sample_rate,
+                       const char *data, quint32 count, quint32 item_size, quint32 &dropped)
+{
+    if (client.socket->bytesToWrite() > DC_MAX_QUEUED)
+    {
+        dropped++;
+        return;
+    }
+
+    char header[DC_HEADER_SIZE] = {};
+    put<quint32>(header, 0, DC_MAGIC);
+    put<quint16>(header, 4, type);
+    put<quint16>(header, 6, (quint16)item_size);
+    put<quint64>(header, 8, seq);
+    put<quint64>(header, 16, sample_index);
+    put<qint64>(header, 24, timestamp_ns);
+    put<double>(header, 32, center_freq);
+    put<double>(header, 40, sample_rate);
+    put<quint32>(header, 48, count);
+    put<quint32>(header, 52, dropped);
+
+    client.socket->write(header, DC_HEADER_SIZE);
+    client.socket->write(data, (qint64)count * item_size);
+    dropped = 0;
+}
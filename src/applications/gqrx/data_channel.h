@@ -0,0 +1,114 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef DATA_CHANNEL_H
+#define DATA_CHANNEL_H
+
+#include <vector>
+#include <QByteArray>
+#include <QList>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QSettings>
+#include <QString>
+#include <QTimer>
+#include <gnuradio/gr_complex.h>
+#include "applications/gqrx/receiver.h"
+
+/*! \brief Local socket streaming FFT frames and I/Q samples to helper scripts.
+ *
+ * The remote control answers one short text line per command, which is
+ * fine for tuning but cannot carry measurement data. This server publishes
+ * the baseband FFT frames and the I/Q of the demodulator channel in binary
+ * frames on a local (Unix domain) socket, so Python tools can compute on
+ * live data at the full frame rate. resources/aguila_data.py is the client
+ * and resources/data-channel.txt describes the protocol.
+ *
+ *   client:  fft iq\n          # streams to subscribe to, replaces the last line
+ *     gqrx:  <64 byte header><payload> ...
+ *
+ * FFT payloads are the linear power of the frame, written straight from the
+ * frame shared by all spectrum consumers. I/Q payloads are complex floats
+ * from the I/Q sniffer at the quadrature rate. A client that does not keep
+ * up loses whole frames, counted in the header of the next frame it gets.
+ *
+ * The receiver is only subscribed to and the sniffer only read while a
+ * client wants the stream.
+ */
+class DataChannel : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DataChannel(receiver *rx, QObject *parent = 0);
+    ~DataChannel();
+
+    void start_server(void);
+    void stop_server(void);
+    bool is_running(void) const
+    {
+        return dc_server.isListening();
+    }
+
+    void readSettings(QSettings *settings);
+    void saveSettings(QSettings *settings) const;
+
+    QString serverName(void) const
+    {
+        return dc_server.fullServerName();
+    }
+
+private slots:
+    void acceptConnection();
+    void readSubscription();
+    void clientDisconnected();
+    void readIq();
+
+private:
+    /*! \brief A connected client and the streams it wants. */
+    struct Client {
+        QLocalSocket *socket;
+        bool          fft;
+        bool          iq;
+        quint32       fft_dropped;  /*!< Frames dropped since the last one sent. */
+        quint32       iq_dropped;
+    };
+
+    void publishFft(const iq_fft_frame_sptr &frame);
+    void send(Client &client, quint16 type, quint64 seq, quint64 sample_index,
+              qint64 timestamp_ns, double center_freq, double sample_rate,
+              const char *data, quint32 count, quint32 item_size, quint32 &dropped);
+    void updateStreams();
+
+    receiver      *dc_rx;
+    QLocalServer   dc_server;
+    QString        dc_name;          /*!< Name of the socket, see QLocalServer::listen(). */
+    QList<Client>  dc_clients;
+    int            dc_fft_sub;       /*!< FFT subscription, 0 if none. */
+    int            dc_iq_reader;     /*!< I/Q sniffer reader, 0 if none. */
+    QTimer         dc_iq_timer;
+    quint64        dc_iq_seq;        /*!< Blocks of I/Q read. */
+    quint64        dc_iq_index;      /*!< Samples of I/Q read or dropped. */
+    quint64        dc_iq_overruns;   /*!< The sniffer's drops counted in dc_iq_index. */
+};
+
+#endif // DATA_CHANNEL_H
@@ -82,6 +82,11 @@ int main(int argc, char *argv[])
     bool            edit_conf = false;
     int             return_code = 0;
 
+    // All OpenGL widgets (plotter waterfall and the sigint views) share one
+    // context group, so moving a dock to another window does not recreate
+    // their contexts and textures
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts, true);
+
     QApplication app(argc, argv);
     QCoreApplication::setOrganizationName(GQRX_ORG_NAME);
     QCoreApplication::setOrganizationDomain(GQRX_ORG_DOMAIN);
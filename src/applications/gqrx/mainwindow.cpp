@@ -30,6 +30,7 @@
 #include <QDateTime>
 #include <QDesktopServices>
 #include <QDialogButtonBox>
+#include <QEvent>
 #include <QFile>
 #include <QGroupBox>
 #include <QJsonDocument>
@@ -48,6 +49,7 @@
 #include <QVBoxLayout>
 #include <QSvgWidget>
 #include "qtgui/ioconfig.h"
+#include "dsp/trace.h"
 #include "mainwindow.h"
 #include "qtgui/dxc_options.h"
 #include "qtgui/dxc_spots.h"
@@ -57,10 +59,13 @@
 
 /* DSP */
 #include "receiver.h"
+#include "receiver_settings.h"
+#include "dsp/afsk1200/afsk1200_decoder.h"
 #include "remote_control_settings.h"
 
 #include "qtgui/bookmarkstaglist.h"
 #include "qtgui/bandplan.h"
+#include "qtgui/sigint_logger.h"
 
 MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent) :
     QMainWindow(parent),
@@ -68,16 +73,21 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     ui(new Ui::MainWindow),
     d_lnb_lo(0),
     d_hw_freq(0),
+    d_stall_ms(INPUT_STALL_MS),
     d_fftAvg(0.25),
     d_fftWindowType(0),
     d_fftNormalizeEnergy(false),
     d_have_audio(true),
-    dec_afsk1200(nullptr)
+    dec_afsk1200(nullptr),
+    dec_afsk1200_id(-1),
+    d_devices(nullptr)
 {
+    d_startup.start();
     ui->setupUi(this);
     BandPlan::create();
     Bookmarks::create();
     DXCSpots::create();
+    startupMark("ui");
 
     /* Initialise default configuration directory */
     QByteArray xdg_dir = qgetenv("XDG_CONFIG_HOME");
@@ -113,22 +123,60 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     /* create receiver object */
     rx = new receiver("", "", 1);
     rx->set_rf_freq(144500000.0);
+    rxQueue = new ReceiverQueue();
+    startupMark("receiver");
 
     // remote controller
-    remote = new RemoteControl();
+    remote = new RemoteControl(rx);
+
+    // Commands are answered in their own thread so a busy GUI does not
+    // delay them; the changes they make are applied on the GUI thread
+    remoteThread = new QThread(this);
+    remote->moveToThread(remoteThread);
+    connect(remoteThread, SIGNAL(finished()), remote, SLOT(deleteLater()));
+    remoteThread->start();
+
+    // data channel for helper scripts
+    dataChannel = new DataChannel(rx);
+
+    // cluster of instances, over the remote control
+    clusterMember = new ClusterMember(rx);
+    clusterCoordinator = new ClusterCoordinator();
+
+    scanner = new ChannelScanner(rx);
+
+    iqCapture = new IqCapture(rx, this);
+    iqAnnotations = new IqAnnotations(rx, this);
+    d_capture_detector = false;
+    d_capture_squelch = false;
+    d_squelch_open = false;
+    d_squelch_open_time = 0.0;
+    d_squelch_open_level = 0.0f;
+    d_drop_events = 0;
+    d_drop_label = new QLabel(this);
+    d_drop_label->setToolTip(tr("Gaps in the input, such as overflows of the device,\n"
+                                "in the last minute and since the start"));
+    d_drop_label->hide();
+    ui->statusBar->addPermanentWidget(d_drop_label);
 
     /* meter timer */
     meter_timer = new QTimer(this);
     connect(meter_timer, SIGNAL(timeout()), this, SLOT(meterTimeout()));
 
+    /* performance counters, polled while enabled */
+    perf_timer = new QTimer(this);
+    connect(perf_timer, SIGNAL(timeout()), this, SLOT(perfTimeout()));
+
     /* FFT timer & data */
-    d_iqFftData.resize(receiver::DEFAULT_FFT_SIZE);
+    d_zoom_fft = false;
     iq_fft_timer = new QTimer(this);
     iq_fft_timer->setTimerType(Qt::PreciseTimer);
     connect(iq_fft_timer, SIGNAL(timeout()), this, SLOT(iqFftTimeout()));
     d_last_fft_ms = 0;
     d_avg_fft_rate = 0.0;
     d_frame_drop = false;
+    d_fft_busy_ns = 0;
+    d_display_hidden = false;
 
     d_audioFftData.resize(receiver::DEFAULT_FFT_SIZE);
     audio_fft_timer = new QTimer(this);
@@ -150,11 +198,15 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     uiDockAudio = new DockAudio();
     uiDockInputCtl = new DockInputCtl();
     uiDockFft = new DockFft();
+    startupMark("docks");
     uiDockSigint = new DockSigint(rx, this);
+    startupMark("sigint dock");
     BandPlan::Get().setConfigDir(m_cfg_dir);
     Bookmarks::Get().setConfigDir(m_cfg_dir);
+    rx->load_fft_wisdom((m_cfg_dir + "/fftw_wisdom").toStdString());
     BandPlan::Get().load();
     uiDockBookmarks = new DockBookmarks(this);
+    uiDockPerf = new DockPerf();
 
     // setup some toggle view shortcuts
     uiDockInputCtl->toggleViewAction()->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_J));
@@ -204,9 +256,12 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     uiDockAudio->raise();
 
     addDockWidget(Qt::BottomDockWidgetArea, uiDockBookmarks);
+    addDockWidget(Qt::BottomDockWidgetArea, uiDockPerf);
+    tabifyDockWidget(uiDockBookmarks, uiDockPerf);
 
     /* hide docks that we don't want to show initially */
     uiDockBookmarks->hide();
+    uiDockPerf->hide();
     uiDockRDS->hide();
 
     /* Add dock widget actions to View menu. By doing it this way all signal/slot
@@ -219,6 +274,14 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     ui->menu_View->addAction(uiDockFft->toggleViewAction());
     ui->menu_View->addAction(uiDockSigint->toggleViewAction());
     ui->menu_View->addAction(uiDockBookmarks->toggleViewAction());
+    ui->menu_View->addAction(uiDockPerf->toggleViewAction());
+    ui->menu_View->addSeparator();
+    d_panorama_action = ui->menu_View->addAction(tr("Sweep panorama"));
+    d_panorama_action->setCheckable(true);
+    connect(d_panorama_action, SIGNAL(toggled(bool)), this, SLOT(setPanorama(bool)));
+    d_baseline_action = ui->menu_View->addAction(tr("Difference to baseline"));
+    d_baseline_action->setCheckable(true);
+    connect(d_baseline_action, SIGNAL(toggled(bool)), this, SLOT(setBaselineView(bool)));
     ui->menu_View->addSeparator();
     ui->menu_View->addAction(ui->mainToolBar->toggleViewAction());
     ui->menu_View->addSeparator();
@@ -231,6 +294,7 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     connect(ui->freqCtrl, SIGNAL(newFrequency(qint64)), uiDockRxOpt, SLOT(setRxFreq(qint64)));
     connect(uiDockInputCtl, SIGNAL(lnbLoChanged(double)), this, SLOT(setLnbLo(double)));
     connect(uiDockInputCtl, SIGNAL(lnbLoChanged(double)), remote, SLOT(setLnbLo(double)));
+    connect(uiDockInputCtl, SIGNAL(lnbLoChanged(double)), clusterMember, SLOT(setLnbLo(double)));
     connect(uiDockInputCtl, SIGNAL(gainChanged(QString, double)), this, SLOT(setGain(QString,double)));
     connect(uiDockInputCtl, SIGNAL(gainChanged(QString, double)), remote, SLOT(setGain(QString,double)));
     connect(uiDockInputCtl, SIGNAL(autoGainChanged(bool)), this, SLOT(setAutoGain(bool)));
@@ -278,9 +342,15 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     connect(uiDockFft, SIGNAL(fftSizeChanged(int)), this, SLOT(setIqFftSize(int)));
     connect(uiDockFft, SIGNAL(fftRateChanged(int)), this, SLOT(setIqFftRate(int)));
     connect(uiDockFft, SIGNAL(fftWindowChanged(int)), this, SLOT(setIqFftWindow(int)));
+    connect(uiDockFft, SIGNAL(fftStreamingChanged(bool,float,int)), this, SLOT(setIqFftStreaming(bool,float,int)));
+    connect(uiDockFft, SIGNAL(fftThreadsChanged(int)), this, SLOT(setIqFftThreads(int)));
+    connect(uiDockFft, SIGNAL(fftGpuChanged(bool)), this, SLOT(setIqFftGpu(bool)));
+    connect(uiDockFft, SIGNAL(fftEstimatorChanged(int,int)), this, SLOT(setIqFftEstimator(int,int)));
+    connect(uiDockFft, SIGNAL(zoomFftChanged(bool)), this, SLOT(setZoomFft(bool)));
     connect(uiDockFft, SIGNAL(wfSpanChanged(quint64)), this, SLOT(setWfTimeSpan(quint64)));
     connect(uiDockFft, SIGNAL(fftSplitChanged(int)), this, SLOT(setIqFftSplit(int)));
     connect(uiDockFft, SIGNAL(fftAvgChanged(float)), ui->plotter, SLOT(setFftAvg(float)));
+    connect(uiDockFft, SIGNAL(fftLogAvgChanged(bool)), ui->plotter, SLOT(setFftLogAvg(bool)));
     connect(uiDockFft, SIGNAL(fftZoomChanged(float)), ui->plotter, SLOT(zoomOnXAxis(float)));
     connect(uiDockFft, SIGNAL(waterfallModeChanged(int)), ui->plotter, SLOT(setWaterfallMode(int)));
     connect(uiDockFft, SIGNAL(plotModeChanged(int)), ui->plotter, SLOT(setPlotMode(int)));
@@ -293,6 +363,8 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     connect(uiDockFft, SIGNAL(markersChanged(bool)), ui->plotter, SLOT(enableMarkers(bool)));
     connect(uiDockFft, SIGNAL(markersChanged(bool)), this, SLOT(enableMarkers(bool)));
     connect(uiDockFft, SIGNAL(wfColormapChanged(const QString)), ui->plotter, SLOT(setWfColormap(const QString)));
+    connect(uiDockFft, SIGNAL(gpuWaterfallChanged(bool)), ui->plotter, SLOT(setGpuWaterfall(bool)));
+    connect(uiDockFft, SIGNAL(wfResolutionChanged(int)), ui->plotter, SLOT(setWaterfallResolution(int)));
     connect(uiDockFft, SIGNAL(wfColormapChanged(const QString)), uiDockAudio, SLOT(setWfColormap(const QString)));
     connect(uiDockFft, SIGNAL(pandapterRangeChanged(float,float)),
             ui->plotter, SLOT(setPandapterRange(float,float)));
@@ -303,6 +375,7 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     connect(uiDockFft, SIGNAL(fftMaxHoldToggled(bool)), ui->plotter, SLOT(enableMaxHold(bool)));
     connect(uiDockFft, SIGNAL(fftMinHoldToggled(bool)), ui->plotter, SLOT(enableMinHold(bool)));
     connect(uiDockFft, SIGNAL(peakDetectToggled(bool)), ui->plotter, SLOT(enablePeakDetect(bool)));
+    connect(uiDockFft, SIGNAL(autoRangeChanged(bool)), ui->plotter, SLOT(enableLevelStats(bool)));
     connect(uiDockRDS, SIGNAL(rdsDecoderToggled(bool)), this, SLOT(setRdsDecoder(bool)));
 
     // Plotter
@@ -310,6 +383,8 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
             uiDockFft, SLOT(setPandapterRange(float,float)));
     connect(ui->plotter, SIGNAL(newZoomLevel(float)),
             uiDockFft, SLOT(setZoomLevel(float)));
+    connect(ui->plotter, SIGNAL(levelStatsUpdated(float,float)),
+            uiDockFft, SLOT(setLevelStats(float,float)));
     connect(ui->plotter, SIGNAL(newSize()), this, SLOT(setWfSize()));
     connect(ui->plotter, SIGNAL(markerSelectA(qint64)), this, SLOT(setMarkerA(qint64)));
     connect(ui->plotter, SIGNAL(markerSelectB(qint64)), this, SLOT(setMarkerB(qint64)));
@@ -317,19 +392,33 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     // Bookmarks
     connect(uiDockBookmarks, SIGNAL(newBookmarkActivated(qint64, QString, int)), this, SLOT(onBookmarkActivated(qint64, QString, int)));
     connect(uiDockBookmarks->actionAddBookmark, SIGNAL(triggered()), this, SLOT(on_actionAddBookmark_triggered()));
-    connect(&Bookmarks::Get(), SIGNAL(BookmarksChanged()), ui->plotter, SLOT(updateOverlay()));
+    connect(uiDockBookmarks->actionScanBookmarks, SIGNAL(toggled(bool)), this, SLOT(onBookmarkScanToggled(bool)));
+    connect(scanner, &ChannelScanner::channelActive, this, &MainWindow::onScannerChannelActive);
+    connect(&Bookmarks::Get(), SIGNAL(BookmarksChanged()), ui->plotter, SLOT(updateTags()));
 
     //DXC Spots
     connect(&DXCSpots::Get(), SIGNAL(dxcSpotsUpdated()), this, SLOT(updateClusterSpots()));
 
     // I/Q playback
-    connect(iq_tool, SIGNAL(startRecording(QString, QString)), this, SLOT(startIqRecording(QString, QString)));
-    connect(iq_tool, SIGNAL(startRecording(QString, QString)), remote, SLOT(startIqRecorder(QString, QString)));
+    connect(iq_tool, SIGNAL(startRecording(QString, QString, QString, bool)), this, SLOT(startIqRecording(QString, QString, QString, bool)));
+    connect(iq_tool, SIGNAL(startRecording(QString, QString, QString, bool)), remote, SLOT(startIqRecorder(QString, QString)));
     connect(iq_tool, SIGNAL(stopRecording()), this, SLOT(stopIqRecording()));
     connect(iq_tool, SIGNAL(stopRecording()), remote, SLOT(stopIqRecorder()));
-    connect(iq_tool, SIGNAL(startPlayback(QString,float,qint64)), this, SLOT(startIqPlayback(QString,float,qint64)));
+    connect(iq_tool, SIGNAL(startPlayback(QString,float,qint64,QString)), this, SLOT(startIqPlayback(QString,float,qint64,QString)));
     connect(iq_tool, SIGNAL(stopPlayback()), this, SLOT(stopIqPlayback()));
     connect(iq_tool, SIGNAL(seek(qint64)), this,SLOT(seekIqFile(qint64)));
+    connect(iq_tool, SIGNAL(playbackSpeedChanged(double)), this, SLOT(setIqPlaybackSpeed(double)));
+    connect(iq_tool, SIGNAL(captureSettingsChanged(double,double,bool,bool)), this, SLOT(setIqCapture(double,double,bool,bool)));
+    connect(iq_tool, SIGNAL(captureRequested()), this, SLOT(onManualIqCapture()));
+    connect(remote, SIGNAL(iqCaptureRequested(QString)), this, SLOT(triggerIqCapture(QString)));
+    connect(uiDockSigint, SIGNAL(iqCaptureRequested(QString)), this, SLOT(triggerIqCapture(QString)));
+    connect(uiDockSigint, SIGNAL(signalDetected(QString)), this, SLOT(onSignalDetected(QString)));
+    connect(uiDockSigint, &DockSigint::storeEventsInDb, iqAnnotations, &IqAnnotations::addEvents);
+    connect(uiDockSigint, &DockSigint::sweepSegment, this, &MainWindow::onSweepSegment);
+    connect(uiDockSigint, &DockSigint::baselineChanged, this, [this](bool enabled) {
+        if (!enabled)
+            d_baseline_action->setChecked(false);
+    });
 
     // remote control
     connect(remote, SIGNAL(newRDSmode(bool)), uiDockRDS, SLOT(setRDSmode(bool)));
@@ -360,6 +449,51 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     connect(remote, SIGNAL(waterfallRangeChanged(float,float)), ui->plotter, SLOT(setWaterfallRange(float,float)));
     connect(remote, SIGNAL(waterfallRangeChanged(float,float)), uiDockFft, SLOT(setWaterfallRange(float,float)));
     connect(remote, SIGNAL(takeScreenshot()), this, SLOT(captureScreenshot()));
+    connect(ui->actionRenderTiming, SIGNAL(toggled(bool)), ui->plotter, SLOT(enableRenderTiming(bool)));
+    connect(ui->actionRenderTiming, SIGNAL(toggled(bool)), remote, SLOT(setRenderTimingStatus(bool)));
+    connect(remote, SIGNAL(renderTimingChanged(bool)), ui->actionRenderTiming, SLOT(setChecked(bool)));
+    connect(uiDockPerf, SIGNAL(perfCountersToggled(bool)), this, SLOT(setPerfCounters(bool)));
+    connect(remote, SIGNAL(perfCountersChanged(bool)), uiDockPerf, SLOT(setPerfEnabled(bool)));
+
+    // tuning commands typed in the sigint chat
+    connect(uiDockSigint, SIGNAL(newFrequency(qint64)), ui->freqCtrl, SLOT(setFrequency(qint64)));
+    connect(uiDockSigint, SIGNAL(newMode(int)), this, SLOT(selectDemod(int)));
+    connect(uiDockSigint, SIGNAL(newMode(int)), uiDockRxOpt, SLOT(setCurrentDemod(int)));
+    connect(uiDockSigint, SIGNAL(newPassband(int)), this, SLOT(setPassband(int)));
+    connect(uiDockSigint, SIGNAL(classificationChanged(QString)), ui->plotter, SLOT(setClassification(QString)));
+    connect(uiDockSigint, SIGNAL(detectionsChanged(QString)), remote, SLOT(setDetections(QString)));
+    connect(uiDockFft, SIGNAL(waterfallRangeChanged(float,float)), remote, SLOT(setWaterfallRange(float,float)));
+    connect(uiDockFft, SIGNAL(wfColormapChanged(const QString)), remote, SLOT(setWfColormap(const QString)));
+    remote->setSnapshot(uiDockSigint->snapshot());
+    remote->setTiles(uiDockSigint->tiles());
+    connect(uiDockSigint, SIGNAL(detectorChanged(bool)), remote, SLOT(setDetectorStatus(bool)));
+    connect(remote, SIGNAL(detectorChanged(bool)), uiDockSigint, SLOT(setDetectorEnabled(bool)));
+    connect(ui->plotter, SIGNAL(renderTimingUpdated(QString)), remote, SLOT(setRenderTiming(QString)));
+    connect(remote, SIGNAL(newVfo(int,qint64,int,int)), this, SLOT(setVfo(int,qint64,int,int)));
+    remote->setSurveyAvailable(true);
+    connect(remote, SIGNAL(surveyRangesChanged(QString)), uiDockSigint, SLOT(setSurveyRanges(QString)));
+    connect(remote, SIGNAL(clusterJoin(QString,QString,int,double,double)),
+            clusterCoordinator, SLOT(join(QString,QString,int,double,double)));
+    connect(remote, SIGNAL(clusterRangesChanged(QString)), clusterCoordinator, SLOT(setRanges(QString)));
+    connect(remote, SIGNAL(clusterVfoRequested(qint64,QString,int)),
+            clusterCoordinator, SLOT(requestVfo(qint64,QString,int)));
+    connect(remote, SIGNAL(clusterVfoRemoved(qint64)), clusterCoordinator, SLOT(removeVfo(qint64)));
+    connect(clusterCoordinator, SIGNAL(statusChanged(QString,QString)),
+            remote, SLOT(setClusterStatus(QString,QString)));
+    connect(clusterCoordinator, SIGNAL(summaryChanged(QString,QString)),
+            remote, SLOT(setClusterSummary(QString,QString)));
+    connect(clusterCoordinator, SIGNAL(emissionEnded(QString,double,double,double,double,double)),
+            uiDockSigint, SLOT(storeClusterEmission(QString,double,double,double,double,double)));
+    connect(remote, SIGNAL(vfoRemoved(int)), this, SLOT(removeVfo(int)));
+    connect(remote, SIGNAL(newVfoMuted(int,bool)), this, SLOT(setVfoMuted(int,bool)));
+    connect(remote, SIGNAL(newVfoSquelchLevel(int,double)), this, SLOT(setVfoSqlLevel(int,double)));
+    connect(remote, SIGNAL(newVfoUdpStreaming(int,QString,int,bool,int)),
+            this, SLOT(setVfoUdpStreaming(int,QString,int,bool,int)));
+    connect(remote, SIGNAL(newVfoRecording(int,int)), this, SLOT(setVfoRecording(int,int)));
+    connect(remote, SIGNAL(newVfoAfsk(int,bool)), this, SLOT(setVfoAfsk(int,bool)));
+    connect(remote, SIGNAL(newVfoChannels(int)), this, SLOT(setVfoChannels(int)));
+    connect(remote, SIGNAL(newIqStream(int,int,int,QString,int)),
+            this, SLOT(setIqStream(int,int,int,QString,int)));
 
     rds_timer = new QTimer(this);
     connect(rds_timer, SIGNAL(timeout()), this, SLOT(rdsTimeout()));
@@ -367,9 +501,8 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     // enable frequency tooltips on FFT plot
     ui->plotter->setTooltipsEnabled(true);
 
-    // Create list of input devices. This must be done before the configuration is
-    // restored because device probing might change the device configuration
-    CIoConfig::getDeviceList(devList);
+    // Input devices for the I/O configurator, which scans for them when it opens
+    d_devices = new DeviceCache(m_cfg_dir + "/devices.conf", this);
 
     m_recent_config = new RecentConfig(m_cfg_dir, ui->menu_RecentConfig);
     connect(m_recent_config, SIGNAL(loadConfig(const QString &)), this, SLOT(loadConfigSlot(const QString &)));
@@ -405,6 +538,16 @@ MainWindow::MainWindow(const QString& cfgfile, bool edit_conf, QWidget *parent)
     }
 
     qsvg_dummy = new QSvgWidget();
+    startupMark("config loaded");
+
+    // Reported with the first spectrum, or once the window is up if the
+    // DSP is not running
+    QTimer::singleShot(0, this, [this]() {
+        startupMark("event loop");
+        if (!ui->actionDSP->isChecked())
+            reportStartup();
+    });
+    QTimer::singleShot(STARTUP_REPORT_MS, this, &MainWindow::reportStartup);
 }
 
 MainWindow::~MainWindow()
@@ -418,12 +561,18 @@ MainWindow::~MainWindow()
     meter_timer->stop();
     delete meter_timer;
 
+    perf_timer->stop();
+    delete perf_timer;
+
     iq_fft_timer->stop();
     delete iq_fft_timer;
 
     audio_fft_timer->stop();
     delete audio_fft_timer;
 
+    // Tunes back, while the receiver is still there
+    delete scanner;
+
     if (m_settings)
     {
         m_settings->setValue("configversion", 4);
@@ -456,8 +605,17 @@ MainWindow::~MainWindow()
     delete uiDockFft;
     delete uiDockInputCtl;
     delete uiDockRDS;
+    delete uiDockSigint;
+    delete uiDockPerf;
+    delete dataChannel;
+    delete clusterMember;
+    delete clusterCoordinator;
+    // The remote control is deleted in its thread, before the receiver
+    remoteThread->quit();
+    remoteThread->wait();
+    // Runs the commands still queued
+    delete rxQueue;
     delete rx;
-    delete remote;
     delete qsvg_dummy;
 }
 
@@ -534,6 +692,10 @@ bool MainWindow::loadConfig(const QString& cfgfile, bool check_crash,
     if (skip_loading_cfg)
         return false;
 
+    // The settings below rewire the flow graph one by one, it is started
+    // again once at the end
+    rx->begin_config();
+
     // manual reconf (FIXME: check status)
     conv_ok = false;
 
@@ -587,6 +749,8 @@ bool MainWindow::loadConfig(const QString& cfgfile, bool check_crash,
         }
         else
             updateGainStages(true);
+
+        d_stall_ms = readStandbySettings(rx, m_settings);
     }
 
     QString outdev = m_settings->value("output/device", "").toString();
@@ -602,6 +766,10 @@ bool MainWindow::loadConfig(const QString& cfgfile, bool check_crash,
                          QMessageBox::Ok);
     }
 
+    readMemorySettings(m_settings);
+    readBufferSettings(rx, m_settings);
+    readThreadSettings(rx, m_settings);
+
     int_val = m_settings->value("input/sample_rate", 0).toInt(&conv_ok);
     if (conv_ok && (int_val > 0))
     {
@@ -632,6 +800,7 @@ bool MainWindow::loadConfig(const QString& cfgfile, bool check_crash,
 
     if (actual_rate > 0.)
     {
+        readDecimSettings(rx, m_settings);
         int_val = m_settings->value("input/decimation", 1).toInt(&conv_ok);
         if (conv_ok && int_val >= 2)
         {
@@ -656,7 +825,8 @@ bool MainWindow::loadConfig(const QString& cfgfile, bool check_crash,
         uiDockFft->setSampleRate(actual_rate);
         ui->plotter->setSampleRate(actual_rate);
         ui->plotter->setSpanFreq((quint32)actual_rate);
-        remote->setBandwidth((qint64)actual_rate);
+        QMetaObject::invokeMethod(remote, "setBandwidth", Qt::QueuedConnection,
+                                  Q_ARG(qint64, (qint64)actual_rate));
         iq_tool->setSampleRate((qint64)actual_rate);
     }
     else
@@ -675,6 +845,7 @@ bool MainWindow::loadConfig(const QString& cfgfile, bool check_crash,
     uiDockRxOpt->readSettings(m_settings);
     uiDockFft->readSettings(m_settings);
     uiDockAudio->readSettings(m_settings);
+    uiDockSigint->readSettings(m_settings);
     dxc_options->readSettings(m_settings);
 
     {
@@ -713,6 +884,8 @@ bool MainWindow::loadConfig(const QString& cfgfile, bool check_crash,
 
     iq_tool->readSettings(m_settings);
 
+    rx->end_config();
+
     /*
      * Initialization the remote control at the end.
      * We must be sure that all variables initialized before starting RC server.
@@ -725,6 +898,14 @@ bool MainWindow::loadConfig(const QString& cfgfile, bool check_crash,
        ui->actionRemoteControl->setChecked(true);
     }
 
+    // The remote control runs in its thread
+    QMetaObject::invokeMethod(remote, "setClusterCoordinator", Qt::QueuedConnection,
+                              Q_ARG(bool, m_settings->value("cluster/coordinator", false).toBool()));
+    clusterMember->setRemotePort(remote->getPort());
+    clusterMember->readSettings(m_settings);
+
+    dataChannel->readSettings(m_settings);
+
     emit m_recent_config->configLoaded(m_settings->fileName());
 
     return conf_ok;
@@ -801,8 +982,10 @@ void MainWindow::storeSession()
         uiDockRxOpt->saveSettings(m_settings);
         uiDockFft->saveSettings(m_settings);
         uiDockAudio->saveSettings(m_settings);
+        uiDockSigint->saveSettings(m_settings);
 
         remote->saveSettings(m_settings);
+        dataChannel->saveSettings(m_settings);
         iq_tool->saveSettings(m_settings);
         dxc_options->saveSettings(m_settings);
 
@@ -901,7 +1084,78 @@ void MainWindow::updateGainStages(bool read_from_device)
     }
 
     uiDockInputCtl->setGainStages(gain_list);
-    remote->setGainStages(gain_list);
+    QMetaObject::invokeMethod(remote, "setGainStages", Qt::QueuedConnection,
+                              Q_ARG(gain_list_t, gain_list));
+}
+
+/**
+ * Show and log new gaps in the input. Each is logged with the input rate and
+ * decimation at the time, so that data loss can be traced to the load and
+ * the configuration.
+ */
+void MainWindow::checkInputDrops()
+{
+    uint64_t events, samples;
+    rx->get_input_drops(events, samples);
+    if (events == d_drop_events && d_drop_times.isEmpty())
+        return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (uint64_t i = d_drop_events; i < events; i++)
+        d_drop_times.append(now);
+    while (!d_drop_times.isEmpty() && now - d_drop_times.first() > 60000)
+        d_drop_times.removeFirst();
+
+    if (events != d_drop_events)
+    {
+        SIGINT_LOG(SigintLogger::Warning, SigintLogger::General,
+                   QString("Input gap: %1 new, %2 in the last minute, %3 in total with %4 samples "
+                           "dropped, input rate %5 Hz, decimation %6")
+                   .arg(events - d_drop_events).arg(d_drop_times.size()).arg(events)
+                   .arg(samples).arg(rx->get_input_rate(), 0, 'f', 0)
+                   .arg(rx->get_input_decim()));
+        d_drop_events = events;
+    }
+
+    d_drop_label->setText(tr("Input gaps: %1/min, %2 total, %3 samples dropped")
+                          .arg(d_drop_times.size()).arg(events).arg(samples));
+    d_drop_label->show();
+}
+
+/** Add a step to the startup timeline, with the time since the window was created. */
+void MainWindow::startupMark(const QString &what)
+{
+    if (d_startup.isValid())
+        d_startup_marks.append(QString("%1 %2 ms").arg(what).arg(d_startup.elapsed()));
+}
+
+/** Log the startup timeline, once. */
+void MainWindow::reportStartup()
+{
+    if (!d_startup.isValid())
+        return;
+
+    SIGINT_LOG(SigintLogger::Info, SigintLogger::General,
+               "Startup: " + d_startup_marks.join(", "));
+    d_startup.invalidate();
+    d_startup_marks.clear();
+}
+
+/**
+ * The receiver switched to the standby device after the input device
+ * stalled. The configuration keeps both devices, so the next start uses the
+ * input device again.
+ */
+void MainWindow::inputFailover()
+{
+    QString standby = m_settings->value("input/standby_device", "").toString();
+    qWarning() << "Input device stalled, switched to standby device" << standby;
+    ui->statusBar->showMessage(tr("Input device stalled, switched to %1").arg(standby));
+    setWindowTitle(QString("Aguila Signal Analysis Platform - %1").arg(standby));
+
+    std::vector<std::string> antennas = rx->get_antennas();
+    uiDockInputCtl->setAntennas(antennas);
+    updateGainStages(true);
 }
 
 /**
@@ -926,6 +1180,8 @@ void MainWindow::setNewFrequency(qint64 rx_freq)
     uiDockRxOpt->setHwFreq(d_hw_freq);
     ui->freqCtrl->setFrequency(rx_freq);
     uiDockBookmarks->setNewFrequency(rx_freq);
+    uiDockSigint->setNewFrequency(rx_freq);
+    updateVfos();
 }
 
 // Update delta and center (of marker span) when markers are updated
@@ -1012,6 +1268,7 @@ void MainWindow::setLnbLo(double freq_mhz)
     updateFrequencyRange();
     ui->freqCtrl->setFrequency(d_lnb_lo + rf_freq);
     ui->plotter->setCenterFreq(d_lnb_lo + d_hw_freq);
+    updateVfos();
 
     // update LNB LO in settings
     if (freq_mhz == 0.)
@@ -1317,12 +1574,17 @@ void MainWindow::selectDemod(int mode_idx)
     ui->plotter->setHiLowCutFrequencies(flo, fhi);
     ui->plotter->setClickResolution(click_res);
     ui->plotter->setFilterClickResolution(click_res);
-    rx->set_filter((double)flo, (double)fhi, d_filter_shape);
+    // Queued too, or a filter still queued would override the preset
+    const receiver::filter_shape shape = d_filter_shape;
+    rxQueue->post("filter", [this, flo, fhi, shape]() {
+        return (int)rx->set_filter((double)flo, (double)fhi, shape);
+    });
     rx->set_cw_offset(cwofs);
     rx->set_sql_level(uiDockRxOpt->currentSquelchLevel());
 
-    remote->setMode(mode_idx);
-    remote->setPassband(flo, fhi);
+    QMetaObject::invokeMethod(remote, "setMode", Qt::QueuedConnection, Q_ARG(int, mode_idx));
+    QMetaObject::invokeMethod(remote, "setPassband", Qt::QueuedConnection,
+                              Q_ARG(int, flo), Q_ARG(int, fhi));
 
     d_have_audio = (mode_idx != DockRxOpt::MODE_OFF);
 
@@ -1480,14 +1742,79 @@ void MainWindow::meterTimeout()
 {
     float level;
 
+    if (rx->check_input_stall(d_stall_ms))
+        inputFailover();
+    checkInputDrops();
+
     level = rx->get_signal_pwr();
-    ui->sMeter->setLevel(level);
-    remote->setSignalLevel(level);
+    if (!d_display_hidden)
+        ui->sMeter->setLevel(level);
+    QMetaObject::invokeMethod(remote, "setSignalLevel", Qt::QueuedConnection,
+                              Q_ARG(float, level));
+
+    float ring_fill;
+    uint64_t dropped;
+    if (rx->get_iq_recording_stats(ring_fill, dropped))
+        iq_tool->setRecordingStats(ring_fill, dropped);
+
+    float audio_latency;
+    uint64_t underruns, audio_dropped;
+    if (rx->get_audio_stats(audio_latency, underruns, audio_dropped))
+        uiDockAudio->setOutputStats(audio_latency, underruns, audio_dropped);
+
+    uint64_t play_pos, play_length;
+    if (rx->get_iq_playback_position(play_pos, play_length))
+        iq_tool->setPlaybackPosition(play_pos);
+
+    double sql = uiDockRxOpt->getSqlLevel();
+    bool open = (sql > -150.0 && level >= sql);
+    if (open && !d_squelch_open && d_capture_squelch)
+        triggerIqCapture(tr("Squelch opened at %1 dBFS").arg(level, 0, 'f', 1));
+    if (open && !d_squelch_open)
+    {
+        d_squelch_open_time = QDateTime::currentMSecsSinceEpoch() / 1000.0;
+        d_squelch_open_level = level;
+    }
+    else if (!open && d_squelch_open)
+    {
+        iqAnnotations->addRange(d_squelch_open_time, QDateTime::currentMSecsSinceEpoch() / 1000.0,
+                                (double)ui->freqCtrl->getFrequency(), ui->plotter->getFilterBw(),
+                                "Gqrx squelch", "squelch",
+                                QString("Opened at %1 dBFS").arg(d_squelch_open_level, 0, 'f', 1));
+    }
+    d_squelch_open = open;
+    for (auto it = d_vfos.constBegin(); it != d_vfos.constEnd(); ++it)
+        QMetaObject::invokeMethod(remote, "setVfoLevel", Qt::QueuedConnection,
+                                  Q_ARG(int, it.key()),
+                                  Q_ARG(float, rx->get_vfo_signal_pwr(it->id)));
+}
+
+/** Enable or disable the performance counters of the flow graph. */
+void MainWindow::setPerfCounters(bool enabled)
+{
+    rx->set_perf_counters(enabled);
+    QMetaObject::invokeMethod(remote, "setPerfStatus", Qt::QueuedConnection,
+                              Q_ARG(bool, enabled));
+    if (enabled)
+        perf_timer->start(1000);
+    else
+        perf_timer->stop();
+}
+
+/** Show the performance counters and pass them to the remote control. */
+void MainWindow::perfTimeout()
+{
+    std::vector<receiver::block_perf> blocks = rx->get_block_perf();
+
+    uiDockPerf->setBlockPerf(blocks);
+    QMetaObject::invokeMethod(remote, "setBlockPerf", Qt::QueuedConnection,
+                              Q_ARG(QString, RemoteControl::formatBlockPerf(blocks)));
 }
 
 /** Baseband FFT plot timeout. */
 void MainWindow::iqFftTimeout()
 {
+    TRACE_SCOPE("gui", "MainWindow::iqFftTimeout");
     const unsigned int fftsize = rx->iq_fft_size();
 
     if (fftsize == 0)
@@ -1519,8 +1846,143 @@ void MainWindow::iqFftTimeout()
     }
     d_last_fft_ms = now_ms;
 
-    if (rx->get_iq_fft_data(d_iqFftData.data()) >= 0)
-        ui->plotter->setNewFftData(d_iqFftData.data(), fftsize);
+    // Shed display quality while the frames take too much of their interval
+    const double busy_ns = (double)(d_fft_busy_ns + ui->plotter->takeBusyNs());
+    if (d_governor.update(now_ms, busy_ns / (iq_fft_timer->interval() * 1e6), drop))
+    {
+        const int level = d_governor.level();
+        SIGINT_LOG(SigintLogger::Info, SigintLogger::General,
+                   QString("Display load %1 %, quality level %2 (%3)")
+                       .arg(qRound(d_governor.load() * 100.0))
+                       .arg(level)
+                       .arg(CLoadGovernor::levelName(level)));
+        if (level > CLoadGovernor::FULL)
+            ui->statusBar->showMessage(tr("Display quality reduced to keep up (%1)")
+                                       .arg(CLoadGovernor::levelName(level)), 5000);
+        applyLoadLevel();
+    }
+
+    // Publish one frame per tick to every spectrum consumer
+    QElapsedTimer busy;
+    busy.start();
+    CRenderTiming::Scope fftTiming(ui->plotter->renderTiming(), CRenderTiming::FFT);
+    iq_fft_frame_sptr frame = rx->publish_iq_fft_frame();
+    if (d_startup.isValid())
+    {
+        startupMark("first spectrum");
+        reportStartup();
+    }
+
+    // The frame is still published for the detectors, the survey and the
+    // remote clients, but nothing is drawn and the zoom FFT is stopped
+    if (d_display_hidden || !ui->plotter->isVisible())
+    {
+        rx->set_zoom_fft(false, 0.0, 0.0);
+        fftTiming.stop();
+        d_fft_busy_ns = busy.nsecsElapsed();
+        return;
+    }
+
+    // The difference to the baseline, which is of the full band frames
+    const SpectrumBaseline &baseline = uiDockSigint->baseline();
+    if (d_baseline_action->isChecked() && frame && baseline.isValid())
+    {
+        rx->set_zoom_fft(false, 0.0, 0.0);
+        fftTiming.stop();
+        d_fft_busy_ns = busy.nsecsElapsed();
+        if (baseline.seq() != frame->seq || baseline.size() != (int)frame->data.size())
+            return;
+
+        // A bin at its baseline is drawn at 0 dB
+        const int size = baseline.size();
+        const float scale = (float)size * (float)size;
+        d_baselineData.resize(size);
+        for (int i = 0; i < size; i++)
+            d_baselineData[i] = baseline.ratio()[i] * scale;
+        ui->plotter->setNewFftData(d_baselineData.data(), size);
+        return;
+    }
+
+    // Zoomed views use the decimated zoom FFT once it can decimate by at
+    // least two, with the full band FFT as fallback while it settles.
+    if (d_zoom_fft)
+    {
+        const qint64 span = ui->plotter->getSpanFreq();
+        const bool zoomed = span * 8 <= (qint64)ui->plotter->getSampleRate();
+        double zoom_center;
+        double zoom_rate;
+
+        rx->set_zoom_fft(zoomed, (double)ui->plotter->getFftCenterFreq(), (double)span);
+        d_zoomFftData.resize(rx->zoom_fft_size());
+        if (zoomed && rx->get_zoom_fft_data(d_zoomFftData.data(), zoom_center, zoom_rate) >= 0)
+        {
+            fftTiming.stop();
+            d_fft_busy_ns = busy.nsecsElapsed();
+            ui->plotter->setNewFftData(d_zoomFftData.data(), (int)d_zoomFftData.size(),
+                                       zoom_rate, qRound64(zoom_center));
+            return;
+        }
+    }
+
+    fftTiming.stop();
+    d_fft_busy_ns = busy.nsecsElapsed();
+    if (frame)
+        ui->plotter->setNewFftData(frame->data.data(), (int)frame->data.size());
+}
+
+/**
+ * Apply the level of the load governor.
+ *
+ * The levels add up, from the sigint dock views that few look at to the FFT
+ * rate that every display follows. The flow graph, and with it audio,
+ * recording and the decoders, is not touched.
+ */
+void MainWindow::applyLoadLevel()
+{
+    const int level = d_governor.level();
+
+    uiDockSigint->setViewRate(level >= CLoadGovernor::SIGINT ? SIGINT_VIEW_SHED_FPS : SIGINT_VIEW_FPS);
+    ui->plotter->setReducedDetail(level >= CLoadGovernor::OVERLAY);
+    ui->plotter->setWaterfallShed(level >= CLoadGovernor::WATERFALL);
+    setIqFftRate(uiDockFft->fftRate());
+}
+
+/*
+ * Suspend the display only work while the window is minimized: the plotter,
+ * the zoom and audio FFT, the S-meter and the views of the sigint dock.
+ * Recordings, decoders, detectors and the remote control go on, and so
+ * does the baseband FFT they take their frames from.
+ */
+void MainWindow::changeEvent(QEvent *event)
+{
+    QMainWindow::changeEvent(event);
+    if (event->type() == QEvent::WindowStateChange)
+        updateDisplayState();
+}
+
+void MainWindow::updateDisplayState()
+{
+    const bool hidden = isMinimized();
+    if (hidden == d_display_hidden)
+        return;
+
+    d_display_hidden = hidden;
+    SIGINT_LOG(SigintLogger::Info, SigintLogger::General,
+               hidden ? "Window minimized, display updates suspended"
+                      : "Window restored, display updates resumed");
+    uiDockSigint->setViewsSuspended(hidden);
+    if (hidden)
+        audio_fft_timer->stop();
+    else if (ui->actionDSP->isChecked())
+        audio_fft_timer->start(40);
+}
+
+/** FFT rate for the rate set by the user, halved at the last governor level. */
+int MainWindow::shedFftRate(int fps) const
+{
+    if (d_governor.level() < CLoadGovernor::FFT_RATE || fps <= LOAD_GOVERNOR_MIN_FPS)
+        return fps;
+    return qMax(fps / 2, LOAD_GOVERNOR_MIN_FPS);
 }
 
 /** Audio FFT plot timeout. */
@@ -1645,30 +2107,63 @@ void MainWindow::stopAudioStreaming()
     rx->stop_udp_streaming();
 }
 
-/** Start I/Q recording. */
-void MainWindow::startIqRecording(const QString& recdir, const QString& format)
+/**
+ * Start I/Q recording.
+ *
+ * The samples are cf32, cs16 or cs8, the integer formats are the float
+ * samples times iq_file_sink::scale(), which the SigMF metadata keeps as
+ * gqrx:full_scale. A compressed recording is a gzip stream of the same
+ * samples.
+ */
+void MainWindow::startIqRecording(const QString& recdir, const QString& format,
+                                  const QString& samples, bool compress)
 {
     qDebug() << __func__;
+    iq_file_format sample_format = IQ_FILE_CF32;
+    QString type = "fc";
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    QString datatype = "cf32_be";
+#else
+    QString datatype = "cf32_le";
+#endif
+    if (samples == "cs16")
+    {
+        sample_format = IQ_FILE_CS16;
+        type = "cs16";
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+        datatype = "ci16_be";
+#else
+        datatype = "ci16_le";
+#endif
+    }
+    else if (samples == "cs8")
+    {
+        sample_format = IQ_FILE_CS8;
+        type = "cs8";
+        datatype = "ci8";
+    }
+
     // generate file name using date, time, rf freq in kHz and BW in Hz
     // gqrx_iq_yyyymmdd_hhmmss_freq_bw_fc.raw
     auto freq = qRound64(rx->get_rf_freq());
     auto sr = qRound64(rx->get_input_rate());
     auto dec = (quint32)(rx->get_input_decim());
     auto currentDate = QDateTime::currentDateTimeUtc();
-    auto filenameTemplate = currentDate.toString("%1/gqrx_yyyyMMdd_hhmmss_%2_%3_fc.%4").arg(recdir).arg(freq).arg(sr/dec);
+    auto filenameTemplate = currentDate.toString("%1/gqrx_yyyyMMdd_hhmmss_%2_%3_%4.%5").arg(recdir).arg(freq).arg(sr/dec).arg(type);
     bool sigmf = (format == "SigMF");
     auto lastRec = filenameTemplate.arg(sigmf ? "sigmf-data" : "raw");
+    if (compress)
+        lastRec += ".gz";
 
     QFile metaFile(filenameTemplate.arg("sigmf-meta"));
     bool ok = true;
+    QJsonObject metaObject;
     if (sigmf) {
-        auto meta = QJsonDocument { QJsonObject {
+        metaObject = QJsonObject {
             {"global", QJsonObject {
-#if Q_BYTE_ORDER == Q_BIG_ENDIAN
-                {"core:datatype", "cf32_be"},
-#else
-                {"core:datatype", "cf32_le"},
-#endif
+                {"core:datatype", datatype},
+                {"gqrx:full_scale", iq_file_sink::scale(sample_format)},
+                {"gqrx:compression", compress ? "gzip" : "none"},
                 {"core:sample_rate", sr/dec},
                 {"core:version", "1.0.0"},
                 {"core:recorder", "Gqrx " VERSION},
@@ -1680,19 +2175,20 @@ void MainWindow::startIqRecording(const QString& recdir, const QString& format)
                     {"core:datetime", currentDate.toString(Qt::ISODateWithMs)},
                 },
             }}, {"annotations", QJsonArray {}},
-        }}.toJson();
+        };
+        auto meta = QJsonDocument(metaObject).toJson();
 
         if (!metaFile.open(QIODevice::WriteOnly) || metaFile.write(meta) != meta.size()) {
             ok = false;
         }
     }
 
-    // start recorder; fails if recording already in progress
-    if (!ok || rx->start_iq_recording(lastRec.toStdString()))
-    {
+    const QString metaName = (sigmf && metaFile.isOpen()) ? metaFile.fileName() : QString();
+    metaFile.close();
+    auto failed = [this, metaName]() {
         // remove metadata file if we managed to open it
-        if (sigmf && metaFile.isOpen())
-            metaFile.remove();
+        if (!metaName.isEmpty())
+            QFile::remove(metaName);
 
         // reset action status
         ui->statusBar->showMessage(tr("Error starting I/Q recoder"));
@@ -1703,13 +2199,29 @@ void MainWindow::startIqRecording(const QString& recdir, const QString& format)
         msg_box.setText(tr("There was an error starting the I/Q recorder.\n"
                            "Check write permissions for the selected location."));
         msg_box.exec();
-
-    }
-    else
+    };
+    if (!ok)
     {
+        failed();
+        return;
+    }
+
+    // start recorder; fails if recording already in progress
+    const std::string filename = lastRec.toStdString();
+    rxQueue->post(QString(), [this, filename, sample_format, compress]() {
+        return (int)rx->start_iq_recording(filename, sample_format, compress);
+    }, [=](int status) {
+        if (status != receiver::STATUS_OK)
+        {
+            failed();
+            return;
+        }
+        // Detector events, squelch openings and bookmarks while recording
+        if (sigmf)
+            iqAnnotations->start(metaName, metaObject, (double)(sr/dec), (double)freq);
         ui->statusBar->showMessage(tr("Recording I/Q data to: %1").arg(lastRec),
                                    5000);
-    }
+    });
 }
 
 /** Stop current I/Q recording. */
@@ -1717,15 +2229,68 @@ void MainWindow::stopIqRecording()
 {
     qDebug() << __func__;
 
-    if (rx->stop_iq_recording())
-        ui->statusBar->showMessage(tr("Error stopping I/Q recoder"));
-    else
-        ui->statusBar->showMessage(tr("I/Q data recoding stopped"), 5000);
+    // The recording may still be starting in the queue, so the samples
+    // dropped are taken there, just before it stops
+    auto dropped = std::make_shared<uint64_t>(0);
+    rxQueue->post(QString(), [this, dropped]() {
+        float ring_fill;
+        rx->get_iq_recording_stats(ring_fill, *dropped);
+        return (int)rx->stop_iq_recording();
+    }, [this, dropped](int status) {
+        iqAnnotations->stop();
+        if (status != receiver::STATUS_OK)
+            ui->statusBar->showMessage(tr("Error stopping I/Q recoder"));
+        else if (*dropped > 0)
+            ui->statusBar->showMessage(tr("I/Q data recoding stopped, %1 samples dropped")
+                                       .arg(*dropped), 5000);
+        else
+            ui->statusBar->showMessage(tr("I/Q data recoding stopped"), 5000);
+    });
 }
 
-void MainWindow::startIqPlayback(const QString& filename, float samprate, qint64 center_freq)
+/** New pre-trigger and post-trigger times or triggers of the I/Q captures. */
+void MainWindow::setIqCapture(double pre_sec, double post_sec, bool on_detector, bool on_squelch)
 {
-    if (ui->actionDSP->isChecked())
+    iqCapture->setWindow(pre_sec, post_sec);
+    d_capture_detector = on_detector;
+    d_capture_squelch = on_squelch;
+}
+
+/**
+ * Write a capture from the pre-trigger ring to the folder of the I/Q tool,
+ * or extend the running one.
+ */
+void MainWindow::triggerIqCapture(const QString& reason)
+{
+    if (!iqCapture->isEnabled())
+        return;
+
+    bool extending = rx->iq_capture_active();
+    iqCapture->setDirectory(iq_tool->recordingDir());
+    iqCapture->setHardware(m_settings->value("input/device", "").toString());
+    if (!iqCapture->trigger(reason))
+        ui->statusBar->showMessage(tr("Error starting I/Q capture"), 5000);
+    else if (!extending)
+        ui->statusBar->showMessage(tr("Capturing I/Q: %1").arg(reason), 5000);
+}
+
+void MainWindow::onManualIqCapture()
+{
+    triggerIqCapture(tr("Manual capture"));
+}
+
+/** New signal of the detector, captured if enabled. */
+void MainWindow::onSignalDetected(const QString& description)
+{
+    if (d_capture_detector)
+        triggerIqCapture(description);
+}
+
+void MainWindow::startIqPlayback(const QString& filename, float samprate, qint64 center_freq,
+                                 const QString& samples)
+{
+    bool was_running = ui->actionDSP->isChecked();
+    if (was_running)
     {
         // suspend DSP while we reload settings
         on_actionDSP_triggered(false);
@@ -1733,16 +2298,37 @@ void MainWindow::startIqPlayback(const QString& filename, float samprate, qint64
 
     storeSession();
 
-    auto sri = (int)samprate;
-    auto cf  = center_freq;
+    iq_file_format format = IQ_FILE_CF32;
+    if (samples == "cs16")
+        format = IQ_FILE_CS16;
+    else if (samples == "cs8")
+        format = IQ_FILE_CS8;
+
     double current_offset = rx->get_filter_offset();
-    QString escapedFilename = receiver::escape_filename(filename.toStdString()).c_str();
-    auto devstr = QString("file=%1,rate=%2,freq=%3,throttle=true,repeat=false")
-            .arg(escapedFilename).arg(sri).arg(cf);
 
-    qDebug() << __func__ << ":" << devstr;
+    // Memory mapped, or through the osmosdr file source where that fails
+    if (rx->start_iq_playback(filename.toStdString(), format, samprate, center_freq)
+        != receiver::STATUS_OK)
+    {
+        if (format != IQ_FILE_CF32)
+        {
+            iq_tool->cancelPlayback();
+            ui->statusBar->showMessage(tr("Can not play %1").arg(filename), 5000);
+            if (was_running)
+                on_actionDSP_triggered(true);
+            return;
+        }
+
+        auto sri = (int)samprate;
+        auto cf  = center_freq;
+        QString escapedFilename = receiver::escape_filename(filename.toStdString()).c_str();
+        auto devstr = QString("file=%1,rate=%2,freq=%3,throttle=true,repeat=false")
+                .arg(escapedFilename).arg(sri).arg(cf);
 
-    rx->set_input_device(devstr.toStdString());
+        qDebug() << __func__ << ":" << devstr;
+
+        rx->set_input_device(devstr.toStdString());
+    }
     updateHWFrequencyRange(false);
 
     // sample rate
@@ -1759,7 +2345,8 @@ void MainWindow::startIqPlayback(const QString& filename, float samprate, qint64
     else
         on_plotter_newDemodFreq(center_freq + current_offset, current_offset);
 
-    remote->setBandwidth(actual_rate);
+    QMetaObject::invokeMethod(remote, "setBandwidth", Qt::QueuedConnection,
+                              Q_ARG(qint64, (qint64)actual_rate));
 
     // FIXME: would be nice with good/bad status
     ui->statusBar->showMessage(tr("Playing %1").arg(filename));
@@ -1794,7 +2381,8 @@ void MainWindow::stopIqPlayback()
         uiDockRxOpt->setFilterOffsetRange((qint64)(actual_rate));
         ui->plotter->setSampleRate(actual_rate);
         ui->plotter->setSpanFreq((quint32)actual_rate);
-        remote->setBandwidth(sr);
+        QMetaObject::invokeMethod(remote, "setBandwidth", Qt::QueuedConnection,
+                                  Q_ARG(qint64, (qint64)sr));
 
         // not needed as long as we are not recording in iq_tool
         //iq_tool->setSampleRate(sr);
@@ -1821,19 +2409,26 @@ void MainWindow::stopIqPlayback()
 
 /**
  * Go to a specific offset in the IQ file.
- * @param seek_pos The byte offset from the beginning of the file.
+ * @param seek_pos The sample offset from the beginning of the file.
  */
 void MainWindow::seekIqFile(qint64 seek_pos)
 {
-    rx->seek_iq_file((long)seek_pos);
+    // Dragging the position slider only seeks to the last position
+    rxQueue->post("seek", [this, seek_pos]() {
+        return (int)rx->seek_iq_file((long)seek_pos);
+    });
+}
+
+/** Speed of the I/Q playback has changed, negative to play backwards. */
+void MainWindow::setIqPlaybackSpeed(double speed)
+{
+    rx->set_iq_playback_speed(speed);
 }
 
 /** FFT size has changed. */
 void MainWindow::setIqFftSize(int size)
 {
     qDebug() << "Changing baseband FFT size to" << size;
-    d_iqFftData.resize(size);
-    d_iqFftData.shrink_to_fit();
     rx->set_iq_fft_size(size);
 }
 
@@ -1843,6 +2438,7 @@ void MainWindow::setIqFftRate(int fps)
     int interval;
 
     d_fps = fps;
+    fps = shedFftRate(fps);
 
     if (fps == 0)
     {
@@ -1874,6 +2470,45 @@ void MainWindow::setIqFftWindow(int type)
     rx->set_iq_fft_window(d_fftWindowType, d_fftNormalizeEnergy);
 }
 
+/** Streaming (continuous) baseband FFT settings have changed. */
+void MainWindow::setIqFftStreaming(bool enabled, float overlap, int reduce)
+{
+    rx->set_iq_fft_streaming(enabled, overlap, reduce);
+}
+
+/** Baseband FFT spectral estimator has changed. */
+void MainWindow::setIqFftEstimator(int estimator, int param)
+{
+    rx->set_iq_fft_estimator(estimator, param);
+}
+
+/** Zoom FFT for zoomed views enabled or disabled. */
+void MainWindow::setZoomFft(bool enabled)
+{
+    d_zoom_fft = enabled;
+    ui->plotter->setZoomFftEnabled(enabled);
+    if (!enabled)
+        rx->set_zoom_fft(false, 0.0, 0.0);
+}
+
+/** Streamed baseband FFT on the GPU toggled. */
+void MainWindow::setIqFftGpu(bool enabled)
+{
+    rx->set_iq_fft_gpu(enabled);
+}
+
+/** Number of baseband FFT threads has changed. */
+void MainWindow::setIqFftThreads(int nthreads)
+{
+    rx->set_iq_fft_threads(nthreads);
+
+    // plan the other sizes now so that switching FFT size does not stall
+    std::vector<unsigned int> sizes;
+    for (int size : uiDockFft->fftSizes())
+        sizes.push_back(size);
+    rx->preplan_iq_fft(sizes, nthreads);
+}
+
 void MainWindow::plotScaleChanged(int type, bool perHz)
 {
     // PLOT_SCALE_DBFS (0) always uses amplitude normalization.
@@ -1947,16 +2582,23 @@ void MainWindow::enableFftFill(bool enable)
  */
 void MainWindow::on_actionDSP_triggered(bool checked)
 {
-    remote->setReceiverStatus(checked);
+    QMetaObject::invokeMethod(remote, "setReceiverStatus", Qt::QueuedConnection,
+                              Q_ARG(bool, checked));
 
     if (checked)
     {
         /* start receiver */
         rx->start();
+        startupMark("flow graph started");
 
         /* start GUI timers */
         meter_timer->start(100);
 
+        /* full display quality until the governor measures otherwise */
+        d_governor.reset();
+        applyLoadLevel();
+        d_fft_busy_ns = 0;
+        ui->plotter->takeBusyNs();
         if (uiDockFft->fftRate())
         {
             iq_fft_timer->start(1000/uiDockFft->fftRate());
@@ -1968,7 +2610,8 @@ void MainWindow::on_actionDSP_triggered(bool checked)
             ui->plotter->setRunningState(false);
         }
 
-        audio_fft_timer->start(40);
+        if (!d_display_hidden)
+            audio_fft_timer->start(40);
 
         /* update menu text and button tooltip */
         ui->actionDSP->setToolTip(tr("Stop DSP processing"));
@@ -2008,7 +2651,7 @@ int MainWindow::on_actionIoConfig_triggered()
 {
     qDebug() << "Configure I/O devices.";
 
-    auto *ioconf = new CIoConfig(m_settings, devList);
+    auto *ioconf = new CIoConfig(m_settings, d_devices);
     auto confres = ioconf->exec();
 
     if (confres == QDialog::Accepted)
@@ -2040,7 +2683,7 @@ int MainWindow::firstTimeConfig()
 {
     qDebug() << __func__;
 
-    auto *ioconf = new CIoConfig(m_settings, devList);
+    auto *ioconf = new CIoConfig(m_settings, d_devices);
     auto confres = ioconf->exec();
 
     if (confres == QDialog::Accepted)
@@ -2120,17 +2763,57 @@ void MainWindow::on_plotter_newDemodFreq(qint64 freq, qint64 delta)
         rx->reset_rds_parser();
 }
 
+/** Tune to a frequency clicked in the panorama and go back to the live view. */
+void MainWindow::on_plotter_panoramaFreqSelected(qint64 freq)
+{
+    d_panorama_action->setChecked(false);
+    setNewFrequency(freq);
+}
+
+/** Show the sweeps in the plotter from the next one on, or the live FFT again. */
+void MainWindow::setPanorama(bool enabled)
+{
+    if (!enabled)
+        ui->plotter->setPanorama(false);
+}
+
+/**
+ * Draw the frames as their difference to the baseline of the sigint dock,
+ * capturing one if there is none. The zoom FFT is not used meanwhile.
+ */
+void MainWindow::setBaselineView(bool enabled)
+{
+    if (enabled)
+        uiDockSigint->setBaselineEnabled(true);
+}
+
+void MainWindow::onSweepSegment(const SpectrumCapture::SweepSegment &segment)
+{
+    if (!d_panorama_action->isChecked())
+        return;
+
+    // A sweep of another range starts a new panorama
+    if (segment.step == 0)
+        ui->plotter->setPanorama(true, qRound64(segment.sweep_start), qRound64(segment.sweep_end));
+    ui->plotter->addPanoramaSegment(segment.start_freq, segment.bin_hz, segment.power->data(),
+                                    (int)segment.power->size(), segment.fft_size,
+                                    segment.step == 0);
+}
+
 /* CPlotter::NewfilterFreq() is emitted or bookmark activated */
 void MainWindow::on_plotter_newFilterFreq(int low, int high)
 {   /* parameter correctness will be checked in receiver class */
-    receiver::status retcode = rx->set_filter((double) low, (double) high, d_filter_shape);
+    const receiver::filter_shape shape = d_filter_shape;
+    rxQueue->post("filter", [this, low, high, shape]() {
+        return (int)rx->set_filter((double) low, (double) high, shape);
+    }, [this, low, high](int status) {
+        if (status == receiver::STATUS_OK)
+            uiDockRxOpt->setFilterParam(low, high);
+    });
 
     /* Update filter range of plotter, in case this slot is triggered by
      * switching to a bookmark */
     ui->plotter->setHiLowCutFrequencies(low, high);
-
-    if (retcode == receiver::STATUS_OK)
-        uiDockRxOpt->setFilterParam(low, high);
 }
 
 /** Full screen button or menu item toggled. */
@@ -2168,6 +2851,7 @@ void MainWindow::on_actionRemoteConfig_triggered()
     if (rcs->exec() == QDialog::Accepted)
     {
         remote->setPort(rcs->getPort());
+        clusterMember->setRemotePort(rcs->getPort());
         remote->setHosts(rcs->getHosts());
     }
 
@@ -2175,14 +2859,12 @@ void MainWindow::on_actionRemoteConfig_triggered()
 }
 
 
-#define DATA_BUFFER_SIZE 48000
-
 /**
  * AFSK1200 decoder action triggered.
  *
  * This slot is called when the user activates the AFSK1200
  * action. It will create an AFSK1200 decoder window and start
- * and start pushing data from the receiver to it.
+ * the decoder in the receiver, whose messages are shown in it.
  */
 void MainWindow::on_actionAFSK1200_triggered()
 {
@@ -2205,8 +2887,8 @@ void MainWindow::on_actionAFSK1200_triggered()
     {
         qDebug() << "Starting AFSK1200 decoder.";
 
-        /* start sample sniffer */
-        if (rx->start_sniffer(22050, DATA_BUFFER_SIZE) == receiver::STATUS_OK)
+        dec_afsk1200_id = rx->start_decoder(std::make_shared<afsk1200_decoder>());
+        if (dec_afsk1200_id >= 0)
         {
             dec_afsk1200 = new Afsk1200Win(this);
             connect(dec_afsk1200, SIGNAL(windowClosed()), this, SLOT(afsk1200win_closed()));
@@ -2217,8 +2899,7 @@ void MainWindow::on_actionAFSK1200_triggered()
         }
         else
             QMessageBox::warning(this, tr("Gqrx error"),
-                                 tr("Error starting sample sniffer.\n"
-                                    "Close all data decoders and try again."),
+                                 tr("Error starting the AFSK1200 decoder."),
                                  QMessageBox::Ok, QMessageBox::Ok);
     }
 }
@@ -2233,11 +2914,16 @@ void MainWindow::on_actionAFSK1200_triggered()
  */
 void MainWindow::afsk1200win_closed()
 {
-    /* stop cyclic processing */
-    dec_timer->stop();
-    rx->stop_sniffer();
+    /* stop cyclic processing unless the VFOs still decode */
+    rx->stop_decoder(dec_afsk1200_id);
+    bool vfo_afsk = false;
+    for (const Vfo &v : d_vfos)
+        vfo_afsk = vfo_afsk || v.afsk_id >= 0;
+    if (!vfo_afsk)
+        dec_timer->stop();
 
     dec_afsk1200 = nullptr;
+    dec_afsk1200_id = -1;
 }
 
 /** Show DXC Options. */
@@ -2247,17 +2933,34 @@ void MainWindow::on_actionDX_Cluster_triggered()
 }
 
 /**
- * Cyclic processing for acquiring samples from receiver and processing them
- * with data decoders (see dec_* objects)
+ * Cyclic display of the messages the data decoders in the receiver have
+ * decoded since the last time (see dec_* objects). The decoding itself does
+ * not depend on this timer.
  */
 void MainWindow::decoderTimeout()
 {
-    float buffer[DATA_BUFFER_SIZE];
-    unsigned int num;
+    std::string msg;
+
+    while (dec_afsk1200 && rx->get_decoder_message(dec_afsk1200_id, msg))
+    {
+        dec_afsk1200->show_message(QString::fromStdString(msg));
+        QMetaObject::invokeMethod(remote, "addPacket", Qt::QueuedConnection,
+                                  Q_ARG(int, 0), Q_ARG(QString, QString::fromStdString(msg)));
+    }
 
-    rx->get_sniffer_data(&buffer[0], num);
-    if (dec_afsk1200)
-        dec_afsk1200->process_samples(&buffer[0], num);
+    for (auto it = d_vfos.constBegin(); it != d_vfos.constEnd(); ++it)
+    {
+        if (it->afsk_id < 0)
+            continue;
+        while (rx->get_decoder_message(it->afsk_id, msg))
+        {
+            const QString packet = QString::fromStdString(msg);
+            if (dec_afsk1200)
+                dec_afsk1200->show_message(QString("VFO %1: %2").arg(it.key()).arg(packet));
+            QMetaObject::invokeMethod(remote, "addPacket", Qt::QueuedConnection,
+                                      Q_ARG(int, it.key()), Q_ARG(QString, packet));
+        }
+    }
 }
 
 void MainWindow::setRdsDecoder(bool checked)
@@ -2277,7 +2980,8 @@ void MainWindow::setRdsDecoder(bool checked)
         rx->stop_rds_decoder();
         rds_timer->stop();
     }
-    remote->setRDSstatus(checked);
+    QMetaObject::invokeMethod(remote, "setRDSstatus", Qt::QueuedConnection,
+                              Q_ARG(bool, checked));
 }
 
 void MainWindow::onBookmarkActivated(qint64 freq, const QString& demod, int bandwidth)
@@ -2309,32 +3013,273 @@ void MainWindow::onBookmarkActivated(qint64 freq, const QString& demod, int band
     on_plotter_newFilterFreq(lo, hi);
 }
 
+/*
+ * Scan the bookmarks shown in the bookmark list. The squelch level is the
+ * activity threshold when the squelch is in use.
+ */
+void MainWindow::onBookmarkScanToggled(bool checked)
+{
+    if (!checked)
+    {
+        scanner->stop();
+        return;
+    }
+
+    QList<ChannelScanner::Channel> channels;
+    for (int i = 0; i < Bookmarks::Get().size(); i++)
+    {
+        const BookmarkInfo& info = Bookmarks::Get().getBookmark(i);
+        if (info.IsActive())
+            channels.append({info.frequency, info.name, info.modulation, info.bandwidth});
+    }
+    if (channels.isEmpty())
+    {
+        uiDockBookmarks->actionScanBookmarks->setChecked(false);
+        return;
+    }
+
+    if (uiDockRxOpt->getSqlLevel() > -150.0)
+        scanner->setThreshold(uiDockRxOpt->getSqlLevel());
+    scanner->setLnbLo(d_lnb_lo);
+    scanner->setChannels(channels);
+    scanner->start();
+}
+
+/* Show the channel the scanner stopped on, it has tuned the receiver already */
+void MainWindow::onScannerChannelActive(const ChannelScanner::Channel& channel, float level_db)
+{
+    auto offset = (qint64)rx->get_filter_offset();
+
+    qDebug() << "Scanner:" << channel.name << channel.frequency << level_db << "dBFS,"
+             << scanner->channelRate() << "channels/s";
+    ui->plotter->setFilterOffset(offset);
+    uiDockRxOpt->setFilterOffset(offset);
+    onBookmarkActivated(channel.frequency, channel.modulation, (int)channel.bandwidth);
+}
+
 void MainWindow::setPassband(int bandwidth)
+{
+    int lo, hi;
+    passbandEdges(uiDockRxOpt->currentDemod(), uiDockRxOpt->currentFilter(),
+                  bandwidth, &lo, &hi);
+
+    QMetaObject::invokeMethod(remote, "setPassband", Qt::QueuedConnection,
+                              Q_ARG(int, lo), Q_ARG(int, hi));
+
+    on_plotter_newFilterFreq(lo, hi);
+}
+
+/** Filter edges of a passband, placed like the filter preset of the mode. */
+void MainWindow::passbandEdges(int mode, int preset, int bandwidth, int *lo, int *hi) const
 {
     /* Check if filter is symmetric or not by checking the presets */
-    auto mode = uiDockRxOpt->currentDemod();
-    auto preset = uiDockRxOpt->currentFilter();
+    uiDockRxOpt->getFilterPreset(mode, preset, lo, hi);
+
+    if(*lo + *hi == 0)
+    {
+        *lo = -bandwidth / 2;
+        *hi =  bandwidth / 2;
+    }
+    else if(*lo >= 0 && *hi >= 0)
+    {
+        *hi = *lo + bandwidth;
+    }
+    else if(*lo <= 0 && *hi <= 0)
+    {
+        *lo = *hi - bandwidth;
+    }
+}
+
+/** Receiver demodulator of an additional VFO, CW is received as SSB. */
+static receiver::rx_demod vfoDemod(int mode_idx)
+{
+    switch (mode_idx) {
+    case DockRxOpt::MODE_RAW:
+        return receiver::RX_DEMOD_NONE;
+    case DockRxOpt::MODE_AM:
+        return receiver::RX_DEMOD_AM;
+    case DockRxOpt::MODE_AM_SYNC:
+        return receiver::RX_DEMOD_AMSYNC;
+    case DockRxOpt::MODE_NFM:
+        return receiver::RX_DEMOD_NFM;
+    case DockRxOpt::MODE_WFM_MONO:
+        return receiver::RX_DEMOD_WFM_M;
+    case DockRxOpt::MODE_WFM_STEREO:
+        return receiver::RX_DEMOD_WFM_S;
+    case DockRxOpt::MODE_WFM_STEREO_OIRT:
+        return receiver::RX_DEMOD_WFM_S_OIRT;
+    case DockRxOpt::MODE_LSB:
+    case DockRxOpt::MODE_USB:
+    case DockRxOpt::MODE_CWL:
+    case DockRxOpt::MODE_CWU:
+        return receiver::RX_DEMOD_SSB;
+    default:
+        return receiver::RX_DEMOD_OFF;
+    }
+}
+
+/**
+ * @brief Add or retune an additional VFO.
+ * @param vfo Number of the VFO given by the remote control.
+ * @param freq Frequency including the LNB LO, as the main frequency.
+ * @param mode Mode index, as for selectDemod().
+ * @param passband Passband in Hz, 0 for the normal filter preset of the mode.
+ */
+void MainWindow::setVfo(int vfo, qint64 freq, int mode, int passband)
+{
+    receiver::rx_demod demod = vfoDemod(mode);
+    if (demod == receiver::RX_DEMOD_OFF)
+        return;
 
     int lo, hi;
-    uiDockRxOpt->getFilterPreset(mode, preset, &lo, &hi);
+    if (passband > 0)
+        passbandEdges(mode, FILTER_PRESET_NORMAL, passband, &lo, &hi);
+    else
+        uiDockRxOpt->getFilterPreset(mode, FILTER_PRESET_NORMAL, &lo, &hi);
 
-    if(lo + hi == 0)
+    auto it = d_vfos.find(vfo);
+    if (it == d_vfos.end())
     {
-        lo = -bandwidth / 2;
-        hi =  bandwidth / 2;
+        int id = rx->add_vfo((double)(freq - d_lnb_lo - d_hw_freq), demod);
+        if (id < 0)
+            return;
+        it = d_vfos.insert(vfo, Vfo{id, freq, lo, hi, -1});
     }
-    else if(lo >= 0 && hi >= 0)
+    else
     {
-        hi = lo + bandwidth;
+        rx->set_vfo_demod(it->id, demod);
+        it->freq = freq;
+        it->low = lo;
+        it->high = hi;
     }
-    else if(lo <= 0 && hi <= 0)
+    rx->set_vfo_filter(it->id, lo, hi, d_filter_shape);
+    updateVfos();
+}
+
+void MainWindow::removeVfo(int vfo)
+{
+    auto it = d_vfos.find(vfo);
+    if (it == d_vfos.end())
+        return;
+
+    rx->remove_vfo(it->id);
+    d_vfos.erase(it);
+    d_iq_streams.remove(vfo);
+    updateVfos();
+}
+
+void MainWindow::setVfoMuted(int vfo, bool muted)
+{
+    if (d_vfos.contains(vfo))
+        rx->set_vfo_audio_muted(d_vfos[vfo].id, muted);
+}
+
+void MainWindow::setVfoSqlLevel(int vfo, double level_db)
+{
+    if (d_vfos.contains(vfo))
+        rx->set_vfo_sql_level(d_vfos[vfo].id, level_db);
+}
+
+/** Stream the audio of a VFO over UDP, port 0 stops it. */
+void MainWindow::setVfoUdpStreaming(int vfo, const QString &host, int port, bool stereo, int format)
+{
+    if (!d_vfos.contains(vfo))
+        return;
+
+    if (port == 0)
+        rx->stop_vfo_udp_streaming(d_vfos[vfo].id);
+    else
+        rx->start_vfo_udp_streaming(d_vfos[vfo].id, host.toStdString(), port, stereo,
+                                    (udp_stream_format) format, vfo);
+}
+
+/**
+ * Decode AFSK1200 on a VFO. The packets go to the remote control and, while
+ * it is open, to the AFSK1200 window with the number of the VFO.
+ */
+void MainWindow::setVfoAfsk(int vfo, bool enabled)
+{
+    if (!d_vfos.contains(vfo))
+        return;
+
+    Vfo &v = d_vfos[vfo];
+    if (enabled && v.afsk_id < 0)
     {
-        lo = hi - bandwidth;
+        v.afsk_id = rx->start_decoder(std::make_shared<afsk1200_decoder>(), v.id);
+        if (v.afsk_id >= 0 && !dec_timer->isActive())
+            dec_timer->start(100);
     }
+    else if (!enabled && v.afsk_id >= 0)
+    {
+        rx->stop_decoder(v.afsk_id);
+        v.afsk_id = -1;
+    }
+}
 
-    remote->setPassband(lo, hi);
+/**
+ * Record the audio of a VFO to the folder of the audio recordings: for
+ * mode 1 into one file, for mode 2 a file per transmission while the
+ * squelch is open, 0 stops the recording.
+ */
+void MainWindow::setVfoRecording(int vfo, int mode)
+{
+    if (!d_vfos.contains(vfo))
+        return;
 
-    on_plotter_newFilterFreq(lo, hi);
+    const Vfo &v = d_vfos[vfo];
+    rx->stop_vfo_audio_recording(v.id);
+    if (mode == 1)
+    {
+        QString file_name = QDateTime::currentDateTime().toUTC().toString("gqrx_yyyyMMdd_hhmmss");
+        QString path = QString("%1/%2_%3.wav").arg(uiDockAudio->recDir()).arg(file_name).arg(v.freq);
+        rx->start_vfo_audio_recording(v.id, path.toStdString());
+    }
+    else if (mode == 2)
+    {
+        QString prefix = QString("%1/gqrx_%2").arg(uiDockAudio->recDir()).arg(v.freq);
+        rx->start_vfo_audio_log(v.id, prefix.toStdString());
+    }
+}
+
+/** Split the input with a channelizer for the VFOs, or feed them the whole input for 0. */
+void MainWindow::setVfoChannels(int channels)
+{
+    if (rx->set_vfo_channels(channels) != receiver::STATUS_OK)
+        qWarning() << "Can not split the input into" << channels << "channels";
+}
+
+/**
+ * Stream the I/Q of the baseband, source 0, or of a VFO to the network,
+ * replacing the stream it had. No ports stops it.
+ */
+void MainWindow::setIqStream(int source, int format, int tcp_port, const QString &group, int udp_port)
+{
+    if (d_iq_streams.contains(source))
+        rx->stop_iq_stream(d_iq_streams.take(source));
+    if ((tcp_port == 0 && udp_port == 0) || (source > 0 && !d_vfos.contains(source)))
+        return;
+
+    const int id = rx->start_iq_stream(source > 0 ? d_vfos[source].id : -1,
+                                       (iq_file_format) format, tcp_port,
+                                       group.toStdString(), udp_port);
+    if (id < 0)
+        qWarning() << "Can not start the I/Q stream of source" << source;
+    else
+        d_iq_streams.insert(source, id);
+}
+
+/** Keep the VFOs on their frequency after retuning and show them on the plotter. */
+void MainWindow::updateVfos()
+{
+    QVector<CPlotter::VfoMarker> markers;
+    std::map<int, double> offsets;
+    for (auto it = d_vfos.constBegin(); it != d_vfos.constEnd(); ++it)
+    {
+        offsets[it->id] = (double)(it->freq - d_lnb_lo - d_hw_freq);
+        markers.append(CPlotter::VfoMarker{it.key(), it->freq, it->low, it->high});
+    }
+    rx->set_vfo_offsets(offsets);
+    ui->plotter->setVfoMarkers(markers);
 }
 
 /** Launch Gqrx google group website. */
@@ -2538,12 +3483,16 @@ void MainWindow::on_actionAddBookmark_triggered()
 
         Bookmarks::Get().add(info);
         uiDockBookmarks->updateTags();
+
+        const double now = QDateTime::currentMSecsSinceEpoch() / 1000.0;
+        iqAnnotations->addRange(now, now, (double)info.frequency, (double)info.bandwidth,
+                                "Gqrx bookmark", "bookmark", info.name);
     }
 }
 
 void MainWindow::updateClusterSpots()
 {
-    ui->plotter->updateOverlay();
+    ui->plotter->updateTags();
 }
 
 void MainWindow::frequencyFocusShortcut()
@@ -24,29 +24,47 @@
 #define MAINWINDOW_H
 
 #include <QColor>
+#include <QElapsedTimer>
+#include <QLabel>
+#include <QList>
 #include <QMainWindow>
+#include <QMap>
 #include <QPointer>
 #include <QSettings>
 #include <QString>
+#include <QStringList>
 #include <QTimer>
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QSvgWidget>
+#include <QThread>
 
 #include "qtgui/dockrxopt.h"
 #include "qtgui/dockaudio.h"
 #include "qtgui/dockinputctl.h"
 #include "qtgui/dockfft.h"
+#include "qtgui/device_cache.h"
 #include "qtgui/dockbookmarks.h"
+#include "qtgui/dockperf.h"
 #include "qtgui/dockrds.h"
 #include "qtgui/docksigint.h"
 #include "qtgui/afsk1200win.h"
+#include "qtgui/channel_scanner.h"
+#include "qtgui/iq_annotations.h"
+#include "qtgui/iq_capture.h"
 #include "qtgui/iq_tool.h"
+#include "qtgui/load_governor.h"
 #include "qtgui/dxc_options.h"
 
 #include "applications/gqrx/recentconfig.h"
 #include "applications/gqrx/remote_control.h"
+#include "applications/gqrx/cluster.h"
+#include "applications/gqrx/data_channel.h"
 #include "applications/gqrx/receiver.h"
+#include "applications/gqrx/receiver_queue.h"
+
+/* Time after which the startup timeline is logged even without a spectrum */
+#define STARTUP_REPORT_MS 10000
 
 namespace Ui {
     class MainWindow;  /*! The main window UI */
@@ -76,6 +94,9 @@ public slots:
 signals:
     void dspStateChanged(bool running);  // Add signal declaration here
 
+protected:
+    void changeEvent(QEvent *event) override;
+
 private:
     Ui::MainWindow *ui;
 
@@ -86,6 +107,7 @@ private:
 
     qint64 d_lnb_lo;  /* LNB LO in Hz. */
     qint64 d_hw_freq;
+    int    d_stall_ms;  /* Input stall before the standby device takes over. */
     qint64 d_marker_a;
     qint64 d_marker_b;
     bool   d_show_markers;
@@ -93,7 +115,8 @@ private:
     qint64 d_hw_freq_stop{};
 
     enum receiver::filter_shape d_filter_shape;
-    std::vector<float> d_iqFftData;
+    std::vector<float> d_zoomFftData;
+    bool            d_zoom_fft;    /*!< Use the zoom FFT for zoomed views. */
     float           d_fftAvg;      /*!< FFT averaging parameter set by user (not the true gain). */
     float           d_fps;
     int             d_fftWindowType;
@@ -102,6 +125,17 @@ private:
     std::vector<float> d_audioFftData;
     bool d_have_audio;  /*!< Whether we have audio (i.e. not with demod_off. */
 
+    /* Additional VFO, by the number the remote control gives it */
+    struct Vfo {
+        int     id;         /*!< Id in the receiver. */
+        qint64  freq;       /*!< Frequency including the LNB LO [Hz]. */
+        int     low;        /*!< Filter low cut [Hz]. */
+        int     high;       /*!< Filter high cut [Hz]. */
+        int     afsk_id;    /*!< Receiver id of its AFSK1200 decoder, or -1. */
+    };
+    QMap<int, Vfo> d_vfos;
+    QMap<int, int> d_iq_streams;  /*!< Receiver ids of the I/Q streams by VFO, 0 for the baseband. */
+
     /* dock widgets */
     DockRxOpt      *uiDockRxOpt;
     DockAudio      *uiDockAudio;
@@ -110,6 +144,7 @@ private:
     DockBookmarks  *uiDockBookmarks;
     DockRDS        *uiDockRDS;
     DockSigint     *uiDockSigint;
+    DockPerf       *uiDockPerf;
 
     CIqTool        *iq_tool;
     DXCOptions     *dxc_options;
@@ -117,6 +152,7 @@ private:
 
     /* data decoders */
     Afsk1200Win    *dec_afsk1200;
+    int             dec_afsk1200_id;  /*!< Receiver id of the AFSK1200 decoder. */
     bool            dec_rds{};
 
     QTimer   *dec_timer;
@@ -124,15 +160,41 @@ private:
     QTimer   *iq_fft_timer;
     QTimer   *audio_fft_timer;
     QTimer   *rds_timer;
+    QTimer   *perf_timer;
     quint64  d_last_fft_ms;
     float    d_avg_fft_rate;
     bool     d_frame_drop;
+    qint64   d_fft_busy_ns;     /*!< Time to fetch the last FFT frame. */
+    bool     d_display_hidden;  /*!< Minimized, the display only work is suspended. */
+    CLoadGovernor d_governor;   /*!< Display quality under GUI thread load. */
 
     receiver *rx;
+    ReceiverQueue *rxQueue;        /*!< Runs filter, recording and seek commands off the GUI thread. */
 
     RemoteControl *remote;
-
-    std::map<QString, QVariant> devList;
+    QThread       *remoteThread;   /*!< Runs the remote control server. */
+    DataChannel   *dataChannel;  /*!< FFT frames and I/Q for helper scripts. */
+    ClusterMember *clusterMember;  /*!< Joins the cluster of a coordinator. */
+    ClusterCoordinator *clusterCoordinator;  /*!< Drives the nodes that join this instance. */
+    ChannelScanner *scanner;     /*!< Scans the bookmarks. */
+    IqCapture     *iqCapture;    /*!< Event triggered captures of the pre-trigger ring. */
+    IqAnnotations *iqAnnotations;  /*!< Annotations of the running SigMF recording. */
+    bool           d_capture_detector;  /*!< Capture on new signals of the detector. */
+    bool           d_capture_squelch;   /*!< Capture when the squelch opens. */
+    bool           d_squelch_open;
+    double         d_squelch_open_time;   /*!< Since the epoch [s], for the annotation. */
+    float          d_squelch_open_level;
+    QAction       *d_panorama_action;  /*!< Sweeps are shown in the plotter while checked. */
+    QAction       *d_baseline_action;  /*!< The plotter shows the frames over the baseline. */
+    std::vector<float> d_baselineData;
+    QLabel        *d_drop_label;    /*!< Input gaps in the status bar, hidden until the first. */
+    uint64_t       d_drop_events;   /*!< Gaps already reported. */
+    QList<qint64>  d_drop_times;    /*!< Times of the gaps of the last minute [ms]. */
+
+    DeviceCache   *d_devices;           /*!< Input devices for the I/O configurator. */
+
+    QElapsedTimer  d_startup;           /*!< Since the window was created, invalid once reported. */
+    QStringList    d_startup_marks;     /*!< Steps of the startup with their times. */
 
     // dummy widget to enforce linking to QtSvg
     QSvgWidget      *qsvg_dummy;
@@ -143,7 +205,16 @@ private:
     void updateHWFrequencyRange(bool ignore_limits);
     void updateFrequencyRange();
     void updateDeltaAndCenter();
+    void updateVfos();
+    void passbandEdges(int mode, int preset, int bandwidth, int *lo, int *hi) const;
     void updateGainStages(bool read_from_device);
+    void inputFailover();
+    void checkInputDrops();
+    void startupMark(const QString &what);
+    void reportStartup();
+    void applyLoadLevel();
+    void updateDisplayState();
+    int  shedFftRate(int fps) const;
     void showSimpleTextFile(const QString &resource_path,
                             const QString &window_title);
     /* key shortcuts */
@@ -191,6 +262,17 @@ private slots:
     void setAudioGain(float gain);
     void setPassband(int bandwidth);
 
+    /* additional VFOs, from the remote control */
+    void setVfo(int vfo, qint64 freq, int mode, int passband);
+    void removeVfo(int vfo);
+    void setVfoMuted(int vfo, bool muted);
+    void setVfoSqlLevel(int vfo, double level_db);
+    void setVfoUdpStreaming(int vfo, const QString &host, int port, bool stereo, int format);
+    void setVfoRecording(int vfo, int mode);
+    void setVfoAfsk(int vfo, bool enabled);
+    void setVfoChannels(int channels);
+    void setIqStream(int source, int format, int tcp_port, const QString &group, int udp_port);
+
     /* audio recording and playback */
     void startAudioRec(const QString& filename);
     void stopAudioRec();
@@ -201,16 +283,28 @@ private slots:
     void stopAudioStreaming();
 
     /* I/Q playback and recording*/
-    void startIqRecording(const QString& recdir, const QString& format);
+    void startIqRecording(const QString& recdir, const QString& format,
+                          const QString& samples, bool compress);
     void stopIqRecording();
-    void startIqPlayback(const QString& filename, float samprate, qint64 center_freq);
+    void startIqPlayback(const QString& filename, float samprate, qint64 center_freq,
+                         const QString& samples);
     void stopIqPlayback();
     void seekIqFile(qint64 seek_pos);
+    void setIqPlaybackSpeed(double speed);
+    void setIqCapture(double pre_sec, double post_sec, bool on_detector, bool on_squelch);
+    void triggerIqCapture(const QString& reason);
+    void onManualIqCapture();
+    void onSignalDetected(const QString& description);
 
     /* FFT settings */
     void setIqFftSize(int size);
     void setIqFftRate(int fps);
     void setIqFftWindow(int type);
+    void setIqFftStreaming(bool enabled, float overlap, int reduce);
+    void setIqFftEstimator(int estimator, int param);
+    void setZoomFft(bool enabled);
+    void setIqFftThreads(int nthreads);
+    void setIqFftGpu(bool enabled);
     void plotScaleChanged(int type, bool perHz);
     void setIqFftSplit(int pct_wf);
     void setAudioFftRate(int fps);
@@ -222,12 +316,18 @@ private slots:
     /* FFT plot */
     void on_plotter_newDemodFreq(qint64 freq, qint64 delta);   /*! New demod freq (aka. filter offset). */
     void on_plotter_newFilterFreq(int low, int high);    /*! New filter width */
+    void on_plotter_panoramaFreqSelected(qint64 freq);  /*! Click in the sweep panorama. */
+    void setPanorama(bool enabled);
+    void setBaselineView(bool enabled);
+    void onSweepSegment(const SpectrumCapture::SweepSegment &segment);
 
     /* RDS */
     void setRdsDecoder(bool checked);
 
     /* Bookmarks */
     void onBookmarkActivated(qint64 freq, const QString& demod, int bandwidth);
+    void onBookmarkScanToggled(bool checked);
+    void onScannerChannelActive(const ChannelScanner::Channel& channel, float level_db);
 
     /* DXC Spots */
     void updateClusterSpots();
@@ -267,6 +367,8 @@ private slots:
     void iqFftTimeout();
     void audioFftTimeout();
     void rdsTimeout();
+    void perfTimeout();
+    void setPerfCounters(bool enabled);
 };
 
 #endif // MAINWINDOW_H
@@ -20,21 +20,32 @@
  * the Free Software Foundation, Inc., 51 Franklin Street,
  * Boston, MA 02110-1301, USA.
  */
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
+#include <set>
 #include <sstream>
+#include <thread>
 #include <QDebug>
 
+#include <gnuradio/block_detail.h>
+#include <gnuradio/block_registry.h>
+#include <gnuradio/high_res_timer.h>
+#include <gnuradio/hier_block2.h>
 #include <gnuradio/prefs.h>
+#include <gnuradio/realtime.h>
 #include <gnuradio/top_block.h>
 #include <osmosdr/source.h>
 #include <osmosdr/ranges.h>
 
 #include "applications/gqrx/receiver.h"
 #include "dsp/correct_iq_cc.h"
+#include "dsp/fft_plan_cache.h"
 #include "dsp/filter/fir_decim.h"
 #include "dsp/rx_fft.h"
+#include "dsp/trace.h"
 #include "receivers/nbrx.h"
 #include "receivers/wfmrx.h"
 
@@ -50,6 +61,17 @@
 #define WAV_FILE_GAIN 0.5
 #define TARGET_QUAD_RATE 1e6
 
+/* Time the pre-trigger ring holds beyond the requested pre-trigger, for the
+ * writer to catch up with the oldest samples of a capture */
+#define IQ_CAPTURE_SLACK_SEC 2.0
+
+/* Fill of an output buffer counted as a full event by get_block_perf() */
+#define PERF_BUFFER_FULL 0.95f
+
+/* Frames recycled by alloc_fft_frame(), enough for the taps, the decimated
+ * sizes and the frames the consumers keep */
+#define FFT_FRAME_POOL_SIZE 32
+
 /**
  * @brief Public constructor.
  * @param input_device Input device specifier.
@@ -60,19 +82,37 @@ receiver::receiver(const std::string input_device,
                    const std::string audio_device,
                    unsigned int decimation)
     : d_running(false),
+      d_config_depth(0),
+      d_config_running(false),
       d_input_rate(96000.0),
       d_audio_rate(48000),
+      d_audio_latency(0),
       d_decim(decimation),
+      d_decim_quality(FIR_DECIM_SHARP),
+      d_sc16_playback(false),
       d_rf_freq(144800000.0),
       d_filter_offset(0.0),
+      d_filter_low(-5000.0),
+      d_filter_high(5000.0),
       d_cw_offset(0.0),
+      d_doppler_offset(0.0),
       d_recording_iq(false),
+      d_iq_pretrigger(0.0),
       d_recording_wav(false),
-      d_sniffer_active(false),
+      d_iq_sniffer_active(false),
       d_iq_rev(false),
       d_dc_cancel(false),
       d_iq_balance(false),
-      d_demod(RX_DEMOD_OFF)
+      d_zoom_fft(false),
+      d_chan_fft(false),
+      d_realtime(false),
+      d_perf(false),
+      d_demod(RX_DEMOD_OFF),
+      d_vfo_id(0),
+      d_decoder_id(0),
+      d_iq_stream_id(0),
+      d_fft_sub_id(0),
+      d_stall_count(0)
 {
 
     tb = gr::make_top_block("gqrx");
@@ -84,7 +124,7 @@ receiver::receiver(const std::string input_device,
     else
     {
         input_devstr = input_device;
-        src = osmosdr::source::make(input_device);
+        src = open_input(input_device);
     }
 
     // input decimator
@@ -92,7 +132,7 @@ receiver::receiver(const std::string input_device,
     {
         try
         {
-            input_decim = make_fir_decim_cc(d_decim);
+            input_decim = make_fir_decim_cc(d_decim, d_decim_quality);
         }
         catch (std::range_error &e)
         {
@@ -115,18 +155,30 @@ receiver::receiver(const std::string input_device,
     rx  = make_nbrx(d_quad_rate, d_audio_rate);
 
     iq_swap = make_iq_swap_cc(false);
-    dc_corr = make_dc_corr_cc(d_decim_rate, 1.0);
+    iq_swap->set_sample_rate(d_decim_rate);
     iq_fft = make_rx_fft_c(DEFAULT_FFT_SIZE, d_decim_rate, gr::fft::window::WIN_HANN);
+    zoom_fft = make_zoom_fft_c(DEFAULT_FFT_SIZE, d_decim_rate);
+    rds_scan = make_rds_scanner_cc(d_decim_rate);
+    input_fft = make_rx_fft_c(DEFAULT_FFT_SIZE, d_input_rate, gr::fft::window::WIN_HANN);
+    chan_fft = make_rx_fft_c(DEFAULT_FFT_SIZE, d_quad_rate, gr::fft::window::WIN_HANN);
+    input_swap = make_iq_swap_cc(false);
+    input_cvt = make_sc16_to_cf32();
+    for (int i = 0; i < FFT_TAP_NUM; i++)
+    {
+        d_fft_taps[i] = false;
+        d_fft_frame_seq[i] = 0;
+    }
 
     audio_fft = make_rx_fft_f(DEFAULT_FFT_SIZE, d_audio_rate, gr::fft::window::WIN_HANN);
     audio_gain0 = gr::blocks::multiply_const_ff::make(0);
     audio_gain1 = gr::blocks::multiply_const_ff::make(0);
     set_af_gain(DEFAULT_AUDIO_GAIN);
 
-    audio_udp_sink = make_udp_sink_f();
+    audio_udp_sink = make_udp_sink_f(d_audio_rate);
 
 #ifdef WITH_PULSEAUDIO
-    audio_snk = make_pa_sink(audio_device, d_audio_rate, "GQRX", "Audio output");
+    audio_snk = make_pa_sink(audio_device, d_audio_rate, "GQRX", "Audio output",
+                             PA_SINK_LATENCY_MS);
 #elif WITH_PORTAUDIO
     audio_snk = make_portaudio_sink(audio_device, d_audio_rate, "GQRX", "Audio output");
 #else
@@ -138,8 +190,10 @@ receiver::receiver(const std::string input_device,
     /* wav sink and source is created when rec/play is started */
     audio_null_sink0 = gr::blocks::null_sink::make(sizeof(float));
     audio_null_sink1 = gr::blocks::null_sink::make(sizeof(float));
-    sniffer = make_sniffer_f();
-    /* sniffer_rr is created at each activation. */
+    iq_sniffer = make_iq_sniffer_cc();
+
+    for (auto &buffers : d_buffers)
+        buffers = stage_buffers{0, 0};
 
     set_demod(RX_DEMOD_NFM);
 
@@ -151,15 +205,17 @@ receiver::receiver(const std::string input_device,
 receiver::~receiver()
 {
     tb->stop();
+    fft_plan_cache::shutdown();
 }
 
 
 /** Start the receiver. */
 void receiver::start()
 {
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
     if (!d_running)
     {
-        tb->start();
+        start_tb();
         d_running = true;
     }
 }
@@ -167,6 +223,8 @@ void receiver::start()
 /** Stop the receiver. */
 void receiver::stop()
 {
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    d_config_running = false;
     if (d_running)
     {
         tb->stop();
@@ -175,6 +233,38 @@ void receiver::stop()
     }
 }
 
+/**
+ * @brief Apply the following settings with the flow graph stopped.
+ *
+ * Many setters rewire the flow graph, and while it runs each of them stops
+ * and starts it. Between begin_config() and end_config() they find the
+ * receiver stopped and only rewire it, which is cheap, and end_config()
+ * starts the flow graph once if it was running. Calls may nest. A stop()
+ * in between keeps the receiver stopped.
+ */
+void receiver::begin_config()
+{
+    if (d_config_depth++ == 0)
+    {
+        bool running = d_running;
+        stop();
+        d_config_running = running;
+    }
+}
+
+/** @brief Start the flow graph again if begin_config() stopped it. */
+void receiver::end_config()
+{
+    if (d_config_depth == 0 || --d_config_depth > 0)
+        return;
+
+    if (d_config_running)
+    {
+        d_config_running = false;
+        start();
+    }
+}
+
 /**
  * @brief Select new input device.
  * @param device
@@ -185,11 +275,21 @@ void receiver::set_input_device(const std::string device)
     qDebug() << "  old:" << input_devstr.c_str();
     qDebug() << "  new:" << device.c_str();
 
-    std::string error = "";
-
     if (device.empty())
         return;
 
+    replace_input(device, nullptr);
+}
+
+/*
+ * Open a new input device, or the given file source with the device as its
+ * stand-in for the device API, with the flow graph stopped.
+ */
+void receiver::replace_input(const std::string &device, iq_file_source_sptr file_src)
+{
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    std::string error = "";
+
     input_devstr = device;
 
     // tb->lock() can hang occasionally
@@ -199,59 +299,269 @@ void receiver::set_input_device(const std::string device)
         tb->wait();
     }
 
-    if (d_decim >= 2)
-    {
-        tb->disconnect(src, 0, input_decim, 0);
-        tb->disconnect(input_decim, 0, iq_swap, 0);
-    }
-    else
-    {
-        tb->disconnect(src, 0, iq_swap, 0);
-    }
+    disconnect_input();
+    iq_file_src.reset();
+    test_src.reset();
+    stitch_src.reset();
 
 #if GNURADIO_VERSION < 0x030802
     //Work around GNU Radio bug #3184
     //temporarily connect dummy source to ensure that previous device is closed
+    if (d_decim >= 2)
+        tb->disconnect(input_decim, 0, iq_swap, 0);
     src = osmosdr::source::make("file="+escape_filename(get_zero_file())+",freq=428e6,rate=96000,repeat=true,throttle=true");
     tb->connect(src, 0, iq_swap, 0);
-    tb->start();
+    start_tb();
     tb->stop();
     tb->wait();
     tb->disconnect(src, 0, iq_swap, 0);
+    if (d_decim >= 2)
+        tb->connect(input_decim, 0, iq_swap, 0);
 #else
     src.reset();
 #endif
 
     try
     {
-        src = osmosdr::source::make(device);
+        src = open_input(device);
     }
     catch (std::exception &x)
     {
         error = x.what();
+        test_src.reset();
+        stitch_src.reset();
         src = osmosdr::source::make("file="+escape_filename(get_zero_file())+",freq=428e6,rate=96000,repeat=true,throttle=true");
     }
+    iq_file_src = file_src;
+
+    // The decimator takes the samples of the new input as they come
+    if (d_decim >= 2 && input_decim->is_sc16() != is_sc16_input())
+        swap_input_decim();
 
+    connect_input();
     if(src->get_sample_rate() != 0)
         set_input_rate(src->get_sample_rate());
 
-    if (d_decim >= 2)
+    if (d_running)
+        start_tb();
+
+    if (error != "")
     {
-        tb->connect(src, 0, input_decim, 0);
-        tb->connect(input_decim, 0, iq_swap, 0);
+        throw std::runtime_error(error);
     }
-    else
+}
+
+/*
+ * Open the osmosdr device of a device string. A test signal, "test=...",
+ * is made into test_src and answered for by a zero file at its rate and
+ * frequency, like a playback. Stitched devices, "stitch=...", are made
+ * into stitch_src and the first of them answers for the device API.
+ */
+osmosdr::source::sptr receiver::open_input(const std::string &device)
+{
+    if (stitched_source::is_stitched(device))
     {
-        tb->connect(src, 0, iq_swap, 0);
+        stitch_src = make_stitched_source(device);
+        return stitch_src->reference();
     }
 
-    if (d_running)
-        tb->start();
+    test_signal_params params;
+    if (!test_signal_params::parse(device, params))
+        return osmosdr::source::make(device);
 
-    if (error != "")
+    test_src = make_test_signal_source(params);
+
+    std::ostringstream standin;
+    standin << "file=" << escape_filename(get_zero_file()) << ",freq=" << (long long)params.freq
+            << ",rate=" << (long long)params.rate << ",repeat=true,throttle=true";
+    return osmosdr::source::make(standin.str());
+}
+
+/**
+ * @brief Open a standby input device.
+ * @param device The device string, empty to close the standby device.
+ *
+ * The standby device is opened at the input rate and frequency of the
+ * receiver and streams into a null sink, so that failover_to_standby() can
+ * switch to it without opening it. It follows the rate, frequency and gains
+ * set on the receiver until then.
+ */
+void receiver::set_standby_device(const std::string device)
+{
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    if (device == standby_devstr)
+        return;
+
+    tb->lock();
+    if (standby_src)
     {
-        throw std::runtime_error(error);
+        tb->disconnect(standby_src, 0, standby_sink, 0);
+        standby_src.reset();
+    }
+    standby_devstr.clear();
+
+    if (!device.empty())
+    {
+        try
+        {
+            standby_src = osmosdr::source::make(device);
+            standby_src->set_sample_rate(d_input_rate);
+            standby_src->set_center_freq(d_rf_freq);
+            standby_src->set_gain_mode(src->get_gain_mode());
+            for (const auto &name : standby_src->get_gain_names())
+                standby_src->set_gain(src->get_gain(name), name);
+            if (!standby_sink)
+                standby_sink = gr::blocks::null_sink::make(sizeof(gr_complex));
+            tb->connect(standby_src, 0, standby_sink, 0);
+            standby_devstr = device;
+        }
+        catch (std::exception &x)
+        {
+            std::cerr << "Failed to open standby device " << device << ": "
+                      << x.what() << std::endl;
+            standby_src.reset();
+        }
+    }
+    unlock_tb();
+}
+
+/**
+ * @brief Replace the input device with the standby device.
+ * @returns False if there is no standby device.
+ *
+ * Only the source is swapped with the flow graph locked, the rest of the
+ * chain keeps its state. The old device is closed and the standby device
+ * becomes the input device; there is no standby device afterwards.
+ */
+bool receiver::failover_to_standby(void)
+{
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    if (!standby_src || iq_file_src || test_src || stitch_src)
+        return false;
+
+    tb->lock();
+
+    tb->disconnect(standby_src, 0, standby_sink, 0);
+    disconnect_input();
+
+    src = standby_src;
+    standby_src.reset();
+    input_devstr = standby_devstr;
+    standby_devstr.clear();
+
+    connect_input();
+    unlock_tb();
+
+    d_stall_time = std::chrono::steady_clock::now();
+    return true;
+}
+
+/* The file source while playing back, the test signal, else the input device */
+gr::basic_block_sptr receiver::input_block(void) const
+{
+    if (iq_file_src)
+        return iq_file_src;
+    if (test_src)
+        return test_src;
+    if (stitch_src)
+        return stitch_src;
+
+    return src;
+}
+
+/*
+ * The input as gr_complex at the full rate: input_block(), or input_cvt
+ * when that is sc16. Only the decimator takes the sc16 samples.
+ */
+gr::basic_block_sptr receiver::full_rate_block(void) const
+{
+    if (is_sc16_input())
+        return input_cvt;
+
+    return input_block();
+}
+
+/* Connect everything fed directly by the input, c.f. connect_all() */
+void receiver::connect_input(void)
+{
+    gr::basic_block_sptr in = full_rate_block();
+
+    if (is_sc16_input())
+        tb->connect(input_block(), 0, input_cvt, 0);
+    if (d_decim >= 2)
+        tb->connect(input_block(), 0, input_decim, 0);
+    else
+        tb->connect(in, 0, iq_swap, 0);
+    if (d_recording_iq && d_decim < 2)
+        tb->connect(in, 0, iq_sink, 0);
+    if (iq_capture && d_decim < 2)
+        tb->connect(in, 0, iq_capture, 0);
+    if (d_fft_taps[FFT_TAP_INPUT])
+        tb->connect(in, 0, input_swap, 0);
+}
+
+void receiver::disconnect_input(void)
+{
+    gr::basic_block_sptr in = full_rate_block();
+
+    if (is_sc16_input())
+        tb->disconnect(input_block(), 0, input_cvt, 0);
+    if (d_decim >= 2)
+        tb->disconnect(input_block(), 0, input_decim, 0);
+    else
+        tb->disconnect(in, 0, iq_swap, 0);
+    if (d_recording_iq && d_decim < 2)
+        tb->disconnect(in, 0, iq_sink, 0);
+    if (iq_capture && d_decim < 2)
+        tb->disconnect(in, 0, iq_capture, 0);
+    if (d_fft_taps[FFT_TAP_INPUT])
+        tb->disconnect(in, 0, input_swap, 0);
+}
+
+/* Rebuild the decimator for the sample type of the input, with it disconnected from the input */
+void receiver::swap_input_decim(void)
+{
+    tb->disconnect(input_decim, 0, iq_swap, 0);
+    if (d_recording_iq)
+        tb->disconnect(input_decim, 0, iq_sink, 0);
+    if (iq_capture)
+        tb->disconnect(input_decim, 0, iq_capture, 0);
+
+    input_decim = make_fir_decim_cc(d_decim, d_decim_quality, is_sc16_input());
+
+    tb->connect(input_decim, 0, iq_swap, 0);
+    if (d_recording_iq)
+        tb->connect(input_decim, 0, iq_sink, 0);
+    if (iq_capture)
+        tb->connect(input_decim, 0, iq_capture, 0);
+}
+
+/**
+ * @brief Switch to the standby device if the input has stalled.
+ * @param stall_ms Time without new samples that counts as a stall.
+ * @returns True if the receiver switched to the standby device.
+ *
+ * Meant to be called periodically, more often than stall_ms, while the
+ * receiver runs. The samples are counted by the baseband FFT.
+ */
+bool receiver::check_input_stall(int stall_ms)
+{
+    auto now = std::chrono::steady_clock::now();
+    uint64_t count = iq_fft->sample_count();
+
+    if (!d_running || count != d_stall_count)
+    {
+        d_stall_count = count;
+        d_stall_time = now;
+        return false;
     }
+
+    if (!standby_src || now - d_stall_time < std::chrono::milliseconds(stall_ms))
+        return false;
+
+    std::cerr << "No input samples for " << stall_ms << " ms, switching to "
+              << standby_devstr << std::endl;
+    return failover_to_standby();
 }
 
 
@@ -261,6 +571,7 @@ void receiver::set_input_device(const std::string device)
  */
 void receiver::set_output_device(const std::string device)
 {
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
     qDebug() << "Set output device:";
     qDebug() << "   old:" << output_devstr.c_str();
     qDebug() << "   new:" << device.c_str();
@@ -269,37 +580,70 @@ void receiver::set_output_device(const std::string device)
 
     tb->lock();
 
-    if (d_demod != RX_DEMOD_OFF)
+    if (audio_out0)
     {
-        tb->disconnect(audio_gain0, 0, audio_snk, 0);
-        tb->disconnect(audio_gain1, 0, audio_snk, 1);
+        tb->disconnect(audio_out0, 0, audio_snk, 0);
+        tb->disconnect(audio_out1, 0, audio_snk, 1);
     }
     audio_snk.reset();
 
     try {
 #ifdef WITH_PULSEAUDIO
-        audio_snk = make_pa_sink(device, d_audio_rate, "GQRX", "Audio output");
+        audio_snk = make_pa_sink(device, d_audio_rate, "GQRX", "Audio output",
+                                 d_audio_latency > 0 ? d_audio_latency : PA_SINK_LATENCY_MS);
 #elif WITH_PORTAUDIO
         audio_snk = make_portaudio_sink(device, d_audio_rate, "GQRX", "Audio output");
 #else
         audio_snk = gr::audio::sink::make(d_audio_rate, device, true);
 #endif
 
-        if (d_demod != RX_DEMOD_OFF)
+        if (audio_out0)
         {
-            tb->connect(audio_gain0, 0, audio_snk, 0);
-            tb->connect(audio_gain1, 0, audio_snk, 1);
+            tb->connect(audio_out0, 0, audio_snk, 0);
+            tb->connect(audio_out1, 0, audio_snk, 1);
         }
 
-        tb->unlock();
+        unlock_tb();
 
     } catch (std::exception &x) {
-        tb->unlock();
+        unlock_tb();
         // handle problems on non-freeing devices
         throw x;
     }
 }
 
+/**
+ * @brief Set the target latency of the audio output.
+ * @param latency_ms Latency in ms, 0 for the default of the output.
+ *
+ * Only the PulseAudio output has a latency that can be set, the others
+ * keep theirs.
+ */
+void receiver::set_audio_latency(int latency_ms)
+{
+    d_audio_latency = std::max(latency_ms, 0);
+#ifdef WITH_PULSEAUDIO
+    audio_snk->set_target_latency(d_audio_latency > 0 ? d_audio_latency : PA_SINK_LATENCY_MS);
+#endif
+}
+
+/**
+ * @brief Latency, underruns and dropped samples of the audio output.
+ * @return false if the output does not keep them.
+ */
+bool receiver::get_audio_stats(float &latency_ms, uint64_t &underruns, uint64_t &dropped) const
+{
+#ifdef WITH_PULSEAUDIO
+    audio_snk->get_stats(latency_ms, underruns, dropped);
+    return true;
+#else
+    (void) latency_ms;
+    (void) underruns;
+    (void) dropped;
+    return false;
+#endif
+}
+
 /** Get a list of available antenna connectors. */
 std::vector<std::string> receiver::get_antennas(void) const
 {
@@ -311,7 +655,10 @@ void receiver::set_antenna(const std::string &antenna)
 {
     if (!antenna.empty())
     {
-        src->set_antenna(antenna);
+        if (stitch_src)
+            stitch_src->set_antenna(antenna);
+        else
+            src->set_antenna(antenna);
     }
 }
 
@@ -323,18 +670,26 @@ void receiver::set_antenna(const std::string &antenna)
  */
 double receiver::set_input_rate(double rate)
 {
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
     double  current_rate;
     bool    rate_has_changed;
 
-    current_rate = src->get_sample_rate();
+    // The rate of stitched devices is set by their device string
+    if (stitch_src)
+        rate = stitch_src->get_sample_rate();
+    current_rate = stitch_src ? d_input_rate : src->get_sample_rate();
     rate_has_changed = !(rate == current_rate ||
             std::abs(rate - current_rate) < std::abs(std::min(rate, current_rate))
             * std::numeric_limits<double>::epsilon());
 
+    // Setting the same rate again restarts the stream on some drivers
+    if (!rate_has_changed && rate == d_input_rate)
+        return d_input_rate;
+
     tb->lock();
     try
     {
-        d_input_rate = src->set_sample_rate(rate);
+        d_input_rate = stitch_src ? rate : src->set_sample_rate(rate);
     }
     catch (std::runtime_error &e)
     {
@@ -359,35 +714,86 @@ double receiver::set_input_rate(double rate)
     d_decim_rate = d_input_rate / (double)d_decim;
     d_ddc_decim = std::max(1, (int)(d_decim_rate / TARGET_QUAD_RATE));
     d_quad_rate = d_decim_rate / d_ddc_decim;
-    dc_corr->set_sample_rate(d_decim_rate);
-    ddc->set_decim_and_samp_rate(d_ddc_decim, d_decim_rate);
+    iq_swap->set_sample_rate(d_decim_rate);
+    {
+        std::lock_guard<std::mutex> lock(d_ddc_mutex);
+        ddc->set_decim_and_samp_rate(d_ddc_decim, d_decim_rate);
+    }
     rx->set_quad_rate(d_quad_rate);
+    bool vfos_moved = update_vfo_chains();
+    update_iq_streams();
     iq_fft->set_quad_rate(d_decim_rate);
-    tb->unlock();
+    zoom_fft->set_samp_rate(d_decim_rate);
+    rds_scan->set_samp_rate(d_decim_rate);
+    input_fft->set_quad_rate(d_input_rate);
+    chan_fft->set_quad_rate(d_quad_rate);
+    if (standby_src)
+        standby_src->set_sample_rate(d_input_rate);
+    if (iq_capture)
+        replace_iq_capture(true);
+    unlock_tb();
+
+    if (vfos_moved)
+        reconnect_all();
 
     return d_input_rate;
 }
 
-/** Set input decimation */
+/**
+ * @brief Set input decimation.
+ *
+ * Only the decimator is replaced and the blocks after it get the new rate,
+ * with the flow graph locked. The source keeps running, so the change does
+ * not restart the device.
+ */
 unsigned int receiver::set_input_decim(unsigned int decim)
 {
     if (decim == d_decim)
         return d_decim;
 
-    if (d_running)
-    {
-        tb->stop();
-        tb->wait();
-    }
+    return replace_input_decim(decim);
+}
+
+/**
+ * @brief Set the filter quality of the input decimator.
+ * @param quality One of fir_decim_quality.
+ *
+ * The fast and balanced qualities decimate by powers of two with halfband
+ * stages, which take much less CPU at high input rates than the sharp FIR
+ * stages. A running decimator is rebuilt like in set_input_decim().
+ */
+void receiver::set_input_decim_quality(int quality)
+{
+    if (quality == d_decim_quality)
+        return;
+
+    d_decim_quality = quality;
+    if (d_decim >= 2)
+        replace_input_decim(d_decim);
+}
+
+/* Replace the input decimator and update the rates after it. */
+unsigned int receiver::replace_input_decim(unsigned int decim)
+{
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    tb->lock();
 
     if (d_decim >= 2)
     {
-        tb->disconnect(src, 0, input_decim, 0);
+        tb->disconnect(input_block(), 0, input_decim, 0);
         tb->disconnect(input_decim, 0, iq_swap, 0);
+        if (d_recording_iq)
+            tb->disconnect(input_decim, 0, iq_sink, 0);
+        if (iq_capture)
+            tb->disconnect(input_decim, 0, iq_capture, 0);
     }
     else
     {
-        tb->disconnect(src, 0, iq_swap, 0);
+        tb->disconnect(full_rate_block(), 0, iq_swap, 0);
+        if (d_recording_iq)
+            tb->disconnect(full_rate_block(), 0, iq_sink, 0);
+        if (iq_capture)
+            tb->disconnect(full_rate_block(), 0, iq_capture, 0);
     }
 
     input_decim.reset();
@@ -396,7 +802,7 @@ unsigned int receiver::set_input_decim(unsigned int decim)
     {
         try
         {
-            input_decim = make_fir_decim_cc(d_decim);
+            input_decim = make_fir_decim_cc(d_decim, d_decim_quality, is_sc16_input());
         }
         catch (std::range_error &e)
         {
@@ -416,19 +822,39 @@ unsigned int receiver::set_input_decim(unsigned int decim)
     // update quadrature rate
     d_ddc_decim = std::max(1, (int)(d_decim_rate / TARGET_QUAD_RATE));
     d_quad_rate = d_decim_rate / d_ddc_decim;
-    dc_corr->set_sample_rate(d_decim_rate);
-    ddc->set_decim_and_samp_rate(d_ddc_decim, d_decim_rate);
+    iq_swap->set_sample_rate(d_decim_rate);
+    {
+        std::lock_guard<std::mutex> lock(d_ddc_mutex);
+        ddc->set_decim_and_samp_rate(d_ddc_decim, d_decim_rate);
+    }
     rx->set_quad_rate(d_quad_rate);
+    bool vfos_moved = update_vfo_chains();
+    update_iq_streams();
     iq_fft->set_quad_rate(d_decim_rate);
+    zoom_fft->set_samp_rate(d_decim_rate);
+    rds_scan->set_samp_rate(d_decim_rate);
+    chan_fft->set_quad_rate(d_quad_rate);
+
+    // The ring holds samples at the old rate
+    if (iq_capture)
+        iq_capture = make_iq_capture_sink(iq_capture_samples());
 
     if (d_decim >= 2)
     {
-        tb->connect(src, 0, input_decim, 0);
+        tb->connect(input_block(), 0, input_decim, 0);
         tb->connect(input_decim, 0, iq_swap, 0);
+        if (d_recording_iq)
+            tb->connect(input_decim, 0, iq_sink, 0);
+        if (iq_capture)
+            tb->connect(input_decim, 0, iq_capture, 0);
     }
     else
     {
-        tb->connect(src, 0, iq_swap, 0);
+        tb->connect(full_rate_block(), 0, iq_swap, 0);
+        if (d_recording_iq)
+            tb->connect(full_rate_block(), 0, iq_sink, 0);
+        if (iq_capture)
+            tb->connect(full_rate_block(), 0, iq_capture, 0);
     }
 
 #ifdef CUSTOM_AIRSPY_KERNELS
@@ -436,8 +862,10 @@ unsigned int receiver::set_input_decim(unsigned int decim)
         src->set_bandwidth(d_decim_rate);
 #endif
 
-    if (d_running)
-        tb->start();
+    unlock_tb();
+
+    if (vfos_moved)
+        reconnect_all();
 
     return d_decim;
 }
@@ -449,6 +877,8 @@ unsigned int receiver::set_input_decim(unsigned int decim)
  */
 double receiver::set_analog_bandwidth(double bw)
 {
+    if (stitch_src)
+        stitch_src->set_bandwidth(bw);
     return src->set_bandwidth(bw);
 }
 
@@ -466,6 +896,7 @@ void receiver::set_iq_swap(bool reversed)
 
     d_iq_rev = reversed;
     iq_swap->set_enabled(d_iq_rev);
+    input_swap->set_enabled(d_iq_rev);
 }
 
 /**
@@ -489,9 +920,8 @@ void receiver::set_dc_cancel(bool enable)
 
     d_dc_cancel = enable;
 
-    // until we have a way to switch on/off
-    // inside the dc_corr_cc we do a reconf
-    set_demod(d_demod, true);
+    // done in the I/Q swap block, so the flow graph is not touched
+    iq_swap->set_dc_cancel(enable);
 }
 
 /**
@@ -515,7 +945,10 @@ void receiver::set_iq_balance(bool enable)
 
     d_iq_balance = enable;
 
-    src->set_iq_balance_mode(enable ? 2 : 0);
+    if (stitch_src)
+        stitch_src->set_iq_balance_mode(enable ? 2 : 0);
+    else
+        src->set_iq_balance_mode(enable ? 2 : 0);
 }
 
 /**
@@ -538,7 +971,13 @@ receiver::status receiver::set_rf_freq(double freq_hz)
 {
     d_rf_freq = freq_hz;
 
-    src->set_center_freq(d_rf_freq);
+    if (stitch_src)
+        stitch_src->set_center_freq(d_rf_freq);
+    else
+        src->set_center_freq(d_rf_freq);
+    if (standby_src)
+        standby_src->set_center_freq(d_rf_freq);
+    update_iq_streams();
     // FIXME: read back frequency?
 
     return STATUS_OK;
@@ -551,7 +990,7 @@ receiver::status receiver::set_rf_freq(double freq_hz)
  */
 double receiver::get_rf_freq(void)
 {
-    d_rf_freq = src->get_center_freq();
+    d_rf_freq = stitch_src ? stitch_src->get_center_freq() : src->get_center_freq();
 
     return d_rf_freq;
 }
@@ -615,7 +1054,12 @@ receiver::status receiver::get_gain_range(std::string &name, double *start,
 
 receiver::status receiver::set_gain(std::string name, double value)
 {
-    src->set_gain(value, name);
+    if (stitch_src)
+        stitch_src->set_gain(value, name);
+    else
+        src->set_gain(value, name);
+    if (standby_src)
+        standby_src->set_gain(value, name);
 
     return STATUS_OK;
 }
@@ -633,7 +1077,12 @@ double receiver::get_gain(std::string name) const
  */
 receiver::status receiver::set_auto_gain(bool automatic)
 {
-    src->set_gain_mode(automatic);
+    if (stitch_src)
+        stitch_src->set_gain_mode(automatic);
+    else
+        src->set_gain_mode(automatic);
+    if (standby_src)
+        standby_src->set_gain_mode(automatic);
 
     return STATUS_OK;
 }
@@ -654,8 +1103,9 @@ receiver::status receiver::set_auto_gain(bool automatic)
  */
 receiver::status receiver::set_filter_offset(double offset_hz)
 {
+    std::lock_guard<std::mutex> lock(d_ddc_mutex);
     d_filter_offset = offset_hz;
-    ddc->set_center_freq(d_filter_offset - d_cw_offset);
+    ddc->set_center_freq(d_filter_offset + d_doppler_offset - d_cw_offset);
 
     return STATUS_OK;
 }
@@ -673,8 +1123,11 @@ double receiver::get_filter_offset(void) const
 /* CW offset can serve as a "BFO" if the GUI needs it */
 receiver::status receiver::set_cw_offset(double offset_hz)
 {
-    d_cw_offset = offset_hz;
-    ddc->set_center_freq(d_filter_offset - d_cw_offset);
+    {
+        std::lock_guard<std::mutex> lock(d_ddc_mutex);
+        d_cw_offset = offset_hz;
+        ddc->set_center_freq(d_filter_offset + d_doppler_offset - d_cw_offset);
+    }
     rx->set_cw_offset(d_cw_offset);
 
     return STATUS_OK;
@@ -685,38 +1138,65 @@ double receiver::get_cw_offset(void) const
     return d_cw_offset;
 }
 
-receiver::status receiver::set_filter(double low, double high, filter_shape shape)
+/**
+ * @brief Set the Doppler correction of the demodulator channel.
+ * @param offset_hz Shift added to the filter offset, in Hz.
+ *
+ * The correction moves the channel in the down-converter only, so it can
+ * be updated many times per second without retuning the hardware, and it
+ * does not change the filter offset that the GUI shows and sets.
+ */
+receiver::status receiver::set_doppler_offset(double offset_hz)
 {
-    double trans_width;
+    std::lock_guard<std::mutex> lock(d_ddc_mutex);
+    d_doppler_offset = offset_hz;
+    ddc->set_center_freq(d_filter_offset + d_doppler_offset - d_cw_offset);
 
-    if ((low >= high) || (std::abs(high-low) < RX_FILTER_MIN_WIDTH))
-        return STATUS_ERROR;
+    return STATUS_OK;
+}
 
+double receiver::get_doppler_offset(void) const
+{
+    return d_doppler_offset;
+}
+
+/** Transition width of a channel filter of the given shape. */
+double receiver::transition_width(double low, double high, filter_shape shape)
+{
     switch (shape) {
 
     case FILTER_SHAPE_SOFT:
-        trans_width = std::abs(high - low) * 0.5;
-        break;
+        return std::abs(high - low) * 0.5;
 
     case FILTER_SHAPE_SHARP:
-        trans_width = std::abs(high - low) * 0.1;
-        break;
+        return std::abs(high - low) * 0.1;
 
     case FILTER_SHAPE_NORMAL:
     default:
-        trans_width = std::abs(high - low) * 0.2;
-        break;
+        return std::abs(high - low) * 0.2;
 
     }
+}
 
-    rx->set_filter(low, high, trans_width);
+receiver::status receiver::set_filter(double low, double high, filter_shape shape)
+{
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    if ((low >= high) || (std::abs(high-low) < RX_FILTER_MIN_WIDTH))
+        return STATUS_ERROR;
+
+    rx->set_filter(low, high, transition_width(low, high, shape));
+    d_filter_low = low;
+    d_filter_high = high;
 
     return STATUS_OK;
 }
 
 receiver::status receiver::set_freq_corr(double ppm)
 {
-    src->set_freq_corr(ppm);
+    if (stitch_src)
+        stitch_src->set_freq_corr(ppm);
+    else
+        src->set_freq_corr(ppm);
 
     return STATUS_OK;
 }
@@ -734,10 +1214,37 @@ float receiver::get_signal_pwr() const
     return rx->get_signal_level();
 }
 
+/**
+ * @brief Measure the signal power of the next samples.
+ * @param skip_sec Time to let pass before, for the filters to settle.
+ * @param length_sec Time to average over.
+ *
+ * This is the detector of get_signal_pwr() with a window of its own, short
+ * enough for a scanner to measure a channel right after tuning to it.
+ * @sa get_level_probe()
+ */
+void receiver::start_level_probe(double skip_sec, double length_sec)
+{
+    rx->start_level_probe(skip_sec, length_sec);
+}
+
+/**
+ * @brief Get the result of start_level_probe().
+ * @param level_db The power in dBFS.
+ * @return false while the measurement is not done.
+ */
+bool receiver::get_level_probe(float &level_db) const
+{
+    return rx->get_level_probe(level_db);
+}
+
 /** Set new FFT size. */
 void receiver::set_iq_fft_size(int newsize)
 {
     iq_fft->set_fft_size(newsize);
+    zoom_fft->set_fft_size(newsize);
+    input_fft->set_fft_size(newsize);
+    chan_fft->set_fft_size(newsize);
 }
 
 unsigned int receiver::iq_fft_size() const
@@ -748,60 +1255,514 @@ unsigned int receiver::iq_fft_size() const
 void receiver::set_iq_fft_window(int window_type, bool normalize_energy)
 {
     iq_fft->set_window_type(window_type, normalize_energy);
+    zoom_fft->set_window_type(window_type, normalize_energy);
+    input_fft->set_window_type(window_type, normalize_energy);
+    chan_fft->set_window_type(window_type, normalize_energy);
 }
 
-/** Get latest baseband FFT data. */
-int receiver::get_iq_fft_data(float* fftPoints)
+/**
+ * @brief Enable/disable continuous (streaming) baseband FFT.
+ * @param enable Compute every FFT frame on the DSP thread.
+ * @param overlap Overlap between consecutive frames (0.0 to <1.0).
+ * @param reduce Frame reduction, see rx_fft_c::stream_reduce.
+ */
+void receiver::set_iq_fft_streaming(bool enable, float overlap, int reduce)
 {
-    return iq_fft->get_fft_data(fftPoints);
+    iq_fft->set_streaming(enable, overlap, reduce);
 }
 
-unsigned int receiver::audio_fft_size() const
+/** Set number of threads used for the baseband FFT. */
+void receiver::set_iq_fft_threads(int nthreads)
 {
-    return audio_fft->fft_size();
+    iq_fft->set_fft_threads(nthreads);
 }
 
-/** Get latest audio FFT data. */
-int receiver::get_audio_fft_data(float* fftPoints)
+/** Compute the streamed baseband FFT on an OpenCL device, if there is one. */
+void receiver::set_iq_fft_gpu(bool enable)
 {
-    return audio_fft->get_fft_data(fftPoints);
+    iq_fft->set_gpu(enable);
 }
 
-receiver::status receiver::set_nb_on(int nbid, bool on)
+/**
+ * @brief Select the baseband FFT spectral estimator.
+ * @param estimator The estimator, see rx_fft_c::estimator.
+ * @param param Number of Welch segments or PFB taps.
+ */
+void receiver::set_iq_fft_estimator(int estimator, int param)
 {
-    if (rx->has_nb())
-        rx->set_nb_on(nbid, on);
-
-    return STATUS_OK; // FIXME
+    iq_fft->set_estimator(estimator, std::max(param, 1));
 }
 
-receiver::status receiver::set_nb_threshold(int nbid, float threshold)
+/** Number of baseband FFT snapshots that had to be re-copied. */
+unsigned long receiver::get_iq_fft_read_retries(void) const
 {
-    if (rx->has_nb())
-        rx->set_nb_threshold(nbid, threshold);
+    return iq_fft->read_retries();
+}
 
-    return STATUS_OK; // FIXME
+/** Sample index of the next baseband sample, at the FFT input rate. */
+uint64_t receiver::get_iq_sample_count(void) const
+{
+    return iq_fft->sample_count();
 }
 
 /**
- * @brief Set squelch level.
- * @param level_db The new level in dBFS.
+ * @brief Gaps in the input, such as overflows of the device.
+ * @param events Number of gaps since the receiver was created.
+ * @param samples Input samples missing in the gaps, at the input rate.
+ *
+ * The gaps are found by the baseband FFT from the rx_time tags of the
+ * source, or from its sample count falling behind the system clock.
+ * @sa rx_fft_c::update_time()
  */
-receiver::status receiver::set_sql_level(double level_db)
+void receiver::get_input_drops(uint64_t &events, uint64_t &samples) const
 {
-    if (rx->has_sql())
-        rx->set_sql_level(level_db);
-
-    return STATUS_OK; // FIXME
+    iq_fft->get_drops(events, samples);
+    samples *= d_decim;
 }
 
-/** Set squelch alpha */
-receiver::status receiver::set_sql_alpha(double alpha)
+/**
+ * @brief Get the last retune tagged by the input device.
+ * @param sample_index First baseband sample at the new frequency.
+ * @param freq Frequency reported in the tag.
+ * @param count Number of retune tags so far.
+ * @returns false if the device does not tag retunes.
+ * @sa rx_fft_c::get_retune()
+ */
+bool receiver::get_iq_retune(uint64_t &sample_index, double &freq, unsigned int &count)
 {
-    if (rx->has_sql())
-        rx->set_sql_alpha(alpha);
-
-    return STATUS_OK; // FIXME
+    return iq_fft->get_retune(sample_index, freq, count);
+}
+
+/**
+ * @brief Keep a history of the baseband for retrospective FFTs.
+ * @param seconds History length in seconds, 0 to disable.
+ */
+void receiver::set_iq_fft_history(double seconds)
+{
+    iq_fft->set_history(seconds);
+}
+
+/**
+ * @brief Get the baseband FFT of the input some time ago.
+ * @param fftPoints Buffer to copy FFT data, iq_fft_size() elements.
+ * @param age How far to look back in seconds.
+ * @returns 0 on success, -1 if the history does not reach back that far.
+ */
+int receiver::get_iq_fft_history_data(float *fftPoints, double age)
+{
+    return iq_fft->get_history_fft_data(fftPoints, age);
+}
+
+/**
+ * @brief Load FFTW wisdom and use the file to store new wisdom.
+ * @param filename Full path of the wisdom file.
+ */
+void receiver::load_fft_wisdom(const std::string &filename)
+{
+    fft_plan_cache::load_wisdom(filename);
+}
+
+/**
+ * @brief Plan baseband FFT sizes in the background.
+ * @param sizes The FFT sizes to plan.
+ * @param nthreads The number of FFTW threads to plan for.
+ *
+ * Later FFT size changes to any of these sizes reuse the finished plans.
+ */
+void receiver::preplan_iq_fft(const std::vector<unsigned int> &sizes, int nthreads)
+{
+    fft_plan_cache::preplan(sizes, nthreads);
+}
+
+/** Get latest baseband FFT data. */
+int receiver::get_iq_fft_data(float* fftPoints)
+{
+    return iq_fft->get_fft_data(fftPoints);
+}
+
+/**
+ * @brief Get latest baseband FFT data and its position in the input stream.
+ * @param fftPoints Buffer to copy FFT data, iq_fft_size() elements.
+ * @param sample_index Index of the sample after the frame (output).
+ * @param timestamp Unix time of that sample (output).
+ *
+ * The index counts samples at the FFT input rate, i.e. the input rate
+ * divided by the input decimation.
+ */
+int receiver::get_iq_fft_data(float* fftPoints, uint64_t &sample_index, double &timestamp)
+{
+    return iq_fft->get_fft_data(fftPoints, sample_index, timestamp);
+}
+
+/**
+ * @brief Compute a new baseband FFT frame and hand it to all subscribers.
+ * @returns The new frame, or an empty pointer if no data is available.
+ *
+ * This is the only place that reads the baseband FFT for display, so that
+ * each frame is computed once no matter how many consumers there are.
+ * Subscribers are called on the calling thread. The input and channel
+ * taps are connected here while they have subscribers, and their frames
+ * are handed out at the same time.
+ */
+iq_fft_frame_sptr receiver::publish_iq_fft_frame(void)
+{
+    bool wanted[FFT_TAP_NUM] = { true, false, false };
+    {
+        std::lock_guard<std::mutex> lock(d_fft_frame_mutex);
+        for (auto &sub : d_fft_subscribers)
+            wanted[sub.second.tap] = true;
+    }
+    update_fft_taps(wanted);
+
+    iq_fft_frame_sptr frame = read_fft_frame(FFT_TAP_BASEBAND);
+    if (frame)
+    {
+        {
+            std::lock_guard<std::mutex> lock(d_fft_frame_mutex);
+            d_fft_frame = frame;
+        }
+        deliver_fft_frame(frame, FFT_TAP_BASEBAND);
+    }
+
+    for (int tap = FFT_TAP_INPUT; tap < FFT_TAP_NUM; tap++)
+    {
+        if (!d_fft_taps[tap] || (tap == FFT_TAP_CHANNEL && !d_chan_fft))
+            continue;
+        iq_fft_frame_sptr tap_frame = read_fft_frame((fft_tap)tap);
+        if (tap_frame)
+            deliver_fft_frame(tap_frame, (fft_tap)tap);
+    }
+
+    return frame;
+}
+
+/**
+ * @brief Get a frame with room for bins bins, from the pool if one is free.
+ *
+ * A pooled frame is free once the pool holds its only reference, so it
+ * comes back when the last consumer drops it and neither the frame nor
+ * its data are allocated again at the frame rate. The free frame with the
+ * smallest buffer that fits is taken. While consumers keep more than
+ * FFT_FRAME_POOL_SIZE frames, the others are allocated and not pooled.
+ */
+std::shared_ptr<iq_fft_frame> receiver::alloc_fft_frame(size_t bins)
+{
+    std::lock_guard<std::mutex> lock(d_fft_frame_mutex);
+    std::shared_ptr<iq_fft_frame> *best = nullptr;
+    for (auto &frame : d_fft_frame_pool)
+    {
+        if (frame.use_count() != 1)
+            continue;
+        const size_t cap = frame->data.capacity();
+        if (!best || (cap >= bins && (cap < (*best)->data.capacity() ||
+                                      (*best)->data.capacity() < bins)))
+            best = &frame;
+    }
+
+    if (!best)
+    {
+        auto frame = std::make_shared<iq_fft_frame>();
+        frame->data.resize(bins);
+        if (d_fft_frame_pool.size() < FFT_FRAME_POOL_SIZE)
+            d_fft_frame_pool.push_back(frame);
+        return frame;
+    }
+
+    // The last consumer released it on any thread, see its reads first
+    std::atomic_thread_fence(std::memory_order_acquire);
+    (*best)->data.resize(bins);
+    return *best;
+}
+
+/** Read a new frame of an FFT tap, empty if no data is available. */
+iq_fft_frame_sptr receiver::read_fft_frame(fft_tap tap)
+{
+    rx_fft_c_sptr fft = iq_fft;
+    double timestamp;
+
+    if (tap == FFT_TAP_INPUT)
+        fft = input_fft;
+    else if (tap == FFT_TAP_CHANNEL)
+        fft = chan_fft;
+    auto frame = alloc_fft_frame(fft->fft_size());
+
+    frame->center_freq = d_rf_freq;
+    frame->sample_rate = d_decim_rate;
+    if (tap == FFT_TAP_INPUT)
+    {
+        frame->sample_rate = d_input_rate;
+    }
+    else if (tap == FFT_TAP_CHANNEL)
+    {
+        frame->center_freq = d_rf_freq + d_filter_offset + d_doppler_offset - d_cw_offset;
+        frame->sample_rate = d_quad_rate;
+    }
+
+    frame->fft_size = (unsigned int)frame->data.size();
+    if (fft->get_fft_data(frame->data.data(), frame->sample_index, timestamp) < 0)
+        return iq_fft_frame_sptr();
+
+    frame->timestamp = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::duration<double>(timestamp)));
+
+    std::lock_guard<std::mutex> lock(d_fft_frame_mutex);
+    frame->seq = d_fft_frame_seq[tap]++;
+    return frame;
+}
+
+/**
+ * @brief Hand a frame to the subscribers of its tap that are due.
+ *
+ * The list of deliveries is taken from d_fft_deliveries and put back, so
+ * it keeps its capacity from frame to frame. A callback that publishes
+ * again gets an empty list of its own.
+ */
+void receiver::deliver_fft_frame(const iq_fft_frame_sptr &frame, fft_tap tap)
+{
+    std::vector<fft_delivery> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(d_fft_frame_mutex);
+        callbacks.swap(d_fft_deliveries);
+
+        const auto now = std::chrono::steady_clock::now();
+        for (auto &sub : d_fft_subscribers)
+        {
+            fft_subscriber &s = sub.second;
+            if (s.tap != tap)
+                continue;
+            if (s.interval.count() > 0)
+            {
+                if (now < s.next)
+                    continue;
+                // Keep the rate when frames come late, but do not catch up
+                s.next = now - s.next < s.interval ? s.next + s.interval : now + s.interval;
+            }
+            callbacks.push_back({ s.callback, s.max_bins, iq_fft_frame_sptr() });
+        }
+    }
+
+    // Decimated frames are made once per size, subscribers share them
+    for (size_t i = 0; i < callbacks.size(); i++)
+    {
+        const unsigned int bins = callbacks[i].max_bins;
+        if (bins == 0 || bins >= frame->data.size())
+        {
+            callbacks[i].callback(frame);
+            continue;
+        }
+        for (size_t j = 0; j < i && !callbacks[i].frame; j++)
+            if (callbacks[j].max_bins == bins)
+                callbacks[i].frame = callbacks[j].frame;
+        if (!callbacks[i].frame)
+            callbacks[i].frame = decimate_iq_fft_frame(frame, bins);
+        callbacks[i].callback(callbacks[i].frame);
+    }
+
+    // Drop the frames before the list goes back, for them to be free
+    callbacks.clear();
+    std::lock_guard<std::mutex> lock(d_fft_frame_mutex);
+    if (d_fft_deliveries.empty())
+        callbacks.swap(d_fft_deliveries);
+}
+
+/** Connect the input and channel FFT taps that are wanted, disconnect the others. */
+void receiver::update_fft_taps(const bool wanted[FFT_TAP_NUM])
+{
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    if (wanted[FFT_TAP_INPUT] == d_fft_taps[FFT_TAP_INPUT] &&
+        wanted[FFT_TAP_CHANNEL] == d_fft_taps[FFT_TAP_CHANNEL])
+        return;
+
+    tb->lock();
+    if (wanted[FFT_TAP_INPUT] != d_fft_taps[FFT_TAP_INPUT])
+    {
+        if (wanted[FFT_TAP_INPUT])
+        {
+            tb->connect(full_rate_block(), 0, input_swap, 0);
+            tb->connect(input_swap, 0, input_fft, 0);
+        }
+        else
+        {
+            tb->disconnect(full_rate_block(), 0, input_swap, 0);
+            tb->disconnect(input_swap, 0, input_fft, 0);
+        }
+    }
+    if (wanted[FFT_TAP_CHANNEL] != d_fft_taps[FFT_TAP_CHANNEL])
+    {
+        if (d_chan_fft)
+            tb->disconnect(ddc, 0, chan_fft, 0);
+        else if (d_demod != RX_DEMOD_OFF)
+            tb->connect(ddc, 0, chan_fft, 0);
+        d_chan_fft = !d_chan_fft && d_demod != RX_DEMOD_OFF;
+    }
+    for (int i = 0; i < FFT_TAP_NUM; i++)
+        d_fft_taps[i] = wanted[i];
+    unlock_tb();
+}
+
+/**
+ * @brief Reduce a frame to fewer bins by keeping the maximum of each group,
+ *        so narrow carriers are not averaged away.
+ */
+iq_fft_frame_sptr receiver::decimate_iq_fft_frame(const iq_fft_frame_sptr &frame,
+                                                  unsigned int bins)
+{
+    auto small = alloc_fft_frame(bins);
+    const size_t n = frame->data.size();
+
+    small->fft_size = frame->fft_size;
+    small->center_freq = frame->center_freq;
+    small->sample_rate = frame->sample_rate;
+    small->seq = frame->seq;
+    small->sample_index = frame->sample_index;
+    small->timestamp = frame->timestamp;
+    for (size_t x = 0; x < bins; x++)
+    {
+        const size_t b0 = x * n / bins;
+        const size_t b1 = std::max((x + 1) * n / bins, b0 + 1);
+        small->data[x] = *std::max_element(frame->data.begin() + b0,
+                                           frame->data.begin() + b1);
+    }
+    return small;
+}
+
+/** Get the last published baseband FFT frame, may be empty. */
+iq_fft_frame_sptr receiver::get_iq_fft_frame(void)
+{
+    std::lock_guard<std::mutex> lock(d_fft_frame_mutex);
+    return d_fft_frame;
+}
+
+/**
+ * @brief Get notified of published baseband FFT frames.
+ * @param callback Function called with each new frame.
+ * @param max_rate Frames per second at most, 0 for every frame.
+ * @param max_bins Bins per frame at most, larger frames are max-decimated.
+ *                 0 for full frames.
+ * @param tap Where the spectrum is taken. The input and channel taps only
+ *            run while they have subscribers.
+ * @returns Id to pass to unsubscribe_iq_fft().
+ *
+ * Consumers that only draw a small view ask for what they draw, so frames
+ * they would drop are not converted and copied for them.
+ */
+int receiver::subscribe_iq_fft(const std::function<void(const iq_fft_frame_sptr &)> &callback,
+                               double max_rate, unsigned int max_bins, fft_tap tap)
+{
+    std::lock_guard<std::mutex> lock(d_fft_frame_mutex);
+
+    fft_subscriber &sub = d_fft_subscribers[++d_fft_sub_id];
+    sub.callback = callback;
+    sub.interval = max_rate > 0.0
+                 ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                       std::chrono::duration<double>(1.0 / max_rate))
+                 : std::chrono::steady_clock::duration::zero();
+    sub.next = std::chrono::steady_clock::time_point();
+    sub.max_bins = max_bins;
+    sub.tap = tap;
+    return d_fft_sub_id;
+}
+
+/** Remove a subscriber added with subscribe_iq_fft(). */
+void receiver::unsubscribe_iq_fft(int id)
+{
+    std::lock_guard<std::mutex> lock(d_fft_frame_mutex);
+    d_fft_subscribers.erase(id);
+}
+
+/**
+ * @brief Enable/disable and tune the zoom FFT.
+ * @param enable Whether the zoom FFT should run.
+ * @param center_freq Center of the zoomed span relative to the baseband center.
+ * @param span Width of the zoomed span.
+ *
+ * The zoom FFT is only connected to the flowgraph while enabled.
+ */
+void receiver::set_zoom_fft(bool enable, double center_freq, double span)
+{
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    if (enable)
+        zoom_fft->set_zoom(center_freq, span);
+
+    if (enable == d_zoom_fft)
+        return;
+
+    tb->lock();
+    if (enable)
+        tb->connect(iq_swap, 0, zoom_fft, 0);
+    else
+        tb->disconnect(iq_swap, 0, zoom_fft, 0);
+    d_zoom_fft = enable;
+    unlock_tb();
+}
+
+unsigned int receiver::zoom_fft_size() const
+{
+    return zoom_fft->fft_size();
+}
+
+/**
+ * @brief Get latest zoom FFT data.
+ * @param fftPoints Buffer for zoom_fft_size() points.
+ * @param center_freq Center of the data relative to the baseband center (output).
+ * @param rate Bandwidth covered by the data (output).
+ * @returns 0 on success, -1 if the zoom FFT has no valid data.
+ */
+int receiver::get_zoom_fft_data(float* fftPoints, double &center_freq, double &rate)
+{
+    if (!d_zoom_fft)
+        return -1;
+
+    return zoom_fft->get_fft_data(fftPoints, center_freq, rate);
+}
+
+unsigned int receiver::audio_fft_size() const
+{
+    return audio_fft->fft_size();
+}
+
+/** Get latest audio FFT data. */
+int receiver::get_audio_fft_data(float* fftPoints)
+{
+    return audio_fft->get_fft_data(fftPoints);
+}
+
+receiver::status receiver::set_nb_on(int nbid, bool on)
+{
+    if (rx->has_nb())
+        rx->set_nb_on(nbid, on);
+
+    return STATUS_OK; // FIXME
+}
+
+receiver::status receiver::set_nb_threshold(int nbid, float threshold)
+{
+    if (rx->has_nb())
+        rx->set_nb_threshold(nbid, threshold);
+
+    return STATUS_OK; // FIXME
+}
+
+/**
+ * @brief Set squelch level.
+ * @param level_db The new level in dBFS.
+ */
+receiver::status receiver::set_sql_level(double level_db)
+{
+    if (rx->has_sql())
+        rx->set_sql_level(level_db);
+
+    return STATUS_OK; // FIXME
+}
+
+/** Set squelch alpha */
+receiver::status receiver::set_sql_alpha(double alpha)
+{
+    if (rx->has_sql())
+        rx->set_sql_alpha(alpha);
+
+    return STATUS_OK; // FIXME
 }
 
 /**
@@ -862,12 +1823,44 @@ receiver::status receiver::set_agc_manual_gain(int gain)
     return STATUS_OK; // FIXME
 }
 
+/**
+ * Process the AGC of all receivers and VFOs in blocks with VOLK (default)
+ * or one sample at a time, see CAgc::ProcessBlock().
+ */
+void receiver::set_agc_block_mode(bool enabled)
+{
+    CAgc::SetBlockMode(enabled);
+}
+
+/**
+ * @brief Set the demodulator.
+ * @param demod The new demodulator.
+ * @param force Rebuild the flow graph even if nothing changes.
+ *
+ * Demodulators of the same receiver chain are switched inside the chain
+ * while the flow graph runs. Only a change between the narrow band and the
+ * wide band FM chain, or to and from RX_DEMOD_OFF, stops the flow graph.
+ */
 receiver::status receiver::set_demod(rx_demod demod, bool force)
 {
-    status ret = STATUS_OK;
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    TRACE_SCOPE("rx", "receiver::set_demod");
+    int chain_demod, old_chain_demod;
+    rx_chain chain = demod_chain(demod, chain_demod);
 
     if (!force && (demod == d_demod))
-        return ret;
+        return STATUS_OK;
+
+    if (chain == RX_CHAIN_NONE && demod != RX_DEMOD_OFF)
+        return STATUS_ERROR;
+
+    if (!force && chain != RX_CHAIN_NONE &&
+        chain == demod_chain(d_demod, old_chain_demod))
+    {
+        rx->set_demod(chain_demod);
+        d_demod = demod;
+        return STATUS_OK;
+    }
 
     // tb->lock() seems to hang occasionally
     if (d_running)
@@ -877,64 +1870,16 @@ receiver::status receiver::set_demod(rx_demod demod, bool force)
     }
 
     tb->disconnect_all();
-
-    switch (demod)
-    {
-    case RX_DEMOD_OFF:
-        connect_all(RX_CHAIN_NONE);
-        break;
-
-    case RX_DEMOD_NONE:
-        connect_all(RX_CHAIN_NBRX);
-        rx->set_demod(nbrx::NBRX_DEMOD_NONE);
-        break;
-
-    case RX_DEMOD_AM:
-        connect_all(RX_CHAIN_NBRX);
-        rx->set_demod(nbrx::NBRX_DEMOD_AM);
-        break;
-
-    case RX_DEMOD_AMSYNC:
-        connect_all(RX_CHAIN_NBRX);
-        rx->set_demod(nbrx::NBRX_DEMOD_AMSYNC);
-        break;
-
-    case RX_DEMOD_NFM:
-        connect_all(RX_CHAIN_NBRX);
-        rx->set_demod(nbrx::NBRX_DEMOD_FM);
-        break;
-
-    case RX_DEMOD_WFM_M:
-        connect_all(RX_CHAIN_WFMRX);
-        rx->set_demod(wfmrx::WFMRX_DEMOD_MONO);
-        break;
-
-    case RX_DEMOD_WFM_S:
-        connect_all(RX_CHAIN_WFMRX);
-        rx->set_demod(wfmrx::WFMRX_DEMOD_STEREO);
-        break;
-
-    case RX_DEMOD_WFM_S_OIRT:
-        connect_all(RX_CHAIN_WFMRX);
-        rx->set_demod(wfmrx::WFMRX_DEMOD_STEREO_UKW);
-        break;
-
-    case RX_DEMOD_SSB:
-        connect_all(RX_CHAIN_NBRX);
-        rx->set_demod(nbrx::NBRX_DEMOD_SSB);
-        break;
-
-    default:
-        ret = STATUS_ERROR;
-        break;
-    }
+    connect_all(chain);
+    if (chain != RX_CHAIN_NONE)
+        rx->set_demod(chain_demod);
 
     d_demod = demod;
 
     if (d_running)
-        tb->start();
+        start_tb();
 
-    return ret;
+    return STATUS_OK;
 }
 
 /**
@@ -1006,6 +1951,7 @@ receiver::status receiver::set_af_gain(float gain_db)
  */
 receiver::status receiver::start_audio_recording(const std::string filename)
 {
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
     if (d_recording_wav)
     {
         /* error - we are already recording */
@@ -1046,7 +1992,7 @@ receiver::status receiver::start_audio_recording(const std::string filename)
     tb->connect(rx, 1, wav_gain1, 0);
     tb->connect(wav_gain0, 0, wav_sink, 0);
     tb->connect(wav_gain1, 0, wav_sink, 1);
-    tb->unlock();
+    unlock_tb();
     d_recording_wav = true;
 
     std::cout << "Recording audio to " << filename << std::endl;
@@ -1057,6 +2003,7 @@ receiver::status receiver::start_audio_recording(const std::string filename)
 /** Stop WAV file recorder. */
 receiver::status receiver::stop_audio_recording()
 {
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
     if (!d_recording_wav) {
         /* error: we are not recording */
         std::cout << "ERROR: Can not stop audio recorder (not recording)" << std::endl;
@@ -1084,7 +2031,7 @@ receiver::status receiver::stop_audio_recording()
     tb->connect(ddc, 0, rx, 0);
     // End temporary workaround
 
-    tb->unlock();
+    unlock_tb();
     wav_gain0.reset();
     wav_gain1.reset();
     wav_sink.reset();
@@ -1180,10 +2127,11 @@ receiver::status receiver::stop_audio_playback()
     return STATUS_OK;
 }
 
-/** Start UDP streaming of audio. */
-receiver::status receiver::start_udp_streaming(const std::string host, int port, bool stereo)
+/** Start UDP streaming of audio, the RTP packets of the main audio are channel 0. */
+receiver::status receiver::start_udp_streaming(const std::string host, int port, bool stereo,
+                                               udp_stream_format format)
 {
-    audio_udp_sink->start_streaming(host, port, stereo);
+    audio_udp_sink->start_streaming(host, port, stereo, format);
     return STATUS_OK;
 }
 
@@ -1197,9 +2145,14 @@ receiver::status receiver::stop_udp_streaming()
 /**
  * @brief Start I/Q data recorder.
  * @param filename The filename where to record.
+ * @param format The sample format of the file.
+ * @param compress Write a gzip stream, see iq_file_sink::can_compress().
  */
-receiver::status receiver::start_iq_recording(const std::string filename)
+receiver::status receiver::start_iq_recording(const std::string filename,
+                                              iq_file_format format,
+                                              bool compress)
 {
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
     receiver::status status = STATUS_OK;
 
     if (d_recording_iq) {
@@ -1209,11 +2162,11 @@ receiver::status receiver::start_iq_recording(const std::string filename)
 
     try
     {
-        iq_sink = gr::blocks::file_sink::make(sizeof(gr_complex), filename.c_str(), true);
+        iq_sink = make_iq_file_sink(filename, format, compress);
     }
     catch (std::runtime_error &e)
     {
-        std::cout << __func__ << ": couldn't open I/Q file" << std::endl;
+        std::cout << __func__ << ": couldn't open I/Q file: " << e.what() << std::endl;
         return STATUS_ERROR;
     }
 
@@ -1221,9 +2174,9 @@ receiver::status receiver::start_iq_recording(const std::string filename)
     if (d_decim >= 2)
         tb->connect(input_decim, 0, iq_sink, 0);
     else
-        tb->connect(src, 0, iq_sink, 0);
+        tb->connect(full_rate_block(), 0, iq_sink, 0);
     d_recording_iq = true;
-    tb->unlock();
+    unlock_tb();
 
     return status;
 }
@@ -1231,20 +2184,21 @@ receiver::status receiver::start_iq_recording(const std::string filename)
 /** Stop I/Q data recorder. */
 receiver::status receiver::stop_iq_recording()
 {
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
     if (!d_recording_iq) {
         /* error: we are not recording */
         return STATUS_ERROR;
     }
 
     tb->lock();
-    iq_sink->close();
-
     if (d_decim >= 2)
         tb->disconnect(input_decim, 0, iq_sink, 0);
     else
-        tb->disconnect(src, 0, iq_sink, 0);
+        tb->disconnect(full_rate_block(), 0, iq_sink, 0);
+    unlock_tb();
 
-    tb->unlock();
+    // Outside the lock, draining the ring to the disk may take a while
+    iq_sink->close();
     iq_sink.reset();
     d_recording_iq = false;
 
@@ -1252,84 +2206,448 @@ receiver::status receiver::stop_iq_recording()
 }
 
 /**
- * @brief Seek to position in IQ file source.
- * @param pos Byte offset from the beginning of the file.
+ * @brief Buffer fill and dropped samples of the I/Q recorder.
+ * @param ring_fill Part of the ring waiting for the disk, 0 to 1.
+ * @param dropped Samples dropped since the recording started.
+ * @return false if there is no recording.
  */
-receiver::status receiver::seek_iq_file(long pos)
+bool receiver::get_iq_recording_stats(float &ring_fill, uint64_t &dropped) const
 {
-    receiver::status status = STATUS_OK;
-
-    tb->lock();
-
-    if (src->seek(pos, SEEK_SET))
-    {
-        status = STATUS_OK;
-    }
-    else
-    {
-        status = STATUS_ERROR;
-    }
+    if (!d_recording_iq || !iq_sink)
+        return false;
 
-    tb->unlock();
+    ring_fill = iq_sink->ring_fill();
+    dropped = iq_sink->dropped();
 
-    return status;
+    return true;
 }
 
 /**
- * @brief Start data sniffer.
- * @param buffsize The buffer that should be used in the sniffer.
- * @return STATUS_OK if the sniffer was started, STATUS_ERROR if the sniffer is already in use.
+ * @brief Position of the I/Q recorder in the file.
+ * @param sample Index of the next sample written. Dropped samples are not
+ *               in the file and do not count.
+ * @return false if there is no recording.
  */
-receiver::status receiver::start_sniffer(unsigned int samprate, int buffsize)
+bool receiver::get_iq_recording_position(uint64_t &sample) const
 {
-    if (d_sniffer_active) {
-        /* sniffer already in use */
+    if (!d_recording_iq || !iq_sink)
+        return false;
+
+    sample = iq_sink->samples();
+
+    return true;
+}
+
+/**
+ * @brief Keep the last seconds of I/Q for captures of what came before a
+ *        trigger.
+ * @param seconds Pre-trigger length, 0 to free the ring.
+ *
+ * The ring is fed like the I/Q recorder and holds IQ_CAPTURE_SLACK_SEC
+ * more than asked for. A capture that is running ends with the samples
+ * already in the old ring.
+ */
+void receiver::set_iq_pretrigger(double seconds)
+{
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    seconds = std::max(seconds, 0.0);
+    if (seconds == d_iq_pretrigger)
+        return;
+
+    d_iq_pretrigger = seconds;
+    tb->lock();
+    replace_iq_capture(seconds > 0.0);
+    unlock_tb();
+}
+
+/* Samples of a pre-trigger ring at the current rate */
+uint64_t receiver::iq_capture_samples() const
+{
+    return (uint64_t)((d_iq_pretrigger + IQ_CAPTURE_SLACK_SEC) * d_decim_rate);
+}
+
+/* Replace the pre-trigger ring, or remove it, with the flow graph locked */
+void receiver::replace_iq_capture(bool enable)
+{
+    gr::basic_block_sptr b = full_rate_block();
+    if (d_decim >= 2)
+        b = input_decim;
+
+    if (iq_capture)
+        tb->disconnect(b, 0, iq_capture, 0);
+    iq_capture.reset();
+
+    if (enable)
+    {
+        iq_capture = make_iq_capture_sink(iq_capture_samples());
+        tb->connect(b, 0, iq_capture, 0);
+    }
+}
+
+/**
+ * @brief Write a capture from the pre-trigger ring.
+ * @param filename The cf32 file to write.
+ * @param pre_seconds Time before now to start at, limited to the ring.
+ * @param post_seconds Time after now to end at.
+ * @param captured_pre Time before now the file starts at (output).
+ * @return STATUS_ERROR if there is no ring, a capture is running or the
+ *         file can not be opened.
+ */
+receiver::status receiver::start_iq_capture(const std::string filename, double pre_seconds,
+                                            double post_seconds, double &captured_pre)
+{
+    if (!iq_capture)
         return STATUS_ERROR;
+
+    int64_t pre = iq_capture->start(filename,
+                                    (uint64_t)(std::max(pre_seconds, 0.0) * d_decim_rate),
+                                    (uint64_t)(std::max(post_seconds, 0.0) * d_decim_rate));
+    if (pre < 0)
+        return STATUS_ERROR;
+
+    captured_pre = (double)pre / d_decim_rate;
+    return STATUS_OK;
+}
+
+/**
+ * @brief Let the running capture go on until post_seconds from now.
+ * @return false if no capture is running.
+ */
+bool receiver::extend_iq_capture(double post_seconds)
+{
+    if (!iq_capture)
+        return false;
+
+    return iq_capture->extend((uint64_t)(std::max(post_seconds, 0.0) * d_decim_rate));
+}
+
+bool receiver::iq_capture_active() const
+{
+    return iq_capture && iq_capture->capturing();
+}
+
+/**
+ * @brief Seek to position in IQ file source.
+ * @param pos Sample offset from the beginning of the file.
+ *
+ * The memory mapped playback takes the new position with its next block,
+ * without locking the flow graph.
+ */
+receiver::status receiver::seek_iq_file(long pos)
+{
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    receiver::status status = STATUS_OK;
+
+    if (iq_file_src)
+    {
+        iq_file_src->seek((uint64_t)std::max(pos, 0L));
+        return STATUS_OK;
     }
 
-    sniffer->set_buffer_size(buffsize);
-    sniffer_rr = make_resampler_ff((float)samprate/(float)d_audio_rate);
     tb->lock();
-    tb->connect(rx, 0, sniffer_rr, 0);
-    tb->connect(sniffer_rr, 0, sniffer, 0);
-    tb->unlock();
-    d_sniffer_active = true;
+
+    if (src->seek(pos, SEEK_SET))
+    {
+        status = STATUS_OK;
+    }
+    else
+    {
+        status = STATUS_ERROR;
+    }
+
+    unlock_tb();
+
+    return status;
+}
+
+/**
+ * @brief Play an uncompressed I/Q recording through a memory mapping.
+ * @param filename The recording.
+ * @param format The sample format of the recording.
+ * @param rate The sample rate of the recording.
+ * @param freq The center frequency of the recording.
+ * @return STATUS_ERROR if the file can not be mapped, the input is
+ *         unchanged then.
+ *
+ * The file source takes the place of the input device in the flow graph
+ * and a zero file source at the rate and frequency of the recording
+ * answers for the device. Opening the next device with set_input_device()
+ * ends the playback.
+ */
+receiver::status receiver::start_iq_playback(const std::string filename,
+                                             iq_file_format format,
+                                             double rate, double freq)
+{
+    iq_file_source_sptr file_src;
+
+    // Integer recordings go to the int16 halfband stages without conversion
+    const bool sc16 = d_sc16_playback && format != IQ_FILE_CF32 &&
+                      fir_decim_cc::has_halfbands(d_decim, d_decim_quality);
+
+    try
+    {
+        file_src = make_iq_file_source(filename, format, rate, sc16);
+    }
+    catch (std::exception &x)
+    {
+        std::cerr << "Can not play " << filename << ": " << x.what() << std::endl;
+        return STATUS_ERROR;
+    }
+
+    std::ostringstream device;
+    device << "file=" << escape_filename(get_zero_file()) << ",freq=" << (long long)freq
+           << ",rate=" << (long long)rate << ",repeat=true,throttle=true";
+    replace_input(device.str(), file_src);
 
     return STATUS_OK;
 }
 
 /**
- * @brief Stop data sniffer.
- * @return STATUS_ERROR i the sniffer is not currently active.
+ * @brief Get the position of the memory mapped playback.
+ * @param pos Sample played next (output).
+ * @param length Samples in the recording (output).
+ * @return false if there is no such playback.
+ */
+bool receiver::get_iq_playback_position(uint64_t &pos, uint64_t &length) const
+{
+    if (!iq_file_src)
+        return false;
+
+    pos = iq_file_src->position();
+    length = iq_file_src->length();
+    return true;
+}
+
+/**
+ * @brief Set the speed of the memory mapped playback.
+ * @param speed Recording samples per sample played, negative to play
+ *              backwards and 0 to pause.
+ */
+void receiver::set_iq_playback_speed(double speed)
+{
+    if (iq_file_src)
+        iq_file_src->set_speed(speed);
+}
+
+/**
+ * @brief Start a data decoder.
+ * @param decoder The decoder, fed with the audio at its own sample rate.
+ * @param vfo The VFO to decode, or -1 for the main channel.
+ * @return Id of the decoder for get_decoder_message() and stop_decoder(),
+ *         or -1 if there is no such VFO.
+ *
+ * The decoder runs in the flow graph, so it keeps up with the audio whether
+ * or not its messages are read in time. Decoders of the same channel and
+ * rate share the audio resampler, see connect_decoders().
+ */
+int receiver::start_decoder(data_decoder_sptr decoder, int vfo)
+{
+    if (vfo >= 0 && d_vfos.count(vfo) == 0)
+        return -1;
+
+    decoder_chain dec;
+    dec.vfo = vfo;
+    dec.rate = decoder->sample_rate();
+    dec.sink = make_decoder_sink_f(decoder);
+    dec.store = make_decoder_store();
+
+    const int id = ++d_decoder_id;
+    d_decoders[id] = dec;
+    reconnect_all();
+
+    return id;
+}
+
+/**
+ * @brief Stop a data decoder.
+ * @return STATUS_ERROR if there is no such decoder.
  */
-receiver::status receiver::stop_sniffer()
+receiver::status receiver::stop_decoder(int id)
 {
-    if (!d_sniffer_active) {
+    auto it = d_decoders.find(id);
+    if (it == d_decoders.end())
         return STATUS_ERROR;
+
+    d_decoders.erase(it);
+    reconnect_all();
+
+    return STATUS_OK;
+}
+
+/** Take the oldest message of a decoder, false if there is none. */
+bool receiver::get_decoder_message(int id, std::string &msg)
+{
+    auto it = d_decoders.find(id);
+    return it != d_decoders.end() && it->second.store->get_message(msg);
+}
+
+/**
+ * @brief Stream I/Q samples to the network.
+ * @param vfo The VFO whose down-converted samples are streamed, or -1 for
+ *            the baseband after the DC removal.
+ * @param format The sample format of the stream.
+ * @param tcp_port Port the clients connect to, 0 for none.
+ * @param group Multicast group the datagrams go to.
+ * @param udp_port Port of the datagrams, 0 for none.
+ * @return Id of the stream for stop_iq_stream(), or -1 if there is no such
+ *         VFO or the sockets can not be opened.
+ *
+ * The stream runs in the flow graph whether or not anybody reads it, see
+ * iq_stream_sink for how slow clients are dealt with.
+ */
+int receiver::start_iq_stream(int vfo, iq_file_format format, int tcp_port,
+                              const std::string &group, int udp_port)
+{
+    if (vfo >= 0 && d_vfos.count(vfo) == 0)
+        return -1;
+
+    iq_stream_chain stream;
+    stream.vfo = vfo;
+    try
+    {
+        stream.sink = make_iq_stream_sink(vfo < 0 ? "baseband" : "vfo " + std::to_string(vfo),
+                                          format, tcp_port, group, udp_port);
+    }
+    catch (std::runtime_error &e)
+    {
+        std::cout << __func__ << ": " << e.what() << std::endl;
+        return -1;
     }
 
-    tb->lock();
-    tb->disconnect(rx, 0, sniffer_rr, 0);
+    const int id = ++d_iq_stream_id;
+    d_iq_streams[id] = stream;
+    update_iq_streams();
+    reconnect_all();
 
-    // Temporary workaround for https://github.com/gnuradio/gnuradio/issues/5436
-    tb->disconnect(ddc, 0, rx, 0);
-    tb->connect(ddc, 0, rx, 0);
-    // End temporary workaround
+    return id;
+}
+
+/**
+ * @brief Stop streaming I/Q samples.
+ * @return STATUS_ERROR if there is no such stream.
+ */
+receiver::status receiver::stop_iq_stream(int id)
+{
+    auto it = d_iq_streams.find(id);
+    if (it == d_iq_streams.end())
+        return STATUS_ERROR;
+
+    d_iq_streams.erase(it);
+    reconnect_all();
+
+    return STATUS_OK;
+}
+
+/** Clients and samples dropped of an I/Q stream, false if there is no such stream. */
+bool receiver::get_iq_stream_stats(int id, int &clients, uint64_t &dropped) const
+{
+    auto it = d_iq_streams.find(id);
+    if (it == d_iq_streams.end())
+        return false;
+
+    clients = it->second.sink->clients();
+    dropped = it->second.sink->dropped();
+    return true;
+}
+
+/* Rate and center frequency of the I/Q streams, for their metadata */
+void receiver::update_iq_streams(void)
+{
+    for (auto &s : d_iq_streams)
+    {
+        auto v = d_vfos.find(s.second.vfo);
+        if (v == d_vfos.end())
+            s.second.sink->set_params(d_decim_rate, d_rf_freq);
+        else
+            s.second.sink->set_params(v->second.ddc_rate / v->second.ddc_decim,
+                                      d_rf_freq + v->second.offset);
+    }
+}
+
+/**
+ * @brief Start reading the I/Q sniffer.
+ * @param buffsize The buffer size of this reader in samples at the
+ *                 quadrature rate.
+ * @return Id of the reader, for peek_iq_sniffer_data() and stop_iq_sniffer().
+ *
+ * The sniffer taps the output of the down-converter, so it gets the channel
+ * of the demodulator before any filtering. It is only connected while it
+ * has readers and a demodulator is active. Each reader gets all samples.
+ */
+int receiver::start_iq_sniffer(int buffsize)
+{
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    const int id = iq_sniffer->add_reader(buffsize);
+
+    if (!d_iq_sniffer_active)
+    {
+        d_iq_sniffer_active = true;
+        if (d_demod != RX_DEMOD_OFF)
+        {
+            tb->lock();
+            tb->connect(ddc, 0, iq_sniffer, 0);
+            unlock_tb();
+        }
+    }
+
+    return id;
+}
+
+/**
+ * @brief Stop reading the I/Q sniffer.
+ * @param id The reader returned by start_iq_sniffer().
+ * @return STATUS_ERROR if the sniffer is not currently active.
+ */
+receiver::status receiver::stop_iq_sniffer(int id)
+{
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    if (!d_iq_sniffer_active)
+        return STATUS_ERROR;
 
-    tb->disconnect(sniffer_rr, 0, sniffer, 0);
-    tb->unlock();
-    d_sniffer_active = false;
+    iq_sniffer->remove_reader(id);
+    if (iq_sniffer->num_readers() > 0)
+        return STATUS_OK;
 
-    /* delete resampler */
-    sniffer_rr.reset();
+    d_iq_sniffer_active = false;
+    if (d_demod != RX_DEMOD_OFF)
+    {
+        tb->lock();
+        tb->disconnect(ddc, 0, iq_sniffer, 0);
+
+        // Temporary workaround for https://github.com/gnuradio/gnuradio/issues/5436
+        tb->disconnect(ddc, 0, rx, 0);
+        tb->connect(ddc, 0, rx, 0);
+        // End temporary workaround
+
+        unlock_tb();
+    }
 
     return STATUS_OK;
 }
 
-/** Get sniffer data. */
-void receiver::get_sniffer_data(float * outbuff, unsigned int &num)
+/**
+ * Get I/Q sniffer data at the quadrature rate, in the buffer of the sniffer.
+ * @param id The reader returned by start_iq_sniffer().
+ * @param data Set to the oldest sample.
+ * @param max The most samples wanted, the oldest are dropped if more are
+ *            available.
+ * @return The number of samples at data, valid until they are released
+ *         with release_iq_sniffer_data().
+ */
+unsigned int receiver::peek_iq_sniffer_data(int id, const gr_complex *&data, unsigned int max)
+{
+    return iq_sniffer->peek_samples(id, data, max);
+}
+
+void receiver::release_iq_sniffer_data(int id, unsigned int num)
+{
+    iq_sniffer->release_samples(id, num);
+}
+
+/** Samples the reader has missed because its buffer was full. */
+uint64_t receiver::get_iq_sniffer_overruns(int id)
 {
-    sniffer->get_samples(outbuff, num);
+    return iq_sniffer->overruns(id);
 }
 
 /** Convenience function to connect all blocks. */
@@ -1337,13 +2655,22 @@ void receiver::connect_all(rx_chain type)
 {
     gr::basic_block_sptr b;
 
-    // Setup source
-    b = src;
+    // Setup source, an sc16 playback only goes as it is into the decimator
+    b = full_rate_block();
+    if (is_sc16_input())
+        tb->connect(input_block(), 0, input_cvt, 0);
+
+    // Full rate spectrum, only while it has subscribers
+    if (d_fft_taps[FFT_TAP_INPUT])
+    {
+        tb->connect(b, 0, input_swap, 0);
+        tb->connect(input_swap, 0, input_fft, 0);
+    }
 
     // Pre-processing
     if (d_decim >= 2)
     {
-        tb->connect(b, 0, input_decim, 0);
+        tb->connect(input_block(), 0, input_decim, 0);
         b = input_decim;
     }
 
@@ -1352,18 +2679,24 @@ void receiver::connect_all(rx_chain type)
         // We record IQ with minimal pre-processing
         tb->connect(b, 0, iq_sink, 0);
     }
+    if (iq_capture)
+        tb->connect(b, 0, iq_capture, 0);
 
+    // I/Q swap and DC removal
     tb->connect(b, 0, iq_swap, 0);
     b = iq_swap;
 
-    if (d_dc_cancel)
-    {
-        tb->connect(b, 0, dc_corr, 0);
-        b = dc_corr;
-    }
+    // Network streams of the baseband
+    for (auto &s : d_iq_streams)
+        if (s.second.vfo < 0)
+            tb->connect(b, 0, s.second.sink, 0);
 
     // Visualization
     tb->connect(b, 0, iq_fft, 0);
+    if (d_zoom_fft)
+        tb->connect(b, 0, zoom_fft, 0);
+    if (!rds_scan->empty())
+        tb->connect(b, 0, rds_scan, 0);
 
     // RX demod chain
     switch (type)
@@ -1389,17 +2722,103 @@ void receiver::connect_all(rx_chain type)
     }
 
     // Audio path (if there is a receiver)
+    d_chan_fft = (type != RX_CHAIN_NONE) && d_fft_taps[FFT_TAP_CHANNEL];
     if (type != RX_CHAIN_NONE)
     {
         tb->connect(b, 0, ddc, 0);
         tb->connect(ddc, 0, rx, 0);
+        if (d_iq_sniffer_active)
+            tb->connect(ddc, 0, iq_sniffer, 0);
+        if (d_fft_taps[FFT_TAP_CHANNEL])
+            tb->connect(ddc, 0, chan_fft, 0);
         tb->connect(rx, 0, audio_fft, 0);
         tb->connect(rx, 0, audio_udp_sink, 0);
         tb->connect(rx, 1, audio_udp_sink, 1);
         tb->connect(rx, 0, audio_gain0, 0);
         tb->connect(rx, 1, audio_gain1, 0);
-        tb->connect(audio_gain0, 0, audio_snk, 0);
-        tb->connect(audio_gain1, 0, audio_snk, 1);
+    }
+
+    // Additional VFOs, their gain blocks only when they have an output
+    std::vector<gr::basic_block_sptr> mix0, mix1;
+    if (type != RX_CHAIN_NONE)
+    {
+        mix0.push_back(audio_gain0);
+        mix1.push_back(audio_gain1);
+    }
+    // With the channelizer each VFO is fed from the channel it is in
+    std::map<int, int> channel_outputs;
+    if (channelizer && !d_vfos.empty())
+    {
+        std::vector<int> channels;
+        for (auto &v : d_vfos)
+        {
+            if (channel_outputs.count(v.second.channel) == 0)
+            {
+                channel_outputs[v.second.channel] = channels.size();
+                channels.push_back(v.second.channel);
+            }
+        }
+        channelizer->set_outputs(channels);
+        tb->connect(b, 0, channelizer, 0);
+    }
+    for (auto &v : d_vfos)
+    {
+        vfo_chain &vfo = v.second;
+        if (channelizer)
+            tb->connect(channelizer, channel_outputs[vfo.channel], vfo.ddc, 0);
+        else
+            tb->connect(b, 0, vfo.ddc, 0);
+        tb->connect(vfo.ddc, 0, vfo.rx, 0);
+        for (auto &s : d_iq_streams)
+            if (s.second.vfo == v.first)
+                tb->connect(vfo.ddc, 0, s.second.sink, 0);
+        tb->connect(vfo.rx, 0, vfo.udp_sink, 0);
+        tb->connect(vfo.rx, 1, vfo.udp_sink, 1);
+        if (vfo.muted && !vfo.wav_sink && !vfo.log_sink)
+            continue;
+
+        tb->connect(vfo.rx, 0, vfo.gain0, 0);
+        tb->connect(vfo.rx, 1, vfo.gain1, 0);
+        if (vfo.wav_sink)
+        {
+            tb->connect(vfo.gain0, 0, vfo.wav_sink, 0);
+            tb->connect(vfo.gain1, 0, vfo.wav_sink, 1);
+        }
+        if (vfo.log_sink)
+            tb->connect(vfo.gain0, 0, vfo.log_sink, 0);
+        if (!vfo.muted)
+        {
+            mix0.push_back(vfo.gain0);
+            mix1.push_back(vfo.gain1);
+        }
+    }
+
+    // Audio output, summed when more than one channel is heard
+    audio_mix0.reset();
+    audio_mix1.reset();
+    audio_out0.reset();
+    audio_out1.reset();
+    if (mix0.size() == 1)
+    {
+        audio_out0 = mix0[0];
+        audio_out1 = mix1[0];
+    }
+    else if (mix0.size() > 1)
+    {
+        audio_mix0 = gr::blocks::add_ff::make();
+        audio_mix1 = gr::blocks::add_ff::make();
+        for (size_t i = 0; i < mix0.size(); i++)
+        {
+            tb->connect(mix0[i], 0, audio_mix0, i);
+            tb->connect(mix1[i], 0, audio_mix1, i);
+        }
+        audio_out0 = audio_mix0;
+        audio_out1 = audio_mix1;
+    }
+    if (audio_out0)
+    {
+        tb->connect(audio_out0, 0, audio_snk, 0);
+        tb->connect(audio_out1, 0, audio_snk, 1);
     }
 
     // Recorders and sniffers
@@ -1411,11 +2830,78 @@ void receiver::connect_all(rx_chain type)
         tb->connect(wav_gain1, 0, wav_sink, 1);
     }
 
-    if (d_sniffer_active)
+    connect_decoders(type != RX_CHAIN_NONE);
+
+    apply_buffers();
+    apply_cpu_affinity();
+}
+
+/*
+ * Connect the decoders, through one resampler per channel and rate. The
+ * rates below the audio rate form a chain, each fed by the next higher
+ * one, so a lower rate is made from fewer samples. Decoders at the audio
+ * rate take the audio as it is. Resamplers are kept across reconnects
+ * while their input rate stays, and dropped when no decoder uses them.
+ */
+void receiver::connect_decoders(bool main_channel)
+{
+    std::map<int, std::set<unsigned int>> rates;
+    std::map<std::pair<int, unsigned int>, audio_resampler> resamplers;
+    const unsigned int audio_rate = (unsigned int) d_audio_rate;
+
+    for (auto &d : d_decoders)
+    {
+        const decoder_chain &dec = d.second;
+        if (dec.vfo < 0 ? !main_channel : d_vfos.count(dec.vfo) == 0)
+            continue;
+        rates[dec.vfo].insert(dec.rate);
+    }
+
+    for (auto &channel : rates)
     {
-        tb->connect(rx, 0, sniffer_rr, 0);
-        tb->connect(sniffer_rr, 0, sniffer, 0);
+        gr::basic_block_sptr audio = channel.first < 0 ? rx : d_vfos[channel.first].rx;
+        gr::basic_block_sptr source = audio;
+        double source_rate = audio_rate;
+
+        for (auto rate = channel.second.rbegin(); rate != channel.second.rend(); ++rate)
+        {
+            if (*rate == audio_rate)
+                continue;
+
+            // Up from the audio, down from the next higher rate
+            const double from = *rate > audio_rate ? (double) audio_rate : source_rate;
+            const auto key = std::make_pair(channel.first, *rate);
+            auto old = d_audio_rr.find(key);
+            audio_resampler node;
+            if (old != d_audio_rr.end() && old->second.source_rate == from)
+                node = old->second;
+            else
+                node = {from, make_resampler_ff((float)(*rate / from))};
+
+            tb->connect(*rate > audio_rate ? audio : source, 0, node.rr, 0);
+            resamplers[key] = node;
+            if (*rate < audio_rate)
+            {
+                source = node.rr;
+                source_rate = *rate;
+            }
+        }
+
+        for (auto &d : d_decoders)
+        {
+            decoder_chain &dec = d.second;
+            if (dec.vfo != channel.first)
+                continue;
+
+            if (dec.rate == audio_rate)
+                tb->connect(audio, 0, dec.sink, 0);
+            else
+                tb->connect(resamplers[std::make_pair(dec.vfo, dec.rate)].rr, 0, dec.sink, 0);
+            tb->msg_connect(dec.sink, "out", dec.store, "store");
+        }
     }
+
+    d_audio_rr.swap(resamplers);
 }
 
 void receiver::get_rds_data(std::string &outbuff, int &num)
@@ -1461,12 +2947,836 @@ void receiver::reset_rds_parser(void)
     rx->reset_rds_parser();
 }
 
-std::string receiver::escape_filename(std::string filename)
+/**
+ * @brief Decode the RDS of FM stations in the input, for band surveys.
+ * @param offsets The stations by offset from the RF frequency [Hz], none
+ *                to stop.
+ *
+ * Each station only gets the PI code and name decoded, at a fraction of the
+ * cost of the WFM demodulator, and while the main channel is on anything.
+ */
+void receiver::set_rds_scan(const std::vector<double> &offsets)
 {
-    std::stringstream ss1;
-    std::stringstream ss2;
+    const bool was_empty = rds_scan->empty();
 
-    ss1 << std::quoted(filename, '\'', '\\');
-    ss2 << std::quoted(ss1.str(), '\'', '\\');
-    return ss2.str();
+    rds_scan->set_stations(offsets);
+    if (was_empty != rds_scan->empty())
+        reconnect_all();
+}
+
+std::vector<rds_scanner_cc::station_info> receiver::get_rds_scan(void)
+{
+    return rds_scan->get_stations();
+}
+
+/** Receiver chain of a demodulator and the demodulator type within that chain. */
+receiver::rx_chain receiver::demod_chain(rx_demod demod, int &chain_demod)
+{
+    switch (demod)
+    {
+    case RX_DEMOD_NONE:
+        chain_demod = nbrx::NBRX_DEMOD_NONE;
+        return RX_CHAIN_NBRX;
+    case RX_DEMOD_AM:
+        chain_demod = nbrx::NBRX_DEMOD_AM;
+        return RX_CHAIN_NBRX;
+    case RX_DEMOD_AMSYNC:
+        chain_demod = nbrx::NBRX_DEMOD_AMSYNC;
+        return RX_CHAIN_NBRX;
+    case RX_DEMOD_NFM:
+        chain_demod = nbrx::NBRX_DEMOD_FM;
+        return RX_CHAIN_NBRX;
+    case RX_DEMOD_SSB:
+        chain_demod = nbrx::NBRX_DEMOD_SSB;
+        return RX_CHAIN_NBRX;
+    case RX_DEMOD_WFM_M:
+        chain_demod = wfmrx::WFMRX_DEMOD_MONO;
+        return RX_CHAIN_WFMRX;
+    case RX_DEMOD_WFM_S:
+        chain_demod = wfmrx::WFMRX_DEMOD_STEREO;
+        return RX_CHAIN_WFMRX;
+    case RX_DEMOD_WFM_S_OIRT:
+        chain_demod = wfmrx::WFMRX_DEMOD_STEREO_UKW;
+        return RX_CHAIN_WFMRX;
+    default:
+        chain_demod = 0;
+        return RX_CHAIN_NONE;
+    }
+}
+
+/** Connect the flow graph again after VFOs or their outputs have changed. */
+void receiver::reconnect_all(void)
+{
+    std::lock_guard<std::recursive_mutex> config(d_config_mutex);
+    int chain_demod;
+
+    // tb->lock() seems to hang occasionally
+    if (d_running)
+    {
+        tb->stop();
+        tb->wait();
+    }
+
+    tb->disconnect_all();
+    connect_all(demod_chain(d_demod, chain_demod));
+
+    if (d_running)
+        start_tb();
+}
+
+/**
+ * @brief Add a VFO.
+ * @param offset_hz Offset from the RF frequency, as the filter offset.
+ * @param demod Demodulator of the VFO.
+ * @return Id of the new VFO, or -1 if the demodulator is not valid.
+ *
+ * A VFO is a down-converter and demodulator of its own, fed with the same
+ * samples as the main demodulator. Its audio is mixed into the audio output
+ * and can be streamed over UDP and recorded on its own. The filter is the
+ * default of the demodulator until set_vfo_filter() is called.
+ */
+int receiver::add_vfo(double offset_hz, rx_demod demod)
+{
+    int chain_demod;
+    rx_chain chain = demod_chain(demod, chain_demod);
+
+    if (chain == RX_CHAIN_NONE)
+        return -1;
+
+    vfo_chain vfo;
+    vfo.offset = offset_hz;
+    vfo.demod = demod;
+    vfo.muted = false;
+    vfo.channel = -1;
+    vfo.ddc_rate = d_decim_rate;
+    vfo.ddc_decim = d_ddc_decim;
+    vfo.ddc = make_downconverter_cc(d_ddc_decim, offset_hz, d_decim_rate);
+    if (chain == RX_CHAIN_WFMRX)
+        vfo.rx = make_wfmrx(d_quad_rate, d_audio_rate);
+    else
+        vfo.rx = make_nbrx(d_quad_rate, d_audio_rate);
+    vfo.rx->set_demod(chain_demod);
+    update_vfo_chain(vfo);
+    vfo.gain0 = gr::blocks::multiply_const_ff::make(audio_gain0->k());
+    vfo.gain1 = gr::blocks::multiply_const_ff::make(audio_gain1->k());
+    vfo.udp_sink = make_udp_sink_f(d_audio_rate);
+
+    int id = ++d_vfo_id;
+    d_vfos[id] = vfo;
+    reconnect_all();
+
+    return id;
+}
+
+receiver::status receiver::remove_vfo(int id)
+{
+    auto it = d_vfos.find(id);
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    it->second.udp_sink->stop_streaming();
+    if (it->second.wav_sink)
+        it->second.wav_sink->close();
+    if (it->second.log_sink)
+        it->second.log_sink->close();
+    d_vfos.erase(it);
+    for (auto d = d_decoders.begin(); d != d_decoders.end();)
+        d = d->second.vfo == id ? d_decoders.erase(d) : std::next(d);
+    for (auto s = d_iq_streams.begin(); s != d_iq_streams.end();)
+        s = s->second.vfo == id ? d_iq_streams.erase(s) : std::next(s);
+    reconnect_all();
+
+    return STATUS_OK;
+}
+
+std::vector<int> receiver::get_vfo_ids(void) const
+{
+    std::vector<int> ids;
+    for (auto &v : d_vfos)
+        ids.push_back(v.first);
+    return ids;
+}
+
+receiver::status receiver::set_vfo_offset(int id, double offset_hz)
+{
+    auto it = d_vfos.find(id);
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    it->second.offset = offset_hz;
+    if (update_vfo_chain(it->second))
+        reconnect_all();
+    update_iq_streams();
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Move several VFOs at once.
+ *
+ * The flow graph is rebuilt at most once, when some of them move to
+ * another channel of the channelizer. Unknown ids are skipped.
+ */
+void receiver::set_vfo_offsets(const std::map<int, double> &offsets)
+{
+    bool moved = false;
+
+    for (auto &o : offsets)
+    {
+        auto it = d_vfos.find(o.first);
+        if (it == d_vfos.end())
+            continue;
+
+        it->second.offset = o.second;
+        moved |= update_vfo_chain(it->second);
+    }
+    if (moved)
+        reconnect_all();
+    update_iq_streams();
+}
+
+double receiver::get_vfo_offset(int id) const
+{
+    auto it = d_vfos.find(id);
+    return it == d_vfos.end() ? 0.0 : it->second.offset;
+}
+
+/** Set the demodulator of a VFO, the flow graph is only rebuilt if the chain changes. */
+receiver::status receiver::set_vfo_demod(int id, rx_demod demod)
+{
+    int chain_demod;
+    rx_chain chain = demod_chain(demod, chain_demod);
+
+    auto it = d_vfos.find(id);
+    if (it == d_vfos.end() || chain == RX_CHAIN_NONE)
+        return STATUS_ERROR;
+
+    vfo_chain &vfo = it->second;
+    int old_demod;
+    if (demod_chain(vfo.demod, old_demod) == chain)
+    {
+        vfo.rx->set_demod(chain_demod);
+    }
+    else
+    {
+        double quad_rate = vfo.ddc_rate / vfo.ddc_decim;
+        if (chain == RX_CHAIN_WFMRX)
+            vfo.rx = make_wfmrx(quad_rate, d_audio_rate);
+        else
+            vfo.rx = make_nbrx(quad_rate, d_audio_rate);
+        vfo.rx->set_demod(chain_demod);
+        reconnect_all();
+    }
+    vfo.demod = demod;
+
+    return STATUS_OK;
+}
+
+receiver::status receiver::set_vfo_filter(int id, double low, double high, filter_shape shape)
+{
+    auto it = d_vfos.find(id);
+    if (it == d_vfos.end() || (low >= high) || (std::abs(high-low) < RX_FILTER_MIN_WIDTH))
+        return STATUS_ERROR;
+
+    it->second.rx->set_filter(low, high, transition_width(low, high, shape));
+
+    return STATUS_OK;
+}
+
+receiver::status receiver::set_vfo_sql_level(int id, double level_db)
+{
+    auto it = d_vfos.find(id);
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    if (it->second.rx->has_sql())
+        it->second.rx->set_sql_level(level_db);
+
+    return STATUS_OK;
+}
+
+receiver::status receiver::set_vfo_af_gain(int id, float gain_db)
+{
+    auto it = d_vfos.find(id);
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    float k = powf(10.0f, gain_db / 20.0f);
+    it->second.gain0->set_k(k);
+    it->second.gain1->set_k(k);
+
+    return STATUS_OK;
+}
+
+/** Leave a VFO out of the audio output or mix it in again. */
+receiver::status receiver::set_vfo_audio_muted(int id, bool muted)
+{
+    auto it = d_vfos.find(id);
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    if (it->second.muted != muted)
+    {
+        it->second.muted = muted;
+        reconnect_all();
+    }
+
+    return STATUS_OK;
+}
+
+float receiver::get_vfo_signal_pwr(int id) const
+{
+    auto it = d_vfos.find(id);
+    return it == d_vfos.end() ? -200.0f : it->second.rx->get_signal_level();
+}
+
+/** Start UDP streaming of a VFO, channel is the SSRC of its RTP packets. */
+receiver::status receiver::start_vfo_udp_streaming(int id, const std::string host, int port, bool stereo,
+                                                   udp_stream_format format, uint32_t channel)
+{
+    auto it = d_vfos.find(id);
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    it->second.udp_sink->start_streaming(host, port, stereo, format, channel);
+    return STATUS_OK;
+}
+
+receiver::status receiver::stop_vfo_udp_streaming(int id)
+{
+    auto it = d_vfos.find(id);
+    if (it == d_vfos.end())
+        return STATUS_ERROR;
+
+    it->second.udp_sink->stop_streaming();
+    return STATUS_OK;
+}
+
+/**
+ * @brief Start recording the audio of a VFO.
+ *
+ * The audio is recorded after the gain of the VFO, see set_vfo_af_gain().
+ */
+receiver::status receiver::start_vfo_audio_recording(int id, const std::string filename)
+{
+    auto it = d_vfos.find(id);
+    if (it == d_vfos.end() || it->second.wav_sink)
+        return STATUS_ERROR;
+
+    try {
+#if GNURADIO_VERSION < 0x030900
+        it->second.wav_sink = gr::blocks::wavfile_sink::make(filename.c_str(), 2,
+                                                             (unsigned int) d_audio_rate,
+                                                             16);
+#else
+        it->second.wav_sink = gr::blocks::wavfile_sink::make(filename.c_str(), 2,
+                                                             (unsigned int) d_audio_rate,
+                                                             gr::blocks::FORMAT_WAV,
+                                                             gr::blocks::FORMAT_PCM_16);
+#endif
+    }
+    catch (std::runtime_error &e) {
+        std::cout << "Error opening " << filename << ": " << e.what() << std::endl;
+        return STATUS_ERROR;
+    }
+    reconnect_all();
+
+    std::cout << "Recording VFO " << id << " to " << filename << std::endl;
+
+    return STATUS_OK;
+}
+
+/**
+ * @brief Record the audio of a VFO while its squelch is open.
+ * @param prefix Path and start of the file names, see audio_log_sink.
+ *
+ * Each transmission goes to a file of its own, encoded off the scheduler
+ * threads by encoders shared with the other VFOs. Only the left channel
+ * is recorded.
+ */
+receiver::status receiver::start_vfo_audio_log(int id, const std::string prefix)
+{
+    auto it = d_vfos.find(id);
+    if (it == d_vfos.end() || it->second.wav_sink || it->second.log_sink)
+        return STATUS_ERROR;
+
+    if (!d_audio_log)
+        d_audio_log = std::make_shared<audio_log_encoder>(AUDIO_LOG_THREADS);
+    it->second.log_sink = make_audio_log_sink(d_audio_log, prefix, d_audio_rate);
+    reconnect_all();
+
+    std::cout << "Logging transmissions of VFO " << id << " to " << prefix << std::endl;
+
+    return STATUS_OK;
+}
+
+/** Stop the recording or the transmission log of a VFO. */
+receiver::status receiver::stop_vfo_audio_recording(int id)
+{
+    auto it = d_vfos.find(id);
+    if (it == d_vfos.end() || (!it->second.wav_sink && !it->second.log_sink))
+        return STATUS_ERROR;
+
+    if (it->second.wav_sink)
+        it->second.wav_sink->close();
+    if (it->second.log_sink)
+        it->second.log_sink->close();
+    it->second.wav_sink.reset();
+    it->second.log_sink.reset();
+    reconnect_all();
+
+    return STATUS_OK;
+}
+
+std::string receiver::escape_filename(std::string filename)
+{
+    std::stringstream ss1;
+    std::stringstream ss2;
+
+    ss1 << std::quoted(filename, '\'', '\\');
+    ss2 << std::quoted(ss1.str(), '\'', '\\');
+    return ss2.str();
+}
+
+/**
+ * @brief Feed the VFOs from a polyphase channelizer.
+ * @param channels Number of channels the input is split into, even, or 0
+ *                 to feed each VFO with the whole input.
+ *
+ * Without the channelizer every VFO down-converts the whole input, so the
+ * cost grows with the number of VFOs times the input rate. The channelizer
+ * splits the input once, at a cost that does not depend on the number of
+ * VFOs, and each VFO only tunes within its channel at the channel rate.
+ * A VFO must then fit within a channel: its passband should stay below a
+ * fifth of the channel spacing, input rate / channels, on either side.
+ */
+receiver::status receiver::set_vfo_channels(unsigned int channels)
+{
+    if (channels == 1 || channels % 2 != 0)
+        return STATUS_ERROR;
+    if (channels == get_vfo_channels())
+        return STATUS_OK;
+
+    channelizer.reset();
+    if (channels > 0)
+        channelizer = make_channelizer_cc(channels, d_decim_rate);
+    update_vfo_chains();
+    update_iq_streams();
+    reconnect_all();
+
+    return STATUS_OK;
+}
+
+unsigned int receiver::get_vfo_channels(void) const
+{
+    return channelizer ? channelizer->channels() : 0;
+}
+
+/**
+ * @brief Set the rates and the offset of the down-converter of a VFO.
+ * @return True if the VFO moved to another channel and the flow graph has
+ *         to be connected again.
+ */
+bool receiver::update_vfo_chain(vfo_chain &vfo)
+{
+    int channel = -1;
+    double rate = d_decim_rate;
+    double center = vfo.offset;
+
+    if (channelizer)
+    {
+        channel = channelizer->nearest_channel(vfo.offset);
+        rate = channelizer->channel_rate();
+        center = vfo.offset - channelizer->channel_freq(channel);
+    }
+
+    unsigned int decim = std::max(1, (int)(rate / TARGET_QUAD_RATE));
+    if (rate != vfo.ddc_rate || decim != vfo.ddc_decim)
+    {
+        vfo.ddc->set_decim_and_samp_rate(decim, rate);
+        vfo.rx->set_quad_rate(rate / decim);
+        vfo.ddc_rate = rate;
+        vfo.ddc_decim = decim;
+    }
+    vfo.ddc->set_center_freq(center);
+
+    bool moved = (channel != vfo.channel);
+    vfo.channel = channel;
+    return moved;
+}
+
+bool receiver::update_vfo_chains(void)
+{
+    bool moved = false;
+
+    if (channelizer)
+        channelizer->set_samp_rate(d_decim_rate);
+    for (auto &v : d_vfos)
+        moved |= update_vfo_chain(v.second);
+
+    return moved;
+}
+
+/**
+ * @brief Set the buffers of all stages from a profile.
+ *
+ * Low latency keeps the chunks on the channel and audio path small, so the
+ * audio is not held back behind large blocks of samples. High throughput
+ * gives the input stage deep buffers, so slow readers such as the FFTs do
+ * not hold up the source at high sample rates.
+ */
+void receiver::set_buffer_profile(buffer_profile profile)
+{
+    static const stage_buffers profiles[3][BUFFER_STAGE_NUM] = {
+        { {0, 0},    {0, 0},    {0, 0} },       // default
+        { {0, 0},    {4096, 0}, {512, 0} },     // low latency
+        { {0, 1 << 20}, {0, 0}, {0, 0} },       // high throughput
+    };
+
+    if (profile < BUFFER_PROFILE_DEFAULT || profile > BUFFER_PROFILE_HIGH_THROUGHPUT)
+        return;
+
+    for (int i = 0; i < BUFFER_STAGE_NUM; i++)
+        d_buffers[i] = profiles[profile][i];
+    apply_buffers();
+    if (d_running)
+        reconnect_all();
+}
+
+/**
+ * @brief Set the buffers of one stage.
+ *
+ * GNU Radio allocates the buffers when the flow graph starts, so a running
+ * receiver is restarted.
+ */
+void receiver::set_stage_buffers(buffer_stage stage, const stage_buffers &buffers)
+{
+    if (stage < BUFFER_STAGE_INPUT || stage >= BUFFER_STAGE_NUM)
+        return;
+
+    d_buffers[stage] = stage_buffers{std::max(0, buffers.max_noutput_items),
+                                     std::max(0, buffers.min_output_buffer)};
+    apply_buffers();
+    if (d_running)
+        reconnect_all();
+}
+
+receiver::stage_buffers receiver::get_stage_buffers(buffer_stage stage) const
+{
+    if (stage < BUFFER_STAGE_INPUT || stage >= BUFFER_STAGE_NUM)
+        return stage_buffers{0, 0};
+
+    return d_buffers[stage];
+}
+
+/*
+ * Only single blocks have max_noutput_items, hierarchical blocks pass the
+ * output buffer size on to the blocks at their outputs.
+ */
+static void set_block_buffers(const gr::basic_block_sptr &block,
+                              const receiver::stage_buffers &buffers)
+{
+    if (!block)
+        return;
+
+    if (auto *b = dynamic_cast<gr::block *>(block.get()))
+    {
+        if (buffers.max_noutput_items > 0)
+            b->set_max_noutput_items(buffers.max_noutput_items);
+        else
+            b->unset_max_noutput_items();
+        b->set_min_output_buffer(buffers.min_output_buffer);
+    }
+    else if (auto *h = dynamic_cast<gr::hier_block2 *>(block.get()))
+    {
+        h->set_min_output_buffer(buffers.min_output_buffer);
+    }
+}
+
+/** Give the blocks of each stage the buffer settings of the stage. */
+void receiver::apply_buffers(void)
+{
+    const stage_buffers &input = d_buffers[BUFFER_STAGE_INPUT];
+    set_block_buffers(src, input);
+    set_block_buffers(input_decim, input);
+    set_block_buffers(iq_swap, input);
+
+    const stage_buffers &channel = d_buffers[BUFFER_STAGE_CHANNEL];
+    set_block_buffers(ddc, channel);
+    set_block_buffers(rx, channel);
+    set_block_buffers(channelizer, channel);
+
+    const stage_buffers &audio = d_buffers[BUFFER_STAGE_AUDIO];
+    set_block_buffers(audio_gain0, audio);
+    set_block_buffers(audio_gain1, audio);
+    set_block_buffers(audio_mix0, audio);
+    set_block_buffers(audio_mix1, audio);
+
+    for (auto &v : d_vfos)
+    {
+        set_block_buffers(v.second.ddc, channel);
+        set_block_buffers(v.second.rx, channel);
+        set_block_buffers(v.second.gain0, audio);
+        set_block_buffers(v.second.gain1, audio);
+    }
+}
+
+/**
+ * @brief Pin a group of blocks to some cores.
+ * @param group The group of blocks.
+ * @param cores Core numbers, or empty to let the blocks run on any core.
+ */
+void receiver::set_cpu_affinity(cpu_group group, const std::vector<int> &cores)
+{
+    if (group < CPU_GROUP_SOURCE || group >= CPU_GROUP_NUM)
+        return;
+
+    d_affinity[group] = cores;
+    apply_cpu_affinity();
+}
+
+std::vector<int> receiver::get_cpu_affinity(cpu_group group) const
+{
+    if (group < CPU_GROUP_SOURCE || group >= CPU_GROUP_NUM)
+        return std::vector<int>();
+
+    return d_affinity[group];
+}
+
+/**
+ * @brief Cores of a group in the automatic layout.
+ * @param group The group of blocks.
+ * @param num_cores Number of cores of the machine.
+ *
+ * Core 0 is left to the user interface and the system. With fewer than four
+ * cores nothing is pinned, with fewer than eight the source and decimator
+ * share core 1, and from eight on each group has two cores of its own
+ * except the source.
+ */
+std::vector<int> receiver::auto_cpu_affinity(cpu_group group, unsigned int num_cores)
+{
+    if (num_cores < 4)
+        return std::vector<int>();
+
+    if (num_cores < 8)
+    {
+        switch (group)
+        {
+        case CPU_GROUP_SOURCE:
+        case CPU_GROUP_DECIM:
+            return {1};
+        case CPU_GROUP_DEMOD:
+            return {2};
+        case CPU_GROUP_FFT:
+            return {3};
+        default:
+            return std::vector<int>();
+        }
+    }
+
+    switch (group)
+    {
+    case CPU_GROUP_SOURCE:
+        return {1};
+    case CPU_GROUP_DECIM:
+        return {2, 3};
+    case CPU_GROUP_DEMOD:
+        return {4, 5};
+    case CPU_GROUP_FFT:
+        return {6, 7};
+    default:
+        return std::vector<int>();
+    }
+}
+
+/**
+ * @brief Run the DSP threads at real-time priority.
+ *
+ * Takes effect when the flow graph is started or reconfigured the next
+ * time. Needs the right to use real-time scheduling, e.g. rtprio in
+ * limits.conf on Linux; without it the threads keep the normal priority.
+ */
+void receiver::set_realtime_priority(bool enabled)
+{
+    d_realtime = enabled;
+}
+
+/**
+ * @brief Collect the GNU Radio performance counters of the blocks.
+ *
+ * The block executors read the preference when they are created, so a
+ * running receiver is restarted. GNU Radio must be built with the
+ * performance counters, otherwise they stay at zero.
+ */
+void receiver::set_perf_counters(bool enabled)
+{
+    if (enabled == d_perf)
+        return;
+
+    d_perf = enabled;
+    d_perf_last.clear();
+    d_perf_time = std::chrono::steady_clock::now();
+    gr::prefs::singleton()->set_bool("PerfCounters", "on", enabled);
+    if (d_running)
+        reconnect_all();
+}
+
+static float max_fill(const std::vector<float> &fill)
+{
+    if (fill.empty())
+        return -1.0f;
+
+    return *std::max_element(fill.begin(), fill.end());
+}
+
+/**
+ * @brief Performance counters of the blocks of the flattened flow graph.
+ *
+ * The blocks inside the hierarchical blocks are found through the DOT
+ * graph of the flattened top block, which names them by their alias, and
+ * the block registry. The CPU share is the work time since the previous
+ * call, so the function should be called at a steady interval. Empty
+ * while the counters are off.
+ */
+std::vector<receiver::block_perf> receiver::get_block_perf(void)
+{
+    std::vector<block_perf> blocks;
+
+    if (!d_perf)
+        return blocks;
+
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - d_perf_time).count();
+    double tps = (double)gr::high_res_timer_tps();
+    d_perf_time = now;
+
+    // Nodes are lines of <unique id> [ label="<alias>" ], edges have an arrow
+    std::istringstream graph(gr::dot_graph(tb));
+    std::string line;
+    while (std::getline(graph, line))
+    {
+        size_t start = line.find("label=\"");
+        if (start == std::string::npos || line.find("->") != std::string::npos)
+            continue;
+        start += 7;
+        size_t end = line.find('"', start);
+        if (end == std::string::npos)
+            continue;
+
+        gr::basic_block_sptr found;
+        try
+        {
+            found = gr::global_block_registry.block_lookup(pmt::intern(line.substr(start, end - start)));
+        }
+        catch (std::exception &)
+        {
+            continue;
+        }
+        auto *block = dynamic_cast<gr::block *>(found.get());
+        if (!block || !block->detail())
+            continue;
+
+        perf_last &last = d_perf_last[block->unique_id()];
+        float total = block->pc_work_time_total();
+        // The counters start from zero when the flow graph is restarted
+        float work = total >= last.work_total ? total - last.work_total : total;
+        last.work_total = total;
+
+        block_perf perf;
+        perf.name = block->alias();
+        perf.cpu = elapsed > 0.0 ? (float)(100.0 * work / tps / elapsed) : 0.0f;
+        perf.work_time = (float)(1e6 * block->pc_work_time_avg() / tps);
+        perf.input_fill = max_fill(block->pc_input_buffers_full_avg());
+        perf.output_fill = max_fill(block->pc_output_buffers_full_avg());
+        if (block->detail()->noutputs() > 0)
+            perf.nproduced = block->nitems_written(0);
+        else if (block->detail()->ninputs() > 0)
+            perf.nproduced = block->nitems_read(0);
+        else
+            perf.nproduced = 0;
+        if (max_fill(block->pc_output_buffers_full()) >= PERF_BUFFER_FULL)
+            last.full_events++;
+        perf.full_events = last.full_events;
+        blocks.push_back(perf);
+    }
+
+    return blocks;
+}
+
+static void set_block_affinity(const gr::basic_block_sptr &block, const std::vector<int> &cores)
+{
+    if (!block)
+        return;
+
+    if (cores.empty())
+        block->unset_processor_affinity();
+    else
+        block->set_processor_affinity(cores);
+}
+
+/** Give the blocks of each group the cores of the group. */
+void receiver::apply_cpu_affinity(void)
+{
+    const std::vector<int> &source = d_affinity[CPU_GROUP_SOURCE];
+    set_block_affinity(src, source);
+    set_block_affinity(iq_swap, source);
+
+    set_block_affinity(input_decim, d_affinity[CPU_GROUP_DECIM]);
+
+    const std::vector<int> &fft = d_affinity[CPU_GROUP_FFT];
+    set_block_affinity(iq_fft, fft);
+    set_block_affinity(zoom_fft, fft);
+    set_block_affinity(input_swap, fft);
+    set_block_affinity(input_fft, fft);
+    set_block_affinity(chan_fft, fft);
+
+    const std::vector<int> &demod = d_affinity[CPU_GROUP_DEMOD];
+    set_block_affinity(ddc, demod);
+    set_block_affinity(rx, demod);
+    set_block_affinity(channelizer, demod);
+    set_block_affinity(audio_fft, demod);
+    set_block_affinity(audio_gain0, demod);
+    set_block_affinity(audio_gain1, demod);
+    set_block_affinity(audio_mix0, demod);
+    set_block_affinity(audio_mix1, demod);
+    set_block_affinity(audio_snk, demod);
+    for (auto &v : d_vfos)
+    {
+        set_block_affinity(v.second.ddc, demod);
+        set_block_affinity(v.second.rx, demod);
+        set_block_affinity(v.second.gain0, demod);
+        set_block_affinity(v.second.gain1, demod);
+    }
+}
+
+void receiver::start_tb(void)
+{
+    run_dsp_threads([this]() { tb->start(); });
+}
+
+void receiver::unlock_tb(void)
+{
+    run_dsp_threads([this]() { tb->unlock(); });
+}
+
+/*
+ * The scheduler creates the block threads in the thread that starts or
+ * unlocks the top block and they inherit its priority. For real-time
+ * priority that is done from a short lived thread, so the user interface
+ * keeps the normal priority.
+ */
+void receiver::run_dsp_threads(const std::function<void()> &fn)
+{
+    if (!d_realtime)
+    {
+        fn();
+        return;
+    }
+
+    std::thread starter([&fn]() {
+        if (gr::enable_realtime_scheduling() != gr::RT_OK)
+            std::cerr << "Failed to enable real-time priority for the DSP threads" << std::endl;
+        fn();
+    });
+    starter.join();
 }
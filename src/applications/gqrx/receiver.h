@@ -23,15 +23,22 @@
 #ifndef RECEIVER_H
 #define RECEIVER_H
 
-#include <gnuradio/blocks/file_sink.h>
+#include <gnuradio/blocks/add_blk.h>
 #include <gnuradio/blocks/multiply_const.h>
 #include <gnuradio/blocks/null_sink.h>
 #include <gnuradio/blocks/wavfile_sink.h>
 #include <gnuradio/blocks/wavfile_source.h>
 #include <gnuradio/top_block.h>
 #include <osmosdr/source.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
+#include "dsp/channelizer.h"
 #include "dsp/correct_iq_cc.h"
 #include "dsp/downconverter.h"
 #include "dsp/filter/fir_decim.h"
@@ -42,8 +49,18 @@
 #include "dsp/rx_demod_fm.h"
 #include "dsp/rx_demod_am.h"
 #include "dsp/rx_fft.h"
-#include "dsp/sniffer_f.h"
+#include "dsp/rds_scanner.h"
+#include "dsp/zoom_fft.h"
+#include "dsp/data_decoder.h"
+#include "dsp/iq_sniffer_cc.h"
 #include "dsp/resampler_xx.h"
+#include "dsp/test_signal.h"
+#include "interfaces/audio_log_sink.h"
+#include "interfaces/iq_capture_sink.h"
+#include "interfaces/iq_file_sink.h"
+#include "interfaces/iq_file_source.h"
+#include "interfaces/iq_stream_sink.h"
+#include "interfaces/stitched_source.h"
 #include "interfaces/udp_sink_f.h"
 #include "receivers/receiver_base.h"
 
@@ -59,6 +76,27 @@
  * @defgroup DSP Digital signal processing library based on GNU Radio
  */
 
+/**
+ * @brief Baseband FFT frame shared by all spectrum consumers.
+ *
+ * Frames are immutable once published; consumers keep a reference for as
+ * long as they need the data. The receiver reuses a frame once the last
+ * reference is dropped, so consumers never keep a pointer into data
+ * without a reference to the frame.
+ */
+struct iq_fft_frame
+{
+    std::vector<float> data;    /*!< Shifted power spectrum, iq_fft_size() bins or fewer. */
+    unsigned int fft_size;      /*!< Bins of the FFT, more than data.size() if decimated. */
+    double      center_freq;    /*!< RF frequency of the center bin. */
+    double      sample_rate;    /*!< Bandwidth covered by the data. */
+    uint64_t    seq;            /*!< Frame number, increases by one per frame. */
+    uint64_t    sample_index;   /*!< Index of the sample after the frame at the FFT input rate. */
+    std::chrono::system_clock::time_point timestamp; /*!< Wall-clock time of sample_index. */
+};
+
+typedef std::shared_ptr<const iq_fft_frame> iq_fft_frame_sptr;
+
 /**
  * @brief Top-level receiver class.
  * @ingroup DSP
@@ -105,6 +143,55 @@ public:
         FILTER_SHAPE_SHARP = 2   /*!< Sharp: Transition band is TBD of width. */
     };
 
+    /** Stages of the flow graph with buffer settings of their own. */
+    enum buffer_stage {
+        BUFFER_STAGE_INPUT   = 0,  /*!< Source to DC removal, feeds the FFTs. */
+        BUFFER_STAGE_CHANNEL = 1,  /*!< Down-converters and demodulators. */
+        BUFFER_STAGE_AUDIO   = 2,  /*!< Audio gain and mixing. */
+        BUFFER_STAGE_NUM     = 3   /*!< Included for convenience. */
+    };
+
+    /** Presets of the buffer settings of all stages. */
+    enum buffer_profile {
+        BUFFER_PROFILE_DEFAULT         = 0,  /*!< GNU Radio defaults. */
+        BUFFER_PROFILE_LOW_LATENCY     = 1,  /*!< Small chunks on the audio path. */
+        BUFFER_PROFILE_HIGH_THROUGHPUT = 2   /*!< Deep buffers on the input. */
+    };
+
+    /** Buffer settings of a stage, 0 for the GNU Radio default. */
+    struct stage_buffers {
+        int max_noutput_items;     /*!< Most items per call to work(). */
+        int min_output_buffer;     /*!< Smallest output buffer [items]. */
+    };
+
+    /** Points of the flow graph with a spectrum for display. */
+    enum fft_tap {
+        FFT_TAP_BASEBAND = 0,  /*!< After the input decimator, the plotter. */
+        FFT_TAP_INPUT    = 1,  /*!< Full input rate, before the decimator. */
+        FFT_TAP_CHANNEL  = 2,  /*!< Demodulator channel, after the down-converter. */
+        FFT_TAP_NUM      = 3   /*!< Included for convenience. */
+    };
+
+    /** Groups of blocks that are pinned to the same cores. */
+    enum cpu_group {
+        CPU_GROUP_SOURCE = 0,  /*!< Source, I/Q swap and DC removal. */
+        CPU_GROUP_DECIM  = 1,  /*!< Input decimator. */
+        CPU_GROUP_FFT    = 2,  /*!< Baseband and zoom FFT. */
+        CPU_GROUP_DEMOD  = 3,  /*!< Down-converters, demodulators and audio. */
+        CPU_GROUP_NUM    = 4   /*!< Included for convenience. */
+    };
+
+    /** Performance counters of a block of the flattened flow graph. */
+    struct block_perf {
+        std::string name;          /*!< Alias of the block, such as fir_filter_ccf3. */
+        float       cpu;           /*!< Share of one core spent in work() since the last call [%]. */
+        float       work_time;     /*!< Average time of a call to work() [us]. */
+        float       input_fill;    /*!< Average fill of the fullest input buffer, -1 without inputs. */
+        float       output_fill;   /*!< Average fill of the fullest output buffer, -1 without outputs. */
+        uint64_t    nproduced;     /*!< Items written to the first output, or read by a sink. */
+        uint64_t    full_events;   /*!< Calls to get_block_perf() that found an output buffer full. */
+    };
+
     static const unsigned int DEFAULT_FFT_SIZE = 8192;
 
     receiver(const std::string input_device="",
@@ -114,8 +201,18 @@ public:
 
     void        start();
     void        stop();
+    void        begin_config();
+    void        end_config();
     void        set_input_device(const std::string device);
     void        set_output_device(const std::string device);
+    void        set_audio_latency(int latency_ms);
+    int         get_audio_latency(void) const { return d_audio_latency; }
+    bool        get_audio_stats(float &latency_ms, uint64_t &underruns, uint64_t &dropped) const;
+
+    void        set_standby_device(const std::string device);
+    bool        has_standby_device(void) const { return standby_src != nullptr; }
+    bool        failover_to_standby(void);
+    bool        check_input_stall(int stall_ms);
 
     std::vector<std::string> get_antennas(void) const;
     void        set_antenna(const std::string &antenna);
@@ -125,11 +222,20 @@ public:
 
     unsigned int    set_input_decim(unsigned int decim);
     unsigned int    get_input_decim(void) const { return d_decim; }
+    void            set_input_decim_quality(int quality);
+    int             get_input_decim_quality(void) const { return d_decim_quality; }
+    void            set_sc16_playback(bool enable) { d_sc16_playback = enable; }
+    bool            get_sc16_playback(void) const { return d_sc16_playback; }
 
     double      get_quad_rate(void) const {
         return d_input_rate / (double)d_decim;
     }
 
+    /* rate of the demodulator channel, after down-conversion */
+    double      get_demod_rate(void) const {
+        return d_quad_rate;
+    }
+
     double      set_analog_bandwidth(double bw);
     double      get_analog_bandwidth(void) const;
 
@@ -157,13 +263,43 @@ public:
     double      get_filter_offset(void) const;
     status      set_cw_offset(double offset_hz);
     double      get_cw_offset(void) const;
+    status      set_doppler_offset(double offset_hz);
+    double      get_doppler_offset(void) const;
     status      set_filter(double low, double high, filter_shape shape);
+    void        get_filter(double &low, double &high) const {
+        low = d_filter_low;
+        high = d_filter_high;
+    }
     status      set_freq_corr(double ppm);
     float       get_signal_pwr() const;
+    void        start_level_probe(double skip_sec, double length_sec);
+    bool        get_level_probe(float &level_db) const;
     void        set_iq_fft_size(int newsize);
     unsigned int iq_fft_size(void) const;
     void        set_iq_fft_window(int window_type, bool normalize_energy);
+    void        set_iq_fft_streaming(bool enable, float overlap, int reduce);
+    void        set_iq_fft_threads(int nthreads);
+    void        set_iq_fft_gpu(bool enable);
+    void        set_iq_fft_estimator(int estimator, int param);
+    unsigned long get_iq_fft_read_retries(void) const;
+    uint64_t    get_iq_sample_count(void) const;
+    void        get_input_drops(uint64_t &events, uint64_t &samples) const;
+    bool        get_iq_retune(uint64_t &sample_index, double &freq, unsigned int &count);
+    void        set_iq_fft_history(double seconds);
+    int         get_iq_fft_history_data(float *fftPoints, double age);
+    void        load_fft_wisdom(const std::string &filename);
+    void        preplan_iq_fft(const std::vector<unsigned int> &sizes, int nthreads);
     int         get_iq_fft_data(float* fftPoints);
+    int         get_iq_fft_data(float* fftPoints, uint64_t &sample_index, double &timestamp);
+    iq_fft_frame_sptr publish_iq_fft_frame(void);
+    iq_fft_frame_sptr get_iq_fft_frame(void);
+    int         subscribe_iq_fft(const std::function<void(const iq_fft_frame_sptr &)> &callback,
+                                 double max_rate = 0.0, unsigned int max_bins = 0,
+                                 fft_tap tap = FFT_TAP_BASEBAND);
+    void        unsubscribe_iq_fft(int id);
+    void        set_zoom_fft(bool enable, double center_freq, double span);
+    unsigned int zoom_fft_size(void) const;
+    int         get_zoom_fft_data(float* fftPoints, double &center_freq, double &rate);
     int         get_audio_fft_data(float* fftPoints);
     unsigned int audio_fft_size(void) const;
 
@@ -182,6 +318,7 @@ public:
     status      set_agc_slope(int slope);
     status      set_agc_decay(int decay_ms);
     status      set_agc_manual_gain(int gain);
+    static void set_agc_block_mode(bool enabled);
 
     status      set_demod(rx_demod demod, bool force=false);
 
@@ -203,21 +340,54 @@ public:
     status      start_audio_playback(const std::string filename);
     status      stop_audio_playback();
 
-    status      start_udp_streaming(const std::string host, int port, bool stereo);
+    status      start_udp_streaming(const std::string host, int port, bool stereo,
+                                    udp_stream_format format = UDP_STREAM_RAW);
     status      stop_udp_streaming();
 
     /* I/Q recording and playback */
-    status      start_iq_recording(const std::string filename);
+    status      start_iq_recording(const std::string filename,
+                                   iq_file_format format = IQ_FILE_CF32,
+                                   bool compress = false);
     status      stop_iq_recording();
+    bool        get_iq_recording_stats(float &ring_fill, uint64_t &dropped) const;
+    bool        get_iq_recording_position(uint64_t &sample) const;
+
+    /* pre-trigger I/Q ring and the captures written from it */
+    void        set_iq_pretrigger(double seconds);
+    double      get_iq_pretrigger() const { return d_iq_pretrigger; }
+    status      start_iq_capture(const std::string filename, double pre_seconds,
+                                 double post_seconds, double &captured_pre);
+    bool        extend_iq_capture(double post_seconds);
+    bool        iq_capture_active() const;
     status      seek_iq_file(long pos);
 
-    /* sample sniffer */
-    status      start_sniffer(unsigned int samplrate, int buffsize);
-    status      stop_sniffer();
-    void        get_sniffer_data(float * outbuff, unsigned int &num);
+    /* memory mapped I/Q playback, ended by set_input_device() */
+    status      start_iq_playback(const std::string filename, iq_file_format format,
+                                  double rate, double freq);
+    bool        is_playing_iq(void) const { return (bool)iq_file_src; }
+    bool        is_test_signal(void) const { return (bool)test_src; }
+    bool        get_iq_playback_position(uint64_t &pos, uint64_t &length) const;
+    void        set_iq_playback_speed(double speed);
+
+    /* data decoders on the audio of the main channel or a VFO */
+    int         start_decoder(data_decoder_sptr decoder, int vfo = -1);
+    status      stop_decoder(int id);
+    bool        get_decoder_message(int id, std::string &msg);
+
+    /* I/Q streams to the network, of the baseband or of a VFO */
+    int         start_iq_stream(int vfo, iq_file_format format, int tcp_port,
+                                const std::string &group = std::string(), int udp_port = 0);
+    status      stop_iq_stream(int id);
+    bool        get_iq_stream_stats(int id, int &clients, uint64_t &dropped) const;
+
+    /* I/Q sniffer on the demodulator channel */
+    int         start_iq_sniffer(int buffsize);
+    status      stop_iq_sniffer(int id);
+    unsigned int peek_iq_sniffer_data(int id, const gr_complex *&data, unsigned int max);
+    void        release_iq_sniffer_data(int id, unsigned int num);
+    uint64_t    get_iq_sniffer_overruns(int id);
 
     bool        is_recording_audio(void) const { return d_recording_wav; }
-    bool        is_snifffer_active(void) const { return d_sniffer_active; }
     bool        is_running(void) const { return d_running; }
 
     /* rds functions */
@@ -226,56 +396,214 @@ public:
     void        stop_rds_decoder();
     bool        is_rds_decoder_active(void) const;
     void        reset_rds_parser(void);
+    void        set_rds_scan(const std::vector<double> &offsets);
+    std::vector<rds_scanner_cc::station_info> get_rds_scan(void);
+
+    /* Additional VFOs, demodulators on the same input as the main one */
+    int         add_vfo(double offset_hz, rx_demod demod);
+    status      remove_vfo(int id);
+    std::vector<int> get_vfo_ids(void) const;
+    status      set_vfo_offset(int id, double offset_hz);
+    void        set_vfo_offsets(const std::map<int, double> &offsets);
+    double      get_vfo_offset(int id) const;
+    status      set_vfo_demod(int id, rx_demod demod);
+    status      set_vfo_filter(int id, double low, double high, filter_shape shape);
+    status      set_vfo_sql_level(int id, double level_db);
+    status      set_vfo_af_gain(int id, float gain_db);
+    status      set_vfo_audio_muted(int id, bool muted);
+    float       get_vfo_signal_pwr(int id) const;
+    status      start_vfo_udp_streaming(int id, const std::string host, int port, bool stereo,
+                                        udp_stream_format format = UDP_STREAM_RAW,
+                                        uint32_t channel = 0);
+    status      stop_vfo_udp_streaming(int id);
+    status      start_vfo_audio_recording(int id, const std::string filename);
+    status      start_vfo_audio_log(int id, const std::string prefix);
+    status      stop_vfo_audio_recording(int id);
+    status      set_vfo_channels(unsigned int channels);
+    unsigned int get_vfo_channels(void) const;
+
+    /* flow graph buffers */
+    void        set_buffer_profile(buffer_profile profile);
+    void        set_stage_buffers(buffer_stage stage, const stage_buffers &buffers);
+    stage_buffers get_stage_buffers(buffer_stage stage) const;
+
+    /* DSP threads */
+    void        set_cpu_affinity(cpu_group group, const std::vector<int> &cores);
+    std::vector<int> get_cpu_affinity(cpu_group group) const;
+    static std::vector<int> auto_cpu_affinity(cpu_group group, unsigned int num_cores);
+    void        set_realtime_priority(bool enabled);
+    bool        get_realtime_priority(void) const { return d_realtime; }
+
+    /* GNU Radio performance counters */
+    void        set_perf_counters(bool enabled);
+    bool        get_perf_counters(void) const { return d_perf; }
+    std::vector<block_perf> get_block_perf(void);
 
     /* utility functions */
     static std::string escape_filename(std::string filename);
 
 private:
     void        connect_all(rx_chain type);
+    void        reconnect_all(void);
+    void        apply_buffers(void);
+    void        apply_cpu_affinity(void);
+    void        start_tb(void);
+    void        unlock_tb(void);
+    unsigned int replace_input_decim(unsigned int decim);
+    void        replace_input(const std::string &device, iq_file_source_sptr file_src);
+    osmosdr::source::sptr open_input(const std::string &device);
+    gr::basic_block_sptr input_block(void) const;
+    gr::basic_block_sptr full_rate_block(void) const;
+    bool        is_sc16_input(void) const { return iq_file_src && iq_file_src->is_sc16(); }
+    void        swap_input_decim(void);
+    void        connect_input(void);
+    void        disconnect_input(void);
+    void        run_dsp_threads(const std::function<void()> &fn);
+    static rx_chain demod_chain(rx_demod demod, int &chain_demod);
+    static double transition_width(double low, double high, filter_shape shape);
 
 private:
     bool        d_running;          /*!< Whether receiver is running or not. */
+    int         d_config_depth;     /*!< Nesting of begin_config(). */
+    bool        d_config_running;   /*!< Running when begin_config() stopped it. */
     double      d_input_rate;       /*!< Input sample rate. */
     double      d_decim_rate;       /*!< Rate after decimation (input_rate / decim) */
     double      d_quad_rate;        /*!< Quadrature rate (after down-conversion) */
     double      d_audio_rate;       /*!< Audio output rate. */
+    int         d_audio_latency;    /*!< Target latency of the audio output in ms, 0 for the default. */
     unsigned int    d_decim;        /*!< input decimation. */
+    int             d_decim_quality; /*!< fir_decim_quality of the input decimator. */
+    bool            d_sc16_playback; /*!< Play integer recordings as sc16 into the decimator. */
     unsigned int    d_ddc_decim;    /*!< Down-conversion decimation. */
     double      d_rf_freq;          /*!< Current RF frequency. */
     double      d_filter_offset;    /*!< Current filter offset */
+    double      d_filter_low;       /*!< Current filter low cut */
+    double      d_filter_high;      /*!< Current filter high cut */
     double      d_cw_offset;        /*!< CW offset */
+    double      d_doppler_offset;   /*!< Doppler correction of the channel */
+    std::mutex  d_ddc_mutex;        /*!< Offsets are set from the GUI and remote threads. */
+    /*! Held while the flowgraph or the demodulator changes, from the GUI or the
+     *  control thread of ReceiverQueue. Recursive, these methods call each other. */
+    std::recursive_mutex d_config_mutex;
     bool        d_recording_iq;     /*!< Whether we are recording I/Q file. */
+    double      d_iq_pretrigger;    /*!< Length of the pre-trigger ring in seconds. */
     bool        d_recording_wav;    /*!< Whether we are recording WAV file. */
-    bool        d_sniffer_active;   /*!< Only one data decoder allowed. */
+    bool        d_iq_sniffer_active; /*!< Whether the I/Q sniffer has readers. */
     bool        d_iq_rev;           /*!< Whether I/Q is reversed or not. */
     bool        d_dc_cancel;        /*!< Enable automatic DC removal. */
     bool        d_iq_balance;       /*!< Enable automatic IQ balance. */
+    bool        d_zoom_fft;         /*!< Whether the zoom FFT is connected. */
+    bool        d_fft_taps[FFT_TAP_NUM]; /*!< Extra FFT taps that have subscribers. */
+    bool        d_chan_fft;         /*!< Whether the channel FFT is connected. */
+    stage_buffers d_buffers[BUFFER_STAGE_NUM]; /*!< Buffer settings per stage. */
+    std::vector<int> d_affinity[CPU_GROUP_NUM]; /*!< Cores per group, empty for any. */
+    bool        d_realtime;         /*!< Run the DSP threads at real-time priority. */
+    bool        d_perf;             /*!< GNU Radio performance counters are collected. */
+    struct perf_last {
+        float    work_total;        /*!< pc_work_time_total() at the last poll [ticks]. */
+        uint64_t full_events;
+    };
+    std::map<long, perf_last> d_perf_last; /*!< Per unique_id() of the blocks. */
+    std::chrono::steady_clock::time_point d_perf_time; /*!< Time of the last poll. */
 
     std::string input_devstr;  /*!< Current input device string. */
     std::string output_devstr; /*!< Current output device string. */
 
     rx_demod    d_demod;       /*!< Current demodulator. */
 
+    /** Additional VFO, with its own down-converter, demodulator and outputs. */
+    struct vfo_chain {
+        double      offset;        /*!< Offset from the RF frequency [Hz]. */
+        rx_demod    demod;         /*!< Demodulator, never RX_DEMOD_OFF. */
+        bool        muted;         /*!< Whether it is left out of the audio output. */
+        int         channel;       /*!< Channelizer output it is fed from, or -1. */
+        double      ddc_rate;      /*!< Input rate of the down-converter. */
+        unsigned int ddc_decim;    /*!< Decimation of the down-converter. */
+        downconverter_cc_sptr ddc;
+        receiver_base_cf_sptr rx;
+        gr::blocks::multiply_const_ff::sptr gain0;  /*!< Audio gain, left. */
+        gr::blocks::multiply_const_ff::sptr gain1;  /*!< Audio gain, right. */
+        udp_sink_f_sptr udp_sink;
+        gr::blocks::wavfile_sink::sptr wav_sink;    /*!< Set while recording. */
+        audio_log_sink_sptr log_sink;   /*!< Set while logging transmissions. */
+    };
+    std::map<int, vfo_chain> d_vfos;
+    int         d_vfo_id;          /*!< Last VFO id handed out. */
+    channelizer_cc_sptr channelizer;  /*!< Splits the input for the VFOs, or null. */
+    audio_log_encoder_sptr d_audio_log;  /*!< Writes the VFO audio logs, made by the first. */
+
+    bool        update_vfo_chain(vfo_chain &vfo);
+    uint64_t    iq_capture_samples() const;
+    void        replace_iq_capture(bool enable);
+    bool        update_vfo_chains(void);
+
+    /** Data decoder, run by the scheduler on the audio of one channel. */
+    struct decoder_chain {
+        int         vfo;           /*!< VFO it decodes, or -1 for the main channel. */
+        unsigned int        rate;  /*!< Audio rate the decoder wants. */
+        decoder_sink_f_sptr sink;
+        decoder_store_sptr  store; /*!< Messages waiting for the GUI. */
+    };
+    std::map<int, decoder_chain> d_decoders;
+    int         d_decoder_id;      /*!< Last decoder id handed out. */
+
+    /** Network stream of the I/Q samples of the baseband or of a VFO. */
+    struct iq_stream_chain {
+        int         vfo;           /*!< VFO it streams, or -1 for the baseband. */
+        iq_stream_sink_sptr sink;
+    };
+    std::map<int, iq_stream_chain> d_iq_streams;
+    int         d_iq_stream_id;    /*!< Last stream id handed out. */
+    void        update_iq_streams(void);
+
+    /** Audio of a channel at a rate its decoders want, shared by them. */
+    struct audio_resampler {
+        double      source_rate;   /*!< Rate of the audio it is fed. */
+        resampler_ff_sptr rr;
+    };
+    /** Resamplers by VFO, -1 for the main channel, and rate. */
+    std::map<std::pair<int, unsigned int>, audio_resampler> d_audio_rr;
+
+    void        connect_decoders(bool main_channel);
+
     gr::top_block_sptr         tb;        /*!< The GNU Radio top block. */
 
     osmosdr::source::sptr     src;       /*!< Real time I/Q source. */
+    iq_file_source_sptr       iq_file_src;  /*!< Playback source, feeds the flow graph instead of src. */
+    test_signal_source_sptr   test_src;     /*!< Test signal, feeds the flow graph instead of src. */
+    stitched_source_sptr      stitch_src;   /*!< Stitched devices, src is the first of them. */
+    osmosdr::source::sptr     standby_src;  /*!< Standby source, kept streaming, or null. */
+    gr::blocks::null_sink::sptr standby_sink; /*!< Takes the samples of the standby source. */
+    std::string standby_devstr; /*!< Device string of the standby source. */
+    uint64_t    d_stall_count;  /*!< Sample count at the last check_input_stall(). */
+    std::chrono::steady_clock::time_point d_stall_time; /*!< When the count last changed. */
     fir_decim_cc_sptr         input_decim;      /*!< Input decimator. */
+    sc16_to_cf32_sptr         input_cvt;        /*!< Full rate gr_complex of an sc16 input. */
     receiver_base_cf_sptr     rx;        /*!< receiver. */
 
-    dc_corr_cc_sptr           dc_corr;   /*!< DC corrector block. */
-    iq_swap_cc_sptr           iq_swap;   /*!< I/Q swapping block. */
+    iq_swap_cc_sptr           iq_swap;   /*!< I/Q swapping and DC removal. */
 
     rx_fft_c_sptr             iq_fft;     /*!< Baseband FFT block. */
+    zoom_fft_c_sptr           zoom_fft;   /*!< Decimated FFT of the zoomed span. */
+    rds_scanner_cc_sptr       rds_scan;   /*!< RDS of the stations of a band survey. */
     rx_fft_f_sptr             audio_fft;  /*!< Audio FFT block. */
+    rx_fft_c_sptr             input_fft;  /*!< FFT at the input rate, before decimation. */
+    rx_fft_c_sptr             chan_fft;   /*!< FFT of the demodulator channel. */
+    iq_swap_cc_sptr           input_swap; /*!< I/Q swapping for the input FFT. */
 
     downconverter_cc_sptr     ddc;        /*!< Digital down-converter for demod chain. */
 
     gr::blocks::multiply_const_ff::sptr audio_gain0; /*!< Audio gain block. */
     gr::blocks::multiply_const_ff::sptr audio_gain1; /*!< Audio gain block. */
+    gr::blocks::add_ff::sptr audio_mix0; /*!< Mixes the VFOs into the audio output. */
+    gr::blocks::add_ff::sptr audio_mix1; /*!< Mixes the VFOs into the audio output. */
+    gr::basic_block_sptr     audio_out0; /*!< Block feeding the audio sink, or null. */
+    gr::basic_block_sptr     audio_out1; /*!< Block feeding the audio sink, or null. */
     gr::blocks::multiply_const_ff::sptr wav_gain0; /*!< WAV file gain block. */
     gr::blocks::multiply_const_ff::sptr wav_gain1; /*!< WAV file gain block. */
 
-    gr::blocks::file_sink::sptr         iq_sink;     /*!< I/Q file sink. */
+    iq_file_sink_sptr                   iq_sink;     /*!< I/Q file sink. */
+    iq_capture_sink_sptr                iq_capture;  /*!< Pre-trigger ring, set while enabled. */
 
     gr::blocks::wavfile_sink::sptr      wav_sink;   /*!< WAV file sink for recording. */
     gr::blocks::wavfile_source::sptr    wav_src;    /*!< WAV file source for playback. */
@@ -283,8 +611,7 @@ private:
     gr::blocks::null_sink::sptr         audio_null_sink1; /*!< Audio null sink used during playback. */
 
     udp_sink_f_sptr   audio_udp_sink;  /*!< UDP sink to stream audio over the network. */
-    sniffer_f_sptr    sniffer;    /*!< Sample sniffer for data decoders. */
-    resampler_ff_sptr sniffer_rr; /*!< Sniffer resampler. */
+    iq_sniffer_cc_sptr iq_sniffer; /*!< I/Q sniffer for the modulation classifier. */
 
 #ifdef WITH_PULSEAUDIO
     pa_sink_sptr              audio_snk;  /*!< Pulse audio sink. */
@@ -294,6 +621,33 @@ private:
     gr::audio::sink::sptr     audio_snk;  /*!< gr audio sink */
 #endif
 
+    /* shared baseband FFT frames */
+    std::mutex          d_fft_frame_mutex;  /*!< Protects the members below. */
+    iq_fft_frame_sptr   d_fft_frame;        /*!< Last published frame. */
+    uint64_t            d_fft_frame_seq[FFT_TAP_NUM]; /*!< Number of the next frame. */
+    int                 d_fft_sub_id;       /*!< Last subscriber id handed out. */
+    struct fft_subscriber {
+        std::function<void(const iq_fft_frame_sptr &)> callback;
+        std::chrono::steady_clock::duration interval;   /*!< Zero for every frame. */
+        std::chrono::steady_clock::time_point next;     /*!< Earliest next delivery. */
+        unsigned int max_bins;                          /*!< Zero for full frames. */
+        fft_tap tap;
+    };
+    std::map<int, fft_subscriber> d_fft_subscribers;
+    std::vector<std::shared_ptr<iq_fft_frame>> d_fft_frame_pool; /*!< Free while only the pool holds them. */
+    struct fft_delivery {
+        std::function<void(const iq_fft_frame_sptr &)> callback;
+        unsigned int max_bins;
+        iq_fft_frame_sptr frame;    /*!< Decimated for max_bins, or empty. */
+    };
+    std::vector<fft_delivery> d_fft_deliveries; /*!< Scratch of deliver_fft_frame(), kept for its capacity. */
+
+    std::shared_ptr<iq_fft_frame> alloc_fft_frame(size_t bins);
+    iq_fft_frame_sptr read_fft_frame(fft_tap tap);
+    void        deliver_fft_frame(const iq_fft_frame_sptr &frame, fft_tap tap);
+    void        update_fft_taps(const bool wanted[FFT_TAP_NUM]);
+    iq_fft_frame_sptr decimate_iq_fft_frame(const iq_fft_frame_sptr &frame, unsigned int bins);
+
     //! Get a path to a file containing random bytes
     static std::string get_zero_file(void);
 };
@@ -0,0 +1,101 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include "receiver_queue.h"
+
+ReceiverQueue::ReceiverQueue(QObject *parent) :
+    QObject(parent),
+    rq_next_id(0),
+    rq_stop(false)
+{
+    connect(this, &ReceiverQueue::finished, this, &ReceiverQueue::complete,
+            Qt::QueuedConnection);
+    rq_thread = std::thread(&ReceiverQueue::run, this);
+}
+
+/*! \brief Run the commands still queued, then end the thread. */
+ReceiverQueue::~ReceiverQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(rq_mutex);
+        rq_stop = true;
+    }
+    rq_wake.notify_one();
+    rq_thread.join();
+}
+
+/*! \brief Queue a command.
+ *  \param key Commands with the same key replace each other while queued,
+ *             empty to always run it.
+ *  \param command Runs in the control thread.
+ *  \param done Called on the GUI thread with the status of the command.
+ */
+void ReceiverQueue::post(const QString &key, const Command &command, const Done &done)
+{
+    const quint64 id = rq_next_id++;
+    if (done)
+        rq_done.insert(id, done);
+
+    {
+        std::lock_guard<std::mutex> lock(rq_mutex);
+        if (!key.isEmpty())
+        {
+            for (auto it = rq_queue.begin(); it != rq_queue.end(); ++it)
+            {
+                if (it->key == key)
+                {
+                    rq_done.remove(it->id);
+                    rq_queue.erase(it);
+                    break;
+                }
+            }
+        }
+        rq_queue.push_back({id, key, command});
+    }
+    rq_wake.notify_one();
+}
+
+void ReceiverQueue::run(void)
+{
+    std::unique_lock<std::mutex> lock(rq_mutex);
+    for (;;)
+    {
+        rq_wake.wait(lock, [this]() { return rq_stop || !rq_queue.empty(); });
+        if (rq_queue.empty())
+            return;
+
+        Entry entry = std::move(rq_queue.front());
+        rq_queue.pop_front();
+        lock.unlock();
+
+        emit finished(entry.id, entry.command());
+
+        lock.lock();
+    }
+}
+
+void ReceiverQueue::complete(quint64 id, int status)
+{
+    Done done = rq_done.take(id);
+    if (done)
+        done(status);
+}
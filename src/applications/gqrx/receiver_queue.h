@@ -0,0 +1,89 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RECEIVER_QUEUE_H
+#define RECEIVER_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <QMap>
+#include <QObject>
+#include <QString>
+
+/*! \brief Runs receiver commands in a control thread of its own.
+ *
+ * Changing the filter takes the mutex of the filter block until its
+ * work() returns, and starting a recording or seeking in a file locks the
+ * flowgraph until every block thread has stopped. Under a heavy DSP load
+ * either can take long enough to freeze the user interface, so MainWindow
+ * posts these commands here instead and the GUI thread goes on at once.
+ *
+ * Commands run one at a time in the order they were posted. A command
+ * with a key replaces the one with the same key that has not started yet,
+ * which moves to the end of the queue: dragging a filter edge only applies
+ * the newest setting instead of one per mouse event. Its completion is
+ * dropped with it. The completion of a command that ran is called on the
+ * GUI thread with its receiver::status.
+ *
+ * The receiver serializes the commands with the changes the GUI thread
+ * still makes itself, see receiver::d_config_mutex.
+ */
+class ReceiverQueue : public QObject
+{
+    Q_OBJECT
+public:
+    typedef std::function<int()>     Command;   /*!< Returns a receiver::status. */
+    typedef std::function<void(int)> Done;
+
+    explicit ReceiverQueue(QObject *parent = 0);
+    ~ReceiverQueue();
+
+    void post(const QString &key, const Command &command, const Done &done = nullptr);
+
+signals:
+    void finished(quint64 id, int status);
+
+private slots:
+    void complete(quint64 id, int status);
+
+private:
+    struct Entry {
+        quint64 id;
+        QString key;
+        Command command;
+    };
+
+    void run(void);
+
+    quint64                 rq_next_id;
+    QMap<quint64, Done>     rq_done;    /*!< Completions by command, GUI thread only. */
+    std::mutex              rq_mutex;
+    std::condition_variable rq_wake;    /*!< A command was posted or the queue stops. */
+    std::deque<Entry>       rq_queue;
+    bool                    rq_stop;
+    std::thread             rq_thread;
+};
+
+#endif // RECEIVER_QUEUE_H
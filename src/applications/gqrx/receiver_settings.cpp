@@ -0,0 +1,187 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <thread>
+#include <vector>
+#include <QDebug>
+#include <QString>
+#include <QStringList>
+
+#include "applications/gqrx/receiver_settings.h"
+#include "dsp/mem_account.h"
+
+/**
+ * @brief Read the flow graph buffer settings of the receiver.
+ *
+ * These are only set in the configuration file, in the [receiver] group:
+ * buffer_profile=low_latency|high_throughput, and for the stages input,
+ * channel and audio <stage>_max_noutput_items and <stage>_min_output_buffer
+ * on top of the profile. They are read at startup and never written.
+ * agc_block_mode=false runs the AGC one sample at a time instead of in
+ * blocks.
+ */
+void readBufferSettings(receiver *rx, QSettings *settings)
+{
+    static const char *stages[receiver::BUFFER_STAGE_NUM] = { "input", "channel", "audio" };
+
+    QString profile = settings->value("receiver/buffer_profile", "").toString();
+    if (profile == "low_latency")
+        rx->set_buffer_profile(receiver::BUFFER_PROFILE_LOW_LATENCY);
+    else if (profile == "high_throughput")
+        rx->set_buffer_profile(receiver::BUFFER_PROFILE_HIGH_THROUGHPUT);
+    else
+        rx->set_buffer_profile(receiver::BUFFER_PROFILE_DEFAULT);
+
+    for (int i = 0; i < receiver::BUFFER_STAGE_NUM; i++)
+    {
+        auto stage = (receiver::buffer_stage)i;
+        receiver::stage_buffers buffers = rx->get_stage_buffers(stage);
+        QString key = QString("receiver/%1_").arg(stages[i]);
+        bool conv_ok;
+        int val = settings->value(key + "max_noutput_items", 0).toInt(&conv_ok);
+        if (conv_ok && val > 0)
+            buffers.max_noutput_items = val;
+        val = settings->value(key + "min_output_buffer", 0).toInt(&conv_ok);
+        if (conv_ok && val > 0)
+            buffers.min_output_buffer = val;
+        rx->set_stage_buffers(stage, buffers);
+    }
+
+    rx->set_agc_block_mode(settings->value("receiver/agc_block_mode", true).toBool());
+
+    // Buffering of the audio output, 0 for the default of the output
+    rx->set_audio_latency(settings->value("output/latency_ms", 0).toInt());
+}
+
+/**
+ * @brief Read the core and priority settings of the DSP threads.
+ *
+ * Also only set in the configuration file, in the [receiver] group:
+ * cpu_affinity=auto pins the groups of blocks as receiver::auto_cpu_affinity()
+ * lays them out for this machine, and source_cores, decim_cores, fft_cores
+ * and demod_cores, lists of core numbers such as 2,3, pin single groups.
+ * realtime_priority=true runs the DSP threads at real-time priority.
+ */
+void readThreadSettings(receiver *rx, QSettings *settings)
+{
+    static const char *groups[receiver::CPU_GROUP_NUM] = { "source", "decim", "fft", "demod" };
+
+    bool auto_layout = settings->value("receiver/cpu_affinity", "").toString() == "auto";
+    unsigned int num_cores = std::thread::hardware_concurrency();
+
+    for (int i = 0; i < receiver::CPU_GROUP_NUM; i++)
+    {
+        auto group = (receiver::cpu_group)i;
+        std::vector<int> cores;
+        if (auto_layout)
+            cores = receiver::auto_cpu_affinity(group, num_cores);
+
+        QString key = QString("receiver/%1_cores").arg(groups[i]);
+        if (settings->contains(key))
+        {
+            cores.clear();
+            for (const QString &core : settings->value(key).toString().split(',', QString::SkipEmptyParts))
+            {
+                bool conv_ok;
+                int n = core.trimmed().toInt(&conv_ok);
+                if (conv_ok && n >= 0 && (unsigned int)n < num_cores)
+                    cores.push_back(n);
+                else
+                    qWarning() << "Ignoring core" << core << "in" << key;
+            }
+        }
+        rx->set_cpu_affinity(group, cores);
+    }
+
+    rx->set_realtime_priority(settings->value("receiver/realtime_priority", false).toBool());
+}
+
+/*
+ * Open the standby device of [input] standby_device, which the I/O dialog
+ * sets. standby_stall_ms, only set in the configuration file, is the time
+ * without input samples after which it takes over.
+ *
+ * Returns the stall time for receiver::check_input_stall().
+ */
+int readStandbySettings(receiver *rx, QSettings *settings)
+{
+    QString device = settings->value("input/standby_device", "").toString();
+    rx->set_standby_device(device.toStdString());
+    if (!device.isEmpty() && !rx->has_standby_device())
+        qWarning() << "Failed to open standby device" << device;
+
+    bool conv_ok;
+    int stall_ms = settings->value("input/standby_stall_ms", INPUT_STALL_MS).toInt(&conv_ok);
+    return (conv_ok && stall_ms > 0) ? stall_ms : INPUT_STALL_MS;
+}
+
+/*
+ * Filter quality of the input decimator from [input] decim_quality, one of
+ * sharp, balanced or fast. Only set in the configuration file; read before
+ * the decimation so the decimator is built once. With [input] sc16_playback
+ * the cs16 and cs8 recordings are played as int16 into the halfband stages
+ * of the balanced and fast qualities.
+ */
+void readDecimSettings(receiver *rx, QSettings *settings)
+{
+    QString quality = settings->value("input/decim_quality", "sharp").toString();
+    if (quality == "fast")
+        rx->set_input_decim_quality(FIR_DECIM_FAST);
+    else if (quality == "balanced")
+        rx->set_input_decim_quality(FIR_DECIM_BALANCED);
+    else
+    {
+        if (quality != "sharp")
+            qWarning() << "Unknown decimator quality" << quality;
+        rx->set_input_decim_quality(FIR_DECIM_SHARP);
+    }
+    rx->set_sc16_playback(settings->value("input/sc16_playback", false).toBool());
+}
+
+/**
+ * @brief Read the memory caps of the history buffers.
+ *
+ * Only set in the configuration file, in the [memory] group, in megabytes:
+ * fft_history_mb, waterfall_history_mb, iq_pretrigger_mb, chat_history_mb and
+ * waterfall_tiles_mb.
+ * A history over its cap is shortened the next time it is resized, the chat
+ * history drops its oldest messages, which stay in the database, and the
+ * waterfall tiles their oldest rows of tiles. 0 or no
+ * key for no cap. The use of each buffer is shown in the performance dock.
+ */
+void readMemorySettings(QSettings *settings)
+{
+    static const struct { const char *key; int subsystem; } caps[] = {
+        { "memory/fft_history_mb",       MEM_FFT_SAMPLES },
+        { "memory/waterfall_history_mb", MEM_WF_HISTORY },
+        { "memory/iq_pretrigger_mb",     MEM_IQ_PRETRIGGER },
+        { "memory/chat_history_mb",      MEM_CHAT_HISTORY },
+        { "memory/waterfall_tiles_mb",   MEM_WF_TILES },
+    };
+
+    for (const auto &cap : caps)
+    {
+        bool conv_ok;
+        double mb = settings->value(cap.key, 0).toDouble(&conv_ok);
+        mem_account::set_cap(cap.subsystem, conv_ok && mb > 0.0 ? (int64_t)(mb * 1048576.0) : 0);
+    }
+}
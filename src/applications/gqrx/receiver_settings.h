@@ -0,0 +1,42 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RECEIVER_SETTINGS_H
+#define RECEIVER_SETTINGS_H
+
+#include <QSettings>
+#include "applications/gqrx/receiver.h"
+
+/* Default time without input samples before the standby device takes over */
+#define INPUT_STALL_MS 500
+
+/*
+ * Receiver settings that are only set in the configuration file and have
+ * no widget, shared by the GUI and the headless receiver.
+ */
+void readBufferSettings(receiver *rx, QSettings *settings);
+void readThreadSettings(receiver *rx, QSettings *settings);
+int readStandbySettings(receiver *rx, QSettings *settings);
+void readDecimSettings(receiver *rx, QSettings *settings);
+void readMemorySettings(QSettings *settings);
+
+#endif // RECEIVER_SETTINGS_H
@@ -20,24 +20,138 @@
  * the Free Software Foundation, Inc., 51 Franklin Street,
  * Boston, MA 02110-1301, USA.
  */
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <QtEndian>
 #include <QString>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QStandardPaths>
 #include <QStringList>
+#include <QThread>
+#ifdef WITH_WEBSOCKETS
+#include <QWebSocket>
+#include <QWebSocketServer>
+#endif
 #include "remote_control.h"
+#include "dsp/trace.h"
 #include "qtgui/dockrxopt.h"
+#include "qtgui/spectrum_summary.h"
+#include "qtgui/waterfall_snapshot.h"
+#include "qtgui/waterfall_tiles.h"
 
 #define DEFAULT_RC_PORT            7356
 #define DEFAULT_RC_ALLOWED_HOSTS   "127.0.0.1"
+#define DEFAULT_RC_WEB_PORT        7357
+
+/* Items a client can subscribe to, see SUBSCRIBE */
+#define RC_SUBSCRIBE_ITEMS         "F M STRENGTH RDS_PI DETECTOR DETECTIONS PACKET"
+
+/* Decoded packets kept for a client until they are pushed, oldest dropped */
+#define RC_PACKET_QUEUE            64
+
+/* Items of U NOTIFY */
+#define RC_NOTIFY_ITEMS            "F M DETECTOR"
+
+/* Sample formats of FFT_STREAM, in the order of their codes */
+#define RC_FFT_FORMATS             "F32 I16 I8"
+#define RC_FFT_F32                 1
+#define RC_FFT_I16                 2
+#define RC_FFT_I8                  3
+
+/* Spectrum taps of FFT_STREAM, in the order of receiver::fft_tap */
+#define RC_FFT_TAPS                "BASEBAND INPUT CHANNEL"
+
+/* Magic number at the start of every FFT record, "AGF1" in little endian */
+#define RC_FFT_MAGIC               0x31464741
+#define RC_FFT_HEADER_SIZE         56
+
+/* Level of the integer formats: dB = offset + scale * value */
+#define RC_FFT_I16_SCALE           0.01f
+#define RC_FFT_I8_OFFSET           -64.0f
+#define RC_FFT_I8_SCALE            1.0f
+
+/*
+ * FFT frames are dropped while more than this many are queued for a
+ * client, so a slow link gets fewer frames instead of a growing delay,
+ * and never more bytes than RC_FFT_MAX_QUEUED
+ */
+#define RC_FFT_QUEUE_FRAMES        4
+#define RC_FFT_MAX_QUEUED          (4 * 1024 * 1024)
+
+/* Interval of the Doppler corrections in ms, steps of 2 Hz at 100 Hz/s */
+#define RC_DOPPLER_STEP_MS         20
+
+/* Size of the SCREENSHOT PNG images, width in pixels and spectrum height */
+/* Longest delay before a change from the GUI is seen by the read commands, the meter interval */
+#define RC_STATE_INTERVAL_MS       100
+
+/* Highest number of the VFO command */
+#define RC_VFO_MAX                 8
+
+/* Most channels of the VFO channelizer */
+#define RC_VFO_CHANNELS_MAX        1024
+
+#define RC_SCREENSHOT_WIDTH        1024
+#define RC_SCREENSHOT_MAX_WIDTH    8192
+#define RC_SCREENSHOT_SPECTRUM     64
 
-RemoteControl::RemoteControl(QObject *parent) :
-    QObject(parent)
+/* Most rows of a HISTORY grid */
+#define RC_HISTORY_MAX_ROWS        4096
+
+/* Columns of the waterfall reduced for SUMMARY */
+#define RC_SUMMARY_COLUMNS         512
+
+/* Revisit interval of a SURVEY or CLUSTER RANGE range without one [s] */
+#define RC_SURVEY_INTERVAL         60
+
+/* Store a value in an FFT record at offset, in little endian */
+template <typename T>
+static void put(char *record, int offset, T value)
+{
+    qToLittleEndian<T>(value, (uchar *)(record + offset));
+}
+
+static void put(char *record, int offset, float value)
+{
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put<quint32>(record, offset, bits);
+}
+
+static void put(char *record, int offset, double value)
+{
+    quint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put<quint64>(record, offset, bits);
+}
+
+RemoteControl::RemoteControl(receiver *rx, QObject *parent) :
+    QObject(parent),
+    rc_rx(rx),
+    rc_snapshot(nullptr),
+    rc_tiles(nullptr),
+    rc_server(this),
+    rc_web_server(nullptr),
+    rc_web_port(DEFAULT_RC_WEB_PORT),
+    rc_notify_timer(this),
+    rc_state_timer(this),
+    rc_doppler_timer(this),
+    rc_doppler_rate(0.0)
 {
+    // The server and the timer are children, so they move to the thread too
+    qRegisterMetaType<gain_list_t>("gain_list_t");
 
     rc_freq = 0;
     rc_filter_offset = 0;
     bw_half = 740e3;
+    rc_bandwidth = 0;
     rc_lnb_lo_mhz = 0.0;
     rc_mode = 0;
     rc_passband_lo = 0;
@@ -53,18 +167,42 @@ RemoteControl::RemoteControl(QObject *parent) :
     iq_recorder_status = false;
     receiver_running = false;
     hamlib_compatible = false;
+    rc_current = -1;
     is_audio_muted = false;
     waterfall_min_db = -160.0f;
     waterfall_max_db = 0.0f;
+    render_timing_status = false;
+    perf_status = false;
+    detector_status = false;
+    rc_vfo_channels = 0;
+    rc_survey_available = false;
+    rc_cluster_coordinator = false;
 
     rc_port = DEFAULT_RC_PORT;
     rc_allowed_hosts.append(DEFAULT_RC_ALLOWED_HOSTS);
 
-    rc_socket = 0;
+    // Updates are pushed once the current command has been answered
+    rc_notify_timer.setSingleShot(true);
+    rc_clock.start();
 
     connect(&rc_server, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+#ifdef WITH_WEBSOCKETS
+    rc_web_server = new QWebSocketServer("Aguila", QWebSocketServer::NonSecureMode, this);
+    connect(rc_web_server, SIGNAL(newConnection()), this, SLOT(acceptWebConnection()));
+#endif
+    connect(&rc_notify_timer, SIGNAL(timeout()), this, SLOT(sendNotifications()));
+
+    rc_state_timer.setSingleShot(true);
+    rc_state_timer.setInterval(RC_STATE_INTERVAL_MS);
+    connect(&rc_state_timer, SIGNAL(timeout()), this, SLOT(publishState()));
+    publishState();
+
+    rc_doppler_timer.setTimerType(Qt::PreciseTimer);
+    rc_doppler_timer.setInterval(RC_DOPPLER_STEP_MS);
+    connect(&rc_doppler_timer, SIGNAL(timeout()), this, SLOT(applyDoppler()));
 }
 
+/* Deleted in the thread of the server, see MainWindow::~MainWindow() */
 RemoteControl::~RemoteControl()
 {
     stop_server();
@@ -73,22 +211,39 @@ RemoteControl::~RemoteControl()
 /*! \brief Start the server. */
 void RemoteControl::start_server()
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "start_server", Qt::BlockingQueuedConnection);
+        return;
+    }
+
     if (!rc_server.isListening())
         rc_server.listen(QHostAddress::Any, rc_port);
+#ifdef WITH_WEBSOCKETS
+    if (rc_web_port > 0 && !rc_web_server->isListening())
+        rc_web_server->listen(QHostAddress::Any, rc_web_port);
+#endif
 }
 
 /*! \brief Stop the server. */
 void RemoteControl::stop_server()
 {
-    if (rc_socket != 0) {
-        rc_socket->close();
-        rc_socket->deleteLater();
-        rc_socket = 0;
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "stop_server", Qt::BlockingQueuedConnection);
+        return;
     }
 
+    while (!rc_clients.isEmpty())
+        closeClient(0);
+    rc_notify_timer.stop();
+
     if (rc_server.isListening())
         rc_server.close();
-
+#ifdef WITH_WEBSOCKETS
+    if (rc_web_server->isListening())
+        rc_web_server->close();
+#endif
 }
 
 /*! \brief Read settings. */
@@ -97,6 +252,13 @@ void RemoteControl::readSettings(QSettings *settings)
     if (!settings)
         return;
 
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "readSettings", Qt::BlockingQueuedConnection,
+                                  Q_ARG(QSettings *, settings));
+        return;
+    }
+
     settings->beginGroup("remote_control");
 
     // Get port number; restart server if running
@@ -107,14 +269,24 @@ void RemoteControl::readSettings(QSettings *settings)
     if (settings->contains("allowed_hosts"))
         setHosts(settings->value("allowed_hosts").toStringList());
 
+    // Port of the WebSocket gateway, 0 disables it
+    rc_web_port = settings->value("web_port", DEFAULT_RC_WEB_PORT).toInt();
+
     settings->endGroup();
 }
 
-void RemoteControl::saveSettings(QSettings *settings) const
+void RemoteControl::saveSettings(QSettings *settings)
 {
     if (!settings)
         return;
 
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "saveSettings", Qt::BlockingQueuedConnection,
+                                  Q_ARG(QSettings *, settings));
+        return;
+    }
+
     settings->beginGroup("remote_control");
 
     if (rc_server.isListening())
@@ -132,6 +304,11 @@ void RemoteControl::saveSettings(QSettings *settings) const
     else
         settings->remove("allowed_hosts");
 
+    if (rc_web_port != DEFAULT_RC_WEB_PORT)
+        settings->setValue("web_port", rc_web_port);
+    else
+        settings->remove("web_port");
+
     settings->endGroup();
 }
 
@@ -146,6 +323,13 @@ void RemoteControl::setPort(int port)
     if (port == rc_port)
         return;
 
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "setPort", Qt::BlockingQueuedConnection,
+                                  Q_ARG(int, port));
+        return;
+    }
+
     rc_port = port;
     if (rc_server.isListening())
     {
@@ -156,130 +340,634 @@ void RemoteControl::setPort(int port)
 
 void RemoteControl::setHosts(QStringList hosts)
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "setHosts", Qt::BlockingQueuedConnection,
+                                  Q_ARG(QStringList, hosts));
+        return;
+    }
+
     rc_allowed_hosts = hosts;
 }
 
 
-/*! \brief Accept a new client connection.
+/*! \brief Accept new client connections.
  *
- * This slot is called when a client opens a new connection.
+ * This slot is called when a client opens a new connection. Clients stay
+ * connected side by side, each with its own state, and their commands are
+ * handled one at a time in the order they arrive.
  */
 void RemoteControl::acceptConnection()
 {
-    if (rc_socket)
+    while (rc_server.hasPendingConnections())
     {
-        rc_socket->close();
-        rc_socket->deleteLater();
-    }
-    rc_socket = rc_server.nextPendingConnection();
+        QTcpSocket *socket = rc_server.nextPendingConnection();
+
+        // check if host is allowed
+        auto address = socket->peerAddress();
+        bool allowed = false;
+
+        for (auto allowed_host : rc_allowed_hosts)
+        {
+            if (address.isEqual(QHostAddress(allowed_host)))
+            {
+                allowed = true;
+                break;
+            }
+        }
+
+        if (!allowed)
+        {
+            std::cout << "*** Remote connection attempt from " << address.toString().toStdString()
+                      << " (not in allowed list)" << std::endl;
+            socket->close();
+            socket->deleteLater();
+            continue;
+        }
 
-    // check if host is allowed
-    auto address = rc_socket->peerAddress();
+        connect(socket, SIGNAL(readyRead()), this, SLOT(startRead()));
+        // Queued, a failed write must not remove a client while others are served
+        connect(socket, SIGNAL(disconnected()), this, SLOT(clientDisconnected()),
+                Qt::QueuedConnection);
+        rc_clients.append({socket, socket, nullptr, 0, false, {}, {}, {}, 0, 0.0, 0, RC_FFT_I16, 0,
+                           receiver::FFT_TAP_BASEBAND, {}});
+    }
+}
 
-    for (auto allowed_host : rc_allowed_hosts)
+#ifdef WITH_WEBSOCKETS
+/*! \brief Accept new WebSocket connections, from the same hosts as the TCP server. */
+void RemoteControl::acceptWebConnection()
+{
+    while (rc_web_server->hasPendingConnections())
     {
-        if (address.isEqual(QHostAddress(allowed_host)))
+        QWebSocket *web = rc_web_server->nextPendingConnection();
+
+        bool allowed = false;
+        for (auto allowed_host : rc_allowed_hosts)
+        {
+            if (web->peerAddress().isEqual(QHostAddress(allowed_host)))
+            {
+                allowed = true;
+                break;
+            }
+        }
+
+        if (!allowed)
         {
-            connect(rc_socket, SIGNAL(readyRead()), this, SLOT(startRead()));
-            return;
+            std::cout << "*** WebSocket connection attempt from "
+                      << web->peerAddress().toString().toStdString()
+                      << " (not in allowed list)" << std::endl;
+            web->close(QWebSocketProtocol::ClosePolicyViolated);
+            web->deleteLater();
+            continue;
         }
+
+        connect(web, SIGNAL(textMessageReceived(QString)), this, SLOT(webMessage(QString)));
+        connect(web, SIGNAL(bytesWritten(qint64)), this, SLOT(webBytesWritten(qint64)));
+        connect(web, SIGNAL(disconnected()), this, SLOT(clientDisconnected()),
+                Qt::QueuedConnection);
+        rc_clients.append({web, nullptr, web, 0, false, {}, {}, {}, 0, 0.0, 0, RC_FFT_I16, 0,
+                           receiver::FFT_TAP_BASEBAND, {}});
+    }
+}
+
+/*! \brief A text message holds one or more lines of commands. */
+void RemoteControl::webMessage(const QString &message)
+{
+    const int index = findClient(sender());
+    if (index >= 0)
+        runLines(index, message.split('\n'));
+}
+
+/*! \brief Track the send queue of a WebSocket, which has no bytesToWrite(). */
+void RemoteControl::webBytesWritten(qint64 bytes)
+{
+    const int index = findClient(sender());
+    if (index >= 0)
+        rc_clients[index].web_queued = std::max<qint64>(rc_clients[index].web_queued - bytes, 0);
+}
+#endif
+
+/*! \brief Index of the client on a connection, -1 if it is not connected. */
+int RemoteControl::findClient(QObject *conn) const
+{
+    for (int i = 0; i < rc_clients.size(); i++)
+    {
+        if (rc_clients[i].conn == conn)
+            return i;
     }
+    return -1;
+}
+
+/*! \brief Send text, or binary data on a WebSocket, to a client. */
+void RemoteControl::write(Client &client, const QByteArray &data, bool binary)
+{
+    if (client.socket)
+    {
+        client.socket->write(data);
+        return;
+    }
+#ifdef WITH_WEBSOCKETS
+    if (binary)
+        client.web->sendBinaryMessage(data);
+    else
+        client.web->sendTextMessage(QString::fromLatin1(data));
+    client.web_queued += data.size();
+#else
+    Q_UNUSED(binary);
+#endif
+}
+
+/*! \brief Bytes waiting to be sent to a client. */
+qint64 RemoteControl::queuedBytes(const Client &client) const
+{
+    return client.socket ? client.socket->bytesToWrite() : client.web_queued;
+}
+
+void RemoteControl::clientDisconnected()
+{
+    // Only compared, the socket may be gone already
+    const int index = findClient(sender());
+    if (index >= 0)
+        closeClient(index);
+}
 
-    std::cout << "*** Remote connection attempt from " << address.toString().toStdString()
-              << " (not in allowed list)" << std::endl;
-    rc_socket->close();
-    rc_socket->deleteLater();
-    rc_socket = 0;
+/*! \brief Disconnect a client and forget its state. */
+void RemoteControl::closeClient(int index)
+{
+    const Client client = rc_clients[index];
+    stopFftStream(rc_clients[index]);
+    rc_clients.removeAt(index);
+    {
+        std::lock_guard<std::mutex> lock(rc_fft_mutex);
+        rc_fft_frames.erase(client.conn);
+    }
+    disconnect(client.conn, 0, this, 0);
+    if (client.socket)
+        client.socket->close();
+#ifdef WITH_WEBSOCKETS
+    else
+        client.web->close();
+#endif
+    client.conn->deleteLater();
 }
 
 /*! \brief Start reading from the socket.
  *
- * This slot is called when the client TCP socket emits a readyRead() signal,
+ * This slot is called when a client TCP socket emits a readyRead() signal,
  * i.e. when there is data to read.
  */
 void RemoteControl::startRead()
 {
-    while (rc_socket->canReadLine()) {
-        char    buffer[1024] = {0};
-        int     bytes_read;
-        QString answer = "";
+    TRACE_SCOPE("rc", "RemoteControl::startRead");
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    const int index = findClient(socket);
+    if (index < 0)
+        return;
 
-        bytes_read = rc_socket->readLine(buffer, 1024);
-        if (bytes_read < 2)  // command + '\n'
-            continue;
+    QStringList lines;
+    while (socket->canReadLine())
+        lines << QString::fromLatin1(socket->readLine());
+    runLines(index, lines);
+}
 
+/*! \brief Run the commands of a client and send all answers at once.
+ *
+ * A line can hold several commands separated by ';'. Pipelined lines and
+ * batches are answered in order with one write.
+ */
+void RemoteControl::runLines(int index, const QStringList &lines)
+{
+    // The commands below see the state of this client
+    hamlib_compatible = rc_clients[index].hamlib_compatible;
+    rc_current = index;
+
+    QByteArray reply;
+    for (const QString &line : lines)
+    {
+        for (const QString &command : line.split(';'))
+        {
 #if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
-        QStringList cmdlist = QString(buffer).trimmed().split(" ", QString::SkipEmptyParts);
+            QStringList cmdlist = command.trimmed().split(" ", QString::SkipEmptyParts);
 #else
-        QStringList cmdlist = QString(buffer).trimmed().split(" ", Qt::SkipEmptyParts);
+            QStringList cmdlist = command.trimmed().split(" ", Qt::SkipEmptyParts);
 #endif
+            if (cmdlist.size() == 0)
+                continue;
 
-        if (cmdlist.size() == 0)
-            continue;
+            if (cmdlist[0] == "q" || cmdlist[0] == "Q")
+            {
+                // FIXME: for now we assume 'close' command
+                if (!reply.isEmpty())
+                    write(rc_clients[index], reply);
+                rc_current = -1;
+                closeClient(index);
+                return;
+            }
+            reply += runCommand(cmdlist).toLatin1();
+
+            // A client reads back what it has just set
+            if (rc_state_timer.isActive())
+                publishState();
+
+            // Binary data goes in the stream for TCP, in a message of its own for WebSockets
+            if (!rc_attachment.isEmpty())
+            {
+                if (rc_clients[index].socket)
+                    reply += rc_attachment;
+                else
+                {
+                    write(rc_clients[index], reply);
+                    write(rc_clients[index], rc_attachment, true);
+                    reply.clear();
+                }
+                rc_attachment.clear();
+            }
+        }
+    }
+    if (!reply.isEmpty())
+        write(rc_clients[index], reply);
+
+    rc_clients[index].hamlib_compatible = hamlib_compatible;
+    rc_current = -1;
+    scheduleNotifications();
+}
+
+/*! \brief Run one command of the client being served and return its answer. */
+QString RemoteControl::runCommand(const QStringList &cmdlist)
+{
+    QString answer = "";
+    QString cmd = cmdlist[0];
+
+    if (cmd == "f")
+        answer = cmd_get_freq();
+    else if (cmd == "F")
+        answer = cmd_set_freq(cmdlist);
+    else if (cmd == "m")
+        answer = cmd_get_mode();
+    else if (cmd == "M")
+        answer = cmd_set_mode(cmdlist);
+    else if (cmd == "l")
+        answer = cmd_get_level(cmdlist);
+    else if (cmd == "L")
+        answer = cmd_set_level(cmdlist);
+    else if (cmd == "u")
+        answer = cmd_get_func(cmdlist);
+    else if (cmd == "U")
+        answer = cmd_set_func(cmdlist);
+    else if (cmd == "v")
+        answer = cmd_get_vfo();
+    else if (cmd == "V")
+        answer = cmd_set_vfo(cmdlist);
+    else if (cmd == "s")
+        answer = cmd_get_split_vfo();
+    else if (cmd == "S")
+        answer = cmd_set_split_vfo();
+    else if (cmd == "p")
+        answer = cmd_get_param(cmdlist);
+    else if (cmd == "_")
+        answer = cmd_get_info();
+    else if (cmd == "AOS")
+        answer = cmd_AOS();
+    else if (cmd == "LOS")
+        answer = cmd_LOS();
+    else if (cmd == "LNB_LO")
+        answer = cmd_lnb_lo(cmdlist);
+    else if (cmd == "\\chk_vfo")
+        answer = QString("0\n");
+    else if (cmd == "\\dump_state")
+        answer = cmd_dump_state();
+    else if (cmd == "\\get_powerstat")
+        answer = QString("1\n");
+    else if (cmd == "SUBSCRIBE")
+        answer = cmd_subscribe(cmdlist);
+    else if (cmd == "UNSUBSCRIBE")
+        answer = cmd_unsubscribe(cmdlist);
+    else if (cmd == "FFT_STREAM")
+        answer = cmd_fft_stream(cmdlist);
+    else if (cmd == "DOPPLER")
+        answer = cmd_doppler(cmdlist);
+    else if (cmd == "VFO")
+        answer = cmd_vfo(cmdlist);
+    else if (cmd == "IQSTREAM")
+        answer = cmd_iq_stream(cmdlist);
+    else if (cmd == "SCREENSHOT" && cmdlist.size() > 1)
+        answer = cmd_screenshot(cmdlist);
+    else if (cmd == "SCREENSHOT")
+    {
+        emit takeScreenshot();
+        answer = QString("RPRT 0\n");
+    }
+    else if (cmd == "HISTORY")
+        answer = cmd_history(cmdlist);
+    else if (cmd == "TILES")
+        answer = cmd_tiles();
+    else if (cmd == "TILE")
+        answer = cmd_tile(cmdlist);
+    else if (cmd == "TRACE")
+        answer = cmd_trace();
+    else if (cmd == "SUMMARY")
+        answer = cmd_summary(cmdlist);
+    else if (cmd == "SURVEY")
+        answer = cmd_survey(cmdlist);
+    else if (cmd == "CLUSTER")
+        answer = cmd_cluster(cmdlist);
+    else if (cmd == "IQCAPTURE")
+    {
+        QString reason = cmdlist.mid(1).join(' ');
+        emit iqCaptureRequested(reason.isEmpty() ? QString("Remote control") : reason);
+        answer = QString("RPRT 0\n");
+    }
+    else
+    {
+        // print unknown command and respond with an error
+        qWarning() << "Unknown remote command:" << cmdlist;
+        answer = QString("RPRT 1\n");
+    }
+
+    return answer;
+}
 
-        QString cmd = cmdlist[0];
-        if (cmd == "f")
-            answer = cmd_get_freq();
-        else if (cmd == "F")
-            answer = cmd_set_freq(cmdlist);
-        else if (cmd == "m")
-            answer = cmd_get_mode();
-        else if (cmd == "M")
-            answer = cmd_set_mode(cmdlist);
-        else if (cmd == "l")
-            answer = cmd_get_level(cmdlist);
-        else if (cmd == "L")
-            answer = cmd_set_level(cmdlist);
-        else if (cmd == "u")
-            answer = cmd_get_func(cmdlist);
-        else if (cmd == "U")
-            answer = cmd_set_func(cmdlist);
-        else if (cmd == "v")
-            answer = cmd_get_vfo();
-        else if (cmd == "V")
-            answer = cmd_set_vfo(cmdlist);
-        else if (cmd == "s")
-            answer = cmd_get_split_vfo();
-        else if (cmd == "S")
-            answer = cmd_set_split_vfo();
-        else if (cmd == "p")
-            answer = cmd_get_param(cmdlist);
-        else if (cmd == "_")
-            answer = cmd_get_info();
-        else if (cmd == "AOS")
-            answer = cmd_AOS();
-        else if (cmd == "LOS")
-            answer = cmd_LOS();
-        else if (cmd == "LNB_LO")
-            answer = cmd_lnb_lo(cmdlist);
-        else if (cmd == "\\chk_vfo")
-            answer = QString("0\n");
-        else if (cmd == "\\dump_state")
-            answer = cmd_dump_state();
-        else if (cmd == "\\get_powerstat")
-            answer = QString("1\n");
-        else if (cmd == "SCREENSHOT")
+/*! \brief Mark an item as changed for the clients subscribed to it.
+ *
+ * The lines are made from the current state when they are pushed, so a
+ * burst of changes, such as dragging the frequency, is pushed once with
+ * the last value.
+ */
+void RemoteControl::notify(const QString &item)
+{
+    bool wanted = false;
+    for (Client &client : rc_clients)
+    {
+        if (client.subscriptions.contains(item))
         {
-            emit takeScreenshot();
-            answer = QString("RPRT 0\n");
+            client.pending.insert(item);
+            wanted = true;
         }
-        else if (cmd == "q" || cmd == "Q")
+    }
+    // Pushed after the reply of a command that is being handled
+    if (wanted && rc_current < 0)
+        scheduleNotifications();
+}
+
+/*! \brief Start the timer for the next pending item that is due. */
+void RemoteControl::scheduleNotifications()
+{
+    const qint64 now = rc_clock.elapsed();
+    qint64 next = -1;
+
+    for (const Client &client : rc_clients)
+    {
+        for (const QString &item : client.pending)
         {
-            // FIXME: for now we assume 'close' command
-            rc_socket->close();
-            rc_socket->deleteLater();
-            rc_socket = 0;
-            return;
+            const qint64 due = client.last_sent.value(item, -1) < 0 ? now
+                             : client.last_sent.value(item) + client.subscriptions.value(item);
+            if (next < 0 || due < next)
+                next = due;
         }
-        else
+    }
+
+    if (next < 0)
+        return;
+    const int delay = (int)std::max<qint64>(next - now, 0);
+    if (!rc_notify_timer.isActive() || rc_notify_timer.remainingTime() > delay)
+        rc_notify_timer.start(delay);
+}
+
+/*! \brief Push the pending items that are due, the others wait for their interval. */
+void RemoteControl::sendNotifications()
+{
+    const qint64 now = rc_clock.elapsed();
+    const bool hamlib = hamlib_compatible;
+
+    for (Client &client : rc_clients)
+    {
+        QByteArray lines;
+        for (auto it = client.pending.begin(); it != client.pending.end(); )
         {
-            // print unknown command and respond with an error
-            qWarning() << "Unknown remote command:" << cmdlist;
-            answer = QString("RPRT 1\n");
+            const qint64 last = client.last_sent.value(*it, -1);
+            if (last >= 0 && now - last < client.subscriptions.value(*it))
+            {
+                ++it;
+                continue;
+            }
+            // Mode names as this client asked for them
+            hamlib_compatible = client.hamlib_compatible;
+            if (*it == "PACKET")
+            {
+                // A queue of their own rather than the latest value
+                lines += client.packets.join("").toLatin1();
+                client.packets.clear();
+            }
+            else
+            {
+                lines += itemLines(*it).toLatin1();
+            }
+            client.last_sent[*it] = now;
+            it = client.pending.erase(it);
+        }
+        if (!lines.isEmpty())
+            write(client, lines);
+    }
+
+    hamlib_compatible = hamlib;
+    scheduleNotifications();
+}
+
+/*! \brief Stop the FFT stream of a client, if it has one. */
+void RemoteControl::stopFftStream(Client &client)
+{
+    if (client.fft_sub)
+    {
+        rc_rx->unsubscribe_iq_fft(client.fft_sub);
+        client.fft_sub = 0;
+    }
+}
+
+/*! \brief Set the channel correction of the Doppler program for the current time.
+ *
+ * The correction is interpolated between the points and follows the rate
+ * after the last one. It runs in this thread and goes straight to the
+ * receiver, so neither the network nor the GUI adds jitter.
+ */
+void RemoteControl::applyDoppler()
+{
+    if (rc_doppler_points.empty())
+        return;
+
+    const double now = QDateTime::currentMSecsSinceEpoch() / 1000.0;
+    const auto &first = rc_doppler_points.front();
+    const auto &last = rc_doppler_points.back();
+    double offset;
+
+    if (now <= first.first)
+        offset = first.second;
+    else if (now >= last.first)
+        offset = last.second + rc_doppler_rate * (now - last.first);
+    else
+    {
+        auto next = std::upper_bound(rc_doppler_points.begin(), rc_doppler_points.end(),
+                                     std::make_pair(now, 0.0));
+        auto prev = next - 1;
+        offset = prev->second + (next->second - prev->second) *
+                 (now - prev->first) / (next->first - prev->first);
+    }
+    rc_rx->set_doppler_offset(offset);
+}
+
+/*! \brief Send the FFT frames handed over since the last call. */
+void RemoteControl::sendFftFrames()
+{
+    std::map<QTcpSocket *, FftHandover> frames;
+    {
+        std::lock_guard<std::mutex> lock(rc_fft_mutex);
+        frames.swap(rc_fft_frames);
+    }
+
+    for (const auto &entry : frames)
+    {
+        const int index = findClient(entry.first);
+        if (index >= 0 && rc_clients[index].fft_sub)
+        {
+            rc_clients[index].fft_dropped += entry.second.replaced;
+            sendFft(rc_clients[index], entry.second.frame);
         }
+    }
+}
+
+/*! \brief Write one FFT record to a client, or drop it if the client is behind.
+ *
+ * Records are written by this thread between the commands, so a record
+ * never lands inside a reply. The record is a header in little endian,
+ * described in remote-control.txt, and one level per bin in dBFS.
+ */
+void RemoteControl::sendFft(Client &client, const iq_fft_frame_sptr &frame)
+{
+    if (frame->data.empty())
+        return;
+
+    const int bins = (int)frame->data.size();
+    float offset = 0.0f;
+    float scale = 1.0f;
+    int item_size = sizeof(float);
+    if (client.fft_format == RC_FFT_I16)
+    {
+        scale = RC_FFT_I16_SCALE;
+        item_size = sizeof(qint16);
+    }
+    else if (client.fft_format == RC_FFT_I8)
+    {
+        offset = RC_FFT_I8_OFFSET;
+        scale = RC_FFT_I8_SCALE;
+        item_size = sizeof(qint8);
+    }
+
+    // Adapt the rate to the link: skip frames while the queue is deep
+    const qint64 size = RC_FFT_HEADER_SIZE + (qint64)bins * item_size;
+    if (queuedBytes(client) > std::min<qint64>(RC_FFT_QUEUE_FRAMES * size, RC_FFT_MAX_QUEUED))
+    {
+        client.fft_dropped++;
+        return;
+    }
+
+    QByteArray record(size, 0);
+    char *header = record.data();
+    put<quint32>(header, 0, RC_FFT_MAGIC);
+    put<quint16>(header, 4, (quint16)client.fft_format);
+    put<quint16>(header, 6, RC_FFT_HEADER_SIZE);
+    put<quint64>(header, 8, frame->seq);
+    put<qint64>(header, 16, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                frame->timestamp.time_since_epoch()).count());
+    put(header, 24, frame->center_freq);
+    put(header, 32, frame->sample_rate);
+    put(header, 40, offset);
+    put(header, 44, scale);
+    put<quint32>(header, 48, (quint32)bins);
+    put<quint32>(header, 52, client.fft_dropped);
+
+    // dBFS as in the plotter, scaled by the FFT size also for decimated frames
+    const float n = (float)(frame->fft_size > 0 ? frame->fft_size : bins);
+    const float norm = 1.0f / (n * n);
+    char *payload = header + RC_FFT_HEADER_SIZE;
+    for (int i = 0; i < bins; i++)
+    {
+        const float level = 10.0f * log10f(std::max(frame->data[i] * norm, 1e-20f));
+        if (client.fft_format == RC_FFT_F32)
+            put(payload, i * item_size, level);
+        else if (client.fft_format == RC_FFT_I16)
+            put<qint16>(payload, i * item_size,
+                        (qint16)qBound(-32768, qRound(level / scale), 32767));
+        else
+            payload[i] = (char)qBound(-128, qRound((level - offset) / scale), 127);
+    }
+
+    // A WebSocket message has its own length, TCP clients get a line first
+    if (client.socket)
+        write(client, QString("! FFT %1\n").arg(record.size()).toLatin1());
+    write(client, record, true);
+    client.fft_dropped = 0;
+}
 
-        rc_socket->write(answer.toLatin1());
+/*! \brief Lines pushed for a subscribed item, made from the current state. */
+QString RemoteControl::itemLines(const QString &item)
+{
+    if (item == "F")
+        return QString("! F %1\n").arg(rc_freq);
+    if (item == "M")
+        return QString("! M %1 %2\n").arg(intToModeStr(rc_mode))
+                                      .arg(rc_passband_hi - rc_passband_lo);
+    if (item == "STRENGTH")
+        return QString("! STRENGTH %1\n").arg((double)signal_level, 0, 'f', 1);
+    if (item == "RDS_PI")
+        return QString("! RDS_PI %1\n").arg(rc_program_id);
+    if (item == "DETECTOR")
+        return QString("! DETECTOR %1\n").arg(detector_status);
+    if (item == "DETECTIONS")
+    {
+        // The list of p DETECTIONS, one line per signal after the count
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+        QStringList list = detections.split('\n', QString::SkipEmptyParts);
+#else
+        QStringList list = detections.split('\n', Qt::SkipEmptyParts);
+#endif
+        if (list.isEmpty())
+            return QString("! DETECTIONS 0\n");
+        QString lines = QString("! DETECTIONS %1\n").arg(list.takeFirst());
+        for (const QString &signal : list)
+            lines += QString("! DETECTION %1\n").arg(signal);
+        return lines;
     }
+    return QString();
+}
+
+/*! \brief Note a change of the values in State.
+ *
+ * Changes from the GUI come in bursts, while dragging a slider for example,
+ * and are published together on the next meter tick or command.
+ */
+void RemoteControl::stateChanged()
+{
+    if (!rc_state_timer.isActive())
+        rc_state_timer.start();
+}
+
+/*! \brief Publish a new State for the read commands. */
+void RemoteControl::publishState()
+{
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->freq = rc_freq;
+    state->mode = rc_mode;
+    state->passband = rc_passband_hi - rc_passband_lo;
+    state->level = signal_level;
+    state->squelch = squelch_level;
+    state->audio_gain = audio_gain;
+    state->muted = is_audio_muted;
+    state->rds_pi = rc_program_id;
+    state->rds_station = rds_station;
+    state->rds_radiotext = rds_radiotext;
+    std::atomic_store(&rc_state, std::shared_ptr<const State>(state));
+
+    rc_state_timer.stop();
 }
 
 /*! \brief Slot called when the receiver is tuned to a new frequency.
@@ -290,7 +978,11 @@ void RemoteControl::startRead()
  */
 void RemoteControl::setNewFrequency(qint64 freq)
 {
+    if (freq == rc_freq)
+        return;
     rc_freq = freq;
+    stateChanged();
+    notify("F");
 }
 
 /*! \brief Slot called when the filter offset is changed. */
@@ -309,6 +1001,8 @@ void RemoteControl::setLnbLo(double freq_mhz)
 
 void RemoteControl::setBandwidth(qint64 bw)
 {
+    rc_bandwidth = bw;
+
     // we want to leave some margin
     bw_half = (qint64)(0.9f * (bw / 2.f));
 }
@@ -316,13 +1010,21 @@ void RemoteControl::setBandwidth(qint64 bw)
 /*! \brief Set signal level in dBFS. */
 void RemoteControl::setSignalLevel(float level)
 {
+    // Pushed on every meter update, at most at the rate of each subscriber
     signal_level = level;
+    publishState();
+    notify("STRENGTH");
 }
 
 /*! \brief Set demodulator (from mainwindow). */
 void RemoteControl::setMode(int mode)
 {
-    rc_mode = mode;
+    if (mode != rc_mode)
+    {
+        rc_mode = mode;
+        stateChanged();
+        notify("M");
+    }
 
     if (rc_mode == 0)
         audio_recorder_status = false;
@@ -331,8 +1033,11 @@ void RemoteControl::setMode(int mode)
 /*! \brief Set passband (from mainwindow). */
 void RemoteControl::setPassband(int passband_lo, int passband_hi)
 {
+    if (passband_hi - passband_lo != rc_passband_hi - rc_passband_lo)
+        notify("M");
     rc_passband_lo = passband_lo;
     rc_passband_hi = passband_hi;
+    stateChanged();
 }
 
 /*! \brief New remote frequency received. */
@@ -360,25 +1065,32 @@ void RemoteControl::setNewRemoteFreq(qint64 freq)
         emit newFrequency(freq);
     }
 
+    // The GUI reports the new frequency later, when it is already known here
+    if (freq != rc_freq)
+        notify("F");
     rc_freq = freq;
+    stateChanged();
 }
 
 /*! \brief Set squelch level (from mainwindow). */
 void RemoteControl::setSquelchLevel(double level)
 {
     squelch_level = level;
+    stateChanged();
 }
 
 /*! \brief Set audio gain (from mainwindow). */
 void RemoteControl::setAudioGain(float gain)
 {
     audio_gain = gain;
+    stateChanged();
 }
 
 /*! \brief Set audio muted (from mainwindow). */
 void RemoteControl::setAudioMuted(bool muted)
 {
     is_audio_muted = muted;
+    stateChanged();
 }
 
 /*! \brief Start audio recorder (from mainwindow). */
@@ -414,7 +1126,7 @@ void RemoteControl::setReceiverStatus(bool enabled)
 }
 
 /*! \brief Set available gain settings (from mainwindow). */
-void RemoteControl::setGainStages(gain_list_t &gain_list)
+void RemoteControl::setGainStages(const gain_list_t &gain_list)
 {
     gains = gain_list;
 }
@@ -439,28 +1151,35 @@ bool RemoteControl::setGain(QString name, double gain)
 /*! \brief Set RDS program identification (from RDS parser). */
 void RemoteControl::rdsPI(QString program_id)
 {
+    if (program_id == rc_program_id)
+        return;
     rc_program_id = program_id;
+    stateChanged();
+    notify("RDS_PI");
 }
 
 /*! \brief Set RDS status (from RDS dock). */
 void RemoteControl::setRDSstatus(bool enabled)
 {
     rds_status = enabled;
-    rc_program_id = "0000";
+    rdsPI("0000");
     rds_station = "";
     rds_radiotext = "";
+    stateChanged();
 }
 
 /*! \brief Set RDS program service (station) name. */
 void RemoteControl::setRdsStation(QString name)
 {
     rds_station = name;
+    stateChanged();
 }
 
 /*! \brief Set RDS Radiotext. */
 void RemoteControl::setRdsRadiotext(QString text)
 {
     rds_radiotext = text;
+    stateChanged();
 }
 
 
@@ -607,7 +1326,7 @@ QString RemoteControl::intToModeStr(int mode)
 /* Get frequency */
 QString RemoteControl::cmd_get_freq() const
 {
-    return QString("%1\n").arg(rc_freq);
+    return QString("%1\n").arg(state()->freq);
 }
 
 /* Set new frequency */
@@ -628,9 +1347,10 @@ QString RemoteControl::cmd_set_freq(QStringList cmdlist)
 /* Get mode and passband */
 QString RemoteControl::cmd_get_mode()
 {
+    std::shared_ptr<const State> s = state();
     return QString("%1\n%2\n")
-                   .arg(intToModeStr(rc_mode))
-                   .arg(rc_passband_hi - rc_passband_lo);
+                   .arg(intToModeStr(s->mode))
+                   .arg(s->passband);
 }
 
 /* Set mode and passband */
@@ -651,7 +1371,10 @@ QString RemoteControl::cmd_set_mode(QStringList cmdlist)
         }
         else
         {
+            if (mode != rc_mode)
+                notify("M");
             rc_mode = mode;
+            stateChanged();
             emit newMode(rc_mode);
 
             int passband = cmdlist.value(2, "0").toInt();
@@ -682,15 +1405,15 @@ QString RemoteControl::cmd_get_level(QStringList cmdlist)
     }
     else if (lvl.compare("STRENGTH", Qt::CaseInsensitive) == 0 || lvl.isEmpty())
     {
-        answer = QString("%1\n").arg((double)signal_level, 0, 'f', 1);
+        answer = QString("%1\n").arg((double)state()->level, 0, 'f', 1);
     }
     else if (lvl.compare("SQL", Qt::CaseInsensitive) == 0)
     {
-        answer = QString("%1\n").arg((double)squelch_level, 0, 'f', 1);
+        answer = QString("%1\n").arg(state()->squelch, 0, 'f', 1);
     }
     else if (lvl.compare("AF", Qt::CaseInsensitive) == 0)
     {
-        answer = QString("%1\n").arg((double)audio_gain, 0, 'f', 1);
+        answer = QString("%1\n").arg((double)state()->audio_gain, 0, 'f', 1);
     }
     else if (lvl.compare("WF_MIN_DB", Qt::CaseInsensitive) == 0)
     {
@@ -742,6 +1465,7 @@ QString RemoteControl::cmd_set_level(QStringList cmdlist)
         {
             answer = QString("RPRT 0\n");
             squelch_level = std::max<double>(-150, std::min<double>(0, squelch));
+            stateChanged();
             emit newSquelchLevel(squelch_level);
         }
         else
@@ -820,7 +1544,7 @@ QString RemoteControl::cmd_get_func(QStringList cmdlist)
     QString func = cmdlist.value(1, "");
 
     if (func == "?")
-        answer = QString("RECORD IQRECORD DSP RDS MUTE\n");
+        answer = QString("RECORD IQRECORD DSP RDS MUTE TIMING PERF DETECTOR NOTIFY\n");
     else if (func.compare("RECORD", Qt::CaseInsensitive) == 0)
         answer = QString("%1\n").arg(audio_recorder_status);
     else if (func.compare("IQRECORD", Qt::CaseInsensitive) == 0)
@@ -830,7 +1554,20 @@ QString RemoteControl::cmd_get_func(QStringList cmdlist)
     else if (func.compare("RDS", Qt::CaseInsensitive) == 0)
         answer = QString("%1\n").arg(rds_status);
     else if (func.compare("MUTE", Qt::CaseInsensitive) == 0)
-        answer = QString("%1\n").arg(is_audio_muted ? '1' : '0');
+        answer = QString("%1\n").arg(state()->muted ? '1' : '0');
+    else if (func.compare("TIMING", Qt::CaseInsensitive) == 0)
+        answer = QString("%1\n").arg(render_timing_status);
+    else if (func.compare("PERF", Qt::CaseInsensitive) == 0)
+        answer = QString("%1\n").arg(perf_status);
+    else if (func.compare("DETECTOR", Qt::CaseInsensitive) == 0)
+        answer = QString("%1\n").arg(detector_status);
+    else if (func.compare("NOTIFY", Qt::CaseInsensitive) == 0 && rc_current >= 0)
+    {
+        bool all = true;
+        for (const QString &item : QString(RC_NOTIFY_ITEMS).split(' '))
+            all &= rc_clients[rc_current].subscriptions.contains(item);
+        answer = QString("%1\n").arg(all);
+    }
     else
         answer = QString("RPRT 1\n");
 
@@ -847,7 +1584,7 @@ QString RemoteControl::cmd_set_func(QStringList cmdlist)
 
     if (func == "?")
     {
-        answer = QString("RECORD IQRECORD DSP RDS MUTE\n");
+        answer = QString("RECORD IQRECORD DSP RDS MUTE TIMING PERF DETECTOR NOTIFY\n");
     }
     else if ((func.compare("RECORD", Qt::CaseInsensitive) == 0) && ok)
     {
@@ -908,14 +1645,36 @@ QString RemoteControl::cmd_set_func(QStringList cmdlist)
 
         answer = QString("RPRT 0\n");
     }
-    else
+    else if ((func.compare("TIMING", Qt::CaseInsensitive) == 0) && ok)
     {
-        answer = QString("RPRT 1\n");
+        emit renderTimingChanged(status != 0);
+        answer = QString("RPRT 0\n");
+    }
+    else if ((func.compare("PERF", Qt::CaseInsensitive) == 0) && ok)
+    {
+        emit perfCountersChanged(status != 0);
+        answer = QString("RPRT 0\n");
+    }
+    else if ((func.compare("DETECTOR", Qt::CaseInsensitive) == 0) && ok)
+    {
+        emit detectorChanged(status != 0);
+        answer = QString("RPRT 0\n");
+    }
+    else if ((func.compare("NOTIFY", Qt::CaseInsensitive) == 0) && ok)
+    {
+        // Short for SUBSCRIBE or UNSUBSCRIBE of each item
+        for (const QString &item : QString(RC_NOTIFY_ITEMS).split(' '))
+            answer = status ? cmd_subscribe({"SUBSCRIBE", item})
+                            : cmd_unsubscribe({"UNSUBSCRIBE", item});
+    }
+    else
+    {
+        answer = QString("RPRT 1\n");
     }
 
-    return answer;
-}
-
+    return answer;
+}
+
 /* Get parameter */
 QString RemoteControl::cmd_get_param(QStringList cmdlist)
 {
@@ -923,13 +1682,19 @@ QString RemoteControl::cmd_get_param(QStringList cmdlist)
     QString func = cmdlist.value(1, "");
 
     if (func == "?")
-        answer = QString("RDS_PI RDS_PS_NAME RDS_RADIOTEXT\n");
+        answer = QString("RDS_PI RDS_PS_NAME RDS_RADIOTEXT RENDER_TIMING PERF DETECTIONS\n");
     else if (func.compare("RDS_PI", Qt::CaseInsensitive) == 0)
-        answer = QString("%1\n").arg(rc_program_id);
+        answer = QString("%1\n").arg(state()->rds_pi);
     else if (func.compare("RDS_PS_NAME", Qt::CaseInsensitive) == 0)
-        answer = QString("%1\n").arg(rds_station);
+        answer = QString("%1\n").arg(state()->rds_station);
     else if (func.compare("RDS_RADIOTEXT", Qt::CaseInsensitive) == 0)
-        answer = QString("%1\n").arg(rds_radiotext);
+        answer = QString("%1\n").arg(state()->rds_radiotext);
+    else if (func.compare("RENDER_TIMING", Qt::CaseInsensitive) == 0)
+        answer = QString("%1\n").arg(render_timing);
+    else if (func.compare("PERF", Qt::CaseInsensitive) == 0)
+        answer = QString("%1\n%2").arg(block_perf.count('\n')).arg(block_perf);
+    else if (func.compare("DETECTIONS", Qt::CaseInsensitive) == 0)
+        answer = QString("%1\n%2").arg(detections.count('\n')).arg(detections);
     else
         answer = QString("RPRT 1\n");
 
@@ -1018,6 +1783,726 @@ QString RemoteControl::cmd_lnb_lo(QStringList cmdlist)
     }
 }
 
+/*
+ * Subscribe this client to pushed updates of an item, at most rate times
+ * per second if a rate is given. The current value is pushed right away.
+ */
+QString RemoteControl::cmd_subscribe(QStringList cmdlist)
+{
+    if (rc_current < 0)
+        return QString("RPRT 1\n");
+    Client &client = rc_clients[rc_current];
+
+    QString item = cmdlist.value(1, "").toUpper();
+    if (item == "?")
+        return QString(RC_SUBSCRIBE_ITEMS "\n");
+
+    if (item.isEmpty())
+    {
+        // List the subscriptions with their rate, 0 for every change
+        QStringList list;
+        for (auto it = client.subscriptions.constBegin(); it != client.subscriptions.constEnd(); ++it)
+            list << QString("%1:%2").arg(it.key())
+                                    .arg(it.value() > 0 ? 1000.0 / it.value() : 0.0);
+        return list.join(" ") + "\n";
+    }
+
+    if (!QString(RC_SUBSCRIBE_ITEMS).split(' ').contains(item))
+        return QString("RPRT 1\n");
+
+    bool ok = true;
+    const double rate = cmdlist.size() > 2 ? cmdlist[2].toDouble(&ok) : 0.0;
+    if (!ok || rate < 0.0)
+        return QString("RPRT 1\n");
+
+    client.subscriptions[item] = rate > 0.0 ? (qint64)(1000.0 / rate) : 0;
+    client.last_sent.remove(item);
+    client.pending.insert(item);
+    return QString("RPRT 0\n");
+}
+
+/* Stop the pushed updates of an item, or of all items */
+QString RemoteControl::cmd_unsubscribe(QStringList cmdlist)
+{
+    if (rc_current < 0)
+        return QString("RPRT 1\n");
+    Client &client = rc_clients[rc_current];
+
+    const QString item = cmdlist.value(1, "ALL").toUpper();
+    if (item == "ALL")
+    {
+        client.subscriptions.clear();
+        client.pending.clear();
+    }
+    else
+    {
+        client.subscriptions.remove(item);
+        client.pending.remove(item);
+    }
+    return QString("RPRT 0\n");
+}
+
+/* Stream the FFT frames of a spectrum tap to this client as binary records */
+QString RemoteControl::cmd_fft_stream(QStringList cmdlist)
+{
+    if (rc_current < 0)
+        return QString("RPRT 1\n");
+    Client &client = rc_clients[rc_current];
+    const QStringList formats = QString(RC_FFT_FORMATS).split(' ');
+
+    const QString arg = cmdlist.value(1, "").toUpper();
+    if (arg == "?")
+        return QString(RC_FFT_FORMATS "\n");
+
+    if (arg.isEmpty())
+    {
+        if (!client.fft_sub)
+            return QString("OFF\n");
+        return QString("%1 %2 %3 %4\n").arg(client.fft_rate).arg(client.fft_bins)
+                                        .arg(formats[client.fft_format - 1])
+                                        .arg(QString(RC_FFT_TAPS).split(' ')[client.fft_tap]);
+    }
+
+    if (arg == "OFF")
+    {
+        stopFftStream(client);
+        return QString("RPRT 0\n");
+    }
+
+    bool rate_ok;
+    bool bins_ok = true;
+    const double rate = arg.toDouble(&rate_ok);
+    const unsigned int bins = cmdlist.size() > 2 ? cmdlist[2].toUInt(&bins_ok) : 0;
+    const int format = formats.indexOf(cmdlist.value(3, "I16").toUpper()) + 1;
+    const int tap = QString(RC_FFT_TAPS).split(' ').indexOf(cmdlist.value(4, "BASEBAND").toUpper());
+    if (!rate_ok || rate < 0.0 || !bins_ok || format == 0 || tap < 0)
+        return QString("RPRT 1\n");
+
+    // The receiver decimates once for all clients that ask for the same size
+    stopFftStream(client);
+    client.fft_rate = rate;
+    client.fft_bins = bins;
+    client.fft_format = format;
+    client.fft_dropped = 0;
+    client.fft_tap = tap;
+    // Called on the GUI thread; only the latest frame waits for this thread
+    QObject *conn = client.conn;
+    client.fft_sub = rc_rx->subscribe_iq_fft([this, conn](const iq_fft_frame_sptr &frame) {
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(rc_fft_mutex);
+            idle = rc_fft_frames.empty();
+            FftHandover &handover = rc_fft_frames[conn];
+            if (handover.frame)
+                handover.replaced++;
+            handover.frame = frame;
+        }
+        if (idle)
+            QMetaObject::invokeMethod(this, "sendFftFrames", Qt::QueuedConnection);
+    }, rate, bins, (receiver::fft_tap)tap);
+    return QString("RPRT 0\n");
+}
+
+/*
+ * Doppler program of the demodulator channel:
+ *   DOPPLER                           current correction in Hz
+ *   DOPPLER <time> <Hz> [<time> <Hz> ...]   replace the program
+ *   DOPPLER ADD <time> <Hz> [...]     add points after the last one
+ *   DOPPLER RATE <Hz> <Hz/s> [time]   linear correction from time, default now
+ *   DOPPLER OFF                       stop, the correction goes back to 0
+ */
+QString RemoteControl::cmd_doppler(QStringList cmdlist)
+{
+    const QString arg = cmdlist.value(1, "").toUpper();
+
+    if (arg.isEmpty())
+        return QString("%1\n").arg(rc_rx->get_doppler_offset(), 0, 'f', 1);
+
+    if (arg == "OFF")
+    {
+        rc_doppler_timer.stop();
+        rc_doppler_points.clear();
+        rc_doppler_rate = 0.0;
+        rc_rx->set_doppler_offset(0.0);
+        return QString("RPRT 0\n");
+    }
+
+    std::vector<std::pair<double, double>> points;
+    double rate = 0.0;
+    bool ok = true;
+
+    if (arg == "RATE")
+    {
+        bool rate_ok;
+        const double offset = cmdlist.value(2, "").toDouble(&ok);
+        rate = cmdlist.value(3, "").toDouble(&rate_ok);
+        bool start_ok = true;
+        const double start = cmdlist.size() > 4 ? cmdlist[4].toDouble(&start_ok)
+                                                : QDateTime::currentMSecsSinceEpoch() / 1000.0;
+        if (!ok || !rate_ok || !start_ok)
+            return QString("RPRT 1\n");
+        points.emplace_back(start, offset);
+    }
+    else
+    {
+        const bool add = (arg == "ADD");
+        const int first = add ? 2 : 1;
+        if (add)
+        {
+            points = rc_doppler_points;
+            rate = rc_doppler_rate;
+        }
+        if (cmdlist.size() <= first || (cmdlist.size() - first) % 2 != 0)
+            return QString("RPRT 1\n");
+
+        for (int i = first; ok && i < cmdlist.size(); i += 2)
+        {
+            bool hz_ok;
+            const double time = cmdlist[i].toDouble(&ok);
+            const double offset = cmdlist[i + 1].toDouble(&hz_ok);
+            // Points must come in time order
+            ok = ok && hz_ok && (points.empty() || time > points.back().first);
+            points.emplace_back(time, offset);
+        }
+        if (!ok)
+            return QString("RPRT 1\n");
+    }
+
+    rc_doppler_points = points;
+    rc_doppler_rate = rate;
+    applyDoppler();
+    rc_doppler_timer.start();
+    return QString("RPRT 0\n");
+}
+
+/*
+ * Additional VFOs, numbered 1 to RC_VFO_MAX by the client:
+ *   VFO                                  list them
+ *   VFO <n> <freq> <mode> [passband]     add or retune
+ *   VFO <n> OFF|STRENGTH
+ *   VFO <n> MUTE|RECORD|AFSK <status>
+ *   VFO <n> SQL <level>
+ *   VFO <n> UDP <host> <port> [stereo] [format] | VFO <n> UDP OFF
+ *   VFO CHANNELS [<channels>|OFF]        channelizer feeding the VFOs
+ * The main window applies the changes.
+ */
+QString RemoteControl::cmd_vfo(QStringList cmdlist)
+{
+    if (cmdlist.size() == 1)
+    {
+        QString answer = QString("%1\n").arg(rc_vfos.size());
+        for (auto it = rc_vfos.constBegin(); it != rc_vfos.constEnd(); ++it)
+            answer += QString("%1 %2 %3 %4 %5 %6 %7\n").arg(it.key()).arg(it->freq)
+                      .arg(intToModeStr(it->mode)).arg(it->passband)
+                      .arg(it->muted).arg(it->recording).arg(it->afsk);
+        return answer;
+    }
+
+    bool ok;
+    if (cmdlist[1].toUpper() == "CHANNELS")
+    {
+        if (cmdlist.size() == 2)
+            return QString("%1
+").arg(rc_vfo_channels);
+
+        const QString arg = cmdlist[2].toUpper();
+        const int channels = (arg == "OFF") ? 0 : arg.toInt(&ok);
+        if ((arg != "OFF" && !ok) || channels < 0 || channels > RC_VFO_CHANNELS_MAX
+            || channels == 1 || channels % 2 != 0)
+            return QString("RPRT 1\n");
+        rc_vfo_channels = channels;
+        emit newVfoChannels(channels);
+        return QString("RPRT 0\n");
+    }
+
+    const int n = cmdlist[1].toInt(&ok);
+    const QString arg = cmdlist.value(2, "").toUpper();
+    if (!ok || n < 1 || n > RC_VFO_MAX || arg.isEmpty())
+        return QString("RPRT 1\n");
+
+    bool freq_ok;
+    const double freq = cmdlist[2].toDouble(&freq_ok);
+    if (freq_ok)
+    {
+        const int mode = modeStrToInt(cmdlist.value(3, ""));
+        const int passband = cmdlist.value(4, "0").toInt(&ok);
+        if (mode <= 0 || !ok || passband < 0)
+            return QString("RPRT 1\n");
+
+        if (!rc_vfos.contains(n))
+            rc_vfos.insert(n, Vfo{0, 0, 0, false, 0, false, -200.0f});
+        Vfo &vfo = rc_vfos[n];
+        vfo.freq = (qint64)freq;
+        vfo.mode = mode;
+        vfo.passband = passband;
+        emit newVfo(n, vfo.freq, mode, passband);
+        return QString("RPRT 0\n");
+    }
+
+    if (!rc_vfos.contains(n))
+        return QString("RPRT 1\n");
+    Vfo &vfo = rc_vfos[n];
+
+    if (arg == "OFF")
+    {
+        rc_vfos.remove(n);
+        rc_iq_streams.remove(n);
+        emit vfoRemoved(n);
+    }
+    else if (arg == "STRENGTH")
+    {
+        return QString("%1\n").arg((double)vfo.level, 0, 'f', 1);
+    }
+    else if ((arg == "MUTE" || arg == "RECORD" || arg == "AFSK") && cmdlist.size() == 4)
+    {
+        const int status = cmdlist[3].toInt(&ok);
+        const bool enabled = status != 0;
+        if (!ok || (arg == "RECORD" && (status < 0 || status > 2)))
+            return QString("RPRT 1\n");
+        if (arg == "MUTE")
+        {
+            vfo.muted = enabled;
+            emit newVfoMuted(n, enabled);
+        }
+        else if (arg == "RECORD")
+        {
+            vfo.recording = status;
+            emit newVfoRecording(n, status);
+        }
+        else
+        {
+            vfo.afsk = enabled;
+            emit newVfoAfsk(n, enabled);
+        }
+    }
+    else if (arg == "SQL" && cmdlist.size() == 4)
+    {
+        const double level = cmdlist[3].toDouble(&ok);
+        if (!ok)
+            return QString("RPRT 1\n");
+        emit newVfoSquelchLevel(n, std::max<double>(-150, std::min<double>(0, level)));
+    }
+    else if (arg == "UDP" && cmdlist.value(3, "").toUpper() == "OFF")
+    {
+        emit newVfoUdpStreaming(n, QString(), 0, false, 0);
+    }
+    else if (arg == "UDP" && cmdlist.size() >= 5)
+    {
+        const int port = cmdlist[4].toInt(&ok);
+        if (!ok || port < 1 || port > 65535)
+            return QString("RPRT 1\n");
+        // Same values as udp_stream_format
+        const int format = QStringList({"RAW", "RTP", "OPUS"}).indexOf(cmdlist.value(6, "RAW").toUpper());
+        if (format < 0)
+            return QString("RPRT 1\n");
+        emit newVfoUdpStreaming(n, cmdlist[3], port, cmdlist.value(5, "0").toInt() != 0, format);
+    }
+    else
+    {
+        return QString("RPRT 1\n");
+    }
+    return QString("RPRT 0\n");
+}
+
+/*
+ * I/Q streams to the network, of the baseband or of a VFO:
+ *   IQSTREAM                                       list them
+ *   IQSTREAM BASEBAND|<n> TCP <port> [format]      serve TCP clients
+ *   IQSTREAM BASEBAND|<n> MCAST <group> <port> [format]
+ *   IQSTREAM BASEBAND|<n> OFF
+ * Each source has at most one stream, a new one replaces it. The main
+ * window applies the changes.
+ */
+QString RemoteControl::cmd_iq_stream(QStringList cmdlist)
+{
+    // Same order as iq_file_format
+    static const QStringList formats = {"CF32", "CS16", "CS8"};
+
+    if (cmdlist.size() == 1)
+    {
+        QString answer = QString("%1\n").arg(rc_iq_streams.size());
+        for (auto it = rc_iq_streams.constBegin(); it != rc_iq_streams.constEnd(); ++it)
+        {
+            const QString source = it.key() == 0 ? QString("BASEBAND") : QString::number(it.key());
+            if (it->tcp_port > 0)
+                answer += QString("%1 TCP %2 %3\n").arg(source).arg(it->tcp_port)
+                          .arg(formats[it->format]);
+            else
+                answer += QString("%1 MCAST %2 %3 %4\n").arg(source).arg(it->group)
+                          .arg(it->udp_port).arg(formats[it->format]);
+        }
+        return answer;
+    }
+
+    bool ok = true;
+    const int source = cmdlist[1].toUpper() == "BASEBAND" ? 0 : cmdlist[1].toInt(&ok);
+    const QString arg = cmdlist.value(2, "").toUpper();
+    if (!ok || source < 0 || source > RC_VFO_MAX || (source > 0 && !rc_vfos.contains(source)))
+        return QString("RPRT 1\n");
+
+    IqStream stream{0, QString(), 0, 0};
+    int format_arg;
+    if (arg == "OFF" && cmdlist.size() == 3)
+    {
+        rc_iq_streams.remove(source);
+        emit newIqStream(source, 0, 0, QString(), 0);
+        return QString("RPRT 0\n");
+    }
+    else if (arg == "TCP" && (cmdlist.size() == 4 || cmdlist.size() == 5))
+    {
+        stream.tcp_port = cmdlist[3].toInt(&ok);
+        if (!ok || stream.tcp_port < 1 || stream.tcp_port > 65535)
+            return QString("RPRT 1\n");
+        format_arg = 4;
+    }
+    else if (arg == "MCAST" && (cmdlist.size() == 5 || cmdlist.size() == 6))
+    {
+        stream.group = cmdlist[3];
+        stream.udp_port = cmdlist[4].toInt(&ok);
+        if (!ok || stream.udp_port < 1 || stream.udp_port > 65535)
+            return QString("RPRT 1\n");
+        format_arg = 5;
+    }
+    else
+    {
+        return QString("RPRT 1\n");
+    }
+
+    stream.format = formats.indexOf(cmdlist.value(format_arg, "CF32").toUpper());
+    if (stream.format < 0)
+        return QString("RPRT 1\n");
+
+    rc_iq_streams[source] = stream;
+    emit newIqStream(source, stream.format, stream.tcp_port, stream.group, stream.udp_port);
+    return QString("RPRT 0\n");
+}
+
+/*
+ * Render the waterfall offscreen and answer with the image:
+ *   SCREENSHOT PNG|JPG [width] [start Hz] [end Hz]
+ * The reply is the size in bytes on a line of its own, then the image.
+ * The whole band is shown unless a range is given.
+ */
+QString RemoteControl::cmd_screenshot(QStringList cmdlist)
+{
+    const QString format = cmdlist[1].toUpper();
+    if (!rc_snapshot || (format != "PNG" && format != "JPG"))
+        return QString("RPRT 1\n");
+
+    bool ok = true;
+    const int width = cmdlist.size() > 2 ? cmdlist[2].toInt(&ok) : RC_SCREENSHOT_WIDTH;
+    if (!ok || width < 16 || width > RC_SCREENSHOT_MAX_WIDTH)
+        return QString("RPRT 1\n");
+
+    // The snapshot has hardware frequencies, without the LNB LO
+    const double lnb_lo = rc_lnb_lo_mhz * 1.0e6;
+    double start = (double)(rc_freq - rc_filter_offset) - lnb_lo - rc_bandwidth / 2.0;
+    double end = start + rc_bandwidth;
+    if (cmdlist.size() > 3)
+    {
+        bool end_ok;
+        start = cmdlist[3].toDouble(&ok) - lnb_lo;
+        end = cmdlist.value(4, "").toDouble(&end_ok) - lnb_lo;
+        ok = ok && end_ok;
+    }
+    if (!ok || end <= start)
+        return QString("RPRT 1\n");
+
+    // Drawn with the colors of the main window
+    rc_snapshot->setRange(waterfall_min_db, waterfall_max_db);
+    if (!wf_colormap.isEmpty())
+        rc_snapshot->setColormap(wf_colormap);
+    const QByteArray image = CWaterfallSnapshot::encode(
+        rc_snapshot->render(start, end, width, 0, RC_SCREENSHOT_SPECTRUM), qPrintable(format));
+    if (image.isEmpty())
+        return QString("RPRT 1\n");
+
+    rc_attachment = image;
+    return QString("%1\n").arg(image.size());
+}
+
+/*
+ * Answer with the levels of the waterfall history on a grid:
+ *   HISTORY MAX|AVG <seconds> <columns> <rows> [start Hz] [end Hz]
+ * The reply is the size in bytes and the time the history covers [ms] on a
+ * line of its own, then rows * columns little endian float32 dBFS, newest
+ * row first, NaN where there is no data.
+ */
+QString RemoteControl::cmd_history(QStringList cmdlist)
+{
+    const QString mode = cmdlist.value(1, "").toUpper();
+    if (!rc_snapshot || (mode != "MAX" && mode != "AVG"))
+        return QString("RPRT 1\n");
+
+    bool seconds_ok, columns_ok, rows_ok, ok = true;
+    const double seconds = cmdlist.value(2, "").toDouble(&seconds_ok);
+    const int columns = cmdlist.value(3, "").toInt(&columns_ok);
+    const int rows = cmdlist.value(4, "").toInt(&rows_ok);
+    if (!seconds_ok || !columns_ok || !rows_ok || seconds * 1000.0 < 1.0 ||
+        columns < 1 || columns > RC_SCREENSHOT_MAX_WIDTH || rows < 1 || rows > RC_HISTORY_MAX_ROWS)
+        return QString("RPRT 1\n");
+
+    // As SCREENSHOT, the snapshot has hardware frequencies
+    const double lnb_lo = rc_lnb_lo_mhz * 1.0e6;
+    double start = (double)(rc_freq - rc_filter_offset) - lnb_lo - rc_bandwidth / 2.0;
+    double end = start + rc_bandwidth;
+    if (cmdlist.size() > 5)
+    {
+        bool end_ok;
+        start = cmdlist[5].toDouble(&ok) - lnb_lo;
+        end = cmdlist.value(6, "").toDouble(&end_ok) - lnb_lo;
+        ok = ok && end_ok;
+    }
+    if (!ok || end <= start)
+        return QString("RPRT 1\n");
+
+    std::vector<float> levels;
+    uint64_t covered_ms;
+    if (rc_snapshot->history(start, end, columns, rows, (uint64_t)(seconds * 1000.0),
+                             mode == "MAX", levels, covered_ms) == 0)
+        return QString("RPRT 1\n");
+
+    QByteArray data(levels.size() * sizeof(float), Qt::Uninitialized);
+    for (size_t i = 0; i < levels.size(); i++)
+        put(data.data(), (int)(i * sizeof(float)), levels[i]);
+
+    rc_attachment = data;
+    return QString("%1 %2\n").arg(data.size()).arg(covered_ms);
+}
+
+/*
+ * Describe the tile pyramid of the waterfall: a line with the zoom levels,
+ * the tile size, the band [Hz], the lines and the times of the first and
+ * the newest line [ms since the epoch], then a line per zoom with the y of
+ * the oldest tile kept and of the one being filled.
+ */
+QString RemoteControl::cmd_tiles() const
+{
+    CWaterfallTiles::Info info;
+    if (!rc_tiles || !rc_tiles->info(info))
+        return QString("RPRT 1\n");
+
+    // The tiles have hardware frequencies, without the LNB LO
+    const double lnb_lo = rc_lnb_lo_mhz * 1.0e6;
+    QString answer = QString("%1 %2 %3 %4 %5 %6 %7\n")
+                     .arg(WF_TILES_ZOOMS).arg(WF_TILES_SIZE)
+                     .arg((qint64)std::llround(info.startFreq + lnb_lo))
+                     .arg((qint64)std::llround(info.endFreq + lnb_lo))
+                     .arg(info.lines).arg(info.firstMs).arg(info.lastMs);
+    for (int zoom = 0; zoom < WF_TILES_ZOOMS; zoom++)
+        answer += QString("%1 %2\n").arg(info.oldest[zoom]).arg(info.newest[zoom]);
+    return answer;
+}
+
+/*
+ * Answer with a tile of the waterfall pyramid:
+ *   TILE <zoom> <x> <y>
+ * The reply is the size in bytes on a line of its own, then the tile as
+ * qCompress() stores it: the size of the levels in 4 bytes big endian, then
+ * a zlib stream.
+ */
+QString RemoteControl::cmd_tile(QStringList cmdlist)
+{
+    bool zoom_ok, x_ok, y_ok;
+    const int zoom = cmdlist.value(1, "").toInt(&zoom_ok);
+    const int x = cmdlist.value(2, "").toInt(&x_ok);
+    const qint64 y = cmdlist.value(3, "").toLongLong(&y_ok);
+    if (!rc_tiles || !zoom_ok || !x_ok || !y_ok)
+        return QString("RPRT 1\n");
+
+    const QByteArray tile = rc_tiles->tile(zoom, x, y);
+    if (tile.isEmpty())
+        return QString("RPRT 1\n");
+
+    rc_attachment = tile;
+    return QString("%1\n").arg(tile.size());
+}
+
+/*
+ * Describe the waterfall history between two frequencies, the current band
+ * without them, as one line of SpectrumSummary JSON.
+ */
+QString RemoteControl::cmd_summary(QStringList cmdlist)
+{
+    if (!rc_snapshot)
+        return QString("RPRT 1\n");
+
+    // As SCREENSHOT, the snapshot has hardware frequencies
+    const double lnb_lo = rc_lnb_lo_mhz * 1.0e6;
+    double start = (double)(rc_freq - rc_filter_offset) - lnb_lo - rc_bandwidth / 2.0;
+    double end = start + rc_bandwidth;
+    bool ok = true;
+    if (cmdlist.size() > 1)
+    {
+        bool end_ok;
+        start = cmdlist[1].toDouble(&ok) - lnb_lo;
+        end = cmdlist.value(2, "").toDouble(&end_ok) - lnb_lo;
+        ok = ok && end_ok;
+    }
+    if (!ok || end <= start)
+        return QString("RPRT 1\n");
+
+    std::vector<float> levels;
+    uint64_t span_ms;
+    const int rows = rc_snapshot->levels(start, end, RC_SUMMARY_COLUMNS, 0, levels, span_ms);
+    SpectrumSummary summary;
+    if (!summary.compute(levels.data(), RC_SUMMARY_COLUMNS, rows, start + lnb_lo,
+                         (end - start) / RC_SUMMARY_COLUMNS, span_ms))
+        return QString("RPRT 1\n");
+
+    return QString::fromUtf8(QJsonDocument(summary.toJson()).toJson(QJsonDocument::Compact)) + "\n";
+}
+
+/* Range "<start> <end> <interval>" from the arguments at first, empty if invalid */
+static QString rangeLine(const QStringList &cmdlist, int first)
+{
+    bool start_ok, end_ok, interval_ok = true;
+    const double start = cmdlist.value(first, "").toDouble(&start_ok);
+    const double end = cmdlist.value(first + 1, "").toDouble(&end_ok);
+    const int interval = cmdlist.size() > first + 2 ? cmdlist[first + 2].toInt(&interval_ok)
+                                                    : RC_SURVEY_INTERVAL;
+    if (!start_ok || !end_ok || !interval_ok || start <= 0.0 || end <= start || interval < 1)
+        return QString();
+    return QString("%1 %2 %3").arg((qint64)start).arg((qint64)end).arg(interval);
+}
+
+/* Count of the lines, then the lines */
+static QString listLines(const QStringList &lines)
+{
+    QString answer = QString("%1\n").arg(lines.size());
+    for (const QString &line : lines)
+        answer += line + "\n";
+    return answer;
+}
+
+/* Get, add or clear the ranges of the band survey of the sigint dock */
+QString RemoteControl::cmd_survey(QStringList cmdlist)
+{
+    if (cmdlist.size() == 1)
+        return listLines(rc_survey_ranges);
+    if (!rc_survey_available)
+        return QString("RPRT 1\n");
+
+    if (cmdlist[1].toUpper() == "CLEAR")
+    {
+        rc_survey_ranges.clear();
+    }
+    else
+    {
+        const QString range = rangeLine(cmdlist, 1);
+        if (range.isEmpty())
+            return QString("RPRT 1\n");
+        rc_survey_ranges.append(range);
+    }
+    emit surveyRangesChanged(rc_survey_ranges.join('\n'));
+    return QString("RPRT 0\n");
+}
+
+/*
+ * Commands of the cluster coordinator, see ClusterCoordinator. Only
+ * CLUSTER, the list of nodes, works when this instance does not coordinate.
+ */
+QString RemoteControl::cmd_cluster(QStringList cmdlist)
+{
+    const QString arg = cmdlist.value(1, "").toUpper();
+    if (arg.isEmpty())
+        return listLines(rc_cluster_nodes);
+    if (!rc_cluster_coordinator || rc_current < 0)
+        return QString("RPRT 1\n");
+
+    bool ok;
+    if (arg == "JOIN")
+    {
+        // The node is reached at the address it connected from
+        const Client &client = rc_clients[rc_current];
+        QHostAddress address = client.socket ? client.socket->peerAddress() : QHostAddress();
+#ifdef WITH_WEBSOCKETS
+        if (client.web)
+            address = client.web->peerAddress();
+#endif
+        const quint32 ipv4 = address.toIPv4Address(&ok);
+        if (ok)
+            address = QHostAddress(ipv4);
+
+        const QString name = cmdlist.value(2, "");
+        bool port_ok, center_ok, bw_ok;
+        const int port = cmdlist.value(3, "").toInt(&port_ok);
+        const double center = cmdlist.value(4, "").toDouble(&center_ok);
+        const double bandwidth = cmdlist.value(5, "").toDouble(&bw_ok);
+        if (name.isEmpty() || address.isNull() || !port_ok || port < 1 || port > 65535 ||
+            !center_ok || !bw_ok || bandwidth <= 0.0)
+            return QString("RPRT 1\n");
+        emit clusterJoin(address.toString(), name, port, center, bandwidth);
+        return QString("RPRT 0\n");
+    }
+    if (arg == "RANGE")
+    {
+        if (cmdlist.size() == 2)
+            return listLines(rc_cluster_ranges);
+        if (cmdlist[2].toUpper() == "CLEAR")
+        {
+            rc_cluster_ranges.clear();
+        }
+        else
+        {
+            const QString range = rangeLine(cmdlist, 2);
+            if (range.isEmpty())
+                return QString("RPRT 1\n");
+            rc_cluster_ranges.append(range);
+        }
+        emit clusterRangesChanged(rc_cluster_ranges.join('\n'));
+        return QString("RPRT 0\n");
+    }
+    if (arg == "VFO")
+    {
+        if (cmdlist.size() == 2)
+            return listLines(rc_cluster_vfos);
+        const double freq = cmdlist[2].toDouble(&ok);
+        if (!ok || freq <= 0.0)
+            return QString("RPRT 1\n");
+        if (cmdlist.value(3, "").toUpper() == "OFF")
+        {
+            emit clusterVfoRemoved((qint64)freq);
+            return QString("RPRT 0\n");
+        }
+        const int mode = modeStrToInt(cmdlist.value(3, ""));
+        const int passband = cmdlist.value(4, "0").toInt(&ok);
+        if (mode <= 0 || !ok || passband < 0)
+            return QString("RPRT 1\n");
+        emit clusterVfoRequested((qint64)freq, intToModeStr(mode), passband);
+        return QString("RPRT 0\n");
+    }
+    if (arg == "SUMMARY")
+    {
+        auto it = rc_cluster_summaries.constFind(cmdlist.value(2, ""));
+        if (it == rc_cluster_summaries.constEnd())
+            return QString("RPRT 1\n");
+        return *it + "\n";
+    }
+    return QString("RPRT 1\n");
+}
+
+/*
+ * Write the events of the trace points as a Chrome trace to the traces
+ * folder in the configuration directory and answer with the path of the
+ * file. Only in builds with -DENABLE_TRACING=ON.
+ */
+QString RemoteControl::cmd_trace() const
+{
+#ifdef WITH_TRACING
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + "/gqrx/traces";
+    if (!QDir().mkpath(dir))
+        return QString("RPRT 1\n");
+
+    const QString path = dir + QDateTime::currentDateTime().toString("/'aguila'-yyyyMMdd-hhmmss-zzz'.json'");
+    if (!trace::dump(QFile::encodeName(path).toStdString()))
+        return QString("RPRT 1\n");
+    return path + "\n";
+#else
+    return QString("RPRT 1\n");
+#endif
+}
+
 /*
  * '\dump_state' used by hamlib clients, e.g. xdx, fldigi, rigctl and etc
  * More info:
@@ -1101,3 +2586,134 @@ void RemoteControl::setWaterfallRange(float min, float max)
     waterfall_min_db = min;
     waterfall_max_db = max;
 }
+
+/*! \brief Waterfall colormap changed (from DockFft). */
+void RemoteControl::setWfColormap(const QString &cmap)
+{
+    wf_colormap = cmap;
+}
+
+/*! \brief Render timing was enabled or disabled. */
+void RemoteControl::setRenderTimingStatus(bool enabled)
+{
+    render_timing_status = enabled;
+    if (!enabled)
+        render_timing.clear();
+}
+
+/*! \brief Set the render timing summary returned by "p RENDER_TIMING". */
+void RemoteControl::setRenderTiming(const QString &summary)
+{
+    render_timing = summary;
+}
+
+/*! \brief Performance counters were enabled or disabled. */
+void RemoteControl::setPerfStatus(bool enabled)
+{
+    perf_status = enabled;
+    if (!enabled)
+        block_perf.clear();
+}
+
+/*! \brief Set the block counters returned by "p PERF", as formatBlockPerf() makes them. */
+void RemoteControl::setBlockPerf(const QString &list)
+{
+    block_perf = list;
+}
+
+/*! \brief One line per block for "p PERF".
+ *
+ * <name> <cpu %> <work us> <input fill %> <output fill %> <items> <full events>
+ * with -1 for the fill of a block without inputs or outputs.
+ */
+QString RemoteControl::formatBlockPerf(const std::vector<receiver::block_perf> &blocks)
+{
+    QString list;
+
+    for (const receiver::block_perf &b : blocks)
+        list += QString("%1 %2 %3 %4 %5 %6 %7\n")
+                .arg(QString::fromStdString(b.name))
+                .arg(b.cpu, 0, 'f', 1)
+                .arg(b.work_time, 0, 'f', 1)
+                .arg(b.input_fill < 0.0f ? -1.0f : 100.0f * b.input_fill, 0, 'f', 0)
+                .arg(b.output_fill < 0.0f ? -1.0f : 100.0f * b.output_fill, 0, 'f', 0)
+                .arg((qulonglong)b.nproduced)
+                .arg((qulonglong)b.full_events);
+    return list;
+}
+
+void RemoteControl::setDetectorStatus(bool enabled)
+{
+    if (enabled == detector_status)
+        return;
+    detector_status = enabled;
+    if (!enabled)
+        detections.clear();
+    notify("DETECTOR");
+    notify("DETECTIONS");
+}
+
+/*! \brief Push a decoded packet to the clients that subscribed to PACKET.
+ *  \param vfo The VFO it was decoded on, 0 for the main channel.
+ */
+void RemoteControl::addPacket(int vfo, const QString &packet)
+{
+    // One line each, the decoder breaks the header from the payload
+    const QString line = QString("! PACKET %1 %2\n").arg(vfo)
+                         .arg(packet.trimmed().replace(QRegularExpression("\\s*\\n\\s*"), " "));
+    bool wanted = false;
+    for (Client &client : rc_clients)
+    {
+        if (!client.subscriptions.contains("PACKET"))
+            continue;
+        if (client.packets.size() >= RC_PACKET_QUEUE)
+            client.packets.removeFirst();
+        client.packets.append(line);
+        wanted = true;
+    }
+    if (wanted)
+        notify("PACKET");
+}
+
+/*! \brief Set the signal list returned by "p DETECTIONS", one per line. */
+/*! \brief Set signal level of an additional VFO in dBFS (from mainwindow). */
+void RemoteControl::setVfoLevel(int vfo, float level)
+{
+    if (rc_vfos.contains(vfo))
+        rc_vfos[vfo].level = level;
+}
+
+void RemoteControl::setDetections(const QString &list)
+{
+    if (list == detections)
+        return;
+    detections = list;
+    notify("DETECTIONS");
+}
+
+/*! \brief Accept the CLUSTER commands that change the coordination. */
+void RemoteControl::setClusterCoordinator(bool enabled)
+{
+    rc_cluster_coordinator = enabled;
+}
+
+/*! \brief Nodes and VFOs of the coordinator for CLUSTER and CLUSTER VFO, one per line. */
+void RemoteControl::setClusterStatus(const QString &nodes, const QString &vfos)
+{
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+    rc_cluster_nodes = nodes.split('\n', QString::SkipEmptyParts);
+    rc_cluster_vfos = vfos.split('\n', QString::SkipEmptyParts);
+#else
+    rc_cluster_nodes = nodes.split('\n', Qt::SkipEmptyParts);
+    rc_cluster_vfos = vfos.split('\n', Qt::SkipEmptyParts);
+#endif
+}
+
+/*! \brief Latest SUMMARY of a node for CLUSTER SUMMARY, dropped if empty. */
+void RemoteControl::setClusterSummary(const QString &node, const QString &summary)
+{
+    if (summary.isEmpty())
+        rc_cluster_summaries.remove(node);
+    else
+        rc_cluster_summaries.insert(node, summary);
+}
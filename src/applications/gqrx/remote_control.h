@@ -23,14 +23,31 @@
 #ifndef REMOTE_CONTROL_H
 #define REMOTE_CONTROL_H
 
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <QList>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
 #include <QObject>
+#include <QSet>
 #include <QSettings>
 #include <QString>
 #include <QStringList>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QTimer>
 #include <QtNetwork>
 
+#include "applications/gqrx/receiver.h"
+
+class CWaterfallSnapshot;
+class CWaterfallTiles;
+class QWebSocket;
+class QWebSocketServer;
 /* For gain_t and gain_list_t */
 #include "qtgui/dockinputctl.h"
 
@@ -53,6 +70,25 @@
  *
  *  close: Close connection (useful for interactive telnet sessions).
  *
+ *  FFT_STREAM: Binary spectrum frames on this connection, each after a
+ *  "! FFT <bytes>" line so line based clients can skip them.
+ *
+ *  DOPPLER: Time stamped channel corrections, applied by this thread.
+ *
+ * Browsers can use the same commands over a WebSocket, see
+ * remote-control.txt. Text messages carry the commands, replies and
+ * notifications, binary messages the FFT records and images.
+ *
+ *
+ * The object is meant to run in a thread of its own, so commands are read
+ * and answered while the GUI is busy. Queries are answered from the state
+ * kept here, changes are sent to the GUI as queued signals. The settings
+ * and server functions may be called from the GUI thread, they run in the
+ * thread of the server and block until done.
+ *
+ * The values that the read commands return are published as an immutable
+ * State after every command and once per meter tick, so they can be read
+ * from any thread without a lock.
  *
  * FIXME: The server code is very minimalistic and probably not very robust.
  */
@@ -60,30 +96,70 @@ class RemoteControl : public QObject
 {
     Q_OBJECT
 public:
-    explicit RemoteControl(QObject *parent = 0);
+    explicit RemoteControl(receiver *rx, QObject *parent = 0);
     ~RemoteControl();
 
-    void start_server(void);
-    void stop_server(void);
+    Q_INVOKABLE void start_server(void);
+    Q_INVOKABLE void stop_server(void);
 
-    void readSettings(QSettings *settings);
-    void saveSettings(QSettings *settings) const;
+    Q_INVOKABLE void readSettings(QSettings *settings);
+    Q_INVOKABLE void saveSettings(QSettings *settings);
 
-    void setPort(int port);
+    Q_INVOKABLE void setPort(int port);
     int  getPort(void) const
     {
         return rc_port;
     }
 
-    void setHosts(QStringList hosts);
+    Q_INVOKABLE void setHosts(QStringList hosts);
     QStringList getHosts(void) const
     {
         return rc_allowed_hosts;
     }
-    void setReceiverStatus(bool enabled);
-    void setGainStages(gain_list_t &gain_list);
+
+    /*! \brief Receiver state returned by the read commands. */
+    struct State {
+        qint64      freq;              /*!< Frequency [Hz] */
+        int         mode;              /*!< Demodulator, as in setMode() */
+        int         passband;          /*!< Passband [Hz] */
+        float       level;             /*!< Signal level [dBFS] */
+        double      squelch;           /*!< Squelch level [dBFS] */
+        float       audio_gain;        /*!< Audio gain [dB] */
+        bool        muted;             /*!< Audio muted */
+        QString     rds_pi;            /*!< RDS program identification */
+        QString     rds_station;       /*!< RDS program service name */
+        QString     rds_radiotext;     /*!< RDS Radiotext */
+    };
+
+    /*! \brief Latest published state, may be called from any thread. */
+    std::shared_ptr<const State> state() const
+    {
+        return std::atomic_load(&rc_state);
+    }
+
+    static QString formatBlockPerf(const std::vector<receiver::block_perf> &blocks);
+
+    /*! \brief Offscreen waterfall for SCREENSHOT PNG, set before the server starts. */
+    void setSnapshot(CWaterfallSnapshot *snapshot)
+    {
+        rc_snapshot = snapshot;
+    }
+
+    /*! \brief Tile pyramid for TILES and TILE, set before the server starts. */
+    void setTiles(CWaterfallTiles *tiles)
+    {
+        rc_tiles = tiles;
+    }
+
+    /*! \brief Whether SURVEY can set ranges, set before the server starts. */
+    void setSurveyAvailable(bool available)
+    {
+        rc_survey_available = available;
+    }
 
 public slots:
+    void setReceiverStatus(bool enabled);
+    void setGainStages(const gain_list_t &gain_list);
     void setNewFrequency(qint64 freq);
     void setFilterOffset(qint64 freq);
     void setLnbLo(double freq_mhz);
@@ -104,6 +180,18 @@ public slots:
     void setRdsStation(QString name);
     void setRdsRadiotext(QString text);
     void setWaterfallRange(float min, float max);
+    void setWfColormap(const QString &cmap);
+    void setRenderTimingStatus(bool enabled);
+    void setRenderTiming(const QString &summary);
+    void setPerfStatus(bool enabled);
+    void setBlockPerf(const QString &list);
+    void setDetectorStatus(bool enabled);
+    void setDetections(const QString &list);
+    void setVfoLevel(int vfo, float level);
+    void addPacket(int vfo, const QString &packet);
+    void setClusterCoordinator(bool enabled);
+    void setClusterStatus(const QString &nodes, const QString &vfos);
+    void setClusterSummary(const QString &node, const QString &summary);
 
 signals:
     void newFrequency(qint64 freq);
@@ -123,14 +211,84 @@ signals:
     void newAudioMuted(bool muted);
     void waterfallRangeChanged(float min, float max);
     void takeScreenshot();
+    void iqCaptureRequested(const QString &reason);
+    void renderTimingChanged(bool enabled);
+    void perfCountersChanged(bool enabled);
+    void detectorChanged(bool enabled);
+    void newVfo(int vfo, qint64 freq, int mode, int passband);
+    void vfoRemoved(int vfo);
+    void newVfoMuted(int vfo, bool muted);
+    void newVfoSquelchLevel(int vfo, double level);
+    void newVfoUdpStreaming(int vfo, const QString &host, int port, bool stereo, int format);
+    void newVfoRecording(int vfo, int mode);
+    void newVfoAfsk(int vfo, bool enabled);
+    void newVfoChannels(int channels);
+    void newIqStream(int source, int format, int tcp_port, const QString &group, int udp_port);
+    void surveyRangesChanged(const QString &ranges);
+    void clusterJoin(const QString &host, const QString &name, int port, double center,
+                     double bandwidth);
+    void clusterRangesChanged(const QString &ranges);
+    void clusterVfoRequested(qint64 freq, const QString &mode, int passband);
+    void clusterVfoRemoved(qint64 freq);
 
 private slots:
     void acceptConnection();
     void startRead();
+    void clientDisconnected();
+    void sendNotifications();
+    void publishState();
+    void sendFftFrames();
+    void applyDoppler();
+#ifdef WITH_WEBSOCKETS
+    void acceptWebConnection();
+    void webMessage(const QString &message);
+    void webBytesWritten(qint64 bytes);
+#endif
 
 private:
+    /*! \brief State of one connected client. */
+    struct Client {
+        QObject    *conn;              /*!< The socket, whichever kind it is. */
+        QTcpSocket *socket;            /*!< Line protocol connection, or null. */
+        QWebSocket *web;               /*!< WebSocket connection, or null. */
+        qint64      web_queued;        /*!< Bytes given to the WebSocket, not yet written. */
+        bool        hamlib_compatible; /*!< Mode names as hamlib uses them, set by M. */
+        QMap<QString, qint64> subscriptions; /*!< Subscribed items, minimum interval in ms. */
+        QMap<QString, qint64> last_sent;     /*!< When each item was last pushed, ms. */
+        QSet<QString> pending;         /*!< Items changed since they were last pushed. */
+        int         fft_sub;           /*!< FFT stream subscription, 0 if none. */
+        double      fft_rate;          /*!< Frames per second at most, 0 for all. */
+        unsigned int fft_bins;         /*!< Bins per frame at most, 0 for all. */
+        int         fft_format;        /*!< RC_FFT_F32, RC_FFT_I16 or RC_FFT_I8. */
+        quint32     fft_dropped;       /*!< Frames dropped since the last one sent. */
+        int         fft_tap;           /*!< receiver::fft_tap the frames come from. */
+        QStringList packets;           /*!< PACKET lines not pushed yet. */
+    };
+
+    receiver   *rc_rx;             /*!< Source of the streamed FFT frames. */
+    CWaterfallSnapshot *rc_snapshot; /*!< Rendered by SCREENSHOT PNG, may be null. */
+    CWaterfallTiles *rc_tiles;     /*!< Served by TILE, may be null. */
     QTcpServer  rc_server;         /*!< The active server object. */
-    QTcpSocket* rc_socket;         /*!< The active socket object. */
+    QWebSocketServer *rc_web_server; /*!< Gateway for browsers, null without WebSockets. */
+    int         rc_web_port;       /*!< Port of the gateway, 0 to disable it. */
+    QByteArray  rc_attachment;     /*!< Binary data that follows the answer of a command. */
+    QList<Client> rc_clients;      /*!< Connected clients, in the order they connected. */
+    int         rc_current;        /*!< Index of the client being served, -1 if none. */
+    QTimer      rc_notify_timer;   /*!< Pushes the pending items when they are due. */
+    std::shared_ptr<const State> rc_state; /*!< Published with std::atomic_store. */
+    QTimer      rc_state_timer;    /*!< Publishes changes from the GUI if no meter tick does. */
+    QElapsedTimer rc_clock;        /*!< Time base of the push intervals. */
+    QTimer      rc_doppler_timer;  /*!< Applies the Doppler program while it runs. */
+    std::vector<std::pair<double, double>> rc_doppler_points; /*!< Unix time [s] and correction [Hz]. */
+    double      rc_doppler_rate;   /*!< Change after the last point [Hz/s]. */
+
+    /*! \brief Latest FFT frame for a client, handed over from the GUI thread. */
+    struct FftHandover {
+        iq_fft_frame_sptr frame;
+        quint32     replaced;          /*!< Frames replaced before they were sent. */
+    };
+    std::mutex  rc_fft_mutex;
+    std::map<QObject *, FftHandover> rc_fft_frames;
 
     QStringList rc_allowed_hosts;  /*!< Hosts where we accept connection from. */
     int         rc_port;           /*!< The port we are listening on. */
@@ -153,13 +311,63 @@ private:
     bool        audio_recorder_status; /*!< Audio recording enabled */
     bool        iq_recorder_status;    /*!< IQ recording enabled */
     bool        receiver_running;  /*!< Whether the receiver is running or not */
-    bool        hamlib_compatible;
+    bool        hamlib_compatible; /*!< Of the client whose commands are handled. */
     gain_list_t gains;             /*!< Possible and current gain settings */
     bool        is_audio_muted;
     float       waterfall_min_db;
     float       waterfall_max_db;
+    QString     wf_colormap;       /*!< Waterfall colormap of the main window */
+    qint64      rc_bandwidth;      /*!< Bandwidth of the FFT [Hz] */
+    bool        render_timing_status; /*!< Render timers enabled */
+    QString     render_timing;     /*!< Latest render timing summary */
+    bool        perf_status;       /*!< Performance counters collected */
+    QString     block_perf;        /*!< Counters of the blocks, one per line */
+    bool        detector_status;   /*!< Signal detector enabled */
+    QString     detections;        /*!< Signals of the detector, one per line */
+
+    /*! \brief Additional VFO, as set by the VFO command. */
+    struct Vfo {
+        qint64      freq;              /*!< Frequency [Hz] */
+        int         mode;              /*!< Demodulator, as in setMode() */
+        int         passband;          /*!< Passband [Hz], 0 for the default */
+        bool        muted;             /*!< Left out of the audio output */
+        int         recording;         /*!< Audio recorder: 0 off, 1 continuous, 2 per transmission */
+        bool        afsk;              /*!< AFSK1200 decoder running */
+        float       level;             /*!< Signal level in dBFS */
+    };
+    QMap<int, Vfo> rc_vfos;            /*!< By VFO number. */
+    int         rc_vfo_channels;       /*!< Channels of the VFO channelizer, 0 when off */
+
+    /*! \brief I/Q stream, as set by the IQSTREAM command. */
+    struct IqStream {
+        int         format;            /*!< As in iq_file_format */
+        QString     group;             /*!< Multicast group */
+        int         tcp_port;          /*!< TCP port, 0 for a multicast stream */
+        int         udp_port;          /*!< Port of the datagrams */
+    };
+    QMap<int, IqStream> rc_iq_streams; /*!< By VFO number, 0 for the baseband. */
+
+    bool        rc_survey_available;   /*!< A sigint dock takes the SURVEY ranges */
+    QStringList rc_survey_ranges;      /*!< "<start> <end> <interval>" of SURVEY */
+    bool        rc_cluster_coordinator; /*!< This instance coordinates a cluster */
+    QStringList rc_cluster_ranges;     /*!< Coverage of CLUSTER RANGE, as rc_survey_ranges */
+    QStringList rc_cluster_nodes;      /*!< Lines of CLUSTER, from the coordinator */
+    QStringList rc_cluster_vfos;       /*!< Lines of CLUSTER VFO, from the coordinator */
+    QHash<QString, QString> rc_cluster_summaries; /*!< Last SUMMARY of each node */
 
     void        setNewRemoteFreq(qint64 freq);
+    void        stateChanged();
+    QString     runCommand(const QStringList &cmdlist);
+    void        runLines(int index, const QStringList &lines);
+    int         findClient(QObject *conn) const;
+    void        write(Client &client, const QByteArray &data, bool binary = false);
+    qint64      queuedBytes(const Client &client) const;
+    void        notify(const QString &item);
+    void        scheduleNotifications();
+    QString     itemLines(const QString &item);
+    void        closeClient(int index);
+    void        stopFftStream(Client &client);
+    void        sendFft(Client &client, const iq_fft_frame_sptr &frame);
     int         modeStrToInt(QString mode_str);
     QString     intToModeStr(int mode);
 
@@ -181,7 +389,23 @@ private:
     QString     cmd_AOS();
     QString     cmd_LOS();
     QString     cmd_lnb_lo(QStringList cmdlist);
+    QString     cmd_subscribe(QStringList cmdlist);
+    QString     cmd_unsubscribe(QStringList cmdlist);
+    QString     cmd_fft_stream(QStringList cmdlist);
+    QString     cmd_doppler(QStringList cmdlist);
+    QString     cmd_vfo(QStringList cmdlist);
+    QString     cmd_iq_stream(QStringList cmdlist);
+    QString     cmd_screenshot(QStringList cmdlist);
+    QString     cmd_history(QStringList cmdlist);
+    QString     cmd_tiles() const;
+    QString     cmd_tile(QStringList cmdlist);
+    QString     cmd_trace() const;
+    QString     cmd_summary(QStringList cmdlist);
+    QString     cmd_survey(QStringList cmdlist);
+    QString     cmd_cluster(QStringList cmdlist);
     QString     cmd_dump_state() const;
 };
 
+Q_DECLARE_METATYPE(gain_list_t)
+
 #endif // REMOTE_CONTROL_H
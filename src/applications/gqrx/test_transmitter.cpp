@@ -0,0 +1,79 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <stdexcept>
+
+#include "applications/gqrx/test_transmitter.h"
+
+test_transmitter::test_transmitter()
+    : d_running(false)
+{
+}
+
+test_transmitter::~test_transmitter()
+{
+    stop();
+}
+
+void test_transmitter::start(const std::string &device, double freq, double gain,
+                             const test_signal_params &params)
+{
+    stop();
+
+    test_signal_params unpaced = params;
+    unpaced.throttle = false;
+
+    try
+    {
+        tb = gr::make_top_block("test_transmitter");
+        sink = osmosdr::sink::make(device);
+        sink->set_sample_rate(unpaced.rate);
+        sink->set_center_freq(freq);
+        sink->set_gain(gain);
+        sink->set_bandwidth(unpaced.rate);
+        if (!sink->get_antennas().empty())
+            sink->set_antenna(sink->get_antennas().front());
+
+        tb->connect(make_test_signal_source(unpaced), 0, sink, 0);
+        tb->start();
+    }
+    catch (std::exception &x)
+    {
+        tb.reset();
+        sink.reset();
+        throw std::runtime_error(x.what());
+    }
+    d_running = true;
+}
+
+/* Stop sending and close the device */
+void test_transmitter::stop()
+{
+    if (d_running)
+    {
+        tb->stop();
+        tb->wait();
+        d_running = false;
+    }
+    tb.reset();
+    sink.reset();
+}
@@ -0,0 +1,62 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef TEST_TRANSMITTER_H
+#define TEST_TRANSMITTER_H
+
+#include <string>
+#include <gnuradio/top_block.h>
+#include <osmosdr/sink.h>
+
+#include "dsp/test_signal.h"
+
+/*! \brief Sends a test signal to a transmitting device.
+ *
+ * A flow graph of its own from a test_signal_source to an osmosdr sink,
+ * in place of the transmitter scripts. The sink paces the signal, so it
+ * is made without throttle. A half duplex device such as the HackRF can
+ * not be the input device while it transmits.
+ */
+class test_transmitter
+{
+public:
+    test_transmitter();
+    ~test_transmitter();
+
+    /*! \brief Open the device and start sending, throws std::runtime_error.
+     *  \param device The osmosdr sink device string.
+     *  \param freq The center frequency in Hz.
+     *  \param gain The overall gain in dB.
+     *  \param params The signal, params.rate is the device rate.
+     */
+    void start(const std::string &device, double freq, double gain,
+               const test_signal_params &params);
+    void stop();
+    bool is_running() const { return d_running; }
+
+private:
+    gr::top_block_sptr  tb;
+    osmosdr::sink::sptr sink;
+    bool                d_running;
+};
+
+#endif // TEST_TRANSMITTER_H
@@ -0,0 +1,247 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2014 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <thread>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QSysInfo>
+#include <QThread>
+
+#include "applications/headless/benchmark.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchDemod
+{
+    const char         *name;
+    receiver::rx_demod  demod;
+    double              low;        // filter in Hz
+    double              high;
+};
+
+/* Same filters as dsp_bench */
+static const BenchDemod bench_demods[] = {
+    { "RAW",    receiver::RX_DEMOD_NONE,    -5000.0,  5000.0 },
+    { "AM",     receiver::RX_DEMOD_AM,      -5000.0,  5000.0 },
+    { "AMSYNC", receiver::RX_DEMOD_AMSYNC,  -5000.0,  5000.0 },
+    { "NFM",    receiver::RX_DEMOD_NFM,     -5000.0,  5000.0 },
+    { "SSB",    receiver::RX_DEMOD_SSB,       100.0,  2800.0 },
+    { "WFM",    receiver::RX_DEMOD_WFM_M,  -80000.0, 80000.0 },
+    { "WFM_S",  receiver::RX_DEMOD_WFM_S,  -80000.0, 80000.0 },
+};
+
+ReceiverBenchmark::ReceiverBenchmark(const BenchmarkConfig &config)
+    : config(config),
+      rx(nullptr),
+      temporary(false)
+{
+}
+
+ReceiverBenchmark::~ReceiverBenchmark()
+{
+    if (rx)
+    {
+        if (rx->is_running())
+            rx->stop();
+        delete rx;
+    }
+    if (temporary)
+        QFile::remove(file);
+}
+
+/* Tone and complex Gaussian noise, as the synthetic signal of dsp_bench */
+bool ReceiverBenchmark::writeSynthetic(const QString &path)
+{
+    QFile out(path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    std::vector<std::complex<float>> block(65536);
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(0.0f, 0.01f);
+    const double phase_inc = 2.0 * M_PI / 64.0;
+    for (size_t done = 0; done < BENCH_SYNTH_SAMPLES; done += block.size())
+    {
+        for (size_t i = 0; i < block.size(); i++)
+            block[i] = std::polar(0.1f, (float)std::fmod(phase_inc * (done + i), 2.0 * M_PI)) +
+                       std::complex<float>(noise(rng), noise(rng));
+        qint64 bytes = (qint64)(block.size() * sizeof(block[0]));
+        if (out.write((const char *)block.data(), bytes) != bytes)
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Play the recording at rate and measure it after the warmup. The
+ * playback is started over before it reaches the end, where it would
+ * put out zeros.
+ */
+bool ReceiverBenchmark::trial(double rate, QJsonObject &result)
+{
+    if (rx->start_iq_playback(file.toStdString(), IQ_FILE_CF32, rate, 100e6) != receiver::STATUS_OK)
+        return false;
+
+    for (size_t i = 0; i < vfo_ids.size(); i++)
+        rx->set_vfo_offset(vfo_ids[i], ((double)(i + 1) / (vfo_ids.size() + 1) - 0.5) * 0.8 * rate);
+
+    if (!rx->is_running())
+        rx->start();
+
+    auto loop = [this, rate](Clock::time_point until) {
+        uint64_t pos, length;
+        while (Clock::now() < until)
+        {
+            if (rx->get_iq_playback_position(pos, length) && pos + (uint64_t)(rate / 2.0) > length)
+                rx->seek_iq_file(0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    };
+
+    loop(Clock::now() + std::chrono::milliseconds(BENCH_WARMUP_MS));
+
+    float latency_ms = 0.0f;
+    uint64_t underruns0 = 0, underruns1 = 0, dropped = 0;
+    bool audio_stats = rx->get_audio_stats(latency_ms, underruns0, dropped);
+    uint64_t count0 = rx->get_iq_sample_count();
+    Clock::time_point start = Clock::now();
+
+    loop(start + std::chrono::milliseconds((int)(config.seconds * 1000.0)));
+
+    uint64_t count1 = rx->get_iq_sample_count();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    rx->get_audio_stats(latency_ms, underruns1, dropped);
+
+    // Counted after the input decimation
+    double achieved = (double)(count1 - count0) * rx->get_input_decim() / seconds;
+    bool sustained = achieved >= BENCH_SUSTAINED * rate && underruns1 == underruns0;
+
+    result["rate"] = rate;
+    result["achieved"] = achieved;
+    if (audio_stats)
+        result["audio_underruns"] = (double)(underruns1 - underruns0);
+    result["sustained"] = sustained;
+    return sustained;
+}
+
+QJsonObject ReceiverBenchmark::run()
+{
+    QJsonObject report;
+    QJsonObject cfg;
+    cfg["file"] = config.file.isEmpty() ? QString("synthetic") : config.file;
+    cfg["demod"] = config.demod;
+    cfg["decim"] = (int)config.decim;
+    cfg["fft_size"] = config.fft_size;
+    cfg["nb"] = config.nb;
+    cfg["vfos"] = config.vfos;
+    cfg["min_rate"] = config.min_rate;
+    cfg["max_rate"] = config.max_rate;
+    cfg["seconds"] = config.seconds;
+    report["config"] = cfg;
+
+    QJsonObject host;
+    host["name"] = QSysInfo::machineHostName();
+    host["cpu"] = QSysInfo::currentCpuArchitecture();
+    host["kernel"] = QSysInfo::kernelType() + " " + QSysInfo::kernelVersion();
+    host["threads"] = QThread::idealThreadCount();
+    report["host"] = host;
+
+    const BenchDemod *demod = nullptr;
+    for (const BenchDemod &d : bench_demods)
+        if (config.demod.toUpper() == d.name)
+            demod = &d;
+    if (!demod || config.min_rate <= 0.0 || config.max_rate < config.min_rate ||
+        (config.decim & (config.decim - 1)) != 0)
+    {
+        report["error"] = QString("Invalid demodulator, rates or decimation");
+        return report;
+    }
+
+    if (config.file.isEmpty())
+    {
+        file = QDir::temp().filePath(QString("gqrx_bench_%1.cf32").arg(QCoreApplication::applicationPid()));
+        temporary = true;
+        if (!writeSynthetic(file))
+        {
+            report["error"] = QString("Can not write %1").arg(file);
+            return report;
+        }
+    }
+    else
+    {
+        file = config.file;
+    }
+
+    rx = new receiver("", "", std::max(1u, config.decim));
+    rx->set_demod(demod->demod);
+    rx->set_filter(demod->low, demod->high, receiver::FILTER_SHAPE_NORMAL);
+    rx->set_iq_fft_size(config.fft_size);
+    rx->set_nb_on(1, config.nb);
+    rx->set_nb_on(2, config.nb);
+    for (int i = 0; i < config.vfos; i++)
+    {
+        int id = rx->add_vfo(0.0, demod->demod);
+        rx->set_vfo_filter(id, demod->low, demod->high, receiver::FILTER_SHAPE_NORMAL);
+        vfo_ids.push_back(id);
+    }
+
+    // The highest rate first, then bisect between the last rates that were
+    // and were not sustained
+    QJsonArray trials;
+    double lo = 0.0;
+    double hi = config.max_rate;
+    double rate = config.max_rate;
+    for (;;)
+    {
+        QJsonObject result;
+        bool ok = trial(rate, result);
+        if (result.isEmpty())
+        {
+            report["error"] = QString("Can not play %1").arg(file);
+            break;
+        }
+        trials.append(result);
+        if (ok)
+            lo = rate;
+        else
+            hi = rate;
+
+        if (ok && rate == config.max_rate)
+            break;
+        if (!ok && rate == config.min_rate)
+            break;
+        if (lo > 0.0 && hi - lo <= config.precision * hi)
+            break;
+        rate = lo > 0.0 ? (lo + hi) / 2.0 : std::max(config.min_rate, hi / 2.0);
+    }
+    rx->stop();
+
+    report["trials"] = trials;
+    report["max_rate"] = lo;
+    return report;
+}
@@ -0,0 +1,87 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2014 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <vector>
+#include <QJsonObject>
+#include <QString>
+
+#include "applications/gqrx/receiver.h"
+
+/* Time the flow graph runs at a new rate before it is measured */
+#define BENCH_WARMUP_MS 1000
+
+/* Share of the rate the input must keep up with to be sustained */
+#define BENCH_SUSTAINED 0.99
+
+/* Samples of the synthetic recording, played over and over */
+#define BENCH_SYNTH_SAMPLES (1 << 22)
+
+/*! \brief Configuration of a receiver benchmark. */
+struct BenchmarkConfig
+{
+    QString      file;          /*!< cf32 recording, synthetic if empty. */
+    QString      demod;         /*!< RAW, AM, AMSYNC, NFM, SSB, WFM or WFM_S. */
+    unsigned int decim;         /*!< Input decimation. */
+    int          fft_size;      /*!< Points of the main spectrum. */
+    bool         nb;            /*!< Both noise blankers on. */
+    int          vfos;          /*!< VFOs besides the main channel. */
+    double       min_rate;      /*!< Lowest input rate tried, in Hz. */
+    double       max_rate;      /*!< Highest input rate tried, in Hz. */
+    double       precision;     /*!< Search stops within this share of the rate. */
+    double       seconds;       /*!< Measured time of each rate. */
+};
+
+/*! \brief The highest input rate the receiver keeps up with.
+ *
+ * Builds the receiver flow graph with its audio output, plays a recording
+ * through the memory mapped playback, which is paced at the sample rate
+ * like a device, and searches the rate by bisection. A rate is sustained
+ * when the input keeps up with BENCH_SUSTAINED of it and the audio output
+ * has no underruns while it is measured. The report is a JSON object with
+ * the configuration, the machine, each rate tried and the result.
+ */
+class ReceiverBenchmark
+{
+public:
+    explicit ReceiverBenchmark(const BenchmarkConfig &config);
+    ~ReceiverBenchmark();
+
+    /*! \brief Run the search.
+     *  \return The report, with an "error" member if it could not run.
+     */
+    QJsonObject run();
+
+private:
+    bool        trial(double rate, QJsonObject &result);
+    bool        writeSynthetic(const QString &path);
+
+    BenchmarkConfig config;
+    receiver       *rx;
+    QString         file;       /*!< Recording played. */
+    bool            temporary;  /*!< The recording is removed at the end. */
+    std::vector<int> vfo_ids;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,926 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2014 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <chrono>
+#include <cmath>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "applications/gqrx/receiver_settings.h"
+#include "applications/headless/headless.h"
+#include "dsp/afsk1200/afsk1200_decoder.h"
+#include "qtgui/dockrxopt.h"
+
+/* Intervals of the signal meter, of the published FFT frames and of the
+ * polls of the performance counters */
+#define METER_INTERVAL_MS   100
+#define DEFAULT_FFT_RATE    25
+#define PERF_INTERVAL_MS    1000
+
+/* Names of the modes in the configuration, as DockRxOpt writes them */
+static const char *mode_names[DockRxOpt::MODE_LAST] = {
+    "Demod Off", "Raw I/Q", "AM", "AM-Sync", "LSB", "USB", "CW-L", "CW-U",
+    "Narrow FM", "WFM (mono)", "WFM (stereo)", "WFM (oirt)"
+};
+
+/* Modes of configurations before version 3, c.f. DockRxOpt */
+static const int old_modes[] = {
+    DockRxOpt::MODE_OFF, DockRxOpt::MODE_RAW, DockRxOpt::MODE_AM, DockRxOpt::MODE_NFM,
+    DockRxOpt::MODE_WFM_MONO, DockRxOpt::MODE_WFM_STEREO, DockRxOpt::MODE_LSB,
+    DockRxOpt::MODE_USB, DockRxOpt::MODE_CWL, DockRxOpt::MODE_CWU,
+    DockRxOpt::MODE_WFM_STEREO_OIRT, DockRxOpt::MODE_AM_SYNC
+};
+
+/* The normal filter preset of each mode, c.f. DockRxOpt */
+static const int normal_filter[DockRxOpt::MODE_LAST][2] = {
+    {      0,     0 },  // MODE_OFF
+    {  -5000,  5000 },  // MODE_RAW
+    {  -5000,  5000 },  // MODE_AM
+    {  -5000,  5000 },  // MODE_AMSYNC
+    {  -2800,  -100 },  // MODE_LSB
+    {    100,  2800 },  // MODE_USB
+    {   -250,   250 },  // MODE_CWL
+    {   -250,   250 },  // MODE_CWU
+    {  -5000,  5000 },  // MODE_NFM
+    { -80000, 80000 },  // MODE_WFM_MONO
+    { -80000, 80000 },  // MODE_WFM_STEREO
+    { -80000, 80000 }   // MODE_WFM_STEREO_OIRT
+};
+
+/** Receiver demodulator of a mode, CW is received as SSB. */
+static receiver::rx_demod modeDemod(int mode_idx)
+{
+    switch (mode_idx) {
+    case DockRxOpt::MODE_RAW:
+        return receiver::RX_DEMOD_NONE;
+    case DockRxOpt::MODE_AM:
+        return receiver::RX_DEMOD_AM;
+    case DockRxOpt::MODE_AM_SYNC:
+        return receiver::RX_DEMOD_AMSYNC;
+    case DockRxOpt::MODE_NFM:
+        return receiver::RX_DEMOD_NFM;
+    case DockRxOpt::MODE_WFM_MONO:
+        return receiver::RX_DEMOD_WFM_M;
+    case DockRxOpt::MODE_WFM_STEREO:
+        return receiver::RX_DEMOD_WFM_S;
+    case DockRxOpt::MODE_WFM_STEREO_OIRT:
+        return receiver::RX_DEMOD_WFM_S_OIRT;
+    case DockRxOpt::MODE_LSB:
+    case DockRxOpt::MODE_USB:
+    case DockRxOpt::MODE_CWL:
+    case DockRxOpt::MODE_CWU:
+        return receiver::RX_DEMOD_SSB;
+    default:
+        return receiver::RX_DEMOD_OFF;
+    }
+}
+
+HeadlessReceiver::HeadlessReceiver(const QString &cfgfile, QObject *parent) :
+    QObject(parent),
+    configOk(false),
+    m_settings(nullptr),
+    fftSubscription(0),
+    detectorEnabled(false),
+    d_lnb_lo(0),
+    d_hw_freq(0),
+    d_rx_freq(0),
+    d_mode(DockRxOpt::MODE_OFF),
+    d_audio_gain(-6.0f),
+    d_cw_offset(700.0),
+    d_drop_events(0),
+    d_stall_ms(INPUT_STALL_MS),
+    d_iq_rec_compress(false),
+    d_capture_detector(false)
+{
+    rx = new receiver("", "", 1);
+    rx->set_rf_freq(144500000.0);
+
+    // The remote control answers in its own thread, as in the GUI
+    remote = new RemoteControl(rx);
+    remoteThread = new QThread(this);
+    remote->moveToThread(remoteThread);
+    connect(remoteThread, SIGNAL(finished()), remote, SLOT(deleteLater()));
+    remoteThread->start();
+    remote->setSnapshot(&waterfallSnapshot);
+    iqCapture = new IqCapture(rx, this);
+
+    connect(remote, SIGNAL(newFrequency(qint64)), this, SLOT(setNewFrequency(qint64)));
+    connect(remote, SIGNAL(newFilterOffset(qint64)), this, SLOT(setFilterOffset(qint64)));
+    connect(remote, SIGNAL(newLnbLo(double)), this, SLOT(setLnbLo(double)));
+    connect(remote, SIGNAL(newMode(int)), this, SLOT(selectDemod(int)));
+    connect(remote, SIGNAL(newPassband(int)), this, SLOT(setPassband(int)));
+    connect(remote, SIGNAL(newSquelchLevel(double)), this, SLOT(setSqlLevel(double)));
+    connect(remote, SIGNAL(newAudioGain(float)), this, SLOT(setAudioGain(float)));
+    connect(remote, SIGNAL(newAudioMuted(bool)), this, SLOT(setAudioMuted(bool)));
+    connect(remote, SIGNAL(gainChanged(QString, double)), this, SLOT(setGain(QString,double)));
+    connect(remote, SIGNAL(dspChanged(bool)), this, SLOT(setDsp(bool)));
+    connect(remote, SIGNAL(startAudioRecorderEvent()), this, SLOT(startAudioRecorder()));
+    connect(remote, SIGNAL(stopAudioRecorderEvent()), this, SLOT(stopAudioRecorder()));
+    connect(remote, SIGNAL(startIqRecorderEvent()), this, SLOT(startIqRecorder()));
+    connect(remote, SIGNAL(stopIqRecorderEvent()), this, SLOT(stopIqRecorder()));
+    connect(remote, SIGNAL(detectorChanged(bool)), this, SLOT(setDetectorEnabled(bool)));
+    connect(remote, SIGNAL(perfCountersChanged(bool)), this, SLOT(setPerfCounters(bool)));
+    connect(remote, SIGNAL(newVfo(int,qint64,int,int)), this, SLOT(setVfo(int,qint64,int,int)));
+    connect(remote, SIGNAL(vfoRemoved(int)), this, SLOT(removeVfo(int)));
+    connect(remote, SIGNAL(newVfoMuted(int,bool)), this, SLOT(setVfoMuted(int,bool)));
+    connect(remote, SIGNAL(newVfoSquelchLevel(int,double)), this, SLOT(setVfoSqlLevel(int,double)));
+    connect(remote, SIGNAL(newVfoUdpStreaming(int,QString,int,bool,int)),
+            this, SLOT(setVfoUdpStreaming(int,QString,int,bool,int)));
+    connect(remote, SIGNAL(newVfoRecording(int,int)), this, SLOT(setVfoRecording(int,int)));
+    connect(remote, SIGNAL(newVfoAfsk(int,bool)), this, SLOT(setVfoAfsk(int,bool)));
+    connect(remote, SIGNAL(newVfoChannels(int)), this, SLOT(setVfoChannels(int)));
+    connect(remote, SIGNAL(newIqStream(int,int,int,QString,int)),
+            this, SLOT(setIqStream(int,int,int,QString,int)));
+    connect(remote, SIGNAL(iqCaptureRequested(QString)), this, SLOT(triggerIqCapture(QString)));
+
+    // A headless node has no survey, it takes VFOs; it can still coordinate
+    clusterMember = new ClusterMember(rx, this);
+    clusterCoordinator = new ClusterCoordinator(this);
+    connect(remote, SIGNAL(clusterJoin(QString,QString,int,double,double)),
+            clusterCoordinator, SLOT(join(QString,QString,int,double,double)));
+    connect(remote, SIGNAL(clusterRangesChanged(QString)), clusterCoordinator, SLOT(setRanges(QString)));
+    connect(remote, SIGNAL(clusterVfoRequested(qint64,QString,int)),
+            clusterCoordinator, SLOT(requestVfo(qint64,QString,int)));
+    connect(remote, SIGNAL(clusterVfoRemoved(qint64)), clusterCoordinator, SLOT(removeVfo(qint64)));
+    connect(clusterCoordinator, SIGNAL(statusChanged(QString,QString)),
+            remote, SLOT(setClusterStatus(QString,QString)));
+    connect(clusterCoordinator, SIGNAL(summaryChanged(QString,QString)),
+            remote, SLOT(setClusterSummary(QString,QString)));
+
+    connect(&meter_timer, SIGNAL(timeout()), this, SLOT(meterTimeout()));
+    connect(&fft_timer, SIGNAL(timeout()), this, SLOT(fftTimeout()));
+    connect(&perf_timer, SIGNAL(timeout()), this, SLOT(perfTimeout()));
+
+    // Frames are published on this thread by fftTimeout()
+    fftSubscription = rx->subscribe_iq_fft([this](const iq_fft_frame_sptr &frame) {
+        const qint64 ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              frame->timestamp.time_since_epoch()).count();
+        waterfallSnapshot.addFrame(frame->data.data(), (int)frame->data.size(),
+                                   frame->center_freq, frame->sample_rate, (uint64_t)ms);
+        if (detectorEnabled)
+            runDetector(frame);
+    });
+
+    configOk = loadConfig(cfgfile);
+}
+
+HeadlessReceiver::~HeadlessReceiver()
+{
+    meter_timer.stop();
+    fft_timer.stop();
+    perf_timer.stop();
+    rx->unsubscribe_iq_fft(fftSubscription);
+    if (rx->is_running())
+        rx->stop();
+    delete clusterMember;
+    delete clusterCoordinator;
+
+    // The remote control is deleted in its thread, before the receiver
+    remoteThread->quit();
+    remoteThread->wait();
+    delete rx;
+    delete m_settings;
+}
+
+/**
+ * Load the configuration.
+ * @param cfgfile Absolute path, or name of a file in the configuration
+ *                directory of the GUI.
+ * @returns False if the file or its input device can not be used.
+ *
+ * The settings are read as in MainWindow::loadConfig() and the readSettings()
+ * of the docks, without any of the widget settings.
+ */
+bool HeadlessReceiver::loadConfig(const QString &cfgfile)
+{
+    bool        conv_ok;
+    int         int_val;
+    double      dbl_val;
+
+    QString cfg_path = cfgfile;
+    if (!QDir::isAbsolutePath(cfgfile))
+    {
+        QByteArray xdg_dir = qgetenv("XDG_CONFIG_HOME");
+        if (xdg_dir.isEmpty())
+            cfg_path = QString("%1/.config/gqrx/%2").arg(QDir::homePath()).arg(cfgfile);
+        else
+            cfg_path = QString("%1/gqrx/%2").arg(xdg_dir.data()).arg(cfgfile);
+    }
+    if (!QFile::exists(cfg_path))
+    {
+        qCritical() << "Configuration file" << cfg_path << "does not exist";
+        return false;
+    }
+    m_settings = new QSettings(cfg_path, QSettings::IniFormat);
+    qInfo() << "Configuration file:" << m_settings->fileName();
+
+    QString indev = m_settings->value("input/device", "").toString();
+    if (indev.isEmpty())
+    {
+        qCritical() << "No input device in the configuration";
+        return false;
+    }
+    try
+    {
+        rx->set_input_device(indev.toStdString());
+    }
+    catch (std::runtime_error &x)
+    {
+        qCritical() << "Failed to set input device:" << x.what();
+        return false;
+    }
+
+    try
+    {
+        rx->set_output_device(m_settings->value("output/device", "").toString().toStdString());
+    }
+    catch (std::exception &x)
+    {
+        qWarning() << "Failed to set output device:" << x.what();
+    }
+
+    readMemorySettings(m_settings);
+    readBufferSettings(rx, m_settings);
+    readThreadSettings(rx, m_settings);
+
+    double actual_rate = rx->get_input_rate();
+    int_val = m_settings->value("input/sample_rate", 0).toInt(&conv_ok);
+    if (conv_ok && int_val > 0)
+    {
+        actual_rate = rx->set_input_rate(int_val);
+        if (actual_rate == 0)
+        {
+            qWarning() << "There was an error configuring the input device";
+            actual_rate = int_val;
+        }
+    }
+    readDecimSettings(rx, m_settings);
+    int_val = m_settings->value("input/decimation", 1).toInt(&conv_ok);
+    if (conv_ok && int_val >= 2 && rx->set_input_decim(int_val) == (unsigned int)int_val)
+        actual_rate /= (double)int_val;
+    else
+        rx->set_input_decim(1);
+    qInfo() << "Quadrature rate:" << QString("%1").arg(actual_rate, 0, 'f', 6);
+    QMetaObject::invokeMethod(remote, "setBandwidth", Qt::QueuedConnection,
+                              Q_ARG(qint64, (qint64)actual_rate));
+
+    int_val = m_settings->value("input/bandwidth", 0).toInt(&conv_ok);
+    if (conv_ok)
+        rx->set_analog_bandwidth((double)int_val);
+
+    // Input controls, c.f. DockInputCtl::readSettings()
+    rx->set_freq_corr(m_settings->value("input/corr_freq", 0).toLongLong() / 1.0e6);
+    rx->set_iq_swap(m_settings->value("input/swap_iq", false).toBool());
+    rx->set_dc_cancel(m_settings->value("input/dc_cancel", false).toBool());
+    rx->set_iq_balance(m_settings->value("input/iq_balance", false).toBool());
+    d_lnb_lo = m_settings->value("input/lnb_lo", 0).toLongLong();
+    if (m_settings->contains("input/antenna"))
+        rx->set_antenna(m_settings->value("input/antenna").toString().toStdString());
+    rx->set_auto_gain(m_settings->value("input/hwagc", false).toBool());
+    if (m_settings->contains("input/gains"))
+    {
+        // stored as dB*10
+        QMap<QString, QVariant> gains = m_settings->value("input/gains").toMap();
+        for (auto it = gains.constBegin(); it != gains.constEnd(); ++it)
+            rx->set_gain(it.key().toStdString(), 0.1 * it.value().toInt());
+        updateGainStages(true);
+    }
+    else
+        updateGainStages(!indev.contains("rtl", Qt::CaseInsensitive));
+    d_stall_ms = readStandbySettings(rx, m_settings);
+
+    int_val = m_settings->value("fft/fft_size", 0).toInt(&conv_ok);
+    if (conv_ok && int_val > 0)
+        rx->set_iq_fft_size(int_val);
+    int_val = m_settings->value("fft/fft_rate", DEFAULT_FFT_RATE).toInt(&conv_ok);
+    fft_timer.setInterval(1000 / ((conv_ok && int_val > 0) ? int_val : DEFAULT_FFT_RATE));
+
+    // Receiver options, c.f. DockRxOpt::readSettings()
+    d_cw_offset = m_settings->value("receiver/cwoffset", 700).toInt();
+    rx->set_fm_maxdev(m_settings->value("receiver/fm_maxdev", 5000).toInt());
+    dbl_val = m_settings->value("receiver/fm_deemph", 75).toDouble(&conv_ok);
+    if (conv_ok && dbl_val >= 0)
+        rx->set_fm_deemph(1.0e-6 * dbl_val); // stored as usec
+    rx->set_filter_offset(m_settings->value("receiver/offset", 0).toInt());
+    rx->set_agc_threshold(m_settings->value("receiver/agc_threshold", -100).toInt());
+    rx->set_agc_decay(m_settings->value("receiver/agc_decay", 500).toInt());
+    rx->set_agc_slope(m_settings->value("receiver/agc_slope", 0).toInt());
+    rx->set_agc_manual_gain(m_settings->value("receiver/agc_gain", 0).toInt());
+    rx->set_agc_hang(m_settings->value("receiver/agc_usehang", false).toBool());
+    rx->set_agc_on(!m_settings->value("receiver/agc_off", false).toBool());
+    rx->set_am_dcr(m_settings->value("receiver/am_dcr", true).toBool());
+    rx->set_amsync_dcr(m_settings->value("receiver/amsync_dcr", true).toBool());
+    rx->set_amsync_pll_bw(m_settings->value("receiver/amsync_pllbw", 1000).toInt() / 1.0e6);
+
+    dbl_val = m_settings->value("receiver/sql_level", 1.0).toDouble(&conv_ok);
+    if (conv_ok && dbl_val < 1.0)
+        setSqlLevel(dbl_val);
+
+    int mode = DockRxOpt::MODE_AM;
+    if (m_settings->contains("receiver/demod"))
+    {
+        if (m_settings->value("configversion").toInt() >= 3)
+        {
+            QString name = m_settings->value("receiver/demod").toString();
+            for (int i = 0; i < DockRxOpt::MODE_LAST; i++)
+                if (name == mode_names[i])
+                    mode = i;
+        }
+        else
+        {
+            int_val = m_settings->value("receiver/demod").toInt(&conv_ok);
+            if (conv_ok && int_val >= 0 && int_val < DockRxOpt::MODE_LAST)
+                mode = old_modes[int_val];
+        }
+    }
+    selectDemod(mode);
+
+    int flo = m_settings->value("receiver/filter_low_cut", 0).toInt(&conv_ok);
+    int fhi = m_settings->value("receiver/filter_high_cut", 0).toInt(&conv_ok);
+    if (conv_ok && d_mode != DockRxOpt::MODE_OFF && flo != fhi)
+    {
+        rx->set_filter((double)flo, (double)fhi, receiver::FILTER_SHAPE_NORMAL);
+        QMetaObject::invokeMethod(remote, "setPassband", Qt::QueuedConnection,
+                                  Q_ARG(int, flo), Q_ARG(int, fhi));
+    }
+
+    setNewFrequency(m_settings->value("input/frequency", 14236000).toLongLong());
+    QMetaObject::invokeMethod(remote, "setNewFrequency", Qt::QueuedConnection,
+                              Q_ARG(qint64, d_rx_freq));
+    QMetaObject::invokeMethod(remote, "setFilterOffset", Qt::QueuedConnection,
+                              Q_ARG(qint64, (qint64)rx->get_filter_offset()));
+    QMetaObject::invokeMethod(remote, "setLnbLo", Qt::QueuedConnection,
+                              Q_ARG(double, d_lnb_lo / 1.0e6));
+
+    // Audio, c.f. DockAudio::readSettings()
+    m_settings->beginGroup("audio");
+    int_val = m_settings->value("gain", -60).toInt(&conv_ok);
+    if (conv_ok)
+        d_audio_gain = int_val / 10.0f;
+    d_audio_rec_dir = m_settings->value("rec_dir", QDir::homePath()).toString();
+    QString udp_host = m_settings->value("udp_host", "localhost").toString();
+    int udp_port = m_settings->value("udp_port", 7355).toInt();
+    bool udp_stereo = m_settings->value("udp_stereo", false).toBool();
+    m_settings->endGroup();
+    setAudioGain(d_audio_gain);
+    QMetaObject::invokeMethod(remote, "setAudioGain", Qt::QueuedConnection,
+                              Q_ARG(float, d_audio_gain));
+
+    // Only the headless receiver streams the audio from the start
+    if (m_settings->value("headless/udp_streaming", false).toBool())
+    {
+        const QString format = m_settings->value("headless/udp_format", "RAW").toString().toUpper();
+        rx->start_udp_streaming(udp_host.toStdString(), udp_port, udp_stereo,
+                                format == "OPUS" ? UDP_STREAM_OPUS :
+                                format == "RTP" ? UDP_STREAM_RTP : UDP_STREAM_RAW);
+    }
+
+    d_iq_rec_dir = m_settings->value("baseband/rec_dir", QDir::homePath()).toString();
+    d_iq_rec_samples = m_settings->value("baseband/rec_samples", "cf32").toString();
+    d_iq_rec_compress = m_settings->value("baseband/rec_compress", false).toBool();
+    d_capture_detector = m_settings->value("baseband/capture_detector", false).toBool();
+    iqCapture->setDirectory(d_iq_rec_dir);
+    iqCapture->setHardware(m_settings->value("input/device", "").toString());
+    iqCapture->setWindow(m_settings->value("baseband/pretrigger", 0.0).toDouble(),
+                         m_settings->value("baseband/posttrigger", IQ_CAPTURE_POST_SEC).toDouble());
+
+    m_settings->beginGroup("SIGINT");
+    signalDetector.setThreshold(m_settings->value("detector_threshold",
+                                                  SIGNAL_DETECTOR_THRESHOLD_DB).toFloat());
+    bool detector = m_settings->value("detector", false).toBool();
+    m_settings->endGroup();
+    setDetectorEnabled(detector);
+    QMetaObject::invokeMethod(remote, "setDetectorStatus", Qt::QueuedConnection,
+                              Q_ARG(bool, detector));
+
+    // Without a GUI the remote control is the only way in, it always runs
+    remote->readSettings(m_settings);
+    remote->start_server();
+
+    QMetaObject::invokeMethod(remote, "setClusterCoordinator", Qt::QueuedConnection,
+                              Q_ARG(bool, m_settings->value("cluster/coordinator", false).toBool()));
+    clusterMember->setLnbLo(d_lnb_lo / 1.0e6);
+    clusterMember->setRemotePort(remote->getPort());
+    clusterMember->readSettings(m_settings);
+
+    setDsp(true);
+    return true;
+}
+
+/** Send the gain stages of the device to the remote control. */
+void HeadlessReceiver::updateGainStages(bool read_from_device)
+{
+    gain_list_t gain_list;
+    gain_t gain;
+
+    for (const std::string &name : rx->get_gain_names())
+    {
+        gain.name = name;
+        rx->get_gain_range(gain.name, &gain.start, &gain.stop, &gain.step);
+        if (read_from_device)
+        {
+            gain.value = rx->get_gain(gain.name);
+        }
+        else
+        {
+            // rtlsdr gain is 0 by default, c.f. MainWindow::loadConfig()
+            gain.value = (gain.start + gain.stop) / 2;
+            rx->set_gain(gain.name, gain.value);
+        }
+        gain_list.push_back(gain);
+    }
+
+    QMetaObject::invokeMethod(remote, "setGainStages", Qt::QueuedConnection,
+                              Q_ARG(gain_list_t, gain_list));
+}
+
+/**
+ * @brief Tune to a new frequency.
+ * @param rx_freq The frequency including the filter offset and the LNB LO.
+ */
+void HeadlessReceiver::setNewFrequency(qint64 rx_freq)
+{
+    d_rx_freq = rx_freq;
+    d_hw_freq = (qint64)((double)(rx_freq - d_lnb_lo) - rx->get_filter_offset());
+    rx->set_rf_freq((double)d_hw_freq);
+    updateVfos();
+}
+
+void HeadlessReceiver::setFilterOffset(qint64 freq_hz)
+{
+    rx->set_filter_offset((double)freq_hz);
+    d_rx_freq = d_hw_freq + d_lnb_lo + freq_hz;
+
+    if (rx->is_rds_decoder_active())
+        rx->reset_rds_parser();
+}
+
+void HeadlessReceiver::setLnbLo(double freq_mhz)
+{
+    // The RF frequency stays, the frequency including the LO changes
+    d_rx_freq += qint64(freq_mhz * 1e6) - d_lnb_lo;
+    d_lnb_lo = qint64(freq_mhz * 1e6);
+    clusterMember->setLnbLo(freq_mhz);
+    updateVfos();
+}
+
+/**
+ * @brief Select a new mode, with the normal filter preset of it.
+ * @param mode_idx Mode index, c.f. DockRxOpt::rxopt_mode_idx
+ */
+void HeadlessReceiver::selectDemod(int mode_idx)
+{
+    if (mode_idx < DockRxOpt::MODE_OFF || mode_idx >= DockRxOpt::MODE_LAST)
+    {
+        qWarning() << "Invalid mode index:" << mode_idx;
+        mode_idx = DockRxOpt::MODE_OFF;
+    }
+
+    if (mode_idx == DockRxOpt::MODE_OFF && rx->is_recording_audio())
+        rx->stop_audio_recording();
+
+    d_mode = mode_idx;
+    rx->set_demod(mode_idx == DockRxOpt::MODE_OFF ? receiver::RX_DEMOD_OFF : modeDemod(mode_idx));
+
+    double cwofs = 0.0;
+    if (mode_idx == DockRxOpt::MODE_CWL)
+        cwofs = -d_cw_offset;
+    else if (mode_idx == DockRxOpt::MODE_CWU)
+        cwofs = d_cw_offset;
+
+    int flo = normal_filter[mode_idx][0];
+    int fhi = normal_filter[mode_idx][1];
+    rx->set_filter((double)flo, (double)fhi, receiver::FILTER_SHAPE_NORMAL);
+    rx->set_cw_offset(cwofs);
+
+    QMetaObject::invokeMethod(remote, "setMode", Qt::QueuedConnection, Q_ARG(int, mode_idx));
+    QMetaObject::invokeMethod(remote, "setPassband", Qt::QueuedConnection,
+                              Q_ARG(int, flo), Q_ARG(int, fhi));
+}
+
+/** Filter edges of a passband, placed like the normal preset of the mode. */
+void HeadlessReceiver::passbandEdges(int mode, int bandwidth, int *lo, int *hi) const
+{
+    *lo = normal_filter[mode][0];
+    *hi = normal_filter[mode][1];
+
+    if (*lo + *hi == 0)
+    {
+        *lo = -bandwidth / 2;
+        *hi =  bandwidth / 2;
+    }
+    else if (*lo >= 0 && *hi >= 0)
+    {
+        *hi = *lo + bandwidth;
+    }
+    else if (*lo <= 0 && *hi <= 0)
+    {
+        *lo = *hi - bandwidth;
+    }
+}
+
+void HeadlessReceiver::setPassband(int bandwidth)
+{
+    int lo, hi;
+    passbandEdges(d_mode, bandwidth, &lo, &hi);
+    rx->set_filter((double)lo, (double)hi, receiver::FILTER_SHAPE_NORMAL);
+
+    QMetaObject::invokeMethod(remote, "setPassband", Qt::QueuedConnection,
+                              Q_ARG(int, lo), Q_ARG(int, hi));
+}
+
+void HeadlessReceiver::setSqlLevel(double level_db)
+{
+    rx->set_sql_level(level_db);
+    QMetaObject::invokeMethod(remote, "setSquelchLevel", Qt::QueuedConnection,
+                              Q_ARG(double, level_db));
+}
+
+void HeadlessReceiver::setAudioGain(float gain)
+{
+    d_audio_gain = gain;
+    rx->set_af_gain(gain);
+}
+
+/** Mute the audio, as the mute button of DockAudio does through the gain. */
+void HeadlessReceiver::setAudioMuted(bool muted)
+{
+    rx->set_af_gain(muted ? -INFINITY : d_audio_gain);
+    QMetaObject::invokeMethod(remote, "setAudioMuted", Qt::QueuedConnection,
+                              Q_ARG(bool, muted));
+}
+
+void HeadlessReceiver::setGain(QString name, double value)
+{
+    rx->set_gain(name.toStdString(), value);
+}
+
+/** Start or stop the flow graph and the timers that feed the remote control. */
+void HeadlessReceiver::setDsp(bool enabled)
+{
+    QMetaObject::invokeMethod(remote, "setReceiverStatus", Qt::QueuedConnection,
+                              Q_ARG(bool, enabled));
+    if (enabled)
+    {
+        rx->start();
+        meter_timer.start(METER_INTERVAL_MS);
+        fft_timer.start();
+    }
+    else
+    {
+        meter_timer.stop();
+        fft_timer.stop();
+        rx->stop();
+    }
+}
+
+/** Record the audio to the folder of the audio recordings, named as by DockAudio. */
+void HeadlessReceiver::startAudioRecorder()
+{
+    QString file_name = QDateTime::currentDateTime().toUTC().toString("gqrx_yyyyMMdd_hhmmss");
+    QString path = QString("%1/%2_%3.wav").arg(d_audio_rec_dir).arg(file_name).arg(d_rx_freq);
+
+    if (d_mode == DockRxOpt::MODE_OFF || rx->start_audio_recording(path.toStdString()))
+    {
+        qWarning() << "Error starting audio recorder";
+        QMetaObject::invokeMethod(remote, "stopAudioRecorder", Qt::QueuedConnection);
+        return;
+    }
+    qInfo() << "Recording audio to" << path;
+}
+
+void HeadlessReceiver::stopAudioRecorder()
+{
+    if (rx->stop_audio_recording())
+        qWarning() << "Error stopping audio recorder";
+}
+
+/**
+ * Record I/Q to the folder of the baseband recordings, named as by
+ * MainWindow::startIqRecording(). Always in the raw format, with the sample
+ * format and compression of the config.
+ */
+void HeadlessReceiver::startIqRecorder()
+{
+    auto freq = qRound64(rx->get_rf_freq());
+    auto sr = qRound64(rx->get_input_rate());
+    auto dec = (quint32)(rx->get_input_decim());
+    iq_file_format format = IQ_FILE_CF32;
+    if (d_iq_rec_samples == "cs16")
+        format = IQ_FILE_CS16;
+    else if (d_iq_rec_samples == "cs8")
+        format = IQ_FILE_CS8;
+    QString path = QDateTime::currentDateTimeUtc()
+                   .toString("%1/gqrx_yyyyMMdd_hhmmss_%2_%3_%4.raw")
+                   .arg(d_iq_rec_dir).arg(freq).arg(sr / dec)
+                   .arg(format == IQ_FILE_CF32 ? QString("fc") : d_iq_rec_samples);
+    if (d_iq_rec_compress)
+        path += ".gz";
+
+    if (rx->start_iq_recording(path.toStdString(), format, d_iq_rec_compress))
+    {
+        qWarning() << "Error starting I/Q recorder";
+        QMetaObject::invokeMethod(remote, "stopIqRecorder", Qt::QueuedConnection);
+        return;
+    }
+    qInfo() << "Recording I/Q data to" << path;
+}
+
+/** Capture from the pre-trigger ring, see IqCapture. */
+void HeadlessReceiver::triggerIqCapture(const QString &reason)
+{
+    bool extending = rx->iq_capture_active();
+    if (!iqCapture->trigger(reason))
+        qWarning() << "Error starting I/Q capture";
+    else if (!extending)
+        qInfo().noquote() << "Capturing I/Q:" << reason;
+}
+
+void HeadlessReceiver::stopIqRecorder()
+{
+    float ring_fill;
+    uint64_t dropped = 0;
+    rx->get_iq_recording_stats(ring_fill, dropped);
+
+    if (rx->stop_iq_recording())
+        qWarning() << "Error stopping I/Q recorder";
+    else if (dropped > 0)
+        qWarning() << "I/Q recorder dropped" << dropped << "samples";
+}
+
+/** Start or stop the signal detector, stopping closes the open signals. */
+void HeadlessReceiver::setDetectorEnabled(bool enabled)
+{
+    if (enabled == detectorEnabled)
+        return;
+
+    detectorEnabled = enabled;
+    if (!enabled)
+    {
+        SignalDetector::Update update;
+        signalDetector.reset(update);
+        QMetaObject::invokeMethod(remote, "setDetections", Qt::QueuedConnection,
+                                  Q_ARG(QString, QString()));
+    }
+}
+
+/** Collect the performance counters for "p PERF". */
+void HeadlessReceiver::setPerfCounters(bool enabled)
+{
+    rx->set_perf_counters(enabled);
+    QMetaObject::invokeMethod(remote, "setPerfStatus", Qt::QueuedConnection,
+                              Q_ARG(bool, enabled));
+    if (enabled)
+        perf_timer.start(PERF_INTERVAL_MS);
+    else
+        perf_timer.stop();
+}
+
+/** Run the detector on a frame and log the signals it reports. */
+void HeadlessReceiver::runDetector(const iq_fft_frame_sptr &frame)
+{
+    const qint64 ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          frame->timestamp.time_since_epoch()).count();
+    if (!detectorLevels.setFrame(frame->data.data(), (int)frame->data.size(),
+                                 frame->center_freq, frame->sample_rate, frame->seq))
+        return;
+
+    SignalDetector::Update update;
+    if (!signalDetector.process(detectorLevels.dB(), detectorLevels.size(),
+                                detectorLevels.centerFreq(), detectorLevels.sampleRate(),
+                                ms, update))
+        return;
+
+    for (const SignalDetector::Detection &det : update.opened)
+    {
+        QString text = QString("Detected signal %1 at %2 Hz, %3 Hz wide, SNR %4 dB")
+                       .arg(det.event.id).arg(det.event.center_freq, 0, 'f', 0)
+                       .arg(det.event.bandwidth, 0, 'f', 0).arg(det.snr_db, 0, 'f', 1);
+        qInfo().noquote() << text;
+        if (d_capture_detector)
+            triggerIqCapture(text);
+    }
+    QMetaObject::invokeMethod(remote, "setDetections", Qt::QueuedConnection,
+                              Q_ARG(QString, signalDetector.describe()));
+}
+
+/**
+ * @brief Add or retune an additional VFO.
+ * @param vfo Number of the VFO given by the remote control.
+ * @param freq Frequency including the LNB LO, as the main frequency.
+ * @param mode Mode index, as for selectDemod().
+ * @param passband Passband in Hz, 0 for the normal filter preset of the mode.
+ */
+void HeadlessReceiver::setVfo(int vfo, qint64 freq, int mode, int passband)
+{
+    receiver::rx_demod demod = modeDemod(mode);
+    if (demod == receiver::RX_DEMOD_OFF)
+        return;
+
+    int lo = normal_filter[mode][0];
+    int hi = normal_filter[mode][1];
+    if (passband > 0)
+        passbandEdges(mode, passband, &lo, &hi);
+
+    auto it = d_vfos.find(vfo);
+    if (it == d_vfos.end())
+    {
+        int id = rx->add_vfo((double)(freq - d_lnb_lo - d_hw_freq), demod);
+        if (id < 0)
+            return;
+        it = d_vfos.insert(vfo, Vfo{id, freq, -1});
+    }
+    else
+    {
+        rx->set_vfo_demod(it->id, demod);
+        it->freq = freq;
+    }
+    rx->set_vfo_filter(it->id, lo, hi, receiver::FILTER_SHAPE_NORMAL);
+    updateVfos();
+}
+
+void HeadlessReceiver::removeVfo(int vfo)
+{
+    auto it = d_vfos.find(vfo);
+    if (it == d_vfos.end())
+        return;
+
+    rx->remove_vfo(it->id);
+    d_vfos.erase(it);
+    d_iq_streams.remove(vfo);
+    updateVfos();
+}
+
+void HeadlessReceiver::setVfoMuted(int vfo, bool muted)
+{
+    if (d_vfos.contains(vfo))
+        rx->set_vfo_audio_muted(d_vfos[vfo].id, muted);
+}
+
+void HeadlessReceiver::setVfoSqlLevel(int vfo, double level_db)
+{
+    if (d_vfos.contains(vfo))
+        rx->set_vfo_sql_level(d_vfos[vfo].id, level_db);
+}
+
+/** Stream the audio of a VFO over UDP, port 0 stops it. */
+void HeadlessReceiver::setVfoUdpStreaming(int vfo, const QString &host, int port, bool stereo, int format)
+{
+    if (!d_vfos.contains(vfo))
+        return;
+
+    if (port == 0)
+        rx->stop_vfo_udp_streaming(d_vfos[vfo].id);
+    else
+        rx->start_vfo_udp_streaming(d_vfos[vfo].id, host.toStdString(), port, stereo,
+                                    (udp_stream_format) format, vfo);
+}
+
+/**
+ * Record the audio of a VFO to the folder of the audio recordings: for
+ * mode 1 into one file, for mode 2 a file per transmission while the
+ * squelch is open, 0 stops the recording.
+ */
+void HeadlessReceiver::setVfoRecording(int vfo, int mode)
+{
+    if (!d_vfos.contains(vfo))
+        return;
+
+    const Vfo &v = d_vfos[vfo];
+    rx->stop_vfo_audio_recording(v.id);
+    if (mode == 1)
+    {
+        QString file_name = QDateTime::currentDateTime().toUTC().toString("gqrx_yyyyMMdd_hhmmss");
+        QString path = QString("%1/%2_%3.wav").arg(d_audio_rec_dir).arg(file_name).arg(v.freq);
+        rx->start_vfo_audio_recording(v.id, path.toStdString());
+    }
+    else if (mode == 2)
+    {
+        QString prefix = QString("%1/gqrx_%2").arg(d_audio_rec_dir).arg(v.freq);
+        rx->start_vfo_audio_log(v.id, prefix.toStdString());
+    }
+}
+
+/** Decode AFSK1200 on a VFO, the packets are pushed by the remote control. */
+void HeadlessReceiver::setVfoAfsk(int vfo, bool enabled)
+{
+    if (!d_vfos.contains(vfo))
+        return;
+
+    Vfo &v = d_vfos[vfo];
+    if (enabled && v.afsk_id < 0)
+    {
+        v.afsk_id = rx->start_decoder(std::make_shared<afsk1200_decoder>(), v.id);
+    }
+    else if (!enabled && v.afsk_id >= 0)
+    {
+        rx->stop_decoder(v.afsk_id);
+        v.afsk_id = -1;
+    }
+}
+
+void HeadlessReceiver::setVfoChannels(int channels)
+{
+    if (rx->set_vfo_channels(channels) != receiver::STATUS_OK)
+        qWarning() << "Can not split the input into" << channels << "channels";
+}
+
+/**
+ * Stream the I/Q of the baseband, source 0, or of a VFO to the network,
+ * replacing the stream it had. No ports stops it.
+ */
+void HeadlessReceiver::setIqStream(int source, int format, int tcp_port, const QString &group, int udp_port)
+{
+    if (d_iq_streams.contains(source))
+        rx->stop_iq_stream(d_iq_streams.take(source));
+    if ((tcp_port == 0 && udp_port == 0) || (source > 0 && !d_vfos.contains(source)))
+        return;
+
+    const int id = rx->start_iq_stream(source > 0 ? d_vfos[source].id : -1,
+                                       (iq_file_format) format, tcp_port,
+                                       group.toStdString(), udp_port);
+    if (id < 0)
+        qWarning() << "Can not start the I/Q stream of source" << source;
+    else
+        d_iq_streams.insert(source, id);
+}
+
+/** Keep the VFOs on their frequency after retuning. */
+void HeadlessReceiver::updateVfos()
+{
+    std::map<int, double> offsets;
+    for (auto it = d_vfos.constBegin(); it != d_vfos.constEnd(); ++it)
+        offsets[it->id] = (double)(it->freq - d_lnb_lo - d_hw_freq);
+    rx->set_vfo_offsets(offsets);
+}
+
+/** Signal levels for the remote control, and the check for a stalled input. */
+void HeadlessReceiver::meterTimeout()
+{
+    if (rx->check_input_stall(d_stall_ms))
+    {
+        qWarning() << "Input device stalled, switched to standby device"
+                   << m_settings->value("input/standby_device").toString();
+        updateGainStages(true);
+    }
+
+    uint64_t events, samples;
+    rx->get_input_drops(events, samples);
+    if (events != d_drop_events)
+    {
+        qWarning().noquote() << QDateTime::currentDateTime().toString(Qt::ISODateWithMs)
+                             << "Input gap:" << events - d_drop_events << "new," << events
+                             << "in total with" << samples << "samples dropped, input rate"
+                             << rx->get_input_rate() << "Hz, decimation" << rx->get_input_decim();
+        d_drop_events = events;
+    }
+
+    QMetaObject::invokeMethod(remote, "setSignalLevel", Qt::QueuedConnection,
+                              Q_ARG(float, rx->get_signal_pwr()));
+    std::string msg;
+    for (auto it = d_vfos.constBegin(); it != d_vfos.constEnd(); ++it)
+    {
+        QMetaObject::invokeMethod(remote, "setVfoLevel", Qt::QueuedConnection,
+                                  Q_ARG(int, it.key()),
+                                  Q_ARG(float, rx->get_vfo_signal_pwr(it->id)));
+        while (it->afsk_id >= 0 && rx->get_decoder_message(it->afsk_id, msg))
+            QMetaObject::invokeMethod(remote, "addPacket", Qt::QueuedConnection,
+                                      Q_ARG(int, it.key()),
+                                      Q_ARG(QString, QString::fromStdString(msg)));
+    }
+}
+
+void HeadlessReceiver::perfTimeout()
+{
+    QMetaObject::invokeMethod(remote, "setBlockPerf", Qt::QueuedConnection,
+                              Q_ARG(QString, RemoteControl::formatBlockPerf(rx->get_block_perf())));
+}
+
+/** Publish a frame to the FFT subscribers, the FFT streams and the detector. */
+void HeadlessReceiver::fftTimeout()
+{
+    if (rx->iq_fft_size() > 0)
+        rx->publish_iq_fft_frame();
+}
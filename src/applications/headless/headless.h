@@ -0,0 +1,143 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2014 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <QMap>
+#include <QObject>
+#include <QSettings>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+
+#include "applications/gqrx/receiver.h"
+#include "applications/gqrx/remote_control.h"
+#include "applications/gqrx/cluster.h"
+#include "qtgui/iq_capture.h"
+#include "qtgui/signal_detector.h"
+#include "qtgui/spectrum_levels.h"
+#include "qtgui/waterfall_snapshot.h"
+
+/*! \brief The receiver without the GUI.
+ *
+ * Runs the flow graph, the remote control with its streams, the audio and
+ * I/Q recorders and the signal detector, set up from the same
+ * configuration file as the GUI. Everything that is changed at runtime is
+ * changed through the remote control, which takes the place of the
+ * widgets here: its signals are applied to the receiver as MainWindow
+ * does, and the state it reports is sent back to it.
+ *
+ * The configuration is read but never written.
+ */
+class HeadlessReceiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HeadlessReceiver(const QString &cfgfile, QObject *parent = nullptr);
+    ~HeadlessReceiver() override;
+
+    bool configOk; /*!< Main app uses this flag to know whether we should abort or continue. */
+
+private slots:
+    void setNewFrequency(qint64 rx_freq);
+    void setFilterOffset(qint64 freq_hz);
+    void setLnbLo(double freq_mhz);
+    void selectDemod(int mode_idx);
+    void setPassband(int bandwidth);
+    void setSqlLevel(double level_db);
+    void setAudioGain(float gain);
+    void setAudioMuted(bool muted);
+    void setGain(QString name, double value);
+    void setDsp(bool enabled);
+    void startAudioRecorder();
+    void stopAudioRecorder();
+    void startIqRecorder();
+    void stopIqRecorder();
+    void triggerIqCapture(const QString &reason);
+    void setDetectorEnabled(bool enabled);
+    void setPerfCounters(bool enabled);
+    void setVfo(int vfo, qint64 freq, int mode, int passband);
+    void removeVfo(int vfo);
+    void setVfoMuted(int vfo, bool muted);
+    void setVfoSqlLevel(int vfo, double level_db);
+    void setVfoUdpStreaming(int vfo, const QString &host, int port, bool stereo, int format);
+    void setVfoRecording(int vfo, int mode);
+    void setVfoAfsk(int vfo, bool enabled);
+    void setVfoChannels(int channels);
+    void setIqStream(int source, int format, int tcp_port, const QString &group, int udp_port);
+    void meterTimeout();
+    void fftTimeout();
+    void perfTimeout();
+
+private:
+    /*! \brief An additional VFO added by the remote control. */
+    struct Vfo
+    {
+        int     id;     /*!< Id in the receiver. */
+        qint64  freq;   /*!< Frequency including the LNB LO. */
+        int     afsk_id; /*!< Receiver id of its AFSK1200 decoder, or -1. */
+    };
+
+    bool loadConfig(const QString &cfgfile);
+    void updateGainStages(bool read_from_device);
+    void updateVfos();
+    void passbandEdges(int mode, int bandwidth, int *lo, int *hi) const;
+    void runDetector(const iq_fft_frame_sptr &frame);
+
+    receiver       *rx;
+    RemoteControl  *remote;
+    QThread        *remoteThread;
+    ClusterMember  *clusterMember;
+    ClusterCoordinator *clusterCoordinator;
+    QSettings      *m_settings;
+    IqCapture      *iqCapture;
+
+    QTimer          meter_timer;
+    QTimer          fft_timer;
+    QTimer          perf_timer;
+
+    int             fftSubscription;
+    CWaterfallSnapshot waterfallSnapshot;
+    SignalDetector  signalDetector;
+    SpectrumLevels  detectorLevels;
+    bool            detectorEnabled;
+
+    qint64          d_lnb_lo;       /*!< LNB LO in Hz. */
+    qint64          d_hw_freq;      /*!< Frequency of the device in Hz. */
+    qint64          d_rx_freq;      /*!< Frequency including filter offset and LNB LO. */
+    int             d_mode;         /*!< Mode index, c.f. DockRxOpt::rxopt_mode_idx */
+    float           d_audio_gain;   /*!< Audio gain in dB while not muted. */
+    double          d_cw_offset;
+    uint64_t        d_drop_events;  /*!< Input gaps already logged. */
+    int             d_stall_ms;     /*!< Input stall before the standby device takes over. */
+    QString         d_audio_rec_dir;
+    QString         d_iq_rec_dir;
+    QString         d_iq_rec_samples;   /*!< cf32, cs16 or cs8 */
+    bool            d_iq_rec_compress;
+    bool            d_capture_detector; /*!< Capture the I/Q of new signals. */
+    QMap<int, Vfo>  d_vfos;
+    QMap<int, int>  d_iq_streams;  /*!< Receiver ids of the I/Q streams by VFO, 0 for the baseband. */
+};
+
+#endif // HEADLESS_H
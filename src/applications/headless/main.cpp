@@ -0,0 +1,143 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <csignal>
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QString>
+#include <QtGlobal>
+
+#ifdef WITH_PORTAUDIO
+#include <portaudio.h>
+#endif
+
+#include "applications/gqrx/gqrx.h"
+#include "applications/headless/benchmark.h"
+#include "applications/headless/headless.h"
+
+static void quit_handler(int)
+{
+    QCoreApplication::quit();
+}
+
+int main(int argc, char *argv[])
+{
+    // The waterfall snapshots are drawn into QImages with fonts, which needs
+    // a QGuiApplication. The offscreen platform works without a display.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    QCoreApplication::setOrganizationName(GQRX_ORG_NAME);
+    QCoreApplication::setOrganizationDomain(GQRX_ORG_DOMAIN);
+    QCoreApplication::setApplicationName(GQRX_APP_NAME);
+    QCoreApplication::setApplicationVersion(VERSION);
+
+    // setup controlport via environment variables, c.f. gqrx/main.cpp
+    if (qputenv("GR_CONF_CONTROLPORT_ON", "False"))
+        qDebug() << "Controlport disabled";
+    else
+        qDebug() << "Failed to disable controlport";
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Gqrx receiver without the GUI " VERSION);
+    parser.addHelpOption();
+    parser.addOptions({
+        {{"c", "conf"}, "Run with this config file", "file", "default.conf"},
+        {"benchmark", "Find the highest input rate the receiver keeps up with and exit"},
+        {"bench-file", "Raw complex float recording to play, a synthetic signal otherwise", "file"},
+        {"bench-demod", "RAW, AM, AMSYNC, NFM, SSB, WFM or WFM_S", "demod", "NFM"},
+        {"bench-decim", "Input decimation, a power of 2", "n", "1"},
+        {"bench-fft-size", "Points of the main spectrum", "n", "8192"},
+        {"bench-nb", "Run with both noise blankers on"},
+        {"bench-vfos", "VFOs besides the main channel", "n", "0"},
+        {"bench-min-rate", "Lowest input rate tried", "Hz", "250000"},
+        {"bench-max-rate", "Highest input rate tried", "Hz", "20000000"},
+        {"bench-precision", "Stop the search within this share of the rate", "share", "0.02"},
+        {"bench-seconds", "Time measured at each rate", "s", "5"},
+        {"bench-report", "Write the JSON report to this file rather than stdout", "file"},
+    });
+    parser.process(app);
+
+#ifdef WITH_PORTAUDIO
+    PaError     err = Pa_Initialize();
+    if (err != paNoError)
+    {
+        qCritical() << "Portaudio error:" << Pa_GetErrorText(err);
+        return 1;
+    }
+#endif
+
+    int return_code = 1;
+    if (parser.isSet("benchmark"))
+    {
+        BenchmarkConfig config;
+        config.file = parser.value("bench-file");
+        config.demod = parser.value("bench-demod");
+        config.decim = (unsigned int)std::max(1, parser.value("bench-decim").toInt());
+        config.fft_size = parser.value("bench-fft-size").toInt();
+        config.nb = parser.isSet("bench-nb");
+        config.vfos = std::max(0, parser.value("bench-vfos").toInt());
+        config.min_rate = parser.value("bench-min-rate").toDouble();
+        config.max_rate = parser.value("bench-max-rate").toDouble();
+        config.precision = std::max(0.001, parser.value("bench-precision").toDouble());
+        config.seconds = std::max(0.5, parser.value("bench-seconds").toDouble());
+
+        QJsonObject report = ReceiverBenchmark(config).run();
+        QByteArray json = QJsonDocument(report).toJson();
+        QFile out;
+        bool opened;
+        if (parser.isSet("bench-report"))
+        {
+            out.setFileName(parser.value("bench-report"));
+            opened = out.open(QIODevice::WriteOnly | QIODevice::Truncate);
+        }
+        else
+        {
+            opened = out.open(stdout, QIODevice::WriteOnly);
+        }
+        if (opened)
+            out.write(json);
+        return_code = (opened && !report.contains("error")) ? 0 : 1;
+    }
+    else
+    {
+        HeadlessReceiver receiver(parser.value("conf"));
+        if (receiver.configOk)
+        {
+            // Stop cleanly, so that recordings are closed
+            std::signal(SIGINT, quit_handler);
+            std::signal(SIGTERM, quit_handler);
+            return_code = app.exec();
+        }
+    }
+
+#ifdef WITH_PORTAUDIO
+    Pa_Terminate();
+#endif
+
+    return return_code;
+}
@@ -0,0 +1,46 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include "dsp/afsk1200/afsk1200_decoder.h"
+
+
+afsk1200_decoder::afsk1200_decoder()
+    : d_afsk(new CAfsk12()),
+      d_buf(CORRLEN, 0.0f)
+{
+    /* Without a context object the lambda runs directly in demod() */
+    QObject::connect(d_afsk, &CAfsk12::newMessage, [this](const QString &msg) {
+        emit_message(msg.toStdString());
+    });
+}
+
+afsk1200_decoder::~afsk1200_decoder()
+{
+    delete d_afsk;
+}
+
+void afsk1200_decoder::process(const float *samples, int length)
+{
+    d_buf.insert(d_buf.end(), samples, samples + length);
+    d_afsk->demod(d_buf.data(), length);
+    d_buf.erase(d_buf.begin(), d_buf.begin() + length);
+}
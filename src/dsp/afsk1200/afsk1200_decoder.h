@@ -0,0 +1,51 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef AFSK1200_DECODER_H
+#define AFSK1200_DECODER_H
+
+#include <vector>
+#include "dsp/data_decoder.h"
+#include "dsp/afsk1200/cafsk12.h"
+
+/*! \brief AFSK1200 packet decoder for decoder_sink_f.
+ *  \ingroup DSP
+ *
+ * Wraps CAfsk12 and keeps the CORRLEN samples of overlap it needs between
+ * calls to process().
+ */
+class afsk1200_decoder : public data_decoder
+{
+public:
+    afsk1200_decoder();
+    ~afsk1200_decoder();
+
+    const char *name() const { return "AFSK1200"; }
+    unsigned int sample_rate() const { return FREQ_SAMP; }
+    void process(const float *samples, int length);
+
+private:
+    CAfsk12            *d_afsk;
+    std::vector<float>  d_buf;   /*!< Overlap followed by the new samples. */
+};
+
+#endif /* AFSK1200_DECODER_H */
@@ -25,6 +25,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include "dsp/cpu_dispatch.h"
 #include "filter.h"
 #include "cafsk12.h"
 
@@ -80,11 +81,11 @@ void CAfsk12::demod(float *buffer, int length)
         length -= numfill;
         state->l1.afsk12.subsamp = 0;
     }
-    for (; length >= SUBSAMP; length -= SUBSAMP, buffer += SUBSAMP) {
-        f = fsqr(mac(buffer, corr_mark_i, CORRLEN)) +
-            fsqr(mac(buffer, corr_mark_q, CORRLEN)) -
-            fsqr(mac(buffer, corr_space_i, CORRLEN)) -
-            fsqr(mac(buffer, corr_space_q, CORRLEN));
+    int num = length / SUBSAMP;
+    correlate(buffer, num);
+    for (int n = 0; n < num; n++) {
+        f = fsqr(sum_mark_i[n]) + fsqr(sum_mark_q[n]) -
+            fsqr(sum_space_i[n]) - fsqr(sum_space_q[n]);
         state->l1.afsk12.dcd_shreg <<= 1;
         state->l1.afsk12.dcd_shreg |= (f > 0);
         verbprintf(10, "%c", '0'+(state->l1.afsk12.dcd_shreg & 1));
@@ -108,7 +109,45 @@ void CAfsk12::demod(float *buffer, int length)
             hdlc_rxbit(state, curbit);
         }
     }
-    state->l1.afsk12.subsamp = length;
+    state->l1.afsk12.subsamp = length - num * SUBSAMP;
+}
+
+/* Add tap c of the four correlators to the sums at num points SUBSAMP apart */
+DSP_MULTIVERSION
+static void correlate_tap(const float *b, int num, const float c[4], float *mark_i,
+                          float *mark_q, float *space_i, float *space_q)
+{
+    for (int n = 0; n < num; n++) {
+        const float x = b[n * SUBSAMP];
+        mark_i[n] += x * c[0];
+        mark_q[n] += x * c[1];
+        space_i[n] += x * c[2];
+        space_q[n] += x * c[3];
+    }
+}
+
+/*! \brief Correlate the tones at each of the num bit sampling points.
+ *
+ * One pass over all points per tap rather than one mac() per point and
+ * tone, so the loop over the points can be vectorized. Each sum still
+ * adds the taps in the same order, the result is the same as with mac().
+ */
+void CAfsk12::correlate(const float *buffer, int num)
+{
+    sum_mark_i.assign(num, 0.0f);
+    sum_mark_q.assign(num, 0.0f);
+    sum_space_i.assign(num, 0.0f);
+    sum_space_q.assign(num, 0.0f);
+
+    float *mark_i = sum_mark_i.data();
+    float *mark_q = sum_mark_q.data();
+    float *space_i = sum_space_i.data();
+    float *space_q = sum_space_q.data();
+
+    for (int i = 0; i < CORRLEN; i++) {
+        const float c[4] = { corr_mark_i[i], corr_mark_q[i], corr_space_i[i], corr_space_q[i] };
+        correlate_tap(buffer + i, num, c, mark_i, mark_q, space_i, space_q);
+    }
 }
 
 /** HDLC functions **/
@@ -24,6 +24,7 @@
 #define CAFSK12_H
 
 #include <QObject>
+#include <vector>
 
 extern const float costabf[0x400];
 #define COS(x) costabf[(((x)>>6)&0x3ffu)]
@@ -166,8 +167,16 @@ private:
     float corr_space_i[CORRLEN];
     float corr_space_q[CORRLEN];
 
+    /* Correlations at the bit sampling points of one demod() call */
+    std::vector<float> sum_mark_i;
+    std::vector<float> sum_mark_q;
+    std::vector<float> sum_space_i;
+    std::vector<float> sum_space_q;
+
     struct demod_state *state;
 
+    void correlate(const float *buffer, int num);
+
     /* HDLC functions */
     void hdlc_init(struct demod_state *s);
     void hdlc_rxbit(struct demod_state *s, int bit);
@@ -37,8 +37,11 @@
 //or implied, of Moe Wheatley.
 //==========================================================================================
 
+#include <algorithm>
 #include <dsp/agc_impl.h>
+#include <dsp/cpu_dispatch.h>
 #include <math.h>
+#include <volk/volk.h>
 
 //////////////////////////////////////////////////////////////////////
 // Local Defines
@@ -75,10 +78,15 @@
                             // corresponding to -160dB.
                             // K = 10^(-8 + log(MAX_AMP))
 
+#define LOG10_2     0.30102999566f   // log10(x) = log2(x) * LOG10_2
+#define LN_10       2.30258509299f   // 10^x = exp(x * LN_10)
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
 
+std::atomic<bool> CAgc::s_BlockMode(true);
+
 CAgc::CAgc()
 {
     m_AgcOn = true;
@@ -106,6 +114,8 @@ CAgc::CAgc()
     m_WindowSamples = 0;
     m_HangTime = 0;
     m_HangTimer = 0;
+    m_MaxHead = 0;
+    m_MaxCount = 0;
 }
 
 CAgc::~CAgc()
@@ -144,7 +154,7 @@ void CAgc::SetParameters(bool AgcOn,  bool UseHang, int Threshold, int ManualGai
         //clear out delay buffer and init some things if sample rate changes
         m_SampleRate = SampleRate;
         m_DelaySamples = (int)(m_SampleRate * DELAY_TIMECONST);
-        m_WindowSamples = (int)(m_SampleRate * WINDOW_TIMECONST);
+        m_WindowSamples = std::min((int)(m_SampleRate * WINDOW_TIMECONST), MAX_DELAY_BUF);
         for (int i = 0; i < MAX_DELAY_BUF; i++)
         {
             m_SigDelayBuf[i] = 0.0;
@@ -157,8 +167,9 @@ void CAgc::SetParameters(bool AgcOn,  bool UseHang, int Threshold, int ManualGai
         m_AttackAve = -5.0;
         m_MagBufPos = 0;
 
-        m_MagDeque.clear();
-        m_MagDeque.push_back(m_WindowSamples - 1);
+        m_MaxHead = 0;
+        m_MaxCount = 1;
+        m_MaxQueue[0] = m_WindowSamples - 1;
     }
 
     // convert m_ThreshGain to linear manual gain value
@@ -196,122 +207,209 @@ void CAgc::SetParameters(bool AgcOn,  bool UseHang, int Threshold, int ManualGai
 //////////////////////////////////////////////////////////////////////
 void CAgc::ProcessData(int Length, const TYPECPX * pInData, TYPECPX * pOutData)
 {
-    float       gain;
-    float       mag;
-    TYPECPX     delayedin;
-
     if (m_AgcOn)
     {
-        for (int i = 0; i < Length; i++)
+        if (s_BlockMode.load(std::memory_order_relaxed))
+            ProcessBlock(Length, pInData, pOutData);
+        else
+            ProcessSamples(Length, pInData, pOutData);
+    }
+    else
+    {
+        // manual gain just multiply by m_ManualGain
+        volk_32f_s32f_multiply_32f((float *)pOutData, (const float *)pInData,
+                                   m_ManualAgcGain, 2 * Length);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Put the latest magnitude into the sliding window of 'm_WindowSamples'
+// magnitudes and return the peak value within the window.
+//////////////////////////////////////////////////////////////////////
+float CAgc::WindowPeak(float mag)
+{
+    const int mask = MAX_DELAY_BUF - 1;
+
+    if (m_MaxQueue[m_MaxHead] == m_MagBufPos)
+    {
+        m_MaxHead = (m_MaxHead + 1) & mask;
+        m_MaxCount--;
+    }
+
+    while (m_MaxCount > 0 && mag >= m_MagBuf[m_MaxQueue[(m_MaxHead + m_MaxCount - 1) & mask]])
+        m_MaxCount--;
+
+    m_MaxQueue[(m_MaxHead + m_MaxCount) & mask] = m_MagBufPos;
+    m_MaxCount++;
+
+    float peak = m_MagBuf[m_MaxQueue[m_MaxHead]];
+
+    m_MagBuf[m_MagBufPos++] = mag;       // put latest mag sample in buffer;
+    if (m_MagBufPos >= m_WindowSamples)  // deal with magnitude buffer wrap around
+        m_MagBufPos = 0;
+
+    return peak;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Update the attack and decay averagers with the latest peak and return
+// the greater of the two.
+//////////////////////////////////////////////////////////////////////
+float CAgc::Average(float peak)
+{
+    m_Peak = peak;
+
+    if (m_Peak > m_AttackAve)
+        // if power is rising (use m_AttackRiseAlpha time constant)
+        m_AttackAve = (1.0f - m_AttackRiseAlpha) * m_AttackAve +
+                      m_AttackRiseAlpha * m_Peak;
+    else
+        // else magnitude is falling (use  m_AttackFallAlpha time constant)
+        m_AttackAve = (1.0f - m_AttackFallAlpha) * m_AttackAve +
+                      m_AttackFallAlpha * m_Peak;
+
+    if (m_UseHang)
+    {
+        // using hang timer mode
+        if (m_Peak > m_DecayAve)
         {
-            // get latest input sample
-            TYPECPX     in = pInData[i];
-
-            // Get delayed sample of input signal
-            delayedin = m_SigDelayBuf[m_SigDelayPtr];
-
-            // put new input sample into signal delay buffer
-            m_SigDelayBuf[m_SigDelayPtr++] = in;
-
-            // deal with delay buffer wrap around
-            if (m_SigDelayPtr >= m_DelaySamples)
-                m_SigDelayPtr = 0;
-
-            mag = fabsf(in.real());
-            float mim = fabsf(in.imag());
-            if (mim > mag)
-                mag = mim;
-            mag = log10f(mag + MIN_CONSTANT) - LOG_MAX_AMPL;
-
-            // create a sliding window of 'm_WindowSamples' magnitudes and output the peak value within the sliding window
-            if (m_MagDeque.front() == m_MagBufPos)
-                m_MagDeque.pop_front();
-
-            while ((!m_MagDeque.empty()) && mag >= m_MagBuf[m_MagDeque.back()])
-                m_MagDeque.pop_back();
-
-            m_MagDeque.push_back(m_MagBufPos);
-
-            m_Peak = m_MagBuf[m_MagDeque.front()];
-
-            m_MagBuf[m_MagBufPos++] = mag;       // put latest mag sample in buffer;
-            if (m_MagBufPos >= m_WindowSamples)  // deal with magnitude buffer wrap around
-                m_MagBufPos = 0;
-
-            if (m_UseHang)
-            {
-                // using hang timer mode
-                if (m_Peak > m_AttackAve)
-                    // if power is rising (use m_AttackRiseAlpha time constant)
-                    m_AttackAve = (1.0f - m_AttackRiseAlpha) * m_AttackAve +
-                                  m_AttackRiseAlpha * m_Peak;
-                else
-                    // else magnitude is falling (use  m_AttackFallAlpha time constant)
-                    m_AttackAve = (1.0f - m_AttackFallAlpha) * m_AttackAve +
-                                  m_AttackFallAlpha * m_Peak;
-
-                if (m_Peak > m_DecayAve)
-                {
-                    // if magnitude is rising (use m_DecayRiseAlpha time constant)
-                    m_DecayAve = (1.0f - m_DecayRiseAlpha) * m_DecayAve +
-                                  m_DecayRiseAlpha * m_Peak;
-                    // reset hang timer
-                    m_HangTimer = 0;
-                }
-                else
-                {	// here if decreasing signal
-                    if (m_HangTimer < m_HangTime)
-                        m_HangTimer++;	// just inc and hold current m_DecayAve
-                    else	// else decay with m_DecayFallAlpha which is RELEASE_TIMECONST
-                        m_DecayAve = (1.0f - m_DecayFallAlpha) * m_DecayAve +
-                                     m_DecayFallAlpha * m_Peak;
-                }
-            }
-            else
-            {
-                // using exponential decay mode
-                // perform average of magnitude using 2 averagers each with separate rise and fall time constants
-                if (m_Peak > m_AttackAve)	//if magnitude is rising (use m_AttackRiseAlpha time constant)
-                    m_AttackAve = (1.0f - m_AttackRiseAlpha) * m_AttackAve +
-                                  m_AttackRiseAlpha * m_Peak;
-                else
-                    // else magnitude is falling (use  m_AttackFallAlpha time constant)
-                    m_AttackAve = (1.0f - m_AttackFallAlpha) * m_AttackAve +
-                                  m_AttackFallAlpha * m_Peak;
-
-                if (m_Peak > m_DecayAve)
-                    // if magnitude is rising (use m_DecayRiseAlpha time constant)
-                    m_DecayAve = (1.0f - m_DecayRiseAlpha) * m_DecayAve +
-                                 m_DecayRiseAlpha * m_Peak;
-                else
-                    // else magnitude is falling (use m_DecayFallAlpha time constant)
-                    m_DecayAve = (1.0f - m_DecayFallAlpha) * m_DecayAve +
-                                 m_DecayFallAlpha * m_Peak;
-            }
-
-            // use greater magnitude of attack or Decay Averager
-            if (m_AttackAve > m_DecayAve)
-                mag = m_AttackAve;
-            else
-                mag = m_DecayAve;
-
-            // calc gain depending on which side of knee the magnitude is on
-            if (mag <= m_Knee)
-                // use fixed gain if below knee
-                gain = m_FixedGain;
-            else
-                // use variable gain if above knee
-                gain = AGC_OUTSCALE * powf(10.0f, mag * (m_GainSlope - 1.0f));
-
-            pOutData[i] = delayedin * gain;
+            // if magnitude is rising (use m_DecayRiseAlpha time constant)
+            m_DecayAve = (1.0f - m_DecayRiseAlpha) * m_DecayAve +
+                          m_DecayRiseAlpha * m_Peak;
+            // reset hang timer
+            m_HangTimer = 0;
+        }
+        else
+        {	// here if decreasing signal
+            if (m_HangTimer < m_HangTime)
+                m_HangTimer++;	// just inc and hold current m_DecayAve
+            else	// else decay with m_DecayFallAlpha which is RELEASE_TIMECONST
+                m_DecayAve = (1.0f - m_DecayFallAlpha) * m_DecayAve +
+                             m_DecayFallAlpha * m_Peak;
         }
     }
     else
     {
-        // manual gain just multiply by m_ManualGain
-        for (int i = 0; i < Length; i++)
+        // using exponential decay mode
+        if (m_Peak > m_DecayAve)
+            // if magnitude is rising (use m_DecayRiseAlpha time constant)
+            m_DecayAve = (1.0f - m_DecayRiseAlpha) * m_DecayAve +
+                         m_DecayRiseAlpha * m_Peak;
+        else
+            // else magnitude is falling (use m_DecayFallAlpha time constant)
+            m_DecayAve = (1.0f - m_DecayFallAlpha) * m_DecayAve +
+                         m_DecayFallAlpha * m_Peak;
+    }
+
+    // use greater magnitude of attack or Decay Averager
+    return (m_AttackAve > m_DecayAve) ? m_AttackAve : m_DecayAve;
+}
+
+//////////////////////////////////////////////////////////////////////
+// One sample at a time, with the exact log10f() and powf()
+//////////////////////////////////////////////////////////////////////
+void CAgc::ProcessSamples(int Length, const TYPECPX * pInData, TYPECPX * pOutData)
+{
+    float       gain;
+    float       mag;
+    TYPECPX     delayedin;
+
+    for (int i = 0; i < Length; i++)
+    {
+        // get latest input sample
+        TYPECPX     in = pInData[i];
+
+        // Get delayed sample of input signal
+        delayedin = m_SigDelayBuf[m_SigDelayPtr];
+
+        // put new input sample into signal delay buffer
+        m_SigDelayBuf[m_SigDelayPtr++] = in;
+
+        // deal with delay buffer wrap around
+        if (m_SigDelayPtr >= m_DelaySamples)
+            m_SigDelayPtr = 0;
+
+        mag = fabsf(in.real());
+        float mim = fabsf(in.imag());
+        if (mim > mag)
+            mag = mim;
+        mag = log10f(mag + MIN_CONSTANT) - LOG_MAX_AMPL;
+
+        mag = Average(WindowPeak(mag));
+
+        // calc gain depending on which side of knee the magnitude is on
+        if (mag <= m_Knee)
+            // use fixed gain if below knee
+            gain = m_FixedGain;
+        else
+            // use variable gain if above knee
+            gain = AGC_OUTSCALE * powf(10.0f, mag * (m_GainSlope - 1.0f));
+
+        pOutData[i] = delayedin * gain;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Larger magnitude of I and Q of each sample of a block, as floats
+//////////////////////////////////////////////////////////////////////
+DSP_MULTIVERSION
+static void block_magnitude(float *mag, const float *in, int n)
+{
+    for (int i = 0; i < n; i++)
+        mag[i] = std::max(fabsf(in[2 * i]), fabsf(in[2 * i + 1])) + MIN_CONSTANT;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Blocks of AGC_BLOCK_SIZE samples. The magnitudes, the log, the gain
+// and the output are computed with VOLK for the whole block; only the
+// sliding window and the averagers are updated one sample at a time.
+// log and exp are the VOLK approximations, the gain is within 0.01 dB
+// of ProcessSamples().
+//////////////////////////////////////////////////////////////////////
+void CAgc::ProcessBlock(int Length, const TYPECPX * pInData, TYPECPX * pOutData)
+{
+    // below the knee the gain is fixed, which is the variable gain at the knee
+    const float gain_scale = (m_GainSlope - 1.0f) * LN_10;
+    const float gain_offset = logf(AGC_OUTSCALE);
+
+    for (int done = 0; done < Length; done += AGC_BLOCK_SIZE)
+    {
+        const int n = std::min(Length - done, AGC_BLOCK_SIZE);
+        const float *in = (const float *)(pInData + done);
+
+        block_magnitude(m_BlockMag, in, n);
+        volk_32f_log2_32f(m_BlockMag, m_BlockMag, n);
+
+        for (int i = 0; i < n; i++)
         {
-            pOutData[i] = m_ManualAgcGain * pInData[i];
+            float mag = Average(WindowPeak(m_BlockMag[i] * LOG10_2 - LOG_MAX_AMPL));
+            m_BlockGain[i] = std::max(mag, m_Knee) * gain_scale + gain_offset;
         }
+        volk_32f_exp_32f(m_BlockGain, m_BlockGain, n);
+
+        DelayBlock(n, pInData + done, pOutData + done);
+        volk_32fc_32f_multiply_32fc(pOutData + done, pOutData + done, m_BlockGain, n);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Signal delay line of ProcessSamples() for a block, copied in
+// contiguous runs of the delay buffer
+//////////////////////////////////////////////////////////////////////
+void CAgc::DelayBlock(int Length, const TYPECPX * pInData, TYPECPX * pOutData)
+{
+    const int delay = std::max(m_DelaySamples, 1);
+
+    for (int pos = 0; pos < Length; )
+    {
+        const int n = std::min(Length - pos, delay - m_SigDelayPtr);
+
+        std::copy(m_SigDelayBuf + m_SigDelayPtr, m_SigDelayBuf + m_SigDelayPtr + n, pOutData + pos);
+        std::copy(pInData + pos, pInData + pos + n, m_SigDelayBuf + m_SigDelayPtr);
+
+        m_SigDelayPtr += n;
+        if (m_SigDelayPtr >= delay)
+            m_SigDelayPtr = 0;
+        pos += n;
     }
 }
@@ -11,11 +11,15 @@
 #ifndef AGC_IMPL_H
 #define AGC_IMPL_H
 
+#include <atomic>
 #include <complex>
-#include <deque>
 
+// must be a power of two, it also sizes the ring of the sliding window max
 #define MAX_DELAY_BUF 2048
 
+// samples per block in the block processing mode
+#define AGC_BLOCK_SIZE 512
+
 /*
 typedef struct _dCplx
 {
@@ -37,7 +41,17 @@ public:
     void SetParameters(bool AgcOn, bool UseHang, int Threshold, int ManualGain, int Slope, int Decay, float SampleRate);
     void ProcessData(int Length, const TYPECPX * pInData, TYPECPX * pOutData);
 
+    // block processing with VOLK for all instances, on by default
+    static void SetBlockMode(bool enabled) { s_BlockMode.store(enabled); }
+    static bool BlockMode() { return s_BlockMode.load(); }
+
 private:
+    void  ProcessSamples(int Length, const TYPECPX * pInData, TYPECPX * pOutData);
+    void  ProcessBlock(int Length, const TYPECPX * pInData, TYPECPX * pOutData);
+    float WindowPeak(float mag);
+    float Average(float peak);
+    void  DelayBlock(int Length, const TYPECPX * pInData, TYPECPX * pOutData);
+
     bool        m_AgcOn;
     bool        m_UseHang;
     int         m_Threshold;
@@ -73,7 +87,16 @@ private:
     float*      m_SigDelayBuf_r;
 
     float       m_MagBuf[MAX_DELAY_BUF];
-    std::deque<int> m_MagDeque;
+
+    // positions in m_MagBuf of decreasing magnitudes, a ring of MAX_DELAY_BUF
+    int         m_MaxQueue[MAX_DELAY_BUF];
+    int         m_MaxHead;
+    int         m_MaxCount;
+
+    float       m_BlockMag[AGC_BLOCK_SIZE];
+    float       m_BlockGain[AGC_BLOCK_SIZE];
+
+    static std::atomic<bool> s_BlockMode;
 };
 
 #endif //  AGC_IMPL_H
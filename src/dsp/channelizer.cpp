@@ -0,0 +1,117 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <cmath>
+#include <gnuradio/filter/firdes.h>
+#include <gnuradio/io_signature.h>
+
+#include "channelizer.h"
+
+/* Output rate of a channel relative to the channel spacing */
+#define CHANNEL_OVERSAMPLE 2
+
+/*
+ * Prototype filter edges relative to the channel spacing: flat to 0.7 and
+ * down at 0.9, so the spectrum that folds back at the output rate stays
+ * outside of the passband.
+ */
+#define CHANNEL_CUTOFF     0.8
+#define CHANNEL_TRANSITION 0.2
+
+channelizer_cc_sptr make_channelizer_cc(unsigned int channels, double samp_rate)
+{
+    return gnuradio::get_initial_sptr(new channelizer_cc(channels, samp_rate));
+}
+
+/**
+ * @param channels Number of channels, even.
+ * @param samp_rate Input sample rate.
+ */
+channelizer_cc::channelizer_cc(unsigned int channels, double samp_rate)
+    : gr::hier_block2("channelizer_cc",
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          gr::io_signature::make(1, channels, sizeof(gr_complex))),
+      d_channels(channels),
+      d_samp_rate(samp_rate)
+{
+    // The filter is designed for a sample rate of 1, so it fits any rate
+    std::vector<float> taps = gr::filter::firdes::low_pass(
+            1.0, 1.0, CHANNEL_CUTOFF / d_channels, CHANNEL_TRANSITION / d_channels,
+#if GNURADIO_VERSION < 0x030900
+            gr::filter::firdes::WIN_BLACKMAN_HARRIS
+#else
+            gr::fft::window::WIN_BLACKMAN_HARRIS
+#endif
+    );
+
+    split = gr::blocks::stream_to_streams::make(sizeof(gr_complex), d_channels);
+    pfb = gr::filter::pfb_channelizer_ccf::make(d_channels, taps, CHANNEL_OVERSAMPLE);
+
+    connect(self(), 0, split, 0);
+    for (unsigned int i = 0; i < d_channels; i++)
+        connect(split, i, pfb, i);
+    set_outputs({0});
+}
+
+channelizer_cc::~channelizer_cc()
+{
+
+}
+
+void channelizer_cc::set_samp_rate(double samp_rate)
+{
+    d_samp_rate = samp_rate;
+}
+
+void channelizer_cc::set_outputs(const std::vector<int> &channels)
+{
+    if (channels.empty() || channels == d_outputs)
+        return;
+
+    lock();
+    for (size_t i = 0; i < d_outputs.size(); i++)
+        disconnect(pfb, i, self(), i);
+    d_outputs = channels;
+    pfb->set_channel_map(d_outputs);
+    for (size_t i = 0; i < d_outputs.size(); i++)
+        connect(pfb, i, self(), i);
+    unlock();
+}
+
+double channelizer_cc::channel_rate(void) const
+{
+    return CHANNEL_OVERSAMPLE * d_samp_rate / d_channels;
+}
+
+/** Center of a channel, relative to the center of the input. */
+double channelizer_cc::channel_freq(int channel) const
+{
+    double spacing = d_samp_rate / d_channels;
+    if (channel >= (int)d_channels / 2)
+        channel -= d_channels;
+    return channel * spacing;
+}
+
+/** Channel whose center is closest to freq, relative to the center of the input. */
+int channelizer_cc::nearest_channel(double freq) const
+{
+    int channel = (int)std::lround(freq * d_channels / d_samp_rate);
+    return ((channel % (int)d_channels) + d_channels) % d_channels;
+}
@@ -0,0 +1,72 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#pragma once
+
+#include <vector>
+#include <gnuradio/blocks/stream_to_streams.h>
+#include <gnuradio/filter/pfb_channelizer_ccf.h>
+#include <gnuradio/hier_block2.h>
+
+class channelizer_cc;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<channelizer_cc> channelizer_cc_sptr;
+#else
+typedef std::shared_ptr<channelizer_cc> channelizer_cc_sptr;
+#endif
+channelizer_cc_sptr make_channelizer_cc(unsigned int channels, double samp_rate);
+
+/**
+ * @brief Polyphase filter bank that splits the input into equally spaced channels.
+ *
+ * Channel k is centered on k * samp_rate / channels, the channels above the
+ * middle on negative frequencies as in an FFT. Each channel is output at
+ * twice the spacing, so a signal near the edge between two channels still
+ * fits in the nearest one. The cost per input sample does not depend on the
+ * number of channels used; outputs exist only for the channels passed to
+ * set_outputs().
+ */
+class channelizer_cc : public gr::hier_block2
+{
+    friend channelizer_cc_sptr make_channelizer_cc(unsigned int channels, double samp_rate);
+
+public:
+    channelizer_cc(unsigned int channels, double samp_rate);
+    ~channelizer_cc();
+
+    void set_samp_rate(double samp_rate);
+
+    /** Channels on outputs 0, 1, ..., at least one. */
+    void set_outputs(const std::vector<int> &channels);
+
+    unsigned int channels(void) const { return d_channels; }
+    double channel_rate(void) const;
+    double channel_freq(int channel) const;
+    int nearest_channel(double freq) const;
+
+private:
+    unsigned int d_channels;
+    double d_samp_rate;
+    std::vector<int> d_outputs;
+
+    gr::blocks::stream_to_streams::sptr split;
+    gr::filter::pfb_channelizer_ccf::sptr pfb;
+};
@@ -20,8 +20,11 @@
  * the Free Software Foundation, Inc., 51 Franklin Street,
  * Boston, MA 02110-1301, USA.
  */
+#include <algorithm>
+#include <cmath>
 #include <gnuradio/io_signature.h>
 #include <gnuradio/gr_complex.h>
+#include <volk/volk.h>
 #include <iostream>
 #include <QDebug>
 #include "dsp/correct_iq_cc.h"
@@ -95,9 +98,15 @@ iq_swap_cc_sptr make_iq_swap_cc(bool enabled)
 iq_swap_cc::iq_swap_cc(bool enabled)
     : gr::sync_block ("iq_swap_cc",
           gr::io_signature::make(1, 1, sizeof(gr_complex)),
-          gr::io_signature::make(1, 1, sizeof(gr_complex)))
+          gr::io_signature::make(1, 1, sizeof(gr_complex))),
+      d_dc_enabled(false),
+      d_sr(96000.0),
+      d_tau(1.0),
+      d_dc(0.0, 0.0),
+      d_ones(IQ_DC_BLOCK, 1.0f)
 {
     d_enabled = enabled;
+    update_dc_block();
 }
 
 iq_swap_cc::~iq_swap_cc()
@@ -116,6 +125,49 @@ void iq_swap_cc::set_enabled(bool enabled)
     d_enabled = enabled;
 }
 
+/*! \brief Enable or disable DC removal. */
+void iq_swap_cc::set_dc_cancel(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    qDebug() << "IQ DCR:" << enabled;
+
+    d_dc_enabled = enabled;
+    d_dc = 0.0;
+}
+
+/*! \brief Set new sample rate. */
+void iq_swap_cc::set_sample_rate(double sample_rate)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    d_sr = sample_rate;
+    update_dc_block();
+
+    qDebug() << "IQ DCR samp_rate:" << sample_rate;
+    qDebug() << "IQ DCR alpha:" << d_alpha;
+}
+
+/*! \brief Set new time constant. */
+void iq_swap_cc::set_tau(double tau)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    d_tau = tau;
+    update_dc_block();
+
+    qDebug() << "IQ DCR alpha:" << d_alpha;
+}
+
+/* d_mutex must be held, unless in the constructor */
+void iq_swap_cc::update_dc_block()
+{
+    d_alpha = 1.0 / (1.0 + d_tau * d_sr);
+    d_dc_block = (unsigned int)std::min(1.e-3 / d_alpha, (double)IQ_DC_BLOCK);
+    d_dc_block = std::max(d_dc_block, 1u);
+    d_dc_decay = std::pow(1.0 - d_alpha, (double)d_dc_block);
+}
+
 int iq_swap_cc::work(int noutput_items,
                      gr_vector_const_void_star& input_items,
                      gr_vector_void_star& output_items)
@@ -123,7 +175,46 @@ int iq_swap_cc::work(int noutput_items,
     const float *in = (const float *)input_items[0];
     float *out = (float *)output_items[0];
 
-    if (d_enabled)
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    if (d_dc_enabled)
+    {
+        for (int i = 0; i < noutput_items; i += d_dc_block)
+        {
+            unsigned int n = std::min((unsigned int)(noutput_items - i), d_dc_block);
+            const float *x = in + 2 * i;
+            float *y = out + 2 * i;
+            float dc_re = (float)d_dc.real();
+            float dc_im = (float)d_dc.imag();
+
+            if (d_enabled)
+            {
+                for (unsigned int k = 0; k < n; k++)
+                {
+                    y[2 * k] = x[2 * k + 1] - dc_re;
+                    y[2 * k + 1] = x[2 * k] - dc_im;
+                }
+            }
+            else
+            {
+                for (unsigned int k = 0; k < n; k++)
+                {
+                    y[2 * k] = x[2 * k] - dc_re;
+                    y[2 * k + 1] = x[2 * k + 1] - dc_im;
+                }
+            }
+
+            // Sum of the block from the residuals, which keeps float precision
+            lv_32fc_t sum;
+            volk_32fc_32f_dot_prod_32fc(&sum, (const lv_32fc_t *)y, d_ones.data(), n);
+            std::complex<double> block_sum((double)sum.real() + n * (double)dc_re,
+                                           (double)sum.imag() + n * (double)dc_im);
+            double decay = (n == d_dc_block) ? d_dc_decay
+                                             : std::pow(1.0 - d_alpha, (double)n);
+            d_dc = decay * d_dc + (1.0 - decay) / n * block_sum;
+        }
+    }
+    else if (d_enabled)
     {
         for (int i = 0; i < noutput_items; ++i)
         {
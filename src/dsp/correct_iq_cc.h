@@ -23,6 +23,9 @@
 #ifndef CORRECT_IQ_CC_H
 #define CORRECT_IQ_CC_H
 
+#include <complex>
+#include <mutex>
+#include <vector>
 #include <gnuradio/gr_complex.h>
 #include <gnuradio/blocks/complex_to_float.h>
 #include <gnuradio/blocks/float_to_complex.h>
@@ -79,8 +82,18 @@ private:
 /*! \brief Return a shared_ptr to a new instance of iq_swap_cc. */
 iq_swap_cc_sptr make_iq_swap_cc(bool enabled);
 
-/*! \brief Block to swap I and Q channels.
+/* Largest block of samples that subtract the same DC estimate */
+#define IQ_DC_BLOCK 256
+
+/*! \brief Block to swap I and Q channels and remove DC.
  *  \ingroup DSP
+ *
+ * Both run in one pass over the input. The DC removal is the same single
+ * pole IIR average as in dc_corr_cc, but updated once per block of up to
+ * IQ_DC_BLOCK samples: the block subtracts the current estimate in a loop
+ * the compiler vectorizes, and the estimate is then decayed and moved
+ * towards the block sum from VOLK. The block is short enough that the
+ * estimate would move by less than 0.1% of the way within it.
  */
 class iq_swap_cc : public gr::sync_block
 {
@@ -92,12 +105,26 @@ protected:
 public:
     ~iq_swap_cc();
     void set_enabled(bool enabled);
+    void set_dc_cancel(bool enabled);
+    void set_sample_rate(double sample_rate);
+    void set_tau(double tau);
     int work(int noutput_items,
              gr_vector_const_void_star& input_items,
              gr_vector_void_star& output_items);
 
 private:
+    void update_dc_block();
+
     bool d_enabled;
+    bool d_dc_enabled;           /*!< Whether DC removal is on. */
+    double d_sr;                 /*!< Sample rate. */
+    double d_tau;                /*!< Time constant of the DC average. */
+    double d_alpha;              /*!< 1/(1+tau/T). */
+    unsigned int d_dc_block;     /*!< Samples per DC estimate update. */
+    double d_dc_decay;           /*!< (1-alpha)^d_dc_block */
+    std::complex<double> d_dc;   /*!< DC estimate. */
+    std::vector<float> d_ones;   /*!< Weights of the block sum. */
+    std::mutex d_mutex;          /*!< Protects the DC settings. */
 };
 
 #endif /* CORRECT_IQ_CC_H */
@@ -0,0 +1,53 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+/*
+ * Hot loops of our own blocks compiled for several x86 levels.
+ *
+ * The VOLK kernels pick their implementation at runtime, the loops of our
+ * own blocks are compiled for the baseline of the build, which is SSE2 for
+ * distribution binaries. With -DENABLE_CPU_DISPATCH=ON and a compiler and
+ * target with target_clones (GCC or Clang on x86 ELF), a function marked
+ * DSP_MULTIVERSION is compiled for AVX-512, AVX2, SSE4.2 and the baseline,
+ * and the loader picks the clone for the CPU once, by ifunc, so calls cost
+ * no more than before. Elsewhere the macro is empty; NEON is the baseline
+ * of 64-bit ARM anyway.
+ *
+ * FMA is not in the clones, and the marked loops have no reductions, so
+ * every clone gives the same output on any CPU.
+ *
+ *   DSP_MULTIVERSION
+ *   static void kernel(float *out, const float *in, int n);
+ *
+ * Only mark file-local functions with plain loops over arrays; the clones
+ * cannot be inlined.
+ */
+#ifdef WITH_CPU_DISPATCH
+#define DSP_MULTIVERSION __attribute__((target_clones("avx512f", "avx2", "sse4.2", "default")))
+#else
+#define DSP_MULTIVERSION
+#endif
+
+#endif // CPU_DISPATCH_H
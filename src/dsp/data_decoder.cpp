@@ -0,0 +1,125 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <gnuradio/io_signature.h>
+#include "dsp/data_decoder.h"
+
+static_assert((DECODER_QUEUE_SIZE & (DECODER_QUEUE_SIZE - 1)) == 0,
+              "DECODER_QUEUE_SIZE must be a power of two");
+
+
+decoder_sink_f_sptr make_decoder_sink_f(data_decoder_sptr decoder)
+{
+    return gnuradio::get_initial_sptr(new decoder_sink_f(decoder));
+}
+
+decoder_sink_f::decoder_sink_f(data_decoder_sptr decoder)
+    : gr::sync_block ("decoder_sink_f",
+          gr::io_signature::make(1, 1, sizeof(float)),
+          gr::io_signature::make(0, 0, 0)),
+      d_decoder(decoder),
+      d_port(pmt::mp("out"))
+{
+    message_port_register_out(d_port);
+    d_decoder->set_output(std::bind(&decoder_sink_f::publish, this, std::placeholders::_1));
+}
+
+decoder_sink_f::~decoder_sink_f()
+{
+    d_decoder->set_output(nullptr);
+}
+
+int decoder_sink_f::work(int noutput_items,
+                         gr_vector_const_void_star &input_items,
+                         gr_vector_void_star &output_items)
+{
+    (void) output_items;
+
+    d_decoder->process((const float *) input_items[0], noutput_items);
+
+    return noutput_items;
+}
+
+/* Blobs rather than symbols, which would stay in the symbol table forever */
+void decoder_sink_f::publish(const std::string &msg)
+{
+    message_port_pub(d_port, pmt::make_blob(msg.data(), msg.size()));
+}
+
+
+decoder_store_sptr make_decoder_store()
+{
+    return gnuradio::get_initial_sptr(new decoder_store());
+}
+
+decoder_store::decoder_store()
+    : gr::block ("decoder_store",
+          gr::io_signature::make(0, 0, 0),
+          gr::io_signature::make(0, 0, 0)),
+      d_head(0),
+      d_tail(0),
+      d_dropped(0)
+{
+    message_port_register_in(pmt::mp("store"));
+    set_msg_handler(pmt::mp("store"), std::bind(&decoder_store::store, this, std::placeholders::_1));
+}
+
+decoder_store::~decoder_store()
+{
+}
+
+/*! \brief Take the oldest message.
+ *  \return false if there is none.
+ *
+ * Only one thread may read the store.
+ */
+bool decoder_store::get_message(std::string &msg)
+{
+    unsigned int tail = d_tail.load(std::memory_order_relaxed);
+
+    if (tail == d_head.load(std::memory_order_acquire))
+        return false;
+
+    msg.swap(d_ring[tail & (DECODER_QUEUE_SIZE - 1)]);
+    d_ring[tail & (DECODER_QUEUE_SIZE - 1)].clear();
+    d_tail.store(tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+void decoder_store::store(pmt::pmt_t msg)
+{
+    if (!pmt::is_blob(msg))
+        return;
+
+    unsigned int head = d_head.load(std::memory_order_relaxed);
+
+    if (head - d_tail.load(std::memory_order_acquire) == DECODER_QUEUE_SIZE)
+    {
+        d_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    d_ring[head & (DECODER_QUEUE_SIZE - 1)].assign((const char *) pmt::blob_data(msg),
+                                                   pmt::blob_length(msg));
+    d_head.store(head + 1, std::memory_order_release);
+}
@@ -0,0 +1,151 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef DATA_DECODER_H
+#define DATA_DECODER_H
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <gnuradio/block.h>
+#include <gnuradio/sync_block.h>
+
+/* Number of decoded messages a decoder_store holds, a power of two */
+#define DECODER_QUEUE_SIZE 256
+
+class data_decoder;
+class decoder_sink_f;
+class decoder_store;
+
+typedef std::shared_ptr<data_decoder> data_decoder_sptr;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<decoder_sink_f> decoder_sink_f_sptr;
+typedef boost::shared_ptr<decoder_store> decoder_store_sptr;
+#else
+typedef std::shared_ptr<decoder_sink_f> decoder_sink_f_sptr;
+typedef std::shared_ptr<decoder_store> decoder_store_sptr;
+#endif
+
+
+/*! \brief Interface of a data decoder working on demodulated audio.
+ *  \ingroup DSP
+ *
+ * A decoder gets the audio at the rate it asks for in process(), which is
+ * called from the scheduler thread of its decoder_sink_f, and reports each
+ * decoded message with emit_message().
+ */
+class data_decoder
+{
+public:
+    typedef std::function<void(const std::string &)> output_fn;
+
+    virtual ~data_decoder() {}
+
+    /*! \brief Short name of the decoder, e.g. "AFSK1200". */
+    virtual const char *name() const = 0;
+
+    /*! \brief Sample rate the decoder wants its input at. */
+    virtual unsigned int sample_rate() const = 0;
+
+    /*! \brief Decode the next samples. */
+    virtual void process(const float *samples, int length) = 0;
+
+    void set_output(output_fn output) { d_output = output; }
+
+protected:
+    void emit_message(const std::string &msg)
+    {
+        if (d_output)
+            d_output(msg);
+    }
+
+private:
+    output_fn d_output;
+};
+
+
+decoder_sink_f_sptr make_decoder_sink_f(data_decoder_sptr decoder);
+
+/*! \brief Sink running a data_decoder in the flow graph.
+ *  \ingroup DSP
+ *
+ * Each decoded message is published as a blob on the "out" message port.
+ */
+class decoder_sink_f : public gr::sync_block
+{
+    friend decoder_sink_f_sptr make_decoder_sink_f(data_decoder_sptr decoder);
+
+protected:
+    decoder_sink_f(data_decoder_sptr decoder);
+
+public:
+    ~decoder_sink_f();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    data_decoder_sptr decoder() const { return d_decoder; }
+
+private:
+    void publish(const std::string &msg);
+
+    data_decoder_sptr d_decoder;
+    pmt::pmt_t        d_port;
+};
+
+
+decoder_store_sptr make_decoder_store();
+
+/*! \brief Keeps the messages of a decoder_sink_f for the GUI.
+ *  \ingroup DSP
+ *
+ * Messages arrive on the "store" message port and are kept in a single
+ * producer, single consumer ring, so the message thread never waits for
+ * the reader. When the ring is full new messages are dropped and counted.
+ */
+class decoder_store : public gr::block
+{
+    friend decoder_store_sptr make_decoder_store();
+
+protected:
+    decoder_store();
+
+public:
+    ~decoder_store();
+
+    bool get_message(std::string &msg);
+    uint64_t dropped() const { return d_dropped.load(std::memory_order_relaxed); }
+
+private:
+    void store(pmt::pmt_t msg);
+
+    std::array<std::string, DECODER_QUEUE_SIZE> d_ring;
+    std::atomic<unsigned int> d_head;   /*!< Next slot written by store(). */
+    std::atomic<unsigned int> d_tail;   /*!< Next slot read by get_message(). */
+    std::atomic<uint64_t>     d_dropped;
+};
+
+#endif /* DATA_DECODER_H */
@@ -25,6 +25,7 @@
 #include <gnuradio/io_signature.h>
 
 #include "downconverter.h"
+#include "filter_taps_cache.h"
 
 #define LPF_CUTOFF 120e3
 
@@ -54,12 +55,17 @@ downconverter_cc::~downconverter_cc()
 void downconverter_cc::set_decim_and_samp_rate(unsigned int decim, double samp_rate)
 {
     d_samp_rate = samp_rate;
-    d_decim = decim;
 
-    lock();
-    disconnect_all();
-    connect_all();
-    unlock();
+    // The filter and rotator take a new rate without being replaced, which
+    // would lock the flow graph
+    if (decim != d_decim)
+    {
+        d_decim = decim;
+        lock();
+        disconnect_all();
+        connect_all();
+        unlock();
+    }
 
     update_proto_taps();
     update_phase_inc();
@@ -92,7 +98,7 @@ void downconverter_cc::update_proto_taps()
     if (d_decim > 1)
     {
         double out_rate = d_samp_rate / d_decim;
-        filt->set_taps(gr::filter::firdes::low_pass(1.0, d_samp_rate, LPF_CUTOFF, out_rate - 2*LPF_CUTOFF,
+        filt->set_taps(filter_taps_cache::low_pass(1.0, d_samp_rate, LPF_CUTOFF, out_rate - 2*LPF_CUTOFF,
 #if GNURADIO_VERSION < 0x030900
             gr::filter::firdes::WIN_BLACKMAN_HARRIS
 #else
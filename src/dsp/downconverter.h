@@ -35,6 +35,13 @@ typedef std::shared_ptr<downconverter_cc> downconverter_cc_sptr;
 #endif
 downconverter_cc_sptr make_downconverter_cc(unsigned int decim, double center_freq, double samp_rate);
 
+/*! \brief Shift a channel to zero frequency and decimate it.
+ *
+ * With decimation the shift and the low pass are one block: the low pass
+ * taps are rotated to the channel frequency, the filter is only evaluated
+ * at the output instants and the remaining phase is corrected at the
+ * output rate. Without decimation it is only a rotator.
+ */
 class downconverter_cc : public gr::hier_block2
 {
     friend downconverter_cc_sptr make_downconverter_cc(unsigned int decim, double center_freq, double samp_rate);
@@ -0,0 +1,230 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <fftw3.h>
+#include "dsp/fft_plan_cache.h"
+
+namespace
+{
+    struct cached_plan
+    {
+        unsigned int         size;
+        int                  nthreads;
+        fft_plan_cache::fft_c *fft;   /* one of the two is set */
+        fft_plan_cache::fft_r *rfft;
+    };
+
+    std::mutex              pool_mutex;
+    std::list<cached_plan>  pool;        /* idle plans, most recent first */
+    size_t                  pool_bytes = 0;
+    std::string             wisdom_file;
+
+    std::mutex              planner_thread_mutex;
+    std::thread             planner_thread;
+    std::atomic<bool>       planner_abort(false);
+
+    size_t plan_bytes(unsigned int size)
+    {
+        return 2 * sizeof(gr_complex) * (size_t)size;
+    }
+
+    size_t real_plan_bytes(unsigned int size)
+    {
+        return sizeof(float) * (size_t)size + sizeof(gr_complex) * (size_t)(size / 2 + 1);
+    }
+
+    size_t cached_bytes(const cached_plan &p)
+    {
+        return p.fft ? plan_bytes(p.size) : real_plan_bytes(p.size);
+    }
+
+    fft_plan_cache::fft_c *create_fft(unsigned int size, int nthreads)
+    {
+#if GNURADIO_VERSION < 0x030900
+        return new gr::fft::fft_complex(size, true, nthreads);
+#else
+        return new gr::fft::fft_complex_fwd(size, nthreads);
+#endif
+    }
+
+    /* pool_mutex must be held */
+    void trim_pool(size_t max_bytes)
+    {
+        while (pool_bytes > max_bytes && !pool.empty())
+        {
+            pool_bytes -= cached_bytes(pool.back());
+            delete pool.back().fft;
+            delete pool.back().rfft;
+            pool.pop_back();
+        }
+    }
+}
+
+fft_plan_cache::fft_c *fft_plan_cache::acquire(unsigned int size, int nthreads)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+
+        for (auto it = pool.begin(); it != pool.end(); ++it)
+        {
+            if (it->fft && it->size == size && it->nthreads == nthreads)
+            {
+                fft_c *fft = it->fft;
+                pool_bytes -= plan_bytes(size);
+                pool.erase(it);
+                return fft;
+            }
+        }
+    }
+
+    /* GNU Radio serializes planning internally */
+    return create_fft(size, nthreads);
+}
+
+void fft_plan_cache::release(fft_c *fft, unsigned int size, int nthreads)
+{
+    if (!fft)
+        return;
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+
+    pool.push_front({size, nthreads, fft, nullptr});
+    pool_bytes += plan_bytes(size);
+    trim_pool(FFT_PLAN_CACHE_MAX_BYTES);
+}
+
+fft_plan_cache::fft_r *fft_plan_cache::acquire_real(unsigned int size, int nthreads)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+
+        for (auto it = pool.begin(); it != pool.end(); ++it)
+        {
+            if (it->rfft && it->size == size && it->nthreads == nthreads)
+            {
+                fft_r *fft = it->rfft;
+                pool_bytes -= real_plan_bytes(size);
+                pool.erase(it);
+                return fft;
+            }
+        }
+    }
+
+    return new gr::fft::fft_real_fwd(size, nthreads);
+}
+
+void fft_plan_cache::release_real(fft_r *fft, unsigned int size, int nthreads)
+{
+    if (!fft)
+        return;
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+
+    pool.push_front({size, nthreads, nullptr, fft});
+    pool_bytes += real_plan_bytes(size);
+    trim_pool(FFT_PLAN_CACHE_MAX_BYTES);
+}
+
+bool fft_plan_cache::load_wisdom(const std::string &filename)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        wisdom_file = filename;
+    }
+
+    gr::fft::planner::scoped_lock lock(gr::fft::planner::mutex());
+    return fftwf_import_wisdom_from_filename(filename.c_str()) != 0;
+}
+
+bool fft_plan_cache::save_wisdom()
+{
+    std::string filename;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        filename = wisdom_file;
+    }
+
+    if (filename.empty())
+        return false;
+
+    gr::fft::planner::scoped_lock lock(gr::fft::planner::mutex());
+    if (fftwf_export_wisdom_to_filename(filename.c_str()) == 0)
+    {
+        std::cerr << "Failed to save FFTW wisdom to " << filename << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void fft_plan_cache::preplan(const std::vector<unsigned int> &sizes, int nthreads)
+{
+    std::lock_guard<std::mutex> lock(planner_thread_mutex);
+
+    if (planner_thread.joinable())
+        return;
+
+    /* plan the largest sizes last so they are the last ones evicted */
+    std::vector<unsigned int> sorted(sizes);
+    std::sort(sorted.begin(), sorted.end());
+
+    planner_abort = false;
+    planner_thread = std::thread([sorted, nthreads]() {
+        for (unsigned int size : sorted)
+        {
+            if (planner_abort)
+                break;
+
+            bool cached = false;
+            {
+                std::lock_guard<std::mutex> lock(pool_mutex);
+                for (const cached_plan &p : pool)
+                    cached |= (p.fft && p.size == size && p.nthreads == nthreads);
+            }
+
+            if (!cached)
+                release(create_fft(size, nthreads), size, nthreads);
+        }
+        save_wisdom();
+    });
+}
+
+void fft_plan_cache::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(planner_thread_mutex);
+        planner_abort = true;
+        if (planner_thread.joinable())
+            planner_thread.join();
+    }
+
+    save_wisdom();
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    trim_pool(0);
+}
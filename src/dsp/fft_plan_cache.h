@@ -0,0 +1,96 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef FFT_PLAN_CACHE_H
+#define FFT_PLAN_CACHE_H
+
+#include <string>
+#include <vector>
+#include <gnuradio/fft/fft.h>
+
+/* Upper limit for memory held by idle plans (input and output buffers) */
+#define FFT_PLAN_CACHE_MAX_BYTES (128 * 1024 * 1024)
+
+/*! \brief Process-wide pool of forward FFT objects.
+ *
+ * Creating an FFTW plan for a large size can take seconds. The pool keeps
+ * FFT objects that are no longer used so they can be handed out again
+ * without planning, and persists FFTW wisdom so that sizes which are not
+ * in the pool are planned quickly.
+ *
+ * An acquired FFT object is owned exclusively by the caller until it is
+ * given back with release(). Idle objects are evicted oldest first when
+ * they exceed FFT_PLAN_CACHE_MAX_BYTES. The real-input FFTs of the audio
+ * spectrum are pooled the same way, with acquire_real() and release_real().
+ */
+class fft_plan_cache
+{
+public:
+#if GNURADIO_VERSION < 0x030900
+    typedef gr::fft::fft_complex     fft_c;
+#else
+    typedef gr::fft::fft_complex_fwd fft_c;
+#endif
+    typedef gr::fft::fft_real_fwd    fft_r;
+
+    /*! \brief Get an FFT object, from the pool if possible.
+     *  \param size The FFT size.
+     *  \param nthreads The number of FFTW threads.
+     */
+    static fft_c *acquire(unsigned int size, int nthreads = 1);
+
+    /*! \brief Return an FFT object obtained with acquire() to the pool.
+     *  \param fft The FFT object, may be nullptr.
+     *  \param size The size it was acquired with.
+     *  \param nthreads The number of threads it was acquired with.
+     */
+    static void release(fft_c *fft, unsigned int size, int nthreads = 1);
+
+    /*! \brief Get a real-input FFT object, from the pool if possible.
+     *  \param size The FFT size; the output has size / 2 + 1 bins.
+     *  \param nthreads The number of FFTW threads.
+     */
+    static fft_r *acquire_real(unsigned int size, int nthreads = 1);
+
+    /*! \brief Return an FFT object obtained with acquire_real() to the pool. */
+    static void release_real(fft_r *fft, unsigned int size, int nthreads = 1);
+
+    /*! \brief Load FFTW wisdom from file and remember it for save_wisdom().
+     *  \returns true if the file was read.
+     */
+    static bool load_wisdom(const std::string &filename);
+
+    /*! \brief Write accumulated FFTW wisdom to the file given to load_wisdom(). */
+    static bool save_wisdom();
+
+    /*! \brief Plan the given sizes on a background thread.
+     *
+     * Planned objects are put in the pool and the wisdom is saved when
+     * done. Calling this while planning is in progress has no effect.
+     */
+    static void preplan(const std::vector<unsigned int> &sizes, int nthreads = 1);
+
+    /*! \brief Stop background planning, save wisdom and free the pool. */
+    static void shutdown();
+};
+
+#endif /* FFT_PLAN_CACHE_H */
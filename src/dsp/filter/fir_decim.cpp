@@ -91,21 +91,40 @@ static const decimation_stage decimation_stages[] =
     }
 };
 
-fir_decim_cc_sptr make_fir_decim_cc(unsigned int decim)
+/* Halfband taps per side of the center (K of halfband_decim_cc) by quality,
+ * for the stages before the last one and for the last one. The early stages
+ * only have to keep their aliases out of the final pass band, so the last
+ * stage sets the transition band. */
+static const unsigned int halfband_early_taps[] = { 0, 4, 2 };
+static const unsigned int halfband_last_taps[] = { 0, 16, 8 };
+
+fir_decim_cc_sptr make_fir_decim_cc(unsigned int decim, int quality, bool sc16)
 {
-    return gnuradio::get_initial_sptr(new fir_decim_cc(decim));
+    return gnuradio::get_initial_sptr(new fir_decim_cc(decim, quality, sc16));
 }
 
-fir_decim_cc::fir_decim_cc(unsigned int decim)
+fir_decim_cc::fir_decim_cc(unsigned int decim, int quality, bool sc16)
     : gr::hier_block2("fir_decim_cc",
-          gr::io_signature::make(1, 1, sizeof(gr_complex)),
-          gr::io_signature::make(1, 1, sizeof(gr_complex)))
+          gr::io_signature::make(1, 1, sc16 ? 2 * sizeof(int16_t) : sizeof(gr_complex)),
+          gr::io_signature::make(1, 1, sizeof(gr_complex))),
+      d_sc16(sc16)
 {
     std::vector<float>  taps;
     int this_stage = 0;
     int index = decimation_stage_count - 1;
+    gr::basic_block_sptr input = self();
+
+    std::cout << "Decimation: " << decim << (sc16 ? " (sc16)" : "") << std::endl;
+    if (sc16 ? connect_halfbands_sc(decim, quality) : connect_halfbands(decim, quality))
+        return;
+
+    if (sc16)
+    {
+        convert = make_sc16_to_cf32();
+        connect(self(), 0, convert, 0);
+        input = convert;
+    }
 
-    std::cout << "Decimation: " << decim << std::endl;
     while (decim > 1 && index >= 0)
     {
         const decimation_stage  *stage = &decimation_stages[index];
@@ -136,18 +155,18 @@ fir_decim_cc::fir_decim_cc(unsigned int decim)
 
     if (this_stage == 1)
     {
-        connect(self(), 0, fir1, 0);
+        connect(input, 0, fir1, 0);
         connect(fir1, 0, self(), 0);
     }
     else if (this_stage == 2)
     {
-        connect(self(), 0, fir1, 0);
+        connect(input, 0, fir1, 0);
         connect(fir1, 0, fir2, 0);
         connect(fir2, 0, self(), 0);
     }
     else
     {
-        connect(self(), 0, fir1, 0);
+        connect(input, 0, fir1, 0);
         connect(fir1, 0, fir2, 0);
         connect(fir2, 0, fir3, 0);
         connect(fir3, 0, self(), 0);
@@ -158,3 +177,63 @@ fir_decim_cc::~fir_decim_cc()
 {
 
 }
+
+/**
+ * Decimate with a chain of halfband stages for the balanced and fast
+ * qualities. Returns false for the sharp quality and for a decimation that
+ * is not a power of two, which use the FIR stages.
+ */
+bool fir_decim_cc::has_halfbands(unsigned int decim, int quality)
+{
+    return (quality == FIR_DECIM_BALANCED || quality == FIR_DECIM_FAST) &&
+           decim >= 2 && (decim & (decim - 1)) == 0;
+}
+
+bool fir_decim_cc::connect_halfbands(unsigned int decim, int quality)
+{
+    if (!has_halfbands(decim, quality))
+        return false;
+
+    for (unsigned int d = decim; d > 1; d /= 2)
+    {
+        unsigned int half_taps = (d == 2) ? halfband_last_taps[quality]
+                                          : halfband_early_taps[quality];
+        halfbands.push_back(make_halfband_decim_cc(half_taps));
+        std::cout << "  halfband stage: " << halfbands.size() << "  taps: "
+                  << 4 * half_taps - 1 << std::endl;
+    }
+
+    connect(self(), 0, halfbands.front(), 0);
+    for (size_t i = 1; i < halfbands.size(); i++)
+        connect(halfbands[i - 1], 0, halfbands[i], 0);
+    connect(halfbands.back(), 0, self(), 0);
+
+    return true;
+}
+
+/**
+ * The halfband stages of connect_halfbands() on int16 samples, for an sc16
+ * input. The last stage puts out gr_complex, so the samples are converted
+ * at the output rate.
+ */
+bool fir_decim_cc::connect_halfbands_sc(unsigned int decim, int quality)
+{
+    if (!has_halfbands(decim, quality))
+        return false;
+
+    for (unsigned int d = decim; d > 1; d /= 2)
+    {
+        unsigned int half_taps = (d == 2) ? halfband_last_taps[quality]
+                                          : halfband_early_taps[quality];
+        halfbands_sc.push_back(make_halfband_decim_sc(half_taps, d == 2));
+        std::cout << "  sc16 halfband stage: " << halfbands_sc.size() << "  taps: "
+                  << 4 * half_taps - 1 << std::endl;
+    }
+
+    connect(self(), 0, halfbands_sc.front(), 0);
+    for (size_t i = 1; i < halfbands_sc.size(); i++)
+        connect(halfbands_sc[i - 1], 0, halfbands_sc[i], 0);
+    connect(halfbands_sc.back(), 0, self(), 0);
+
+    return true;
+}
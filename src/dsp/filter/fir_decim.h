@@ -22,9 +22,20 @@
  */
 #pragma once
 
+#include <vector>
 #include <gnuradio/filter/fir_filter_blk.h>
 #include <gnuradio/hier_block2.h>
 
+#include "halfband_decim.h"
+#include "dsp/sc16_to_cf32.h"
+
+/*! \brief Filter quality of fir_decim_cc, trading stop band for CPU. */
+enum fir_decim_quality {
+    FIR_DECIM_SHARP = 0,    /*!< Long FIR stages from fir_decim_coef.h. */
+    FIR_DECIM_BALANCED = 1, /*!< Halfband stages of 15 taps, 63 for the last one. */
+    FIR_DECIM_FAST = 2      /*!< Halfband stages of 7 taps, 31 for the last one. */
+};
+
 class fir_decim_cc;
 
 #if GNURADIO_VERSION < 0x030900
@@ -32,21 +43,40 @@ typedef boost::shared_ptr<fir_decim_cc> fir_decim_cc_sptr;
 #else
 typedef std::shared_ptr<fir_decim_cc> fir_decim_cc_sptr;
 #endif
-fir_decim_cc_sptr make_fir_decim_cc(unsigned int decim);
+fir_decim_cc_sptr make_fir_decim_cc(unsigned int decim, int quality = FIR_DECIM_SHARP,
+                                    bool sc16 = false);
 
+/*
+ * The input decimator. With sc16 the input is complex int16 and the output
+ * is still gr_complex: the halfband stages of the balanced and fast
+ * qualities run on int16, the last one converting, and the FIR stages of
+ * the sharp quality get the samples converted first.
+ */
 class fir_decim_cc : public gr::hier_block2
 {
-    friend fir_decim_cc_sptr make_fir_decim_cc(unsigned int decim);
+    friend fir_decim_cc_sptr make_fir_decim_cc(unsigned int decim, int quality, bool sc16);
 
 //protected:
 public:
-    fir_decim_cc(unsigned int decim);
+    fir_decim_cc(unsigned int decim, int quality = FIR_DECIM_SHARP, bool sc16 = false);
 
 public:
     ~fir_decim_cc();
 
+    bool is_sc16(void) const { return d_sc16; }
+
+    /* Whether the decimation is done by halfband stages, which run on int16 for sc16 */
+    static bool has_halfbands(unsigned int decim, int quality);
+
 private:
+    bool                                    d_sc16;
     gr::filter::fir_filter_ccf::sptr        fir1;
     gr::filter::fir_filter_ccf::sptr        fir2;
     gr::filter::fir_filter_ccf::sptr        fir3;
+    std::vector<halfband_decim_cc_sptr>     halfbands;
+    std::vector<halfband_decim_sc_sptr>     halfbands_sc;
+    sc16_to_cf32_sptr                       convert;
+
+    bool connect_halfbands(unsigned int decim, int quality);
+    bool connect_halfbands_sc(unsigned int decim, int quality);
 };
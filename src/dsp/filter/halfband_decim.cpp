@@ -0,0 +1,249 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include <gnuradio/io_signature.h>
+
+#include "dsp/cpu_dispatch.h"
+#include "halfband_decim.h"
+
+/* Outputs computed per pass over the taps, small enough to stay in L1 */
+#define HALFBAND_BLOCK 1024
+
+/* Kaiser window beta, about 80 dB of stop band attenuation */
+#define HALFBAND_KAISER_BETA 7.0
+
+/* Modified Bessel function of the first kind, order 0 */
+static double bessel_i0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < 1e-12 * sum)
+            break;
+    }
+    return sum;
+}
+
+halfband_decim_cc_sptr make_halfband_decim_cc(unsigned int half_taps)
+{
+    return gnuradio::get_initial_sptr(new halfband_decim_cc(half_taps));
+}
+
+std::vector<float> halfband_taps(unsigned int half_taps)
+{
+    // Taps at odd distances 1, 3, ... from the center of a windowed sinc
+    // with its cut-off at a quarter of the input rate
+    const int center = 2 * half_taps - 1;
+    const double i0_beta = bessel_i0(HALFBAND_KAISER_BETA);
+    double sum = 0.0;
+
+    std::vector<float> taps(half_taps);
+    for (unsigned int k = 0; k < half_taps; k++)
+    {
+        const double d = 2.0 * k + 1.0;
+        const double r = d / (center + 1.0);
+        const double window = bessel_i0(HALFBAND_KAISER_BETA * std::sqrt(1.0 - r * r)) / i0_beta;
+        const double sinc = std::sin(M_PI * d / 2.0) / (M_PI * d / 2.0);
+        taps[k] = (float)(0.5 * sinc * window);
+        sum += 2.0 * taps[k];
+    }
+
+    // unity gain at DC together with the center tap of 0.5
+    for (auto &tap : taps)
+        tap = (float)(tap * 0.5 / sum);
+
+    return taps;
+}
+
+halfband_decim_cc::halfband_decim_cc(unsigned int half_taps)
+    : gr::sync_decimator("halfband_decim_cc",
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          2),
+      d_half_taps(std::max(half_taps, 1u)),
+      d_taps(halfband_taps(d_half_taps))
+{
+    set_history(4 * d_half_taps - 1);
+}
+
+halfband_decim_cc::~halfband_decim_cc()
+{
+}
+
+/* The filter of work() for len interleaved floats */
+DSP_MULTIVERSION
+static void halfband_filter(float *acc, const float *even, const float *odd,
+                            const float *taps, int K, int len)
+{
+    for (int i = 0; i < len; i++)
+        acc[i] = 0.5f * odd[i];
+
+    for (int k = 0; k < K; k++)
+    {
+        const float tap = taps[k];
+        const float *a = even + 2 * (K - 1 - k);
+        const float *b = even + 2 * (K + k);
+        for (int i = 0; i < len; i++)
+            acc[i] += tap * (a[i] + b[i]);
+    }
+}
+
+/**
+ * Output n is
+ *   0.5 * odd[n + K - 1] + sum_k taps[k] * (even[n + K - 1 - k] + even[n + K + k])
+ * for K = half_taps, with even[i] = in[2i] and odd[i] = in[2i + 1].
+ */
+int halfband_decim_cc::work(int noutput_items,
+                            gr_vector_const_void_star &input_items,
+                            gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *)input_items[0];
+    gr_complex *out = (gr_complex *)output_items[0];
+    const int K = (int)d_half_taps;
+
+    for (int done = 0; done < noutput_items; done += HALFBAND_BLOCK)
+    {
+        const int n = std::min(noutput_items - done, HALFBAND_BLOCK);
+        const int n_even = n + 2 * K - 1;
+        const gr_complex *blk = in + 2 * done;
+
+        if (d_even.size() < (size_t)n_even)
+        {
+            d_even.resize(n_even);
+            d_odd.resize(n_even);
+        }
+        for (int i = 0; i < n_even; i++)
+        {
+            d_even[i] = blk[2 * i];
+            d_odd[i] = blk[2 * i + 1];
+        }
+
+        // As interleaved floats, so that the loops are plain float loops
+        float *acc = (float *)(out + done);
+        const float *even = (const float *)d_even.data();
+        const float *odd = (const float *)(d_odd.data() + K - 1);
+        halfband_filter(acc, even, odd, d_taps.data(), K, 2 * n);
+    }
+
+    return noutput_items;
+}
+
+halfband_decim_sc_sptr make_halfband_decim_sc(unsigned int half_taps, bool float_out)
+{
+    return gnuradio::get_initial_sptr(new halfband_decim_sc(half_taps, float_out));
+}
+
+halfband_decim_sc::halfband_decim_sc(unsigned int half_taps, bool float_out)
+    : gr::sync_decimator("halfband_decim_sc",
+          gr::io_signature::make(1, 1, 2 * sizeof(int16_t)),
+          gr::io_signature::make(1, 1, float_out ? sizeof(gr_complex) : 2 * sizeof(int16_t)),
+          2),
+      d_half_taps(std::max(half_taps, 1u)),
+      d_float_out(float_out)
+{
+    for (float tap : halfband_taps(d_half_taps))
+        d_taps.push_back((int16_t)std::lrint(tap * 32768.0f));
+
+    set_history(4 * d_half_taps - 1);
+}
+
+halfband_decim_sc::~halfband_decim_sc()
+{
+}
+
+/* The filter of halfband_filter() in Q15 for len interleaved int16, sums in Q30 */
+DSP_MULTIVERSION
+static void halfband_filter_sc(int32_t *acc, const int16_t *even, const int16_t *odd,
+                               const int16_t *taps, int K, int len)
+{
+    for (int i = 0; i < len; i++)
+        acc[i] = (int32_t)odd[i] * 16384;
+
+    for (int k = 0; k < K; k++)
+    {
+        const int32_t tap = taps[k];
+        const int16_t *a = even + 2 * (K - 1 - k);
+        const int16_t *b = even + 2 * (K + k);
+        for (int i = 0; i < len; i++)
+            acc[i] += tap * ((int32_t)a[i] + (int32_t)b[i]);
+    }
+}
+
+DSP_MULTIVERSION
+static void halfband_round_sc(int16_t *out, const int32_t *acc, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        const int32_t v = (acc[i] + 16384) >> 15;
+        out[i] = (int16_t)std::min(std::max(v, (int32_t)-32768), (int32_t)32767);
+    }
+}
+
+DSP_MULTIVERSION
+static void halfband_float_sc(float *out, const int32_t *acc, int len)
+{
+    const float scale = 1.0f / (32768.0f * SC16_SCALE);
+    for (int i = 0; i < len; i++)
+        out[i] = (float)acc[i] * scale;
+}
+
+/** As halfband_decim_cc::work(), over the I and Q of each sample as int16. */
+int halfband_decim_sc::work(int noutput_items,
+                            gr_vector_const_void_star &input_items,
+                            gr_vector_void_star &output_items)
+{
+    const int16_t *in = (const int16_t *)input_items[0];
+    const int K = (int)d_half_taps;
+
+    for (int done = 0; done < noutput_items; done += HALFBAND_BLOCK)
+    {
+        const int n = std::min(noutput_items - done, HALFBAND_BLOCK);
+        const int n_even = n + 2 * K - 1;
+        const int16_t *blk = in + 4 * done;
+
+        if (d_even.size() < 2 * (size_t)n_even)
+        {
+            d_even.resize(2 * n_even);
+            d_odd.resize(2 * n_even);
+            d_acc.resize(2 * HALFBAND_BLOCK);
+        }
+        for (int i = 0; i < n_even; i++)
+        {
+            d_even[2 * i] = blk[4 * i];
+            d_even[2 * i + 1] = blk[4 * i + 1];
+            d_odd[2 * i] = blk[4 * i + 2];
+            d_odd[2 * i + 1] = blk[4 * i + 3];
+        }
+
+        halfband_filter_sc(d_acc.data(), d_even.data(), d_odd.data() + 2 * (K - 1),
+                           d_taps.data(), K, 2 * n);
+        if (d_float_out)
+            halfband_float_sc((float *)output_items[0] + 2 * done, d_acc.data(), 2 * n);
+        else
+            halfband_round_sc((int16_t *)output_items[0] + 2 * done, d_acc.data(), 2 * n);
+    }
+
+    return noutput_items;
+}
@@ -0,0 +1,124 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <gnuradio/sync_decimator.h>
+#include <gnuradio/gr_complex.h>
+
+#include "dsp/sc16_to_cf32.h"
+
+class halfband_decim_cc;
+class halfband_decim_sc;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<halfband_decim_cc> halfband_decim_cc_sptr;
+#else
+typedef std::shared_ptr<halfband_decim_cc> halfband_decim_cc_sptr;
+#endif
+halfband_decim_cc_sptr make_halfband_decim_cc(unsigned int half_taps);
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<halfband_decim_sc> halfband_decim_sc_sptr;
+#else
+typedef std::shared_ptr<halfband_decim_sc> halfband_decim_sc_sptr;
+#endif
+halfband_decim_sc_sptr make_halfband_decim_sc(unsigned int half_taps, bool float_out = false);
+
+/** Taps shared by each pair of even samples of a halfband filter, see halfband_decim_cc. */
+std::vector<float> halfband_taps(unsigned int half_taps);
+
+/**
+ * @brief Decimate by two with a halfband filter.
+ *
+ * The filter has 4 * half_taps - 1 taps. All taps at an even distance from
+ * the center are zero except the center tap, which is 0.5, and the others
+ * are symmetric, so an output takes half_taps multiplications instead of
+ * 4 * half_taps - 1: the input is split into its even and odd samples, the
+ * pairs of even samples that share a tap are added first, and the odd
+ * samples only contribute the center tap.
+ *
+ * The outputs are computed a block at a time, one tap at a time over the
+ * block, so that the inner loops run over contiguous samples and are
+ * vectorized by the compiler (SSE/AVX or NEON, depending on the target).
+ *
+ * The taps are a Kaiser windowed sinc. The transition band is centered on a
+ * quarter of the input rate and narrows with half_taps.
+ */
+class halfband_decim_cc : public gr::sync_decimator
+{
+    friend halfband_decim_cc_sptr make_halfband_decim_cc(unsigned int half_taps);
+
+protected:
+    halfband_decim_cc(unsigned int half_taps);
+
+public:
+    ~halfband_decim_cc();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    /** Taps shared by each pair of even samples, from the center outwards. */
+    const std::vector<float> &taps(void) const { return d_taps; }
+
+private:
+    unsigned int        d_half_taps;
+    std::vector<float>  d_taps;
+    std::vector<gr_complex> d_even;   /*!< Even input samples of a block. */
+    std::vector<gr_complex> d_odd;    /*!< Odd input samples of a block. */
+};
+
+/**
+ * @brief Decimate complex int16 samples by two with a halfband filter.
+ *
+ * The filter of halfband_decim_cc with the taps in Q15 and the sums in
+ * 32 bits, for the stages at the full input rate when the input comes as
+ * integers: a sample is 4 bytes instead of 8 and the integer loops are
+ * vectorized with twice the lanes of the float ones. The taps add up to
+ * less than 2 in magnitude, so the sums stay below 2^31 for any input; the
+ * outputs are rounded and
+ * saturated to int16, or with float_out converted to gr_complex with
+ * SC16_SCALE as 1.0, which ends a chain of integer stages.
+ */
+class halfband_decim_sc : public gr::sync_decimator
+{
+    friend halfband_decim_sc_sptr make_halfband_decim_sc(unsigned int half_taps, bool float_out);
+
+protected:
+    halfband_decim_sc(unsigned int half_taps, bool float_out);
+
+public:
+    ~halfband_decim_sc();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+private:
+    unsigned int         d_half_taps;
+    bool                 d_float_out;
+    std::vector<int16_t> d_taps;    /*!< halfband_taps() in Q15. */
+    std::vector<int16_t> d_even;    /*!< Even input samples of a block, interleaved. */
+    std::vector<int16_t> d_odd;     /*!< Odd input samples of a block, interleaved. */
+    std::vector<int32_t> d_acc;     /*!< Sums of a block in Q30. */
+};
@@ -0,0 +1,235 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <gnuradio/filter/firdes.h>
+#include "dsp/filter_taps_cache.h"
+
+namespace
+{
+    enum design_type {
+        DESIGN_COMPLEX_BAND_PASS,
+        DESIGN_LOW_PASS
+    };
+
+    struct design_key
+    {
+        design_type  type;
+        double       gain;
+        double       sample_rate;
+        double       low;
+        double       high;
+        double       trans_width;
+        int          window;
+
+        bool operator==(const design_key &k) const
+        {
+            return type == k.type && gain == k.gain && sample_rate == k.sample_rate &&
+                   low == k.low && high == k.high && trans_width == k.trans_width &&
+                   window == k.window;
+        }
+    };
+
+    struct cached_design
+    {
+        design_key               key;
+        std::vector<gr_complex>  complex_taps;
+        std::vector<float>       real_taps;
+    };
+
+    std::mutex                 cache_mutex;
+    std::list<cached_design>   cache;   /* most recently used first */
+
+    /* cache_mutex must be held. Moves the design to the front. */
+    cached_design *find(const design_key &key)
+    {
+        for (auto it = cache.begin(); it != cache.end(); ++it)
+        {
+            if (it->key == key)
+            {
+                cache.splice(cache.begin(), cache, it);
+                return &cache.front();
+            }
+        }
+        return nullptr;
+    }
+
+    /* cache_mutex must be held */
+    void insert(cached_design &&design)
+    {
+        cache.push_front(std::move(design));
+        if (cache.size() > FILTER_TAPS_CACHE_SIZE)
+            cache.pop_back();
+    }
+
+    struct pending_job
+    {
+        const void              *owner;
+        std::function<void()>    job;
+    };
+
+    /* The background thread, started with the first job and stopped at exit */
+    class designer
+    {
+    public:
+        ~designer()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            cond.notify_all();
+            if (thread.joinable())
+                thread.join();
+        }
+
+        void post(const void *owner, std::function<void()> job)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                bool replaced = false;
+                for (pending_job &p : jobs)
+                {
+                    if (p.owner == owner)
+                    {
+                        p.job = std::move(job);
+                        replaced = true;
+                        break;
+                    }
+                }
+                if (!replaced)
+                    jobs.push_back({owner, std::move(job)});
+                if (!thread.joinable())
+                    thread = std::thread(&designer::run, this);
+            }
+            cond.notify_all();
+        }
+
+        void cancel(const void *owner)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobs.remove_if([owner](const pending_job &p) { return p.owner == owner; });
+            cond.wait(lock, [this, owner]() { return running != owner; });
+        }
+
+    private:
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;)
+            {
+                cond.wait(lock, [this]() { return stop || !jobs.empty(); });
+                if (stop)
+                    break;
+
+                pending_job p = std::move(jobs.front());
+                jobs.pop_front();
+                running = p.owner;
+                lock.unlock();
+                p.job();
+                lock.lock();
+                running = nullptr;
+                cond.notify_all();
+            }
+        }
+
+        std::mutex               mutex;
+        std::condition_variable  cond;
+        std::list<pending_job>   jobs;
+        const void              *running = nullptr;
+        bool                     stop = false;
+        std::thread              thread;
+    };
+
+    designer background;
+}
+
+std::vector<gr_complex> filter_taps_cache::complex_band_pass(double gain, double sample_rate,
+                                                             double low, double high,
+                                                             double trans_width,
+                                                             window_type window)
+{
+    std::vector<gr_complex> taps;
+    if (find_complex_band_pass(gain, sample_rate, low, high, trans_width, taps, window))
+        return taps;
+
+    /* designed without the lock, so lookups of other filters do not wait */
+    taps = gr::filter::firdes::complex_band_pass(gain, sample_rate, low, high,
+                                                 trans_width, window);
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    design_key key = { DESIGN_COMPLEX_BAND_PASS, gain, sample_rate, low, high,
+                       trans_width, (int)window };
+    if (!find(key))
+        insert({key, taps, {}});
+    return taps;
+}
+
+bool filter_taps_cache::find_complex_band_pass(double gain, double sample_rate,
+                                               double low, double high, double trans_width,
+                                               std::vector<gr_complex> &taps,
+                                               window_type window)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    design_key key = { DESIGN_COMPLEX_BAND_PASS, gain, sample_rate, low, high,
+                       trans_width, (int)window };
+    cached_design *design = find(key);
+    if (!design)
+        return false;
+    taps = design->complex_taps;
+    return true;
+}
+
+std::vector<float> filter_taps_cache::low_pass(double gain, double sample_rate,
+                                               double cutoff, double trans_width,
+                                               window_type window)
+{
+    design_key key = { DESIGN_LOW_PASS, gain, sample_rate, 0.0, cutoff,
+                       trans_width, (int)window };
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        cached_design *design = find(key);
+        if (design)
+            return design->real_taps;
+    }
+
+    std::vector<float> taps = gr::filter::firdes::low_pass(gain, sample_rate, cutoff,
+                                                           trans_width, window);
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (!find(key))
+        insert({key, {}, taps});
+    return taps;
+}
+
+void filter_taps_cache::post(const void *owner, std::function<void()> job)
+{
+    background.post(owner, std::move(job));
+}
+
+void filter_taps_cache::cancel(const void *owner)
+{
+    background.cancel(owner);
+}
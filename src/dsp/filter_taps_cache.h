@@ -0,0 +1,95 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef FILTER_TAPS_CACHE_H
+#define FILTER_TAPS_CACHE_H
+
+#include <functional>
+#include <vector>
+#include <gnuradio/gr_complex.h>
+#if GNURADIO_VERSION < 0x030900
+#include <gnuradio/filter/firdes.h>
+#else
+#include <gnuradio/fft/window.h>
+#endif
+
+/* Number of filter designs kept, least recently used ones are evicted */
+#define FILTER_TAPS_CACHE_SIZE 64
+
+/*! \brief Process-wide cache of designed filter taps.
+ *
+ * Designing a sharp filter with firdes takes a while for thousands of taps,
+ * and the same filters are designed again and again when the passband is
+ * dragged back and forth or the rate changes. The cache keeps the taps of
+ * the latest designs, keyed on all the design parameters.
+ *
+ * post() runs designs on a background thread so that the caller, usually
+ * the GUI thread, does not wait for them.
+ */
+class filter_taps_cache
+{
+public:
+#if GNURADIO_VERSION < 0x030900
+    typedef gr::filter::firdes::win_type window_type;
+    static const window_type WIN_HAMMING = gr::filter::firdes::WIN_HAMMING;
+#else
+    typedef gr::fft::window::win_type    window_type;
+    static const window_type WIN_HAMMING = gr::fft::window::WIN_HAMMING;
+#endif
+
+    /*! \brief Complex band pass taps, see firdes::complex_band_pass(). */
+    static std::vector<gr_complex> complex_band_pass(double gain, double sample_rate,
+                                                     double low, double high,
+                                                     double trans_width,
+                                                     window_type window = WIN_HAMMING);
+
+    /*! \brief Like complex_band_pass() without designing.
+     *  \returns true and the taps if the design is in the cache.
+     */
+    static bool find_complex_band_pass(double gain, double sample_rate,
+                                       double low, double high, double trans_width,
+                                       std::vector<gr_complex> &taps,
+                                       window_type window = WIN_HAMMING);
+
+    /*! \brief Low pass taps, see firdes::low_pass(). */
+    static std::vector<float> low_pass(double gain, double sample_rate,
+                                       double cutoff, double trans_width,
+                                       window_type window = WIN_HAMMING);
+
+    /*! \brief Run a design job on the background thread.
+     *  \param owner The object the job belongs to.
+     *  \param job The job.
+     *
+     * Jobs run one at a time in the order they were posted. A job that has
+     * not started yet is replaced by a newer job of the same owner, so only
+     * the latest of a burst of requests is designed.
+     */
+    static void post(const void *owner, std::function<void()> job);
+
+    /*! \brief Drop the waiting job of owner and wait for its running job.
+     *
+     * Must be called before the owner is destroyed.
+     */
+    static void cancel(const void *owner);
+};
+
+#endif /* FILTER_TAPS_CACHE_H */
@@ -70,13 +70,28 @@ void fm_deemph::set_tau(double tau)
 /*! \brief Calculate taps for FM de-emph IIR filter. */
 void fm_deemph::calculate_iir_taps(double tau)
 {
+    iir_taps((double)d_quad_rate, tau, d_fftaps, d_fbtaps);
+}
+
+/*! \brief Taps of a de-emphasis filter, for iir_filter_ffd without oldstyle.
+ *  \param rate The sample rate.
+ *  \param tau The time constant, 0.0 for none.
+ *  \param fftaps Two feed forward taps.
+ *  \param fbtaps Two feed back taps.
+ */
+void fm_deemph::iir_taps(double rate, double tau,
+                         std::vector<double> &fftaps, std::vector<double> &fbtaps)
+{
+    fftaps.resize(2);
+    fbtaps.resize(2);
+
     if (tau > 1.0e-9)
     {
         // copied from fm_emph.py in gr-analog
         double  w_c;    // Digital corner frequency
         double  w_ca;   // Prewarped analog corner frequency
         double  k, z1, p1, b0;
-        double  fs = (double)d_quad_rate;
+        double  fs = rate;
 
         w_c = 1.0 / tau;
         w_ca = 2.0 * fs * tan(w_c / (2.0 * fs));
@@ -89,16 +104,16 @@ void fm_deemph::calculate_iir_taps(double tau)
         p1 = (1.0 + k) / (1.0 - k);
         b0 = -k / (1.0 - k);
 
-        d_fftaps[0] = b0;
-        d_fftaps[1] = -z1 * b0;
-        d_fbtaps[0] = 1.0;
-        d_fbtaps[1] = -p1;
+        fftaps[0] = b0;
+        fftaps[1] = -z1 * b0;
+        fbtaps[0] = 1.0;
+        fbtaps[1] = -p1;
     }
     else
     {
-        d_fftaps[0] = 1.0;
-        d_fftaps[1] = 0.0;
-        d_fbtaps[0] = 0.0;
-        d_fbtaps[1] = 0.0;
+        fftaps[0] = 1.0;
+        fftaps[1] = 0.0;
+        fbtaps[0] = 0.0;
+        fbtaps[1] = 0.0;
     }
 }
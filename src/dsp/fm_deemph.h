@@ -59,6 +59,9 @@ public:
 
     void set_tau(double tau);
 
+    static void iir_taps(double rate, double tau,
+                         std::vector<double> &fftaps, std::vector<double> &fbtaps);
+
 private:
     /* GR blocks */
     gr::filter::iir_filter_ffd::sptr        d_deemph;    /*! De-emphasis IIR filter. */
@@ -0,0 +1,364 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include "dsp/gpu_fft.h"
+
+#ifdef WITH_OPENCL_FFT
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <clFFT.h>
+
+namespace
+{
+    /* The window over the whole batch, then the shifted power of the
+     * first frames folded into the accumulator, one work item per bin */
+    const char *kernel_source = R"CL(
+__kernel void apply_window(__global float2 *frames, __global const float *window,
+                           const uint n)
+{
+    const size_t i = get_global_id(0);
+    frames[i] *= window[i % n];
+}
+
+__kernel void reduce_power(__global const float2 *frames, __global float *acc,
+                           const uint n, const uint count, const int max_hold)
+{
+    const uint k = get_global_id(0);
+    const uint half = n / 2;
+    const uint bin = k < n - half ? k + half : k - (n - half);
+    float r = acc[k];
+    for (uint f = 0; f < count; f++)
+    {
+        const float2 v = frames[(size_t)f * n + bin];
+        const float p = v.x * v.x + v.y * v.y;
+        r = max_hold ? fmax(r, p) : r + p;
+    }
+    acc[k] = r;
+}
+)CL";
+
+    /* clFFT is set up once for the process */
+    std::mutex  clfft_mutex;
+    int         clfft_users = 0;
+
+    bool check(cl_int err, const char *what)
+    {
+        if (err == CL_SUCCESS)
+            return true;
+        std::cerr << "OpenCL FFT: " << what << " failed (" << err << ")" << std::endl;
+        return false;
+    }
+
+    bool clfft_acquire()
+    {
+        std::lock_guard<std::mutex> lock(clfft_mutex);
+        if (clfft_users == 0)
+        {
+            clfftSetupData setup;
+            clfftInitSetupData(&setup);
+            if (!check(clfftSetup(&setup), "clfftSetup"))
+                return false;
+        }
+        clfft_users++;
+        return true;
+    }
+
+    void clfft_release()
+    {
+        std::lock_guard<std::mutex> lock(clfft_mutex);
+        if (--clfft_users == 0)
+            clfftTeardown();
+    }
+
+    /* The first GPU of all platforms, any device if there is none */
+    cl_device_id pick_device()
+    {
+        cl_uint nplatforms = 0;
+        if (clGetPlatformIDs(0, nullptr, &nplatforms) != CL_SUCCESS || nplatforms == 0)
+            return nullptr;
+        std::vector<cl_platform_id> platforms(nplatforms);
+        clGetPlatformIDs(nplatforms, platforms.data(), nullptr);
+
+        const cl_device_type types[] = {CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_ALL};
+        for (cl_device_type type : types)
+        {
+            for (cl_platform_id platform : platforms)
+            {
+                cl_device_id device;
+                if (clGetDeviceIDs(platform, type, 1, &device, nullptr) == CL_SUCCESS)
+                    return device;
+            }
+        }
+        return nullptr;
+    }
+}
+
+struct gpu_fft_stream::cl_state
+{
+    cl_context          context = nullptr;
+    cl_command_queue    queue = nullptr;
+    cl_program          program = nullptr;
+    cl_kernel           window_kernel = nullptr;
+    cl_kernel           reduce_kernel = nullptr;
+    cl_mem              frames = nullptr;   /* batch of fftsize frames, in place */
+    cl_mem              window = nullptr;
+    cl_mem              acc = nullptr;      /* reduced shifted power */
+    clfftPlanHandle     plan = 0;
+    bool                clfft = false;
+    bool                planned = false;
+
+    ~cl_state()
+    {
+        if (queue)
+            clFinish(queue);
+        if (planned)
+            clfftDestroyPlan(&plan);
+        if (clfft)
+            clfft_release();
+        if (acc)
+            clReleaseMemObject(acc);
+        if (window)
+            clReleaseMemObject(window);
+        if (frames)
+            clReleaseMemObject(frames);
+        if (reduce_kernel)
+            clReleaseKernel(reduce_kernel);
+        if (window_kernel)
+            clReleaseKernel(window_kernel);
+        if (program)
+            clReleaseProgram(program);
+        if (queue)
+            clReleaseCommandQueue(queue);
+        if (context)
+            clReleaseContext(context);
+    }
+};
+
+std::unique_ptr<gpu_fft_stream> gpu_fft_stream::create(unsigned int fftsize,
+                                                       const std::vector<float> &window,
+                                                       bool max_hold)
+{
+    cl_device_id device = pick_device();
+    if (!device || fftsize == 0)
+        return nullptr;
+
+    std::unique_ptr<gpu_fft_stream> s(new gpu_fft_stream());
+    s->d_cl.reset(new cl_state());
+    cl_state &cl = *s->d_cl;
+    s->d_fftsize = fftsize;
+    s->d_max_hold = max_hold;
+    s->d_batch = std::max(1u, std::min((unsigned int)GPU_FFT_MAX_BATCH,
+                          (unsigned int)(GPU_FFT_BATCH_BYTES / (sizeof(gr_complex) * fftsize))));
+
+    char name[256] = "";
+    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name) - 1, name, nullptr);
+    s->d_device = name;
+
+    cl_int err;
+    cl.context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &err);
+    if (!check(err, "clCreateContext"))
+        return nullptr;
+    cl.queue = clCreateCommandQueue(cl.context, device, 0, &err);
+    if (!check(err, "clCreateCommandQueue"))
+        return nullptr;
+
+    cl.program = clCreateProgramWithSource(cl.context, 1, &kernel_source, nullptr, &err);
+    if (!check(err, "clCreateProgramWithSource") ||
+        !check(clBuildProgram(cl.program, 1, &device, "", nullptr, nullptr), "clBuildProgram"))
+        return nullptr;
+    cl.window_kernel = clCreateKernel(cl.program, "apply_window", &err);
+    if (!check(err, "clCreateKernel"))
+        return nullptr;
+    cl.reduce_kernel = clCreateKernel(cl.program, "reduce_power", &err);
+    if (!check(err, "clCreateKernel"))
+        return nullptr;
+
+    cl.frames = clCreateBuffer(cl.context, CL_MEM_READ_WRITE,
+                               sizeof(gr_complex) * fftsize * s->d_batch, nullptr, &err);
+    if (!check(err, "clCreateBuffer"))
+        return nullptr;
+    cl.window = clCreateBuffer(cl.context, CL_MEM_READ_ONLY, sizeof(float) * fftsize,
+                               nullptr, &err);
+    if (!check(err, "clCreateBuffer"))
+        return nullptr;
+    cl.acc = clCreateBuffer(cl.context, CL_MEM_READ_WRITE, sizeof(float) * fftsize,
+                            nullptr, &err);
+    if (!check(err, "clCreateBuffer"))
+        return nullptr;
+
+    const float zero = 0.0f;
+    if (!check(clEnqueueFillBuffer(cl.queue, cl.acc, &zero, sizeof(zero), 0,
+                                   sizeof(float) * fftsize, 0, nullptr, nullptr),
+               "clEnqueueFillBuffer"))
+        return nullptr;
+
+    if (!clfft_acquire())
+        return nullptr;
+    cl.clfft = true;
+
+    size_t length = fftsize;
+    if (!check(clfftCreateDefaultPlan(&cl.plan, cl.context, CLFFT_1D, &length),
+               "clfftCreateDefaultPlan"))
+        return nullptr;
+    cl.planned = true;
+    clfftSetPlanPrecision(cl.plan, CLFFT_SINGLE);
+    clfftSetLayout(cl.plan, CLFFT_COMPLEX_INTERLEAVED, CLFFT_COMPLEX_INTERLEAVED);
+    clfftSetResultLocation(cl.plan, CLFFT_INPLACE);
+    clfftSetPlanBatchSize(cl.plan, s->d_batch);
+    clfftSetPlanDistance(cl.plan, fftsize, fftsize);
+    if (!check(clfftBakePlan(cl.plan, 1, &cl.queue, nullptr, nullptr), "clfftBakePlan"))
+        return nullptr;
+
+    if (!s->set_window(window))
+        return nullptr;
+    s->d_host.resize((size_t)fftsize * s->d_batch);
+    return s;
+}
+
+gpu_fft_stream::~gpu_fft_stream() = default;
+
+bool gpu_fft_stream::set_window(const std::vector<float> &window)
+{
+    if (window.size() < d_fftsize || !submit())
+        return false;
+
+    return check(clEnqueueWriteBuffer(d_cl->queue, d_cl->window, CL_TRUE, 0,
+                                      sizeof(float) * d_fftsize, window.data(),
+                                      0, nullptr, nullptr),
+                 "clEnqueueWriteBuffer");
+}
+
+bool gpu_fft_stream::add_frame(const gr_complex *frame)
+{
+    std::copy(frame, frame + d_fftsize, &d_host[(size_t)d_queued * d_fftsize]);
+    if (++d_queued < d_batch)
+        return true;
+    return submit();
+}
+
+/*
+ * The blocking write waits for the previous batch in the in-order queue,
+ * so at most one batch is in flight and d_host can be refilled at once.
+ * A partial batch is transformed whole, only its frames are reduced.
+ */
+bool gpu_fft_stream::submit()
+{
+    if (d_queued == 0)
+        return true;
+
+    cl_state &cl = *d_cl;
+    const cl_uint n = d_fftsize;
+    const cl_uint count = d_queued;
+    const cl_int max_hold = d_max_hold;
+    const size_t window_items = (size_t)n * count;
+    const size_t reduce_items = n;
+    d_queued = 0;
+
+    if (!check(clEnqueueWriteBuffer(cl.queue, cl.frames, CL_TRUE, 0,
+                                    sizeof(gr_complex) * window_items, d_host.data(),
+                                    0, nullptr, nullptr), "clEnqueueWriteBuffer"))
+        return false;
+
+    clSetKernelArg(cl.window_kernel, 0, sizeof(cl_mem), &cl.frames);
+    clSetKernelArg(cl.window_kernel, 1, sizeof(cl_mem), &cl.window);
+    clSetKernelArg(cl.window_kernel, 2, sizeof(cl_uint), &n);
+    if (!check(clEnqueueNDRangeKernel(cl.queue, cl.window_kernel, 1, nullptr, &window_items,
+                                      nullptr, 0, nullptr, nullptr), "apply_window"))
+        return false;
+
+    if (!check(clfftEnqueueTransform(cl.plan, CLFFT_FORWARD, 1, &cl.queue, 0, nullptr,
+                                     nullptr, &cl.frames, nullptr, nullptr),
+               "clfftEnqueueTransform"))
+        return false;
+
+    clSetKernelArg(cl.reduce_kernel, 0, sizeof(cl_mem), &cl.frames);
+    clSetKernelArg(cl.reduce_kernel, 1, sizeof(cl_mem), &cl.acc);
+    clSetKernelArg(cl.reduce_kernel, 2, sizeof(cl_uint), &n);
+    clSetKernelArg(cl.reduce_kernel, 3, sizeof(cl_uint), &count);
+    clSetKernelArg(cl.reduce_kernel, 4, sizeof(cl_int), &max_hold);
+    if (!check(clEnqueueNDRangeKernel(cl.queue, cl.reduce_kernel, 1, nullptr, &reduce_items,
+                                      nullptr, 0, nullptr, nullptr), "reduce_power"))
+        return false;
+
+    clFlush(cl.queue);
+    d_reduced += count;
+    return true;
+}
+
+int gpu_fft_stream::read(float *acc)
+{
+    if (!submit())
+        return -1;
+
+    cl_state &cl = *d_cl;
+    if (!check(clEnqueueReadBuffer(cl.queue, cl.acc, CL_TRUE, 0, sizeof(float) * d_fftsize,
+                                   acc, 0, nullptr, nullptr), "clEnqueueReadBuffer"))
+        return -1;
+
+    const float zero = 0.0f;
+    if (!check(clEnqueueFillBuffer(cl.queue, cl.acc, &zero, sizeof(zero), 0,
+                                   sizeof(float) * d_fftsize, 0, nullptr, nullptr),
+               "clEnqueueFillBuffer"))
+        return -1;
+
+    const int frames = d_reduced;
+    d_reduced = 0;
+    return frames;
+}
+
+#else
+
+struct gpu_fft_stream::cl_state
+{
+};
+
+std::unique_ptr<gpu_fft_stream> gpu_fft_stream::create(unsigned int, const std::vector<float> &,
+                                                       bool)
+{
+    return nullptr;
+}
+
+gpu_fft_stream::~gpu_fft_stream() = default;
+
+bool gpu_fft_stream::set_window(const std::vector<float> &)
+{
+    return false;
+}
+
+bool gpu_fft_stream::add_frame(const gr_complex *)
+{
+    return false;
+}
+
+int gpu_fft_stream::read(float *)
+{
+    return -1;
+}
+
+bool gpu_fft_stream::submit()
+{
+    return false;
+}
+
+#endif /* WITH_OPENCL_FFT */
@@ -0,0 +1,101 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef GPU_FFT_H
+#define GPU_FFT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <gnuradio/gr_complex.h>
+
+/* Input of one batch of streamed frames, the number of frames follows */
+#define GPU_FFT_BATCH_BYTES (16 * 1024 * 1024)
+
+/* Most frames in one batch, for small FFT sizes */
+#define GPU_FFT_MAX_BATCH   64
+
+/*! \brief Streamed FFT frames computed and reduced on an OpenCL device.
+ *
+ * The streaming mode of rx_fft_c runs a windowed FFT for every hop of the
+ * input. With this backend the frames are collected on the host and sent
+ * to the device a batch at a time, where one dispatch applies the window,
+ * transforms the whole batch with clFFT and folds the shifted power of
+ * every frame into an accumulator that stays on the device, as sum or
+ * maximum. Only the reduced spectrum is read back, once per frame handed
+ * to the GUI, so the CPU does little beyond copying the input.
+ *
+ * The bins are not reduced to pixels on the device: the frames go to the
+ * detector and the sigint history at full resolution, and to the views
+ * through the per-subscriber decimation of the receiver.
+ *
+ * Only built with -DENABLE_OPENCL_FFT=ON; create() returns nullptr without
+ * it, or if no device can be used.
+ */
+class gpu_fft_stream
+{
+public:
+    /*! \brief Set up the backend for one FFT size.
+     *  \param fftsize The FFT size.
+     *  \param window The window taps, fftsize of them.
+     *  \param max_hold Keep the maximum power of the frames instead of the sum.
+     *  \returns The backend, or nullptr if there is no usable device.
+     */
+    static std::unique_ptr<gpu_fft_stream> create(unsigned int fftsize,
+                                                  const std::vector<float> &window,
+                                                  bool max_hold);
+    ~gpu_fft_stream();
+
+    /*! \brief Name of the device, for the log. */
+    const std::string &device() const { return d_device; }
+
+    /*! \brief Replace the window, the frames already sent keep the old one. */
+    bool set_window(const std::vector<float> &window);
+
+    /*! \brief Add a frame of fftsize samples, the batch is sent when full.
+     *  \returns false if the device failed, the backend is unusable then.
+     */
+    bool add_frame(const gr_complex *frame);
+
+    /*! \brief Send the partial batch and read the reduced spectrum.
+     *  \param acc Shifted power of fftsize bins, summed or max-held (output).
+     *  \returns The frames reduced into acc since the last read, -1 if the
+     *           device failed.
+     */
+    int read(float *acc);
+
+private:
+    gpu_fft_stream() = default;
+    bool submit();
+
+    struct cl_state;
+    std::unique_ptr<cl_state> d_cl;
+    std::string               d_device;
+    unsigned int              d_fftsize = 0;
+    unsigned int              d_batch = 0;   /*! Frames per dispatch. */
+    unsigned int              d_queued = 0;  /*! Frames in d_host. */
+    unsigned int              d_reduced = 0; /*! Frames in the accumulator. */
+    bool                      d_max_hold = false;
+    std::vector<gr_complex>   d_host;        /*! Frames of the next batch. */
+};
+
+#endif /* GPU_FFT_H */
@@ -0,0 +1,196 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cstring>
+#include <gnuradio/io_signature.h>
+#include <dsp/iq_sniffer_cc.h>
+
+
+/* Return a shared_ptr to a new instance of iq_sniffer_cc */
+iq_sniffer_cc_sptr make_iq_sniffer_cc()
+{
+    return gnuradio::get_initial_sptr(new iq_sniffer_cc());
+}
+
+
+/*! \brief Create an iq_sniffer_cc object. */
+iq_sniffer_cc::iq_sniffer_cc()
+    : gr::sync_block ("iq_sniffer_cc",
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          gr::io_signature::make(0, 0, 0)),
+      d_readers(std::make_shared<const reader_map>()),
+      d_next_reader(0),
+      d_minsamp(1000)
+{
+
+}
+
+iq_sniffer_cc::~iq_sniffer_cc()
+{
+
+}
+
+
+int iq_sniffer_cc::work(int noutput_items,
+                    gr_vector_const_void_star &input_items,
+                    gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *)input_items[0];
+
+    (void) output_items;
+
+    std::shared_ptr<const reader_map> readers = std::atomic_load(&d_readers);
+    for (const auto &reader : *readers)
+        reader.second->write(in, noutput_items);
+
+    return noutput_items;
+}
+
+
+/*! \brief Add a reader, which gets the samples written from now on.
+ *  \param size The size of its ring in samples.
+ *  \returns The id of the reader for peek_samples() and remove_reader().
+ *
+ * When choosing the size, take into account the input sample rate and
+ * how often the samples will be read.
+ */
+int iq_sniffer_cc::add_reader(unsigned int size)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    auto readers = std::make_shared<reader_map>(*d_readers);
+    (*readers)[++d_next_reader] = std::make_shared<reader>(size);
+    std::atomic_store(&d_readers, std::shared_ptr<const reader_map>(readers));
+    return d_next_reader;
+}
+
+/*! \brief Remove a reader, whose samples are no longer valid. */
+void iq_sniffer_cc::remove_reader(int id)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    auto readers = std::make_shared<reader_map>(*d_readers);
+    readers->erase(id);
+    std::atomic_store(&d_readers, std::shared_ptr<const reader_map>(readers));
+}
+
+int iq_sniffer_cc::num_readers()
+{
+    return (int)std::atomic_load(&d_readers)->size();
+}
+
+unsigned int iq_sniffer_cc::samples_available(int id)
+{
+    std::shared_ptr<reader> r = find_reader(id);
+    if (!r)
+        return 0;
+
+    return r->d_head.load(std::memory_order_acquire) - r->d_tail.load(std::memory_order_relaxed);
+}
+
+/*! \brief Get the samples of a reader in place.
+ *  \param id The reader.
+ *  \param data Set to the oldest sample.
+ *  \param max The most samples wanted, the oldest of the others are dropped.
+ *  \returns The number of samples at data, 0 if fewer than min_samples().
+ *
+ * The samples stay valid until they are released or the reader is
+ * removed. Only one thread may read a reader.
+ */
+unsigned int iq_sniffer_cc::peek_samples(int id, const gr_complex *&data, unsigned int max)
+{
+    std::shared_ptr<reader> r = find_reader(id);
+    if (!r)
+        return 0;
+
+    uint64_t tail = r->d_tail.load(std::memory_order_relaxed);
+    const uint64_t available = r->d_head.load(std::memory_order_acquire) - tail;
+    if (available < d_minsamp)
+        return 0;
+
+    if (available > max)
+    {
+        tail += available - max;
+        r->d_tail.store(tail, std::memory_order_release);
+    }
+    data = &r->d_buf[tail % r->d_size];
+
+    return std::min<uint64_t>(available, max);
+}
+
+/*! \brief Free the oldest num samples of a reader for new samples. */
+void iq_sniffer_cc::release_samples(int id, unsigned int num)
+{
+    std::shared_ptr<reader> r = find_reader(id);
+    if (r)
+        r->d_tail.fetch_add(num, std::memory_order_release);
+}
+
+/*! \brief Samples dropped so far because the ring of a reader was full. */
+uint64_t iq_sniffer_cc::overruns(int id)
+{
+    std::shared_ptr<reader> r = find_reader(id);
+
+    return r ? r->d_overruns.load(std::memory_order_relaxed) : 0;
+}
+
+std::shared_ptr<iq_sniffer_cc::reader> iq_sniffer_cc::find_reader(int id)
+{
+    std::shared_ptr<const reader_map> readers = std::atomic_load(&d_readers);
+    auto it = readers->find(id);
+
+    return it == readers->end() ? nullptr : it->second;
+}
+
+
+iq_sniffer_cc::reader::reader(unsigned int size)
+    : d_buf(2 * (size_t)size),
+      d_size(size),
+      d_head(0),
+      d_tail(0),
+      d_overruns(0)
+{
+}
+
+/* Append what fits, at the same place in both halves of the ring */
+void iq_sniffer_cc::reader::write(const gr_complex *in, unsigned int num)
+{
+    const uint64_t head = d_head.load(std::memory_order_relaxed);
+    const uint64_t free = d_size - (head - d_tail.load(std::memory_order_acquire));
+
+    if (num > free)
+    {
+        d_overruns.fetch_add(num - free, std::memory_order_relaxed);
+        num = free;
+    }
+
+    const unsigned int pos = head % d_size;
+    const unsigned int first = std::min(num, d_size - pos);
+    gr_complex *buf = d_buf.data();
+    memcpy(buf + pos, in, sizeof(gr_complex) * first);
+    memcpy(buf + pos + d_size, in, sizeof(gr_complex) * first);
+    memcpy(buf, in + first, sizeof(gr_complex) * (num - first));
+    memcpy(buf + d_size, in + first, sizeof(gr_complex) * (num - first));
+
+    d_head.store(head + num, std::memory_order_release);
+}
@@ -0,0 +1,119 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef IQ_SNIFFER_CC_H
+#define IQ_SNIFFER_CC_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <gnuradio/gr_complex.h>
+#include <gnuradio/sync_block.h>
+
+
+class iq_sniffer_cc;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<iq_sniffer_cc> iq_sniffer_cc_sptr;
+#else
+typedef std::shared_ptr<iq_sniffer_cc> iq_sniffer_cc_sptr;
+#endif
+
+
+/*! \brief Return a shared_ptr to a new instance of iq_sniffer_cc.
+ *
+ * This is effectively the public constructor. To avoid accidental use
+ * of raw pointers, the constructor is private. This function is the public
+ * interface for creating new instances.
+ *
+ */
+iq_sniffer_cc_sptr make_iq_sniffer_cc();
+
+
+/*! \brief Sink to access I/Q in the flow graph.
+ *  \ingroup DSP
+ *
+ * This block can be used by external objects to access the complex baseband
+ * in the flow graph. It is connected to the output of the down-converter, so
+ * it gets the channel selected by the demodulator at the quadrature rate, and
+ * is used by the modulation classifier and the data channel.
+ *
+ * Each consumer adds its own reader, a single producer, single consumer
+ * ring of the size it asks for, so work() never waits for a consumer and
+ * consumers never wait for each other. A consumer gets the samples in
+ * place with peek_samples() and frees them with release_samples(). The
+ * second half of a ring mirrors the first, so the samples are always
+ * contiguous. When a ring is full the new samples are dropped and counted.
+ */
+class iq_sniffer_cc : public gr::sync_block
+{
+    friend iq_sniffer_cc_sptr make_iq_sniffer_cc();
+
+protected:
+    iq_sniffer_cc();
+
+public:
+    ~iq_sniffer_cc();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    int  add_reader(unsigned int size);
+    void remove_reader(int id);
+    int  num_readers();
+
+    unsigned int samples_available(int id);
+    unsigned int peek_samples(int id, const gr_complex *&data, unsigned int max);
+    void release_samples(int id, unsigned int num);
+    uint64_t overruns(int id);
+
+    void set_min_samples(unsigned int num) {d_minsamp = num;}
+    int min_samples() {return d_minsamp;}
+
+private:
+    struct reader {
+        reader(unsigned int size);
+
+        void write(const gr_complex *in, unsigned int num);
+
+        std::vector<gr_complex> d_buf;   /*!< Twice the size, see iq_sniffer_cc. */
+        const unsigned int d_size;
+        std::atomic<uint64_t> d_head;    /*!< Samples written by work(). */
+        std::atomic<uint64_t> d_tail;    /*!< Samples released by the consumer. */
+        std::atomic<uint64_t> d_overruns;
+    };
+    typedef std::map<int, std::shared_ptr<reader>> reader_map;
+
+    std::shared_ptr<reader> find_reader(int id);
+
+    std::mutex d_mutex;                     /*! Serializes the changes of the readers. */
+    std::shared_ptr<const reader_map> d_readers;   /*! Replaced, never changed in place. */
+    int d_next_reader;
+    std::atomic<unsigned int> d_minsamp;    /*! smallest number of samples we want to return. */
+
+};
+
+
+#endif /* IQ_SNIFFER_CC_H */
@@ -22,7 +22,7 @@
  */
 #include <cmath>
 #include <gnuradio/io_signature.h>
-#include <gnuradio/filter/firdes.h>
+#include "dsp/filter_taps_cache.h"
 #include "dsp/lpf.h"
 
 static const int MIN_IN  = 1; /* Minimum number of input streams. */
@@ -54,8 +54,8 @@ lpf_ff::lpf_ff(double sample_rate, double cutoff_freq,
     d_gain(gain)
 {
     /* generate taps */
-    d_taps = gr::filter::firdes::low_pass(d_gain, d_sample_rate,
-                                 d_cutoff_freq, d_trans_width);
+    d_taps = filter_taps_cache::low_pass(d_gain, d_sample_rate,
+                                         d_cutoff_freq, d_trans_width);
 
     /* create low-pass filter (decimation=1) */
     lpf = gr::filter::fir_filter_fff::make(1, d_taps);
@@ -78,8 +78,8 @@ void lpf_ff::set_param(double cutoff_freq, double trans_width)
     d_trans_width = trans_width;
 
     /* generate new taps */
-    d_taps = gr::filter::firdes::low_pass(d_gain, d_sample_rate,
-                                 d_cutoff_freq, d_trans_width);
+    d_taps = filter_taps_cache::low_pass(d_gain, d_sample_rate,
+                                         d_cutoff_freq, d_trans_width);
 
     lpf->set_taps(d_taps);
 }
@@ -0,0 +1,103 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <atomic>
+#include "dsp/mem_account.h"
+
+static const char *subsystem_names[MEM_SUBSYSTEMS] = {
+    "FFT samples", "Audio FFT", "Waterfall", "Waterfall history",
+    "Sigint views", "I/Q pre-trigger", "Chat history", "Waterfall tiles"
+};
+
+static std::atomic<int64_t> used_bytes[MEM_SUBSYSTEMS];
+static std::atomic<int64_t> peak_bytes[MEM_SUBSYSTEMS];
+static std::atomic<int64_t> cap_bytes[MEM_SUBSYSTEMS];
+
+static bool valid(int subsystem)
+{
+    return subsystem >= 0 && subsystem < MEM_SUBSYSTEMS;
+}
+
+int64_t mem_account::used(int subsystem)
+{
+    return valid(subsystem) ? used_bytes[subsystem].load(std::memory_order_relaxed) : 0;
+}
+
+int64_t mem_account::peak(int subsystem)
+{
+    return valid(subsystem) ? peak_bytes[subsystem].load(std::memory_order_relaxed) : 0;
+}
+
+int64_t mem_account::cap(int subsystem)
+{
+    return valid(subsystem) ? cap_bytes[subsystem].load(std::memory_order_relaxed) : 0;
+}
+
+/*! \brief Set the cap of a subsystem, applied when its owners size their buffers next. */
+void mem_account::set_cap(int subsystem, int64_t bytes)
+{
+    if (valid(subsystem))
+        cap_bytes[subsystem].store(std::max<int64_t>(bytes, 0), std::memory_order_relaxed);
+}
+
+const char *mem_account::name(int subsystem)
+{
+    return valid(subsystem) ? subsystem_names[subsystem] : "";
+}
+
+mem_charge::mem_charge(int subsystem) :
+    d_subsystem(subsystem),
+    d_bytes(0)
+{
+}
+
+mem_charge::~mem_charge()
+{
+    set(0);
+}
+
+/*! \brief Replace what this owner holds by bytes. */
+void mem_charge::set(int64_t bytes)
+{
+    if (!valid(d_subsystem) || bytes == d_bytes)
+        return;
+
+    const int64_t now = used_bytes[d_subsystem].fetch_add(bytes - d_bytes, std::memory_order_relaxed)
+                        + bytes - d_bytes;
+    d_bytes = bytes;
+
+    int64_t peak = peak_bytes[d_subsystem].load(std::memory_order_relaxed);
+    while (now > peak && !peak_bytes[d_subsystem].compare_exchange_weak(peak, now,
+                                                                        std::memory_order_relaxed))
+        ;
+}
+
+int64_t mem_charge::allowed(int64_t wanted) const
+{
+    const int64_t limit = mem_account::cap(d_subsystem);
+    if (limit <= 0)
+        return wanted;
+
+    const int64_t others = mem_account::used(d_subsystem) - d_bytes;
+    return std::max<int64_t>(0, std::min(wanted, limit - others));
+}
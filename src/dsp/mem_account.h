@@ -0,0 +1,81 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef MEM_ACCOUNT_H
+#define MEM_ACCOUNT_H
+
+#include <cstdint>
+
+/*
+ * Memory of the large buffers by subsystem.
+ *
+ * The owners of the buffers that grow with the FFT size, the history or the
+ * screen report what they hold through a mem_charge, the performance dock
+ * shows the sum by subsystem. A subsystem with a cap, from the [memory]
+ * group of the configuration, makes its owners shorten their history to
+ * stay below it; the buffers needed for the current view are never refused.
+ */
+enum mem_subsystem {
+    MEM_FFT_SAMPLES = 0,    /*!< rx_fft_c rings and their history */
+    MEM_AUDIO_FFT,          /*!< rx_fft_f buffers */
+    MEM_WATERFALL,          /*!< CPlotter waterfall image */
+    MEM_WF_HISTORY,         /*!< CWaterfallHistory rows of the plotter and the snapshot */
+    MEM_SIGINT_VIEWS,       /*!< WaterfallDisplay ring of the sigint dock */
+    MEM_IQ_PRETRIGGER,      /*!< iq_capture_sink ring */
+    MEM_CHAT_HISTORY,       /*!< messages of the sigint chat kept in memory */
+    MEM_WF_TILES,           /*!< CWaterfallTiles pyramid for remote viewers */
+    MEM_SUBSYSTEMS
+};
+
+namespace mem_account
+{
+
+int64_t     used(int subsystem);
+int64_t     peak(int subsystem);
+int64_t     cap(int subsystem);
+void        set_cap(int subsystem, int64_t bytes);  /* 0 for none */
+const char *name(int subsystem);
+
+} // namespace mem_account
+
+/*! \brief Bytes one owner holds in a subsystem, released on destruction. */
+class mem_charge
+{
+public:
+    explicit mem_charge(int subsystem);
+    ~mem_charge();
+
+    mem_charge(const mem_charge &) = delete;
+    mem_charge &operator=(const mem_charge &) = delete;
+
+    void    set(int64_t bytes);
+    int64_t bytes() const { return d_bytes; }
+
+    /*! \brief Part of wanted that fits under the cap, next to the other owners. */
+    int64_t allowed(int64_t wanted) const;
+
+private:
+    int     d_subsystem;
+    int64_t d_bytes;
+};
+
+#endif // MEM_ACCOUNT_H
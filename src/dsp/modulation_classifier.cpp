@@ -0,0 +1,397 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "dsp/fft_plan_cache.h"
+#include "dsp/modulation_classifier.h"
+
+/* Samples with less power than this fraction of the mean are left out of
+ * the instantaneous frequency, where the phase is mostly noise */
+#define CLASSIFIER_FREQ_GATE    0.25f
+
+/* A spectral line must be this far above the bins around it */
+#define CLASSIFIER_LINE_DB      10.0f
+
+/* Dynamic range of the occupied bandwidth below the peak */
+#define CLASSIFIER_OCCUPIED_DB  30.0f
+
+/* Bins next to a line that are left out of its neighbourhood, and the
+ * width of the neighbourhood */
+#define CLASSIFIER_LINE_GAP     3
+#define CLASSIFIER_LINE_REACH   12
+
+/* Linear ramp from 0 at lo to 1 at hi */
+static float ramp(float x, float lo, float hi)
+{
+    return std::min(std::max((x - lo) / (hi - lo), 0.0f), 1.0f);
+}
+
+static float to_db(float ratio)
+{
+    return 10.0f * std::log10(std::max(ratio, 1.0e-6f));
+}
+
+/* Median of a copy of part of a vector */
+static float median(const std::vector<float> &v, size_t from, size_t to)
+{
+    std::vector<float> tmp(v.begin() + from, v.begin() + to);
+    if (tmp.empty())
+        return 0.0f;
+    std::nth_element(tmp.begin(), tmp.begin() + tmp.size() / 2, tmp.end());
+    return tmp[tmp.size() / 2];
+}
+
+/* Strongest bin in [from, to) over the median of the bins around it, so a
+ * line stands out and the shape of a wide spectrum does not */
+static float line_db(const std::vector<float> &psd, size_t from, size_t to, size_t *peak = nullptr)
+{
+    size_t k = std::max_element(psd.begin() + from, psd.begin() + to) - psd.begin();
+    if (peak)
+        *peak = k;
+
+    std::vector<float> around;
+    for (size_t d = CLASSIFIER_LINE_GAP; d <= CLASSIFIER_LINE_REACH; d++)
+    {
+        if (k >= d)
+            around.push_back(psd[k - d]);
+        if (k + d < psd.size())
+            around.push_back(psd[k + d]);
+    }
+    float med = median(around, 0, around.size());
+    return med > 0.0f ? to_db(psd[k] / med) : 0.0f;
+}
+
+modulation_classifier::modulation_classifier()
+    : d_sample_rate(96000.0),
+      d_low(-5000.0),
+      d_high(5000.0)
+{
+    d_window.resize(CLASSIFIER_FFT_SIZE);
+    for (unsigned int i = 0; i < CLASSIFIER_FFT_SIZE; i++)
+        d_window[i] = 0.5f - 0.5f * std::cos(2.0 * M_PI * i / CLASSIFIER_FFT_SIZE);
+
+    design_filter();
+}
+
+modulation_classifier::~modulation_classifier()
+{
+}
+
+/*! \brief Set the channel the samples come from.
+ *  \param sample_rate The quadrature rate.
+ *  \param low The low cut of the demodulator filter, relative to the channel.
+ *  \param high The high cut of the demodulator filter, relative to the channel.
+ */
+void modulation_classifier::set_channel(double sample_rate, double low, double high)
+{
+    if (sample_rate == d_sample_rate && low == d_low && high == d_high)
+        return;
+
+    d_sample_rate = sample_rate;
+    d_low = std::max(std::min(low, high), -sample_rate / 2.0);
+    d_high = std::min(std::max(low, high), sample_rate / 2.0);
+    design_filter();
+}
+
+/* Hamming windowed sinc low pass to half the filter width */
+void modulation_classifier::design_filter()
+{
+    const int mid = CLASSIFIER_FILTER_TAPS / 2;
+    const double fc = std::max(d_high - d_low, 1.0) / 2.0 / d_sample_rate;
+    double sum = 0.0;
+
+    d_taps.resize(CLASSIFIER_FILTER_TAPS);
+    for (int i = 0; i < CLASSIFIER_FILTER_TAPS; i++)
+    {
+        double t = i - mid;
+        double h = (t == 0.0) ? 2.0 * fc : std::sin(2.0 * M_PI * fc * t) / (M_PI * t);
+        h *= 0.54 - 0.46 * std::cos(2.0 * M_PI * i / (CLASSIFIER_FILTER_TAPS - 1));
+        d_taps[i] = (float)h;
+        sum += h;
+    }
+    for (float &tap : d_taps)
+        tap /= (float)sum;
+}
+
+/* Welch spectrum with half overlapping Hann segments, DC in the middle */
+void modulation_classifier::averaged_spectrum(const std::vector<gr_complex> &x,
+                                              std::vector<float> &psd)
+{
+    const unsigned int size = CLASSIFIER_FFT_SIZE;
+    fft_plan_cache::fft_c *fft = fft_plan_cache::acquire(size);
+    unsigned int segments = 0;
+
+    psd.assign(size, 0.0f);
+    for (size_t start = 0; start + size <= x.size(); start += size / 2)
+    {
+        gr_complex *in = fft->get_inbuf();
+        for (unsigned int i = 0; i < size; i++)
+            in[i] = x[start + i] * d_window[i];
+        fft->execute();
+
+        const gr_complex *out = fft->get_outbuf();
+        for (unsigned int i = 0; i < size; i++)
+            psd[(i + size / 2) % size] += std::norm(out[i]);
+        segments++;
+    }
+    fft_plan_cache::release(fft, size);
+
+    if (segments > 0)
+        for (float &p : psd)
+            p /= (float)segments;
+}
+
+/*! \brief Classify a block of samples.
+ *  \param samples Complex baseband of the channel at the rate of set_channel().
+ *  \param num The number of samples, at least 4 * CLASSIFIER_FFT_SIZE.
+ *  \param res The classification (output).
+ *  \returns false if there are not enough samples or they are all zero.
+ */
+bool modulation_classifier::classify(const gr_complex *samples, unsigned int num, result &res)
+{
+    const unsigned int size = CLASSIFIER_FFT_SIZE;
+    if (num < 4 * size)
+        return false;
+
+    features &f = res.feat;
+    std::memset(&f, 0, sizeof(f));
+
+    // Move the passband to DC
+    const double center = (d_low + d_high) / 2.0;
+    const double bw = d_high - d_low;
+    const double df = d_sample_rate / size;
+    std::vector<gr_complex> x(num);
+    const double step = -2.0 * M_PI * center / d_sample_rate;
+    for (unsigned int n = 0; n < num; n++)
+    {
+        double phase = std::fmod(step * n, 2.0 * M_PI);
+        x[n] = samples[n] * gr_complex((float)std::cos(phase), (float)std::sin(phase));
+    }
+
+    // Spectrum features
+    std::vector<float> psd;
+    averaged_spectrum(x, psd);
+
+    const int half_bins = std::max(1, (int)(bw / 2.0 / df));
+    const size_t lo = std::max(0, (int)size / 2 - half_bins);
+    const size_t hi = std::min((int)size, (int)size / 2 + half_bins + 1);
+    const size_t bins = hi - lo;
+
+    std::vector<float> sorted(psd);
+    std::sort(sorted.begin(), sorted.end());
+    float noise = sorted[size / 5];
+    if (bins > size * 4 / 5)
+        noise = median(psd, lo, hi) * 0.5f;
+
+    // Occupied bins are above the noise and within CLASSIFIER_OCCUPIED_DB of
+    // the peak, so the keying sidebands of a strong carrier do not count
+    const float top = *std::max_element(psd.begin() + lo, psd.begin() + hi);
+    const float floor = std::max(4.0f * noise, top * std::pow(10.0f, -CLASSIFIER_OCCUPIED_DB / 10.0f));
+    float mean = 0.0f;
+    unsigned int occupied = 0;
+    for (size_t k = lo; k < hi; k++)
+    {
+        mean += psd[k];
+        if (psd[k] > floor)
+            occupied++;
+    }
+    mean /= (float)bins;
+    if (mean <= 0.0f)
+        return false;
+
+    f.snr_db = to_db(noise > 0.0f ? mean / noise - 1.0f : 1.0e6f);
+    size_t peak;
+    f.carrier_db = line_db(psd, lo, hi, &peak);
+    f.carrier_freq = (float)(((int)peak - (int)size / 2) * df + center);
+    f.occupied = (float)occupied / (float)bins;
+
+    // Sidebands around the channel frequency, unless the filter is one sided
+    const double sym = std::min(-d_low, d_high);
+    bool one_sided = sym < bw / 8.0;
+    if (one_sided)
+    {
+        f.asymmetry = (d_low >= 0.0) ? 1.0f : -1.0f;
+    }
+    else
+    {
+        const int zero = (int)size / 2 - (int)std::lround(center / df);
+        const int reach = (int)(sym / df);
+        float upper = 0.0f, lower = 0.0f;
+        for (int k = 1; k <= reach; k++)
+        {
+            if (zero + k < (int)size)
+                upper += std::max(psd[zero + k] - noise, 0.0f);
+            if (zero - k >= 0)
+                lower += std::max(psd[zero - k] - noise, 0.0f);
+        }
+        if (upper + lower > 0.0f)
+            f.asymmetry = (upper - lower) / (upper + lower);
+    }
+
+    // Channel filter, the first taps are left out as they are not settled
+    const unsigned int ntaps = d_taps.size();
+    const unsigned int len = num - ntaps;
+    std::vector<gr_complex> y(len);
+    for (unsigned int n = 0; n < len; n++)
+    {
+        gr_complex acc(0.0f, 0.0f);
+        const gr_complex *in = &x[n];
+        for (unsigned int t = 0; t < ntaps; t++)
+            acc += in[t] * d_taps[t];
+        y[n] = acc;
+    }
+
+    // Moments and cumulants
+    double c21 = 0.0, m42 = 0.0;
+    std::complex<double> m20(0.0, 0.0), m40(0.0, 0.0);
+    for (const gr_complex &s : y)
+    {
+        std::complex<double> v(s.real(), s.imag());
+        std::complex<double> v2 = v * v;
+        double p = std::norm(v);
+        c21 += p;
+        m42 += p * p;
+        m20 += v2;
+        m40 += v2 * v2;
+    }
+    c21 /= len;
+    m42 /= len;
+    m20 /= (double)len;
+    m40 /= (double)len;
+    if (c21 <= 0.0)
+        return false;
+
+    const std::complex<double> c40 = m40 - 3.0 * m20 * m20;
+    const double c42 = m42 - std::norm(m20) - 2.0 * c21 * c21;
+    f.power_db = (float)(10.0 * std::log10(c21));
+    f.env_var = (float)((m42 - c21 * c21) / (c21 * c21));
+    f.noncircular = (float)(std::abs(m20) / c21);
+    f.c40 = (float)(std::abs(c40) / (c21 * c21));
+    f.c42 = (float)(c42 / (c21 * c21));
+
+    // Instantaneous frequency, normalized samples for the cyclic spectra
+    const float gate = CLASSIFIER_FREQ_GATE * (float)c21;
+    const float scale = 1.0f / std::sqrt((float)c21);
+    std::vector<float> freq;
+    freq.reserve(len);
+    std::vector<gr_complex> z2(len), z4(len), zp(len);
+    for (unsigned int n = 0; n < len; n++)
+    {
+        gr_complex v = y[n] * scale;
+        z2[n] = v * v;
+        z4[n] = z2[n] * z2[n];
+        zp[n] = gr_complex(std::norm(v) - 1.0f, 0.0f);
+        if (n > 0 && std::norm(y[n]) > gate && std::norm(y[n - 1]) > gate)
+            freq.push_back(std::arg(y[n] * std::conj(y[n - 1])));
+    }
+    if (freq.size() > 1)
+    {
+        double fmean = 0.0, f2 = 0.0, f4 = 0.0;
+        for (float v : freq)
+            fmean += v;
+        fmean /= freq.size();
+        for (float v : freq)
+        {
+            double d = (v - fmean) * (v - fmean);
+            f2 += d;
+            f4 += d * d;
+        }
+        f2 /= freq.size();
+        f4 /= freq.size();
+        f.freq_std = (float)(std::sqrt(f2) * d_sample_rate / (2.0 * M_PI));
+        f.freq_kurtosis = f2 > 0.0 ? (float)(f4 / (f2 * f2)) : 0.0f;
+    }
+
+    // Lines of x^2 and x^4 within their doubled and quadrupled bandwidths
+    averaged_spectrum(z2, psd);
+    f.line2_db = line_db(psd, std::max(0, (int)size / 2 - 2 * half_bins),
+                         std::min((int)size, (int)size / 2 + 2 * half_bins + 1));
+    averaged_spectrum(z4, psd);
+    f.line4_db = line_db(psd, std::max(0, (int)size / 2 - 4 * half_bins),
+                         std::min((int)size, (int)size / 2 + 4 * half_bins + 1));
+
+    // Symbol rate line of the envelope, away from DC
+    averaged_spectrum(zp, psd);
+    const size_t first = size / 2 + 2;
+    const size_t last = std::min((int)size, (int)size / 2 + half_bins * 2 + 1);
+    if (last > first + 4 && line_db(psd, first, last, &peak) > CLASSIFIER_LINE_DB)
+        f.symbol_rate = (float)((peak - size / 2) * df);
+
+    // Score the classes
+    const float noise_score = 1.0f - ramp(f.snr_db, 3.0f, 10.0f);
+    const float sig = 1.0f - noise_score;
+    const float constant = 1.0f - ramp(f.env_var, 0.1f, 0.4f);
+    const float carrier = ramp(f.carrier_db, 10.0f, 20.0f);
+    const float centered = std::fabs(f.carrier_freq) <= 2.0f * df ? 1.0f : 0.0f;
+    const float narrow = 1.0f - ramp(f.occupied, 0.03f, 0.08f);
+    const float lines = ramp(std::max(f.line2_db, f.line4_db), 8.0f, 14.0f);
+    const float psk = sig * ramp(-f.c42, 0.2f, 0.6f) * (1.0f - carrier);
+    const float ssb = sig * ramp(f.env_var, 0.4f, 1.0f) * (1.0f - carrier) * (1.0f - narrow) *
+                      (one_sided ? 1.0f : ramp(std::fabs(f.asymmetry), 0.4f, 0.7f));
+
+    const struct {
+        const char *label;
+        float score;
+    } scores[] = {
+        { "Noise", noise_score },
+        { "CW",    sig * carrier * narrow },
+        { "AM",    sig * carrier * centered * (1.0f - narrow) * ramp(f.env_var, 0.05f, 0.15f) },
+        { f.asymmetry >= 0.0f ? "USB" : "LSB", ssb },
+        { "FM",    sig * constant * ramp(f.freq_kurtosis, 1.6f, 2.1f) * (1.0f - lines) },
+        { "FSK",   sig * constant * (1.0f - ramp(f.freq_kurtosis, 1.6f, 2.1f)) },
+        { "BPSK",  psk * ramp(f.line2_db, 8.0f, 14.0f) },
+        { "QPSK",  psk * ramp(f.line4_db, 8.0f, 14.0f) * (1.0f - ramp(f.line2_db, 6.0f, 10.0f)) },
+    };
+
+    float total = 0.0f;
+    int best = 0;
+    for (int i = 0; i < (int)(sizeof(scores) / sizeof(scores[0])); i++)
+    {
+        total += scores[i].score;
+        if (scores[i].score > scores[best].score)
+            best = i;
+    }
+
+    res.confidence = total > 0.0f ? scores[best].score * scores[best].score / total : 0.0f;
+    res.label = scores[best].score < 0.3f ? "Unknown" : scores[best].label;
+
+    return true;
+}
+
+/*! \brief Short text for the display, like "FM 87% (SNR 23 dB)". */
+std::string modulation_classifier::describe(const result &res)
+{
+    char text[96];
+
+    if (res.feat.symbol_rate > 0.0f && res.label != "Noise")
+        std::snprintf(text, sizeof(text), "%s %d%% (SNR %.0f dB, %.0f Bd)", res.label.c_str(),
+                      (int)std::lround(res.confidence * 100.0f), res.feat.snr_db,
+                      res.feat.symbol_rate);
+    else
+        std::snprintf(text, sizeof(text), "%s %d%% (SNR %.0f dB)", res.label.c_str(),
+                      (int)std::lround(res.confidence * 100.0f), res.feat.snr_db);
+
+    return text;
+}
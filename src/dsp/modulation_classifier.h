@@ -0,0 +1,104 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef MODULATION_CLASSIFIER_H
+#define MODULATION_CLASSIFIER_H
+
+#include <string>
+#include <vector>
+#include <gnuradio/gr_complex.h>
+
+/* FFT size of the averaged spectra */
+#define CLASSIFIER_FFT_SIZE     1024
+
+/* Number of taps of the channel filter */
+#define CLASSIFIER_FILTER_TAPS  65
+
+/* Classifications below this confidence should be reviewed */
+#define CLASSIFIER_MIN_CONFIDENCE 0.6f
+
+/*! \brief Modulation classifier for the demodulator channel.
+ *  \ingroup DSP
+ *
+ * Classifies blocks of complex baseband from the down-converter, as returned
+ * by receiver::get_iq_sniffer_data(), with features that are cheap enough to
+ * compute several times per second:
+ *  - Averaged spectrum of the channel: SNR, carrier, occupied bandwidth and
+ *    the asymmetry that gives away SSB.
+ *  - Normalized envelope variance and the higher-order cumulants C40 and
+ *    C42, which separate constant envelope and linear modulations.
+ *  - Standard deviation and kurtosis of the instantaneous frequency, for FM
+ *    and FSK.
+ *  - Spectral lines of x^2, x^4 and |x|^2, the cyclic features of BPSK, QPSK
+ *    and of the symbol rate.
+ *
+ * The decision is a set of rules scoring each class; the confidence is the
+ * share of the best score. The features are returned so a caller can log
+ * them or hand uncertain cases to something smarter.
+ */
+class modulation_classifier
+{
+public:
+    struct features {
+        float power_db;         /*!< Power in the filter in dBFS. */
+        float snr_db;           /*!< Channel power over the noise floor. */
+        float carrier_db;       /*!< Strongest line in the channel. */
+        float carrier_freq;     /*!< Frequency of that line relative to the channel. */
+        float occupied;         /*!< Fraction of the channel above the noise. */
+        float asymmetry;        /*!< (upper - lower) / (upper + lower) sideband power. */
+        float env_var;          /*!< Variance of |x|^2 over its squared mean. */
+        float noncircular;      /*!< |C20| / C21, 1 for real signals like AM. */
+        float c40;              /*!< |C40| / C21^2 */
+        float c42;              /*!< C42 / C21^2 */
+        float freq_std;         /*!< Instantaneous frequency deviation in Hz. */
+        float freq_kurtosis;    /*!< Kurtosis of the instantaneous frequency. */
+        float line2_db;         /*!< Spectral line of x^2. */
+        float line4_db;         /*!< Spectral line of x^4. */
+        float symbol_rate;      /*!< Line of |x|^2 in Hz, 0 if none. */
+    };
+
+    struct result {
+        std::string label;      /*!< Modulation, "Noise" or "Unknown". */
+        float       confidence; /*!< 0 to 1. */
+        features    feat;
+    };
+
+    modulation_classifier();
+    ~modulation_classifier();
+
+    void set_channel(double sample_rate, double low, double high);
+    bool classify(const gr_complex *samples, unsigned int num, result &res);
+
+    static std::string describe(const result &res);
+
+private:
+    void design_filter();
+    void averaged_spectrum(const std::vector<gr_complex> &x, std::vector<float> &psd);
+
+    double              d_sample_rate;
+    double              d_low;          /*!< Filter low cut relative to the channel. */
+    double              d_high;         /*!< Filter high cut relative to the channel. */
+    std::vector<float>  d_taps;
+    std::vector<float>  d_window;
+};
+
+#endif /* MODULATION_CLASSIFIER_H */
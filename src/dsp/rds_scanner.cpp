@@ -0,0 +1,173 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include <gnuradio/io_signature.h>
+#include "dsp/filter_taps_cache.h"
+#include "dsp/rds_scanner.h"
+
+rds_scanner_cc_sptr make_rds_scanner_cc(double samp_rate)
+{
+    return gnuradio::get_initial_sptr(new rds_scanner_cc(samp_rate));
+}
+
+rds_scanner_cc::rds_scanner_cc(double samp_rate)
+    : gr::hier_block2("rds_scanner_cc",
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          gr::io_signature::make(0, 0, 0)),
+      d_samp_rate(samp_rate)
+{
+    d_null = gr::blocks::null_sink::make(sizeof(gr_complex));
+    update_taps();
+    connect_all();
+}
+
+rds_scanner_cc::~rds_scanner_cc()
+{
+}
+
+/*! \brief Set the input rate, which starts the stations over. */
+void rds_scanner_cc::set_samp_rate(double samp_rate)
+{
+    if (samp_rate == d_samp_rate)
+        return;
+
+    d_samp_rate = samp_rate;
+    update_taps();
+
+    std::vector<double> offsets;
+    for (const chain &c : d_chains)
+        offsets.push_back(c.info.offset);
+    lock();
+    {
+        std::lock_guard<std::mutex> guard(d_mutex);
+        d_chains.clear();
+        for (double offset : offsets)
+            d_chains.push_back(make_chain(offset));
+    }
+    disconnect_all();
+    connect_all();
+    unlock();
+}
+
+/*! \brief Decode the stations at these offsets from the center of the input.
+ *
+ * Stations that were already decoded keep their chain and what it has
+ * decoded so far.
+ */
+void rds_scanner_cc::set_stations(const std::vector<double> &offsets)
+{
+    std::vector<chain> chains;
+    for (double offset : offsets)
+    {
+        auto it = std::find_if(d_chains.begin(), d_chains.end(),
+                               [offset](const chain &c) { return c.info.offset == offset; });
+        chains.push_back(it != d_chains.end() ? *it : make_chain(offset));
+    }
+
+    lock();
+    disconnect_all();
+    {
+        std::lock_guard<std::mutex> guard(d_mutex);
+        d_chains.swap(chains);
+    }
+    connect_all();
+    unlock();
+}
+
+/*! \brief The stations with the PI code and name decoded so far. */
+std::vector<rds_scanner_cc::station_info> rds_scanner_cc::get_stations(void)
+{
+    std::lock_guard<std::mutex> guard(d_mutex);
+    std::vector<station_info> stations;
+    std::string text;
+    int type;
+
+    for (chain &c : d_chains)
+    {
+        // Types as in DockRDS::updateRDS(), 0 is the PI code and 1 the name
+        for (c.store->get_message(text, type); type != -1; c.store->get_message(text, type))
+        {
+            if (type == 0)
+                c.info.pi = text;
+            else if (type == 1)
+                c.info.ps = text;
+        }
+        stations.push_back(c.info);
+    }
+
+    return stations;
+}
+
+/* Decimate as far as possible without going below RDS_SCAN_RATE */
+void rds_scanner_cc::update_taps(void)
+{
+    d_decim = std::max(1u, (unsigned int)std::floor(d_samp_rate / RDS_SCAN_RATE));
+    d_taps = filter_taps_cache::low_pass(1.0, d_samp_rate, RDS_SCAN_CUTOFF, RDS_SCAN_TRANS);
+}
+
+rds_scanner_cc::chain rds_scanner_cc::make_chain(double offset) const
+{
+    const double chan_rate = d_samp_rate / d_decim;
+    chain c;
+
+    c.info.offset = offset;
+    c.xlat = gr::filter::freq_xlating_fir_filter_ccf::make(d_decim, d_taps, offset, d_samp_rate);
+    if (std::fabs(chan_rate - RDS_SCAN_RATE) > 1.0)
+        c.rr = make_resampler_cc(RDS_SCAN_RATE / chan_rate);
+    c.demod = make_fm_discriminator_cf(RDS_SCAN_RATE / (2.0 * M_PI * RDS_SCAN_MAX_DEV));
+    c.demod->set_accuracy(fm_discriminator_cf::FM_ATAN_FAST);
+    c.rds = make_rx_rds(RDS_SCAN_RATE);
+    c.decoder = gr::rds::decoder::make(0, 0);
+    c.parser = gr::rds::parser::make(0, 0, 0);
+    c.store = make_rx_rds_store();
+
+    return c;
+}
+
+void rds_scanner_cc::connect_all(void)
+{
+    if (d_chains.empty())
+    {
+        connect(self(), 0, d_null, 0);
+        return;
+    }
+
+    for (chain &c : d_chains)
+    {
+        connect(self(), 0, c.xlat, 0);
+        if (c.rr)
+        {
+            connect(c.xlat, 0, c.rr, 0);
+            connect(c.rr, 0, c.demod, 0);
+        }
+        else
+        {
+            connect(c.xlat, 0, c.demod, 0);
+        }
+        connect(c.demod, 0, c.rds, 0);
+        connect(c.rds, 0, c.decoder, 0);
+        msg_connect(c.decoder, "out", c.parser, "in");
+        msg_connect(c.parser, "out", c.store, "store");
+    }
+}
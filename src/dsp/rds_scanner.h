@@ -0,0 +1,110 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RDS_SCANNER_H
+#define RDS_SCANNER_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <gnuradio/blocks/null_sink.h>
+#include <gnuradio/filter/freq_xlating_fir_filter.h>
+#include <gnuradio/hier_block2.h>
+#include "dsp/resampler_xx.h"
+#include "dsp/rx_demod_fm.h"
+#include "dsp/rx_rds.h"
+
+/* Rate of the FM composite signal rx_rds works at */
+#define RDS_SCAN_RATE       240000.0
+
+/* Channel filter of each station, enough for the composite up to RDS */
+#define RDS_SCAN_CUTOFF     100e3
+#define RDS_SCAN_TRANS      40e3
+
+/* Deviation of broadcast FM */
+#define RDS_SCAN_MAX_DEV    75e3
+
+class rds_scanner_cc;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<rds_scanner_cc> rds_scanner_cc_sptr;
+#else
+typedef std::shared_ptr<rds_scanner_cc> rds_scanner_cc_sptr;
+#endif
+
+rds_scanner_cc_sptr make_rds_scanner_cc(double samp_rate);
+
+/*! \brief RDS of several FM stations in the input at once.
+ *  \ingroup DSP
+ *
+ * Each station gets a light chain of its own: a channel filter straight
+ * from the input down to about RDS_SCAN_RATE, an FM discriminator without
+ * de-emphasis or audio, and the RDS demodulator, decoder and parser. The
+ * channel filters of all stations share one set of taps.
+ *
+ * Only the PI code and the program service name are kept, for surveys
+ * of the FM band rather than for listening.
+ */
+class rds_scanner_cc : public gr::hier_block2
+{
+    friend rds_scanner_cc_sptr make_rds_scanner_cc(double samp_rate);
+
+public:
+    struct station_info {
+        double      offset;     /*!< From the center of the input [Hz]. */
+        std::string pi;         /*!< Program identification, empty until decoded. */
+        std::string ps;         /*!< Program service name, empty until decoded. */
+    };
+
+    rds_scanner_cc(double samp_rate);
+    ~rds_scanner_cc();
+
+    void set_samp_rate(double samp_rate);
+    void set_stations(const std::vector<double> &offsets);
+    std::vector<station_info> get_stations(void);
+    bool empty(void) const { return d_chains.empty(); }
+
+private:
+    struct chain {
+        station_info info;
+        gr::filter::freq_xlating_fir_filter_ccf::sptr xlat;
+        resampler_cc_sptr rr;   /*!< To RDS_SCAN_RATE, null if already there. */
+        fm_discriminator_cf_sptr demod;
+        rx_rds_sptr rds;
+        gr::rds::decoder::sptr decoder;
+        gr::rds::parser::sptr parser;
+        rx_rds_store_sptr store;
+    };
+
+    void update_taps(void);
+    chain make_chain(double offset) const;
+    void connect_all(void);
+
+    double d_samp_rate;
+    unsigned int d_decim;       /*!< Of the channel filters. */
+    std::vector<float> d_taps;  /*!< Of the channel filters. */
+    std::vector<chain> d_chains;
+    std::mutex d_mutex;         /*!< Protects d_chains against get_stations(). */
+    gr::blocks::null_sink::sptr d_null;
+};
+
+#endif /* RDS_SCANNER_H */
@@ -20,13 +20,55 @@
  * the Free Software Foundation, Inc., 51 Franklin Street,
  * Boston, MA 02110-1301, USA.
  */
+#include <cmath>
 #include <cstdio>
 #include <gnuradio/io_signature.h>
-#include <gnuradio/filter/firdes.h>
+#include "dsp/filter_taps_cache.h"
 #include "dsp/resampler_xx.h"
 
 #define RESAMPLER_OUTPUT_MULTIPLE 4096
 
+/* Number of filters of the arbitrary rate resampler */
+#define RESAMPLER_PFB_SIZE 32
+
+/*
+ * Find interp / decim equal to rate, both at most RESAMPLER_MAX_RATIONAL.
+ * The rates are ratios of sample rates in Hz, computed in float, so the
+ * match only has to be within float precision. The smallest decim that
+ * matches gives the reduced fraction.
+ */
+static bool rational_rate(float rate, unsigned int &interp, unsigned int &decim)
+{
+    for (unsigned int q = 1; q <= RESAMPLER_MAX_RATIONAL; q++)
+    {
+        double p = std::round((double)rate * q);
+        if (p < 1.0 || p > RESAMPLER_MAX_RATIONAL)
+            continue;
+        if (std::abs(p / q - rate) <= 1.e-6 * rate)
+        {
+            interp = (unsigned int)p;
+            decim = q;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Low pass taps for a filter at 'interp' times the input rate, with the
+ * cutoff relative to the input rate.
+ *
+ * Note: In case of decimation, we limit the cutoff to the output bandwidth to avoid "phantom"
+ *       signals when we have a frequency translation in front of the PFB resampler.
+ */
+static std::vector<float> resampler_taps(float rate, unsigned int interp)
+{
+    double cutoff = rate > 1.0f ? 0.4 : 0.4*(double)rate;
+    double trans_width = rate > 1.0f ? 0.2 : 0.2*(double)rate;
+
+    return filter_taps_cache::low_pass(interp, interp, cutoff, trans_width);
+}
+
 /* Create a new instance of resampler_cc and return
  * a shared_ptr. This is effectively the public constructor.
  */
@@ -44,25 +86,8 @@ resampler_cc::resampler_cc(float rate)
        http://gnuradio.squarespace.com/blog/2010/12/6/new-interface-for-pfb_arb_resampler_ccf.html
 
        and blks2.pfb_arb_resampler.py
-
-       Note: In case of decimation, we limit the cutoff to the output bandwidth to avoid "phantom"
-             signals when we have a frequency translation in front of the PFB resampler.
     */
-
-    /* generate taps */
-    double cutoff = rate > 1.0f ? 0.4 : 0.4*(double)rate;
-    double trans_width = rate > 1.0f ? 0.2 : 0.2*(double)rate;
-    unsigned int flt_size = 32;
-
-    d_taps = gr::filter::firdes::low_pass(flt_size, flt_size, cutoff, trans_width);
-
-    /* create the filter */
-    d_filter = gr::filter::pfb_arb_resampler_ccf::make(rate, d_taps, flt_size);
-    d_filter->set_output_multiple(RESAMPLER_OUTPUT_MULTIPLE);
-
-    /* connect filter */
-    connect(self(), 0, d_filter, 0);
-    connect(d_filter, 0, self(), 0);
+    connect_filter(rate);
 }
 
 resampler_cc::~resampler_cc()
@@ -72,24 +97,42 @@ resampler_cc::~resampler_cc()
 
 void resampler_cc::set_rate(float rate)
 {
-    /* generate taps */
-    double cutoff = rate > 1.0f ? 0.4 : 0.4*(double)rate;
-    double trans_width = rate > 1.0f ? 0.2 : 0.2*(double)rate;
-    unsigned int flt_size = 32;
-    d_taps = gr::filter::firdes::low_pass(flt_size, flt_size, cutoff, trans_width);
-
     /* FIXME: Should implement set_taps() in PFB */
     lock();
-    disconnect(self(), 0, d_filter, 0);
-    disconnect(d_filter, 0, self(), 0);
+    disconnect_all();
     d_filter.reset();
-    d_filter = gr::filter::pfb_arb_resampler_ccf::make(rate, d_taps, flt_size);
-    d_filter->set_output_multiple(RESAMPLER_OUTPUT_MULTIPLE);
-    connect(self(), 0, d_filter, 0);
-    connect(d_filter, 0, self(), 0);
+    d_rational.reset();
+    connect_filter(rate);
     unlock();
 }
 
+/* Create the rational or arbitrary rate resampler and connect it. */
+void resampler_cc::connect_filter(float rate)
+{
+    unsigned int interp, decim;
+
+    if (rational_rate(rate, interp, decim))
+    {
+        d_taps = resampler_taps(rate, interp);
+#if GNURADIO_VERSION < 0x030900
+        d_rational = gr::filter::rational_resampler_base_ccf::make(interp, decim, d_taps);
+#else
+        d_rational = gr::filter::rational_resampler_ccf::make(interp, decim, d_taps);
+#endif
+        d_rational->set_output_multiple(RESAMPLER_OUTPUT_MULTIPLE);
+        connect(self(), 0, d_rational, 0);
+        connect(d_rational, 0, self(), 0);
+    }
+    else
+    {
+        d_taps = resampler_taps(rate, RESAMPLER_PFB_SIZE);
+        d_filter = gr::filter::pfb_arb_resampler_ccf::make(rate, d_taps, RESAMPLER_PFB_SIZE);
+        d_filter->set_output_multiple(RESAMPLER_OUTPUT_MULTIPLE);
+        connect(self(), 0, d_filter, 0);
+        connect(d_filter, 0, self(), 0);
+    }
+}
+
 /* Create a new instance of resampler_ff and return
  * a shared_ptr. This is effectively the public constructor.
  */
@@ -107,24 +150,8 @@ resampler_ff::resampler_ff(float rate)
        http://gnuradio.squarespace.com/blog/2010/12/6/new-interface-for-pfb_arb_resampler_ccf.html
 
        and blks2.pfb_arb_resampler.py
-
-       Note: In case of decimation, we limit the cutoff to the output bandwidth to avoid "phantom"
-             signals when we have a frequency translation in front of the PFB resampler.
     */
-
-    /* generate taps */
-    double cutoff = rate > 1.0f ? 0.4 : 0.4*(double)rate;
-    double trans_width = rate > 1.0f ? 0.2 : 0.2*(double)rate;
-    unsigned int flt_size = 32;
-
-    d_taps = gr::filter::firdes::low_pass(flt_size, flt_size, cutoff, trans_width);
-
-    /* create the filter */
-    d_filter = gr::filter::pfb_arb_resampler_fff::make(rate, d_taps, flt_size);
-
-    /* connect filter */
-    connect(self(), 0, d_filter, 0);
-    connect(d_filter, 0, self(), 0);
+    connect_filter(rate);
 }
 
 resampler_ff::~resampler_ff()
@@ -134,19 +161,36 @@ resampler_ff::~resampler_ff()
 
 void resampler_ff::set_rate(float rate)
 {
-    /* generate taps */
-    double cutoff = rate > 1.0f ? 0.4 : 0.4*(double)rate;
-    double trans_width = rate > 1.0f ? 0.2 : 0.2*(double)rate;
-    unsigned int flt_size = 32;
-    d_taps = gr::filter::firdes::low_pass(flt_size, flt_size, cutoff, trans_width);
-
     /* FIXME: Should implement set_taps() in PFB */
     lock();
-    disconnect(self(), 0, d_filter, 0);
-    disconnect(d_filter, 0, self(), 0);
+    disconnect_all();
     d_filter.reset();
-    d_filter = gr::filter::pfb_arb_resampler_fff::make(rate, d_taps, flt_size);
-    connect(self(), 0, d_filter, 0);
-    connect(d_filter, 0, self(), 0);
+    d_rational.reset();
+    connect_filter(rate);
     unlock();
 }
+
+/* Create the rational or arbitrary rate resampler and connect it. */
+void resampler_ff::connect_filter(float rate)
+{
+    unsigned int interp, decim;
+
+    if (rational_rate(rate, interp, decim))
+    {
+        d_taps = resampler_taps(rate, interp);
+#if GNURADIO_VERSION < 0x030900
+        d_rational = gr::filter::rational_resampler_base_fff::make(interp, decim, d_taps);
+#else
+        d_rational = gr::filter::rational_resampler_fff::make(interp, decim, d_taps);
+#endif
+        connect(self(), 0, d_rational, 0);
+        connect(d_rational, 0, self(), 0);
+    }
+    else
+    {
+        d_taps = resampler_taps(rate, RESAMPLER_PFB_SIZE);
+        d_filter = gr::filter::pfb_arb_resampler_fff::make(rate, d_taps, RESAMPLER_PFB_SIZE);
+        connect(self(), 0, d_filter, 0);
+        connect(d_filter, 0, self(), 0);
+    }
+}
@@ -26,6 +26,14 @@
 #include <gnuradio/hier_block2.h>
 #include <gnuradio/filter/pfb_arb_resampler_ccf.h>
 #include <gnuradio/filter/pfb_arb_resampler_fff.h>
+#if GNURADIO_VERSION < 0x030900
+#include <gnuradio/filter/rational_resampler_base.h>
+#else
+#include <gnuradio/filter/rational_resampler.h>
+#endif
+
+/* Largest interpolation and decimation of the rational resampler */
+#define RESAMPLER_MAX_RATIONAL 256
 
 
 class resampler_cc;
@@ -47,12 +55,17 @@ typedef std::shared_ptr<resampler_ff> resampler_ff_sptr;
  */
 resampler_cc_sptr make_resampler_cc(float rate);
 
-/*! \brief Arbitrary rate resampler based on gr_pfb_arb_resampler_ccf
+/*! \brief Resampler based on the rational and arbitrary rate PFB resamplers
  *  \ingroup DSP
  *
- * This block is a convenience wrapper around gr_pfb_arb_resampler_ccf. It takes care
- * of generating filter taps that can be used for the filter, as well as calculating
- * the other required parameters.
+ * This block is a convenience wrapper around rational_resampler_ccf and
+ * gr_pfb_arb_resampler_ccf. It takes care of generating filter taps that can be used
+ * for the filter, as well as calculating the other required parameters.
+ *
+ * A rate that is a ratio of integers up to RESAMPLER_MAX_RATIONAL, like 48k/96k,
+ * uses the rational resampler, which computes one polyphase branch per output
+ * and is exact. Other rates use the arbitrary rate resampler, which
+ * interpolates between two branches.
  */
 class resampler_cc : public gr::hier_block2
 {
@@ -64,8 +77,15 @@ public:
     void set_rate(float rate);
 
 private:
+    void connect_filter(float rate);
+
     std::vector<float>            d_taps;
     gr::filter::pfb_arb_resampler_ccf::sptr d_filter;
+#if GNURADIO_VERSION < 0x030900
+    gr::filter::rational_resampler_base_ccf::sptr d_rational;
+#else
+    gr::filter::rational_resampler_ccf::sptr d_rational;
+#endif
 };
 
 
@@ -77,12 +97,11 @@ private:
 resampler_ff_sptr make_resampler_ff(float rate);
 
 
-/*! \brief Arbitrary rate resampler based on gr_pfb_arb_resampler_fff
+/*! \brief Resampler based on the rational and arbitrary rate PFB resamplers
  *  \ingroup DSP
  *
- * This block is a convenience wrapper around gr_pfb_arb_resampler_fff. It takes care
- * of generating filter taps that can be used for the filter, as well as calculating
- * the other required parameters.
+ * This block is a convenience wrapper around rational_resampler_fff and
+ * gr_pfb_arb_resampler_fff, see resampler_cc.
  */
 class resampler_ff : public gr::hier_block2
 {
@@ -94,8 +113,15 @@ public:
     void set_rate(float rate);
 
 private:
+    void connect_filter(float rate);
+
     std::vector<float>            d_taps;
     gr::filter::pfb_arb_resampler_fff::sptr d_filter;
+#if GNURADIO_VERSION < 0x030900
+    gr::filter::rational_resampler_base_fff::sptr d_rational;
+#else
+    gr::filter::rational_resampler_fff::sptr d_rational;
+#endif
 };
 
 #endif // RESAMPLER_XX_H
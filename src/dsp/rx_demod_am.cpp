@@ -21,8 +21,171 @@
  * the Free Software Foundation, Inc., 51 Franklin Street,
  * Boston, MA 02110-1301, USA.
  */
+#include <algorithm>
+#include <cmath>
+#include <complex>
 #include <gnuradio/io_signature.h>
+#include <volk/volk.h>
+#include <volk/volk_version.h>
 #include <dsp/rx_demod_am.h>
+#include <dsp/vector_arg.h>
+
+
+/* DC removal of out, with the state in registers */
+static void dc_removal(float *out, int num, float &last_x, float &last_y)
+{
+    float x1 = last_x, y1 = last_y;
+
+    for (int i = 0; i < num; i++)
+    {
+        float x = out[i];
+        y1 = x - x1 + AM_DCR_POLE * y1;
+        x1 = x;
+        out[i] = y1;
+    }
+    last_x = x1;
+    last_y = y1;
+}
+
+
+am_envelope_cf_sptr make_am_envelope_cf(bool dcr)
+{
+    return gnuradio::get_initial_sptr(new am_envelope_cf(dcr));
+}
+
+am_envelope_cf::am_envelope_cf(bool dcr)
+    : gr::sync_block ("am_envelope_cf",
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          gr::io_signature::make(1, 1, sizeof(float))),
+      d_dcr(dcr),
+      d_dcr_x(0.0f),
+      d_dcr_y(0.0f)
+{
+}
+
+am_envelope_cf::~am_envelope_cf()
+{
+}
+
+int am_envelope_cf::work(int noutput_items,
+                         gr_vector_const_void_star &input_items,
+                         gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *) input_items[0];
+    float *out = (float *) output_items[0];
+
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    volk_32fc_magnitude_32f(out, in, noutput_items);
+    if (d_dcr)
+        dc_removal(out, noutput_items, d_dcr_x, d_dcr_y);
+
+    return noutput_items;
+}
+
+void am_envelope_cf::set_dcr(bool dcr)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    if (dcr && !d_dcr)
+        d_dcr_x = d_dcr_y = 0.0f;
+    d_dcr = dcr;
+}
+
+
+amsync_pll_cf_sptr make_amsync_pll_cf(float loop_bw, float max_freq, float min_freq, bool dcr)
+{
+    return gnuradio::get_initial_sptr(new amsync_pll_cf(loop_bw, max_freq, min_freq, dcr));
+}
+
+amsync_pll_cf::amsync_pll_cf(float loop_bw, float max_freq, float min_freq, bool dcr)
+    : gr::sync_block ("amsync_pll_cf",
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          gr::io_signature::make(1, 1, sizeof(float))),
+      d_max_freq(max_freq),
+      d_min_freq(min_freq),
+      d_phase(0.0f),
+      d_freq(0.0f),
+      d_dcr(dcr),
+      d_dcr_x(0.0f),
+      d_dcr_y(0.0f),
+      d_mixed(AMSYNC_PLL_BLOCK),
+      d_error(AMSYNC_PLL_BLOCK)
+{
+    set_loop_bandwidth(loop_bw);
+}
+
+amsync_pll_cf::~amsync_pll_cf()
+{
+}
+
+int amsync_pll_cf::work(int noutput_items,
+                        gr_vector_const_void_star &input_items,
+                        gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *) input_items[0];
+    float *out = (float *) output_items[0];
+
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    for (int i = 0; i < noutput_items; i += AMSYNC_PLL_BLOCK)
+    {
+        const int n = std::min(AMSYNC_PLL_BLOCK, noutput_items - i);
+        gr_complex nco(cosf(d_phase), -sinf(d_phase));
+        const gr_complex step(cosf(d_freq), -sinf(d_freq));
+        const float held = d_freq;
+        float ahead = 0.0f;
+
+#if VOLK_VERSION >= 030100
+        volk_32fc_s32fc_x2_rotator2_32fc(d_mixed.data(), in + i, &step, &nco, n);
+#else
+        volk_32fc_s32fc_x2_rotator_32fc(d_mixed.data(), in + i, step, &nco, n);
+#endif
+        volk_32fc_deinterleave_real_32f(out + i, d_mixed.data(), n);
+        vector_arg<atan_fast>(d_mixed.data(), d_error.data(), n, 1.0f);
+
+        // The loop of gr::blocks::control_loop on each sample. Its NCO is
+        // ahead of the held one, so the error of the held one less that is
+        // the error the loop would have seen.
+        for (int k = 0; k < n; k++)
+        {
+            float error = d_error[k] - ahead;
+            if (error > (float)M_PI)
+                error -= 2.0f * (float)M_PI;
+            else if (error < -(float)M_PI)
+                error += 2.0f * (float)M_PI;
+            d_freq = std::min(std::max(d_freq + d_beta * error, d_min_freq), d_max_freq);
+            ahead += d_freq - held + d_alpha * error;
+        }
+        d_phase = std::remainder(d_phase + n * held + ahead, 2.0f * (float)M_PI);
+    }
+
+    if (d_dcr)
+        dc_removal(out, noutput_items, d_dcr_x, d_dcr_y);
+
+    return noutput_items;
+}
+
+/* Gains as in gr::blocks::control_loop, with its damping of sqrt(2)/2 */
+void amsync_pll_cf::set_loop_bandwidth(float loop_bw)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    const float damping = sqrtf(2.0f) / 2.0f;
+    const float denom = 1.0f + 2.0f * damping * loop_bw + loop_bw * loop_bw;
+
+    d_alpha = (4.0f * damping * loop_bw) / denom;
+    d_beta = (4.0f * loop_bw * loop_bw) / denom;
+}
+
+void amsync_pll_cf::set_dcr(bool dcr)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    if (dcr && !d_dcr)
+        d_dcr_x = d_dcr_y = 0.0f;
+    d_dcr = dcr;
+}
 
 
 /* Create a new instance of rx_demod_am and return a shared_ptr. */
@@ -39,34 +202,13 @@ static const int MAX_OUT = 1; /* Maximum number of output streams. */
 rx_demod_am::rx_demod_am(float quad_rate, bool dcr)
     : gr::hier_block2 ("rx_demod_am",
                       gr::io_signature::make (MIN_IN, MAX_IN, sizeof (gr_complex)),
-                      gr::io_signature::make (MIN_OUT, MAX_OUT, sizeof (float))),
-    d_dcr_enabled(dcr)
+                      gr::io_signature::make (MIN_OUT, MAX_OUT, sizeof (float)))
 {
     (void) quad_rate;
 
-    /* demodulator */
-    d_demod = gr::blocks::complex_to_mag::make(1);
-
-    /* connect blocks */
+    d_demod = make_am_envelope_cf(dcr);
     connect(self(), 0, d_demod, 0);
-
-    /* DC removal */
-    d_fftaps.resize(2);
-    d_fbtaps.resize(2);
-    d_fftaps[0] = 1.0;      // FIXME: could be configurable with a specified time constant
-    d_fftaps[1] = -1.0;
-    d_fbtaps[0] = 0.0;
-    d_fbtaps[1] = 0.999;
-    d_dcr = gr::filter::iir_filter_ffd::make(d_fftaps, d_fbtaps);
-
-    if (d_dcr_enabled) {
-        connect(d_demod, 0, d_dcr, 0);
-        connect(d_dcr, 0, self(), 0);
-    }
-    else {
-        connect(d_demod, 0, self(), 0);
-    }
-
+    connect(d_demod, 0, self(), 0);
 }
 
 rx_demod_am::~rx_demod_am ()
@@ -79,30 +221,7 @@ rx_demod_am::~rx_demod_am ()
  */
 void rx_demod_am::set_dcr(bool dcr)
 {
-    if (dcr == d_dcr_enabled) {
-        return;
-    }
-
-    if (d_dcr_enabled)
-    {
-        // Switching from ON to OFF
-        lock();
-        disconnect(d_demod, 0, d_dcr, 0);
-        disconnect(d_dcr, 0, self(), 0);
-        connect(d_demod, 0, self(), 0);
-        unlock();
-    }
-    else
-    {
-        // Switching from OFF to ON
-        lock();
-        disconnect(d_demod, 0, self(), 0);
-        connect(d_demod, 0, d_dcr, 0);
-        connect(d_dcr, 0, self(), 0);
-        unlock();
-    }
-
-    d_dcr_enabled = dcr;
+    d_demod->set_dcr(dcr);
 }
 
 /* Create a new instance of rx_demod_amsync and return a shared_ptr. */
@@ -116,35 +235,13 @@ rx_demod_amsync_sptr make_rx_demod_amsync(float quad_rate, bool dcr, float pll_b
 rx_demod_amsync::rx_demod_amsync(float quad_rate, bool dcr, float pll_bw)
     : gr::hier_block2 ("rx_demod_amsync",
                       gr::io_signature::make (MIN_IN, MAX_IN, sizeof (gr_complex)),
-                      gr::io_signature::make (MIN_OUT, MAX_OUT, sizeof (float))),
-    d_dcr_enabled(dcr)
-{
-    /* demodulator */
-    d_demod1 = gr::analog::pll_carriertracking_cc::make(pll_bw,
-                                                        (2*(float)M_PI*PLL_FMAX/quad_rate),
-                                                        (2*(float)M_PI*(-PLL_FMAX)/quad_rate));
-    d_demod2 = gr::blocks::complex_to_real::make(1);
-
-    /* connect blocks */
-    connect(self(), 0, d_demod1, 0);
-    connect(d_demod1, 0, d_demod2, 0);
-
-    /* DC removal */
-    d_fftaps.resize(2);
-    d_fbtaps.resize(2);
-    d_fftaps[0] = 1.0;      // FIXME: could be configurable with a specified time constant
-    d_fftaps[1] = -1.0;
-    d_fbtaps[0] = 0.0;
-    d_fbtaps[1] = 0.999;
-    d_dcr = gr::filter::iir_filter_ffd::make(d_fftaps, d_fbtaps);
-
-    if (d_dcr_enabled) {
-        connect(d_demod2, 0, d_dcr, 0);
-        connect(d_dcr, 0, self(), 0);
-    }
-    else {
-        connect(d_demod2, 0, self(), 0);
-    }
+                      gr::io_signature::make (MIN_OUT, MAX_OUT, sizeof (float)))
+{
+    d_demod = make_amsync_pll_cf(pll_bw,
+                                 (2*(float)M_PI*PLL_FMAX/quad_rate),
+                                 (2*(float)M_PI*(-PLL_FMAX)/quad_rate), dcr);
+    connect(self(), 0, d_demod, 0);
+    connect(d_demod, 0, self(), 0);
 }
 
 rx_demod_amsync::~rx_demod_amsync ()
@@ -157,30 +254,7 @@ rx_demod_amsync::~rx_demod_amsync ()
  */
 void rx_demod_amsync::set_dcr(bool dcr)
 {
-    if (dcr == d_dcr_enabled) {
-        return;
-    }
-
-    if (d_dcr_enabled)
-    {
-        // Switching from ON to OFF
-        lock();
-        disconnect(d_demod2, 0, d_dcr, 0);
-        disconnect(d_dcr, 0, self(), 0);
-        connect(d_demod2, 0, self(), 0);
-        unlock();
-    }
-    else
-    {
-        // Switching from OFF to ON
-        lock();
-        disconnect(d_demod2, 0, self(), 0);
-        connect(d_demod2, 0, d_dcr, 0);
-        connect(d_dcr, 0, self(), 0);
-        unlock();
-    }
-
-    d_dcr_enabled = dcr;
+    d_demod->set_dcr(dcr);
 }
 
 /*! \brief Set PLL loop bandwidth.
@@ -188,6 +262,5 @@ void rx_demod_amsync::set_dcr(bool dcr)
  */
 void rx_demod_amsync::set_pll_bw(float pll_bw)
 {
-    d_demod1->set_loop_bandwidth(pll_bw);
-    d_demod1->update_gains();
+    d_demod->set_loop_bandwidth(pll_bw);
 }
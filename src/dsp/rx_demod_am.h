@@ -24,24 +24,113 @@
 #ifndef RX_DEMOD_AM_H
 #define RX_DEMOD_AM_H
 
+#include <mutex>
 #include <gnuradio/hier_block2.h>
-#include <gnuradio/blocks/complex_to_mag.h>
-#include <gnuradio/blocks/complex_to_real.h>
-#include <gnuradio/analog/pll_carriertracking_cc.h>
-#include <gnuradio/filter/iir_filter_ffd.h>
+#include <gnuradio/sync_block.h>
 #include <vector>
 
+/* Pole of the DC removal of the demodulated audio */
+#define AM_DCR_POLE 0.999f
+
+/* Samples the AM-Sync PLL mixes down with one NCO setting */
+#define AMSYNC_PLL_BLOCK 64
+
+class am_envelope_cf;
+class amsync_pll_cf;
 class rx_demod_am;
 class rx_demod_amsync;
 
 #if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<am_envelope_cf> am_envelope_cf_sptr;
+typedef boost::shared_ptr<amsync_pll_cf> amsync_pll_cf_sptr;
 typedef boost::shared_ptr<rx_demod_am> rx_demod_am_sptr;
 typedef boost::shared_ptr<rx_demod_amsync> rx_demod_amsync_sptr;
 #else
+typedef std::shared_ptr<am_envelope_cf> am_envelope_cf_sptr;
+typedef std::shared_ptr<amsync_pll_cf> amsync_pll_cf_sptr;
 typedef std::shared_ptr<rx_demod_am> rx_demod_am_sptr;
 typedef std::shared_ptr<rx_demod_amsync> rx_demod_amsync_sptr;
 #endif
 
+am_envelope_cf_sptr make_am_envelope_cf(bool dcr);
+
+/*! \brief Envelope detector with DC removal in one pass.
+ *  \ingroup DSP
+ *
+ * The magnitude is a VOLK kernel, the DC removal a single loop after it.
+ */
+class am_envelope_cf : public gr::sync_block
+{
+    friend am_envelope_cf_sptr make_am_envelope_cf(bool dcr);
+
+protected:
+    am_envelope_cf(bool dcr);
+
+public:
+    ~am_envelope_cf();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    void set_dcr(bool dcr);
+
+private:
+    std::mutex d_mutex;         /*!< Protects the settings against work(). */
+    bool    d_dcr;
+    float   d_dcr_x;            /*!< Last input of the DC removal. */
+    float   d_dcr_y;
+};
+
+amsync_pll_cf_sptr make_amsync_pll_cf(float loop_bw, float max_freq, float min_freq, bool dcr);
+
+/*! \brief Carrier tracking PLL and synchronous detector with DC removal.
+ *  \ingroup DSP
+ *
+ * The loop is the one of gr::analog::pll_carriertracking_cc, but the
+ * signal is mixed down in blocks of AMSYNC_PLL_BLOCK samples by a VOLK
+ * rotator, with the frequency and phase of the NCO held over the block,
+ * and the phase errors come from a vectorized atan2. Only the loop filter
+ * runs per sample, on the errors less how far its NCO is ahead of the
+ * held one, which are the errors it would have had. The output is the
+ * real part of the signal mixed with the held NCO, which differs from the
+ * loop by a fraction of its phase error.
+ *
+ * Frequencies are in radians per sample.
+ */
+class amsync_pll_cf : public gr::sync_block
+{
+    friend amsync_pll_cf_sptr make_amsync_pll_cf(float loop_bw, float max_freq,
+                                                 float min_freq, bool dcr);
+
+protected:
+    amsync_pll_cf(float loop_bw, float max_freq, float min_freq, bool dcr);
+
+public:
+    ~amsync_pll_cf();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    void set_loop_bandwidth(float loop_bw);
+    void set_dcr(bool dcr);
+
+private:
+    std::mutex d_mutex;         /*!< Protects the settings against work(). */
+    float   d_alpha;            /*!< Phase gain of the loop. */
+    float   d_beta;             /*!< Frequency gain of the loop. */
+    float   d_max_freq;
+    float   d_min_freq;
+    float   d_phase;
+    float   d_freq;
+    bool    d_dcr;
+    float   d_dcr_x;            /*!< Last input of the DC removal. */
+    float   d_dcr_y;
+    std::vector<gr_complex> d_mixed;
+    std::vector<float>      d_error;
+};
+
 /*! \brief Return a shared_ptr to a new instance of rx_demod_am.
  *  \param quad_rate The input sample rate.
  *  \param dcr Enable DCR
@@ -55,7 +144,7 @@ rx_demod_am_sptr make_rx_demod_am(float quad_rate, bool dcr=true);
  *
  * This class implements the AM demodulator as envelope detector.
  * AM demodulation is simply a conversion from complex to magnitude.
- * This block implements an optional IIR DC-removal filter for the demodulated signal.
+ * This block implements an optional DC-removal filter for the demodulated signal.
  *
  */
 class rx_demod_am : public gr::hier_block2
@@ -69,16 +158,7 @@ public:
 
 private:
     /* GR blocks */
-    gr::blocks::complex_to_mag::sptr    d_demod;  /*! AM demodulation (complex to magnitude). */
-    gr::filter::iir_filter_ffd::sptr    d_dcr;    /*! DC removal (IIR high pass). */
-
-    /* other parameters */
-    bool   d_dcr_enabled;   /*! DC removal flag. */
-
-    /* IIR DC-removal filter taps */
-    std::vector<double> d_fftaps;   /*! Feed forward taps. */
-    std::vector<double> d_fbtaps;   /*! Feed back taps. */
-
+    am_envelope_cf_sptr     d_demod;  /*! Envelope detector and DC removal. */
 };
 
 
@@ -98,7 +178,7 @@ rx_demod_amsync_sptr make_rx_demod_amsync(float quad_rate, bool dcr=true, float
  * This class implements a synchronous AM demodulator.
  * A PLL tracks the carrier frequency and is mixed with the signal, shifting it to
  * 0 Hz.
- * This block implements an optional IIR DC-removal filter for the demodulated signal.
+ * This block implements an optional DC-removal filter for the demodulated signal.
  *
  */
 class rx_demod_amsync : public gr::hier_block2
@@ -113,17 +193,7 @@ public:
 
 private:
     /* GR blocks */
-    gr::analog::pll_carriertracking_cc::sptr d_demod1;
-    gr::blocks::complex_to_real::sptr d_demod2;
-    gr::filter::iir_filter_ffd::sptr    d_dcr;    /*! DC removal (IIR high pass). */
-
-    /* other parameters */
-    bool   d_dcr_enabled;   /*! DC removal flag. */
-
-    /* IIR DC-removal filter taps */
-    std::vector<double> d_fftaps;   /*! Feed forward taps. */
-    std::vector<double> d_fbtaps;   /*! Feed back taps. */
-
+    amsync_pll_cf_sptr      d_demod;  /*! PLL, detector and DC removal. */
 };
 
 #endif // RX_DEMOD_AM_H
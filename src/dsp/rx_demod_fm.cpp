@@ -20,19 +20,151 @@
  * the Free Software Foundation, Inc., 51 Franklin Street,
  * Boston, MA 02110-1301, USA.
  */
-#include <gnuradio/filter/firdes.h>
+#include <algorithm>
+#include <cfloat>
+#include <complex>
 #include <gnuradio/io_signature.h>
 #include <iostream>
 #include <math.h>
+#include <volk/volk.h>
 #include <QDebug>
 
 #include "dsp/rx_demod_fm.h"
+#include "dsp/vector_arg.h"
+
+
+fm_discriminator_cf_sptr make_fm_discriminator_cf(float gain)
+{
+    return gnuradio::get_initial_sptr(new fm_discriminator_cf(gain));
+}
+
+fm_discriminator_cf::fm_discriminator_cf(float gain)
+    : gr::sync_block ("fm_discriminator_cf",
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          gr::io_signature::make(1, 1, sizeof(float))),
+      d_gain(gain),
+      d_accuracy(FM_ATAN_ACCURATE),
+      d_deemph(false),
+      d_b0(1.0f),
+      d_b1(0.0f),
+      d_p1(0.0f),
+      d_deemph_x(0.0f),
+      d_deemph_y(0.0f),
+      d_dcr(false),
+      d_dcr_x(0.0f),
+      d_dcr_y(0.0f)
+{
+    // The previous sample for the phase difference of the first
+    set_history(2);
+}
+
+fm_discriminator_cf::~fm_discriminator_cf()
+{
+}
+
+int fm_discriminator_cf::work(int noutput_items,
+                              gr_vector_const_void_star &input_items,
+                              gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *) input_items[0];
+    float *out = (float *) output_items[0];
+
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    if ((int)d_prod.size() < noutput_items)
+        d_prod.resize(noutput_items);
+    volk_32fc_x2_multiply_conjugate_32fc(d_prod.data(), in + 1, in, noutput_items);
+
+    switch (d_accuracy)
+    {
+    case FM_ATAN_FAST:
+        vector_arg<atan_fast>(d_prod.data(), out, noutput_items, d_gain);
+        break;
+    case FM_ATAN_ACCURATE:
+        vector_arg<atan_accurate>(d_prod.data(), out, noutput_items, d_gain);
+        break;
+    default:
+        for (int i = 0; i < noutput_items; i++)
+            out[i] = d_gain * std::arg(d_prod[i]);
+        break;
+    }
+
+    if (!d_deemph && !d_dcr)
+        return noutput_items;
+
+    // De-emphasis then DC removal, in one loop with the state in registers
+    float dx = d_deemph_x, dy = d_deemph_y;
+    float cx = d_dcr_x, cy = d_dcr_y;
+    for (int i = 0; i < noutput_items; i++)
+    {
+        float x = out[i];
+        if (d_deemph)
+        {
+            dy = d_b0 * x + d_b1 * dx + d_p1 * dy;
+            dx = x;
+            x = dy;
+        }
+        if (d_dcr)
+        {
+            cy = x - cx + FM_DCR_POLE * cy;
+            cx = x;
+            x = cy;
+        }
+        out[i] = x;
+    }
+    d_deemph_x = dx;
+    d_deemph_y = dy;
+    d_dcr_x = cx;
+    d_dcr_y = cy;
+
+    return noutput_items;
+}
+
+void fm_discriminator_cf::set_gain(float gain)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    d_gain = gain;
+}
+
+/*! \brief Set the de-emphasis.
+ *  \param rate The sample rate.
+ *  \param tau The time constant, 0.0 for none.
+ */
+void fm_discriminator_cf::set_deemph(double rate, double tau)
+{
+    std::vector<double> fftaps, fbtaps;
+    fm_deemph::iir_taps(rate, tau, fftaps, fbtaps);
+
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    d_deemph = tau > 1.0e-9;
+    d_b0 = fftaps[0];
+    d_b1 = fftaps[1];
+    d_p1 = -fbtaps[1];
+}
+
+void fm_discriminator_cf::set_dcr(bool dcr)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    if (dcr && !d_dcr)
+        d_dcr_x = d_dcr_y = 0.0f;
+    d_dcr = dcr;
+}
+
+void fm_discriminator_cf::set_accuracy(fm_atan accuracy)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    d_accuracy = accuracy;
+}
 
 
 /* Create a new instance of rx_demod_fm and return a shared_ptr. */
-rx_demod_fm_sptr make_rx_demod_fm(float quad_rate, float max_dev, double tau)
+rx_demod_fm_sptr make_rx_demod_fm(float quad_rate, float max_dev, double tau, bool dcr)
 {
-    return gnuradio::get_initial_sptr(new rx_demod_fm(quad_rate, max_dev, tau));
+    return gnuradio::get_initial_sptr(new rx_demod_fm(quad_rate, max_dev, tau, dcr));
 }
 
 static const int MIN_IN = 1;  /* Minimum number of input streams. */
@@ -40,7 +172,7 @@ static const int MAX_IN = 1;  /* Maximum number of input streams. */
 static const int MIN_OUT = 1; /* Minimum number of output streams. */
 static const int MAX_OUT = 1; /* Maximum number of output streams. */
 
-rx_demod_fm::rx_demod_fm(float quad_rate, float max_dev, double tau)
+rx_demod_fm::rx_demod_fm(float quad_rate, float max_dev, double tau, bool dcr)
     : gr::hier_block2 ("rx_demod_fm",
                       gr::io_signature::make (MIN_IN, MAX_IN, sizeof (gr_complex)),
                       gr::io_signature::make (MIN_OUT, MAX_OUT, sizeof (float))),
@@ -54,16 +186,14 @@ rx_demod_fm::rx_demod_fm(float quad_rate, float max_dev, double tau)
 
     qDebug() << "FM demod gain:" << gain;
 
-    /* demodulator */
-    d_quad = gr::analog::quadrature_demod_cf::make(gain);
-
-    /* de-emphasis */
-    d_deemph = make_fm_deemph(d_quad_rate, tau);
+    /* demodulator with de-emphasis and DC removal */
+    d_disc = make_fm_discriminator_cf(gain);
+    d_disc->set_deemph(d_quad_rate, tau);
+    d_disc->set_dcr(dcr);
 
     /* connect block */
-    connect(self(), 0, d_quad, 0);
-    connect(d_quad, 0, d_deemph, 0);
-    connect(d_deemph, 0, self(), 0);
+    connect(self(), 0, d_disc, 0);
+    connect(d_disc, 0, self(), 0);
 
 }
 
@@ -91,7 +221,7 @@ void rx_demod_fm::set_max_dev(float max_dev)
     d_max_dev = max_dev;
 
     gain = d_quad_rate / (2 * (float)M_PI * max_dev);
-    d_quad->set_gain(gain);
+    d_disc->set_gain(gain);
 }
 
 /*! \brief Set FM de-emphasis time constant.
@@ -99,5 +229,17 @@ void rx_demod_fm::set_max_dev(float max_dev)
  */
 void rx_demod_fm::set_tau(double tau)
 {
-    d_deemph->set_tau(tau);
+    d_disc->set_deemph(d_quad_rate, tau);
+}
+
+/*! \brief Enable or disable the removal of DC. */
+void rx_demod_fm::set_dcr(bool dcr)
+{
+    d_disc->set_dcr(dcr);
+}
+
+/*! \brief Set the accuracy of the discriminator. */
+void rx_demod_fm::set_accuracy(fm_discriminator_cf::fm_atan accuracy)
+{
+    d_disc->set_accuracy(accuracy);
 }
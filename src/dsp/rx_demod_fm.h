@@ -22,51 +22,117 @@
  */
 #pragma once
 
-#include <gnuradio/analog/quadrature_demod_cf.h>
+#include <mutex>
 #include <gnuradio/hier_block2.h>
+#include <gnuradio/sync_block.h>
 #include <vector>
 #include "dsp/fm_deemph.h"
 
+/* Pole of the DC removal, as in rx_demod_am */
+#define FM_DCR_POLE 0.999f
+
+class fm_discriminator_cf;
 class rx_demod_fm;
 #if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<fm_discriminator_cf> fm_discriminator_cf_sptr;
 typedef boost::shared_ptr<rx_demod_fm> rx_demod_fm_sptr;
 #else
+typedef std::shared_ptr<fm_discriminator_cf> fm_discriminator_cf_sptr;
 typedef std::shared_ptr<rx_demod_fm> rx_demod_fm_sptr;
 #endif
 
+fm_discriminator_cf_sptr make_fm_discriminator_cf(float gain);
+
+/*! \brief FM discriminator with de-emphasis and DC removal in one pass.
+ *  \ingroup DSP
+ *
+ * The phase differences come from a VOLK conjugate product and a branch
+ * free atan2 that the compiler vectorizes, followed by a single loop for
+ * the de-emphasis and the DC removal, the only recursive parts.
+ *
+ * The atan2 is a polynomial with an error of about 6e-4 rad for
+ * FM_ATAN_FAST and 1e-5 rad for FM_ATAN_ACCURATE, or the one of the C
+ * library for FM_ATAN_EXACT.
+ */
+class fm_discriminator_cf : public gr::sync_block
+{
+    friend fm_discriminator_cf_sptr make_fm_discriminator_cf(float gain);
+
+public:
+    enum fm_atan {
+        FM_ATAN_FAST     = 0,
+        FM_ATAN_ACCURATE = 1,
+        FM_ATAN_EXACT    = 2
+    };
+
+protected:
+    fm_discriminator_cf(float gain);
+
+public:
+    ~fm_discriminator_cf();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    void set_gain(float gain);
+    void set_deemph(double rate, double tau);
+    void set_dcr(bool dcr);
+    void set_accuracy(fm_atan accuracy);
+
+private:
+    std::mutex d_mutex;         /*!< Protects the settings against work(). */
+    float   d_gain;
+    fm_atan d_accuracy;
+    bool    d_deemph;
+    float   d_b0;               /*!< De-emphasis, as in fm_deemph. */
+    float   d_b1;
+    float   d_p1;
+    float   d_deemph_x;         /*!< Last input of the de-emphasis. */
+    float   d_deemph_y;
+    bool    d_dcr;
+    float   d_dcr_x;            /*!< Last input of the DC removal. */
+    float   d_dcr_y;
+    std::vector<gr_complex> d_prod;
+};
+
 /*! \brief Return a shared_ptr to a new instance of rx_demod_fm.
  *  \param quad_rate The input sample rate.
  *  \param max_dev Maximum deviation in Hz
  *  \param tau De-emphasis time constant in seconds (75us in US, 50us in EUR, 0.0 disables).
+ *  \param dcr Enable DC removal.
  *
  * This is effectively the public constructor. To avoid accidental use
  * of raw pointers, rx_demod_fm's constructor is private.
  * make_rx_dmod_fm is the public interface for creating new instances.
  */
-rx_demod_fm_sptr make_rx_demod_fm(float quad_rate, float max_dev=5000.0, double tau=50.0e-6);
+rx_demod_fm_sptr make_rx_demod_fm(float quad_rate, float max_dev=5000.0, double tau=50.0e-6,
+                                  bool dcr=false);
 
 /*! \brief FM demodulator.
  *  \ingroup DSP
  *
- * This class implements the FM demodulator using the gr_quadrature_demod block.
- * It also provides de-emphasis with variable time constant (use 0.0 to disable).
+ * This class implements the FM demodulator using an fm_discriminator_cf.
+ * It also provides de-emphasis with variable time constant (use 0.0 to disable)
+ * and DC removal, which takes away the offset of a carrier that is off
+ * frequency.
  *
  */
 class rx_demod_fm : public gr::hier_block2
 {
 
 public:
-    rx_demod_fm(float quad_rate, float max_dev, double tau); // FIXME: should be private
+    rx_demod_fm(float quad_rate, float max_dev, double tau, bool dcr); // FIXME: should be private
     ~rx_demod_fm();
 
     void set_max_dev(float max_dev);
     void set_tau(double tau);
+    void set_dcr(bool dcr);
+    void set_accuracy(fm_discriminator_cf::fm_atan accuracy);
 
 private:
     /* GR blocks */
-    gr::analog::quadrature_demod_cf::sptr   d_quad;      /*! The quadrature demodulator block. */
-    fm_deemph_sptr                          d_deemph;    /*! De-emphasis IIR filter. */
-    std::vector<float>            d_taps;      /*! Taps for the PFB resampler. */
+    fm_discriminator_cf_sptr    d_disc;     /*! Discriminator, de-emphasis and DCR. */
 
     /* other parameters */
     float       d_quad_rate;     /*! Quadrature rate. */
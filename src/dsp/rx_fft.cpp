@@ -21,14 +21,20 @@
  * Boston, MA 02110-1301, USA.
  */
 #include <math.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 #include <volk/volk.h>
 #include <gnuradio/io_signature.h>
 #include <gnuradio/filter/firdes.h>
 #include <gnuradio/gr_complex.h>
 #include <gnuradio/fft/fft.h>
+#include <pmt/pmt.h>
+#include "dsp/fft_plan_cache.h"
 #include "dsp/rx_fft.h"
+#include "dsp/trace.h"
 #include <algorithm>
-
+#include <iostream>
 
 rx_fft_c_sptr make_rx_fft_c (unsigned int fftsize, double quad_rate,
                              int wintype, bool normalize_energy)
@@ -37,6 +43,103 @@ rx_fft_c_sptr make_rx_fft_c (unsigned int fftsize, double quad_rate,
                                                    wintype, normalize_energy));
 }
 
+/*! \brief Shifted power spectrum.
+ *  \param out Output buffer, \p size elements.
+ *  \param in FFT output, \p size elements.
+ *  \param size The FFT size.
+ *
+ * Computes mag^2 of the FFT output with the DC bin moved to the center.
+ * The shift is folded into the output offsets so that the data is only
+ * traversed once, using the VOLK kernel instead of std::norm().
+ */
+static inline void shifted_power(float *out, const gr_complex *in, unsigned int size)
+{
+    const unsigned int half = size / 2;
+
+    volk_32fc_magnitude_squared_32f(out, in + half, size - half);
+    volk_32fc_magnitude_squared_32f(out + (size - half), in, half);
+}
+
+/* Largest difference between sample count and system clock before the
+ * sample time is re-anchored, in seconds. Only used without rx_time tags. */
+#define FFT_TIME_MAX_DRIFT 0.25
+
+/* Smallest circular buffer, in samples */
+#define FFT_RING_MIN_SIZE 4096
+
+/*! \brief Circular sample buffer of rx_fft_c.
+ *
+ * The size is a power of two. Long history buffers are allocated with
+ * mmap() so that pages are only committed once the writer reaches them.
+ */
+struct rx_fft_ring
+{
+    gr_complex *data;
+    uint64_t    size;
+    bool        mapped;
+};
+
+static rx_fft_ring *alloc_ring(uint64_t size, bool use_mmap)
+{
+    rx_fft_ring *ring = new rx_fft_ring;
+    ring->size = size;
+    ring->mapped = false;
+    ring->data = nullptr;
+
+#ifndef _WIN32
+    if (use_mmap)
+    {
+        void *p = mmap(nullptr, size * sizeof(gr_complex), PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS
+#ifdef MAP_NORESERVE
+                       | MAP_NORESERVE
+#endif
+                       , -1, 0);
+        if (p != MAP_FAILED)
+        {
+            ring->data = (gr_complex *)p;
+            ring->mapped = true;
+        }
+    }
+#else
+    (void) use_mmap;
+#endif
+
+    if (!ring->data)
+        ring->data = new gr_complex[size]();
+
+    return ring;
+}
+
+static void free_ring(rx_fft_ring *ring)
+{
+    if (!ring)
+        return;
+
+#ifndef _WIN32
+    if (ring->mapped)
+        munmap(ring->data, ring->size * sizeof(gr_complex));
+    else
+#endif
+        delete[] ring->data;
+
+    delete ring;
+}
+
+static uint64_t next_pow2(uint64_t n)
+{
+    uint64_t p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+/* Number of attempts to copy a snapshot before giving up */
+#define FFT_MAX_READ_ATTEMPTS 4
+
+/* Flag set in d_stream_middle while it holds a frame not yet collected */
+#define STREAM_SLOT_FRESH 0x4
+
 /*! \brief Create receiver FFT object.
  *  \param fftsize The FFT size.
  *  \param wintype The window type (see gr::fft::window::win_type).
@@ -48,39 +151,80 @@ rx_fft_c::rx_fft_c(unsigned int fftsize, double quad_rate, int wintype, bool nor
           gr::io_signature::make(1, 1, sizeof(gr_complex)),
           gr::io_signature::make(0, 0, 0)),
       d_fftsize(fftsize),
-      d_startup_samples(0),
       d_quadrate(quad_rate),
       d_wintype(-1),
-      d_normalize_energy(false)
+      d_normalize_energy(false),
+      d_fft_threads(1),
+      d_estimator(ESTIMATOR_PERIODOGRAM),
+      d_estimator_param(1),
+      d_ring(nullptr),
+      d_ring_epoch(0),
+      d_ring_valid(0),
+      d_history(0.0),
+      d_ring_mem(MEM_FFT_SAMPLES),
+      d_ring_claimed(0),
+      d_ring_written(0),
+      d_read_end(0),
+      d_read_retries(0),
+      d_spectrum_end(0),
+      d_time_index(0),
+      d_time_anchor(0.0),
+      d_time_valid(false),
+      d_time_from_source(false),
+      d_time_restart(false),
+      d_drop_events(0),
+      d_drop_samples(0),
+      d_tune_epoch(0),
+      d_tune_index(0),
+      d_tune_freq(0.0),
+      d_tune_count(0),
+      d_worker_request(false),
+      d_worker_quit(false),
+      d_worker_valid(false),
+      d_worker_frame_end(0),
+      d_worker_result_end(0),
+      d_streaming(false),
+      d_stream_overlap(0.5f),
+      d_stream_reduce(STREAM_REDUCE_AVG),
+      d_stream_hop(fftsize / 2),
+      d_stream_fill(0),
+      d_stream_fft(nullptr),
+      d_gpu_enabled(false),
+      d_stream_slot_frames{0, 0, 0},
+      d_stream_slot_end{0, 0, 0},
+      d_stream_back(0),
+      d_stream_front(1),
+      d_stream_middle(2),
+      d_stream_request(true)
 {
 
     /* create FFT object */
-#if GNURADIO_VERSION < 0x030900
-    d_fft = new gr::fft::fft_complex(d_fftsize, true);
-#else
-    d_fft = new gr::fft::fft_complex_fwd(d_fftsize);
-#endif
-
-    /* allocate circular buffer */
-#if GNURADIO_VERSION < 0x031000
-    d_writer = gr::make_buffer(MAX_FFT_SIZE * 2, sizeof(gr_complex));
-#else
-    d_writer = gr::make_buffer(MAX_FFT_SIZE * 2, sizeof(gr_complex), 1, 1);
-#endif
-    d_reader = gr::buffer_add_reader(d_writer, 0);
-
-    memset(d_writer->write_pointer(), 0, sizeof(gr_complex) * MAX_FFT_SIZE);
-    d_writer->update_write_pointer(MAX_FFT_SIZE);
+    d_fft = fft_plan_cache::acquire(d_fftsize, d_fft_threads);
 
     /* create FFT window */
     set_window_type(wintype, normalize_energy);
 
+    /* allocate circular buffer */
+    update_ring();
+
     d_lasttime = std::chrono::steady_clock::now();
 }
 
 rx_fft_c::~rx_fft_c()
 {
-    delete d_fft;
+    if (d_worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(d_worker_mutex);
+            d_worker_quit = true;
+        }
+        d_worker_cond.notify_one();
+        d_worker.join();
+    }
+
+    fft_plan_cache::release(d_fft, d_fftsize, d_fft_threads);
+    fft_plan_cache::release(d_stream_fft, d_fftsize, d_fft_threads);
+    free_ring(d_ring.load());
 }
 
 /*! \brief Receiver FFT work method.
@@ -88,93 +232,682 @@ rx_fft_c::~rx_fft_c()
  *  \param input_items
  *  \param output_items
  *
- * This method does nothing except throwing the incoming samples into the
- * circular buffer.
- * FFT is only executed when the GUI asks for new FFT data via get_fft_data().
+ * This method throws the incoming samples into the circular buffer.
+ * Unless streaming mode is enabled, FFT is only executed when the GUI asks
+ * for new FFT data via get_fft_data().
+ *
+ * No lock is taken here except the streaming and time mutexes, and those
+ * only with try_lock(): if the GUI is reconfiguring the stream the samples
+ * are simply not streamed.
+ *
+ * The sample counter advances by every input item, also those that do not
+ * fit in the circular buffer, so that frame indices stay sample accurate.
  */
 int rx_fft_c::work(int noutput_items,
                    gr_vector_const_void_star &input_items,
                    gr_vector_void_star &output_items)
 {
+    TRACE_SCOPE("dsp", "rx_fft_c::work");
     const gr_complex *in = (const gr_complex*)input_items[0];
     (void) output_items;
 
+    /* odd epoch tells update_ring() that we may be using the old buffer */
+    d_ring_epoch.fetch_add(1);
+    rx_fft_ring *ring = d_ring.load();
+
     /* just throw new samples into the buffer */
-    int items_to_copy = std::min(noutput_items, (int)d_writer->bufsize());
-    if (items_to_copy < noutput_items)
+    uint64_t items_to_copy = std::min((uint64_t)noutput_items, ring->size);
+    if (items_to_copy < (uint64_t)noutput_items)
         in += (noutput_items - items_to_copy);
 
-    {
-        std::lock_guard<std::mutex> lock(d_in_mutex);
+    const uint64_t written = d_ring_written.load(std::memory_order_relaxed);
+    const uint64_t base = written + (noutput_items - items_to_copy);
+    const uint64_t pos = base & (ring->size - 1);
+    const uint64_t n1 = std::min(items_to_copy, ring->size - pos);
 
-        if (d_writer->space_available() < items_to_copy)
-            d_reader->update_read_pointer(items_to_copy - d_writer->space_available());
-        memcpy(d_writer->write_pointer(), in, sizeof(gr_complex) * items_to_copy);
-        d_writer->update_write_pointer(items_to_copy);
+    /* announce the range we are about to overwrite before touching it */
+    d_ring_claimed.store(base + items_to_copy, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
 
-        if (d_startup_samples < d_writer->bufsize())
-            d_startup_samples += items_to_copy;
+    memcpy(&ring->data[pos], in, sizeof(gr_complex) * n1);
+    if (n1 < items_to_copy)
+        memcpy(&ring->data[0], in + n1, sizeof(gr_complex) * (items_to_copy - n1));
+
+    d_ring_written.store(base + items_to_copy, std::memory_order_release);
+    d_ring_epoch.fetch_add(1);
+
+    update_time(written, noutput_items);
+    update_tune(written, noutput_items);
+
+    if (d_streaming.load(std::memory_order_relaxed))
+    {
+        std::unique_lock<std::mutex> lock(d_stream_mutex, std::try_to_lock);
+        if (lock.owns_lock() && d_streaming)
+            stream_samples((const gr_complex*)input_items[0], noutput_items, written);
     }
 
     return noutput_items;
 }
 
+/*! \brief Update the time of the sample clock.
+ *  \param index Sample index of the first new item.
+ *  \param nitems Number of new items.
+ *
+ * An rx_time tag from the source sets the time of the tagged sample. Without
+ * such tags the first sample is anchored to the system clock, and the
+ * anchor is only moved when the sample count drifts more than
+ * FFT_TIME_MAX_DRIFT from it, e.g. after overruns.
+ *
+ * Time that passed without samples is counted as a gap: the difference of
+ * an rx_time tag to the time predicted from the previous one, which sources
+ * send after an overflow, or a sample count behind the system clock by more
+ * than FFT_TIME_MAX_DRIFT. The pause while the flow graph is stopped is not
+ * a gap.
+ */
+void rx_fft_c::update_time(uint64_t index, int nitems)
+{
+    std::unique_lock<std::mutex> lock(d_time_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+
+    const uint64_t nread = nitems_read(0);
+    get_tags_in_range(d_time_tags, 0, nread, nread + nitems, pmt::intern("rx_time"));
+    for (auto it = d_time_tags.begin(); it != d_time_tags.end(); ++it)
+    {
+        const pmt::pmt_t &value = it->value;
+        if (pmt::is_tuple(value) && pmt::length(value) == 2)
+        {
+            const uint64_t tag_index = index + (it->offset - nread);
+            const double tag_time = (double)pmt::to_uint64(pmt::tuple_ref(value, 0)) +
+                                    pmt::to_double(pmt::tuple_ref(value, 1));
+            if (d_time_from_source && d_time_valid && !d_time_restart && d_quadrate > 0.0)
+            {
+                const double predicted = d_time_anchor +
+                                         ((double)tag_index - (double)d_time_index) / d_quadrate;
+                count_drop(tag_time - predicted);
+            }
+            d_time_index = tag_index;
+            d_time_anchor = tag_time;
+            d_time_valid = true;
+            d_time_from_source = true;
+            d_time_restart = false;
+        }
+    }
+
+    if (d_time_from_source || d_quadrate <= 0.0)
+        return;
+
+    const double now = std::chrono::duration<double>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    const uint64_t end = index + nitems;
+    const double predicted = d_time_anchor + (double)(end - d_time_index) / d_quadrate;
+
+    if (!d_time_valid || d_time_restart || std::fabs(predicted - now) > FFT_TIME_MAX_DRIFT)
+    {
+        if (d_time_valid && !d_time_restart)
+            count_drop(now - predicted);
+        d_time_restart = false;
+        d_time_index = end;
+        d_time_anchor = now;
+        d_time_valid = true;
+    }
+}
+
+/*! \brief Count a gap of the given seconds, if it is at least a sample. */
+void rx_fft_c::count_drop(double seconds)
+{
+    const double samples = std::round(seconds * d_quadrate);
+    if (samples < 1.0)
+        return;
+
+    d_drop_events.fetch_add(1, std::memory_order_relaxed);
+    d_drop_samples.fetch_add((uint64_t)samples, std::memory_order_relaxed);
+}
+
+/*! \brief The flow graph was started or restarted. */
+bool rx_fft_c::start()
+{
+    std::lock_guard<std::mutex> lock(d_time_mutex);
+    d_time_restart = true;
+    return gr::sync_block::start();
+}
+
+/*! \brief Record the last rx_freq tag of new items.
+ *  \param index Sample index of the first new item.
+ *  \param nitems Number of new items.
+ */
+void rx_fft_c::update_tune(uint64_t index, int nitems)
+{
+    const uint64_t nread = nitems_read(0);
+    get_tags_in_range(d_tune_tags, 0, nread, nread + nitems, pmt::intern("rx_freq"));
+    if (d_tune_tags.empty())
+        return;
+
+    const gr::tag_t &tag = d_tune_tags.back();
+    if (!pmt::is_number(tag.value))
+        return;
+
+    d_tune_epoch.fetch_add(1, std::memory_order_acq_rel);
+    d_tune_index.store(index + (tag.offset - nread), std::memory_order_relaxed);
+    d_tune_freq.store(pmt::to_double(tag.value), std::memory_order_relaxed);
+    d_tune_count.fetch_add((unsigned int)d_tune_tags.size(), std::memory_order_relaxed);
+    d_tune_epoch.fetch_add(1, std::memory_order_release);
+}
+
+/*! \brief Get the last retune reported by the source.
+ *  \param sample_index First sample at the new frequency (output).
+ *  \param freq The new frequency from the tag (output).
+ *  \param count Number of retune tags seen so far (output). A retune has
+ *               been reported when it changes.
+ *  \returns false if the source has not sent any rx_freq tag.
+ */
+bool rx_fft_c::get_retune(uint64_t &sample_index, double &freq, unsigned int &count)
+{
+    unsigned int epoch;
+    do
+    {
+        epoch = d_tune_epoch.load(std::memory_order_acquire);
+        sample_index = d_tune_index.load(std::memory_order_relaxed);
+        freq = d_tune_freq.load(std::memory_order_relaxed);
+        count = d_tune_count.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((epoch & 1) || epoch != d_tune_epoch.load(std::memory_order_relaxed));
+
+    return count > 0;
+}
+
+/*! \brief Get the wall-clock time of a sample.
+ *  \param sample_index Absolute sample index, as returned by get_fft_data().
+ *  \returns Unix time in seconds, or 0.0 if no samples have been received.
+ */
+double rx_fft_c::sample_time(uint64_t sample_index)
+{
+    std::lock_guard<std::mutex> lock(d_time_mutex);
+
+    if (!d_time_valid || d_quadrate <= 0.0)
+        return 0.0;
+
+    return d_time_anchor + ((double)sample_index - (double)d_time_index) / d_quadrate;
+}
+
+/*! \brief Compute streamed FFT frames.
+ *  \param in The new input samples.
+ *  \param nitems The number of samples in \p in.
+ *  \param index Sample index of in[0].
+ *
+ * Samples are collected in a sliding window of fftsize samples. Every time
+ * the window is full, a windowed FFT is executed and its shifted power
+ * spectrum is folded into the back slot of the triple buffer. The window
+ * then slides forward by d_stream_hop samples. When get_fft_data() has asked
+ * for a frame, the back slot is swapped with the middle slot.
+ *
+ * The caller must hold d_stream_mutex.
+ */
+void rx_fft_c::stream_samples(const gr_complex *in, int nitems, uint64_t index)
+{
+    while (nitems > 0)
+    {
+        unsigned int n = std::min((unsigned int)nitems, d_fftsize - d_stream_fill);
+        memcpy(&d_stream_buf[d_stream_fill], in, sizeof(gr_complex) * n);
+        d_stream_fill += n;
+        in += n;
+        nitems -= n;
+        index += n;
+
+        if (d_stream_fill < d_fftsize)
+            break;
+
+        if (d_stream_gpu && !d_stream_gpu->add_frame(d_stream_buf.data()))
+        {
+            std::cerr << "rx_fft_c: OpenCL FFT failed, streaming on the CPU" << std::endl;
+            d_stream_gpu.reset();
+        }
+
+        if (!d_stream_gpu)
+        {
+            if (!d_stream_fft)
+                d_stream_fft = fft_plan_cache::acquire(d_fftsize, d_fft_threads);
+            volk_32fc_32f_multiply_32fc(d_stream_fft->get_inbuf(), d_stream_buf.data(),
+                                        d_window.data(), d_fftsize);
+            d_stream_fft->execute();
+
+            float *acc = d_stream_slot[d_stream_back].data();
+
+            // Shifted mag^2(FFT), reduced into the accumulator
+            shifted_power(d_stream_pwr.data(), d_stream_fft->get_outbuf(), d_fftsize);
+            if (d_stream_reduce == STREAM_REDUCE_MAX)
+                volk_32f_x2_max_32f(acc, acc, d_stream_pwr.data(), d_fftsize);
+            else
+                volk_32f_x2_add_32f(acc, acc, d_stream_pwr.data(), d_fftsize);
+            d_stream_slot_frames[d_stream_back]++;
+        }
+        d_stream_slot_end[d_stream_back] = index;
+
+        /* hand the reduced frame over if the reader is waiting for one */
+        if (d_stream_request.exchange(false, std::memory_order_acq_rel))
+        {
+            if (d_stream_gpu)
+            {
+                // The device has reduced the frames since the last hand-over
+                const int frames = d_stream_gpu->read(d_stream_slot[d_stream_back].data());
+                d_stream_slot_frames[d_stream_back] = std::max(0, frames);
+                if (frames < 0)
+                {
+                    std::cerr << "rx_fft_c: OpenCL FFT failed, streaming on the CPU" << std::endl;
+                    d_stream_gpu.reset();
+                }
+            }
+            int old = d_stream_middle.exchange(d_stream_back | STREAM_SLOT_FRESH,
+                                               std::memory_order_acq_rel);
+            d_stream_back = old & ~STREAM_SLOT_FRESH;
+            std::fill(d_stream_slot[d_stream_back].begin(),
+                      d_stream_slot[d_stream_back].end(), 0.0f);
+            d_stream_slot_frames[d_stream_back] = 0;
+        }
+
+        /* slide the window */
+        d_stream_fill = d_fftsize - d_stream_hop;
+        memmove(d_stream_buf.data(), &d_stream_buf[d_stream_hop],
+                sizeof(gr_complex) * d_stream_fill);
+    }
+}
+
 /*! \brief Get FFT data.
  *  \param fftPoints Buffer to copy FFT data
- *  \param fftSize Current FFT size (output).
  */
 int rx_fft_c::get_fft_data(float* fftPoints)
+{
+    uint64_t sample_index;
+    double timestamp;
+
+    return get_fft_data(fftPoints, sample_index, timestamp);
+}
+
+/*! \brief Get FFT data with its position in the input stream.
+ *  \param fftPoints Buffer to copy FFT data
+ *  \param sample_index Index of the sample after the last one in the frame (output).
+ *  \param timestamp Unix time of sample_index, see sample_time() (output).
+ *
+ * In streaming mode this returns the reduction of all frames computed
+ * since the previous hand-over, or -1 if no new frame is available yet.
+ *
+ * For large FFT sizes the snapshot is computed by the worker thread and this
+ * returns the last completed frame, or -1 if none is ready.
+ */
+int rx_fft_c::get_fft_data(float* fftPoints, uint64_t &sample_index, double &timestamp)
+{
+    TRACE_SCOPE("dsp", "rx_fft_c::get_fft_data");
+    int ret = -1;
+
+    if (d_streaming)
+    {
+        std::lock_guard<std::mutex> lock(d_fft_mutex);
+        bool fresh = false;
+
+        if (d_stream_middle.load(std::memory_order_acquire) & STREAM_SLOT_FRESH)
+        {
+            int old = d_stream_middle.exchange(d_stream_front, std::memory_order_acq_rel);
+            d_stream_front = old & ~STREAM_SLOT_FRESH;
+            fresh = true;
+        }
+        d_stream_request.store(true, std::memory_order_release);
+
+        const unsigned int frames = d_stream_slot_frames[d_stream_front];
+        const std::vector<float> &slot = d_stream_slot[d_stream_front];
+        if (!fresh || frames == 0 || slot.size() != d_fftsize)
+            return -1;
+
+        if (d_stream_reduce == STREAM_REDUCE_MAX)
+            memcpy(fftPoints, slot.data(), sizeof(float) * d_fftsize);
+        else
+            volk_32f_s32f_multiply_32f(fftPoints, slot.data(),
+                                       1.0f / (float)frames, d_fftsize);
+
+        sample_index = d_stream_slot_end[d_stream_front];
+        ret = 0;
+    }
+    else if (d_fftsize < FFT_WORKER_MIN_SIZE)
+    {
+        std::lock_guard<std::mutex> lock(d_fft_mutex);
+        ret = compute_snapshot(fftPoints);
+        sample_index = d_spectrum_end;
+    }
+    else
+    {
+        {
+            std::lock_guard<std::mutex> lock(d_worker_mutex);
+
+            if (d_worker_valid && d_worker_result.size() == d_fftsize)
+            {
+                memcpy(fftPoints, d_worker_result.data(), sizeof(float) * d_fftsize);
+                sample_index = d_worker_result_end;
+                d_worker_valid = false;
+                ret = 0;
+            }
+            d_worker_request = true;
+        }
+
+        if (!d_worker.joinable())
+            d_worker = std::thread(&rx_fft_c::worker_loop, this);
+        d_worker_cond.notify_one();
+    }
+
+    if (ret == 0)
+        timestamp = sample_time(sample_index);
+
+    return ret;
+}
+
+/*! \brief Snapshot worker thread.
+ *
+ * Waits for get_fft_data() to request a frame, computes it into
+ * d_worker_frame and publishes it as d_worker_result.
+ */
+void rx_fft_c::worker_loop()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(d_worker_mutex);
+            d_worker_cond.wait(lock, [this] { return d_worker_request || d_worker_quit; });
+            if (d_worker_quit)
+                return;
+            d_worker_request = false;
+        }
+
+        int ret;
+        {
+            std::lock_guard<std::mutex> lock(d_fft_mutex);
+            d_worker_frame.resize(d_fftsize);
+            ret = compute_snapshot(d_worker_frame.data());
+            d_worker_frame_end = d_spectrum_end;
+        }
+
+        if (ret == 0)
+        {
+            std::lock_guard<std::mutex> lock(d_worker_mutex);
+            d_worker_result.swap(d_worker_frame);
+            std::swap(d_worker_result_end, d_worker_frame_end);
+            d_worker_valid = true;
+        }
+    }
+}
+
+/*! \brief Compute a spectrum snapshot on the circular buffer.
+ *  \param fftPoints Buffer to copy the shifted power spectrum to.
+ *
+ * The snapshot end advances at the sample rate so that bursty sources still
+ * produce a smooth display, but it never lags the writer by more than half
+ * the circular buffer. The samples are copied without holding any lock; if
+ * work() claimed part of them while we were copying, the copy is retried.
+ *
+ * Depending on the estimator the snapshot covers one FFT length, several
+ * overlapped Welch segments or the full PFB prototype filter length.
+ *
+ * The caller must hold d_fft_mutex.
+ */
+int rx_fft_c::compute_snapshot(float* fftPoints)
 {
     std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
     std::chrono::duration<double> diff = now - d_lasttime;
-    diff = std::min(diff, std::chrono::duration<double>(d_writer->bufsize() / d_quadrate));
+    diff = std::min(diff, std::chrono::duration<double>(MAX_FFT_SIZE * 2 / d_quadrate));
     d_lasttime = now;
 
-    {
-        std::lock_guard<std::mutex> lock(d_in_mutex);
+    update_ring();
 
-        d_reader->update_read_pointer(std::min((int)(diff.count() * d_quadrate * 1.001), d_reader->items_available() - MAX_FFT_SIZE));
+    const uint64_t advance = (uint64_t)(diff.count() * d_quadrate * 1.001);
+    return compute_spectrum(fftPoints, true, advance);
+}
+
+/*! \brief Compute the spectrum of a part of the circular buffer.
+ *  \param fftPoints Buffer to copy the shifted power spectrum to.
+ *  \param live Follow the writer (true) or look back into the history.
+ *  \param offset Samples to advance since the last live snapshot, or the
+ *                number of samples to look back from the writer.
+ *
+ * The caller must hold d_fft_mutex.
+ */
+int rx_fft_c::compute_spectrum(float* fftPoints, bool live, uint64_t offset)
+{
+    const rx_fft_ring *ring = d_ring.load(std::memory_order_relaxed);
+    const unsigned int span = snapshot_span();
+    /* leave room for the writer to advance while a history frame is copied */
+    const uint64_t max_lag = live ? ring->size / 2 : ring->size - span - ring->size / 8;
+    const unsigned int count = estimator_count();
+    const unsigned int hop = d_fftsize / 2;
+    bool copied = false;
+
+    for (int attempt = 0; attempt < FFT_MAX_READ_ATTEMPTS; attempt++)
+    {
+        const uint64_t written = d_ring_written.load(std::memory_order_acquire);
 
-        if (d_startup_samples < d_reader->items_available() - (MAX_FFT_SIZE - d_fftsize))
+        if (written < d_ring_valid + span)
             return -1;
 
-        apply_window(d_fftsize);
+        uint64_t end;
+        if (live)
+            end = std::min(d_read_end + offset, written);
+        else
+            end = written - std::min(offset, written);
+        if (written - end > max_lag)
+            end = written - max_lag;
+        end = std::max(end, d_ring_valid + span);
+
+        const uint64_t start = end - span;
+
+        if (d_estimator == ESTIMATOR_WELCH)
+        {
+            // Average the power of 50% overlapped segments
+            for (unsigned int k = 0; k < count; k++)
+            {
+                apply_window(start + (uint64_t)k * hop);
+                d_fft->execute();
+                if (k == 0)
+                {
+                    shifted_power(fftPoints, d_fft->get_outbuf(), d_fftsize);
+                }
+                else
+                {
+                    shifted_power(d_welch_pwr.data(), d_fft->get_outbuf(), d_fftsize);
+                    volk_32f_x2_add_32f(fftPoints, fftPoints, d_welch_pwr.data(), d_fftsize);
+                }
+            }
+        }
+        else if (d_estimator == ESTIMATOR_PFB)
+        {
+            apply_pfb(start);
+        }
+        else
+        {
+            apply_window(start);
+        }
+
+        /* verify that the writer did not wrap into what we just copied */
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (d_ring_claimed.load(std::memory_order_relaxed) <= start + ring->size)
+        {
+            if (live)
+                d_read_end = end;
+            d_spectrum_end = end;
+            copied = true;
+            break;
+        }
+        d_read_retries.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (!copied)
+        return -1;
+
+    if (d_estimator == ESTIMATOR_WELCH)
+    {
+        if (count > 1)
+            volk_32f_s32f_multiply_32f(fftPoints, fftPoints, 1.0f / (float)count, d_fftsize);
+        return 0;
     }
 
     /* compute FFT */
     d_fft->execute();
 
-    const std::complex<float> *fftOut = d_fft->get_outbuf();
-
     // Shifted mag^2(FFT)
-    for (unsigned int i = 0; i < d_fftsize/2; ++i)
-        fftPoints[i] = static_cast<float>(std::norm(fftOut[i + d_fftsize/2]));
-    for (unsigned int i = d_fftsize/2; i < d_fftsize; ++i)
-        fftPoints[i] = static_cast<float>(std::norm(fftOut[i - d_fftsize/2]));
+    shifted_power(fftPoints, d_fft->get_outbuf(), d_fftsize);
 
     return 0;
 }
 
-/*! \brief Compute FFT on the available input data.
- *  \param data_in The data to compute FFT on.
- *  \param size The size of data_in.
+/*! \brief Multiply samples from the circular buffer with a set of taps.
+ *  \param dst Output buffer, \p n elements.
+ *  \param start Absolute index of the first sample.
+ *  \param taps Window or filter taps, \p n elements.
+ *  \param n Number of samples.
  *
- * Note that this function does not lock the mutex since the caller, get_fft_data()
- * has already locked it.
+ * The range may wrap around the end of the circular buffer, in which case
+ * it is copied in two parts.
  */
-void rx_fft_c::apply_window(unsigned int size)
+void rx_fft_c::window_segment(gr_complex *dst, uint64_t start, const float *taps, unsigned int n)
 {
-    /* apply window, if any */
-    gr_complex * p = (gr_complex *)d_reader->read_pointer();
-    p += (MAX_FFT_SIZE - d_fftsize);
-    if (d_window.size())
+    const rx_fft_ring *ring = d_ring.load(std::memory_order_relaxed);
+    const unsigned int pos = start & (ring->size - 1);
+    const unsigned int n1 = std::min((uint64_t)n, ring->size - pos);
+
+    volk_32fc_32f_multiply_32fc(dst, &ring->data[pos], taps, n1);
+    if (n1 < n)
+        volk_32fc_32f_multiply_32fc(dst + n1, &ring->data[0], taps + n1, n - n1);
+}
+
+/*! \brief Copy windowed samples from the circular buffer to the FFT input.
+ *  \param start Absolute index of the first sample of the window.
+ */
+void rx_fft_c::apply_window(uint64_t start)
+{
+    window_segment(d_fft->get_inbuf(), start, d_window.data(), d_fftsize);
+}
+
+/*! \brief Fill the FFT input with the polyphase filterbank front end.
+ *  \param start Absolute index of the first sample of the filter span.
+ *
+ * Each of the estimator_count() consecutive fftsize blocks is weighted with
+ * its part of the prototype filter and the blocks are summed, so that the
+ * following FFT yields the channelized spectrum.
+ */
+void rx_fft_c::apply_pfb(uint64_t start)
+{
+    const unsigned int taps = estimator_count();
+    gr_complex *dst = d_fft->get_inbuf();
+
+    window_segment(dst, start, d_pfb_taps.data(), d_fftsize);
+    for (unsigned int t = 1; t < taps; t++)
     {
-        gr_complex *dst = d_fft->get_inbuf();
-        volk_32fc_32f_multiply_32fc(dst, p, &d_window[0], size);
+        window_segment(d_pfb_seg.data(), start + (uint64_t)t * d_fftsize,
+                       &d_pfb_taps[t * d_fftsize], d_fftsize);
+        volk_32f_x2_add_32f((float *)dst, (const float *)dst,
+                            (const float *)d_pfb_seg.data(), 2 * d_fftsize);
     }
-    else
+}
+
+/*! \brief Number of Welch segments or PFB taps that fit in the buffer.
+ *
+ * Snapshots may reach at most half the circular buffer back, which limits
+ * the estimator parameter at large FFT sizes.
+ */
+unsigned int rx_fft_c::estimator_count() const
+{
+    const unsigned int max_span = MAX_FFT_SIZE;
+
+    switch (d_estimator)
     {
-        memcpy(d_fft->get_inbuf(), p, sizeof(gr_complex)*size);
+    case ESTIMATOR_WELCH:
+        return std::max(1u, std::min(d_estimator_param,
+                                     (max_span - d_fftsize) / (d_fftsize / 2) + 1));
+    case ESTIMATOR_PFB:
+        return std::max(1u, std::min(d_estimator_param, max_span / d_fftsize));
+    default:
+        return 1;
+    }
+}
+
+/*! \brief Resize the circular buffer if the settings need another size.
+ *
+ * The buffer holds twice the snapshot span, or the requested history if
+ * that is longer. work() keeps writing without a lock: the new buffer is
+ * published first, and the old one is freed once work() is known not to
+ * be using it any more. Samples in the old buffer are not carried over.
+ *
+ * The caller must hold d_fft_mutex.
+ */
+void rx_fft_c::update_ring()
+{
+    const uint64_t span_size = next_pow2(std::max((uint64_t)FFT_RING_MIN_SIZE, 2 * (uint64_t)snapshot_span()));
+    const uint64_t history = (uint64_t)(d_history * d_quadrate);
+    const bool long_history = history > span_size;
+    uint64_t size = span_size;
+
+    if (long_history)
+    {
+        size = next_pow2(std::min(history, (uint64_t)MAX_HISTORY_SAMPLES));
+
+        /* shorter history under the cap of MEM_FFT_SAMPLES, never below the span */
+        const int64_t sample_bytes = (int64_t)sizeof(gr_complex);
+        while (size > span_size && d_ring_mem.allowed((int64_t)size * sample_bytes) < (int64_t)size * sample_bytes)
+            size /= 2;
+    }
+
+    rx_fft_ring *old = d_ring.load();
+    if (old && old->size == size)
+        return;
+
+    d_ring.store(alloc_ring(size, long_history));
+
+    /* wait until work() is done with the block it may have started before */
+    const unsigned int epoch = d_ring_epoch.load();
+    if (epoch & 1)
+        while (d_ring_epoch.load() == epoch)
+            std::this_thread::yield();
+
+    d_ring_valid = d_ring_written.load(std::memory_order_acquire);
+    free_ring(old);
+    d_ring_mem.set((int64_t)size * sizeof(gr_complex));
+}
+
+/*! \brief Keep a history of the input for retrospective spectra.
+ *  \param seconds History length in seconds, 0 for none.
+ *
+ * Long histories use a memory-mapped buffer of up to MAX_HISTORY_SAMPLES
+ * samples, fewer under the cap of MEM_FFT_SAMPLES. The buffer is resized
+ * at the next snapshot.
+ */
+void rx_fft_c::set_history(double seconds)
+{
+    std::lock_guard<std::mutex> lock(d_fft_mutex);
+    d_history = std::max(0.0, seconds);
+}
+
+/*! \brief Compute the spectrum of the input some time ago.
+ *  \param fftPoints Buffer to copy the shifted power spectrum to.
+ *  \param age How far to look back, in seconds.
+ *  \returns 0 on success, -1 if the history does not reach back that far.
+ *
+ * Uses the current FFT size and estimator. The result is clamped to the
+ * oldest data still in the buffer.
+ */
+int rx_fft_c::get_history_fft_data(float* fftPoints, double age)
+{
+    std::lock_guard<std::mutex> lock(d_fft_mutex);
+
+    update_ring();
+    return compute_spectrum(fftPoints, false, (uint64_t)(std::max(0.0, age) * d_quadrate));
+}
+
+/*! \brief Number of samples used by one snapshot. */
+unsigned int rx_fft_c::snapshot_span() const
+{
+    switch (d_estimator)
+    {
+    case ESTIMATOR_WELCH:
+        return d_fftsize + (estimator_count() - 1) * (d_fftsize / 2);
+    case ESTIMATOR_PFB:
+        return estimator_count() * d_fftsize;
+    default:
+        return d_fftsize;
     }
 }
 
@@ -183,23 +916,83 @@ void rx_fft_c::set_fft_size(unsigned int fftsize)
 {
     if (fftsize != d_fftsize)
     {
-        d_fftsize = fftsize;
+        std::lock_guard<std::mutex> fft_lock(d_fft_mutex);
+        std::lock_guard<std::mutex> lock(d_stream_mutex);
 
-        /* reset FFT object (also reset FFTW plan) */
-        delete d_fft;
-#if GNURADIO_VERSION < 0x030900
-        d_fft = new gr::fft::fft_complex(d_fftsize, true);
-#else
-        d_fft = new gr::fft::fft_complex_fwd(d_fftsize);
-#endif
+        /* swap FFT objects, the pool avoids replanning known sizes */
+        release_ffts();
+        d_fftsize = fftsize;
+        d_fft = fft_plan_cache::acquire(d_fftsize, d_fft_threads);
 
         update_window();
+        reset_stream();
     }
 }
 
+/*! \brief Set the number of threads used by FFTW.
+ *  \param nthreads The number of threads, 1 to MAX_FFT_THREADS.
+ *
+ * Threaded plans only pay off for very large FFTs; at small sizes the
+ * synchronization overhead dominates.
+ */
+void rx_fft_c::set_fft_threads(int nthreads)
+{
+    nthreads = std::max(1, std::min(nthreads, MAX_FFT_THREADS));
+    if (nthreads == d_fft_threads)
+        return;
+
+    std::lock_guard<std::mutex> fft_lock(d_fft_mutex);
+    std::lock_guard<std::mutex> lock(d_stream_mutex);
+
+    release_ffts();
+    d_fft_threads = nthreads;
+    d_fft = fft_plan_cache::acquire(d_fftsize, d_fft_threads);
+    reset_stream();
+}
+
+/*! \brief Compute the streamed frames on an OpenCL device.
+ *
+ * Only has an effect in builds with -DENABLE_OPENCL_FFT=ON and with a usable
+ * device; otherwise, and if the device fails later, the frames stay on the
+ * CPU. Snapshots are always computed on the CPU.
+ */
+void rx_fft_c::set_gpu(bool enable)
+{
+    if (enable == d_gpu_enabled)
+        return;
+
+    std::lock_guard<std::mutex> fft_lock(d_fft_mutex);
+    std::lock_guard<std::mutex> lock(d_stream_mutex);
+
+    d_gpu_enabled = enable;
+    reset_stream();
+}
+
+/*! rief Give both FFT objects back to the plan cache.
+ *
+ * Must be called before d_fftsize or d_fft_threads change, with both
+ * d_fft_mutex and d_stream_mutex held.
+ */
+void rx_fft_c::release_ffts()
+{
+    fft_plan_cache::release(d_fft, d_fftsize, d_fft_threads);
+    fft_plan_cache::release(d_stream_fft, d_fftsize, d_fft_threads);
+    d_fft = nullptr;
+    d_stream_fft = nullptr;
+}
+
 /*! \brief Set new quadrature rate. */
 void rx_fft_c::set_quad_rate(double quad_rate)
 {
+    std::lock_guard<std::mutex> lock(d_time_mutex);
+
+    /* keep the time of the current sample across the rate change */
+    if (d_time_valid && d_quadrate > 0.0)
+    {
+        const uint64_t written = d_ring_written.load(std::memory_order_acquire);
+        d_time_anchor += ((double)written - (double)d_time_index) / d_quadrate;
+        d_time_index = written;
+    }
     d_quadrate = quad_rate;
 }
 
@@ -213,10 +1006,107 @@ void rx_fft_c::set_window_type(int wintype, bool normalize_energy)
 
     if (wintype != d_wintype || normalize_energy != d_normalize_energy)
     {
+        std::lock_guard<std::mutex> fft_lock(d_fft_mutex);
+        std::lock_guard<std::mutex> lock(d_stream_mutex);
+
         d_wintype = wintype;
         d_normalize_energy = normalize_energy;
         update_window();
+        if (d_stream_gpu && !d_stream_gpu->set_window(d_window))
+            reset_stream();
+    }
+}
+
+/*! \brief Select the spectral estimator used for snapshots.
+ *  \param estimator The estimator, see rx_fft_c::estimator.
+ *  \param param Number of Welch segments (up to MAX_WELCH_SEGMENTS) or
+ *               PFB taps per channel (up to MAX_PFB_TAPS).
+ *
+ * Streaming mode is not affected, it already averages every frame.
+ */
+void rx_fft_c::set_estimator(int estimator, unsigned int param)
+{
+    if (estimator != ESTIMATOR_WELCH && estimator != ESTIMATOR_PFB)
+        estimator = ESTIMATOR_PERIODOGRAM;
+
+    if (estimator == ESTIMATOR_WELCH)
+        param = std::max(2u, std::min(param, (unsigned int)MAX_WELCH_SEGMENTS));
+    else if (estimator == ESTIMATOR_PFB)
+        param = std::max(2u, std::min(param, (unsigned int)MAX_PFB_TAPS));
+    else
+        param = 1;
+
+    std::lock_guard<std::mutex> lock(d_fft_mutex);
+
+    d_estimator = estimator;
+    d_estimator_param = param;
+    update_pfb_taps();
+}
+
+/*! \brief Enable or disable streaming mode.
+ *  \param enable Whether to compute every FFT frame in work().
+ *  \param overlap Fraction of each frame that overlaps the previous one,
+ *                 between 0.0 and 0.9375.
+ *  \param reduce How frames are combined between two get_fft_data() calls,
+ *                see rx_fft_c::stream_reduce.
+ */
+void rx_fft_c::set_streaming(bool enable, float overlap, int reduce)
+{
+    std::lock_guard<std::mutex> fft_lock(d_fft_mutex);
+    std::lock_guard<std::mutex> lock(d_stream_mutex);
+
+    d_streaming = enable;
+    d_stream_overlap = std::max(0.0f, std::min(overlap, 0.9375f));
+    d_stream_reduce = (reduce == STREAM_REDUCE_MAX) ? STREAM_REDUCE_MAX : STREAM_REDUCE_AVG;
+    reset_stream();
+}
+
+/*! \brief Reallocate streaming buffers for the current FFT size.
+ *
+ * Note that this function does not lock; the caller must hold both
+ * d_fft_mutex and d_stream_mutex.
+ */
+void rx_fft_c::reset_stream()
+{
+    fft_plan_cache::release(d_stream_fft, d_fftsize, d_fft_threads);
+    d_stream_fft = nullptr;
+    d_stream_gpu.reset();
+    d_stream_fill = 0;
+    d_stream_back = 0;
+    d_stream_front = 1;
+    d_stream_middle = 2;
+    d_stream_request = true;
+
+    for (int i = 0; i < 3; i++)
+    {
+        d_stream_slot_frames[i] = 0;
+        d_stream_slot_end[i] = 0;
+        if (d_streaming)
+            d_stream_slot[i].assign(d_fftsize, 0.0f);
+        else
+            std::vector<float>().swap(d_stream_slot[i]);
+    }
+
+    if (!d_streaming)
+    {
+        std::vector<gr_complex>().swap(d_stream_buf);
+        std::vector<float>().swap(d_stream_pwr);
+        return;
+    }
+
+    if (d_gpu_enabled)
+    {
+        d_stream_gpu = gpu_fft_stream::create(d_fftsize, d_window,
+                                              d_stream_reduce == STREAM_REDUCE_MAX);
+        if (d_stream_gpu)
+            std::cerr << "rx_fft_c: streaming " << d_fftsize << " point FFTs on "
+                      << d_stream_gpu->device() << std::endl;
     }
+    if (!d_stream_gpu)
+        d_stream_fft = fft_plan_cache::acquire(d_fftsize, d_fft_threads);
+    d_stream_hop = std::max(1u, (unsigned int)(d_fftsize * (1.0f - d_stream_overlap)));
+    d_stream_buf.assign(d_fftsize, gr_complex(0.0f, 0.0f));
+    d_stream_pwr.resize(d_fftsize);
 }
 
 void rx_fft_c::update_window()
@@ -235,6 +1125,51 @@ void rx_fft_c::update_window()
     if (d_normalize_energy)
         factor = std::sqrt(factor);
     volk_32f_s32f_normalize(d_window.data(), factor, d_fftsize);
+
+    update_pfb_taps();
+}
+
+/*! \brief Create the PFB prototype filter for the current settings.
+ *
+ * The prototype is a lowpass with a cutoff of one FFT bin, spanning
+ * estimator_count() FFT lengths and tapered with the selected window. It is
+ * normalized like the plain window so that both estimators read the same
+ * level. Buffers are released when the PFB is not in use.
+ */
+void rx_fft_c::update_pfb_taps()
+{
+    if (d_estimator != ESTIMATOR_PFB)
+    {
+        std::vector<float>().swap(d_pfb_taps);
+        std::vector<gr_complex>().swap(d_pfb_seg);
+        std::vector<float>().swap(d_welch_pwr);
+        if (d_estimator == ESTIMATOR_WELCH)
+            d_welch_pwr.resize(d_fftsize);
+        return;
+    }
+
+    const unsigned int len = estimator_count() * d_fftsize;
+    const double center = 0.5 * (double)(len - 1);
+
+    d_pfb_taps = gr::fft::window::build((gr::fft::window::win_type)d_wintype, len, 6.76);
+    d_pfb_taps.resize(len);
+    for (unsigned int i = 0; i < len; i++)
+    {
+        double x = ((double)i - center) / (double)d_fftsize;
+        if (x != 0.0)
+            d_pfb_taps[i] *= (float)(std::sin(M_PI * x) / (M_PI * x));
+    }
+
+    float sum = 0.0;
+    for (auto v : d_pfb_taps)
+        sum += d_normalize_energy ? v * v : v;
+    float factor = sum / (float)d_fftsize;
+    if (d_normalize_energy)
+        factor = std::sqrt(factor);
+    volk_32f_s32f_normalize(d_pfb_taps.data(), factor, len);
+
+    d_pfb_seg.resize(d_fftsize);
+    std::vector<float>().swap(d_welch_pwr);
 }
 
 
@@ -262,15 +1197,13 @@ rx_fft_f::rx_fft_f(unsigned int fftsize, double audio_rate,
       d_startup_samples(0),
       d_audiorate(audio_rate),
       d_wintype(-1),
-      d_normalize_energy(false)
+      d_normalize_energy(false),
+      d_writer_mem(MEM_AUDIO_FFT)
 {
 
     /* create FFT object */
-#if GNURADIO_VERSION < 0x030900
-    d_fft = new gr::fft::fft_complex(d_fftsize, true);
-#else
-    d_fft = new gr::fft::fft_complex_fwd(d_fftsize);
-#endif
+    d_fft = fft_plan_cache::acquire_real(d_fftsize);
+    d_power.resize(d_fftsize / 2 + 1);
 
     /* allocate circular buffer */
 #if GNURADIO_VERSION < 0x031000
@@ -279,6 +1212,7 @@ rx_fft_f::rx_fft_f(unsigned int fftsize, double audio_rate,
     d_writer = gr::make_buffer(AUDIO_BUFFER_SIZE, sizeof(float), 1, 1);
 #endif
     d_reader = gr::buffer_add_reader(d_writer, 0);
+    d_writer_mem.set((int64_t)d_writer->bufsize() * sizeof(float));
 
     memset(d_writer->write_pointer(), 0, sizeof(gr_complex) * d_fftsize);
     d_writer->update_write_pointer(d_fftsize);
@@ -291,7 +1225,7 @@ rx_fft_f::rx_fft_f(unsigned int fftsize, double audio_rate,
 
 rx_fft_f::~rx_fft_f()
 {
-    delete d_fft;
+    fft_plan_cache::release_real(d_fft, d_fftsize);
 }
 
 /*! \brief Audio FFT work method.
@@ -357,13 +1291,16 @@ int rx_fft_f::get_fft_data(float* fftPoints)
         /* compute FFT */
         d_fft->execute();
 
-        const std::complex<float> *fftOut = d_fft->get_outbuf();
-
-        // Shifted mag^2(FFT)
-        for (unsigned int i = 0; i < d_fftsize/2; ++i)
-            fftPoints[i] = static_cast<float>(std::norm(fftOut[i + d_fftsize/2]));
-        for (unsigned int i = d_fftsize/2; i < d_fftsize; ++i)
-            fftPoints[i] = static_cast<float>(std::norm(fftOut[i - d_fftsize/2]));
+        // Shifted mag^2(FFT), the negative half mirrors the positive one
+        const unsigned int half = d_fftsize / 2;
+        const unsigned int neg = d_fftsize - half;
+        volk_32fc_magnitude_squared_32f(d_power.data(), d_fft->get_outbuf(), half + 1);
+        memcpy(fftPoints + neg, d_power.data(), sizeof(float) * half);
+        for (unsigned int i = 0; i < neg; i++)
+        {
+            const unsigned int bin = half + i;
+            fftPoints[i] = d_power[std::min(bin, d_fftsize - bin)];
+        }
     }
 
     return 0;
@@ -378,19 +1315,13 @@ int rx_fft_f::get_fft_data(float* fftPoints)
  */
 void rx_fft_f::apply_window(unsigned int size)
 {
-    gr_complex *dst = d_fft->get_inbuf();
-    float * p = (float *)d_reader->read_pointer();
-    /* apply window, and convert to complex */
+    float *dst = d_fft->get_inbuf();
+    const float *p = (const float *)d_reader->read_pointer();
+    /* apply window */
     if (d_window.size())
-    {
-        for (unsigned int i = 0; i < size; i++)
-            dst[i] = p[i] * d_window[i];
-    }
+        volk_32f_x2_multiply_32f(dst, p, d_window.data(), size);
     else
-    {
-        for (unsigned int i = 0; i < size; i++)
-            dst[i] = p[i];
-    }
+        memcpy(dst, p, sizeof(float) * size);
 }
 
 
@@ -399,15 +1330,11 @@ void rx_fft_f::set_fft_size(unsigned int fftsize)
 {
     if (fftsize != d_fftsize)
     {
+        /* swap FFT object, the pool avoids replanning known sizes */
+        fft_plan_cache::release_real(d_fft, d_fftsize);
         d_fftsize = fftsize;
-
-        /* reset FFT object (also reset FFTW plan) */
-        delete d_fft;
-#if GNURADIO_VERSION < 0x030900
-        d_fft = new gr::fft::fft_complex(d_fftsize, true);
-#else
-        d_fft = new gr::fft::fft_complex_fwd(d_fftsize);
-#endif
+        d_fft = fft_plan_cache::acquire_real(d_fftsize);
+        d_power.resize(d_fftsize / 2 + 1);
 
         update_window();
     }
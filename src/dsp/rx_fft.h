@@ -23,8 +23,12 @@
 #ifndef RX_FFT_H
 #define RX_FFT_H
 
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 #include <gnuradio/sync_block.h>
+#include <gnuradio/tags.h>
 #include <gnuradio/fft/fft.h>
 #include <gnuradio/filter/firdes.h>       /* contains enum win_type */
 #include <gnuradio/gr_complex.h>
@@ -33,12 +37,26 @@
 #include <gnuradio/buffer_reader.h>
 #endif
 #include <chrono>
+#include "dsp/gpu_fft.h"
+#include "dsp/mem_account.h"
 
 
 #define MAX_FFT_SIZE (1024 * 1024 * 4)
 #define AUDIO_BUFFER_SIZE 65536
 
+/* FFT sizes from which rx_fft_c executes snapshots on a worker thread */
+#define FFT_WORKER_MIN_SIZE (1024 * 64)
+#define MAX_FFT_THREADS 16
+
+/* Limits of the Welch and polyphase filterbank estimators */
+#define MAX_WELCH_SEGMENTS 16
+#define MAX_PFB_TAPS 16
+
+/* Largest history buffer of rx_fft_c in samples (1 GiB) */
+#define MAX_HISTORY_SAMPLES (1024 * 1024 * 128)
+
 class rx_fft_c;
+struct rx_fft_ring;
 class rx_fft_f;
 
 #if GNURADIO_VERSION < 0x030900
@@ -74,6 +92,41 @@ rx_fft_c_sptr make_rx_fft_c(unsigned int fftsize=4096,
  * will be performed on the data stored in the circular buffer - assuming
  * of course that the buffer contains at least fftsize samples.
  *
+ * The circular buffer is lock-free: work() announces the range it is about
+ * to overwrite before copying and publishes the new write position
+ * afterwards. The reader copies its window without any lock and retries if
+ * the writer wrapped into it meanwhile. work() therefore never waits for the
+ * GUI, see read_retries().
+ *
+ * In streaming mode (see set_streaming()) every fftsize block of input is
+ * transformed in work() with the configured overlap, and the power spectra
+ * are reduced (averaged or max-held) until the GUI collects them with
+ * get_fft_data(). Reduced frames are handed over through a triple buffer.
+ * No input samples are skipped in this mode. With set_gpu() the frames are
+ * transformed and reduced on an OpenCL device instead, see gpu_fft_stream.
+ *
+ * Snapshots use the estimator selected with set_estimator(): a single
+ * windowed periodogram, Welch averaging of overlapped segments, or a
+ * polyphase filterbank whose prototype filter spans several FFT lengths
+ * and has much lower scalloping and leakage than a plain window.
+ *
+ * Snapshots of FFT_WORKER_MIN_SIZE points or more are executed on a worker
+ * thread: get_fft_data() returns the last completed frame and requests the
+ * next one, so the caller never waits for the FFT itself. The FFTW plans
+ * use set_fft_threads() threads.
+ *
+ * The circular buffer is sized for the current FFT size and estimator and
+ * is resized lazily at the next snapshot. With set_history() it can hold
+ * several seconds of input, so that get_history_fft_data() can show the
+ * spectrum of a signal that has already gone.
+ *
+ * Frames carry the absolute index of the sample after their last input
+ * sample, counted since the block was created, and its wall-clock time.
+ * The time comes from rx_time tags when the source provides them and from
+ * the system clock otherwise. rx_freq tags, which some sources attach to
+ * the first sample after a retune, are recorded so that get_retune() can
+ * tell exactly where data at the new frequency starts.
+ *
  * \note Uses code from qtgui_sink_c
  */
 class rx_fft_c : public gr::sync_block
@@ -88,6 +141,19 @@ protected:
              bool normalize_energy = false);
 
 public:
+    /*! \brief Reduction used to combine streamed FFT frames. */
+    enum stream_reduce {
+        STREAM_REDUCE_AVG = 0,  /*!< Average power of all frames. */
+        STREAM_REDUCE_MAX = 1   /*!< Max-hold power of all frames. */
+    };
+
+    /*! \brief Spectral estimator used for snapshots. */
+    enum estimator {
+        ESTIMATOR_PERIODOGRAM = 0,  /*!< Single windowed FFT. */
+        ESTIMATOR_WELCH       = 1,  /*!< Average of 50% overlapped segments. */
+        ESTIMATOR_PFB         = 2   /*!< Polyphase filterbank channelizer. */
+    };
+
     ~rx_fft_c();
 
     int work(int noutput_items,
@@ -95,6 +161,8 @@ public:
              gr_vector_void_star &output_items);
 
     int get_fft_data(float* fftPoints);
+    int get_fft_data(float* fftPoints, uint64_t &sample_index, double &timestamp);
+    double sample_time(uint64_t sample_index);
 
     void set_window_type(int wintype, bool normalize_energy);
     int  get_window_type() const { return d_wintype; }
@@ -103,14 +171,52 @@ public:
     void set_quad_rate(double quad_rate);
     unsigned int fft_size() const {return d_fftsize;}
 
+    void set_streaming(bool enable, float overlap, int reduce);
+    bool is_streaming() const { return d_streaming; }
+
+    void set_fft_threads(int nthreads);
+    int  fft_threads() const { return d_fft_threads; }
+
+    void set_gpu(bool enable);
+    bool gpu_active() const { return d_stream_gpu != nullptr; }
+
+    void set_estimator(int estimator, unsigned int param);
+    int  get_estimator() const { return d_estimator; }
+
+    /*! \brief Number of snapshot reads that had to be retried because the
+     *         writer overwrote the window while it was being copied. */
+    unsigned long read_retries() const { return d_read_retries; }
+
+    /*! \brief Number of samples received so far, the sample index of the
+     *         next sample. */
+    uint64_t sample_count() const { return d_ring_written.load(std::memory_order_acquire); }
+    bool get_retune(uint64_t &sample_index, double &freq, unsigned int &count);
+
+    /*! \brief Gaps in the input found by the sample clock.
+     *  \param events Number of gaps (output).
+     *  \param samples Samples missing in all gaps, at the input rate of the
+     *                  block (output). */
+    void get_drops(uint64_t &events, uint64_t &samples) const
+    {
+        events = d_drop_events.load(std::memory_order_relaxed);
+        samples = d_drop_samples.load(std::memory_order_relaxed);
+    }
+
+    bool start();
+
+    void set_history(double seconds);
+    double get_history() const { return d_history; }
+    int get_history_fft_data(float* fftPoints, double age);
+
 private:
     unsigned int d_fftsize;   /*! Current FFT size. */
-    unsigned int d_startup_samples;
     double       d_quadrate;
     int          d_wintype;   /*! Current window type. */
     bool         d_normalize_energy;
 
-    std::mutex   d_in_mutex;   /*! Used to lock input buffer. */
+    std::mutex   d_fft_mutex;    /*! Locks FFT objects and window, never taken by work(). */
+    std::mutex   d_stream_mutex; /*! Locks streaming state, work() only try-locks it. */
+    int          d_fft_threads;  /*! Number of FFTW threads. */
 
 #if GNURADIO_VERSION < 0x030900
     gr::fft::fft_complex    *d_fft;    /*! FFT object. */
@@ -119,12 +225,97 @@ private:
 #endif
     std::vector<float>  d_window; /*! FFT window taps. */
 
-    gr::buffer_sptr d_writer;
-    gr::buffer_reader_sptr d_reader;
+    int          d_estimator;       /*! Snapshot estimator, see estimator. */
+    unsigned int d_estimator_param; /*! Welch segments or PFB taps per channel. */
+    std::vector<float>      d_pfb_taps; /*! PFB prototype filter taps. */
+    std::vector<gr_complex> d_pfb_seg;  /*! PFB scratch segment. */
+    std::vector<float>      d_welch_pwr; /*! Welch segment power spectrum. */
+
+    /* lock-free circular buffer */
+    std::atomic<rx_fft_ring *> d_ring;         /*! Sample storage, swapped by update_ring(). */
+    std::atomic<unsigned int>  d_ring_epoch;   /*! Odd while work() copies into d_ring. */
+    uint64_t                   d_ring_valid;   /*! First sample held by the current d_ring. */
+    double                     d_history;      /*! Requested history in seconds. */
+    mem_charge                 d_ring_mem;     /*! Size of d_ring, MEM_FFT_SAMPLES. */
+    std::atomic<uint64_t>      d_ring_claimed; /*! Samples written or being written. */
+    std::atomic<uint64_t>      d_ring_written; /*! Samples completely written. */
+    uint64_t                   d_read_end;     /*! End of the last snapshot window. */
+    std::atomic<unsigned long> d_read_retries;
+    uint64_t                   d_spectrum_end; /*! End of the last computed spectrum. */
     std::chrono::time_point<std::chrono::steady_clock> d_lasttime;
 
-    void apply_window(unsigned int size);
+    /* sample clock */
+    std::mutex   d_time_mutex;       /*! Locks the time anchor, work() only try-locks it. */
+    uint64_t     d_time_index;       /*! Sample index of d_time_anchor. */
+    double       d_time_anchor;      /*! Unix time of sample d_time_index. */
+    bool         d_time_valid;
+    bool         d_time_from_source; /*! Anchor comes from an rx_time tag. */
+    bool         d_time_restart;     /*! The flow graph was started, the input pause is no gap. */
+    std::atomic<uint64_t> d_drop_events;  /*! Gaps in the input. */
+    std::atomic<uint64_t> d_drop_samples; /*! Samples missing in the gaps. */
+    std::vector<gr::tag_t> d_time_tags;
+
+    /* retune tags, written by work() only */
+    std::atomic<unsigned int> d_tune_epoch; /*! Odd while work() updates the fields below. */
+    std::atomic<uint64_t>     d_tune_index; /*! Sample index of the last rx_freq tag. */
+    std::atomic<double>       d_tune_freq;  /*! Frequency of the last rx_freq tag. */
+    std::atomic<unsigned int> d_tune_count; /*! Number of rx_freq tags seen. */
+    std::vector<gr::tag_t>    d_tune_tags;
+
+    /* snapshot worker */
+    std::thread             d_worker;
+    std::mutex              d_worker_mutex;
+    std::condition_variable d_worker_cond;
+    bool                    d_worker_request; /*! A new snapshot is wanted. */
+    bool                    d_worker_quit;
+    bool                    d_worker_valid;   /*! d_worker_result holds a frame. */
+    std::vector<float>      d_worker_frame;   /*! Frame being computed. */
+    std::vector<float>      d_worker_result;  /*! Last completed frame. */
+    uint64_t                d_worker_frame_end;
+    uint64_t                d_worker_result_end;
+
+    /* streaming mode */
+    std::atomic<bool> d_streaming; /*! Compute every frame in work(). */
+    float        d_stream_overlap; /*! Overlap between frames (0.0 to 0.9375). */
+    int          d_stream_reduce; /*! How frames are combined (stream_reduce). */
+    unsigned int d_stream_hop;    /*! New samples between two frames. */
+    unsigned int d_stream_fill;   /*! Samples currently in d_stream_buf. */
+#if GNURADIO_VERSION < 0x030900
+    gr::fft::fft_complex    *d_stream_fft;  /*! FFT object used by work(). */
+#else
+    gr::fft::fft_complex_fwd *d_stream_fft; /*! FFT object used by work(). */
+#endif
+    bool         d_gpu_enabled;   /*! Stream on the OpenCL device if there is one. */
+    std::unique_ptr<gpu_fft_stream> d_stream_gpu; /*! Replaces d_stream_fft when set. */
+    std::vector<gr_complex> d_stream_buf;   /*! Sliding input window. */
+    std::vector<float>      d_stream_pwr;   /*! Power spectrum of the last frame. */
+
+    /* triple buffer of reduced, shifted power spectra */
+    std::vector<float> d_stream_slot[3];
+    unsigned int       d_stream_slot_frames[3]; /*! Frames reduced into each slot. */
+    uint64_t           d_stream_slot_end[3];    /*! End of the last frame in each slot. */
+    int                d_stream_back;    /*! Slot being filled by work(). */
+    int                d_stream_front;   /*! Slot owned by get_fft_data(). */
+    std::atomic<int>   d_stream_middle;  /*! Handoff slot, see STREAM_SLOT_FRESH. */
+    std::atomic<bool>  d_stream_request; /*! get_fft_data() wants a new frame. */
+
+    int  compute_snapshot(float *fftPoints);
+    int  compute_spectrum(float *fftPoints, bool live, uint64_t offset);
+    void update_ring();
+    void worker_loop();
+    void apply_window(uint64_t start);
+    void apply_pfb(uint64_t start);
+    void window_segment(gr_complex *dst, uint64_t start, const float *taps, unsigned int n);
+    unsigned int estimator_count() const;
+    unsigned int snapshot_span() const;
+    void release_ffts();
     void update_window();
+    void update_pfb_taps();
+    void stream_samples(const gr_complex *in, int nitems, uint64_t index);
+    void update_time(uint64_t index, int nitems);
+    void count_drop(double seconds);
+    void update_tune(uint64_t index, int nitems);
+    void reset_stream();
 };
 
 
@@ -146,7 +337,9 @@ rx_fft_f_sptr make_rx_fft_f(unsigned int fftsize=1024,
  *  \ingroup DSP
  *
  * This block is used to compute the FFT of the audio spectrum or anything
- * else where real FFT is useful.
+ * else where real FFT is useful. The transform is real-input, so only the
+ * fftsize / 2 + 1 bins that are not redundant are computed; get_fft_data()
+ * mirrors them into the shifted fftsize points of the complex FFT blocks.
  *
  * The samples are collected in a circular buffer with size FFT_SIZE.
  * When the GUI asks for a new set of FFT data using get_fft_data() an FFT
@@ -190,15 +383,13 @@ private:
 
     std::mutex   d_in_mutex;   /*! Used to lock input buffer. */
 
-#if GNURADIO_VERSION < 0x030900
-    gr::fft::fft_complex    *d_fft;    /*! FFT object. */
-#else
-    gr::fft::fft_complex_fwd *d_fft;   /*! FFT object. */
-#endif
+    gr::fft::fft_real_fwd *d_fft;  /*! FFT object. */
     std::vector<float>  d_window; /*! FFT window taps. */
+    std::vector<float>  d_power;  /*! mag^2 of the fftsize / 2 + 1 bins. */
 
     gr::buffer_sptr d_writer;
     gr::buffer_reader_sptr d_reader;
+    mem_charge      d_writer_mem;  /*! Size of d_writer, MEM_AUDIO_FFT. */
     std::chrono::time_point<std::chrono::steady_clock> d_lasttime;
 
     void apply_window(unsigned int size);
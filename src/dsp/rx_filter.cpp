@@ -25,6 +25,7 @@
 #include <gnuradio/filter/firdes.h>
 #include <iostream>
 #include <QDebug>
+#include "dsp/filter_taps_cache.h"
 #include "dsp/rx_filter.h"
 
 static const int MIN_IN = 1;  /* Minimum number of input streams. */
@@ -32,6 +33,12 @@ static const int MAX_IN = 1;  /* Maximum number of input streams. */
 static const int MIN_OUT = 1; /* Minimum number of output streams. */
 static const int MAX_OUT = 1; /* Maximum number of output streams. */
 
+/* Tap count of a Hamming window design, as firdes computes it */
+static unsigned int hamming_taps(double sample_rate, double trans_width)
+{
+    int ntaps = (int)(53.0 * sample_rate / (22.0 * trans_width));
+    return (unsigned int)(ntaps | 1);
+}
 
 /*
  * Create a new instance of rx_filter and return
@@ -46,6 +53,7 @@ rx_filter::rx_filter(double sample_rate, double low, double high, double trans_w
     : gr::hier_block2 ("rx_filter",
                       gr::io_signature::make (MIN_IN, MAX_IN, sizeof (gr_complex)),
                       gr::io_signature::make (MIN_OUT, MAX_OUT, sizeof (gr_complex))),
+      d_use_fft(false),
       d_sample_rate(sample_rate),
       d_low(low),
       d_high(high),
@@ -58,19 +66,17 @@ rx_filter::rx_filter(double sample_rate, double low, double high, double trans_w
         d_high = 0.95*sample_rate/2.0;
 
     /* generate taps */
-    d_taps = gr::filter::firdes::complex_band_pass(1.0, d_sample_rate, d_low, d_high, d_trans_width);
-
-    /* create band pass filter */
-    d_bpf = gr::filter::fir_filter_ccc::make(1, d_taps);
+    d_taps = filter_taps_cache::complex_band_pass(1.0, d_sample_rate, d_low, d_high, d_trans_width);
+    d_generation = 0;
 
-    /* connect filter */
-    connect(self(), 0, d_bpf, 0);
-    connect(d_bpf, 0, self(), 0);
+    /* create and connect band pass filter */
+    d_use_fft = hamming_taps(d_sample_rate, d_trans_width) > RX_FILTER_FFT_TAPS;
+    connect_bpf();
 }
 
 rx_filter::~rx_filter ()
 {
-
+    filter_taps_cache::cancel(this);
 }
 
 void rx_filter::set_param(double low, double high, double trans_width)
@@ -84,17 +90,82 @@ void rx_filter::set_param(double low, double high, double trans_width)
     if (d_high > 0.95*d_sample_rate/2.0)
         d_high = 0.95*d_sample_rate/2.0;
 
-    /* generate new taps */
-    d_taps = gr::filter::firdes::complex_band_pass(1.0, d_sample_rate,
-                                                   d_low + d_cw_offset,
-                                                   d_high + d_cw_offset,
-                                                   d_trans_width);
+    double sample_rate = d_sample_rate;
+    double lo = d_low + d_cw_offset;
+    double hi = d_high + d_cw_offset;
+    double tw = d_trans_width;
+    unsigned int generation = ++d_generation;
 
     qDebug() << "Generating taps for new filter   LO:" << d_low
-             << "  HI:" << d_high << "  TW:" << d_trans_width
-             << "  Taps:" << d_taps.size();
+             << "  HI:" << d_high << "  TW:" << d_trans_width;
 
-    d_bpf->set_taps(d_taps);
+    bool use_fft = hamming_taps(sample_rate, tw) > RX_FILTER_FFT_TAPS;
+    std::vector<gr_complex> taps;
+    if (use_fft != d_use_fft)
+    {
+        /* the other filter block needs its taps when it is created */
+        taps = filter_taps_cache::complex_band_pass(1.0, sample_rate, lo, hi, tw);
+    }
+    else if (!filter_taps_cache::find_complex_band_pass(1.0, sample_rate, lo, hi, tw, taps))
+    {
+        /* design in the background and skip it if a newer one came meanwhile */
+        filter_taps_cache::post(this, [this, sample_rate, lo, hi, tw, generation]() {
+            set_taps(filter_taps_cache::complex_band_pass(1.0, sample_rate, lo, hi, tw),
+                     generation, use_fft);
+        });
+        return;
+    }
+
+    set_taps(taps, generation, use_fft);
+}
+
+/*
+ * Use new taps unless newer ones have been requested since. Switching
+ * between the FIR and FFT filter locks the flow graph, which is only done
+ * from set_param(), never from the background design.
+ */
+void rx_filter::set_taps(const std::vector<gr_complex> &taps, unsigned int generation,
+                         bool use_fft)
+{
+    std::lock_guard<std::mutex> lock(d_taps_mutex);
+
+    if (generation != d_generation)
+        return;
+
+    d_taps = taps;
+    qDebug() << "New filter taps:" << d_taps.size();
+
+    if (use_fft != d_use_fft)
+    {
+        d_use_fft = use_fft;
+        lock();
+        disconnect_all();
+        connect_bpf();
+        unlock();
+    }
+    else if (d_use_fft)
+        d_fft_bpf->set_taps(d_taps);
+    else
+        d_bpf->set_taps(d_taps);
+}
+
+/* Create the FIR or FFT filter with the current taps and connect it. */
+void rx_filter::connect_bpf(void)
+{
+    if (d_use_fft)
+    {
+        d_bpf.reset();
+        d_fft_bpf = gr::filter::fft_filter_ccc::make(1, d_taps);
+        connect(self(), 0, d_fft_bpf, 0);
+        connect(d_fft_bpf, 0, self(), 0);
+    }
+    else
+    {
+        d_fft_bpf.reset();
+        d_bpf = gr::filter::fir_filter_ccc::make(1, d_taps);
+        connect(self(), 0, d_bpf, 0);
+        connect(d_bpf, 0, self(), 0);
+    }
 }
 
 
@@ -130,7 +201,7 @@ rx_xlating_filter::rx_xlating_filter(double sample_rate, double center, double l
       d_trans_width(trans_width)
 {
     /* generate taps */
-    d_taps = gr::filter::firdes::complex_band_pass(1.0, d_sample_rate, -d_high, -d_low, d_trans_width);
+    d_taps = filter_taps_cache::complex_band_pass(1.0, d_sample_rate, -d_high, -d_low, d_trans_width);
 
     /* create band pass filter */
     d_bpf = gr::filter::freq_xlating_fir_filter_ccc::make(1, d_taps, d_center, d_sample_rate);
@@ -165,7 +236,7 @@ void rx_xlating_filter::set_param(double low, double high, double trans_width)
     d_high        = high;
 
     /* generate new taps */
-    d_taps = gr::filter::firdes::complex_band_pass(1.0, d_sample_rate, -d_high, -d_low, d_trans_width);
+    d_taps = filter_taps_cache::complex_band_pass(1.0, d_sample_rate, -d_high, -d_low, d_trans_width);
 
     d_bpf->set_taps(d_taps);
 }
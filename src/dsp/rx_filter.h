@@ -23,12 +23,16 @@
 #ifndef RX_FILTER_H
 #define RX_FILTER_H
 
+#include <atomic>
+#include <mutex>
 #include <gnuradio/hier_block2.h>
+#include <gnuradio/filter/fft_filter_ccc.h>
 #include <gnuradio/filter/fir_filter_blk.h>
 #include <gnuradio/filter/freq_xlating_fir_filter.h>
 
 
 #define RX_FILTER_MIN_WIDTH 100  /*! Minimum width of filter */
+#define RX_FILTER_FFT_TAPS  128  /*! Filters with more taps run in the frequency domain */
 
 class rx_filter;
 class rx_xlating_filter;
@@ -68,6 +72,15 @@ rx_filter_sptr make_rx_filter(double sample_rate,
  * performed by the accessors (though the taps generator from gr::filter::firdes does perform
  * some sanity checks and throws std::out_of_range in case of bad parameter).
  *
+ * Filters with more than RX_FILTER_FFT_TAPS taps, the narrow filters with sharp
+ * transitions, run as an overlap-save FFT filter, whose cost per sample grows
+ * with the log of the tap count instead of linearly. The two have the same
+ * response and delay; the filter is swapped when set_param() crosses the limit.
+ *
+ * set_param() returns at once: taps that are not in filter_taps_cache are
+ * designed in the background and replace the old ones when done, so that
+ * dragging the passband does not stall the caller.
+ *
  * \note In order to have proper LSB/USB, we must exchange low and high and reverse their sign
  */
 class rx_filter : public gr::hier_block2
@@ -81,8 +94,15 @@ public:
     void set_cw_offset(double offset);
 
 private:
+    void connect_bpf(void);
+    void set_taps(const std::vector<gr_complex> &taps, unsigned int generation, bool use_fft);
+
     std::vector<gr_complex> d_taps;
     gr::filter::fir_filter_ccc::sptr  d_bpf;
+    gr::filter::fft_filter_ccc::sptr  d_fft_bpf;   /*!< Used instead of d_bpf for long filters. */
+    bool   d_use_fft;
+    std::mutex  d_taps_mutex;                /*!< Held while the taps are replaced. */
+    std::atomic<unsigned int> d_generation;  /*!< Counts set_param() calls. */
 
     double d_sample_rate;
     double d_low;
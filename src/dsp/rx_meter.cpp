@@ -21,6 +21,7 @@
  * Boston, MA 02110-1301, USA.
  */
 #include <math.h>
+#include <algorithm>
 #include <volk/volk.h>
 #include <gnuradio/io_signature.h>
 #include <dsp/rx_meter.h>
@@ -37,17 +38,28 @@ rx_meter_c::rx_meter_c(double quad_rate)
           gr::io_signature::make(1, 1, sizeof(gr_complex)),
           gr::io_signature::make(0, 0, 0)),
       d_quadrate(quad_rate),
-      d_avgsize(quad_rate * 0.100)
+      d_segsize(std::max(1u, (unsigned int)(quad_rate * METER_SEGMENT_SEC))),
+      d_segcount(0),
+      d_segsum(0.f),
+      d_segpos(0),
+      d_segfilled(0),
+      d_power(1.f),
+      d_peak(1.f),
+      d_time(std::chrono::steady_clock::now().time_since_epoch().count()),
+      d_history_pos(0),
+      d_history_count(0),
+      d_probe_req(0),
+      d_probe_done(0),
+      d_probe_req_skip(0),
+      d_probe_req_len(0),
+      d_probe_power(0.f),
+      d_probe_seq(0),
+      d_probe_skip(0),
+      d_probe_left(0),
+      d_probe_len(0),
+      d_probe_sum(0.f)
 {
-    /* allocate circular buffer */
-#if GNURADIO_VERSION < 0x031000
-    d_writer = gr::make_buffer(d_avgsize + d_quadrate, sizeof(gr_complex));
-#else
-    d_writer = gr::make_buffer(d_avgsize + d_quadrate, sizeof(gr_complex), 1, 1);
-#endif
-    d_reader = gr::buffer_add_reader(d_writer, 0);
-
-    d_lasttime = std::chrono::steady_clock::now();
+    std::fill(d_seg, d_seg + METER_SEGMENTS, 0.f);
 }
 
 rx_meter_c::~rx_meter_c()
@@ -59,38 +71,152 @@ int rx_meter_c::work(int noutput_items,
                      gr_vector_const_void_star &input_items,
                      gr_vector_void_star &output_items)
 {
-    std::lock_guard<std::mutex> lock(d_mutex);
-
-    const gr_complex *in = (const gr_complex *) input_items[0];
+    const float *in = (const float *) input_items[0];
     (void) output_items; // unused
 
-    int items_to_copy = std::min(noutput_items, (int)d_writer->bufsize());
-    if (items_to_copy < noutput_items)
-        in += (noutput_items - items_to_copy);
-
-    if (d_writer->space_available() < items_to_copy)
-        d_reader->update_read_pointer(items_to_copy - d_writer->space_available());
-    memcpy(d_writer->write_pointer(), in, sizeof(gr_complex) * items_to_copy);
-    d_writer->update_write_pointer(items_to_copy);
+    unsigned int req = d_probe_req.load(std::memory_order_acquire);
+    if (req != d_probe_seq)
+    {
+        d_probe_seq = req;
+        d_probe_skip = d_probe_req_skip.load(std::memory_order_relaxed);
+        d_probe_len = d_probe_req_len.load(std::memory_order_relaxed);
+        d_probe_left = d_probe_len;
+        d_probe_sum = 0.f;
+    }
+    if (d_probe_left > 0)
+        probe(in, noutput_items);
+
+    int i = 0;
+    while (i < noutput_items)
+    {
+        int n = std::min(noutput_items - i, (int)(d_segsize - d_segcount));
+        float sum;
+
+        // I and Q interleaved, so the dot product is the sum of |x|^2
+        volk_32f_x2_dot_prod_32f(&sum, in + 2 * i, in + 2 * i, 2 * n);
+        d_segsum += sum;
+        d_segcount += n;
+        i += n;
+
+        if (d_segcount == d_segsize)
+            end_segment();
+    }
 
     return noutput_items;
 }
 
+/* Add the samples of the running probe, publish it once it has all of them. */
+void rx_meter_c::probe(const float *in, int count)
+{
+    unsigned int skip = std::min(d_probe_skip, (unsigned int)count);
+    unsigned int n = std::min(d_probe_left, count - skip);
+    float sum;
+
+    d_probe_skip -= skip;
+    if (n == 0)
+        return;
+
+    volk_32f_x2_dot_prod_32f(&sum, in + 2 * skip, in + 2 * skip, 2 * n);
+    d_probe_sum += sum;
+    d_probe_left -= n;
+    if (d_probe_left == 0)
+    {
+        d_probe_power.store(d_probe_sum / (float)d_probe_len, std::memory_order_relaxed);
+        d_probe_done.store(d_probe_seq, std::memory_order_release);
+    }
+}
+
+/* Store the power of the finished segment and publish the window. */
+void rx_meter_c::end_segment()
+{
+    float power = d_segsum / (float)d_segsize;
+
+    d_seg[d_segpos] = power;
+    d_segpos = (d_segpos + 1) % METER_SEGMENTS;
+    d_segcount = 0;
+    d_segsum = 0.f;
+
+    {
+        std::lock_guard<std::mutex> lock(d_history_mutex);
+        if (!d_history.empty())
+        {
+            d_history[d_history_pos] = power;
+            d_history_pos = (d_history_pos + 1) % d_history.size();
+            d_history_count = std::min(d_history_count + 1, d_history.size());
+        }
+    }
+
+    // Like before, nothing is published until the first window is full
+    if (d_segfilled < METER_SEGMENTS)
+        d_segfilled++;
+    if (d_segfilled < METER_SEGMENTS)
+        return;
+
+    float sum = 0.f;
+    float peak = 0.f;
+    for (int k = 0; k < METER_SEGMENTS; k++)
+    {
+        sum += d_seg[k];
+        peak = std::max(peak, d_seg[k]);
+    }
+    d_power.store(sum / METER_SEGMENTS, std::memory_order_relaxed);
+    d_peak.store(peak, std::memory_order_relaxed);
+    d_time.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                 std::memory_order_release);
+}
+
 
 float rx_meter_c::get_level_db()
 {
-    std::lock_guard<std::mutex> lock(d_mutex);
+    return 10.f * log10f(d_power.load(std::memory_order_relaxed) + 1.0e-20f);
+}
 
-    if ((unsigned int)d_reader->items_available() < d_avgsize)
-        return 0;
+float rx_meter_c::get_peak_db()
+{
+    return 10.f * log10f(d_peak.load(std::memory_order_relaxed) + 1.0e-20f);
+}
 
-    std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
-    std::chrono::duration<double> diff = now - d_lasttime;
-    d_lasttime = now;
+std::chrono::steady_clock::time_point rx_meter_c::get_level_time()
+{
+    return std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(d_time.load(std::memory_order_acquire)));
+}
+
+void rx_meter_c::set_history_size(unsigned int segments)
+{
+    std::lock_guard<std::mutex> lock(d_history_mutex);
+
+    d_history.assign(segments, 0.f);
+    d_history_pos = 0;
+    d_history_count = 0;
+}
+
+std::vector<float> rx_meter_c::get_history()
+{
+    std::lock_guard<std::mutex> lock(d_history_mutex);
+
+    std::vector<float> levels;
+    levels.reserve(d_history_count);
+    size_t start = (d_history_pos + d_history.size() - d_history_count) %
+                   std::max<size_t>(1, d_history.size());
+    for (size_t k = 0; k < d_history_count; k++)
+        levels.push_back(10.f * log10f(d_history[(start + k) % d_history.size()] + 1.0e-20f));
+    return levels;
+}
+
+void rx_meter_c::start_probe(double skip_sec, double length_sec)
+{
+    d_probe_req_skip.store((unsigned int)(skip_sec * d_quadrate), std::memory_order_relaxed);
+    d_probe_req_len.store(std::max(1u, (unsigned int)(length_sec * d_quadrate)),
+                          std::memory_order_relaxed);
+    d_probe_req.fetch_add(1, std::memory_order_release);
+}
+
+bool rx_meter_c::get_probe_db(float &level_db)
+{
+    if (d_probe_done.load(std::memory_order_acquire) != d_probe_req.load(std::memory_order_relaxed))
+        return false;
 
-    d_reader->update_read_pointer(std::min((unsigned int)(diff.count() * d_quadrate * 1.001), (unsigned int)d_reader->items_available() - d_avgsize));
-    float sum = 0;
-    volk_32f_x2_dot_prod_32f(&sum, (float *)d_reader->read_pointer(), (float *)d_reader->read_pointer(), d_avgsize * 2);
-    float power = sum / (float)(d_avgsize);
-    return 10.f * log10f(power + 1.0e-20f);
+    level_db = 10.f * log10f(d_probe_power.load(std::memory_order_relaxed) + 1.0e-20f);
+    return true;
 }
@@ -24,12 +24,16 @@
 #define RX_METER_H
 
 #include <gnuradio/sync_block.h>
-#include <gnuradio/buffer.h>
-#if GNURADIO_VERSION >= 0x031000
-#include <gnuradio/buffer_reader.h>
-#endif
+#include <atomic>
 #include <chrono>
 #include <mutex>
+#include <vector>
+
+/* Length of a meter segment, the level is published once per segment */
+#define METER_SEGMENT_SEC 0.010
+
+/* Segments in the averaging window of 100 ms */
+#define METER_SEGMENTS 10
 
 
 class rx_meter_c;
@@ -56,6 +60,12 @@ rx_meter_c_sptr make_rx_meter_c(double quad_rate);
  * This block can be used to measure the received signal strength.
  * The get_level_db() method returns the average signal power
  * over a 100ms period.
+ *
+ * The power is summed with VOLK in segments of METER_SEGMENT_SEC, and
+ * after each segment the average and the peak segment over the last
+ * METER_SEGMENTS segments are published in atomics, so reading the level
+ * never waits for the block. The segment levels can also be kept in a
+ * history for the callers that want more than the latest value.
  */
 class rx_meter_c : public gr::sync_block
 {
@@ -74,15 +84,64 @@ public:
     /*! \brief Get the current signal level in dBFS. */
     float get_level_db();
 
-private:
-    double d_quadrate;
-    unsigned int d_avgsize; /*! Number of samples to average. */
+    /*! \brief Get the highest segment level of the window in dBFS. */
+    float get_peak_db();
+
+    /*! \brief Time when the level was last published. */
+    std::chrono::steady_clock::time_point get_level_time();
 
-    gr::buffer_sptr d_writer; /*! buffer to accumulate samples. */
-    gr::buffer_reader_sptr d_reader;
-    std::chrono::time_point<std::chrono::steady_clock> d_lasttime;
+    /*! \brief Keep the levels of the last segments.
+     *  \param segments Number of segments to keep, 0 to stop.
+     */
+    void set_history_size(unsigned int segments);
 
-    std::mutex   d_mutex;  /*! Used to lock FFT output buffer. */
+    /*! \brief Get the kept segment levels in dBFS, oldest first. */
+    std::vector<float> get_history();
+
+    /*! \brief Measure the level of the next samples, for a scanner.
+     *  \param skip_sec Time to let pass first, for the filters to settle.
+     *  \param length_sec Time to average.
+     *
+     * A probe in progress is replaced by the new one.
+     */
+    void start_probe(double skip_sec, double length_sec);
+
+    /*! \brief Get the level of the last started probe in dBFS.
+     *  \return false while the probe is not done.
+     */
+    bool get_probe_db(float &level_db);
+
+private:
+    void end_segment();
+    void probe(const float *in, int count);
+
+    double d_quadrate;
+    unsigned int d_segsize;             /*! Samples in a segment. */
+    unsigned int d_segcount;            /*! Samples in the current segment. */
+    float        d_segsum;              /*! Power sum of the current segment. */
+    float        d_seg[METER_SEGMENTS]; /*! Power of the last segments. */
+    unsigned int d_segpos;              /*! Next entry of d_seg. */
+    unsigned int d_segfilled;           /*! Valid entries of d_seg. */
+
+    std::atomic<float>   d_power;       /*! Average power of the window. */
+    std::atomic<float>   d_peak;        /*! Power of the strongest segment. */
+    std::atomic<int64_t> d_time;        /*! steady_clock ticks at publication. */
+
+    std::mutex         d_history_mutex; /*! Protects the history. */
+    std::vector<float> d_history;       /*! Segment powers, a ring. */
+    size_t             d_history_pos;   /*! Next entry of d_history. */
+    size_t             d_history_count; /*! Valid entries of d_history. */
+
+    std::atomic<unsigned int> d_probe_req;      /*! Sequence of the last start_probe(). */
+    std::atomic<unsigned int> d_probe_done;     /*! Sequence of the last finished probe. */
+    std::atomic<unsigned int> d_probe_req_skip; /*! Samples to skip, of d_probe_req. */
+    std::atomic<unsigned int> d_probe_req_len;  /*! Samples to average, of d_probe_req. */
+    std::atomic<float>        d_probe_power;    /*! Power of d_probe_done. */
+    unsigned int d_probe_seq;           /*! Probe being measured. */
+    unsigned int d_probe_skip;          /*! Samples left to skip. */
+    unsigned int d_probe_left;          /*! Samples left to average. */
+    unsigned int d_probe_len;
+    float        d_probe_sum;
 };
 
 
@@ -21,10 +21,15 @@
  * the Free Software Foundation, Inc., 51 Franklin Street,
  * Boston, MA 02110-1301, USA.
  */
+#include <algorithm>
 #include <gnuradio/io_signature.h>
 #include <gnuradio/gr_complex.h>
+#include <volk/volk.h>
 #include "dsp/rx_noise_blanker_cc.h"
 
+/* Samples blanked by NB1 from the start of a pulse */
+#define NB1_HANGTIME 7
+
 rx_nb_cc_sptr make_rx_nb_cc(double sample_rate, float thld1, float thld2)
 {
     return gnuradio::get_initial_sptr(new rx_nb_cc(sample_rate, thld1, thld2));
@@ -46,9 +51,8 @@ rx_nb_cc::rx_nb_cc(double sample_rate, float thld1, float thld2)
       d_thld_nb2(thld2),
       d_avgmag_nb1(1.0),
       d_avgmag_nb2(1.0),
+      d_avgsig(0.0),
       d_delay {0},
-      d_delidx(2),
-      d_sigidx(0),
       d_hangtime(0)
 {
 
@@ -70,14 +74,16 @@ int rx_nb_cc::work(int noutput_items,
 {
     const gr_complex *in = (const gr_complex *) input_items[0];
     gr_complex *out = (gr_complex *) output_items[0];
-    int i;
-
     std::lock_guard<std::mutex> lock(d_mutex);
 
     // copy data into output buffer then perform the processing on that buffer
-    for (i = 0; i < noutput_items; i++)
+    std::copy(in, in + noutput_items, out);
+
+    if (d_mag.size() < (size_t)noutput_items)
     {
-        out[i] = in[i];
+        d_mag.resize(noutput_items);
+        d_gain.resize(noutput_items);
+        d_delayed.resize(noutput_items + NB1_DELAY);
     }
 
     if (d_nb1_on)
@@ -99,35 +105,39 @@ int rx_nb_cc::work(int noutput_items,
  * Noise blanker 1 is the first noise blanker in the processing chain.
  * It is intended to reduce the effect of impulse type noise.
  *
+ * The magnitudes and the output are computed for the whole block with VOLK,
+ * only the average and the hang time are updated one sample at a time, into
+ * a mask that is 0 where the signal is blanked.
+ *
  * FIXME: Needs different constants for higher sample rates?
  */
 void rx_nb_cc::process_nb1(gr_complex *buf, int num)
 {
-    float cmag;
-    gr_complex zero(0.0, 0.0);
+    volk_32fc_magnitude_32f(d_mag.data(), buf, num);
 
     for (int i = 0; i < num; i++)
     {
-        cmag = std::abs(buf[i]);
-        d_delay[d_sigidx] = buf[i];
-        d_avgmag_nb1 = 0.999f*d_avgmag_nb1 + 0.001f*cmag;
+        d_avgmag_nb1 = 0.999f*d_avgmag_nb1 + 0.001f*d_mag[i];
 
-        if ((d_hangtime == 0) && (cmag > (d_thld_nb1*d_avgmag_nb1)))
-            d_hangtime = 7;
+        if ((d_hangtime == 0) && (d_mag[i] > (d_thld_nb1*d_avgmag_nb1)))
+            d_hangtime = NB1_HANGTIME;
 
         if (d_hangtime > 0)
         {
-            buf[i] = zero;
+            d_gain[i] = 0.0f;
             d_hangtime--;
         }
         else
         {
-            buf[i] = d_delay[d_delidx];
+            d_gain[i] = 1.0f;
         }
-
-        d_sigidx = (d_sigidx + 7) & 7;
-        d_delidx = (d_delidx + 7) & 7;
     }
+
+    // the output is the input NB1_DELAY samples ago, times the mask
+    std::copy(d_delay, d_delay + NB1_DELAY, d_delayed.begin());
+    std::copy(buf, buf + num, d_delayed.begin() + NB1_DELAY);
+    std::copy(d_delayed.begin() + num, d_delayed.begin() + num + NB1_DELAY, d_delay);
+    volk_32fc_32f_multiply_32fc(buf, d_delayed.data(), d_gain.data(), num);
 }
 
 /*! \brief Perform noise blanker 2 processing.
@@ -137,21 +147,24 @@ void rx_nb_cc::process_nb1(gr_complex *buf, int num)
  * Noise blanker 2 is the second noise blanker in the processing chain.
  * It is intended to reduce non-pulse type noise (i.e. longer time constants).
  *
+ * The magnitudes are computed for the whole block with VOLK, the averages
+ * are recursive and stay per sample.
+ *
  * FIXME: Needs different constants for higher sample rates?
  */
 void rx_nb_cc::process_nb2(gr_complex *buf, int num)
 {
-    float cmag;
     gr_complex c1(0.75);
     gr_complex c2(0.25);
 
+    volk_32fc_magnitude_32f(d_mag.data(), buf, num);
+
     for (int i = 0; i < num; i++)
     {
-        cmag = abs(buf[i]);
         d_avgsig = c1*d_avgsig + c2*buf[i];
-        d_avgmag_nb2 = 0.999f*d_avgmag_nb2 + 0.001f*cmag;
+        d_avgmag_nb2 = 0.999f*d_avgmag_nb2 + 0.001f*d_mag[i];
 
-        if (cmag > d_thld_nb2*d_avgmag_nb2)
+        if (d_mag[i] > d_thld_nb2*d_avgmag_nb2)
             buf[i] = d_avgsig;
     }
 }
@@ -24,9 +24,13 @@
 #define RX_NB_CC_H
 
 #include <mutex>
+#include <vector>
 #include <gnuradio/sync_block.h>
 #include <gnuradio/gr_complex.h>
 
+/* Samples NB1 delays the signal by, so that the start of a pulse is blanked */
+#define NB1_DELAY 2
+
 class rx_nb_cc;
 
 #if GNURADIO_VERSION < 0x030900
@@ -91,8 +95,12 @@ private:
     float  d_thld_nb2;      /*! Current threshold for noise blanker 2 (0.0 to 15.0 TBC). */
     float  d_avgmag_nb1;    /*! Average magnitude. */
     float  d_avgmag_nb2;    /*! Average magnitude. */
-    gr_complex d_avgsig, d_delay[8];
-    int    d_delidx, d_sigidx, d_hangtime;   // FIXME: need longer buffer for higher sample rates?
+    gr_complex d_avgsig, d_delay[NB1_DELAY]; /*! NB1 delay line, the last input samples. */
+    int    d_hangtime;      // FIXME: need longer buffer for higher sample rates?
+
+    std::vector<float>      d_mag;      /*! Magnitudes of the block. */
+    std::vector<float>      d_gain;     /*! NB1 mask, 0 where blanked. */
+    std::vector<gr_complex> d_delayed;  /*! NB1 delay line followed by the block. */
 
 };
 
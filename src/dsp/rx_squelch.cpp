@@ -0,0 +1,158 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <gnuradio/io_signature.h>
+#include "dsp/rx_squelch.h"
+
+
+rx_squelch_cc_sptr make_rx_squelch_cc(double threshold_db, double alpha)
+{
+    return gnuradio::get_initial_sptr(new rx_squelch_cc(threshold_db, alpha));
+}
+
+rx_squelch_cc::rx_squelch_cc(double threshold_db, double alpha)
+    : gr::block ("rx_squelch_cc",
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          gr::io_signature::make2(2, 2, sizeof(gr_complex), sizeof(char))),
+      d_avg(0.0f)
+{
+    set_threshold(threshold_db);
+    set_alpha(alpha);
+}
+
+rx_squelch_cc::~rx_squelch_cc()
+{
+}
+
+int rx_squelch_cc::general_work(int noutput_items,
+                                gr_vector_int &ninput_items,
+                                gr_vector_const_void_star &input_items,
+                                gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *) input_items[0];
+    gr_complex *out = (gr_complex *) output_items[0];
+    char *flags = (char *) output_items[1];
+    const int num = std::min(noutput_items, ninput_items[0]);
+    int passed = 0;
+
+    for (int i = 0; i < num; i++)
+    {
+        d_avg = d_alpha * std::norm(in[i]) + (1.0f - d_alpha) * d_avg;
+        flags[i] = d_avg >= d_threshold;
+        if (flags[i])
+            out[passed++] = in[i];
+    }
+
+    consume_each(num);
+    produce(0, passed);
+    produce(1, num);
+
+    return WORK_CALLED_PRODUCE;
+}
+
+void rx_squelch_cc::set_threshold(double threshold_db)
+{
+    d_threshold = std::pow(10.0, threshold_db / 10.0);
+}
+
+void rx_squelch_cc::set_alpha(double alpha)
+{
+    d_alpha = alpha;
+}
+
+
+rx_squelch_fill_ff_sptr make_rx_squelch_fill_ff()
+{
+    return gnuradio::get_initial_sptr(new rx_squelch_fill_ff());
+}
+
+rx_squelch_fill_ff::rx_squelch_fill_ff()
+    : gr::block ("rx_squelch_fill_ff",
+          gr::io_signature::make3(3, 3, sizeof(float), sizeof(float), sizeof(char)),
+          gr::io_signature::make(2, 2, sizeof(float))),
+      d_need_audio(false)
+{
+}
+
+rx_squelch_fill_ff::~rx_squelch_fill_ff()
+{
+}
+
+/* Audio is only required once the flags have run out of it, so a closed
+ * squelch never waits for the blocks it has stopped */
+void rx_squelch_fill_ff::forecast(int noutput_items, gr_vector_int &ninput_items_required)
+{
+    ninput_items_required[0] = d_need_audio ? 1 : 0;
+    ninput_items_required[1] = d_need_audio ? 1 : 0;
+    ninput_items_required[2] = noutput_items;
+}
+
+int rx_squelch_fill_ff::general_work(int noutput_items,
+                                     gr_vector_int &ninput_items,
+                                     gr_vector_const_void_star &input_items,
+                                     gr_vector_void_star &output_items)
+{
+    const float *in0 = (const float *) input_items[0];
+    const float *in1 = (const float *) input_items[1];
+    const char *flags = (const char *) input_items[2];
+    float *out0 = (float *) output_items[0];
+    float *out1 = (float *) output_items[1];
+    const int num = std::min(noutput_items, ninput_items[2]);
+    const int audio = std::min(ninput_items[0], ninput_items[1]);
+    int done = 0;
+    int used = 0;
+
+    // Runs of passed samples are copied and runs of dropped ones zeroed
+    while (done < num)
+    {
+        int end = done + 1;
+        while (end < num && flags[end] == flags[done])
+            end++;
+
+        if (flags[done])
+        {
+            const int len = std::min(end - done, audio - used);
+            memcpy(out0 + done, in0 + used, len * sizeof(float));
+            memcpy(out1 + done, in1 + used, len * sizeof(float));
+            used += len;
+            done += len;
+            if (done < end)
+                break;
+        }
+        else
+        {
+            memset(out0 + done, 0, (end - done) * sizeof(float));
+            memset(out1 + done, 0, (end - done) * sizeof(float));
+            done = end;
+        }
+    }
+    d_need_audio = done < num;
+
+    consume(0, used);
+    consume(1, used);
+    consume(2, done);
+
+    return done;
+}
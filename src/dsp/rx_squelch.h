@@ -0,0 +1,110 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RX_SQUELCH_H
+#define RX_SQUELCH_H
+
+#include <gnuradio/block.h>
+#include <gnuradio/gr_complex.h>
+
+class rx_squelch_cc;
+class rx_squelch_fill_ff;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<rx_squelch_cc> rx_squelch_cc_sptr;
+typedef boost::shared_ptr<rx_squelch_fill_ff> rx_squelch_fill_ff_sptr;
+#else
+typedef std::shared_ptr<rx_squelch_cc> rx_squelch_cc_sptr;
+typedef std::shared_ptr<rx_squelch_fill_ff> rx_squelch_fill_ff_sptr;
+#endif
+
+
+rx_squelch_cc_sptr make_rx_squelch_cc(double threshold_db, double alpha);
+
+/*! \brief Squelch that holds back the samples while it is closed.
+ *  \ingroup DSP
+ *
+ * The level is averaged and compared to the threshold as in
+ * gr::analog::simple_squelch_cc, but the samples of a closed squelch are
+ * dropped rather than zeroed, so the blocks after it have no work until it
+ * opens again, and resume with the state they had when it closed.
+ *
+ * The second output has one byte per input sample, 1 where the sample was
+ * passed and 0 where it was dropped, for an rx_squelch_fill_ff after the
+ * blocks that puts the silence back. The blocks between the two must have
+ * one output per input.
+ */
+class rx_squelch_cc : public gr::block
+{
+    friend rx_squelch_cc_sptr make_rx_squelch_cc(double threshold_db, double alpha);
+
+protected:
+    rx_squelch_cc(double threshold_db, double alpha);
+
+public:
+    ~rx_squelch_cc();
+
+    int general_work(int noutput_items,
+                     gr_vector_int &ninput_items,
+                     gr_vector_const_void_star &input_items,
+                     gr_vector_void_star &output_items);
+
+    void set_threshold(double threshold_db);
+    void set_alpha(double alpha);
+
+private:
+    float d_threshold;          /*!< Power, not dB. */
+    float d_alpha;
+    float d_avg;
+};
+
+
+rx_squelch_fill_ff_sptr make_rx_squelch_fill_ff();
+
+/*! \brief Puts the samples an rx_squelch_cc dropped back as zeros.
+ *  \ingroup DSP
+ *
+ * Inputs 0 and 1 are the left and right audio made from the samples the
+ * squelch passed, input 2 its flags. Both outputs have one sample per flag.
+ */
+class rx_squelch_fill_ff : public gr::block
+{
+    friend rx_squelch_fill_ff_sptr make_rx_squelch_fill_ff();
+
+protected:
+    rx_squelch_fill_ff();
+
+public:
+    ~rx_squelch_fill_ff();
+
+    void forecast(int noutput_items, gr_vector_int &ninput_items_required);
+
+    int general_work(int noutput_items,
+                     gr_vector_int &ninput_items,
+                     gr_vector_const_void_star &input_items,
+                     gr_vector_void_star &output_items);
+
+private:
+    bool d_need_audio;          /*!< The next flag is a passed sample not here yet. */
+};
+
+#endif /* RX_SQUELCH_H */
@@ -0,0 +1,50 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <cstdint>
+#include <gnuradio/gr_complex.h>
+#include <gnuradio/io_signature.h>
+#include <volk/volk.h>
+
+#include "dsp/sc16_to_cf32.h"
+
+sc16_to_cf32_sptr make_sc16_to_cf32()
+{
+    return gnuradio::get_initial_sptr(new sc16_to_cf32());
+}
+
+sc16_to_cf32::sc16_to_cf32()
+    : gr::sync_block("sc16_to_cf32",
+          gr::io_signature::make(1, 1, 2 * sizeof(int16_t)),
+          gr::io_signature::make(0, 1, sizeof(gr_complex)))
+{
+}
+
+int sc16_to_cf32::work(int noutput_items,
+                       gr_vector_const_void_star &input_items,
+                       gr_vector_void_star &output_items)
+{
+    if (output_items.empty())
+        return noutput_items;
+
+    volk_16i_s32f_convert_32f((float *)output_items[0], (const int16_t *)input_items[0],
+                              SC16_SCALE, 2 * noutput_items);
+    return noutput_items;
+}
@@ -0,0 +1,59 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef SC16_TO_CF32_H
+#define SC16_TO_CF32_H
+
+#include <gnuradio/sync_block.h>
+
+/* Integer value of 1.0 in a complex int16 (sc16) stream, as in a cs16 recording */
+#define SC16_SCALE 32767.0f
+
+class sc16_to_cf32;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<sc16_to_cf32> sc16_to_cf32_sptr;
+#else
+typedef std::shared_ptr<sc16_to_cf32> sc16_to_cf32_sptr;
+#endif
+
+sc16_to_cf32_sptr make_sc16_to_cf32();
+
+/*! \brief Convert complex int16 samples to gr_complex, SC16_SCALE being 1.0.
+ *  \ingroup DSP
+ *
+ * Feeds the blocks that take gr_complex at the full rate of an sc16 input.
+ * The output may be left unconnected, the input is then dropped without
+ * being converted.
+ */
+class sc16_to_cf32 : public gr::sync_block
+{
+    friend sc16_to_cf32_sptr make_sc16_to_cf32();
+
+protected:
+    sc16_to_cf32();
+
+public:
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+};
+
+#endif /* SC16_TO_CF32_H */
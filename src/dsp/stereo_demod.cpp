@@ -21,10 +21,144 @@
  * the Free Software Foundation, Inc., 51 Franklin Street,
  * Boston, MA 02110-1301, USA.
  */
+#include <algorithm>
+#include <gnuradio/blocks/null_sink.h>
 #include <gnuradio/io_signature.h>
+#include <gnuradio/math.h>
+#include <gnuradio/sincos.h>
 #include <math.h>
-#include <iostream>
-#include <dsp/stereo_demod.h>
+#include <volk/volk.h>
+#include "dsp/filter_taps_cache.h"
+#include "dsp/fm_deemph.h"
+#include "dsp/stereo_demod.h"
+
+
+stereo_decoder_ff_sptr make_stereo_decoder_ff(float input_rate, unsigned int decim,
+                                              bool stereo, bool oirt)
+{
+    return gnuradio::get_initial_sptr(new stereo_decoder_ff(input_rate, decim,
+                                                            stereo, oirt));
+}
+
+stereo_decoder_ff::stereo_decoder_ff(float input_rate, unsigned int decim,
+                                     bool stereo, bool oirt)
+    : gr::sync_decimator("stereo_decoder_ff",
+                         gr::io_signature::make(1, 1, sizeof(float)),
+                         gr::io_signature::make(2, 2, sizeof(float)),
+                         decim),
+      d_stereo(stereo),
+      d_oirt(oirt),
+      d_phase(0.0f),
+      d_left{0.0f, 0.0f},
+      d_right{0.0f, 0.0f}
+{
+    const double cutoff = d_oirt ? 15e3 : 17e3;
+    const double pilot = d_oirt ? 31250.0 : 19000.0;
+    const double pilot_dev = d_oirt ? 50.0 : 20.0;
+
+    d_sum_taps = filter_taps_cache::low_pass(1.0, input_rate, cutoff, STEREO_AUDIO_TRANS);
+    d_diff_taps = filter_taps_cache::low_pass(STEREO_DIFF_GAIN, input_rate, cutoff,
+                                              STEREO_AUDIO_TRANS);
+    set_history(d_sum_taps.size());
+    d_mix.assign(d_sum_taps.size() - 1, 0.0f);
+
+    // Loop coefficients as in gr::blocks::control_loop
+    const double damping = sqrt(2.0) / 2.0;
+    const double denom = 1.0 + 2.0 * damping * STEREO_PLL_BW + STEREO_PLL_BW * STEREO_PLL_BW;
+    d_alpha = 4.0 * damping * STEREO_PLL_BW / denom;
+    d_beta = 4.0 * STEREO_PLL_BW * STEREO_PLL_BW / denom;
+    d_freq = 2.0 * M_PI * pilot / input_rate;
+    d_min_freq = 2.0 * M_PI * (pilot - pilot_dev) / input_rate;
+    d_max_freq = 2.0 * M_PI * (pilot + pilot_dev) / input_rate;
+    d_lpf_alpha = 1.0 - exp(-2.0 * M_PI * STEREO_PILOT_LPF / input_rate);
+    d_pilot[0] = d_pilot[1] = gr_complex(0.0f, 0.0f);
+
+    std::vector<double> fftaps, fbtaps;
+    fm_deemph::iir_taps((double)input_rate / decim, STEREO_DEEMPH_TAU, fftaps, fbtaps);
+    d_b0 = fftaps[0];
+    d_b1 = fftaps[1];
+    d_p1 = -fbtaps[1];
+}
+
+stereo_decoder_ff::~stereo_decoder_ff()
+{
+}
+
+int stereo_decoder_ff::work(int noutput_items,
+                            gr_vector_const_void_star &input_items,
+                            gr_vector_void_star &output_items)
+{
+    const float *in = (const float *) input_items[0];
+    float *left = (float *) output_items[0];
+    float *right = (float *) output_items[1];
+    const unsigned int ntaps = d_sum_taps.size();
+    const unsigned int decim = decimation();
+    const int nin = noutput_items * decim;
+
+    if (d_stereo)
+    {
+        d_mix.resize(ntaps - 1 + nin);
+        mix(in + ntaps - 1, d_mix.data() + ntaps - 1, nin);
+    }
+
+    for (int k = 0; k < noutput_items; k++)
+    {
+        float sum;
+        float diff = 0.0f;
+
+        volk_32f_x2_dot_prod_32f(&sum, in + k * decim, d_sum_taps.data(), ntaps);
+        if (d_stereo)
+            volk_32f_x2_dot_prod_32f(&diff, d_mix.data() + k * decim, d_diff_taps.data(), ntaps);
+        left[k] = deemph(sum + diff, d_left);
+        right[k] = d_stereo ? deemph(sum - diff, d_right) : left[k];
+    }
+
+    // Keep the history of the difference filter
+    if (d_stereo)
+    {
+        std::copy(d_mix.end() - (ntaps - 1), d_mix.end(), d_mix.begin());
+        d_mix.resize(ntaps - 1);
+    }
+
+    return noutput_items;
+}
+
+/* Track the pilot and mix the composite with the subcarrier */
+void stereo_decoder_ff::mix(const float *in, float *out, int length)
+{
+    for (int i = 0; i < length; i++)
+    {
+        float s, c;
+        gr::sincosf(d_phase, &s, &c);
+
+        // The pilot is the positive frequency of the composite at DC
+        const gr_complex down(in[i] * c, -in[i] * s);
+        d_pilot[0] += d_lpf_alpha * (down - d_pilot[0]);
+        d_pilot[1] += d_lpf_alpha * (d_pilot[0] - d_pilot[1]);
+        const float error = gr::fast_atan2f(d_pilot[1].imag(), d_pilot[1].real());
+
+        // The subcarrier is the pilot in OIRT and its second harmonic otherwise
+        out[i] = in[i] * (d_oirt ? s : 2.0f * s * c);
+
+        d_freq = std::min(std::max(d_freq + d_beta * error, d_min_freq), d_max_freq);
+        d_phase += d_freq + d_alpha * error;
+        if (d_phase > (float)M_PI)
+            d_phase -= 2.0f * (float)M_PI;
+        else if (d_phase < -(float)M_PI)
+            d_phase += 2.0f * (float)M_PI;
+    }
+}
+
+/* One pole de-emphasis, state holds the last input and output */
+float stereo_decoder_ff::deemph(float x, float state[2]) const
+{
+    const float y = d_b0 * x + d_b1 * state[0] + d_p1 * state[1];
+
+    state[0] = x;
+    state[1] = y;
+
+    return y;
+}
 
 
 /* Create a new instance of stereo_demod and return a shared_ptr. */
@@ -54,96 +188,35 @@ stereo_demod::stereo_demod(float input_rate, float audio_rate, bool stereo, bool
     d_stereo(stereo),
     d_oirt(oirt)
 {
-  double cutof_freq = d_oirt ? 15e3 : 17e3;
-  lpf0 = make_lpf_ff((double)d_input_rate, cutof_freq, 2e3); // FIXME
-  audio_rr0 = make_resampler_ff(d_audio_rate/d_input_rate);
-  deemph0 = make_fm_deemph(d_audio_rate, 50.0e-6);
-
-  if (d_stereo)
-  {
-    lpf1 = make_lpf_ff((double)d_input_rate, cutof_freq, 2e3, -2.1); // FIXME
-    audio_rr1 = make_resampler_ff(d_audio_rate/d_input_rate);
-    deemph1 = make_fm_deemph(d_audio_rate, 50.0e-6);
-
-    if (!d_oirt)
-    {
-        d_tone_taps = gr::filter::firdes::complex_band_pass(
-                                       1.0,                  // gain,
-                                       (double)d_input_rate, // sampling_freq
-                                       18980.,               // low_cutoff_freq
-                                       19020.,               // high_cutoff_freq
-                                       5000.);               // transition_width
-        pll = gr::analog::pll_refout_cc::make(0.0002,    // loop_bw FIXME
-                                2 * (float)M_PI * 19020 / input_rate,  // max_freq
-                                2 * (float)M_PI * 18980 / input_rate); // min_freq
-        subtone = gr::blocks::multiply_cc::make();
-    } else {
-        d_tone_taps = gr::filter::firdes::complex_band_pass(
-                                       1.0,                  // gain,
-                                       (double)d_input_rate, // sampling_freq
-                                       31200.,               // low_cutoff_freq
-                                       31300.,               // high_cutoff_freq
-                                       5000.);               // transition_width
-        pll = gr::analog::pll_refout_cc::make(0.0002,    // loop_bw FIXME
-                                2 * (float)M_PI * 31200 / input_rate,  // max_freq
-                                2 * (float)M_PI * 31300 / input_rate); // min_freq
-    }
-
-    tone = gr::filter::fir_filter_fcc::make(1, d_tone_taps);
-    delay = gr::blocks::delay::make(sizeof(float), (d_tone_taps.size() - 1) / 2);
-
-    lo = gr::blocks::complex_to_imag::make();
+    const unsigned int decim = std::max(1, (int)floor(d_input_rate / d_audio_rate + 0.001f));
+    const float decim_rate = d_input_rate / decim;
 
-    mixer = gr::blocks::multiply_ff::make();
+    decoder = make_stereo_decoder_ff(d_input_rate, decim, d_stereo, d_oirt);
+    connect(self(), 0, decoder, 0);
 
-    add = gr::blocks::add_ff::make();
-    sub = gr::blocks::sub_ff::make();
-
-    /* connect block */
-    if (!d_oirt) {
-        connect(self(), 0, tone, 0);
-        connect(self(), 0, delay, 0);
-        connect(tone, 0, pll, 0);
-        connect(pll, 0, subtone, 0);
-        connect(pll, 0, subtone, 1);
-        connect(subtone, 0, lo, 0);
-
-        connect(lo, 0, mixer, 0);
-    } else {
-        connect(self(), 0, tone, 0);
-        connect(self(), 0, delay, 0);
-        connect(tone, 0, pll, 0);
-        connect(pll, 0, lo, 0);
-        connect(lo, 0, mixer, 0);
+    if (fabsf(decim_rate - d_audio_rate) < 0.5f)
+    {
+        connect(decoder, 0, self(), 0);
+        connect(decoder, 1, self(), 1);
+    }
+    else if (d_stereo)
+    {
+        audio_rr0 = make_resampler_ff(d_audio_rate / decim_rate);
+        audio_rr1 = make_resampler_ff(d_audio_rate / decim_rate);
+        connect(decoder, 0, audio_rr0, 0);
+        connect(decoder, 1, audio_rr1, 0);
+        connect(audio_rr0, 0, self(), 0);
+        connect(audio_rr1, 0, self(), 1);
+    }
+    else
+    {
+        // Both outputs of the decoder are the same
+        audio_rr0 = make_resampler_ff(d_audio_rate / decim_rate);
+        connect(decoder, 0, audio_rr0, 0);
+        connect(decoder, 1, gr::blocks::null_sink::make(sizeof(float)), 0);
+        connect(audio_rr0, 0, self(), 0);
+        connect(audio_rr0, 0, self(), 1);
     }
-
-    connect(delay, 0, mixer, 1);
-
-    connect(delay, 0, lpf0, 0);
-    connect(mixer, 0, lpf1, 0);
-
-    connect(lpf0, 0, audio_rr0, 0); // sum
-    connect(lpf1, 0, audio_rr1, 0); // delta
-
-    connect(audio_rr0, 0, add,   0);
-    connect(audio_rr1, 0, add,   1);
-    connect(add,       0, deemph0, 0);
-    connect(deemph0,   0, self(), 0); // left = sum + delta
-
-    connect(audio_rr0, 0, sub,   0);
-    connect(audio_rr1, 0, sub,   1);
-    connect(sub,       0, deemph1, 0);
-    connect(deemph1,   0, self(), 1); // right = sum - delta
-  }
-  else // if (!d_stereo)
-  {
-    /* connect block */
-    connect(self(), 0, lpf0, 0);
-    connect(lpf0,   0, audio_rr0, 0);
-    connect(audio_rr0, 0, deemph0, 0);
-    connect(deemph0, 0, self(), 0);
-    connect(deemph0, 0, self(), 1);
-  }
 }
 
 
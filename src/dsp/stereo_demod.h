@@ -24,31 +24,104 @@
 #ifndef STEREO_DEMOD_H
 #define STEREO_DEMOD_H
 
+#include <gnuradio/gr_complex.h>
 #include <gnuradio/hier_block2.h>
-#include <gnuradio/analog/pll_refout_cc.h>
-#include <gnuradio/blocks/add_blk.h>
-#include <gnuradio/blocks/complex_to_imag.h>
-#include <gnuradio/blocks/delay.h>
-#include <gnuradio/blocks/multiply.h>
-#include <gnuradio/blocks/multiply_const.h>
-#include <gnuradio/blocks/sub.h>
-#include <gnuradio/filter/firdes.h>
-#include <gnuradio/filter/fir_filter_blk.h>
+#include <gnuradio/sync_decimator.h>
 #include <vector>
-#include "dsp/fm_deemph.h"
-#include "dsp/lpf.h"
 #include "dsp/resampler_xx.h"
 
+/* Loop bandwidth of the pilot PLL in rad/sample */
+#define STEREO_PLL_BW           0.0002
 
+/* Corner of the two poles that take the pilot down to DC in the PLL */
+#define STEREO_PILOT_LPF        1000.0
+
+/* Transition width of the audio filters */
+#define STEREO_AUDIO_TRANS      2e3
+
+/* Gain of the difference signal, 2 for the 38 kHz mixing and a bit */
+#define STEREO_DIFF_GAIN        -2.1
+
+/* De-emphasis time constant */
+#define STEREO_DEEMPH_TAU       50.0e-6
+
+
+class stereo_decoder_ff;
 class stereo_demod;
 
 #if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<stereo_decoder_ff> stereo_decoder_ff_sptr;
 typedef boost::shared_ptr<stereo_demod> stereo_demod_sptr;
 #else
+typedef std::shared_ptr<stereo_decoder_ff> stereo_decoder_ff_sptr;
 typedef std::shared_ptr<stereo_demod> stereo_demod_sptr;
 #endif
 
 
+stereo_decoder_ff_sptr make_stereo_decoder_ff(float input_rate, unsigned int decim,
+                                              bool stereo, bool oirt);
+
+/*! \brief FM stereo decoder in a single block.
+ *  \ingroup DSP
+ *
+ * Takes the FM composite signal to left and right audio, decimated by
+ * decim, in one pass: a PLL locks to the pilot, the composite is mixed
+ * with the subcarrier regenerated from it, the sum and difference are
+ * low pass filtered and decimated, computing only the outputs that are
+ * kept, and then matrixed to left and right and de-emphasized.
+ *
+ * The PLL mixes the composite down with its own oscillator and takes the
+ * phase error of the pilot after two poles at STEREO_PILOT_LPF, which
+ * keep the audio around the pilot out of the loop without the long band
+ * pass filter the pilot would otherwise need.
+ *
+ * In mono only the sum is filtered, and both outputs carry it.
+ */
+class stereo_decoder_ff : public gr::sync_decimator
+{
+    friend stereo_decoder_ff_sptr make_stereo_decoder_ff(float input_rate, unsigned int decim,
+                                                         bool stereo, bool oirt);
+
+protected:
+    stereo_decoder_ff(float input_rate, unsigned int decim, bool stereo, bool oirt);
+
+public:
+    ~stereo_decoder_ff();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+private:
+    void mix(const float *in, float *out, int length);
+    float deemph(float x, float state[2]) const;
+
+    bool  d_stereo;
+    bool  d_oirt;       /*!< 31.25 kHz polar modulation rather than a 38 kHz subcarrier. */
+
+    std::vector<float> d_sum_taps;
+    std::vector<float> d_diff_taps;
+    std::vector<float> d_mix;   /*!< Difference signal with the history of the filter. */
+
+    /* pilot PLL */
+    float d_phase;
+    float d_freq;               /*!< In rad/sample. */
+    float d_min_freq;
+    float d_max_freq;
+    float d_alpha;
+    float d_beta;
+    float d_lpf_alpha;
+    gr_complex d_pilot[2];      /*!< The pilot after each pole. */
+
+    /* de-emphasis */
+    float d_b0;
+    float d_b1;
+    float d_p1;
+    float d_left[2];            /*!< Last input and output. */
+    float d_right[2];
+};
+
+
 /*! \brief Return a shared_ptr to a new instance of stere_demod.
  *  \param quad_rate The input sample rate.
  *  \param audio_rate The audio rate.
@@ -68,6 +141,9 @@ stereo_demod_sptr make_stereo_demod(float quad_rate=120e3,
  *
  * This class implements the stereo demodulator for 87.5...108 MHz band.
  *
+ * The decoding is done by a stereo_decoder_ff, decimating by as much as
+ * the audio rate allows. Resamplers follow only when the audio rate is not
+ * an integer fraction of the input rate.
  */
 class stereo_demod : public gr::hier_block2
 {
@@ -84,28 +160,15 @@ public:
 
 private:
     /* GR blocks */
-    gr::filter::fir_filter_fcc::sptr  tone;  /*!< Pilot tone BPF. */
-    gr::blocks::delay::sptr           delay; /*!< Delay to match pilot tone BPF. */
-    gr::analog::pll_refout_cc::sptr   pll;   /*!< Pilot tone PLL. */
-    gr::blocks::multiply_cc::sptr subtone;   /*!< Stereo subtone. */
-    gr::blocks::complex_to_imag::sptr lo;    /*!< Complex tone imag. */
-    gr::blocks::multiply_ff::sptr mixer;     /*!< Balance mixer. */
-    lpf_ff_sptr lpf0;              /*!< Low-pass filter #0. */
-    lpf_ff_sptr lpf1;              /*!< Low-pass filter #1. */
-    resampler_ff_sptr audio_rr0;   /*!< Audio resampler #0. */
-    resampler_ff_sptr audio_rr1;   /*!< Audio resampler #1. */
-    fm_deemph_sptr deemph0;        /*!< FM de-emphasis #0. */
-    fm_deemph_sptr deemph1;        /*!< FM de-emphasis #1. */
-    gr::blocks::add_ff::sptr add;  /*!< Left stereo channel. */
-    gr::blocks::sub_ff::sptr sub;  /*!< Right stereo channel. */
+    stereo_decoder_ff_sptr decoder;  /*!< Pilot PLL, matrix and de-emphasis. */
+    resampler_ff_sptr audio_rr0;     /*!< Audio resampler #0, if needed. */
+    resampler_ff_sptr audio_rr1;     /*!< Audio resampler #1, if needed. */
 
     /* other parameters */
     float d_input_rate;                  /*! Input rate. */
     float d_audio_rate;                  /*! Audio rate. */
     bool  d_stereo;                      /*! On/off stereo mode. */
     bool  d_oirt;
-    std::vector<gr_complex> d_tone_taps; /*! Tone BPF taps. */
-    std::vector<float> d_pll_taps;       /*! Subtone BPF taps. */
 };
 
 
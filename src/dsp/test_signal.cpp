@@ -0,0 +1,277 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+#include <gnuradio/analog/frequency_modulator_fc.h>
+#include <gnuradio/analog/noise_source.h>
+#include <gnuradio/analog/sig_source.h>
+#include <gnuradio/blocks/add_blk.h>
+#include <gnuradio/blocks/multiply_const.h>
+#include <gnuradio/blocks/null_sink.h>
+#include <gnuradio/blocks/rotator_cc.h>
+#include <gnuradio/blocks/throttle.h>
+#include <gnuradio/blocks/vector_source.h>
+#include <gnuradio/blocks/wavfile_source.h>
+#include <gnuradio/filter/firdes.h>
+#include <gnuradio/io_signature.h>
+
+#include "dsp/resampler_xx.h"
+#include "dsp/test_signal.h"
+
+/* Symbols in the repeated PSK and FSK sequence */
+#define TEST_SIGNAL_SYMBOLS 1024
+
+/* Excess bandwidth and length in symbols of the PSK pulses */
+#define TEST_SIGNAL_RRC_ALPHA 0.35
+#define TEST_SIGNAL_RRC_SPAN  11
+
+/* Tone that is the FM program without an audio file */
+#define TEST_SIGNAL_FM_TONE 1000.0
+
+bool test_signal_params::parse(const std::string &device, test_signal_params &params)
+{
+    if (device.compare(0, sizeof(TEST_SIGNAL_DEVICE) - 1, TEST_SIGNAL_DEVICE) != 0)
+        return false;
+
+    params = test_signal_params();
+    std::istringstream fields(device.substr(sizeof(TEST_SIGNAL_DEVICE) - 1));
+    std::string field;
+    bool first = true;
+    while (std::getline(fields, field, ','))
+    {
+        std::string key = first ? "type" : field.substr(0, field.find('='));
+        std::string value = first ? field : (field.find('=') == std::string::npos
+                                             ? "" : field.substr(field.find('=') + 1));
+        first = false;
+
+        if (key == "type")
+        {
+            static const char *types[] = { "tone", "noise", "fm", "psk", "fsk" };
+            for (int i = 0; i < (int)(sizeof(types) / sizeof(types[0])); i++)
+                if (value == types[i])
+                    params.type = (signal_type)i;
+        }
+        else if (key == "rate")
+            params.rate = std::max(std::atof(value.c_str()), 1e3);
+        else if (key == "freq")
+            params.freq = std::atof(value.c_str());
+        else if (key == "offset")
+            params.offset = std::atof(value.c_str());
+        else if (key == "level")
+            params.level = std::atof(value.c_str());
+        else if (key == "noise")
+            params.noise = std::atof(value.c_str());
+        else if (key == "symrate")
+            params.symbol_rate = std::max(std::atof(value.c_str()), 1.0);
+        else if (key == "bits")
+            params.bits = std::min(std::max(std::atoi(value.c_str()), 1), 3);
+        else if (key == "dev")
+            params.deviation = std::atof(value.c_str());
+        else if (key == "audio")
+            params.audio = value;
+        else if (key == "throttle")
+            params.throttle = std::atoi(value.c_str()) != 0;
+    }
+    return true;
+}
+
+test_signal_source_sptr make_test_signal_source(const test_signal_params &params)
+{
+    return gnuradio::get_initial_sptr(new test_signal_source(params));
+}
+
+test_signal_source::test_signal_source(const test_signal_params &params)
+    : gr::hier_block2 ("test_signal_source",
+                      gr::io_signature::make (0, 0, 0),
+                      gr::io_signature::make (1, 1, sizeof (gr_complex))),
+      d_params(params)
+{
+    const double rate = d_params.rate;
+    const float amplitude = std::pow(10.0, d_params.level / 20.0);
+
+    // Every signal but the tone is made at 0 Hz and moved to the offset
+    gr::basic_block_sptr signal;
+    switch (d_params.type)
+    {
+    case test_signal_params::NOISE:
+        break;
+    case test_signal_params::FM:
+        signal = make_fm();
+        break;
+    case test_signal_params::PSK:
+        signal = make_psk();
+        break;
+    case test_signal_params::FSK:
+        signal = make_fsk();
+        break;
+    case test_signal_params::TONE:
+    default:
+        signal = gr::analog::sig_source_c::make(rate, gr::analog::GR_COS_WAVE,
+                                                d_params.offset, amplitude);
+        break;
+    }
+    if (signal && d_params.type != test_signal_params::TONE)
+    {
+        auto gain = gr::blocks::multiply_const_cc::make(amplitude);
+        connect(signal, 0, gain, 0);
+        signal = gain;
+        if (d_params.offset != 0.0)
+        {
+            auto rotator = gr::blocks::rotator_cc::make(2.0 * M_PI * d_params.offset / rate);
+            connect(signal, 0, rotator, 0);
+            signal = rotator;
+        }
+    }
+
+    gr::basic_block_sptr out = signal;
+    if (d_params.noise > -200.0)
+    {
+        auto noise = gr::analog::noise_source_c::make(gr::analog::GR_GAUSSIAN,
+                                                      std::pow(10.0, d_params.noise / 20.0), 1);
+        if (signal)
+        {
+            auto add = gr::blocks::add_cc::make();
+            connect(signal, 0, add, 0);
+            connect(noise, 0, add, 1);
+            out = add;
+        }
+        else
+        {
+            out = noise;
+        }
+    }
+    else if (!signal)
+    {
+        out = gr::analog::sig_source_c::make(rate, gr::analog::GR_CONST_WAVE, 0.0, 0.0);
+    }
+
+    if (d_params.throttle)
+    {
+        auto throttle = gr::blocks::throttle::make(sizeof(gr_complex), rate);
+        connect(out, 0, throttle, 0);
+        out = throttle;
+    }
+    connect(out, 0, self(), 0);
+}
+
+test_signal_source::~test_signal_source()
+{
+}
+
+/* FM of the audio file at the rate, or of a tone if it can not be read */
+gr::basic_block_sptr test_signal_source::make_fm()
+{
+    const double rate = d_params.rate;
+    gr::basic_block_sptr audio;
+
+    if (!d_params.audio.empty())
+    {
+        try
+        {
+            auto wav = gr::blocks::wavfile_source::make(d_params.audio.c_str(), true);
+            for (int ch = 1; ch < wav->channels(); ch++)
+                connect(wav, ch, gr::blocks::null_sink::make(sizeof(float)), 0);
+            auto resampler = make_resampler_ff(rate / wav->sample_rate());
+            connect(wav, 0, resampler, 0);
+            audio = resampler;
+        }
+        catch (std::exception &x)
+        {
+            std::cerr << "Test signal: can not read " << d_params.audio << ": " << x.what()
+                      << ", using a tone" << std::endl;
+        }
+    }
+    if (!audio)
+        audio = gr::analog::sig_source_f::make(rate, gr::analog::GR_SIN_WAVE, TEST_SIGNAL_FM_TONE, 1.0);
+
+    auto modulator = gr::analog::frequency_modulator_fc::make(2.0 * M_PI * d_params.deviation / rate);
+    connect(audio, 0, modulator, 0);
+    return modulator;
+}
+
+/*
+ * Random PSK symbols shaped by root raised cosine pulses, computed once as
+ * a circular sequence so that it repeats without a seam.
+ */
+gr::basic_block_sptr test_signal_source::make_psk()
+{
+    const int sps = std::max(1, (int)std::lround(d_params.rate / d_params.symbol_rate));
+    const int order = 1 << d_params.bits;
+    const int length = TEST_SIGNAL_SYMBOLS * sps;
+
+    std::vector<float> taps = gr::filter::firdes::root_raised_cosine(
+        1.0, (double)sps, 1.0, TEST_SIGNAL_RRC_ALPHA, TEST_SIGNAL_RRC_SPAN * sps | 1);
+    double energy = 0.0;
+    for (float t : taps)
+        energy += (double)t * t;
+    const float norm = (float)std::sqrt(sps / energy);
+
+    std::mt19937 rng(1);
+    std::vector<gr_complex> samples(length);
+    const int center = (int)taps.size() / 2;
+    for (int s = 0; s < TEST_SIGNAL_SYMBOLS; s++)
+    {
+        const int k = (int)(rng() % order);
+        const gr_complex symbol = std::polar(norm, (float)(M_PI * (2 * k + 1) / order));
+        for (int t = 0; t < (int)taps.size(); t++)
+        {
+            const int i = ((s * sps + t - center) % length + length) % length;
+            samples[i] += symbol * taps[t];
+        }
+    }
+    return gr::blocks::vector_source_c::make(samples, true);
+}
+
+/*
+ * Random bits as continuous phase FSK. There are as many ones as zeros, so
+ * the phase is back where it started at the end of the sequence.
+ */
+gr::basic_block_sptr test_signal_source::make_fsk()
+{
+    const int sps = std::max(1, (int)std::lround(d_params.rate / d_params.symbol_rate));
+    const double step = 2.0 * M_PI * d_params.deviation / d_params.rate;
+
+    std::vector<int> bits(TEST_SIGNAL_SYMBOLS);
+    for (int s = 0; s < TEST_SIGNAL_SYMBOLS; s++)
+        bits[s] = s & 1;
+    std::shuffle(bits.begin(), bits.end(), std::mt19937(1));
+
+    std::vector<gr_complex> samples(TEST_SIGNAL_SYMBOLS * sps);
+    double phase = 0.0;
+    for (int s = 0; s < TEST_SIGNAL_SYMBOLS; s++)
+    {
+        const double inc = bits[s] ? step : -step;
+        for (int i = 0; i < sps; i++)
+        {
+            samples[s * sps + i] = std::polar(1.0f, (float)phase);
+            phase = std::fmod(phase + inc, 2.0 * M_PI);
+        }
+    }
+    return gr::blocks::vector_source_c::make(samples, true);
+}
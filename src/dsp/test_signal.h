@@ -0,0 +1,106 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef TEST_SIGNAL_H
+#define TEST_SIGNAL_H
+
+#include <string>
+#include <gnuradio/hier_block2.h>
+
+/* Prefix of the input device strings that select a test signal */
+#define TEST_SIGNAL_DEVICE "test="
+
+/*! \brief What a test_signal_source generates.
+ *
+ * As an input device string, "test=<type>" followed by ",<key>=<value>"
+ * for the fields, e.g. "test=psk,offset=50e3,level=-30,symrate=25e3".
+ * The keys are rate, freq, offset, level, noise, symrate, bits, dev,
+ * audio and throttle.
+ */
+struct test_signal_params
+{
+    enum signal_type {
+        TONE  = 0,      /*!< Carrier at the offset. */
+        NOISE = 1,      /*!< Only the noise floor. */
+        FM    = 2,      /*!< FM of the audio file, or a 1 kHz tone. */
+        PSK   = 3,      /*!< Random symbols with root raised cosine pulses. */
+        FSK   = 4       /*!< Random bits, two tones dev apart from the offset. */
+    };
+
+    signal_type type = TONE;
+    double      rate = 2.4e6;       /*!< Sample rate. */
+    double      freq = 100e6;       /*!< Center frequency the device reports. */
+    double      offset = 0.0;       /*!< Of the signal from the center in Hz. */
+    double      level = -30.0;      /*!< Power of the signal in dBFS. */
+    double      noise = -90.0;      /*!< Power of the noise in dBFS, off below -200. */
+    double      symbol_rate = 10e3; /*!< PSK and FSK. */
+    int         bits = 2;           /*!< Per PSK symbol: 1 BPSK, 2 QPSK, 3 8PSK. */
+    double      deviation = 5e3;    /*!< FM peak deviation and FSK shift each way. */
+    std::string audio;              /*!< WAV program of the FM signal. */
+    bool        throttle = true;    /*!< Pace at the rate, off for benchmarks. */
+
+    /*! \brief Parse a device string, false if it is not a test signal. */
+    static bool parse(const std::string &device, test_signal_params &params);
+};
+
+class test_signal_source;
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<test_signal_source> test_signal_source_sptr;
+#else
+typedef std::shared_ptr<test_signal_source> test_signal_source_sptr;
+#endif
+
+/*! \brief Return a shared_ptr to a new instance of test_signal_source.
+ *  \param params The signal, at params.rate.
+ */
+test_signal_source_sptr make_test_signal_source(const test_signal_params &params);
+
+/*! \brief Synthetic I/Q: tone, noise, FM, PSK or FSK over a noise floor.
+ *  \ingroup DSP
+ *
+ * The same signals the transmitter scripts sent, made with the GNU Radio
+ * blocks in our flow graph: the receiver takes it as its input for
+ * calibration and benchmarks without hardware, and test_transmitter sends
+ * it to a device. The data of PSK and FSK is a fixed random sequence, the
+ * PSK pulses are normalized so that level is the average power.
+ */
+class test_signal_source : public gr::hier_block2
+{
+    friend test_signal_source_sptr make_test_signal_source(const test_signal_params &params);
+
+protected:
+    test_signal_source(const test_signal_params &params);
+
+public:
+    ~test_signal_source();
+
+    const test_signal_params &params() const { return d_params; }
+
+private:
+    gr::basic_block_sptr make_fm();
+    gr::basic_block_sptr make_psk();
+    gr::basic_block_sptr make_fsk();
+
+    test_signal_params  d_params;
+};
+
+#endif // TEST_SIGNAL_H
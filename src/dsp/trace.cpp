@@ -0,0 +1,199 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include "dsp/trace.h"
+
+#ifdef WITH_TRACING
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+namespace trace
+{
+
+namespace
+{
+
+struct Event
+{
+    const char *cat;
+    const char *name;
+    uint64_t    start_ns;
+    uint64_t    dur_ns;
+    bool        instant;
+};
+
+/* Ring of one thread, written by that thread only */
+struct Buffer
+{
+    std::atomic<uint64_t> head{0};  // events written so far
+    Event                 events[TRACE_BUFFER_EVENTS];
+    int                   tid{0};
+    std::string           name;     // under buffers_lock
+};
+
+const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+// The buffers outlive their threads, so that a dump still has the events of
+// a flow graph that has been stopped. There are only a few threads that trace.
+std::mutex              buffers_lock;
+std::vector<Buffer *>   buffers;
+thread_local Buffer    *local_buffer = nullptr;
+
+Buffer *thread_buffer()
+{
+    if (local_buffer)
+        return local_buffer;
+
+    Buffer *buf = new Buffer();
+#ifdef __linux__
+    // GNU Radio names its threads after the blocks, Qt after the QThread
+    char name[16];
+    if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0)
+        buf->name = name;
+#endif
+    std::lock_guard<std::mutex> lock(buffers_lock);
+    buf->tid = (int)buffers.size() + 1;
+    buffers.push_back(buf);
+    local_buffer = buf;
+    return buf;
+}
+
+void record(const Event &event)
+{
+    Buffer *buf = thread_buffer();
+    const uint64_t n = buf->head.load(std::memory_order_relaxed);
+    buf->events[n % TRACE_BUFFER_EVENTS] = event;
+    buf->head.store(n + 1, std::memory_order_release);
+}
+
+void write_string(FILE *out, const std::string &s)
+{
+    std::fputc('"', out);
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            std::fputc('\\', out);
+        if ((unsigned char)c >= 0x20)
+            std::fputc(c, out);
+    }
+    std::fputc('"', out);
+}
+
+} // namespace
+
+uint64_t now_ns()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - origin).count();
+}
+
+void complete(const char *cat, const char *name, uint64_t start_ns, uint64_t dur_ns)
+{
+    record({cat, name, start_ns, dur_ns, false});
+}
+
+void instant(const char *cat, const char *name)
+{
+    record({cat, name, now_ns(), 0, true});
+}
+
+/** Name the calling thread in the trace, instead of the name it has. */
+void set_thread_name(const std::string &name)
+{
+    Buffer *buf = thread_buffer();
+    std::lock_guard<std::mutex> lock(buffers_lock);
+    buf->name = name;
+}
+
+/**
+ * Write the events of all threads to path.
+ *
+ * The threads keep recording meanwhile. Events a thread may have overwritten
+ * while its ring was copied are left out, the rest are consistent.
+ */
+bool dump(const std::string &path)
+{
+    std::vector<const Buffer *> list;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(buffers_lock);
+        list.assign(buffers.begin(), buffers.end());
+        for (const Buffer *buf : buffers)
+            names.push_back(buf->name);
+    }
+
+    FILE *out = std::fopen(path.c_str(), "w");
+    if (!out)
+        return false;
+
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", out);
+    bool first = true;
+    std::vector<Event> events;
+    for (size_t i = 0; i < list.size(); i++)
+    {
+        const Buffer *buf = list[i];
+        const uint64_t end = buf->head.load(std::memory_order_acquire);
+        const uint64_t begin = end > TRACE_BUFFER_EVENTS ? end - TRACE_BUFFER_EVENTS : 0;
+        events.clear();
+        for (uint64_t n = begin; n < end; n++)
+            events.push_back(buf->events[n % TRACE_BUFFER_EVENTS]);
+
+        // The writer may be on the slot after the last one it has published
+        const uint64_t after = buf->head.load(std::memory_order_acquire) + 1;
+        const uint64_t valid = after > TRACE_BUFFER_EVENTS ? after - TRACE_BUFFER_EVENTS : 0;
+        const size_t skip = (size_t)(std::max(valid, begin) - begin);
+
+        std::fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                     first ? "" : ",\n", buf->tid);
+        write_string(out, names[i].empty() ? "thread " + std::to_string(buf->tid) : names[i]);
+        std::fputs("}}", out);
+        first = false;
+
+        for (size_t k = std::min(skip, events.size()); k < events.size(); k++)
+        {
+            const Event &ev = events[k];
+            if (ev.instant)
+                std::fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\","
+                             "\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+                             ev.name, ev.cat, ev.start_ns / 1e3, buf->tid);
+            else
+                std::fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                             "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                             ev.name, ev.cat, ev.start_ns / 1e3, ev.dur_ns / 1e3, buf->tid);
+        }
+    }
+    std::fputs("\n]}\n", out);
+
+    return std::fclose(out) == 0;
+}
+
+} // namespace trace
+
+#endif // WITH_TRACING
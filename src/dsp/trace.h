@@ -0,0 +1,97 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * Trace points of the hot paths, dumped as a Chrome trace for chrome://tracing
+ * or https://ui.perfetto.dev.
+ *
+ * Only built with -DENABLE_TRACING=ON, otherwise the macros are empty and
+ * nothing is recorded. Each thread records into a ring of its own, so that
+ * recording takes two clock reads and a store, without locks. The rings are
+ * read by trace::dump(), for example from the TRACE command of the remote
+ * control.
+ *
+ *   TRACE_SCOPE("dsp", "rx_fft_c::get_fft_data");
+ *
+ * The category and the name must be string literals, only their pointers
+ * are stored.
+ */
+#ifdef WITH_TRACING
+
+#include <cstdint>
+#include <string>
+
+/* Events kept per thread, older ones are overwritten */
+#define TRACE_BUFFER_EVENTS 16384
+
+namespace trace
+{
+
+uint64_t now_ns();
+void     complete(const char *cat, const char *name, uint64_t start_ns, uint64_t dur_ns);
+void     instant(const char *cat, const char *name);
+void     set_thread_name(const std::string &name);
+
+/* Write the events of all threads as Chrome trace JSON, false on failure */
+bool     dump(const std::string &path);
+
+/* Records a complete event from construction to destruction */
+class Scope
+{
+public:
+    Scope(const char *cat, const char *name) :
+        d_cat(cat),
+        d_name(name),
+        d_start(now_ns())
+    {
+    }
+    ~Scope() { complete(d_cat, d_name, d_start, now_ns() - d_start); }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *d_cat;
+    const char *d_name;
+    uint64_t    d_start;
+};
+
+} // namespace trace
+
+#define TRACE_CONCAT_(a, b)         a##b
+#define TRACE_CONCAT(a, b)          TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(cat, name)      trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(cat, name)
+#define TRACE_INSTANT(cat, name)    trace::instant(cat, name)
+#define TRACE_THREAD_NAME(name)     trace::set_thread_name(name)
+
+#else
+
+#define TRACE_SCOPE(cat, name)      ((void)0)
+#define TRACE_INSTANT(cat, name)    ((void)0)
+#define TRACE_THREAD_NAME(name)     ((void)0)
+
+#endif // WITH_TRACING
+
+#endif // TRACE_H
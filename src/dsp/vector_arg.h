@@ -0,0 +1,72 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef VECTOR_ARG_H
+#define VECTOR_ARG_H
+
+#include <algorithm>
+#include <cfloat>
+#include <math.h>
+#include <gnuradio/gr_complex.h>
+
+/* atan(a) on [0, 1] as a polynomial in a, an error of about 6e-4 rad */
+static inline float atan_fast(float a)
+{
+    const float s = a * a;
+    return a * (0.995354f + s * (-0.288679f + s * 0.079331f));
+}
+
+/* The same with an error of about 1e-5 rad */
+static inline float atan_accurate(float a)
+{
+    const float s = a * a;
+    return a * (0.9998660f + s * (-0.3302995f + s * (0.1801410f + s * (-0.0851330f + s * 0.0208351f))));
+}
+
+/* Branch free atan2 of each sample times gain, for the vectorizer */
+template <float (*ATAN)(float)>
+static inline void vector_arg(const gr_complex *in, float *out, int num, float gain)
+{
+    const float *iq = (const float *) in;
+
+    for (int i = 0; i < num; i++)
+    {
+        const float re = iq[2 * i];
+        const float im = iq[2 * i + 1];
+        const float ax = fabsf(re);
+        const float ay = fabsf(im);
+        // Never 0 / 0, and no branch around the division
+        const float mx = std::max(std::max(ax, ay), FLT_MIN);
+        const float mn = std::min(ax, ay);
+        float r = ATAN(mn / mx);
+
+        // The octant by arithmetic, as the vectorizer takes ?: of constants
+        // but not of these values
+        const float swap = ay > ax ? 1.0f : 0.0f;
+        const float left = re < 0.0f ? 1.0f : 0.0f;
+        r += swap * ((float)M_PI_2 - 2.0f * r);
+        r += left * ((float)M_PI - 2.0f * r);
+        out[i] = copysignf(r, im) * gain;
+    }
+}
+
+#endif /* VECTOR_ARG_H */
@@ -0,0 +1,158 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <gnuradio/io_signature.h>
+#include "dsp/zoom_fft.h"
+
+zoom_fft_c_sptr make_zoom_fft_c(unsigned int fftsize, double samp_rate)
+{
+    return gnuradio::get_initial_sptr(new zoom_fft_c(fftsize, samp_rate));
+}
+
+zoom_fft_c::zoom_fft_c(unsigned int fftsize, double samp_rate)
+    : gr::hier_block2("zoom_fft_c",
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          gr::io_signature::make(0, 0, 0)),
+      d_decim(1),
+      d_samp_rate(samp_rate),
+      d_center_freq(0.0)
+{
+    ddc = make_downconverter_cc(1, 0.0, d_samp_rate);
+    fft = make_rx_fft_c(std::min(fftsize, (unsigned int)MAX_ZOOM_FFT_SIZE),
+                        d_samp_rate, gr::fft::window::WIN_HANN);
+
+    connect_all();
+    restart_settling();
+}
+
+zoom_fft_c::~zoom_fft_c()
+{
+
+}
+
+/*! \brief Set new input sample rate. */
+void zoom_fft_c::set_samp_rate(double samp_rate)
+{
+    d_samp_rate = samp_rate;
+    ddc->set_decim_and_samp_rate(1, d_samp_rate);
+    ddc->set_center_freq(d_center_freq);
+    fft->set_quad_rate(d_samp_rate / d_decim);
+    restart_settling();
+}
+
+/*! \brief Set the zoomed part of the spectrum.
+ *  \param center_freq Center of the zoomed span, relative to the baseband center.
+ *  \param span Width of the zoomed span in Hz.
+ *
+ * Changing the decimation reconnects the internal blocks; a new center only
+ * retunes the frequency shift.
+ */
+void zoom_fft_c::set_zoom(double center_freq, double span)
+{
+    unsigned int new_decim = 1;
+    while (new_decim < MAX_ZOOM_DECIM && d_samp_rate / (2 * new_decim) >= 2.0 * span)
+        new_decim *= 2;
+
+    if (center_freq != d_center_freq)
+    {
+        d_center_freq = center_freq;
+        ddc->set_center_freq(d_center_freq);
+        restart_settling();
+    }
+
+    if (new_decim != d_decim)
+    {
+        d_decim = new_decim;
+
+        lock();
+        disconnect_all();
+        connect_all();
+        unlock();
+
+        fft->set_quad_rate(d_samp_rate / d_decim);
+        restart_settling();
+    }
+}
+
+/*! \brief Set new FFT size, limited to MAX_ZOOM_FFT_SIZE. */
+void zoom_fft_c::set_fft_size(unsigned int fftsize)
+{
+    fftsize = std::min(fftsize, (unsigned int)MAX_ZOOM_FFT_SIZE);
+    if (fftsize != fft->fft_size())
+    {
+        fft->set_fft_size(fftsize);
+        restart_settling();
+    }
+}
+
+/*! \brief Set new window type. */
+void zoom_fft_c::set_window_type(int wintype, bool normalize_energy)
+{
+    fft->set_window_type(wintype, normalize_energy);
+}
+
+/*! \brief Get zoomed FFT data.
+ *  \param fftPoints Buffer to copy FFT data, fft_size() elements.
+ *  \param center_freq The center frequency of the data (output).
+ *  \param rate The bandwidth covered by the data (output).
+ *  \returns 0 on success, -1 if no valid frame is available.
+ *
+ * After a retune or decimation change no data is returned until the FFT
+ * window holds only samples from the new setting.
+ */
+int zoom_fft_c::get_fft_data(float *fftPoints, double &center_freq, double &rate)
+{
+    if (std::chrono::steady_clock::now() < d_settled)
+        return -1;
+
+    center_freq = d_center_freq;
+    rate = d_samp_rate / d_decim;
+
+    return fft->get_fft_data(fftPoints);
+}
+
+void zoom_fft_c::connect_all()
+{
+    connect(self(), 0, ddc, 0);
+
+    if (d_decim > 1)
+    {
+        decimator = make_fir_decim_cc(d_decim);
+        connect(ddc, 0, decimator, 0);
+        connect(decimator, 0, fft, 0);
+    }
+    else
+    {
+        decimator.reset();
+        connect(ddc, 0, fft, 0);
+    }
+}
+
+void zoom_fft_c::restart_settling()
+{
+    const double fill_time = 1.2 * fft->fft_size() * d_decim / d_samp_rate;
+
+    d_settled = std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(fill_time));
+}
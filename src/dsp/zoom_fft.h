@@ -0,0 +1,95 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef ZOOM_FFT_H
+#define ZOOM_FFT_H
+
+#include <chrono>
+#include <gnuradio/hier_block2.h>
+#include "dsp/downconverter.h"
+#include "dsp/filter/fir_decim.h"
+#include "dsp/rx_fft.h"
+
+/* Largest zoom decimation, limited by the three fir_decim_cc stages */
+#define MAX_ZOOM_DECIM 16384
+
+/* Largest FFT size used for the zoomed spectrum */
+#define MAX_ZOOM_FFT_SIZE 32768
+
+class zoom_fft_c;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<zoom_fft_c> zoom_fft_c_sptr;
+#else
+typedef std::shared_ptr<zoom_fft_c> zoom_fft_c_sptr;
+#endif
+
+/*! \brief Return a shared_ptr to a new instance of zoom_fft_c.
+ *  \param fftsize The FFT size.
+ *  \param samp_rate The input sample rate.
+ */
+zoom_fft_c_sptr make_zoom_fft_c(unsigned int fftsize, double samp_rate);
+
+/*! \brief Zoom FFT of a part of the baseband.
+ *  \ingroup DSP
+ *
+ * The input is shifted so that the zoom center is at DC, decimated by a
+ * power of two with fir_decim_cc and fed to an rx_fft_c. The decimation
+ * is the largest that keeps the requested span within the central half of
+ * the decimated band, so a narrow span gets fine bins from a small FFT.
+ */
+class zoom_fft_c : public gr::hier_block2
+{
+    friend zoom_fft_c_sptr make_zoom_fft_c(unsigned int fftsize, double samp_rate);
+
+protected:
+    zoom_fft_c(unsigned int fftsize, double samp_rate);
+
+public:
+    ~zoom_fft_c();
+
+    void set_samp_rate(double samp_rate);
+    void set_zoom(double center_freq, double span);
+
+    void set_fft_size(unsigned int fftsize);
+    unsigned int fft_size() const { return fft->fft_size(); }
+    void set_window_type(int wintype, bool normalize_energy);
+
+    unsigned int decim() const { return d_decim; }
+
+    int get_fft_data(float *fftPoints, double &center_freq, double &rate);
+
+private:
+    unsigned int d_decim;
+    double       d_samp_rate;
+    double       d_center_freq;
+    std::chrono::time_point<std::chrono::steady_clock> d_settled; /*! First valid frame time. */
+
+    void connect_all();
+    void restart_settling();
+
+    downconverter_cc_sptr ddc;
+    fir_decim_cc_sptr     decimator;
+    rx_fft_c_sptr         fft;
+};
+
+#endif /* ZOOM_FFT_H */
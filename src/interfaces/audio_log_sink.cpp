@@ -0,0 +1,395 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <gnuradio/io_signature.h>
+
+#include "interfaces/audio_log_sink.h"
+
+#ifdef WITH_OPUS
+#include <opus.h>
+#endif
+
+/* Opus packets on one Ogg page, one second of 20 ms frames */
+#define OGG_PACKETS_PER_PAGE 50
+
+
+audio_log_encoder::audio_log_encoder(unsigned int threads)
+    : d_queued(0.0),
+      d_quit(false),
+      d_dropped(0)
+{
+    for (unsigned int i = 0; i < std::max(threads, 1u); i++)
+        d_threads.emplace_back(&audio_log_encoder::worker, this);
+}
+
+audio_log_encoder::~audio_log_encoder()
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_quit = true;
+    }
+    d_wake.notify_all();
+    for (auto &t : d_threads)
+        t.join();
+}
+
+bool audio_log_encoder::submit(const std::string &path, int rate, std::vector<float> &&samples)
+{
+    const double seconds = (double)samples.size() / rate;
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        if (d_queued + seconds > AUDIO_LOG_MAX_QUEUED_SEC)
+        {
+            d_dropped++;
+            return false;
+        }
+        d_queued += seconds;
+        d_jobs.push_back({path, rate, std::move(samples)});
+    }
+    d_wake.notify_one();
+    return true;
+}
+
+/* Write the queued transmissions, and when quitting the rest of them */
+void audio_log_encoder::worker()
+{
+    std::unique_lock<std::mutex> lock(d_mutex);
+    for (;;)
+    {
+        d_wake.wait(lock, [this] { return d_quit || !d_jobs.empty(); });
+        if (d_jobs.empty())
+            return;
+
+        job j = std::move(d_jobs.front());
+        d_jobs.pop_front();
+        lock.unlock();
+
+        bool ok;
+#ifdef WITH_OPUS
+        const bool opus = j.rate == 8000 || j.rate == 12000 || j.rate == 16000 ||
+                          j.rate == 24000 || j.rate == 48000;
+#else
+        const bool opus = false;
+#endif
+        if (opus)
+            ok = write_opus(j.path, j.rate, j.samples);
+        else
+            ok = write_wav(j.path, j.rate, j.samples);
+        if (!ok)
+            std::cerr << "Audio log: can not write " << j.path << std::endl;
+
+        lock.lock();
+        d_queued -= (double)j.samples.size() / j.rate;
+    }
+}
+
+static void put_le(std::vector<uint8_t> &out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        out.push_back((value >> (8 * i)) & 0xff);
+}
+
+/* Rename the complete file to the first of path.ext, path-1.ext, ... that is free */
+static bool finish_file(FILE *f, const std::string &tmp, const std::string &path, const char *ext)
+{
+    const bool ok = !ferror(f);
+    if (fclose(f) != 0 || !ok)
+    {
+        std::remove(tmp.c_str());
+        return false;
+    }
+
+    std::string name = path + ext;
+    for (int n = 1; ; n++)
+    {
+        FILE *existing = fopen(name.c_str(), "rb");
+        if (!existing)
+            break;
+        fclose(existing);
+        name = path + "-" + std::to_string(n) + ext;
+    }
+    return std::rename(tmp.c_str(), name.c_str()) == 0;
+}
+
+bool audio_log_encoder::write_wav(const std::string &path, int rate, const std::vector<float> &samples)
+{
+    const std::string tmp = path + ".wav.part";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if (!f)
+        return false;
+
+    const uint32_t data_size = (uint32_t)samples.size() * 2;
+    std::vector<uint8_t> out;
+    out.reserve(44 + data_size);
+    out.insert(out.end(), {'R', 'I', 'F', 'F'});
+    put_le(out, 36 + data_size, 4);
+    out.insert(out.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    put_le(out, 16, 4);
+    put_le(out, 1, 2);          // PCM
+    put_le(out, 1, 2);          // mono
+    put_le(out, rate, 4);
+    put_le(out, rate * 2, 4);
+    put_le(out, 2, 2);
+    put_le(out, 16, 2);
+    out.insert(out.end(), {'d', 'a', 't', 'a'});
+    put_le(out, data_size, 4);
+    for (float x : samples)
+        put_le(out, (uint16_t)(int16_t)std::lrint(std::max(-1.0f, std::min(1.0f, x)) * 32767.0f), 2);
+
+    fwrite(out.data(), 1, out.size(), f);
+    return finish_file(f, tmp, path, ".wav");
+}
+
+#ifdef WITH_OPUS
+/* CRC of the Ogg pages, polynomial 0x04c11db7 without reflection */
+static uint32_t ogg_crc(const uint8_t *data, size_t length)
+{
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t r = i << 24;
+            for (int b = 0; b < 8; b++)
+                r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : r << 1;
+            t[i] = r;
+        }
+        return t;
+    }();
+
+    uint32_t crc = 0;
+    for (size_t i = 0; i < length; i++)
+        crc = (crc << 8) ^ table[((crc >> 24) ^ data[i]) & 0xff];
+    return crc;
+}
+
+/* One Ogg page of whole packets */
+static void ogg_page(FILE *f, const std::vector<std::vector<uint8_t>> &packets, uint8_t flags,
+                     uint64_t granule, uint32_t serial, uint32_t sequence)
+{
+    std::vector<uint8_t> page = {'O', 'g', 'g', 'S', 0, flags};
+    put_le(page, granule, 8);
+    put_le(page, serial, 4);
+    put_le(page, sequence, 4);
+    put_le(page, 0, 4);         // CRC
+    page.push_back(0);          // segments
+    for (const auto &p : packets)
+    {
+        for (size_t n = p.size(); ; n -= 255)
+        {
+            page.push_back(n >= 255 ? 255 : n);
+            page[26]++;
+            if (n < 255)
+                break;
+        }
+    }
+    for (const auto &p : packets)
+        page.insert(page.end(), p.begin(), p.end());
+
+    const uint32_t crc = ogg_crc(page.data(), page.size());
+    for (int i = 0; i < 4; i++)
+        page[22 + i] = (crc >> (8 * i)) & 0xff;
+    fwrite(page.data(), 1, page.size(), f);
+}
+#endif
+
+/* Ogg Opus as in RFC 7845, the granule positions count at 48 kHz */
+bool audio_log_encoder::write_opus(const std::string &path, int rate, const std::vector<float> &samples)
+{
+#ifdef WITH_OPUS
+    int err;
+    OpusEncoder *encoder = opus_encoder_create(rate, 1, OPUS_APPLICATION_VOIP, &err);
+    if (err != OPUS_OK)
+        return false;
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(AUDIO_LOG_OPUS_BITRATE));
+    opus_int32 lookahead = 0;
+    opus_encoder_ctl(encoder, OPUS_GET_LOOKAHEAD(&lookahead));
+
+    const std::string tmp = path + ".opus.part";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if (!f)
+    {
+        opus_encoder_destroy(encoder);
+        return false;
+    }
+
+    const int scale = 48000 / rate;
+    const uint32_t serial = (uint32_t)std::hash<std::string>()(path);
+    const uint64_t pre_skip = (uint64_t)lookahead * scale;
+    uint32_t sequence = 0;
+
+    std::vector<uint8_t> head = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, 1};
+    put_le(head, pre_skip, 2);
+    put_le(head, rate, 4);
+    put_le(head, 0, 2);         // output gain
+    head.push_back(0);          // channel mapping family
+    ogg_page(f, {head}, 0x02, 0, serial, sequence++);
+
+    const std::string vendor = opus_get_version_string();
+    std::vector<uint8_t> tags = {'O', 'p', 'u', 's', 'T', 'a', 'g', 's'};
+    put_le(tags, vendor.size(), 4);
+    tags.insert(tags.end(), vendor.begin(), vendor.end());
+    put_le(tags, 0, 4);
+    ogg_page(f, {tags}, 0x00, 0, serial, sequence++);
+
+    // The last frame is padded, and the lookahead is flushed with silence
+    const int frame = rate * AUDIO_LOG_OPUS_FRAME_MS / 1000;
+    const size_t total = samples.size() + lookahead;
+    std::vector<float> pcm(frame);
+    std::vector<std::vector<uint8_t>> packets;
+    uint8_t buf[1500];
+    for (size_t pos = 0; pos < total; pos += frame)
+    {
+        for (int i = 0; i < frame; i++)
+            pcm[i] = pos + i < samples.size() ? samples[pos + i] : 0.0f;
+        const int length = opus_encode_float(encoder, pcm.data(), frame, buf, sizeof(buf));
+        packets.emplace_back(buf, buf + std::max(length, 0));
+
+        const bool last = pos + frame >= total;
+        if (packets.size() == OGG_PACKETS_PER_PAGE || last)
+        {
+            const uint64_t granule = last ? pre_skip + (uint64_t)samples.size() * scale
+                                          : (uint64_t)(pos + frame) * scale;
+            ogg_page(f, packets, last ? 0x04 : 0x00, granule, serial, sequence++);
+            packets.clear();
+        }
+    }
+    opus_encoder_destroy(encoder);
+
+    return finish_file(f, tmp, path, ".opus");
+#else
+    return write_wav(path, rate, samples);
+#endif
+}
+
+
+audio_log_sink_sptr make_audio_log_sink(audio_log_encoder_sptr encoder,
+                                        const std::string &prefix, int rate)
+{
+    return gnuradio::get_initial_sptr(new audio_log_sink(encoder, prefix, rate));
+}
+
+audio_log_sink::audio_log_sink(audio_log_encoder_sptr encoder, const std::string &prefix, int rate)
+    : gr::sync_block ("audio_log_sink",
+          gr::io_signature::make(1, 1, sizeof(float)),
+          gr::io_signature::make(0, 0, 0)),
+      d_encoder(encoder),
+      d_prefix(prefix),
+      d_rate(rate),
+      d_open(false),
+      d_silent(0),
+      d_hang((size_t)(AUDIO_LOG_HANG_SEC * rate)),
+      d_min((size_t)(AUDIO_LOG_MIN_SEC * rate)),
+      d_max((size_t)(AUDIO_LOG_MAX_SEC * rate))
+{
+}
+
+audio_log_sink::~audio_log_sink()
+{
+    close();
+}
+
+int audio_log_sink::work(int noutput_items,
+                         gr_vector_const_void_star &input_items,
+                         gr_vector_void_star &output_items)
+{
+    (void) output_items;
+    const float *in = (const float *) input_items[0];
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    int i = 0;
+    while (i < noutput_items)
+    {
+        if (!d_open)
+        {
+            while (i < noutput_items && in[i] == 0.0f)
+                i++;
+            if (i == noutput_items)
+                break;
+            begin();
+        }
+
+        // Up to the end of the input, of the file or of the hang time
+        const int n = std::min(noutput_items - i, (int)(d_max - d_samples.size()));
+        int j = 0;
+        while (j < n)
+        {
+            if (in[i + j++] != 0.0f)
+                d_silent = 0;
+            else if (++d_silent >= d_hang)
+                break;
+        }
+        d_samples.insert(d_samples.end(), in + i, in + i + j);
+        i += j;
+        if (d_silent >= d_hang || d_samples.size() >= d_max)
+            end();
+    }
+
+    return noutput_items;
+}
+
+/* The running transmission is written when the flow graph stops */
+bool audio_log_sink::stop()
+{
+    close();
+    return true;
+}
+
+void audio_log_sink::close()
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+    if (d_open)
+        end();
+}
+
+void audio_log_sink::begin()
+{
+    char stamp[32];
+    const std::time_t now = std::time(nullptr);
+    std::tm tm;
+#ifdef _WIN32
+    gmtime_s(&tm, &now);
+#else
+    gmtime_r(&now, &tm);
+#endif
+    std::strftime(stamp, sizeof(stamp), "_%Y%m%d_%H%M%S", &tm);
+
+    d_path = d_prefix + stamp;
+    d_open = true;
+    d_silent = 0;
+}
+
+void audio_log_sink::end()
+{
+    d_samples.resize(d_samples.size() - std::min(d_silent, d_samples.size()));
+    if (d_samples.size() >= d_min && !d_encoder->submit(d_path, d_rate, std::move(d_samples)))
+        std::cerr << "Audio log: encoders are behind, dropped " << d_path << std::endl;
+
+    d_samples.clear();
+    d_open = false;
+    d_silent = 0;
+}
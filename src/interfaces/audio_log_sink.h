@@ -0,0 +1,163 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef AUDIO_LOG_SINK_H
+#define AUDIO_LOG_SINK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gnuradio/sync_block.h>
+
+/* Encoder threads shared by the audio logs of all channels */
+#define AUDIO_LOG_THREADS 2
+
+/* Silence after which a transmission ends */
+#define AUDIO_LOG_HANG_SEC 2.0
+
+/* Transmissions shorter than this are not kept */
+#define AUDIO_LOG_MIN_SEC 0.25
+
+/* Longest file, a longer transmission goes on in the next one */
+#define AUDIO_LOG_MAX_SEC 600.0
+
+/* Audio waiting for the encoders above which transmissions are dropped */
+#define AUDIO_LOG_MAX_QUEUED_SEC 3600.0
+
+/* Opus frame and bit rate of the logs, mono speech */
+#define AUDIO_LOG_OPUS_FRAME_MS 20
+#define AUDIO_LOG_OPUS_BITRATE  24000
+
+/*! \brief Threads that write the transmissions of the audio logs.
+ *  \ingroup IO
+ *
+ * A transmission is handed over whole and written as Ogg Opus when built
+ * with Opus and the rate is one Opus takes, else as 16 bit WAV. It is
+ * written under a temporary name and renamed when complete, so a program
+ * watching the folder never reads half a file. When the queue holds more
+ * than AUDIO_LOG_MAX_QUEUED_SEC of audio new transmissions are dropped and
+ * counted. The destructor writes what is queued.
+ */
+class audio_log_encoder
+{
+public:
+    explicit audio_log_encoder(unsigned int threads);
+    ~audio_log_encoder();
+
+    /*! \brief Queue a transmission, false if it is dropped.
+     *  \param path The file without the extension.
+     */
+    bool submit(const std::string &path, int rate, std::vector<float> &&samples);
+
+    uint64_t dropped() const { return d_dropped; }
+
+private:
+    struct job {
+        std::string         path;
+        int                 rate;
+        std::vector<float>  samples;
+    };
+
+    void worker();
+    static bool write_wav(const std::string &path, int rate, const std::vector<float> &samples);
+    static bool write_opus(const std::string &path, int rate, const std::vector<float> &samples);
+
+    std::vector<std::thread> d_threads;
+    std::mutex              d_mutex;
+    std::condition_variable d_wake;
+    std::deque<job>         d_jobs;
+    double                  d_queued;   /*!< Seconds of audio in d_jobs. */
+    bool                    d_quit;
+    std::atomic<uint64_t>   d_dropped;
+};
+
+typedef std::shared_ptr<audio_log_encoder> audio_log_encoder_sptr;
+
+class audio_log_sink;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<audio_log_sink> audio_log_sink_sptr;
+#else
+typedef std::shared_ptr<audio_log_sink> audio_log_sink_sptr;
+#endif
+
+/*! \brief Return a shared_ptr to a new instance of audio_log_sink.
+ *  \param encoder The threads that write the files.
+ *  \param prefix The files are prefix_yyyyMMdd_hhmmss in UTC with extension.
+ *  \param rate The audio rate.
+ */
+audio_log_sink_sptr make_audio_log_sink(audio_log_encoder_sptr encoder,
+                                        const std::string &prefix, int rate);
+
+/*! \brief Audio of a channel, one file per transmission.
+ *  \ingroup IO
+ *
+ * The squelch of the demodulators puts exact zeros where it was closed,
+ * so a transmission begins with the first sample that is not zero and ends
+ * after AUDIO_LOG_HANG_SEC of zeros, which are cut off. work() only copies
+ * the samples of open transmissions; the finished ones are encoded and
+ * written by the shared audio_log_encoder, off the scheduler threads.
+ */
+class audio_log_sink : public gr::sync_block
+{
+    friend audio_log_sink_sptr make_audio_log_sink(audio_log_encoder_sptr encoder,
+                                                   const std::string &prefix, int rate);
+
+protected:
+    audio_log_sink(audio_log_encoder_sptr encoder, const std::string &prefix, int rate);
+
+public:
+    ~audio_log_sink();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    bool stop();
+
+    /*! \brief End the running transmission. */
+    void close();
+
+private:
+    void begin();
+    void end();
+
+    audio_log_encoder_sptr d_encoder;
+    std::string         d_prefix;
+    int                 d_rate;
+    std::mutex          d_mutex;
+    bool                d_open;
+    std::string         d_path;     /*!< Of the running transmission. */
+    std::vector<float>  d_samples;
+    size_t              d_silent;   /*!< Zeros at the end of d_samples. */
+    size_t              d_hang;
+    size_t              d_min;
+    size_t              d_max;
+};
+
+#endif // AUDIO_LOG_SINK_H
@@ -0,0 +1,272 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <gnuradio/io_signature.h>
+
+#include "interfaces/iq_capture_sink.h"
+
+
+iq_capture_sink_sptr make_iq_capture_sink(uint64_t ring_samples)
+{
+    return gnuradio::get_initial_sptr(new iq_capture_sink(ring_samples));
+}
+
+iq_capture_sink::iq_capture_sink(uint64_t ring_samples)
+    : gr::sync_block ("iq_capture_sink",
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          gr::io_signature::make(0, 0, 0)),
+      d_ring(nullptr),
+      d_mapped(false),
+      d_ring_mem(MEM_IQ_PRETRIGGER),
+      d_claimed(0),
+      d_written(0),
+      d_dropped(0),
+      d_capturing(false),
+      d_fd(-1),
+      d_pos(0),
+      d_end(0),
+      d_quit(false),
+      d_chunk(IQ_CAPTURE_CHUNK_SAMPLES)
+{
+    // At least two chunks, so that a capture can start with a whole one
+    d_size = std::min<uint64_t>(std::max<uint64_t>(ring_samples, 2 * IQ_CAPTURE_CHUNK_SAMPLES),
+                                IQ_CAPTURE_MAX_SAMPLES);
+
+    // Shorter pre-trigger under the cap of MEM_IQ_PRETRIGGER
+    const uint64_t allowed = (uint64_t)d_ring_mem.allowed((int64_t)(d_size * sizeof(gr_complex)))
+                             / sizeof(gr_complex);
+    d_size = std::max<uint64_t>(std::min(d_size, allowed), 2 * IQ_CAPTURE_CHUNK_SAMPLES);
+
+#ifndef _WIN32
+    // Only the pages that have been written take memory
+    void *p = mmap(nullptr, d_size * sizeof(gr_complex), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS
+#ifdef MAP_NORESERVE
+                   | MAP_NORESERVE
+#endif
+                   , -1, 0);
+    if (p != MAP_FAILED)
+    {
+        d_ring = (gr_complex *)p;
+        d_mapped = true;
+    }
+#endif
+    if (!d_ring)
+        d_ring = new gr_complex[d_size];
+    d_ring_mem.set((int64_t)(d_size * sizeof(gr_complex)));
+
+    d_thread = std::thread(&iq_capture_sink::writer, this);
+}
+
+/*
+ * A running capture ends with the samples that are in the ring, the thread
+ * writes them before it quits.
+ */
+iq_capture_sink::~iq_capture_sink()
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_quit = true;
+    }
+    d_wake.notify_one();
+    d_thread.join();
+
+#ifndef _WIN32
+    if (d_mapped)
+        munmap(d_ring, d_size * sizeof(gr_complex));
+    else
+#endif
+        delete[] d_ring;
+}
+
+int iq_capture_sink::work(int noutput_items,
+                          gr_vector_const_void_star &input_items,
+                          gr_vector_void_star &output_items)
+{
+    const gr_complex *in = (const gr_complex *) input_items[0];
+    (void) output_items;
+
+    uint64_t count = std::min<uint64_t>(noutput_items, d_size);
+    in += noutput_items - count;
+
+    const uint64_t base = d_written.load(std::memory_order_relaxed) + (noutput_items - count);
+    const uint64_t pos = base % d_size;
+    const uint64_t n1 = std::min(count, d_size - pos);
+
+    // Announce the range about to be overwritten, c.f. rx_fft_c::work()
+    d_claimed.store(base + count, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(&d_ring[pos], in, sizeof(gr_complex) * n1);
+    if (n1 < count)
+        memcpy(&d_ring[0], in + n1, sizeof(gr_complex) * (count - n1));
+
+    d_written.store(base + count, std::memory_order_release);
+
+    // The writer also wakes up by itself, no need to lock here
+    if (d_capturing.load(std::memory_order_relaxed) &&
+        base / IQ_CAPTURE_CHUNK_SAMPLES != (base + count) / IQ_CAPTURE_CHUNK_SAMPLES)
+        d_wake.notify_one();
+
+    return noutput_items;
+}
+
+int64_t iq_capture_sink::start(const std::string &filename, uint64_t pre, uint64_t post)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    if (d_fd >= 0 || d_quit)
+        return -1;
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_BINARY
+    flags |= O_BINARY;
+#endif
+    d_fd = ::open(filename.c_str(), flags, 0644);
+    if (d_fd < 0)
+        return -1;
+
+    // Keep a chunk clear of work(), which overwrites the oldest samples
+    const uint64_t written = d_written.load(std::memory_order_acquire);
+    pre = std::min({pre, written, d_size - IQ_CAPTURE_CHUNK_SAMPLES});
+
+    d_pos = written - pre;
+    d_end = written + post;
+    d_capturing.store(true, std::memory_order_release);
+    d_wake.notify_one();
+
+    return (int64_t) pre;
+}
+
+bool iq_capture_sink::extend(uint64_t post)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    if (d_fd < 0)
+        return false;
+
+    d_end = std::max(d_end, d_written.load(std::memory_order_acquire) + post);
+    return true;
+}
+
+bool iq_capture_sink::write(const gr_complex *data, size_t count)
+{
+    const char *bytes = (const char *) data;
+    size_t length = count * sizeof(gr_complex);
+
+    while (length > 0)
+    {
+        auto written = ::write(d_fd, bytes, length);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        bytes += written;
+        length -= written;
+    }
+    return true;
+}
+
+/*
+ * Write the running capture in chunks of up to IQ_CAPTURE_CHUNK_SAMPLES.
+ * A chunk is copied without the lock, like a snapshot of rx_fft_c, and the
+ * part of it that work() has claimed meanwhile is skipped.
+ */
+void iq_capture_sink::writer()
+{
+    std::unique_lock<std::mutex> lock(d_mutex);
+
+    for (;;)
+    {
+        if (d_fd < 0)
+        {
+            if (d_quit)
+                return;
+            d_wake.wait(lock);
+            continue;
+        }
+
+        uint64_t stop = std::min(d_written.load(std::memory_order_acquire), d_end);
+        if (d_quit)
+            d_end = stop;
+        if (stop - std::min(stop, d_pos) < IQ_CAPTURE_CHUNK_SAMPLES && stop < d_end)
+        {
+            d_wake.wait_for(lock, std::chrono::milliseconds(IQ_CAPTURE_FLUSH_MS));
+            stop = std::min(d_written.load(std::memory_order_acquire), d_end);
+        }
+
+        uint64_t claimed = d_claimed.load(std::memory_order_acquire);
+        if (claimed > d_size && d_pos < claimed - d_size)
+        {
+            d_dropped.fetch_add(claimed - d_size - d_pos, std::memory_order_relaxed);
+            d_pos = claimed - d_size;
+        }
+
+        const uint64_t pos = d_pos;
+        const uint64_t count = std::min<uint64_t>(stop - std::min(stop, pos),
+                                                  IQ_CAPTURE_CHUNK_SAMPLES);
+        bool ok = true;
+        if (count > 0)
+        {
+            lock.unlock();
+
+            const uint64_t first = pos % d_size;
+            const uint64_t n1 = std::min(count, d_size - first);
+            memcpy(d_chunk.data(), &d_ring[first], sizeof(gr_complex) * n1);
+            if (n1 < count)
+                memcpy(d_chunk.data() + n1, &d_ring[0], sizeof(gr_complex) * (count - n1));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            claimed = d_claimed.load(std::memory_order_relaxed);
+            uint64_t skip = 0;
+            if (claimed > d_size && pos < claimed - d_size)
+                skip = std::min(count, claimed - d_size - pos);
+            d_dropped.fetch_add(skip, std::memory_order_relaxed);
+
+            ok = write(d_chunk.data() + skip, count - skip);
+
+            lock.lock();
+            d_pos = pos + count;
+        }
+
+        if (!ok)
+            std::cout << __func__ << ": I/Q capture write failed" << std::endl;
+        if (!ok || d_pos >= d_end)
+        {
+            ::close(d_fd);
+            d_fd = -1;
+            d_capturing.store(false, std::memory_order_release);
+        }
+    }
+}
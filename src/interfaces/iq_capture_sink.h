@@ -0,0 +1,130 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef IQ_CAPTURE_SINK_H
+#define IQ_CAPTURE_SINK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gnuradio/sync_block.h>
+#include "dsp/mem_account.h"
+
+/* Largest pre-trigger ring of iq_capture_sink in samples (16 GiB) */
+#define IQ_CAPTURE_MAX_SAMPLES (1024ULL * 1024 * 1024 * 2)
+
+/* Samples the writer thread copies out of the ring and writes at once */
+#define IQ_CAPTURE_CHUNK_SAMPLES (128 * 1024)
+
+/* Time the writer thread waits for a full chunk before it writes less */
+#define IQ_CAPTURE_FLUSH_MS 200
+
+class iq_capture_sink;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<iq_capture_sink> iq_capture_sink_sptr;
+#else
+typedef std::shared_ptr<iq_capture_sink> iq_capture_sink_sptr;
+#endif
+
+/*! \brief Return a shared_ptr to a new instance of iq_capture_sink.
+ *  \param ring_samples Samples kept before a trigger.
+ */
+iq_capture_sink_sptr make_iq_capture_sink(uint64_t ring_samples);
+
+/*! \brief Pre-trigger ring of I/Q samples in cf32.
+ *  \ingroup IO
+ *
+ * work() keeps the newest samples in a ring, an anonymous mapping where
+ * there is one, and does nothing else. start() opens a file and a thread
+ * of the sink writes the samples from some time before the trigger to
+ * some time after it, so a burst that set off a detector is in the file
+ * from its beginning. The thread copies a chunk out of the ring before it
+ * writes it and checks that work() has not overwritten it meanwhile, so
+ * work() never waits for the disk. Samples the thread was too slow for
+ * are skipped and counted.
+ */
+class iq_capture_sink : public gr::sync_block
+{
+    friend iq_capture_sink_sptr make_iq_capture_sink(uint64_t ring_samples);
+
+protected:
+    iq_capture_sink(uint64_t ring_samples);
+
+public:
+    ~iq_capture_sink();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    /*! \brief Start writing a capture to a new file.
+     *  \param filename The file to write, it is truncated.
+     *  \param pre Samples before the trigger, limited to what the ring holds.
+     *  \param post Samples after the trigger.
+     *  \return Samples before the trigger in the file, or -1 if the file can
+     *          not be opened or a capture is running.
+     */
+    int64_t start(const std::string &filename, uint64_t pre, uint64_t post);
+
+    /*! \brief Let a running capture end no earlier than post samples from now.
+     *  \return false if no capture is running.
+     */
+    bool extend(uint64_t post);
+
+    /*! \brief Whether a capture is being written. */
+    bool capturing() const { return d_capturing.load(std::memory_order_acquire); }
+
+    /*! \brief Samples the ring holds. */
+    uint64_t ring_samples() const { return d_size; }
+
+    /*! \brief Samples skipped by the writer since the block was created. */
+    uint64_t dropped() const { return d_dropped.load(std::memory_order_relaxed); }
+
+private:
+    void writer();
+    bool write(const gr_complex *data, size_t count);
+
+    gr_complex             *d_ring;
+    uint64_t                d_size;
+    bool                    d_mapped;       /*!< d_ring is an anonymous mapping. */
+    mem_charge              d_ring_mem;     /*!< Size of d_ring, MEM_IQ_PRETRIGGER. */
+    std::atomic<uint64_t>   d_claimed;      /*!< Samples written or being written. */
+    std::atomic<uint64_t>   d_written;      /*!< Samples completely written. */
+    std::atomic<uint64_t>   d_dropped;
+    std::atomic<bool>       d_capturing;
+
+    std::mutex              d_mutex;        /*!< Locks the capture state below. */
+    std::condition_variable d_wake;
+    int                     d_fd;           /*!< File of the running capture. */
+    uint64_t                d_pos;          /*!< Next sample to write to d_fd. */
+    uint64_t                d_end;          /*!< First sample after the capture. */
+    bool                    d_quit;
+    std::thread             d_thread;
+    std::vector<gr_complex> d_chunk;        /*!< Copy of the samples being written. */
+};
+
+#endif /* IQ_CAPTURE_SINK_H */
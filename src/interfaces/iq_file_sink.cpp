@@ -0,0 +1,316 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include <gnuradio/io_signature.h>
+#include <volk/volk.h>
+
+#include "interfaces/iq_file_sink.h"
+
+static_assert(IQ_FILE_CHUNK_SIZE % IQ_FILE_PAGE_SIZE == 0,
+              "IQ_FILE_CHUNK_SIZE must be a multiple of IQ_FILE_PAGE_SIZE");
+
+
+iq_file_sink_sptr make_iq_file_sink(const std::string &filename,
+                                    iq_file_format format,
+                                    bool compress,
+                                    size_t ring_size)
+{
+    return gnuradio::get_initial_sptr(new iq_file_sink(filename, format, compress,
+                                                       ring_size));
+}
+
+iq_file_sink::iq_file_sink(const std::string &filename, iq_file_format format,
+                           bool compress, size_t ring_size)
+    : gr::sync_block ("iq_file_sink",
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          gr::io_signature::make(0, 0, 0)),
+      d_format(format),
+      d_fd(-1),
+      d_direct(false),
+#ifdef WITH_ZLIB
+      d_gz(nullptr),
+#endif
+      d_head(0),
+      d_tail(0),
+      d_dropped(0),
+      d_failed(false),
+      d_stop(false)
+{
+    if (compress)
+    {
+#ifdef WITH_ZLIB
+        d_gz = gzopen(filename.c_str(), "wb1");
+        if (!d_gz)
+            throw std::runtime_error("can not open " + filename);
+        gzbuffer(d_gz, IQ_FILE_CHUNK_SIZE);
+#else
+        throw std::runtime_error("compressed I/Q recording needs zlib");
+#endif
+    }
+    else
+    {
+        int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_BINARY
+        flags |= O_BINARY;
+#endif
+#ifdef O_DIRECT
+        // Not every file system takes O_DIRECT, tmpfs does not
+        d_fd = ::open(filename.c_str(), flags | O_DIRECT, 0644);
+        d_direct = (d_fd >= 0);
+#endif
+        if (d_fd < 0)
+            d_fd = ::open(filename.c_str(), flags, 0644);
+        if (d_fd < 0)
+            throw std::runtime_error("can not open " + filename);
+    }
+
+    // Whole chunks, so the samples of all formats and the writes of the
+    // thread never straddle the end of the ring
+    d_ring_size = std::max<size_t>(1, (ring_size + IQ_FILE_CHUNK_SIZE - 1) / IQ_FILE_CHUNK_SIZE)
+                  * IQ_FILE_CHUNK_SIZE;
+    d_ring = (char *) volk_malloc(d_ring_size, IQ_FILE_PAGE_SIZE);
+    if (!d_ring)
+    {
+#ifdef WITH_ZLIB
+        if (d_gz)
+            gzclose(d_gz);
+#endif
+        if (d_fd >= 0)
+            ::close(d_fd);
+        throw std::runtime_error("can not allocate the I/Q file ring");
+    }
+
+    d_thread = std::thread(&iq_file_sink::writer, this);
+}
+
+iq_file_sink::~iq_file_sink()
+{
+    close();
+    volk_free(d_ring);
+}
+
+size_t iq_file_sink::sample_size(iq_file_format format)
+{
+    switch (format)
+    {
+    case IQ_FILE_CS16:
+        return 2 * sizeof(int16_t);
+    case IQ_FILE_CS8:
+        return 2 * sizeof(int8_t);
+    default:
+        return sizeof(gr_complex);
+    }
+}
+
+float iq_file_sink::scale(iq_file_format format)
+{
+    switch (format)
+    {
+    case IQ_FILE_CS16:
+        return 32767.0f;
+    case IQ_FILE_CS8:
+        return 127.0f;
+    default:
+        return 1.0f;
+    }
+}
+
+bool iq_file_sink::can_compress()
+{
+#ifdef WITH_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+void iq_file_sink::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_stop = true;
+    }
+    d_wake.notify_one();
+
+    if (d_thread.joinable())
+        d_thread.join();
+
+    if (d_fd >= 0)
+    {
+        ::close(d_fd);
+        d_fd = -1;
+    }
+#ifdef WITH_ZLIB
+    if (d_gz)
+    {
+        gzclose(d_gz);
+        d_gz = nullptr;
+    }
+#endif
+}
+
+float iq_file_sink::ring_fill() const
+{
+    uint64_t used = d_head.load(std::memory_order_relaxed) -
+                    d_tail.load(std::memory_order_relaxed);
+
+    return (float) used / (float) d_ring_size;
+}
+
+int iq_file_sink::work(int noutput_items,
+                       gr_vector_const_void_star &input_items,
+                       gr_vector_void_star &output_items)
+{
+    (void) output_items;
+
+    const float *in = (const float *) input_items[0];
+    size_t size = sample_size(d_format);
+    uint64_t head = d_head.load(std::memory_order_relaxed);
+    uint64_t used = head - d_tail.load(std::memory_order_acquire);
+    int count = std::min<uint64_t>(noutput_items, (d_ring_size - used) / size);
+
+    if (d_failed.load(std::memory_order_relaxed))
+        count = 0;
+    if (count < noutput_items)
+        d_dropped.fetch_add(noutput_items - count, std::memory_order_relaxed);
+
+    // At most two parts, the ring size is a multiple of the sample size
+    int done = 0;
+    while (done < count)
+    {
+        size_t pos = head % d_ring_size;
+        int part = std::min<uint64_t>(count - done, (d_ring_size - pos) / size);
+        char *out = d_ring + pos;
+
+        // The volk kernels saturate at full scale
+        if (d_format == IQ_FILE_CS16)
+            volk_32f_s32f_convert_16i((int16_t *) out, in + 2 * done,
+                                      scale(d_format), 2 * part);
+        else if (d_format == IQ_FILE_CS8)
+            volk_32f_s32f_convert_8i((int8_t *) out, in + 2 * done,
+                                     scale(d_format), 2 * part);
+        else
+            std::copy_n((const char *)(in + 2 * done), part * size, out);
+
+        head += part * size;
+        done += part;
+    }
+    d_head.store(head, std::memory_order_release);
+
+    // The writer also wakes up by itself, no need to lock here
+    if (head - d_tail.load(std::memory_order_relaxed) >= IQ_FILE_CHUNK_SIZE)
+        d_wake.notify_one();
+
+    return noutput_items;
+}
+
+bool iq_file_sink::write(const char *data, size_t bytes)
+{
+#ifdef WITH_ZLIB
+    if (d_gz)
+        return gzwrite(d_gz, data, (unsigned int) bytes) == (int) bytes;
+#endif
+    while (bytes > 0)
+    {
+        auto written = ::write(d_fd, data, bytes);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        data += written;
+        bytes -= written;
+    }
+    return true;
+}
+
+/*
+ * Write the ring to the file in chunks of up to IQ_FILE_CHUNK_SIZE. An
+ * O_DIRECT file only gets whole pages, which keeps the file offset and
+ * the ring position aligned, until close() asks for the rest.
+ */
+void iq_file_sink::writer()
+{
+    for (;;)
+    {
+        uint64_t tail = d_tail.load(std::memory_order_relaxed);
+        uint64_t pending = d_head.load(std::memory_order_acquire) - tail;
+        bool stop;
+
+        {
+            std::unique_lock<std::mutex> lock(d_mutex);
+            if (pending < IQ_FILE_CHUNK_SIZE && !d_stop)
+            {
+                d_wake.wait_for(lock, std::chrono::milliseconds(IQ_FILE_FLUSH_MS));
+                pending = d_head.load(std::memory_order_acquire) - tail;
+            }
+            stop = d_stop;
+        }
+
+        size_t pos = tail % d_ring_size;
+        size_t length = std::min<uint64_t>({pending, IQ_FILE_CHUNK_SIZE, d_ring_size - pos});
+        if (d_direct && length % IQ_FILE_PAGE_SIZE != 0)
+        {
+            if (length > IQ_FILE_PAGE_SIZE || !stop)
+            {
+                length -= length % IQ_FILE_PAGE_SIZE;
+            }
+#ifdef O_DIRECT
+            else
+            {
+                // The last partial page goes through the page cache
+                fcntl(d_fd, F_SETFL, fcntl(d_fd, F_GETFL) & ~O_DIRECT);
+                d_direct = false;
+            }
+#endif
+        }
+
+        if (length > 0)
+        {
+            if (!write(d_ring + pos, length))
+            {
+                std::cout << __func__ << ": I/Q file write failed, recording stopped"
+                          << std::endl;
+                d_dropped.fetch_add((d_head.load() - tail) / sample_size(d_format),
+                                    std::memory_order_relaxed);
+                d_failed.store(true);
+                d_tail.store(d_head.load(), std::memory_order_release);
+                return;
+            }
+            d_tail.store(tail + length, std::memory_order_release);
+        }
+        else if (stop)
+        {
+            return;
+        }
+    }
+}
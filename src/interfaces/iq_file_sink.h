@@ -0,0 +1,156 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef IQ_FILE_SINK_H
+#define IQ_FILE_SINK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <gnuradio/sync_block.h>
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+/* Default size of the ring between the flow graph and the writer thread in bytes */
+#define IQ_FILE_RING_SIZE (128 * 1024 * 1024)
+
+/* Largest write of the writer thread, the ring size is a multiple of it */
+#define IQ_FILE_CHUNK_SIZE (1024 * 1024)
+
+/* Alignment of the ring and of the writes to an O_DIRECT file */
+#define IQ_FILE_PAGE_SIZE 4096
+
+/* Time the writer thread waits for a full chunk before it writes less */
+#define IQ_FILE_FLUSH_MS 200
+
+/*! \brief Sample formats of an I/Q recording. */
+enum iq_file_format {
+    IQ_FILE_CF32 = 0,   /*!< Complex float, 8 bytes per sample. */
+    IQ_FILE_CS16 = 1,   /*!< Complex int16, 4 bytes per sample. */
+    IQ_FILE_CS8  = 2    /*!< Complex int8, 2 bytes per sample. */
+};
+
+class iq_file_sink;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<iq_file_sink> iq_file_sink_sptr;
+#else
+typedef std::shared_ptr<iq_file_sink> iq_file_sink_sptr;
+#endif
+
+/*! \brief Return a shared_ptr to a new instance of iq_file_sink.
+ *  \param filename The file to write, it is truncated.
+ *  \param format The sample format of the file.
+ *  \param compress Write a gzip stream, needs WITH_ZLIB.
+ *  \param ring_size Bytes buffered for the writer thread.
+ *  \throws std::runtime_error if the file can not be opened.
+ */
+iq_file_sink_sptr make_iq_file_sink(const std::string &filename,
+                                    iq_file_format format = IQ_FILE_CF32,
+                                    bool compress = false,
+                                    size_t ring_size = IQ_FILE_RING_SIZE);
+
+/*! \brief File sink of I/Q samples in cf32, cs16 or cs8.
+ *  \ingroup IO
+ *
+ * The integer formats are the samples times scale(), saturated at full
+ * scale, so a reader gets the float samples back by dividing by it.
+ * With compression the file is a gzip stream at the fastest level, which
+ * takes most off the quiet parts of a band.
+ *
+ * work() only converts the samples into a ring of aligned pages, a thread
+ * of the sink writes the ring to the file in chunks, with O_DIRECT where
+ * the file system takes it. A stall of the disk fills the ring instead of
+ * holding up the flow graph, and when the ring is full the new samples
+ * are dropped and counted rather than waited for.
+ */
+class iq_file_sink : public gr::sync_block
+{
+    friend iq_file_sink_sptr make_iq_file_sink(const std::string &filename,
+                                               iq_file_format format,
+                                               bool compress,
+                                               size_t ring_size);
+
+protected:
+    iq_file_sink(const std::string &filename, iq_file_format format, bool compress,
+                 size_t ring_size);
+
+public:
+    ~iq_file_sink();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    /*! \brief Write what is in the ring and close the file, later samples
+     *         are dropped.
+     */
+    void close();
+
+    /*! \brief Part of the ring waiting for the writer thread, 0 to 1. */
+    float ring_fill() const;
+
+    /*! \brief Samples put into the recording, the index of the next one. */
+    uint64_t samples() const { return d_head.load(std::memory_order_relaxed) / sample_size(d_format); }
+
+    /*! \brief Samples dropped because the ring was full or a write failed. */
+    uint64_t dropped() const { return d_dropped.load(std::memory_order_relaxed); }
+
+    /*! \brief Bytes of one complex sample in the given format. */
+    static size_t sample_size(iq_file_format format);
+
+    /*! \brief Integer value of a float sample at 1.0 in the given format. */
+    static float scale(iq_file_format format);
+
+    /*! \brief Whether compressed recordings are supported by this build. */
+    static bool can_compress();
+
+private:
+    void writer();
+    bool write(const char *data, size_t bytes);
+
+    iq_file_format      d_format;
+    int                 d_fd;
+    bool                d_direct;   /*!< d_fd is open with O_DIRECT. */
+#ifdef WITH_ZLIB
+    gzFile              d_gz;
+#endif
+
+    char               *d_ring;
+    size_t              d_ring_size;
+    std::atomic<uint64_t> d_head;   /*!< Bytes put into the ring by work(). */
+    std::atomic<uint64_t> d_tail;   /*!< Bytes written to the file. */
+    std::atomic<uint64_t> d_dropped;
+    std::atomic<bool>   d_failed;   /*!< A write failed, the writer has stopped. */
+
+    std::mutex          d_mutex;
+    std::condition_variable d_wake;
+    bool                d_stop;     /*!< Set by close(), under d_mutex. */
+    std::thread         d_thread;
+};
+
+#endif /* IQ_FILE_SINK_H */
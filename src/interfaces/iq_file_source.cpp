@@ -0,0 +1,294 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <gnuradio/io_signature.h>
+#include <volk/volk.h>
+
+#include "dsp/sc16_to_cf32.h"
+#include "interfaces/iq_file_source.h"
+
+static_assert(IQ_SOURCE_READAHEAD % 4096 == 0,
+              "IQ_SOURCE_READAHEAD must be a multiple of the page size");
+
+
+iq_file_source_sptr make_iq_file_source(const std::string &filename,
+                                        iq_file_format format,
+                                        double sample_rate,
+                                        bool sc16)
+{
+    return gnuradio::get_initial_sptr(new iq_file_source(filename, format, sample_rate, sc16));
+}
+
+iq_file_source::iq_file_source(const std::string &filename, iq_file_format format,
+                               double sample_rate, bool sc16)
+    : gr::sync_block ("iq_file_source",
+          gr::io_signature::make(0, 0, 0),
+          gr::io_signature::make(1, 1, sc16 ? 2 * sizeof(int16_t) : sizeof(gr_complex))),
+      d_format(format),
+      d_sc16(sc16),
+      d_sample_size(iq_file_sink::sample_size(format)),
+      d_scale(iq_file_sink::scale(format)),
+      d_rate(sample_rate),
+      d_fd(-1),
+      d_data(nullptr),
+      d_length(0),
+      d_pos(0.0),
+      d_readahead(UINT64_MAX),
+      d_position(0),
+      d_seek(-1),
+      d_speed(1.0),
+      d_produced(0)
+{
+#ifdef _WIN32
+    throw std::runtime_error("memory mapped playback is not available on this platform");
+#else
+    d_fd = ::open(filename.c_str(), O_RDONLY);
+    if (d_fd < 0)
+        throw std::runtime_error("can not open " + filename);
+
+    struct stat st;
+    if (fstat(d_fd, &st) != 0 || st.st_size < (off_t)d_sample_size)
+    {
+        ::close(d_fd);
+        throw std::runtime_error(filename + " has no samples");
+    }
+    d_length = (uint64_t)st.st_size / d_sample_size;
+
+    void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, d_fd, 0);
+    if (data == MAP_FAILED)
+    {
+        ::close(d_fd);
+        throw std::runtime_error("can not map " + filename);
+    }
+    d_data = (const char *)data;
+#endif
+}
+
+iq_file_source::~iq_file_source()
+{
+#ifndef _WIN32
+    munmap((void *)d_data, d_length * d_sample_size);
+    ::close(d_fd);
+#endif
+}
+
+int iq_file_source::work(int noutput_items,
+                         gr_vector_const_void_star &input_items,
+                         gr_vector_void_star &output_items)
+{
+    (void) input_items;
+
+    int max_items = std::max(1, (int)(d_rate * IQ_SOURCE_CHUNK_MS / 1000.0));
+    int n = std::min(noutput_items, max_items);
+
+    // An sc16 output is converted from gr_complex, except when copied in convert_sc16()
+    gr_complex *out = (gr_complex *) output_items[0];
+    if (d_sc16)
+    {
+        if (d_buf.size() < (size_t)n)
+            d_buf.resize(n);
+        out = d_buf.data();
+    }
+
+    // Pace the output at the sample rate like a throttle block would, and
+    // start over rather than catch up after a stall
+    auto now = std::chrono::steady_clock::now();
+    double due = std::chrono::duration<double>(now - d_start).count() * d_rate;
+    if (d_produced == 0 || due > (double)d_produced + d_rate)
+    {
+        d_start = now;
+        d_produced = 0;
+    }
+    else if ((double)d_produced > due)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double>(
+                                        ((double)d_produced - due) / d_rate));
+    }
+    d_produced += n;
+
+    int64_t seek = d_seek.exchange(-1, std::memory_order_relaxed);
+    if (seek >= 0)
+        d_pos = (double)seek;
+
+    double speed = d_speed.load(std::memory_order_relaxed);
+    if (speed == 1.0)
+    {
+        // Straight from the file
+        uint64_t index = std::min((uint64_t)std::max(d_pos, 0.0), d_length);
+        int count = (int)std::min<uint64_t>(n, d_length - index);
+        readahead(index, false);
+        if (d_sc16)
+        {
+            int16_t *out16 = (int16_t *) output_items[0];
+            convert_sc16(out16, index, count);
+            std::fill(out16 + 2 * count, out16 + 2 * n, 0);
+        }
+        else
+        {
+            convert(out, index, count);
+            std::fill(out + count, out + n, gr_complex(0.0f, 0.0f));
+        }
+        d_pos = (double)(index + count);
+    }
+    else if (speed == 0.0)
+    {
+        // Paused
+        std::fill(out, out + n, gr_complex(0.0f, 0.0f));
+    }
+    else
+    {
+        double last = (double)(d_length - 1);
+        readahead((uint64_t)std::max(d_pos, 0.0), speed < 0.0);
+        for (int i = 0; i < n; i++)
+        {
+            // Past an end the position stays there until the direction turns
+            if (speed > 0.0 && d_pos < 0.0)
+                d_pos = 0.0;
+            else if (speed < 0.0 && d_pos > last)
+                d_pos = last;
+            if (d_pos < 0.0 || d_pos > last)
+            {
+                out[i] = gr_complex(0.0f, 0.0f);
+                continue;
+            }
+            uint64_t index = (uint64_t)d_pos;
+            float frac = (float)(d_pos - index);
+            gr_complex s0 = sample(index);
+            gr_complex s1 = index + 1 < d_length ? sample(index + 1) : s0;
+            gr_complex s = s0 + frac * (s1 - s0);
+            out[i] = speed < 0.0 ? std::conj(s) : s;
+            d_pos += speed;
+        }
+    }
+    if (d_sc16 && speed != 1.0)
+        volk_32f_s32f_convert_16i((int16_t *) output_items[0], (const float *) out,
+                                  SC16_SCALE, 2 * n);
+    d_position.store(std::min((uint64_t)std::max(d_pos, 0.0), d_length),
+                     std::memory_order_relaxed);
+
+    return n;
+}
+
+void iq_file_source::seek(uint64_t sample)
+{
+    sample = std::min(sample, d_length);
+    d_position.store(sample, std::memory_order_relaxed);
+    d_seek.store((int64_t)sample, std::memory_order_relaxed);
+}
+
+gr_complex iq_file_source::sample(uint64_t index) const
+{
+    const char *p = d_data + index * d_sample_size;
+
+    if (d_format == IQ_FILE_CS16)
+    {
+        int16_t v[2];
+        memcpy(v, p, sizeof(v));
+        return gr_complex(v[0], v[1]) / d_scale;
+    }
+    if (d_format == IQ_FILE_CS8)
+    {
+        int8_t v[2];
+        memcpy(v, p, sizeof(v));
+        return gr_complex(v[0], v[1]) / d_scale;
+    }
+
+    gr_complex v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+void iq_file_source::convert(gr_complex *out, uint64_t index, int count) const
+{
+    const char *p = d_data + index * d_sample_size;
+
+    switch (d_format)
+    {
+    case IQ_FILE_CS16:
+        volk_16i_s32f_convert_32f((float *)out, (const int16_t *)p, d_scale, 2 * count);
+        break;
+    case IQ_FILE_CS8:
+        volk_8i_s32f_convert_32f((float *)out, (const int8_t *)p, d_scale, 2 * count);
+        break;
+    default:
+        memcpy(out, p, sizeof(gr_complex) * count);
+        break;
+    }
+}
+
+/* As convert(), to complex int16 with SC16_SCALE as 1.0 */
+void iq_file_source::convert_sc16(int16_t *out, uint64_t index, int count) const
+{
+    const char *p = d_data + index * d_sample_size;
+
+    switch (d_format)
+    {
+    case IQ_FILE_CS16:
+        memcpy(out, p, d_sample_size * count);
+        break;
+    case IQ_FILE_CS8:
+        // 127 * 258 is 32766
+        for (int i = 0; i < 2 * count; i++)
+            out[i] = (int16_t)(((const int8_t *)p)[i] * 258);
+        break;
+    default:
+        volk_32f_s32f_convert_16i(out, (const float *)p, SC16_SCALE, 2 * count);
+        break;
+    }
+}
+
+/*
+ * The kernel reads ahead of sequential access by itself but not behind it,
+ * so the window the position is in and the next one in the direction of
+ * play are asked for whenever the position reaches a new window.
+ */
+void iq_file_source::readahead(uint64_t index, bool reverse)
+{
+#ifndef _WIN32
+    uint64_t window = index * d_sample_size / IQ_SOURCE_READAHEAD;
+    if (window == d_readahead)
+        return;
+    d_readahead = window;
+
+    uint64_t bytes = d_length * d_sample_size;
+    uint64_t start = window * IQ_SOURCE_READAHEAD;
+    if (reverse)
+        start = start >= IQ_SOURCE_READAHEAD ? start - IQ_SOURCE_READAHEAD : 0;
+    if (start >= bytes)
+        return;
+    madvise((void *)(d_data + start), std::min<uint64_t>(2 * IQ_SOURCE_READAHEAD, bytes - start),
+            MADV_WILLNEED);
+#else
+    (void) index;
+    (void) reverse;
+#endif
+}
@@ -0,0 +1,140 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef IQ_FILE_SOURCE_H
+#define IQ_FILE_SOURCE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <gnuradio/sync_block.h>
+
+#include "interfaces/iq_file_sink.h"
+
+/* Longest block of samples work() produces, in ms of playback */
+#define IQ_SOURCE_CHUNK_MS 20
+
+/* Bytes read ahead of the playback position, in the direction it plays */
+#define IQ_SOURCE_READAHEAD (4 * 1024 * 1024)
+
+class iq_file_source;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<iq_file_source> iq_file_source_sptr;
+#else
+typedef std::shared_ptr<iq_file_source> iq_file_source_sptr;
+#endif
+
+/*! \brief Return a shared_ptr to a new instance of iq_file_source.
+ *  \param filename The uncompressed recording to play.
+ *  \param format The sample format of the file.
+ *  \param sample_rate The rate the samples are put out at.
+ *  \param sc16 Put out complex int16 instead of gr_complex.
+ *  \throws std::runtime_error if the file can not be opened or mapped.
+ */
+iq_file_source_sptr make_iq_file_source(const std::string &filename,
+                                        iq_file_format format,
+                                        double sample_rate,
+                                        bool sc16 = false);
+
+/*! \brief Playback of an I/Q recording mapped into memory.
+ *  \ingroup IO
+ *
+ * The file is read through a read-only mapping, so a seek only moves the
+ * position work() reads at and takes effect with the next block, without
+ * locking the flow graph. Blocks are at most IQ_SOURCE_CHUNK_MS long and
+ * put out at the sample rate.
+ *
+ * The speed is the number of file samples per output sample. Other speeds
+ * than 1 interpolate linearly between the nearest samples, with no filter,
+ * which is for finding the way around a recording rather than listening.
+ * A negative speed plays backwards, with the samples conjugated so that
+ * the signals stay on their frequencies. At either end of the file the
+ * source holds its position and puts out zeros.
+ *
+ * With sc16 the samples are put out as complex int16 with SC16_SCALE as
+ * 1.0, half the bytes of gr_complex, for a decimator with int16 stages.
+ * A cs16 recording played at speed 1 is then copied as it is.
+ */
+class iq_file_source : public gr::sync_block
+{
+    friend iq_file_source_sptr make_iq_file_source(const std::string &filename,
+                                                   iq_file_format format,
+                                                   double sample_rate,
+                                                   bool sc16);
+
+protected:
+    iq_file_source(const std::string &filename, iq_file_format format,
+                   double sample_rate, bool sc16);
+
+public:
+    ~iq_file_source();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    /*! \brief Play from the given sample on, limited to the file. */
+    void seek(uint64_t sample);
+
+    /*! \brief Sample work() reads next. */
+    uint64_t position() const { return d_position.load(std::memory_order_relaxed); }
+
+    /*! \brief Samples in the file. */
+    uint64_t length() const { return d_length; }
+
+    /*! \brief Set the file samples per output sample, negative to reverse. */
+    void set_speed(double speed) { d_speed.store(speed, std::memory_order_relaxed); }
+    double speed() const { return d_speed.load(std::memory_order_relaxed); }
+
+    /*! \brief Whether the output is complex int16. */
+    bool is_sc16() const { return d_sc16; }
+
+private:
+    gr_complex sample(uint64_t index) const;
+    void convert(gr_complex *out, uint64_t index, int count) const;
+    void convert_sc16(int16_t *out, uint64_t index, int count) const;
+    void readahead(uint64_t index, bool reverse);
+
+    iq_file_format          d_format;
+    bool                    d_sc16;
+    std::vector<gr_complex> d_buf;          /*!< Samples of an sc16 output before conversion. */
+    size_t                  d_sample_size;
+    float                   d_scale;        /*!< Integer value of 1.0. */
+    double                  d_rate;
+    int                     d_fd;
+    const char             *d_data;         /*!< Mapping of the whole file. */
+    uint64_t                d_length;
+
+    double                  d_pos;          /*!< Fractional position of work(). */
+    uint64_t                d_readahead;    /*!< Byte offset last read ahead at. */
+    std::atomic<uint64_t>   d_position;
+    std::atomic<int64_t>    d_seek;         /*!< Sample to seek to, or -1. */
+    std::atomic<double>     d_speed;
+
+    std::chrono::steady_clock::time_point d_start;  /*!< Time of sample d_produced = 0. */
+    uint64_t                d_produced;
+};
+
+#endif /* IQ_FILE_SOURCE_H */
@@ -0,0 +1,546 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include <gnuradio/io_signature.h>
+#include <volk/volk.h>
+
+#include "interfaces/iq_stream_sink.h"
+
+static_assert(IQ_STREAM_UDP_PAYLOAD % 8 == 0 && IQ_STREAM_TCP_RECORD % 8 == 0,
+              "the records must hold whole samples of every format");
+static_assert((IQ_STREAM_RING_SIZE & (IQ_STREAM_RING_SIZE - 1)) == 0,
+              "IQ_STREAM_RING_SIZE must be a power of two");
+
+/* Magic of the records, "AGI1" */
+#define IQ_STREAM_MAGIC 0x31494741
+
+/* Types of the records */
+#define IQ_STREAM_SAMPLES  0
+#define IQ_STREAM_METADATA 1
+
+
+iq_stream_sink_sptr make_iq_stream_sink(const std::string &source,
+                                        iq_file_format format,
+                                        int tcp_port,
+                                        const std::string &group,
+                                        int udp_port)
+{
+    return gnuradio::get_initial_sptr(new iq_stream_sink(source, format, tcp_port,
+                                                         group, udp_port));
+}
+
+#ifndef _WIN32
+static void set_nonblocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/* Listening socket on all addresses, IPv6 with IPv4 mapped where there is IPv6 */
+static int open_listener(int port)
+{
+    struct addrinfo hints;
+    struct addrinfo *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(nullptr, std::to_string(port).c_str(), &hints, &res) != 0)
+        return -1;
+
+    // Prefer IPv6, which takes the IPv4 clients as well
+    std::vector<struct addrinfo *> candidates;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next)
+        candidates.insert(ai->ai_family == AF_INET6 ? candidates.begin() : candidates.end(), ai);
+
+    int fd = -1;
+    for (struct addrinfo *ai : candidates)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        int on = 1;
+        int off = 0;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (ai->ai_family == AF_INET6)
+            setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 8) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+
+    if (fd >= 0)
+        set_nonblocking(fd);
+    return fd;
+}
+
+/* Connected datagram socket, with the hop limit when it is a multicast group */
+static int open_sender(const std::string &group, int port)
+{
+    struct addrinfo hints;
+    struct addrinfo *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(group.c_str(), std::to_string(port).c_str(), &hints, &res) != 0)
+        return -1;
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        int hops = IQ_STREAM_MCAST_TTL;
+        if (ai->ai_family == AF_INET6)
+            setsockopt(fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &hops, sizeof(hops));
+        else
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops));
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+
+    if (fd >= 0)
+        set_nonblocking(fd);
+    return fd;
+}
+#endif
+
+iq_stream_sink::iq_stream_sink(const std::string &source, iq_file_format format,
+                               int tcp_port, const std::string &group, int udp_port)
+    : gr::sync_block ("iq_stream_sink",
+          gr::io_signature::make(1, 1, sizeof(gr_complex)),
+          gr::io_signature::make(0, 0, 0)),
+      d_source(source),
+      d_format(format),
+      d_size(iq_file_sink::sample_size(format)),
+      d_listen_fd(-1),
+      d_udp_fd(-1),
+      d_ring(nullptr),
+      d_head(0),
+      d_readers(0),
+      d_clients(0),
+      d_dropped(0),
+      d_sample_rate(0.0),
+      d_frequency(0.0),
+      d_meta_seq(0),
+      d_stop(false)
+{
+#ifdef _WIN32
+    (void) tcp_port;
+    (void) group;
+    (void) udp_port;
+    throw std::runtime_error("I/Q streaming is not supported on this platform");
+#else
+    if (tcp_port > 0)
+    {
+        d_listen_fd = open_listener(tcp_port);
+        if (d_listen_fd < 0)
+            throw std::runtime_error("can not listen on TCP port " + std::to_string(tcp_port));
+    }
+    if (udp_port > 0)
+    {
+        d_udp_fd = open_sender(group, udp_port);
+        if (d_udp_fd < 0)
+        {
+            if (d_listen_fd >= 0)
+                close(d_listen_fd);
+            throw std::runtime_error("can not send to " + group + ":" + std::to_string(udp_port));
+        }
+        d_readers.store(1);
+    }
+
+    d_ring = (char *) volk_malloc(IQ_STREAM_RING_SIZE, volk_get_alignment());
+    if (!d_ring)
+    {
+        if (d_listen_fd >= 0)
+            close(d_listen_fd);
+        if (d_udp_fd >= 0)
+            close(d_udp_fd);
+        throw std::runtime_error("can not allocate the I/Q stream ring");
+    }
+
+    d_thread = std::thread(&iq_stream_sink::server, this);
+#endif
+}
+
+iq_stream_sink::~iq_stream_sink()
+{
+    d_stop.store(true);
+    if (d_thread.joinable())
+        d_thread.join();
+#ifndef _WIN32
+    if (d_listen_fd >= 0)
+        close(d_listen_fd);
+    if (d_udp_fd >= 0)
+        close(d_udp_fd);
+#endif
+    volk_free(d_ring);
+}
+
+void iq_stream_sink::set_params(double sample_rate, double frequency)
+{
+    std::lock_guard<std::mutex> lock(d_params_mutex);
+    if (sample_rate == d_sample_rate && frequency == d_frequency)
+        return;
+
+    d_sample_rate = sample_rate;
+    d_frequency = frequency;
+    d_meta_seq.fetch_add(1);
+}
+
+int iq_stream_sink::work(int noutput_items,
+                         gr_vector_const_void_star &input_items,
+                         gr_vector_void_star &output_items)
+{
+    (void) output_items;
+
+    const float *in = (const float *) input_items[0];
+    uint64_t head = d_head.load(std::memory_order_relaxed);
+
+    // Nobody reads, the samples are only counted
+    if (d_readers.load(std::memory_order_relaxed) == 0)
+    {
+        d_head.store(head + noutput_items * d_size, std::memory_order_release);
+        return noutput_items;
+    }
+
+    // The ring is overwritten whatever the readers do, they notice it
+    int done = 0;
+    while (done < noutput_items)
+    {
+        size_t pos = head & (IQ_STREAM_RING_SIZE - 1);
+        int part = std::min<uint64_t>(noutput_items - done, (IQ_STREAM_RING_SIZE - pos) / d_size);
+        char *out = d_ring + pos;
+
+        if (d_format == IQ_FILE_CS16)
+            volk_32f_s32f_convert_16i((int16_t *) out, in + 2 * done,
+                                      iq_file_sink::scale(d_format), 2 * part);
+        else if (d_format == IQ_FILE_CS8)
+            volk_32f_s32f_convert_8i((int8_t *) out, in + 2 * done,
+                                     iq_file_sink::scale(d_format), 2 * part);
+        else
+            std::copy_n((const char *)(in + 2 * done), part * d_size, out);
+
+        head += part * d_size;
+        done += part;
+    }
+    d_head.store(head, std::memory_order_release);
+
+    return noutput_items;
+}
+
+/* Little endian fields, c.f. the FFT stream */
+static void put_le(char *out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        out[i] = (char)((value >> (8 * i)) & 0xff);
+}
+
+void iq_stream_sink::put_header(char *out, uint16_t type, uint32_t length,
+                                uint32_t skipped, uint64_t sample)
+{
+    put_le(out, IQ_STREAM_MAGIC, 4);
+    put_le(out + 4, type, 2);
+    put_le(out + 6, IQ_STREAM_HEADER_SIZE, 2);
+    put_le(out + 8, length, 4);
+    put_le(out + 12, skipped, 4);
+    put_le(out + 16, sample, 8);
+}
+
+/* SigMF global and capture objects of the samples from sample on */
+std::string iq_stream_sink::metadata(uint64_t sample)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    static const char *datatypes[] = {"cf32_be", "ci16_be", "ci8"};
+#else
+    static const char *datatypes[] = {"cf32_le", "ci16_le", "ci8"};
+#endif
+    double sample_rate;
+    double frequency;
+    {
+        std::lock_guard<std::mutex> lock(d_params_mutex);
+        sample_rate = d_sample_rate;
+        frequency = d_frequency;
+    }
+
+    auto now = std::chrono::system_clock::now();
+    std::time_t secs = std::chrono::system_clock::to_time_t(now);
+    int ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+    struct tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &secs);
+#else
+    gmtime_r(&secs, &utc);
+#endif
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &utc);
+
+    std::ostringstream json;
+    json.precision(15);
+    json << "{\"global\":{\"core:datatype\":\"" << datatypes[d_format] << "\""
+         << ",\"core:sample_rate\":" << sample_rate
+         << ",\"core:version\":\"1.0.0\""
+         << ",\"gqrx:full_scale\":" << iq_file_sink::scale(d_format)
+         << ",\"gqrx:source\":\"" << d_source << "\"}"
+         << ",\"captures\":[{\"core:sample_start\":" << sample
+         << ",\"core:frequency\":" << frequency
+         << ",\"core:datetime\":\"" << date << "." << std::to_string(1000 + ms).substr(1) << "Z\"}]}";
+    return json.str();
+}
+
+/*! \brief Put the next record of a reader in its buffer.
+ *  \return false if there is nothing to send.
+ *
+ * The samples are copied out of the ring and only kept if the ring was
+ * not overwritten under them meanwhile, so the records are never torn.
+ */
+bool iq_stream_sink::make_record(reader &r, size_t max_payload)
+{
+    r.out.clear();
+    r.sent = 0;
+
+    const unsigned int meta_seq = d_meta_seq.load();
+    if (r.meta_seq != meta_seq)
+    {
+        const std::string meta = metadata(r.pos / d_size);
+        r.out.resize(IQ_STREAM_HEADER_SIZE + meta.size());
+        put_header(r.out.data(), IQ_STREAM_METADATA, meta.size(), 0, r.pos / d_size);
+        std::copy(meta.begin(), meta.end(), r.out.begin() + IQ_STREAM_HEADER_SIZE);
+        r.meta_seq = meta_seq;
+        return true;
+    }
+
+    for (;;)
+    {
+        uint64_t head = d_head.load(std::memory_order_acquire);
+        if (head - r.pos > IQ_STREAM_MAX_LAG)
+        {
+            r.skipped += (head - r.pos) / d_size;
+            d_dropped.fetch_add((head - r.pos) / d_size, std::memory_order_relaxed);
+            r.pos = head;
+        }
+        if (head == r.pos)
+            return false;
+
+        size_t length = std::min<uint64_t>(head - r.pos, max_payload);
+        r.out.resize(IQ_STREAM_HEADER_SIZE + length);
+        size_t offset = r.pos & (IQ_STREAM_RING_SIZE - 1);
+        size_t first = std::min(length, IQ_STREAM_RING_SIZE - offset);
+        std::copy_n(d_ring + offset, first, r.out.data() + IQ_STREAM_HEADER_SIZE);
+        std::copy_n(d_ring, length - first, r.out.data() + IQ_STREAM_HEADER_SIZE + first);
+
+        if (d_head.load(std::memory_order_acquire) - r.pos > IQ_STREAM_RING_SIZE)
+        {
+            r.skipped += length / d_size;
+            d_dropped.fetch_add(length / d_size, std::memory_order_relaxed);
+            r.pos += length;
+            continue;
+        }
+
+        put_header(r.out.data(), IQ_STREAM_SAMPLES, length,
+                   (uint32_t) std::min<uint64_t>(r.skipped, UINT32_MAX), r.pos / d_size);
+        r.pos += length;
+        r.skipped = 0;
+        return true;
+    }
+}
+
+#ifndef _WIN32
+/*! \brief Send to a TCP client until its socket is full.
+ *  \return false if the client is gone.
+ */
+bool iq_stream_sink::serve_client(reader &r)
+{
+    for (;;)
+    {
+        if (r.sent == r.out.size() && !make_record(r, IQ_STREAM_TCP_RECORD))
+            return true;
+
+        ssize_t n = ::send(r.fd, r.out.data() + r.sent, r.out.size() - r.sent, MSG_NOSIGNAL);
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        r.sent += n;
+    }
+}
+
+/*
+ * Send the datagrams that are due, in batches of IQ_STREAM_UDP_BATCH. A
+ * full socket buffer drops the batch rather than queueing it, datagrams
+ * are not waited for.
+ */
+void iq_stream_sink::serve_datagrams(reader &r)
+{
+    std::vector<char> batch[IQ_STREAM_UDP_BATCH];
+    unsigned int count = 0;
+
+    for (;;)
+    {
+        if (count < IQ_STREAM_UDP_BATCH && make_record(r, IQ_STREAM_UDP_PAYLOAD))
+        {
+            batch[count++].swap(r.out);
+            continue;
+        }
+        if (count == 0)
+            return;
+
+#if defined(__linux__)
+        struct mmsghdr msgs[IQ_STREAM_UDP_BATCH];
+        struct iovec iovs[IQ_STREAM_UDP_BATCH];
+        memset(msgs, 0, sizeof(msgs));
+        for (unsigned int i = 0; i < count; i++)
+        {
+            iovs[i].iov_base = batch[i].data();
+            iovs[i].iov_len = batch[i].size();
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int sent = sendmmsg(d_udp_fd, msgs, count, 0);
+#else
+        int sent = 0;
+        while (sent < (int) count && ::send(d_udp_fd, batch[sent].data(), batch[sent].size(), 0) >= 0)
+            sent++;
+#endif
+        if (sent < (int) count && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            for (unsigned int i = std::max(sent, 0); i < count; i++)
+            {
+                if (batch[i][4] != IQ_STREAM_SAMPLES)
+                    continue;
+                const uint64_t lost = (batch[i].size() - IQ_STREAM_HEADER_SIZE) / d_size;
+                r.skipped += lost;
+                d_dropped.fetch_add(lost, std::memory_order_relaxed);
+            }
+            return;
+        }
+        count = 0;
+    }
+}
+
+void iq_stream_sink::server()
+{
+    std::vector<reader> clients;
+    reader datagrams{d_udp_fd, d_head.load(), 0, ~0u, {}, 0};
+    auto next_meta = std::chrono::steady_clock::now();
+
+    while (!d_stop.load())
+    {
+        std::vector<struct pollfd> fds;
+        if (d_listen_fd >= 0)
+            fds.push_back({d_listen_fd, POLLIN, 0});
+        for (reader &c : clients)
+            fds.push_back({c.fd, (short)(POLLIN | (c.sent < c.out.size() ? POLLOUT : 0)), 0});
+        poll(fds.data(), fds.size(), IQ_STREAM_POLL_MS);
+
+        if (d_listen_fd >= 0 && (fds[0].revents & POLLIN))
+        {
+            int fd;
+            while ((fd = accept(d_listen_fd, nullptr, nullptr)) >= 0)
+            {
+                set_nonblocking(fd);
+                clients.push_back({fd, d_head.load(), 0, ~0u, {}, 0});
+                d_readers.fetch_add(1);
+            }
+        }
+
+        size_t first = d_listen_fd >= 0 ? 1 : 0;
+        for (size_t i = 0; i < clients.size();)
+        {
+            bool alive = true;
+            // The clients are not expected to send, anything they do is read away
+            if (i + first < fds.size() && (fds[i + first].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                char buf[256];
+                ssize_t n = recv(clients[i].fd, buf, sizeof(buf), 0);
+                alive = n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR));
+            }
+            if (alive)
+                alive = serve_client(clients[i]);
+            if (!alive)
+            {
+                close(clients[i].fd);
+                clients.erase(clients.begin() + i);
+                fds.erase(fds.begin() + i + first);
+                d_readers.fetch_sub(1);
+                continue;
+            }
+            i++;
+        }
+        d_clients.store(clients.size(), std::memory_order_relaxed);
+
+        if (d_udp_fd >= 0)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= next_meta)
+            {
+                datagrams.meta_seq = ~0u;
+                next_meta = now + std::chrono::milliseconds(IQ_STREAM_META_MS);
+            }
+            serve_datagrams(datagrams);
+        }
+    }
+
+    for (reader &c : clients)
+        close(c.fd);
+    d_clients.store(0);
+}
+#else
+bool iq_stream_sink::serve_client(reader &r)
+{
+    (void) r;
+    return false;
+}
+
+void iq_stream_sink::serve_datagrams(reader &r)
+{
+    (void) r;
+}
+
+void iq_stream_sink::server()
+{
+}
+#endif
@@ -0,0 +1,169 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef IQ_STREAM_SINK_H
+#define IQ_STREAM_SINK_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gnuradio/sync_block.h>
+
+#include "interfaces/iq_file_sink.h"
+
+/* Size of the ring the clients read the samples from in bytes */
+#define IQ_STREAM_RING_SIZE (32 * 1024 * 1024)
+
+/* Backlog of a client in bytes past which it skips to the newest samples */
+#define IQ_STREAM_MAX_LAG (IQ_STREAM_RING_SIZE / 2)
+
+/* Largest record of samples sent to a TCP client */
+#define IQ_STREAM_TCP_RECORD (64 * 1024)
+
+/* Samples in a datagram in bytes, whole samples of every format */
+#define IQ_STREAM_UDP_PAYLOAD 1408
+
+/* Datagrams sent with one system call */
+#define IQ_STREAM_UDP_BATCH 32
+
+/* Interval of the metadata datagrams, for receivers that join late */
+#define IQ_STREAM_META_MS 1000
+
+/* Time the server thread waits for the sockets before it looks at the ring */
+#define IQ_STREAM_POLL_MS 10
+
+/* Hops a multicast datagram may take */
+#define IQ_STREAM_MCAST_TTL 8
+
+/* Size of the header of every record */
+#define IQ_STREAM_HEADER_SIZE 24
+
+class iq_stream_sink;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<iq_stream_sink> iq_stream_sink_sptr;
+#else
+typedef std::shared_ptr<iq_stream_sink> iq_stream_sink_sptr;
+#endif
+
+/*! \brief Return a shared_ptr to a new instance of iq_stream_sink.
+ *  \param source Name of the stream in its metadata, e.g. "baseband".
+ *  \param format The sample format of the stream.
+ *  \param tcp_port Port the clients connect to, 0 for none.
+ *  \param group Multicast group, or any host, the datagrams go to.
+ *  \param udp_port Port of the datagrams, 0 for none.
+ *  \throws std::runtime_error if a socket can not be opened.
+ */
+iq_stream_sink_sptr make_iq_stream_sink(const std::string &source,
+                                        iq_file_format format,
+                                        int tcp_port,
+                                        const std::string &group = std::string(),
+                                        int udp_port = 0);
+
+/*! \brief Network server of I/Q samples in cf32, cs16 or cs8.
+ *  \ingroup IO
+ *
+ * The samples are served to any number of TCP clients and sent as
+ * datagrams to a multicast group, in records with a IQ_STREAM_HEADER_SIZE
+ * header that numbers them, see resources/remote-control.txt. Metadata
+ * records hold the SigMF global and capture objects of the stream; a
+ * client gets one first and after every set_params(), the datagrams every
+ * IQ_STREAM_META_MS as well.
+ *
+ * work() only writes the samples into a ring, converted like in an
+ * iq_file_sink. A thread of the sink sends the ring to each reader from
+ * where that reader is, so a slow reader never holds up the flow graph or
+ * the other readers. A reader more than IQ_STREAM_MAX_LAG behind skips to
+ * the newest samples and the next record tells how many it lost.
+ */
+class iq_stream_sink : public gr::sync_block
+{
+    friend iq_stream_sink_sptr make_iq_stream_sink(const std::string &source,
+                                                   iq_file_format format,
+                                                   int tcp_port,
+                                                   const std::string &group,
+                                                   int udp_port);
+
+protected:
+    iq_stream_sink(const std::string &source, iq_file_format format, int tcp_port,
+                   const std::string &group, int udp_port);
+
+public:
+    ~iq_stream_sink();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    /*! \brief Set the rate and center of the samples, for the metadata. */
+    void set_params(double sample_rate, double frequency);
+
+    /*! \brief Number of TCP clients connected. */
+    int clients() const { return d_clients.load(std::memory_order_relaxed); }
+
+    /*! \brief Samples the readers skipped, summed over them. */
+    uint64_t dropped() const { return d_dropped.load(std::memory_order_relaxed); }
+
+private:
+    /* Position of a client or of the datagrams in the ring */
+    struct reader {
+        int                 fd;
+        uint64_t            pos;        /*!< Next byte of the stream to send. */
+        uint64_t            skipped;    /*!< Samples lost since the last record. */
+        unsigned int        meta_seq;   /*!< Metadata it got last. */
+        std::vector<char>   out;        /*!< Record being sent. */
+        size_t              sent;
+    };
+
+    void server();
+    bool make_record(reader &r, size_t max_payload);
+    void put_header(char *out, uint16_t type, uint32_t length, uint32_t skipped,
+                    uint64_t sample);
+    std::string metadata(uint64_t sample);
+    bool serve_client(reader &r);
+    void serve_datagrams(reader &r);
+
+    std::string         d_source;
+    iq_file_format      d_format;
+    size_t              d_size;         /*!< Bytes of one sample. */
+    int                 d_listen_fd;
+    int                 d_udp_fd;
+
+    char               *d_ring;
+    std::atomic<uint64_t> d_head;       /*!< Bytes written since the start. */
+    std::atomic<int>    d_readers;      /*!< The ring is only written for readers. */
+    std::atomic<int>    d_clients;
+    std::atomic<uint64_t> d_dropped;
+
+    std::mutex          d_params_mutex;
+    double              d_sample_rate;
+    double              d_frequency;
+    std::atomic<unsigned int> d_meta_seq;
+
+    std::atomic<bool>   d_stop;
+    std::thread         d_thread;
+};
+
+#endif // IQ_STREAM_SINK_H
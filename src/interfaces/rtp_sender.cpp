@@ -0,0 +1,224 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "rtp_sender.h"
+
+static_assert(RTP_SENDER_BATCH <= RTP_SENDER_QUEUE,
+              "RTP_SENDER_BATCH must not exceed RTP_SENDER_QUEUE");
+
+
+rtp_sender_sptr rtp_sender::get(const std::string &host, int port)
+{
+#ifdef _WIN32
+    (void) host;
+    (void) port;
+    std::cerr << "RTP streaming is not supported on this platform" << std::endl;
+    return nullptr;
+#else
+    static std::mutex registry_mutex;
+    static std::map<std::string, std::weak_ptr<rtp_sender>> registry;
+
+    const std::string key = host + ":" + std::to_string(port);
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    rtp_sender_sptr sender = registry[key].lock();
+    if (sender)
+        return sender;
+
+    struct addrinfo hints;
+    struct addrinfo *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    int err = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res);
+    if (err != 0)
+    {
+        std::cerr << "RTP streaming: can not resolve " << host << ": "
+                  << gai_strerror(err) << std::endl;
+        return nullptr;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd < 0)
+    {
+        std::cerr << "RTP streaming: can not open a socket to " << key << std::endl;
+        return nullptr;
+    }
+
+    sender = rtp_sender_sptr(new rtp_sender(fd));
+    registry[key] = sender;
+    for (auto it = registry.begin(); it != registry.end();)
+        it = it->second.expired() ? registry.erase(it) : std::next(it);
+
+    return sender;
+#endif
+}
+
+rtp_sender::rtp_sender(int fd)
+    : d_fd(fd),
+      d_queue(RTP_SENDER_QUEUE),
+      d_head(0),
+      d_count(0),
+      d_dropped(0),
+      d_stop(false)
+{
+    d_thread = std::thread(&rtp_sender::run, this);
+}
+
+rtp_sender::~rtp_sender()
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_stop = true;
+    }
+    d_cond.notify_one();
+    d_thread.join();
+#ifndef _WIN32
+    close(d_fd);
+#endif
+    if (d_dropped > 0)
+        std::cerr << "RTP streaming: " << d_dropped << " packets dropped" << std::endl;
+}
+
+void rtp_sender::send(const uint8_t *data, size_t length)
+{
+    length = std::min<size_t>(length, RTP_SENDER_MAX_PACKET);
+
+    std::unique_lock<std::mutex> lock(d_mutex);
+    if (d_count == RTP_SENDER_QUEUE)
+    {
+        d_dropped++;
+        return;
+    }
+
+    // The slots past the queued packets are not touched by the thread
+    packet &p = d_queue[d_head];
+    memcpy(p.data, data, length);
+    p.length = (uint16_t) length;
+    d_head = (d_head + 1) % RTP_SENDER_QUEUE;
+    d_count++;
+
+    // Only the first packet of a batch and a full batch wake the thread up
+    const bool wake = d_count == 1 || d_count == RTP_SENDER_BATCH;
+    lock.unlock();
+    if (wake)
+        d_cond.notify_one();
+}
+
+unsigned long rtp_sender::dropped()
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+    return d_dropped;
+}
+
+void rtp_sender::run()
+{
+    std::unique_lock<std::mutex> lock(d_mutex);
+
+    while (true)
+    {
+        d_cond.wait(lock, [this] { return d_stop || d_count > 0; });
+        if (d_stop)
+            break;
+
+        d_cond.wait_for(lock, std::chrono::milliseconds(RTP_SENDER_FLUSH_MS),
+                        [this] { return d_stop || d_count >= RTP_SENDER_BATCH; });
+
+        while (d_count > 0)
+        {
+            const unsigned int count = std::min<unsigned int>(d_count, RTP_SENDER_BATCH);
+            const unsigned int first = (d_head + RTP_SENDER_QUEUE - d_count) % RTP_SENDER_QUEUE;
+
+            // The packets stay counted until they are sent, which keeps
+            // their slots from being reused meanwhile
+            lock.unlock();
+            transmit(first, count);
+            lock.lock();
+            d_count -= count;
+        }
+    }
+}
+
+/*! \brief Send count packets from first, wrapping around the queue.
+ *
+ * Errors are ignored, as a connected UDP socket reports the ICMP errors of
+ * the earlier packets when nobody listens at the destination.
+ */
+void rtp_sender::transmit(unsigned int first, unsigned int count)
+{
+#if defined(__linux__)
+    struct mmsghdr msgs[RTP_SENDER_BATCH];
+    struct iovec iovs[RTP_SENDER_BATCH];
+
+    memset(msgs, 0, sizeof(msgs));
+    for (unsigned int i = 0; i < count; i++)
+    {
+        packet &p = d_queue[(first + i) % RTP_SENDER_QUEUE];
+        iovs[i].iov_base = p.data;
+        iovs[i].iov_len = p.length;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    unsigned int sent = 0;
+    while (sent < count)
+    {
+        int n = sendmmsg(d_fd, msgs + sent, count - sent, 0);
+        if (n <= 0)
+            n = 1;  // skip the packet that failed
+        sent += n;
+    }
+#elif !defined(_WIN32)
+    for (unsigned int i = 0; i < count; i++)
+    {
+        packet &p = d_queue[(first + i) % RTP_SENDER_QUEUE];
+        (void) ::send(d_fd, p.data, p.length, 0);
+    }
+#else
+    (void) first;
+    (void) count;
+#endif
+}
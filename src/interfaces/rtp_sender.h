@@ -0,0 +1,100 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RTP_SENDER_H
+#define RTP_SENDER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Largest datagram the sender queues, fits the usual 1500 byte MTU */
+#define RTP_SENDER_MAX_PACKET 1472
+
+/* Number of packets the queue of a sender holds */
+#define RTP_SENDER_QUEUE 256
+
+/* Number of packets sent with one system call */
+#define RTP_SENDER_BATCH 32
+
+/* Longest time a packet waits in the queue for the batch to fill */
+#define RTP_SENDER_FLUSH_MS 5
+
+class rtp_sender;
+
+typedef std::shared_ptr<rtp_sender> rtp_sender_sptr;
+
+
+/*! \brief Batched sender of the datagrams to one destination.
+ *  \ingroup IO
+ *
+ * All the streams to the same host and port share one sender, so a socket
+ * and a thread serve any number of channels. The packets are queued by the
+ * scheduler threads of the streams and sent by the thread of the sender in
+ * batches of up to RTP_SENDER_BATCH, with sendmmsg() on Linux, once the
+ * batch is full or RTP_SENDER_FLUSH_MS after the first packet. A packet
+ * that does not fit in the queue is dropped, the streams never block.
+ */
+class rtp_sender
+{
+public:
+    /*! \brief Get the sender to a destination, created if there is none.
+     *  \return nullptr if the host can not be resolved or sockets are not
+     *          supported on the platform.
+     */
+    static rtp_sender_sptr get(const std::string &host, int port);
+
+    ~rtp_sender();
+
+    /*! \brief Queue a copy of a datagram of at most RTP_SENDER_MAX_PACKET bytes. */
+    void send(const uint8_t *data, size_t length);
+
+    /*! \brief Number of packets dropped because the queue was full. */
+    unsigned long dropped();
+
+private:
+    rtp_sender(int fd);
+
+    void run();
+    void transmit(unsigned int first, unsigned int count);
+
+    struct packet {
+        uint16_t    length;
+        uint8_t     data[RTP_SENDER_MAX_PACKET];
+    };
+
+    int                     d_fd;          /*!< Connected UDP socket. */
+    std::vector<packet>     d_queue;       /*!< RTP_SENDER_QUEUE packets. */
+    unsigned int            d_head;        /*!< Next packet to queue. */
+    unsigned int            d_count;       /*!< Packets in the queue. */
+    unsigned long           d_dropped;
+    bool                    d_stop;
+    std::mutex              d_mutex;
+    std::condition_variable d_cond;
+    std::thread             d_thread;
+};
+
+#endif // RTP_SENDER_H
@@ -0,0 +1,167 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <gnuradio/io_signature.h>
+
+#include "interfaces/rtp_sink_f.h"
+
+/* Size of the fixed RTP header, no CSRC and no extension */
+#define RTP_HEADER_SIZE 12
+
+rtp_sink_f_sptr make_rtp_sink_f(rtp_sender_sptr sender, uint32_t channel,
+                                int channels, int rate, bool opus)
+{
+    return gnuradio::get_initial_sptr(new rtp_sink_f(sender, channel, channels, rate, opus));
+}
+
+rtp_sink_f::rtp_sink_f(rtp_sender_sptr sender, uint32_t channel, int channels,
+                       int rate, bool opus)
+    : gr::sync_block ("rtp_sink_f",
+          gr::io_signature::make(channels, channels, sizeof(float)),
+          gr::io_signature::make(0, 0, 0)),
+      d_sender(sender),
+      d_ssrc(channel),
+      d_channels(channels),
+      d_opus(opus),
+      d_seq(0),
+      d_timestamp(0),
+      d_first(true),
+      d_fill(0),
+      d_packet(RTP_SENDER_MAX_PACKET)
+{
+#ifdef WITH_OPUS
+    d_encoder = nullptr;
+    if (d_opus)
+    {
+        int err;
+        d_encoder = opus_encoder_create(rate, channels, OPUS_APPLICATION_AUDIO, &err);
+        if (err != OPUS_OK)
+        {
+            std::cerr << "RTP streaming: Opus does not support " << rate
+                      << " Hz, sending L16" << std::endl;
+            d_encoder = nullptr;
+            d_opus = false;
+        }
+        else
+        {
+            opus_encoder_ctl(d_encoder, OPUS_SET_BITRATE(RTP_OPUS_BITRATE * channels));
+        }
+    }
+#else
+    if (d_opus)
+        std::cerr << "RTP streaming: built without Opus, sending L16" << std::endl;
+    d_opus = false;
+#endif
+
+    if (d_opus)
+    {
+        // The RTP clock of Opus is 48 kHz whatever the rate of the audio
+        d_frame = rate * RTP_OPUS_FRAME_MS / 1000;
+        d_ts_step = 48000 * RTP_OPUS_FRAME_MS / 1000;
+    }
+    else
+    {
+        d_frame = RTP_L16_PAYLOAD / (2 * channels);
+        d_ts_step = d_frame;
+    }
+    d_buf.resize(d_frame * channels);
+}
+
+rtp_sink_f::~rtp_sink_f()
+{
+#ifdef WITH_OPUS
+    if (d_encoder)
+        opus_encoder_destroy(d_encoder);
+#endif
+}
+
+int rtp_sink_f::work(int noutput_items,
+                     gr_vector_const_void_star &input_items,
+                     gr_vector_void_star &output_items)
+{
+    (void) output_items;
+
+    for (int i = 0; i < noutput_items; i++)
+    {
+        float *frame = &d_buf[d_fill * d_channels];
+        for (int c = 0; c < d_channels; c++)
+            frame[c] = ((const float *) input_items[c])[i];
+        if (++d_fill == d_frame)
+        {
+            send_frame();
+            d_fill = 0;
+        }
+    }
+
+    return noutput_items;
+}
+
+void rtp_sink_f::send_frame()
+{
+    uint8_t *p = d_packet.data();
+
+    p[0] = 0x80;    // version 2
+    p[1] = (d_first ? 0x80 : 0x00) | (d_opus ? RTP_PT_OPUS : RTP_PT_L16);
+    p[2] = d_seq >> 8;
+    p[3] = d_seq & 0xff;
+    p[4] = d_timestamp >> 24;
+    p[5] = (d_timestamp >> 16) & 0xff;
+    p[6] = (d_timestamp >> 8) & 0xff;
+    p[7] = d_timestamp & 0xff;
+    p[8] = d_ssrc >> 24;
+    p[9] = (d_ssrc >> 16) & 0xff;
+    p[10] = (d_ssrc >> 8) & 0xff;
+    p[11] = d_ssrc & 0xff;
+
+    int length = 0;
+#ifdef WITH_OPUS
+    if (d_opus)
+    {
+        length = opus_encode_float(d_encoder, d_buf.data(), d_frame, p + RTP_HEADER_SIZE,
+                                   RTP_SENDER_MAX_PACKET - RTP_HEADER_SIZE);
+        if (length < 0)
+            length = 0;
+    }
+    else
+#endif
+    {
+        uint8_t *out = p + RTP_HEADER_SIZE;
+        for (float x : d_buf)
+        {
+            const int16_t s = (int16_t) std::lrint(std::max(-1.0f, std::min(1.0f, x)) * 32767.0f);
+            *out++ = (uint16_t) s >> 8;
+            *out++ = s & 0xff;
+        }
+        length = 2 * (int) d_buf.size();
+    }
+
+    if (length > 0)
+    {
+        d_sender->send(p, RTP_HEADER_SIZE + length);
+        d_first = false;
+    }
+    d_seq++;
+    d_timestamp += d_ts_step;
+}
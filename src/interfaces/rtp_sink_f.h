@@ -0,0 +1,106 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RTP_SINK_F_H
+#define RTP_SINK_F_H
+
+#include <cstdint>
+#include <vector>
+#include <gnuradio/sync_block.h>
+
+#include "interfaces/rtp_sender.h"
+
+#ifdef WITH_OPUS
+#include <opus.h>
+#endif
+
+/* Largest L16 payload, keeps the packets below the usual 1500 byte MTU */
+#define RTP_L16_PAYLOAD 1400
+
+/* Dynamic RTP payload types of the L16 and Opus streams */
+#define RTP_PT_L16  96
+#define RTP_PT_OPUS 97
+
+/* Duration of an Opus frame, which is one packet */
+#define RTP_OPUS_FRAME_MS 20
+
+/* Opus bit rate per audio channel */
+#define RTP_OPUS_BITRATE 32000
+
+class rtp_sink_f;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<rtp_sink_f> rtp_sink_f_sptr;
+#else
+typedef std::shared_ptr<rtp_sink_f> rtp_sink_f_sptr;
+#endif
+
+rtp_sink_f_sptr make_rtp_sink_f(rtp_sender_sptr sender, uint32_t channel,
+                                int channels, int rate, bool opus);
+
+/*! \brief Audio sink sending RTP packets.
+ *  \ingroup IO
+ *
+ * The audio of one or two channels is packed into RTP packets, either as
+ * 16 bit big endian PCM (L16) or, when built with Opus, as an Opus frame of
+ * RTP_OPUS_FRAME_MS. The SSRC of the packets is the channel number given
+ * to the sink, so a receiver can tell the streams sharing a destination
+ * apart, and the sequence number and timestamp reveal lost packets.
+ * The packets go through a shared rtp_sender, which batches them.
+ */
+class rtp_sink_f : public gr::sync_block
+{
+    friend rtp_sink_f_sptr make_rtp_sink_f(rtp_sender_sptr sender, uint32_t channel,
+                                           int channels, int rate, bool opus);
+
+public:
+    ~rtp_sink_f();
+
+    int work(int noutput_items,
+             gr_vector_const_void_star &input_items,
+             gr_vector_void_star &output_items);
+
+    bool is_opus() const { return d_opus; }
+
+private:
+    rtp_sink_f(rtp_sender_sptr sender, uint32_t channel, int channels, int rate, bool opus);
+
+    void send_frame();
+
+    rtp_sender_sptr     d_sender;
+    uint32_t            d_ssrc;
+    int                 d_channels;
+    bool                d_opus;
+    int                 d_frame;        /*!< Samples per channel in a packet. */
+    uint32_t            d_ts_step;      /*!< Timestamp increment per packet. */
+    uint16_t            d_seq;
+    uint32_t            d_timestamp;
+    bool                d_first;
+    std::vector<float>  d_buf;          /*!< Interleaved samples of the next packet. */
+    int                 d_fill;
+    std::vector<uint8_t> d_packet;
+#ifdef WITH_OPUS
+    OpusEncoder        *d_encoder;
+#endif
+};
+
+#endif // RTP_SINK_F_H
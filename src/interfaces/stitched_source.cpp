@@ -0,0 +1,182 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <gnuradio/io_signature.h>
+#if GNURADIO_VERSION < 0x030900
+#include <gnuradio/filter/rational_resampler_base.h>
+#else
+#include <gnuradio/filter/rational_resampler.h>
+#endif
+
+#include "dsp/filter_taps_cache.h"
+#include "interfaces/stitched_source.h"
+
+/* Output items of the interpolators, to add them in long runs */
+#define STITCH_OUTPUT_MULTIPLE 4096
+
+bool stitched_source::is_stitched(const std::string &device)
+{
+    return device.compare(0, sizeof(STITCH_DEVICE) - 1, STITCH_DEVICE) == 0;
+}
+
+stitched_source_sptr make_stitched_source(const std::string &device)
+{
+    return gnuradio::get_initial_sptr(new stitched_source(device));
+}
+
+stitched_source::stitched_source(const std::string &device)
+    : gr::hier_block2 ("stitched_source",
+                      gr::io_signature::make (0, 0, 0),
+                      gr::io_signature::make (1, 1, sizeof (gr_complex))),
+      d_rate(2.4e6),
+      d_step(0.0),
+      d_interp(1),
+      d_freq(0.0)
+{
+    // The options, then the devices with our own ppm= taken out
+    std::vector<std::string> devices;
+    std::istringstream parts(device.substr(sizeof(STITCH_DEVICE) - 1));
+    std::string part;
+    bool options = true;
+    while (std::getline(parts, part, ';'))
+    {
+        std::istringstream fields(part);
+        std::string field;
+        std::string args;
+        double ppm = 0.0;
+        while (std::getline(fields, field, ','))
+        {
+            const std::string key = field.substr(0, field.find('='));
+            const std::string value = field.find('=') == std::string::npos
+                ? "" : field.substr(field.find('=') + 1);
+            if (options && key == "rate")
+                d_rate = std::atof(value.c_str());
+            else if (options && key == "step")
+                d_step = std::atof(value.c_str());
+            else if (!options && key == "ppm")
+                ppm = std::atof(value.c_str());
+            else if (!options && !field.empty())
+                args += (args.empty() ? "" : ",") + field;
+        }
+        if (!options && !args.empty())
+        {
+            devices.push_back(args);
+            d_ppm.push_back(ppm);
+        }
+        options = false;
+    }
+    if (devices.empty() || d_rate <= 0.0)
+        throw std::runtime_error("stitch: no devices or no rate");
+    if (d_step <= 0.0 || d_step > d_rate)
+        d_step = STITCH_DEFAULT_STEP * d_rate;
+
+    // Complementary transitions at the seams, inside what the devices overlap
+    const double transition = std::max(0.5 * (d_rate - d_step), 0.01 * d_rate);
+    const double span = d_step * devices.size();
+    d_interp = (unsigned int)std::ceil((span + transition) / d_rate);
+    const double out_rate = get_sample_rate();
+    std::vector<float> taps = filter_taps_cache::low_pass(d_interp, d_interp,
+                                                          0.5 * d_step / d_rate,
+                                                          transition / d_rate);
+
+    d_add = gr::blocks::add_cc::make();
+    for (size_t k = 0; k < devices.size(); k++)
+    {
+        osmosdr::source::sptr src = osmosdr::source::make(devices[k]);
+        src->set_sample_rate(d_rate);
+        src->set_freq_corr(d_ppm[k]);
+
+        const double offset = ((double)k - 0.5 * (devices.size() - 1)) * d_step;
+#if GNURADIO_VERSION < 0x030900
+        auto filter = gr::filter::rational_resampler_base_ccf::make(d_interp, 1, taps);
+#else
+        auto filter = gr::filter::rational_resampler_ccf::make(d_interp, 1, taps);
+#endif
+        filter->set_output_multiple(STITCH_OUTPUT_MULTIPLE);
+        auto shift = gr::blocks::rotator_cc::make(2.0 * M_PI * offset / out_rate);
+
+        connect(src, 0, filter, 0);
+        connect(filter, 0, shift, 0);
+        connect(shift, 0, d_add, k);
+
+        d_sources.push_back(src);
+        d_filters.push_back(filter);
+        d_shifts.push_back(shift);
+    }
+    connect(d_add, 0, self(), 0);
+}
+
+stitched_source::~stitched_source()
+{
+}
+
+/* Tune the devices side by side around freq */
+double stitched_source::set_center_freq(double freq)
+{
+    d_freq = freq;
+    for (size_t k = 0; k < d_sources.size(); k++)
+        d_sources[k]->set_center_freq(freq + ((double)k - 0.5 * (d_sources.size() - 1)) * d_step);
+
+    return d_freq;
+}
+
+void stitched_source::set_freq_corr(double ppm)
+{
+    for (size_t k = 0; k < d_sources.size(); k++)
+        d_sources[k]->set_freq_corr(ppm + d_ppm[k]);
+}
+
+void stitched_source::set_gain(double gain, const std::string &name)
+{
+    for (auto &src : d_sources)
+        src->set_gain(gain, name);
+}
+
+void stitched_source::set_gain_mode(bool automatic)
+{
+    for (auto &src : d_sources)
+        src->set_gain_mode(automatic);
+}
+
+void stitched_source::set_antenna(const std::string &antenna)
+{
+    for (auto &src : d_sources)
+        src->set_antenna(antenna);
+}
+
+/* The analog bandwidth of each device, at most its rate */
+void stitched_source::set_bandwidth(double bandwidth)
+{
+    for (auto &src : d_sources)
+        src->set_bandwidth(std::min(bandwidth, d_rate));
+}
+
+void stitched_source::set_iq_balance_mode(int mode)
+{
+    for (auto &src : d_sources)
+        src->set_iq_balance_mode(mode);
+}
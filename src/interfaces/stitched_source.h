@@ -0,0 +1,115 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef STITCHED_SOURCE_H
+#define STITCHED_SOURCE_H
+
+#include <string>
+#include <vector>
+#include <gnuradio/blocks/add_blk.h>
+#include <gnuradio/blocks/rotator_cc.h>
+#include <gnuradio/hier_block2.h>
+#include <osmosdr/source.h>
+
+/* Prefix of the input device strings that stitch several devices */
+#define STITCH_DEVICE "stitch="
+
+/* Span of each device as a part of its rate, without step= */
+#define STITCH_DEFAULT_STEP 0.8
+
+class stitched_source;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<stitched_source> stitched_source_sptr;
+#else
+typedef std::shared_ptr<stitched_source> stitched_source_sptr;
+#endif
+
+/*! \brief Return a shared_ptr to a new instance of stitched_source.
+ *  \param device The device string, throws std::runtime_error if a device
+ *                can not be opened.
+ */
+stitched_source_sptr make_stitched_source(const std::string &device);
+
+/*! \brief Adjacent spans of several devices as one wideband input.
+ *  \ingroup IO
+ *
+ * "stitch=rate=2.4e6,step=2e6;rtl=0;rtl=1,ppm=-12;rtl=2" opens the devices
+ * after the first ';' at rate each and tunes them step apart around the
+ * center frequency. Each stream is interpolated to the combined rate, the
+ * lowest multiple of rate that holds the span, low pass filtered to its
+ * step, shifted to its place and added to the others, so the FFT, the
+ * plotter and the VFOs see one input that is as wide as the devices
+ * together. The filters are complementary at the seams, half of rate minus
+ * step is what the devices overlap.
+ *
+ * The streams are combined sample by sample, so the devices must keep to
+ * their rate: ppm= corrects a device, on top of the correction of the
+ * receiver, and with an RTL-SDR the correction fixes the rate as well as
+ * the frequency. The relative delay of the devices is what it is when
+ * they start, which smears a signal only where it crosses a seam.
+ *
+ * The first device answers for the gain names and ranges, every setting
+ * goes to all of them.
+ */
+class stitched_source : public gr::hier_block2
+{
+    friend stitched_source_sptr make_stitched_source(const std::string &device);
+
+protected:
+    stitched_source(const std::string &device);
+
+public:
+    ~stitched_source();
+
+    /*! \brief Whether a device string is for a stitched_source. */
+    static bool is_stitched(const std::string &device);
+
+    osmosdr::source::sptr reference() const { return d_sources.front(); }
+    size_t      size() const { return d_sources.size(); }
+
+    /*! \brief The combined rate, of the output. */
+    double      get_sample_rate() const { return d_rate * d_interp; }
+    double      get_span() const { return d_step * d_sources.size(); }
+
+    double      set_center_freq(double freq);
+    double      get_center_freq() const { return d_freq; }
+    void        set_freq_corr(double ppm);
+    void        set_gain(double gain, const std::string &name);
+    void        set_gain_mode(bool automatic);
+    void        set_antenna(const std::string &antenna);
+    void        set_bandwidth(double bandwidth);
+    void        set_iq_balance_mode(int mode);
+
+private:
+    double      d_rate;         /*!< Of each device. */
+    double      d_step;         /*!< Between the devices. */
+    unsigned int d_interp;
+    double      d_freq;
+    std::vector<double>                 d_ppm;      /*!< Correction of each device. */
+    std::vector<osmosdr::source::sptr>  d_sources;
+    std::vector<gr::basic_block_sptr>   d_filters;  /*!< Interpolators. */
+    std::vector<gr::blocks::rotator_cc::sptr> d_shifts;
+    gr::blocks::add_cc::sptr            d_add;
+};
+
+#endif // STITCHED_SOURCE_H
@@ -41,9 +41,9 @@
  * upcasted shared_ptr. This is effectively the public
  * constructor.
  */
-udp_sink_f_sptr make_udp_sink_f()
+udp_sink_f_sptr make_udp_sink_f(int audio_rate)
 {
-    return gnuradio::get_initial_sptr(new udp_sink_f());
+    return gnuradio::get_initial_sptr(new udp_sink_f(audio_rate));
 }
 
 static const int MIN_IN = 2;  /*!< Minimum number of input streams. */
@@ -57,10 +57,11 @@ static const int MAX_OUT = 0; /*!< Maximum number of output streams. */
 // lost.
 static const int PAYLOAD_SIZE = 1024;
 
-udp_sink_f::udp_sink_f()
+udp_sink_f::udp_sink_f(int audio_rate)
     : gr::hier_block2("udp_sink_f",
                       gr::io_signature::make(MIN_IN, MAX_IN, sizeof(float)),
-                      gr::io_signature::make(MIN_OUT, MAX_OUT, sizeof(float)))
+                      gr::io_signature::make(MIN_OUT, MAX_OUT, sizeof(float))),
+      d_audio_rate(audio_rate)
 {
 
     d_f2s = gr::blocks::float_to_short::make(1, 32767);
@@ -85,15 +86,51 @@ udp_sink_f::~udp_sink_f()
  *  \param host The hostname or IP address of the client.
  *  \param port The port used for the UDP stream
  *  \param stereo Select mono or stereo streaming
+ *  \param format Bare samples or RTP packets
+ *  \param channel SSRC of the RTP packets
+ *
+ * The RTP streams to the same host and port share one socket and send
+ * their packets in batches, see rtp_sender.
  */
-void udp_sink_f::start_streaming(const std::string host, int port, bool stereo)
+void udp_sink_f::start_streaming(const std::string host, int port, bool stereo,
+                                 udp_stream_format format, uint32_t channel)
 {
+    rtp_sender_sptr sender;
+    if (format != UDP_STREAM_RAW)
+    {
+        sender = rtp_sender::get(host, port);
+        if (!sender)
+            format = UDP_STREAM_RAW;
+    }
+
     lock();
     disconnect_all();
 
     std::cout << "Starting UDP streaming, Host: " << host;
     std::cout << ", Port: " << std::to_string(port) << ", ";
-    std::cout << (stereo ? "Stereo" : "Mono") << std::endl;
+    std::cout << (stereo ? "Stereo" : "Mono");
+    if (format != UDP_STREAM_RAW)
+        std::cout << ", RTP channel " << channel;
+    std::cout << std::endl;
+
+    if (format != UDP_STREAM_RAW)
+    {
+        d_rtp = make_rtp_sink_f(sender, channel, stereo ? 2 : 1, d_audio_rate,
+                                format == UDP_STREAM_OPUS);
+        connect(self(), 0, d_rtp, 0);
+        if (stereo)
+            connect(self(), 1, d_rtp, 1);
+        else
+            connect(self(), 1, d_null1, 0);
+        unlock();
+#if GNURADIO_VERSION < 0x031000
+        d_sink->disconnect();
+#else
+        d_sink = nullptr;
+#endif
+        return;
+    }
+    d_rtp = nullptr;
 
 #if GNURADIO_VERSION >= 0x031000
     d_sink = gr::network::udp_sink::make(sizeof(short), 1, host, port, HEADERTYPE_NONE, PAYLOAD_SIZE, true);
@@ -130,6 +167,8 @@ void udp_sink_f::stop_streaming(void)
 
     std::cout << "Disconnected UDP streaming" << std::endl;
 
+    d_rtp = nullptr;
+
 #if GNURADIO_VERSION < 0x031000
     d_sink->disconnect();
 #else
@@ -34,6 +34,14 @@
 #include <gnuradio/blocks/interleave.h>
 #include <gnuradio/blocks/null_sink.h>
 
+#include "interfaces/rtp_sink_f.h"
+
+/*! \brief Formats of the UDP audio stream. */
+enum udp_stream_format {
+    UDP_STREAM_RAW  = 0,    /*!< Bare 16 bit PCM in host order, as read by nc. */
+    UDP_STREAM_RTP  = 1,    /*!< RTP packets with L16 payload. */
+    UDP_STREAM_OPUS = 2     /*!< RTP packets with Opus payload. */
+};
 
 class udp_sink_f;
 
@@ -43,15 +51,16 @@ typedef boost::shared_ptr<udp_sink_f> udp_sink_f_sptr;
 typedef std::shared_ptr<udp_sink_f> udp_sink_f_sptr;
 #endif
 
-udp_sink_f_sptr make_udp_sink_f(void);
+udp_sink_f_sptr make_udp_sink_f(int audio_rate = 48000);
 
 class udp_sink_f : public gr::hier_block2
 {
 public:
-    udp_sink_f(void);
+    udp_sink_f(int audio_rate);
     ~udp_sink_f();
 
-    void start_streaming(const std::string host, int port, bool stereo);
+    void start_streaming(const std::string host, int port, bool stereo,
+                         udp_stream_format format = UDP_STREAM_RAW, uint32_t channel = 0);
     void stop_streaming(void);
 
 private:
@@ -64,6 +73,8 @@ private:
     gr::blocks::interleave::sptr      d_inter;  /*!< Stereo interleaver. */
     gr::blocks::null_sink::sptr       d_null0;  /*!< Null sink for mono. */
     gr::blocks::null_sink::sptr       d_null1;  /*!< Null sink for mono. */
+    rtp_sink_f_sptr                   d_rtp;    /*!< RTP sink, when not streaming raw. */
+    int                               d_audio_rate;
 
 };
 
@@ -20,10 +20,10 @@
  * the Free Software Foundation, Inc., 51 Franklin Street,
  * Boston, MA 02110-1301, USA.
  */
+#include <algorithm>
+#include <cstring>
 #include <gnuradio/io_signature.h>
-#include <pulse/simple.h>
 #include <pulse/error.h>
-#include <pulse/gccmacro.h>
 #include <stdio.h>
 
 #include "pa_sink.h"
@@ -34,53 +34,95 @@
  *  \param audio_rate The sample rate of the audio stream.
  *  \param app_name Application name.
  *  \param stream_name The audio stream name.
+ *  \param latency_ms Target latency of the output.
  *
  * This is effectively the public constructor for pa_sink.
  */
 pa_sink_sptr make_pa_sink(const string device_name, int audio_rate,
-                          const string app_name, const string stream_name)
+                          const string app_name, const string stream_name,
+                          int latency_ms)
 {
-    return gnuradio::get_initial_sptr(new pa_sink(device_name, audio_rate, app_name, stream_name));
+    return gnuradio::get_initial_sptr(new pa_sink(device_name, audio_rate, app_name,
+                                                  stream_name, latency_ms));
 }
 
 
 pa_sink::pa_sink(const string device_name, int audio_rate,
-                 const string app_name, const string stream_name)
+                 const string app_name, const string stream_name,
+                 int latency_ms)
   : gr::sync_block ("pa_sink",
         gr::io_signature::make (1, 2, sizeof(float)),
         gr::io_signature::make (0, 0, 0)),
+    d_mainloop(NULL),
+    d_context(NULL),
+    d_stream(NULL),
     d_stream_name(stream_name),
-    d_app_name(app_name)
+    d_app_name(app_name),
+    d_head(0),
+    d_tail(0),
+    d_starved(false),
+    d_latency_ms(std::min(std::max(latency_ms, PA_SINK_MIN_LATENCY_MS), PA_SINK_MAX_LATENCY_MS)),
+    d_min_fill(UINT64_MAX),
+    d_window(0),
+    d_latency_us(0),
+    d_underruns(0),
+    d_dropped(0)
 {
-    int error;
-
     /* The sample type to use */
     d_ss.format = PA_SAMPLE_FLOAT32LE;
     d_ss.rate = audio_rate;
     d_ss.channels = 2;
-    d_pasink = pa_simple_new(NULL,
-                             d_app_name.c_str(),
-                             PA_STREAM_PLAYBACK,
-                             device_name.empty() ? NULL : device_name.c_str(),
-                             d_stream_name.c_str(),
-                             &d_ss,
-                             NULL,
-                             NULL,
-                             &error);
-
-    if (!d_pasink) {
-        /** FIXME: Throw an exception **/
-        fprintf(stderr, __FILE__": pa_simple_new() failed: %s\n", pa_strerror(error));
+
+    uint64_t frames = 1;
+    while (frames < (uint64_t)audio_rate * PA_SINK_RING_MS / 1000)
+        frames <<= 1;
+    d_ring.resize(2 * frames);
+    d_ring_mask = frames - 1;
+
+    d_mainloop = pa_threaded_mainloop_new();
+    d_context = pa_context_new(pa_threaded_mainloop_get_api(d_mainloop), d_app_name.c_str());
+    pa_context_set_state_callback(d_context, context_state_cb, this);
+
+    pa_threaded_mainloop_lock(d_mainloop);
+    bool ready = false;
+    if (pa_context_connect(d_context, NULL, PA_CONTEXT_NOFLAGS, NULL) >= 0 &&
+        pa_threaded_mainloop_start(d_mainloop) >= 0)
+    {
+        for (;;)
+        {
+            pa_context_state_t state = pa_context_get_state(d_context);
+            if (state == PA_CONTEXT_READY)
+            {
+                ready = true;
+                break;
+            }
+            if (!PA_CONTEXT_IS_GOOD(state))
+                break;
+            pa_threaded_mainloop_wait(d_mainloop);
+        }
     }
 
+    if (!ready) {
+        /** FIXME: Throw an exception **/
+        fprintf(stderr, __FILE__": pa_context_connect() failed: %s\n",
+                pa_strerror(pa_context_errno(d_context)));
+    }
+    else
+        connect_stream(device_name);
+    pa_threaded_mainloop_unlock(d_mainloop);
 }
 
 
 pa_sink::~pa_sink()
 {
-    if (d_pasink) {
-        pa_simple_free(d_pasink);
-    }
+    pa_threaded_mainloop_lock(d_mainloop);
+    disconnect_stream();
+    pa_context_disconnect(d_context);
+    pa_threaded_mainloop_unlock(d_mainloop);
+
+    pa_threaded_mainloop_stop(d_mainloop);
+    pa_context_unref(d_context);
+    pa_threaded_mainloop_free(d_mainloop);
 }
 
 bool pa_sink::start()
@@ -99,67 +141,227 @@ bool pa_sink::stop()
  */
 void pa_sink::select_device(string device_name)
 {
-    int error;
+    pa_threaded_mainloop_lock(d_mainloop);
+    disconnect_stream();
+    if (pa_context_get_state(d_context) == PA_CONTEXT_READY)
+        connect_stream(device_name);
+    pa_threaded_mainloop_unlock(d_mainloop);
+}
+
+/*! \brief Set the latency of the output.
+ *  \param latency_ms The latency in ms, limited to PA_SINK_MIN_LATENCY_MS
+ *                    to PA_SINK_MAX_LATENCY_MS.
+ */
+void pa_sink::set_target_latency(int latency_ms)
+{
+    d_latency_ms = std::min(std::max(latency_ms, PA_SINK_MIN_LATENCY_MS), PA_SINK_MAX_LATENCY_MS);
+
+    pa_threaded_mainloop_lock(d_mainloop);
+    if (d_stream)
+    {
+        pa_buffer_attr attr = buffer_attr();
+        pa_operation *op = pa_stream_set_buffer_attr(d_stream, &attr, NULL, NULL);
+        if (op)
+            pa_operation_unref(op);
+    }
+    pa_threaded_mainloop_unlock(d_mainloop);
+}
 
-    pa_simple_free(d_pasink);
+/*! \brief Get the statistics of the output.
+ *  \param latency_ms Latency of the samples from work() to the speaker.
+ *  \param underruns Number of times the server buffer ran empty.
+ *  \param dropped Frames dropped because the input ran faster than the output.
+ */
+void pa_sink::get_stats(float &latency_ms, uint64_t &underruns, uint64_t &dropped) const
+{
+    latency_ms = d_latency_us.load(std::memory_order_relaxed) / 1000.0f;
+    underruns = d_underruns.load(std::memory_order_relaxed);
+    dropped = d_dropped.load(std::memory_order_relaxed);
+}
 
-    d_pasink = pa_simple_new(NULL,
-                             d_app_name.c_str(),
-                             PA_STREAM_PLAYBACK,
-                             device_name.empty() ? NULL : device_name.c_str(),
-                             d_stream_name.c_str(),
-                             &d_ss,
-                             NULL,
-                             NULL,
-                             &error);
+/*! \brief Connect a playback stream, with the main loop locked. */
+bool pa_sink::connect_stream(const string &device_name)
+{
+    d_stream = pa_stream_new(d_context, d_stream_name.c_str(), &d_ss, NULL);
+    if (!d_stream)
+    {
+        fprintf(stderr, __FILE__": pa_stream_new() failed: %s\n",
+                pa_strerror(pa_context_errno(d_context)));
+        return false;
+    }
+    pa_stream_set_state_callback(d_stream, stream_state_cb, this);
+    pa_stream_set_write_callback(d_stream, stream_write_cb, this);
+    pa_stream_set_underflow_callback(d_stream, stream_underflow_cb, this);
 
-    if (!d_pasink) {
-        /** FIXME: Throw an exception **/
-        fprintf(stderr, __FILE__": pa_simple_new() failed: %s\n", pa_strerror(error));
+    pa_buffer_attr attr = buffer_attr();
+    pa_stream_flags_t flags = (pa_stream_flags_t)(PA_STREAM_ADJUST_LATENCY |
+                                                  PA_STREAM_INTERPOLATE_TIMING |
+                                                  PA_STREAM_AUTO_TIMING_UPDATE);
+    if (pa_stream_connect_playback(d_stream, device_name.empty() ? NULL : device_name.c_str(),
+                                   &attr, flags, NULL, NULL) >= 0)
+    {
+        for (;;)
+        {
+            pa_stream_state_t state = pa_stream_get_state(d_stream);
+            if (state == PA_STREAM_READY)
+                return true;
+            if (!PA_STREAM_IS_GOOD(state))
+                break;
+            pa_threaded_mainloop_wait(d_mainloop);
+        }
     }
+
+    /** FIXME: Throw an exception **/
+    fprintf(stderr, __FILE__": pa_stream_connect_playback() failed: %s\n",
+            pa_strerror(pa_context_errno(d_context)));
+    disconnect_stream();
+    return false;
+}
+
+/*! \brief Disconnect the playback stream, with the main loop locked. */
+void pa_sink::disconnect_stream()
+{
+    if (!d_stream)
+        return;
+
+    pa_stream_set_state_callback(d_stream, NULL, NULL);
+    pa_stream_set_write_callback(d_stream, NULL, NULL);
+    pa_stream_set_underflow_callback(d_stream, NULL, NULL);
+    pa_stream_disconnect(d_stream);
+    pa_stream_unref(d_stream);
+    d_stream = NULL;
+}
+
+/*! \brief Server buffer for the target latency, the server picks the rest. */
+pa_buffer_attr pa_sink::buffer_attr() const
+{
+    pa_buffer_attr attr;
+
+    attr.maxlength = (uint32_t) -1;
+    attr.tlength = (uint32_t) pa_usec_to_bytes((pa_usec_t)d_latency_ms * 1000, &d_ss);
+    attr.prebuf = (uint32_t) -1;
+    attr.minreq = (uint32_t) -1;
+    attr.fragsize = (uint32_t) -1;
+
+    return attr;
+}
+
+void pa_sink::context_state_cb(pa_context *c, void *userdata)
+{
+    (void) c;
+    pa_threaded_mainloop_signal(((pa_sink *) userdata)->d_mainloop, 0);
 }
 
+void pa_sink::stream_state_cb(pa_stream *s, void *userdata)
+{
+    (void) s;
+    pa_threaded_mainloop_signal(((pa_sink *) userdata)->d_mainloop, 0);
+}
+
+void pa_sink::stream_write_cb(pa_stream *s, size_t nbytes, void *userdata)
+{
+    (void) s;
+    ((pa_sink *) userdata)->write(nbytes);
+}
+
+void pa_sink::stream_underflow_cb(pa_stream *s, void *userdata)
+{
+    (void) s;
+    ((pa_sink *) userdata)->d_underruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*! \brief Move up to nbytes from the ring to the stream.
+ *
+ * Called in the main loop thread, or by work() with the main loop locked
+ * when the last request was not met.
+ */
+void pa_sink::write(size_t nbytes)
+{
+    const size_t frame_size = 2 * sizeof(float);
+    const uint64_t target = (uint64_t)d_latency_ms * d_ss.rate / 1000;
+    uint64_t tail = d_tail.load(std::memory_order_relaxed);
+    uint64_t fill = d_head.load(std::memory_order_acquire) - tail;
+
+    // The least fill in a second is what the input runs ahead by
+    d_min_fill = std::min(d_min_fill, fill);
+    if (d_window >= d_ss.rate)
+    {
+        if (d_min_fill > target)
+        {
+            uint64_t drop = d_min_fill - target / 2;
+            tail += drop;
+            fill -= drop;
+            d_dropped.fetch_add(drop, std::memory_order_relaxed);
+        }
+        d_min_fill = fill;
+        d_window = 0;
+    }
+
+    uint64_t frames = std::min<uint64_t>(nbytes / frame_size, fill);
+    d_starved = frames < nbytes / frame_size;
+    while (frames > 0)
+    {
+        void *buf;
+        size_t bytes = frames * frame_size;
+        if (pa_stream_begin_write(d_stream, &buf, &bytes) < 0 || bytes < frame_size)
+            break;
+
+        uint64_t n = std::min<uint64_t>(frames, bytes / frame_size);
+        uint64_t first = std::min(n, d_ring_mask + 1 - (tail & d_ring_mask));
+        memcpy(buf, &d_ring[2 * (tail & d_ring_mask)], first * frame_size);
+        memcpy((char *) buf + first * frame_size, &d_ring[0], (n - first) * frame_size);
+        pa_stream_write(d_stream, buf, n * frame_size, NULL, 0, PA_SEEK_RELATIVE);
+
+        tail += n;
+        fill -= n;
+        frames -= n;
+        d_window += n;
+    }
+    d_tail.store(tail, std::memory_order_release);
+
+    pa_usec_t usec;
+    int negative = 0;
+    if (pa_stream_get_latency(d_stream, &usec, &negative) == 0)
+        d_latency_us.store((negative ? 0 : (int64_t) usec) + (int64_t)(fill * 1000000 / d_ss.rate),
+                           std::memory_order_relaxed);
+}
 
-#define BUFFER_SIZE 100000
 
 int pa_sink::work (int noutput_items,
                    gr_vector_const_void_star &input_items,
                    gr_vector_void_star &output_items)
 {
-    static float audio_buffer[BUFFER_SIZE];
-    float *ptr = &audio_buffer[0];
-    int i, error;
-
     (void) output_items;
 
-    if (noutput_items > BUFFER_SIZE/2)
-        noutput_items = BUFFER_SIZE/2;
+    uint64_t head = d_head.load(std::memory_order_relaxed);
+    uint64_t space = d_ring_mask + 1 - (head - d_tail.load(std::memory_order_acquire));
+    int n = (int) std::min<uint64_t>(noutput_items, space);
+
+    if (n < noutput_items)
+        d_dropped.fetch_add(noutput_items - n, std::memory_order_relaxed);
 
-    if (input_items.size() == 2)
+    // one channel (mono) has the same data in left and right channel
+    const float *data_l = (const float*) input_items[0];
+    const float *data_r = (const float*) input_items[input_items.size() == 2 ? 1 : 0];
+    for (int i = 0; i < n; i++)
     {
-        // two channels (stereo)
-        const float *data_l = (const float*) input_items[0]; // left channel
-        const float *data_r = (const float*) input_items[1]; // right channel
-        for (i = noutput_items; i > 0; i--)
-        {
-            *ptr++ = *data_l++;
-            *ptr++ = *data_r++;
-        }
+        float *frame = &d_ring[2 * ((head + i) & d_ring_mask)];
+        frame[0] = data_l[i];
+        frame[1] = data_r[i];
     }
-    else
+    d_head.store(head + n, std::memory_order_release);
+
+    // The server is not asking again for what it did not get
+    if (d_starved.exchange(false))
     {
-        // assume 1 channel (mono)
-        const float *data = (const float*) input_items[0];
-        for (i = noutput_items; i > 0; i--)
+        pa_threaded_mainloop_lock(d_mainloop);
+        if (d_stream)
         {
-            float a = *data++;
-            *ptr++ = a; // same data in left and right channel
-            *ptr++ = a;
+            size_t writable = pa_stream_writable_size(d_stream);
+            if (writable != (size_t) -1 && writable > 0)
+                write(writable);
         }
-    }
-
-    if (pa_simple_write(d_pasink, audio_buffer, 2*noutput_items*sizeof(float), &error) < 0) { //!!!
-        fprintf(stderr, __FILE__": pa_simple_write() failed: %s\n", pa_strerror(error));
+        pa_threaded_mainloop_unlock(d_mainloop);
     }
 
     return noutput_items;
@@ -23,12 +23,24 @@
 #ifndef PA_SINK_H
 #define PA_SINK_H
 
+#include <atomic>
 #include <gnuradio/sync_block.h>
-#include <pulse/simple.h>
+#include <pulse/pulseaudio.h>
 #include <string>
+#include <vector>
 
 using namespace std;
 
+/* Default latency of the output, ring and server buffer together, in ms */
+#define PA_SINK_LATENCY_MS 40
+
+/* Range of the latency that can be set, in ms */
+#define PA_SINK_MIN_LATENCY_MS 5
+#define PA_SINK_MAX_LATENCY_MS 500
+
+/* Size of the ring between work() and the stream, in ms */
+#define PA_SINK_RING_MS 1000
+
 class pa_sink;
 
 #if GNURADIO_VERSION < 0x030900
@@ -39,23 +51,38 @@ typedef std::shared_ptr<pa_sink> pa_sink_sptr;
 
 pa_sink_sptr make_pa_sink(const string device_name, int audio_rate,
                           const string app_name,
-                          const string stream_name);
+                          const string stream_name,
+                          int latency_ms = PA_SINK_LATENCY_MS);
 
 
 /*! \brief Pulseaudio sink
  *  \ingroup IO
  *
- * This block implements a two-channel pulseaudio sink using the Pulseaudio simple API.
+ * This block implements a two-channel pulseaudio sink using the
+ * asynchronous API with a threaded main loop.
  *
+ * work() puts the samples into a single producer, single consumer ring and
+ * never waits for the server. The write callback of the stream takes them
+ * from the ring in the main loop thread, so the flow graph is paced by the
+ * input device and not by the buffering of the server. The server buffer
+ * is asked for the target latency with PA_STREAM_ADJUST_LATENCY.
+ *
+ * If the input runs faster than the audio clock, the samples build up in
+ * the ring. When the ring has held more than the target latency during a
+ * whole second, the oldest samples are dropped down to half of it. If it
+ * runs slower, the server buffer runs empty and the underrun is counted;
+ * playback resumes once the buffer is filled again.
  */
 class pa_sink : public gr::sync_block
 {
     friend pa_sink_sptr make_pa_sink(const string device_name, int audio_rate,
-                                     const string app_name, const string stream_name);
+                                     const string app_name, const string stream_name,
+                                     int latency_ms);
 
 public:
     pa_sink(const string device_name, int audio_rate,
-            const string app_name, const string stream_name);
+            const string app_name, const string stream_name,
+            int latency_ms);
     ~pa_sink();
 
     int work (int noutput_items,
@@ -67,11 +94,42 @@ public:
 
     void select_device(string device_name);
 
+    void set_target_latency(int latency_ms);
+    int  target_latency() const { return d_latency_ms; }
+
+    void get_stats(float &latency_ms, uint64_t &underruns, uint64_t &dropped) const;
+
 private:
-    pa_simple *d_pasink;    /*! The pulseaudio object. */
+    bool connect_stream(const string &device_name);
+    void disconnect_stream();
+    pa_buffer_attr buffer_attr() const;
+    void write(size_t nbytes);
+
+    static void context_state_cb(pa_context *c, void *userdata);
+    static void stream_state_cb(pa_stream *s, void *userdata);
+    static void stream_write_cb(pa_stream *s, size_t nbytes, void *userdata);
+    static void stream_underflow_cb(pa_stream *s, void *userdata);
+
+    pa_threaded_mainloop *d_mainloop;
+    pa_context *d_context;
+    pa_stream  *d_stream;   /*! Guarded by the main loop lock. */
     string d_stream_name;   /*! Descriptive name of the stream. */
     string d_app_name;      /*! Descriptive name of the application. */
     pa_sample_spec d_ss;    /*! pulseaudio sample specification. */
+
+    vector<float>         d_ring;       /*!< Interleaved stereo frames. */
+    uint64_t              d_ring_mask;  /*!< Frames in the ring minus one. */
+    std::atomic<uint64_t> d_head;       /*!< Next frame written by work(). */
+    std::atomic<uint64_t> d_tail;       /*!< Next frame taken by the stream. */
+    std::atomic<bool>     d_starved;    /*!< The last request could not be met. */
+    std::atomic<int>      d_latency_ms;
+
+    uint64_t d_min_fill;    /*!< Least ring fill in the current second. */
+    uint64_t d_window;      /*!< Frames taken in the current second. */
+
+    std::atomic<int64_t>  d_latency_us; /*!< Measured latency. */
+    std::atomic<uint64_t> d_underruns;
+    std::atomic<uint64_t> d_dropped;    /*!< Frames dropped for drift or a full ring. */
 };
 
 #endif /* PA_SINK_H */
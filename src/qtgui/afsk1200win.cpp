@@ -31,8 +31,7 @@
 
 Afsk1200Win::Afsk1200Win(QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::Afsk1200Win),
-    tmpbuf(CORRLEN, 0.0)
+    ui(new Ui::Afsk1200Win)
 {
     ui->setupUi(this);
 
@@ -44,32 +43,20 @@ Afsk1200Win::Afsk1200Win(QWidget *parent) :
     spacer->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
     ui->toolBar->addWidget(spacer);
     ui->toolBar->addAction(ui->actionInfo);
-
-    /* AFSK1200 decoder */
-    decoder = new CAfsk12(this);
-    connect(decoder, SIGNAL(newMessage(QString)), ui->textView, SLOT(appendPlainText(QString)));
 }
 
 Afsk1200Win::~Afsk1200Win()
 {
     qDebug() << "AFSK1200 decoder destroyed.";
 
-    delete decoder;
     delete ui;
 }
 
 
-/*! \brief Process new set of samples. */
-void Afsk1200Win::process_samples(float *buffer, int length)
+/*! \brief Show a message decoded by the receiver. */
+void Afsk1200Win::show_message(const QString &message)
 {
-    for (int i = 0; i < length; i++) {
-        tmpbuf.push_back(buffer[i]);
-    }
-
-    decoder->demod(tmpbuf.data(), length);
-
-    /* clear tmpbuf and store "overlap" */
-    tmpbuf.erase(tmpbuf.begin(), tmpbuf.begin() + length);
+    ui->textView->appendPlainText(message);
 }
 
 
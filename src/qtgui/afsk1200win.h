@@ -24,8 +24,6 @@
 #define AFSK1200WIN_H
 
 #include <QMainWindow>
-#include <QVarLengthArray>
-#include "dsp/afsk1200/cafsk12.h"
 
 
 namespace Ui {
@@ -41,7 +39,7 @@ class Afsk1200Win : public QMainWindow
 public:
     explicit Afsk1200Win(QWidget *parent = 0);
     ~Afsk1200Win();
-    void process_samples(float *buffer, int length);
+    void show_message(const QString &message);
 
 protected:
     void closeEvent(QCloseEvent *ev);
@@ -56,10 +54,6 @@ private slots:
 
 private:
     Ui::Afsk1200Win *ui;  /*! Qt Designer form. */
-
-    CAfsk12 *decoder;     /*! The AFSK1200 decoder object. */
-
-    std::vector<float> tmpbuf;   /*! Needed to remember "overlap" samples. */
 };
 
 #endif // AFSK1200WIN_H
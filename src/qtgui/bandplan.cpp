@@ -93,28 +93,43 @@ bool BandPlan::load()
     }
     file.close();
 
+    // Bands with the same lower edge stay in the order of the file
+    std::stable_sort(m_BandInfoList.begin(), m_BandInfoList.end());
+    m_MaxFrequency.resize(m_BandInfoList.size());
+    buildIndex(0, m_BandInfoList.size());
+
     emit BandPlanChanged();
     return true;
 }
 
+// Highest upper edge of each subtree, see visitRange()
+void BandPlan::buildIndex(int lo, int hi)
+{
+    if (lo >= hi)
+        return;
+
+    int mid = (lo + hi) / 2;
+    buildIndex(lo, mid);
+    buildIndex(mid + 1, hi);
+
+    qint64 maxFrequency = m_BandInfoList[mid].maxFrequency;
+    if (lo < mid)
+        maxFrequency = std::max(maxFrequency, m_MaxFrequency[(lo + mid) / 2]);
+    if (mid + 1 < hi)
+        maxFrequency = std::max(maxFrequency, m_MaxFrequency[(mid + 1 + hi) / 2]);
+    m_MaxFrequency[mid] = maxFrequency;
+}
+
 QList<BandInfo> BandPlan::getBandsInRange(qint64 low, qint64 high)
 {
     QList<BandInfo> found;
-    for (int i = 0; i < m_BandInfoList.size(); i++) {
-        if(m_BandInfoList[i].maxFrequency < low) continue;
-        if(m_BandInfoList[i].minFrequency > high) continue;
-        found.append(m_BandInfoList[i]);
-    }
+    forEachBandInRange(low, high, [&found](const BandInfo &band) { found.append(band); });
     return found;
 }
 
 QList<BandInfo> BandPlan::getBandsEncompassing(qint64 freq)
 {
     QList<BandInfo> found;
-    for (int i = 0; i < m_BandInfoList.size(); i++) {
-        if(m_BandInfoList[i].maxFrequency < freq) continue;
-        if(m_BandInfoList[i].minFrequency > freq) continue;
-        found.append(m_BandInfoList[i]);
-    }
+    forEachBandEncompassing(freq, [&found](const BandInfo &band) { found.append(band); });
     return found;
 }
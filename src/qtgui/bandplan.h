@@ -29,6 +29,7 @@
 #include <QMap>
 #include <QList>
 #include <QStringList>
+#include <QVector>
 #include <QColor>
 
 struct BandInfo
@@ -66,11 +67,52 @@ public:
     QList<BandInfo> getBandsInRange(qint64 low, qint64 high);
     QList<BandInfo> getBandsEncompassing(qint64 freq);
 
+    // Call visit(const BandInfo &) for each band that overlaps [low, high],
+    // in order of the lower edge, in O(log n + k) and without copies
+    template <typename Visitor>
+    void forEachBandInRange(qint64 low, qint64 high, Visitor visit) const
+    {
+        visitRange(0, m_BandInfoList.size(), low, high, visit);
+    }
+    template <typename Visitor>
+    void forEachBandEncompassing(qint64 freq, Visitor visit) const
+    {
+        visitRange(0, m_BandInfoList.size(), freq, freq, visit);
+    }
+
     void setConfigDir(const QString&);
 
 private:
     BandPlan(); // Singleton Constructor is private.
+    void buildIndex(int lo, int hi);
+
+    /*
+     * The bands are sorted by their lower edge and searched as a balanced
+     * tree whose root is the middle of the list, each half a subtree of
+     * its own. m_MaxFrequency[mid] is the highest upper edge in the
+     * subtree of mid, so the subtrees that end below the range are
+     * skipped, and so is everything right of a band above it.
+     */
+    template <typename Visitor>
+    void visitRange(int lo, int hi, qint64 low, qint64 high, Visitor &visit) const
+    {
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (m_MaxFrequency[mid] < low)
+                return;
+            visitRange(lo, mid, low, high, visit);
+            const BandInfo &band = m_BandInfoList[mid];
+            if (band.minFrequency > high)
+                return;
+            if (band.maxFrequency >= low)
+                visit(band);
+            lo = mid + 1;
+        }
+    }
+
     QList<BandInfo>  m_BandInfoList;
+    QVector<qint64>  m_MaxFrequency;
     QString          m_bandPlanFile;
     static BandPlan* m_pThis;
 
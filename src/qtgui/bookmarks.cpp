@@ -35,6 +35,8 @@ const QString TagInfo::strUntagged("Untagged");
 Bookmarks* Bookmarks::m_pThis = 0;
 
 Bookmarks::Bookmarks()
+    : m_journalSize(0)
+    , m_replaying(false)
 {
      TagInfo::sptr tag = TagInfo::make(TagInfo::strUntagged);
      m_TagList.append(tag);
@@ -53,24 +55,52 @@ Bookmarks& Bookmarks::Get()
 void Bookmarks::setConfigDir(const QString& cfg_dir)
 {
     m_bookmarksFile = cfg_dir + "/bookmarks.csv";
+    m_journalFile = cfg_dir + "/bookmarks.journal";
     std::cout << "BookmarksFile is " << m_bookmarksFile.toStdString() << std::endl;
 }
 
 void Bookmarks::add(BookmarkInfo &info)
 {
-    m_BookmarkList.append(info);
-    std::stable_sort(m_BookmarkList.begin(),m_BookmarkList.end());
-    save();
+    int index = insert(info);
+    emit BookmarkAdded(index);
+    journal(QStringList() << "+; " + toLine(info));
+    emit BookmarksChanged();
 }
 
 void Bookmarks::remove(int index)
 {
+    QString line = toLine(m_BookmarkList[index]);
     m_BookmarkList.removeAt(index);
-    save();
+    emit BookmarkRemoved(index);
+    journal(QStringList() << "-; " + line);
+    emit BookmarksChanged();
+}
+
+void Bookmarks::update(int index, const BookmarkInfo &info)
+{
+    QString oldLine = toLine(m_BookmarkList[index]);
+    QString newLine = toLine(info);
+    if (newLine == oldLine)
+        return;
+
+    if (info.frequency == m_BookmarkList[index].frequency)
+    {
+        m_BookmarkList[index] = info;
+        emit BookmarkChanged(index);
+    }
+    else
+    {
+        m_BookmarkList.removeAt(index);
+        emit BookmarkRemoved(index);
+        emit BookmarkAdded(insert(info));
+    }
+    journal(QStringList() << "-; " + oldLine << "+; " + newLine);
+    emit BookmarksChanged();
 }
 
 bool Bookmarks::load()
 {
+    bool loaded = false;
     QFile file(m_bookmarksFile);
     if (file.open(QIODevice::ReadOnly | QIODevice::Text))
     {
@@ -112,22 +142,9 @@ bool Bookmarks::load()
             if(line.isEmpty() || line.startsWith("#"))
                 continue;
 
-            QStringList strings = line.split(";");
-            if(strings.count() == 5)
+            BookmarkInfo info;
+            if(parseBookmark(line, info))
             {
-                BookmarkInfo info;
-                info.frequency  = strings[0].toLongLong();
-                info.name       = strings[1].trimmed();
-                info.modulation = strings[2].trimmed();
-                info.bandwidth  = strings[3].toInt();
-                // Multiple Tags may be separated by comma.
-                QString strTags = strings[4];
-                QStringList TagList = strTags.split(",");
-                for(int iTag=0; iTag<TagList.size(); ++iTag)
-                {
-                  info.tags.append(findOrAddTag(TagList[iTag].trimmed()));
-                }
-
                 m_BookmarkList.append(info);
             }
             else
@@ -138,11 +155,32 @@ bool Bookmarks::load()
         }
         file.close();
         std::stable_sort(m_BookmarkList.begin(),m_BookmarkList.end());
+        loaded = true;
+    }
 
-        emit BookmarksChanged();
-        return true;
+    // The edits since the file was last written
+    QFile journalFile(m_journalFile);
+    m_journalSize = 0;
+    if (journalFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        if (!loaded)
+        {
+            m_BookmarkList.clear();
+            m_TagList.clear();
+            findOrAddTag(TagInfo::strUntagged);
+        }
+        m_replaying = true;
+        replay(journalFile);
+        m_replaying = false;
+        journalFile.close();
+        std::sort(m_TagList.begin(),m_TagList.end());
+        save();
+        loaded = true;
     }
-    return false;
+
+    if (loaded)
+        emit BookmarksChanged();
+    return loaded;
 }
 
 //FIXME: Commas in names
@@ -182,53 +220,158 @@ bool Bookmarks::save()
 
         for (int i = 0; i < m_BookmarkList.size(); i++)
         {
-            BookmarkInfo& info = m_BookmarkList[i];
-            QString line = QString::number(info.frequency).rightJustified(12) +
-                    "; " + info.name.leftJustified(25) + "; " +
-                    info.modulation.leftJustified(20)+ "; " +
-                    QString::number(info.bandwidth).rightJustified(10) + "; ";
-            for(int iTag = 0; iTag<info.tags.size(); ++iTag)
-            {
-                TagInfo::sptr tag = info.tags[iTag];
-                if (iTag!=0)
-                {
-                    line.append(",");
-                }
-                line.append(tag->name);
-            }
-
-            stream << line << '\n';
+            stream << toLine(m_BookmarkList[i]) << '\n';
         }
 
-        emit BookmarksChanged();
+        stream.flush();
+        if (file.error() != QFile::NoError)
+            return false;
         file.close();
+
+        // Everything in the journal is in the file now
+        QFile::remove(m_journalFile);
+        m_journalSize = 0;
         return true;
     }
     return false;
 }
 
-QList<BookmarkInfo> Bookmarks::getBookmarksInRange(qint64 low, qint64 high)
+/* After the bookmarks on the same frequency, as the stable sort did */
+int Bookmarks::insert(const BookmarkInfo &info)
+{
+    int index = std::upper_bound(m_BookmarkList.begin(), m_BookmarkList.end(), info) - m_BookmarkList.begin();
+    m_BookmarkList.insert(index, info);
+    return index;
+}
+
+/* Index of the bookmark written as line, -1 if there is none */
+int Bookmarks::find(const QString &line) const
 {
     BookmarkInfo info;
-    info.frequency=low;
-    QList<BookmarkInfo>::const_iterator lb = std::lower_bound(m_BookmarkList.begin(), m_BookmarkList.end(), info);
-    info.frequency=high;
-    QList<BookmarkInfo>::const_iterator ub = std::upper_bound(m_BookmarkList.begin(), m_BookmarkList.end(), info);
+    info.frequency = line.section(';', 0, 0).toLongLong();
+    auto range = std::equal_range(m_BookmarkList.begin(), m_BookmarkList.end(), info);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (toLine(*it).trimmed() == line)
+            return it - m_BookmarkList.begin();
+    }
+    return -1;
+}
 
-    QList<BookmarkInfo> found;
+bool Bookmarks::parseBookmark(const QString &line, BookmarkInfo &info)
+{
+    QStringList strings = line.split(";");
+    if (strings.count() != 5)
+        return false;
 
-    while (lb != ub)
+    info.frequency  = strings[0].toLongLong();
+    info.name       = strings[1].trimmed();
+    info.modulation = strings[2].trimmed();
+    info.bandwidth  = strings[3].toInt();
+    // Multiple Tags may be separated by comma.
+    QString strTags = strings[4];
+    QStringList TagList = strTags.split(",");
+    info.tags.clear();
+    for(int iTag=0; iTag<TagList.size(); ++iTag)
     {
-        const BookmarkInfo& info = *lb;
-        if(info.IsActive())
+      info.tags.append(findOrAddTag(TagList[iTag].trimmed()));
+    }
+    return true;
+}
+
+QString Bookmarks::toLine(const BookmarkInfo &info)
+{
+    QString line = QString::number(info.frequency).rightJustified(12) +
+            "; " + info.name.leftJustified(25) + "; " +
+            info.modulation.leftJustified(20)+ "; " +
+            QString::number(info.bandwidth).rightJustified(10) + "; ";
+    for(int iTag = 0; iTag<info.tags.size(); ++iTag)
+    {
+        TagInfo::sptr tag = info.tags[iTag];
+        if (iTag!=0)
         {
-          found.append(info);
+            line.append(",");
         }
-        lb++;
+        line.append(tag->name);
     }
+    return line;
+}
 
-    return found;
+/* Apply the edits of the journal */
+void Bookmarks::replay(QFile &file)
+{
+    while (!file.atEnd())
+    {
+        QString line = QString::fromUtf8(file.readLine());
+        if (!line.endsWith('\n'))
+            break; // cut short by a crash while it was written
+        line = line.trimmed();
+
+        QString op = line.section(';', 0, 0).trimmed();
+        QString rest = line.section(';', 1).trimmed();
+        if (op == "+")
+        {
+            BookmarkInfo info;
+            if (parseBookmark(rest, info))
+                insert(info);
+        }
+        else if (op == "-")
+        {
+            // Compared as written, so the tags of the line are not added
+            int idx = find(rest);
+            if (idx != -1)
+                m_BookmarkList.removeAt(idx);
+        }
+        else if (op == "T")
+        {
+            TagInfo::sptr info = findOrAddTag(rest.section(';', 0, 0));
+            info->color = QColor(rest.section(';', 1).trimmed());
+        }
+        else if (op == "X")
+        {
+            removeTag(rest);
+        }
+        else
+        {
+            std::cout << "Bookmarks: Ignoring journal line:" << std::endl;
+            std::cout << "  " << line.toStdString() << std::endl;
+        }
+    }
+}
+
+/* Append the lines of an edit that has been made */
+void Bookmarks::journal(const QStringList &lines)
+{
+    if (m_replaying)
+        return;
+
+    if (m_journalSize + lines.size() > BOOKMARKS_JOURNAL_COMPACT)
+    {
+        save();
+        return;
+    }
 
+    QFile file(m_journalFile);
+    if (file.open(QFile::WriteOnly | QFile::Append | QIODevice::Text))
+    {
+        file.write((lines.join('\n') + '\n').toUtf8());
+        file.close();
+        m_journalSize += lines.size();
+    }
+    else
+    {
+        // Nothing is lost as long as the whole file can be written
+        save();
+    }
+}
+
+QList<BookmarkInfo> Bookmarks::getBookmarksInRange(qint64 low, qint64 high)
+{
+    QList<BookmarkInfo> found;
+
+    forEachBookmarkInRange(low, high, [&found](const BookmarkInfo &info) { found.append(info); });
+
+    return found;
 }
 
 TagInfo::sptr Bookmarks::findOrAddTag(QString tagName)
@@ -279,6 +422,7 @@ bool Bookmarks::removeTag(QString tagName)
 
     // Delete Tag.
     m_TagList.removeAt(idx);
+    journal(QStringList() << "X; " + tagName);
 
     emit BookmarksChanged();
     emit TagListChanged();
@@ -296,6 +440,17 @@ bool Bookmarks::setTagChecked(QString tagName, bool bChecked)
     return true;
 }
 
+bool Bookmarks::setTagColor(QString tagName, QColor color)
+{
+    int idx = getTagIndex(tagName);
+    if (idx == -1) return false;
+    m_TagList[idx]->color = color;
+    journal(QStringList() << "T; " + m_TagList[idx]->name + "; " + color.name());
+    emit BookmarksChanged();
+    emit TagListChanged();
+    return true;
+}
+
 int Bookmarks::getTagIndex(QString tagName)
 {
     tagName = tagName.trimmed();
@@ -30,8 +30,13 @@
 #include <QList>
 #include <QStringList>
 #include <QColor>
+#include <QFile>
+#include <algorithm>
 #include <memory>
 
+// Edits appended to the journal before the bookmark file is written again
+#define BOOKMARKS_JOURNAL_COMPACT 1000
+
 struct TagInfo
 {
     using sptr = std::shared_ptr<TagInfo>;
@@ -95,6 +100,15 @@ struct BookmarkInfo
     bool IsActive() const;
 };
 
+/*
+ * The bookmarks, sorted by frequency.
+ *
+ * bookmarks.csv is only written in full when it is loaded with a journal
+ * and after BOOKMARKS_JOURNAL_COMPACT edits. Every edit in between is
+ * appended to bookmarks.journal as a line of the same format, prefixed by
+ * "+" for a bookmark added, "-" for one removed, "T" for the color of a
+ * tag and "X" for a tag removed. A changed bookmark is removed then added.
+ */
 class Bookmarks : public QObject
 {
     Q_OBJECT
@@ -105,11 +119,25 @@ public:
 
     void add(BookmarkInfo& info);
     void remove(int index);
+    // Replace a bookmark, which may move it if the frequency changed
+    void update(int index, const BookmarkInfo& info);
     bool load();
     bool save();
     int size() { return m_BookmarkList.size(); }
-    BookmarkInfo& getBookmark(int i) { return m_BookmarkList[i]; }
+    // Read only, changes are made through update() to be journaled
+    const BookmarkInfo& getBookmark(int i) { return m_BookmarkList[i]; }
     QList<BookmarkInfo> getBookmarksInRange(qint64 low, qint64 high);
+
+    // Visit the active bookmarks from low to high without copying them
+    template <typename Visitor>
+    void forEachBookmarkInRange(qint64 low, qint64 high, Visitor visit) const
+    {
+        auto it = std::lower_bound(m_BookmarkList.constBegin(), m_BookmarkList.constEnd(), low,
+                                   [](const BookmarkInfo &info, qint64 freq) { return info.frequency < freq; });
+        for (; it != m_BookmarkList.constEnd() && it->frequency <= high; ++it)
+            if (it->IsActive())
+                visit(*it);
+    }
     //int lowerBound(qint64 low);
     //int upperBound(qint64 high);
 
@@ -118,18 +146,33 @@ public:
     int getTagIndex(QString tagName);
     bool removeTag(QString tagName);
     bool setTagChecked(QString tagName, bool bChecked);
+    bool setTagColor(QString tagName, QColor color);
 
     void setConfigDir(const QString&);
 
 private:
     Bookmarks(); // Singleton Constructor is private.
+    int insert(const BookmarkInfo& info);
+    int find(const QString& line) const;
+    bool parseBookmark(const QString& line, BookmarkInfo& info);
+    void replay(QFile& file);
+    void journal(const QStringList& lines);
+    static QString toLine(const BookmarkInfo& info);
+
     QList<BookmarkInfo>  m_BookmarkList;
     QList<TagInfo::sptr> m_TagList;
     QString              m_bookmarksFile;
+    QString              m_journalFile;
+    int                  m_journalSize;     // lines in the journal
+    bool                 m_replaying;
     static Bookmarks*    m_pThis;
 
 signals:
     void BookmarksChanged(void);
+    // Single bookmarks edited, a removed one by the index it had
+    void BookmarkAdded(int index);
+    void BookmarkRemoved(int index);
+    void BookmarkChanged(int index);
     void TagListChanged(void);
 };
 
@@ -20,6 +20,8 @@
  * the Free Software Foundation, Inc., 51 Franklin Street,
  * Boston, MA 02110-1301, USA.
  */
+#include <algorithm>
+#include <cstdlib>
 #include <QFile>
 #include <QStringList>
 #include "bookmarks.h"
@@ -28,13 +30,17 @@
 
 
 BookmarksTableModel::BookmarksTableModel(QObject *parent) :
-    QAbstractTableModel(parent)
+    QAbstractTableModel(parent),
+    m_fetched(0)
 {
+    connect(&Bookmarks::Get(), SIGNAL(BookmarkAdded(int)), this, SLOT(bookmarkAdded(int)));
+    connect(&Bookmarks::Get(), SIGNAL(BookmarkRemoved(int)), this, SLOT(bookmarkRemoved(int)));
+    connect(&Bookmarks::Get(), SIGNAL(BookmarkChanged(int)), this, SLOT(bookmarkChanged(int)));
 }
 
 int BookmarksTableModel::rowCount ( const QModelIndex & /*parent*/ ) const
 {
-    return m_Bookmarks.size();
+    return m_fetched;
 }
 int BookmarksTableModel::columnCount ( const QModelIndex & /*parent*/ ) const
 {
@@ -73,7 +79,7 @@ QVariant BookmarksTableModel::headerData ( int section, Qt::Orientation orientat
 
 QVariant BookmarksTableModel::data ( const QModelIndex & index, int role ) const
 {
-    BookmarkInfo& info = *m_Bookmarks[index.row()];
+    const BookmarkInfo& info = Bookmarks::Get().getBookmark(m_rows[index.row()]);
 
     if(role==Qt::BackgroundRole)
     {
@@ -114,19 +120,22 @@ bool BookmarksTableModel::setData(const QModelIndex &index, const QVariant &valu
 {
     if(role==Qt::EditRole)
     {
-        BookmarkInfo &info = *m_Bookmarks[index.row()];
+        // Changed through Bookmarks, which journals the edit and
+        // reports the row changed or moved
+        int iBookmark = m_rows[index.row()];
+        BookmarkInfo info = Bookmarks::Get().getBookmark(iBookmark);
         switch(index.column())
         {
         case COL_FREQUENCY:
             {
                 info.frequency = value.toLongLong();
-                emit dataChanged(index, index);
+                Bookmarks::Get().update(iBookmark, info);
             }
             break;
         case COL_NAME:
             {
                 info.name = value.toString();
-                emit dataChanged(index, index);
+                Bookmarks::Get().update(iBookmark, info);
                 return true;
             }
             break;
@@ -136,14 +145,14 @@ bool BookmarksTableModel::setData(const QModelIndex &index, const QVariant &valu
                 if(DockRxOpt::IsModulationValid(value.toString()))
                 {
                     info.modulation = value.toString();
-                    emit dataChanged(index, index);
+                    Bookmarks::Get().update(iBookmark, info);
                 }
             }
             break;
         case COL_BANDWIDTH:
             {
                 info.bandwidth = value.toInt();
-                emit dataChanged(index, index);
+                Bookmarks::Get().update(iBookmark, info);
             }
             break;
         case COL_TAGS:
@@ -156,7 +165,7 @@ bool BookmarksTableModel::setData(const QModelIndex &index, const QVariant &valu
                     QString strTag = strList[i].trimmed();
                     info.tags.append( Bookmarks::Get().findOrAddTag(strTag) );
                 }
-                emit dataChanged(index, index);
+                Bookmarks::Get().update(iBookmark, info);
                 return true;
             }
             break;
@@ -185,41 +194,131 @@ Qt::ItemFlags BookmarksTableModel::flags ( const QModelIndex& index ) const
     return flags;
 }
 
+bool BookmarksTableModel::canFetchMore ( const QModelIndex & parent ) const
+{
+    return !parent.isValid() && m_fetched < m_rows.size();
+}
+
+void BookmarksTableModel::fetchMore ( const QModelIndex & parent )
+{
+    if (parent.isValid())
+        return;
+    fetchTo(std::min(m_fetched + BOOKMARKS_FETCH_ROWS, (int)m_rows.size()) - 1);
+}
+
+void BookmarksTableModel::fetchTo(int row)
+{
+    if (row < m_fetched)
+        return;
+    beginInsertRows(QModelIndex(), m_fetched, row);
+    m_fetched = row + 1;
+    endInsertRows();
+}
+
 void BookmarksTableModel::update()
 {
-    int iRow = 0;
-    m_Bookmarks.clear();
+    beginResetModel();
+    m_rows.clear();
     for(int iBookmark=0; iBookmark<Bookmarks::Get().size(); iBookmark++)
     {
-        BookmarkInfo& info = Bookmarks::Get().getBookmark(iBookmark);
+        if(Bookmarks::Get().getBookmark(iBookmark).IsActive())
+            m_rows.append(iBookmark);
+    }
+    m_fetched = std::min((int)m_rows.size(), BOOKMARKS_FETCH_ROWS);
+    endResetModel();
+}
 
-        bool bActive = false;
-        for(int iTag=0; iTag<info.tags.size(); ++iTag)
-        {
-            TagInfo::sptr tag = info.tags[iTag];
-            if(tag->active)
-            {
-                bActive = true;
-                break;
-            }
-        }
-        if(bActive)
-        {
-            m_mapRowToBookmarksIndex[iRow]=iBookmark;
-            m_Bookmarks.append(&info);
-            ++iRow;
-        }
+/* Row of a bookmark, or where it would be if its tags are not active */
+int BookmarksTableModel::rowOf(int iBookmark) const
+{
+    return std::lower_bound(m_rows.begin(), m_rows.end(), iBookmark) - m_rows.begin();
+}
+
+/* Shown at once unless the row is past those fetched so far */
+void BookmarksTableModel::showRow(int row, int iBookmark)
+{
+    if (row < m_fetched || m_fetched == m_rows.size())
+    {
+        beginInsertRows(QModelIndex(), row, row);
+        m_rows.insert(row, iBookmark);
+        m_fetched++;
+        endInsertRows();
     }
+    else
+    {
+        m_rows.insert(row, iBookmark);
+    }
+}
 
-    emit layoutChanged();
+void BookmarksTableModel::hideRow(int row)
+{
+    if (row < m_fetched)
+    {
+        beginRemoveRows(QModelIndex(), row, row);
+        m_rows.remove(row);
+        m_fetched--;
+        endRemoveRows();
+    }
+    else
+    {
+        m_rows.remove(row);
+    }
+}
+
+void BookmarksTableModel::bookmarkAdded(int index)
+{
+    int row = rowOf(index);
+    for (int i = row; i < m_rows.size(); i++)
+        m_rows[i]++;
+
+    if (Bookmarks::Get().getBookmark(index).IsActive())
+        showRow(row, index);
+}
+
+void BookmarksTableModel::bookmarkRemoved(int index)
+{
+    int row = rowOf(index);
+    if (row < m_rows.size() && m_rows[row] == index)
+        hideRow(row);
+
+    for (int i = row; i < m_rows.size(); i++)
+        m_rows[i]--;
+}
+
+void BookmarksTableModel::bookmarkChanged(int index)
+{
+    int row = rowOf(index);
+    bool shown = row < m_rows.size() && m_rows[row] == index;
+    bool active = Bookmarks::Get().getBookmark(index).IsActive();
+
+    if (shown && !active)
+        hideRow(row);
+    else if (!shown && active)
+        showRow(row, index);
+    else if (shown && row < m_fetched)
+        emit dataChanged(this->index(row, 0), this->index(row, columnCount() - 1));
 }
 
-BookmarkInfo *BookmarksTableModel::getBookmarkAtRow(int row)
+const BookmarkInfo *BookmarksTableModel::getBookmarkAtRow(int row)
 {
-    return m_Bookmarks[row];
+    return &Bookmarks::Get().getBookmark(m_rows[row]);
 }
 
 int BookmarksTableModel::GetBookmarksIndexForRow(int iRow)
 {
-  return m_mapRowToBookmarksIndex[iRow];
+  return m_rows[iRow];
+}
+
+int BookmarksTableModel::findRow(qint64 frequency)
+{
+    for (int row = 0; row < m_rows.size(); ++row)
+    {
+        const BookmarkInfo& info = Bookmarks::Get().getBookmark(m_rows[row]);
+        if (std::abs(frequency - info.frequency) <= ((info.bandwidth / 2 ) + 1))
+        {
+            fetchTo(row);
+            return row;
+        }
+    }
+    return -1;
 }
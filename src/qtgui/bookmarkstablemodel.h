@@ -24,11 +24,21 @@
 #define BOOKMARKSTABLEMODEL_H
 
 #include <QAbstractTableModel>
-#include <QList>
+#include <QVector>
 
 #include "bookmarks.h"
 
+// Rows the view is given at a time as it scrolls down
+#define BOOKMARKS_FETCH_ROWS 256
 
+/*
+ * The bookmarks with an active tag.
+ *
+ * Bookmarks added, removed and changed are inserted, removed and updated
+ * as single rows, the rows are only built again when the tags change.
+ * The rows are handed to the view BOOKMARKS_FETCH_ROWS at a time through
+ * fetchMore(), so a large list is not laid out in full.
+ */
 class BookmarksTableModel : public QAbstractTableModel
 {
     Q_OBJECT
@@ -51,18 +61,32 @@ public:
     QVariant data ( const QModelIndex & index, int role = Qt::DisplayRole ) const;
     bool setData ( const QModelIndex & index, const QVariant & value, int role = Qt::EditRole );
     Qt::ItemFlags flags ( const QModelIndex & index ) const;
+    bool canFetchMore ( const QModelIndex & parent ) const;
+    void fetchMore ( const QModelIndex & parent );
 
-    BookmarkInfo* getBookmarkAtRow(int row);
+    const BookmarkInfo* getBookmarkAtRow(int row);
     int GetBookmarksIndexForRow(int iRow);
+    // First row within the bandwidth of a bookmark, fetched if it was not, or -1
+    int findRow(qint64 frequency);
 
 private:
-    QList<BookmarkInfo*> m_Bookmarks;
-    QMap<int,int> m_mapRowToBookmarksIndex;
+    int rowOf(int iBookmark) const;
+    void showRow(int row, int iBookmark);
+    void hideRow(int row);
+    void fetchTo(int row);
+
+    QVector<int> m_rows;        // index in Bookmarks of each row, ascending
+    int          m_fetched;     // rows the view has been told of
 
 signals:
 public slots:
     void update();
 
+private slots:
+    void bookmarkAdded(int index);
+    void bookmarkRemoved(int index);
+    void bookmarkChanged(int index);
+
 };
 
 #endif
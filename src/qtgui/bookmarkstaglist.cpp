@@ -70,9 +70,8 @@ void BookmarksTagList::changeColor(int row, int /*column*/)
     if(!color.isValid())
         return;
 
-    info->color=color;
+    Bookmarks::Get().setTagColor(info->name, color);
     updateTags();
-    Bookmarks::Get().save();
 }
 
 void BookmarksTagList::toggleCheckedState(int row, int column)
@@ -0,0 +1,182 @@
+#include "channel_scanner.h"
+#include "../applications/gqrx/receiver.h"
+#include <algorithm>
+#include <cmath>
+
+ChannelScanner::ChannelScanner(receiver *rx, QObject *parent)
+    : QObject(parent)
+    , m_rx(rx)
+    , m_threshold(-70.0)
+    , m_hangMs(2000)
+    , m_dwellMs(0)
+    , m_lnbLo(0)
+    , m_homeRf(0.0)
+    , m_homeOffset(0.0)
+    , m_current(-1)
+    , m_dwelling(false)
+    , m_passHops(0)
+    , m_rate(0.0)
+{
+    qRegisterMetaType<Channel>("ChannelScanner::Channel");
+
+    m_tick.setInterval(SCAN_POLL_MS);
+    m_tick.setTimerType(Qt::PreciseTimer);
+    connect(&m_tick, &QTimer::timeout, this, &ChannelScanner::tick);
+}
+
+ChannelScanner::~ChannelScanner()
+{
+    stop();
+}
+
+void ChannelScanner::setChannels(const QList<Channel>& channels)
+{
+    m_channels = channels;
+    std::sort(m_channels.begin(), m_channels.end(),
+              [](const Channel& a, const Channel& b) { return a.frequency < b.frequency; });
+    m_current = -1;
+    if (m_channels.isEmpty())
+        stop();
+}
+
+/* Add a channel every step from start to end */
+void ChannelScanner::addRange(qint64 start, qint64 end, qint64 step, const QString& modulation,
+                              qint64 bandwidth)
+{
+    if (step <= 0)
+        return;
+
+    QList<Channel> channels = m_channels;
+    for (qint64 freq = start; freq <= end; freq += step)
+        channels.append({freq, QString(), modulation, bandwidth});
+    setChannels(channels);
+}
+
+void ChannelScanner::start()
+{
+    if (isRunning() || m_channels.isEmpty())
+        return;
+
+    m_homeRf = m_rx->get_rf_freq();
+    m_homeOffset = m_rx->get_filter_offset();
+    m_current = -1;
+    m_dwelling = false;
+    m_passHops = 0;
+    m_passTime.start();
+    m_tick.start();
+    hop();
+}
+
+/* Stop and tune back to where the scan started, or to the last active channel */
+void ChannelScanner::stop()
+{
+    if (!isRunning())
+        return;
+
+    m_tick.stop();
+    m_dwelling = false;
+    if (m_rx->get_rf_freq() != m_homeRf)
+        m_rx->set_rf_freq(m_homeRf);
+    m_rx->set_filter_offset(m_homeOffset);
+}
+
+bool ChannelScanner::inSpan(double hw_freq, qint64 bandwidth) const
+{
+    double half_span = m_rx->get_quad_rate() * SCAN_USABLE_FRACTION / 2.0;
+
+    return std::fabs(hw_freq - m_rx->get_rf_freq()) + bandwidth / 2.0 <= half_span;
+}
+
+/* Tune to the next channel and start its measurement */
+void ChannelScanner::hop()
+{
+    m_current = (m_current + 1) % m_channels.size();
+    if (m_current == 0)
+    {
+        if (m_passHops > 0)
+            m_rate = m_passHops * 1000.0 / std::max<qint64>(1, m_passTime.restart());
+        m_passHops = 0;
+    }
+    m_passHops++;
+
+    const Channel& channel = m_channels[m_current];
+    double hw_freq = (double)(channel.frequency - m_lnbLo);
+    double settle = SCAN_SETTLE_SEC;
+
+    // The channel goes to the low edge, the next ones are above it
+    if (!inSpan(hw_freq, channel.bandwidth))
+    {
+        double half_span = m_rx->get_quad_rate() * SCAN_USABLE_FRACTION / 2.0;
+        m_rx->set_rf_freq(hw_freq + std::max(0.0, half_span - channel.bandwidth / 2.0));
+        settle = SCAN_RETUNE_SETTLE_SEC;
+    }
+    m_rx->set_filter_offset(hw_freq - m_rx->get_rf_freq());
+    m_rx->start_level_probe(settle, SCAN_PROBE_SEC);
+    m_probeTime.restart();
+}
+
+void ChannelScanner::probeDone(float level_db)
+{
+    if (m_current < 0 || m_current >= m_channels.size())
+    {
+        // The channels were replaced
+        m_dwelling = false;
+        hop();
+        return;
+    }
+
+    const Channel& channel = m_channels[m_current];
+
+    if (m_dwelling)
+    {
+        if (level_db >= m_threshold)
+            m_activeTime.restart();
+        if (m_activeTime.elapsed() < m_hangMs &&
+            (m_dwellMs <= 0 || m_dwellTime.elapsed() < m_dwellMs))
+        {
+            m_rx->start_level_probe(0.0, SCAN_DWELL_PROBE_SEC);
+            m_probeTime.restart();
+            return;
+        }
+        m_dwelling = false;
+        emit channelQuiet(channel);
+        hop();
+        return;
+    }
+
+    if (level_db < m_threshold)
+    {
+        hop();
+        return;
+    }
+
+    m_dwelling = true;
+    m_dwellTime.start();
+    m_activeTime.start();
+    m_homeRf = m_rx->get_rf_freq();
+    m_homeOffset = m_rx->get_filter_offset();
+    emit channelActive(channel, level_db);
+
+    // After the signal, which may have changed the demodulator
+    m_rx->start_level_probe(0.0, SCAN_DWELL_PROBE_SEC);
+    m_probeTime.restart();
+}
+
+/* Take every finished measurement, a new probe is never done at once */
+void ChannelScanner::tick()
+{
+    float level_db;
+
+    while (isRunning() && !m_channels.isEmpty())
+    {
+        if (!m_rx->get_level_probe(level_db))
+        {
+            if (m_probeTime.elapsed() < SCAN_PROBE_TIMEOUT_MS)
+                return;
+            level_db = -200.0f;
+        }
+        probeDone(level_db);
+        if (m_dwelling)
+            return;
+    }
+}
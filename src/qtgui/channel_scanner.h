@@ -0,0 +1,115 @@
+#ifndef CHANNEL_SCANNER_H
+#define CHANNEL_SCANNER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+class receiver;
+
+// Part of the receiver bandwidth channels are tuned in by the filter offset
+#define SCAN_USABLE_FRACTION 0.9
+
+// Time the channel filter needs after a new offset, before measuring
+#define SCAN_SETTLE_SEC 0.003
+
+// Time the hardware needs after a retune, before measuring
+#define SCAN_RETUNE_SETTLE_SEC 0.05
+
+// Length of the level measurement of a channel
+#define SCAN_PROBE_SEC 0.002
+
+// Length of the level measurements while dwelling on a channel
+#define SCAN_DWELL_PROBE_SEC 0.02
+
+// A channel is given up if its measurement takes longer, the flow graph is stopped
+#define SCAN_PROBE_TIMEOUT_MS 250
+
+// Interval the measurements are polled at
+#define SCAN_POLL_MS 1
+
+/*
+ * Scans a list of channels for activity.
+ *
+ * Channels inside the bandwidth of the receiver are tuned by the filter
+ * offset only and measured with a short level probe of the channel meter,
+ * so hopping takes a few ms. The hardware is retuned only for a channel
+ * outside the bandwidth, and then so that the next channels up fit in it.
+ * The scanner stays on an active channel until it has been quiet for the
+ * hang time, or for the dwell time at most.
+ *
+ * The level is measured in the current filter of the receiver.
+ */
+class ChannelScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Channel {
+        qint64 frequency;       // Hz, with the LNB LO
+        QString name;
+        QString modulation;
+        qint64 bandwidth;       // Hz
+    };
+
+    explicit ChannelScanner(receiver *rx, QObject *parent = nullptr);
+    ~ChannelScanner() override;
+
+    void setChannels(const QList<Channel>& channels);
+    void addRange(qint64 start, qint64 end, qint64 step, const QString& modulation,
+                  qint64 bandwidth);
+    const QList<Channel>& channels() const { return m_channels; }
+
+    void setThreshold(double level_db) { m_threshold = level_db; }
+    void setHang(int ms) { m_hangMs = ms; }
+    void setDwell(int ms) { m_dwellMs = ms; }   // 0 to stay while active
+    void setLnbLo(qint64 lnb_lo) { m_lnbLo = lnb_lo; }
+
+    void start();
+    void stop();
+    bool isRunning() const { return m_tick.isActive(); }
+
+    /* Channels measured per second in the last pass */
+    double channelRate() const { return m_rate; }
+
+signals:
+    void channelActive(const ChannelScanner::Channel& channel, float level_db);
+    void channelQuiet(const ChannelScanner::Channel& channel);
+
+private slots:
+    void tick();
+
+private:
+    void hop();
+    bool inSpan(double hw_freq, qint64 bandwidth) const;
+    void probeDone(float level_db);
+
+    receiver *m_rx;
+    QList<Channel> m_channels;  // by frequency
+    QTimer m_tick;
+
+    double m_threshold;
+    int m_hangMs;
+    int m_dwellMs;
+    qint64 m_lnbLo;
+
+    // Tuning to restore on stop(), of the start or the last active channel
+    double m_homeRf;
+    double m_homeOffset;
+
+    int m_current;              // index in m_channels, -1 before the first hop
+    bool m_dwelling;
+    QElapsedTimer m_probeTime;  // since the probe was started
+    QElapsedTimer m_dwellTime;  // since the channel became active
+    QElapsedTimer m_activeTime; // since the level was last above the threshold
+
+    QElapsedTimer m_passTime;
+    int m_passHops;
+    double m_rate;
+};
+
+Q_DECLARE_METATYPE(ChannelScanner::Channel)
+
+#endif // CHANNEL_SCANNER_H
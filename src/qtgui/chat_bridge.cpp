@@ -0,0 +1,98 @@
+#include <QJsonObject>
+#include "chat_bridge.h"
+
+ChatBridge::ChatBridge(QObject *parent) :
+    QObject(parent),
+    m_ready(false)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(CHAT_BRIDGE_FLUSH_MS);
+    connect(&m_flushTimer, &QTimer::timeout, this, &ChatBridge::flush);
+}
+
+QJsonObject ChatBridge::message(const QString &role, const QString &text)
+{
+    return QJsonObject{{"role", role}, {"text", text}};
+}
+
+/**
+ * Queue a message for the page.
+ * @param placeholder The message is not in the database and does not count
+ *                    for the paging, like the welcome text of an empty chat.
+ */
+void ChatBridge::append(const QString &role, const QString &text, bool placeholder)
+{
+    QJsonObject msg = message(role, text);
+    if (placeholder)
+        msg["placeholder"] = true;
+    m_pending.append(msg);
+    if (!m_flushTimer.isActive())
+        m_flushTimer.start();
+}
+
+/**
+ * Add a page of older messages at the top.
+ * @param messages The messages, oldest first.
+ * @param more True if there are older messages in the database.
+ */
+void ChatBridge::prepend(const QJsonArray &messages, bool more)
+{
+    if (m_ready)
+        emit messagesPrepended(messages, more);
+}
+
+void ChatBridge::clear()
+{
+    m_flushTimer.stop();
+    m_pending = QJsonArray();
+    if (m_ready)
+        emit messagesCleared();
+}
+
+/* The stream functions send the queued messages first to keep the order */
+void ChatBridge::beginStream()
+{
+    flush();
+    if (m_ready)
+        emit streamStarted();
+}
+
+void ChatBridge::appendStream(const QString &text)
+{
+    flush();
+    if (m_ready)
+        emit streamText(text);
+}
+
+/**
+ * End the streamed message.
+ * @param text Complete text of the message.
+ * @param replace Replace the streamed text by text, false to keep it.
+ */
+void ChatBridge::endStream(const QString &text, bool replace)
+{
+    flush();
+    if (m_ready)
+        emit streamEnded(text, replace);
+}
+
+void ChatBridge::pageReady()
+{
+    m_ready = true;
+    flush();
+    emit ready();
+}
+
+void ChatBridge::loadOlder(int loaded)
+{
+    emit olderRequested(loaded);
+}
+
+void ChatBridge::flush()
+{
+    m_flushTimer.stop();
+    if (!m_ready || m_pending.isEmpty())
+        return;
+    emit messagesAppended(m_pending);
+    m_pending = QJsonArray();
+}
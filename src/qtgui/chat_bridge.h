@@ -0,0 +1,77 @@
+#ifndef CHAT_BRIDGE_H
+#define CHAT_BRIDGE_H
+
+#include <QJsonArray>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+/* Appended messages are sent to the page at most this often */
+#define CHAT_BRIDGE_FLUSH_MS      50
+
+/* Messages loaded from the database per page of history */
+#define CHAT_BRIDGE_PAGE_MESSAGES 50
+
+/* Messages kept in the page, older ones are dropped and loaded again on scroll */
+#define CHAT_BRIDGE_DOM_MESSAGES  200
+
+/**
+ * Bridge between DockSigint and the chat page, shared over QWebChannel.
+ *
+ * Messages go to the page as JSON and the page builds the elements, so
+ * nothing is escaped into runJavaScript() strings and the page is loaded
+ * only once. Appended messages are queued and sent in batches.
+ *
+ * The page keeps at most CHAT_BRIDGE_DOM_MESSAGES messages. When it is
+ * scrolled to the top it calls loadOlder() with the number of messages it
+ * holds, which is the offset of the next page from the newest message.
+ */
+class ChatBridge : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int domLimit READ domLimit CONSTANT)
+
+public:
+    explicit ChatBridge(QObject *parent = nullptr);
+
+    void append(const QString &role, const QString &text, bool placeholder = false);
+    void prepend(const QJsonArray &messages, bool more);
+    void clear();
+
+    void beginStream();
+    void appendStream(const QString &text);
+    void endStream(const QString &text, bool replace);
+
+    int domLimit() const { return CHAT_BRIDGE_DOM_MESSAGES; }
+    bool isReady() const { return m_ready; }
+
+    static QJsonObject message(const QString &role, const QString &text);
+
+public slots:
+    // Called from the page
+    void pageReady();
+    void loadOlder(int loaded);
+
+signals:
+    // To the page
+    void messagesAppended(const QJsonArray &messages);
+    void messagesPrepended(const QJsonArray &messages, bool more);
+    void messagesCleared();
+    void streamStarted();
+    void streamText(const QString &text);
+    void streamEnded(const QString &text, bool replace);
+
+    // To DockSigint
+    void ready();
+    void olderRequested(int offset);
+
+private slots:
+    void flush();
+
+private:
+    QJsonArray m_pending;
+    QTimer     m_flushTimer;
+    bool       m_ready;
+};
+
+#endif // CHAT_BRIDGE_H
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <QJsonObject>
+#include "chat_context.h"
+
+// Stable start of every request, cached with the prompt cache
+static const char *systemPrompt =
+    "You are the assistant of the Aguila SIGINT platform, a software defined "
+    "radio receiver based on Gqrx. Help the operator find, identify and "
+    "analyze signals, and explain receiver settings.";
+
+ChatContext::ChatContext() :
+    m_budget(CHAT_CONTEXT_TOKENS),
+    m_windowStart(0),
+    m_summarized(0),
+    m_summaryUpto(0),
+    m_epoch(0)
+{
+}
+
+void ChatContext::setBudget(int tokens)
+{
+    m_budget = std::max(tokens, 1000);
+}
+
+/** Forget all turns and the summary, for example when switching chats. */
+void ChatContext::clear()
+{
+    m_turns.clear();
+    m_windowStart = 0;
+    m_summarized = 0;
+    m_summaryUpto = 0;
+    m_summary.clear();
+    m_epoch++;
+}
+
+void ChatContext::append(const QString &role, const QString &content)
+{
+    m_turns.append({role, content, estimateTokens(content)});
+}
+
+/**
+ * Build the system prompt and messages for a request.
+ * @param message Text of the new user message.
+ * @param content Content of the new user message, text or content blocks.
+ * @param system System prompt blocks (output).
+ * @param messages Messages array ending with the new message (output).
+ *
+ * If the new message is already the last turn, as it is for messages typed
+ * in the chat, it is not sent twice. The last turn before the new message
+ * is marked as a cache breakpoint, so the next request can read the whole
+ * window from the cache.
+ */
+void ChatContext::build(const QString &message, const QJsonValue &content,
+                        QJsonArray &system, QJsonArray &messages)
+{
+    int end = m_turns.size();
+    if (end > 0 && m_turns[end - 1].role == "user" && m_turns[end - 1].content == message)
+        end--;
+    m_windowStart = std::min(m_windowStart, end);
+
+    const int fixed = estimateTokens(systemPrompt) + estimateTokens(m_summary) +
+                      estimateTokens(message);
+    int total = fixed;
+    for (int i = m_windowStart; i < end; i++)
+        total += m_turns[i].tokens;
+
+    if (total > m_budget)
+    {
+        while (m_windowStart < end && total > m_budget / 2)
+            total -= m_turns[m_windowStart++].tokens;
+    }
+
+    // The messages must start with a user turn
+    int start = m_windowStart;
+    while (start < end && m_turns[start].role != "user")
+        start++;
+
+    system = QJsonArray();
+    if (m_summary.isEmpty())
+    {
+        system.append(cachedText(systemPrompt));
+    }
+    else
+    {
+        system.append(QJsonObject{{"type", "text"}, {"text", systemPrompt}});
+        system.append(cachedText(QString("Summary of the earlier conversation:\n%1").arg(m_summary)));
+    }
+
+    messages = QJsonArray();
+    for (int i = start; i < end; i++)
+    {
+        const Turn &turn = m_turns[i];
+        if (i == end - 1)
+            messages.append(QJsonObject{{"role", turn.role},
+                                        {"content", QJsonArray{cachedText(turn.content)}}});
+        else
+            messages.append(QJsonObject{{"role", turn.role}, {"content", turn.content}});
+    }
+    messages.append(QJsonObject{{"role", "user"}, {"content", content}});
+}
+
+/** True if enough turns have left the window to update the summary. */
+bool ChatContext::summaryNeeded() const
+{
+    return m_summaryUpto == 0 && m_windowStart - m_summarized >= CHAT_CONTEXT_SUMMARY_TURNS;
+}
+
+/**
+ * Messages of a request that folds the turns which left the window into
+ * the summary.
+ * @param epoch Value to pass to setSummary() with the reply (output).
+ */
+QJsonArray ChatContext::summaryRequest(int &epoch)
+{
+    QString text;
+    if (!m_summary.isEmpty())
+        text += QString("Summary so far:\n%1\n\n").arg(m_summary);
+    text += "Conversation:\n";
+    for (int i = m_summarized; i < m_windowStart; i++)
+        text += QString("%1: %2\n").arg(m_turns[i].role == "user" ? "Operator" : "Assistant",
+                                       m_turns[i].content);
+    text += "\nWrite an updated summary of this SDR session in at most 200 words. "
+            "Keep frequencies, modes, signal identifications and open questions.";
+
+    m_summaryUpto = m_windowStart;
+    epoch = m_epoch;
+    return QJsonArray{QJsonObject{{"role", "user"}, {"content", text}}};
+}
+
+/**
+ * Store a summary from summaryRequest().
+ * @param epoch The epoch from summaryRequest().
+ * @param summary The new summary, empty if the request failed.
+ */
+void ChatContext::setSummary(int epoch, const QString &summary)
+{
+    if (epoch != m_epoch)
+        return;
+
+    if (!summary.isEmpty())
+    {
+        m_summary = summary.trimmed();
+        m_summarized = m_summaryUpto;
+    }
+    m_summaryUpto = 0;
+}
+
+int ChatContext::estimateTokens(const QString &text)
+{
+    return text.isEmpty() ? 0 : (text.size() + 3) / 4 + 4;
+}
+
+/* Text block marked as a prompt cache breakpoint */
+QJsonObject ChatContext::cachedText(const QString &text)
+{
+    return QJsonObject{{"type", "text"},
+                       {"text", text},
+                       {"cache_control", QJsonObject{{"type", "ephemeral"}}}};
+}
@@ -0,0 +1,66 @@
+#ifndef CHAT_CONTEXT_H
+#define CHAT_CONTEXT_H
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QString>
+#include <QVector>
+
+/* Default token budget of the context sent with each message */
+#define CHAT_CONTEXT_TOKENS         8000
+
+/* Older turns are summarized once this many have left the window */
+#define CHAT_CONTEXT_SUMMARY_TURNS  6
+
+/**
+ * Conversation context sent to Claude with each message.
+ *
+ * Only a window of recent turns is sent, so the request size stays flat
+ * over a long session. When the window goes over the token budget its
+ * start jumps ahead to half the budget, rather than by one turn per
+ * message, so the start of the request stays the same for many turns and
+ * the prompt cache keeps hitting. Turns that leave the window are
+ * summarized in the background and the summary goes in the system prompt.
+ *
+ * Tokens are estimated as four characters per token.
+ */
+class ChatContext
+{
+public:
+    ChatContext();
+
+    void setBudget(int tokens);
+    int  budget() const { return m_budget; }
+
+    void clear();
+    void append(const QString &role, const QString &content);
+
+    void build(const QString &message, const QJsonValue &content,
+               QJsonArray &system, QJsonArray &messages);
+
+    bool summaryNeeded() const;
+    QJsonArray summaryRequest(int &epoch);
+    void setSummary(int epoch, const QString &summary);
+
+    static int estimateTokens(const QString &text);
+
+private:
+    struct Turn {
+        QString role;
+        QString content;
+        int     tokens;
+    };
+
+    static QJsonObject cachedText(const QString &text);
+
+    QVector<Turn> m_turns;
+    int     m_budget;
+    int     m_windowStart;  // first turn sent
+    int     m_summarized;   // first turn not covered by the summary
+    int     m_summaryUpto;  // end of the turns being summarized, 0 if none
+    int     m_epoch;        // bumped by clear() to drop stale summaries
+    QString m_summary;
+};
+
+#endif // CHAT_CONTEXT_H
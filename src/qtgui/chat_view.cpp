@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <cmath>
+#include <QAbstractTextDocumentLayout>
+#include <QApplication>
+#include <QCache>
+#include <QClipboard>
+#include <QContextMenuEvent>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QMenu>
+#include <QPainter>
+#include <QScrollBar>
+#include <QStyledItemDelegate>
+#include <QTextDocument>
+#include "chat_bridge.h"
+#include "chat_view.h"
+
+// Space around a message and inside its box, in pixels
+static const int chatMargin = 8;
+static const int chatPadding = 12;
+
+ChatModel::ChatModel(QObject *parent) :
+    QAbstractListModel(parent)
+{
+}
+
+int ChatModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_entries.size();
+}
+
+QVariant ChatModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_entries.size())
+        return QVariant();
+
+    const Entry &e = m_entries[index.row()];
+    switch (role) {
+    case Qt::DisplayRole:
+        return e.text;
+    case RoleRole:
+        return e.role;
+    case PlaceholderRole:
+        return e.placeholder;
+    default:
+        return QVariant();
+    }
+}
+
+ChatModel::Entry ChatModel::entry(const QJsonValue &message)
+{
+    const QJsonObject msg = message.toObject();
+    return {msg["role"].toString(), msg["text"].toString(), msg["placeholder"].toBool()};
+}
+
+void ChatModel::append(const QJsonArray &messages)
+{
+    if (messages.isEmpty())
+        return;
+    beginInsertRows(QModelIndex(), m_entries.size(), m_entries.size() + messages.size() - 1);
+    for (const QJsonValue &msg : messages)
+        m_entries.append(entry(msg));
+    endInsertRows();
+}
+
+/** Add older messages at the top, oldest first. */
+void ChatModel::prepend(const QJsonArray &messages)
+{
+    if (messages.isEmpty())
+        return;
+    QVector<Entry> older;
+    older.reserve(messages.size() + m_entries.size());
+    for (const QJsonValue &msg : messages)
+        older.append(entry(msg));
+    beginInsertRows(QModelIndex(), 0, messages.size() - 1);
+    m_entries = older + m_entries;
+    endInsertRows();
+}
+
+void ChatModel::clear()
+{
+    beginResetModel();
+    m_entries.clear();
+    endResetModel();
+}
+
+void ChatModel::setText(int row, const QString &text, bool placeholder)
+{
+    if (row < 0 || row >= m_entries.size())
+        return;
+    m_entries[row].text = text;
+    m_entries[row].placeholder = placeholder;
+    emit dataChanged(index(row), index(row));
+}
+
+void ChatModel::removeFirst(int count)
+{
+    count = std::min(count, (int)m_entries.size());
+    if (count <= 0)
+        return;
+    beginRemoveRows(QModelIndex(), 0, count - 1);
+    m_entries.remove(0, count);
+    endRemoveRows();
+}
+
+int ChatModel::loaded() const
+{
+    int count = 0;
+    for (const Entry &e : m_entries)
+        count += e.placeholder ? 0 : 1;
+    return count;
+}
+
+/*
+ * Draws a message in the colors of the web page, the text as markdown. The
+ * laid out documents are cached by width and text, so scrolling and the
+ * size hints do not parse the markdown again.
+ */
+class ChatDelegate : public QStyledItemDelegate
+{
+public:
+    explicit ChatDelegate(QListView *view) :
+        QStyledItemDelegate(view),
+        m_view(view),
+        m_documents(CHAT_VIEW_CACHED_DOCUMENTS)
+    {
+    }
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option,
+               const QModelIndex &index) const override
+    {
+        const bool user = index.data(ChatModel::RoleRole).toString() == "user";
+        const QRect box = option.rect.adjusted(chatMargin, chatMargin / 2,
+                                               -chatMargin, -chatMargin / 2);
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing);
+        if (user || (option.state & QStyle::State_Selected)) {
+            painter->setPen(QColor(option.state & QStyle::State_Selected ? "#569cd6" : "#3d3d3d"));
+            painter->setBrush(user ? QColor("#2d2d2d") : QColor("#1e1e1e"));
+            painter->drawRoundedRect(box, 8, 8);
+        }
+
+        QFont bold = option.font;
+        bold.setBold(true);
+        const QFontMetrics metrics(bold);
+        const QRect content = box.adjusted(chatPadding, chatPadding, -chatPadding, -chatPadding);
+        painter->setFont(bold);
+        painter->setPen(QColor(user ? "#4ec9b0" : "#569cd6"));
+        painter->drawText(content.left(), content.top() + metrics.ascent(),
+                          user ? QString("User") : QString("Assistant"));
+
+        QTextDocument *doc = document(index.data().toString(), content.width(), option.font);
+        painter->translate(content.left(), content.top() + metrics.height() + chatMargin);
+        QAbstractTextDocumentLayout::PaintContext context;
+        context.palette.setColor(QPalette::Text, QColor("#d4d4d4"));
+        context.clip = QRectF(0, 0, content.width(), doc->size().height());
+        doc->documentLayout()->draw(painter, context);
+        painter->restore();
+    }
+
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override
+    {
+        QFont bold = option.font;
+        bold.setBold(true);
+        const int width = m_view->viewport()->width();
+        const int textWidth = std::max(width - 2 * (chatMargin + chatPadding), 1);
+        const QTextDocument *doc = document(index.data().toString(), textWidth, option.font);
+        return QSize(width, chatMargin + 2 * chatPadding + QFontMetrics(bold).height() +
+                            chatMargin + (int)std::ceil(doc->size().height()));
+    }
+
+private:
+    QTextDocument *document(const QString &text, int width, const QFont &font) const
+    {
+        const QString key = QString("%1|%2").arg(width).arg(text);
+        QTextDocument *doc = m_documents.object(key);
+        if (doc)
+            return doc;
+
+        doc = new QTextDocument();
+        doc->setDefaultFont(font);
+        doc->setDocumentMargin(0);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        doc->setMarkdown(text);
+#else
+        doc->setPlainText(text);
+#endif
+        doc->setTextWidth(width);
+        m_documents.insert(key, doc);
+        return doc;
+    }
+
+    QListView *m_view;
+    mutable QCache<QString, QTextDocument> m_documents;
+};
+
+ChatView::ChatView(ChatBridge *bridge, QWidget *parent) :
+    QListView(parent),
+    m_bridge(bridge),
+    m_model(new ChatModel(this)),
+    m_hasOlder(false),
+    m_loadingOlder(false),
+    m_streamRow(-1)
+{
+    setModel(m_model);
+    setItemDelegate(new ChatDelegate(this));
+    setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    // The messages wrap to the width, so their heights change with it
+    setResizeMode(QListView::Adjust);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    setSelectionMode(QAbstractItemView::SingleSelection);
+    setStyleSheet("QListView { background: #1e1e1e; color: #d4d4d4; border: none; }");
+
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &ChatView::scrolled);
+    connect(bridge, &ChatBridge::messagesAppended, this, &ChatView::appendMessages);
+    connect(bridge, &ChatBridge::messagesPrepended, this, &ChatView::prependMessages);
+    connect(bridge, &ChatBridge::messagesCleared, this, &ChatView::clearMessages);
+    connect(bridge, &ChatBridge::streamStarted, this, &ChatView::beginStream);
+    connect(bridge, &ChatBridge::streamText, this, &ChatView::appendStream);
+    connect(bridge, &ChatBridge::streamEnded, this, &ChatView::endStream);
+}
+
+bool ChatView::nearBottom() const
+{
+    const QScrollBar *bar = verticalScrollBar();
+    return bar->maximum() - bar->value() < CHAT_VIEW_LOAD_MARGIN;
+}
+
+void ChatView::appendMessages(const QJsonArray &messages)
+{
+    const bool follow = nearBottom();
+    m_model->append(messages);
+    if (!follow)
+        return;
+
+    // Drop the oldest messages beyond the limit, they are loaded again on scroll
+    const int extra = m_model->rowCount() - m_bridge->domLimit();
+    if (extra > 0) {
+        m_model->removeFirst(extra);
+        m_hasOlder = true;
+        if (m_streamRow >= 0)
+            m_streamRow = std::max(m_streamRow - extra, -1);
+    }
+    scrollToBottom();
+}
+
+void ChatView::prependMessages(const QJsonArray &messages, bool more)
+{
+    const bool first = m_model->rowCount() == 0;
+    m_model->prepend(messages);
+    m_hasOlder = more;
+    m_loadingOlder = false;
+
+    // Keep the messages in view where they were
+    if (first)
+        scrollToBottom();
+    else if (!messages.isEmpty())
+        scrollTo(m_model->index(messages.size()), QAbstractItemView::PositionAtTop);
+}
+
+void ChatView::clearMessages()
+{
+    m_model->clear();
+    m_streamRow = -1;
+    m_hasOlder = false;
+    m_loadingOlder = false;
+}
+
+void ChatView::beginStream()
+{
+    m_model->append(QJsonArray{QJsonObject{{"role", "assistant"}, {"text", ""},
+                                           {"placeholder", true}}});
+    m_streamRow = m_model->rowCount() - 1;
+    m_streamText.clear();
+    scrollToBottom();
+}
+
+void ChatView::appendStream(const QString &text)
+{
+    if (m_streamRow < 0)
+        beginStream();
+    m_streamText += text;
+    setRowText(m_streamRow, m_streamText, true);
+    scrollToBottom();
+}
+
+/* The complete text replaces the streamed one and is stored in the database */
+void ChatView::endStream(const QString &text, bool replace)
+{
+    if (m_streamRow >= 0 && replace)
+        setRowText(m_streamRow, text, false);
+    m_streamRow = -1;
+    m_streamText.clear();
+    scrollToBottom();
+}
+
+void ChatView::setRowText(int row, const QString &text, bool placeholder)
+{
+    m_model->setText(row, text, placeholder);
+    // The list view keeps the item sizes until told
+    emit itemDelegate()->sizeHintChanged(m_model->index(row));
+}
+
+void ChatView::scrolled(int value)
+{
+    if (m_hasOlder && !m_loadingOlder && value < CHAT_VIEW_LOAD_MARGIN) {
+        m_loadingOlder = true;
+        m_bridge->loadOlder(m_model->loaded());
+    }
+}
+
+void ChatView::copyCurrent()
+{
+    const QModelIndex index = currentIndex();
+    if (index.isValid())
+        QApplication::clipboard()->setText(index.data().toString());
+}
+
+void ChatView::keyPressEvent(QKeyEvent *event)
+{
+    if (event->matches(QKeySequence::Copy)) {
+        copyCurrent();
+        return;
+    }
+    QListView::keyPressEvent(event);
+}
+
+void ChatView::contextMenuEvent(QContextMenuEvent *event)
+{
+    const QModelIndex index = indexAt(event->pos());
+    if (!index.isValid())
+        return;
+    setCurrentIndex(index);
+
+    QMenu menu(this);
+    menu.addAction(tr("Copy"), this, &ChatView::copyCurrent);
+    menu.exec(event->globalPos());
+}
@@ -0,0 +1,99 @@
+#ifndef CHAT_VIEW_H
+#define CHAT_VIEW_H
+
+#include <QAbstractListModel>
+#include <QJsonArray>
+#include <QListView>
+#include <QString>
+#include <QVector>
+
+class ChatBridge;
+
+/* Rendered messages kept by the delegate of a ChatView */
+#define CHAT_VIEW_CACHED_DOCUMENTS 256
+
+/* Distance from the top in pixels that loads older messages */
+#define CHAT_VIEW_LOAD_MARGIN      50
+
+/**
+ * Messages of a ChatView, oldest first.
+ */
+class ChatModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        RoleRole = Qt::UserRole,    // "user" or "assistant"
+        PlaceholderRole
+    };
+
+    explicit ChatModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void append(const QJsonArray &messages);
+    void prepend(const QJsonArray &messages);
+    void clear();
+    void setText(int row, const QString &text, bool placeholder);
+    void removeFirst(int count);
+
+    // Messages that are in the database, for the paging
+    int loaded() const;
+
+private:
+    struct Entry {
+        QString role;
+        QString text;
+        bool    placeholder;
+    };
+
+    static Entry entry(const QJsonValue &message);
+
+    QVector<Entry> m_entries;
+};
+
+/**
+ * Chat view without QWebEngineView.
+ *
+ * Shows the messages of a ChatBridge as the web page does, with the same
+ * paging and streaming, in a list view whose delegate renders each message
+ * as markdown in a QTextDocument. There is no Chromium process, so it
+ * starts at once and takes a small part of the memory. A message is copied
+ * with Ctrl+C or from the context menu.
+ */
+class ChatView : public QListView
+{
+    Q_OBJECT
+
+public:
+    explicit ChatView(ChatBridge *bridge, QWidget *parent = nullptr);
+
+protected:
+    void keyPressEvent(QKeyEvent *event) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
+
+private slots:
+    void appendMessages(const QJsonArray &messages);
+    void prependMessages(const QJsonArray &messages, bool more);
+    void clearMessages();
+    void beginStream();
+    void appendStream(const QString &text);
+    void endStream(const QString &text, bool replace);
+    void scrolled(int value);
+
+private:
+    bool nearBottom() const;
+    void setRowText(int row, const QString &text, bool placeholder);
+    void copyCurrent();
+
+    ChatBridge *m_bridge;
+    ChatModel  *m_model;
+    bool        m_hasOlder;     // older messages in the database
+    bool        m_loadingOlder;
+    int         m_streamRow;    // row of the streamed reply, -1 without one
+    QString     m_streamText;
+};
+
+#endif // CHAT_VIEW_H
@@ -0,0 +1,94 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef COLORMAP_H
+#define COLORMAP_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <QColor>
+#include <QString>
+
+/* Number of entries in the level to color lookup table */
+#define COLORMAP_LUT_SIZE      4096
+
+/* Fixed point dB levels have this many fractional bits (1/256 dB) */
+#define COLORMAP_DB_FRAC_BITS  8
+
+/**
+ * Waterfall colormap shared by the plotter and the sigint displays.
+ *
+ * Besides the 256 colors of the map, a COLORMAP_LUT_SIZE entry table maps
+ * fixed point dB levels within the current range straight to an ARGB value
+ * and to the colormap index, so coloring a pixel is one multiply, one shift
+ * and one load.
+ */
+class CColormap
+{
+public:
+    CColormap();
+
+    bool setMap(const QString &cmap);
+    const QString &name() const { return m_name; }
+
+    void setRange(float mindB, float maxdB);
+    float minDb() const { return m_mindB; }
+    float maxDb() const { return m_maxdB; }
+
+    /* The 256 colors of the map */
+    const QRgb *table() const { return m_table; }
+    QColor color(int i) const { return QColor::fromRgb(m_table[i]); }
+
+    static int32_t toFixed(float dB)
+    {
+        return (int32_t)lrintf(dB * (float)(1 << COLORMAP_DB_FRAC_BITS));
+    }
+
+    int lutEntry(int32_t dBfx) const
+    {
+        const int64_t k = ((int64_t)(dBfx - m_minFx) * m_lutScale) >> 16;
+        return (int)std::min<int64_t>(std::max<int64_t>(k, 0), COLORMAP_LUT_SIZE - 1);
+    }
+
+    /* ARGB color and colormap index of a fixed point level */
+    QRgb    rgbFx(int32_t dBfx) const { return m_lut[lutEntry(dBfx)]; }
+    uint8_t indexFx(int32_t dBfx) const { return m_lutIndex[lutEntry(dBfx)]; }
+
+    /* ARGB color and colormap index of a level in dB */
+    QRgb    rgb(float dB) const { return rgbFx(toFixed(dB)); }
+    uint8_t index(float dB) const { return indexFx(toFixed(dB)); }
+
+private:
+    void buildLut();
+
+    QString  m_name;
+    QRgb     m_table[256];
+    QRgb     m_lut[COLORMAP_LUT_SIZE];
+    uint8_t  m_lutIndex[COLORMAP_LUT_SIZE];
+    int32_t  m_minFx;       // fixed point level of LUT entry 0
+    int64_t  m_lutScale;    // LUT entries per fixed point step, 16 fractional bits
+    float    m_mindB;
+    float    m_maxdB;
+};
+
+#endif // COLORMAP_H
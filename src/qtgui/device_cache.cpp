@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <map>
+#include <QDebug>
+#include <QHash>
+#include <QSettings>
+#include <QVariant>
+#include "device_cache.h"
+#include "ioconfig.h"
+
+void DeviceProber::probe()
+{
+    std::map<QString, QVariant> devList;
+    CIoConfig::getDeviceList(devList);
+
+    QStringList labels;
+    QStringList devstrs;
+    for (const auto &dev : devList) {
+        labels.append(dev.first);
+        devstrs.append(dev.second.toString());
+    }
+    emit probed(labels, devstrs);
+}
+
+DeviceCache::DeviceCache(const QString &path, QObject *parent)
+    : QObject(parent)
+    , m_path(path)
+    , m_busy(false)
+{
+    load();
+
+    m_prober = new DeviceProber();
+    m_prober->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_prober, &QObject::deleteLater);
+    connect(this, &DeviceCache::probeRequested, m_prober, &DeviceProber::probe);
+    connect(m_prober, &DeviceProber::probed, this, &DeviceCache::probed);
+    m_thread.start();
+}
+
+/** Waits for a running scan, as the drivers cannot be interrupted. */
+DeviceCache::~DeviceCache()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void DeviceCache::refresh(bool force)
+{
+    if (m_busy)
+        return;
+    if (!force && m_scanned.isValid() &&
+        m_scanned.secsTo(QDateTime::currentDateTime()) < DEVICE_CACHE_FRESH_S)
+        return;
+
+    m_busy = true;
+    emit scanStarted();
+    emit probeRequested();
+}
+
+void DeviceCache::probed(const QStringList &labels, const QStringList &devstrs)
+{
+    m_busy = false;
+    m_scanned = QDateTime::currentDateTime();
+
+    QHash<QString, int> index;
+    for (int i = 0; i < m_devices.size(); i++)
+        index.insert(m_devices[i].devstr, i);
+    for (int i = 0; i < labels.size(); i++) {
+        auto it = index.constFind(devstrs[i]);
+        if (it == index.constEnd()) {
+            index.insert(devstrs[i], m_devices.size());
+            m_devices.append({labels[i], devstrs[i], m_scanned});
+        } else {
+            m_devices[*it].label = labels[i];
+            m_devices[*it].seen = m_scanned;
+        }
+    }
+
+    const QDateTime oldest = m_scanned.addDays(-DEVICE_CACHE_MAX_AGE_DAYS);
+    m_devices.erase(std::remove_if(m_devices.begin(), m_devices.end(),
+                                   [&oldest](const Device &dev) { return dev.seen < oldest; }),
+                    m_devices.end());
+    std::sort(m_devices.begin(), m_devices.end(), [](const Device &a, const Device &b) {
+        return a.label < b.label;
+    });
+
+    qDebug() << "Device scan found" << labels.size() << "devices," << m_devices.size() << "cached";
+    save();
+    emit updated();
+}
+
+void DeviceCache::load()
+{
+    QSettings settings(m_path, QSettings::IniFormat);
+    m_scanned = settings.value("scanned").toDateTime();
+    const int size = settings.beginReadArray("devices");
+    for (int i = 0; i < size; i++) {
+        settings.setArrayIndex(i);
+        Device dev;
+        dev.label = settings.value("label").toString();
+        dev.devstr = settings.value("devstr").toString();
+        dev.seen = settings.value("seen").toDateTime();
+        if (!dev.devstr.isEmpty())
+            m_devices.append(dev);
+    }
+    settings.endArray();
+}
+
+void DeviceCache::save() const
+{
+    QSettings settings(m_path, QSettings::IniFormat);
+    settings.clear();
+    settings.setValue("scanned", m_scanned);
+    settings.beginWriteArray("devices", m_devices.size());
+    for (int i = 0; i < m_devices.size(); i++) {
+        settings.setArrayIndex(i);
+        settings.setValue("label", m_devices[i].label);
+        settings.setValue("devstr", m_devices[i].devstr);
+        settings.setValue("seen", m_devices[i].seen);
+    }
+    settings.endArray();
+}
@@ -0,0 +1,87 @@
+#ifndef DEVICE_CACHE_H
+#define DEVICE_CACHE_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+
+// Age of the last scan below which opening the I/O configurator does not scan again
+#define DEVICE_CACHE_FRESH_S 60
+
+// Devices no scan has found for this long are dropped from the cache
+#define DEVICE_CACHE_MAX_AGE_DAYS 30
+
+/*
+ * Runs the gr-osmosdr device discovery in the thread of a DeviceCache.
+ */
+class DeviceProber : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void probe();
+
+signals:
+    void probed(const QStringList &labels, const QStringList &devstrs);
+};
+
+/*
+ * The input devices for the I/O configurator, kept in a file between runs.
+ *
+ * Discovery opens every device and, with SoapySDR remote or networked USRPs,
+ * waits for the network, so it can take seconds. The cached devices are
+ * shown at once and refresh() scans in a thread of its own. A scan updates
+ * the time each device it finds was seen; the ones it does not find stay
+ * listed, as they may only be unplugged, until DEVICE_CACHE_MAX_AGE_DAYS.
+ * The devices are sorted by label.
+ */
+class DeviceCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Device
+    {
+        QString   label;
+        QString   devstr;
+        QDateTime seen;     // by the last scan that found it
+    };
+
+    DeviceCache(const QString &path, QObject *parent = nullptr);
+    ~DeviceCache();
+
+    const QVector<Device> &devices() const { return m_devices; }
+
+    // End of the last scan, invalid if there has been none
+    QDateTime scanned() const { return m_scanned; }
+    bool isScanning() const { return m_busy; }
+
+    // Scan unless a scan is running, or if force is false, the last one is recent
+    void refresh(bool force = true);
+
+signals:
+    void scanStarted();
+    void updated();
+
+    void probeRequested();
+
+private slots:
+    void probed(const QStringList &labels, const QStringList &devstrs);
+
+private:
+    void load();
+    void save() const;
+
+    QString             m_path;
+    QVector<Device>     m_devices;
+    QDateTime           m_scanned;
+    bool                m_busy;         // a scan is in the thread
+
+    QThread             m_thread;
+    DeviceProber       *m_prober;
+};
+
+#endif // DEVICE_CACHE_H
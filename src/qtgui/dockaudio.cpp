@@ -131,6 +131,18 @@ void DockAudio::setAudioMuted(bool muted)
 }
 
 
+/*! \brief Show the state of the audio output in the tooltip of the settings button.
+ *  \param latency_ms Latency from the receiver to the speaker.
+ *  \param underruns Times the output ran empty.
+ *  \param dropped Samples dropped because the receiver ran ahead of the output.
+ */
+void DockAudio::setOutputStats(float latency_ms, quint64 underruns, quint64 dropped)
+{
+    ui->audioConfButton->setToolTip(tr("Audio settings\n"
+                                       "Output latency %1 ms, %2 underruns, %3 samples dropped")
+                                    .arg(latency_ms, 0, 'f', 0).arg(underruns).arg(dropped));
+}
+
 /*! \brief Get current audio gain.
  *  \returns The current audio gain in tens of dB (0 dB = 10).
  */
@@ -60,10 +60,14 @@ public:
 
     void setAudioRecButtonState(bool checked);
     void setAudioPlayButtonState(bool checked);
+    void setOutputStats(float latency_ms, quint64 underruns, quint64 dropped);
 
     void setFftColor(QColor color);
     void setFftFill(bool enabled);
 
+    /*! \brief Location for audio recordings. */
+    QString recDir() const { return rec_dir; }
+
     void saveSettings(QSettings *settings);
     void readSettings(QSettings *settings);
 
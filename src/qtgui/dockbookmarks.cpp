@@ -69,6 +69,12 @@ DockBookmarks::DockBookmarks(QWidget *parent) :
         actionAddBookmark = new QAction("Add Bookmark", this);
         contextmenu->addAction(actionAddBookmark);
     }
+    // MenuItem Scan
+    {
+        actionScanBookmarks = new QAction("Scan Bookmarks", this);
+        actionScanBookmarks->setCheckable(true);
+        contextmenu->addAction(actionScanBookmarks);
+    }
     ui->tableViewFrequencyList->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(ui->tableViewFrequencyList, SIGNAL(customContextMenuRequested(const QPoint&)),
         this, SLOT(ShowContextMenu(const QPoint&)));
@@ -91,7 +97,8 @@ DockBookmarks::DockBookmarks(QWidget *parent) :
             this, SLOT(onDataChanged(const QModelIndex &, const QModelIndex &)));
     connect(&Bookmarks::Get(), SIGNAL(TagListChanged()),
             ui->tableWidgetTagList, SLOT(updateTags()));
-    connect(&Bookmarks::Get(), SIGNAL(BookmarksChanged()),
+    // The rows follow the single edits themselves, but the tags filter them
+    connect(&Bookmarks::Get(), SIGNAL(TagListChanged()),
             bookmarksTableModel, SLOT(update()));
 }
 
@@ -103,23 +110,18 @@ DockBookmarks::~DockBookmarks()
 
 void DockBookmarks::activated(const QModelIndex & index)
 {
-    BookmarkInfo *info = bookmarksTableModel->getBookmarkAtRow(index.row());
+    const BookmarkInfo *info = bookmarksTableModel->getBookmarkAtRow(index.row());
     emit newBookmarkActivated(info->frequency, info->modulation, info->bandwidth);
 }
 
 void DockBookmarks::setNewFrequency(qint64 rx_freq)
 {
     ui->tableViewFrequencyList->clearSelection();
-    const int iRowCount = bookmarksTableModel->rowCount();
-    for (int row = 0; row < iRowCount; ++row)
+    const int row = bookmarksTableModel->findRow(rx_freq);
+    if (row != -1)
     {
-        BookmarkInfo& info = *(bookmarksTableModel->getBookmarkAtRow(row));
-        if (std::abs(rx_freq - info.frequency) <= ((info.bandwidth / 2 ) + 1))
-        {
-            ui->tableViewFrequencyList->selectRow(row);
-            ui->tableViewFrequencyList->scrollTo(ui->tableViewFrequencyList->currentIndex(), QAbstractItemView::EnsureVisible );
-            break;
-        }
+        ui->tableViewFrequencyList->selectRow(row);
+        ui->tableViewFrequencyList->scrollTo(ui->tableViewFrequencyList->currentIndex(), QAbstractItemView::EnsureVisible );
     }
     m_currentFrequency = rx_freq;
 }
@@ -140,7 +142,6 @@ void DockBookmarks::updateBookmarks()
 void DockBookmarks::onDataChanged(const QModelIndex&, const QModelIndex &)
 {
     updateTags();
-    Bookmarks::Get().save();
 }
 
 void DockBookmarks::on_tableWidgetTagList_itemChanged(QTableWidgetItem *item)
@@ -190,7 +191,6 @@ bool DockBookmarks::DeleteSelectedBookmark()
     {
         int iIndex = bookmarksTableModel->GetBookmarksIndexForRow(selected.first().row());
         Bookmarks::Get().remove(iIndex);
-        bookmarksTableModel->update();
     }
     return true;
 }
@@ -244,7 +244,7 @@ void DockBookmarks::changeBookmarkTags(int row, int /*column*/)
     QStringList tags;
 
     int iIdx = bookmarksTableModel->GetBookmarksIndexForRow(row);
-    BookmarkInfo& bmi = Bookmarks::Get().getBookmark(iIdx);
+    BookmarkInfo bmi = Bookmarks::Get().getBookmark(iIdx);
 
     // Create and show the Dialog for a new Bookmark.
     // Write the result into variable 'tags'.
@@ -281,7 +281,7 @@ void DockBookmarks::changeBookmarkTags(int row, int /*column*/)
             {
                 bmi.tags.append(Bookmarks::Get().findOrAddTag(tags[i]));
             }
-            Bookmarks::Get().save();
+            Bookmarks::Get().update(iIdx, bmi);
         }
     }
 }
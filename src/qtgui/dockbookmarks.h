@@ -61,6 +61,7 @@ public:
     // ui->tableViewFrequencyList
     // ui->tableWidgetTagList
     QAction* actionAddBookmark;
+    QAction* actionScanBookmarks;
 
     void updateTags();
     void updateBookmarks();
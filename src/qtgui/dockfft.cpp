@@ -39,13 +39,37 @@
 #define DEFAULT_WATERFALL_SPAN  0       // Auto
 #define DEFAULT_FFT_SPLIT       35
 #define DEFAULT_FFT_AVG         25
+#define DEFAULT_FFT_THREADS     1
 #define DEFAULT_COLORMAP        "gqrx"
+#define DEFAULT_WF_RESOLUTION   100     // percent
+
+/* Automatic dB ranges, relative to the noise floor and peak level of the plotter */
+#define AUTO_RANGE_PLOT_BELOW   10      // dB of plot below the noise floor
+#define AUTO_RANGE_PLOT_ABOVE   10      // dB of plot above the peak level
+#define AUTO_RANGE_PLOT_SPAN    30      // smallest plot range in dB
+#define AUTO_RANGE_WF_BELOW     5       // dB of waterfall below the noise floor
+#define AUTO_RANGE_WF_SPAN      20      // smallest waterfall range in dB
+#define AUTO_RANGE_HYSTERESIS   2       // dB change before the ranges move
+#define AUTO_RANGE_JUMP         20      // dB change that resets the smoothing
+#define AUTO_RANGE_ALPHA        0.3f    // smoothing of the levels
 
 static const QStringList window_strs = {
     "hamming", "hann", "blackman", "rectangular", "kaiser",
     "blackmanharris", "bartlett", "flattop"
 };
 
+/* Overlap of streamed FFT frames; index 0 disables streaming */
+static const float stream_overlap_table[] = { 0.0f, 0.0f, 0.5f, 0.75f, 0.875f };
+static const QStringList stream_strs = { "off", "0", "50", "75", "87.5" };
+
+/* Spectral estimators: type (see rx_fft_c::estimator) and segments or taps */
+static const int estimator_table[][2] = {
+    { 0, 1 }, { 1, 4 }, { 1, 8 }, { 1, 16 }, { 2, 4 }, { 2, 8 }
+};
+static const QStringList estimator_strs = {
+    "periodogram", "welch4", "welch8", "welch16", "pfb4", "pfb8"
+};
+
 static const quint64 wf_span_table[] =
 {
     0,              // Auto
@@ -74,6 +98,9 @@ DockFft::DockFft(QWidget *parent) :
     m_sample_rate = 0.f;
     m_pand_last_modified = false;
     m_actual_frame_rate = 0.f;
+    m_auto_range_valid = false;
+    m_auto_noise = 0.f;
+    m_auto_peak = 0.f;
     m_frame_dropping = false;
 
     // Add predefined gqrx colors to chooser.
@@ -92,10 +119,22 @@ DockFft::DockFft(QWidget *parent) :
     ui->cmapComboBox->addItem(tr("Wht Hot"), "whitehot");
     ui->cmapComboBox->addItem(tr("Blk Hot"), "blackhot");
 
+    ui->wfResComboBox->addItem(tr("Full"), 100);
+    ui->wfResComboBox->addItem(tr("3/4"), 75);
+    ui->wfResComboBox->addItem(tr("1/2"), 50);
+    ui->wfResComboBox->addItem(tr("1/4"), 25);
+
     QFont font;
     QFontMetrics metrics(font);
     QRectF zoomRect = metrics.boundingRect("888888x");
     ui->zoomLevelLabel->setFixedWidth(zoomRect.width());
+
+#ifndef WITH_OPENGL_WATERFALL
+    ui->wfGpuCheckBox->hide();
+#endif
+#ifndef WITH_OPENCL_FFT
+    ui->fftGpuCheckBox->hide();
+#endif
 }
 DockFft::~DockFft()
 {
@@ -215,6 +254,21 @@ int DockFft::fftSize()
     return fft_size;
 }
 
+/** Get all FFT sizes offered in the FFT size combo box. */
+QList<int> DockFft::fftSizes() const
+{
+    QList<int> sizes;
+
+    for (int i = 0; i < ui->fftSizeComboBox->count(); i++)
+    {
+        int size = ui->fftSizeComboBox->itemText(i).toInt();
+        if (size > 0)
+            sizes.append(size);
+    }
+
+    return sizes;
+}
+
 quint64 DockFft::wfSpan()
 {
     return wf_span_table[ui->wfSpanComboBox->currentIndex()];
@@ -249,6 +303,34 @@ void DockFft::saveSettings(QSettings *settings)
     strval = window_strs[intval];
     settings->setValue("fft_window", strval);
 
+    intval = ui->fftStreamComboBox->currentIndex();
+    if (intval > 0 && intval < stream_strs.size())
+        settings->setValue("stream_overlap", stream_strs[intval]);
+    else
+        settings->remove("stream_overlap");
+
+    if (ui->fftStreamReduceBox->currentIndex() == 1)
+        settings->setValue("stream_reduce", "max");
+    else
+        settings->remove("stream_reduce");
+
+    intval = ui->fftEstimatorComboBox->currentIndex();
+    if (intval > 0 && intval < estimator_strs.size())
+        settings->setValue("estimator", estimator_strs[intval]);
+    else
+        settings->remove("estimator");
+
+    intval = ui->fftThreadsSpinBox->value();
+    if (intval != DEFAULT_FFT_THREADS)
+        settings->setValue("fft_threads", intval);
+    else
+        settings->remove("fft_threads");
+
+    if (ui->fftGpuCheckBox->isChecked())
+        settings->setValue("gpu_fft", true);
+    else
+        settings->remove("gpu_fft");
+
     intval = wfSpan();
     if (intval != DEFAULT_WATERFALL_SPAN)
         settings->setValue("waterfall_span", intval);
@@ -260,6 +342,11 @@ void DockFft::saveSettings(QSettings *settings)
     else
         settings->remove("averaging");
 
+    if (ui->fftLogAvgCheckBox->isChecked())
+        settings->setValue("log_averaging", true);
+    else
+        settings->remove("log_averaging");
+
     intval = ui->plotScaleBox->currentIndex();
     if      (intval == 1) strval = "dbv";
     else if (intval == 2) strval = "dbm";
@@ -331,6 +418,11 @@ void DockFft::saveSettings(QSettings *settings)
     else
         settings->remove("db_ranges_locked");
 
+    if (ui->autoRangeCheckBox->isChecked())
+        settings->setValue("auto_range", true);
+    else
+        settings->remove("auto_range");
+
     // Band Plan
     if (ui->bandPlanCheckBox->isChecked())
         settings->setValue("bandplan", true);
@@ -343,6 +435,18 @@ void DockFft::saveSettings(QSettings *settings)
     else
         settings->remove("markers");
 
+    // Zoom FFT
+    if (ui->zoomFftCheckBox->isChecked())
+        settings->setValue("zoom_fft", true);
+    else
+        settings->remove("zoom_fft");
+
+    // OpenGL waterfall
+    if (ui->wfGpuCheckBox->isChecked())
+        settings->setValue("gpu_waterfall", true);
+    else
+        settings->remove("gpu_waterfall");
+
     // Peak
     if (ui->peakDetectCheckBox->isChecked())
         settings->setValue("peak_detect", true);
@@ -364,6 +468,12 @@ void DockFft::saveSettings(QSettings *settings)
     else
         settings->remove("waterfall_colormap");
 
+    intval = ui->wfResComboBox->currentData().toInt();
+    if (intval != DEFAULT_WF_RESOLUTION)
+        settings->setValue("waterfall_resolution", intval);
+    else
+        settings->remove("waterfall_resolution");
+
     // FFT Zoom
     if (ui->fftZoomSlider->value() != DEFAULT_FFT_ZOOM)
         settings->setValue("fft_zoom", ui->fftZoomSlider->value());
@@ -415,6 +525,27 @@ void DockFft::readSettings(QSettings *settings)
     if (conv_ok)
         ui->fftWinComboBox->setCurrentIndex(intval);
 
+    strval = settings->value("stream_reduce", "avg").toString();
+    ui->fftStreamReduceBox->setCurrentIndex(strval == "max" ? 1 : 0);
+    intval = stream_strs.indexOf(settings->value("stream_overlap", "off").toString());
+    ui->fftStreamComboBox->setCurrentIndex(std::max(0, intval));
+    emitStreamingChanged();
+
+    intval = estimator_strs.indexOf(settings->value("estimator", "periodogram").toString());
+    ui->fftEstimatorComboBox->setCurrentIndex(std::max(0, intval));
+    on_fftEstimatorComboBox_currentIndexChanged(ui->fftEstimatorComboBox->currentIndex());
+
+    intval = settings->value("fft_threads", DEFAULT_FFT_THREADS).toInt(&conv_ok);
+    if (conv_ok)
+        ui->fftThreadsSpinBox->setValue(intval);
+    emit fftThreadsChanged(ui->fftThreadsSpinBox->value());
+
+#ifdef WITH_OPENCL_FFT
+    bool_val = settings->value("gpu_fft", false).toBool();
+    ui->fftGpuCheckBox->setChecked(bool_val);
+    emit fftGpuChanged(bool_val);
+#endif
+
     intval = settings->value("waterfall_span", DEFAULT_WATERFALL_SPAN).toInt(&conv_ok);
     if (conv_ok) {
         if (configversion >= 4) {
@@ -429,6 +560,9 @@ void DockFft::readSettings(QSettings *settings)
     if (conv_ok)
         ui->fftAvgSlider->setValue(intval);
 
+    bool_val = settings->value("log_averaging", false).toBool();
+    ui->fftLogAvgCheckBox->setChecked(bool_val);
+
     // Plot scale and denominator
     strval = settings->value("plot_y_unit", "dbfs").toString();
     if      (strval == "dbv") intval = 1;
@@ -487,6 +621,10 @@ void DockFft::readSettings(QSettings *settings)
     bool_val = settings->value("db_ranges_locked", false).toBool();
     ui->lockCheckBox->setChecked(bool_val);
 
+    bool_val = settings->value("auto_range", false).toBool();
+    ui->autoRangeCheckBox->setChecked(bool_val);
+    emit autoRangeChanged(bool_val);
+
     bool_val = settings->value("bandplan", false).toBool();
     ui->bandPlanCheckBox->setChecked(bool_val);
     emit bandPlanChanged(bool_val);
@@ -495,6 +633,16 @@ void DockFft::readSettings(QSettings *settings)
     ui->markersCheckBox->setChecked(bool_val);
     emit markersChanged(bool_val);
 
+    bool_val = settings->value("zoom_fft", false).toBool();
+    ui->zoomFftCheckBox->setChecked(bool_val);
+    emit zoomFftChanged(bool_val);
+
+#ifdef WITH_OPENGL_WATERFALL
+    bool_val = settings->value("gpu_waterfall", false).toBool();
+    ui->wfGpuCheckBox->setChecked(bool_val);
+    emit gpuWaterfallChanged(bool_val);
+#endif
+
     bool_val = settings->value("peak_detect", false).toBool();
     ui->peakDetectCheckBox->setChecked(bool_val);
     emit peakDetectToggled(bool_val);
@@ -510,6 +658,10 @@ void DockFft::readSettings(QSettings *settings)
     QString cmap = settings->value("waterfall_colormap", "gqrx").toString();
     ui->cmapComboBox->setCurrentIndex(ui->cmapComboBox->findData(cmap));
 
+    intval = settings->value("waterfall_resolution", DEFAULT_WF_RESOLUTION).toInt(&conv_ok);
+    if (conv_ok && ui->wfResComboBox->findData(intval) >= 0)
+        ui->wfResComboBox->setCurrentIndex(ui->wfResComboBox->findData(intval));
+
     // FFT Zoom
     intval = settings->value("fft_zoom", DEFAULT_FFT_ZOOM).toInt(&conv_ok);
     if (conv_ok)
@@ -538,6 +690,54 @@ void DockFft::setWaterfallRange(float min, float max)
     ui->wfRangeSlider->blockSignals(false);
 }
 
+/**
+ * Follow the levels of the plotter with the dB ranges.
+ * @param noiseFloor Noise floor of the spectrum in dB.
+ * @param peakLevel Level of the strongest signals in dB.
+ *
+ * The levels are smoothed and the ranges only move when they change by
+ * AUTO_RANGE_HYSTERESIS dB, so the display does not breathe with the
+ * noise. The sliders are moved like by the user, so the plotter and the
+ * lock follow through the usual signals.
+ */
+void DockFft::setLevelStats(float noiseFloor, float peakLevel)
+{
+    if (!ui->autoRangeCheckBox->isChecked())
+        return;
+
+    if (!m_auto_range_valid ||
+        fabsf(noiseFloor - m_auto_noise) > AUTO_RANGE_JUMP ||
+        fabsf(peakLevel - m_auto_peak) > AUTO_RANGE_JUMP)
+    {
+        m_auto_noise = noiseFloor;
+        m_auto_peak = peakLevel;
+        m_auto_range_valid = true;
+    }
+    else
+    {
+        m_auto_noise += AUTO_RANGE_ALPHA * (noiseFloor - m_auto_noise);
+        m_auto_peak += AUTO_RANGE_ALPHA * (peakLevel - m_auto_peak);
+    }
+
+    const int lo = ui->plotRangeSlider->minimum();
+    const int hi = ui->plotRangeSlider->maximum();
+
+    int plotMin = qBound(lo, (int)floorf(m_auto_noise) - AUTO_RANGE_PLOT_BELOW, hi - AUTO_RANGE_PLOT_SPAN);
+    int plotMax = qBound(plotMin + AUTO_RANGE_PLOT_SPAN, (int)ceilf(m_auto_peak) + AUTO_RANGE_PLOT_ABOVE, hi);
+    int wfMin = qBound(lo, (int)floorf(m_auto_noise) - AUTO_RANGE_WF_BELOW, hi - AUTO_RANGE_WF_SPAN);
+    int wfMax = qBound(wfMin + AUTO_RANGE_WF_SPAN, (int)ceilf(m_auto_peak), hi);
+
+    if (abs(plotMin - ui->plotRangeSlider->minimumValue()) >= AUTO_RANGE_HYSTERESIS ||
+        abs(plotMax - ui->plotRangeSlider->maximumValue()) >= AUTO_RANGE_HYSTERESIS)
+        ui->plotRangeSlider->setValues(plotMin, plotMax);
+
+    // With the lock on the waterfall already follows the plot
+    if (!ui->lockCheckBox->isChecked() &&
+        (abs(wfMin - ui->wfRangeSlider->minimumValue()) >= AUTO_RANGE_HYSTERESIS ||
+         abs(wfMax - ui->wfRangeSlider->maximumValue()) >= AUTO_RANGE_HYSTERESIS))
+        ui->wfRangeSlider->setValues(wfMin, wfMax);
+}
+
 void DockFft::setZoomLevel(float level)
 {
     ui->fftZoomSlider->blockSignals(true);
@@ -587,6 +787,53 @@ void DockFft::on_fftWinComboBox_currentIndexChanged(int index)
     emit fftWindowChanged(index);
 }
 
+/** Streaming FFT overlap changed. */
+void DockFft::on_fftStreamComboBox_currentIndexChanged(int index)
+{
+    ui->fftStreamReduceBox->setEnabled(index > 0);
+    emitStreamingChanged();
+    updateInfoLabels();
+}
+
+/** Streaming FFT frame reduction changed. */
+void DockFft::on_fftStreamReduceBox_currentIndexChanged(int index)
+{
+    Q_UNUSED(index);
+    emitStreamingChanged();
+}
+
+/** Spectral estimator changed. */
+void DockFft::on_fftEstimatorComboBox_currentIndexChanged(int index)
+{
+    if (index < 0 || index >= (int)(sizeof(estimator_table) / sizeof(estimator_table[0])))
+        index = 0;
+
+    emit fftEstimatorChanged(estimator_table[index][0], estimator_table[index][1]);
+}
+
+/** Number of FFT threads changed. */
+void DockFft::on_fftThreadsSpinBox_valueChanged(int value)
+{
+    emit fftThreadsChanged(value);
+}
+
+/** Streamed FFT on the GPU toggled. */
+void DockFft::on_fftGpuCheckBox_stateChanged(int state)
+{
+    emit fftGpuChanged(state == Qt::Checked);
+}
+
+void DockFft::emitStreamingChanged(void)
+{
+    int idx = ui->fftStreamComboBox->currentIndex();
+
+    if (idx < 0 || idx >= (int)(sizeof(stream_overlap_table) / sizeof(stream_overlap_table[0])))
+        idx = 0;
+
+    emit fftStreamingChanged(idx > 0, stream_overlap_table[idx],
+                             ui->fftStreamReduceBox->currentIndex());
+}
+
 /** Waterfall time span changed. */
 void DockFft::on_wfSpanComboBox_currentIndexChanged(int index)
 {
@@ -626,6 +873,12 @@ void DockFft::on_fftAvgSlider_valueChanged(int value)
     emit fftAvgChanged(avg);
 }
 
+/** Averaging on dB values toggled. */
+void DockFft::on_fftLogAvgCheckBox_stateChanged(int state)
+{
+    emit fftLogAvgChanged(state == Qt::Checked);
+}
+
 /** FFT zoom level changed */
 void DockFft::on_fftZoomSlider_valueChanged(int level)
 {
@@ -736,6 +989,23 @@ void DockFft::on_markersCheckBox_stateChanged(int state)
     emit markersChanged(state == Qt::Checked);
 }
 
+void DockFft::on_zoomFftCheckBox_stateChanged(int state)
+{
+    emit zoomFftChanged(state == Qt::Checked);
+}
+
+void DockFft::on_wfGpuCheckBox_stateChanged(int state)
+{
+    emit gpuWaterfallChanged(state == Qt::Checked);
+}
+
+/** automatic dB ranges toggled */
+void DockFft::on_autoRangeCheckBox_stateChanged(int state)
+{
+    m_auto_range_valid = false;
+    emit autoRangeChanged(state == Qt::Checked);
+}
+
 /** lock button toggled */
 void DockFft::on_lockCheckBox_stateChanged(int state)
 {
@@ -762,6 +1032,12 @@ void DockFft::on_cmapComboBox_currentIndexChanged(int index)
     emit wfColormapChanged(ui->cmapComboBox->currentData().toString());
 }
 
+void DockFft::on_wfResComboBox_currentIndexChanged(int index)
+{
+    Q_UNUSED(index);
+    emit wfResolutionChanged(ui->wfResComboBox->currentData().toInt());
+}
+
 /** Update RBW and FFT overlab labels */
 void DockFft::updateInfoLabels(void)
 {
@@ -786,7 +1062,9 @@ void DockFft::updateInfoLabels(void)
         ui->fftRbwLabel->setText(QString("RBW: %1 MHz").arg(1.e-6 * (double)rbw, 0, 'f', 1));
 
     rate = fftRate();
-    if (rate == 0)
+    if (ui->fftStreamComboBox->currentIndex() > 0)
+        ovr = 100 * stream_overlap_table[ui->fftStreamComboBox->currentIndex()];
+    else if (rate == 0)
         ovr = 0;
     else
     {
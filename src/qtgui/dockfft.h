@@ -44,6 +44,7 @@ public:
 
     int fftSize();
     int setFftSize(int fft_size);
+    QList<int> fftSizes() const;
 
     quint64 wfSpan();
     quint64 setWfSpan(quint64 fft_size);
@@ -57,6 +58,10 @@ signals:
     void fftSizeChanged(int size);                 /*! FFT size changed. */
     void fftRateChanged(int fps);                  /*! FFT rate changed. */
     void fftWindowChanged(int window);             /*! FFT window type changed */
+    void fftStreamingChanged(bool enabled, float overlap, int reduce); /*! Streaming FFT settings changed. */
+    void fftThreadsChanged(int nthreads);          /*! Number of FFT threads changed. */
+    void fftGpuChanged(bool enabled);              /*! Toggle streamed FFT on the GPU. */
+    void fftEstimatorChanged(int estimator, int param); /*! Spectral estimator changed. */
     void displayDbmChanged(int state);             /*! Whether to show dBm/Hz.*/
     void wfSpanChanged(quint64 span_ms);           /*! Waterfall span changed. */
     void fftSplitChanged(int pct);                 /*! Split between pandapter and waterfall changed. */
@@ -65,6 +70,7 @@ signals:
     void plotModeChanged(int value);               /*! 2D plot mode (max/avg/filled) changed. */
     void plotScaleChanged(int value, bool useHz);  /*! 2D plot scale (FS/V/DBM) or (RBW/Hz) changed. */
     void fftAvgChanged(float gain);                /*! FFT video filter gain has changed. */
+    void fftLogAvgChanged(bool enabled);           /*! Toggle averaging on dB values. */
     void pandapterRangeChanged(float min, float max);
     void waterfallRangeChanged(float min, float max);
     void resetFftZoom(void);                       /*! FFT zoom reset. */
@@ -77,7 +83,11 @@ signals:
     void peakDetectToggled(bool enabled);          /*! Enable peak detection in FFT plot */
     void bandPlanChanged(bool enabled);            /*! Toggle Band Plan at bottom of FFT area. */
     void markersChanged(bool enabled);             /*! Toggle markers and on-plot controls. */
+    void zoomFftChanged(bool enabled);             /*! Toggle decimated FFT for zoomed views. */
+    void gpuWaterfallChanged(bool enabled);        /*! Toggle OpenGL waterfall rendering. */
+    void wfResolutionChanged(int percent);         /*! Waterfall resolution in percent of the screen. */
     void wfColormapChanged(const QString &cmap);
+    void autoRangeChanged(bool enabled);           /*! Toggle automatic dB ranges. */
 
 public slots:
     void setPandapterRange(float min, float max);
@@ -86,14 +96,21 @@ public slots:
     void setZoomLevel(float level);
     void setMarkersEnabled(bool enable);
     void setActualFrameRate(float rate, bool dropping);
+    void setLevelStats(float noiseFloor, float peakLevel);
 
 private slots:
     void on_fftSizeComboBox_currentIndexChanged(int index);
     void on_fftRateComboBox_currentIndexChanged(int index);
     void on_fftWinComboBox_currentIndexChanged(int index);
+    void on_fftStreamComboBox_currentIndexChanged(int index);
+    void on_fftStreamReduceBox_currentIndexChanged(int index);
+    void on_fftEstimatorComboBox_currentIndexChanged(int index);
+    void on_fftThreadsSpinBox_valueChanged(int value);
+    void on_fftGpuCheckBox_stateChanged(int state);
     void on_wfSpanComboBox_currentIndexChanged(int index);
     void on_fftSplitSlider_valueChanged(int value);
     void on_fftAvgSlider_valueChanged(int value);
+    void on_fftLogAvgCheckBox_stateChanged(int state);
     void on_fftZoomSlider_valueChanged(int level);
     void on_plotModeBox_currentIndexChanged(int index);
     void on_plotScaleBox_currentIndexChanged(int index);
@@ -110,12 +127,17 @@ private slots:
     void on_minHoldCheckBox_stateChanged(int state);
     void on_peakDetectCheckBox_stateChanged(int state);
     void on_lockCheckBox_stateChanged(int state);
+    void on_autoRangeCheckBox_stateChanged(int state);
     void on_bandPlanCheckBox_stateChanged(int state);
     void on_markersCheckBox_stateChanged(int state);
+    void on_zoomFftCheckBox_stateChanged(int state);
+    void on_wfGpuCheckBox_stateChanged(int state);
     void on_cmapComboBox_currentIndexChanged(int index);
+    void on_wfResComboBox_currentIndexChanged(int index);
 
 private:
     void updateInfoLabels(void);
+    void emitStreamingChanged(void);
 
 private:
     Ui::DockFft   * ui;
@@ -125,6 +147,9 @@ private:
     bool          m_pand_last_modified; /* Flag to indicate which slider was changed last */
     float         m_actual_frame_rate;
     bool          m_frame_dropping;
+    bool          m_auto_range_valid;   /* m_auto_noise and m_auto_peak hold smoothed levels */
+    float         m_auto_noise;
+    float         m_auto_peak;
 };
 
 #endif // DOCKFFT_H
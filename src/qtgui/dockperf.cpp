@@ -0,0 +1,153 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <cmath>
+#include <QTableWidgetItem>
+#include "dockperf.h"
+#include "ui_dockperf.h"
+#include "dsp/mem_account.h"
+
+/* Refresh interval of the memory table */
+#define MEM_REFRESH_MS 1000
+
+enum {
+    COL_NAME = 0,
+    COL_CPU,
+    COL_WORK,
+    COL_INPUT,
+    COL_OUTPUT,
+    COL_ITEMS,
+    COL_FULL
+};
+
+enum {
+    MEM_COL_NAME = 0,
+    MEM_COL_USED,
+    MEM_COL_PEAK,
+    MEM_COL_CAP
+};
+
+DockPerf::DockPerf(QWidget *parent) :
+    QDockWidget(parent),
+    ui(new Ui::DockPerf)
+{
+    ui->setupUi(this);
+    ui->perfTable->sortByColumn(COL_CPU, Qt::DescendingOrder);
+
+    ui->memoryTable->setRowCount(MEM_SUBSYSTEMS);
+    connect(&memTimer, SIGNAL(timeout()), this, SLOT(updateMemory()));
+    memTimer.start(MEM_REFRESH_MS);
+}
+
+DockPerf::~DockPerf()
+{
+    delete ui;
+}
+
+bool DockPerf::perfEnabled() const
+{
+    return ui->perfCheckBox->isChecked();
+}
+
+/*! \brief Set the check box, from the remote control. */
+void DockPerf::setPerfEnabled(bool enabled)
+{
+    ui->perfCheckBox->setChecked(enabled);
+}
+
+static void setCell(QTableWidget *table, int row, int col, const QVariant &value)
+{
+    QTableWidgetItem *item = table->item(row, col);
+    if (!item)
+    {
+        item = new QTableWidgetItem();
+        if (col != COL_NAME)
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        table->setItem(row, col, item);
+    }
+    item->setData(Qt::DisplayRole, value);
+}
+
+/* Numbers with one decimal that still sort as numbers, empty if not applicable */
+static QVariant decimal(float value)
+{
+    if (value < 0.0f)
+        return QVariant(QString());
+
+    return QVariant(std::round(value * 10.0) / 10.0);
+}
+
+/*! \brief Show the counters of the latest poll. */
+void DockPerf::setBlockPerf(const std::vector<receiver::block_perf> &blocks)
+{
+    QTableWidget *table = ui->perfTable;
+    float total = 0.0f;
+
+    // Sorted again once all rows are filled
+    table->setSortingEnabled(false);
+    table->setRowCount((int)blocks.size());
+    for (int row = 0; row < (int)blocks.size(); row++)
+    {
+        const receiver::block_perf &b = blocks[row];
+        setCell(table, row, COL_NAME, QString::fromStdString(b.name));
+        setCell(table, row, COL_CPU, decimal(b.cpu));
+        setCell(table, row, COL_WORK, decimal(b.work_time));
+        setCell(table, row, COL_INPUT, decimal(b.input_fill < 0.0f ? -1.0f : 100.0f * b.input_fill));
+        setCell(table, row, COL_OUTPUT, decimal(b.output_fill < 0.0f ? -1.0f : 100.0f * b.output_fill));
+        setCell(table, row, COL_ITEMS, QVariant((qulonglong)b.nproduced));
+        setCell(table, row, COL_FULL, QVariant((qulonglong)b.full_events));
+        total += b.cpu;
+    }
+    table->setSortingEnabled(true);
+
+    ui->totalLabel->setText(blocks.empty() ? QString()
+                                           : tr("Total %1% CPU").arg(total, 0, 'f', 1));
+}
+
+/* Megabytes with one decimal, empty for no cap */
+static QVariant megabytes(int64_t bytes)
+{
+    return decimal(bytes > 0 ? bytes / 1048576.0f : -1.0f);
+}
+
+/*! \brief Show the memory of the buffers, only while the dock is visible. */
+void DockPerf::updateMemory()
+{
+    if (!isVisible())
+        return;
+
+    QTableWidget *table = ui->memoryTable;
+    for (int row = 0; row < MEM_SUBSYSTEMS; row++)
+    {
+        setCell(table, row, MEM_COL_NAME, QString(mem_account::name(row)));
+        setCell(table, row, MEM_COL_USED, decimal(mem_account::used(row) / 1048576.0f));
+        setCell(table, row, MEM_COL_PEAK, decimal(mem_account::peak(row) / 1048576.0f));
+        setCell(table, row, MEM_COL_CAP, megabytes(mem_account::cap(row)));
+    }
+}
+
+void DockPerf::on_perfCheckBox_toggled(bool checked)
+{
+    if (!checked)
+        setBlockPerf(std::vector<receiver::block_perf>());
+    emit perfCountersToggled(checked);
+}
@@ -0,0 +1,70 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef DOCKPERF_H
+#define DOCKPERF_H
+
+#include <vector>
+#include <QDockWidget>
+#include <QTimer>
+
+#include "../applications/gqrx/receiver.h"
+
+namespace Ui {
+    class DockPerf;
+}
+
+/*! \brief Performance counters of the blocks of the flow graph.
+ *
+ * One row per block with its CPU share, work time, buffer fill and the
+ * number of times its output was found full, so that the stage which is
+ * saturating can be seen before the audio breaks up. Below, the memory
+ * of the large buffers from mem_account, refreshed while the dock is shown.
+ */
+class DockPerf : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit DockPerf(QWidget *parent = 0);
+    ~DockPerf();
+
+    bool perfEnabled() const;
+    void setBlockPerf(const std::vector<receiver::block_perf> &blocks);
+
+public slots:
+    void setPerfEnabled(bool enabled);
+
+signals:
+    /*! \brief Collecting the counters was enabled or disabled. */
+    void perfCountersToggled(bool enabled);
+
+private slots:
+    void on_perfCheckBox_toggled(bool checked);
+    void updateMemory();
+
+private:
+    Ui::DockPerf *ui;        /*! The Qt designer UI file. */
+    QTimer        memTimer;  /*! Refresh of the memory table. */
+};
+
+#endif // DOCKPERF_H
@@ -5,10 +5,12 @@
 #include <QTimer>
 #include <QStandardPaths>
 #include <QClipboard>
+#ifdef WITH_WEBENGINE
 #include <QWebEngineView>
 #include <QWebEnginePage>
 #include <QWebEngineSettings>
 #include <QWebChannel>
+#endif
 #include <QVBoxLayout>
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -22,245 +24,427 @@
 #include <QSplitter>
 #include <QPushButton>
 #include <QHBoxLayout>
-#include <QTemporaryFile>
-#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <QtEndian>
 #include "../applications/gqrx/mainwindow.h"
 #include "docksigint.h"
 #include "ui_docksigint.h"
 #include "waterfall_display.h"
 #include "plotter.h"
+#include "sigint_logger.h"
+#include "spectrum_summary.h"
+#include "tuning_intent.h"
+#include "dsp/trace.h"
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QProcess>
+#include <QCryptographicHash>
+#include <QRandomGenerator>
+#include <QRegularExpression>
 
 // NetworkWorker implementation
-NetworkWorker::NetworkWorker(QObject *parent) : QObject(parent)
+NetworkWorker::NetworkWorker(QObject *parent) :
+    QObject(parent),
+    running{},
+    apiRequestId(0)
 {
     networkManager = new QNetworkAccessManager(this);
-    pythonProcess = new QProcess(this);
-    pythonProcess->setProgram("python3");
+    sslConfig = QSslConfiguration::defaultConfiguration();
+    sslConfig.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2,
+                                       QSslConfiguration::NextProtocolHttp1_1});
+
+    // Everything goes to Claude until the dock routes a priority elsewhere
+    anthropic = std::make_shared<AnthropicBackend>(sslConfig);
+    for (LlmBackendPtr &backend : backends)
+        backend = anthropic;
 }
 
 NetworkWorker::~NetworkWorker()
 {
     delete networkManager;
-    if (pythonProcess->state() == QProcess::Running) {
-        pythonProcess->terminate();
-        pythonProcess->waitForFinished();
+}
+
+/**
+ * Open a connection to each server ahead of the first request.
+ *
+ * The connections stay in the cache of the network manager for the
+ * following turns, see LlmBackend::preconnect().
+ */
+void NetworkWorker::preconnect()
+{
+    QList<const LlmBackend *> done;
+    for (const LlmBackendPtr &backend : backends) {
+        if (done.contains(backend.get()))
+            continue;
+        done.append(backend.get());
+        backend->preconnect(networkManager);
+        SIGINT_LOG(SigintLogger::Debug, SigintLogger::Network,
+                   QString("Connecting to %1").arg(backend->name()));
     }
 }
 
-bool NetworkWorker::analyzeTuningRequest(const QString &message)
+/**
+ * Choose the server of a priority.
+ * @param url OpenAI compatible endpoint of a local inference server, or
+ *            empty for the Claude API.
+ * @param model Model of the local server, empty to ask for the dock model.
+ * @param apiKey Key of the local server, empty if it needs none.
+ *
+ * Applies to requests queued from now on.
+ */
+void NetworkWorker::setBackend(int priority, const QString &url, const QString &model,
+                               const QString &apiKey)
 {
-    qDebug() << "\n=== 🔍 Analyzing Tuning Request ===";
-    qDebug() << "Message:" << message;
+    if (priority < 0 || priority >= PriorityCount)
+        return;
 
-    // Create a temporary Python script
-    QTemporaryFile scriptFile;
-    if (scriptFile.open()) {
-        qDebug() << "✅ Created temporary script at:" << scriptFile.fileName();
-        
-        QTextStream stream(&scriptFile);
-        QString escapedMessage = message;
-        escapedMessage.replace("\"", "\\\"");
-        QString script = QString(
-            "import sys\n"
-            "import os\n"
-            "import json\n"
-            "import logging\n\n"
-            "# Configure logging\n"
-            "logging.basicConfig(level=logging.DEBUG)\n"
-            "logger = logging.getLogger('TuningAnalyzer')\n\n"
-            "# Add current directory to path\n"
-            "current_dir = os.path.dirname(os.path.abspath(__file__))\n"
-            "logger.debug(f'Current directory: {current_dir}')\n"
-            "sys.path.append('.')\n"
-            "logger.debug(f'Python path: {sys.path}')\n\n"
-            "try:\n"
-            "    logger.debug('Importing chat_coordinator...')\n"
-            "    from resources.chat_coordinator import ChatCoordinator\n"
-            "    logger.debug('Successfully imported ChatCoordinator')\n\n"
-            "    logger.debug('Creating coordinator instance...')\n"
-            "    coordinator = ChatCoordinator()\n"
-            "    logger.debug('Successfully created coordinator')\n\n"
-            "    message = %1\n"
-            "    logger.debug(f'Analyzing message: {message}')\n"
-            "    result = coordinator.evaluate_request(message)\n"
-            "    logger.debug(f'Analysis result: {result}')\n\n"
-            "    # Print result as JSON for parsing\n"
-            "    print(json.dumps(result))\n"
-            "except Exception as e:\n"
-            "    logger.error(f'Error during analysis: {str(e)}')\n"
-            "    import traceback\n"
-            "    traceback.print_exc()\n"
-            "    sys.exit(1)\n"
-        ).arg(QString("\"%1\"").arg(escapedMessage));
-
-        stream << script;
-        scriptFile.close();
-        
-        qDebug() << "📜 Generated Python script:";
-        qDebug().noquote() << script;
-
-        // Set working directory to Aguila root
-        QString aguilaRoot = QCoreApplication::applicationDirPath() + "/../../";
-        QDir aguilaDir(aguilaRoot);
-        QString absoluteAguilaPath = aguilaDir.absolutePath();
-        pythonProcess->setWorkingDirectory(absoluteAguilaPath);
-        
-        // Set up environment
-        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-        env.insert("PYTHONPATH", absoluteAguilaPath);
-        env.insert("PYTHONUNBUFFERED", "1");  // Ensure Python output is not buffered
-        
-        // Copy over any existing environment variables from .env
-        QFile envFile(absoluteAguilaPath + "/.env");
-        if (envFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            while (!envFile.atEnd()) {
-                QString line = envFile.readLine().trimmed();
-                if (!line.isEmpty() && !line.startsWith('#')) {
-                    QStringList parts = line.split('=');
-                    if (parts.size() == 2) {
-                        QString key = parts[0].trimmed();
-                        QString value = parts[1].trimmed();
-                        // Remove quotes if present
-                        if (value.startsWith('"') && value.endsWith('"')) {
-                            value = value.mid(1, value.length() - 2);
-                        }
-                        env.insert(key, value);
-                        qDebug() << "Setting env var:" << key << "=" << (key.contains("KEY") ? "***" : value);
-                    }
-                }
-            }
-            envFile.close();
-        }
-        
-        pythonProcess->setProcessEnvironment(env);
-        
-        // Run the script
-        pythonProcess->setArguments(QStringList() << scriptFile.fileName());
-        qDebug() << "🚀 Running Python script with args:" << pythonProcess->arguments();
-        qDebug() << "📂 Working directory:" << pythonProcess->workingDirectory();
-        qDebug() << "📂 PYTHONPATH:" << env.value("PYTHONPATH");
-        
-        pythonProcess->start();
-        
-        if (pythonProcess->waitForStarted()) {
-            qDebug() << "✅ Python process started";
-            
-            if (pythonProcess->waitForFinished()) {
-                QString stdout = QString::fromUtf8(pythonProcess->readAllStandardOutput());
-                QString stderr = QString::fromUtf8(pythonProcess->readAllStandardError());
-                
-                qDebug() << "\n=== Python Process Output ===";
-                qDebug() << "Exit code:" << pythonProcess->exitCode();
-                qDebug() << "Standard output:" << stdout;
-                if (!stderr.isEmpty()) {
-                    qDebug() << "Standard error:" << stderr;
-                }
-                
-                // Try to parse the output as JSON
-                QJsonDocument doc = QJsonDocument::fromJson(stdout.toUtf8());
-                if (!doc.isNull()) {
-                    QJsonObject result = doc.object();
-                    bool requiresTuning = result["requires_tuning"].toString() == "true";
-                    qDebug() << "Analysis result:";
-                    qDebug() << "- Requires tuning:" << requiresTuning;
-                    qDebug() << "- Confidence:" << result["confidence"].toString();
-                    qDebug() << "- Frequency:" << result["frequency_mentioned"].toString();
-                    
-                    if (requiresTuning) {
-                        qDebug() << "🎯 Tuning request detected!";
-                        return true;
-                    }
-                } else {
-                    qDebug() << "❌ Failed to parse Python output as JSON";
-                }
-            } else {
-                qDebug() << "❌ Python process failed to finish";
-                qDebug() << "Error:" << pythonProcess->errorString();
-            }
-        } else {
-            qDebug() << "❌ Failed to start Python process";
-            qDebug() << "Error:" << pythonProcess->errorString();
+    if (url.isEmpty())
+        backends[priority] = anthropic;
+    else
+        backends[priority] = std::make_shared<OpenAiBackend>(QUrl(url), model, apiKey);
+    SIGINT_LOG(SigintLogger::Info, SigintLogger::Network,
+               QString("Priority %1 requests go to %2").arg(priority).arg(backends[priority]->name()));
+}
+
+/**
+ * Log the timings of an API request when it finishes.
+ * @param reply The reply, just posted.
+ * @param what Name of the request in the log.
+ *
+ * The network manager does not report the DNS lookup apart from the TCP and
+ * TLS setup, so the time to the encrypted() signal covers all three. Without
+ * that signal the request went over a connection that was already open.
+ */
+void NetworkWorker::traceReply(QNetworkReply *reply, const QString &what)
+{
+    auto timer = std::make_shared<QElapsedTimer>();
+    auto connectMs = std::make_shared<qint64>(-1);
+    auto firstByteMs = std::make_shared<qint64>(-1);
+    timer->start();
+
+    connect(reply, &QNetworkReply::encrypted, this, [timer, connectMs]() {
+        *connectMs = timer->elapsed();
+    });
+    connect(reply, &QNetworkReply::metaDataChanged, this, [timer, firstByteMs]() {
+        if (*firstByteMs < 0)
+            *firstByteMs = timer->elapsed();
+    });
+    connect(reply, &QNetworkReply::finished, this, [reply, what, timer, connectMs, firstByteMs]() {
+        const bool http2 = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+        SIGINT_LOG(SigintLogger::Info, SigintLogger::Network,
+                   QString("%1: %2, DNS+TLS %3, TTFB %4 ms, total %5 ms")
+                       .arg(what, http2 ? "HTTP/2" : "HTTP/1.1",
+                            *connectMs < 0 ? QString("reused") : QString("%1 ms").arg(*connectMs))
+                       .arg(*firstByteMs)
+                       .arg(timer->elapsed()));
+    });
+}
+
+/**
+ * Parse a chunk of the server-sent event stream of a reply.
+ *
+ * The lines are parsed by the backend. Text deltas are emitted as
+ * messageDelta() and collected in the state so the complete reply can be
+ * emitted when the stream ends.
+ */
+void NetworkWorker::parseStream(const LlmBackend &backend, const QByteArray &chunk,
+                                StreamState &stream)
+{
+    stream.buffer.append(chunk);
+
+    int eol;
+    while ((eol = stream.buffer.indexOf('\n')) >= 0) {
+        const QByteArray line = stream.buffer.left(eol).trimmed();
+        stream.buffer.remove(0, eol + 1);
+
+        QString text;
+        backend.parseStreamLine(line, text, stream.error, stream.errorType);
+        if (!text.isEmpty()) {
+            stream.text += text;
+            emit messageDelta(text);
         }
-    } else {
-        qDebug() << "❌ Failed to create temporary script file";
     }
-    
-    qDebug() << "=== Analysis Complete ===\n";
-    return false;
 }
 
-void NetworkWorker::sendMessage(const QString &apiKey, const QString &model, const QJsonArray &messages)
+/**
+ * Ask Claude for a summary of older turns, see ChatContext::summaryRequest().
+ *
+ * The reply is emitted as summaryReady(), with an empty summary on error so
+ * the context can try again later.
+ */
+void NetworkWorker::summarize(const QString &apiKey, const QString &model,
+                              const QJsonArray &messages, int epoch)
 {
+    auto request = std::make_shared<ApiRequest>();
+    request->priority = Background;
+    request->backend = backends[Background];
+    request->apiKey = apiKey;
+    request->body = request->backend->body(model, QJsonArray(), messages, 1024, false);
+    request->epoch = epoch;
+    enqueue(request);
+}
+
+/**
+ * Send a message to Claude.
+ * @param priority Scheduling priority, NetworkWorker::Priority.
+ *
+ * Chat replies are streamed, analysis replies are emitted whole, so only
+ * one reply streams into the chat at a time. Chat messages have already
+ * been checked for tuning requests by the dock.
+ */
+void NetworkWorker::sendMessage(const QString &apiKey, const QString &model,
+                                const QJsonArray &system, const QJsonArray &messages,
+                                int priority, const QString &cacheKey)
+{
+    TRACE_SCOPE("llm", "NetworkWorker::sendMessage");
     qDebug() << "\n=== 📨 Processing Message ===";
+
+    // Chat replies are streamed as server-sent events so text shows up as
+    // it is generated.
+    const bool stream = priority == Interactive;
+
+    auto request = std::make_shared<ApiRequest>();
+    request->priority = qBound(0, priority, PriorityCount - 1);
+    request->backend = backends[request->priority];
+    request->apiKey = apiKey;
+    request->body = request->backend->body(model, system, messages, 4096, stream);
+
+    qDebug() << "🌐 Queueing request to" << request->backend->name() << ":";
+    qDebug() << "  - Model:" << model;
+    qDebug() << "  - Messages:" << messages.size();
+    request->stream = stream;
+    request->cacheKey = cacheKey;
+    enqueue(request);
     
-    // Get the latest message from the array
-    QString latestMessage = messages.last().toObject()["content"].toString();
-    qDebug() << "Message content:" << latestMessage;
-    
-    // First, analyze with coordinator
-    qDebug() << "🔍 Analyzing for tuning request...";
-    if (analyzeTuningRequest(latestMessage)) {
-        qDebug() << "✅ Tuning request confirmed - bypassing Claude";
-        emit messageReceived("✅ Tuning request processed - adjusting radio frequency...");
-        return;
+    qDebug() << "=== Message Processing Complete ===\n";
+}
+
+/**
+ * Drop the queued and running requests of a priority.
+ *
+ * Used for the analysis requests when the operator retunes, since their
+ * answer would describe a signal that is no longer tuned.
+ */
+void NetworkWorker::cancel(int priority)
+{
+    int cancelled = pending[priority].size();
+    pending[priority].clear();
+
+    // Copy, the finished handler of an aborted reply removes it from active
+    const QList<ApiRequestPtr> requests = active;
+    for (const ApiRequestPtr &request : requests) {
+        if (request->priority != priority || request->cancelled)
+            continue;
+        request->cancelled = true;
+        cancelled++;
+        if (request->reply)
+            request->reply->abort();
+        else
+            finishRequest(request);   // waiting for a retry
+    }
+
+    if (cancelled > 0) {
+        SIGINT_LOG(SigintLogger::Info, SigintLogger::Network,
+                   QString("Cancelled %1 request(s) of priority %2").arg(cancelled).arg(priority));
+        if (priority == Analysis)
+            emit errorOccurred("Signal analysis cancelled, the receiver was retuned.", false);
+    }
+}
+
+/**
+ * Queue a request, or drop it if the same analysis is already queued or
+ * running.
+ */
+void NetworkWorker::enqueue(const ApiRequestPtr &request)
+{
+    request->id = ++apiRequestId;
+    if (request->priority == Analysis) {
+        request->digest = QCryptographicHash::hash(request->body, QCryptographicHash::Sha1);
+        auto same = [&request](const ApiRequestPtr &other) {
+            return !other->cancelled && other->digest == request->digest;
+        };
+        if (std::any_of(pending[Analysis].begin(), pending[Analysis].end(), same) ||
+            std::any_of(active.begin(), active.end(), same)) {
+            SIGINT_LOG(SigintLogger::Info, SigintLogger::Network,
+                       "Same analysis already in progress, request dropped");
+            return;
+        }
     }
-    qDebug() << "ℹ️ Not a tuning request - proceeding with Claude";
 
-    // If not a tuning request, proceed with normal Claude request
-    QJsonObject requestBody{
-        {"model", model},
-        {"messages", messages},
-        {"max_tokens", 4096}
+    pending[request->priority].append(request);
+    schedule();
+}
+
+/* Start queued requests, highest priority first, within the limits */
+void NetworkWorker::schedule()
+{
+    static const int limits[PriorityCount] = {
+        SIGINT_API_MAX_INTERACTIVE, SIGINT_API_MAX_ANALYSIS, SIGINT_API_MAX_BACKGROUND
     };
 
-    QNetworkRequest request(QUrl("https://api.anthropic.com/v1/messages"));
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    request.setRawHeader("x-api-key", apiKey.toUtf8());
-    request.setRawHeader("anthropic-version", "2023-06-01");
+    for (int p = 0; p < PriorityCount; p++) {
+        while (!pending[p].isEmpty() && running[p] < limits[p] &&
+               active.size() < SIGINT_API_MAX_REQUESTS) {
+            const ApiRequestPtr request = pending[p].takeFirst();
+            running[p]++;
+            active.append(request);
+            postRequest(request);
+        }
+    }
+}
+
+void NetworkWorker::postRequest(const ApiRequestPtr &request)
+{
+    const LlmBackend &backend = *request->backend;
+    QNetworkReply *reply = networkManager->post(backend.request(request->apiKey, request->stream),
+                                                request->body);
+    request->reply = reply;
+    request->attempts++;
+    traceReply(reply, QString("Request %1 to %2 (priority %3, attempt %4)")
+                          .arg(request->id).arg(backend.name())
+                          .arg(request->priority).arg(request->attempts));
+
+    auto stream = std::make_shared<StreamState>();
+    if (request->stream) {
+        connect(reply, &QNetworkReply::readyRead, this, [this, request, reply, stream]() {
+            // Leave error bodies for the finished handler
+            if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200)
+                parseStream(*request->backend, reply->readAll(), *stream);
+        });
+    }
 
-    qDebug() << "🌐 Sending request to Claude:";
-    qDebug() << "  - Model:" << model;
-    qDebug() << "  - Messages:" << messages.size();
+    connect(reply, &QNetworkReply::finished, this, [this, request, reply, stream]() {
+        request->reply = nullptr;
+        reply->deleteLater();
+        if (request->cancelled) {
+            finishRequest(request);
+            return;
+        }
 
-    QNetworkReply *reply = networkManager->post(request, QJsonDocument(requestBody).toJson());
-    
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        if (reply->error() == QNetworkReply::NoError) {
-            QByteArray response = reply->readAll();
-            QJsonDocument jsonResponse = QJsonDocument::fromJson(response);
-            QJsonObject jsonObject = jsonResponse.object();
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        QString text;
+        QString error;
+        bool retry = false;
 
-            qDebug() << "✅ Received response from Claude";
-            if (jsonObject.contains("content")) {
-                QString assistantMessage = jsonObject["content"].toArray()[0].toObject()["text"].toString();
-                emit messageReceived(assistantMessage);
+        if (reply->error() == QNetworkReply::NoError) {
+            if (request->stream) {
+                // Complete a last event without the trailing newline
+                parseStream(*request->backend, reply->readAll() + "\n", *stream);
+                text = stream->text;
+                error = stream->error;
+                // An overloaded stream can be restarted if nothing was shown yet
+                retry = stream->errorType == "overloaded_error" && text.isEmpty();
             }
             else {
-                QString error = "Error: Response does not contain 'content' field";
-                qDebug() << "❌ " << error;
-                emit errorOccurred(error);
+                const QJsonObject result = QJsonDocument::fromJson(reply->readAll()).object();
+                text = request->backend->replyText(result);
             }
+            if (error.isEmpty() && text.isEmpty())
+                error = "Error: Response does not contain any text";
         }
         else {
-            QString errorDetails = QString("Error: %1\nResponse: %2")
-                                 .arg(reply->errorString(), reply->readAll().constData());
-            qDebug() << "❌ Network error:" << errorDetails;
-            emit errorOccurred(errorDetails);
+            // 429 rate limited, 529 overloaded, 5xx and lost connections are transient
+            retry = status == 429 || status >= 500 || status == 0;
+            error = status == 429 || status == 529
+                  ? QString("Error: %1 is busy (HTTP %2), please try again in a moment")
+                        .arg(request->backend->needsApiKey() ? QString("Claude") : request->backend->name())
+                        .arg(status)
+                  : QString("Error: %1\nResponse: %2").arg(reply->errorString(),
+                                                           reply->readAll().constData());
         }
-        reply->deleteLater();
+
+        if (retry && request->attempts < SIGINT_API_MAX_ATTEMPTS) {
+            const int delay = retryDelay(request->attempts,
+                                         reply->rawHeader("retry-after").toInt());
+            SIGINT_LOG(SigintLogger::Warning, SigintLogger::Network,
+                       QString("Request %1 failed (HTTP %2), retrying in %3 ms")
+                       .arg(request->id).arg(status).arg(delay));
+            // The request keeps its slot, so a busy API also slows the queue
+            QTimer::singleShot(delay, this, [this, request]() {
+                if (!request->cancelled)
+                    postRequest(request);
+            });
+            return;
+        }
+
+        if (request->priority == Background) {
+            if (!error.isEmpty()) {
+                SIGINT_LOG(SigintLogger::Warning, SigintLogger::Network,
+                           QString("Chat summary failed: %1").arg(error));
+                text.clear();
+            }
+            emit summaryReady(request->epoch, text);
+        }
+        else if (!error.isEmpty()) {
+            qDebug() << "❌ " << error;
+            emit errorOccurred(error, request->stream);
+        }
+        else {
+            qDebug() << "✅ Received response from Claude";
+            if (request->cacheKey.startsWith(SIGINT_BATCH_KEY)) {
+                emit batchReceived(request->cacheKey, text);
+            }
+            else {
+                emit messageReceived(text, request->stream);
+                if (!request->cacheKey.isEmpty())
+                    emit analysisReceived(request->cacheKey, text);
+            }
+        }
+        finishRequest(request);
     });
-    
-    qDebug() << "=== Message Processing Complete ===\n";
+}
+
+/* Release the slot of a request and start the next ones */
+void NetworkWorker::finishRequest(const ApiRequestPtr &request)
+{
+    if (!active.removeOne(request))
+        return;
+    running[request->priority]--;
+    schedule();
+}
+
+/**
+ * Delay before the next attempt of a request.
+ * @param attempts Attempts made so far.
+ * @param retryAfter Retry-After header of the reply in seconds, 0 if none.
+ *
+ * Exponential backoff with jitter, so requests that failed together do
+ * not come back together.
+ */
+int NetworkWorker::retryDelay(int attempts, int retryAfter)
+{
+    const int backoff = std::min(SIGINT_API_RETRY_BASE_MS << (attempts - 1), SIGINT_API_RETRY_MAX_MS);
+    const int delay = backoff / 2 + (int)QRandomGenerator::global()->bounded(backoff / 2 + 1);
+    return std::max(delay, std::min(retryAfter * 1000, SIGINT_API_RETRY_MAX_MS));
 }
 
 // DatabaseWorker implementation
-DatabaseWorker::DatabaseWorker(const QString &dbPath, QObject *parent) : QObject(parent)
+DatabaseWorker::DatabaseWorker(const QString &dbPath, QObject *parent) :
+    QObject(parent),
+    dbPath(dbPath),
+    eventsRtree(false),
+    messagesFts(false),
+    flushTimer(new QTimer(this))
+{
+    qRegisterMetaType<SearchHit>("SearchHit");
+    qRegisterMetaType<QVector<SearchHit>>("QVector<SearchHit>");
+
+    // A child of the worker, so it moves to the database thread with it
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(SIGINT_DB_FLUSH_MS);
+    connect(flushTimer, &QTimer::timeout, this, &DatabaseWorker::flushMessages);
+}
+
+/**
+ * Open the database and create the tables it lacks.
+ *
+ * Runs in the database thread, queued before any other request, so the
+ * GUI does not wait for the disk at startup.
+ */
+void DatabaseWorker::initializeDatabase()
 {
     qDebug() << "\n=== 🔧 Initializing Database Worker 🔧 ===";
     qDebug() << "📂 Database path:" << dbPath;
@@ -306,6 +490,7 @@ DatabaseWorker::DatabaseWorker(const QString &dbPath, QObject *parent) : QObject
                        "role TEXT NOT NULL,"
                        "content TEXT NOT NULL,"
                        "timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
+                       "meta TEXT,"
                        "FOREIGN KEY (chat_id) REFERENCES chats(id)"
                        ")")) {
             qDebug() << "❌ Failed to create messages table:" << query.lastError().text();
@@ -313,6 +498,32 @@ DatabaseWorker::DatabaseWorker(const QString &dbPath, QObject *parent) : QObject
             return;
         }
 
+        // Receiver state of each message for the search, missing in older databases
+        bool hasMeta = false;
+        query.exec("PRAGMA table_info(messages)");
+        while (query.next())
+            hasMeta = hasMeta || query.value(1).toString() == "meta";
+        if (!hasMeta && !query.exec("ALTER TABLE messages ADD COLUMN meta TEXT")) {
+            qDebug() << "❌ Failed to add meta to messages:" << query.lastError().text();
+            db.rollback();
+            return;
+        }
+
+        // Full text index of the messages, kept up to date by flushMessages().
+        // A new index is filled with the messages stored so far.
+        query.exec("SELECT 1 FROM sqlite_master WHERE name = 'messages_fts'");
+        const bool ftsExisted = query.next();
+        messagesFts = query.exec("CREATE VIRTUAL TABLE IF NOT EXISTS messages_fts USING fts5("
+                                 "content, meta, content='messages', content_rowid='id')");
+        if (!messagesFts) {
+            qDebug() << "⚠️ No FTS5 module, searches scan the messages:" << query.lastError().text();
+        } else if (!ftsExisted &&
+                   !query.exec("INSERT INTO messages_fts (messages_fts) VALUES ('rebuild')")) {
+            qDebug() << "❌ Failed to index messages:" << query.lastError().text();
+            db.rollback();
+            return;
+        }
+
         // Create settings table
         if (!query.exec("CREATE TABLE IF NOT EXISTS settings ("
                        "key TEXT PRIMARY KEY,"
@@ -324,6 +535,63 @@ DatabaseWorker::DatabaseWorker(const QString &dbPath, QObject *parent) : QObject
             return;
         }
 
+        // Create analysis cache table, created_at in seconds since the epoch
+        if (!query.exec("CREATE TABLE IF NOT EXISTS analysis_cache ("
+                       "key TEXT PRIMARY KEY,"
+                       "response TEXT NOT NULL,"
+                       "created_at INTEGER NOT NULL"
+                       ")")) {
+            qDebug() << "❌ Failed to create analysis cache table:" << query.lastError().text();
+            db.rollback();
+            return;
+        }
+
+        // Detected emissions, times in seconds since the epoch
+        if (!query.exec("CREATE TABLE IF NOT EXISTS events ("
+                       "id INTEGER PRIMARY KEY,"
+                       "range TEXT,"
+                       "start_time REAL NOT NULL,"
+                       "stop_time REAL NOT NULL,"
+                       "center_freq REAL NOT NULL,"
+                       "bandwidth REAL NOT NULL,"
+                       "peak_db REAL,"
+                       "classification TEXT"
+                       ")")) {
+            qDebug() << "❌ Failed to create events table:" << query.lastError().text();
+            db.rollback();
+            return;
+        }
+
+        // R-tree over time and frequency. Its 32 bit float bounds are
+        // rounded outwards, so the exact columns of events are checked too.
+        eventsRtree = query.exec("CREATE VIRTUAL TABLE IF NOT EXISTS events_rtree USING rtree("
+                                 "id, start_time, stop_time, min_freq, max_freq)");
+        if (!eventsRtree) {
+            qDebug() << "⚠️ No R-tree module, events are indexed by time only:" << query.lastError().text();
+            query.exec("CREATE INDEX IF NOT EXISTS events_time ON events (start_time, stop_time)");
+        }
+
+        // Occupancy tiles of OccupancyRecorder, additive, so without a key
+        if (!query.exec("CREATE TABLE IF NOT EXISTS occupancy ("
+                       "level INTEGER NOT NULL,"
+                       "start_time INTEGER NOT NULL,"
+                       "first_cell INTEGER NOT NULL,"
+                       "data BLOB NOT NULL"
+                       ")") ||
+            !query.exec("CREATE INDEX IF NOT EXISTS occupancy_time ON occupancy (level, start_time)")) {
+            qDebug() << "❌ Failed to create occupancy table:" << query.lastError().text();
+            db.rollback();
+            return;
+        }
+
+        // Indexes for the history pages and the cache expiry
+        if (!query.exec("CREATE INDEX IF NOT EXISTS messages_chat_id ON messages (chat_id, id)") ||
+            !query.exec("CREATE INDEX IF NOT EXISTS analysis_cache_created_at ON analysis_cache (created_at)")) {
+            qDebug() << "❌ Failed to create indexes:" << query.lastError().text();
+            db.rollback();
+            return;
+        }
+
         // Create default chat if it doesn't exist
         if (!query.exec("INSERT OR IGNORE INTO chats (id, name) VALUES (1, 'Chat 1')")) {
             qDebug() << "❌ Failed to create default chat:" << query.lastError().text();
@@ -336,6 +604,37 @@ DatabaseWorker::DatabaseWorker(const QString &dbPath, QObject *parent) : QObject
             db.rollback();
         }
         
+        insertQuery = QSqlQuery(db);
+        insertQuery.prepare("INSERT INTO messages (chat_id, role, content, meta) VALUES (?, ?, ?, ?)");
+        indexQuery = QSqlQuery(db);
+        searchQuery = QSqlQuery(db);
+        if (messagesFts) {
+            indexQuery.prepare("INSERT INTO messages_fts (rowid, content, meta) VALUES (?, ?, ?)");
+            searchQuery.prepare("SELECT m.id, m.chat_id, c.name, m.role, m.meta, m.timestamp, "
+                                "snippet(messages_fts, 0, '[', ']', '...', 16) "
+                                "FROM messages_fts JOIN messages m ON m.id = messages_fts.rowid "
+                                "LEFT JOIN chats c ON c.id = m.chat_id "
+                                "WHERE messages_fts MATCH ? ORDER BY rank LIMIT ?");
+        } else {
+            searchQuery.prepare("SELECT m.id, m.chat_id, c.name, m.role, m.meta, m.timestamp, "
+                                "substr(m.content, 1, 160) FROM messages m "
+                                "LEFT JOIN chats c ON c.id = m.chat_id "
+                                "WHERE m.content LIKE ? OR m.meta LIKE ? ORDER BY m.id DESC LIMIT ?");
+        }
+        eventQuery = QSqlQuery(db);
+        eventQuery.prepare("INSERT OR REPLACE INTO events (id, range, start_time, stop_time, "
+                           "center_freq, bandwidth, peak_db, classification) "
+                           "VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+        eventIndexQuery = QSqlQuery(db);
+        if (eventsRtree)
+            eventIndexQuery.prepare("INSERT OR REPLACE INTO events_rtree VALUES (?, ?, ?, ?, ?)");
+        occupancyQuery = QSqlQuery(db);
+        occupancyQuery.prepare("INSERT INTO occupancy (level, start_time, first_cell, data) "
+                               "VALUES (?, ?, ?, ?)");
+        historyQuery = QSqlQuery(db);
+        historyQuery.prepare("SELECT role, content FROM messages WHERE chat_id = ? "
+                             "ORDER BY id DESC LIMIT ? OFFSET ?");
+
         qDebug() << "✅ Database initialized successfully with WAL mode and busy timeout";
     } else {
         qDebug() << "❌ Failed to open database:" << db.lastError().text();
@@ -344,6 +643,16 @@ DatabaseWorker::DatabaseWorker(const QString &dbPath, QObject *parent) : QObject
 
 DatabaseWorker::~DatabaseWorker()
 {
+    flushMessages();
+    // The queries must go before the connection is removed
+    insertQuery = QSqlQuery();
+    indexQuery = QSqlQuery();
+    searchQuery = QSqlQuery();
+    historyQuery = QSqlQuery();
+    eventQuery = QSqlQuery();
+    eventIndexQuery = QSqlQuery();
+    occupancyQuery = QSqlQuery();
+
     QString connectionName = db.connectionName();
     if (db.isOpen()) {
         db.close();
@@ -352,75 +661,90 @@ DatabaseWorker::~DatabaseWorker()
     QSqlDatabase::removeDatabase(connectionName);
 }
 
-void DatabaseWorker::saveMessage(int chatId, const QString &role, const QString &content)
+/**
+ * Queue a message for the database.
+ *
+ * Messages are written by flushMessages() in one transaction, at most
+ * SIGINT_DB_FLUSH_MS after they are queued, so automated analyses logged
+ * at a high rate do not each pay for a commit.
+ */
+void DatabaseWorker::saveMessage(int chatId, const QString &role, const QString &content,
+                                 const QString &meta)
 {
-    qDebug() << "\n=== 💾 Saving Message to Database 💾 ===";
-    qDebug() << "🆔 Chat ID:" << chatId;
-    qDebug() << "👤 Role:" << role;
-    qDebug() << "📝 Content:" << content.left(50) + "...";
+    pendingMessages.append({chatId, role, content, meta});
+    if (pendingMessages.size() >= SIGINT_DB_FLUSH_MESSAGES)
+        flushMessages();
+    else if (!flushTimer->isActive())
+        flushTimer->start();
+}
 
-    // Ensure database connection is valid
-    if (!db.isOpen()) {
-        if (!db.open()) {
-            QString error = "Database not open: " + db.lastError().text();
-            qDebug() << "❌ " << error;
-            emit this->error(error);
-            return;
-        }
-    }
+/* Write the queued messages, also called before reads so they see them */
+void DatabaseWorker::flushMessages()
+{
+    flushTimer->stop();
+    if (pendingMessages.isEmpty())
+        return;
+    TRACE_SCOPE("db", "DatabaseWorker::flushMessages");
 
-    // Use a unique transaction for this save operation
-    if (!db.transaction()) {
-        QString error = "Failed to start transaction: " + db.lastError().text();
-        qDebug() << "❌ " << error;
-        emit this->error(error);
+    if (!db.isOpen() && !db.open()) {
+        emit this->error("Database not open: " + db.lastError().text());
         return;
     }
-
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO messages (chat_id, role, content) VALUES (?, ?, ?)");
-    query.addBindValue(chatId);
-    query.addBindValue(role);
-    query.addBindValue(content);
-
-    if (!query.exec()) {
-        QString error = "Error saving message: " + query.lastError().text();
-        qDebug() << "❌ " << error;
-        db.rollback();
-        emit this->error(error);
+    if (!db.transaction()) {
+        emit this->error("Failed to start transaction: " + db.lastError().text());
         return;
     }
 
-    qint64 id = query.lastInsertId().toLongLong();
-    
-    // Verify the message was saved
-    query.prepare("SELECT * FROM messages WHERE id = ?");
-    query.addBindValue(id);
-    if (query.exec() && query.next()) {
-        qDebug() << "✅ Message saved and verified:";
-        qDebug() << "   ID:" << query.value(0).toLongLong();
-        qDebug() << "   Chat ID:" << query.value(1).toInt();
-        qDebug() << "   Role:" << query.value(2).toString();
-        qDebug() << "   Content:" << query.value(3).toString().left(50) + "...";
-        
-        if (!db.commit()) {
-            QString error = "Failed to commit transaction: " + db.lastError().text();
+    QVector<qint64> ids;
+    ids.reserve(pendingMessages.size());
+    for (const PendingMessage &msg : pendingMessages) {
+        insertQuery.addBindValue(msg.chatId);
+        insertQuery.addBindValue(msg.role);
+        insertQuery.addBindValue(msg.content);
+        insertQuery.addBindValue(msg.meta);
+        bool ok = insertQuery.exec();
+        const qint64 id = insertQuery.lastInsertId().toLongLong();
+        if (ok && messagesFts) {
+            indexQuery.addBindValue(id);
+            indexQuery.addBindValue(msg.content);
+            indexQuery.addBindValue(msg.meta);
+            ok = indexQuery.exec();
+        }
+        if (!ok) {
+            const QString error = "Error saving message: " +
+                                  (insertQuery.lastError().isValid() ? insertQuery : indexQuery)
+                                  .lastError().text();
             qDebug() << "❌ " << error;
             db.rollback();
+            pendingMessages.clear();
             emit this->error(error);
             return;
         }
-        
-        emit messageSaved(id);
-    } else {
-        QString error = "Failed to verify saved message: " + query.lastError().text();
+        ids.append(id);
+    }
+    pendingMessages.clear();
+
+    if (!db.commit()) {
+        const QString error = "Failed to commit transaction: " + db.lastError().text();
         qDebug() << "❌ " << error;
         db.rollback();
         emit this->error(error);
+        return;
     }
+
+    for (qint64 id : ids)
+        emit messageSaved(id);
 }
 
-void DatabaseWorker::loadChatHistory(int chatId)
+/**
+ * Load a page of the messages of a chat.
+ * @param chatId The chat.
+ * @param offset Number of newer messages to skip, 0 for the newest page.
+ *
+ * At most CHAT_BRIDGE_PAGE_MESSAGES messages are emitted with
+ * historyLoaded(), oldest first, and whether there are older ones.
+ */
+void DatabaseWorker::loadChatHistory(int chatId, int offset)
 {
     qDebug() << "\n=== 📚 Loading Chat History 📚 ===";
     qDebug() << "🆔 Chat ID:" << chatId;
@@ -432,9 +756,11 @@ void DatabaseWorker::loadChatHistory(int chatId)
         return;
     }
 
-    QSqlQuery query(db);
-    query.prepare("SELECT role, content FROM messages WHERE chat_id = ? ORDER BY timestamp ASC");
+    flushMessages();
+    QSqlQuery &query = historyQuery;
     query.addBindValue(chatId);
+    query.addBindValue(CHAT_BRIDGE_PAGE_MESSAGES + 1);
+    query.addBindValue(offset);
     
     if (!query.exec()) {
         QString error = "Error loading chat history: " + query.lastError().text();
@@ -444,17 +770,81 @@ void DatabaseWorker::loadChatHistory(int chatId)
     }
 
     QVector<QPair<QString, QString>> messages;
-    while (query.next()) {
+    while (query.next() && messages.size() < CHAT_BRIDGE_PAGE_MESSAGES) {
         QString role = query.value(0).toString();
         QString content = query.value(1).toString();
-        messages.append(qMakePair(role, content));
-        qDebug() << "📨 Loaded message:";
-        qDebug() << "   Role:" << role;
-        qDebug() << "   Content:" << content.left(50) + "...";
+        messages.prepend(qMakePair(role, content));
     }
+    // The extra row only tells if there are older messages
+    const bool more = query.isValid();
+    query.finish();
 
     qDebug() << "✅ Loaded" << messages.size() << "messages from history";
-    emit historyLoaded(messages);
+    emit historyLoaded(chatId, offset, messages, more);
+}
+
+/**
+ * Find the messages of all chats with every word of text as a prefix.
+ *
+ * With FTS5 the hits are ranked by BM25 over the content and the receiver
+ * state stored with each message, without it the newest messages that
+ * contain the text are taken. At most SIGINT_SEARCH_RESULTS hits are
+ * emitted with searchFound(), with the text so stale results can be
+ * dropped.
+ */
+void DatabaseWorker::searchMessages(const QString &text)
+{
+    QVector<SearchHit> hits;
+    const QString words = text.simplified();
+    if (words.isEmpty()) {
+        emit searchFound(text, hits);
+        return;
+    }
+    if (!db.isOpen() && !db.open()) {
+        emit this->error("Database not open: " + db.lastError().text());
+        return;
+    }
+    TRACE_SCOPE("db", "DatabaseWorker::searchMessages");
+
+    flushMessages();
+    QSqlQuery &query = searchQuery;
+    if (messagesFts) {
+        // Each word is quoted, so nothing the user types is FTS5 syntax
+        QStringList terms;
+        for (QString word : words.split(' ')) {
+            word.remove('"');
+            if (!word.isEmpty())
+                terms << QString("\"%1\"*").arg(word);
+        }
+        if (terms.isEmpty()) {
+            emit searchFound(text, hits);
+            return;
+        }
+        query.addBindValue(terms.join(' '));
+    } else {
+        const QString pattern = "%" + words + "%";
+        query.addBindValue(pattern);
+        query.addBindValue(pattern);
+    }
+    query.addBindValue(SIGINT_SEARCH_RESULTS);
+
+    if (!query.exec()) {
+        emit this->error("Error searching messages: " + query.lastError().text());
+        return;
+    }
+    while (query.next()) {
+        SearchHit hit;
+        hit.id = query.value(0).toLongLong();
+        hit.chatId = query.value(1).toInt();
+        hit.chatName = query.value(2).toString();
+        hit.role = query.value(3).toString();
+        hit.meta = query.value(4).toString();
+        hit.timestamp = query.value(5).toString();
+        hit.snippet = query.value(6).toString();
+        hits.append(hit);
+    }
+    query.finish();
+    emit searchFound(text, hits);
 }
 
 void DatabaseWorker::loadAllChats()
@@ -583,59 +973,349 @@ void DatabaseWorker::loadSetting(const QString &key)
     }
 }
 
-DockSigint::DockSigint(receiver *rx_ptr, QWidget *parent) :
-    QDockWidget(parent),
-    ui(new Ui::DockSigint),
-    webView(nullptr),
-    networkWorker(nullptr),
-    databaseWorker(nullptr),
-    networkThread(),
-    databaseThread(),
-    anthropicApiKey(),
-    currentModel(),
-    currentChatId(1),
-    messageHistory(),
-    chatList(),
-    chatHtml(),
-    spectrumCapture(nullptr),
-    spectrumVisualizer(nullptr),
-    waterfallDisplay(nullptr),
-    rx_ptr(rx_ptr),
-    dsp_running(false),
-    currentTab("spectrum"),
-    spectrumContainer(nullptr),
-    waterfallContainer(nullptr)
+/**
+ * Look up a cached signal analysis.
+ * @param key Cache key from DockSigint::captureWaterfallScreenshot().
+ * @param maxAge Age in seconds after which an entry has expired.
+ *
+ * The result is emitted as analysisLookedUp(), with an empty response if
+ * there is no entry or it has expired.
+ */
+void DatabaseWorker::lookupAnalysis(const QString &key, int maxAge)
 {
-    qDebug() << "\n=== 🚀 SIGINT Panel Starting Up 🚀 ===";
-    
-    ui->setupUi(this);
+    QString response;
+    qint64 createdAt = 0;
 
-    // Connect to DSP state changes
-    if (auto *mainWindow = qobject_cast<MainWindow*>(parent)) {
-        connect(mainWindow, &MainWindow::dspStateChanged, 
-                this, &DockSigint::onDspStateChanged);
+    if (db.isOpen() || db.open()) {
+        QSqlQuery query(db);
+        query.prepare("SELECT response, created_at FROM analysis_cache WHERE key = ? AND created_at >= ?");
+        query.addBindValue(key);
+        query.addBindValue(QDateTime::currentSecsSinceEpoch() - maxAge);
+        if (!query.exec())
+            emit this->error("Error looking up analysis: " + query.lastError().text());
+        else if (query.next()) {
+            response = query.value(0).toString();
+            createdAt = query.value(1).toLongLong();
+        }
     }
 
-    // Set icon explicitly
-    setWindowIcon(QIcon(":/icons/icons/eagle.svg"));
+    emit analysisLookedUp(key, response, createdAt);
+}
 
-    // Initialize web view
-    qDebug() << "🌐 Initializing web view...";
-    webView = new QWebEngineView(ui->chatDisplay);
-    webView->settings()->setAttribute(QWebEngineSettings::JavascriptEnabled, true);
-    webView->settings()->setAttribute(QWebEngineSettings::JavascriptCanAccessClipboard, true);
-    webView->page()->setWebChannel(new QWebChannel(this));
-    auto *layout = new QVBoxLayout(ui->chatDisplay);
-    layout->setContentsMargins(0, 0, 0, 0);
-    layout->addWidget(webView);
-    ui->chatDisplay->setLayout(layout);
-    qDebug() << "✅ Web view initialized";
+/** Store new emissions, or the new state of known ones, in one transaction. */
+void DatabaseWorker::storeEvents(const QVector<SignalEvent> &events)
+{
+    if (!db.isOpen() && !db.open()) {
+        emit this->error("Database not open: " + db.lastError().text());
+        return;
+    }
 
-    // Load environment variables before creating NetworkWorker
-    QString configDir = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
-    QString envPath = QDir(configDir).filePath(".env");
-    if (QFile::exists(envPath)) {
-        QFile envFile(envPath);
+    db.transaction();
+    for (const SignalEvent &e : events) {
+        eventQuery.addBindValue(e.id);
+        eventQuery.addBindValue(e.range);
+        eventQuery.addBindValue(e.start_time);
+        eventQuery.addBindValue(e.stop_time);
+        eventQuery.addBindValue(e.center_freq);
+        eventQuery.addBindValue(e.bandwidth);
+        eventQuery.addBindValue(e.peak_db);
+        eventQuery.addBindValue(e.classification.isEmpty() ? QVariant() : QVariant(e.classification));
+        bool ok = eventQuery.exec();
+
+        if (ok && eventsRtree) {
+            eventIndexQuery.addBindValue(e.id);
+            eventIndexQuery.addBindValue(e.start_time);
+            eventIndexQuery.addBindValue(e.stop_time);
+            eventIndexQuery.addBindValue(e.center_freq - e.bandwidth / 2);
+            eventIndexQuery.addBindValue(e.center_freq + e.bandwidth / 2);
+            ok = eventIndexQuery.exec();
+        }
+
+        if (!ok) {
+            db.rollback();
+            emit this->error("Error storing events: " + eventQuery.lastError().text() +
+                             eventIndexQuery.lastError().text());
+            return;
+        }
+    }
+    if (!db.commit())
+        emit this->error("Failed to commit events: " + db.lastError().text());
+}
+
+/**
+ * Find the emissions active in a time and frequency range.
+ * @param startTime Start of the time range, in seconds since the epoch.
+ * @param stopTime End of the time range.
+ * @param startFreq Start of the frequency range in Hz.
+ * @param stopFreq End of the frequency range.
+ *
+ * An emission is active if it overlaps both ranges. The result is
+ * emitted with eventsFound(), oldest first.
+ */
+void DatabaseWorker::queryEvents(double startTime, double stopTime, double startFreq, double stopFreq)
+{
+    QVector<SignalEvent> events;
+
+    if (db.isOpen() || db.open()) {
+        QSqlQuery query(db);
+        query.prepare(QString("SELECT e.id, e.range, e.start_time, e.stop_time, e.center_freq, "
+                              "e.bandwidth, e.peak_db, e.classification FROM %1 "
+                              "WHERE %2 e.stop_time >= ? AND e.start_time <= ? "
+                              "AND e.center_freq + e.bandwidth / 2 >= ? "
+                              "AND e.center_freq - e.bandwidth / 2 <= ? "
+                              "ORDER BY e.start_time")
+                      .arg(eventsRtree ? "events_rtree r JOIN events e ON e.id = r.id" : "events e",
+                           eventsRtree ? "r.stop_time >= ? AND r.start_time <= ? AND "
+                                         "r.max_freq >= ? AND r.min_freq <= ? AND" : ""));
+        for (int pass = eventsRtree ? 0 : 1; pass < 2; pass++) {
+            query.addBindValue(startTime);
+            query.addBindValue(stopTime);
+            query.addBindValue(startFreq);
+            query.addBindValue(stopFreq);
+        }
+
+        if (!query.exec()) {
+            emit this->error("Error querying events: " + query.lastError().text());
+        }
+        else {
+            while (query.next()) {
+                SignalEvent e;
+                e.id = query.value(0).toLongLong();
+                e.range = query.value(1).toString();
+                e.start_time = query.value(2).toDouble();
+                e.stop_time = query.value(3).toDouble();
+                e.center_freq = query.value(4).toDouble();
+                e.bandwidth = query.value(5).toDouble();
+                e.peak_db = query.value(6).toDouble();
+                e.classification = query.value(7).toString();
+                events.append(e);
+            }
+        }
+    }
+
+    emit eventsFound(events);
+}
+
+/**
+ * Store occupancy tiles. With the tiles of a level the ones older than the
+ * level keeps are dropped, once per closed interval of the level.
+ */
+void DatabaseWorker::storeOccupancy(const QVector<OccupancyTile> &tiles)
+{
+    if (!db.isOpen() && !db.open()) {
+        emit this->error("Database not open: " + db.lastError().text());
+        return;
+    }
+
+    db.transaction();
+    bool pruned[OCCUPANCY_LEVELS] = {};
+    for (const OccupancyTile &t : tiles) {
+        occupancyQuery.addBindValue(t.level);
+        occupancyQuery.addBindValue(t.start);
+        occupancyQuery.addBindValue(t.first_cell);
+        occupancyQuery.addBindValue(t.data);
+        bool ok = occupancyQuery.exec();
+
+        if (ok && !pruned[t.level] && occupancyKeepSeconds[t.level] > 0) {
+            QSqlQuery prune(db);
+            prune.prepare("DELETE FROM occupancy WHERE level = ? AND start_time < ?");
+            prune.addBindValue(t.level);
+            prune.addBindValue(t.start - occupancyKeepSeconds[t.level]);
+            ok = prune.exec();
+            pruned[t.level] = true;
+        }
+
+        if (!ok) {
+            db.rollback();
+            emit this->error("Error storing occupancy: " + occupancyQuery.lastError().text());
+            return;
+        }
+    }
+    if (!db.commit())
+        emit this->error("Failed to commit occupancy: " + db.lastError().text());
+}
+
+/**
+ * Occupancy of a time and frequency range, per OCCUPANCY_CELL_HZ cell.
+ *
+ * The tiles are read from the level OccupancyRecorder::levelFor() picks,
+ * the intervals at the ends of the range count whole. The result is
+ * emitted with occupancyFound().
+ */
+void DatabaseWorker::queryOccupancy(double startTime, double stopTime, double startFreq,
+                                    double stopFreq)
+{
+    const int level = OccupancyRecorder::levelFor(startTime, stopTime,
+                                                  QDateTime::currentSecsSinceEpoch());
+    const qint64 firstCell = (qint64)std::floor(startFreq / OCCUPANCY_CELL_HZ);
+    const qint64 lastCell = (qint64)std::floor(stopFreq / OCCUPANCY_CELL_HZ);
+    const int cells = (int)std::max<qint64>(lastCell - firstCell + 1, 0);
+
+    QVector<quint64> frames(cells, 0);
+    QVector<quint64> occupied(cells, 0);
+    if (db.isOpen() || db.open()) {
+        QSqlQuery query(db);
+        query.prepare("SELECT first_cell, data FROM occupancy "
+                      "WHERE level = ? AND start_time > ? AND start_time < ? "
+                      "AND first_cell <= ? AND first_cell + length(data) / 8 > ?");
+        query.addBindValue(level);
+        query.addBindValue((qint64)std::floor(startTime) - occupancyLevelSeconds[level]);
+        query.addBindValue(stopTime);
+        query.addBindValue(lastCell);
+        query.addBindValue(firstCell);
+
+        if (!query.exec()) {
+            emit this->error("Error querying occupancy: " + query.lastError().text());
+        }
+        else {
+            while (query.next()) {
+                const qint64 first = query.value(0).toLongLong();
+                const QByteArray data = query.value(1).toByteArray();
+                const qint64 from = std::max(first, firstCell);
+                const qint64 to = std::min(first + data.size() / 8, lastCell + 1);
+                for (qint64 c = from; c < to; c++) {
+                    const char *pair = data.constData() + 8 * (c - first);
+                    frames[c - firstCell] += qFromLittleEndian<quint32>(pair);
+                    occupied[c - firstCell] += qFromLittleEndian<quint32>(pair + 4);
+                }
+            }
+        }
+    }
+
+    OccupancyResult result{startTime, stopTime, firstCell * OCCUPANCY_CELL_HZ, level,
+                           QVector<float>(cells, -1.0f), -1.0f, 0};
+    quint64 total = 0;
+    for (int c = 0; c < cells; c++) {
+        if (frames[c] > 0)
+            result.duty[c] = (float)occupied[c] / frames[c];
+        result.frames += frames[c];
+        total += occupied[c];
+    }
+    if (result.frames > 0)
+        result.total = (float)total / result.frames;
+
+    emit occupancyFound(result);
+}
+
+/** Store a signal analysis and drop the expired ones. */
+void DatabaseWorker::storeAnalysis(const QString &key, const QString &response, int maxAge)
+{
+    if (!db.isOpen() && !db.open()) {
+        emit this->error("Database not open: " + db.lastError().text());
+        return;
+    }
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM analysis_cache WHERE created_at < ?");
+    query.addBindValue(now - maxAge);
+    query.exec();
+
+    query.prepare("INSERT OR REPLACE INTO analysis_cache (key, response, created_at) VALUES (?, ?, ?)");
+    query.addBindValue(key);
+    query.addBindValue(response);
+    query.addBindValue(now);
+    if (!query.exec())
+        emit this->error("Error storing analysis: " + query.lastError().text());
+}
+
+DockSigint::DockSigint(receiver *rx_ptr, QWidget *parent) :
+    QDockWidget(parent),
+    ui(new Ui::DockSigint),
+#ifdef WITH_WEBENGINE
+    webView(nullptr),
+    webChannel(nullptr),
+#endif
+    chatView(nullptr),
+    nativeChat(false),
+    chatContainer(nullptr),
+    chatBridge(nullptr),
+    networkWorker(nullptr),
+    databaseWorker(nullptr),
+    networkThread(),
+    databaseThread(),
+    helperProcesses(nullptr),
+    helpersStarted(false),
+    optimizerJob(0),
+#ifdef WITH_EMBEDDED_PYTHON
+    coordinatorThread(nullptr),
+    embeddedCoordinator(nullptr),
+    embeddedFailed(false),
+    coordinatorRequestId(0),
+#endif
+    anthropicApiKey(),
+    currentModel(),
+    currentChatId(1),
+    messageHistory(),
+    historyMem(MEM_CHAT_HISTORY),
+    chatContext(),
+    chatList(),
+    chatHtml(),
+    streamTimer(nullptr),
+    streamPending(),
+    streaming(false),
+    spectrumCapture(nullptr),
+    spectrumSurvey(nullptr),
+    spectrumVisualizer(nullptr),
+    waterfallDisplay(nullptr),
+    rx_ptr(rx_ptr),
+    dsp_running(false),
+    fftSubscription(0),
+    viewSubscription(0),
+    viewFps(SIGINT_VIEW_FPS),
+    viewsSuspended(false),
+    snapshotImages(false),
+    lastFrequency(0),
+    analysisCacheTtl(SIGINT_ANALYSIS_CACHE_TTL),
+    localLlmTasks(QString(SIGINT_LOCAL_LLM_TASKS).split(' ')),
+    classifyTimer(nullptr),
+    classifyButton(nullptr),
+    classifyReader(0),
+    detectButton(nullptr),
+    detectorEnabled(false),
+    baselineButton(nullptr),
+    lastDetectionAnalysis(0),
+    detectionTimer(nullptr),
+    detectionBatchId(0),
+    searchInput(nullptr),
+    searchResults(nullptr),
+    searchTimer(nullptr),
+    currentTab("spectrum"),
+    spectrumContainer(nullptr),
+    waterfallContainer(nullptr)
+{
+    qDebug() << "\n=== 🚀 SIGINT Panel Starting Up 🚀 ===";
+    
+    ui->setupUi(this);
+
+    // Connect to DSP state changes
+    if (auto *mainWindow = qobject_cast<MainWindow*>(parent)) {
+        connect(mainWindow, &MainWindow::dspStateChanged, 
+                this, &DockSigint::onDspStateChanged);
+    }
+
+    // Set icon explicitly
+    setWindowIcon(QIcon(":/icons/icons/eagle.svg"));
+
+    // The web view starts a Chromium process, so it is only created when
+    // the dock is first shown, see initializeWebView()
+    chatBridge = new ChatBridge(this);
+#ifdef WITH_WEBENGINE
+    webChannel = new QWebChannel(this);
+    webChannel->registerObject(QStringLiteral("bridge"), chatBridge);
+#endif
+    chatContainer = new QWidget(this);
+    auto *chatLayout = new QVBoxLayout(chatContainer);
+    chatLayout->setContentsMargins(0, 0, 0, 0);
+    auto *layout = new QVBoxLayout(ui->chatDisplay);
+    layout->setContentsMargins(0, 0, 0, 0);
+    ui->chatDisplay->setLayout(layout);
+
+    // Load environment variables before creating NetworkWorker
+    QString configDir = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
+    QString envPath = QDir(configDir).filePath(".env");
+    if (QFile::exists(envPath)) {
+        QFile envFile(envPath);
         if (envFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
             while (!envFile.atEnd()) {
                 QString line = envFile.readLine().trimmed();
@@ -658,16 +1338,66 @@ DockSigint::DockSigint(receiver *rx_ptr, QWidget *parent) :
     }
 
     // Create worker thread and move NetworkWorker to it
-    QThread *networkThread = new QThread(this);
-    NetworkWorker *networkWorker = new NetworkWorker();
-    networkWorker->moveToThread(networkThread);
+    networkWorker = new NetworkWorker();
+    networkWorker->moveToThread(&networkThread);
 
     // Set up network worker connections
-    connect(networkThread, &QThread::finished, networkWorker, &QObject::deleteLater);
+    connect(&networkThread, &QThread::finished, networkWorker, &QObject::deleteLater);
     connect(this, &DockSigint::sendMessageToWorker, networkWorker, &NetworkWorker::sendMessage);
+    connect(networkWorker, &NetworkWorker::messageDelta, this, &DockSigint::onWorkerMessageDelta);
     connect(networkWorker, &NetworkWorker::messageReceived, this, &DockSigint::onWorkerMessageReceived);
     connect(networkWorker, &NetworkWorker::errorOccurred, this, &DockSigint::onWorkerErrorOccurred);
-    networkThread->start();
+    connect(this, &DockSigint::summarizeInWorker, networkWorker, &NetworkWorker::summarize);
+    connect(this, &DockSigint::cancelInWorker, networkWorker, &NetworkWorker::cancel);
+    connect(networkWorker, &NetworkWorker::analysisReceived, this, [this](const QString &key, const QString &text) {
+        if (analysisCacheTtl > 0)
+            emit storeAnalysisInDb(key, text, analysisCacheTtl);
+        applyReview(key, text);
+    });
+    connect(networkWorker, &NetworkWorker::batchReceived, this, &DockSigint::applyBatch);
+    connect(networkWorker, &NetworkWorker::summaryReady, this, [this](int epoch, const QString &summary) {
+        chatContext.setSummary(epoch, summary);
+    });
+    networkThread.start();
+
+    detectionTimer = new QTimer(this);
+    detectionTimer->setSingleShot(true);
+    connect(detectionTimer, &QTimer::timeout, this, &DockSigint::describeDetections);
+
+    streamTimer = new QTimer(this);
+    streamTimer->setSingleShot(true);
+    streamTimer->setInterval(SIGINT_STREAM_FLUSH_MS);
+    connect(streamTimer, &QTimer::timeout, this, &DockSigint::flushStreamedText);
+
+    signalDetector.setIdAllocator([this]() { return emissionTracker.allocateId(); });
+
+    classifyTimer = new QTimer(this);
+    classifyTimer->setInterval(SIGINT_CLASSIFY_MS);
+    connect(classifyTimer, &QTimer::timeout, this, &DockSigint::classifyChannel);
+
+    // The chat coordinator answers one JSON line per message, see
+    // resources/chat_coordinator.py. Warm it up so the first message does
+    // not wait for the interpreter and the LangChain imports, but after the
+    // receiver has had the CPU to start.
+    helperProcesses = new HelperProcessManager(QCoreApplication::applicationDirPath() + "/../../", this);
+    helperProcesses->addService("coordinator",
+                                QStringList() << "-m" << "resources.chat_coordinator" << "--serve",
+                                COORDINATOR_START_TIMEOUT_MS);
+    QTimer::singleShot(COORDINATOR_START_DELAY_MS, this, &DockSigint::startHelpers);
+
+    QMetaObject::invokeMethod(networkWorker, "preconnect", Qt::QueuedConnection);
+    connect(this, &QDockWidget::visibilityChanged, this, &DockSigint::updateViewSubscription);
+    connect(this, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (!visible)
+            return;
+        initializeWebView();
+        startHelpers();
+    });
+    connect(this, &QDockWidget::visibilityChanged, networkWorker, [this](bool visible) {
+        // Runs in the worker thread
+        if (visible)
+            networkWorker->preconnect();
+    });
     qDebug() << "✅ Network worker started in separate thread";
 
     // Initialize database worker
@@ -686,8 +1416,32 @@ DockSigint::DockSigint(receiver *rx_ptr, QWidget *parent) :
             this, &DockSigint::onCaptureError);
     connect(spectrumCapture.get(), &SpectrumCapture::progressUpdate,
             this, &DockSigint::onCaptureProgress);
+    connect(spectrumCapture.get(), &SpectrumCapture::sweepComplete,
+            this, &DockSigint::onSweepComplete);
+    connect(spectrumCapture.get(), &SpectrumCapture::sweepSegment,
+            this, &DockSigint::sweepSegment);
     qDebug() << "✅ Spectrum capture initialized";
 
+    spectrumSurvey = std::make_unique<SpectrumSurvey>(rx_ptr, spectrumCapture.get());
+    connect(spectrumSurvey.get(), &SpectrumSurvey::visitComplete,
+            this, [this](const SpectrumSurvey::Visit& visit) {
+        SIGINT_LOG(SigintLogger::Info, SigintLogger::Capture,
+                   QString("Survey %1: %2 bins, floor %3 dB, %4% occupied, visit %5%6")
+                   .arg(visit.name).arg(visit.avg_db->size())
+                   .arg(visit.noise_floor_db, 0, 'f', 1)
+                   .arg(100.0 * visit.occupied_fraction, 0, 'f', 1)
+                   .arg(visit.visits).arg(visit.swept ? ", swept" : ""));
+
+        // Emissions are stored for queries by time and frequency
+        if (visit.range >= (int)spectrumSurvey->ranges().size())
+            return;
+        const double threshold = spectrumSurvey->ranges()[visit.range].threshold_db;
+        QVector<SignalEvent> events = emissionTracker.update(visit, threshold);
+        scanRds(visit, events);
+        if (!events.isEmpty())
+            emit storeEventsInDb(events);
+    });
+
     // Initialize spectrum visualizer
     spectrumVisualizer = ui->spectrumVisualizer;
     
@@ -699,70 +1453,41 @@ DockSigint::DockSigint(receiver *rx_ptr, QWidget *parent) :
             double center_freq = result.range.start_freq + bandwidth/2;
             
             // Update both visualizers with the same data
-            spectrumVisualizer->updateData(result.fft_data, center_freq, bandwidth, result.range.sample_rate);
+            SpectrumLevels levels;
+            levels.setFrame(result.fft_data->data(), (int)result.fft_data->size(),
+                            center_freq, bandwidth, result.sample_index);
+            spectrumVisualizer->updateData(levels);
             if (waterfallDisplay) {
                 qDebug() << "🌊 Sending data to waterfall display:";
-                qDebug() << "  - FFT data size:" << result.fft_data.size();
+                qDebug() << "  - FFT data size:" << result.fft_data->size();
                 qDebug() << "  - Center freq:" << center_freq << "Hz";
                 qDebug() << "  - Bandwidth:" << bandwidth << "Hz";
                 qDebug() << "  - Sample rate:" << result.range.sample_rate << "Hz";
-                waterfallDisplay->updateData(result.fft_data, center_freq, bandwidth, result.range.sample_rate);
+                waterfallDisplay->updateData(levels);
             } else {
                 qDebug() << "❌ Waterfall display not initialized";
             }
         }
     });
 
-    // Test direct database access
-    {
-        // Create a new scope for database objects
-        {
-            QSqlDatabase testDb = QSqlDatabase::addDatabase("QSQLITE", "TestConnection");
-            testDb.setDatabaseName(dbPath);
-            if (testDb.open()) {
-                qDebug() << "🎯 Test database connection successful";
-                // Create a new scope for query
-                {
-                    QSqlQuery query(testDb);
-                    
-                    // Create tables if they don't exist
-                    if (!query.exec("CREATE TABLE IF NOT EXISTS chats ("
-                                  "id INTEGER PRIMARY KEY,"
-                                  "name TEXT NOT NULL,"
-                                  "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
-                                  ")")) {
-                        qDebug() << "❌ Failed to create chats table:" << query.lastError().text();
-                    }
-                    
-                    if (!query.exec("CREATE TABLE IF NOT EXISTS messages ("
-                                  "id INTEGER PRIMARY KEY,"
-                                  "chat_id INTEGER,"
-                                  "role TEXT NOT NULL,"
-                                  "content TEXT NOT NULL,"
-                                  "timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
-                                  "FOREIGN KEY (chat_id) REFERENCES chats(id)"
-                                  ")")) {
-                        qDebug() << "❌ Failed to create messages table:" << query.lastError().text();
-                    }
-
-                    // Insert test chat
-                    if (!query.exec("INSERT OR IGNORE INTO chats (id, name) VALUES (1, 'Test Chat')")) {
-                        qDebug() << "❌ Failed to insert test chat:" << query.lastError().text();
-                    }
-                } // query goes out of scope here
-                testDb.close();
-            } else {
-                qDebug() << "❌ Test database connection failed:" << testDb.lastError().text();
-            }
-        } // testDb goes out of scope here
-        QSqlDatabase::removeDatabase("TestConnection");
-    }
-
+    // Opened in its thread, before the requests queued below
     databaseWorker = new DatabaseWorker(dbPath);
     databaseWorker->moveToThread(&databaseThread);
+    QMetaObject::invokeMethod(databaseWorker, "initializeDatabase", Qt::QueuedConnection);
     connect(&databaseThread, &QThread::finished, databaseWorker, &QObject::deleteLater);
     connect(this, &DockSigint::saveMessageToDb, databaseWorker, &DatabaseWorker::saveMessage);
+    connect(this, &DockSigint::searchMessagesInDb, databaseWorker, &DatabaseWorker::searchMessages);
+    connect(databaseWorker, &DatabaseWorker::searchFound, this, &DockSigint::onSearchFound);
     connect(this, &DockSigint::loadHistoryFromDb, databaseWorker, &DatabaseWorker::loadChatHistory);
+    connect(this, &DockSigint::lookupAnalysisInDb, databaseWorker, &DatabaseWorker::lookupAnalysis);
+    connect(this, &DockSigint::storeAnalysisInDb, databaseWorker, &DatabaseWorker::storeAnalysis);
+    connect(this, &DockSigint::storeEventsInDb, databaseWorker, &DatabaseWorker::storeEvents);
+    connect(this, &DockSigint::queryEventsInDb, databaseWorker, &DatabaseWorker::queryEvents);
+    connect(&occupancy, &OccupancyRecorder::tilesReady, databaseWorker, &DatabaseWorker::storeOccupancy);
+    connect(this, &DockSigint::queryOccupancyInDb, databaseWorker, &DatabaseWorker::queryOccupancy);
+    connect(databaseWorker, &DatabaseWorker::occupancyFound, this, &DockSigint::occupancyFound);
+    connect(databaseWorker, &DatabaseWorker::eventsFound, this, &DockSigint::eventsFound);
+    connect(databaseWorker, &DatabaseWorker::analysisLookedUp, this, &DockSigint::onAnalysisLookedUp);
     connect(databaseWorker, &DatabaseWorker::messageSaved, this, [this](qint64 id) {
         qDebug() << "✅ Message saved with ID:" << id;
         if (!messageHistory.isEmpty())
@@ -771,17 +1496,35 @@ DockSigint::DockSigint(receiver *rx_ptr, QWidget *parent) :
     connect(databaseWorker, &DatabaseWorker::error, this, [](const QString &error) {
         qDebug() << "❌ Database worker error:" << error;
     });
-    connect(databaseWorker, &DatabaseWorker::historyLoaded, this, [this](const QVector<QPair<QString, QString>> &messages) {
+    connect(databaseWorker, &DatabaseWorker::historyLoaded, this, [this](int chatId, int offset,
+                                                                         const QVector<QPair<QString, QString>> &messages,
+                                                                         bool more) {
+        if (chatId != currentChatId)
+            return;  // switched chats meanwhile
+
         qDebug() << "📚 Loading" << messages.size() << "messages into view";
-        messageHistory.clear();
+        QJsonArray page;
+        for (const auto &msg : messages)
+            page.append(ChatBridge::message(msg.first, msg.second));
+
+        // Older pages only go to the view, the context starts with the newest page
+        if (offset > 0) {
+            chatBridge->prepend(page, more);
+            return;
+        }
+
+        clearHistory();
+        chatContext.clear();
         for (const auto &msg : messages) {
             Message newMsg;
             newMsg.id = -1;
             newMsg.role = msg.first;
             newMsg.content = msg.second;
-            messageHistory.append(newMsg);
-            appendMessageToView(newMsg.content, newMsg.role == "user");
+            appendHistory(newMsg);
+            chatContext.append(newMsg.role, newMsg.content);
         }
+        chatBridge->clear();
+        chatBridge->prepend(page, more);
         
         // Add placeholder message if chat is empty
         if (messages.isEmpty()) {
@@ -792,7 +1535,7 @@ DockSigint::DockSigint(receiver *rx_ptr, QWidget *parent) :
                                 "• Ask questions about signal types and characteristics\n"
                                 "• Get help with SDR settings and configurations\n\n"
                                 "What would you like to do?";
-            appendMessageToView(placeholder, false);
+            chatBridge->append("assistant", placeholder, true);
         }
     });
     connect(databaseWorker, &DatabaseWorker::chatsLoaded, this, &DockSigint::onChatsLoaded);
@@ -804,9 +1547,9 @@ DockSigint::DockSigint(receiver *rx_ptr, QWidget *parent) :
         
         // First switch to the new chat
         currentChatId = chatId;
-        messageHistory.clear();
+        clearHistory();
         clearChat();
-        emit loadHistoryFromDb(chatId);
+        emit loadHistoryFromDb(chatId, 0);
         
         // Then update the selector and force the correct selection
         ui->chatSelector->blockSignals(true);
@@ -855,43 +1598,14 @@ DockSigint::DockSigint(receiver *rx_ptr, QWidget *parent) :
     // Initialize chat HTML
     chatHtml = getBaseHtml();
     
-    // Connect loadFinished signal before setting HTML content
-    connect(webView->page(), &QWebEnginePage::loadFinished, this, [this](bool ok) {
-        if (ok) {
-            // Initialize JavaScript functions after page loads
-            webView->page()->runJavaScript(
-                "window.scrollToBottom = function() {"
-                "    const container = document.getElementById('chat-container');"
-                "    if (container) container.scrollTop = container.scrollHeight;"
-                "};"
-                "window.appendMessage = function(html) {"
-                "    const messages = document.getElementById('messages');"
-                "    if (messages) {"
-                "        messages.insertAdjacentHTML('beforeend', html);"
-                "        scrollToBottom();"
-                "    }"
-                "};"
-                "if (!document.getElementById('messages')) {"
-                "    const container = document.getElementById('chat-container');"
-                "    if (container) {"
-                "        const messages = document.createElement('div');"
-                "        messages.id = 'messages';"
-                "        container.appendChild(messages);"
-                "    }"
-                "}"
-            );
-            
-            // Load chat history
-            emit loadHistoryFromDb(currentChatId);
-            if (messageHistory.isEmpty()) {
-                appendMessage("👋 Welcome to the Aguila SIGINT platform. Claude has the helm.", false);
-            }
-        }
+    // Load the history once the page has connected to the bridge
+    connect(chatBridge, &ChatBridge::ready, this, [this]() {
+        emit loadHistoryFromDb(currentChatId, 0);
+    });
+    connect(chatBridge, &ChatBridge::olderRequested, this, [this](int offset) {
+        emit loadHistoryFromDb(currentChatId, offset);
     });
 
-    // Set the HTML content
-    updateChatView();
-    
     // Connect chat management signals
     connect(ui->newChatButton, &QPushButton::clicked, this, &DockSigint::onNewChatClicked);
     connect(ui->chatSelector, QOverload<int>::of(&QComboBox::currentIndexChanged),
@@ -901,15 +1615,18 @@ DockSigint::DockSigint(receiver *rx_ptr, QWidget *parent) :
     auto *captureShortcut = new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_G), this);
     connect(captureShortcut, &QShortcut::activated, this, &DockSigint::testSpectrumCapture);
 
+    // Sweep four receiver bandwidths around the current frequency (Ctrl+Shift+G)
+    auto *sweepShortcut = new QShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_G), this);
+    connect(sweepShortcut, &QShortcut::activated, this, &DockSigint::testSpectrumSweep);
+
     // Add screenshot shortcut (Ctrl+P)
     auto *screenshotShortcut = new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_P), this);
     connect(screenshotShortcut, &QShortcut::activated, this, &DockSigint::captureWaterfallScreenshot);
 
-    // Load existing chats
-    databaseWorker->loadAllChats();
-    
-    // Load last active chat setting
-    databaseWorker->loadSetting("last_active_chat");
+    // Load existing chats and the last active one, in the database thread
+    QMetaObject::invokeMethod(databaseWorker, "loadAllChats", Qt::QueuedConnection);
+    QMetaObject::invokeMethod(databaseWorker, "loadSetting", Qt::QueuedConnection,
+                              Q_ARG(QString, QStringLiteral("last_active_chat")));
 
     // Initialize tab system
     currentTab = "spectrum";
@@ -917,16 +1634,6 @@ DockSigint::DockSigint(receiver *rx_ptr, QWidget *parent) :
     waterfallContainer = new QWidget(this);
     setupTabSystem();
     
-    // Create the web channel
-    QWebChannel *channel = new QWebChannel(this);
-    webView->page()->setWebChannel(channel);
-    
-    // Register this object to handle JavaScript calls
-    channel->registerObject(QStringLiteral("qt"), this);
-    
-    // Load the HTML
-    webView->setHtml(getBaseHtml());
-    
     qDebug() << "\n=== SIGINT Panel Initialization ===";
     qDebug() << "App directory:" << QCoreApplication::applicationDirPath();
     qDebug() << "Current working directory:" << QDir::currentPath();
@@ -939,10 +1646,58 @@ DockSigint::DockSigint(receiver *rx_ptr, QWidget *parent) :
     // Add at the start of the class implementation, after member initialization
     m_lastActiveChatLoaded = false;
     m_chatsLoaded = false;
+
+    // Share the frames computed for the main plotter instead of running
+    // another FFT; frames are published on the GUI thread
+    if (rx_ptr) {
+        fftSubscription = rx_ptr->subscribe_iq_fft([this](const iq_fft_frame_sptr &frame) {
+            const qint64 ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                  frame->timestamp.time_since_epoch()).count();
+            // Captures render from this history, so it is fed while hidden too
+            waterfallSnapshot.addFrame(frame->data.data(), (int)frame->data.size(),
+                                       frame->center_freq, frame->sample_rate, (uint64_t)ms);
+            waterfallTiles.addFrame(frame->data.data(), (int)frame->data.size(),
+                                    frame->center_freq, frame->sample_rate, (uint64_t)ms);
+            occupancy.addFrame(frame->data.data(), (int)frame->data.size(),
+                               frame->center_freq, frame->sample_rate, ms);
+            spectrumBaseline.process(frame->data.data(), (int)frame->data.size(),
+                                     frame->center_freq, frame->sample_rate, frame->seq);
+            if (detectorEnabled &&
+                detectorLevels.setFrame(frame->data.data(), (int)frame->data.size(),
+                                        frame->center_freq, frame->sample_rate, frame->seq))
+                runDetector(ms);
+#ifdef WITH_EMBEDDED_PYTHON
+            EmbeddedCoordinator::setFrame(frame);
+#endif
+        });
+    }
 }
 
 DockSigint::~DockSigint()
 {
+    if (rx_ptr && fftSubscription)
+        rx_ptr->unsubscribe_iq_fft(fftSubscription);
+    updateViewSubscription(false);
+
+    // The open intervals are written before the database thread stops
+    disconnect(&occupancy, nullptr, databaseWorker, nullptr);
+    connect(&occupancy, &OccupancyRecorder::tilesReady, databaseWorker,
+            &DatabaseWorker::storeOccupancy, Qt::BlockingQueuedConnection);
+    occupancy.flush();
+
+    helperProcesses->shutdown();
+#ifdef WITH_EMBEDDED_PYTHON
+    // A call into Python cannot be interrupted. If one is still running the
+    // thread is left to finish it rather than blocking the exit.
+    coordinatorRequests.clear();
+    if (coordinatorThread) {
+        coordinatorThread->quit();
+        if (coordinatorThread->wait(COORDINATOR_EMBEDDED_STOP_MS))
+            delete coordinatorThread;
+        else
+            qWarning() << "Embedded chat coordinator still busy, not waiting for it";
+    }
+#endif
     networkThread.quit();
     networkThread.wait();
     databaseThread.quit();
@@ -975,6 +1730,9 @@ void DockSigint::loadEnvironmentVariables()
                     anthropicApiKey = line.mid(18).trimmed();
                     qDebug() << "API key found, length:" << anthropicApiKey.length();
                 }
+                else if (line.startsWith("LOCAL_LLM_API_KEY=")) {
+                    localLlmKey = line.mid(18).trimmed();
+                }
                 else if (line.startsWith("AI_MODEL=")) {
                     currentModel = line.mid(9).trimmed();
                     qDebug() << "Model found:" << currentModel;
@@ -1007,7 +1765,46 @@ void DockSigint::saveSettings(QSettings *settings)
         return;
 
     settings->beginGroup("SIGINT");
-    // Add settings as needed
+    if (chatContext.budget() != CHAT_CONTEXT_TOKENS)
+        settings->setValue("context_tokens", chatContext.budget());
+    else
+        settings->remove("context_tokens");
+    if (snapshotImages)
+        settings->setValue("snapshot_images", true);
+    else
+        settings->remove("snapshot_images");
+    if (nativeChat)
+        settings->setValue("native_chat", true);
+    else
+        settings->remove("native_chat");
+    if (analysisCacheTtl != SIGINT_ANALYSIS_CACHE_TTL)
+        settings->setValue("analysis_cache_ttl", analysisCacheTtl);
+    else
+        settings->remove("analysis_cache_ttl");
+    if (classifyButton && classifyButton->isChecked())
+        settings->setValue("classifier", true);
+    else
+        settings->remove("classifier");
+    if (detectorEnabled)
+        settings->setValue("detector", true);
+    else
+        settings->remove("detector");
+    if (signalDetector.threshold() != SIGNAL_DETECTOR_THRESHOLD_DB)
+        settings->setValue("detector_threshold", signalDetector.threshold());
+    else
+        settings->remove("detector_threshold");
+    if (!localLlmUrl.isEmpty())
+        settings->setValue("local_llm_url", localLlmUrl);
+    else
+        settings->remove("local_llm_url");
+    if (!localLlmModel.isEmpty())
+        settings->setValue("local_llm_model", localLlmModel);
+    else
+        settings->remove("local_llm_model");
+    if (localLlmTasks.join(' ') != SIGINT_LOCAL_LLM_TASKS)
+        settings->setValue("local_llm_tasks", localLlmTasks.join(' '));
+    else
+        settings->remove("local_llm_tasks");
     settings->endGroup();
 }
 
@@ -1017,8 +1814,48 @@ void DockSigint::readSettings(QSettings *settings)
         return;
 
     settings->beginGroup("SIGINT");
-    // Add settings as needed
+    chatContext.setBudget(settings->value("context_tokens", CHAT_CONTEXT_TOKENS).toInt());
+    snapshotImages = settings->value("snapshot_images", false).toBool();
+    nativeChat = settings->value("native_chat", false).toBool();
+    analysisCacheTtl = settings->value("analysis_cache_ttl", SIGINT_ANALYSIS_CACHE_TTL).toInt();
+    if (classifyButton)
+        classifyButton->setChecked(settings->value("classifier", false).toBool());
+    signalDetector.setThreshold(settings->value("detector_threshold", SIGNAL_DETECTOR_THRESHOLD_DB).toFloat());
+    setDetectorEnabled(settings->value("detector", false).toBool());
+    localLlmUrl = settings->value("local_llm_url").toString();
+    localLlmModel = settings->value("local_llm_model").toString();
+    localLlmTasks = settings->value("local_llm_tasks", SIGINT_LOCAL_LLM_TASKS).toString()
+                    .split(' ', Qt::SkipEmptyParts);
     settings->endGroup();
+    applyBackends();
+}
+
+/**
+ * Route the tasks in localLlmTasks to the local LLM server, and the
+ * others to Claude.
+ *
+ * A small model on the LAN answers the short analysis and summary requests
+ * much sooner than the API over a slow uplink, or when there is no uplink,
+ * while the chat keeps the larger model.
+ */
+void DockSigint::applyBackends()
+{
+    for (int priority = 0; priority < NetworkWorker::PriorityCount; priority++) {
+        const bool local = isLocal(priority);
+        QMetaObject::invokeMethod(networkWorker, "setBackend", Qt::QueuedConnection,
+                                  Q_ARG(int, priority),
+                                  Q_ARG(QString, local ? localLlmUrl : QString()),
+                                  Q_ARG(QString, localLlmModel),
+                                  Q_ARG(QString, localLlmKey));
+    }
+    QMetaObject::invokeMethod(networkWorker, "preconnect", Qt::QueuedConnection);
+}
+
+/* Whether requests of a NetworkWorker priority go to the local server */
+bool DockSigint::isLocal(int priority) const
+{
+    static const char *tasks[NetworkWorker::PriorityCount] = {"chat", "analysis", "summary"};
+    return !localLlmUrl.isEmpty() && localLlmTasks.contains(tasks[priority]);
 }
 
 void DockSigint::onSendClicked()
@@ -1028,12 +1865,79 @@ void DockSigint::onSendClicked()
     if (!message.isEmpty()) {
         qDebug() << "Message:" << message;
         appendMessage(message);
-        sendToClaude(message);
+        if (!handleTuningCommand(message) && !handleCaptureCommand(message))
+            sendToClaude(message);
         ui->chatInput->clear();
     }
     qDebug() << "=== Send Complete ===\n";
 }
 
+/**
+ * Handle plain tuning commands locally.
+ *
+ * Unambiguous commands ("tune to 146.52", "7.074 MHz usb") are applied
+ * through the same MainWindow slots as the remote control, so the
+ * frequency control, plotter and receiver stay in sync. Everything else
+ * goes to the coordinator and Claude.
+ */
+bool DockSigint::handleTuningCommand(const QString &message)
+{
+    TuningIntent intent;
+    if (!intent.parse(message))
+        return false;
+
+    // Mode first, since a mode change resets the filter
+    if (intent.hasMode())
+        emit newMode(intent.mode());
+    if (intent.hasPassband())
+        emit newPassband(intent.passband());
+    if (intent.hasFrequency())
+        emit newFrequency(intent.frequency());
+
+    SIGINT_LOG(SigintLogger::Info, SigintLogger::General,
+               QString("Tuning command handled locally: %1").arg(intent.describe()));
+    appendMessage(QString("✅ %1").arg(intent.describe()), false);
+    return true;
+}
+
+/**
+ * Handle "capture" locally: write what the pre-trigger ring holds and what
+ * follows to a SigMF file, see IqCapture.
+ */
+bool DockSigint::handleCaptureCommand(const QString &message)
+{
+    static const QRegularExpression capture(
+        "^\\s*capture(\\s+(iq|i/q|this|it|the signal))?\\s*[.!]?\\s*$",
+        QRegularExpression::CaseInsensitiveOption);
+    if (!capture.match(message).hasMatch())
+        return false;
+
+    emit iqCaptureRequested(QString("Chat: %1").arg(message.trimmed()));
+    appendMessage("✅ I/Q capture requested", false);
+    return true;
+}
+
+/**
+ * Receiver tuned to a new frequency.
+ *
+ * Signal analysis requests still waiting for Claude describe the old
+ * frequency, so they are cancelled.
+ */
+void DockSigint::setNewFrequency(qint64 rx_freq)
+{
+    if (rx_freq == lastFrequency)
+        return;
+    lastFrequency = rx_freq;
+    emit cancelInWorker(NetworkWorker::Analysis);
+    pendingBatches.clear();
+    detectionQueue.clear();
+
+    // A new channel starts a new classification
+    closeChannelEvent();
+    channelClass.label.clear();
+    channelClass.count = 0;
+}
+
 void DockSigint::onReturnPressed()
 {
     onSendClicked();
@@ -1050,35 +1954,22 @@ void DockSigint::sendToClaude(const QString &message, std::function<void(const Q
     qDebug() << "=== Send Initiated ===\n";
 }
 
-void DockSigint::sendToClaude(const QString &message, const QByteArray &imageData, std::function<void(const QString&)> callback)
+void DockSigint::sendToClaude(const QString &message, const QByteArray &imageData, std::function<void(const QString&)> callback,
+                              int priority, const QString &cacheKey)
 {
     qDebug() << "\n=== 📤 Sending Message to Claude (with potential image) ===";
     qDebug() << "Message:" << message;
     qDebug() << "Has image data:" << !imageData.isEmpty();
     
-    if (anthropicApiKey.isEmpty()) {
+    if (anthropicApiKey.isEmpty() && !isLocal(priority)) {
         qDebug() << "❌ Error: API key is empty";
         appendMessage("Error: API key not found. Please check your .env file.", false);
         return;
     }
 
-    // Prepare the messages array with history
-    QJsonArray messages;
-    for (const auto &msg : messageHistory) {
-        messages.append(QJsonObject{
-            {"role", msg.role == "user" ? "user" : "assistant"},
-            {"content", msg.content}
-        });
-    }
-
-    // Add the current message
-    if (imageData.isEmpty()) {
-        // Text-only message
-        messages.append(QJsonObject{
-            {"role", "user"},
-            {"content", message}
-        });
-    } else {
+    // Content of the current message
+    QJsonValue content = message;
+    if (!imageData.isEmpty()) {
         // Message with image
         QString base64Image = QString::fromLatin1(imageData.toBase64());
         
@@ -1098,42 +1989,245 @@ void DockSigint::sendToClaude(const QString &message, const QByteArray &imageDat
         QJsonArray contentArray;
         contentArray.append(imageContent);
         contentArray.append(textContent);
-
-        messages.append(QJsonObject{
-            {"role", "user"},
-            {"content", contentArray}
-        });
+        content = contentArray;
     }
 
+    // Recent turns within the token budget, older ones are in the summary
+    QJsonArray system;
+    QJsonArray messages;
+    chatContext.build(message, content, system, messages);
     qDebug() << "Message history size:" << messages.size();
-    
-    // Connect a one-time handler for the response if callback provided
-    if (callback) {
-        QMetaObject::Connection *connection = new QMetaObject::Connection;
-        *connection = connect(networkWorker, &NetworkWorker::messageReceived,
-                            this, [this, callback, connection](const QString &response) {
-            // Disconnect after receiving the response
-            QObject::disconnect(*connection);
-            delete connection;
-            
-            // Call the callback with the response
-            callback(response);
-        });
+
+    if (chatContext.summaryNeeded() && (!anthropicApiKey.isEmpty() || isLocal(NetworkWorker::Background))) {
+        int epoch;
+        const QJsonArray request = chatContext.summaryRequest(epoch);
+        emit summarizeInWorker(anthropicApiKey, currentModel, request, epoch);
     }
     
-    qDebug() << "🚀 Emitting sendMessageToWorker signal";
-    emit sendMessageToWorker(anthropicApiKey, currentModel, messages);
-    
+    auto send = [this, callback, system, messages, priority, cacheKey]() {
+        // Connect a one-time handler for the response if callback provided
+        if (callback) {
+            QMetaObject::Connection *connection = new QMetaObject::Connection;
+            *connection = connect(networkWorker, &NetworkWorker::messageReceived,
+                                this, [this, callback, connection](const QString &response) {
+                // Disconnect after receiving the response
+                QObject::disconnect(*connection);
+                delete connection;
+
+                // Call the callback with the response
+                callback(response);
+            });
+        }
+
+        qDebug() << "🚀 Emitting sendMessageToWorker signal";
+        emit sendMessageToWorker(anthropicApiKey, currentModel, system, messages, priority, cacheKey);
+    };
+
+    if (priority != NetworkWorker::Interactive) {
+        send();
+        return;
+    }
+
+    // Chat messages go to the coordinator first, tuning requests bypass Claude
+    analyzeTuningRequest(message, [this, callback, send](bool tuning) {
+        if (!tuning) {
+            send();
+            return;
+        }
+        const QString reply = "✅ Tuning request processed - adjusting radio frequency...";
+        onWorkerMessageReceived(reply, false);
+        if (callback)
+            callback(reply);
+    });
+
     qDebug() << "=== Send Complete ===\n";
 }
 
-void DockSigint::onWorkerMessageReceived(const QString &message)
+/**
+ * Ask the chat coordinator whether a message asks to tune the receiver.
+ * @param done Called with the answer, with false if the coordinator is not
+ *             available or does not answer within COORDINATOR_REQUEST_TIMEOUT_MS.
+ *
+ * The coordinator is a helper service, or runs in the embedded interpreter
+ * when built with it. Either way the dock does not wait for it; messages
+ * typed meanwhile queue behind this one and keep their order.
+ */
+void DockSigint::analyzeTuningRequest(const QString &message, const std::function<void(bool)> &done)
 {
-    appendMessage(message, false);
+    startHelpers();
+    QElapsedTimer timer;
+    timer.start();
+
+#ifdef WITH_EMBEDDED_PYTHON
+    if (!embeddedFailed) {
+        // Answered by the evaluated() handler, or by the timeout, whichever
+        // comes first; the other one finds the request gone
+        const qint64 id = ++coordinatorRequestId;
+        coordinatorRequests.insert(id, [this, done, timer](bool ok, const QJsonObject &result) {
+            if (!ok) {
+                SIGINT_LOG(SigintLogger::Error, SigintLogger::Network,
+                           "Chat coordinator not available, sending the message to Claude");
+                done(false);
+                return;
+            }
+            done(requiresTuning(result, timer.elapsed()));
+        });
+        QTimer::singleShot(COORDINATOR_REQUEST_TIMEOUT_MS, this, [this, id]() {
+            auto done = coordinatorRequests.take(id);
+            if (done)
+                done(false, QJsonObject());
+        });
+        QMetaObject::invokeMethod(embeddedCoordinator, "evaluate", Qt::QueuedConnection,
+                                  Q_ARG(qint64, id), Q_ARG(QString, message));
+        return;
+    }
+#endif
+
+    helperProcesses->request("coordinator", QJsonObject{{"message", message}},
+                             COORDINATOR_REQUEST_TIMEOUT_MS,
+                             [this, done, timer](bool ok, const QJsonObject &reply) {
+        if (!ok) {
+            SIGINT_LOG(SigintLogger::Error, SigintLogger::Network,
+                       "Chat coordinator not available, sending the message to Claude");
+            done(false);
+            return;
+        }
+        done(requiresTuning(reply["result"].toObject(), timer.elapsed()));
+    });
+}
+
+/** Read and log the result of ChatCoordinator.evaluate_request(). */
+bool DockSigint::requiresTuning(const QJsonObject &result, qint64 elapsedMs) const
+{
+    const bool tuning = result["requires_tuning"].toString() == "true";
+    SIGINT_LOG(SigintLogger::Debug, SigintLogger::Network,
+               QString("Tuning analysis in %1 ms: tuning %2, confidence %3, frequency %4")
+               .arg(elapsedMs)
+               .arg(tuning ? "yes" : "no")
+               .arg(result["confidence"].toString())
+               .arg(result["frequency_mentioned"].toString()));
+    return tuning;
+}
+
+#ifdef WITH_EMBEDDED_PYTHON
+/**
+ * Start the coordinator in the embedded interpreter.
+ *
+ * Messages sent before it is ready wait in its thread. If it cannot be
+ * created, for example because LangChain is missing from the Python the
+ * program was built against, the coordinator process is used instead.
+ */
+void DockSigint::startEmbeddedCoordinator()
+{
+    coordinatorThread = new QThread;
+    coordinatorThread->setObjectName("EmbeddedCoordinator");
+    embeddedCoordinator = new EmbeddedCoordinator(helperProcesses->root());
+    embeddedCoordinator->moveToThread(coordinatorThread);
+
+    connect(coordinatorThread, &QThread::started, embeddedCoordinator, &EmbeddedCoordinator::start);
+    // The interpreter is finalized in its own thread
+    connect(coordinatorThread, &QThread::finished, embeddedCoordinator, &QObject::deleteLater);
+    connect(embeddedCoordinator, &EmbeddedCoordinator::ready, this,
+            [this](bool ok, const QString &error) {
+        if (ok)
+            return;
+        qWarning() << "Embedded chat coordinator failed, starting the coordinator process:" << error;
+        embeddedFailed = true;
+        helperProcesses->warmUp("coordinator");
+    });
+    connect(embeddedCoordinator, &EmbeddedCoordinator::evaluated, this,
+            [this](qint64 id, bool ok, const QJsonObject &result) {
+        auto done = coordinatorRequests.take(id);
+        if (done)
+            done(ok, result);
+    });
+
+    coordinatorThread->start();
+}
+#endif
+
+/**
+ * Show streamed reply text.
+ *
+ * The first delta of a reply starts an empty assistant message. Text is
+ * then collected and sent to the page once per SIGINT_STREAM_FLUSH_MS,
+ * rather than once per delta.
+ */
+void DockSigint::onWorkerMessageDelta(const QString &text)
+{
+    if (!streaming) {
+        streaming = true;
+        streamPending.clear();
+        chatBridge->beginStream();
+    }
+    streamPending += text;
+    if (!streamTimer->isActive())
+        streamTimer->start();
+}
+
+void DockSigint::flushStreamedText()
+{
+    if (streamPending.isEmpty())
+        return;
+    chatBridge->appendStream(streamPending);
+    streamPending.clear();
+}
+
+/* Replace the streamed text by the complete reply and store it like appendMessage() */
+void DockSigint::finishStreamedMessage(const QString &message)
+{
+    streamTimer->stop();
+    streamPending.clear();
+    streaming = false;
+    chatBridge->endStream(message, true);
+
+    Message msg;
+    msg.id = -1;
+    msg.role = "assistant";
+    msg.content = message;
+    appendHistory(msg);
+    chatContext.append(msg.role, msg.content);
+    emit saveMessageToDb(currentChatId, msg.role, msg.content, messageMeta());
+}
+
+/* Keep a message in memory, without the oldest ones over the cap of MEM_CHAT_HISTORY */
+void DockSigint::appendHistory(const Message &msg)
+{
+    auto messageBytes = [](const Message &m) {
+        return (qint64)sizeof(m) + (qint64)(m.role.size() + m.content.size()) * (qint64)sizeof(QChar);
+    };
+    messageHistory.append(msg);
+    qint64 bytes = historyMem.bytes() + messageBytes(msg);
+    while (messageHistory.size() > 1 && historyMem.allowed(bytes) < bytes) {
+        bytes -= messageBytes(messageHistory.first());
+        messageHistory.removeFirst();
+    }
+    historyMem.set(bytes);
+}
+
+void DockSigint::clearHistory()
+{
+    messageHistory.clear();
+    historyMem.set(0);
+}
+
+void DockSigint::onWorkerMessageReceived(const QString &message, bool streamed)
+{
+    if (streamed && streaming)
+        finishStreamedMessage(message);
+    else
+        appendMessage(message, false);
 }
 
-void DockSigint::onWorkerErrorOccurred(const QString &error)
+void DockSigint::onWorkerErrorOccurred(const QString &error, bool streamed)
 {
+    // Keep the part of a reply that was streamed before the error
+    if (streamed && streaming) {
+        flushStreamedText();
+        streamTimer->stop();
+        streaming = false;
+        chatBridge->endStream(QString(), false);
+    }
     appendMessage(error, false);
 }
 
@@ -1147,14 +2241,15 @@ QString DockSigint::getDatabasePath()
 void DockSigint::loadChats()
 {
     qDebug() << "Loading all chats...";
-    emit loadHistoryFromDb(currentChatId);
+    emit loadHistoryFromDb(currentChatId, 0);
 }
 
 void DockSigint::createNewChat()
 {
     int newChatNum = chatList.isEmpty() ? 1 : chatList.last().id + 1;
     QString chatName = QString("Chat %1").arg(newChatNum);
-    databaseWorker->createChat(chatName);
+    QMetaObject::invokeMethod(databaseWorker, "createChat", Qt::QueuedConnection,
+                              Q_ARG(QString, chatName));
 }
 
 void DockSigint::switchToChat(int chatId)
@@ -1162,12 +2257,14 @@ void DockSigint::switchToChat(int chatId)
     if (chatId == currentChatId) return;
 
     currentChatId = chatId;
-    messageHistory.clear();
+    clearHistory();
     clearChat();
-    emit loadHistoryFromDb(currentChatId);
+    emit loadHistoryFromDb(currentChatId, 0);
     
     // Save the last active chat
-    databaseWorker->saveSetting("last_active_chat", QString::number(chatId));
+    QMetaObject::invokeMethod(databaseWorker, "saveSetting", Qt::QueuedConnection,
+                              Q_ARG(QString, QStringLiteral("last_active_chat")),
+                              Q_ARG(QString, QString::number(chatId)));
 }
 
 void DockSigint::updateChatSelector()
@@ -1186,7 +2283,7 @@ void DockSigint::updateChatSelector()
 
 void DockSigint::clearChat()
 {
-    webView->page()->runJavaScript("document.getElementById('messages').innerHTML = '';");
+    chatBridge->clear();
 }
 
 void DockSigint::onNewChatClicked()
@@ -1202,6 +2299,39 @@ void DockSigint::onChatSelected(int index)
     }
 }
 
+/* Show the hits of a search, unless the text has changed since */
+void DockSigint::onSearchFound(const QString &text, const QVector<SearchHit> &hits)
+{
+    if (!searchInput || text != searchInput->text())
+        return;
+
+    searchResults->clear();
+    for (const SearchHit &hit : hits) {
+        QStringList header;
+        header << hit.chatName << hit.timestamp;
+        if (!hit.meta.isEmpty())
+            header << hit.meta;
+        auto *item = new QListWidgetItem(header.join(" | ") + "\n" + hit.snippet.simplified());
+        item->setData(Qt::UserRole, hit.chatId);
+        item->setToolTip(hit.role);
+        searchResults->addItem(item);
+    }
+    if (hits.isEmpty() && !text.trimmed().isEmpty()) {
+        auto *item = new QListWidgetItem("No messages found");
+        item->setFlags(Qt::NoItemFlags);
+        searchResults->addItem(item);
+    }
+}
+
+/* Receiver state stored with a message, so a search finds it by frequency and modulation */
+QString DockSigint::messageMeta() const
+{
+    QString meta = QString("%1 MHz").arg(lastFrequency / 1e6, 0, 'f', 6);
+    if (channelClass.count >= SIGINT_CLASSIFY_STABLE && !channelClass.label.isEmpty())
+        meta += " " + channelClass.label;
+    return meta;
+}
+
 void DockSigint::onChatsLoaded(const QVector<QPair<int, QString>> &chats)
 {
     qDebug() << "\n=== 📚 Chats Loaded ===";
@@ -1247,11 +2377,11 @@ void DockSigint::onCaptureStarted(const SpectrumCapture::CaptureRange& range)
 void DockSigint::onCaptureComplete(const SpectrumCapture::CaptureResult& result)
 {
     if (result.success) {
-        qDebug() << "Capture complete:" << result.fft_data.size() << "samples";
+        qDebug() << "Capture complete:" << result.fft_data->size() << "samples";
         
         // Phase 1A - Basic FFT Data Capture
         QString message = QString("✅ Phase 1A Capture Complete\n\n");
-        message += QString("📊 Captured %1 FFT samples\n").arg(result.fft_data.size());
+        message += QString("📊 Captured %1 FFT samples\n").arg(result.fft_data->size());
         message += QString("📡 Center Frequency: %1 MHz\n")
                   .arg((result.range.start_freq + result.range.end_freq) / 2e6, 0, 'f', 3);
         message += QString("📏 Bandwidth: %1 MHz\n")
@@ -1285,6 +2415,46 @@ void DockSigint::onCaptureProgress(int percent)
     // TODO: Add progress indicator to UI
 }
 
+void DockSigint::testSpectrumSweep()
+{
+    if (!rx_ptr || !dsp_running) {
+        appendMessage("❌ Error: DSP is not running. Please start DSP first (click the power button).", false);
+        return;
+    }
+
+    const double center_freq = spectrumCapture->getCurrentCenterFreq();
+    const double span = 4.0 * rx_ptr->get_input_rate();
+
+    SpectrumCapture::SweepConfig config;
+    config.start_freq = center_freq - span / 2;
+    config.end_freq = center_freq + span / 2;
+    config.averages = 8;
+    config.settle_ms = 50.0;
+    config.usable_fraction = 0.75;
+    config.fast = false;
+    spectrumCapture->startSweep(config);
+}
+
+void DockSigint::onSweepComplete(const SpectrumCapture::SweepResult& result)
+{
+    if (!result.success)
+        return;
+
+    const std::vector<float> &power = *result.power;
+    const double span = result.bin_hz * power.size();
+    appendMessage(QString("✅ Sweep complete: %1 to %2 MHz, %3 steps, %4 bins of %5 kHz")
+                  .arg(result.start_freq / 1e6, 0, 'f', 3)
+                  .arg((result.start_freq + span) / 1e6, 0, 'f', 3)
+                  .arg(result.steps)
+                  .arg(power.size())
+                  .arg(result.bin_hz / 1e3, 0, 'f', 2), false);
+
+    SpectrumLevels levels;
+    levels.setFrame(power.data(), (int)power.size(),
+                    result.start_freq + span / 2, span, 0, result.fft_size);
+    spectrumVisualizer->updateData(levels);
+}
+
 void DockSigint::testSpectrumCapture()
 {
     qDebug() << "\n=== 🔍 Starting Spectrum Capture Test ===";
@@ -1346,9 +2516,10 @@ void DockSigint::testSpectrumCapture()
             
             // Print FFT data in a format easy to copy/paste
             QString fftDataStr = "[\n";
-            for (size_t i = 0; i < result.fft_data.size(); ++i) {
-                fftDataStr += QString::number(result.fft_data[i], 'f', 2);
-                if (i < result.fft_data.size() - 1) {
+            const std::vector<float> &fft_data = *result.fft_data;
+            for (size_t i = 0; i < fft_data.size(); ++i) {
+                fftDataStr += QString::number(fft_data[i], 'f', 2);
+                if (i < fft_data.size() - 1) {
                     fftDataStr += ", ";
                 }
                 if ((i + 1) % 8 == 0) {  // 8 values per line
@@ -1380,6 +2551,12 @@ void DockSigint::testSpectrumCapture()
 void DockSigint::onDspStateChanged(bool running)
 {
     dsp_running = running;
+    if (!running && classifyTimer && classifyTimer->isActive()) {
+        closeChannelEvent();
+        channelClass.label.clear();
+        channelClass.count = 0;
+        emit classificationChanged(QString());
+    }
     if (running) {
         appendMessage("✅ DSP started", false);
     } else {
@@ -1419,7 +2596,7 @@ void DockSigint::setupTabSystem()
             border: 1px solid rgba(86, 156, 214, 0.5);
             color: #569cd6;
         }
-        QPushButton:pressed {
+        QPushButton:pressed, QPushButton:checked {
             background-color: rgba(14, 99, 156, 0.8);
             border: 1px solid rgba(86, 156, 214, 0.8);
             color: white;
@@ -1445,6 +2622,28 @@ void DockSigint::setupTabSystem()
     QPushButton *fmTransmitBtn = new QPushButton("FM Transmit");
     fmTransmitBtn->setObjectName("fmTransmitButton");
     toolbarLayout->addWidget(fmTransmitBtn);
+
+    // Add modulation classifier toggle
+    classifyButton = new QPushButton("Classify");
+    classifyButton->setObjectName("classifyButton");
+    classifyButton->setCheckable(true);
+    classifyButton->setToolTip("Classify the modulation of the demodulator channel");
+    toolbarLayout->addWidget(classifyButton);
+
+    // Add signal detector toggle
+    detectButton = new QPushButton("Detect");
+    detectButton->setObjectName("detectButton");
+    detectButton->setCheckable(true);
+    detectButton->setToolTip("Detect and describe new signals in the spectrum");
+    toolbarLayout->addWidget(detectButton);
+
+    // Add baseline toggle, a new capture each time it is checked
+    baselineButton = new QPushButton("Baseline");
+    baselineButton->setObjectName("baselineButton");
+    baselineButton->setCheckable(true);
+    baselineButton->setToolTip("Capture the spectrum now as the quiet reference, "
+                               "then only describe signals that are new to it");
+    toolbarLayout->addWidget(baselineButton);
     
     // Connect screenshot button to capture function
     connect(screenshotBtn, &QPushButton::clicked, this, &DockSigint::captureWaterfallScreenshot);
@@ -1455,6 +2654,10 @@ void DockSigint::setupTabSystem()
     // Connect FM Transmit button
     connect(fmTransmitBtn, &QPushButton::clicked, this, &DockSigint::startFMTransmission);
 
+    connect(classifyButton, &QPushButton::toggled, this, &DockSigint::setClassifierEnabled);
+    connect(detectButton, &QPushButton::toggled, this, &DockSigint::setDetectorEnabled);
+    connect(baselineButton, &QPushButton::toggled, this, &DockSigint::setBaselineEnabled);
+
     // Add spacer to push everything to the left
     toolbarLayout->addStretch();
     
@@ -1505,11 +2708,61 @@ void DockSigint::setupTabSystem()
     }
     waterfallLayout->addWidget(waterfallDisplay.get());
     tabWidget->addTab(waterfallTab, "Waterfall");
+
+    // Create search tab over the messages of all chats
+    QWidget *searchTab = new QWidget();
+    QVBoxLayout *searchLayout = new QVBoxLayout(searchTab);
+    searchLayout->setContentsMargins(0, 4, 0, 0);
+    searchInput = new QLineEdit();
+    searchInput->setPlaceholderText("Search all chats, e.g. FSK 433");
+    searchInput->setClearButtonEnabled(true);
+    searchInput->setStyleSheet(R"(
+        QLineEdit {
+            background-color: #1e1e1e;
+            color: #d4d4d4;
+            border: 1px solid #2d2d2d;
+            border-radius: 4px;
+            padding: 4px;
+        }
+    )");
+    searchResults = new QListWidget();
+    searchResults->setWordWrap(true);
+    searchResults->setStyleSheet(R"(
+        QListWidget {
+            background-color: #1e1e1e;
+            color: #d4d4d4;
+            border: 1px solid #2d2d2d;
+            border-radius: 4px;
+        }
+        QListWidget::item {
+            padding: 4px;
+            border-bottom: 1px solid #2d2d2d;
+        }
+        QListWidget::item:selected {
+            background-color: rgba(14, 99, 156, 0.8);
+        }
+    )");
+    searchLayout->addWidget(searchInput);
+    searchLayout->addWidget(searchResults);
+    tabWidget->addTab(searchTab, "Search");
+
+    searchTimer = new QTimer(this);
+    searchTimer->setSingleShot(true);
+    searchTimer->setInterval(SIGINT_SEARCH_DELAY_MS);
+    connect(searchInput, &QLineEdit::textChanged, searchTimer, QOverload<>::of(&QTimer::start));
+    connect(searchTimer, &QTimer::timeout, this, [this]() {
+        emit searchMessagesInDb(searchInput->text());
+    });
+    connect(searchResults, &QListWidget::itemClicked, this, [this](QListWidgetItem *item) {
+        const int index = ui->chatSelector->findData(item->data(Qt::UserRole));
+        if (index >= 0)
+            ui->chatSelector->setCurrentIndex(index);
+    });
     
     // Add widgets to splitter
     mainSplitter->addWidget(toolbar);  // Add toolbar first
     mainSplitter->addWidget(tabWidget);
-    mainSplitter->addWidget(webView);
+    mainSplitter->addWidget(chatContainer);
     
     // Set initial sizes - give chat area more space
     QList<int> sizes;
@@ -1531,20 +2784,16 @@ void DockSigint::setupTabSystem()
     
     // Connect tab changed signal
     connect(tabWidget, &QTabWidget::currentChanged, this, [this](int index) {
-        currentTab = (index == 0) ? "spectrum" : "waterfall";
+        currentTab = (index == 0) ? "spectrum" : (index == 1) ? "waterfall" : "search";
         qDebug() << "Switched to tab:" << currentTab;
-        if (currentTab == "spectrum") {
-            spectrumVisualizer->setVisible(true);
-            if (waterfallDisplay) waterfallDisplay->setVisible(false);
-        } else {
-            spectrumVisualizer->setVisible(false);
-            if (waterfallDisplay) waterfallDisplay->setVisible(true);
-        }
+        spectrumVisualizer->setVisible(currentTab == "spectrum");
+        if (waterfallDisplay) waterfallDisplay->setVisible(currentTab == "waterfall");
+        if (currentTab == "search") searchInput->setFocus();
     });
     
     // Set minimum sizes to prevent areas from becoming too small
     tabWidget->setMinimumHeight(150);  // Minimum height for visualization
-    webView->setMinimumHeight(100);    // Minimum height for chat
+    chatContainer->setMinimumHeight(100);    // Minimum height for chat
 }
 
 void DockSigint::moveVisualizerToTab()
@@ -1565,17 +2814,129 @@ void DockSigint::onTabChanged(const QString &tabName)
     }
 }
 
-void DockSigint::onNewFFTData(const std::vector<float>& fft_data, double center_freq, double bandwidth, double sample_rate)
+/**
+ * Subscribe to reduced frames for the views while the dock is visible.
+ *
+ * The views are a few hundred pixels wide and nobody reads them faster
+ * than SIGINT_VIEW_FPS, so the receiver hands out at most that many frames
+ * of SIGINT_VIEW_BINS bins. While hidden the views get nothing at all.
+ */
+void DockSigint::updateViewSubscription(bool visible)
+{
+    if (!rx_ptr)
+        return;
+
+    visible = visible && !viewsSuspended;
+    if (visible && !viewSubscription) {
+        viewSubscription = rx_ptr->subscribe_iq_fft([this](const iq_fft_frame_sptr &frame) {
+            onNewFFTData(frame);
+        }, viewFps, SIGINT_VIEW_BINS);
+    }
+    else if (!visible && viewSubscription) {
+        rx_ptr->unsubscribe_iq_fft(viewSubscription);
+        viewSubscription = 0;
+    }
+}
+
+/**
+ * Set the rate of the view frames, SIGINT_VIEW_FPS by default.
+ *
+ * MainWindow lowers it while the GUI thread is overloaded. The detector and
+ * the snapshot history keep their full frames.
+ */
+void DockSigint::setViewRate(double fps)
 {
+    if (fps == viewFps)
+        return;
+
+    viewFps = fps;
+    if (viewSubscription) {
+        updateViewSubscription(false);
+        updateViewSubscription(true);
+    }
+}
+
+/**
+ * Drop the view frames while nothing of the dock can be seen.
+ *
+ * The dock stays visible to Qt when the main window is minimized, so
+ * MainWindow tells it. The detector, the classifier and the snapshot
+ * history keep their frames.
+ */
+void DockSigint::setViewsSuspended(bool suspended)
+{
+    viewsSuspended = suspended;
+    updateViewSubscription(isVisible());
+}
+
+/*
+ * Survey the ranges set over the remote control, by a cluster coordinator
+ * or any client. They replace the ones set before and may retune the
+ * receiver, as no one is expected to be at the controls.
+ */
+void DockSigint::setSurveyRanges(const QString &ranges)
+{
+    spectrumSurvey->stop();
+    spectrumSurvey->clearRanges();
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+    const QStringList lines = ranges.split('\n', QString::SkipEmptyParts);
+#else
+    const QStringList lines = ranges.split('\n', Qt::SkipEmptyParts);
+#endif
+    for (const QString &line : lines) {
+        const QStringList words = line.split(' ');
+        SpectrumSurvey::Range range;
+        range.name = QString("remote %1").arg(spectrumSurvey->ranges().size() + 1);
+        range.start_freq = words.value(0).toDouble();
+        range.end_freq = words.value(1).toDouble();
+        range.interval_s = words.value(2).toInt();
+        range.averages = SIGINT_SURVEY_AVERAGES;
+        range.threshold_db = SIGINT_SURVEY_THRESHOLD_DB;
+        range.allow_retune = true;
+        spectrumSurvey->addRange(range);
+    }
+
+    if (!lines.isEmpty())
+        spectrumSurvey->start();
+    SIGINT_LOG(SigintLogger::Info, SigintLogger::Capture,
+               QString("Survey set to %1 remote ranges").arg(lines.size()));
+}
+
+/* Store a signal a node of the cluster has seen, as an event of its own range */
+void DockSigint::storeClusterEmission(const QString &node, double start_time, double stop_time,
+                                      double center_freq, double bandwidth, double peak_db)
+{
+    SignalEvent event{};
+    event.id = emissionTracker.allocateId();
+    event.range = QString("cluster %1").arg(node);
+    event.start_time = start_time;
+    event.stop_time = stop_time;
+    event.center_freq = center_freq;
+    event.bandwidth = bandwidth;
+    event.peak_db = peak_db;
+    emit storeEventsInDb({event});
+}
+
+void DockSigint::onNewFFTData(const iq_fft_frame_sptr &frame)
+{
+    // Convert once, both views reduce the same dB levels to their width.
+    // The frame may be decimated, the levels are scaled by the FFT size.
+    if (!spectrumLevels.setFrame(frame->data.data(), (int)frame->data.size(),
+                                 frame->center_freq, frame->sample_rate, frame->seq,
+                                 (int)frame->fft_size))
+        return;
+
     // Update spectrum visualizer
-    spectrumVisualizer->updateData(fft_data, center_freq, bandwidth, sample_rate);
+    spectrumVisualizer->updateData(spectrumLevels);
     
     // Update waterfall display if it exists and is visible
     if (waterfallDisplay && currentTab == "waterfall") {
-        qDebug() << "Updating waterfall with" << fft_data.size() << "samples";
-        qDebug() << "Center freq:" << center_freq << "Hz";
-        qDebug() << "Bandwidth:" << bandwidth << "Hz";
-        waterfallDisplay->updateData(fft_data, center_freq, bandwidth, sample_rate);
+        SIGINT_LOG_EVERY_MS(SigintLogger::Debug, SigintLogger::Waterfall, 1000,
+                            QString("Waterfall update: %1 bins, center %2 Hz, bandwidth %3 Hz")
+                            .arg(spectrumLevels.size()).arg(spectrumLevels.centerFreq(), 0, 'f', 0)
+                            .arg(spectrumLevels.sampleRate(), 0, 'f', 0));
+        waterfallDisplay->updateData(spectrumLevels);
     }
 }
 
@@ -1673,89 +3034,639 @@ void DockSigint::captureWaterfallScreenshot()
     qDebug() << "  - Filter Bandwidth:" << filterBandwidth << "Hz (" << filterBandwidth/1e3 << "kHz)";
     qDebug() << "  - Filter Range:" << filterLowCut << "to" << filterHighCut << "Hz";
     
-    // Set up capture parameters
-    QRect widgetRect = waterfallWidget->rect();
-    int centerX = plotter->xFromFreq(demodFreq);
-    int sliceWidth = 100;  // Width of the slice to capture
-    
-    // Calculate actual frequency range of the slice
-    double pixelsPerHz = plotter->width() / sampleRate;
-    double captureWidthHz = sliceWidth / pixelsPerHz;
-    
+    // Render the slice around the demod frequency from the offscreen
+    // history; this works with the main window hidden and without a display
+    const int sliceWidth = 100;  // Width of the slice to capture
+    const double hzPerPixel = sampleRate / plotter->width();
+    const double captureWidthHz = sliceWidth * hzPerPixel;
+
     qDebug() << "📊 Capture Parameters:";
-    qDebug() << "  - Widget size:" << widgetRect.size();
-    qDebug() << "  - Center X:" << centerX;
     qDebug() << "  - Slice width:" << sliceWidth << "pixels";
+    qDebug() << "  - Waterfall lines:" << waterfallSnapshot.rows();
     qDebug() << "  - Capture bandwidth:" << captureWidthHz << "Hz (" << captureWidthHz/1e3 << "kHz)";
-    
-    // Create capture rectangle
-    QRect captureRect(
-        centerX - sliceWidth/2,
-        0,
-        sliceWidth,
-        widgetRect.height()
-    );
-    
-    // Capture the widget
-    QPixmap screenshot = waterfallWidget->grab(captureRect);
-    
-    // Save to temp file
-    QTemporaryFile tempFile;
-    tempFile.setAutoRemove(false);
-    if (tempFile.open()) {
-        QString filepath = tempFile.fileName();
-        if (screenshot.save(&tempFile, "PNG")) {
-            tempFile.close();
-            
-            // Read the image data
-            QFile imageFile(filepath);
-            if (imageFile.open(QIODevice::ReadOnly)) {
-                QByteArray imageData = imageFile.readAll();
-                imageFile.close();
-                
-                // Create detailed analysis prompt
-                QString analysisPrompt = QString(
-                    "Please analyze this waterfall signal data from GQRX:\n\n"
-                    "📡 Signal Parameters:\n"
-                    "- Center Frequency: %1 MHz\n"
-                    "- Filter Bandwidth: %2 kHz\n"
-                    "- Sample Rate: %3 MHz\n\n"
-                    "Please analyze this signal and tell me:\n"
-                    "1. The likely signal type(s)\n"
-                    "2. Any modulation characteristics you can identify\n"
-                    "3. Potential sources or applications\n"
-                    "4. Signal quality assessment\n\n"
-                    "If you're unsure about the precise signal type, please provide several likely possibilities. "
-                    "Include any other relevant observations about the signal pattern, strength, or unique characteristics."
-                ).arg(demodFreq / 1e6, 0, 'f', 6)
-                 .arg(filterBandwidth / 1e3, 0, 'f', 2)
-                 .arg(sampleRate / 1e6, 0, 'f', 3);
-
-                qDebug() << "\n📝 Analysis Prompt:";
-                qDebug().noquote() << analysisPrompt;
-                qDebug() << "";
-
-                // Send to Claude
-                appendMessage("🔍 Analyzing signal...", false);
-                sendToClaude(analysisPrompt, imageData);
-            } else {
-                QString error = "Could not read captured image";
-                qDebug() << "❌ Error:" << error;
-                appendMessage("❌ Error: " + error, false);
-            }
-            
-            // Clean up
-            QFile::remove(filepath);
-        } else {
-            QString error = "Could not save screenshot";
-            qDebug() << "❌ Error:" << error;
-            appendMessage("❌ Error: " + error, false);
-        }
-    } else {
-        QString error = "Could not create temporary file";
+
+    // Describe the slice with numbers, the image is only added if enabled
+    const double startFreq = demodFreq - captureWidthHz / 2.0;
+    const double endFreq = demodFreq + captureWidthHz / 2.0;
+    std::vector<float> levels;
+    uint64_t spanMs;
+    const int rows = waterfallSnapshot.levels(startFreq, endFreq, SIGINT_SUMMARY_COLUMNS, 0,
+                                              levels, spanMs);
+    SpectrumSummary summary;
+    if (!summary.compute(levels.data(), SIGINT_SUMMARY_COLUMNS, rows, startFreq,
+                         captureWidthHz / SIGINT_SUMMARY_COLUMNS, spanMs)) {
+        QString error = "No waterfall data to capture";
         qDebug() << "❌ Error:" << error;
         appendMessage("❌ Error: " + error, false);
+        return;
     }
+    const QString summaryJson = QString::fromUtf8(
+        QJsonDocument(summary.toJson()).toJson(QJsonDocument::Compact));
+
+    QByteArray imageData;
+    if (snapshotImages) {
+        waterfallSnapshot.setRange(plotter->getWaterfallMin(), plotter->getWaterfallMax());
+        waterfallSnapshot.setColormap(plotter->getWfColormap());
+        imageData = renderWaterfallSnapshot(startFreq, endFreq, sliceWidth);
+    }
+
+    // Create detailed analysis prompt
+    static const char *analysisTemplate =
+        "Please analyze this waterfall signal data from GQRX:\n\n"
+        "📡 Signal Parameters:\n"
+        "- Center Frequency: %1 MHz\n"
+        "- Filter Bandwidth: %2 kHz\n"
+        "- Sample Rate: %3 MHz\n\n"
+        "📊 Spectrum summary of the waterfall around the center frequency "
+        "(levels in dBFS, occupancy as a fraction of lines):\n%4\n\n"
+        "Please analyze this signal and tell me:\n"
+        "1. The likely signal type(s)\n"
+        "2. Any modulation characteristics you can identify\n"
+        "3. Potential sources or applications\n"
+        "4. Signal quality assessment\n\n"
+        "If you're unsure about the precise signal type, please provide several likely possibilities. "
+        "Include any other relevant observations about the signal pattern, strength, or unique characteristics.";
+    QString analysisPrompt = QString(analysisTemplate)
+     .arg(demodFreq / 1e6, 0, 'f', 6)
+     .arg(filterBandwidth / 1e3, 0, 'f', 2)
+     .arg(sampleRate / 1e6, 0, 'f', 3)
+     .arg(summaryJson);
+
+    qDebug() << "\n📝 Analysis Prompt:";
+    qDebug().noquote() << analysisPrompt;
+    qDebug() << "";
+
+    // Send to Claude
+    appendMessage("🔍 Analyzing signal...", false);
+    if (analysisCacheTtl <= 0) {
+        sendToClaude(analysisPrompt, imageData, nullptr, NetworkWorker::Analysis);
+        return;
+    }
+
+    // A recent analysis of the same spectrum near the same frequency, with
+    // the same prompt and model, is answered from the cache
+    const double bucketHz = captureWidthHz / SIGINT_ANALYSIS_FREQ_BUCKETS;
+    const QString key = QString("%1|%2|%3|%4|%5")
+                        .arg(analysisTemplate, currentModel)
+                        .arg(std::llround(demodFreq / bucketHz))
+                        .arg(std::llround(filterBandwidth / bucketHz))
+                        .arg(summary.fingerprint(bucketHz));
+    const QString hash = QString::fromLatin1(
+        QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex());
+    pendingAnalyses.insert(hash, {analysisPrompt, imageData, NetworkWorker::Analysis});
+    emit lookupAnalysisInDb(hash, analysisCacheTtl);
+}
+
+/* Show a cached analysis, or ask Claude if there is none */
+void DockSigint::onAnalysisLookedUp(const QString &key, const QString &response, qint64 createdAt)
+{
+    auto it = pendingAnalyses.find(key);
+    if (it == pendingAnalyses.end())
+        return;
+    const PendingAnalysis analysis = it.value();
+    pendingAnalyses.erase(it);
+
+    if (response.isEmpty()) {
+        sendToClaude(analysis.prompt, analysis.imageData, nullptr, analysis.priority, key);
+        return;
+    }
+
+    SIGINT_LOG(SigintLogger::Info, SigintLogger::Network,
+               QString("Signal analysis answered from the cache, %1 s old")
+               .arg(QDateTime::currentSecsSinceEpoch() - createdAt));
+    applyReview(key, response);
+    appendMessage(QString("%1
+
+(Cached analysis from %2)")
+                  .arg(response, QDateTime::fromSecsSinceEpoch(createdAt).toString("yyyy-MM-dd HH:mm")),
+                  false);
+}
+
+/**
+ * Start or stop classifying the modulation of the demodulator channel.
+ *
+ * The I/Q sniffer of the receiver is connected while the classifier runs,
+ * and classifyChannel() takes its newest samples every SIGINT_CLASSIFY_MS.
+ */
+void DockSigint::setClassifierEnabled(bool enabled)
+{
+    if (!rx_ptr || !classifyTimer || enabled == classifyTimer->isActive())
+        return;
+
+    if (enabled) {
+        classifyReader = rx_ptr->start_iq_sniffer(SIGINT_CLASSIFY_BUFFER);
+        classifyTimer->start();
+    } else {
+        classifyTimer->stop();
+        rx_ptr->stop_iq_sniffer(classifyReader);
+        closeChannelEvent();
+        channelClass.label.clear();
+        channelClass.count = 0;
+        emit classificationChanged(QString());
+    }
+}
+
+/**
+ * Classify the newest samples of the demodulator channel.
+ *
+ * The result goes to the plotter through classificationChanged(). Once a
+ * label has lasted SIGINT_CLASSIFY_STABLE intervals it is stored as an
+ * event, and if it is not confident it is sent to Claude for review.
+ */
+void DockSigint::classifyChannel()
+{
+    if (!rx_ptr || !dsp_running)
+        return;
+
+    // The newest samples, classified in the buffer of the sniffer
+    const gr_complex *samples = nullptr;
+    const unsigned int count = rx_ptr->peek_iq_sniffer_data(classifyReader, samples,
+                                                            SIGINT_CLASSIFY_SAMPLES);
+
+    double low, high;
+    rx_ptr->get_filter(low, high);
+    classifier.set_channel(rx_ptr->get_demod_rate(), low, high);
+
+    QElapsedTimer timer;
+    timer.start();
+    modulation_classifier::result res;
+    const bool classified = count > 0 && classifier.classify(samples, count, res);
+    rx_ptr->release_iq_sniffer_data(classifyReader, count);
+    if (!classified)
+        return;
+    const qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+
+    const QString label = QString::fromStdString(res.label);
+    if (label != channelClass.label) {
+        closeChannelEvent();
+        channelClass.label = label;
+        channelClass.count = 0;
+    }
+    channelClass.count++;
+
+    QString text = QString::fromStdString(modulation_classifier::describe(res));
+    if (!channelClass.review.isEmpty() && channelClass.reviewFreq == lastFrequency &&
+        channelClass.reviewLabel == label)
+        text = QString("%1 (AI) - %2").arg(channelClass.review, text);
+    emit classificationChanged(text);
+
+    if (channelClass.count != SIGINT_CLASSIFY_STABLE)
+        return;
+
+    SIGINT_LOG(SigintLogger::Info, SigintLogger::General,
+               QString("Channel at %1 Hz classified as %2 from %3 samples in %4 us")
+               .arg(lastFrequency).arg(text).arg(count).arg(elapsedUs));
+    if (label == "Noise")
+        return;
+
+    const double now = QDateTime::currentMSecsSinceEpoch() / 1000.0;
+    SignalEvent &event = channelClass.event;
+    event.id = emissionTracker.allocateId();
+    event.range = "channel";
+    event.start_time = now - SIGINT_CLASSIFY_STABLE * SIGINT_CLASSIFY_MS / 1000.0;
+    event.stop_time = now;
+    event.center_freq = lastFrequency + (low + high) / 2.0;
+    event.bandwidth = high - low;
+    event.peak_db = res.feat.power_db;
+    event.classification = text;
+    emit storeEventsInDb({event});
+
+    if (res.confidence < CLASSIFIER_MIN_CONFIDENCE)
+        reviewClassification(res, low, high);
+}
+
+/*
+ * Decode the RDS of the broadcast FM stations among the emissions of a
+ * visit, all at once from the capture, and classify their events with the
+ * PI code and name decoded so far. A swept visit has moved the receiver
+ * away, so its stations are dropped until the survey dwells again.
+ */
+void DockSigint::scanRds(const SpectrumSurvey::Visit &visit, QVector<SignalEvent> &events)
+{
+    if (!rx_ptr)
+        return;
+
+    const double rf_freq = rx_ptr->get_rf_freq();
+    for (const rds_scanner_cc::station_info &station : rx_ptr->get_rds_scan()) {
+        if (station.pi.empty())
+            continue;
+        QString name = QString("WFM RDS PI %1").arg(QString::fromStdString(station.pi));
+        if (!station.ps.empty())
+            name += QString(" PS %1").arg(QString::fromStdString(station.ps).trimmed());
+        rdsStations[std::llround(rf_freq + station.offset)] = name;
+    }
+
+    std::vector<double> offsets;
+    const double half_rate = rx_ptr->get_quad_rate() / 2.0;
+    for (SignalEvent &e : events) {
+        if (e.center_freq < SIGINT_RDS_BAND_LOW || e.center_freq > SIGINT_RDS_BAND_HIGH ||
+            e.bandwidth < SIGINT_RDS_MIN_BW)
+            continue;
+
+        const double station = std::round(e.center_freq / SIGINT_RDS_RASTER) * SIGINT_RDS_RASTER;
+        auto known = rdsStations.constFind(std::llround(station));
+        if (known != rdsStations.constEnd())
+            e.classification = known.value();
+
+        const double offset = station - rf_freq;
+        if (!visit.swept && (int)offsets.size() < SIGINT_RDS_MAX_STATIONS &&
+            std::fabs(offset) + SIGINT_RDS_MIN_BW < half_rate &&
+            std::find(offsets.begin(), offsets.end(), offset) == offsets.end())
+            offsets.push_back(offset);
+    }
+
+    rx_ptr->set_rds_scan(offsets);
+}
+
+/* Store the stop time of the event of the current classification */
+void DockSigint::closeChannelEvent()
+{
+    SignalEvent &event = channelClass.event;
+    if (event.id == 0)
+        return;
+
+    event.stop_time = QDateTime::currentMSecsSinceEpoch() / 1000.0;
+    emit storeEventsInDb({event});
+    event.id = 0;
+}
+
+/**
+ * Ask Claude about a classification the classifier is not sure of.
+ *
+ * Only the features are sent, once per frequency and label. The reply is
+ * cached like other analyses, keyed by the rounded features.
+ */
+void DockSigint::reviewClassification(const modulation_classifier::result &res,
+                                      double low, double high)
+{
+    const QString label = QString::fromStdString(res.label);
+    if (channelClass.reviewFreq == lastFrequency && channelClass.reviewLabel == label)
+        return;
+
+    const modulation_classifier::features &f = res.feat;
+    const QJsonObject features{
+        {"snr_db", std::round(f.snr_db)},
+        {"carrier_db", std::round(f.carrier_db)},
+        {"carrier_offset_hz", std::round(f.carrier_freq)},
+        {"occupied_fraction", std::round(f.occupied * 100.0f) / 100.0},
+        {"sideband_asymmetry", std::round(f.asymmetry * 100.0f) / 100.0},
+        {"envelope_variance", std::round(f.env_var * 100.0f) / 100.0},
+        {"c40", std::round(f.c40 * 100.0f) / 100.0},
+        {"c42", std::round(f.c42 * 100.0f) / 100.0},
+        {"freq_deviation_hz", std::round(f.freq_std)},
+        {"freq_kurtosis", std::round(f.freq_kurtosis * 10.0f) / 10.0},
+        {"x2_line_db", std::round(f.line2_db)},
+        {"x4_line_db", std::round(f.line4_db)},
+        {"symbol_rate_hz", std::round(f.symbol_rate)}
+    };
+
+    static const char *reviewTemplate =
+        "The modulation classifier of the receiver is unsure about the channel at %1 MHz, "
+        "filter %2 to %3 Hz. Its best guess is %4 at %5% confidence. Features of the complex "
+        "baseband in the filter (cumulants are normalized by C21^2):\n%6\n\n"
+        "Start your reply with the most likely modulation as one word (CW, AM, USB, LSB, FM, "
+        "FSK, BPSK, QPSK, OFDM, Noise or Unknown), then explain in one or two sentences.";
+    const QString featuresJson = QString::fromUtf8(QJsonDocument(features).toJson(QJsonDocument::Compact));
+    const QString prompt = QString(reviewTemplate)
+                           .arg(lastFrequency / 1e6, 0, 'f', 6)
+                           .arg(std::lround(low)).arg(std::lround(high))
+                           .arg(label).arg(std::lround(res.confidence * 100.0f))
+                           .arg(featuresJson);
+
+    // Similar features on the same channel get the same answer
+    const QString key = QString("%1|%2|%3|%4|%5|%6|%7|%8")
+                        .arg(reviewTemplate, currentModel, label)
+                        .arg(lastFrequency / 1000)
+                        .arg(std::lround(high - low))
+                        .arg(std::lround(f.snr_db / SPECTRUM_SUMMARY_FINGERPRINT_DB))
+                        .arg(std::lround(f.env_var * 4.0f))
+                        .arg(QString("%1:%2:%3").arg(std::lround(f.freq_kurtosis * 2.0f))
+                             .arg(std::lround(f.line2_db / 6.0f)).arg(std::lround(f.line4_db / 6.0f)));
+    const QString hash = QString::fromLatin1(
+        QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex());
+
+    channelClass.reviewFreq = lastFrequency;
+    channelClass.reviewLabel = label;
+    channelClass.reviewKey = hash;
+    channelClass.review.clear();
+
+    appendMessage(QString("Classifier unsure of the channel at %1 MHz (%2), asking for a review...")
+                  .arg(lastFrequency / 1e6, 0, 'f', 6)
+                  .arg(QString::fromStdString(modulation_classifier::describe(res))), false);
+    if (analysisCacheTtl <= 0) {
+        sendToClaude(prompt, QByteArray(), nullptr, NetworkWorker::Analysis, hash);
+        return;
+    }
+    pendingAnalyses.insert(hash, {prompt, QByteArray(), NetworkWorker::Analysis});
+    emit lookupAnalysisInDb(hash, analysisCacheTtl);
+}
+
+/* Take the label from the first word of a review reply */
+void DockSigint::applyReview(const QString &key, const QString &response)
+{
+    if (key.isEmpty() || key != channelClass.reviewKey)
+        return;
+
+    const QString word = response.section(QRegularExpression("[^A-Za-z0-9]+"), 0, 0,
+                                          QString::SectionSkipEmpty);
+    channelClass.review = word.left(16);
+}
+
+/**
+ * Start or stop the signal detector.
+ *
+ * While it runs, every FFT frame is converted and run through it, also when
+ * the dock is hidden. Stopping closes the open signals.
+ */
+void DockSigint::setDetectorEnabled(bool enabled)
+{
+    if (enabled == detectorEnabled)
+        return;
+
+    detectorEnabled = enabled;
+    if (!enabled) {
+        SignalDetector::Update update;
+        signalDetector.reset(update);
+        detectionQueue.clear();
+        QVector<SignalEvent> events;
+        for (const SignalDetector::Detection &det : update.closed)
+            events.append(det.event);
+        if (!events.isEmpty())
+            emit storeEventsInDb(events);
+        emit detectionsChanged(QString());
+    }
+
+    if (detectButton && detectButton->isChecked() != enabled)
+        detectButton->setChecked(enabled);
+    emit detectorChanged(enabled);
+}
+
+/**
+ * Capture a baseline from the next frames, or drop it.
+ *
+ * While there is a baseline, the detector still stores every signal it
+ * finds, but only those over bins that have changed compared to the
+ * baseline are announced and described by Claude.
+ */
+void DockSigint::setBaselineEnabled(bool enabled)
+{
+    if (enabled == spectrumBaseline.isActive())
+        return;
+
+    if (enabled)
+        spectrumBaseline.capture();
+    else
+        spectrumBaseline.clear();
+    SIGINT_LOG(SigintLogger::Info, SigintLogger::Fft,
+               enabled ? QString("Capturing a baseline of %1 frames").arg(SPECTRUM_BASELINE_CAPTURE_FRAMES)
+                       : QString("Baseline cleared"));
+
+    if (baselineButton && baselineButton->isChecked() != enabled)
+        baselineButton->setChecked(enabled);
+    emit baselineChanged(enabled);
+}
+
+/**
+ * Run the detector on the current frame in detectorLevels.
+ * @param timeMs Time of the frame in ms since the epoch.
+ *
+ * Signals are stored as events when they are reported and again when they
+ * are closed. The strong new ones are queued to be described to Claude.
+ */
+void DockSigint::runDetector(qint64 timeMs)
+{
+    SignalDetector::Update update;
+    if (!signalDetector.process(detectorLevels.dB(), detectorLevels.size(),
+                                detectorLevels.centerFreq(), detectorLevels.sampleRate(),
+                                timeMs, update))
+        return;
+
+    QVector<SignalEvent> events;
+    const SignalDetector::Detection *strongest = nullptr;
+    for (const SignalDetector::Detection &det : update.opened) {
+        SIGINT_LOG(SigintLogger::Info, SigintLogger::Fft,
+                   QString("Detected signal %1 at %2 Hz, %3 Hz wide, SNR %4 dB")
+                   .arg(det.event.id).arg(det.event.center_freq, 0, 'f', 0)
+                   .arg(det.event.bandwidth, 0, 'f', 0).arg(det.snr_db, 0, 'f', 1));
+        events.append(det.event);
+        if (spectrumBaseline.isValid() &&
+            !spectrumBaseline.changedAt(det.event.center_freq, det.event.bandwidth))
+            continue;
+        if (!strongest || det.snr_db > strongest->snr_db)
+            strongest = &det;
+        if (det.snr_db >= SIGINT_DETECT_ANALYZE_SNR)
+            queueDetection(det);
+    }
+    for (const SignalDetector::Detection &det : update.closed)
+        events.append(det.event);
+
+    emit storeEventsInDb(events);
+    emit detectionsChanged(signalDetector.describe());
+    if (strongest)
+        emit signalDetected(QString("Signal %1 at %2 Hz, %3 Hz wide, SNR %4 dB")
+                            .arg(strongest->event.id)
+                            .arg(strongest->event.center_freq, 0, 'f', 0)
+                            .arg(strongest->event.bandwidth, 0, 'f', 0)
+                            .arg(strongest->snr_db, 0, 'f', 1));
+}
+
+/**
+ * Keep a new signal for the next description, which is sent when the rate
+ * limit allows. Beyond SIGINT_DETECT_BATCH_MAX the weakest are dropped.
+ */
+void DockSigint::queueDetection(const SignalDetector::Detection &det)
+{
+    if (anthropicApiKey.isEmpty() && !isLocal(NetworkWorker::Analysis))
+        return;
+
+    detectionQueue.append(det);
+    std::sort(detectionQueue.begin(), detectionQueue.end(),
+              [](const SignalDetector::Detection &a, const SignalDetector::Detection &b) {
+        return a.snr_db > b.snr_db;
+    });
+    if (detectionQueue.size() > SIGINT_DETECT_BATCH_MAX)
+        detectionQueue.resize(SIGINT_DETECT_BATCH_MAX);
+
+    // Signals of the same frame go out together
+    if (!detectionTimer->isActive()) {
+        const qint64 elapsed = QDateTime::currentMSecsSinceEpoch() - lastDetectionAnalysis;
+        detectionTimer->start((int)std::max((qint64)0, SIGINT_DETECT_ANALYZE_MS - elapsed));
+    }
+}
+
+/**
+ * Describe the queued signals, at most once per SIGINT_DETECT_ANALYZE_MS.
+ *
+ * A single signal is asked about on its own, so its answer can come from
+ * the analysis cache. Several go in one request that asks for a JSON
+ * answer per signal, which saves the round trips and the chat context of
+ * one request each when the band is busy.
+ */
+void DockSigint::describeDetections()
+{
+    if (detectionQueue.isEmpty())
+        return;
+    lastDetectionAnalysis = QDateTime::currentMSecsSinceEpoch();
+
+    const QVector<SignalDetector::Detection> batch = detectionQueue;
+    detectionQueue.clear();
+    if (batch.size() == 1)
+        describeDetection(batch.first());
+    else
+        describeBatch(batch);
+}
+
+/* Other active signals of the detector, one line each */
+static QString otherSignals(const SignalDetector &detector,
+                            const QVector<SignalDetector::Detection> &batch)
+{
+    QString others;
+    for (const SignalDetector::Detection &other : detector.active()) {
+        bool described = false;
+        for (const SignalDetector::Detection &det : batch)
+            described = described || det.event.id == other.event.id;
+        if (!described)
+            others += QString("\n- %1 MHz, %2 kHz wide, SNR %3 dB")
+                      .arg(other.event.center_freq / 1e6, 0, 'f', 4)
+                      .arg(other.event.bandwidth / 1e3, 0, 'f', 1)
+                      .arg(other.snr_db, 0, 'f', 0);
+    }
+    return others.isEmpty() ? QString("\n- none") : others;
+}
+
+/** Ask Claude what a new signal may be, as a background request. */
+void DockSigint::describeDetection(const SignalDetector::Detection &det)
+{
+    const QString others = otherSignals(signalDetector, {det});
+
+    static const char *detectionTemplate =
+        "The energy detector of the receiver found a new signal at %1 MHz, about %2 kHz wide, "
+        "%3 dB above the noise floor at %4 dBFS. Other signals in the %5 MHz wide view:%6\n\n"
+        "In two or three sentences, say what this signal most likely is (service, band plan "
+        "allocation, likely modulation) and whether it is worth tuning to.";
+    const QString prompt = QString(detectionTemplate)
+                           .arg(det.event.center_freq / 1e6, 0, 'f', 4)
+                           .arg(det.event.bandwidth / 1e3, 0, 'f', 1)
+                           .arg(det.snr_db, 0, 'f', 0)
+                           .arg(det.level_db, 0, 'f', 0)
+                           .arg(detectorLevels.sampleRate() / 1e6, 0, 'f', 3)
+                           .arg(others);
+
+    appendMessage(QString("📡 New signal at %1 MHz, %2 kHz wide, SNR %3 dB")
+                  .arg(det.event.center_freq / 1e6, 0, 'f', 4)
+                  .arg(det.event.bandwidth / 1e3, 0, 'f', 1)
+                  .arg(det.snr_db, 0, 'f', 0), false);
+    if (analysisCacheTtl <= 0) {
+        sendToClaude(prompt, QByteArray(), nullptr, NetworkWorker::Background);
+        return;
+    }
+
+    // The same signal seen again on a later pass is answered from the cache
+    const double bucketHz = std::max(det.event.bandwidth, 1000.0);
+    const QString key = QString("%1|%2|%3|%4")
+                        .arg(detectionTemplate, currentModel)
+                        .arg(std::llround(det.event.center_freq / bucketHz))
+                        .arg(std::lround(std::log2(bucketHz)));
+    const QString hash = QString::fromLatin1(
+        QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex());
+    pendingAnalyses.insert(hash, {prompt, QByteArray(), NetworkWorker::Background});
+    emit lookupAnalysisInDb(hash, analysisCacheTtl);
+}
+
+/**
+ * Ask Claude about several new signals in one analysis request. The reply
+ * is a JSON array, shown by applyBatch() one signal per paragraph.
+ */
+void DockSigint::describeBatch(const QVector<SignalDetector::Detection> &batch)
+{
+    QString signalList;
+    QString announced;
+    for (const SignalDetector::Detection &det : batch) {
+        signalList += QString("\n- id %1: %2 MHz, %3 kHz wide, SNR %4 dB, peak %5 dBFS")
+                      .arg(det.event.id)
+                      .arg(det.event.center_freq / 1e6, 0, 'f', 4)
+                      .arg(det.event.bandwidth / 1e3, 0, 'f', 1)
+                      .arg(det.snr_db, 0, 'f', 0)
+                      .arg(det.level_db, 0, 'f', 0);
+        announced += QString("\n%1 MHz, %2 kHz wide, SNR %3 dB")
+                     .arg(det.event.center_freq / 1e6, 0, 'f', 4)
+                     .arg(det.event.bandwidth / 1e3, 0, 'f', 1)
+                     .arg(det.snr_db, 0, 'f', 0);
+    }
+
+    const QString prompt = QString(
+        "The energy detector of the receiver found %1 new signals:%2
+"
+        "Other signals in the %3 MHz wide view:%4
+
+"
+        "For each new signal, say in one or two sentences what it most likely is (service, "
+        "band plan allocation, likely modulation) and whether it is worth tuning to. Answer "
+        "with only a JSON array with one object per signal: "
+        "[{\"id\": <id>, \"description\": \"...\", \"worth_tuning\": true or false}]")
+        .arg(batch.size())
+        .arg(signalList)
+        .arg(detectorLevels.sampleRate() / 1e6, 0, 'f', 3)
+        .arg(otherSignals(signalDetector, batch));
+
+    appendMessage(QString("📡 %1 new signals:%2").arg(batch.size()).arg(announced), false);
+    const QString key = QString("%1%2").arg(SIGINT_BATCH_KEY).arg(++detectionBatchId);
+    pendingBatches.insert(key, batch);
+    sendToClaude(prompt, QByteArray(), nullptr, NetworkWorker::Analysis, key);
+}
+
+/* Show the answer to describeBatch(), as it came if it is no JSON array */
+void DockSigint::applyBatch(const QString &key, const QString &response)
+{
+    auto it = pendingBatches.find(key);
+    if (it == pendingBatches.end())
+        return;
+    const QVector<SignalDetector::Detection> batch = it.value();
+    pendingBatches.erase(it);
+
+    // Models tend to wrap the array in a code block
+    const int first = response.indexOf('[');
+    const int last = response.lastIndexOf(']');
+    QHash<qint64, QJsonObject> answers;
+    if (first >= 0 && last > first) {
+        const QJsonArray array = QJsonDocument::fromJson(
+            response.mid(first, last - first + 1).toUtf8()).array();
+        for (const QJsonValue &value : array) {
+            const QJsonObject answer = value.toObject();
+            answers.insert((qint64)answer["id"].toDouble(), answer);
+        }
+    }
+
+    QString text;
+    for (const SignalDetector::Detection &det : batch) {
+        auto answer = answers.constFind(det.event.id);
+        if (answer == answers.constEnd())
+            continue;
+        text += QString("📡 %1 MHz: %2%3\n\n")
+                .arg(det.event.center_freq / 1e6, 0, 'f', 4)
+                .arg((*answer)["description"].toString())
+                .arg((*answer)["worth_tuning"].toBool() ? " Worth tuning to." : "");
+    }
+    appendMessage(text.isEmpty() ? response : text.trimmed(), false);
+}
+
+/**
+ * Render a waterfall image from the FFT frames received so far.
+ * @param startFreq Absolute frequency of the left edge in Hz.
+ * @param endFreq Absolute frequency of the right edge in Hz.
+ * @param width Width of the image in pixels.
+ * @param format Image format, e.g. "PNG" or "JPG".
+ * @returns The encoded image, empty if there is no data yet.
+ *
+ * A spectrum of the newest line is drawn above the waterfall. No widget is
+ * grabbed and nothing is written to disk.
+ */
+QByteArray DockSigint::renderWaterfallSnapshot(double startFreq, double endFreq, int width,
+                                               const char *format) const
+{
+    const QImage image = waterfallSnapshot.render(startFreq, endFreq, width, 0,
+                                                  SIGINT_SNAPSHOT_SPECTRUM_HEIGHT);
+    return CWaterfallSnapshot::encode(image, format);
 }
 
 void DockSigint::switchToLastActiveChat()
@@ -1891,6 +3802,7 @@ html, body {
 }
 </style>
 
+<script src="qrc:///qtwebchannel/qwebchannel.js"></script>
 <script>
 function copyMessage(element) {
     const text = element.parentElement.querySelector('.text').innerText;
@@ -1911,13 +3823,131 @@ function copyMessage(element) {
     }
 }
 
+let bridge = null;
+let hasOlder = false;       // older messages in the database
+let loadingOlder = false;
+
+// Streamed replies: an assistant message whose text grows as deltas arrive
+let streamText = null;
+
+function messageElement(msg) {
+    const div = document.createElement('div');
+    div.className = 'message ' + (msg.role === 'user' ? 'user-message' : 'assistant-message');
+    // Placeholders are not in the database and do not count for the paging
+    if (msg.placeholder) div.classList.add('placeholder');
+    div.innerHTML = '<div class="message-content">' +
+        '<button class="copy-button" onclick="copyMessage(this)">📋</button>' +
+        '<div class="sender"></div><div class="text"></div></div>';
+    div.querySelector('.sender').textContent = msg.role === 'user' ? 'User' : 'Assistant';
+    div.querySelector('.text').textContent = msg.text;
+    return div;
+}
+
+function loadedCount() {
+    return document.querySelectorAll('#messages .message:not(.placeholder)').length;
+}
+
+function nearBottom() {
+    const container = document.getElementById('chat-container');
+    return container.scrollHeight - container.scrollTop - container.clientHeight < 50;
+}
+
+// Drop the oldest messages beyond the limit, they are loaded again on scroll
+function trimMessages() {
+    const messages = document.getElementById('messages');
+    while (messages.children.length > bridge.domLimit) {
+        messages.removeChild(messages.firstElementChild);
+        hasOlder = true;
+    }
+}
+
+function appendMessages(list) {
+    const messages = document.getElementById('messages');
+    const follow = nearBottom();
+    const fragment = document.createDocumentFragment();
+    list.forEach(msg => fragment.appendChild(messageElement(msg)));
+    messages.appendChild(fragment);
+    if (follow) {
+        trimMessages();
+        scrollToBottom();
+    }
+}
+
+function prependMessages(list, more) {
+    const container = document.getElementById('chat-container');
+    const messages = document.getElementById('messages');
+    const first = messages.children.length === 0;
+    const height = container.scrollHeight;
+    const fragment = document.createDocumentFragment();
+    list.forEach(msg => fragment.appendChild(messageElement(msg)));
+    messages.insertBefore(fragment, messages.firstChild);
+    hasOlder = more;
+    loadingOlder = false;
+
+    // Keep the messages in view where they were
+    container.style.scrollBehavior = 'auto';
+    if (first)
+        container.scrollTop = container.scrollHeight;
+    else
+        container.scrollTop += container.scrollHeight - height;
+    container.style.scrollBehavior = '';
+}
+
+function clearMessages() {
+    document.getElementById('messages').innerHTML = '';
+    streamText = null;
+    hasOlder = false;
+    loadingOlder = false;
+}
+
+function beginStreamMessage() {
+    const messages = document.getElementById('messages');
+    const element = messageElement({role: 'assistant', text: '', placeholder: true});
+    messages.appendChild(element);
+    streamText = element.querySelector('.text');
+    scrollToBottom();
+}
+
+function appendStreamText(text) {
+    if (!streamText) beginStreamMessage();
+    streamText.textContent += text;
+    scrollToBottom();
+}
+
+// The complete text replaces the streamed one and is stored in the database
+function endStreamMessage(text, replace) {
+    if (streamText && replace) {
+        streamText.textContent = text;
+        streamText.closest('.message').classList.remove('placeholder');
+    }
+    streamText = null;
+    scrollToBottom();
+}
+
 function scrollToBottom() {
     const container = document.getElementById('chat-container');
     if (container) container.scrollTop = container.scrollHeight;
 }
 
 document.addEventListener('DOMContentLoaded', function() {
-    scrollToBottom();
+    const container = document.getElementById('chat-container');
+    container.addEventListener('scroll', function() {
+        if (bridge && hasOlder && !loadingOlder && container.scrollTop < 50) {
+            loadingOlder = true;
+            bridge.loadOlder(loadedCount());
+        }
+    });
+
+    new QWebChannel(qt.webChannelTransport, function(channel) {
+        bridge = channel.objects.bridge;
+        bridge.messagesAppended.connect(appendMessages);
+        bridge.messagesPrepended.connect(prependMessages);
+        bridge.messagesCleared.connect(clearMessages);
+        bridge.streamStarted.connect(beginStreamMessage);
+        bridge.streamText.connect(appendStreamText);
+        bridge.streamEnded.connect(endStreamMessage);
+        bridge.pageReady();
+    });
 });
 </script>
 </head>
@@ -1929,15 +3959,74 @@ document.addEventListener('DOMContentLoaded', function() {
 </html>)HTML");
 }
 
+/**
+ * Create the chat view and load the page, once.
+ *
+ * Called when the dock is first shown. The page asks the bridge for the
+ * history when it has connected, so nothing is lost while there is none.
+ * With native_chat in the settings, or in builds without QtWebEngine, the
+ * messages go to a ChatView instead, which needs no Chromium process.
+ */
 void DockSigint::initializeWebView()
 {
-    webView->setContextMenuPolicy(Qt::NoContextMenu);
-    webView->setStyleSheet("QWebEngineView { background: #1e1e1e; }");
+#ifdef WITH_WEBENGINE
+    if (webView)
+        return;
+#endif
+    if (chatView)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+#ifdef WITH_WEBENGINE
+    if (!nativeChat) {
+        webView = new QWebEngineView(chatContainer);
+        webView->settings()->setAttribute(QWebEngineSettings::JavascriptEnabled, true);
+        webView->settings()->setAttribute(QWebEngineSettings::JavascriptCanAccessClipboard, true);
+        webView->page()->setWebChannel(webChannel);
+        webView->setContextMenuPolicy(Qt::NoContextMenu);
+        webView->setStyleSheet("QWebEngineView { background: #1e1e1e; }");
+        chatContainer->layout()->addWidget(webView);
+        updateChatView();
+        SIGINT_LOG(SigintLogger::Info, SigintLogger::General,
+                   QString("Chat view created in %1 ms").arg(timer.elapsed()));
+        return;
+    }
+#endif
+
+    chatView = new ChatView(chatBridge, chatContainer);
+    chatContainer->layout()->addWidget(chatView);
+    chatBridge->pageReady();
+    SIGINT_LOG(SigintLogger::Info, SigintLogger::General,
+               QString("Native chat view created in %1 ms").arg(timer.elapsed()));
 }
 
+/**
+ * Start the chat coordinator, once.
+ *
+ * The interpreter and the LangChain imports take seconds of CPU, so this
+ * waits for COORDINATOR_START_DELAY_MS, or until the chat is shown or used.
+ */
+void DockSigint::startHelpers()
+{
+    if (helpersStarted)
+        return;
+    helpersStarted = true;
+#ifdef WITH_EMBEDDED_PYTHON
+    startEmbeddedCoordinator();
+#else
+    helperProcesses->warmUp("coordinator");
+#endif
+}
+
+/* Load the chat page, which then only changes through the bridge */
 void DockSigint::updateChatView()
 {
-    webView->setHtml(chatHtml);
+#ifdef WITH_WEBENGINE
+    // qrc base URL for qwebchannel.js
+    if (webView)
+        webView->setHtml(chatHtml, QUrl("qrc:///"));
+#endif
 }
 
 void DockSigint::appendMessage(const QString &message, bool isUser)
@@ -1952,11 +4041,12 @@ void DockSigint::appendMessage(const QString &message, bool isUser)
     msg.content = message;
     
     // Add to history
-    messageHistory.append(msg);
+    appendHistory(msg);
+    chatContext.append(msg.role, msg.content);
     
     // Save to database asynchronously
     qDebug() << "Sending save message request to worker thread";
-    emit saveMessageToDb(currentChatId, msg.role, msg.content);
+    emit saveMessageToDb(currentChatId, msg.role, msg.content, messageMeta());
     
     // Update view asynchronously
     qDebug() << "Updating view";
@@ -1966,191 +4056,86 @@ void DockSigint::appendMessage(const QString &message, bool isUser)
 
 void DockSigint::appendMessageToView(const QString &message, bool isUser)
 {
-    QString messageHtml = QString(
-        "<div class=\"message %1\">"
-        "<div class=\"message-content\">"
-        "<button class=\"copy-button\" onclick=\"copyMessage(this)\">📋</button>"
-        "<div class=\"sender\">%2</div>"
-        "<div class=\"text\">%3</div>"
-        "</div>"
-        "</div>"
-    ).arg(isUser ? "user-message" : "assistant-message",
-          isUser ? "User" : "Assistant",
-          message.toHtmlEscaped());
-
-    // Run JavaScript asynchronously
-    webView->page()->runJavaScript(QString("appendMessage(`%1`);").arg(messageHtml));
+    // Sent to the page in batches
+    chatBridge->append(isUser ? "user" : "assistant", message);
 }
 
 void DockSigint::runWaterfallOptimizer()
 {
     qDebug() << "\n=== Running Waterfall Display Optimizer ===";
-    
+
+    if (helperProcesses->isRunning(optimizerJob)) {
+        appendMessage("🎯 The waterfall display optimization is still running.", false);
+        return;
+    }
+
     // Initial message to user
     appendMessage("🎯 Starting waterfall display optimization... The display will auto-adjust several times over the next 10-15 seconds.", false);
-    
-    // Get absolute path to the script
-    QString aguilaRoot = QCoreApplication::applicationDirPath() + "/../../";
-    QString scriptPath = aguilaRoot + "resources/waterfall_display_optimizer.py";
-    
-    // Create and configure process
-    QProcess *process = new QProcess(this);
-    process->setWorkingDirectory(aguilaRoot);
-    process->setProgram("python3");
-    process->setArguments(QStringList() << scriptPath);
-    
-    // Start the process
-    process->start();
-    
-    // Connect output handlers
-    connect(process, &QProcess::readyReadStandardOutput, this, [this, process]() {
-        QString output = QString::fromUtf8(process->readAllStandardOutput());
-        qDebug() << "Optimizer output:" << output;  // Just log to debug
-    });
-    
-    connect(process, &QProcess::readyReadStandardError, this, [this, process]() {
-        QString error = QString::fromUtf8(process->readAllStandardError());
-        qDebug() << "Optimizer error:" << error;  // Just log to debug
-    });
-    
-    // Connect finished handler
-    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, [this, process](int exitCode, QProcess::ExitStatus exitStatus) {
-        if (exitCode == 0) {
-            appendMessage("✅ Waterfall display optimization complete! The optimal dB range has been applied.", false);
-        } else {
-            appendMessage("❌ Waterfall optimization failed. Please try again.", false);
-        }
-        process->deleteLater();
-    });
-} 
 
-// Add this function at the end of the file, before the closing }
+    const QString scriptPath = helperProcesses->root() + "/resources/waterfall_display_optimizer.py";
+    optimizerJob = helperProcesses->run(QStringList() << scriptPath, SIGINT_OPTIMIZER_TIMEOUT_MS,
+        [](const QString &line, bool error) {
+            qDebug() << (error ? "Optimizer error:" : "Optimizer output:") << line;  // Just log to debug
+        },
+        [this](bool ok, int, const QString &) {
+            if (ok) {
+                appendMessage("✅ Waterfall display optimization complete! The optimal dB range has been applied.", false);
+            } else {
+                appendMessage("❌ Waterfall optimization failed. Please try again.", false);
+            }
+        });
+}
+
+/**
+ * Start sending FM of the background music on the current frequency with
+ * the HackRF, or stop it if it is sending.
+ */
 void DockSigint::startFMTransmission()
 {
     qDebug() << "\n=== Starting FM Transmission ===";
-    
+
+    if (fmTransmitter.is_running()) {
+        appendMessage("🔇 Stopping FM transmission...", false);
+        fmTransmitter.stop();
+        appendMessage("✅ FM transmission complete", false);
+        return;
+    }
+
     // Initial message to user
     appendMessage("🔊 Beginning FM transmission setup...", false);
-    
+
     // Get the current frequency from rx_ptr
     if (!rx_ptr) {
         appendMessage("❌ Error: Could not access receiver", false);
         return;
     }
-    
-    double centerFreq = rx_ptr->get_rf_freq() / 1e6; // Convert to MHz
-    qDebug() << "Current frequency:" << centerFreq << "MHz";
-    
-    // Get absolute path to the script
-    QString aguilaRoot = QCoreApplication::applicationDirPath() + "/../../";
-    QString scriptPath = aguilaRoot + "resources/real_fm_transmit.py";
-    
-    // Check if script exists
-    if (!QFile::exists(scriptPath)) {
-        QString error = QString("FM transmitter script not found at: %1").arg(scriptPath);
-        qDebug() << "❌ Error:" << error;
-        appendMessage("❌ Error: " + error, false);
-        return;
-    }
-    
-    // Check if audio file exists
-    QString audioPath = aguilaRoot + "resources/audio/bgmusic.wav";
-    if (!QFile::exists(audioPath)) {
-        QString error = QString("Audio file not found at: %1").arg(audioPath);
-        qDebug() << "❌ Error:" << error;
-        appendMessage("❌ Error: " + error, false);
-        return;
+
+    double centerFreq = rx_ptr->get_rf_freq();
+    qDebug() << "Current frequency:" << centerFreq / 1e6 << "MHz";
+
+    test_signal_params params;
+    params.type = test_signal_params::FM;
+    params.rate = SIGINT_FM_TX_RATE;
+    params.level = 0.0;
+    params.noise = -300.0;
+    params.deviation = SIGINT_FM_TX_DEVIATION;
+
+    // A tone is sent without the audio file
+    QString audioPath = helperProcesses->root() + "/resources/audio/bgmusic.wav";
+    if (QFile::exists(audioPath)) {
+        params.audio = audioPath.toStdString();
+    } else {
+        qDebug() << "Audio file not found at:" << audioPath;
+        appendMessage(QString("⚠️ Audio file not found at: %1, sending a 1 kHz tone").arg(audioPath), false);
     }
-    
-    appendMessage(QString("🎵 Transmitting at %.3f MHz using HackRF...").arg(centerFreq), false);
-    
-    // Create and configure process with output buffer
-    QProcess *process = new QProcess(this);
-    
-    // Add the output buffer as a dynamic property to the process
-    // This avoids the dangling reference that was causing the segfault
-    process->setProperty("outputBuffer", QString());
-    
-    process->setWorkingDirectory(aguilaRoot);
-    process->setProgram("/usr/bin/python3");
-    process->setArguments(QStringList() << scriptPath << "-f" << QString::number(centerFreq) << "-d");
-    
-    // Start the process
-    qDebug() << "Starting process with:" << process->program() << process->arguments().join(" ");
-    process->start();
-    
-    if (!process->waitForStarted(3000)) {
-        QString error = QString("Failed to start FM transmitter: %1").arg(process->errorString());
-        qDebug() << "❌ Error:" << error;
-        appendMessage("❌ Error: " + error, false);
-        process->deleteLater();
+
+    try {
+        fmTransmitter.start(SIGINT_FM_TX_DEVICE, centerFreq, SIGINT_FM_TX_GAIN, params);
+    } catch (std::exception &x) {
+        qDebug() << "FM transmitter error:" << x.what();
+        appendMessage(QString("❌ FM transmission failed: %1").arg(x.what()), false);
         return;
     }
-    
-    // Connect output handlers
-    connect(process, &QProcess::readyReadStandardOutput, this, [this, process]() {
-        QString output = QString::fromUtf8(process->readAllStandardOutput());
-        
-        // Append to stored buffer
-        QString buffer = process->property("outputBuffer").toString();
-        buffer += output;
-        process->setProperty("outputBuffer", buffer);
-        
-        qDebug() << "FM Transmitter output:" << output;
-        
-        // Only send important status messages to the chat
-        QStringList lines = output.split("\n", Qt::SkipEmptyParts);
-        for (const QString &line : lines) {
-            // Only forward meaningful status messages, not debug info
-            if (line.contains("ERROR:", Qt::CaseInsensitive) || 
-                line.contains("Starting FM transmission") ||
-                line.contains("Transmission running") ||
-                line.contains("completed successfully") ||
-                line.contains("interrupted")) {
-                appendMessage(line.trimmed(), false);
-            }
-        }
-    });
-    
-    connect(process, &QProcess::readyReadStandardError, this, [this, process]() {
-        QString error = QString::fromUtf8(process->readAllStandardError());
-        
-        // Append to stored buffer
-        QString buffer = process->property("outputBuffer").toString();
-        buffer += error;
-        process->setProperty("outputBuffer", buffer);
-        
-        qDebug() << "FM Transmitter error:" << error;
-        
-        // Always forward error messages
-        appendMessage("❌ Error: " + error.trimmed(), false);
-    });
-    
-    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), 
-            this, [this, process](int exitCode, QProcess::ExitStatus exitStatus) {
-        qDebug() << "FM Transmitter process finished with exit code:" << exitCode;
-        
-        // Get the complete output buffer from the process properties
-        QString allOutput = process->property("outputBuffer").toString();
-        
-        if (exitCode == 0) {
-            appendMessage("✅ FM transmission complete", false);
-        } else {
-            qDebug() << "Full process output:\n" << allOutput;
-            
-            // Extract error message if available
-            QString errorMessage = "Unknown error";
-            QStringList lines = allOutput.split("\n");
-            for (const QString &line : lines) {
-                if (line.contains("ERROR:", Qt::CaseInsensitive)) {
-                    errorMessage = line.trimmed();
-                    break;
-                }
-            }
-            
-            appendMessage(QString("❌ FM transmission failed (code %1): %2").arg(exitCode).arg(errorMessage), false);
-        }
-        process->deleteLater();
-    });
-}
\ No newline at end of file
+
+    appendMessage(QString("🎵 Transmitting at %1 MHz using HackRF...").arg(centerFreq / 1e6, 0, 'f', 3), false);
+}
@@ -1,27 +1,163 @@
 #ifndef DOCKSIGINT_H
 #define DOCKSIGINT_H
 
+#include "chat_bridge.h"
+#include "chat_context.h"
+#include "chat_view.h"
+#include "emission_tracker.h"
+#include "helper_process_manager.h"
+#include "llm_backend.h"
+#include "occupancy_store.h"
+#include "signal_detector.h"
+#include "spectrum_baseline.h"
 #include "spectrum_capture.h"
+#include "spectrum_levels.h"
+#include "spectrum_survey.h"
 #include "spectrum_visualizer.h"
 #include "waterfall_display.h"
+#include "waterfall_snapshot.h"
+#include "waterfall_tiles.h"
 #include "../applications/gqrx/receiver.h"
+#include "../applications/gqrx/test_transmitter.h"
+#include "dsp/modulation_classifier.h"
+#include "dsp/mem_account.h"
+#ifdef WITH_EMBEDDED_PYTHON
+#include "embedded_coordinator.h"
+#endif
 #include <QDockWidget>
 #include <QSettings>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QSslConfiguration>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#ifdef WITH_WEBENGINE
 #include <QWebEngineView>
 #include <QWebEnginePage>
 #include <QWebChannel>
+#endif
 #include <QSqlDatabase>
+#include <QSqlQuery>
 #include <QThread>
 #include <QDateTime>
-#include <QProcess>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QPushButton>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QHash>
 #include <memory>
 #include <functional>
 
+/* Streamed reply text is added to the chat view at most this often */
+#define SIGINT_STREAM_FLUSH_MS 50
+
+/* Columns of the numeric spectrum summary sent for signal analysis */
+#define SIGINT_SUMMARY_COLUMNS 256
+
+/* Default lifetime of cached signal analyses in seconds, 0 disables the cache */
+#define SIGINT_ANALYSIS_CACHE_TTL 21600
+
+/* Rate and bins of the FFT frames drawn by the dock while it is visible */
+#define SIGINT_VIEW_FPS         10
+#define SIGINT_VIEW_BINS        2048
+
+/* Rate of the view frames while the GUI thread is overloaded */
+#define SIGINT_VIEW_SHED_FPS    3
+
+/* Default tasks sent to the local LLM server when one is set */
+#define SIGINT_LOCAL_LLM_TASKS "analysis summary"
+
+/* Frequency buckets per captured width in the analysis cache key */
+#define SIGINT_ANALYSIS_FREQ_BUCKETS 10
+
+/* Height of the spectrum drawn above waterfall snapshots */
+#define SIGINT_SNAPSHOT_SPECTRUM_HEIGHT 64
+
+/* Interval of the modulation classifier in ms */
+#define SIGINT_CLASSIFY_MS          250
+
+/* Newest samples of the I/Q sniffer classified in each interval */
+#define SIGINT_CLASSIFY_SAMPLES     32768
+
+/* Size of the I/Q sniffer buffer in samples */
+#define SIGINT_CLASSIFY_BUFFER      131072
+
+/* Intervals a classification must last to be stored or reviewed */
+#define SIGINT_CLASSIFY_STABLE      4
+
+/* New signals at least this far above the noise are described to Claude */
+#define SIGINT_DETECT_ANALYZE_SNR   15.0f
+
+/* Shortest time between two descriptions of new signals, in ms */
+#define SIGINT_DETECT_ANALYZE_MS    60000
+
+/* Most new signals described in one request, the strongest are kept */
+#define SIGINT_DETECT_BATCH_MAX     8
+
+/* Start of the cache key of batched descriptions, which are not cached */
+#define SIGINT_BATCH_KEY            "batch/"
+
+/* Requests to the Claude API running at the same time, in all and per priority */
+#define SIGINT_API_MAX_REQUESTS     3
+#define SIGINT_API_MAX_INTERACTIVE  1
+#define SIGINT_API_MAX_ANALYSIS     1
+#define SIGINT_API_MAX_BACKGROUND   1
+
+/* Attempts of a request that is rate limited or hits an overloaded API */
+#define SIGINT_API_MAX_ATTEMPTS     4
+
+/* Backoff between attempts, doubled for each attempt */
+#define SIGINT_API_RETRY_BASE_MS    1000
+#define SIGINT_API_RETRY_MAX_MS     30000
+
+/* Saved messages are written in one transaction at most this often */
+#define SIGINT_DB_FLUSH_MS          200
+
+/* Messages written at once when they come faster than SIGINT_DB_FLUSH_MS */
+#define SIGINT_DB_FLUSH_MESSAGES    100
+
+/* Hits of a history search, and the pause in typing before it runs in ms */
+#define SIGINT_SEARCH_RESULTS       50
+#define SIGINT_SEARCH_DELAY_MS      150
+
+/* Time for the chat coordinator to start and import LangChain */
+#define COORDINATOR_START_TIMEOUT_MS   60000
+
+/* Time for one tuning analysis, which involves an LLM call */
+#define COORDINATOR_REQUEST_TIMEOUT_MS 30000
+
+/* Time for the embedded coordinator to finish a call when the dock closes */
+#define COORDINATOR_EMBEDDED_STOP_MS   5000
+
+/* Delay of the coordinator start after the dock is created, so Python does
+   not compete with the receiver starting; showing or using the chat starts
+   it earlier */
+#define COORDINATOR_START_DELAY_MS     5000
+
+/* Time the waterfall optimizer may run */
+#define SIGINT_OPTIMIZER_TIMEOUT_MS    60000
+
+/* FM transmitter: device, rate, gain and peak deviation */
+#define SIGINT_FM_TX_DEVICE     "hackrf=0"
+#define SIGINT_FM_TX_RATE       2e6
+#define SIGINT_FM_TX_GAIN       14.0
+#define SIGINT_FM_TX_DEVIATION  75e3
+
+/* Survey emissions in the FM broadcast band that get their RDS decoded */
+#define SIGINT_RDS_BAND_LOW         87.5e6
+#define SIGINT_RDS_BAND_HIGH        108.0e6
+#define SIGINT_RDS_MIN_BW           100e3
+#define SIGINT_RDS_MAX_STATIONS     24
+
+/* Channel raster the stations are snapped to, so drift keeps their decoders */
+#define SIGINT_RDS_RASTER           100e3
+
+/* Frames per visit and occupancy threshold of the ranges set with SURVEY */
+#define SIGINT_SURVEY_AVERAGES      8
+#define SIGINT_SURVEY_THRESHOLD_DB  6.0
+
 // Worker class for network operations
 class NetworkWorker : public QObject
 {
@@ -30,17 +166,84 @@ public:
     explicit NetworkWorker(QObject *parent = nullptr);
     ~NetworkWorker();
 
+    /** Priorities of API requests, each with its own limit of running requests. */
+    enum Priority {
+        Interactive = 0,    // chat messages, streamed
+        Analysis = 1,       // signal analysis, cancelled on retune
+        Background = 2,     // chat summaries
+        PriorityCount = 3
+    };
+
 public slots:
-    void sendMessage(const QString &apiKey, const QString &model, const QJsonArray &messages);
+    void sendMessage(const QString &apiKey, const QString &model,
+                     const QJsonArray &system, const QJsonArray &messages, int priority,
+                     const QString &cacheKey);
+    void summarize(const QString &apiKey, const QString &model,
+                   const QJsonArray &messages, int epoch);
+    void cancel(int priority);
+    void preconnect();
+    void setBackend(int priority, const QString &url, const QString &model, const QString &apiKey);
 
 signals:
-    void messageReceived(const QString &message);
-    void errorOccurred(const QString &error);
+    void messageDelta(const QString &text);     // streamed part of a reply
+    void messageReceived(const QString &message, bool streamed);
+    void errorOccurred(const QString &error, bool streamed);
+    void summaryReady(int epoch, const QString &summary);
+    void analysisReceived(const QString &cacheKey, const QString &text);
+    void batchReceived(const QString &key, const QString &text);
 
 private:
+    struct StreamState {
+        QByteArray buffer;  // partial event line
+        QString text;       // reply text so far
+        QString error;
+        QString errorType;  // type of an error event, e.g. overloaded_error
+    };
+
+    struct ApiRequest {
+        quint64 id = 0;
+        int priority = Interactive;
+        LlmBackendPtr backend;
+        QString apiKey;
+        QByteArray body;
+        QByteArray digest;              // hash of the body of analysis requests
+        QString cacheKey;               // analysis cache entry for the reply
+        bool stream = false;
+        int epoch = 0;                  // of summaries
+        int attempts = 0;
+        bool cancelled = false;
+        QNetworkReply *reply = nullptr; // null while waiting for a retry
+    };
+    typedef std::shared_ptr<ApiRequest> ApiRequestPtr;
+
+    QList<ApiRequestPtr> pending[PriorityCount];
+    QList<ApiRequestPtr> active;        // running or waiting for a retry
+    int running[PriorityCount];
+    quint64 apiRequestId;
+
     QNetworkAccessManager *networkManager;
-    QProcess *pythonProcess;
-    bool analyzeTuningRequest(const QString &message);
+    QSslConfiguration sslConfig;        // offers HTTP/2, the same for all API connections
+    LlmBackendPtr anthropic;
+    LlmBackendPtr backends[PriorityCount];  // server of each priority
+    void parseStream(const LlmBackend &backend, const QByteArray &chunk, StreamState &stream);
+    void traceReply(QNetworkReply *reply, const QString &what);
+    void enqueue(const ApiRequestPtr &request);
+    void schedule();
+    void postRequest(const ApiRequestPtr &request);
+    void finishRequest(const ApiRequestPtr &request);
+    static int retryDelay(int attempts, int retryAfter);
+};
+
+/** Message of the chat history found by DatabaseWorker::searchMessages(). */
+struct SearchHit
+{
+    qint64  id;
+    int     chatId;
+    QString chatName;
+    QString role;
+    QString meta;       // receiver state when it was written, see DockSigint::messageMeta()
+    QString timestamp;
+    QString snippet;    // with the matched words between [ and ]
 };
 
 // Worker class for database operations
@@ -53,25 +256,59 @@ public:
     ~DatabaseWorker();
 
 public slots:
-    void saveMessage(int chatId, const QString &role, const QString &content);
-    void loadChatHistory(int chatId);
+    void initializeDatabase();
+    void saveMessage(int chatId, const QString &role, const QString &content,
+                     const QString &meta);
+    void searchMessages(const QString &text);
+    void loadChatHistory(int chatId, int offset);
     void loadAllChats();
     void createChat(const QString &name);
     void saveSetting(const QString &key, const QString &value);
     void loadSetting(const QString &key);
+    void lookupAnalysis(const QString &key, int maxAge);
+    void storeEvents(const QVector<SignalEvent> &events);
+    void queryEvents(double startTime, double stopTime, double startFreq, double stopFreq);
+    void storeOccupancy(const QVector<OccupancyTile> &tiles);
+    void queryOccupancy(double startTime, double stopTime, double startFreq, double stopFreq);
+    void storeAnalysis(const QString &key, const QString &response, int maxAge);
 
 signals:
     void messageSaved(qint64 id);
-    void historyLoaded(const QVector<QPair<QString, QString>> &messages);
+    void historyLoaded(int chatId, int offset, const QVector<QPair<QString, QString>> &messages,
+                       bool more);
     void chatsLoaded(const QVector<QPair<int, QString>> &chats);
     void chatCreated(int chatId, const QString &name);
     void error(const QString &message);
     void settingLoaded(const QString &key, const QString &value);
+    void analysisLookedUp(const QString &key, const QString &response, qint64 createdAt);
+    void eventsFound(const QVector<SignalEvent> &events);
+    void occupancyFound(const OccupancyResult &result);
+    void searchFound(const QString &text, const QVector<SearchHit> &hits);
+
+private slots:
+    void flushMessages();
 
 private:
+    struct PendingMessage {
+        int chatId;
+        QString role;
+        QString content;
+        QString meta;
+    };
+
+    QString dbPath;
     QSqlDatabase db;
-    void initializeDatabase();
-    void verifyDatabaseState();
+    QSqlQuery insertQuery;      // prepared once, reused for every message
+    QSqlQuery historyQuery;
+    QSqlQuery eventQuery;
+    QSqlQuery eventIndexQuery;
+    QSqlQuery occupancyQuery;
+    QSqlQuery indexQuery;       // adds a message to messages_fts
+    QSqlQuery searchQuery;
+    bool eventsRtree;           // events_rtree exists, SQLite has the R-tree module
+    bool messagesFts;           // messages_fts exists, SQLite has FTS5
+    QVector<PendingMessage> pendingMessages;
+    QTimer *flushTimer;
 };
 
 namespace Ui {
@@ -90,25 +327,73 @@ public:
     void saveSettings(QSettings *settings);
     void readSettings(QSettings *settings);
 
+    QByteArray renderWaterfallSnapshot(double startFreq, double endFreq, int width,
+                                       const char *format = "PNG") const;
+
+    /** Offscreen waterfall, for renders from other threads. */
+    CWaterfallSnapshot *snapshot() { return &waterfallSnapshot; }
+    CWaterfallTiles *tiles() { return &waterfallTiles; }
+
+    /** Reference spectrum, compared with every frame while it is enabled. */
+    const SpectrumBaseline &baseline() const { return spectrumBaseline; }
+
 signals:
-    void sendMessageToWorker(const QString &apiKey, const QString &model, const QJsonArray &messages);
-    void saveMessageToDb(int chatId, const QString &role, const QString &content);
-    void loadHistoryFromDb(int chatId);
+    void sendMessageToWorker(const QString &apiKey, const QString &model,
+                             const QJsonArray &system, const QJsonArray &messages, int priority,
+                             const QString &cacheKey);
+    void cancelInWorker(int priority);
+    void lookupAnalysisInDb(const QString &key, int maxAge);
+    void storeAnalysisInDb(const QString &key, const QString &response, int maxAge);
+    void storeEventsInDb(const QVector<SignalEvent> &events);
+    void queryEventsInDb(double startTime, double stopTime, double startFreq, double stopFreq);
+    void eventsFound(const QVector<SignalEvent> &events);
+    void queryOccupancyInDb(double startTime, double stopTime, double startFreq, double stopFreq);
+    void occupancyFound(const OccupancyResult &result);
+    void sweepSegment(const SpectrumCapture::SweepSegment &segment);  // for the panorama
+    void summarizeInWorker(const QString &apiKey, const QString &model,
+                           const QJsonArray &messages, int epoch);
+    void saveMessageToDb(int chatId, const QString &role, const QString &content,
+                         const QString &meta);
+    void searchMessagesInDb(const QString &text);
+    void loadHistoryFromDb(int chatId, int offset);
+    void newFrequency(qint64 freq);
+    void newMode(int mode);
+    void newPassband(int passband);
+    void classificationChanged(const QString &text);  // empty when not classifying
+    void detectorChanged(bool enabled);
+    void baselineChanged(bool enabled);
+    void detectionsChanged(const QString &list);  // SignalDetector::describe()
+    void signalDetected(const QString &description);  // strongest new signal of a frame
+    void iqCaptureRequested(const QString &reason);
 
 public slots:
     void onReceiverDestroyed() { rx_ptr = nullptr; }
+    void setNewFrequency(qint64 rx_freq);
+    void setClassifierEnabled(bool enabled);
+    void setDetectorEnabled(bool enabled);
+    void setBaselineEnabled(bool enabled);
+    void setViewRate(double fps);
+    void setViewsSuspended(bool suspended);
+    void setSurveyRanges(const QString &ranges);  // "<start> <end> <interval>" lines
+    void storeClusterEmission(const QString &node, double start_time, double stop_time,
+                              double center_freq, double bandwidth, double peak_db);
 
 private slots:
     void onSendClicked();
     void onReturnPressed();
-    void onWorkerMessageReceived(const QString &message);
-    void onWorkerErrorOccurred(const QString &error);
+    void onWorkerMessageDelta(const QString &text);
+    void onWorkerMessageReceived(const QString &message, bool streamed);
+    void flushStreamedText();
+    void onWorkerErrorOccurred(const QString &error, bool streamed);
+    void onAnalysisLookedUp(const QString &key, const QString &response, qint64 createdAt);
+    void classifyChannel();
     void onNewChatClicked();
     void onChatSelected(int index);
     void onChatsLoaded(const QVector<QPair<int, QString>> &chats);
+    void onSearchFound(const QString &text, const QVector<SearchHit> &hits);
     void onDspStateChanged(bool running);
     void onTabChanged(const QString &tabName);
-    void onNewFFTData(const std::vector<float>& fft_data, double center_freq, double bandwidth, double sample_rate);
+    void onNewFFTData(const iq_fft_frame_sptr &frame);
     void runWaterfallOptimizer();  // New slot for FFT optimization
     void startFMTransmission();   // New slot for FM transmission
     
@@ -118,6 +403,8 @@ private slots:
     void onCaptureError(const std::string& error);
     void onCaptureProgress(int percent);
     void testSpectrumCapture();  // Test function
+    void testSpectrumSweep();
+    void onSweepComplete(const SpectrumCapture::SweepResult& result);
 
 private:
     struct Message {
@@ -132,31 +419,111 @@ private:
         QDateTime createdAt;
     };
 
+    struct PendingAnalysis {
+        QString prompt;
+        QByteArray imageData;
+        int priority;
+    };
+
+    /* Classification of the demodulator channel */
+    struct ChannelClass {
+        QString label;          // label of the last interval
+        int     count = 0;      // intervals in a row with this label
+        SignalEvent event{};    // event of a stable label, id 0 if none
+        qint64  reviewFreq = 0; // frequency and label sent to Claude for review
+        QString reviewLabel;
+        QString reviewKey;      // analysis cache key of the review
+        QString review;         // Claude's label, empty until it replies
+    };
+
     // Screenshot functionality
     QString getScreenshotPath() const;
     void captureWaterfallScreenshot();
     QWidget* findWaterfallWidget() const;
 
     Ui::DockSigint *ui;
-    QWebEngineView *webView;
+#ifdef WITH_WEBENGINE
+    QWebEngineView *webView;     // created when the dock is first shown
+    QWebChannel *webChannel;
+#endif
+    ChatView *chatView;          // instead of webView with native_chat
+    bool nativeChat;
+    QWidget *chatContainer;      // holds the chat view
+    ChatBridge *chatBridge;  // Shared with the chat page over QWebChannel
     NetworkWorker *networkWorker;
     DatabaseWorker *databaseWorker;
     QThread networkThread;
     QThread databaseThread;
+    HelperProcessManager *helperProcesses;  // chat coordinator and helper scripts
+    bool helpersStarted;     // the coordinator has been started
+    int optimizerJob;        // helper jobs, 0 if none has run
+    test_transmitter fmTransmitter;
+#ifdef WITH_EMBEDDED_PYTHON
+    QThread *coordinatorThread;  // runs embeddedCoordinator, may outlive the dock
+    EmbeddedCoordinator *embeddedCoordinator;
+    bool embeddedFailed;     // the coordinator process is used instead
+    qint64 coordinatorRequestId;
+    QHash<qint64, std::function<void(bool, const QJsonObject &)>> coordinatorRequests;  // waiting for evaluated()
+#endif
     QString anthropicApiKey;
     QString currentModel;
     int currentChatId;
-    QVector<Message> messageHistory;
+    QVector<Message> messageHistory;  // newest messages, the database has all
+    mem_charge historyMem;  // messageHistory, MEM_CHAT_HISTORY
+    ChatContext chatContext;  // window of messageHistory sent to Claude
     QVector<Chat> chatList;
     QString chatHtml;
+    QTimer *streamTimer;     // batches streamed text into one view update
+    QString streamPending;   // streamed text not in the view yet
+    bool streaming;          // a streamed reply is being shown
     
     // Spectrum capture and visualization
     std::unique_ptr<SpectrumCapture> spectrumCapture;
+    std::unique_ptr<SpectrumSurvey> spectrumSurvey;  // Idle until ranges are added
     SpectrumVisualizer *spectrumVisualizer;
     std::unique_ptr<WaterfallDisplay> waterfallDisplay;  // Add waterfall display
 
     receiver *rx_ptr;
     bool dsp_running;  // Track DSP state locally
+    int fftSubscription;  // Full frames for the snapshot history and the detector
+    int viewSubscription;  // Reduced frames for the views, only while visible
+    double viewFps;  // Rate of the view frames, lowered under load
+    bool viewsSuspended;  // No view frames while the main window is minimized
+    CWaterfallSnapshot waterfallSnapshot;  // Offscreen waterfall for captures
+    CWaterfallTiles waterfallTiles;  // Pyramid for the TILE command of the remote control
+    bool snapshotImages;  // Send a waterfall image with the numeric summary
+    qint64 lastFrequency;  // Last frequency from setNewFrequency()
+    int analysisCacheTtl;  // Lifetime of cached analyses in seconds
+    QString localLlmUrl;    // OpenAI compatible endpoint on the LAN, empty if none
+    QString localLlmModel;
+    QString localLlmKey;    // LOCAL_LLM_API_KEY of the .env file
+    QStringList localLlmTasks;  // "chat", "analysis" and "summary" go to the local server
+    QHash<QString, PendingAnalysis> pendingAnalyses;  // Waiting for the cache lookup
+    EmissionTracker emissionTracker;  // Emissions of the survey, stored as events
+    QHash<qint64, QString> rdsStations;  // "WFM RDS ..." by station frequency in Hz
+    SpectrumLevels spectrumLevels;  // Current view frame in dBFS for the sigint views
+    SpectrumLevels detectorLevels;  // Current full frame in dBFS for the detector
+    OccupancyRecorder occupancy;    // Duty cycle tiles of every frame, stored in the database
+    QTimer *classifyTimer;  // Pulls the demodulator channel from the I/Q sniffer
+    QPushButton *classifyButton;
+    int classifyReader;  // I/Q sniffer reader of the classifier
+    modulation_classifier classifier;
+    ChannelClass channelClass;
+    SignalDetector signalDetector;  // Fed with every FFT frame while enabled
+    QPushButton *detectButton;
+    bool detectorEnabled;
+    SpectrumBaseline spectrumBaseline;  // Quiet reference, only changes to it are described
+    QPushButton *baselineButton;
+    qint64 lastDetectionAnalysis;  // ms, rate limit of describeDetections()
+    QVector<SignalDetector::Detection> detectionQueue;  // waiting for the rate limit
+    QTimer *detectionTimer;
+    QHash<QString, QVector<SignalDetector::Detection>> pendingBatches;  // by batch key
+    quint64 detectionBatchId;
+
+    // Search of the chat history, run when typing pauses
+    QLineEdit *searchInput;
+    QListWidget *searchResults;
+    QTimer *searchTimer;
 
     // Tab management
     QString currentTab;
@@ -164,18 +531,44 @@ private:
     QWidget *waterfallContainer;
     
     void loadEnvironmentVariables();
+    void updateViewSubscription(bool visible);
+    void applyBackends();
+    bool isLocal(int priority) const;
+    bool handleTuningCommand(const QString &message);
+    bool handleCaptureCommand(const QString &message);
+    void closeChannelEvent();
+    void scanRds(const SpectrumSurvey::Visit &visit, QVector<SignalEvent> &events);
+    void reviewClassification(const modulation_classifier::result &res, double low, double high);
+    void applyReview(const QString &key, const QString &response);
+    void runDetector(qint64 timeMs);
+    void queueDetection(const SignalDetector::Detection &det);
+    void describeDetections();
+    void describeDetection(const SignalDetector::Detection &det);
+    void describeBatch(const QVector<SignalDetector::Detection> &batch);
+    void applyBatch(const QString &key, const QString &response);
     QString getBaseHtml();
     void initializeWebView();
+    void startHelpers();
     void updateChatView();
     void appendMessage(const QString &message, bool isUser = true);
     void appendMessageToView(const QString &message, bool isUser);
+    void finishStreamedMessage(const QString &message);
+    void appendHistory(const Message &msg);
+    void clearHistory();
     void sendToClaude(const QString &message, std::function<void(const QString&)> callback = nullptr);
-    void sendToClaude(const QString &message, const QByteArray &imageData, std::function<void(const QString&)> callback = nullptr);
+    void sendToClaude(const QString &message, const QByteArray &imageData, std::function<void(const QString&)> callback = nullptr,
+                      int priority = NetworkWorker::Interactive, const QString &cacheKey = QString());
+    void analyzeTuningRequest(const QString &message, const std::function<void(bool)> &done);
+    bool requiresTuning(const QJsonObject &result, qint64 elapsedMs) const;
+#ifdef WITH_EMBEDDED_PYTHON
+    void startEmbeddedCoordinator();
+#endif
     QString getDatabasePath();
     void loadChats();
     void createNewChat();
     void switchToChat(int chatId);
     void updateChatSelector();
+    QString messageMeta() const;
     void clearChat();
     void setupTabSystem();
     void moveVisualizerToTab();
@@ -188,4 +581,6 @@ private:
     void switchToLastActiveChat();
 };
 
+Q_DECLARE_METATYPE(SearchHit)
+
 #endif // DOCKSIGINT_H 
\ No newline at end of file
@@ -35,7 +35,15 @@
 DXCSpots* DXCSpots::m_pThis = 0;
 
 DXCSpots::DXCSpots()
+    : m_DXCSpotTimeout(10 * 60)
+    , m_wheelPos(0)
 {
+    resizeWheel();
+    m_wheelTimer.setInterval(DXC_SPOT_WHEEL_TICK_MS);
+    connect(&m_wheelTimer, SIGNAL(timeout()), this, SLOT(checkSpotTimeout()));
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(DXC_SPOTS_UPDATE_MS);
+    connect(&m_updateTimer, SIGNAL(timeout()), this, SIGNAL(dxcSpotsUpdated()));
 }
 
 void DXCSpots::create()
@@ -51,48 +59,103 @@ DXCSpots& DXCSpots::Get()
 void DXCSpots::add(DXCSpotInfo &info)
 {
     info.time = std::chrono::steady_clock::now();
-    // check only callsign, so if present remove and re-append
+    // check only callsign, so if present remove and re-insert
     // if check also frequency we can only change the time
-    if (m_DXCSpotList.contains(info))
-        m_DXCSpotList.removeAt(m_DXCSpotList.indexOf(info));
-    m_DXCSpotList.append(info);
-    std::stable_sort(m_DXCSpotList.begin(),m_DXCSpotList.end());
-    emit( dxcSpotsUpdated() );
-    QTimer::singleShot(m_DXCSpotTimeout, this, SLOT(checkSpotTimeout()));
+    remove(info.name);
+    m_DXCSpotList.insert(qMakePair(info.frequency, info.name), info);
+    m_DXCSpotByName.insert(info.name, info.frequency);
+    scheduleExpiry(info.name, info.time);
+    if (!m_wheelTimer.isActive())
+        m_wheelTimer.start();
+    spotsChanged();
+}
+
+void DXCSpots::setSpotTimeout(int i)
+{
+    m_DXCSpotTimeout = std::chrono::seconds(i * 60);
+    resizeWheel();
+}
+
+void DXCSpots::remove(const QString &name)
+{
+    auto it = m_DXCSpotByName.find(name);
+    if (it == m_DXCSpotByName.end())
+        return;
+
+    m_DXCSpotList.remove(qMakePair(it.value(), name));
+    m_DXCSpotByName.erase(it);
+}
+
+// Put a callsign in the tick of the wheel it expires in, rounded up
+void DXCSpots::scheduleExpiry(const QString &name, std::chrono::steady_clock::time_point time)
+{
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                time + m_DXCSpotTimeout - std::chrono::steady_clock::now()).count();
+    int ticks = (int)((left + DXC_SPOT_WHEEL_TICK_MS - 1) / DXC_SPOT_WHEEL_TICK_MS);
+    ticks = std::max(1, std::min(ticks, (int)m_expiryWheel.size() - 1));
+    m_expiryWheel[(m_wheelPos + ticks) % m_expiryWheel.size()].append(name);
+}
+
+// One turn of the wheel is the timeout, the spots are scheduled again
+void DXCSpots::resizeWheel()
+{
+    auto ticks = std::chrono::duration_cast<std::chrono::milliseconds>(m_DXCSpotTimeout).count()
+                 / DXC_SPOT_WHEEL_TICK_MS;
+    m_expiryWheel.clear();
+    m_expiryWheel.resize((int)ticks + 2);
+    m_wheelPos = 0;
+    for (auto it = m_DXCSpotList.constBegin(); it != m_DXCSpotList.constEnd(); ++it)
+        scheduleExpiry(it.value().name, it.value().time);
+}
+
+// Coalesce the changes into one dxcSpotsUpdated() per DXC_SPOTS_UPDATE_MS
+void DXCSpots::spotsChanged()
+{
+    if (!m_updateTimer.isActive())
+        m_updateTimer.start();
 }
 
 void DXCSpots::checkSpotTimeout()
 {
     auto now = std::chrono::steady_clock::now();
-    for (int i = 0; i < m_DXCSpotList.size(); i++)
+    bool changed = false;
+
+    m_wheelPos = (m_wheelPos + 1) % m_expiryWheel.size();
+    QStringList due;
+    due.swap(m_expiryWheel[m_wheelPos]);
+    for (const QString &name : due)
     {
-        auto diff = std::chrono::duration_cast<std::chrono::seconds>(now - m_DXCSpotList[i].time);
-        if ( m_DXCSpotTimeout <= diff)
+        auto it = m_DXCSpotByName.constFind(name);
+        if (it == m_DXCSpotByName.constEnd())
+            continue;
+
+        auto spot = m_DXCSpotList.constFind(qMakePair(it.value(), name));
+        if (m_DXCSpotTimeout <= std::chrono::duration_cast<std::chrono::seconds>(now - spot.value().time))
+        {
+            remove(name);
+            changed = true;
+        }
+        else if (spot.value().time + m_DXCSpotTimeout > now + std::chrono::milliseconds(DXC_SPOT_WHEEL_TICK_MS))
+        {
+            // Spotted again after it was scheduled, it is in a later tick too
+            continue;
+        }
+        else
         {
-            m_DXCSpotList.removeAt(i);
+            scheduleExpiry(name, spot.value().time);
         }
     }
-    std::stable_sort(m_DXCSpotList.begin(),m_DXCSpotList.end());
-    emit( dxcSpotsUpdated() );
+
+    if (m_DXCSpotList.isEmpty())
+        m_wheelTimer.stop();
+    if (changed)
+        spotsChanged();
 }
 
 QList<DXCSpotInfo> DXCSpots::getDXCSpotsInRange(qint64 low, qint64 high)
 {
-    DXCSpotInfo info;
-    info.frequency=low;
-    QList<DXCSpotInfo>::const_iterator lb = std::lower_bound(m_DXCSpotList.begin(), m_DXCSpotList.end(), info);
-    info.frequency=high;
-    QList<DXCSpotInfo>::const_iterator ub = std::upper_bound(m_DXCSpotList.begin(), m_DXCSpotList.end(), info);
-
     QList<DXCSpotInfo> found;
-
-    while (lb != ub)
-    {
-        const DXCSpotInfo& info = *lb;
-        found.append(info);
-        lb++;
-    }
-
+    forEachDXCSpotInRange(low, high, [&found](const DXCSpotInfo &info) { found.append(info); });
     return found;
 }
 
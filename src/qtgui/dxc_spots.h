@@ -30,8 +30,18 @@
 #include <QList>
 #include <QStringList>
 #include <QColor>
+#include <QHash>
+#include <QPair>
+#include <QTimer>
+#include <QVector>
 #include <chrono>
 
+// Interval of the expiry wheel, the spots expire this late at most
+#define DXC_SPOT_WHEEL_TICK_MS 5000
+
+// Shortest time between two dxcSpotsUpdated(), the changes in between are sent at once
+#define DXC_SPOTS_UPDATE_MS 250
+
 struct DXCSpotInfo
 {
     qint64  frequency;
@@ -70,14 +80,38 @@ public:
     static DXCSpots& Get();
 
     void add(DXCSpotInfo& info);
-    void setSpotTimeout(int i) { m_DXCSpotTimeout = std::chrono::seconds(i * 60); }
-    DXCSpotInfo& getDXCSpot(int i) { return m_DXCSpotList[i]; }
+    void setSpotTimeout(int i);
+    int size() const { return m_DXCSpotByName.size(); }
     QList<DXCSpotInfo> getDXCSpotsInRange(qint64 low, qint64 high);
 
+    // Call visit(const DXCSpotInfo &) for each spot in [low, high], lowest
+    // frequency first, without copies
+    template <typename Visitor>
+    void forEachDXCSpotInRange(qint64 low, qint64 high, Visitor visit) const
+    {
+        auto it = m_DXCSpotList.lowerBound(qMakePair(low, QString()));
+        for (; it != m_DXCSpotList.constEnd() && it.key().first <= high; ++it)
+            visit(it.value());
+    }
+
 private:
     DXCSpots(); // Singleton Constructor is private.
-    QList<DXCSpotInfo> m_DXCSpotList;
+    void remove(const QString &name);
+    void scheduleExpiry(const QString &name, std::chrono::steady_clock::time_point time);
+    void resizeWheel();
+    void spotsChanged();
+
+    // By frequency, then callsign, so spots on the same frequency are kept
+    QMap<QPair<qint64, QString>, DXCSpotInfo> m_DXCSpotList;
+    QHash<QString, qint64> m_DXCSpotByName;     // frequency of each callsign
     std::chrono::seconds m_DXCSpotTimeout;
+
+    // Callsigns due to expire in each tick, checked again when the tick
+    // comes as they may have been spotted since
+    QVector<QStringList> m_expiryWheel;
+    int                  m_wheelPos;
+    QTimer               m_wheelTimer;
+    QTimer               m_updateTimer;
     static DXCSpots* m_pThis;
 
 private slots:
@@ -0,0 +1,155 @@
+#include <chrono>
+#include <mutex>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include "embedded_coordinator.h"
+#include "sigint_logger.h"
+
+// Python.h uses "slots" as a name, which Qt defines as a macro
+#pragma push_macro("slots")
+#undef slots
+#include <pybind11/embed.h>
+#include <pybind11/numpy.h>
+#pragma pop_macro("slots")
+
+namespace py = pybind11;
+
+/* Newest FFT frame, set from the GUI thread and read from Python */
+static std::mutex frameMutex;
+static iq_fft_frame_sptr latestFrame;
+
+PYBIND11_EMBEDDED_MODULE(aguila, m)
+{
+    m.doc() = "Live data of the Aguila receiver";
+
+    m.def("latest_fft", []() -> py::object {
+        iq_fft_frame_sptr frame;
+        {
+            std::lock_guard<std::mutex> lock(frameMutex);
+            frame = latestFrame;
+        }
+        if (!frame)
+            return py::none();
+
+        // The capsule holds a reference to the frame for as long as the array lives
+        py::capsule owner(new iq_fft_frame_sptr(frame), [](void *p) {
+            delete static_cast<iq_fft_frame_sptr *>(p);
+        });
+        py::array_t<float> data({(py::ssize_t)frame->data.size()}, {(py::ssize_t)sizeof(float)},
+                                frame->data.data(), owner);
+        data.attr("setflags")(py::arg("write") = false);
+
+        py::dict result;
+        result["data"] = data;      // linear power, DC in the middle
+        result["center_freq"] = frame->center_freq;
+        result["sample_rate"] = frame->sample_rate;
+        result["seq"] = frame->seq;
+        result["timestamp"] = std::chrono::duration<double>(frame->timestamp.time_since_epoch()).count();
+        return result;
+    }, "Newest FFT frame as a dict, or None before the first frame");
+}
+
+struct EmbeddedCoordinator::Python {
+    // Declared first so it is destroyed last, after the objects
+    std::unique_ptr<py::scoped_interpreter> interpreter;
+    py::object coordinator;
+    py::object dumps;   // json.dumps
+};
+
+/**
+ * @param root Aguila root directory, added to sys.path so the coordinator
+ *             is imported as resources.chat_coordinator like the sidecar.
+ */
+EmbeddedCoordinator::EmbeddedCoordinator(const QString &root, QObject *parent) :
+    QObject(parent),
+    m_root(QDir(root).absolutePath())
+{
+}
+
+/* Finalizes the interpreter, so it must run in the thread that started it */
+EmbeddedCoordinator::~EmbeddedCoordinator()
+{
+    m_python.reset();
+}
+
+/** Keep a frame for aguila.latest_fft(). Thread safe. */
+void EmbeddedCoordinator::setFrame(const iq_fft_frame_sptr &frame)
+{
+    std::lock_guard<std::mutex> lock(frameMutex);
+    latestFrame = frame;
+}
+
+/**
+ * Start the interpreter and create the coordinator.
+ *
+ * Emits ready(), with the Python error if the coordinator could not be
+ * created. The interpreter is then finalized again.
+ */
+void EmbeddedCoordinator::start()
+{
+    if (m_python)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    m_python.reset(new Python);
+
+    QString error;
+    try {
+        // Leave SIGINT to the application
+        m_python->interpreter.reset(new py::scoped_interpreter(false));
+
+        py::module_::import("sys").attr("path").attr("insert")(0, m_root.toStdString());
+        // The sidecar gets these from its environment
+        py::module_::import("dotenv").attr("load_dotenv")((m_root + "/.env").toStdString(),
+                                                           py::arg("override") = true);
+        m_python->dumps = py::module_::import("json").attr("dumps");
+        m_python->coordinator = py::module_::import("resources.chat_coordinator")
+                                .attr("ChatCoordinator")();
+    }
+    catch (const std::exception &e) {
+        error = QString::fromUtf8(e.what());
+    }
+
+    if (!error.isEmpty()) {
+        // The exception is gone, nothing refers into the interpreter anymore
+        m_python.reset();
+        SIGINT_LOG(SigintLogger::Error, SigintLogger::Network,
+                   QString("Embedded chat coordinator failed: %1").arg(error));
+        emit ready(false, error);
+        return;
+    }
+
+    SIGINT_LOG(SigintLogger::Info, SigintLogger::Network,
+               QString("Embedded chat coordinator ready after %1 ms").arg(timer.elapsed()));
+    emit ready(true, QString());
+}
+
+/**
+ * Evaluate a chat message, see ChatCoordinator.evaluate_request().
+ *
+ * The result dict is converted with json.dumps, the same as the sidecar
+ * sends it, so both paths give the same QJsonObject.
+ */
+void EmbeddedCoordinator::evaluate(qint64 id, const QString &message)
+{
+    if (!m_python) {
+        emit evaluated(id, false, QJsonObject());
+        return;
+    }
+
+    QByteArray json;
+    try {
+        py::object result = m_python->coordinator.attr("evaluate_request")(message.toStdString());
+        json = QByteArray::fromStdString(m_python->dumps(result).cast<std::string>());
+    }
+    catch (const std::exception &e) {
+        SIGINT_LOG(SigintLogger::Error, SigintLogger::Network,
+                   QString("Embedded chat coordinator: %1").arg(QString::fromUtf8(e.what())));
+        emit evaluated(id, false, QJsonObject());
+        return;
+    }
+
+    emit evaluated(id, true, QJsonDocument::fromJson(json).object());
+}
@@ -0,0 +1,50 @@
+#ifndef EMBEDDED_COORDINATOR_H
+#define EMBEDDED_COORDINATOR_H
+
+#include <memory>
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include "../applications/gqrx/receiver.h"
+
+/**
+ * Chat coordinator in an embedded CPython interpreter.
+ *
+ * Built with ENABLE_EMBEDDED_PYTHON. resources/chat_coordinator.py is
+ * imported once and ChatCoordinator.evaluate_request() is called directly,
+ * without the sidecar process, its JSON lines and its pipes. Python code
+ * running here can import the aguila module, whose latest_fft() returns the
+ * newest FFT frame with its data as a read-only numpy array over the frame
+ * buffer, without a copy.
+ *
+ * The interpreter is started, used and finalized in the thread this object
+ * is moved to, which keeps the GIL. A call into Python cannot be
+ * interrupted, so callers time out on their side and drop late replies.
+ * Only one instance may exist in the process.
+ */
+class EmbeddedCoordinator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EmbeddedCoordinator(const QString &root, QObject *parent = nullptr);
+    ~EmbeddedCoordinator();
+
+    static void setFrame(const iq_fft_frame_sptr &frame);
+
+public slots:
+    void start();
+    void evaluate(qint64 id, const QString &message);
+
+signals:
+    void ready(bool ok, const QString &error);
+    void evaluated(qint64 id, bool ok, const QJsonObject &result);
+
+private:
+    struct Python;
+
+    std::unique_ptr<Python> m_python;
+    QString m_root;
+};
+
+#endif // EMBEDDED_COORDINATOR_H
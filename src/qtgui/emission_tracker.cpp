@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <QDateTime>
+#include "emission_tracker.h"
+
+EmissionTracker::EmissionTracker() :
+    m_nextId(QDateTime::currentMSecsSinceEpoch())
+{
+    qRegisterMetaType<SignalEvent>("SignalEvent");
+    qRegisterMetaType<QVector<SignalEvent>>("QVector<SignalEvent>");
+}
+
+/**
+ * Update the emissions of a range with a visit.
+ * @param visit The visit, from SpectrumSurvey::visitComplete().
+ * @param threshold_db Level above the noise floor of the visit that counts
+ *                     as occupied, as in the survey.
+ * @returns The emissions that changed.
+ */
+QVector<SignalEvent> EmissionTracker::update(const SpectrumSurvey::Visit& visit, double threshold_db)
+{
+    QVector<SignalEvent> changed;
+    const std::vector<float>& avg = *visit.avg_db;
+    const std::vector<float>& max = *visit.max_db;
+    const int bins = (int)avg.size();
+    const float level = (float)(visit.noise_floor_db + threshold_db);
+
+    std::vector<bool> seen(m_open.size(), false);
+
+    int k = 0;
+    while (k < bins) {
+        if (avg[k] <= level) {
+            k++;
+            continue;
+        }
+
+        // Run of occupied bins, with gaps of up to EMISSION_GAP_BINS
+        const int first = k;
+        int last = k;
+        float peak = max[k];
+        for (k++; k < bins && k - last <= EMISSION_GAP_BINS + 1; k++) {
+            if (avg[k] > level) {
+                last = k;
+                peak = std::max(peak, max[k]);
+            }
+        }
+        k = last + 1;
+
+        const double lo = visit.start_freq + first * visit.bin_hz;
+        const double hi = visit.start_freq + (last + 1) * visit.bin_hz;
+
+        int match = -1;
+        for (int i = 0; i < m_open.size() && match < 0; i++) {
+            const SignalEvent& e = m_open[i].event;
+            if (m_open[i].range == visit.range &&
+                lo < e.center_freq + e.bandwidth / 2 && hi > e.center_freq - e.bandwidth / 2)
+                match = i;
+        }
+
+        if (match < 0) {
+            Open open;
+            open.range = visit.range;
+            open.missed = 0;
+            open.event.id = m_nextId++;
+            open.event.range = visit.name;
+            open.event.start_time = visit.timestamp;
+            open.event.center_freq = 0.0;
+            open.event.bandwidth = 0.0;
+            open.event.peak_db = peak;
+            m_open.append(open);
+            seen.push_back(false);
+            match = m_open.size() - 1;
+        }
+
+        // Keep the widest extent seen, as the emission may drift
+        Open& open = m_open[match];
+        SignalEvent& e = open.event;
+        const double elo = e.bandwidth > 0 ? std::min(lo, e.center_freq - e.bandwidth / 2) : lo;
+        const double ehi = e.bandwidth > 0 ? std::max(hi, e.center_freq + e.bandwidth / 2) : hi;
+        e.center_freq = (elo + ehi) / 2;
+        e.bandwidth = ehi - elo;
+        e.stop_time = visit.timestamp;
+        e.peak_db = std::max(e.peak_db, (double)peak);
+        open.missed = 0;
+        seen[match] = true;
+        changed.append(e);
+    }
+
+    // Close the emissions of this range that were not seen for too long,
+    // their stop time is the last visit they were seen in
+    for (int i = m_open.size() - 1; i >= 0; i--) {
+        if (m_open[i].range == visit.range && !seen[i] && ++m_open[i].missed > EMISSION_MAX_MISSED)
+            m_open.remove(i);
+    }
+
+    return changed;
+}
@@ -0,0 +1,63 @@
+#ifndef EMISSION_TRACKER_H
+#define EMISSION_TRACKER_H
+
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+#include "spectrum_survey.h"
+
+/* Bins below the threshold that still join two runs into one emission */
+#define EMISSION_GAP_BINS     2
+
+/* Visits an emission may be missing from before it is closed */
+#define EMISSION_MAX_MISSED   1
+
+/** A detected emission, as stored in the events table. */
+struct SignalEvent {
+    qint64  id;
+    QString range;              // survey range it was detected in
+    double  start_time;         // seconds since the epoch
+    double  stop_time;
+    double  center_freq;        // Hz
+    double  bandwidth;          // Hz
+    double  peak_db;            // max-hold level in dBFS
+    QString classification;     // empty until classified
+};
+
+Q_DECLARE_METATYPE(SignalEvent)
+
+/**
+ * Turns survey visits into emissions with a start and a stop time.
+ *
+ * In each visit the runs of bins above the occupancy threshold are the
+ * emissions seen. One that overlaps an open emission of the same range in
+ * frequency extends it, others open new emissions. An open emission not
+ * seen for more than EMISSION_MAX_MISSED visits is closed.
+ *
+ * update() returns the emissions that were opened or extended, so the
+ * database always holds the current state of each one. Ids start at
+ * the time the tracker is created in milliseconds, so they do not collide
+ * with those of an earlier session in the same database.
+ */
+class EmissionTracker
+{
+public:
+    EmissionTracker();
+
+    QVector<SignalEvent> update(const SpectrumSurvey::Visit& visit, double threshold_db);
+
+    /** Id for an event from another source, unique with those of update() */
+    qint64 allocateId() { return m_nextId++; }
+
+private:
+    struct Open {
+        SignalEvent event;
+        int range;
+        int missed;
+    };
+
+    QVector<Open> m_open;
+    qint64 m_nextId;
+};
+
+#endif // EMISSION_TRACKER_H
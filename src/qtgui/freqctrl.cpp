@@ -47,7 +47,9 @@
     "Right-click to clear digits."
 
 CFreqCtrl::CFreqCtrl(QWidget *parent) :
-    QFrame(parent)
+    QFrame(parent),
+    m_LeadZeroPos(0),
+    m_BkDirty(true)
 {
     setAutoFillBackground(false);
     setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
@@ -100,11 +102,19 @@ void CFreqCtrl::setActiveDigit(int idx)
 {
     if (m_ActiveEditDigit != idx)
     {
+        updateDigit(m_ActiveEditDigit);
         m_ActiveEditDigit = idx;
-        update();
+        updateDigit(m_ActiveEditDigit);
     }
 }
 
+// Schedule a repaint of one digit only
+void CFreqCtrl::updateDigit(int idx)
+{
+    if (idx >= m_DigStart && idx < m_NumDigits)
+        update(m_DigitInfo[idx].dQRect);
+}
+
 static int fmax_to_numdigits(qint64 fmax)
 {
     if (fmax < 10e6)
@@ -199,10 +209,16 @@ void CFreqCtrl::setFrequency(qint64 freq)
     qint64    acc = 0;
     qint64    rem;
     int       val;
+    int       oldval[FCTL_MAX_DIGITS];
 
     if (freq == m_Oldfreq)
         return;
 
+    const bool oldneg = m_freq < 0;
+    const int oldleadzero = m_LeadZeroPos;
+    for (i = 0; i < m_NumDigits; i++)
+        oldval[i] = m_DigitInfo[i].val;
+
     if (freq < m_MinFreq)
         freq = m_MinFreq;
 
@@ -247,13 +263,27 @@ void CFreqCtrl::setFrequency(qint64 freq)
     // signal the new frequency to world
     m_Oldfreq = m_freq;
     emit    newFrequency(m_freq);
-    update();
+
+    // Only the digits that changed are drawn again, unless the leading
+    // zeros and with them the colors and separators have changed
+    if (m_LeadZeroPos != oldleadzero || (m_freq < 0) != oldneg)
+    {
+        m_BkDirty = true;
+        update();
+    }
+    else
+    {
+        for (i = m_DigStart; i < m_NumDigits; i++)
+            if (m_DigitInfo[i].val != oldval[i])
+                updateDigit(i);
+    }
     m_LastLeadZeroPos = m_LeadZeroPos;
 }
 
 void CFreqCtrl::setDigitColor(QColor col)
 {
     m_DigitColor = col;
+    clearGlyphs();
     update();
 }
 
@@ -301,6 +331,7 @@ void CFreqCtrl::setUnit(FctlUnit unit)
         break;
     }
     m_Unit = unit;
+    m_BkDirty = true;
     update();
 }
 
@@ -308,37 +339,60 @@ void CFreqCtrl::setBgColor(QColor col)
 {
     m_BkColor = col;
 
+    clearGlyphs();
     update();
 }
 
 void CFreqCtrl::setUnitsColor(QColor col)
 {
     m_UnitsColor = col;
+    m_BkDirty = true;
     update();
 }
 
 void CFreqCtrl::setHighlightColor(QColor col)
 {
     m_HighlightColor = col;
+    clearGlyphs();
     update();
 }
 
 void CFreqCtrl::leaveEvent(QEvent *)
 {
     // called when mouse cursor leaves this control so deactivate any highlights
-    if (m_ActiveEditDigit >= 0)
-    {
-        m_ActiveEditDigit = -1;
-        update();
-    }
+    setActiveDigit(-1);
 }
 
-void CFreqCtrl::paintEvent(QPaintEvent *)
+/*
+ * The units and separators are kept in a pixmap and the digits are copied
+ * from rendered glyphs, so a repaint of the digits that changed, as
+ * setFrequency() asks for, draws no text.
+ */
+void CFreqCtrl::paintEvent(QPaintEvent *event)
 {
-    QPainter painter(this);
+    const qreal dpr = devicePixelRatioF();
+    const QSize pixsize = size() * dpr;
+
+    if (m_BkDirty || m_BkPixmap.size() != pixsize)
+    {
+        m_BkPixmap = QPixmap(pixsize);
+        m_BkPixmap.setDevicePixelRatio(dpr);
+        m_BkPixmap.fill(Qt::transparent);
+        QPainter bkpainter(&m_BkPixmap);
+        drawBkGround(bkpainter);
+        m_BkDirty = false;
+
+        const QSize cell = m_DigitInfo[m_DigStart].dQRect.size();
+        if (cell != m_GlyphSize)
+        {
+            clearGlyphs();
+            m_GlyphSize = cell;
+        }
+    }
 
-    drawBkGround(painter);
-    drawDigits(painter);
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, m_BkPixmap);
+    drawDigits(painter, event->rect());
 }
 
 void CFreqCtrl::mouseMoveEvent(QMouseEvent *event)
@@ -585,9 +639,8 @@ void CFreqCtrl::drawBkGround(QPainter &Painter)
     }
 }
 
-void CFreqCtrl::drawDigits(QPainter &Painter)
+void CFreqCtrl::drawDigits(QPainter &Painter, const QRect &area)
 {
-    Painter.setFont(m_DigitFont);
     m_FirstEditableDigit = m_DigStart;
 
     for (int i = m_DigStart; i < m_NumDigits; i++)
@@ -595,27 +648,50 @@ void CFreqCtrl::drawDigits(QPainter &Painter)
         if (m_DigitInfo[i].incval == 0)
             m_FirstEditableDigit++;
 
-        if (i == m_ActiveEditDigit && m_DigitInfo[i].incval != 0)
-            Painter.fillRect(m_DigitInfo[i].dQRect, m_HighlightColor);
-        else
-            Painter.fillRect(m_DigitInfo[i].dQRect, m_BkColor);
-
-        if (i >= m_LeadZeroPos)
-            Painter.setPen(m_InactiveColor);
-        else
-            Painter.setPen(m_DigitColor);
+        if (!area.intersects(m_DigitInfo[i].dQRect))
+            continue;
 
+        bool highlight = (i == m_ActiveEditDigit && m_DigitInfo[i].incval != 0);
+        bool inactive = (i >= m_LeadZeroPos);
+        int glyph;
         if (m_freq < 0 && i == m_LeadZeroPos - 1 && m_DigitInfo[i].val == 0)
-            Painter.drawText(m_DigitInfo[i].dQRect,
-                                Qt::AlignHCenter | Qt::AlignVCenter,
-                                QString("-0"));
+            glyph = 19;     // "-0"
         else
-            Painter.drawText(m_DigitInfo[i].dQRect,
-                                Qt::AlignHCenter | Qt::AlignVCenter,
-                                QString().number(m_DigitInfo[i].val));
+            glyph = qBound(-9, m_DigitInfo[i].val, 9) + 9;
+
+        Painter.drawPixmap(m_DigitInfo[i].dQRect.topLeft(),
+                           digitGlyph(glyph, inactive, highlight));
     }
 }
 
+// A digit as drawn in a cell, rendered the first time it is shown
+const QPixmap &CFreqCtrl::digitGlyph(int glyph, bool inactive, bool highlight)
+{
+    const qreal dpr = devicePixelRatioF();
+    QPixmap &pix = m_Glyphs[(inactive ? 1 : 0) + (highlight ? 2 : 0)][glyph];
+    if (!pix.isNull() && pix.devicePixelRatio() == dpr)
+        return pix;
+
+    pix = QPixmap(m_GlyphSize * dpr);
+    pix.setDevicePixelRatio(dpr);
+    pix.fill(highlight ? m_HighlightColor : m_BkColor);
+
+    QPainter painter(&pix);
+    painter.setFont(m_DigitFont);
+    painter.setPen(inactive ? m_InactiveColor : m_DigitColor);
+    painter.drawText(QRect(QPoint(0, 0), m_GlyphSize),
+                     Qt::AlignHCenter | Qt::AlignVCenter,
+                     glyph == 19 ? QString("-0") : QString::number(glyph - 9));
+    return pix;
+}
+
+void CFreqCtrl::clearGlyphs()
+{
+    for (auto &row : m_Glyphs)
+        for (auto &pix : row)
+            pix = QPixmap();
+}
+
 // Increment just the digit active in edit mode
 void CFreqCtrl::incDigit()
 {
@@ -5,6 +5,7 @@
 
 #include <QFrame>
 #include <QImage>
+#include <QPixmap>
 #include <QtGui>
 
 enum FctlUnit {
@@ -64,7 +65,7 @@ public slots:
     void    setFrequencyFocus();
 
 protected:
-    void    paintEvent(QPaintEvent *);
+    void    paintEvent(QPaintEvent *event);
     void    mouseMoveEvent(QMouseEvent *);
     void    mousePressEvent(QMouseEvent *);
     void    wheelEvent(QWheelEvent *);
@@ -73,7 +74,10 @@ protected:
 
 private:
     void    drawBkGround(QPainter &Painter);
-    void    drawDigits(QPainter &Painter);
+    void    drawDigits(QPainter &Painter, const QRect &area);
+    const QPixmap &digitGlyph(int glyph, bool inactive, bool highlight);
+    void    clearGlyphs();
+    void    updateDigit(int idx);
     void    incDigit();
     void    decDigit();
     void    incFreq();
@@ -125,6 +129,14 @@ private:
     QFont       m_DigitFont;
     QFont       m_UnitsFont;
 
+    // Units and separators, drawn again when m_BkDirty or the size changed
+    QPixmap     m_BkPixmap;
+    bool        m_BkDirty;
+
+    // Rendered digits, [inactive + 2 * highlighted][-9..9 at 0..18, "-0" at 19]
+    QPixmap     m_Glyphs[4][20];
+    QSize       m_GlyphSize;
+
     struct DigStuct {
         qint64    weight;      // decimal weight of this digit
         qint64    incval;      // value this digit increments or decrements
@@ -0,0 +1,462 @@
+#include <algorithm>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTimer>
+#include <QVariant>
+#include "helper_process_manager.h"
+#include "sigint_logger.h"
+
+/**
+ * @param root Directory of the helpers, the working directory and
+ *             PYTHONPATH of the processes. Variables in its .env file are
+ *             added to their environment.
+ */
+HelperProcessManager::HelperProcessManager(const QString &root, QObject *parent) :
+    QObject(parent),
+    m_root(QDir(root).absolutePath()),
+    m_environment(QProcessEnvironment::systemEnvironment()),
+    m_nextRequestId(0),
+    m_nextJobId(0),
+    m_shutdown(false),
+    m_idleTimer(nullptr)
+{
+    m_environment.insert("PYTHONPATH", m_root);
+    m_environment.insert("PYTHONUNBUFFERED", "1");  // output line by line
+
+    QFile envFile(m_root + "/.env");
+    if (envFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        while (!envFile.atEnd()) {
+            const QString line = envFile.readLine().trimmed();
+            if (line.isEmpty() || line.startsWith('#'))
+                continue;
+            const QStringList parts = line.split('=');
+            if (parts.size() != 2)
+                continue;
+            QString value = parts[1].trimmed();
+            if (value.startsWith('"') && value.endsWith('"'))
+                value = value.mid(1, value.length() - 2);
+            m_environment.insert(parts[0].trimmed(), value);
+        }
+    }
+
+    m_idleTimer = new QTimer(this);
+    m_idleTimer->setInterval(HELPER_IDLE_MS / 5);
+    connect(m_idleTimer, &QTimer::timeout, this, &HelperProcessManager::reapIdle);
+    m_idleTimer->start();
+}
+
+HelperProcessManager::~HelperProcessManager()
+{
+    shutdown();
+
+    // No event loop is left to wait for the graceful exits. A killed
+    // process ends at once, so the QProcess destructors do not hang.
+    const QList<QProcess *> processes = findChildren<QProcess *>();
+    for (QProcess *process : processes) {
+        disconnect(process, nullptr, this, nullptr);
+        if (process->state() != QProcess::NotRunning)
+            process->kill();
+    }
+}
+
+/**
+ * Register a service.
+ * @param name Name used with request().
+ * @param arguments Arguments of the interpreter, e.g. "-m" "module" "--serve".
+ * @param startTimeoutMs Time for an instance to report it is ready.
+ * @param instances Instances run at most, requests queue when all are busy.
+ */
+void HelperProcessManager::addService(const QString &name, const QStringList &arguments,
+                                      int startTimeoutMs, int instances)
+{
+    Service &service = m_services[name];
+    service.arguments = arguments;
+    service.startTimeoutMs = startTimeoutMs;
+    service.instances = std::max(instances, 1);
+}
+
+/** Start an instance of a service ahead of the first request. */
+void HelperProcessManager::warmUp(const QString &name)
+{
+    if (m_shutdown || !m_services.contains(name))
+        return;
+    if (m_services[name].pool.isEmpty())
+        startInstance(name);
+}
+
+/**
+ * Send a request to a service.
+ * @param request Request object, the "id" is added here.
+ * @param timeoutMs Time for the reply once the request is written. An
+ *                  instance that does not answer in time is killed, since
+ *                  it would hold up the requests after this one.
+ * @param handler Called with the reply object, or with ok false.
+ */
+void HelperProcessManager::request(const QString &name, const QJsonObject &request,
+                                   int timeoutMs, const ReplyHandler &handler)
+{
+    if (m_shutdown || !m_services.contains(name)) {
+        if (handler)
+            handler(false, QJsonObject());
+        return;
+    }
+
+    m_services[name].queue.append({request, timeoutMs, handler});
+    dispatch(name);
+}
+
+/**
+ * Run a script once.
+ * @param arguments Arguments of the interpreter, the script first.
+ * @param timeoutMs Time the job may run, 0 for no limit.
+ * @param output Called for each line of output, may be empty.
+ * @param finished Called when the job has ended, may be empty.
+ * @returns Id of the job, for isRunning() and stop().
+ */
+int HelperProcessManager::run(const QStringList &arguments, int timeoutMs,
+                              const OutputHandler &output, const FinishedHandler &finished)
+{
+    const int id = ++m_nextJobId;
+    if (m_shutdown) {
+        if (finished)
+            finished(false, -1, "Shutting down");
+        return id;
+    }
+
+    Job &job = m_jobs[id];
+    job.process = createProcess(arguments);
+    job.outputHandler = output;
+    job.finishedHandler = finished;
+
+    QProcess *process = job.process;
+    connect(process, &QProcess::readyReadStandardOutput, this, [this, id]() {
+        readJob(id, QProcess::StandardOutput);
+    });
+    connect(process, &QProcess::readyReadStandardError, this, [this, id]() {
+        readJob(id, QProcess::StandardError);
+    });
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this, id](int exitCode, QProcess::ExitStatus status) {
+        finishJob(id, status == QProcess::NormalExit && exitCode == 0, exitCode);
+    });
+    connect(process, &QProcess::errorOccurred, this, [this, id, process](QProcess::ProcessError error) {
+        // A process that failed to start does not emit finished()
+        if (error != QProcess::FailedToStart || !m_jobs.contains(id))
+            return;
+        m_jobs[id].output += process->errorString();
+        finishJob(id, false, -1);
+    });
+
+    if (timeoutMs > 0) {
+        job.timer = new QTimer(this);
+        job.timer->setSingleShot(true);
+        connect(job.timer, &QTimer::timeout, this, [this, id]() {
+            if (!m_jobs.contains(id))
+                return;
+            m_jobs[id].timedOut = true;
+            SIGINT_LOG(SigintLogger::Warning, SigintLogger::General,
+                       QString("Helper job %1 timed out, stopping it").arg(id));
+            stop(id);
+        });
+        job.timer->start(timeoutMs);
+    }
+
+    SIGINT_LOG(SigintLogger::Info, SigintLogger::General,
+               QString("Starting helper job %1: %2").arg(id).arg(arguments.join(' ')));
+    process->start();
+    return id;
+}
+
+/** Terminate a job, and kill it if it is still running HELPER_STOP_TIMEOUT_MS later. */
+void HelperProcessManager::stop(int job)
+{
+    if (!m_jobs.contains(job))
+        return;
+
+    QProcess *process = m_jobs[job].process;
+    process->terminate();
+    QTimer::singleShot(HELPER_STOP_TIMEOUT_MS, process, [process]() {
+        process->kill();
+    });
+}
+
+/**
+ * Stop all helpers without waiting for them.
+ *
+ * The handlers of queued and running requests and of the jobs are dropped
+ * and not called, so this can be used while their owner is destroyed.
+ */
+void HelperProcessManager::shutdown()
+{
+    if (m_shutdown)
+        return;
+    m_shutdown = true;
+    m_idleTimer->stop();
+
+    for (Service &service : m_services) {
+        service.queue.clear();
+        for (const InstancePtr &instance : service.pool) {
+            instance->handler = nullptr;
+            instance->timer->stop();
+            instance->timer->deleteLater();
+            closeProcess(instance->process);
+        }
+        service.pool.clear();
+    }
+
+    for (auto it = m_jobs.begin(); it != m_jobs.end(); ++it) {
+        it->outputHandler = nullptr;
+        it->finishedHandler = nullptr;
+        stop(it.key());
+    }
+}
+
+QProcess *HelperProcessManager::createProcess(const QStringList &arguments)
+{
+    QProcess *process = new QProcess(this);
+    process->setProgram(HELPER_PYTHON);
+    process->setArguments(arguments);
+    process->setWorkingDirectory(m_root);
+    process->setProcessEnvironment(m_environment);
+    return process;
+}
+
+void HelperProcessManager::startInstance(const QString &name)
+{
+    Service &service = m_services[name];
+    auto instance = std::make_shared<Instance>();
+    instance->service = name;
+    instance->process = createProcess(service.arguments);
+    // Service logging goes to stderr, keep it out of the reply stream
+    instance->process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    instance->timer = new QTimer(this);
+    instance->timer->setSingleShot(true);
+
+    connect(instance->timer, &QTimer::timeout, this, [this, instance]() {
+        removeInstance(instance, instance->ready ? "did not answer" : "did not start in time");
+    });
+    connect(instance->process, &QProcess::readyReadStandardOutput, this, [this, instance]() {
+        readInstance(instance);
+    });
+    connect(instance->process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this, instance](int exitCode, QProcess::ExitStatus) {
+        removeInstance(instance, QString("exited with code %1").arg(exitCode));
+    });
+    connect(instance->process, &QProcess::errorOccurred, this, [this, instance](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart)
+            removeInstance(instance, instance->process->errorString());
+    });
+
+    service.pool.append(instance);
+    instance->clock.start();
+    instance->timer->start(service.startTimeoutMs);
+    instance->process->start();
+    SIGINT_LOG(SigintLogger::Info, SigintLogger::General,
+               QString("Starting helper %1 (%2 of %3) in %4")
+               .arg(name).arg(service.pool.size()).arg(service.instances).arg(m_root));
+}
+
+/* Hand queued requests to idle instances, starting one if all are busy */
+void HelperProcessManager::dispatch(const QString &name)
+{
+    Service &service = m_services[name];
+    while (!service.queue.isEmpty()) {
+        InstancePtr idle;
+        bool starting = false;
+        for (const InstancePtr &instance : service.pool) {
+            if (!instance->ready)
+                starting = true;
+            else if (instance->requestId == 0) {
+                idle = instance;
+                break;
+            }
+        }
+
+        if (!idle) {
+            if (!starting && service.pool.size() < service.instances)
+                startInstance(name);
+            return;
+        }
+
+        const Request request = service.queue.takeFirst();
+        idle->requestId = ++m_nextRequestId;
+        idle->handler = request.handler;
+
+        QJsonObject body = request.body;
+        body["id"] = idle->requestId;
+        idle->process->write(QJsonDocument(body).toJson(QJsonDocument::Compact) + '\n');
+        idle->timer->start(request.timeoutMs);
+    }
+}
+
+void HelperProcessManager::readInstance(const InstancePtr &instance)
+{
+    instance->buffer.append(instance->process->readAllStandardOutput());
+
+    int eol;
+    while ((eol = instance->buffer.indexOf('\n')) >= 0) {
+        const QByteArray line = instance->buffer.left(eol);
+        instance->buffer.remove(0, eol + 1);
+        const QJsonObject reply = QJsonDocument::fromJson(line).object();
+
+        if (!instance->ready) {
+            if (!reply.contains("ready"))
+                continue;
+            if (!reply["ready"].toBool()) {
+                removeInstance(instance, QString("failed: %1").arg(reply["error"].toString()));
+                return;
+            }
+            instance->ready = true;
+            instance->timer->stop();
+            SIGINT_LOG(SigintLogger::Info, SigintLogger::General,
+                       QString("Helper %1 ready after %2 ms")
+                       .arg(instance->service).arg(instance->clock.restart()));
+            dispatch(instance->service);
+            continue;
+        }
+
+        // A reply without a request, e.g. to a line it could not parse
+        if (instance->requestId == 0 ||
+            reply["id"].toVariant().toLongLong() != instance->requestId)
+            continue;
+
+        const ReplyHandler handler = instance->handler;
+        instance->handler = nullptr;
+        instance->requestId = 0;
+        instance->timer->stop();
+        instance->clock.restart();
+        if (handler)
+            handler(true, reply);
+        if (m_shutdown)
+            return;
+        dispatch(instance->service);
+    }
+}
+
+/**
+ * Drop an instance that died, failed or hung.
+ *
+ * The request in flight fails. If the instance never got ready the next
+ * one would most likely not either, so the queued requests fail too
+ * rather than restart the service in a loop.
+ */
+void HelperProcessManager::removeInstance(const InstancePtr &instance, const QString &reason)
+{
+    Service &service = m_services[instance->service];
+    if (!service.pool.removeOne(instance))
+        return;     // already removed, e.g. killed after a timeout
+
+    instance->timer->stop();
+    instance->timer->deleteLater();
+    disconnect(instance->process, nullptr, this, nullptr);
+    if (instance->process->state() == QProcess::NotRunning) {
+        instance->process->deleteLater();
+    }
+    else {
+        connect(instance->process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                instance->process, &QObject::deleteLater);
+        instance->process->kill();
+    }
+
+    SIGINT_LOG(SigintLogger::Warning, SigintLogger::General,
+               QString("Helper %1 %2").arg(instance->service, reason));
+
+    QList<Request> failed;
+    if (!instance->ready)
+        failed.swap(service.queue);
+
+    const ReplyHandler handler = instance->handler;
+    instance->handler = nullptr;
+    if (handler)
+        handler(false, QJsonObject());
+    for (const Request &request : failed) {
+        if (request.handler)
+            request.handler(false, QJsonObject());
+    }
+
+    if (!m_shutdown)
+        dispatch(instance->service);
+}
+
+/* Close the instances beyond the first of each service that idle for HELPER_IDLE_MS */
+void HelperProcessManager::reapIdle()
+{
+    for (Service &service : m_services) {
+        for (int k = service.pool.size() - 1; k > 0; k--) {
+            const InstancePtr instance = service.pool[k];
+            if (!instance->ready || instance->requestId != 0 ||
+                instance->clock.elapsed() < HELPER_IDLE_MS)
+                continue;
+            service.pool.removeAt(k);
+            instance->timer->deleteLater();
+            closeProcess(instance->process);
+        }
+    }
+}
+
+void HelperProcessManager::readJob(int id, QProcess::ProcessChannel channel)
+{
+    if (!m_jobs.contains(id))
+        return;
+
+    Job &job = m_jobs[id];
+    const bool error = channel == QProcess::StandardError;
+    QByteArray &partial = job.partial[error ? 1 : 0];
+    partial.append(error ? job.process->readAllStandardError()
+                         : job.process->readAllStandardOutput());
+
+    int eol;
+    while ((eol = partial.indexOf('\n')) >= 0) {
+        const QString line = QString::fromUtf8(partial.left(eol)).trimmed();
+        partial.remove(0, eol + 1);
+
+        job.output += line + '\n';
+        if (job.output.size() > HELPER_OUTPUT_MAX)
+            job.output.remove(0, job.output.size() - HELPER_OUTPUT_MAX);
+        if (job.outputHandler && !line.isEmpty())
+            job.outputHandler(line, error);
+    }
+}
+
+void HelperProcessManager::finishJob(int id, bool ok, int exitCode)
+{
+    if (!m_jobs.contains(id))
+        return;
+
+    // Output left without a newline
+    for (int k = 0; k < 2; k++)
+        m_jobs[id].partial[k].append('\n');
+    readJob(id, QProcess::StandardOutput);
+    readJob(id, QProcess::StandardError);
+
+    const Job job = m_jobs.take(id);
+    if (job.timer) {
+        job.timer->stop();
+        job.timer->deleteLater();
+    }
+    job.process->deleteLater();
+
+    SIGINT_LOG(ok ? SigintLogger::Info : SigintLogger::Warning, SigintLogger::General,
+               QString("Helper job %1 finished with code %2%3")
+               .arg(id).arg(exitCode).arg(job.timedOut ? ", timed out" : ""));
+    if (job.finishedHandler)
+        job.finishedHandler(ok && !job.timedOut, exitCode, job.output);
+}
+
+/* Let a service exit when its stdin is closed, and kill it if it does not */
+void HelperProcessManager::closeProcess(QProcess *process)
+{
+    disconnect(process, nullptr, this, nullptr);
+    if (process->state() == QProcess::NotRunning) {
+        process->deleteLater();
+        return;
+    }
+
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            process, &QObject::deleteLater);
+    process->closeWriteChannel();
+    QTimer::singleShot(HELPER_STOP_TIMEOUT_MS, process, [process]() {
+        process->kill();
+    });
+}
@@ -0,0 +1,137 @@
+#ifndef HELPER_PROCESS_MANAGER_H
+#define HELPER_PROCESS_MANAGER_H
+
+#include <functional>
+#include <memory>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QString>
+#include <QStringList>
+
+class QTimer;
+
+/* Interpreter the helpers are run with */
+#define HELPER_PYTHON               "python3"
+
+/* Time for a helper to exit after its stdin is closed or it is terminated */
+#define HELPER_STOP_TIMEOUT_MS      2000
+
+/* Instances of a service beyond the first are stopped after idling this long */
+#define HELPER_IDLE_MS              300000
+
+/* Output of a job kept for its finished handler, in bytes */
+#define HELPER_OUTPUT_MAX           65536
+
+/**
+ * Python helper processes of the SIGINT dock.
+ *
+ * Services are long running interpreters that answer one JSON line per
+ * request, like the chat coordinator with --serve. Their instances are
+ * pooled and reused, so the interpreter start and the imports are paid
+ * once. A service writes {"ready": true} when it can take requests, or
+ * {"ready": false, "error": "..."} if it cannot start; each request gets
+ * an "id" that its reply carries back.
+ *
+ * Jobs are scripts run once to completion, like the waterfall optimizer.
+ *
+ * Nothing here waits on a process. Replies, output and exits are handled
+ * from the QProcess signals, and timeouts are timers that kill the
+ * process. shutdown() drops the handlers, closes the services and
+ * terminates the jobs, and the destructor kills whatever is left, so no
+ * python3 outlives the program. The manager must be used from the thread
+ * it lives in.
+ */
+class HelperProcessManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** Reply of a service request, ok is false on timeout or if the service died. */
+    typedef std::function<void(bool ok, const QJsonObject &reply)> ReplyHandler;
+    /** Line of output of a job, error is true for stderr. */
+    typedef std::function<void(const QString &line, bool error)> OutputHandler;
+    /** Exit of a job, ok is true for exit code 0 within the timeout. */
+    typedef std::function<void(bool ok, int exitCode, const QString &output)> FinishedHandler;
+
+    explicit HelperProcessManager(const QString &root, QObject *parent = nullptr);
+    ~HelperProcessManager();
+
+    QString root() const { return m_root; }
+
+    void addService(const QString &name, const QStringList &arguments,
+                    int startTimeoutMs, int instances = 1);
+    void warmUp(const QString &name);
+    void request(const QString &name, const QJsonObject &request, int timeoutMs,
+                 const ReplyHandler &handler);
+
+    int  run(const QStringList &arguments, int timeoutMs,
+             const OutputHandler &output, const FinishedHandler &finished);
+    bool isRunning(int job) const { return m_jobs.contains(job); }
+    void stop(int job);
+
+    void shutdown();
+
+private:
+    struct Request {
+        QJsonObject  body;
+        int          timeoutMs;
+        ReplyHandler handler;
+    };
+
+    struct Instance {
+        QString       service;
+        QProcess     *process = nullptr;
+        QTimer       *timer = nullptr;  // start or request timeout
+        QByteArray    buffer;           // partial reply line
+        QElapsedTimer clock;            // since started, then since last used
+        bool          ready = false;
+        qint64        requestId = 0;    // request in flight, 0 if idle
+        ReplyHandler  handler;
+    };
+    typedef std::shared_ptr<Instance> InstancePtr;
+
+    struct Service {
+        QStringList        arguments;
+        int                startTimeoutMs = 0;
+        int                instances = 1;
+        QList<InstancePtr> pool;
+        QList<Request>     queue;
+    };
+
+    struct Job {
+        QProcess       *process = nullptr;
+        QTimer         *timer = nullptr;
+        QByteArray      partial[2];     // partial stdout and stderr lines
+        QString         output;
+        bool            timedOut = false;
+        OutputHandler   outputHandler;
+        FinishedHandler finishedHandler;
+    };
+
+    QProcess *createProcess(const QStringList &arguments);
+    void startInstance(const QString &name);
+    void dispatch(const QString &name);
+    void readInstance(const InstancePtr &instance);
+    void removeInstance(const InstancePtr &instance, const QString &reason);
+    void reapIdle();
+    void readJob(int id, QProcess::ProcessChannel channel);
+    void finishJob(int id, bool ok, int exitCode);
+    void closeProcess(QProcess *process);
+
+    QString   m_root;
+    QProcessEnvironment m_environment;
+    QMap<QString, Service> m_services;
+    QMap<int, Job> m_jobs;
+    qint64    m_nextRequestId;
+    int       m_nextJobId;
+    bool      m_shutdown;
+    QTimer   *m_idleTimer;
+};
+
+#endif // HELPER_PROCESS_MANAGER_H
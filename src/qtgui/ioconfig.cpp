@@ -21,8 +21,10 @@
  * Boston, MA 02110-1301, USA.
  */
 #include <iomanip>
+#include <QDateTime>
 #include <QDebug>
 #include <QFile>
+#include <QLocale>
 #include <QPushButton>
 #include <QSettings>
 #include <QString>
@@ -35,6 +37,7 @@
 
 #ifdef WITH_PULSEAUDIO
 #include "pulseaudio/pa_device_list.h"
+#include "pulseaudio/pa_sink.h"
 #elif WITH_PORTAUDIO
 #include "portaudio/device_list.h"
 #elif defined(Q_OS_DARWIN)
@@ -46,17 +49,17 @@
 
 
 CIoConfig::CIoConfig(QSettings * settings,
-                     std::map<QString, QVariant> &devList,
+                     DeviceCache *devices,
                      QWidget *parent) :
     QDialog(parent),
     ui(new Ui::CIoConfig),
     m_settings(settings),
-    m_devList(&devList)
+    m_devices(devices)
 {
     ui->setupUi(this);
 
-    // update input device list
-    updateInDev(settings, *m_devList);
+    // update input device list, from the cache until the scan has finished
+    updateInDev(settings->value("input/device", "").toString(), m_devices->devices());
 
     // input rate
     updateInputSampleRates(settings->value("input/sample_rate", 0).toInt());
@@ -72,6 +75,9 @@ CIoConfig::CIoConfig(QSettings * settings,
     // LNB LO
     ui->loSpinBox->setValue(1.0e-6 * settings->value("input/lnb_lo", 0.0).toDouble());
 
+    // Standby device
+    ui->standbyDevEdit->setText(settings->value("input/standby_device", "").toString());
+
     // Output device
     updateOutDev();
 
@@ -85,6 +91,12 @@ CIoConfig::CIoConfig(QSettings * settings,
     connect(ui->inSrCombo, SIGNAL(editTextChanged(QString)), this, SLOT(inputRateChanged(QString)));
     connect(ui->decimCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(decimationChanged(int)));
     connect(m_scanButton, SIGNAL(clicked(bool)), this, SLOT(onScanButtonClicked()));
+    connect(m_devices, SIGNAL(scanStarted()), this, SLOT(onScanStarted()));
+    connect(m_devices, SIGNAL(updated()), this, SLOT(onDevicesUpdated()));
+
+    if (m_devices->isScanning())
+        onScanStarted();
+    m_devices->refresh(false);
 }
 
 CIoConfig::~CIoConfig()
@@ -190,6 +202,13 @@ void CIoConfig::saveConfig()
         m_settings->remove("output/device");
     }
 
+#ifdef WITH_PULSEAUDIO
+    if (ui->outLatencySpin->value() != PA_SINK_LATENCY_MS)
+        m_settings->setValue("output/latency_ms", ui->outLatencySpin->value());
+    else
+        m_settings->remove("output/latency_ms");
+#endif
+
     // input settings
     m_settings->setValue("input/device", ui->inDevEdit->text());  // "OK" button disabled if empty
 
@@ -205,6 +224,11 @@ void CIoConfig::saveConfig()
     else
         m_settings->remove("input/lnb_lo");
 
+    if (ui->standbyDevEdit->text().isEmpty())
+        m_settings->remove("input/standby_device");
+    else
+        m_settings->setValue("input/standby_device", ui->standbyDevEdit->text());
+
     int_val = ui->inSrCombo->currentText().toInt(&conv_ok);
     if (conv_ok)
         m_settings->setValue("input/sample_rate", int_val);
@@ -578,18 +602,22 @@ void CIoConfig::updateDecimations(void)
     decimationChanged(0);
 }
 
-void CIoConfig::updateInDev(const QSettings *settings, const std::map<QString, QVariant> &devList)
+void CIoConfig::updateInDev(const QString &indev, const QVector<DeviceCache::Device> &devices)
 {
-    QString indev = settings->value("input/device", "").toString();
     bool cfgmatch = false; //flag to indicate that device from config was found
+    QDateTime scanned = m_devices->scanned();
 
     // insert the device list in device combo box
     ui->inDevCombo->clear();
     int i = 0;
-    for (auto it = devList.cbegin(); it != devList.cend(); it++, i++)
+    for (auto it = devices.cbegin(); it != devices.cend(); it++, i++)
     {
-        auto devstr = (*it).second.toString();
-        ui->inDevCombo->addItem((*it).first, devstr);
+        auto devstr = (*it).devstr;
+        ui->inDevCombo->addItem((*it).label, devstr);
+        if ((*it).seen < scanned)
+            ui->inDevCombo->setItemData(i, tr("Not found by the last scan, last seen %1")
+                                        .arg(QLocale().toString((*it).seen, QLocale::ShortFormat)),
+                                        Qt::ToolTipRole);
 
         // is this the device stored in config?
         if (indev == devstr)
@@ -631,6 +659,13 @@ void CIoConfig::updateOutDev()
     ui->outDevCombo->clear();
     ui->outDevCombo->addItem("Default");
 
+    // Only the PulseAudio output has a latency that can be set
+#ifdef WITH_PULSEAUDIO
+    ui->outLatencySpin->setValue(m_settings->value("output/latency_ms", PA_SINK_LATENCY_MS).toInt());
+#else
+    ui->outLatencySpin->setEnabled(false);
+#endif
+
     // get list of audio output devices
 #ifdef WITH_PULSEAUDIO
    pa_device_list devices;
@@ -760,12 +795,37 @@ void CIoConfig::decimationChanged(int index)
  */
 void CIoConfig::onScanButtonClicked()
 {
-    m_devList->clear();
-    CIoConfig::getDeviceList(*m_devList);
-    updateInDev(m_settings, *m_devList);
+    m_devices->refresh();
     updateOutDev();
 }
 
+/** Show that the device list is being refreshed. */
+void CIoConfig::onScanStarted()
+{
+    m_scanButton->setEnabled(false);
+    m_scanButton->setText(tr("Scanning..."));
+}
+
+/**
+ * @brief The device scan has finished.
+ *
+ * The list is filled again, keeping the device string in the edit box.
+ * Only if there is none yet, as at the first start, the first device found
+ * is selected as if by the user.
+ */
+void CIoConfig::onDevicesUpdated()
+{
+    m_scanButton->setEnabled(true);
+    m_scanButton->setText(tr("&Device scan"));
+
+    QString indev = ui->inDevEdit->text();
+    ui->inDevCombo->blockSignals(true);
+    updateInDev(indev, m_devices->devices());
+    ui->inDevCombo->blockSignals(false);
+    if (indev.isEmpty() && !ui->inDevEdit->text().isEmpty())
+        inputDeviceSelected(ui->inDevCombo->currentIndex());
+}
+
 /** Convert a combo box index to decimation. */
 int CIoConfig::idx2decim(int idx) const
 {
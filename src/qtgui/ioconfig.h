@@ -26,6 +26,9 @@
 #include <QDialog>
 #include <QSettings>
 #include <QString>
+#include <QVector>
+
+#include "qtgui/device_cache.h"
 
 #ifdef WITH_PULSEAUDIO
 #include "pulseaudio/pa_device_list.h"
@@ -46,7 +49,7 @@ class CIoConfig : public QDialog
     Q_OBJECT
 
 public:
-    explicit CIoConfig(QSettings *settings, std::map<QString, QVariant> &devList, QWidget *parent = 0);
+    explicit CIoConfig(QSettings *settings, DeviceCache *devices, QWidget *parent = 0);
     virtual ~CIoConfig();
     static void getDeviceList(std::map<QString, QVariant> &devList);
 
@@ -57,11 +60,13 @@ private slots:
     void inputRateChanged(const QString &text);
     void decimationChanged(int index);
     void onScanButtonClicked();
+    void onScanStarted();
+    void onDevicesUpdated();
 
 private:
     void updateInputSampleRates(int rate);
     void updateDecimations(void);
-    void updateInDev(const QSettings *settings, const std::map<QString, QVariant> &devList);
+    void updateInDev(const QString &indev, const QVector<DeviceCache::Device> &devices);
     void updateOutDev();
     int  idx2decim(int idx) const;
     int  decim2idx(int decim) const;
@@ -71,7 +76,7 @@ private:
     Ui::CIoConfig  *ui;
     QSettings      *m_settings;
     QPushButton    *m_scanButton;
-    std::map<QString, QVariant> *m_devList; // will point to devList from constructor
+    DeviceCache    *m_devices;
 
 #ifdef WITH_PULSEAUDIO
     vector<pa_device>           outDevList;
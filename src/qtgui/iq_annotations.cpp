@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cmath>
+#include "iq_annotations.h"
+#include "../applications/gqrx/receiver.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+IqAnnotations::IqAnnotations(receiver *rx, QObject *parent)
+    : QObject(parent)
+    , m_rx(rx)
+    , m_rate(0.0)
+    , m_frequency(0.0)
+    , m_next(0)
+    , m_changes(0)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(IQ_ANNOTATIONS_FLUSH_MS);
+    connect(&m_timer, &QTimer::timeout, this, &IqAnnotations::flush);
+}
+
+IqAnnotations::~IqAnnotations()
+{
+    stop();
+}
+
+void IqAnnotations::start(const QString &metaPath, const QJsonObject &meta, double rate,
+                          double frequency)
+{
+    stop();
+    m_path = metaPath;
+    m_meta = meta;
+    m_rate = rate;
+    m_frequency = frequency;
+    m_next = 0;
+    m_changes = 0;
+}
+
+/** Write what has changed and forget the recording. */
+void IqAnnotations::stop()
+{
+    if (!isActive())
+        return;
+
+    flush();
+    m_timer.stop();
+    m_path.clear();
+    m_events.clear();
+    m_other.clear();
+}
+
+/** Sample of the recording at a time in seconds since the epoch, -1 without one. */
+qint64 IqAnnotations::sampleAt(double time) const
+{
+    uint64_t position;
+    if (!m_rx->get_iq_recording_position(position))
+        return -1;
+
+    const double now = QDateTime::currentMSecsSinceEpoch() / 1000.0;
+    return (qint64)position - qRound64((now - time) * m_rate);
+}
+
+/** Events of the sigint dock, in the band of the recording. */
+void IqAnnotations::addEvents(const QVector<SignalEvent> &events)
+{
+    if (!isActive())
+        return;
+
+    for (const SignalEvent &event : events)
+    {
+        if (std::abs(event.center_freq - m_frequency) > m_rate / 2.0)
+            continue;
+
+        const qint64 stop = sampleAt(std::max(event.stop_time, event.start_time));
+        if (stop < 0)
+            continue;
+
+        // The start stays where it was first seen
+        auto it = m_events.constFind(event.id);
+        const qint64 start = it != m_events.constEnd()
+            ? (qint64)(*it)["core:sample_start"].toDouble()
+            : std::max(sampleAt(event.start_time), (qint64)0);
+
+        m_events.insert(event.id, QJsonObject {
+            {"core:sample_start", start},
+            {"core:sample_count", std::max(stop - start, (qint64)0)},
+            {"core:freq_lower_edge", event.center_freq - event.bandwidth / 2.0},
+            {"core:freq_upper_edge", event.center_freq + event.bandwidth / 2.0},
+            {"core:label", event.classification.isEmpty() ? QString("signal") : event.classification},
+            {"core:generator", QString("Gqrx %1").arg(event.range)},
+            {"core:comment", QString("Peak %1 dBFS").arg(event.peak_db, 0, 'f', 1)},
+        });
+        changed();
+    }
+}
+
+/** Span of time in seconds since the epoch, equal times for an instant. */
+void IqAnnotations::addRange(double start_time, double stop_time, double center_freq,
+                             double bandwidth, const QString &generator, const QString &label,
+                             const QString &comment)
+{
+    if (!isActive())
+        return;
+
+    const qint64 stop = sampleAt(std::max(stop_time, start_time));
+    if (stop < 0)
+        return;
+    const qint64 start = std::max(sampleAt(start_time), (qint64)0);
+
+    QJsonObject annotation {
+        {"core:sample_start", start},
+        {"core:sample_count", std::max(stop - start, (qint64)0)},
+        {"core:generator", generator},
+        {"core:label", label},
+    };
+    if (bandwidth > 0.0)
+    {
+        annotation.insert("core:freq_lower_edge", center_freq - bandwidth / 2.0);
+        annotation.insert("core:freq_upper_edge", center_freq + bandwidth / 2.0);
+    }
+    if (!comment.isEmpty())
+        annotation.insert("core:comment", comment);
+    m_other.insert(m_next++, annotation);
+    changed();
+}
+
+void IqAnnotations::changed()
+{
+    if (++m_changes >= IQ_ANNOTATIONS_BATCH)
+        flush();
+    else if (!m_timer.isActive())
+        m_timer.start();
+}
+
+/** Rewrite the metadata with the annotations. */
+void IqAnnotations::flush()
+{
+    m_timer.stop();
+    if (!isActive() || m_changes == 0)
+        return;
+    m_changes = 0;
+
+    QVector<QJsonObject> annotations;
+    annotations.reserve(m_events.size() + m_other.size());
+    for (const QJsonObject &annotation : m_events)
+        annotations.append(annotation);
+    for (const QJsonObject &annotation : m_other)
+        annotations.append(annotation);
+    std::stable_sort(annotations.begin(), annotations.end(),
+                     [](const QJsonObject &a, const QJsonObject &b) {
+        return a["core:sample_start"].toDouble() < b["core:sample_start"].toDouble();
+    });
+
+    QJsonArray array;
+    for (const QJsonObject &annotation : annotations)
+        array.append(annotation);
+    QJsonObject meta = m_meta;
+    meta.insert("annotations", array);
+
+    const QByteArray data = QJsonDocument(meta).toJson();
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+        qWarning() << "Can not write" << m_path;
+}
@@ -0,0 +1,72 @@
+#ifndef IQ_ANNOTATIONS_H
+#define IQ_ANNOTATIONS_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include "emission_tracker.h"
+
+class receiver;
+
+// Longest time new annotations wait before the metadata is written
+#define IQ_ANNOTATIONS_FLUSH_MS 5000
+
+// Changed annotations that have the metadata written at once
+#define IQ_ANNOTATIONS_BATCH 100
+
+/*
+ * Annotations of a running SigMF recording.
+ *
+ * The events of the detector, the classifier and the survey, squelch
+ * openings and bookmarks become annotations with the range of samples they
+ * cover and their band, so an analysis can go to them without reading the
+ * samples. The sample of a time is counted back from the position of the
+ * recorder when the annotation is added, which leaves out the samples it
+ * dropped. An event that is reported again as it lasts updates its
+ * annotation.
+ *
+ * The metadata is rewritten whole, sorted by the first sample as SigMF
+ * asks, IQ_ANNOTATIONS_FLUSH_MS after a change or after
+ * IQ_ANNOTATIONS_BATCH changes, and when the recording stops. It is
+ * replaced atomically, so a reader never sees half a file.
+ */
+class IqAnnotations : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit IqAnnotations(receiver *rx, QObject *parent = nullptr);
+    ~IqAnnotations();
+
+    // meta without annotations, rate and frequency of the samples
+    void start(const QString &metaPath, const QJsonObject &meta, double rate, double frequency);
+    void stop();
+    bool isActive() const { return !m_path.isEmpty(); }
+
+public slots:
+    void addEvents(const QVector<SignalEvent> &events);
+    void addRange(double start_time, double stop_time, double center_freq, double bandwidth,
+                  const QString &generator, const QString &label, const QString &comment);
+    void flush();
+
+private:
+    qint64 sampleAt(double time) const;
+    void changed();
+
+    receiver    *m_rx;
+    QString      m_path;
+    QJsonObject  m_meta;
+    double       m_rate;
+    double       m_frequency;
+    qint64       m_next;        // key of the next annotation that is no event
+
+    QHash<qint64, QJsonObject> m_events;    // by event id
+    QHash<qint64, QJsonObject> m_other;
+    int          m_changes;     // since the last write
+    QTimer       m_timer;
+};
+
+#endif // IQ_ANNOTATIONS_H
@@ -0,0 +1,90 @@
+#include "iq_capture.h"
+#include "../applications/gqrx/receiver.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+IqCapture::IqCapture(receiver *rx, QObject *parent)
+    : QObject(parent)
+    , m_rx(rx)
+    , m_pre(0.0)
+    , m_post(IQ_CAPTURE_POST_SEC)
+{
+}
+
+void IqCapture::setWindow(double pre_sec, double post_sec)
+{
+    m_pre = qMax(pre_sec, 0.0);
+    m_post = qMax(post_sec, 0.0);
+    m_rx->set_iq_pretrigger(m_pre);
+}
+
+/*
+ * Start a capture, or extend the running one.
+ *
+ * The metadata is written after the ring has been asked for the capture,
+ * since the start of the file, and so its time, depends on how much of
+ * preTrigger() the ring holds yet.
+ */
+bool IqCapture::trigger(const QString &reason)
+{
+    if (!isEnabled())
+        return false;
+
+    if (m_rx->iq_capture_active() && m_rx->extend_iq_capture(m_post))
+    {
+        emit captureExtended(m_path, reason);
+        return true;
+    }
+
+    auto freq = qRound64(m_rx->get_rf_freq());
+    auto rate = m_rx->get_input_rate() / m_rx->get_input_decim();
+    auto now = QDateTime::currentDateTimeUtc();
+    auto filenameTemplate = now.toString("%1/gqrx_yyyyMMdd_hhmmss_%2_%3_fc.%4")
+                            .arg(m_dir).arg(freq).arg(qRound64(rate));
+    QString path = filenameTemplate.arg("sigmf-data");
+
+    double captured_pre = 0.0;
+    if (m_rx->start_iq_capture(path.toStdString(), m_pre, m_post, captured_pre))
+    {
+        qWarning() << "Can not start I/Q capture to" << path;
+        return false;
+    }
+
+    auto start = now.addMSecs(-qRound64(captured_pre * 1000.0));
+    auto meta = QJsonDocument { QJsonObject {
+        {"global", QJsonObject {
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+            {"core:datatype", "cf32_be"},
+#else
+            {"core:datatype", "cf32_le"},
+#endif
+            {"core:sample_rate", rate},
+            {"core:version", "1.0.0"},
+            {"core:recorder", "Gqrx " VERSION},
+            {"core:hw", QString("OsmoSDR: ") + m_hw},
+        }}, {"captures", QJsonArray {
+            QJsonObject {
+                {"core:sample_start", 0},
+                {"core:frequency", freq},
+                {"core:datetime", start.toString(Qt::ISODateWithMs)},
+            },
+        }}, {"annotations", QJsonArray {
+            QJsonObject {
+                {"core:sample_start", qRound64(captured_pre * rate)},
+                {"core:comment", reason},
+            },
+        }},
+    }}.toJson();
+
+    QFile metaFile(filenameTemplate.arg("sigmf-meta"));
+    if (!metaFile.open(QIODevice::WriteOnly) || metaFile.write(meta) != meta.size())
+        qWarning() << "Can not write" << metaFile.fileName();
+
+    m_path = path;
+    emit captureStarted(path, reason);
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef IQ_CAPTURE_H
+#define IQ_CAPTURE_H
+
+#include <QObject>
+#include <QString>
+
+class receiver;
+
+// Default time kept before a trigger
+#define IQ_CAPTURE_PRE_SEC 30.0
+
+// Default time written after a trigger
+#define IQ_CAPTURE_POST_SEC 10.0
+
+/*
+ * Event triggered I/Q captures from the pre-trigger ring of the receiver.
+ *
+ * trigger() writes a SigMF recording from preTrigger() before the event to
+ * postTrigger() after it, named like the recordings of the I/Q tool, so it
+ * can be played back from there. A trigger while a capture is running
+ * makes it last postTrigger() from then instead of starting another one.
+ * The reason of each new capture is its first annotation.
+ */
+class IqCapture : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit IqCapture(receiver *rx, QObject *parent = nullptr);
+
+    void setDirectory(const QString &dir) { m_dir = dir; }
+    void setHardware(const QString &hw) { m_hw = hw; }
+
+    // 0 s before the trigger frees the ring and disables the captures
+    void setWindow(double pre_sec, double post_sec);
+    double preTrigger() const { return m_pre; }
+    double postTrigger() const { return m_post; }
+    bool isEnabled() const { return m_pre > 0.0; }
+
+public slots:
+    bool trigger(const QString &reason);
+
+signals:
+    void captureStarted(const QString &path, const QString &reason);
+    void captureExtended(const QString &path, const QString &reason);
+
+private:
+    receiver *m_rx;
+    QString   m_dir;
+    QString   m_hw;
+    QString   m_path;       // of the last capture
+    double    m_pre;
+    double    m_post;
+};
+
+#endif // IQ_CAPTURE_H
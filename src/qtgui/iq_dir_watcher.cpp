@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <QDir>
+#include <QFileInfo>
+#include "iq_dir_watcher.h"
+
+void IqDirLister::list(const QString &path, const QStringList &filters)
+{
+    QStringList names;
+    QVector<qint64> sizes;
+    const QFileInfoList entries = QDir(path).entryInfoList(filters, QDir::Files,
+                                                          QDir::Name | QDir::IgnoreCase);
+    names.reserve(entries.size());
+    sizes.reserve(entries.size());
+    for (const QFileInfo &info : entries) {
+        names.append(info.fileName());
+        sizes.append(info.size());
+    }
+    emit listed(path, names, sizes);
+}
+
+IqDirWatcher::IqDirWatcher(const QStringList &filters, QObject *parent)
+    : QObject(parent)
+    , m_filters(filters)
+    , m_busy(false)
+    , m_pending(false)
+{
+    qRegisterMetaType<QVector<qint64>>("QVector<qint64>");
+
+    m_lister = new IqDirLister();
+    m_lister->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_lister, &QObject::deleteLater);
+    connect(this, &IqDirWatcher::listRequested, m_lister, &IqDirLister::list);
+    connect(m_lister, &IqDirLister::listed, this, &IqDirWatcher::listed);
+    m_thread.start();
+
+    m_settle.setSingleShot(true);
+    m_settle.setInterval(IQ_DIR_SETTLE_MS);
+    connect(&m_settle, &QTimer::timeout, this, &IqDirWatcher::rescan);
+    m_rescan.setInterval(IQ_DIR_RESCAN_MS);
+    connect(&m_rescan, &QTimer::timeout, this, &IqDirWatcher::rescan);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &IqDirWatcher::directoryChanged);
+}
+
+IqDirWatcher::~IqDirWatcher()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void IqDirWatcher::setPath(const QString &path)
+{
+    if (path == m_path)
+        return;
+
+    if (!m_watcher.directories().isEmpty())
+        m_watcher.removePaths(m_watcher.directories());
+    m_path = path;
+    m_files.clear();
+    m_sizes.clear();
+    m_watcher.addPath(path);
+    m_rescan.start();
+    rescan();
+}
+
+/** List the directory, after the listing in the thread if there is one. */
+void IqDirWatcher::rescan()
+{
+    if (m_path.isEmpty())
+        return;
+
+    if (m_busy) {
+        m_pending = true;
+        return;
+    }
+    m_busy = true;
+    m_pending = false;
+    emit listRequested(m_path, m_filters);
+}
+
+bool IqDirWatcher::lessThan(const QString &a, const QString &b)
+{
+    return a.compare(b, Qt::CaseInsensitive) < 0;
+}
+
+void IqDirWatcher::directoryChanged(const QString &path)
+{
+    Q_UNUSED(path);
+    m_settle.start();
+}
+
+void IqDirWatcher::listed(const QString &path, const QStringList &names, const QVector<qint64> &sizes)
+{
+    m_busy = false;
+    if (m_pending)
+        rescan();
+    if (path != m_path)
+        return;
+
+    // Both lists are sorted, so they are merged
+    QStringList added;
+    QStringList removed;
+    bool resized = false;
+    QHash<QString, qint64> newSizes;
+    newSizes.reserve(names.size());
+    int i = 0;
+    int j = 0;
+    while (i < m_files.size() || j < names.size()) {
+        if (j == names.size() || (i < m_files.size() && lessThan(m_files[i], names[j]))) {
+            removed.append(m_files[i++]);
+            continue;
+        }
+        if (i == m_files.size() || lessThan(names[j], m_files[i])) {
+            added.append(names[j]);
+        } else if (m_files[i] != names[j]) {
+            // Renamed to another case
+            removed.append(m_files[i++]);
+            added.append(names[j]);
+        } else {
+            resized |= m_sizes.value(names[j]) != sizes[j];
+            i++;
+        }
+        newSizes.insert(names[j], sizes[j]);
+        j++;
+    }
+
+    m_files = names;
+    m_sizes.swap(newSizes);
+    if (!added.isEmpty() || !removed.isEmpty() || resized)
+        emit updated(added, removed);
+}
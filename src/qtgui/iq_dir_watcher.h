@@ -0,0 +1,91 @@
+#ifndef IQ_DIR_WATCHER_H
+#define IQ_DIR_WATCHER_H
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+// Time a burst of changes in the directory is collected for before it is listed
+#define IQ_DIR_SETTLE_MS 200
+
+// Interval of the listings that catch the changes the watcher does not see,
+// such as files written by other hosts on a network file system
+#define IQ_DIR_RESCAN_MS 30000
+
+/*
+ * Lists a directory with the sizes of its files, in the thread of an
+ * IqDirWatcher.
+ */
+class IqDirLister : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void list(const QString &path, const QStringList &filters);
+
+signals:
+    void listed(const QString &path, const QStringList &names, const QVector<qint64> &sizes);
+};
+
+/*
+ * The recordings in a directory, kept up to date without blocking the GUI.
+ *
+ * The directory is listed in a thread of its own when a QFileSystemWatcher
+ * reports a change, after the changes have settled for IQ_DIR_SETTLE_MS,
+ * and every IQ_DIR_RESCAN_MS. Each listing is compared with the previous
+ * one and only the differences are reported, so a view can update its rows
+ * instead of being filled again. The files are in the order of QDir::Name
+ * with QDir::IgnoreCase, as lessThan() compares them.
+ */
+class IqDirWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    IqDirWatcher(const QStringList &filters, QObject *parent = nullptr);
+    ~IqDirWatcher();
+
+    // Forget the files of the previous directory and list the new one
+    void setPath(const QString &path);
+    QString path() const { return m_path; }
+
+    void rescan();
+
+    const QStringList &files() const { return m_files; }
+
+    // Size in bytes as of the last listing, -1 if not listed yet
+    qint64 size(const QString &name) const { return m_sizes.value(name, -1); }
+
+    static bool lessThan(const QString &a, const QString &b);
+
+signals:
+    // Files that appeared and disappeared, either may be empty if only sizes changed
+    void updated(const QStringList &added, const QStringList &removed);
+
+    void listRequested(const QString &path, const QStringList &filters);
+
+private slots:
+    void directoryChanged(const QString &path);
+    void listed(const QString &path, const QStringList &names, const QVector<qint64> &sizes);
+
+private:
+    QStringList         m_filters;
+    QString             m_path;
+    QStringList         m_files;
+    QHash<QString, qint64> m_sizes;
+    bool                m_busy;         // a listing is in the thread
+    bool                m_pending;      // and another one is due after it
+
+    QFileSystemWatcher  m_watcher;
+    QTimer              m_settle;
+    QTimer              m_rescan;
+    QThread             m_thread;
+    IqDirLister        *m_lister;
+};
+
+#endif // IQ_DIR_WATCHER_H
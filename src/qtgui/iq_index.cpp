@@ -0,0 +1,260 @@
+#include "iq_index.h"
+#include "spectrum_file.h"
+#include "../dsp/fft_plan_cache.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QJsonObject>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+IqIndex::IqIndex(QObject *parent)
+    : QObject(parent)
+    , m_bytes(8)
+    , m_rate(0.0)
+    , m_center(0)
+    , m_size(0)
+    , m_mtime(0)
+    , m_ready(false)
+    , m_data(nullptr)
+    , m_samples(0)
+    , m_columns(0)
+    , m_next(0)
+    , m_done(0)
+    , m_quit(false)
+{
+    m_poll.setInterval(IQ_INDEX_POLL_MS);
+    connect(&m_poll, &QTimer::timeout, this, &IqIndex::poll);
+}
+
+IqIndex::~IqIndex()
+{
+    cancel();
+}
+
+/**
+ * Start indexing a recording, or load its index if it is up to date.
+ * ready() is emitted when the index is there, at once if it was loaded.
+ */
+void IqIndex::open(const QString &path, int bytesPerSample, double sampleRate, qint64 centerFreq)
+{
+    cancel();
+
+    QFileInfo info(path);
+    m_path = path;
+    m_bytes = bytesPerSample;
+    m_rate = sampleRate;
+    m_center = centerFreq;
+    m_size = info.size();
+    m_mtime = info.lastModified().toMSecsSinceEpoch();
+    m_samples = m_size / m_bytes;
+    m_columns = (int)std::min<qint64>(IQ_INDEX_COLUMNS, m_samples / IQ_INDEX_BINS);
+    if (m_columns == 0)
+        return;
+
+    if (load()) {
+        m_ready = true;
+        emit ready();
+        return;
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly) || !(m_data = m_file.map(0, m_size))) {
+        qDebug() << "IqIndex: cannot map" << path << m_file.errorString();
+        m_file.close();
+        m_columns = 0;
+        return;
+    }
+
+    m_avg.assign((size_t)m_columns * IQ_INDEX_BINS, 0.0f);
+    m_max.assign((size_t)m_columns * IQ_INDEX_BINS, 0.0f);
+    m_next = 0;
+    m_done = 0;
+    m_quit = false;
+    const unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int i = 0; i < threads; i++)
+        m_workers.emplace_back(&IqIndex::worker, this);
+    m_poll.start();
+    emit progress(0);
+}
+
+/** Stop indexing and forget the index. */
+void IqIndex::cancel()
+{
+    m_poll.stop();
+    m_quit = true;
+    for (std::thread &thread : m_workers)
+        thread.join();
+    m_workers.clear();
+
+    if (m_data)
+        m_file.unmap((uchar *)m_data);
+    m_data = nullptr;
+    m_file.close();
+
+    m_ready = false;
+    m_columns = 0;
+    m_avg.clear();
+    m_max.clear();
+}
+
+void IqIndex::poll()
+{
+    const int done = m_done;
+    if (done < m_columns) {
+        emit progress(100 * done / m_columns);
+        return;
+    }
+
+    m_poll.stop();
+    for (std::thread &thread : m_workers)
+        thread.join();
+    m_workers.clear();
+    m_file.unmap((uchar *)m_data);
+    m_data = nullptr;
+    m_file.close();
+
+    save();
+    m_ready = true;
+    emit ready();
+}
+
+/** Read the index of the recording, if it was made from the recording as it is now. */
+bool IqIndex::load()
+{
+    SpectrumFileReader reader;
+    if (!reader.open(indexPath(m_path)))
+        return false;
+
+    const QJsonObject meta = reader.metadata();
+    if (meta["type"].toString() != "iq_index" ||
+        (qint64)meta["data_size"].toDouble() != m_size ||
+        (qint64)meta["data_mtime"].toDouble() != m_mtime ||
+        meta["bytes_per_sample"].toInt() != m_bytes)
+        return false;
+
+    const int columns = meta["columns"].toInt();
+    if (columns <= 0 || reader.rows() != 2 * columns)
+        return false;
+
+    std::vector<float> avg((size_t)columns * IQ_INDEX_BINS);
+    std::vector<float> max((size_t)columns * IQ_INDEX_BINS);
+    for (int col = 0; col < columns; col++) {
+        if (reader.row(2 * col).bins != IQ_INDEX_BINS || reader.row(2 * col + 1).bins != IQ_INDEX_BINS ||
+            !reader.levels(2 * col, &avg[(size_t)col * IQ_INDEX_BINS]) ||
+            !reader.levels(2 * col + 1, &max[(size_t)col * IQ_INDEX_BINS]))
+            return false;
+    }
+
+    m_columns = columns;
+    m_avg.swap(avg);
+    m_max.swap(max);
+    return true;
+}
+
+/** Write the index next to the recording, it is only made again if that fails. */
+void IqIndex::save()
+{
+    QJsonObject meta;
+    meta["type"] = "iq_index";
+    meta["created"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    meta["data_file"] = QFileInfo(m_path).fileName();
+    meta["data_size"] = (double)m_size;
+    meta["data_mtime"] = (double)m_mtime;
+    meta["bytes_per_sample"] = m_bytes;
+    meta["sample_rate"] = m_rate;
+    meta["center_freq"] = (double)m_center;
+    meta["columns"] = m_columns;
+    meta["ffts"] = IQ_INDEX_FFTS;
+
+    SpectrumFileWriter writer;
+    if (!writer.open(indexPath(m_path), meta)) {
+        qDebug() << "IqIndex: cannot write" << indexPath(m_path) << writer.errorString();
+        return;
+    }
+
+    SpectrumRowHeader row;
+    row.bins = IQ_INDEX_BINS;
+    row.fft_size = IQ_INDEX_BINS;
+    row.start_freq = m_center - m_rate / 2.0;
+    row.bin_hz = m_rate / IQ_INDEX_BINS;
+    row.timestamp = 0.0;
+    row.steps = 1;
+    for (int col = 0; col < m_columns; col++) {
+        row.sample_index = (uint64_t)(m_samples * (col + 1) / m_columns);
+        row.kind = SpectrumRowHeader::SURVEY_AVG;
+        writer.append(row, &m_avg[(size_t)col * IQ_INDEX_BINS]);
+        row.kind = SpectrumRowHeader::SURVEY_MAX;
+        writer.append(row, &m_max[(size_t)col * IQ_INDEX_BINS]);
+    }
+}
+
+/** Samples as floats, the integer formats at the scale of iq_file_sink. */
+void IqIndex::convert(std::complex<float> *out, qint64 index, int count) const
+{
+    const uchar *p = m_data + index * m_bytes;
+
+    if (m_bytes == 4) {
+        const int16_t *in = (const int16_t *)p;
+        for (int i = 0; i < count; i++)
+            out[i] = std::complex<float>(in[2 * i], in[2 * i + 1]) / 32767.0f;
+    } else if (m_bytes == 2) {
+        const int8_t *in = (const int8_t *)p;
+        for (int i = 0; i < count; i++)
+            out[i] = std::complex<float>(in[2 * i], in[2 * i + 1]) / 127.0f;
+    } else {
+        memcpy(out, p, sizeof(std::complex<float>) * count);
+    }
+}
+
+/** Compute columns until there are none left, DC in the middle of each. */
+void IqIndex::worker()
+{
+    const int bins = IQ_INDEX_BINS;
+
+    std::vector<float> window(bins);
+    float gain = 0.0f;
+    for (int i = 0; i < bins; i++) {
+        window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / (bins - 1));
+        gain += window[i];
+    }
+    // A full scale tone in a bin is at 0 dB
+    const float norm = 1.0f / (gain * gain);
+
+    fft_plan_cache::fft_c *fft = fft_plan_cache::acquire(bins);
+    for (;;) {
+        const int col = m_next++;
+        if (col >= m_columns || m_quit)
+            break;
+
+        const qint64 first = m_samples * col / m_columns;
+        const qint64 span = m_samples * (col + 1) / m_columns - first;
+        const int ffts = (int)std::min<qint64>(IQ_INDEX_FFTS, span / bins);
+        float *avg = &m_avg[(size_t)col * bins];
+        float *max = &m_max[(size_t)col * bins];
+        std::fill(avg, avg + bins, 0.0f);
+        std::fill(max, max + bins, 0.0f);
+
+        for (int k = 0; k < ffts; k++) {
+            const qint64 start = first + (ffts > 1 ? (span - bins) * k / (ffts - 1) : 0);
+            std::complex<float> *in = fft->get_inbuf();
+            convert(in, start, bins);
+            for (int i = 0; i < bins; i++)
+                in[i] *= window[i];
+            fft->execute();
+            const std::complex<float> *out = fft->get_outbuf();
+            for (int i = 0; i < bins; i++) {
+                const float power = std::norm(out[(i + bins / 2) % bins]) * norm;
+                avg[i] += power;
+                max[i] = std::max(max[i], power);
+            }
+        }
+        for (int i = 0; i < bins; i++) {
+            avg[i] = 10.0f * log10f(avg[i] / ffts + 1.0e-20f);
+            max[i] = 10.0f * log10f(max[i] + 1.0e-20f);
+        }
+        m_done++;
+    }
+    fft_plan_cache::release(fft, bins);
+}
@@ -0,0 +1,98 @@
+#ifndef IQ_INDEX_H
+#define IQ_INDEX_H
+
+#include <atomic>
+#include <complex>
+#include <thread>
+#include <vector>
+#include <QFile>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+// Columns (time) and bins (frequency) of an index
+#define IQ_INDEX_COLUMNS 1024
+#define IQ_INDEX_BINS    256
+
+// Most FFTs per column, evenly spread over the part of the recording it covers
+#define IQ_INDEX_FFTS 256
+
+// Interval of the progress updates
+#define IQ_INDEX_POLL_MS 100
+
+// Appended to the name of a recording for the name of its index
+#define IQ_INDEX_SUFFIX ".spectrum"
+
+/*
+ * Low resolution spectrogram of an I/Q recording, to find the activity in
+ * it without playing it.
+ *
+ * Each column covers an equal part of the recording and holds the average
+ * and the maximum of up to IQ_INDEX_FFTS power spectra from that part.
+ * Only those FFTs are read, so an index takes a fraction of the time the
+ * recording lasts; a signal longer than the spacing of the FFTs is in the
+ * maximum wherever it is.
+ *
+ * The columns are computed by one thread per core, reading the recording
+ * through a memory map. The index is written into a spectrum file next to
+ * the recording, as SURVEY_AVG and SURVEY_MAX rows, and read from there
+ * again while the size and the time of the recording match.
+ */
+class IqIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit IqIndex(QObject *parent = nullptr);
+    ~IqIndex();
+
+    // Index an uncompressed recording of 8 (cf32), 4 (cs16) or 2 (cs8) bytes per sample
+    void open(const QString &path, int bytesPerSample, double sampleRate, qint64 centerFreq);
+    void cancel();
+
+    bool isReady() const { return m_ready; }
+    int columns() const { return m_columns; }
+    int bins() const { return IQ_INDEX_BINS; }
+
+    // dB per column from the lowest frequency up, columns() times bins()
+    const std::vector<float> &average() const { return m_avg; }
+    const std::vector<float> &peak() const { return m_max; }
+
+    static QString indexPath(const QString &path) { return path + IQ_INDEX_SUFFIX; }
+
+signals:
+    void progress(int percent);
+    void ready();
+
+private slots:
+    void poll();
+
+private:
+    bool load();
+    void save();
+    void worker();
+    void convert(std::complex<float> *out, qint64 index, int count) const;
+
+    QString                 m_path;
+    int                     m_bytes;        // per sample
+    double                  m_rate;
+    qint64                  m_center;
+    qint64                  m_size;         // of the recording when it was opened
+    qint64                  m_mtime;        // ms since the epoch
+    bool                    m_ready;
+
+    QFile                   m_file;
+    const uchar            *m_data;         // mapping of m_file
+    qint64                  m_samples;
+    int                     m_columns;
+    std::vector<float>      m_avg;
+    std::vector<float>      m_max;
+
+    std::vector<std::thread> m_workers;
+    std::atomic<int>        m_next;         // next column to compute
+    std::atomic<int>        m_done;         // columns computed
+    std::atomic<bool>       m_quit;
+    QTimer                  m_poll;
+};
+
+#endif // IQ_INDEX_H
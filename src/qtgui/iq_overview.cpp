@@ -0,0 +1,87 @@
+#include "iq_overview.h"
+#include <QMouseEvent>
+#include <QPainter>
+#include <algorithm>
+
+CIqOverview::CIqOverview(QWidget *parent)
+    : QFrame(parent)
+    , m_position(-1.0)
+{
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    setFrameStyle(QFrame::StyledPanel | QFrame::Sunken);
+}
+
+QSize CIqOverview::minimumSizeHint() const
+{
+    return QSize(100, 48);
+}
+
+QSize CIqOverview::sizeHint() const
+{
+    return QSize(400, 48);
+}
+
+void CIqOverview::setImage(const QImage &image)
+{
+    m_image = image;
+    update();
+}
+
+void CIqOverview::setText(const QString &text)
+{
+    if (text == m_text)
+        return;
+    m_text = text;
+    update();
+}
+
+void CIqOverview::setPosition(double fraction)
+{
+    // Only repaint when the marker moves by a pixel
+    if (qRound(fraction * width()) == qRound(m_position * width()))
+        return;
+    m_position = fraction;
+    update();
+}
+
+void CIqOverview::paintEvent(QPaintEvent *event)
+{
+    QFrame::paintEvent(event);
+
+    QPainter painter(this);
+    const QRect area = contentsRect();
+    if (m_image.isNull()) {
+        painter.setPen(palette().color(QPalette::Disabled, QPalette::Text));
+        painter.drawText(area, Qt::AlignCenter, m_text);
+        return;
+    }
+
+    painter.drawImage(area, m_image);
+    if (m_position >= 0.0) {
+        const int x = area.left() + qRound(m_position * (area.width() - 1));
+        painter.setPen(Qt::white);
+        painter.drawLine(x, area.top(), x, area.bottom());
+    }
+}
+
+void CIqOverview::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton)
+        select(event->pos().x());
+}
+
+void CIqOverview::mouseMoveEvent(QMouseEvent *event)
+{
+    if (event->buttons() & Qt::LeftButton)
+        select(event->pos().x());
+}
+
+void CIqOverview::select(int x)
+{
+    if (m_image.isNull())
+        return;
+
+    const QRect area = contentsRect();
+    const double fraction = (double)(x - area.left()) / std::max(area.width() - 1, 1);
+    emit positionSelected(std::min(std::max(fraction, 0.0), 1.0));
+}
@@ -0,0 +1,48 @@
+#ifndef IQ_OVERVIEW_H
+#define IQ_OVERVIEW_H
+
+#include <QFrame>
+#include <QImage>
+#include <QString>
+
+/*
+ * Navigation strip of the I/Q tool: the spectrogram of a whole recording
+ * with time from left to right and a marker at the playback position.
+ *
+ * Clicking or dragging on it emits positionSelected() with the part of the
+ * recording under the mouse, 0 at the start and 1 at the end.
+ */
+class CIqOverview : public QFrame
+{
+    Q_OBJECT
+
+public:
+    explicit CIqOverview(QWidget *parent = nullptr);
+
+    QSize minimumSizeHint() const override;
+    QSize sizeHint() const override;
+
+    // A null image shows the text instead
+    void setImage(const QImage &image);
+    void setText(const QString &text);
+
+    // Negative hides the marker
+    void setPosition(double fraction);
+
+signals:
+    void positionSelected(double fraction);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private:
+    void select(int x);
+
+    QImage  m_image;
+    QString m_text;
+    double  m_position;
+};
+
+#endif // IQ_OVERVIEW_H
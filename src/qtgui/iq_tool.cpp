@@ -24,14 +24,20 @@
 #include <QDebug>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QImage>
 #include <QDir>
 #include <QPalette>
 #include <QString>
 #include <QStringList>
 #include <QScrollBar>
 
+#include <algorithm>
 #include <math.h>
 
+#include "colormap.h"
+#include "iq_capture.h"
+#include "iq_dir_watcher.h"
+#include "iq_index.h"
 #include "iq_tool.h"
 #include "ui_iq_tool.h"
 
@@ -43,22 +49,44 @@ CIqTool::CIqTool(QWidget *parent) :
     ui->setupUi(this);
 
     is_recording = false;
+    select_new = false;
     is_playing = false;
+    position_known = false;
     bytes_per_sample = 8;
+    is_playable = true;
     sample_rate = 192000;
     rec_len = 0;
     center_freq = 1e8;
 
     //ui->recDirEdit->setText(QDir::currentPath());
 
-    recdir = new QDir(QDir::homePath(), "*.raw");
-    recdir->setNameFilters(recdir->nameFilters() << "*.sigmf-data");
+    recdir = new QDir(QDir::homePath());
+    dir_watcher = new IqDirWatcher({"*.raw", "*.sigmf-data", "*.raw.gz", "*.sigmf-data.gz"}, this);
+    connect(dir_watcher, SIGNAL(updated(QStringList,QStringList)),
+            this, SLOT(filesUpdated(QStringList,QStringList)));
+
+#ifndef WITH_ZLIB
+    ui->compressBox->setChecked(false);
+    ui->compressBox->setEnabled(false);
+    ui->compressBox->setToolTip(tr("This build has no zlib"));
+#endif
 
     error_palette = new QPalette();
     error_palette->setColor(QPalette::Text, Qt::red);
 
     timer = new QTimer(this);
     connect(timer, SIGNAL(timeout()), this, SLOT(timeoutFunction()));
+
+    iq_index = new IqIndex(this);
+    connect(iq_index, SIGNAL(ready()), this, SLOT(showOverview()));
+    connect(iq_index, SIGNAL(progress(int)), this, SLOT(indexProgress(int)));
+    connect(ui->overview, SIGNAL(positionSelected(double)), this, SLOT(overviewPositionSelected(double)));
+
+    ui->captureButton->setEnabled(false);
+    connect(ui->preSpin, SIGNAL(valueChanged(double)), this, SLOT(captureSettingsEdited()));
+    connect(ui->postSpin, SIGNAL(valueChanged(double)), this, SLOT(captureSettingsEdited()));
+    connect(ui->detectorBox, SIGNAL(toggled(bool)), this, SLOT(captureSettingsEdited()));
+    connect(ui->squelchBox, SIGNAL(toggled(bool)), this, SLOT(captureSettingsEdited()));
 }
 
 CIqTool::~CIqTool()
@@ -79,8 +107,7 @@ void CIqTool::setSampleRate(qint64 sr)
     if (!current_file.isEmpty())
     {
         // Get duration of selected recording and update label
-        QFileInfo info(*recdir, current_file);
-        rec_len = (int)(info.size() / (sample_rate * bytes_per_sample));
+        rec_len = (int)(fileSize() / (sample_rate * bytes_per_sample));
         refreshTimeWidgets();
     }
 }
@@ -91,14 +118,22 @@ void CIqTool::on_listWidget_currentTextChanged(const QString &currentText)
 {
 
     current_file = currentText;
-    QFileInfo info(*recdir, current_file);
 
     parseFileName(currentText);
-    rec_len = (int)(info.size() / (sample_rate * bytes_per_sample));
+    rec_len = (int)(fileSize() / (sample_rate * bytes_per_sample));
+    ui->slider->setValue(0);
 
     // Get duration of selected recording and update label
     refreshTimeWidgets();
 
+    // Overview of the recording, unless it is the one being written
+    ui->overview->setImage(QImage());
+    ui->overview->setText(QString());
+    if (is_playable && !is_recording && !current_file.isEmpty())
+        iq_index->open(recdir->absoluteFilePath(current_file), bytes_per_sample, sample_rate,
+                       center_freq);
+    else
+        iq_index->cancel();
 }
 
 /*! \brief Start/stop playback */
@@ -124,12 +159,33 @@ void CIqTool::on_playButton_clicked(bool checked)
 
             ui->playButton->setChecked(false); // will not trig clicked()
         }
+        else if (!is_playable)
+        {
+            QMessageBox msg_box;
+            msg_box.setIcon(QMessageBox::Critical);
+            msg_box.setText(tr("Only uncompressed recordings can be played back."));
+            msg_box.exec();
+
+            ui->playButton->setChecked(false);
+        }
         else
         {
+            QString samples = "cf32";
+            if (bytes_per_sample == 4)
+                samples = "cs16";
+            else if (bytes_per_sample == 2)
+                samples = "cs8";
+
             ui->listWidget->setEnabled(false);
             ui->recButton->setEnabled(false);
+            position_known = false;
             emit startPlayback(recdir->absoluteFilePath(current_file),
-                               (float)sample_rate, center_freq);
+                               (float)sample_rate, center_freq, samples);
+            on_speedCombo_currentTextChanged(ui->speedCombo->currentText());
+
+            // Start where the overview or the slider was set to
+            if (ui->slider->value() > 0)
+                emit seek((qint64)ui->slider->value() * sample_rate);
         }
     }
     else
@@ -161,8 +217,91 @@ void CIqTool::on_slider_valueChanged(int value)
 {
     refreshTimeWidgets();
 
-    qint64 seek_pos = (qint64)(value)*sample_rate;
-    emit seek(seek_pos);
+    if (is_playing)
+    {
+        qint64 seek_pos = (qint64)(value)*sample_rate;
+        emit seek(seek_pos);
+    }
+}
+
+/*! \brief Playback speed has changed, e.g. "-2x" for twice as fast backwards. */
+void CIqTool::on_speedCombo_currentTextChanged(const QString &text)
+{
+    bool ok;
+    double speed = text.left(text.size() - 1).toDouble(&ok);
+
+    if (ok)
+        emit playbackSpeedChanged(speed);
+}
+
+/*! \brief Show the position of the playback, unless the slider is dragged.
+ *
+ * The slider then no longer moves on by itself once a second.
+ */
+void CIqTool::setPlaybackPosition(quint64 sample)
+{
+    position_known = true;
+    if (!is_playing || ui->slider->isSliderDown() || sample_rate <= 0)
+        return;
+
+    ui->slider->blockSignals(true);
+    ui->slider->setValue((int)(sample / sample_rate));
+    ui->slider->blockSignals(false);
+    refreshTimeWidgets();
+}
+
+/*! \brief Switch the overview between average and peak levels. */
+void CIqTool::on_overviewCombo_currentIndexChanged(int index)
+{
+    Q_UNUSED(index);
+    showOverview();
+}
+
+/*! \brief Show the index of the selected recording in the overview.
+ *
+ * The median of the average levels is at the bottom of the colormap and
+ * the strongest peak at the top, in both views.
+ */
+void CIqTool::showOverview(void)
+{
+    if (!iq_index->isReady())
+        return;
+
+    const std::vector<float> &avg = iq_index->average();
+    const std::vector<float> &peak = iq_index->peak();
+    const std::vector<float> &db = ui->overviewCombo->currentIndex() == 1 ? peak : avg;
+    int columns = iq_index->columns();
+    int bins = iq_index->bins();
+
+    std::vector<float> sorted(avg);
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    float floor = sorted[sorted.size() / 2];
+    float top = *std::max_element(peak.begin(), peak.end());
+
+    CColormap colormap;
+    colormap.setRange(floor, std::max(top, floor + 10.0f));
+
+    // High frequencies at the top
+    QImage image(columns, bins, QImage::Format_RGB32);
+    for (int y = 0; y < bins; y++)
+    {
+        QRgb *line = (QRgb *)image.scanLine(y);
+        for (int x = 0; x < columns; x++)
+            line[x] = colormap.rgb(db[(size_t)x * bins + bins - 1 - y]);
+    }
+    ui->overview->setImage(image);
+}
+
+/*! \brief The selected recording is being indexed. */
+void CIqTool::indexProgress(int percent)
+{
+    ui->overview->setText(tr("Indexing %1%").arg(percent));
+}
+
+/*! \brief Move the slider, and the playback, to where the overview was clicked. */
+void CIqTool::overviewPositionSelected(double fraction)
+{
+    ui->slider->setValue(qRound(fraction * rec_len));
 }
 
 /*! \brief Start/stop recording */
@@ -173,18 +312,49 @@ void CIqTool::on_recButton_clicked(bool checked)
     if (checked)
     {
         ui->playButton->setEnabled(false);
-        emit startRecording(recdir->path(), ui->formatCombo->currentText());
+        emit startRecording(recdir->path(), ui->formatCombo->currentText(),
+                            ui->samplesCombo->currentText(),
+                            ui->compressBox->isChecked());
 
-        refreshDir();
-        ui->listWidget->setCurrentRow(ui->listWidget->count()-1);
+        // The recording is selected when the directory watcher finds it
+        select_new = true;
     }
     else
     {
         ui->playButton->setEnabled(true);
+        ui->bufferLabel->clear();
+        select_new = false;
         emit stopRecording();
+        dir_watcher->rescan();  // for the final size
     }
 }
 
+/*! \brief Show the buffer fill and dropped samples of the recording. */
+void CIqTool::setRecordingStats(float ring_fill, quint64 dropped)
+{
+    if (!is_recording)
+        return;
+
+    QString text = tr("Buffer %1%").arg(qRound(100.0f * ring_fill));
+    if (dropped > 0)
+        text += tr(", %1 dropped").arg(dropped);
+    ui->bufferLabel->setText(text);
+}
+
+/*! \brief Write a capture from the pre-trigger ring. */
+void CIqTool::on_captureButton_clicked()
+{
+    emit captureRequested();
+}
+
+/*! \brief Pre-trigger, post-trigger or the triggers have been changed. */
+void CIqTool::captureSettingsEdited()
+{
+    ui->captureButton->setEnabled(ui->preSpin->value() > 0.0);
+    emit captureSettingsChanged(ui->preSpin->value(), ui->postSpin->value(),
+                                ui->detectorBox->isChecked(), ui->squelchBox->isChecked());
+}
+
 /*! Public slot to start IQ recording by external events (e.g. remote control).
  *
  * If a recording is already in progress we ignore the event.
@@ -225,6 +395,7 @@ void CIqTool::cancelRecording()
 {
     ui->recButton->setChecked(false);
     ui->playButton->setEnabled(true);
+    ui->bufferLabel->clear();
     is_recording = false;
 }
 
@@ -245,7 +416,7 @@ void CIqTool::closeEvent(QCloseEvent *event)
 void CIqTool::showEvent(QShowEvent * event)
 {
     Q_UNUSED(event);
-    refreshDir();
+    dir_watcher->rescan();
     refreshTimeWidgets();
     timer->start(1000);
 }
@@ -268,6 +439,44 @@ void CIqTool::saveSettings(QSettings *settings)
         settings->setValue("baseband/rec_format", format);
     else
         settings->remove("baseband/rec_format");
+
+    QString samples = ui->samplesCombo->currentText();
+    if (samples != "cf32")
+        settings->setValue("baseband/rec_samples", samples);
+    else
+        settings->remove("baseband/rec_samples");
+
+    if (ui->compressBox->isChecked())
+        settings->setValue("baseband/rec_compress", true);
+    else
+        settings->remove("baseband/rec_compress");
+
+    // Levels shown in the overview of a recording
+    if (ui->overviewCombo->currentIndex() != 0)
+        settings->setValue("baseband/overview", ui->overviewCombo->currentText());
+    else
+        settings->remove("baseband/overview");
+
+    // Event triggered captures
+    if (ui->preSpin->value() > 0.0)
+        settings->setValue("baseband/pretrigger", ui->preSpin->value());
+    else
+        settings->remove("baseband/pretrigger");
+
+    if (ui->postSpin->value() != IQ_CAPTURE_POST_SEC)
+        settings->setValue("baseband/posttrigger", ui->postSpin->value());
+    else
+        settings->remove("baseband/posttrigger");
+
+    if (ui->detectorBox->isChecked())
+        settings->setValue("baseband/capture_detector", true);
+    else
+        settings->remove("baseband/capture_detector");
+
+    if (ui->squelchBox->isChecked())
+        settings->setValue("baseband/capture_squelch", true);
+    else
+        settings->remove("baseband/capture_squelch");
 }
 
 void CIqTool::readSettings(QSettings *settings)
@@ -282,6 +491,30 @@ void CIqTool::readSettings(QSettings *settings)
     // Format of baseband recordings
     QString format = settings->value("baseband/rec_format", "Raw").toString();
     ui->formatCombo->setCurrentText(format);
+
+    // Sample format and compression of baseband recordings
+    QString samples = settings->value("baseband/rec_samples", "cf32").toString();
+    ui->samplesCombo->setCurrentText(samples);
+#ifdef WITH_ZLIB
+    ui->compressBox->setChecked(settings->value("baseband/rec_compress", false).toBool());
+#endif
+
+    ui->overviewCombo->setCurrentText(settings->value("baseband/overview", "Average").toString());
+
+    // Event triggered captures, set at once
+    ui->preSpin->blockSignals(true);
+    ui->postSpin->blockSignals(true);
+    ui->detectorBox->blockSignals(true);
+    ui->squelchBox->blockSignals(true);
+    ui->preSpin->setValue(settings->value("baseband/pretrigger", 0.0).toDouble());
+    ui->postSpin->setValue(settings->value("baseband/posttrigger", IQ_CAPTURE_POST_SEC).toDouble());
+    ui->detectorBox->setChecked(settings->value("baseband/capture_detector", false).toBool());
+    ui->squelchBox->setChecked(settings->value("baseband/capture_squelch", false).toBool());
+    ui->preSpin->blockSignals(false);
+    ui->postSpin->blockSignals(false);
+    ui->detectorBox->blockSignals(false);
+    ui->squelchBox->blockSignals(false);
+    captureSettingsEdited();
 }
 
 
@@ -295,6 +528,8 @@ void CIqTool::on_recDirEdit_textChanged(const QString &dir)
         ui->recDirEdit->setPalette(QPalette());  // Clear custom color
         recdir->setPath(dir);
         recdir->cd(dir);
+        ui->listWidget->clear();
+        dir_watcher->setPath(recdir->path());
         //emit newRecDirSelected(dir);
     }
     else
@@ -317,9 +552,7 @@ void CIqTool::on_recDirButton_clicked()
 
 void CIqTool::timeoutFunction(void)
 {
-    refreshDir();
-
-    if (is_playing)
+    if (is_playing && !position_known)
     {
         // advance slider with one second
         int val = ui->slider->value();
@@ -332,33 +565,76 @@ void CIqTool::timeoutFunction(void)
         }
     }
     if (is_recording)
+    {
+        // update rec_len; if the file being recorded is the one selected
+        // in the list, the length will update periodically
+        QFileInfo info(*recdir, current_file);
+        rec_len = (int)(info.size() / (sample_rate * bytes_per_sample));
         refreshTimeWidgets();
+    }
 }
 
-/*! \brief Refresh list of files in current working directory. */
-void CIqTool::refreshDir()
+/*! \brief Apply the changes found by the directory watcher to the list.
+ *
+ * Rows are inserted and removed in place, so the selection and the scroll
+ * position stay where they are.
+ */
+void CIqTool::filesUpdated(const QStringList &added, const QStringList &removed)
 {
-    int selection = ui->listWidget->currentRow();
     QScrollBar * sc = ui->listWidget->verticalScrollBar();
     int lastScroll = sc->sliderPosition();
-
-    recdir->refresh();
-    QStringList files = recdir->entryList();
+    bool found;
 
     ui->listWidget->blockSignals(true);
-    ui->listWidget->clear();
-    ui->listWidget->insertItems(0, files);
-    ui->listWidget->setCurrentRow(selection);
+    for (const QString &name : removed)
+    {
+        int row = fileRow(name, &found);
+        if (found)
+            delete ui->listWidget->takeItem(row);
+    }
+    for (const QString &name : added)
+    {
+        int row = fileRow(name, &found);
+        if (!found)
+            ui->listWidget->insertItem(row, name);
+    }
     sc->setSliderPosition(lastScroll);
     ui->listWidget->blockSignals(false);
 
-    if (is_recording)
+    if (select_new && !added.isEmpty())
     {
-        // update rec_len; if the file being recorded is the one selected
-        // in the list, the length will update periodically
-        QFileInfo info(*recdir, current_file);
-        rec_len = (int)(info.size() / (sample_rate * bytes_per_sample));
+        select_new = false;
+        ui->listWidget->setCurrentRow(fileRow(added.last(), &found));
+    }
+    else if (!current_file.isEmpty() && !is_recording && !is_playing)
+    {
+        rec_len = (int)(fileSize() / (sample_rate * bytes_per_sample));
+        refreshTimeWidgets();
+    }
+}
+
+/*! \brief Row of a file in the sorted list, or where it would be inserted. */
+int CIqTool::fileRow(const QString &name, bool *found) const
+{
+    int lo = 0;
+    int hi = ui->listWidget->count();
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (IqDirWatcher::lessThan(ui->listWidget->item(mid)->text(), name))
+            lo = mid + 1;
+        else
+            hi = mid;
     }
+    *found = lo < ui->listWidget->count() && ui->listWidget->item(lo)->text() == name;
+    return lo;
+}
+
+/*! \brief Size of the selected file, from the last listing if it is in it. */
+qint64 CIqTool::fileSize(void) const
+{
+    qint64 size = dir_watcher->size(current_file);
+    return size >= 0 ? size : QFileInfo(*recdir, current_file).size();
 }
 
 /*! \brief Refresh time labels and slider position
@@ -392,10 +668,14 @@ void CIqTool::refreshTimeWidgets(void)
                            .arg(lh, 2, 10, QChar('0'))
                            .arg(lm, 2, 10, QChar('0'))
                            .arg(ls, 2, 10, QChar('0')));
+
+    ui->overview->setPosition(rec_len > 0 ? (double)ui->slider->value() / rec_len : -1.0);
 }
 
 
-/*! \brief Extract sample rate and offset frequency from file name */
+/*! \brief Extract sample rate, offset frequency and sample format from
+ *         file name
+ */
 void CIqTool::parseFileName(const QString &filename)
 {
     bool   sr_ok;
@@ -408,10 +688,20 @@ void CIqTool::parseFileName(const QString &filename)
     if (list.size() < 5)
         return;
 
-    // gqrx_yymmdd_hhmmss_freq_samprate_fc.raw
+    // gqrx_yymmdd_hhmmss_freq_samprate_fc.raw, cs16 or cs8 instead of fc
+    // and .gz appended for the compact formats
     sr = list.at(4).toLongLong(&sr_ok);
     center = list.at(3).toLongLong(&center_ok);
 
+    QString type = list.size() > 5 ? list.at(5).section('.', 0, 0) : QString("fc");
+    if (type == "cs16")
+        bytes_per_sample = 4;
+    else if (type == "cs8")
+        bytes_per_sample = 2;
+    else
+        bytes_per_sample = 8;
+    is_playable = !filename.endsWith(".gz");
+
     if (sr_ok)
         sample_rate = sr;
     if (center_ok)
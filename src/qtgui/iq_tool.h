@@ -30,8 +30,12 @@
 #include <QSettings>
 #include <QShowEvent>
 #include <QString>
+#include <QStringList>
 #include <QTimer>
 
+class IqDirWatcher;
+class IqIndex;
+
 namespace Ui {
     class CIqTool;
 }
@@ -61,17 +65,27 @@ public:
     void saveSettings(QSettings *settings);
     void readSettings(QSettings *settings);
 
+    QString recordingDir() const { return recdir->path(); }
+
 signals:
-    void startRecording(const QString recdir, const QString format);
+    void startRecording(const QString recdir, const QString format,
+                        const QString samples, bool compress);
     void stopRecording();
-    void startPlayback(const QString filename, float samprate, qint64 center_freq);
+    void startPlayback(const QString filename, float samprate, qint64 center_freq,
+                       const QString samples);
     void stopPlayback();
+    void playbackSpeedChanged(double speed);
     void seek(qint64 seek_pos);
+    void captureSettingsChanged(double pre_sec, double post_sec, bool on_detector,
+                                bool on_squelch);
+    void captureRequested();
 
 public slots:
     void cancelRecording();
     void cancelPlayback();
     void startIqRecorder(void);     /*!< Used if IQ Recorder is started e.g. from remote control */
+    void setRecordingStats(float ring_fill, quint64 dropped);
+    void setPlaybackPosition(quint64 sample);
     void stopIqRecorder(void);      /*!< Used if IQ Recorder is stopped e.g. from remote control */
 
 private slots:
@@ -80,11 +94,20 @@ private slots:
     void on_recButton_clicked(bool checked);
     void on_playButton_clicked(bool checked);
     void on_slider_valueChanged(int value);
+    void on_speedCombo_currentTextChanged(const QString &text);
+    void on_overviewCombo_currentIndexChanged(int index);
+    void showOverview(void);
+    void indexProgress(int percent);
+    void overviewPositionSelected(double fraction);
     void on_listWidget_currentTextChanged(const QString &currentText);
+    void on_captureButton_clicked();
+    void captureSettingsEdited();
     void timeoutFunction(void);
+    void filesUpdated(const QStringList &added, const QStringList &removed);
 
 private:
-    void refreshDir(void);
+    int fileRow(const QString &name, bool *found) const;
+    qint64 fileSize(void) const;
     void refreshTimeWidgets(void);
     void parseFileName(const QString &filename);
 
@@ -94,12 +117,17 @@ private:
     QDir        *recdir;
     QTimer      *timer;
     QPalette    *error_palette; /*!< Palette used to indicate an error. */
+    IqIndex     *iq_index;      /*!< Overview of the selected file. */
+    IqDirWatcher *dir_watcher;  /*!< Recordings in recdir. */
 
     QString current_file;      /*!< Selected file in file browser. */
 
     bool    is_recording;
+    bool    select_new;        /*!< Select the next new file, the one being recorded. */
     bool    is_playing;
-    int     bytes_per_sample;  /*!< Bytes per sample (fc = 4) */
+    bool    position_known;    /*!< The playback reports its position. */
+    int     bytes_per_sample;  /*!< Bytes per sample (fc = 8, cs16 = 4, cs8 = 2) */
+    bool    is_playable;       /*!< Selected file is uncompressed. */
     int     sample_rate;       /*!< Current sample rate. */
     qint64  center_freq;       /*!< Center frequency. */
     int     rec_len;           /*!< Length of a recording in seconds */
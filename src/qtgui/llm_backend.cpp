@@ -0,0 +1,193 @@
+#include <QJsonDocument>
+#include "llm_backend.h"
+
+/* Version of the Anthropic messages API */
+#define ANTHROPIC_API_VERSION "2023-06-01"
+#define ANTHROPIC_API_URL     "https://api.anthropic.com/v1/messages"
+
+AnthropicBackend::AnthropicBackend(const QSslConfiguration &sslConfig) :
+    m_sslConfig(sslConfig)
+{
+}
+
+QString AnthropicBackend::name() const
+{
+    return QUrl(ANTHROPIC_API_URL).host();
+}
+
+/*
+ * The DNS lookup and the TLS handshake are done while the operator types,
+ * and the connection stays in the cache of the network manager. Requests
+ * use the same SSL configuration, so they pick up this connection.
+ */
+void AnthropicBackend::preconnect(QNetworkAccessManager *manager) const
+{
+    manager->connectToHostEncrypted(name(), 443, m_sslConfig);
+}
+
+/* Request to the messages endpoint, allowed to use HTTP/2 */
+QNetworkRequest AnthropicBackend::request(const QString &apiKey, bool stream) const
+{
+    QNetworkRequest request(QUrl(ANTHROPIC_API_URL));
+    request.setSslConfiguration(m_sslConfig);
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setRawHeader("x-api-key", apiKey.toUtf8());
+    request.setRawHeader("anthropic-version", ANTHROPIC_API_VERSION);
+    if (stream)
+        request.setRawHeader("Accept", "text/event-stream");
+    return request;
+}
+
+QByteArray AnthropicBackend::body(const QString &model, const QJsonArray &system,
+                                  const QJsonArray &messages, int maxTokens, bool stream) const
+{
+    QJsonObject body{
+        {"model", model},
+        {"messages", messages},
+        {"max_tokens", maxTokens}
+    };
+    if (stream)
+        body["stream"] = true;
+    if (!system.isEmpty())
+        body["system"] = system;
+    return QJsonDocument(body).toJson(QJsonDocument::Compact);
+}
+
+QString AnthropicBackend::replyText(const QJsonObject &reply) const
+{
+    return reply["content"].toArray()[0].toObject()["text"].toString();
+}
+
+/* Only the data lines are used, the event type is repeated in the JSON */
+void AnthropicBackend::parseStreamLine(const QByteArray &line, QString &delta,
+                                       QString &error, QString &errorType) const
+{
+    if (!line.startsWith("data:"))
+        return;
+
+    const QJsonObject event = QJsonDocument::fromJson(line.mid(5).trimmed()).object();
+    const QString type = event["type"].toString();
+    if (type == "content_block_delta") {
+        const QJsonObject d = event["delta"].toObject();
+        if (d["type"].toString() == "text_delta")
+            delta = d["text"].toString();
+    }
+    else if (type == "error") {
+        const QJsonObject e = event["error"].toObject();
+        error = QString("Error: %1").arg(e["message"].toString());
+        errorType = e["type"].toString();
+    }
+}
+
+OpenAiBackend::OpenAiBackend(const QUrl &url, const QString &model, const QString &apiKey) :
+    m_url(url),
+    m_model(model),
+    m_apiKey(apiKey)
+{
+}
+
+QString OpenAiBackend::name() const
+{
+    return m_url.host();
+}
+
+void OpenAiBackend::preconnect(QNetworkAccessManager *manager) const
+{
+    if (m_url.scheme() == "https")
+        manager->connectToHostEncrypted(m_url.host(), m_url.port(443));
+    else
+        manager->connectToHost(m_url.host(), m_url.port(80));
+}
+
+QNetworkRequest OpenAiBackend::request(const QString &apiKey, bool stream) const
+{
+    Q_UNUSED(apiKey);   // the Anthropic key is not sent to other servers
+
+    QNetworkRequest request(m_url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    if (!m_apiKey.isEmpty())
+        request.setRawHeader("Authorization", "Bearer " + m_apiKey.toUtf8());
+    if (stream)
+        request.setRawHeader("Accept", "text/event-stream");
+    return request;
+}
+
+/* Text blocks as content parts, images as data URLs */
+QJsonValue OpenAiBackend::convertContent(const QJsonValue &content)
+{
+    if (!content.isArray())
+        return content;
+
+    QJsonArray parts;
+    for (const QJsonValue &value : content.toArray()) {
+        const QJsonObject block = value.toObject();
+        const QString type = block["type"].toString();
+        if (type == "text") {
+            parts.append(QJsonObject{{"type", "text"}, {"text", block["text"]}});
+        }
+        else if (type == "image") {
+            const QJsonObject source = block["source"].toObject();
+            const QString url = QString("data:%1;base64,%2")
+                                .arg(source["media_type"].toString(), source["data"].toString());
+            parts.append(QJsonObject{{"type", "image_url"},
+                                     {"image_url", QJsonObject{{"url", url}}}});
+        }
+    }
+    return parts;
+}
+
+QByteArray OpenAiBackend::body(const QString &model, const QJsonArray &system,
+                               const QJsonArray &messages, int maxTokens, bool stream) const
+{
+    QJsonArray converted;
+
+    // The system blocks become one system message
+    QStringList systemText;
+    for (const QJsonValue &block : system)
+        systemText << block.toObject()["text"].toString();
+    if (!systemText.isEmpty())
+        converted.append(QJsonObject{{"role", "system"}, {"content", systemText.join("\n\n")}});
+
+    for (const QJsonValue &value : messages) {
+        const QJsonObject message = value.toObject();
+        converted.append(QJsonObject{{"role", message["role"]},
+                                     {"content", convertContent(message["content"])}});
+    }
+
+    QJsonObject body{
+        {"model", m_model.isEmpty() ? model : m_model},
+        {"messages", converted},
+        {"max_tokens", maxTokens}
+    };
+    if (stream)
+        body["stream"] = true;
+    return QJsonDocument(body).toJson(QJsonDocument::Compact);
+}
+
+QString OpenAiBackend::replyText(const QJsonObject &reply) const
+{
+    return reply["choices"].toArray()[0].toObject()["message"].toObject()["content"].toString();
+}
+
+/* Chunks carry the text in choices[0].delta.content, the stream ends with [DONE] */
+void OpenAiBackend::parseStreamLine(const QByteArray &line, QString &delta,
+                                    QString &error, QString &errorType) const
+{
+    if (!line.startsWith("data:"))
+        return;
+
+    const QByteArray data = line.mid(5).trimmed();
+    if (data == "[DONE]")
+        return;
+
+    const QJsonObject chunk = QJsonDocument::fromJson(data).object();
+    if (chunk.contains("error")) {
+        const QJsonValue e = chunk["error"];
+        error = QString("Error: %1").arg(e.isObject() ? e.toObject()["message"].toString()
+                                                      : e.toString());
+        errorType = e.toObject()["type"].toString();
+        return;
+    }
+    delta = chunk["choices"].toArray()[0].toObject()["delta"].toObject()["content"].toString();
+}
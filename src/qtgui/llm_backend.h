@@ -0,0 +1,115 @@
+#ifndef LLM_BACKEND_H
+#define LLM_BACKEND_H
+
+#include <memory>
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QSslConfiguration>
+#include <QString>
+#include <QUrl>
+
+/**
+ * Server that answers the chat and analysis requests of the dock.
+ *
+ * Requests are built in the form of the Anthropic messages API: a system
+ * array of text blocks and messages whose content is a string or an array
+ * of text and image blocks. A backend turns them into its own request and
+ * reads the text back out of its replies, so NetworkWorker can queue,
+ * retry and stream requests the same way for every server.
+ */
+class LlmBackend
+{
+public:
+    virtual ~LlmBackend() = default;
+
+    /** Name for the log, the host of the server. */
+    virtual QString name() const = 0;
+
+    /** Open the connection ahead of the first request. */
+    virtual void preconnect(QNetworkAccessManager *manager) const = 0;
+
+    virtual QNetworkRequest request(const QString &apiKey, bool stream) const = 0;
+
+    /**
+     * Body of a request.
+     * @param model Model chosen in the dock, used unless the backend has its own.
+     */
+    virtual QByteArray body(const QString &model, const QJsonArray &system,
+                            const QJsonArray &messages, int maxTokens, bool stream) const = 0;
+
+    /** Text of a whole reply, empty if it has none. */
+    virtual QString replyText(const QJsonObject &reply) const = 0;
+
+    /**
+     * Parse one line of a streamed reply.
+     * @param delta Set to the text in the line, if any.
+     * @param error Set to the error reported in the line, if any.
+     * @param errorType Type of that error, for example overloaded_error.
+     */
+    virtual void parseStreamLine(const QByteArray &line, QString &delta,
+                                 QString &error, QString &errorType) const = 0;
+
+    /** Whether requests need the Anthropic API key of the dock. */
+    virtual bool needsApiKey() const { return false; }
+};
+
+typedef std::shared_ptr<const LlmBackend> LlmBackendPtr;
+
+/** The Anthropic messages API, over HTTP/2 with a shared connection. */
+class AnthropicBackend : public LlmBackend
+{
+public:
+    explicit AnthropicBackend(const QSslConfiguration &sslConfig);
+
+    QString name() const override;
+    void preconnect(QNetworkAccessManager *manager) const override;
+    QNetworkRequest request(const QString &apiKey, bool stream) const override;
+    QByteArray body(const QString &model, const QJsonArray &system,
+                    const QJsonArray &messages, int maxTokens, bool stream) const override;
+    QString replyText(const QJsonObject &reply) const override;
+    void parseStreamLine(const QByteArray &line, QString &delta,
+                         QString &error, QString &errorType) const override;
+    bool needsApiKey() const override { return true; }
+
+private:
+    QSslConfiguration m_sslConfig;
+};
+
+/**
+ * A server with the OpenAI chat completions API, as offered by the local
+ * inference servers llama.cpp, Ollama and vLLM.
+ *
+ * Cache control marks are dropped and images are sent as data URLs, which
+ * the server ignores or rejects if its model has no vision support.
+ */
+class OpenAiBackend : public LlmBackend
+{
+public:
+    /**
+     * @param url Endpoint, for example http://192.168.1.10:8080/v1/chat/completions.
+     * @param model Model to ask for, empty to send the model of the dock.
+     * @param apiKey Sent as a bearer token if not empty.
+     */
+    OpenAiBackend(const QUrl &url, const QString &model, const QString &apiKey);
+
+    QString name() const override;
+    void preconnect(QNetworkAccessManager *manager) const override;
+    QNetworkRequest request(const QString &apiKey, bool stream) const override;
+    QByteArray body(const QString &model, const QJsonArray &system,
+                    const QJsonArray &messages, int maxTokens, bool stream) const override;
+    QString replyText(const QJsonObject &reply) const override;
+    void parseStreamLine(const QByteArray &line, QString &delta,
+                         QString &error, QString &errorType) const override;
+
+private:
+    static QJsonValue convertContent(const QJsonValue &content);
+
+    QUrl    m_url;
+    QString m_model;
+    QString m_apiKey;
+};
+
+#endif // LLM_BACKEND_H
@@ -0,0 +1,113 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include "load_governor.h"
+
+/* Weight of the newest frame in the averaged load */
+#define LOAD_GOVERNOR_ALPHA 0.1
+
+static const char *level_names[CLoadGovernor::LEVELS] = {
+    "full", "sigint", "overlay", "waterfall", "fft rate"
+};
+
+CLoadGovernor::CLoadGovernor()
+{
+    reset();
+}
+
+/** Back to full quality, with nothing measured yet. */
+void CLoadGovernor::reset()
+{
+    m_level = FULL;
+    m_load = -1.0;
+    m_overMs = 0;
+    m_underMs = 0;
+    m_restoredMs = 0;
+    m_restoreMs = LOAD_GOVERNOR_RESTORE_MS;
+}
+
+/**
+ * Account one frame.
+ * @param now_ms The current time in milliseconds.
+ * @param load The time spent on the frame as a share of the frame interval.
+ * @param drop Whether the frame rate is below the one set.
+ *
+ * A level has to be over or within budget for its whole delay, counted
+ * again after each change, so that one slow frame does not shed and the
+ * displays do not flicker between two levels.
+ */
+bool CLoadGovernor::update(quint64 now_ms, double load, bool drop)
+{
+    if (m_load < 0.0)
+        m_load = load;
+    else
+        m_load += LOAD_GOVERNOR_ALPHA * (load - m_load);
+
+    const bool over = drop || m_load > LOAD_GOVERNOR_HIGH;
+    const bool under = !drop && m_load < LOAD_GOVERNOR_LOW;
+    if (!over)
+        m_overMs = 0;
+    else if (m_overMs == 0)
+        m_overMs = now_ms;
+    if (!under)
+        m_underMs = 0;
+    else if (m_underMs == 0)
+        m_underMs = now_ms;
+
+    // A restore that held for long resets the delay
+    if (m_restoredMs && now_ms - m_restoredMs >= LOAD_GOVERNOR_MAX_RESTORE_MS)
+    {
+        m_restoredMs = 0;
+        m_restoreMs = LOAD_GOVERNOR_RESTORE_MS;
+    }
+
+    if (over && m_level < LEVELS - 1 && now_ms - m_overMs >= LOAD_GOVERNOR_SHED_MS)
+    {
+        // The last restore did not hold, wait longer before the next
+        if (m_restoredMs && now_ms - m_restoredMs < m_restoreMs + LOAD_GOVERNOR_SHED_MS)
+            m_restoreMs = std::min(m_restoreMs * 2, (quint64)LOAD_GOVERNOR_MAX_RESTORE_MS);
+        m_restoredMs = 0;
+        m_level++;
+        m_overMs = 0;
+        m_underMs = 0;
+        return true;
+    }
+
+    if (under && m_level > FULL && now_ms - m_underMs >= m_restoreMs)
+    {
+        m_restoredMs = now_ms;
+        m_level--;
+        m_overMs = 0;
+        m_underMs = 0;
+        return true;
+    }
+
+    return false;
+}
+
+const char *CLoadGovernor::levelName(int level)
+{
+    if (level < 0 || level >= LEVELS)
+        return "";
+    return level_names[level];
+}
@@ -0,0 +1,88 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef LOAD_GOVERNOR_H
+#define LOAD_GOVERNOR_H
+
+#include <QtGlobal>
+
+/* Share of the frame interval the GUI may spend on a frame before shedding */
+#define LOAD_GOVERNOR_HIGH        0.7
+
+/* Share below which a shed level is restored */
+#define LOAD_GOVERNOR_LOW         0.35
+
+/* Time over budget before the next level is shed */
+#define LOAD_GOVERNOR_SHED_MS     1000
+
+/* Time within budget before a level is restored, doubled up to
+ * LOAD_GOVERNOR_MAX_RESTORE_MS when restoring it overloads again at once */
+#define LOAD_GOVERNOR_RESTORE_MS  5000
+#define LOAD_GOVERNOR_MAX_RESTORE_MS 60000
+
+/* FFT rate below which the rate is not shed */
+#define LOAD_GOVERNOR_MIN_FPS     10
+
+/**
+ * Quality levels of the spectrum displays under GUI thread load.
+ *
+ * The load is the time the GUI thread spends on a frame, as a share of the
+ * FFT timer interval. When it stays above LOAD_GOVERNOR_HIGH, or frames are
+ * dropped, one more level is shed, the least visible display first. When it
+ * stays below LOAD_GOVERNOR_LOW, the last shed level is restored. The
+ * governor only decides the level, MainWindow applies it. Audio and recording
+ * run in the flow graph and are never shed.
+ */
+class CLoadGovernor
+{
+public:
+    enum eLevel {
+        FULL = 0,   // everything at the rates set by the user
+        SIGINT,     // sigint dock views at a lower rate
+        OVERLAY,    // spectrum without fill and peak markers
+        WATERFALL,  // waterfall at half its resolution
+        FFT_RATE,   // FFT at half its rate
+        LEVELS
+    };
+
+    CLoadGovernor();
+
+    void reset();
+
+    /** Account one frame, true when the level has changed. */
+    bool update(quint64 now_ms, double load, bool drop);
+
+    int    level() const { return m_level; }
+    double load() const { return m_load; }
+
+    static const char *levelName(int level);
+
+private:
+    int     m_level;
+    double  m_load;         // averaged over the last frames
+    quint64 m_overMs;       // since when over budget, 0 if not
+    quint64 m_underMs;      // since when within budget, 0 if not
+    quint64 m_restoredMs;   // time of the last restore
+    quint64 m_restoreMs;    // current restore delay
+};
+
+#endif // LOAD_GOVERNOR_H
@@ -78,21 +78,40 @@ void CMeter::setLevel(float dbfs)
     // only redraw when the label needs to change
     if (qRound(m_dBFS * 10) != qRound(old * 10))
     {
-        update();
+        update(levelRect());
     }
 }
 
 void CMeter::setSqlLevel(float dbfs)
 {
+    if (dbfs == m_Sql)
+        return;
     m_Sql = dbfs;
-    update();
+    update(levelRect());
+}
+
+// Bar, squelch mark and label, the part below the scale text that changes
+QRect CMeter::levelRect() const
+{
+    int top = (int)((qreal)height() * CTRL_NEEDLE_TOP);
+    return QRect(0, top, width(), height() - top);
 }
 
 // Called by QT when screen needs to be redrawn
 void CMeter::paintEvent(QPaintEvent *)
 {
+    const qreal dpr = devicePixelRatioF();
+    if (m_overlay.size() != size() * dpr)
+    {
+        m_overlay = QPixmap(size() * dpr);
+        m_overlay.setDevicePixelRatio(dpr);
+        m_overlay.fill(Qt::transparent);
+        QPainter overlay(&m_overlay);
+        drawOverlay(overlay);
+    }
+
     QPainter painter(this);
-    drawOverlay(painter);
+    painter.drawPixmap(0, 0, m_overlay);
     draw(painter);
 }
 
@@ -33,6 +33,7 @@
 
 #include <QtGui>
 #include <QFrame>
+#include <QPixmap>
 
 class CMeter : public QFrame
 {
@@ -55,8 +56,10 @@ protected:
 private:
     void draw(QPainter &painter);
     void drawOverlay(QPainter &painter);
+    QRect levelRect() const;
 
     float   m_dBFS;
     float   m_Sql;
     QFont   m_font;
+    QPixmap m_overlay;      // scale, drawn again when the size changes
 };
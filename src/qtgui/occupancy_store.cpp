@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cmath>
+#include <QtEndian>
+#include "occupancy_store.h"
+
+OccupancyRecorder::OccupancyRecorder(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<OccupancyTile>("OccupancyTile");
+    qRegisterMetaType<QVector<OccupancyTile>>("QVector<OccupancyTile>");
+    qRegisterMetaType<OccupancyResult>("OccupancyResult");
+    for (Level &level : m_levels)
+        level.start = -1;
+}
+
+OccupancyRecorder::~OccupancyRecorder()
+{
+    flush();
+}
+
+/**
+ * Count a frame.
+ * @param dB The power spectrum in dBFS.
+ * @param size The bins of the spectrum.
+ * @param centerFreq The RF frequency of the center bin.
+ * @param sampleRate The bandwidth the bins cover.
+ * @param ms Time of the frame in milliseconds since the epoch.
+ */
+void OccupancyRecorder::addFrame(const float *dB, int size, double centerFreq, double sampleRate,
+                                 qint64 ms)
+{
+    if (size <= 0 || sampleRate <= 0.0)
+        return;
+
+    advance(ms / 1000);
+
+    m_scratch.assign(dB, dB + size);
+    std::nth_element(m_scratch.begin(), m_scratch.begin() + size / 2, m_scratch.end());
+    const float threshold = m_scratch[size / 2] + OCCUPANCY_THRESHOLD_DB;
+
+    // The cells grow with the bins, so each is looked up once
+    const double binHz = sampleRate / size;
+    const double startFreq = centerFreq - sampleRate / 2.0;
+    std::map<qint64, Cell> &cells = m_levels[0].cells;
+    qint64 cell = (qint64)std::floor((startFreq + 0.5 * binHz) / OCCUPANCY_CELL_HZ);
+    float peak = dB[0];
+    for (int i = 1; i <= size; i++)
+    {
+        const qint64 c = i < size
+            ? (qint64)std::floor((startFreq + (i + 0.5) * binHz) / OCCUPANCY_CELL_HZ) : cell + 1;
+        if (c != cell)
+        {
+            Cell &counts = cells.emplace(cell, Cell{0, 0}).first->second;
+            counts.frames++;
+            counts.occupied += peak >= threshold;
+            cell = c;
+            if (i < size)
+                peak = dB[i];
+        }
+        else
+        {
+            peak = std::max(peak, dB[i]);
+        }
+    }
+}
+
+/* Close the intervals that end before second and open the one it is in */
+void OccupancyRecorder::advance(qint64 second)
+{
+    QVector<OccupancyTile> tiles;
+    for (int l = 0; l < OCCUPANCY_LEVELS; l++)
+        if (m_levels[l].start >= 0 && second >= m_levels[l].start + occupancyLevelSeconds[l])
+            close(l, tiles);
+
+    if (m_levels[0].start < 0)
+        m_levels[0].start = second;
+    if (!tiles.isEmpty())
+        emit tilesReady(tiles);
+}
+
+void OccupancyRecorder::flush()
+{
+    QVector<OccupancyTile> tiles;
+    for (int l = 0; l < OCCUPANCY_LEVELS; l++)
+        if (m_levels[l].start >= 0)
+            close(l, tiles);
+    if (!tiles.isEmpty())
+        emit tilesReady(tiles);
+}
+
+/* Write the tiles of a level and add its counts to the next one */
+void OccupancyRecorder::close(int level, QVector<OccupancyTile> &tiles)
+{
+    Level &closing = m_levels[level];
+
+    OccupancyTile tile{level, closing.start, 0, QByteArray()};
+    qint64 next = 0;
+    for (const auto &c : closing.cells)
+    {
+        if (tile.data.isEmpty() || c.first != next ||
+            tile.data.size() >= OCCUPANCY_TILE_CELLS * 8)
+        {
+            if (!tile.data.isEmpty())
+                tiles.append(tile);
+            tile.first_cell = c.first;
+            tile.data.clear();
+        }
+        char pair[8];
+        qToLittleEndian<quint32>(c.second.frames, pair);
+        qToLittleEndian<quint32>(c.second.occupied, pair + 4);
+        tile.data.append(pair, sizeof(pair));
+        next = c.first + 1;
+    }
+    if (!tile.data.isEmpty())
+        tiles.append(tile);
+
+    if (level + 1 < OCCUPANCY_LEVELS && !closing.cells.empty())
+    {
+        const qint64 start = closing.start - closing.start % occupancyLevelSeconds[level + 1];
+        Level &up = m_levels[level + 1];
+        if (up.start >= 0 && up.start != start)
+            close(level + 1, tiles);
+        up.start = start;
+        for (const auto &c : closing.cells)
+        {
+            Cell &counts = up.cells.emplace(c.first, Cell{0, 0}).first->second;
+            counts.frames += c.second.frames;
+            counts.occupied += c.second.occupied;
+        }
+    }
+
+    closing.cells.clear();
+    closing.start = -1;
+}
+
+/**
+ * The level a query reads: the coarsest with an interval of at most a
+ * tenth of the range, or a finer one if its tiles of the range are gone.
+ */
+int OccupancyRecorder::levelFor(double startTime, double stopTime, double now)
+{
+    int level = 0;
+    while (level + 1 < OCCUPANCY_LEVELS &&
+           occupancyLevelSeconds[level + 1] * 10.0 <= stopTime - startTime)
+        level++;
+    while (level + 1 < OCCUPANCY_LEVELS && occupancyKeepSeconds[level] > 0 &&
+           startTime < now - occupancyKeepSeconds[level])
+        level++;
+    return level;
+}
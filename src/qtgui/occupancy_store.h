@@ -0,0 +1,101 @@
+#ifndef OCCUPANCY_STORE_H
+#define OCCUPANCY_STORE_H
+
+#include <map>
+#include <vector>
+#include <QByteArray>
+#include <QMetaType>
+#include <QObject>
+#include <QVector>
+
+/* Width of the frequency cells, on a grid from 0 Hz so that all tunings share it */
+#define OCCUPANCY_CELL_HZ       12500.0
+
+/* A cell is occupied in a frame when its strongest bin is this far over the noise floor */
+#define OCCUPANCY_THRESHOLD_DB  6.0f
+
+/* Aggregation levels, intervals of 1 s, 1 min and 1 h */
+#define OCCUPANCY_LEVELS        3
+
+/* Most cells in one tile */
+#define OCCUPANCY_TILE_CELLS    4096
+
+/** Seconds of each aggregation level. */
+static const int occupancyLevelSeconds[OCCUPANCY_LEVELS] = { 1, 60, 3600 };
+
+/** Seconds the tiles of each level are kept, 0 for ever. */
+static const int occupancyKeepSeconds[OCCUPANCY_LEVELS] = { 6 * 3600, 30 * 86400, 0 };
+
+/**
+ * Counts of a run of cells over one interval of a level, as stored in the
+ * occupancy table. data holds a pair of little endian uint32 per cell:
+ * the frames that covered it and the frames it was occupied in.
+ */
+struct OccupancyTile {
+    int        level;
+    qint64     start;           // seconds since the epoch, a multiple of the interval
+    qint64     first_cell;      // cell of the first pair, frequency / OCCUPANCY_CELL_HZ
+    QByteArray data;
+};
+
+/** Occupancy of a time and frequency range, from the tiles of one level. */
+struct OccupancyResult {
+    double          start_time;
+    double          stop_time;
+    double          start_freq;     // of the first cell
+    int             level;          // the tiles were read from
+    QVector<float>  duty;           // per cell, -1 where it was never seen
+    float           total;          // over the range, -1 without data
+    qint64          frames;         // cell frames counted
+};
+
+Q_DECLARE_METATYPE(OccupancyTile)
+Q_DECLARE_METATYPE(OccupancyResult)
+
+/**
+ * Per cell duty cycle statistics of the shared FFT frames.
+ *
+ * Each frame marks the cells whose strongest bin is OCCUPANCY_THRESHOLD_DB
+ * over its noise floor, the median as in the survey. The counts are summed
+ * over a second, and each closed interval is handed on as tiles and added
+ * to the next level, so the minute and hour tiles are exact sums and a
+ * query of days reads a few hundred rows. Tiles are additive: an interval
+ * cut by a pause or by flush() is stored in more than one row.
+ */
+class OccupancyRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OccupancyRecorder(QObject *parent = nullptr);
+    ~OccupancyRecorder();
+
+    void addFrame(const float *dB, int size, double centerFreq, double sampleRate, qint64 ms);
+
+    /* Close all the intervals, before the recorder stops */
+    void flush();
+
+    /* Level a query of a range reads, the coarsest that resolves it and is kept */
+    static int levelFor(double startTime, double stopTime, double now);
+
+signals:
+    void tilesReady(const QVector<OccupancyTile> &tiles);
+
+private:
+    struct Cell {
+        quint32 frames;
+        quint32 occupied;
+    };
+    struct Level {
+        qint64 start;           // of the open interval, -1 if none
+        std::map<qint64, Cell> cells;
+    };
+
+    void advance(qint64 second);
+    void close(int level, QVector<OccupancyTile> &tiles);
+
+    Level              m_levels[OCCUPANCY_LEVELS];
+    std::vector<float> m_scratch;
+};
+
+#endif // OCCUPANCY_STORE_H
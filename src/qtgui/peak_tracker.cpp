@@ -0,0 +1,320 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include "peak_tracker.h"
+
+/*
+ * Sliding window statistics of v[i - hw .. i + hw] for hw <= i < n - hw.
+ * Max and min use monotonic queues of indices, so every element is pushed
+ * and popped once.
+ */
+static void sliding_stats(const float *v, int n, int hw,
+                          std::vector<float> &vmax, std::vector<float> &vmin,
+                          std::vector<float> &vsum)
+{
+    vmax.assign(n, 0.0f);
+    vmin.assign(n, 0.0f);
+    vsum.assign(n, 0.0f);
+
+    const int len = 2 * hw + 1;
+    if (n < len)
+        return;
+
+    std::vector<int> qmax(n);
+    std::vector<int> qmin(n);
+    int maxHead = 0, maxTail = 0;
+    int minHead = 0, minTail = 0;
+    double sum = 0.0;
+
+    for (int j = 0; j < n; j++)
+    {
+        while (maxTail > maxHead && v[qmax[maxTail - 1]] <= v[j])
+            maxTail--;
+        qmax[maxTail++] = j;
+        while (minTail > minHead && v[qmin[minTail - 1]] >= v[j])
+            minTail--;
+        qmin[minTail++] = j;
+        sum += v[j];
+
+        if (j < len - 1)
+            continue;
+
+        const int first = j - len + 1;
+        if (qmax[maxHead] < first)
+            maxHead++;
+        if (qmin[minHead] < first)
+            minHead++;
+
+        const int i = j - hw;
+        vmax[i] = v[qmax[maxHead]];
+        vmin[i] = v[qmin[minHead]];
+        vsum[i] = (float)sum;
+
+        sum -= v[first];
+    }
+}
+
+CPeakTracker::CPeakTracker() :
+    m_quit(false),
+    m_pending(false),
+    m_resultValid(false),
+    m_reset(false),
+    m_inputStart(0.0),
+    m_inputStep(0.0),
+    m_inputMs(0),
+    m_start(0.0),
+    m_step(0.0),
+    m_ms(0),
+    m_nextId(1)
+{
+}
+
+CPeakTracker::~CPeakTracker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_cond.notify_one();
+    if (m_worker.joinable())
+        m_worker.join();
+}
+
+/**
+ * Queue a detection run.
+ * @param data Linear power of each pixel column.
+ * @param n Number of columns.
+ * @param startFreq Absolute frequency of column 0.
+ * @param hzPerColumn Width of a column in Hz.
+ * @param ms Time of the data.
+ *
+ * The data is copied. If the worker is still busy, a queued request that
+ * has not started is replaced.
+ */
+void CPeakTracker::submit(const float *data, int n, double startFreq, double hzPerColumn,
+                          uint64_t ms)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_input.assign(data, data + std::max(n, 0));
+        m_inputStart = startFreq;
+        m_inputStep = hzPerColumn;
+        m_inputMs = ms;
+        m_pending = true;
+
+        if (!m_worker.joinable())
+            m_worker = std::thread(&CPeakTracker::workerLoop, this);
+    }
+    m_cond.notify_one();
+}
+
+/**
+ * Get the tracks of the latest run.
+ * @param tracks Current tracks (output), unchanged if there is no new run.
+ * @returns true if a run has finished since the last call.
+ */
+bool CPeakTracker::takeTracks(std::vector<Track> &tracks)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_resultValid)
+        return false;
+
+    tracks.swap(m_result);
+    m_resultValid = false;
+    return true;
+}
+
+/** Drop all tracks, for example when peak detection is turned off. */
+void CPeakTracker::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending = false;
+    m_resultValid = false;
+    m_result.clear();
+    m_reset = true;
+}
+
+/**
+ * Find narrow and wide peaks.
+ * @param data Linear power of each column.
+ * @param n Number of columns.
+ * @param pw Half width of the narrow peak window.
+ * @param peaks Column of each peak, in increasing order (output).
+ *
+ * A narrow peak is the max of its window, above twice the window mean and
+ * four times the window min. Wide peaks are found with the same rule in a
+ * five times wider window over the smoothed curve, and are only kept if
+ * there is no narrow peak close to them.
+ */
+void CPeakTracker::detect(const float *data, int n, int pw, std::vector<int> &peaks)
+{
+    std::vector<float> vmax, vmin, vsum;
+    std::vector<float> smooth(data, data + n);
+    std::vector<char> narrow(n, 0);
+
+    peaks.clear();
+
+    sliding_stats(data, n, pw, vmax, vmin, vsum);
+    for (int i = pw; i < n - pw; ++i)
+    {
+        const float vi = data[i];
+        const float avgV = vsum[i] / (float)(pw * 2 + 1);
+        smooth[i] = avgV;
+        if (vi == vmax[i] && (vi > 2.0f * avgV) && (vi > 4.0f * vmin[i]))
+            narrow[i] = 1;
+    }
+
+    // Prefix count of narrow peaks to test the neighbourhood of wide ones
+    std::vector<int> narrowCount(n + 1, 0);
+    for (int i = 0; i < n; ++i)
+        narrowCount[i + 1] = narrowCount[i] + narrow[i];
+
+    const int pw2 = pw * 5;
+    sliding_stats(smooth.data(), n, pw2, vmax, vmin, vsum);
+    for (int i = 0; i < n; ++i)
+    {
+        if (narrow[i])
+        {
+            peaks.push_back(i);
+            continue;
+        }
+        if (i < pw2 || i >= n - pw2)
+            continue;
+
+        const float vi = smooth[i];
+        const float avgV = vsum[i] / (float)(pw2 * 2);
+        if (vi == vmax[i] && (vi > 2.0f * avgV) && (vi > 4.0f * vmin[i]))
+        {
+            const int lo = std::max(i - pw, 0);
+            const int hi = std::min(i + pw + 1, n);
+            if (narrowCount[hi] == narrowCount[lo])
+                peaks.push_back(i);
+        }
+    }
+}
+
+void CPeakTracker::workerLoop()
+{
+    std::vector<int> peaks;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return m_pending || m_quit; });
+            if (m_quit)
+                return;
+            m_pending = false;
+            if (m_reset)
+            {
+                m_tracks.clear();
+                m_reset = false;
+            }
+            m_data.swap(m_input);
+            m_start = m_inputStart;
+            m_step = m_inputStep;
+            m_ms = m_inputMs;
+        }
+
+        detect(m_data.data(), (int)m_data.size(), PEAK_TRACK_HALF_WIDTH, peaks);
+        updateTracks(peaks);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_reset)
+        {
+            m_result = m_tracks;
+            m_resultValid = true;
+        }
+    }
+}
+
+/*
+ * Match detections to tracks, strongest first, each to the nearest free
+ * track within PEAK_TRACK_MAX_SHIFT columns. Unmatched detections start
+ * new tracks.
+ */
+void CPeakTracker::updateTracks(const std::vector<int> &peaks)
+{
+    const double maxShift = PEAK_TRACK_MAX_SHIFT * m_step;
+
+    std::vector<int> order(peaks.size());
+    for (size_t k = 0; k < order.size(); k++)
+        order[k] = (int)k;
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return m_data[peaks[a]] > m_data[peaks[b]];
+    });
+
+    std::vector<char> matched(m_tracks.size(), 0);
+    std::vector<Track> born;
+
+    for (int k : order)
+    {
+        const int col = peaks[k];
+        const double freq = m_start + (double)col * m_step;
+        const float level = m_data[col];
+
+        int best = -1;
+        double bestDist = maxShift;
+        for (size_t t = 0; t < m_tracks.size(); t++)
+        {
+            const double dist = fabs(m_tracks[t].freq - freq);
+            if (!matched[t] && dist <= bestDist)
+            {
+                best = (int)t;
+                bestDist = dist;
+            }
+        }
+
+        if (best >= 0)
+        {
+            Track &track = m_tracks[best];
+            track.freq = freq;
+            track.level = level;
+            track.hits++;
+            track.misses = 0;
+            track.last_ms = m_ms;
+            matched[best] = 1;
+        }
+        else
+        {
+            born.push_back({m_nextId++, freq, level, 1, 0, m_ms, m_ms});
+        }
+    }
+
+    // Age unmatched tracks and drop the ones lost for too long
+    std::vector<Track> tracks;
+    tracks.reserve(m_tracks.size() + born.size());
+    for (size_t t = 0; t < m_tracks.size(); t++)
+    {
+        Track track = m_tracks[t];
+        if (!matched[t] && ++track.misses > PEAK_TRACK_MAX_MISSES)
+            continue;
+        tracks.push_back(track);
+    }
+    tracks.insert(tracks.end(), born.begin(), born.end());
+    std::sort(tracks.begin(), tracks.end(), [](const Track &a, const Track &b) {
+        return a.freq < b.freq;
+    });
+    m_tracks.swap(tracks);
+}
@@ -0,0 +1,105 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef PEAK_TRACKER_H
+#define PEAK_TRACKER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Half width of the narrow peak window in pixel columns */
+#define PEAK_TRACK_HALF_WIDTH   10
+
+/* A detection continues a track if it is within this many columns */
+#define PEAK_TRACK_MAX_SHIFT     5
+
+/* Tracks not seen in this many detection runs are dropped */
+#define PEAK_TRACK_MAX_MISSES    3
+
+/**
+ * Peak detection and tracking for the plotter.
+ *
+ * Detection runs on a worker thread over the pixel columns of the spectrum.
+ * Each column is compared with the max, min and mean of a sliding window,
+ * which are kept with monotonic queues and a running sum, so a run is O(N)
+ * in the number of columns. Wider peaks are found the same way on the
+ * smoothed curve.
+ *
+ * Detections are matched to the tracks of the previous run by frequency.
+ * A track keeps its id as long as it is seen, so consumers get a stable
+ * list of carriers rather than a new set of peaks for every frame.
+ */
+class CPeakTracker
+{
+public:
+    struct Track {
+        int      id;
+        double   freq;      // absolute frequency in Hz
+        float    level;     // linear power, as in the plotter buffers
+        int      hits;      // number of runs the track was detected in
+        int      misses;    // consecutive runs without detection
+        uint64_t first_ms;  // time of the first detection
+        uint64_t last_ms;   // time of the latest detection
+    };
+
+    CPeakTracker();
+    ~CPeakTracker();
+
+    void submit(const float *data, int n, double startFreq, double hzPerColumn, uint64_t ms);
+    bool takeTracks(std::vector<Track> &tracks);
+    void reset();
+
+    static void detect(const float *data, int n, int pw, std::vector<int> &peaks);
+
+private:
+    void workerLoop();
+    void updateTracks(const std::vector<int> &peaks);
+
+    std::thread             m_worker;
+    std::mutex              m_mutex;
+    std::condition_variable m_cond;
+    bool                    m_quit;
+    bool                    m_pending;      // m_input holds a new request
+    bool                    m_resultValid;  // m_result not taken yet
+    bool                    m_reset;
+
+    // Request, filled by submit()
+    std::vector<float>      m_input;
+    double                  m_inputStart;
+    double                  m_inputStep;
+    uint64_t                m_inputMs;
+
+    // Worker state
+    std::vector<float>      m_data;
+    double                  m_start;
+    double                  m_step;
+    uint64_t                m_ms;
+    std::vector<Track>      m_tracks;
+    int                     m_nextId;
+
+    std::vector<Track>      m_result;
+};
+
+#endif // PEAK_TRACKER_H
@@ -27,18 +27,29 @@
  * authors and should not be interpreted as representing official policies, either expressed
  * or implied, of Moe Wheatley.
  */
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <QColor>
 #include <QDateTime>
 #include <QDebug>
 #include <QFont>
+#include <QFontDatabase>
 #include <QPainter>
+#include <QScreen>
 #include <QtGlobal>
+#include <QTimer>
 #include <QToolTip>
+#include <QWindow>
 #include "plotter.h"
 #include "bandplan.h"
 #include "bookmarks.h"
 #include "dxc_spots.h"
+#include "dsp/cpu_dispatch.h"
+#include "dsp/trace.h"
+#ifdef WITH_OPENGL_WATERFALL
+#include "waterfall_gl.h"
+#endif
 #include <volk/volk.h>
 
 Q_LOGGING_CATEGORY(plotter, "plotter")
@@ -53,6 +64,24 @@ Q_LOGGING_CATEGORY(plotter, "plotter")
 
 #define FILTER_WIDTH_MIN_HZ 200
 
+// Narrowest span when the zoom FFT provides the data for zoomed views
+#define ZOOM_FFT_MIN_SPAN_HZ 100
+
+// Number of FFT bins processed per pass in setNewFftData(), sized to keep
+// the working set (input, output, IIR and scratch) in L1 cache
+#define FFT_BLOCK_SIZE 1024
+
+// Columns with fewer bins than this are reduced without VOLK
+#define COLUMN_SIMD_MIN_BINS 16
+
+// dB per unit of log2 of a power, the scale of the log averaging IIR
+#define DB_PER_LOG2 3.0103f
+
+// The histogram splits each hit over the nearest cells with weights in
+// steps of 1 / HIST_WEIGHT_ONE, so one hit adds HIST_HIT in total
+#define HIST_WEIGHT_ONE 16
+#define HIST_HIT        (HIST_WEIGHT_ONE * HIST_WEIGHT_ONE)
+
 // Colors of type QRgb in 0xAARRGGBB format (unsigned int)
 #define PLOTTER_BGD_COLOR           0xFF1F1D1D
 #define PLOTTER_GRID_COLOR          0x80606060
@@ -61,6 +90,8 @@ Q_LOGGING_CATEGORY(plotter, "plotter")
 #define PLOTTER_FILTER_LINE_COLOR   0xB0FF6060
 #define PLOTTER_FILTER_BOX_COLOR    0x28FFFFFF
 #define PLOTTER_MARKER_COLOR        0XB080FF80
+#define PLOTTER_VFO_LINE_COLOR      0xB0FFC040
+#define PLOTTER_VFO_BOX_COLOR       0x20FFC040
 // FIXME: Should cache the QColors also
 
 #define HOR_MARGIN 5
@@ -78,6 +109,45 @@ static inline bool out_of_range(float min, float max)
             max < min + FFT_MIN_DB_RANGE);
 }
 
+// Histogram IIR of one pixel column: decay by decay / 2^32, rounded up so
+// that unlit cells go back to zero, then add the hits of the frame. The max
+// is an integer reduction, so every clone returns the same.
+DSP_MULTIVERSION
+static uint32_t hist_iir(uint32_t *iir, const uint32_t *hits, uint32_t decay, int n)
+{
+    uint32_t vmax = 0;
+    for (int j = 0; j < n; j++)
+    {
+        const uint32_t v = iir[j];
+        const uint32_t d = (uint32_t)(((uint64_t)v * decay) >> 32) + (v != 0);
+        const uint32_t out = std::min(v - d, UINT32_MAX - hits[j]) + hits[j];
+        iir[j] = out;
+        vmax = std::max(vmax, out);
+    }
+    return vmax;
+}
+
+// Max and sum of the bins mapped to one pixel column
+static inline void reduce_bins(const float *in, int n, float &vmax, float &vsum)
+{
+    if (n < COLUMN_SIMD_MIN_BINS)
+    {
+        vmax = in[0];
+        vsum = in[0];
+        for (int k = 1; k < n; k++)
+        {
+            vmax = std::max(vmax, in[k]);
+            vsum += in[k];
+        }
+        return;
+    }
+
+    uint32_t idx = 0;
+    volk_32f_index_max_32u(&idx, in, n);
+    volk_32f_accumulator_s32f(&vsum, in, n);
+    vmax = in[idx];
+}
+
 #define STATUS_TIP \
     "Click, drag or scroll on spectrum to tune. " \
     "Drag and scroll X and Y axes for pan and zoom. " \
@@ -141,6 +211,7 @@ CPlotter::CPlotter(QWidget *parent) : QFrame(parent)
     m_VerDivs = 6;
     m_PandMaxdB = m_WfMaxdB = 0.f;
     m_PandMindB = m_WfMindB = FFT_MAX_DB;
+    m_colormap.setRange(m_WfMindB, m_WfMaxdB);
 
     m_CumWheelDelta = 0;
     m_FreqUnits = 1000000;
@@ -177,6 +248,11 @@ CPlotter::CPlotter(QWidget *parent) : QFrame(parent)
     wf_avg_count = 0;
     wf_span = 0;
     fft_rate = 15;
+
+    m_presentTimer = new QTimer(this);
+    m_presentTimer->setSingleShot(true);
+    m_presentTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_presentTimer, SIGNAL(timeout()), this, SLOT(presentFrame()));
 }
 
 CPlotter::~CPlotter()
@@ -202,6 +278,14 @@ void CPlotter::mouseMoveEvent(QMouseEvent* event)
     int py = qRound((qreal)pt.y() * m_DPR);
     QPoint ppos = QPoint(px, py);
 
+    // The panorama can not be zoomed, panned or tuned by dragging
+    if (m_Panorama)
+    {
+        if (m_TooltipsEnabled)
+            showToolTip(event, QString("%1 kHz").arg(freqFromX(px) / 1.e3, 0, 'f', 3));
+        return;
+    }
+
     /* mouse enter / mouse leave events */
     if (py < h)
     {
@@ -302,11 +386,12 @@ void CPlotter::mouseMoveEvent(QMouseEvent* event)
 
                     QFontMetricsF metrics(m_Font);
                     qreal bandTopY = ((qreal)h) - metrics.height() - 2 * VER_MARGIN - m_BandPlanHeight;
-                    QList<BandInfo> hoverBands = BandPlan::Get().getBandsEncompassing(hoverFrequency);
-                    if(m_BandPlanEnabled && py > bandTopY && !hoverBands.empty())
+                    if (m_BandPlanEnabled && py > bandTopY)
                     {
-                        for (auto & hoverBand : hoverBands)
-                            toolTipText.append("\n" + hoverBand.name);
+                        BandPlan::Get().forEachBandEncompassing(hoverFrequency,
+                            [&toolTipText](const BandInfo &hoverBand) {
+                                toolTipText.append("\n" + hoverBand.name);
+                            });
                     }
                     showToolTip(event, toolTipText);
                 }
@@ -596,10 +681,12 @@ void CPlotter::setWaterfallSpan(quint64 span_ms)
     clearWaterfallBuf();
 }
 
+/** Start the next waterfall line with no frames accumulated. */
 void CPlotter::clearWaterfallBuf()
 {
     for (int i = 0; i < MAX_SCREENSIZE; i++)
         m_wfbuf[i] = 0.0;
+    wf_avg_count = 0;
 }
 
 /** Get waterfall time resolution in milleconds / line. */
@@ -627,6 +714,13 @@ void CPlotter::mousePressEvent(QMouseEvent * event)
     int py = qRound((qreal)pt.y() * m_DPR);
     QPoint ppos = QPoint(px, py);
 
+    if (m_Panorama)
+    {
+        if (event->buttons() == Qt::LeftButton)
+            emit panoramaFreqSelected(roundFreq(freqFromX(px), m_ClickResolution));
+        return;
+    }
+
     if (NOCAP == m_CursorCaptured)
     {
         if (isPointCloseTo(px, m_DemodFreqX, m_CursorCaptureDelta))
@@ -828,8 +922,10 @@ void CPlotter::zoomStepX(float step, int x)
     if (m_fftDataSize != 0)
     {
         double currentZoom = (double)m_SampleFreq / (double)m_Span;
+        double maxZoom = m_ZoomFftEnabled ? (double)m_SampleFreq / ZOOM_FFT_MIN_SPAN_HZ
+                                          : (double)m_fftDataSize / 4;
         if ((step >= 1.0f && currentZoom <= 1.0)
-            || (step < 1.0f && currentZoom >= (double)m_fftDataSize / 4))
+            || (step < 1.0f && currentZoom >= maxZoom))
             return;
     }
 
@@ -924,6 +1020,9 @@ void CPlotter::wheelEvent(QWheelEvent * event)
 #else
     QPointF pt = event->position();
 #endif
+    if (m_Panorama)
+        return;
+
     int h = m_OverlayPixmap.height();
     int px = qRound((qreal)pt.x() * m_DPR);
     int py = qRound((qreal)pt.y() * m_DPR);
@@ -1028,39 +1127,32 @@ void CPlotter::resizeEvent(QResizeEvent* )
         m_2DPixmap = QPixmap(w, plotHeight);
         m_2DPixmap.fill(QColor::fromRgba(PLOTTER_BGD_COLOR));
 
-        // No waterfall, use null image
-        if (wfHeight == 0)
-        {
+        // The waterfall may use a lower resolution than the screen. The
+        // image is scaled up in paintEvent() or by the OpenGL quad.
+        const int wfImgWidth = std::max(qRound((qreal)w * wfResolution() / 100.0), 1);
+        const int wfImgHeight = qRound((qreal)wfHeight * wfResolution() / 100.0);
+
+        // No waterfall, use null image. Otherwise reuse the backing store,
+        // the content is drawn again from history on the next draw().
+        if (wfImgHeight == 0)
             m_WaterfallImage = QImage();
-        }
+        else
+            allocWaterfallImage(wfImgWidth, wfImgHeight);
 
-        // New waterfall, create blank area
-        else if (m_WaterfallImage.isNull()) {
-            m_WaterfallImage = QImage(w, wfHeight, QImage::Format_RGB32);
-            m_WaterfallImage.setDevicePixelRatio(m_DPR);
-            m_WaterfallImage.fill(Qt::black);
-            m_WaterfallOffset = wfHeight;
-        }
+        // Keep one history row per waterfall line
+        m_wfHistory.setCapacity(wfImgHeight);
 
-        // Existing waterfall, rescale width but no height as that would
-        // invalidate time
-        else
+        resizePanorama(w, plotHeight, wfHeight);
+
+#ifdef WITH_OPENGL_WATERFALL
+        if (m_wfGL)
         {
-            const int wfHeightOld = m_WaterfallImage.height();
-            QImage oldWaterfall = m_WaterfallImage.scaled(
-                w, wfHeightOld,
-                Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-            m_WaterfallImage = QImage(w, wfHeight, QImage::Format_RGB32);
-            m_WaterfallImage.setDevicePixelRatio(m_DPR);
-            m_WaterfallImage.fill(Qt::black);
-            const int firstHeight = std::min(wfHeight, wfHeightOld - m_WaterfallOffset);
-            memcpy(m_WaterfallImage.scanLine(0), oldWaterfall.scanLine(m_WaterfallOffset),
-                 m_WaterfallImage.bytesPerLine() * firstHeight);
-            const int secondHeight = std::min(wfHeight - firstHeight, m_WaterfallOffset);
-            memcpy(m_WaterfallImage.scanLine(firstHeight), oldWaterfall.scanLine(0),
-                 m_WaterfallImage.bytesPerLine() * secondHeight);
-            m_WaterfallOffset = wfHeight;
+            m_wfGL->setGeometry(0, rawPlotHeight, s.width(), rawWfHeight);
+            m_wfGL->setVisible(wfImgHeight > 0 && !m_Panorama);
+            m_wfGL->resizeRing(wfImgWidth, wfImgHeight);
+            m_wfLine.assign(wfImgWidth, 0);
         }
+#endif
 
         // Invalidate on resize
         m_MaxHoldValid = false;
@@ -1086,6 +1178,9 @@ void CPlotter::paintEvent(QPaintEvent *)
     // Pixmap resolution scales with DPR. Here, they are rescaled to fit the
     // the CPlotter resolution.
 
+    QElapsedTimer busy;
+    busy.start();
+    CRenderTiming::Scope paintTiming(m_timing, CRenderTiming::PAINT);
     QPainter painter(this);
 
     int plotHeightT = 0;
@@ -1102,14 +1197,32 @@ void CPlotter::paintEvent(QPaintEvent *)
         painter.drawPixmap(plotRectT, m_2DPixmap, plotRectS);
     }
 
-    if (!m_WaterfallImage.isNull())
+    if (m_Panorama && !m_PanoWaterfall.isNull())
+    {
+        // A line per sweep, newest at the top, drawn in two parts like the
+        // waterfall below
+        const qreal wfHeightT = m_Size.height() - plotHeightT;
+        const int wfHeight = m_PanoWaterfall.height();
+        const int firstHeightS = wfHeight - m_PanoWfOffset;
+        const qreal scaleT = wfHeightT / (qreal)wfHeight;
+        painter.drawImage(QRectF(0.0, plotHeightT, m_Size.width(), firstHeightS * scaleT),
+                          m_PanoWaterfall,
+                          QRectF(0.0, m_PanoWfOffset, m_PanoWaterfall.width(), firstHeightS));
+        painter.drawImage(QRectF(0.0, plotHeightT + firstHeightS * scaleT, m_Size.width(),
+                                 m_PanoWfOffset * scaleT),
+                          m_PanoWaterfall,
+                          QRectF(0.0, 0.0, m_PanoWaterfall.width(), m_PanoWfOffset));
+    }
+    else if (!m_WaterfallImage.isNull() && !m_wfGL)
     {
+        // The waterfall fills the rest of the widget whatever its resolution
         const int wfWidth = m_WaterfallImage.width();
-        const int wfWidthT = qRound((qreal)wfWidth / m_DPR);
+        const int wfWidthT = m_Size.width();
         const int wfHeight = m_WaterfallImage.height();
+        const qreal scaleT = (qreal)(m_Size.height() - plotHeightT) / (qreal)wfHeight;
         const int firstHeightS = wfHeight - m_WaterfallOffset;
-        const qreal firstHeightT = firstHeightS / m_DPR;
-        const qreal secondHeightT = m_WaterfallOffset / m_DPR;
+        const qreal firstHeightT = firstHeightS * scaleT;
+        const qreal secondHeightT = m_WaterfallOffset * scaleT;
         // draw the waterfall in two parts based on the location of the offset:
         // the first draw is the section below the offset to be drawm at top
         painter.drawImage(QRectF(0.0, plotHeightT, wfWidthT, firstHeightT), m_WaterfallImage,
@@ -1118,15 +1231,51 @@ void CPlotter::paintEvent(QPaintEvent *)
         painter.drawImage(QRectF(0.0, plotHeightT + firstHeightT, wfWidthT, secondHeightT), m_WaterfallImage,
             QRectF(0.0, 0.0, wfWidth, m_WaterfallOffset));
     }
+
+    paintTiming.stop();
+    m_busyNs += busy.nsecsElapsed();
+    if (m_timing.isEnabled())
+        drawTimingHud(painter);
+}
+
+/** Draw the render timing percentiles in the top right corner. */
+void CPlotter::drawTimingHud(QPainter &painter)
+{
+    const QStringList lines = m_timing.hudLines();
+    const QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    const QFontMetrics metrics(font);
+    int textWidth = 0;
+    for (const QString &line : lines)
+        textWidth = std::max(textWidth, metrics.boundingRect(line).width());
+
+    const int pad = 4;
+    const QRect box(m_Size.width() - textWidth - 3 * pad, pad,
+                    textWidth + 2 * pad, metrics.height() * lines.size() + 2 * pad);
+
+    painter.setFont(font);
+    painter.fillRect(box, QColor(0, 0, 0, 160));
+    painter.setPen(QColor::fromRgba(PLOTTER_TEXT_COLOR));
+    for (int i = 0; i < lines.size(); i++)
+        painter.drawText(box.left() + pad, box.top() + pad + metrics.ascent() + i * metrics.height(),
+                         lines[i]);
 }
 
-// Called to update spectrum data for displaying on the screen
-void CPlotter::draw(bool newData)
+// Called to update spectrum data for displaying on the screen. With
+// present false, new data only goes into the column buffers, holds,
+// histogram and waterfall; the 2D plot is painted later by presentFrame().
+void CPlotter::draw(bool newData, bool present)
 {
+    TRACE_SCOPE("gui", "CPlotter::draw");
     qint32        i, j;
-    float         histMax;
+    uint32_t      histMax;
     QFontMetricsF metrics(m_Font);
 
+    if (m_Panorama)
+    {
+        drawPanorama(present);
+        return;
+    }
+
     // No fft data yet? Draw overlay if needed and return.
     if (m_fftDataSize == 0)
     {
@@ -1158,12 +1307,12 @@ void CPlotter::draw(bool newData)
 
     // Scale plotter for graph height
     const float panddBGainFactor = (float)plotHeight / fabsf(m_PandMaxdB - m_PandMindB);
-    // Scale waterfall and histogram for colormap
-    const float wfdBGainFactor = 256.0f / fabsf(m_WfMaxdB - m_WfMindB);
 
+    // The FFT data covers the full band, or only a part of it when it comes
+    // from the zoom FFT.
     const double fftSize = m_fftDataSize;
-    const double sampleFreq = (double)m_SampleFreq;
-    const double fftCenter = (double)m_FftCenter;
+    const double sampleFreq = m_fftDataRate;
+    const double fftCenter = (double)(m_FftCenter - m_fftDataCenter);
     const double span = (double)m_Span;
     const double startFreq = fftCenter - span / 2.0;
     const double binsPerHz = fftSize / sampleFreq;
@@ -1173,7 +1322,7 @@ void CPlotter::draw(bool newData)
 
     // Center of fft is the center of the DC bin. The Nyquist bin (index 0
     // after shift) is not used.
-    const double startBinD = startFreq * binsPerHz + fftSize / 2.0;
+    const double startBinD = std::max(startFreq * binsPerHz + fftSize / 2.0, 0.0);
     const qint32 startBin = std::min(qRound(startBinD), m_fftDataSize - 1);
     const qint32 numBins = (qint32)ceil(span * binsPerHz);
     const qint32 endBin = startBin + numBins;
@@ -1188,9 +1337,12 @@ void CPlotter::draw(bool newData)
     // Do plotter work only if visible.
     const bool plotterVisible = (!m_2DPixmap.isNull());
 
-    // Limit plotter drawing rate.
-    const bool drawPlotter = (plotterVisible
-        && tnow_ms >= tlast_plot_drawn_ms + PLOTTER_UPDATE_LIMIT_MS);
+    // Limit plotter drawing rate to the display refresh rate. A frame that
+    // comes too early is presented when the interval has passed.
+    const bool drawPlotter = (present && plotterVisible
+        && tnow_ms + 1 >= tlast_plot_drawn_ms + (quint64)m_presentIntervalMs);
+    if (present && plotterVisible && !drawPlotter)
+        schedulePresent();
 
     // Do not waste time with histogram calculations unless in this mode.
     const bool doHistogram = (plotterVisible && m_PlotMode == PLOT_MODE_HISTOGRAM && (!m_histIIRValid || newData));
@@ -1202,9 +1354,6 @@ void CPlotter::draw(bool newData)
             qRound(32 * (float)numBins / 2048.0f))
         );
 
-    // Amount to add to histogram for each hit
-    const float histWeight = 10e6f * frameTime / (float)histBinsDisplayed / (float)fftSize;
-
     // Bins / dB
     const float histdBGainFactor = (float)histBinsDisplayed / fabsf(m_PandMaxdB - m_PandMindB);
 
@@ -1224,9 +1373,12 @@ void CPlotter::draw(bool newData)
     const bool doMaxLine = m_PlotMode != PLOT_MODE_AVG
                            && m_PlotMode != PLOT_MODE_HISTOGRAM;
 
-    // Initialize results
-    if (doHistogram)
-        memset(m_histogram, 0, sizeof(m_histogram));
+    // Initialize results. Only the visible columns and the one on either
+    // side the interpolation reaches are used.
+    const qint32 histXmin = std::max(xmin - 1, 0);
+    const qint32 histXmax = std::min(xmax + 2, MAX_SCREENSIZE);
+    if (doHistogram && histXmax > histXmin)
+        memset(m_histogram[histXmin], 0, (histXmax - histXmin) * sizeof(m_histogram[0]));
 
     // Peak means "peak of average" in AVG mode, else "peak of max"
     const bool peakIsAverage = m_PlotMode == PLOT_MODE_AVG;
@@ -1241,106 +1393,103 @@ void CPlotter::draw(bool newData)
     float vsum;
     float vsumIIR;
 
-    if ((qreal)numBins >= w)
+    // Column buffers only change with new data or a new bin to pixel
+    // mapping, so repaints between FFT frames skip the reduction.
+    const bool doReduce = newData || doHistogram || !m_MaxHoldValid || !m_MinHoldValid
+                          || minbin != m_redMinBin || maxbin != m_redMaxBin
+                          || startBin != m_redStartBin || xScale != m_redScale;
+    m_redMinBin = minbin;
+    m_redMaxBin = maxbin;
+    m_redStartBin = startBin;
+    m_redScale = xScale;
+
+    CRenderTiming::Scope columnsTiming(m_timing, CRenderTiming::COLUMNS, doReduce);
+    if (doReduce && (qreal)numBins >= w)
     {
-        qint32 count;
-        qint32 xprev = xmin;
-        bool first = true;
+        // Per-frame work depends on the screen width: every column is
+        // reduced in one pass over its bin range.
+        updateColumnBins(minbin, maxbin, startBin, xScale);
 
-        for(qint32 i = minbin; i <= maxbin; i++)
+        const int ncols = (int)m_colX.size();
+        for (int c = 0; c < ncols; c++)
         {
-            const float xD = (float)(i - startBin) * (float)xScale;
-            const int x = qRound(xD);
+            const qint32 x = m_colX[c];
+            const qint32 b0 = m_colBin[c];
+            const int count = m_colBin[c + 1] - b0;
 
             // Plot uses IIR output. Histogram and waterfall use raw fft data.
-            const float v = m_fftData[i];
-            const float viir = m_fftIIR[i];
+            reduce_bins(&m_fftData[b0], count, vmax, vsum);
+            reduce_bins(&m_fftIIR[b0], count, vmaxIIR, vsumIIR);
 
-            if (first)
+            // The log IIR is converted back per column, and its average
+            // is the mean of the dB values.
+            if (m_logAvg)
             {
-                vmax = v;
-                vmaxIIR = viir;
-                vsum = v;
-                vsumIIR = viir;
-                count = 1;
+                vmaxIIR = exp2f(vmaxIIR);
+                vsumIIR = exp2f(vsumIIR / (float)count) * (float)count;
             }
 
-            // Histogram increments the appropriate bin for each value. Ignore
-            // out-of-range values, rather than clipping. Allocate value to two
-            // closest bins using linear interpolation.
-            if (doHistogram)
+            vmax = std::max(vmax, fmin);
+            m_wfMaxBuf[x] = vmax;
+
+            vmaxIIR = std::max(vmaxIIR, fmin);
+            m_fftMaxBuf[x] = vmaxIIR;
+
+            const float vavg = std::max((float)(vsum / (float)count), fmin);
+            m_wfAvgBuf[x] = vavg;
+            const float vavgIIR = std::max((float)(vsumIIR / (float)count), fmin);
+            m_fftAvgBuf[x] = vavgIIR;
+
+            // New peak hold value if greater, or reset
+            const float currentPeak = m_fftMaxHoldBuf[x];
+            const float newPeak = peakIsAverage ? vavgIIR : vmaxIIR;
+            m_fftMaxHoldBuf[x] = m_MaxHoldValid ? std::max(currentPeak, newPeak) : newPeak;
+
+            // New min hold value if less, or reset
+            const float currentMin = m_fftMinHoldBuf[x];
+            const float newMin = minIsAverage ? vavgIIR : vmaxIIR;
+            m_fftMinHoldBuf[x] = m_MinHoldValid ? std::min(currentMin, newMin) : newMin;
+        }
+
+        // Histogram increments the appropriate bin for each value. Ignore
+        // out-of-range values, rather than clipping. Allocate value to two
+        // closest bins using linear interpolation. This is the only pass
+        // that still visits every bin.
+        if (doHistogram)
+        {
+            for (qint32 i = minbin; i <= maxbin; i++)
             {
-                const float binD = histdBGainFactor * (m_PandMaxdB - 10.0f * log10f(v));
+                const float xD = (float)(i - startBin) * (float)xScale;
+                // The log IIR has left log2 of the frame in m_X
+                const float vdB = m_logAvg ? DB_PER_LOG2 * m_X[i] : 10.0f * log10f(m_fftData[i]);
+                const float binD = histdBGainFactor * (m_PandMaxdB - vdB);
                 if (binD > 0.0f && binD < (float)histBinsDisplayed) {
                     const int binLeft = std::max((int)(xD - 0.5f), 0);
                     const int binRight = std::min(binLeft + 1, numBins - 1);
                     const int binLow = std::min(std::max((int)(binD - 0.5f), 0), histBinsDisplayed - 1);
                     const int binHigh = std::min(binLow + 1, histBinsDisplayed - 1);
-                    const float wgtH = (xD - (float)binLeft) / 2.0f;
-                    const float wgtV = (binD - (float)binLow) / 2.0f;
-                    m_histogram[binLeft][binLow] += (1.0f - wgtV) * (1.0f - wgtH) * histWeight;
-                    m_histogram[binLeft][binHigh] += wgtV * (1.0f - wgtH) * histWeight;
-                    m_histogram[binRight][binLow] += (1.0f - wgtV) * wgtH * histWeight;
-                    m_histogram[binRight][binHigh] += wgtV * wgtH * histWeight;
+                    const uint32_t wgtH = (uint32_t)((xD - (float)binLeft) * (HIST_WEIGHT_ONE / 2.0f) + 0.5f);
+                    const uint32_t wgtV = (uint32_t)((binD - (float)binLow) * (HIST_WEIGHT_ONE / 2.0f) + 0.5f);
+                    m_histogram[binLeft][binLow] += (HIST_WEIGHT_ONE - wgtV) * (HIST_WEIGHT_ONE - wgtH);
+                    m_histogram[binLeft][binHigh] += wgtV * (HIST_WEIGHT_ONE - wgtH);
+                    m_histogram[binRight][binLow] += (HIST_WEIGHT_ONE - wgtV) * wgtH;
+                    m_histogram[binRight][binHigh] += wgtV * wgtH;
                 }
             }
-
-            // New (or last) pixel - output values
-            if (x != xprev || i == maxbin)
-            {
-                vmax = std::max(vmax, fmin);
-                m_wfMaxBuf[xprev] = vmax;
-
-                vmaxIIR = std::max(vmaxIIR, fmin);
-                m_fftMaxBuf[xprev] = vmaxIIR;
-
-                const float vavg = std::max((float)(vsum / (float)count), fmin);
-                m_wfAvgBuf[xprev] = vavg;
-                const float vavgIIR = std::max((float)(vsumIIR / (float)count), fmin);
-                m_fftAvgBuf[xprev] = vavgIIR;
-
-                // New peak hold value if greater, or reset
-                const float currentPeak = m_fftMaxHoldBuf[xprev];
-                const float newPeak = peakIsAverage ? vavgIIR : vmaxIIR;
-                m_fftMaxHoldBuf[xprev] = m_MaxHoldValid ? std::max(currentPeak, newPeak) : newPeak;
-
-                // New min hold value if less, or reset
-                const float currentMin = m_fftMinHoldBuf[xprev];
-                const float newMin = minIsAverage ? vavgIIR : vmaxIIR;
-                m_fftMinHoldBuf[xprev] = m_MinHoldValid ? std::min(currentMin, newMin) : newMin;
-
-                vmax = v;
-                vmaxIIR = viir;
-                vsum = v;
-                vsumIIR = viir;
-                count = 1;
-                xprev = x;
-            }
-
-            else if (!first)
-            {
-                vmax = std::max(v, vmax);
-                vmaxIIR = std::max(viir, vmaxIIR);
-                vsum += v;
-                vsumIIR += viir;
-                ++count;
-            }
-
-            first = false;
         }
 
         m_MaxHoldValid = true;
         m_MinHoldValid = true;
     }
     // w > m_fftDataSize uses no averaging
-    else
+    else if (doReduce)
     {
         for (i = xmin; i < xmax; i++)
         {
             j = qRound((float)i / (float)xScale + (float)startBinD);
 
             const float v = m_fftData[j];
-            const float viir = m_fftIIR[j];
+            const float viir = m_logAvg ? exp2f(m_fftIIR[j]) : m_fftIIR[j];
 
             m_wfMaxBuf[i] = v;
             m_wfAvgBuf[i] = v;
@@ -1364,15 +1513,36 @@ void CPlotter::draw(bool newData)
                 if (binD > 0.0f && binD < (float)histBinsDisplayed) {
                     const int binLow = std::min(std::max((int)(binD - 0.5f), 0), histBinsDisplayed - 1);
                     const int binHigh = std::min(binLow + 1, histBinsDisplayed - 1);
-                    const float wgt = (binD - (float)binLow) / 2.0f;
-                    m_histogram[i][binLow] += (1.0f - wgt) * histWeight;
-                    m_histogram[i][binHigh] += wgt * histWeight;
+                    const uint32_t wgt = (uint32_t)((binD - (float)binLow) * (HIST_WEIGHT_ONE / 2.0f) + 0.5f);
+                    m_histogram[i][binLow] += (HIST_WEIGHT_ONE - wgt) * HIST_WEIGHT_ONE;
+                    m_histogram[i][binHigh] += wgt * HIST_WEIGHT_ONE;
                 }
             }
         }
     }
 
     const int npts = xmax - xmin;
+    columnsTiming.stop();
+
+    // Render the waterfall again from history when the view has changed
+    CRenderTiming::Scope waterfallTiming(m_timing, CRenderTiming::WATERFALL);
+    if (!m_WaterfallImage.isNull())
+    {
+        const QVector<double> wfKey = {
+            (double)(m_CenterFreq + m_FftCenter - m_Span / 2), span,
+            (double)m_WaterfallImage.width(), (double)m_WaterfallImage.height(),
+            m_WfMindB, m_WfMaxdB, (double)m_WaterfallMode, (double)(m_wfGL != nullptr)
+        };
+        if (wfKey != m_wfHistoryKey)
+        {
+            m_wfHistoryKey = wfKey;
+            renderWaterfallHistory();
+
+            // The accumulated columns belong to the old pixel mapping
+            if (msec_per_wfline > 0)
+                clearWaterfallBuf();
+        }
+    }
 
     if (doWaterfall)
     {
@@ -1397,20 +1567,42 @@ void CPlotter::draw(bool newData)
             dataSource = m_wfMaxBuf;
         }
 
-        // if not in "auto" mode, store max waterfall data in accumulator
+        // The history keeps the full FFT span at bin resolution, reduced
+        // the same way as the pixel columns.
+        const bool wfUseMax = m_WaterfallMode == WATERFALL_MODE_MAX
+            || (m_WaterfallMode == WATERFALL_MODE_SYNC && m_PlotMode == PLOT_MODE_MAX);
+        const float *wfHistSource = m_fftData.data();
+        if (m_WaterfallMode == WATERFALL_MODE_SYNC && m_logAvg)
+        {
+            // exp2(x) = exp(x ln 2)
+            m_syncScratch.resize(m_fftDataSize);
+            volk_32f_s32f_multiply_32f(m_syncScratch.data(), m_fftIIR.data(), (float)M_LN2, m_fftDataSize);
+            volk_32f_exp_32f(m_syncScratch.data(), m_syncScratch.data(), m_fftDataSize);
+            wfHistSource = m_syncScratch.data();
+        }
+        else if (m_WaterfallMode == WATERFALL_MODE_SYNC)
+        {
+            wfHistSource = m_fftIIR.data();
+        }
+        m_wfHistory.addFrame(wfHistSource, m_fftDataSize, (double)(m_CenterFreq + m_fftDataCenter),
+                             m_fftDataRate, wfUseMax);
+
+        // If not in "auto" mode, every frame goes into the accumulator, so a
+        // line spanning many frames shows all of them rather than the last.
+        // The columns are indexed as the line is drawn, from xmin.
         if (msec_per_wfline > 0)
         {
             // In avg mode, accumulate so average of frames can be shown
             if (m_WaterfallMode != WATERFALL_MODE_MAX)
             {
                 ++wf_avg_count;
-                for (i = 0; i < npts; ++i)
+                for (i = xmin; i < xmin + npts; ++i)
                     m_wfbuf[i] += dataSource[i];
             }
             // In max mode, track the max bin over time
             else
             {
-                for (i = 0; i < npts; ++i)
+                for (i = xmin; i < xmin + npts; ++i)
                     m_wfbuf[i] = std::max(m_wfbuf[i], dataSource[i]);
             }
         }
@@ -1426,6 +1618,8 @@ void CPlotter::draw(bool newData)
                 wf_valid_since_ms = tnow_ms;
             tlast_wf_drawn_ms = tnow_ms;
 
+            m_wfHistory.pushLine(tnow_ms, wfUseMax);
+
             // move the offset "up"
             // this changes how the resulting waterfall is drawn
             // it is more efficient than moving all of the image scan lines
@@ -1437,66 +1631,100 @@ void CPlotter::draw(bool newData)
             const bool useWfBuf = msec_per_wfline > 0;
             float _lineFactor;
             if (useWfBuf && m_WaterfallMode != WATERFALL_MODE_MAX)
-                _lineFactor = 1.0f / (float)wf_avg_count;
+                _lineFactor = 1.0f / (float)std::max(wf_avg_count, (quint64)1);
             else
                 _lineFactor = 1.0f;
             const float lineFactor = _lineFactor;
-            wf_avg_count = 0;
 
+            // At a reduced resolution the pixel columns do not match the
+            // waterfall, so the line is taken from the history instead
+            if (m_WaterfallImage.width() != qRound(w))
+            {
+                int hxmin, hxmax;
+                const bool valid = renderHistoryLine(0, hxmin, hxmax);
+#ifdef WITH_OPENGL_WATERFALL
+                if (m_wfGL)
+                {
+                    for (i = hxmin; i < hxmax; ++i)
+                        m_wfLine[i] = m_colormap.indexFx(CWaterfallHistory::levelFixed(m_wfHistLine[i]));
+                    if (valid)
+                        m_wfGL->addLine(m_wfLine.data(), hxmin, hxmax);
+                }
+                else
+#endif
+                {
+                    QRgb *line = reinterpret_cast<QRgb *>(m_WaterfallImage.scanLine(m_WaterfallOffset));
+                    for (i = hxmin; i < hxmax; ++i)
+                        line[i] = m_colormap.rgbFx(CWaterfallHistory::levelFixed(m_wfHistLine[i]));
+                }
+            }
             // Use buffer (max or average) if in manual mode, else current data
-            for (i = 0; i < npts; ++i)
+#ifdef WITH_OPENGL_WATERFALL
+            else if (m_wfGL && (int)m_wfLine.size() >= xmin + npts)
             {
-                const int ix = i + xmin;
-                const float v = useWfBuf ? m_wfbuf[ix] * lineFactor : dataSource[ix];
-                qint32 cidx = qRound((m_WfMaxdB - 10.0f * log10f(v)) * wfdBGainFactor);
-                cidx = std::max(std::min(cidx, 255), 0);
-                m_WaterfallImage.setPixel(ix, m_WaterfallOffset, m_ColorTbl[255 - cidx].rgb());
+                // The GPU only needs the colormap index of each pixel
+                for (i = 0; i < npts; ++i)
+                {
+                    const int ix = i + xmin;
+                    const float v = useWfBuf ? m_wfbuf[ix] * lineFactor : dataSource[ix];
+                    m_wfLine[ix] = m_colormap.index(10.0f * log10f(v));
+                }
+                m_wfGL->addLine(m_wfLine.data(), xmin, xmin + npts);
+            }
+            else
+#endif
+            {
+                QRgb *line = reinterpret_cast<QRgb *>(m_WaterfallImage.scanLine(m_WaterfallOffset));
+                for (i = 0; i < npts; ++i)
+                {
+                    const int ix = i + xmin;
+                    const float v = useWfBuf ? m_wfbuf[ix] * lineFactor : dataSource[ix];
+                    line[ix] = m_colormap.rgb(10.0f * log10f(v));
+                }
             }
             if(m_WaterfallOffset == 0)
             {
                 m_WaterfallOffset = m_WaterfallImage.height();
             }
 
-            wf_avg_count = 0;
             if (msec_per_wfline > 0)
                 clearWaterfallBuf();
         }
     }
 
+    waterfallTiming.stop();
+
     // Update histogram IIR if it will be used.
     if (doHistogram)
     {
         const float gamma = 1.0f;
         const float a = powf(1.0f - m_alpha, gamma);
-        // fast attack ... leaving alternative here in case it's useful
-        const float aAttack = 1.0f;
-        // const float aAttack = 1.0 - a * frameTime;
+        // Fast attack: the hits are added in full
         const float aDecay = 1.0f - powf(a, 4.0f * frameTime);
+        const uint32_t decay = (uint32_t)std::min((double)aDecay * 4294967296.0, 4294967295.0);
 
-        histMax = 0.0;
+        histMax = 0;
         for (i = xmin; i < xmax; ++i) {
-            for (j = 0; j < histBinsDisplayed; ++j)
+            // Fast response when invalid
+            if (!m_histIIRValid)
             {
-                float histV;
-                const float histPrev = m_histIIR[i][j];
-                const float histNew = m_histogram[i][j];
-                // Fast response when invalid
-                if (!m_histIIRValid)
-                    histV = histNew;
-                else
-                    histV = histPrev + aAttack * histNew - aDecay * histPrev;
-                m_histIIR[i][j] = std::max(histV, 0.0f);
-                histMax = std::max(histMax, histV);
+                memcpy(m_histIIR[i], m_histogram[i], histBinsDisplayed * sizeof(uint32_t));
+                histMax = std::max(histMax, *std::max_element(m_histIIR[i], m_histIIR[i] + histBinsDisplayed));
+            }
+            else
+            {
+                histMax = std::max(histMax, hist_iir(m_histIIR[i], m_histogram[i], decay, histBinsDisplayed));
             }
         }
         m_histIIRValid = true;
 
         // 5 Hz time constant for colormap adjustment
         const float histMaxAlpha = std::min(5.0f * frameTime, 1.0f);
-        m_histMaxIIR = m_histMaxIIR * (1.0f - histMaxAlpha) + histMax * histMaxAlpha;
+        m_histMaxIIR = m_histMaxIIR * (1.0f - histMaxAlpha) + (float)histMax * histMaxAlpha;
     }
 
     // get/draw the 2D spectrum
+    CRenderTiming::Scope plotTiming(m_timing, CRenderTiming::PLOT, drawPlotter);
     if (drawPlotter)
     {
         tlast_plot_drawn_ms = tnow_ms;
@@ -1539,6 +1767,16 @@ void CPlotter::draw(bool newData)
         const int maxMarker = std::max(ax, bx);
 
         const float binSizeY = (float)plotHeight / (float)histBinsDisplayed;
+
+        // The histogram cells are colored into an image with a pixel per
+        // cell, which is scaled onto the plot in one draw.
+        const bool drawHist = m_PlotMode == PLOT_MODE_HISTOGRAM && npts > 0;
+        if (drawHist && (m_histImage.width() < xmax || m_histImage.height() != histBinsDisplayed))
+            m_histImage = QImage(std::max(xmax, qRound(w)), histBinsDisplayed, QImage::Format_ARGB32);
+        uchar *histBits = drawHist ? m_histImage.bits() : nullptr;
+        const int histStride = drawHist ? m_histImage.bytesPerLine() : 0;
+        const float histScale = 255.0f * .7f / m_histMaxIIR;
+
         QPolygonF abPolygon;
         qreal yFillMax = 0;
         for (i = 0; i < npts; i++)
@@ -1554,27 +1792,23 @@ void CPlotter::draw(bool newData)
 
             if (m_PlotMode == PLOT_MODE_HISTOGRAM)
             {
-                const float *histData = m_histIIR[(ix)];
-                qreal topBin = plotHeight;
+                const uint32_t *histData = m_histIIR[(ix)];
+                qint16 topBin = -1;
                 for (j = 0; j < histBinsDisplayed; ++j)
                 {
-                    qint32 cidx = qRound(histData[j] / m_histMaxIIR * 255.0f * .7f);
+                    // Histogram IIR can cause out-of-range cidx
+                    qint32 cidx = qRound(std::min((float)histData[j] * histScale, 255.0f));
+                    QRgb c = 0;
                     if (cidx > 0) {
                         cidx += 65;  // 255 * 0.7 = 178, + 65 = 243
-                        // Histogram IIR can cause out-of-range cidx
-                        cidx = std::max(std::min(cidx, 255), 0);
-                        QColor c = m_ColorTbl[cidx];
-                        // Paint rectangle
-                        const qreal binY = (qreal)binSizeY * j;
-                        topBin = std::min(topBin, binY);
-                        const qreal binH = (qreal)binSizeY * (j + 1) - binY;
-                        painter2.fillRect(QRectF(ixPlot, binY, 1.0, binH), c);
+                        cidx = std::min(cidx, 255);
+                        c = m_colormap.table()[cidx];
+                        if (topBin < 0)
+                            topBin = j;
                     }
+                    reinterpret_cast<QRgb *>(histBits + j * histStride)[ix] = c;
                 }
-                // Highlight the top bin, if it isn't too crowded
-                if (topBin != plotHeight && showHistHighlights) {
-                    painter2.fillRect(QRectF(ixPlot, topBin, 1.0, (qreal)binSizeY), maxLineColor);
-                }
+                m_histTopBin[ix] = topBin;
             }
 
             // Add max, average points if they will be drawn
@@ -1591,6 +1825,21 @@ void CPlotter::draw(bool newData)
             }
         }
 
+        if (drawHist)
+        {
+            painter2.drawImage(QRectF(xmin, 0.0, npts, plotHeight), m_histImage,
+                               QRectF(xmin, 0.0, npts, histBinsDisplayed));
+
+            // Highlight the top bin, if it isn't too crowded
+            if (showHistHighlights)
+            {
+                for (i = xmin; i < xmax; i++)
+                    if (m_histTopBin[i] >= 0)
+                        painter2.fillRect(QRectF((qreal)i, (qreal)binSizeY * m_histTopBin[i],
+                                                 1.0, (qreal)binSizeY), maxLineColor);
+            }
+        }
+
         if (m_FftFill && m_PlotMode != PLOT_MODE_HISTOGRAM)
         {
             for (i = 0; i < npts; i++)
@@ -1650,7 +1899,7 @@ void CPlotter::draw(bool newData)
             m_MinHoldValid = true;
         }
 
-        if (m_PlotMode == PLOT_MODE_FILLED)
+        if (m_PlotMode == PLOT_MODE_FILLED && !m_reducedDetail)
         {
             for (i = 0; i < npts; i++)
             {
@@ -1674,10 +1923,8 @@ void CPlotter::draw(bool newData)
         }
 
         // Peak detection
-        if (m_PeakDetectActive)
+        if (m_PeakDetectActive && !m_reducedDetail)
         {
-            const int pw = PEAK_WINDOW_HALF_WIDTH;
-
             // Use data source appropriate for current display mode
             float *_detectSource;
             if (m_MaxHoldActive)
@@ -1689,70 +1936,30 @@ void CPlotter::draw(bool newData)
             const float *detectSource = _detectSource;
 
             // Run peak detection periodically. If overlay will be redrawn, run
-            // peak detection since zoom/pan may have changed.
+            // peak detection since zoom/pan may have changed. Detection runs
+            // on the tracker thread; the latest tracks are drawn meanwhile.
+            const double hzPerColumn = (double)m_Span / w;
             if (tnow_ms > tlast_peaks_ms + PEAK_UPDATE_PERIOD || m_DrawOverlay) {
                 tlast_peaks_ms = tnow_ms;
-                m_Peaks.clear();
-
-                // Narrow peaks
-                for (i = pw; i < npts - pw; ++i) {
-                    const int ix = i + xmin;
-                    const float vi = detectSource[ix];
-                    float sumV = 0;
-                    float minV = vi;
-                    float maxV = 0;
-                    for (j = -pw; j <= pw; ++j) {
-                        const float vj = detectSource[ix + j];
-                        minV = std::min(minV, vj);
-                        maxV = std::max(maxV, vj);
-                        sumV += vj;
-                    }
-                    const float avgV = sumV / (float)(pw * 2 + 1);
-                    m_peakSmoothBuf[ix] = avgV;
-                    if (vi == maxV && (vi > 2.0f * avgV) && (vi > 4.0f * minV))
-                    {
-                        const qreal y = (qreal)std::max(std::min(
-                            panddBGainFactor * (m_PandMaxdB - 10.0f * log10f(vi)),
-                            (float)plotHeight - 0.0f), 0.0f);
-                        m_Peaks[ix] = y;
-                    }
-                }
+                const double viewStart = (double)(m_CenterFreq + m_FftCenter) - (double)m_Span / 2.0;
+                m_peakTracker.submit(detectSource + xmin, npts,
+                                     viewStart + (double)xmin * hzPerColumn, hzPerColumn, tnow_ms);
+            }
+            m_peakTracker.takeTracks(m_peakTracks);
 
-                // Use the smoothed curve to find wider peaks
-                const int pw2 = pw * 5;
-                for (i = pw2; i < npts - pw2; ++i) {
-                    const int ix = i + xmin;
-                    const float vi = m_peakSmoothBuf[ix];
-                    float sumV = 0;
-                    float minV = vi;
-                    float maxV = 0;
-                    for (j = -pw2; j <= pw2; ++j) {
-                        const float vj = m_peakSmoothBuf[ix + j];
-                        minV = std::min(minV, vj);
-                        maxV = std::max(maxV, vj);
-                        sumV += vj;
-                    }
-                    const float avgV = sumV / (float)(pw2 * 2);
-                    if (vi == maxV && (vi > 2.0f * avgV) && (vi > 4.0f * minV))
-                    {
-                        const qreal y = (qreal)std::max(std::min(
-                            panddBGainFactor * (m_PandMaxdB - 10.0f * log10f(vi)),
-                            (float)plotHeight - 0.0f), 0.0f);
-
-                        // Show the wider peak only if there is no very close narrow peak
-                        bool found = false;
-                        for (j = -pw; j <= pw; ++j) {
-                            auto it = m_Peaks.find(ix + j);
-                            if (it != m_Peaks.end()) {
-                                found = true;
-                                break;
-                            }
-                        }
-                        if (!found) {
-                            m_Peaks[ix] = y;
-                        }
-                    }
-                }
+            // Place the tracked peaks in the current view
+            m_Peaks.clear();
+            for (const auto &track : m_peakTracks)
+            {
+                if (track.misses > 0)
+                    continue;
+                const int ix = xFromFreq(qRound64(track.freq));
+                if (ix < xmin || ix >= xmax)
+                    continue;
+                const qreal y = (qreal)std::max(std::min(
+                    panddBGainFactor * (m_PandMaxdB - 10.0f * log10f(track.level)),
+                    (float)plotHeight - 0.0f), 0.0f);
+                m_Peaks[ix] = y;
             }
 
             // Paint peaks with shadow
@@ -1799,8 +2006,22 @@ void CPlotter::draw(bool newData)
         painter2.drawPixmap(QPointF(0.0, 0.0), m_OverlayPixmap);
     }
 
+    plotTiming.stop();
+
     // trigger a new paintEvent
-    update();
+    if (present)
+    {
+        if (m_timing.isEnabled() && tnow_ms >= m_timingReportMs + RENDER_TIMING_REPORT_MS)
+        {
+            m_timingReportMs = tnow_ms;
+            emit renderTimingUpdated(m_timing.summary());
+        }
+        update();
+#ifdef WITH_OPENGL_WATERFALL
+        if (m_wfGL)
+            m_wfGL->update();
+#endif
+    }
 }
 
 void CPlotter::setRunningState(bool running)
@@ -1832,10 +2053,34 @@ void CPlotter::setRunningState(bool running)
  */
 void CPlotter::setNewFftData(const float *fftData, int size)
 {
+    setNewFftData(fftData, size, (double)m_SampleFreq, 0);
+}
+
+/**
+ * Set new FFT data covering only part of the band.
+ * @param fftData Pointer to the new FFT data.
+ * @param size The FFT size.
+ * @param rate The bandwidth covered by the data.
+ * @param center The center of the data relative to the center frequency.
+ *
+ * Used for data from the zoom FFT, which covers the zoomed span with finer
+ * bins than the full band FFT.
+ */
+void CPlotter::setNewFftData(const float *fftData, int size, double rate, qint64 center)
+{
+    // Live frames would be drawn on the axis of the panorama
+    if (m_Panorama)
+        return;
+
+    QElapsedTimer busy;
+    busy.start();
+    CRenderTiming::Scope iirTiming(m_timing, CRenderTiming::IIR);
+
     // Make sure zeros don't get through to log calcs
     const float fmin = 1e-20;
+    const bool fullBand = (rate == (double)m_SampleFreq && center == 0);
 
-    if (size != m_fftDataSize)
+    if (size != m_fftDataSize || rate != m_fftDataRate || center != m_fftDataCenter)
     {
         // Reallocate and invalidate IIRs
         m_fftData.resize(size);
@@ -1850,36 +2095,17 @@ void CPlotter::setNewFftData(const float *fftData, int size)
         m_histMaxIIR = std::numeric_limits<float>::min();
 
         m_fftDataSize = size;
+        m_fftDataRate = rate;
+        m_fftDataCenter = center;
 
         // Zoom out if needed to keep about 4 points on the screen
         double currentZoom = (double)m_SampleFreq / (double)m_Span;
         double maxZoom = (double)m_fftDataSize / 4.0;
-        if (currentZoom > maxZoom)
+        if (fullBand && !m_ZoomFftEnabled && currentZoom > maxZoom)
             zoomStepX(currentZoom / maxZoom, qRound((qreal)m_Size.width() * m_DPR / 2.0));
     }
 
-    // For dBFS, define full scale as peak (not RMS). A 1.0 FS peak sine wave
-    // is 0 dBFS.
-    float _pwr_scale = 1.0f / ((float)size * (float)size);
-
-    // For V, convert peak to RMS (/2). 1V peak corresponds to -3.01 dBV (RMS
-    // value is 0.707 * peak).
-    if (m_PlotScale == PLOT_SCALE_DBV)
-        _pwr_scale *= 1.0f / 2.0f;
-
-    // For dBm, the scale is interpreted as V. A 1V peak sine corresponds to
-    // 10mW, or 10 dBm. The factor of 2 converts Vpeak to Vrms.
-    else if (m_PlotScale == PLOT_SCALE_DBMW50)
-        _pwr_scale *= 1000.0f / (2.0f * 50.0f);
-
-    // For units of /Hz, rescale by 1/RBW. For V, this results in /sqrt(Hz), and is
-    // used for noise spectral density.
-    if (m_PlotPerHz && m_PlotScale != PLOT_SCALE_DBFS)
-        _pwr_scale *= (float)size / (float)m_SampleFreq;
-
-    const float pwr_scale = _pwr_scale;
-    for (int i = 0; i < size; ++i)
-        m_fftData[i] = std::max(fftData[i] * pwr_scale, fmin);
+    const float pwr_scale = powerScale(size, rate);
 
     // Update IIR. If IIR is invalid, set alpha to use latest value. Since the
     // IIR is linear data and users would like to see symmetric attack/decay on
@@ -1898,19 +2124,110 @@ void CPlotter::setNewFftData(const float *fftData, int size)
     const bool needIIR = m_IIRValid                         // Initializing
                       && a != 1.0f;                         // IIR is NOP
 
-    if (needIIR) {
-        volk_32f_x2_divide_32f(m_X.data(), m_fftData.data(), m_fftIIR.data(), size);
-        volk_32f_s32f_power_32f(m_X.data(), m_X.data(), a, size);
-        volk_32f_x2_multiply_32f(m_fftIIR.data(), m_fftIIR.data(), m_X.data(), size);
-    }
-    else
+    // Scale, clamp and IIR are done block by block so that each bin is read
+    // from memory once and the remaining passes hit the cache.
+    for (int k = 0; k < size; k += FFT_BLOCK_SIZE)
     {
-        memcpy(m_fftIIR.data(), m_fftData.data(), size * sizeof(float));
+        const int n = std::min(FFT_BLOCK_SIZE, size - k);
+        float *data = m_fftData.data() + k;
+        float *iir = m_fftIIR.data() + k;
+        float *x = m_X.data() + k;
+
+        volk_32f_s32f_multiply_32f(data, fftData + k, pwr_scale, n);
+        for (int i = 0; i < n; ++i)
+            data[i] = std::max(data[i], fmin);
+
+        // The IIR below is geometric, so on log2 of the power it is a plain
+        // linear IIR and needs no power function. The log is kept in m_X for
+        // the histogram.
+        if (m_logAvg) {
+            volk_32f_log2_32f(x, data, n);
+            if (needIIR) {
+                for (int i = 0; i < n; ++i)
+                    iir[i] += a * (x[i] - iir[i]);
+            }
+            else
+            {
+                memcpy(iir, x, n * sizeof(float));
+            }
+        }
+        else if (needIIR) {
+            volk_32f_x2_divide_32f(x, data, iir, n);
+            volk_32f_s32f_power_32f(x, x, a, n);
+            volk_32f_x2_multiply_32f(iir, iir, x, n);
+        }
+        else
+        {
+            memcpy(iir, data, n * sizeof(float));
+        }
     }
 
     m_IIRValid = true;
+    iirTiming.stop();
+
+    if (m_LevelStatsActive && fullBand)
+        updateLevelStats();
+
+    // Ingest now, paint at the display rate
+    draw(true, false);
+    schedulePresent();
+    m_busyNs += busy.nsecsElapsed();
+}
+
+/** Factor from the power of an FFT of size bins over rate Hz to the plot scale. */
+float CPlotter::powerScale(int size, double rate) const
+{
+    // For dBFS, define full scale as peak (not RMS). A 1.0 FS peak sine wave
+    // is 0 dBFS.
+    float scale = 1.0f / ((float)size * (float)size);
+
+    // For V, convert peak to RMS (/2). 1V peak corresponds to -3.01 dBV (RMS
+    // value is 0.707 * peak).
+    if (m_PlotScale == PLOT_SCALE_DBV)
+        scale *= 1.0f / 2.0f;
+
+    // For dBm, the scale is interpreted as V. A 1V peak sine corresponds to
+    // 10mW, or 10 dBm. The factor of 2 converts Vpeak to Vrms.
+    else if (m_PlotScale == PLOT_SCALE_DBMW50)
+        scale *= 1000.0f / (2.0f * 50.0f);
+
+    // For units of /Hz, rescale by 1/RBW. For V, this results in /sqrt(Hz), and is
+    // used for noise spectral density.
+    if (m_PlotPerHz && m_PlotScale != PLOT_SCALE_DBFS)
+        scale *= (float)size / (float)rate;
+
+    return scale;
+}
+
+/**
+ * Emit the noise floor and peak level of the averaged spectrum.
+ *
+ * The levels are percentiles of the IIR bins, so a narrow spur does not
+ * move the peak and a few strong carriers do not move the noise floor.
+ * They are in the current plot scale, like the dB ranges.
+ */
+void CPlotter::updateLevelStats()
+{
+    const quint64 tnow_ms = QDateTime::currentMSecsSinceEpoch();
+    if (tnow_ms < tlast_level_stats_ms + LEVEL_STATS_PERIOD || m_fftIIR.empty())
+        return;
+    tlast_level_stats_ms = tnow_ms;
+
+    m_levelScratch.assign(m_fftIIR.begin(), m_fftIIR.end());
+    const size_t n = m_levelScratch.size();
+    const size_t noiseIdx = n * LEVEL_STATS_NOISE_PCT / 100;
+    const size_t peakIdx = std::min(n * LEVEL_STATS_PEAK_PERMILLE / 1000, n - 1);
+
+    std::nth_element(m_levelScratch.begin(), m_levelScratch.begin() + peakIdx, m_levelScratch.end());
+    const float peak = m_levelScratch[peakIdx];
+    std::nth_element(m_levelScratch.begin(), m_levelScratch.begin() + noiseIdx,
+                     m_levelScratch.begin() + peakIdx);
+    const float noise = m_levelScratch[noiseIdx];
 
-    draw(true);
+    if (m_logAvg)
+        emit levelStatsUpdated(DB_PER_LOG2 * noise, DB_PER_LOG2 * peak);
+    else
+        emit levelStatsUpdated(10.0f * log10f(noise), 10.0f * log10f(peak));
 }
 
 void CPlotter::setFftAvg(float avg)
@@ -1918,6 +2235,30 @@ void CPlotter::setFftAvg(float avg)
     m_alpha = avg;
 }
 
+/**
+ * Average the spectrum on the dB values.
+ *
+ * The IIR then runs on log2 of the power, which costs a multiply-add per
+ * bin instead of a power function, with the same response. The average of
+ * the bins in a pixel column becomes the mean of their dB values, which
+ * sits lower than the mean power on noise.
+ */
+void CPlotter::setFftLogAvg(bool enabled)
+{
+    if (enabled == m_logAvg)
+        return;
+
+    // Carry the IIR over to the other domain
+    m_logAvg = enabled;
+    for (float &v : m_fftIIR)
+        v = enabled ? log2f(v) : exp2f(v);
+    if (enabled && m_X.size() == m_fftData.size())
+        volk_32f_log2_32f(m_X.data(), m_fftData.data(), m_fftData.size());
+    m_MaxHoldValid = false;
+    m_MinHoldValid = false;
+    draw(false);
+}
+
 void CPlotter::setFftRange(float min, float max)
 {
     setWaterfallRange(min, max);
@@ -1942,80 +2283,213 @@ void CPlotter::setWaterfallRange(float min, float max)
 
     m_WfMindB = min;
     m_WfMaxdB = max;
+    m_colormap.setRange(m_WfMindB, m_WfMaxdB);
     // no overlay change is necessary
 }
 
+/**
+ * Start a new rendering of an overlay layer if its inputs have changed.
+ * @param layer The layer to check.
+ * @param key Everything the layer's content depends on.
+ * @returns true if the layer has been cleared and must be drawn.
+ */
+bool CPlotter::overlayLayerStale(int layer, const QVector<double> &key)
+{
+    QPixmap &pixmap = m_OverlayLayer[layer];
+
+    if (key == m_OverlayLayerKey[layer] && pixmap.size() == m_OverlayPixmap.size())
+        return false;
+
+    m_OverlayLayerKey[layer] = key;
+    if (pixmap.size() != m_OverlayPixmap.size())
+        pixmap = QPixmap(m_OverlayPixmap.size());
+    pixmap.fill(Qt::transparent);
+    return true;
+}
+
+/** Force a layer to be drawn on the next overlay update. */
+void CPlotter::invalidateOverlayLayer(int layer)
+{
+    m_OverlayLayerKey[layer].clear();
+}
+
 // Called to draw an overlay bitmap containing grid and text that
 // does not need to be recreated every fft data update.
+/**
+ * Draw the overlay from its layers.
+ *
+ * Tags, band plan, markers, frequency grid, level grid and filter box are
+ * each cached in their own pixmap, keyed on the state they depend on. Only
+ * layers whose key has changed are drawn again, so dragging the filter does
+ * not lay out bookmarks and changing the dB range does not redo the
+ * frequency labels.
+ */
 void CPlotter::drawOverlay()
 {
     if (m_OverlayPixmap.isNull())
         return;
 
-    int     x;
-    qreal   pixperdiv;
-    qreal   adjoffset;
-    qreal   dbstepsize;
-    qreal   mindbadj;
+    CRenderTiming::Scope overlayTiming(m_timing, CRenderTiming::OVERLAY);
     QFontMetricsF metrics(m_Font);
-    const qreal shadowOffset = metrics.height() / 20.0;
-    qreal   w = m_OverlayPixmap.width();
-    qreal   h = m_OverlayPixmap.height();
-
-    m_OverlayPixmap.fill(Qt::transparent);
-    QPainter painter(&m_OverlayPixmap);
-    painter.translate(QPointF(-0.5, -0.5));
-    // painter.setRenderHint(QPainter::Antialiasing);
-    painter.setFont(m_Font);
-
-    QList<BookmarkInfo> tags;
+    const qreal w = m_OverlayPixmap.width();
+    const qreal h = m_OverlayPixmap.height();
 
     // X and Y axis areas
     m_YAxisWidth = metrics.boundingRect("-120").width() + 2 * HOR_MARGIN;
     m_XAxisYCenter = h - metrics.height()/2;
-    qreal xAxisHeight = metrics.height() + 2 * VER_MARGIN;
-    qreal xAxisTop = h - xAxisHeight;
-    qreal fLabelTop = xAxisTop + VER_MARGIN;
+    const qreal xAxisHeight = metrics.height() + 2 * VER_MARGIN;
+    const qreal xAxisTop = h - xAxisHeight;
+
+    // Layers that follow the frequency axis
+    const QVector<double> freqKey = {
+        w, h, m_DPR, m_Font.pointSizeF(),
+        (double)viewStart(), (double)viewSpan()
+    };
+
+    QVector<double> vfoKey;
+    for (const VfoMarker &vfo : m_VfoMarkers)
+        vfoKey << vfo.id << (double)vfo.freq << vfo.low << vfo.high;
 
-    if (m_BookmarksEnabled || m_DXCSpotsEnabled)
+    if (overlayLayerStale(OVERLAY_TAGS, freqKey + QVector<double>{
+            (double)m_BookmarksEnabled, (double)m_DXCSpotsEnabled }))
     {
-        m_Taglist.clear();
-        static const QFontMetricsF fm(painter.font());
-        static const qreal fontHeight = fm.ascent() + 1;
-        static const qreal slant = 5;
-        static const qreal levelHeight = fontHeight + 5;
-        static const qreal nLevels = h / (levelHeight + slant);
-        if (m_BookmarksEnabled)
-        {
-            tags = Bookmarks::Get().getBookmarksInRange(m_CenterFreq + m_FftCenter - m_Span / 2,
-                                                        m_CenterFreq + m_FftCenter + m_Span / 2);
-        }
-        else
+        QPainter painter(&m_OverlayLayer[OVERLAY_TAGS]);
+        painter.translate(QPointF(-0.5, -0.5));
+        painter.setFont(m_Font);
+        drawOverlayTags(painter, h, xAxisTop);
+    }
+
+    if (overlayLayerStale(OVERLAY_BANDPLAN, freqKey + QVector<double>{
+            (double)m_BandPlanEnabled }))
+    {
+        QPainter painter(&m_OverlayLayer[OVERLAY_BANDPLAN]);
+        painter.translate(QPointF(-0.5, -0.5));
+        painter.setFont(m_Font);
+        drawOverlayBandPlan(painter, metrics, w, xAxisTop);
+    }
+
+    if (overlayLayerStale(OVERLAY_MARKERS, freqKey + QVector<double>{
+            (double)m_CenterLineEnabled, (double)m_MarkersEnabled,
+            (double)m_MarkerFreqA, (double)m_MarkerFreqB }))
+    {
+        QPainter painter(&m_OverlayLayer[OVERLAY_MARKERS]);
+        painter.translate(QPointF(-0.5, -0.5));
+        painter.setFont(m_Font);
+        drawOverlayMarkers(painter, metrics, xAxisTop);
+    }
+
+    if (overlayLayerStale(OVERLAY_FREQ_GRID, freqKey + QVector<double>{
+            (double)m_FreqUnits, (double)m_FreqDigits }))
+    {
+        QPainter painter(&m_OverlayLayer[OVERLAY_FREQ_GRID]);
+        painter.translate(QPointF(-0.5, -0.5));
+        painter.setFont(m_Font);
+        drawOverlayFreqGrid(painter, metrics, w, xAxisTop);
+    }
+
+    if (overlayLayerStale(OVERLAY_LEVEL_GRID, QVector<double>{
+            w, h, m_DPR, m_Font.pointSizeF(),
+            m_PandMindB, m_PandMaxdB, (double)m_VdivDelta }))
+    {
+        QPainter painter(&m_OverlayLayer[OVERLAY_LEVEL_GRID]);
+        painter.translate(QPointF(-0.5, -0.5));
+        painter.setFont(m_Font);
+        drawOverlayLevelGrid(painter, metrics, w, h, xAxisHeight);
+    }
+
+    if (overlayLayerStale(OVERLAY_FILTER, freqKey + QVector<double>{
+            (double)m_FilterBoxEnabled, (double)m_DemodCenterFreq,
+            (double)m_DemodLowCutFreq, (double)m_DemodHiCutFreq,
+            (double)qHash(m_Classification) } + vfoKey))
+    {
+        QPainter painter(&m_OverlayLayer[OVERLAY_FILTER]);
+        painter.translate(QPointF(-0.5, -0.5));
+        painter.setFont(m_Font);
+        drawOverlayFilter(painter, h);
+    }
+
+    m_OverlayPixmap.fill(Qt::transparent);
+    QPainter painter(&m_OverlayPixmap);
+    for (int layer = 0; layer < OVERLAY_LAYERS; layer++)
+        painter.drawPixmap(QPointF(0.0, 0.0), m_OverlayLayer[layer]);
+
+    // Draw a black line at the bottom of the plotter to separate it from the
+    // waterfall
+    painter.fillRect(QRectF(0.0, h - 1.0 * m_DPR, w, 1.0 * m_DPR), Qt::black);
+
+    painter.end();
+}
+
+/** Draw bookmark and DX spot tags, and rebuild m_Taglist. */
+void CPlotter::drawOverlayTags(QPainter &painter, qreal h, qreal xAxisTop)
+{
+    // Refers to the bookmarks and spots, which are not changed while drawing
+    struct OverlayTag
+    {
+        qint64         frequency;
+        const QString *name;
+        QColor         color;
+
+        bool operator<(const OverlayTag &other) const
         {
-            tags.clear();
+            return frequency < other.frequency;
         }
-        if (m_DXCSpotsEnabled)
+    };
+
+    int x;
+    QVector<OverlayTag> tags;
+
+    m_Taglist.clear();
+    if (!m_BookmarksEnabled && !m_DXCSpotsEnabled)
+        return;
+
+    static const QFontMetricsF fm(painter.font());
+    static const qreal fontHeight = fm.ascent() + 1;
+    static const qreal slant = 5;
+    static const qreal levelHeight = fontHeight + 5;
+    static const qreal nLevels = h / (levelHeight + slant);
+    if (m_BookmarksEnabled)
+    {
+        Bookmarks::Get().forEachBookmarkInRange(viewStart(), viewStart() + viewSpan(),
+                                                [&tags](const BookmarkInfo &info)
         {
-            QList<DXCSpotInfo> dxcspots = DXCSpots::Get().getDXCSpotsInRange(m_CenterFreq + m_FftCenter - m_Span / 2,
-                                                                             m_CenterFreq + m_FftCenter + m_Span / 2);
-            QListIterator<DXCSpotInfo> iter(dxcspots);
-            while(iter.hasNext())
-            {
-                BookmarkInfo tempDXCSpot;
-                DXCSpotInfo IterDXCSpot = iter.next();
-                tempDXCSpot.name = IterDXCSpot.name;
-                tempDXCSpot.frequency = IterDXCSpot.frequency;
-                tags.append(tempDXCSpot);
-            }
-            std::stable_sort(tags.begin(),tags.end());
-        }
-        QVector<int> tagEnd(nLevels + 1);
-        for (auto & tag : tags)
+            tags.append({info.frequency, &info.name, info.GetColor()});
+        });
+    }
+    if (m_DXCSpotsEnabled)
+    {
+        DXCSpots::Get().forEachDXCSpotInRange(viewStart(), viewStart() + viewSpan(),
+                                              [&tags](const DXCSpotInfo &spot)
         {
-            x = xFromFreq(tag.frequency);
-            qreal nameWidth = fm.boundingRect(tag.name).width();
+            tags.append({spot.frequency, &spot.name, TagInfo::DefaultColor});
+        });
+        std::stable_sort(tags.begin(),tags.end());
+    }
+
+    // Tags keep their level while the view is panned, unless it is taken
+    const QVector<double> levelsKey = {
+        (double)viewSpan(), (double)m_OverlayPixmap.width(), h, m_Font.pointSizeF()
+    };
+    if (levelsKey != m_tagLevelsKey)
+    {
+        m_tagLevels.clear();
+        m_tagLevelsKey = levelsKey;
+    }
+    QHash<QPair<qint64, QString>, int> levels;
+    levels.reserve(tags.size());
+
+    QVector<int> tagEnd(nLevels + 1);
+    for (auto & tag : tags)
+    {
+        x = xFromFreq(tag.frequency);
+        const QStaticText label = overlayLabel(*tag.name);
+        qreal nameWidth = label.size().width();
 
-            int level = 0;
+        const QPair<qint64, QString> key(tag.frequency, *tag.name);
+        int level = m_tagLevels.value(key, -1);
+        if (level < 0 || level >= nLevels || tagEnd[level] > x)
+        {
+            level = 0;
             while(level < nLevels && tagEnd[level] > x)
                 level++;
 
@@ -2025,57 +2499,73 @@ void CPlotter::drawOverlay()
                 if (tagEnd[level] > x)
                     continue; // no overwrite at level 0
             }
-
-            tagEnd[level] = x + nameWidth + slant - 1;
-
-            const auto levelNHeight = level * levelHeight;
-            const auto levelNHeightBottom = levelNHeight + fontHeight;
-            const auto levelNHeightBottomSlant = levelNHeightBottom + slant;
-
-            m_Taglist.append(qMakePair(QRectF(x, levelNHeight, nameWidth + slant, fontHeight), tag.frequency));
-
-            QColor color = QColor(tag.GetColor());
-            color.setAlpha(100);
-            // Vertical line
-            painter.setPen(QPen(color, m_DPR, Qt::DashLine));
-            painter.drawLine(QPointF(x, levelNHeightBottomSlant), QPointF(x, xAxisTop));
-
-            // Horizontal line
-            painter.setPen(QPen(color, m_DPR, Qt::SolidLine));
-            painter.drawLine(QPointF(x + slant, levelNHeightBottom),
-                             QPointF(x + nameWidth + slant - 1,
-                             levelNHeightBottom));
-            // Diagonal line
-            painter.drawLine(QPointF(x + 1, levelNHeightBottomSlant - 1),
-                             QPointF(x + slant - 1, levelNHeightBottom + 1));
-
-            color.setAlpha(255);
-            painter.setPen(QPen(color, 2.0 * m_DPR, Qt::SolidLine));
-            painter.drawText(x + slant, levelNHeight, nameWidth,
-                             fontHeight, Qt::AlignVCenter | Qt::AlignHCenter,
-                             tag.name);
         }
+        levels.insert(key, level);
+
+        tagEnd[level] = x + nameWidth + slant - 1;
+
+        const auto levelNHeight = level * levelHeight;
+        const auto levelNHeightBottom = levelNHeight + fontHeight;
+        const auto levelNHeightBottomSlant = levelNHeightBottom + slant;
+
+        m_Taglist.append(qMakePair(QRectF(x, levelNHeight, nameWidth + slant, fontHeight), tag.frequency));
+
+        QColor color = tag.color;
+        color.setAlpha(100);
+        // Vertical line
+        painter.setPen(QPen(color, m_DPR, Qt::DashLine));
+        painter.drawLine(QPointF(x, levelNHeightBottomSlant), QPointF(x, xAxisTop));
+
+        // Horizontal line
+        painter.setPen(QPen(color, m_DPR, Qt::SolidLine));
+        painter.drawLine(QPointF(x + slant, levelNHeightBottom),
+                         QPointF(x + nameWidth + slant - 1,
+                         levelNHeightBottom));
+        // Diagonal line
+        painter.drawLine(QPointF(x + 1, levelNHeightBottomSlant - 1),
+                         QPointF(x + slant - 1, levelNHeightBottom + 1));
+
+        color.setAlpha(255);
+        painter.setPen(QPen(color, 2.0 * m_DPR, Qt::SolidLine));
+        painter.drawStaticText(QPointF(x + slant, levelNHeight + (fontHeight - label.size().height()) / 2),
+                               label);
     }
+    m_tagLevels.swap(levels);
+}
 
-    if (m_BandPlanEnabled)
+/** Draw the band plan strip above the frequency axis. */
+void CPlotter::drawOverlayBandPlan(QPainter &painter, const QFontMetricsF &metrics,
+                                   qreal w, qreal xAxisTop)
+{
+    if (!m_BandPlanEnabled)
+        return;
+
+    m_BandPlanHeight = metrics.height() + VER_MARGIN;
+    BandPlan::Get().forEachBandInRange(viewStart(), viewStart() + viewSpan(),
+                                       [&](const BandInfo &band)
     {
-        QList<BandInfo> bands = BandPlan::Get().getBandsInRange(m_CenterFreq + m_FftCenter - m_Span / 2,
-                                                                m_CenterFreq + m_FftCenter + m_Span / 2);
+        int band_left = std::max(xFromFreq(band.minFrequency), 0);
+        int band_right = std::min(xFromFreq(band.maxFrequency), (int)w);
+        int band_width = band_right - band_left;
+        QRectF rect(band_left, xAxisTop - m_BandPlanHeight, band_width, m_BandPlanHeight);
+        painter.fillRect(rect, band.color);
+        // Only elided for the bands cut by the edges or too narrow
+        QStaticText band_label = overlayLabel(band.name + " (" + band.modulation + ")");
+        if (band_label.size().width() > band_width - 10)
+            band_label = overlayLabel(metrics.elidedText(band_label.text(), Qt::ElideRight, band_width - 10));
+        QSizeF labelSize = band_label.size();
+        painter.setPen(QPen(QColor::fromRgba(PLOTTER_TEXT_COLOR), m_DPR));
+        painter.drawStaticText(QPointF(band_left + (band_width - labelSize.width()) / 2,
+                                       xAxisTop - m_BandPlanHeight + (metrics.height() - labelSize.height()) / 2),
+                               band_label);
+    });
+}
 
-        m_BandPlanHeight = metrics.height() + VER_MARGIN;
-        for (auto & band : bands)
-        {
-            int band_left = std::max(xFromFreq(band.minFrequency), 0);
-            int band_right = std::min(xFromFreq(band.maxFrequency), (int)w);
-            int band_width = band_right - band_left;
-            QRectF rect(band_left, xAxisTop - m_BandPlanHeight, band_width, m_BandPlanHeight);
-            painter.fillRect(rect, band.color);
-            QString band_label = metrics.elidedText(band.name + " (" + band.modulation + ")", Qt::ElideRight, band_width - 10);
-            QRectF textRect(band_left, xAxisTop - m_BandPlanHeight, band_width, metrics.height());
-            painter.setPen(QPen(QColor::fromRgba(PLOTTER_TEXT_COLOR), m_DPR));
-            painter.drawText(textRect, Qt::AlignCenter, band_label);
-        }
-    }
+/** Draw the center line and the A/B markers. */
+void CPlotter::drawOverlayMarkers(QPainter &painter, const QFontMetricsF &metrics,
+                                  qreal xAxisTop)
+{
+    int x;
 
     if (m_CenterLineEnabled)
     {
@@ -2123,16 +2613,26 @@ void CPlotter::drawOverlay()
             painter.drawStaticText(QPointF(x + markerSize/2, 0), QStaticText("B"));
         }
     }
+}
+
+/** Draw the vertical grid lines and the frequency labels. */
+void CPlotter::drawOverlayFreqGrid(QPainter &painter, const QFontMetricsF &metrics,
+                                   qreal w, qreal xAxisTop)
+{
+    qreal   pixperdiv;
+    qreal   adjoffset;
+    const qreal shadowOffset = metrics.height() / 20.0;
+    const qreal fLabelTop = xAxisTop + VER_MARGIN;
 
-    // Frequency grid
-    qint64  StartFreq = m_CenterFreq + m_FftCenter - m_Span / 2;
+    qint64  StartFreq = viewStart();
+    const qint64 span = viewSpan();
     QString label;
-    label.setNum(float((StartFreq + m_Span) / m_FreqUnits), 'f', m_FreqDigits);
-    calcDivSize(StartFreq, StartFreq + m_Span,
+    label.setNum(float((StartFreq + span) / m_FreqUnits), 'f', m_FreqDigits);
+    calcDivSize(StartFreq, StartFreq + span,
                 qMin(w / (metrics.boundingRect(label).width() + metrics.boundingRect("O").width()),
                      (qreal)HORZ_DIVS_MAX),
                 m_StartFreqAdj, m_FreqPerDiv, m_HorDivs);
-    pixperdiv = w * (qreal) m_FreqPerDiv / (qreal) m_Span;
+    pixperdiv = w * (qreal) m_FreqPerDiv / (qreal) span;
     adjoffset = pixperdiv * (qreal) (m_StartFreqAdj - StartFreq) / (qreal) m_FreqPerDiv;
 
     // Hairline for grid lines
@@ -2163,8 +2663,17 @@ void CPlotter::drawOverlay()
             painter.drawText(textRect, Qt::AlignHCenter|Qt::AlignBottom, m_HDivText[i]);
         }
     }
+}
+
+/** Draw the horizontal grid lines and the dB labels. */
+void CPlotter::drawOverlayLevelGrid(QPainter &painter, const QFontMetricsF &metrics,
+                                    qreal w, qreal h, qreal xAxisHeight)
+{
+    qreal   pixperdiv;
+    qreal   adjoffset;
+    qreal   dbstepsize;
+    qreal   mindbadj;
 
-    // Level grid
     qint64 mindBAdj64 = 0;
     qint64 dbDivSize = 0;
     qint64 dbSpan = (qint64) (m_PandMaxdB - m_PandMindB);
@@ -2213,28 +2722,64 @@ void CPlotter::drawOverlay()
             painter.drawText(textRect, Qt::AlignRight|Qt::AlignVCenter, QString::number(dB));
         }
     }
+}
 
-    // Draw demod filter box
-    if (m_FilterBoxEnabled)
+/** Draw the demod filter box and the boxes of the additional VFOs. */
+void CPlotter::drawOverlayFilter(QPainter &painter, qreal h)
+{
+    if (!m_FilterBoxEnabled)
+        return;
+
+    QFontMetrics vfoMetrics(m_Font);
+    for (const VfoMarker &vfo : m_VfoMarkers)
     {
-        m_DemodFreqX = xFromFreq(m_DemodCenterFreq);
-        m_DemodLowCutFreqX = xFromFreq(m_DemodCenterFreq + m_DemodLowCutFreq);
-        m_DemodHiCutFreqX = xFromFreq(m_DemodCenterFreq + m_DemodHiCutFreq);
+        int x = xFromFreq(vfo.freq);
+        int lowX = xFromFreq(vfo.freq + vfo.low);
+        int highX = xFromFreq(vfo.freq + vfo.high);
+
+        painter.fillRect(lowX, 0, highX - lowX, h, QColor::fromRgba(PLOTTER_VFO_BOX_COLOR));
+        painter.setPen(QPen(QColor::fromRgba(PLOTTER_VFO_LINE_COLOR), m_DPR));
+        painter.drawLine(x, 0, x, h);
+        painter.drawText(x + (int)(2 * m_DPR), h - vfoMetrics.descent() - (int)(2 * m_DPR),
+                         QString("V%1").arg(vfo.id));
+    }
+
+    m_DemodFreqX = xFromFreq(m_DemodCenterFreq);
+    m_DemodLowCutFreqX = xFromFreq(m_DemodCenterFreq + m_DemodLowCutFreq);
+    m_DemodHiCutFreqX = xFromFreq(m_DemodCenterFreq + m_DemodHiCutFreq);
 
-        int dw = m_DemodHiCutFreqX - m_DemodLowCutFreqX;
+    int dw = m_DemodHiCutFreqX - m_DemodLowCutFreqX;
 
-        painter.fillRect(m_DemodLowCutFreqX, 0, dw, h,
-                         QColor::fromRgba(PLOTTER_FILTER_BOX_COLOR));
+    painter.fillRect(m_DemodLowCutFreqX, 0, dw, h,
+                     QColor::fromRgba(PLOTTER_FILTER_BOX_COLOR));
 
-        painter.setPen(QPen(QColor::fromRgba(PLOTTER_FILTER_LINE_COLOR), m_DPR));
-        painter.drawLine(m_DemodFreqX, 0, m_DemodFreqX, h);
+    painter.setPen(QPen(QColor::fromRgba(PLOTTER_FILTER_LINE_COLOR), m_DPR));
+    painter.drawLine(m_DemodFreqX, 0, m_DemodFreqX, h);
+
+    // Modulation of the channel, next to the filter box if it is narrow
+    if (!m_Classification.isEmpty())
+    {
+        QFontMetrics metrics(m_Font);
+        const int pad = (int)(2 * m_DPR);
+        int x = m_DemodLowCutFreqX + pad;
+        if (metrics.boundingRect(m_Classification).width() > dw)
+            x = m_DemodHiCutFreqX + pad;
+        painter.setPen(QPen(QColor::fromRgba(PLOTTER_TEXT_COLOR)));
+        painter.drawText(x, metrics.ascent() + pad, m_Classification);
     }
+}
 
-    // Draw a black line at the bottom of the plotter to separate it from the
-    // waterfall
-    painter.fillRect(QRectF(0.0, h - 1.0 * m_DPR, w, 1.0 * m_DPR), Qt::black);
+/**
+ * Show the modulation of the demodulator channel in the filter box.
+ * @param text Classification like "FM 87%", empty to clear.
+ */
+void CPlotter::setClassification(const QString &text)
+{
+    if (text == m_Classification)
+        return;
 
-    painter.end();
+    m_Classification = text;
+    updateOverlay();
 }
 
 // Create frequency division strings based on start frequency, span frequency,
@@ -2295,10 +2840,7 @@ void CPlotter::makeFrequencyStrs()
 int CPlotter::xFromFreq(qint64 freq)
 {
     qreal w = m_Size.width() * m_DPR;
-    double startFreq = (double)m_CenterFreq
-                       + (double)m_FftCenter
-                       - (double)m_Span / 2.0;
-    int x = qRound(w * ((double)freq - startFreq) / (double)m_Span);
+    int x = qRound(w * (double)(freq - viewStart()) / (double)viewSpan());
     return x;
 }
 
@@ -2309,11 +2851,16 @@ qint64 CPlotter::freqFromX(int x)
     if ((m_Size.width() > 0) && (m_DPR > 0))
         ratio = (double)x / (qreal)m_Size.width() / m_DPR;
 
-    qint64 f = qRound64((double)m_CenterFreq + (double)m_FftCenter
-                        - (double)m_Span / 2.0 + ratio * (double)m_Span);
+    qint64 f = viewStart() + qRound64(ratio * (double)viewSpan());
     return f;
 }
 
+/** First frequency of the plot, of the panorama in panorama mode. */
+qint64 CPlotter::viewStart() const
+{
+    return m_Panorama ? m_PanoStart : m_CenterFreq + m_FftCenter - m_Span / 2;
+}
+
 /** Calculate time offset of a given line on the waterfall */
 quint64 CPlotter::msecFromY(int y)
 {
@@ -2323,7 +2870,13 @@ quint64 CPlotter::msecFromY(int y)
     if (y < h)
         return 0;
 
-    qreal dy = (qreal)y - (qreal)h;
+    // Waterfall line in the image, which may have a reduced resolution
+    qreal dy = ((qreal)y - (qreal)h) * wfResolution() / 100.0;
+
+    // Lines in the history have their own time
+    const int age = (int)dy;
+    if (age < m_wfHistory.rows())
+        return m_wfHistory.rowTime(age);
 
     if (msec_per_wfline > 0)
         return tlast_wf_drawn_ms - dy * msec_per_wfline;
@@ -2387,6 +2940,34 @@ void CPlotter::setCenterFreq(quint64 f)
     updateOverlay();
 }
 
+/** Laid out label, from the cache unless the text was not drawn recently. */
+QStaticText CPlotter::overlayLabel(const QString &text)
+{
+    if (m_labelFont != m_Font)
+    {
+        m_labelCache.clear();
+        m_labelFont = m_Font;
+    }
+
+    QStaticText *label = m_labelCache.object(text);
+    if (!label)
+    {
+        label = new QStaticText(text);
+        label->setTextFormat(Qt::PlainText);
+        label->setPerformanceHint(QStaticText::AggressiveCaching);
+        label->prepare(QTransform(), m_Font);
+        m_labelCache.insert(text, label);
+    }
+    return *label;
+}
+
+/** Redraw bookmark and DX spot tags after the lists have changed. */
+void CPlotter::updateTags()
+{
+    invalidateOverlayLayer(OVERLAY_TAGS);
+    updateOverlay();
+}
+
 // Invalidate overlay. If not running, force a redraw.
 void CPlotter::updateOverlay()
 {
@@ -2467,6 +3048,21 @@ void CPlotter::enableMinHold(bool enabled)
 void CPlotter::enablePeakDetect(bool enabled)
 {
     m_PeakDetectActive = enabled;
+    if (!enabled)
+    {
+        m_peakTracker.reset();
+        m_peakTracks.clear();
+        m_Peaks.clear();
+    }
+}
+
+/** Turn levelStatsUpdated() on or off, used for automatic dB ranges. */
+void CPlotter::enableLevelStats(bool enabled)
+{
+    m_LevelStatsActive = enabled;
+    tlast_level_stats_ms = 0;
+    if (!enabled)
+        m_levelScratch = std::vector<float>();
 }
 
 void CPlotter::enableBandPlan(bool enabled)
@@ -2480,6 +3076,12 @@ void CPlotter::enableMarkers(bool enabled)
     m_MarkersEnabled = enabled;
 }
 
+void CPlotter::setVfoMarkers(const QVector<VfoMarker> &markers)
+{
+    m_VfoMarkers = markers;
+    updateOverlay();
+}
+
 void CPlotter::setMarkers(qint64 a, qint64 b)
 {
     // Invalidate x positions
@@ -2497,6 +3099,590 @@ void CPlotter::clearWaterfall()
     if (!m_WaterfallImage.isNull()) {
         m_WaterfallImage.fill(Qt::black);
     }
+#ifdef WITH_OPENGL_WATERFALL
+    if (m_wfGL)
+        m_wfGL->clear();
+#endif
+    m_wfHistory.clear();
+}
+
+/**
+ * Draw the whole waterfall from the history.
+ *
+ * Called when the span, center, size, dB range, mode or colormap has
+ * changed, so that the change applies to the old lines too.
+ */
+void CPlotter::renderWaterfallHistory()
+{
+    if (m_WaterfallImage.isNull())
+        return;
+
+    const int h = m_WaterfallImage.height();
+    const int rows = std::min(m_wfHistory.rows(), h);
+    int xmin, xmax;
+
+#ifdef WITH_OPENGL_WATERFALL
+    if (m_wfGL)
+    {
+        // Oldest first, the GPU ring takes lines like new ones
+        std::vector<quint8> glLine(m_WaterfallImage.width(), 0);
+        m_wfGL->clear();
+        for (int age = rows - 1; age >= 0; age--)
+        {
+            renderHistoryLine(age, xmin, xmax);
+            for (int x = xmin; x < xmax; x++)
+                glLine[x] = m_colormap.indexFx(CWaterfallHistory::levelFixed(m_wfHistLine[x]));
+            m_wfGL->addLine(glLine.data(), xmin, xmax);
+        }
+        m_wfGL->update();
+        return;
+    }
+#endif
+
+    // Newest line at the top, as after the waterfall offset wraps
+    m_WaterfallImage.fill(Qt::black);
+    m_WaterfallOffset = h;
+    for (int age = 0; age < rows; age++)
+    {
+        if (!renderHistoryLine(age, xmin, xmax))
+            continue;
+
+        QRgb *line = reinterpret_cast<QRgb *>(m_WaterfallImage.scanLine(age));
+        for (int x = xmin; x < xmax; x++)
+            line[x] = m_colormap.rgbFx(CWaterfallHistory::levelFixed(m_wfHistLine[x]));
+    }
+}
+
+/**
+ * Render a history row into m_wfHistLine for the current view.
+ * @param age Row to render, 0 is the newest.
+ * @param xmin First waterfall pixel with data (output).
+ * @param xmax One past the last waterfall pixel with data (output).
+ * @returns false if the row does not exist or is outside the view.
+ */
+bool CPlotter::renderHistoryLine(int age, int &xmin, int &xmax)
+{
+    const int w = m_WaterfallImage.width();
+    const double startFreq = (double)(m_CenterFreq + m_FftCenter) - (double)m_Span / 2.0;
+    const double hzPerPixel = (double)m_Span / (double)w;
+    const bool useMax = m_WaterfallMode != WATERFALL_MODE_AVG;
+
+    m_wfHistLine.resize(w);
+    return m_wfHistory.renderRow(age, startFreq, hzPerPixel, w, useMax,
+                                 m_wfHistLine.data(), xmin, xmax);
+}
+
+/**
+ * Point m_WaterfallImage at a w x h area of the backing store.
+ *
+ * The store grows in steps of PLOTTER_STORE_CHUNK pixels in each direction
+ * and is kept when the waterfall shrinks, so resize steps while dragging a
+ * dock or window edge mostly reuse the same memory. The image is cleared.
+ */
+void CPlotter::allocWaterfallImage(int w, int h)
+{
+    // Release the old image before the store can move
+    m_WaterfallImage = QImage();
+
+    if (w > m_wfStoreWidth || h > m_wfStoreHeight)
+    {
+        const int chunk = PLOTTER_STORE_CHUNK;
+        m_wfStoreWidth = std::max(m_wfStoreWidth, (w + chunk - 1) / chunk * chunk);
+        m_wfStoreHeight = std::max(m_wfStoreHeight, (h + chunk - 1) / chunk * chunk);
+        m_wfStore.assign((size_t)m_wfStoreWidth * m_wfStoreHeight * sizeof(QRgb), 0);
+        m_wfStoreMem.set((int64_t)m_wfStore.size());
+    }
+
+    const int bytesPerLine = m_wfStoreWidth * (int)sizeof(QRgb);
+    m_WaterfallImage = QImage(m_wfStore.data(), w, h, bytesPerLine, QImage::Format_RGB32);
+    m_WaterfallImage.setDevicePixelRatio(m_DPR);
+    m_WaterfallImage.fill(Qt::black);
+    m_WaterfallOffset = h;
+}
+
+/**
+ * Rebuild the pixel column to FFT bin table if the mapping has changed.
+ *
+ * Bins minbin..maxbin are grouped by the pixel they fall on. This only
+ * changes on zoom, pan, resize or a new FFT size, so draw() does not have
+ * to compute the pixel of every bin for every frame.
+ */
+void CPlotter::updateColumnBins(qint32 minbin, qint32 maxbin, qint32 startBin, double xScale)
+{
+    if (minbin == m_colMinBin && maxbin == m_colMaxBin &&
+        startBin == m_colStartBin && xScale == m_colScale)
+        return;
+
+    m_colMinBin = minbin;
+    m_colMaxBin = maxbin;
+    m_colStartBin = startBin;
+    m_colScale = xScale;
+    m_colX.clear();
+    m_colBin.clear();
+
+    qint32 xprev = -1;
+    qint32 i;
+    for (i = minbin; i <= maxbin; i++)
+    {
+        const int x = qRound((float)(i - startBin) * (float)xScale);
+        if (x >= MAX_SCREENSIZE)
+            break;
+        if (x != xprev)
+        {
+            m_colX.push_back(x);
+            m_colBin.push_back(i);
+            xprev = x;
+        }
+    }
+    m_colBin.push_back(i);
+}
+
+/**
+ * Set the internal resolution of the waterfall.
+ * @param percent Resolution in percent of the screen pixels, 10 to 100.
+ *
+ * A lower resolution makes drawing and resizing cheaper on large, high DPI
+ * screens; the waterfall is scaled up to fill its area. The waterfall is
+ * drawn again from the history.
+ */
+void CPlotter::setWaterfallResolution(int percent)
+{
+    percent = qBound(10, percent, 100);
+    if (percent == m_wfResolution)
+        return;
+
+    m_wfResolution = percent;
+    applyWfResolution();
+}
+
+/**
+ * Halve the waterfall resolution, down to 10 %, while the GUI thread is
+ * overloaded. The resolution set by the user is kept.
+ */
+void CPlotter::setWaterfallShed(bool shed)
+{
+    if (shed == m_wfShed)
+        return;
+
+    m_wfShed = shed;
+    applyWfResolution();
+}
+
+void CPlotter::applyWfResolution()
+{
+    m_wfHistoryKey.clear();
+    m_Size = QSize(0, 0);
+    resizeEvent(nullptr);
+    update();
+}
+
+/**
+ * Draw the spectrum without the fill of the filled mode and without the peak
+ * markers, which cost a rectangle per column and a pixmap per peak.
+ */
+void CPlotter::setReducedDetail(bool reduced)
+{
+    if (reduced == m_reducedDetail)
+        return;
+
+    m_reducedDetail = reduced;
+    draw(false);
+}
+
+/**
+ * Enable the render timers and their on-screen display.
+ *
+ * While enabled, renderTimingUpdated() is emitted with a summary every
+ * RENDER_TIMING_REPORT_MS.
+ */
+void CPlotter::enableRenderTiming(bool enabled)
+{
+    m_timing.setEnabled(enabled);
+    m_timingReportMs = 0;
+    update();
+}
+
+/**
+ * Render the waterfall with OpenGL.
+ * @param enabled Use the OpenGL renderer if it was built and can be initialized.
+ *
+ * Lines are uploaded to a ring texture and colored in a shader instead of
+ * being drawn into m_WaterfallImage. After switching renderer the
+ * waterfall is drawn again from the history. Without OpenGL support this
+ * does nothing.
+ */
+void CPlotter::setGpuWaterfall(bool enabled)
+{
+#ifdef WITH_OPENGL_WATERFALL
+    if (enabled == (m_wfGL != nullptr))
+        return;
+
+    if (enabled)
+    {
+        m_wfGL = new CWaterfallGL(this);
+        connect(m_wfGL, SIGNAL(glFailed()), this, SLOT(gpuWaterfallFailed()));
+        m_wfGL->setColormap(m_colormap.table());
+        m_wfGL->show();
+    }
+    else
+    {
+        delete m_wfGL;
+        m_wfGL = nullptr;
+    }
+
+    m_wfHistoryKey.clear();
+    m_Size = QSize(0, 0);
+    resizeEvent(nullptr);
+    update();
+#else
+    Q_UNUSED(enabled);
+#endif
+}
+
+/** OpenGL could not be initialized, fall back to QPainter. */
+void CPlotter::gpuWaterfallFailed()
+{
+#ifdef WITH_OPENGL_WATERFALL
+    if (m_wfGL)
+    {
+        m_wfGL->hide();
+        m_wfGL->deleteLater();
+        m_wfGL = nullptr;
+        m_wfHistoryKey.clear();
+        draw(false);
+    }
+#endif
+}
+
+/**
+ * Schedule painting of the 2D plot for the next display refresh.
+ *
+ * FFT frames may arrive faster than the screen refreshes. They are ingested
+ * as they come, and any number of them between two refreshes result in one
+ * repaint.
+ */
+void CPlotter::schedulePresent()
+{
+    if (m_presentTimer->isActive())
+        return;
+
+    // Follow the refresh rate of the screen the plotter is on
+    const QWindow *win = window()->windowHandle();
+    const QScreen *scr = win ? win->screen() : nullptr;
+    if (scr && scr->refreshRate() > 1.0)
+        m_presentIntervalMs = std::max(qRound(1000.0 / scr->refreshRate()), PLOTTER_MIN_PRESENT_MS);
+    else
+        m_presentIntervalMs = PLOTTER_UPDATE_LIMIT_MS;
+
+    const qint64 due = (qint64)(tlast_plot_drawn_ms + m_presentIntervalMs)
+                       - (qint64)QDateTime::currentMSecsSinceEpoch();
+    m_presentTimer->start((int)std::max(due, (qint64)0));
+}
+
+void CPlotter::presentFrame()
+{
+    QElapsedTimer busy;
+    busy.start();
+    draw(false, true);
+    m_busyNs += busy.nsecsElapsed();
+}
+
+/**
+ * Time spent on new data, painting the 2D plot and composing the widget
+ * since the last call.
+ *
+ * Measured always, unlike the render timers, for the load governor of
+ * MainWindow. Redraws after view changes are not included.
+ */
+qint64 CPlotter::takeBusyNs()
+{
+    const qint64 ns = m_busyNs;
+    m_busyNs = 0;
+    return ns;
+}
+
+/**
+ * Show sweep results from startFreq to stopFreq instead of the live FFT.
+ *
+ * The plot keeps a column per pixel and the waterfall a line per sweep.
+ * addPanoramaSegment() reduces the bins of a hop into the columns they
+ * cover and redraws only those columns of the trace and of the waterfall
+ * line, so the work per hop does not grow with the span. The frequency
+ * axis, bookmarks and band plan follow the panorama, and a click emits
+ * panoramaFreqSelected(). A new span starts empty.
+ */
+void CPlotter::setPanorama(bool enabled, qint64 startFreq, qint64 stopFreq)
+{
+    if (enabled && stopFreq <= startFreq)
+        return;
+    if (enabled == m_Panorama &&
+        (!enabled || (startFreq == m_PanoStart && stopFreq == m_PanoStop)))
+        return;
+
+    m_Panorama = enabled;
+    m_PanoStart = enabled ? startFreq : 0;
+    m_PanoStop = enabled ? stopFreq : 0;
+    m_panoMax.clear();
+    m_panoSum.clear();
+    m_panoCount.clear();
+    m_panoSweepOf.clear();
+    m_panoSweep = 0;
+    m_PanoWaterfall = QImage();
+
+    // The live plot and waterfall are drawn again when leaving
+    m_MaxHoldValid = false;
+    m_MinHoldValid = false;
+    m_histIIRValid = false;
+    m_wfHistoryKey.clear();
+    m_Size = QSize(0, 0);
+    resizeEvent(nullptr);
+}
+
+/**
+ * Add the bins of a sweep step to the panorama.
+ * @param startFreq Frequency of data[0].
+ * @param binHz Bin spacing.
+ * @param data Linear power, as for setNewFftData().
+ * @param size Number of bins.
+ * @param fftSize FFT size of the step, for the scale.
+ * @param newSweep First step of a sweep, starts a waterfall line.
+ */
+void CPlotter::addPanoramaSegment(double startFreq, double binHz, const float *data, int size,
+                                  int fftSize, bool newSweep)
+{
+    const int w = (int)m_panoMax.size();
+    if (!m_Panorama || w == 0 || size <= 0 || binHz <= 0.0)
+        return;
+
+    QElapsedTimer busy;
+    busy.start();
+
+    const bool doWaterfall = !m_PanoWaterfall.isNull();
+    if (newSweep)
+    {
+        ++m_panoSweep;
+        if (doWaterfall)
+        {
+            m_PanoWfOffset = (m_PanoWfOffset > 0 ? m_PanoWfOffset : m_PanoWaterfall.height()) - 1;
+            memset(m_PanoWaterfall.scanLine(m_PanoWfOffset), 0, m_PanoWaterfall.bytesPerLine());
+        }
+    }
+
+    const double hzPerColumn = (double)(m_PanoStop - m_PanoStart) / (double)w;
+    const double offset = startFreq - (double)m_PanoStart;
+    const int x0 = std::max((int)floor(offset / hzPerColumn), 0);
+    const int x1 = std::min((int)ceil((offset + size * binHz) / hzPerColumn), w);
+    if (x0 >= x1)
+        return;
+
+    // Make sure zeros don't get through to log calcs
+    const float fmin = 1e-20;
+    const float scale = powerScale(fftSize, fftSize * binHz);
+    QRgb *line = doWaterfall ? reinterpret_cast<QRgb *>(m_PanoWaterfall.scanLine(m_PanoWfOffset))
+                             : nullptr;
+
+    for (int x = x0; x < x1; x++)
+    {
+        // Bins that fall on the column, or the nearest one if bins are
+        // wider than a column. Columns shared with the neighbouring step
+        // add up the bins of both.
+        const double bin = ((double)x * hzPerColumn - offset) / binHz;
+        const int b0 = qBound(0, (int)ceil(bin), size - 1);
+        const int b1 = qBound(b0 + 1, (int)ceil(bin + hzPerColumn / binHz), size);
+
+        if (m_panoSweepOf[x] != m_panoSweep)
+        {
+            m_panoSweepOf[x] = m_panoSweep;
+            m_panoMax[x] = fmin;
+            m_panoSum[x] = 0.0f;
+            m_panoCount[x] = 0;
+        }
+        for (int b = b0; b < b1; b++)
+        {
+            const float v = std::max(data[b] * scale, fmin);
+            m_panoMax[x] = std::max(m_panoMax[x], v);
+            m_panoSum[x] += v;
+        }
+        m_panoCount[x] += b1 - b0;
+
+        if (line)
+        {
+            const float v = m_WaterfallMode == WATERFALL_MODE_MAX
+                            ? m_panoMax[x] : m_panoSum[x] / (float)m_panoCount[x];
+            line[x] = m_colormap.rgb(10.0f * log10f(v));
+        }
+    }
+
+    // A trace drawn for other settings is drawn whole by drawPanorama()
+    if (!m_PanoKey.isEmpty())
+        renderPanorama(x0, x1);
+    schedulePresent();
+    m_busyNs += busy.nsecsElapsed();
+}
+
+/** Redraw columns x0 to x1 of the panorama trace. */
+void CPlotter::renderPanorama(int x0, int x1)
+{
+    if (m_PanoPixmap.isNull())
+        return;
+
+    const int w = (int)m_panoMax.size();
+    const int h = m_PanoPixmap.height();
+    const float plotHeight = (float)h;
+    const float panddBGainFactor = plotHeight / fabsf(m_PandMaxdB - m_PandMindB);
+
+    // The lines to the neighbouring columns cross one pixel on either side
+    const int c0 = std::max(x0 - 1, 0);
+    const int c1 = std::min(x1 + 1, w);
+    QPainter painter(&m_PanoPixmap);
+    painter.fillRect(QRect(c0, 0, c1 - c0, h), QColor::fromRgba(PLOTTER_BGD_COLOR));
+    painter.setClipRect(QRect(c0, 0, c1 - c0, h));
+    painter.translate(QPointF(0.5, 0.5));
+
+    const bool doMaxLine = m_PlotMode != PLOT_MODE_AVG && m_PlotMode != PLOT_MODE_HISTOGRAM;
+    const bool doAvgLine = m_PlotMode != PLOT_MODE_MAX;
+    const QPen maxLinePen(m_PlotMode == PLOT_MODE_FILLED ? m_FilledModeMaxLineCol : m_MainLineCol);
+    const QPen avgLinePen(m_PlotMode == PLOT_MODE_AVG || m_PlotMode == PLOT_MODE_HISTOGRAM
+                          ? m_MainLineCol : m_FilledModeAvgLineCol);
+
+    // Columns not swept yet break the lines
+    const int p0 = std::max(c0 - 1, 0);
+    const int p1 = std::min(c1 + 1, w);
+    int npts = 0;
+    for (int x = p0; x <= p1; x++)
+    {
+        if (x < p1 && m_panoCount[x] > 0)
+        {
+            const float avg = m_panoSum[x] / (float)m_panoCount[x];
+            const qreal yMax = std::max(std::min(
+                panddBGainFactor * (m_PandMaxdB - 10.0f * log10f(m_panoMax[x])), plotHeight), 0.0f);
+            const qreal yAvg = std::max(std::min(
+                panddBGainFactor * (m_PandMaxdB - 10.0f * log10f(avg)), plotHeight), 0.0f);
+            m_maxLineBuf[npts] = QPointF((qreal)x, yMax);
+            m_avgLineBuf[npts] = QPointF((qreal)x, yAvg);
+            npts++;
+            continue;
+        }
+
+        if (npts > 0 && doMaxLine)
+        {
+            painter.setPen(maxLinePen);
+            painter.drawPolyline(m_maxLineBuf, npts);
+        }
+        if (npts > 0 && doAvgLine)
+        {
+            painter.setPen(avgLinePen);
+            painter.drawPolyline(m_avgLineBuf, npts);
+        }
+        npts = 0;
+    }
+}
+
+/** Compose the panorama trace and the overlay into the 2D plot. */
+void CPlotter::drawPanorama(bool present)
+{
+    if (m_2DPixmap.isNull() || m_PanoPixmap.isNull())
+        return;
+
+    const QVector<double> key = {
+        m_PandMindB, m_PandMaxdB, (double)m_PlotMode,
+        (double)m_MainLineCol.rgba(), (double)m_FilledModeAvgLineCol.rgba(),
+        (double)m_PanoPixmap.width(), (double)m_PanoPixmap.height()
+    };
+    if (key != m_PanoKey)
+    {
+        m_PanoKey = key;
+        renderPanorama(0, (int)m_panoMax.size());
+    }
+
+    if (m_DrawOverlay)
+    {
+        drawOverlay();
+        m_DrawOverlay = false;
+    }
+
+    QPainter painter(&m_2DPixmap);
+    painter.drawPixmap(QPointF(0.0, 0.0), m_PanoPixmap);
+    painter.drawPixmap(QPointF(0.0, 0.0), m_OverlayPixmap);
+    painter.end();
+
+    if (present)
+    {
+        tlast_plot_drawn_ms = QDateTime::currentMSecsSinceEpoch();
+        update();
+    }
+}
+
+/**
+ * Size the panorama buffers for the plot, or release them outside of
+ * panorama mode. The columns and the waterfall are resampled, so a resize
+ * keeps the sweeps shown.
+ */
+void CPlotter::resizePanorama(int w, int plotHeight, int wfHeight)
+{
+    if (!m_Panorama)
+    {
+        m_panoMax.clear();
+        m_panoSum.clear();
+        m_panoCount.clear();
+        m_panoSweepOf.clear();
+        m_PanoPixmap = QPixmap();
+        m_PanoWaterfall = QImage();
+        m_PanoKey.clear();
+        return;
+    }
+
+    const int oldW = (int)m_panoMax.size();
+    if (oldW == 0)
+    {
+        m_panoMax.assign(w, 0.0f);
+        m_panoSum.assign(w, 0.0f);
+        m_panoCount.assign(w, 0);
+        m_panoSweepOf.assign(w, 0);
+    }
+    else if (oldW != w)
+    {
+        std::vector<float> maxBuf(w), sumBuf(w);
+        std::vector<int> countBuf(w);
+        std::vector<quint32> sweepBuf(w);
+        for (int x = 0; x < w; x++)
+        {
+            const int src = (int)((qint64)x * oldW / w);
+            maxBuf[x] = m_panoMax[src];
+            sumBuf[x] = m_panoSum[src];
+            countBuf[x] = m_panoCount[src];
+            sweepBuf[x] = m_panoSweepOf[src];
+        }
+        m_panoMax.swap(maxBuf);
+        m_panoSum.swap(sumBuf);
+        m_panoCount.swap(countBuf);
+        m_panoSweepOf.swap(sweepBuf);
+    }
+
+    m_PanoPixmap = QPixmap(w, plotHeight);
+    m_PanoPixmap.fill(QColor::fromRgba(PLOTTER_BGD_COLOR));
+    m_PanoKey.clear();
+
+    if (wfHeight <= 0)
+    {
+        m_PanoWaterfall = QImage();
+        return;
+    }
+
+    // Newest line at the top, then scaled to the new size
+    QImage wf(w, wfHeight, QImage::Format_RGB32);
+    wf.fill(Qt::black);
+    if (!m_PanoWaterfall.isNull())
+    {
+        const int oldH = m_PanoWaterfall.height();
+        QImage rows(m_PanoWaterfall.width(), oldH, QImage::Format_RGB32);
+        for (int y = 0; y < oldH; y++)
+            memcpy(rows.scanLine(y), m_PanoWaterfall.constScanLine((m_PanoWfOffset + y) % oldH),
+                   rows.bytesPerLine());
+        wf = rows.scaled(w, wfHeight, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+    }
+    m_PanoWaterfall = wf;
+    m_PanoWfOffset = 0;
 }
 
 void CPlotter::calcDivSize (qint64 low, qint64 high, int divswanted, qint64 &adjlow, qint64 &step, int& divs)
@@ -2545,448 +3731,15 @@ void CPlotter::showToolTip(QMouseEvent* event, QString toolTipText)
 #endif
 }
 
-// contributed by Chris Kuethe @ckuethe
-// source https://ai.googleblog.com/2019/08/turbo-improved-rainbow-colormap-for.html
-unsigned char turbo[256][3] = {
-        {48,18,59}, {50,21,67},    {51,24,74},
-        {52,27,81},   {53,30,88},   {54,33,95},    {55,36,102},   {56,39,109},
-        {57,42,115},  {58,45,121},  {59,47,128},   {60,50,134},   {61,53,139},
-        {62,56,145},  {63,59,151},  {63,62,156},   {64,64,162},   {65,67,167},
-        {65,70,172},  {66,73,177},  {66,75,181},   {67,78,186},   {68,81,191},
-        {68,84,195},  {68,86,199},  {69,89,203},   {69,92,207},   {69,94,211},
-        {70,97,214},  {70,100,218}, {70,102,221},  {70,105,224},  {70,107,227},
-        {71,110,230}, {71,113,233}, {71,115,235},  {71,118,238},  {71,120,240},
-        {71,123,242}, {70,125,244}, {70,128,246},  {70,130,248},  {70,133,250},
-        {70,135,251}, {69,138,252}, {69,140,253},  {68,143,254},  {67,145,254},
-        {66,148,255}, {65,150,255}, {64,153,255},  {62,155,254},  {61,158,254},
-        {59,160,253}, {58,163,252}, {56,165,251},  {55,168,250},  {53,171,248},
-        {51,173,247}, {49,175,245}, {47,178,244},  {46,180,242},  {44,183,240},
-        {42,185,238}, {40,188,235}, {39,190,233},  {37,192,231},  {35,195,228},
-        {34,197,226}, {32,199,223}, {31,201,221},  {30,203,218},  {28,205,216},
-        {27,208,213}, {26,210,210}, {26,212,208},  {25,213,205},  {24,215,202},
-        {24,217,200}, {24,219,197}, {24,221,194},  {24,222,192},  {24,224,189},
-        {25,226,187}, {25,227,185}, {26,228,182},  {28,230,180},  {29,231,178},
-        {31,233,175}, {32,234,172}, {34,235,170},  {37,236,167},  {39,238,164},
-        {42,239,161}, {44,240,158}, {47,241,155},  {50,242,152},  {53,243,148},
-        {56,244,145}, {60,245,142}, {63,246,138},  {67,247,135},  {70,248,132},
-        {74,248,128}, {78,249,125}, {82,250,122},  {85,250,118},  {89,251,115},
-        {93,252,111}, {97,252,108}, {101,253,105}, {105,253,102}, {109,254,98},
-        {113,254,95}, {117,254,92}, {121,254,89},  {125,255,86},  {128,255,83},
-        {132,255,81}, {136,255,78}, {139,255,75},  {143,255,73},  {146,255,71},
-        {150,254,68}, {153,254,66}, {156,254,64},  {159,253,63},  {161,253,61},
-        {164,252,60}, {167,252,58}, {169,251,57},  {172,251,56},  {175,250,55},
-        {177,249,54}, {180,248,54}, {183,247,53},  {185,246,53},  {188,245,52},
-        {190,244,52}, {193,243,52}, {195,241,52},  {198,240,52},  {200,239,52},
-        {203,237,52}, {205,236,52}, {208,234,52},  {210,233,53},  {212,231,53},
-        {215,229,53}, {217,228,54}, {219,226,54},  {221,224,55},  {223,223,55},
-        {225,221,55}, {227,219,56}, {229,217,56},  {231,215,57},  {233,213,57},
-        {235,211,57}, {236,209,58}, {238,207,58},  {239,205,58},  {241,203,58},
-        {242,201,58}, {244,199,58}, {245,197,58},  {246,195,58},  {247,193,58},
-        {248,190,57}, {249,188,57}, {250,186,57},  {251,184,56},  {251,182,55},
-        {252,179,54}, {252,177,54}, {253,174,53},  {253,172,52},  {254,169,51},
-        {254,167,50}, {254,164,49}, {254,161,48},  {254,158,47},  {254,155,45},
-        {254,153,44}, {254,150,43}, {254,147,42},  {254,144,41},  {253,141,39},
-        {253,138,38}, {252,135,37}, {252,132,35},  {251,129,34},  {251,126,33},
-        {250,123,31}, {249,120,30}, {249,117,29},  {248,114,28},  {247,111,26},
-        {246,108,25}, {245,105,24}, {244,102,23},  {243,99,21},   {242,96,20},
-        {241,93,19},  {240,91,18},  {239,88,17},   {237,85,16},   {236,83,15},
-        {235,80,14},  {234,78,13},  {232,75,12},   {231,73,12},   {229,71,11},
-        {228,69,10},  {226,67,10},  {225,65,9},    {223,63,8},    {221,61,8},
-        {220,59,7},   {218,57,7},   {216,55,6},    {214,53,6},    {212,51,5},
-        {210,49,5},   {208,47,5},   {206,45,4},    {204,43,4},    {202,42,4},
-        {200,40,3},   {197,38,3},   {195,37,3},    {193,35,2},    {190,33,2},
-        {188,32,2},   {185,30,2},   {183,29,2},    {180,27,1},    {178,26,1},
-        {175,24,1},   {172,23,1},   {169,22,1},    {167,20,1},    {164,19,1},
-        {161,18,1},   {158,16,1},   {155,15,1},    {152,14,1},    {149,13,1},
-        {146,11,1},   {142,10,1},   {139,9,2},     {136,8,2},     {133,7,2},
-        {129,6,2},    {126,5,2},    {122,4,3}
-};
-
-// contributed by @devnulling
-unsigned char plasma[256][3] = {
-        {12, 7, 134},   {16, 7, 135},   {19, 6, 137},   {21, 6, 138},   {24, 6, 139},
-        {27, 6, 140},   {29, 6, 141},   {31, 5, 142},   {33, 5, 143},   {35, 5, 144},
-        {37, 5, 145},   {39, 5, 146},   {41, 5, 147},   {43, 5, 148},   {45, 4, 148},
-        {47, 4, 149},   {49, 4, 150},   {51, 4, 151},   {52, 4, 152},   {54, 4, 152},
-        {56, 4, 153},   {58, 4, 154},   {59, 3, 154},   {61, 3, 155},   {63, 3, 156},
-        {64, 3, 156},   {66, 3, 157},   {68, 3, 158},   {69, 3, 158},   {71, 2, 159},
-        {73, 2, 159},   {74, 2, 160},   {76, 2, 161},   {78, 2, 161},   {79, 2, 162},
-        {81, 1, 162},   {82, 1, 163},   {84, 1, 163},   {86, 1, 163},   {87, 1, 164},
-        {89, 1, 164},   {90, 0, 165},   {92, 0, 165},   {94, 0, 165},   {95, 0, 166},
-        {97, 0, 166},   {98, 0, 166},   {100, 0, 167},  {101, 0, 167},  {103, 0, 167},
-        {104, 0, 167},  {106, 0, 167},  {108, 0, 168},  {109, 0, 168},  {111, 0, 168},
-        {112, 0, 168},  {114, 0, 168},  {115, 0, 168},  {117, 0, 168},  {118, 1, 168},
-        {120, 1, 168},  {121, 1, 168},  {123, 2, 168},  {124, 2, 167},  {126, 3, 167},
-        {127, 3, 167},  {129, 4, 167},  {130, 4, 167},  {132, 5, 166},  {133, 6, 166},
-        {134, 7, 166},  {136, 7, 165},  {137, 8, 165},  {139, 9, 164},  {140, 10, 164},
-        {142, 12, 164}, {143, 13, 163}, {144, 14, 163}, {146, 15, 162}, {147, 16, 161},
-        {149, 17, 161}, {150, 18, 160}, {151, 19, 160}, {153, 20, 159}, {154, 21, 158},
-        {155, 23, 158}, {157, 24, 157}, {158, 25, 156}, {159, 26, 155}, {160, 27, 155},
-        {162, 28, 154}, {163, 29, 153}, {164, 30, 152}, {165, 31, 151}, {167, 33, 151},
-        {168, 34, 150}, {169, 35, 149}, {170, 36, 148}, {172, 37, 147}, {173, 38, 146},
-        {174, 39, 145}, {175, 40, 144}, {176, 42, 143}, {177, 43, 143}, {178, 44, 142},
-        {180, 45, 141}, {181, 46, 140}, {182, 47, 139}, {183, 48, 138}, {184, 50, 137},
-        {185, 51, 136}, {186, 52, 135}, {187, 53, 134}, {188, 54, 133}, {189, 55, 132},
-        {190, 56, 131}, {191, 57, 130}, {192, 59, 129}, {193, 60, 128}, {194, 61, 128},
-        {195, 62, 127}, {196, 63, 126}, {197, 64, 125}, {198, 65, 124}, {199, 66, 123},
-        {200, 68, 122}, {201, 69, 121}, {202, 70, 120}, {203, 71, 119}, {204, 72, 118},
-        {205, 73, 117}, {206, 74, 117}, {207, 75, 116}, {208, 77, 115}, {209, 78, 114},
-        {209, 79, 113}, {210, 80, 112}, {211, 81, 111}, {212, 82, 110}, {213, 83, 109},
-        {214, 85, 109}, {215, 86, 108}, {215, 87, 107}, {216, 88, 106}, {217, 89, 105},
-        {218, 90, 104}, {219, 91, 103}, {220, 93, 102}, {220, 94, 102}, {221, 95, 101},
-        {222, 96, 100}, {223, 97, 99},  {223, 98, 98},  {224, 100, 97}, {225, 101, 96},
-        {226, 102, 96}, {227, 103, 95}, {227, 104, 94}, {228, 106, 93}, {229, 107, 92},
-        {229, 108, 91}, {230, 109, 90}, {231, 110, 90}, {232, 112, 89}, {232, 113, 88},
-        {233, 114, 87}, {234, 115, 86}, {234, 116, 85}, {235, 118, 84}, {236, 119, 84},
-        {236, 120, 83}, {237, 121, 82}, {237, 123, 81}, {238, 124, 80}, {239, 125, 79},
-        {239, 126, 78}, {240, 128, 77}, {240, 129, 77}, {241, 130, 76}, {242, 132, 75},
-        {242, 133, 74}, {243, 134, 73}, {243, 135, 72}, {244, 137, 71}, {244, 138, 71},
-        {245, 139, 70}, {245, 141, 69}, {246, 142, 68}, {246, 143, 67}, {246, 145, 66},
-        {247, 146, 65}, {247, 147, 65}, {248, 149, 64}, {248, 150, 63}, {248, 152, 62},
-        {249, 153, 61}, {249, 154, 60}, {250, 156, 59}, {250, 157, 58}, {250, 159, 58},
-        {250, 160, 57}, {251, 162, 56}, {251, 163, 55}, {251, 164, 54}, {252, 166, 53},
-        {252, 167, 53}, {252, 169, 52}, {252, 170, 51}, {252, 172, 50}, {252, 173, 49},
-        {253, 175, 49}, {253, 176, 48}, {253, 178, 47}, {253, 179, 46}, {253, 181, 45},
-        {253, 182, 45}, {253, 184, 44}, {253, 185, 43}, {253, 187, 43}, {253, 188, 42},
-        {253, 190, 41}, {253, 192, 41}, {253, 193, 40}, {253, 195, 40}, {253, 196, 39},
-        {253, 198, 38}, {252, 199, 38}, {252, 201, 38}, {252, 203, 37}, {252, 204, 37},
-        {252, 206, 37}, {251, 208, 36}, {251, 209, 36}, {251, 211, 36}, {250, 213, 36},
-        {250, 214, 36}, {250, 216, 36}, {249, 217, 36}, {249, 219, 36}, {248, 221, 36},
-        {248, 223, 36}, {247, 224, 36}, {247, 226, 37}, {246, 228, 37}, {246, 229, 37},
-        {245, 231, 38}, {245, 233, 38}, {244, 234, 38}, {243, 236, 38}, {243, 238, 38},
-        {242, 240, 38}, {242, 241, 38}, {241, 243, 38}, {240, 245, 37}, {240, 246, 35},
-        {239, 248, 33}
-};
-
-// contributed by @Piruzzolo
-float viridis[256][3] = {
-        { 0.267004, 0.004874, 0.329415 },
-        { 0.268510, 0.009605, 0.335427 },
-        { 0.269944, 0.014625, 0.341379 },
-        { 0.271305, 0.019942, 0.347269 },
-        { 0.272594, 0.025563, 0.353093 },
-        { 0.273809, 0.031497, 0.358853 },
-        { 0.274952, 0.037752, 0.364543 },
-        { 0.276022, 0.044167, 0.370164 },
-        { 0.277018, 0.050344, 0.375715 },
-        { 0.277941, 0.056324, 0.381191 },
-        { 0.278791, 0.062145, 0.386592 },
-        { 0.279566, 0.067836, 0.391917 },
-        { 0.280267, 0.073417, 0.397163 },
-        { 0.280894, 0.078907, 0.402329 },
-        { 0.281446, 0.084320, 0.407414 },
-        { 0.281924, 0.089666, 0.412415 },
-        { 0.282327, 0.094955, 0.417331 },
-        { 0.282656, 0.100196, 0.422160 },
-        { 0.282910, 0.105393, 0.426902 },
-        { 0.283091, 0.110553, 0.431554 },
-        { 0.283197, 0.115680, 0.436115 },
-        { 0.283229, 0.120777, 0.440584 },
-        { 0.283187, 0.125848, 0.444960 },
-        { 0.283072, 0.130895, 0.449241 },
-        { 0.282884, 0.135920, 0.453427 },
-        { 0.282623, 0.140926, 0.457517 },
-        { 0.282290, 0.145912, 0.461510 },
-        { 0.281887, 0.150881, 0.465405 },
-        { 0.281412, 0.155834, 0.469201 },
-        { 0.280868, 0.160771, 0.472899 },
-        { 0.280255, 0.165693, 0.476498 },
-        { 0.279574, 0.170599, 0.479997 },
-        { 0.278826, 0.175490, 0.483397 },
-        { 0.278012, 0.180367, 0.486697 },
-        { 0.277134, 0.185228, 0.489898 },
-        { 0.276194, 0.190074, 0.493001 },
-        { 0.275191, 0.194905, 0.496005 },
-        { 0.274128, 0.199721, 0.498911 },
-        { 0.273006, 0.204520, 0.501721 },
-        { 0.271828, 0.209303, 0.504434 },
-        { 0.270595, 0.214069, 0.507052 },
-        { 0.269308, 0.218818, 0.509577 },
-        { 0.267968, 0.223549, 0.512008 },
-        { 0.266580, 0.228262, 0.514349 },
-        { 0.265145, 0.232956, 0.516599 },
-        { 0.263663, 0.237631, 0.518762 },
-        { 0.262138, 0.242286, 0.520837 },
-        { 0.260571, 0.246922, 0.522828 },
-        { 0.258965, 0.251537, 0.524736 },
-        { 0.257322, 0.256130, 0.526563 },
-        { 0.255645, 0.260703, 0.528312 },
-        { 0.253935, 0.265254, 0.529983 },
-        { 0.252194, 0.269783, 0.531579 },
-        { 0.250425, 0.274290, 0.533103 },
-        { 0.248629, 0.278775, 0.534556 },
-        { 0.246811, 0.283237, 0.535941 },
-        { 0.244972, 0.287675, 0.537260 },
-        { 0.243113, 0.292092, 0.538516 },
-        { 0.241237, 0.296485, 0.539709 },
-        { 0.239346, 0.300855, 0.540844 },
-        { 0.237441, 0.305202, 0.541921 },
-        { 0.235526, 0.309527, 0.542944 },
-        { 0.233603, 0.313828, 0.543914 },
-        { 0.231674, 0.318106, 0.544834 },
-        { 0.229739, 0.322361, 0.545706 },
-        { 0.227802, 0.326594, 0.546532 },
-        { 0.225863, 0.330805, 0.547314 },
-        { 0.223925, 0.334994, 0.548053 },
-        { 0.221989, 0.339161, 0.548752 },
-        { 0.220057, 0.343307, 0.549413 },
-        { 0.218130, 0.347432, 0.550038 },
-        { 0.216210, 0.351535, 0.550627 },
-        { 0.214298, 0.355619, 0.551184 },
-        { 0.212395, 0.359683, 0.551710 },
-        { 0.210503, 0.363727, 0.552206 },
-        { 0.208623, 0.367752, 0.552675 },
-        { 0.206756, 0.371758, 0.553117 },
-        { 0.204903, 0.375746, 0.553533 },
-        { 0.203063, 0.379716, 0.553925 },
-        { 0.201239, 0.383670, 0.554294 },
-        { 0.199430, 0.387607, 0.554642 },
-        { 0.197636, 0.391528, 0.554969 },
-        { 0.195860, 0.395433, 0.555276 },
-        { 0.194100, 0.399323, 0.555565 },
-        { 0.192357, 0.403199, 0.555836 },
-        { 0.190631, 0.407061, 0.556089 },
-        { 0.188923, 0.410910, 0.556326 },
-        { 0.187231, 0.414746, 0.556547 },
-        { 0.185556, 0.418570, 0.556753 },
-        { 0.183898, 0.422383, 0.556944 },
-        { 0.182256, 0.426184, 0.557120 },
-        { 0.180629, 0.429975, 0.557282 },
-        { 0.179019, 0.433756, 0.557430 },
-        { 0.177423, 0.437527, 0.557565 },
-        { 0.175841, 0.441290, 0.557685 },
-        { 0.174274, 0.445044, 0.557792 },
-        { 0.172719, 0.448791, 0.557885 },
-        { 0.171176, 0.452530, 0.557965 },
-        { 0.169646, 0.456262, 0.558030 },
-        { 0.168126, 0.459988, 0.558082 },
-        { 0.166617, 0.463708, 0.558119 },
-        { 0.165117, 0.467423, 0.558141 },
-        { 0.163625, 0.471133, 0.558148 },
-        { 0.162142, 0.474838, 0.558140 },
-        { 0.160665, 0.478540, 0.558115 },
-        { 0.159194, 0.482237, 0.558073 },
-        { 0.157729, 0.485932, 0.558013 },
-        { 0.156270, 0.489624, 0.557936 },
-        { 0.154815, 0.493313, 0.557840 },
-        { 0.153364, 0.497000, 0.557724 },
-        { 0.151918, 0.500685, 0.557587 },
-        { 0.150476, 0.504369, 0.557430 },
-        { 0.149039, 0.508051, 0.557250 },
-        { 0.147607, 0.511733, 0.557049 },
-        { 0.146180, 0.515413, 0.556823 },
-        { 0.144759, 0.519093, 0.556572 },
-        { 0.143343, 0.522773, 0.556295 },
-        { 0.141935, 0.526453, 0.555991 },
-        { 0.140536, 0.530132, 0.555659 },
-        { 0.139147, 0.533812, 0.555298 },
-        { 0.137770, 0.537492, 0.554906 },
-        { 0.136408, 0.541173, 0.554483 },
-        { 0.135066, 0.544853, 0.554029 },
-        { 0.133743, 0.548535, 0.553541 },
-        { 0.132444, 0.552216, 0.553018 },
-        { 0.131172, 0.555899, 0.552459 },
-        { 0.129933, 0.559582, 0.551864 },
-        { 0.128729, 0.563265, 0.551229 },
-        { 0.127568, 0.566949, 0.550556 },
-        { 0.126453, 0.570633, 0.549841 },
-        { 0.125394, 0.574318, 0.549086 },
-        { 0.124395, 0.578002, 0.548287 },
-        { 0.123463, 0.581687, 0.547445 },
-        { 0.122606, 0.585371, 0.546557 },
-        { 0.121831, 0.589055, 0.545623 },
-        { 0.121148, 0.592739, 0.544641 },
-        { 0.120565, 0.596422, 0.543611 },
-        { 0.120092, 0.600104, 0.542530 },
-        { 0.119738, 0.603785, 0.541400 },
-        { 0.119512, 0.607464, 0.540218 },
-        { 0.119423, 0.611141, 0.538982 },
-        { 0.119483, 0.614817, 0.537692 },
-        { 0.119699, 0.618490, 0.536347 },
-        { 0.120081, 0.622161, 0.534946 },
-        { 0.120638, 0.625828, 0.533488 },
-        { 0.121380, 0.629492, 0.531973 },
-        { 0.122312, 0.633153, 0.530398 },
-        { 0.123444, 0.636809, 0.528763 },
-        { 0.124780, 0.640461, 0.527068 },
-        { 0.126326, 0.644107, 0.525311 },
-        { 0.128087, 0.647749, 0.523491 },
-        { 0.130067, 0.651384, 0.521608 },
-        { 0.132268, 0.655014, 0.519661 },
-        { 0.134692, 0.658636, 0.517649 },
-        { 0.137339, 0.662252, 0.515571 },
-        { 0.140210, 0.665859, 0.513427 },
-        { 0.143303, 0.669459, 0.511215 },
-        { 0.146616, 0.673050, 0.508936 },
-        { 0.150148, 0.676631, 0.506589 },
-        { 0.153894, 0.680203, 0.504172 },
-        { 0.157851, 0.683765, 0.501686 },
-        { 0.162016, 0.687316, 0.499129 },
-        { 0.166383, 0.690856, 0.496502 },
-        { 0.170948, 0.694384, 0.493803 },
-        { 0.175707, 0.697900, 0.491033 },
-        { 0.180653, 0.701402, 0.488189 },
-        { 0.185783, 0.704891, 0.485273 },
-        { 0.191090, 0.708366, 0.482284 },
-        { 0.196571, 0.711827, 0.479221 },
-        { 0.202219, 0.715272, 0.476084 },
-        { 0.208030, 0.718701, 0.472873 },
-        { 0.214000, 0.722114, 0.469588 },
-        { 0.220124, 0.725509, 0.466226 },
-        { 0.226397, 0.728888, 0.462789 },
-        { 0.232815, 0.732247, 0.459277 },
-        { 0.239374, 0.735588, 0.455688 },
-        { 0.246070, 0.738910, 0.452024 },
-        { 0.252899, 0.742211, 0.448284 },
-        { 0.259857, 0.745492, 0.444467 },
-        { 0.266941, 0.748751, 0.440573 },
-        { 0.274149, 0.751988, 0.436601 },
-        { 0.281477, 0.755203, 0.432552 },
-        { 0.288921, 0.758394, 0.428426 },
-        { 0.296479, 0.761561, 0.424223 },
-        { 0.304148, 0.764704, 0.419943 },
-        { 0.311925, 0.767822, 0.415586 },
-        { 0.319809, 0.770914, 0.411152 },
-        { 0.327796, 0.773980, 0.406640 },
-        { 0.335885, 0.777018, 0.402049 },
-        { 0.344074, 0.780029, 0.397381 },
-        { 0.352360, 0.783011, 0.392636 },
-        { 0.360741, 0.785964, 0.387814 },
-        { 0.369214, 0.788888, 0.382914 },
-        { 0.377779, 0.791781, 0.377939 },
-        { 0.386433, 0.794644, 0.372886 },
-        { 0.395174, 0.797475, 0.367757 },
-        { 0.404001, 0.800275, 0.362552 },
-        { 0.412913, 0.803041, 0.357269 },
-        { 0.421908, 0.805774, 0.351910 },
-        { 0.430983, 0.808473, 0.346476 },
-        { 0.440137, 0.811138, 0.340967 },
-        { 0.449368, 0.813768, 0.335384 },
-        { 0.458674, 0.816363, 0.329727 },
-        { 0.468053, 0.818921, 0.323998 },
-        { 0.477504, 0.821444, 0.318195 },
-        { 0.487026, 0.823929, 0.312321 },
-        { 0.496615, 0.826376, 0.306377 },
-        { 0.506271, 0.828786, 0.300362 },
-        { 0.515992, 0.831158, 0.294279 },
-        { 0.525776, 0.833491, 0.288127 },
-        { 0.535621, 0.835785, 0.281908 },
-        { 0.545524, 0.838039, 0.275626 },
-        { 0.555484, 0.840254, 0.269281 },
-        { 0.565498, 0.842430, 0.262877 },
-        { 0.575563, 0.844566, 0.256415 },
-        { 0.585678, 0.846661, 0.249897 },
-        { 0.595839, 0.848717, 0.243329 },
-        { 0.606045, 0.850733, 0.236712 },
-        { 0.616293, 0.852709, 0.230052 },
-        { 0.626579, 0.854645, 0.223353 },
-        { 0.636902, 0.856542, 0.216620 },
-        { 0.647257, 0.858400, 0.209861 },
-        { 0.657642, 0.860219, 0.203082 },
-        { 0.668054, 0.861999, 0.196293 },
-        { 0.678489, 0.863742, 0.189503 },
-        { 0.688944, 0.865448, 0.182725 },
-        { 0.699415, 0.867117, 0.175971 },
-        { 0.709898, 0.868751, 0.169257 },
-        { 0.720391, 0.870350, 0.162603 },
-        { 0.730889, 0.871916, 0.156029 },
-        { 0.741388, 0.873449, 0.149561 },
-        { 0.751884, 0.874951, 0.143228 },
-        { 0.762373, 0.876424, 0.137064 },
-        { 0.772852, 0.877868, 0.131109 },
-        { 0.783315, 0.879285, 0.125405 },
-        { 0.793760, 0.880678, 0.120005 },
-        { 0.804182, 0.882046, 0.114965 },
-        { 0.814576, 0.883393, 0.110347 },
-        { 0.824940, 0.884720, 0.106217 },
-        { 0.835270, 0.886029, 0.102646 },
-        { 0.845561, 0.887322, 0.099702 },
-        { 0.855810, 0.888601, 0.097452 },
-        { 0.866013, 0.889868, 0.095953 },
-        { 0.876168, 0.891125, 0.095250 },
-        { 0.886271, 0.892374, 0.095374 },
-        { 0.896320, 0.893616, 0.096335 },
-        { 0.906311, 0.894855, 0.098125 },
-        { 0.916242, 0.896091, 0.100717 },
-        { 0.926106, 0.897330, 0.104071 },
-        { 0.935904, 0.898570, 0.108131 },
-        { 0.945636, 0.899815, 0.112838 },
-        { 0.955300, 0.901065, 0.118128 },
-        { 0.964894, 0.902323, 0.123941 },
-        { 0.974417, 0.903590, 0.130215 },
-        { 0.983868, 0.904867, 0.136897 },
-        { 0.993248, 0.906157, 0.143936 }
-};
-
-
 void CPlotter::setWfColormap(const QString &cmap)
 {
-    int i;
+    m_colormap.setMap(cmap);
 
-    if (cmap.compare("gqrx", Qt::CaseInsensitive) == 0)
-    {
-        for (i = 0; i < 256; i++)
-        {
-            // level 0: black background
-            if (i < 20)
-                m_ColorTbl[i].setRgb(0, 0, 0);
-                // level 1: black -> blue
-            else if ((i >= 20) && (i < 70))
-                m_ColorTbl[i].setRgb(0, 0, 140*(i-20)/50);
-                // level 2: blue -> light-blue / greenish
-            else if ((i >= 70) && (i < 100))
-                m_ColorTbl[i].setRgb(60*(i-70)/30, 125*(i-70)/30, 115*(i-70)/30 + 140);
-                // level 3: light blue -> yellow
-            else if ((i >= 100) && (i < 150))
-                m_ColorTbl[i].setRgb(195*(i-100)/50 + 60, 130*(i-100)/50 + 125, 255-(255*(i-100)/50));
-                // level 4: yellow -> red
-            else if ((i >= 150) && (i < 250))
-                m_ColorTbl[i].setRgb(255, 255-255*(i-150)/100, 0);
-                // level 5: red -> white
-            else if (i >= 250)
-                m_ColorTbl[i].setRgb(255, 255*(i-250)/5, 255*(i-250)/5);
-        }
-    }
-    else if (cmap.compare("turbo", Qt::CaseInsensitive) == 0)
-    {
-        for (i = 0; i < 256; i++)
-            m_ColorTbl[i].setRgb(turbo[i][0], turbo[i][1], turbo[i][2]);
-    }
-    else if (cmap.compare("plasma",Qt::CaseInsensitive) == 0)
-    {
-        for (i = 0; i < 256; i++)
-            m_ColorTbl[i].setRgb(plasma[i][0], plasma[i][1], plasma[i][2]);
-    }
-    else if (cmap.compare("whitehotcompressed",Qt::CaseInsensitive) == 0)
-    {
-        // contributed by @drmpeg @devnulling
-        // for use with high quality spectrum paining
-        // see https://gist.github.com/drmpeg/31a9a7dd6918856aeb60
-        for (i = 0; i < 256; i++)
-        {
-            if (i < 64)
-            {
-                m_ColorTbl[i].setRgb(i*4, i*4, i*4);
-            }
-            else
-            {
-                m_ColorTbl[i].setRgb(255, 255, 255);
-            }
-        }
-    }
-    else if (cmap.compare("whitehot",Qt::CaseInsensitive) == 0)
-    {
-        for (i = 0; i < 256; i++)
-            m_ColorTbl[i].setRgb(i, i, i);
-    }
-    else if (cmap.compare("blackhot",Qt::CaseInsensitive) == 0)
-    {
-        for (i = 0; i < 256; i++)
-            m_ColorTbl[i].setRgb(255-i, 255-i, 255-i);
-    }
-    else if (cmap.compare("viridis",Qt::CaseInsensitive) == 0)
-    {
-        for (i = 0; i < 256; i++)
-            m_ColorTbl[i].setRgb(viridis[i][0] * 256, viridis[i][1] * 256, viridis[i][2] * 256);
-    }
+#ifdef WITH_OPENGL_WATERFALL
+    if (m_wfGL)
+        m_wfGL->setColormap(m_colormap.table());
+#endif
+
+    // Old lines are drawn again with the new colors
+    m_wfHistoryKey.clear();
 }
@@ -6,8 +6,17 @@
 #include <QFont>
 #include <QFrame>
 #include <QImage>
+#include <QCache>
+#include <QHash>
+#include <QStaticText>
 #include <vector>
 #include <QMap>
+#include "colormap.h"
+#include "peak_tracker.h"
+#include "render_timing.h"
+#include "waterfall_history.h"
+
+class QTimer;
 
 #define HORZ_DIVS_MAX 12    //50
 #define VERT_DIVS_MIN 5
@@ -16,12 +25,20 @@
 
 #define PEAK_CLICK_MAX_H_DISTANCE 10 //Maximum horizontal distance of clicked point from peak
 #define PEAK_CLICK_MAX_V_DISTANCE 20 //Maximum vertical distance of clicked point from peak
-#define PEAK_WINDOW_HALF_WIDTH    10
 #define PEAK_UPDATE_PERIOD       100 // msec
-#define PLOTTER_UPDATE_LIMIT_MS   16 // 16ms = 62.5 Hz
+#define PLOTTER_UPDATE_LIMIT_MS   16 // 16ms = 62.5 Hz, used if the refresh rate is unknown
+#define PLOTTER_MIN_PRESENT_MS     4 // 250 Hz
+#define PLOTTER_STORE_CHUNK      256 // waterfall backing store grows in steps of this many pixels
+#define RENDER_TIMING_REPORT_MS 1000 // interval of renderTimingUpdated()
+#define LEVEL_STATS_PERIOD       500 // msec, interval of levelStatsUpdated()
+#define LEVEL_STATS_NOISE_PCT     20 // percentile of the bins taken as noise floor
+#define LEVEL_STATS_PEAK_PERMILLE 995 // permille of the bins taken as peak level
+#define OVERLAY_LABEL_CACHE     4096 // tag and band labels kept laid out between overlay draws
 
 #define MARKER_OFF std::numeric_limits<qint64>::min()
 
+class CWaterfallGL;
+
 class CPlotter : public QFrame
 {
     Q_OBJECT
@@ -34,7 +51,7 @@ public:
     QSize sizeHint() const override;
 
     //void SetSdrInterface(CSdrInterface* ptr){m_pSdrInterface = ptr;}
-    void draw(bool newData); //call to draw new fft data onto screen plot
+    void draw(bool newData, bool present = true); //call to draw new fft data onto screen plot
     void setRunningState(bool running);
     void setClickResolution(int clickres) { m_ClickResolution = clickres; }
     void setFilterClickResolution(int clickres) { m_FilterClickResolution = clickres; }
@@ -46,6 +63,17 @@ public:
     void setDXCSpotsEnabled(bool enabled) { m_DXCSpotsEnabled = enabled; }
 
     void setNewFftData(const float *fftData, int size);
+    void setNewFftData(const float *fftData, int size, double rate, qint64 center);
+    void setZoomFftEnabled(bool enabled) { m_ZoomFftEnabled = enabled; }
+
+    // Panorama of sweep results instead of the live FFT
+    void setPanorama(bool enabled, qint64 startFreq = 0, qint64 stopFreq = 0);
+    bool isPanorama() const { return m_Panorama; }
+    qint64 getPanoramaStart() const { return m_PanoStart; }
+    qint64 getPanoramaStop() const { return m_PanoStop; }
+    void addPanoramaSegment(double startFreq, double binHz, const float *data, int size,
+                            int fftSize, bool newSweep);
+    bool gpuWaterfall() const { return m_wfGL != nullptr; }
 
     void setCenterFreq(quint64 f);
     void setFreqUnits(qint32 unit) { m_FreqUnits = unit; }
@@ -57,6 +85,15 @@ public:
     int xFromFreq(qint64 freq);
     qint64 freqFromX(int x);
 
+    /*! \brief Additional VFO, drawn as a filter box with its number. */
+    struct VfoMarker {
+        int     id;
+        qint64  freq;       /*!< Channel frequency [Hz]. */
+        int     low;        /*!< Low cut from freq [Hz]. */
+        int     high;       /*!< High cut from freq [Hz]. */
+    };
+    void setVfoMarkers(const QVector<VfoMarker> &markers);
+
     /*! \brief Move the filter to freq_hz from center. */
     void setFilterOffset(qint64 freq_hz)
     {
@@ -98,6 +135,8 @@ public:
         updateOverlay();
     }
 
+    qint64 getSpanFreq() const { return m_Span; }
+
     void setVdivDelta(int delta) { m_VdivDelta = delta; }
 
     void setFreqDigits(int digits) { m_FreqDigits = digits>=0 ? digits : 0; }
@@ -127,8 +166,17 @@ public:
     }
 
     int     getNearestPeak(QPoint pt);
+    /*! \brief Tracked peaks of the latest detection run, by frequency. */
+    std::vector<CPeakTracker::Track> getPeakTracks() const { return m_peakTracks; }
+    /*! \brief Stage timers of the render path, shared with MainWindow. */
+    CRenderTiming &renderTiming() { return m_timing; }
+    /*! \brief GUI thread time spent on frames since the last call, in ns. */
+    qint64  takeBusyNs();
     void    setWaterfallSpan(quint64 span_ms);
     quint64 getWfTimeRes() const;
+    float   getWaterfallMin() const { return m_WfMindB; }
+    float   getWaterfallMax() const { return m_WfMaxdB; }
+    const QString &getWfColormap() const { return m_colormap.name(); }
     void    setFftRate(int rate_hz);
     void    clearWaterfallBuf();
 
@@ -159,8 +207,11 @@ signals:
     void pandapterRangeChanged(float min, float max);
     void newZoomLevel(float level);
     void newSize();
+    void renderTimingUpdated(const QString &summary);
+    void levelStatsUpdated(float noiseFloor, float peakLevel); /* dB, for automatic ranges */
     void markerSelectA(qint64 freq);
     void markerSelectB(qint64 freq);
+    void panoramaFreqSelected(qint64 freq);
 
 public slots:
     // zoom functions
@@ -178,16 +229,25 @@ public slots:
     void enableMaxHold(bool enabled);
     void enableMinHold(bool enabled);
     void setFftAvg(float avg);
+    void setFftLogAvg(bool enabled);
     void setFftRange(float min, float max);
     void setWfColormap(const QString &cmap);
     void setPandapterRange(float min, float max);
     void setWaterfallRange(float min, float max);
     void enablePeakDetect(bool enabled);
+    void enableLevelStats(bool enabled);
     void enableBandPlan(bool enable);
     void enableMarkers(bool enabled);
     void setMarkers(qint64 a, qint64 b);
     void clearWaterfall();
+    void setGpuWaterfall(bool enabled);
+    void setWaterfallResolution(int percent);
+    void setWaterfallShed(bool shed);
+    void setReducedDetail(bool reduced);
+    void enableRenderTiming(bool enabled);
     void updateOverlay();
+    void updateTags();
+    void setClassification(const QString &text);
 
     void setPercent2DScreen(int percent)
     {
@@ -196,6 +256,10 @@ public slots:
         resizeEvent(nullptr);
     }
 
+private slots:
+    void gpuWaterfallFailed();
+    void presentFrame();
+
 protected:
     //re-implemented widget event handlers
     void paintEvent(QPaintEvent *event) override;
@@ -206,6 +270,24 @@ protected:
     void wheelEvent( QWheelEvent * event ) override;
 
 private:
+    void updateColumnBins(qint32 minbin, qint32 maxbin, qint32 startBin, double xScale);
+    void updateLevelStats();
+    void schedulePresent();
+    void renderWaterfallHistory();
+    bool renderHistoryLine(int age, int &xmin, int &xmax);
+    void allocWaterfallImage(int w, int h);
+    void drawTimingHud(QPainter &painter);
+    qint64 viewStart() const;
+    qint64 viewSpan() const { return m_Panorama ? m_PanoStop - m_PanoStart : m_Span; }
+    float powerScale(int size, double rate) const;
+    void drawPanorama(bool present);
+    void renderPanorama(int x0, int x1);
+    void resizePanorama(int w, int plotHeight, int wfHeight);
+    void applyWfResolution();
+    int  wfResolution() const {
+        return m_wfShed ? qMax(m_wfResolution / 2, 10) : m_wfResolution;
+    }
+
     enum eCapturetype {
         NOCAP,
         LEFT,
@@ -218,7 +300,31 @@ private:
         MARKER_B
     };
 
+    // Overlay layers, from bottom to top
+    enum eOverlayLayer {
+        OVERLAY_TAGS,
+        OVERLAY_BANDPLAN,
+        OVERLAY_MARKERS,
+        OVERLAY_FREQ_GRID,
+        OVERLAY_LEVEL_GRID,
+        OVERLAY_FILTER,
+        OVERLAY_LAYERS
+    };
+
     void        drawOverlay();
+    bool        overlayLayerStale(int layer, const QVector<double> &key);
+    void        invalidateOverlayLayer(int layer);
+    void        drawOverlayTags(QPainter &painter, qreal h, qreal xAxisTop);
+    void        drawOverlayBandPlan(QPainter &painter, const QFontMetricsF &metrics,
+                                    qreal w, qreal xAxisTop);
+    void        drawOverlayMarkers(QPainter &painter, const QFontMetricsF &metrics,
+                                   qreal xAxisTop);
+    void        drawOverlayFreqGrid(QPainter &painter, const QFontMetricsF &metrics,
+                                    qreal w, qreal xAxisTop);
+    void        drawOverlayLevelGrid(QPainter &painter, const QFontMetricsF &metrics,
+                                     qreal w, qreal h, qreal xAxisHeight);
+    void        drawOverlayFilter(QPainter &painter, qreal h);
+    QStaticText overlayLabel(const QString &text);
     void        makeFrequencyStrs();
     void        zoomStepX(float factor, int x);
     static qint64      roundFreq(qint64 freq, int resolution);
@@ -251,21 +357,44 @@ private:
     float       m_fftAvgBuf[MAX_SCREENSIZE]{};
     float       m_wfMaxBuf[MAX_SCREENSIZE]{};
     float       m_wfAvgBuf[MAX_SCREENSIZE]{};
-    float       m_histogram[MAX_SCREENSIZE][MAX_HISTOGRAM_SIZE]{};
-    float       m_histIIR[MAX_SCREENSIZE][MAX_HISTOGRAM_SIZE]{};
+    // Histogram hits of a frame and their IIR in fixed point, see HIST_HIT
+    uint32_t    m_histogram[MAX_SCREENSIZE][MAX_HISTOGRAM_SIZE]{};
+    uint32_t    m_histIIR[MAX_SCREENSIZE][MAX_HISTOGRAM_SIZE]{};
+    qint16      m_histTopBin[MAX_SCREENSIZE]{};   // highest lit bin of each column, or -1
+    QImage      m_histImage;                      // colored cells, a pixel per bin
     QPointF     m_avgLineBuf[MAX_SCREENSIZE]{};
     QPointF     m_maxLineBuf[MAX_SCREENSIZE]{};
     QPointF     m_holdLineBuf[MAX_SCREENSIZE]{};
     float       m_histMaxIIR;
-    std::vector<float> m_fftIIR;
+    std::vector<float> m_fftIIR;           // log2 of the power with m_logAvg
     std::vector<float> m_fftData;
     std::vector<float> m_X;                // scratch array of matching size for local calculation
+    std::vector<float> m_syncScratch;      // linear m_fftIIR for the waterfall history
     float      m_wfbuf[MAX_SCREENSIZE]{}; // used for accumulating waterfall data at high time spans
     float       m_fftMaxHoldBuf[MAX_SCREENSIZE]{};
     float       m_fftMinHoldBuf[MAX_SCREENSIZE]{};
-    float       m_peakSmoothBuf[MAX_SCREENSIZE]{}; // used in peak detection
     float      *m_wfData{};
     int         m_fftDataSize{};
+    double      m_fftDataRate{};       // bandwidth covered by m_fftData
+    qint64      m_fftDataCenter{};     // center of m_fftData relative to m_CenterFreq
+    bool        m_ZoomFftEnabled{};    // zoomed views may get decimated FFT data
+
+    // Pixel column -> FFT bin range table, rebuilt when the mapping changes
+    std::vector<qint32> m_colX;        // pixel of each column
+    std::vector<qint32> m_colBin;      // first bin of each column, plus end sentinel
+    qint32      m_colMinBin{-1};
+    qint32      m_colMaxBin{-1};
+    qint32      m_colStartBin{-1};
+    double      m_colScale{};
+
+    // Bin to pixel mapping of the last column reduction
+    qint32      m_redMinBin{-1};
+    qint32      m_redMaxBin{-1};
+    qint32      m_redStartBin{-1};
+    double      m_redScale{};
+
+    QTimer     *m_presentTimer{};      // coalesces repaints to the display rate
+    int         m_presentIntervalMs{PLOTTER_UPDATE_LIMIT_MS};
 
     qreal       m_XAxisYCenter{};
     qreal       m_YAxisWidth{};
@@ -273,10 +402,29 @@ private:
     eCapturetype    m_CursorCaptured;
     QPixmap     m_2DPixmap;         // Composite of everything displayed in the 2D plotter area
     QPixmap     m_OverlayPixmap;    // Grid, axes ... things that need to be drawn infrequently
+    QPixmap     m_OverlayLayer[OVERLAY_LAYERS];         // cached parts of m_OverlayPixmap
+    QVector<double> m_OverlayLayerKey[OVERLAY_LAYERS];  // state each layer was drawn with
     QPixmap     m_PeakPixmap;
     QImage      m_WaterfallImage;
     int         m_WaterfallOffset;
-    QColor      m_ColorTbl[256];
+    CColormap   m_colormap;
+    CWaterfallGL *m_wfGL{nullptr};   // OpenGL waterfall, replaces m_WaterfallImage drawing
+    std::vector<quint8> m_wfLine;    // colormap indices of the new GPU waterfall line
+
+    CWaterfallHistory m_wfHistory;      // quantized dB rows behind the waterfall
+    QVector<double>   m_wfHistoryKey;   // view the waterfall was last rendered for
+    std::vector<quint16> m_wfHistLine;  // levels of a rendered history row
+    int         m_wfResolution{100};    // waterfall resolution in percent of the screen
+    bool        m_wfShed{false};        // halve the resolution under load
+    bool        m_reducedDetail{false}; // no fill and peak markers under load
+    qint64      m_busyNs{0};            // time in setNewFftData(), presentFrame() and paintEvent()
+    std::vector<uchar> m_wfStore;       // pixels of m_WaterfallImage, grown in chunks
+    mem_charge  m_wfStoreMem{MEM_WATERFALL};
+    int         m_wfStoreWidth{0};
+    int         m_wfStoreHeight{0};
+
+    CRenderTiming m_timing;             // render path timers, shown as HUD when enabled
+    quint64     m_timingReportMs{0};    // time of the last renderTimingUpdated()
     QSize       m_Size;
     qreal       m_DPR{};
     QString     m_HDivText[HORZ_DIVS_MAX+1];
@@ -302,6 +450,8 @@ private:
     int         m_DemodFreqX{};       //screen coordinate x position
     int         m_DemodHiCutFreqX{};  //screen coordinate x position
     int         m_DemodLowCutFreqX{}; //screen coordinate x position
+    QString     m_Classification;     /*!< Modulation of the demod channel */
+    QVector<VfoMarker> m_VfoMarkers;  /*!< Additional VFOs */
     int         m_MarkerAX{};
     int         m_MarkerBX{};
     int         m_CursorCaptureDelta;
@@ -322,6 +472,7 @@ private:
     float       m_WfMindB;
     float       m_WfMaxdB;
     float       m_alpha;     /*!< IIR averaging. */
+    bool        m_logAvg{false}; /*!< IIR and column averages on log2 of the power. */
 
     qint64      m_Span;
     float       m_SampleFreq;    /*!< Sample rate. */
@@ -347,9 +498,18 @@ private:
     QColor      m_FftFillCol, m_FilledModeFillCol, m_FilledModeMaxLineCol, m_FilledModeAvgLineCol, m_MainLineCol, m_HoldLineCol;
     bool        m_FftFill{};
 
-    QMap<int,qreal>   m_Peaks;
+    QMap<int,qreal>   m_Peaks;      // x -> y of the peaks drawn
+    CPeakTracker      m_peakTracker;
+    std::vector<CPeakTracker::Track> m_peakTracks;
+    bool        m_LevelStatsActive{};
+    quint64     tlast_level_stats_ms{}; // last time levelStatsUpdated() was emitted
+    std::vector<float> m_levelScratch;  // copy of m_fftIIR for the percentiles
 
     QList< QPair<QRectF, qint64> >     m_Taglist;
+    QCache<QString, QStaticText> m_labelCache{OVERLAY_LABEL_CACHE};
+    QFont       m_labelFont;        // font the cached labels were laid out with
+    QHash<QPair<qint64, QString>, int> m_tagLevels;  // level of each tag last drawn
+    QVector<double> m_tagLevelsKey; // span and size m_tagLevels is valid for
 
     // Waterfall averaging
     quint64     tlast_wf_ms;        // last time waterfall has been updated
@@ -363,6 +523,20 @@ private:
     quint64     tlast_peaks_ms;     // last time peaks were updated
     quint64     wf_span;            // waterfall span in milliseconds (0 = auto)
     int         fft_rate;           // expected FFT rate (needed when WF span is auto)
+
+    // Panorama, a column per pixel of the plot
+    bool        m_Panorama{false};
+    qint64      m_PanoStart{};
+    qint64      m_PanoStop{};
+    std::vector<float>   m_panoMax;     // scaled linear power of each column
+    std::vector<float>   m_panoSum;
+    std::vector<int>     m_panoCount;   // bins in m_panoSum, 0 if never swept
+    std::vector<quint32> m_panoSweepOf; // sweep that last wrote each column
+    quint32     m_panoSweep{0};
+    QPixmap     m_PanoPixmap;           // trace, only columns of new segments are redrawn
+    QVector<double> m_PanoKey;          // range and mode m_PanoPixmap was drawn with
+    QImage      m_PanoWaterfall;        // a line per sweep
+    int         m_PanoWfOffset{0};
 };
 
 #endif // PLOTTER_H
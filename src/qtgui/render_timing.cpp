@@ -0,0 +1,146 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <vector>
+#include "render_timing.h"
+
+static const char *stage_names[CRenderTiming::STAGES] = {
+    "fft", "iir", "columns", "waterfall", "plot", "overlay", "paint"
+};
+
+CRenderTiming::Scope::Scope(CRenderTiming &timing, int stage, bool active) :
+    m_timing(timing),
+    m_stage(stage),
+    m_running(active && timing.isEnabled())
+{
+    if (m_running)
+        m_timer.start();
+}
+
+void CRenderTiming::Scope::stop()
+{
+    if (!m_running)
+        return;
+    m_timing.add(m_stage, m_timer.nsecsElapsed());
+    m_running = false;
+}
+
+CRenderTiming::CRenderTiming() :
+    m_enabled(false)
+{
+    clear();
+}
+
+/** Enable or disable recording. Old samples are dropped when enabling. */
+void CRenderTiming::setEnabled(bool enabled)
+{
+    if (enabled && !m_enabled)
+        clear();
+    m_enabled = enabled;
+}
+
+void CRenderTiming::clear()
+{
+    for (int s = 0; s < STAGES; s++)
+    {
+        m_count[s] = 0;
+        m_next[s] = 0;
+    }
+}
+
+/** Record a run of a stage that took ns nanoseconds. */
+void CRenderTiming::add(int stage, qint64 ns)
+{
+    if (!m_enabled || stage < 0 || stage >= STAGES)
+        return;
+
+    m_samples[stage][m_next[stage]] = ns;
+    m_next[stage] = (m_next[stage] + 1) % RENDER_TIMING_SAMPLES;
+    m_count[stage] = std::min(m_count[stage] + 1, RENDER_TIMING_SAMPLES);
+}
+
+/** Percentiles of the recorded runs of a stage, in microseconds. */
+CRenderTiming::Stats CRenderTiming::stats(int stage) const
+{
+    Stats st = {0, 0.0, 0.0, 0.0, 0.0};
+    if (stage < 0 || stage >= STAGES || m_count[stage] == 0)
+        return st;
+
+    std::vector<qint64> v(m_samples[stage], m_samples[stage] + m_count[stage]);
+    std::sort(v.begin(), v.end());
+
+    const int n = (int)v.size();
+    auto pct = [&](int p) { return (double)v[std::min(n * p / 100, n - 1)] / 1000.0; };
+
+    st.count = n;
+    st.p50 = pct(50);
+    st.p95 = pct(95);
+    st.p99 = pct(99);
+    st.max = (double)v[n - 1] / 1000.0;
+    return st;
+}
+
+const char *CRenderTiming::stageName(int stage)
+{
+    if (stage < 0 || stage >= STAGES)
+        return "";
+    return stage_names[stage];
+}
+
+/**
+ * One line summary of all stages with samples, for the remote control.
+ *
+ * Format: "stage:count,p50,p95,p99,max stage:..." with times in
+ * microseconds.
+ */
+QString CRenderTiming::summary() const
+{
+    QStringList items;
+    for (int s = 0; s < STAGES; s++)
+    {
+        const Stats st = stats(s);
+        if (st.count == 0)
+            continue;
+        items << QString("%1:%2,%3,%4,%5,%6").arg(stageName(s)).arg(st.count)
+                 .arg(st.p50, 0, 'f', 0).arg(st.p95, 0, 'f', 0)
+                 .arg(st.p99, 0, 'f', 0).arg(st.max, 0, 'f', 0);
+    }
+    return items.join(' ');
+}
+
+/** Text lines for the on-screen display, times in milliseconds. */
+QStringList CRenderTiming::hudLines() const
+{
+    QStringList lines;
+    lines << QString("%1 %2 %3 %4").arg("stage", -10).arg("p50", 7).arg("p95", 7).arg("p99", 7);
+    for (int s = 0; s < STAGES; s++)
+    {
+        const Stats st = stats(s);
+        if (st.count == 0)
+            continue;
+        lines << QString("%1 %2 %3 %4").arg(stageName(s), -10)
+                 .arg(st.p50 / 1000.0, 7, 'f', 2).arg(st.p95 / 1000.0, 7, 'f', 2)
+                 .arg(st.p99 / 1000.0, 7, 'f', 2);
+    }
+    return lines;
+}
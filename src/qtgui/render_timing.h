@@ -0,0 +1,98 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RENDER_TIMING_H
+#define RENDER_TIMING_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+
+/* Number of samples per stage the percentiles are taken over */
+#define RENDER_TIMING_SAMPLES  256
+
+/**
+ * Timing of the spectrum and waterfall render path.
+ *
+ * Each stage keeps the durations of its last RENDER_TIMING_SAMPLES runs,
+ * from which percentiles are computed on request. Recording is a branch
+ * when disabled and a clock read and a store when enabled, so the timers
+ * can stay in the hot path.
+ */
+class CRenderTiming
+{
+public:
+    enum eStage {
+        FFT = 0,    // fetching the FFT frame in MainWindow::iqFftTimeout()
+        IIR,        // scaling and averaging in CPlotter::setNewFftData()
+        COLUMNS,    // reduction of bins to pixel columns
+        WATERFALL,  // waterfall line, history and re-render
+        PLOT,       // painting the 2D plot, including OVERLAY
+        OVERLAY,    // redrawing the overlay
+        PAINT,      // CPlotter::paintEvent() composition
+        STAGES
+    };
+
+    struct Stats {
+        int    count;   // samples available
+        double p50;     // in microseconds
+        double p95;
+        double p99;
+        double max;
+    };
+
+    /** Times a stage from construction to stop() or destruction. */
+    class Scope
+    {
+    public:
+        Scope(CRenderTiming &timing, int stage, bool active = true);
+        ~Scope() { stop(); }
+        void stop();
+
+    private:
+        CRenderTiming &m_timing;
+        int            m_stage;
+        bool           m_running;
+        QElapsedTimer  m_timer;
+    };
+
+    CRenderTiming();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+    void clear();
+
+    void  add(int stage, qint64 ns);
+    Stats stats(int stage) const;
+
+    static const char *stageName(int stage);
+    QString     summary() const;
+    QStringList hudLines() const;
+
+private:
+    bool   m_enabled;
+    qint64 m_samples[STAGES][RENDER_TIMING_SAMPLES];   // nanoseconds
+    int    m_count[STAGES];
+    int    m_next[STAGES];
+};
+
+#endif // RENDER_TIMING_H
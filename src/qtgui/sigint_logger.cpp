@@ -1,13 +1,54 @@
 #include "sigint_logger.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
 #include <iostream>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include <QFileInfo>
+#include <QStringList>
 
-SigintLogger::SigintLogger() : logStream(nullptr) {
+static_assert((SIGINT_LOG_QUEUE & (SIGINT_LOG_QUEUE - 1)) == 0,
+              "SIGINT_LOG_QUEUE must be a power of two");
+
+static const char *category_names[SigintLogger::Categories] = {
+    "general", "fft", "waterfall", "capture", "network", "database"
+};
+
+static const char *level_names[] = { "debug", "info", "warning", "error", "off" };
+
+// The signals that write the crash dump
+static const int fatal_signals[] = {
+    SIGSEGV, SIGABRT, SIGFPE, SIGILL,
+#ifdef SIGBUS
+    SIGBUS,
+#endif
+};
+
+// Per frame categories start at Info, the rest log everything
+std::atomic<int> SigintLogger::s_levels[SigintLogger::Categories] = {
+    {SigintLogger::Debug}, {SigintLogger::Info}, {SigintLogger::Info},
+    {SigintLogger::Debug}, {SigintLogger::Debug}, {SigintLogger::Debug}
+};
+
+SigintLogger::SigintLogger()
+    : logOpened(0), tail(0), head(0), lost(0), running(false), quit(false),
+      recentNext(0), logFd(-1)
+{
     // Force stderr to be unbuffered
     setvbuf(stderr, nullptr, _IONBF, 0);
+
+    for (size_t i = 0; i < SIGINT_LOG_QUEUE; i++)
+        queue[i].seq.store(i, std::memory_order_relaxed);
+    std::memset(recent, 0, sizeof(recent));
 }
 
 SigintLogger::~SigintLogger() {
-    cleanup();
+    cleanupImpl();
 }
 
 SigintLogger& SigintLogger::instance() {
@@ -20,72 +61,285 @@ void SigintLogger::initialize(const QString& logPath) {
 }
 
 void SigintLogger::debug(const QString& msg) {
-    instance().logImpl("Debug", "\033[34m", msg);  // Blue
+    SIGINT_LOG(Debug, General, msg);
 }
 
 void SigintLogger::info(const QString& msg) {
-    instance().logImpl("Info", "\033[32m", msg);   // Green
+    SIGINT_LOG(Info, General, msg);
 }
 
 void SigintLogger::warning(const QString& msg) {
-    instance().logImpl("Warning", "\033[33m", msg); // Yellow
+    SIGINT_LOG(Warning, General, msg);
 }
 
 void SigintLogger::error(const QString& msg) {
-    instance().logImpl("Error", "\033[31m", msg);   // Red
+    SIGINT_LOG(Error, General, msg);
+}
+
+void SigintLogger::setLevel(Category category, Level level) {
+    if (category >= 0 && category < Categories)
+        s_levels[category].store(level, std::memory_order_relaxed);
+}
+
+/* Queue a message; callers normally go through SIGINT_LOG(), which checks the level first.
+ * Before initialize() and after cleanup() the message is written to stderr at once. */
+void SigintLogger::log(Level level, Category category, const QString& msg) {
+    if (level < Debug || level > Error)
+        return;
+
+    Record rec;
+    rec.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::system_clock::now().time_since_epoch()).count();
+    rec.level = level;
+    rec.category = category;
+    rec.msg = msg;
+
+    SigintLogger& logger = instance();
+    if (!logger.running.load(std::memory_order_acquire)) {
+        QByteArray console, file;
+        logger.format(rec, console, file);
+        fwrite(console.constData(), 1, console.size(), stderr);
+        return;
+    }
+
+    if (!logger.enqueue(std::move(rec))) {
+        logger.lost.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (level >= Warning)
+        logger.wake.notify_one();
+}
+
+/* True if interval_ms has passed since the last time this returned true for last_ms. */
+bool SigintLogger::rateLimit(std::atomic<qint64>& last_ms, int interval_ms) {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 last = last_ms.load(std::memory_order_relaxed);
+    if (now - last < interval_ms)
+        return false;
+    return last_ms.compare_exchange_strong(last, now, std::memory_order_relaxed);
+}
+
+quint64 SigintLogger::dropped() {
+    return instance().lost.load(std::memory_order_relaxed);
 }
 
 void SigintLogger::cleanup() {
     instance().cleanupImpl();
 }
 
-void SigintLogger::initializeImpl(const QString& logPath) {
-    if (logFile.isOpen()) return;
+void SigintLogger::initializeImpl(const QString& path) {
+    if (running.load(std::memory_order_acquire)) return;
+
+    // Levels from the environment, e.g. GQRX_SIGINT_LOG="fft=debug,network=warning"
+    // or "*=info". Unknown names are ignored.
+    const QStringList rules = QString::fromLocal8Bit(qgetenv("GQRX_SIGINT_LOG"))
+                              .split(',', Qt::SkipEmptyParts);
+    for (const QString& rule : rules) {
+        const QStringList kv = rule.trimmed().split('=');
+        if (kv.size() != 2)
+            continue;
+        int level = -1;
+        for (int l = Debug; l <= Off; l++)
+            if (kv[1].trimmed().compare(level_names[l], Qt::CaseInsensitive) == 0)
+                level = l;
+        if (level < 0)
+            continue;
+        for (int c = 0; c < Categories; c++)
+            if (kv[0].trimmed() == "*" || kv[0].trimmed().compare(category_names[c], Qt::CaseInsensitive) == 0)
+                setLevel((Category)c, (Level)level);
+    }
     
+    logPath = path;
     logFile.setFileName(logPath);
     if (logFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
-        logStream = new QTextStream(&logFile);
-        
+        // The age of the file counts from its creation, also across restarts
+        const QDateTime born = QFileInfo(logPath).birthTime();
+        logOpened = born.isValid() ? born.toMSecsSinceEpoch() : QDateTime::currentMSecsSinceEpoch();
+        logFd.store(logFile.handle(), std::memory_order_release);
+
         // Write startup message to both console and file
         QString startMsg = QString("\n=== Starting GQRX SIGINT at %1 ===\n")
                             .arg(QDateTime::currentDateTime().toString());
         
         fprintf(stderr, "\033[32m%s\033[0m", qPrintable(startMsg));  // Green
-        *logStream << startMsg;
-        logStream->flush();
+        logFile.write(startMsg.toUtf8());
+        logFile.flush();
     } else {
         fprintf(stderr, "\033[31mFailed to open log file: %s\033[0m\n", 
                 qPrintable(logPath));
     }
+
+    quit.store(false, std::memory_order_relaxed);
+    writer = std::thread(&SigintLogger::run, this);
+    running.store(true, std::memory_order_release);
+
+    for (int sig : fatal_signals)
+        std::signal(sig, &SigintLogger::fatalSignal);
 }
 
-void SigintLogger::logImpl(const QString& level, const char* color, const QString& msg) {
-    QString timestamp = QDateTime::currentDateTime()
-                        .toString("yyyy-MM-dd hh:mm:ss.zzz");
-    
-    // Console output with color - using fprintf for direct output
-    fprintf(stderr, "%s[%s][%s]: %s\033[0m\n",
-            color,
-            qPrintable(timestamp),
-            qPrintable(level),
-            qPrintable(msg));
-    
-    // File output
-    if (logStream) {
-        *logStream << QString("[%1][%2]: %3\n")
-                        .arg(timestamp)
-                        .arg(level)
-                        .arg(msg);
-        logStream->flush();
+/* Claim the next slot and fill it, false if the queue is full. */
+bool SigintLogger::enqueue(Record&& rec) {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+        slot = &queue[pos & (SIGINT_LOG_QUEUE - 1)];
+        const size_t seq = slot->seq.load(std::memory_order_acquire);
+        const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = tail.load(std::memory_order_relaxed);
+        }
     }
+
+    slot->rec = std::move(rec);
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+/* The writer thread: drain the queue every SIGINT_LOG_FLUSH_MS or when woken,
+ * and write each batch with one write per output. */
+void SigintLogger::run() {
+    QByteArray console;
+    QByteArray file;
+    quint64 reported = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(SIGINT_LOG_FLUSH_MS));
+        }
+        // Whatever was queued before quit was set is written below
+        const bool stopping = quit.load(std::memory_order_acquire);
+
+        drain(console, file);
+        const quint64 dropped = lost.load(std::memory_order_relaxed);
+        if (dropped != reported) {
+            Record rec;
+            rec.time_us = QDateTime::currentMSecsSinceEpoch() * 1000;
+            rec.level = Warning;
+            rec.category = General;
+            rec.msg = QString("%1 log records dropped, the queue was full").arg(dropped - reported);
+            format(rec, console, file);
+            reported = dropped;
+        }
+
+        if (!console.isEmpty())
+            fwrite(console.constData(), 1, console.size(), stderr);
+        if (!file.isEmpty() && logFile.isOpen()) {
+            if (logFile.size() + file.size() > SIGINT_LOG_MAX_BYTES ||
+                QDateTime::currentMSecsSinceEpoch() - logOpened > (qint64)SIGINT_LOG_MAX_AGE_S * 1000)
+                rotate();
+            logFile.write(file);
+            logFile.flush();
+        }
+        console.resize(0);
+        file.resize(0);
+
+        if (stopping)
+            break;
+    }
+}
+
+/* Format all queued records into the batches, returns their number. */
+int SigintLogger::drain(QByteArray& console, QByteArray& file) {
+    int count = 0;
+    for (;;) {
+        Slot &slot = queue[head & (SIGINT_LOG_QUEUE - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != head + 1)
+            break;
+
+        Record rec = std::move(slot.rec);
+        slot.seq.store(head + SIGINT_LOG_QUEUE, std::memory_order_release);
+        head++;
+
+        const int start = (int)file.size();
+        format(rec, console, file);
+        remember(file.mid(start));
+        count++;
+    }
+    return count;
+}
+
+void SigintLogger::format(const Record& rec, QByteArray& console, QByteArray& file) {
+    static const char *colors[] = { "\033[34m", "\033[32m", "\033[33m", "\033[31m" };  // Blue, green, yellow, red
+    static const char *labels[] = { "Debug", "Info", "Warning", "Error" };
+
+    const QByteArray timestamp = QDateTime::fromMSecsSinceEpoch(rec.time_us / 1000)
+                                 .toString("yyyy-MM-dd hh:mm:ss.zzz").toUtf8();
+    QByteArray label = labels[rec.level];
+    if (rec.category != General)
+        label += QByteArray("][") + category_names[rec.category];
+    const QByteArray msg = rec.msg.toUtf8();
+
+    console += colors[rec.level];
+    console += '[' + timestamp + "][" + label + "]: " + msg + "\033[0m\n";
+    file += '[' + timestamp + "][" + label + "]: " + msg + '\n';
+}
+
+/* Keep a line for the crash dump, cut to SIGINT_LOG_RECENT_LINE. */
+void SigintLogger::remember(const QByteArray& line) {
+    const unsigned next = recentNext.load(std::memory_order_relaxed);
+    char *slot = recent[next % SIGINT_LOG_RECENT];
+    const int len = std::min((int)line.size(), SIGINT_LOG_RECENT_LINE - 1);
+    std::memcpy(slot, line.constData(), len);
+    slot[len] = '\0';
+    if (len == SIGINT_LOG_RECENT_LINE - 1)
+        slot[len - 1] = '\n';
+    recentNext.store(next + 1, std::memory_order_release);
+}
+
+/* Move the log to <path>.1, the older ones up to <path>.SIGINT_LOG_KEEP. */
+void SigintLogger::rotate() {
+    logFd.store(-1, std::memory_order_release);
+    logFile.close();
+
+    QFile::remove(QString("%1.%2").arg(logPath).arg(SIGINT_LOG_KEEP));
+    for (int i = SIGINT_LOG_KEEP - 1; i >= 1; i--)
+        QFile::rename(QString("%1.%2").arg(logPath).arg(i), QString("%1.%2").arg(logPath).arg(i + 1));
+    QFile::rename(logPath, logPath + ".1");
+
+    if (logFile.open(QIODevice::WriteOnly | QIODevice::Append))
+        logFd.store(logFile.handle(), std::memory_order_release);
+    logOpened = QDateTime::currentMSecsSinceEpoch();
+}
+
+/* Only write(), so that it can be called from a signal handler. */
+void SigintLogger::dumpRecent(int fd) {
+    SigintLogger& logger = instance();
+    const unsigned next = logger.recentNext.load(std::memory_order_acquire);
+    const unsigned count = std::min(next, (unsigned)SIGINT_LOG_RECENT);
+    for (unsigned i = next - count; i != next; i++) {
+        const char *line = logger.recent[i % SIGINT_LOG_RECENT];
+        if (write(fd, line, strlen(line)) < 0)
+            return;
+    }
+}
+
+/* Dump the recent lines to stderr and the log file, then die of the signal. */
+void SigintLogger::fatalSignal(int sig) {
+    static const char header[] = "\n=== Fatal signal, last log lines ===\n";
+
+    std::signal(sig, SIG_DFL);
+    if (write(STDERR_FILENO, header, sizeof(header) - 1) >= 0)
+        dumpRecent(STDERR_FILENO);
+    const int fd = instance().logFd.load(std::memory_order_acquire);
+    if (fd >= 0 && write(fd, header, sizeof(header) - 1) >= 0)
+        dumpRecent(fd);
+    std::raise(sig);
 }
 
 void SigintLogger::cleanupImpl() {
-    if (logStream) {
-        delete logStream;
-        logStream = nullptr;
+    if (running.exchange(false, std::memory_order_acq_rel)) {
+        quit.store(true, std::memory_order_release);
+        wake.notify_one();
+        writer.join();
     }
+    logFd.store(-1, std::memory_order_release);
     if (logFile.isOpen()) {
         logFile.close();
     }
-} 
\ No newline at end of file
+}
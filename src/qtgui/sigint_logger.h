@@ -2,12 +2,49 @@
 
 #include <QString>
 #include <QFile>
-#include <QTextStream>
 #include <QDateTime>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
-// Forward declaration of the implementation class
+// Messages below this level are compiled out. Release builds drop debug
+// messages, so hot path debug logging costs nothing there.
+#ifndef SIGINT_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define SIGINT_LOG_MIN_LEVEL 1  // SigintLogger::Info
+#else
+#define SIGINT_LOG_MIN_LEVEL 0  // SigintLogger::Debug
+#endif
+#endif
+
+// Records waiting for the writer thread, a power of two. Records logged
+// while the queue is full are dropped and counted.
+#define SIGINT_LOG_QUEUE        8192
+
+// Interval the writer thread writes at, warnings and errors wake it at once
+#define SIGINT_LOG_FLUSH_MS     100
+
+// The log file is rotated when it grows past the size or gets older than
+// the age, keeping as many old files as SIGINT_LOG_KEEP
+#define SIGINT_LOG_MAX_BYTES    (16 * 1024 * 1024)
+#define SIGINT_LOG_MAX_AGE_S    (24 * 3600)
+#define SIGINT_LOG_KEEP         5
+
+// Recent lines kept in memory for the crash dump, and their length
+#define SIGINT_LOG_RECENT       256
+#define SIGINT_LOG_RECENT_LINE  256
+
+// Writes the records of all threads from a thread of its own. Logging is a
+// level check and, when enabled, a lock-free enqueue of the record; the
+// formatting, the colored console output and the file writes happen in
+// batches in the writer thread. A fatal signal writes the most recent
+// lines to stderr and the log file before the process ends.
 class SigintLogger {
 public:
+    enum Level { Debug = 0, Info, Warning, Error, Off };
+    enum Category { General = 0, Fft, Waterfall, Capture, Network, Database, Categories };
+
     static void initialize(const QString& logPath);
     static void debug(const QString& msg);
     static void info(const QString& msg);
@@ -15,15 +52,86 @@ public:
     static void error(const QString& msg);
     static void cleanup();
 
+    // Runtime level per category, see also GQRX_SIGINT_LOG in initialize()
+    static void setLevel(Category category, Level level);
+    static bool enabled(Level level, Category category)
+    {
+        return (int)level >= s_levels[category].load(std::memory_order_relaxed);
+    }
+    static void log(Level level, Category category, const QString& msg);
+    static bool rateLimit(std::atomic<qint64>& last_ms, int interval_ms);
+
+    // Records lost to a full queue
+    static quint64 dropped();
+
+    // Write the recent lines to a file descriptor, async-signal-safe
+    static void dumpRecent(int fd);
+
 private:
-    QFile logFile;
-    QTextStream* logStream;
+    struct Record {
+        qint64   time_us;     // since the epoch
+        Level    level;
+        Category category;
+        QString  msg;
+    };
+
+    // Slot of the bounded multi-producer queue, seq tells whose turn it is
+    struct Slot {
+        std::atomic<size_t> seq;
+        Record              rec;
+    };
+
+    QFile   logFile;
+    QString logPath;
+    qint64  logOpened;          // ms since the epoch
+
+    Slot                     queue[SIGINT_LOG_QUEUE];
+    std::atomic<size_t>      tail;      // next slot to claim by the producers
+    size_t                   head;      // next slot of the writer
+    std::atomic<quint64>     lost;
+    std::thread              writer;
+    std::mutex               wakeMutex;
+    std::condition_variable  wake;
+    std::atomic<bool>        running;
+    std::atomic<bool>        quit;
+
+    // Written by the writer thread only, read by dumpRecent()
+    char                     recent[SIGINT_LOG_RECENT][SIGINT_LOG_RECENT_LINE];
+    std::atomic<unsigned>    recentNext;
+    std::atomic<int>         logFd;     // of logFile, -1 while closed
+
+    static std::atomic<int> s_levels[Categories];
     
     SigintLogger();
     ~SigintLogger();
     
     static SigintLogger& instance();
     void initializeImpl(const QString& logPath);
-    void logImpl(const QString& level, const char* color, const QString& msg);
+    bool enqueue(Record&& rec);
+    void run();
+    int  drain(QByteArray& console, QByteArray& file);
+    void format(const Record& rec, QByteArray& console, QByteArray& file);
+    void remember(const QByteArray& line);
+    void rotate();
     void cleanupImpl();
-}; 
\ No newline at end of file
+    static void fatalSignal(int sig);
+};
+
+// Log msg if level is compiled in and enabled for category. The message
+// expression is only evaluated when it will be written.
+#define SIGINT_LOG(level, category, msg) \
+    do { \
+        if ((level) >= SIGINT_LOG_MIN_LEVEL && \
+            SigintLogger::enabled((level), (category))) \
+            SigintLogger::log((level), (category), (msg)); \
+    } while (0)
+
+// As SIGINT_LOG, but at most once per interval_ms for this call site
+#define SIGINT_LOG_EVERY_MS(level, category, interval_ms, msg) \
+    do { \
+        static std::atomic<qint64> sigint_log_last_ms_(0); \
+        if ((level) >= SIGINT_LOG_MIN_LEVEL && \
+            SigintLogger::enabled((level), (category)) && \
+            SigintLogger::rateLimit(sigint_log_last_ms_, (interval_ms))) \
+            SigintLogger::log((level), (category), (msg)); \
+    } while (0)
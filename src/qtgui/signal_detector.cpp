@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cmath>
+#include "signal_detector.h"
+
+SignalDetector::SignalDetector() :
+    m_threshold(SIGNAL_DETECTOR_THRESHOLD_DB),
+    m_centerFreq(0.0),
+    m_sampleRate(0.0),
+    m_frames(0),
+    m_nextId(1)
+{
+}
+
+/**
+ * Close all signals and restart the floor.
+ * @param update Receives the signals that were reported and are now closed.
+ */
+void SignalDetector::reset(Update &update)
+{
+    for (const Track &track : m_tracks) {
+        if (track.reported) {
+            Detection det = track.det;
+            det.event.stop_time = track.lastSeen / 1000.0;
+            update.closed.append(det);
+        }
+    }
+    m_tracks.clear();
+    m_level.clear();
+    m_floor.clear();
+    m_noise.clear();
+    m_frames = 0;
+}
+
+/**
+ * Process a frame.
+ * @param dB Levels in dBFS, for example SpectrumLevels::dB().
+ * @param size Number of bins.
+ * @param centerFreq RF frequency of the center bin.
+ * @param sampleRate Bandwidth covered by the bins.
+ * @param timeMs Time of the frame in ms since the epoch.
+ * @param update The signals reported and closed by this frame (output).
+ * @returns true if the update is not empty.
+ */
+bool SignalDetector::process(const float *dB, int size, double centerFreq, double sampleRate,
+                             qint64 timeMs, Update &update)
+{
+    update.opened.clear();
+    update.closed.clear();
+    if (size <= 0 || sampleRate <= 0.0)
+        return false;
+
+    if (size != (int)m_level.size() || centerFreq != m_centerFreq || sampleRate != m_sampleRate) {
+        reset(update);
+        m_level.assign(dB, dB + size);
+        m_floor = m_level;
+        m_noise = m_level;
+        m_centerFreq = centerFreq;
+        m_sampleRate = sampleRate;
+        return !update.closed.isEmpty();
+    }
+
+    // The floor starts as the mean level, which settles much faster than
+    // the percentile tracker
+    m_frames++;
+    const float up = SIGNAL_DETECTOR_FLOOR_STEP_DB * SIGNAL_DETECTOR_PERCENTILE;
+    const float down = SIGNAL_DETECTOR_FLOOR_STEP_DB * (1.0f - SIGNAL_DETECTOR_PERCENTILE);
+    const bool warmup = m_frames <= SIGNAL_DETECTOR_WARMUP_FRAMES;
+    for (int k = 0; k < size; k++) {
+        m_level[k] += SIGNAL_DETECTOR_ALPHA * (dB[k] - m_level[k]);
+        if (warmup)
+            m_floor[k] += (m_level[k] - m_floor[k]) / (float)m_frames;
+        else
+            m_floor[k] += m_level[k] > m_floor[k] ? up : -down;
+    }
+
+    if (m_frames % SIGNAL_DETECTOR_CFAR_FRAMES == 0)
+        updateNoise();
+    if (m_frames < SIGNAL_DETECTOR_WARMUP_FRAMES)
+        return false;
+
+    const double binHz = sampleRate / size;
+    const double startFreq = centerFreq - sampleRate / 2.0;
+    const int edge = (int)(size * SIGNAL_DETECTOR_EDGE);
+    const int end = size - edge;
+    std::vector<bool> seen(m_tracks.size(), false);
+
+    int k = edge;
+    while (k < end) {
+        if (m_level[k] <= m_noise[k] + m_threshold) {
+            k++;
+            continue;
+        }
+
+        // Run of bins above the threshold, with gaps of up to SIGNAL_DETECTOR_GAP_BINS
+        const int first = k;
+        int last = k;
+        int peak = k;
+        for (k++; k < end && k - last <= SIGNAL_DETECTOR_GAP_BINS + 1; k++) {
+            if (m_level[k] > m_noise[k] + m_threshold) {
+                last = k;
+                if (m_level[k] > m_level[peak])
+                    peak = k;
+            }
+        }
+        k = last + 1;
+
+        int match = -1;
+        for (int i = 0; i < m_tracks.size() && match < 0; i++) {
+            if (!seen[i] && first <= m_tracks[i].hi + SIGNAL_DETECTOR_GAP_BINS &&
+                last >= m_tracks[i].lo - SIGNAL_DETECTOR_GAP_BINS)
+                match = i;
+        }
+
+        const double lo = startFreq + first * binHz;
+        const double hi = startFreq + (last + 1) * binHz;
+        if (match < 0) {
+            Track track;
+            track.det.event.id = 0;
+            track.det.event.range = "detector";
+            track.det.event.start_time = timeMs / 1000.0;
+            track.det.event.center_freq = (lo + hi) / 2.0;
+            track.det.event.bandwidth = hi - lo;
+            track.det.event.peak_db = m_level[peak];
+            track.det.frames = 0;
+            track.reported = false;
+            m_tracks.append(track);
+            seen.push_back(false);
+            match = m_tracks.size() - 1;
+        }
+
+        // Keep the widest extent seen, as the signal may drift
+        Track &track = m_tracks[match];
+        SignalEvent &e = track.det.event;
+        const double elo = std::min(lo, e.center_freq - e.bandwidth / 2.0);
+        const double ehi = std::max(hi, e.center_freq + e.bandwidth / 2.0);
+        e.center_freq = (elo + ehi) / 2.0;
+        e.bandwidth = ehi - elo;
+        e.stop_time = timeMs / 1000.0;
+        e.peak_db = std::max(e.peak_db, (double)m_level[peak]);
+        track.det.level_db = m_level[peak];
+        track.det.snr_db = m_level[peak] - m_noise[peak];
+        track.det.frames++;
+        track.lo = first;
+        track.hi = last;
+        track.lastSeen = timeMs;
+        seen[match] = true;
+
+        if (!track.reported && track.det.frames >= SIGNAL_DETECTOR_CONFIRM_FRAMES) {
+            track.reported = true;
+            e.id = m_allocate ? m_allocate() : m_nextId++;
+            update.opened.append(track.det);
+        }
+    }
+
+    // Signals not reported yet must be seen in consecutive frames, reported
+    // ones are closed when missing for too long
+    for (int i = m_tracks.size() - 1; i >= 0; i--) {
+        const Track &track = m_tracks[i];
+        if (seen[i])
+            continue;
+        if (!track.reported) {
+            m_tracks.remove(i);
+        } else if (timeMs - track.lastSeen > SIGNAL_DETECTOR_HOLD_MS) {
+            Detection det = track.det;
+            det.event.stop_time = track.lastSeen / 1000.0;
+            update.closed.append(det);
+            m_tracks.remove(i);
+        }
+    }
+
+    return !update.opened.isEmpty() || !update.closed.isEmpty();
+}
+
+/* Ordered statistic CFAR over the floor, reduced to cells */
+void SignalDetector::updateNoise()
+{
+    const int size = (int)m_floor.size();
+    const int cells = std::min(size, SIGNAL_DETECTOR_CFAR_CELLS);
+
+    std::vector<float> cell(cells);
+    for (int c = 0; c < cells; c++) {
+        const int b0 = (int)((qint64)c * size / cells);
+        const int b1 = std::max((int)((qint64)(c + 1) * size / cells), b0 + 1);
+        float sum = 0.0f;
+        for (int b = b0; b < b1; b++)
+            sum += m_floor[b];
+        cell[c] = sum / (float)(b1 - b0);
+    }
+
+    // Greatest of the lower quartiles on each side, so the slope at the
+    // edges of the band or of a wide signal is not taken as a signal
+    std::vector<float> cellNoise(cells);
+    std::vector<float> left, right;
+    left.reserve(SIGNAL_DETECTOR_CFAR_WINDOW);
+    right.reserve(SIGNAL_DETECTOR_CFAR_WINDOW);
+    for (int c = 0; c < cells; c++) {
+        left.clear();
+        right.clear();
+        for (int d = SIGNAL_DETECTOR_CFAR_GUARD + 1; d <= SIGNAL_DETECTOR_CFAR_WINDOW; d++) {
+            if (c - d >= 0)
+                left.push_back(cell[c - d]);
+            if (c + d < cells)
+                right.push_back(cell[c + d]);
+        }
+        float noise = -INFINITY;
+        for (std::vector<float> *side : {&left, &right}) {
+            if (side->empty())
+                continue;
+            std::nth_element(side->begin(), side->begin() + side->size() / 4, side->end());
+            noise = std::max(noise, (*side)[side->size() / 4]);
+        }
+        cellNoise[c] = std::min(cell[c], noise);
+    }
+
+    for (int k = 0; k < size; k++)
+        m_noise[k] = std::min(m_floor[k], cellNoise[(int)((qint64)k * cells / size)]);
+}
+
+/** Signals reported and not closed yet. */
+QVector<SignalDetector::Detection> SignalDetector::active() const
+{
+    QVector<Detection> dets;
+    for (const Track &track : m_tracks) {
+        if (track.reported)
+            dets.append(track.det);
+    }
+    return dets;
+}
+
+/**
+ * Active signals, one per line:
+ * "<id> <center Hz> <bandwidth Hz> <peak dBFS> <SNR dB> <start time>",
+ * with the start time in seconds since the epoch.
+ */
+QString SignalDetector::describe() const
+{
+    QString text;
+    for (const Track &track : m_tracks) {
+        if (!track.reported)
+            continue;
+        const SignalEvent &e = track.det.event;
+        text += QString("%1 %2 %3 %4 %5 %6\n")
+                .arg(e.id)
+                .arg(std::llround(e.center_freq))
+                .arg(std::llround(e.bandwidth))
+                .arg(e.peak_db, 0, 'f', 1)
+                .arg(track.det.snr_db, 0, 'f', 1)
+                .arg(e.start_time, 0, 'f', 1);
+    }
+    return text;
+}
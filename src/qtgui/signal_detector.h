@@ -0,0 +1,113 @@
+#ifndef SIGNAL_DETECTOR_H
+#define SIGNAL_DETECTOR_H
+
+#include <functional>
+#include <vector>
+#include <QString>
+#include <QVector>
+#include "emission_tracker.h"
+
+/* Default level over the noise floor that counts as a signal */
+#define SIGNAL_DETECTOR_THRESHOLD_DB   10.0f
+
+/* Percentile of the levels of a bin over time taken as its floor */
+#define SIGNAL_DETECTOR_PERCENTILE     0.3f
+
+/* Step of the floor tracker, and frames the floor is the mean level for
+ * before the tracker starts */
+#define SIGNAL_DETECTOR_FLOOR_STEP_DB  0.1f
+#define SIGNAL_DETECTOR_WARMUP_FRAMES  50
+
+/* Smoothing of the levels over frames */
+#define SIGNAL_DETECTOR_ALPHA          0.3f
+
+/* Cells the floor is reduced to for the CFAR window, the half width of
+ * the window in cells and the guard cells left out next to the cell */
+#define SIGNAL_DETECTOR_CFAR_CELLS     512
+#define SIGNAL_DETECTOR_CFAR_WINDOW    32
+#define SIGNAL_DETECTOR_CFAR_GUARD     2
+
+/* Frames between updates of the CFAR noise estimate */
+#define SIGNAL_DETECTOR_CFAR_FRAMES    16
+
+/* Bins below the threshold that still join two runs into one signal */
+#define SIGNAL_DETECTOR_GAP_BINS       2
+
+/* Frames a signal must be seen in before it is reported */
+#define SIGNAL_DETECTOR_CONFIRM_FRAMES 5
+
+/* Time a reported signal may be missing before it is closed */
+#define SIGNAL_DETECTOR_HOLD_MS        1000
+
+/* Fraction of the span at each edge left out, where the decimation
+ * filters roll off */
+#define SIGNAL_DETECTOR_EDGE           0.05
+
+/**
+ * Energy detector and segmenter for the IQ FFT frames.
+ *
+ * The noise floor of each bin is a running percentile of its level over
+ * time, so signals that come and go do not raise it. A carrier that is
+ * always on would end up in the floor of its own bins, so the floor is
+ * also compared with the floors around it, as in an ordered statistic
+ * CFAR over frequency: the noise of a bin is the smaller of its floor and
+ * the greater of the lower quartiles of the floors on either side of it.
+ *
+ * Runs of bins above noise + threshold are segmented into signals and
+ * followed from frame to frame by overlap. A signal is reported once seen
+ * in SIGNAL_DETECTOR_CONFIRM_FRAMES frames and closed when missing for
+ * SIGNAL_DETECTOR_HOLD_MS. A change of center frequency, rate or FFT size
+ * closes all signals and restarts the floor.
+ */
+class SignalDetector
+{
+public:
+    struct Detection {
+        SignalEvent event;      // range "detector", times in seconds since the epoch
+        float       level_db;   // level of the last frame at the peak
+        float       snr_db;     // peak level over the noise
+        int         frames;     // frames seen in
+    };
+
+    struct Update {
+        QVector<Detection> opened;  // reported in this frame
+        QVector<Detection> closed;  // closed in this frame, stop time set
+    };
+
+    SignalDetector();
+
+    void setIdAllocator(const std::function<qint64()> &allocate) { m_allocate = allocate; }
+    void setThreshold(float db) { m_threshold = db; }
+    float threshold() const { return m_threshold; }
+
+    void reset(Update &update);
+    bool process(const float *dB, int size, double centerFreq, double sampleRate,
+                 qint64 timeMs, Update &update);
+
+    QVector<Detection> active() const;
+    QString describe() const;
+
+private:
+    struct Track {
+        Detection det;
+        int       lo;           // bins of the last frame it was seen in
+        int       hi;
+        qint64    lastSeen;     // ms
+        bool      reported;
+    };
+
+    void updateNoise();
+
+    std::function<qint64()> m_allocate;
+    float  m_threshold;
+    double m_centerFreq;
+    double m_sampleRate;
+    int    m_frames;            // frames since the floor was restarted
+    qint64 m_nextId;            // used without an allocator
+    std::vector<float> m_level; // smoothed levels
+    std::vector<float> m_floor; // percentile of the levels over time
+    std::vector<float> m_noise; // noise estimate of the last CFAR update
+    QVector<Track> m_tracks;
+};
+
+#endif // SIGNAL_DETECTOR_H
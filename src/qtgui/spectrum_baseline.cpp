@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cmath>
+#include "spectrum_baseline.h"
+
+SpectrumBaseline::SpectrumBaseline() :
+    m_active(false),
+    m_frames(0),
+    m_centerFreq(0.0),
+    m_sampleRate(0.0),
+    m_seq(0),
+    m_changedBins(0)
+{
+}
+
+/** Average the next frames into a new baseline. */
+void SpectrumBaseline::capture()
+{
+    m_active = true;
+    m_frames = 0;
+    m_changedBins = 0;
+    m_baseline.clear();
+    m_ratio.clear();
+}
+
+void SpectrumBaseline::clear()
+{
+    m_active = false;
+    m_frames = 0;
+    m_changedBins = 0;
+    m_baseline.clear();
+    m_level.clear();
+    m_ratio.clear();
+    m_changed.clear();
+}
+
+/**
+ * Compare a frame with the baseline and update it.
+ * @param power Linear power spectrum with DC in the middle.
+ * @returns true if there is a baseline and ratio() is of this frame.
+ */
+bool SpectrumBaseline::process(const float *power, int size, double centerFreq,
+                               double sampleRate, uint64_t seq)
+{
+    if (!m_active || size <= 0)
+        return false;
+
+    if (size != (int)m_baseline.size() || centerFreq != m_centerFreq ||
+        sampleRate != m_sampleRate)
+    {
+        capture();
+        m_centerFreq = centerFreq;
+        m_sampleRate = sampleRate;
+        m_baseline.assign(size, 0.0f);
+        m_level.assign(power, power + size);
+        m_changed.assign(size, 0);
+    }
+
+    if (m_frames < SPECTRUM_BASELINE_CAPTURE_FRAMES)
+    {
+        const float w = 1.0f / (float)(m_frames + 1);
+        for (int i = 0; i < size; i++)
+            m_baseline[i] += w * (power[i] - m_baseline[i]);
+        m_level.assign(power, power + size);
+        m_frames++;
+        return false;
+    }
+
+    const float threshold = std::pow(10.0f, SPECTRUM_BASELINE_CHANGE_DB / 10.0f);
+    const float slow = SPECTRUM_BASELINE_ALPHA / SPECTRUM_BASELINE_CHANGED_SLOWER;
+    m_ratio.resize(size);
+    m_changedBins = 0;
+    for (int i = 0; i < size; i++)
+    {
+        const float base = std::max(m_baseline[i], 1e-20f);
+        m_level[i] += SPECTRUM_BASELINE_SMOOTH * (power[i] - m_level[i]);
+        m_ratio[i] = power[i] / base;
+
+        const bool changed = m_level[i] > threshold * base;
+        m_changed[i] = changed;
+        m_changedBins += changed;
+        m_baseline[i] += (changed ? slow : SPECTRUM_BASELINE_ALPHA) * (power[i] - m_baseline[i]);
+    }
+    m_seq = seq;
+    return true;
+}
+
+/** Whether a bin from freq - bandwidth / 2 to freq + bandwidth / 2 has changed. */
+bool SpectrumBaseline::changedAt(double freq, double bandwidth) const
+{
+    const int size = (int)m_changed.size();
+    if (!isValid() || size == 0 || m_sampleRate <= 0.0)
+        return false;
+
+    const double binHz = m_sampleRate / size;
+    const double first = m_centerFreq - m_sampleRate / 2.0;
+    const int lo = std::max(0, (int)std::floor((freq - bandwidth / 2.0 - first) / binHz));
+    const int hi = std::min(size - 1, (int)std::floor((freq + bandwidth / 2.0 - first) / binHz));
+    for (int i = lo; i <= hi; i++)
+        if (m_changed[i])
+            return true;
+    return false;
+}
@@ -0,0 +1,70 @@
+#ifndef SPECTRUM_BASELINE_H
+#define SPECTRUM_BASELINE_H
+
+#include <cstdint>
+#include <vector>
+
+/* Frames averaged into a new baseline */
+#define SPECTRUM_BASELINE_CAPTURE_FRAMES  100
+
+/* Step of the baseline towards the levels per frame, about a minute at 25 fps,
+ * and how many times slower it is in the bins that have changed */
+#define SPECTRUM_BASELINE_ALPHA           0.0007f
+#define SPECTRUM_BASELINE_CHANGED_SLOWER  20.0f
+
+/* Smoothing of the levels over frames before they are compared */
+#define SPECTRUM_BASELINE_SMOOTH          0.3f
+
+/* Level over the baseline that makes a bin changed */
+#define SPECTRUM_BASELINE_CHANGE_DB       6.0f
+
+/**
+ * Reference spectrum of a band at a quiet time, to see what is new.
+ *
+ * capture() averages the power of the next SPECTRUM_BASELINE_CAPTURE_FRAMES
+ * frames of each bin. After that every frame moves the baseline a little
+ * towards the levels, so that it follows slow changes of the noise and of
+ * the gain. In the bins that have changed it moves SPECTRUM_BASELINE_CHANGED_SLOWER
+ * times slower, so a new emission stands out for many minutes before it
+ * becomes part of the baseline.
+ *
+ * A bin has changed while its smoothed level is SPECTRUM_BASELINE_CHANGE_DB
+ * over the baseline. ratio() is the power of the last frame over the
+ * baseline, which the plotter draws as a difference in dB. A change of
+ * center frequency, rate or size starts a new capture.
+ */
+class SpectrumBaseline
+{
+public:
+    SpectrumBaseline();
+
+    void capture();
+    void clear();
+
+    bool isActive() const { return m_active; }
+    bool isValid() const { return m_active && m_frames >= SPECTRUM_BASELINE_CAPTURE_FRAMES; }
+
+    bool process(const float *power, int size, double centerFreq, double sampleRate,
+                 uint64_t seq);
+
+    // Of the last frame process() returned true for
+    uint64_t seq() const { return m_seq; }
+    const float *ratio() const { return m_ratio.data(); }
+    int size() const { return (int)m_ratio.size(); }
+    int changedBins() const { return m_changedBins; }
+    bool changedAt(double freq, double bandwidth) const;
+
+private:
+    bool   m_active;
+    int    m_frames;            // averaged into the baseline since capture()
+    double m_centerFreq;
+    double m_sampleRate;
+    uint64_t m_seq;
+    int    m_changedBins;
+    std::vector<float> m_baseline;  // linear power
+    std::vector<float> m_level;     // smoothed linear power
+    std::vector<float> m_ratio;
+    std::vector<uint8_t> m_changed;
+};
+
+#endif // SPECTRUM_BASELINE_H
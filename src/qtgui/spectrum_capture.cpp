@@ -1,17 +1,48 @@
 #include "spectrum_capture.h"
 #include "../applications/gqrx/receiver.h"
+#include "spectrum_levels.h"
 #include <QDebug>
 #include <QMetaType>
+#include <QDateTime>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+
+// A sweep fails if a step gets no usable frame for this long after settling
+#define SWEEP_STEP_TIMEOUT_MS 2000
+
+// A fast sweep falls back to estimated settling if no retune tag arrives in time
+#define SWEEP_TAG_TIMEOUT_MS  250
 
 SpectrumCapture::SpectrumCapture(receiver *rx, QObject *parent)
     : QObject(parent)
     , m_capturing(false)
     , m_rx(rx)
+    , m_nextJobId(1)
+    , m_sweepTimer(new QTimer(this))
+    , m_sweepStep(0)
+    , m_sweepFrames(0)
+    , m_sweepUsable(0)
+    , m_sweepCenter(0.0)
+    , m_sweepRestoreFreq(0.0)
+    , m_sweepNextSample(0)
+    , m_sweepSettle(0)
+    , m_sweepTuneCount(0)
+    , m_sweepWaitTag(false)
+    , m_sweepTagged(false)
+    , m_sweepTagDeadline(0)
+    , m_sweepDeadline(0)
 {
+    m_job = Job();
+    m_job.id = 0;
+
     // Register types for use in signals/slots
     qRegisterMetaType<CaptureRange>("SpectrumCapture::CaptureRange");
     qRegisterMetaType<CaptureResult>("SpectrumCapture::CaptureResult");
+    qRegisterMetaType<SweepResult>("SpectrumCapture::SweepResult");
+    qRegisterMetaType<SweepSegment>("SpectrumCapture::SweepSegment");
+
+    connect(m_sweepTimer, &QTimer::timeout, this, &SpectrumCapture::sweepPoll);
 
     if (!m_rx) {
         qDebug() << "SpectrumCapture: Warning - Null receiver pointer";
@@ -28,6 +59,9 @@ SpectrumCapture::CaptureResult SpectrumCapture::captureRange(const CaptureRange&
     CaptureResult result;
     result.range = range;
     result.success = false;
+    result.timestamp = 0.0;
+    result.sample_index = 0;
+    result.job_id = m_job.id;
 
     // Basic validation
     if (!m_rx) {
@@ -65,28 +99,182 @@ SpectrumCapture::CaptureResult SpectrumCapture::captureRange(const CaptureRange&
     try {
         result.fft_data = extractFftData();
         result.success = true;
-        result.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()
-        ).count() / 1000.0;
+        result.timestamp = std::chrono::duration<double>(
+            m_frame->timestamp.time_since_epoch()
+        ).count();
+        result.sample_index = m_frame->sample_index;
     }
     catch (const std::exception& e) {
         result.error_message = std::string("FFT data extraction failed: ") + e.what();
         result.success = false;
     }
 
+    if (result.success && m_recorder.isOpen()) {
+        SpectrumRowHeader row;
+        row.kind = SpectrumRowHeader::FRAME;
+        row.start_freq = m_frame->center_freq - m_frame->sample_rate / 2;
+        row.bin_hz = m_frame->sample_rate / (double)result.fft_data->size();
+        row.timestamp = result.timestamp;
+        row.sample_index = result.sample_index;
+        row.steps = 1;
+        recordRow(result.fft_data->data(), (int)result.fft_data->size(),
+                  (int)result.fft_data->size(), row);
+    }
+
+    m_frame.reset();
     m_capturing = false;
     emit captureComplete(result);
     return result;
 }
 
+/** Cancel the running job and drop the queued ones. */
 void SpectrumCapture::stop()
 {
-    if (m_capturing) {
-        m_capturing = false;
-        emit captureError("Capture stopped by user");
+    while (!m_queue.empty())
+        cancel(m_queue.back().id);
+
+    if (isSweeping())
+        finishSweep(false, "Capture stopped by user");
+}
+
+/**
+ * Append the results of all following captures and sweeps to a file.
+ * @param path File to create or append to, see spectrum_file.h.
+ * @param extra Added to the metadata of a new file, e.g. the device.
+ * @param format Level format of the rows.
+ *
+ * The metadata of a new file has the input rate and the gain stages.
+ */
+bool SpectrumCapture::startRecording(const QString& path, const QJsonObject& extra,
+                                     SpectrumRowHeader::Format format)
+{
+    QJsonObject meta = extra;
+    meta["created"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    if (m_rx) {
+        QJsonObject gains;
+        for (const auto& name : m_rx->get_gain_names())
+            gains[QString::fromStdString(name)] = m_rx->get_gain(name);
+        meta["input_rate"] = m_rx->get_input_rate();
+        meta["rf_freq"] = m_rx->get_rf_freq();
+        meta["gains"] = gains;
+    }
+
+    if (!m_recorder.open(path, meta, format)) {
+        emit captureError("Cannot open " + path.toStdString() + ": " +
+                          m_recorder.errorString().toStdString());
+        return false;
+    }
+    return true;
+}
+
+void SpectrumCapture::stopRecording()
+{
+    m_recorder.close();
+}
+
+/** Convert power to dBFS and append it as a row. */
+void SpectrumCapture::recordRow(const float *power, int bins, int fft_size, SpectrumRowHeader& row)
+{
+    SpectrumLevels levels;
+    levels.setFrame(power, bins, 0.0, 0.0, 0, fft_size);
+
+    row.bins = (uint32_t)bins;
+    row.fft_size = (uint32_t)fft_size;
+    if (!m_recorder.append(row, levels.dB())) {
+        qDebug() << "SpectrumCapture: recording failed:" << m_recorder.errorString();
+        m_recorder.close();
     }
 }
 
+/**
+ * Queue a single capture, see captureRange().
+ * @returns Job id, or -1 if the queue is full.
+ */
+int SpectrumCapture::queueCapture(const CaptureRange& range)
+{
+    Job job;
+    job.sweep = false;
+    job.range = range;
+    return queueJob(job);
+}
+
+/**
+ * Cancel a job.
+ * @returns false if the job has already finished.
+ *
+ * A queued job is removed; a running sweep stops at the next poll and
+ * retunes the receiver back. Both end with jobFinished(job_id, false).
+ */
+bool SpectrumCapture::cancel(int job_id)
+{
+    if (job_id <= 0)
+        return false;
+
+    if (job_id == m_job.id) {
+        if (isSweeping())
+            finishSweep(false, "Capture cancelled");
+        return true;
+    }
+
+    for (auto it = m_queue.begin(); it != m_queue.end(); ++it) {
+        if (it->id == job_id) {
+            m_queue.erase(it);
+            emit jobFinished(job_id, false);
+            return true;
+        }
+    }
+    return false;
+}
+
+int SpectrumCapture::queueJob(const Job& job)
+{
+    if ((int)m_queue.size() >= SPECTRUM_CAPTURE_MAX_QUEUE) {
+        emit captureError("Capture queue is full");
+        return -1;
+    }
+
+    m_queue.push_back(job);
+    m_queue.back().id = m_nextJobId++;
+    QTimer::singleShot(0, this, &SpectrumCapture::runNextJob);
+    return m_queue.back().id;
+}
+
+void SpectrumCapture::runNextJob()
+{
+    if (m_job.id != 0 || m_capturing || m_queue.empty())
+        return;
+
+    m_job = m_queue.front();
+    m_queue.pop_front();
+
+    if (m_job.sweep) {
+        if (!beginSweep(m_job.config))
+            jobDone(false);
+        return;
+    }
+
+    jobDone(captureRange(m_job.range).success);
+}
+
+void SpectrumCapture::setProgress(int percent)
+{
+    emit progressUpdate(percent);
+    if (m_job.id != 0)
+        emit jobProgress(m_job.id, percent);
+}
+
+/** End the running job and start the next one from the event loop. */
+void SpectrumCapture::jobDone(bool success)
+{
+    const int id = m_job.id;
+
+    m_job.id = 0;
+    if (id != 0)
+        emit jobFinished(id, success);
+    if (!m_queue.empty())
+        QTimer::singleShot(0, this, &SpectrumCapture::runNextJob);
+}
+
 double SpectrumCapture::getCurrentCenterFreq() const
 {
     return m_rx ? m_rx->get_rf_freq() : 0.0;
@@ -140,11 +328,13 @@ bool SpectrumCapture::prepareCaptureParameters(const CaptureRange& range)
         return false;
     }
 
-    m_fft_buffer.resize(fft_size);
-    
-    // Test FFT data access with proper error handling
+    // Use the frame the display is showing; only compute one if the
+    // FFT timer is not running or the frame is from an old FFT size
     try {
-        if (m_rx->get_iq_fft_data(m_fft_buffer.data()) < 0) {
+        m_frame = m_rx->get_iq_fft_frame();
+        if (!m_frame || m_frame->data.size() != fft_size)
+            m_frame = m_rx->publish_iq_fft_frame();
+        if (!m_frame) {
             qDebug() << "Failed to get FFT data";
             return false;
         }
@@ -158,11 +348,11 @@ bool SpectrumCapture::prepareCaptureParameters(const CaptureRange& range)
         return false;
     }
     
-    emit progressUpdate(50);  // Placeholder progress update
+    setProgress(50);  // Placeholder progress update
     return true;
 }
 
-std::vector<float> SpectrumCapture::extractFftData()
+SpectrumCapture::SpectrumBuffer SpectrumCapture::extractFftData()
 {
     // Phase 1A: Just get current FFT data
     // This will be expanded to handle specific ranges in later phases
@@ -171,11 +361,243 @@ std::vector<float> SpectrumCapture::extractFftData()
         throw std::runtime_error("Invalid FFT size");
     }
 
-    std::vector<float> data(fft_size);
-    if (!m_rx || m_rx->get_iq_fft_data(data.data()) < 0) {
+    if (!m_frame || m_frame->data.size() != fft_size) {
         throw std::runtime_error("Failed to get FFT data from receiver");
     }
-    
-    emit progressUpdate(100);
-    return data;
-} 
\ No newline at end of file
+
+    setProgress(100);
+    // Share the receiver's frame instead of copying its data
+    return SpectrumBuffer(m_frame, &m_frame->data);
+} 
+
+/**
+ * Queue a sweep. Runs from the event loop, emits sweepSegment() as each
+ * step completes and ends with sweepComplete().
+ * @returns Job id, or -1 if the parameters are invalid or the queue is
+ *          full; captureError() is emitted with the reason.
+ *
+ * Steps are placed so the kept bins of all steps lie on one grid of
+ * sample_rate / fft_size spacing starting at start_freq. After each
+ * retune, frames with samples from before settle_ms has passed are
+ * dropped, then `averages` frames without overlap are averaged. The DC
+ * bin of each step is replaced by the mean of its neighbours. The
+ * receiver is tuned back to its frequency when the sweep ends.
+ *
+ * Without tags the settle time has to cover the retune latency of the
+ * driver and the flow graph, because the retune is placed at the input
+ * position when set_rf_freq() is called. In fast mode the step waits for
+ * the rx_freq tag that sources like UHD put on the first sample at the new
+ * frequency, and drops exactly settle_ms after it, so settle_ms only needs
+ * to cover the PLL and a small value allows many hops per second. If the
+ * source sends no tag, the sweep continues as a normal one.
+ */
+int SpectrumCapture::startSweep(const SweepConfig& config)
+{
+    if (!m_rx || !config.isValid()) {
+        emit captureError(m_rx ? "Invalid sweep parameters" : "No receiver available");
+        return -1;
+    }
+
+    Job job;
+    job.sweep = true;
+    job.config = config;
+    return queueJob(job);
+}
+
+bool SpectrumCapture::beginSweep(const SweepConfig& config)
+{
+    std::string error_msg;
+    iq_fft_frame_sptr frame;
+
+    if (!(frame = m_rx->publish_iq_fft_frame()) || frame->data.size() < 4 ||
+        frame->sample_rate <= 0.0)
+        error_msg = "No FFT data from receiver";
+
+    if (!error_msg.empty()) {
+        emit captureError(error_msg);
+        return false;
+    }
+
+    const int fft_size = (int)frame->data.size();
+    const double bin_hz = frame->sample_rate / fft_size;
+    const int bins = (int)std::ceil((config.end_freq - config.start_freq) / bin_hz);
+
+    m_sweep = config;
+    m_sweepUsable = std::max(std::min((int)(fft_size * config.usable_fraction), fft_size), 1);
+    m_sweepResult = SweepResult();
+    m_sweepResult.success = false;
+    m_sweepPower = std::make_shared<std::vector<float>>(bins, 0.0f);
+    m_sweepMax = std::make_shared<std::vector<float>>(bins, 0.0f);
+    m_sweepResult.start_freq = config.start_freq;
+    m_sweepResult.bin_hz = bin_hz;
+    m_sweepResult.fft_size = fft_size;
+    m_sweepResult.steps = (bins + m_sweepUsable - 1) / m_sweepUsable;
+    m_sweepResult.timestamp = 0.0;
+    m_sweepResult.job_id = m_job.id;
+    m_sweepStep = 0;
+    m_sweepSettle = (uint64_t)(config.settle_ms * 1e-3 * frame->sample_rate);
+    m_sweepTagged = config.fast;
+    m_sweepRestoreFreq = m_rx->get_rf_freq();
+    m_capturing = true;
+
+    CaptureRange range;
+    range.start_freq = config.start_freq;
+    range.end_freq = config.end_freq;
+    range.fft_size = fft_size;
+    range.sample_rate = frame->sample_rate;
+    emit captureStarted(range);
+    setProgress(0);
+
+    // Poll about once per FFT frame of new samples
+    m_sweepTimer->setTimerType(config.fast ? Qt::PreciseTimer : Qt::CoarseTimer);
+    m_sweepTimer->start(std::max((int)(1000.0 / bin_hz), 1));
+    tuneSweepStep();
+    return true;
+}
+
+/** Retune for m_sweepStep and drop what was accumulated. */
+void SpectrumCapture::tuneSweepStep()
+{
+    const int fft_size = m_sweepResult.fft_size;
+    const int first = (fft_size - m_sweepUsable) / 2;   // first kept bin of a step
+
+    // Bin j of a step is at center + (j - fft_size / 2) * bin_hz
+    m_sweepCenter = m_sweepResult.start_freq +
+                    (double)(m_sweepStep * m_sweepUsable - first + fft_size / 2) * m_sweepResult.bin_hz;
+
+    uint64_t tune_index;
+    double tune_freq;
+    m_rx->get_iq_retune(tune_index, tune_freq, m_sweepTuneCount);
+    const uint64_t now = m_rx->get_iq_sample_count();
+
+    m_rx->set_rf_freq(m_sweepCenter);
+
+    m_sweepNextSample = now + m_sweepSettle + fft_size;
+    m_sweepWaitTag = m_sweepTagged;
+    m_sweepTagDeadline = QDateTime::currentMSecsSinceEpoch() + SWEEP_TAG_TIMEOUT_MS;
+    m_sweepAcc.assign(fft_size, 0.0);
+    m_sweepMaxAcc.assign(fft_size, 0.0f);
+    m_sweepFrames = 0;
+    m_sweepDeadline = QDateTime::currentMSecsSinceEpoch() + (qint64)m_sweep.settle_ms +
+                      SWEEP_STEP_TIMEOUT_MS;
+}
+
+void SpectrumCapture::sweepPoll()
+{
+    if (m_sweepWaitTag) {
+        uint64_t tune_index;
+        double tune_freq;
+        unsigned int count;
+        if (m_rx->get_iq_retune(tune_index, tune_freq, count) && count != m_sweepTuneCount) {
+            m_sweepNextSample = tune_index + m_sweepSettle + m_sweepResult.fft_size;
+            m_sweepWaitTag = false;
+        } else if (QDateTime::currentMSecsSinceEpoch() > m_sweepTagDeadline) {
+            qDebug() << "SpectrumCapture: no retune tags from the source, using the settle time";
+            m_sweepTagged = false;
+            m_sweepWaitTag = false;
+        } else {
+            return;
+        }
+    }
+
+    // Use the frame the display computed if it is recent enough
+    iq_fft_frame_sptr frame = m_rx->get_iq_fft_frame();
+    if (!frame || frame->sample_index < m_sweepNextSample || frame->center_freq != m_sweepCenter)
+        frame = m_rx->publish_iq_fft_frame();
+
+    if (!frame || (int)frame->data.size() != m_sweepResult.fft_size ||
+        frame->center_freq != m_sweepCenter || frame->sample_index < m_sweepNextSample)
+    {
+        if (QDateTime::currentMSecsSinceEpoch() > m_sweepDeadline)
+            finishSweep(false, frame && (int)frame->data.size() != m_sweepResult.fft_size ?
+                               "FFT size changed during sweep" : "No FFT data from receiver");
+        return;
+    }
+
+    for (int j = 0; j < m_sweepResult.fft_size; j++) {
+        m_sweepAcc[j] += frame->data[j];
+        m_sweepMaxAcc[j] = std::max(m_sweepMaxAcc[j], frame->data[j]);
+    }
+    m_sweepNextSample = frame->sample_index + m_sweepResult.fft_size;
+    m_sweepDeadline = QDateTime::currentMSecsSinceEpoch() + SWEEP_STEP_TIMEOUT_MS;
+    m_sweepResult.timestamp = std::chrono::duration<double>(
+        frame->timestamp.time_since_epoch()).count();
+
+    if (++m_sweepFrames < m_sweep.averages)
+        return;
+
+    storeSweepStep();
+    ++m_sweepStep;
+    setProgress(100 * m_sweepStep / m_sweepResult.steps);
+
+    if (m_sweepStep == m_sweepResult.steps)
+        finishSweep(true, std::string());
+    else
+        tuneSweepStep();
+}
+
+/** Copy the kept bins of the current step into the result, and emit them as a segment. */
+void SpectrumCapture::storeSweepStep()
+{
+    const int fft_size = m_sweepResult.fft_size;
+    const int first = (fft_size - m_sweepUsable) / 2;
+    const int dc = fft_size / 2;
+    const double scale = 1.0 / m_sweepFrames;
+    const int bins = (int)m_sweepPower->size();
+
+    m_sweepAcc[dc] = 0.5 * (m_sweepAcc[dc - 1] + m_sweepAcc[dc + 1]);
+    m_sweepMaxAcc[dc] = std::max(m_sweepMaxAcc[dc - 1], m_sweepMaxAcc[dc + 1]);
+
+    for (int j = first; j < first + m_sweepUsable; j++)
+    {
+        const int k = m_sweepStep * m_sweepUsable + j - first;
+        if (k >= bins)
+            break;
+        (*m_sweepPower)[k] = (float)(m_sweepAcc[j] * scale);
+        (*m_sweepMax)[k] = m_sweepMaxAcc[j];
+    }
+
+    const int begin = std::min(m_sweepStep * m_sweepUsable, bins);
+    const int end = std::min(begin + m_sweepUsable, bins);
+    SweepSegment segment;
+    segment.power = std::make_shared<std::vector<float>>(m_sweepPower->begin() + begin,
+                                                         m_sweepPower->begin() + end);
+    segment.start_freq = m_sweepResult.start_freq + begin * m_sweepResult.bin_hz;
+    segment.sweep_start = m_sweepResult.start_freq;
+    segment.sweep_end = m_sweepResult.start_freq + bins * m_sweepResult.bin_hz;
+    segment.bin_hz = m_sweepResult.bin_hz;
+    segment.fft_size = fft_size;
+    segment.step = m_sweepStep;
+    segment.steps = m_sweepResult.steps;
+    segment.job_id = m_sweepResult.job_id;
+    emit sweepSegment(segment);
+}
+
+void SpectrumCapture::finishSweep(bool success, const std::string& error_msg)
+{
+    m_sweepTimer->stop();
+    m_rx->set_rf_freq(m_sweepRestoreFreq);
+    m_capturing = false;
+
+    m_sweepResult.success = success;
+    m_sweepResult.error_message = error_msg;
+    if (success && m_recorder.isOpen()) {
+        SpectrumRowHeader row;
+        row.kind = SpectrumRowHeader::SWEEP;
+        row.start_freq = m_sweepResult.start_freq;
+        row.bin_hz = m_sweepResult.bin_hz;
+        row.timestamp = m_sweepResult.timestamp;
+        row.sample_index = 0;
+        row.steps = (uint32_t)m_sweepResult.steps;
+        recordRow(m_sweepPower->data(), (int)m_sweepPower->size(),
+                  m_sweepResult.fft_size, row);
+    }
+    m_sweepResult.power = std::move(m_sweepPower);
+    m_sweepResult.max_power = std::move(m_sweepMax);
+    m_sweepAcc.clear();
+    m_sweepMaxAcc.clear();
+    if (!success)
+        emit captureError(error_msg);
+    emit sweepComplete(m_sweepResult);
+    jobDone(success);
+}
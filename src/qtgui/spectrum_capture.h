@@ -1,24 +1,45 @@
 #ifndef SPECTRUM_CAPTURE_H
 #define SPECTRUM_CAPTURE_H
 
+#include <cstdint>
+#include <deque>
 #include <vector>
 #include <string>
 #include <memory>
 #include <QObject>
+#include <QTimer>
+#include "spectrum_file.h"
+
+// Largest number of jobs waiting behind the running one
+#define SPECTRUM_CAPTURE_MAX_QUEUE 8
 
 class receiver;  // Forward declaration of GQRX receiver class
+struct iq_fft_frame;
 
 /**
  * @brief The SpectrumCapture class handles capturing spectrum data for specific frequency ranges
  * 
  * This class provides functionality to capture FFT data from the receiver
  * for specified frequency ranges, independent of the UI display.
+ *
+ * Captures and sweeps can be queued as jobs. Jobs run one at a time from
+ * the event loop, so a sweep never blocks the GUI, and each gets an id
+ * that is passed back with its progress and result and can be used to
+ * cancel it. The receiver is only touched from the thread owning this
+ * object, because publishing an FFT frame calls the GUI subscribers.
  */
 class SpectrumCapture : public QObject
 {
     Q_OBJECT
 
 public:
+    /**
+     * Immutable spectrum shared by all receivers of a result. Results are
+     * passed through queued signals by value; this way only the pointer is
+     * copied, however many consumers there are.
+     */
+    typedef std::shared_ptr<const std::vector<float>> SpectrumBuffer;
+
     struct CaptureRange {
         double start_freq;  // Hz
         double end_freq;    // Hz
@@ -35,10 +56,59 @@ public:
 
     struct CaptureResult {
         bool success;
-        std::vector<float> fft_data;
+        SpectrumBuffer fft_data;  // Linear power, shares the receiver's frame
         CaptureRange range;
         std::string error_message;
-        double timestamp;  // Unix timestamp of capture
+        double timestamp;  // Unix time of the last sample in the frame
+        uint64_t sample_index;  // Sample after the frame, at the FFT input rate
+        int job_id;  // Job that made the capture, 0 for captureRange()
+    };
+
+    /**
+     * Sweep over a range wider than the receiver bandwidth, like rtl_power
+     * or hackrf_sweep: the receiver is retuned in steps, and the central
+     * part of each step is kept.
+     */
+    struct SweepConfig {
+        double start_freq;      // Hz
+        double end_freq;        // Hz
+        int averages;           // frames averaged per step
+        double settle_ms;       // data discarded after each retune
+        double usable_fraction; // central part of each step that is kept
+        bool fast;              // settle from the source's retune tags, see startSweep()
+
+        bool isValid() const {
+            return start_freq < end_freq &&
+                   averages > 0 &&
+                   settle_ms >= 0.0 &&
+                   usable_fraction > 0.0 && usable_fraction <= 1.0;
+        }
+    };
+
+    struct SweepResult {
+        bool success;
+        SpectrumBuffer power;       // Linear power, same scale as iq_fft_frame::data
+        SpectrumBuffer max_power;   // Max-hold of the frames of each step
+        double start_freq;          // Frequency of power[0]
+        double bin_hz;              // Bin spacing
+        int fft_size;               // FFT size of the steps, for the dBFS scale
+        int steps;
+        std::string error_message;
+        double timestamp;           // Unix time of the last frame
+        int job_id;
+    };
+
+    // Kept bins of one step of a sweep, emitted as the step completes
+    struct SweepSegment {
+        SpectrumBuffer power;       // Linear power, same scale as SweepResult::power
+        double start_freq;          // Frequency of power[0]
+        double sweep_start;         // Range of the whole sweep
+        double sweep_end;
+        double bin_hz;
+        int fft_size;
+        int step;
+        int steps;
+        int job_id;
     };
 
     explicit SpectrumCapture(receiver *rx, QObject *parent = nullptr);
@@ -47,7 +117,21 @@ public:
     // Core capture interface
     CaptureResult captureRange(const CaptureRange& range);
     bool isCapturing() const { return m_capturing; }
+    bool isSweeping() const { return m_sweepTimer->isActive(); }
+
+    // Jobs
+    int queueCapture(const CaptureRange& range);
+    int startSweep(const SweepConfig& config);
+    bool cancel(int job_id);
     void stop();
+    int currentJob() const { return m_job.id; }
+    int pendingJobs() const { return (int)m_queue.size(); }
+
+    // Recording of results to a spectrum file
+    bool startRecording(const QString& path, const QJsonObject& extra = QJsonObject(),
+                        SpectrumRowHeader::Format format = SpectrumRowHeader::FLOAT16);
+    void stopRecording();
+    bool isRecording() const { return m_recorder.isOpen(); }
 
     // Getters for current state
     double getCurrentCenterFreq() const;
@@ -59,22 +143,75 @@ signals:
     void captureComplete(const CaptureResult& result);
     void captureError(const std::string& error_message);
     void progressUpdate(int percent);
+    void sweepSegment(const SpectrumCapture::SweepSegment& segment);
+    void sweepComplete(const SpectrumCapture::SweepResult& result);
+    void jobProgress(int job_id, int percent);
+    void jobFinished(int job_id, bool success);
+
+private slots:
+    void sweepPoll();
+    void runNextJob();
 
 private:
     bool validateRange(const CaptureRange& range, std::string& error_msg);
     bool prepareCaptureParameters(const CaptureRange& range);
-    std::vector<float> extractFftData();
+    SpectrumBuffer extractFftData();
+    struct Job {
+        int id;             // 0 if no job
+        bool sweep;
+        CaptureRange range;
+        SweepConfig config;
+    };
+
+    int queueJob(const Job& job);
+    void setProgress(int percent);
+    void jobDone(bool success);
+    bool beginSweep(const SweepConfig& config);
+    void tuneSweepStep();
+    void storeSweepStep();
+    void finishSweep(bool success, const std::string& error_msg);
+    void recordRow(const float *power, int bins, int fft_size, SpectrumRowHeader& row);
 
     bool m_capturing;
     receiver *m_rx;  // Non-owning pointer to receiver
     
     // Current capture state
     CaptureRange m_current_range;
-    std::vector<float> m_fft_buffer;
+    std::shared_ptr<const iq_fft_frame> m_frame;  // Shared frame from the receiver
+
+    SpectrumFileWriter m_recorder;
+
+    // Jobs
+    std::deque<Job> m_queue;
+    Job m_job;                          // Running job
+    int m_nextJobId;
+
+    // Sweep state
+    QTimer *m_sweepTimer;
+    SweepConfig m_sweep;
+    SweepResult m_sweepResult;
+    std::shared_ptr<std::vector<float>> m_sweepPower;   // Filled, then handed out as m_sweepResult.power
+    std::shared_ptr<std::vector<float>> m_sweepMax;     // Same for m_sweepResult.max_power
+    std::vector<double> m_sweepAcc;     // Sum of the frames of the current step
+    std::vector<float> m_sweepMaxAcc;   // Max of the frames of the current step
+    int m_sweepStep;
+    int m_sweepFrames;                  // Frames in m_sweepAcc
+    int m_sweepUsable;                  // Bins kept per step
+    double m_sweepCenter;               // Center frequency of the current step
+    double m_sweepRestoreFreq;          // Frequency before the sweep
+    uint64_t m_sweepNextSample;         // First frame end accepted for the step
+    uint64_t m_sweepSettle;             // Settle time in samples
+    unsigned int m_sweepTuneCount;      // Retune tags seen before the current retune
+    bool m_sweepWaitTag;                // Waiting for the retune tag of the step
+    bool m_sweepTagged;                 // The source tags retunes
+    qint64 m_sweepTagDeadline;          // Stop waiting for tags after this
+    qint64 m_sweepDeadline;             // Give up if no frame is accepted by then
 };
 
 // Register types with Qt's meta-object system
 Q_DECLARE_METATYPE(SpectrumCapture::CaptureRange)
 Q_DECLARE_METATYPE(SpectrumCapture::CaptureResult)
+Q_DECLARE_METATYPE(SpectrumCapture::SweepResult)
+Q_DECLARE_METATYPE(SpectrumCapture::SweepSegment)
 
 #endif // SPECTRUM_CAPTURE_H 
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "spectrum_file.h"
+#include <QJsonDocument>
+#include <qfloat16.h>
+#include <cstring>
+
+static inline uint32_t pad8(uint32_t size)
+{
+    return (size + 7u) & ~7u;
+}
+
+SpectrumFileWriter::SpectrumFileWriter()
+    : m_format(SpectrumRowHeader::FLOAT16)
+{
+}
+
+SpectrumFileWriter::~SpectrumFileWriter()
+{
+    close();
+}
+
+/**
+ * Create a file, or append to an existing one.
+ * @param meta Written to a new file, ignored when appending.
+ * @param format Format of the rows written from now on.
+ */
+bool SpectrumFileWriter::open(const QString &path, const QJsonObject &meta,
+                              SpectrumRowHeader::Format format)
+{
+    close();
+
+    m_format = (uint16_t)format;
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Append))
+        return false;
+
+    if (m_file.size() > 0)
+        return true;
+
+    const QByteArray json = QJsonDocument(meta).toJson(QJsonDocument::Compact);
+
+    SpectrumFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SPECTRUM_FILE_MAGIC, sizeof(header.magic));
+    header.version = SPECTRUM_FILE_VERSION;
+    header.meta_size = (uint32_t)json.size();
+    header.header_size = (uint32_t)sizeof(header) + pad8(header.meta_size);
+    header.byte_order = SPECTRUM_FILE_BYTE_ORDER;
+
+    QByteArray block((const char *)&header, sizeof(header));
+    block.append(json);
+    block.append(QByteArray((int)(header.header_size - block.size()), '\0'));
+    if (m_file.write(block) != block.size())
+    {
+        m_file.close();
+        return false;
+    }
+    m_file.flush();
+    return true;
+}
+
+void SpectrumFileWriter::close()
+{
+    if (m_file.isOpen())
+        m_file.close();
+}
+
+/**
+ * Append a row.
+ * @param row Frequency axis and time; magic, format and data_size are
+ *            filled in here.
+ * @param dB row.bins levels in dBFS.
+ *
+ * The row is written with one write and flushed, so it survives a crash
+ * and readers see it in one piece.
+ */
+bool SpectrumFileWriter::append(const SpectrumRowHeader &row, const float *dB)
+{
+    if (!m_file.isOpen() || row.bins == 0)
+        return false;
+
+    const uint32_t sample = m_format == SpectrumRowHeader::FLOAT16 ? 2 : 4;
+    SpectrumRowHeader header = row;
+    header.magic = SPECTRUM_ROW_MAGIC;
+    header.format = m_format;
+    header.data_size = pad8(row.bins * sample);
+
+    m_buffer.assign(sizeof(header) + header.data_size, 0);
+    memcpy(m_buffer.data(), &header, sizeof(header));
+    char *data = m_buffer.data() + sizeof(header);
+    if (m_format == SpectrumRowHeader::FLOAT16)
+    {
+        qfloat16 *dst = (qfloat16 *)data;
+        for (uint32_t i = 0; i < row.bins; i++)
+            dst[i] = qfloat16(dB[i]);
+    }
+    else
+    {
+        memcpy(data, dB, row.bins * sizeof(float));
+    }
+
+    if (m_file.write(m_buffer.data(), (qint64)m_buffer.size()) != (qint64)m_buffer.size())
+        return false;
+    return m_file.flush();
+}
+
+SpectrumFileReader::SpectrumFileReader()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_scanned(0)
+{
+}
+
+SpectrumFileReader::~SpectrumFileReader()
+{
+    close();
+}
+
+bool SpectrumFileReader::open(const QString &path)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly) || !map())
+    {
+        close();
+        return false;
+    }
+
+    SpectrumFileHeader header;
+    if (m_size < (qint64)sizeof(header))
+    {
+        close();
+        return false;
+    }
+    memcpy(&header, m_data, sizeof(header));
+    if (memcmp(header.magic, SPECTRUM_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SPECTRUM_FILE_VERSION ||
+        header.byte_order != SPECTRUM_FILE_BYTE_ORDER ||
+        header.header_size < sizeof(header) + header.meta_size ||
+        (qint64)header.header_size > m_size)
+    {
+        close();
+        return false;
+    }
+
+    m_meta = QJsonDocument::fromJson(QByteArray((const char *)m_data + sizeof(header),
+                                                (int)header.meta_size)).object();
+    m_scanned = header.header_size;
+    return refresh();
+}
+
+void SpectrumFileReader::close()
+{
+    if (m_data)
+        m_file.unmap((uchar *)m_data);
+    if (m_file.isOpen())
+        m_file.close();
+    m_data = nullptr;
+    m_size = 0;
+    m_scanned = 0;
+    m_meta = QJsonObject();
+    m_rows.clear();
+}
+
+bool SpectrumFileReader::map()
+{
+    const qint64 size = m_file.size();
+    if (m_data && size == m_size)
+        return true;
+
+    if (m_data)
+        m_file.unmap((uchar *)m_data);
+    m_data = size > 0 ? m_file.map(0, size) : nullptr;
+    m_size = m_data ? size : 0;
+    return m_data != nullptr;
+}
+
+/**
+ * Pick up rows appended since the last call.
+ * @returns false if the file is not open or cannot be mapped.
+ */
+bool SpectrumFileReader::refresh()
+{
+    if (!m_file.isOpen() || !map())
+        return false;
+
+    while (m_scanned + (qint64)sizeof(SpectrumRowHeader) <= m_size)
+    {
+        SpectrumRowHeader header;
+        memcpy(&header, m_data + m_scanned, sizeof(header));
+        if (header.magic != SPECTRUM_ROW_MAGIC)
+            break;
+
+        const qint64 end = m_scanned + (qint64)sizeof(header) + header.data_size;
+        if (end > m_size)
+            break;
+
+        m_rows.push_back(m_scanned);
+        m_scanned = end;
+    }
+    return true;
+}
+
+const SpectrumRowHeader &SpectrumFileReader::row(int index) const
+{
+    return *(const SpectrumRowHeader *)(m_data + m_rows[index]);
+}
+
+/** Raw levels of a row, in the format given by its header. */
+const void *SpectrumFileReader::rowData(int index) const
+{
+    return m_data + m_rows[index] + sizeof(SpectrumRowHeader);
+}
+
+/**
+ * Get the levels of a row.
+ * @param dB row(index).bins levels in dBFS (output).
+ */
+bool SpectrumFileReader::levels(int index, float *dB) const
+{
+    if (index < 0 || index >= rows())
+        return false;
+
+    const SpectrumRowHeader &header = row(index);
+    if (header.format == SpectrumRowHeader::FLOAT16)
+    {
+        const qfloat16 *src = (const qfloat16 *)rowData(index);
+        for (uint32_t i = 0; i < header.bins; i++)
+            dB[i] = (float)src[i];
+    }
+    else if (header.format == SpectrumRowHeader::FLOAT32)
+    {
+        memcpy(dB, rowData(index), header.bins * sizeof(float));
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
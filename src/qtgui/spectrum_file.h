@@ -0,0 +1,113 @@
+#ifndef SPECTRUM_FILE_H
+#define SPECTRUM_FILE_H
+
+#include <cstdint>
+#include <vector>
+#include <QFile>
+#include <QJsonObject>
+#include <QString>
+
+/*
+ * Spectrum capture file
+ *
+ * A SpectrumFileHeader, UTF-8 JSON metadata (device, rate, gains, ...)
+ * padded to 8 bytes, then any number of rows. Each row is a
+ * SpectrumRowHeader followed by data_size bytes of levels in dBFS, as
+ * float32 or float16, padded to 8 bytes. Every row has its own frequency
+ * axis, so single frames and sweeps can be mixed.
+ *
+ * Rows are only appended, and a reader ignores a row that is not
+ * complete, so a file can be read while it is being written. Fields are
+ * in the byte order of the writer, see byte_order.
+ */
+#define SPECTRUM_FILE_MAGIC      "AGSPEC01"
+#define SPECTRUM_FILE_VERSION    1
+#define SPECTRUM_FILE_BYTE_ORDER 0x01020304u
+#define SPECTRUM_ROW_MAGIC       0x574f5253u   // "SROW"
+
+struct SpectrumFileHeader {
+    char     magic[8];      // SPECTRUM_FILE_MAGIC
+    uint32_t version;
+    uint32_t header_size;   // offset of the first row
+    uint32_t meta_size;     // bytes of JSON after this header
+    uint32_t byte_order;    // SPECTRUM_FILE_BYTE_ORDER as written
+    uint64_t reserved;
+};
+
+struct SpectrumRowHeader {
+    enum Format { FLOAT32 = 0, FLOAT16 = 1 };
+    // Levels are dBFS, except for OCCUPANCY rows, which hold the percentage
+    // of survey visits a bin was occupied in
+    enum Kind { FRAME = 0, SWEEP = 1, SURVEY_AVG = 2, SURVEY_MAX = 3, OCCUPANCY = 4 };
+
+    uint32_t magic;         // SPECTRUM_ROW_MAGIC
+    uint16_t format;        // Format
+    uint16_t kind;          // Kind
+    uint32_t bins;
+    uint32_t fft_size;      // FFT size the levels were computed with
+    double   start_freq;    // Hz, frequency of the first bin
+    double   bin_hz;        // bin spacing
+    double   timestamp;     // Unix time of the last sample
+    uint64_t sample_index;  // sample after the frame, 0 for sweeps
+    uint32_t steps;         // retune steps of a sweep, 1 for a frame
+    uint32_t data_size;     // bytes of level data including padding
+};
+
+static_assert(sizeof(SpectrumFileHeader) == 32, "SpectrumFileHeader layout");
+static_assert(sizeof(SpectrumRowHeader) == 56, "SpectrumRowHeader layout");
+
+/** Append rows to a spectrum capture file. */
+class SpectrumFileWriter
+{
+public:
+    SpectrumFileWriter();
+    ~SpectrumFileWriter();
+
+    bool open(const QString &path, const QJsonObject &meta,
+              SpectrumRowHeader::Format format = SpectrumRowHeader::FLOAT16);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    QString errorString() const { return m_file.errorString(); }
+
+    bool append(const SpectrumRowHeader &row, const float *dB);
+
+private:
+    QFile                  m_file;
+    uint16_t               m_format;
+    std::vector<char>      m_buffer;    // Row being written
+};
+
+/**
+ * Read a spectrum capture file through a memory map.
+ *
+ * Only the row headers are touched when the file is opened, so a long
+ * survey can be browsed without loading it into memory.
+ */
+class SpectrumFileReader
+{
+public:
+    SpectrumFileReader();
+    ~SpectrumFileReader();
+
+    bool open(const QString &path);
+    void close();
+    bool refresh();
+
+    QJsonObject metadata() const { return m_meta; }
+    int rows() const { return (int)m_rows.size(); }
+    const SpectrumRowHeader &row(int index) const;
+    const void *rowData(int index) const;
+    bool levels(int index, float *dB) const;
+
+private:
+    bool map();
+
+    QFile                  m_file;
+    const uchar           *m_data;
+    qint64                 m_size;
+    qint64                 m_scanned;   // End of the last complete row
+    QJsonObject            m_meta;
+    std::vector<qint64>    m_rows;      // Offset of each row header
+};
+
+#endif // SPECTRUM_FILE_H
@@ -0,0 +1,54 @@
+#include "spectrum_levels.h"
+#include <algorithm>
+#include <cmath>
+
+SpectrumLevels::SpectrumLevels()
+    : m_centerFreq(0.0)
+    , m_sampleRate(0.0)
+    , m_seq(0)
+    , m_valid(false)
+{
+}
+
+/**
+ * Convert a frame.
+ * @param data Linear power spectrum with DC in the middle.
+ * @param size Number of bins.
+ * @param seq Frame number, a frame that is already converted is skipped.
+ * @param fftSize FFT size for the dBFS scale, if the data is not one FFT
+ *                frame (a stitched sweep), else 0.
+ * @returns false if the frame was already converted or is empty.
+ */
+bool SpectrumLevels::setFrame(const float *data, int size, double centerFreq,
+                              double sampleRate, uint64_t seq, int fftSize)
+{
+    if (size <= 0 || (m_valid && seq == m_seq && size == (int)m_dB.size()))
+        return false;
+
+    const float n = (float)(fftSize > 0 ? fftSize : size);
+    const float scale = 1.0f / (n * n);
+    m_dB.resize(size);
+    for (int i = 0; i < size; i++)
+        m_dB[i] = 10.0f * log10f(std::max(data[i] * scale, 1e-20f));
+
+    m_centerFreq = centerFreq;
+    m_sampleRate = sampleRate;
+    m_seq = seq;
+    m_valid = true;
+    return true;
+}
+
+/**
+ * Reduce the levels to width columns by max, so narrow carriers stay
+ * visible. width must not be larger than size().
+ */
+void SpectrumLevels::reduce(int width, float *out) const
+{
+    const int n = (int)m_dB.size();
+    for (int x = 0; x < width; x++)
+    {
+        const int b0 = (int)((int64_t)x * n / width);
+        const int b1 = std::max((int)((int64_t)(x + 1) * n / width), b0 + 1);
+        out[x] = *std::max_element(m_dB.begin() + b0, m_dB.begin() + b1);
+    }
+}
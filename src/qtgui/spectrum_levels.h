@@ -0,0 +1,39 @@
+#ifndef SPECTRUM_LEVELS_H
+#define SPECTRUM_LEVELS_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * The current IQ FFT frame in dBFS, shared by the sigint views.
+ *
+ * Frames from receiver::subscribe_iq_fft() hold linear power. Each frame
+ * is converted to dBFS (1/N² as in CPlotter) once, here, and every view
+ * reduces the levels to its own width with reduce(). The max of dB levels
+ * is the dB of the max power, so that gives the same result as reducing
+ * the power first.
+ */
+class SpectrumLevels
+{
+public:
+    SpectrumLevels();
+
+    bool setFrame(const float *data, int size, double centerFreq, double sampleRate,
+                  uint64_t seq, int fftSize = 0);
+    void reduce(int width, float *out) const;
+
+    int size() const { return (int)m_dB.size(); }
+    const float *dB() const { return m_dB.data(); }
+    double centerFreq() const { return m_centerFreq; }
+    double sampleRate() const { return m_sampleRate; }
+    uint64_t seq() const { return m_seq; }
+
+private:
+    std::vector<float> m_dB;
+    double   m_centerFreq;
+    double   m_sampleRate;
+    uint64_t m_seq;
+    bool     m_valid;
+};
+
+#endif // SPECTRUM_LEVELS_H
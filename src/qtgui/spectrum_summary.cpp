@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cmath>
+#include <QJsonArray>
+#include "spectrum_summary.h"
+
+static const int percentileRanks[4] = { 10, 50, 90, 99 };
+
+/* Round to 0.1 for the JSON output */
+static double round1(double v)
+{
+    return std::round(v * 10.0) / 10.0;
+}
+
+SpectrumSummary::SpectrumSummary() :
+    m_startFreq(0.0),
+    m_hzPerPixel(0.0),
+    m_width(0),
+    m_rows(0),
+    m_spanMs(0),
+    m_noiseFloor(0.0f),
+    m_maxDb(0.0f),
+    m_percentiles{0.0f, 0.0f, 0.0f, 0.0f},
+    m_occupancy(0.0f)
+{
+}
+
+/**
+ * Compute the summary.
+ * @param dB Levels in dBFS, rows lines of width columns, NaN where there is no data.
+ * @param width Number of columns.
+ * @param rows Number of lines.
+ * @param startFreq Absolute frequency of column 0.
+ * @param hzPerPixel Width of a column in Hz.
+ * @param spanMs Time covered by the lines, for the output only.
+ * @returns false if there are no valid levels.
+ */
+bool SpectrumSummary::compute(const float *dB, int width, int rows, double startFreq,
+                              double hzPerPixel, uint64_t spanMs)
+{
+    m_startFreq = startFreq;
+    m_hzPerPixel = hzPerPixel;
+    m_width = width;
+    m_rows = rows;
+    m_spanMs = spanMs;
+    m_peaks.clear();
+
+    if (width <= 0 || rows <= 0)
+        return false;
+
+    // Mean of each column over the lines, and all valid levels
+    std::vector<float> mean(width, 0.0f);
+    std::vector<int> count(width, 0);
+    std::vector<float> all;
+    all.reserve((size_t)width * rows);
+    for (int r = 0; r < rows; r++)
+    {
+        const float *line = dB + (size_t)r * width;
+        for (int x = 0; x < width; x++)
+        {
+            if (std::isnan(line[x]))
+                continue;
+            mean[x] += line[x];
+            count[x]++;
+            all.push_back(line[x]);
+        }
+    }
+    if (all.empty())
+        return false;
+
+    std::vector<int> columns;
+    std::vector<float> valid;
+    for (int x = 0; x < width; x++)
+    {
+        if (count[x] == 0)
+            continue;
+        mean[x] /= (float)count[x];
+        columns.push_back(x);
+        valid.push_back(mean[x]);
+    }
+
+    std::nth_element(valid.begin(), valid.begin() + valid.size() / 2, valid.end());
+    m_noiseFloor = valid[valid.size() / 2];
+
+    std::sort(all.begin(), all.end());
+    for (int k = 0; k < 4; k++)
+        m_percentiles[k] = all[std::min(all.size() * percentileRanks[k] / 100, all.size() - 1)];
+    m_maxDb = all.back();
+
+    const float occupied = m_noiseFloor + SPECTRUM_SUMMARY_OCCUPIED_DB;
+    m_occupancy = (float)(all.end() - std::upper_bound(all.begin(), all.end(), occupied)) /
+                  (float)all.size();
+
+    // Local maxima of the mean spectrum, well above the noise floor
+    const float minLevel = m_noiseFloor + SPECTRUM_SUMMARY_PEAK_SNR;
+    for (size_t k = 0; k < columns.size(); k++)
+    {
+        const int x = columns[k];
+        const float level = mean[x];
+        if (level < minLevel)
+            continue;
+        if (k > 0 && mean[columns[k - 1]] > level)
+            continue;
+        if (k + 1 < columns.size() && mean[columns[k + 1]] > level)
+            continue;
+
+        size_t lo = k, hi = k;
+        while (lo > 0 && mean[columns[lo - 1]] > level - SPECTRUM_SUMMARY_BW_DB)
+            lo--;
+        while (hi + 1 < columns.size() && mean[columns[hi + 1]] > level - SPECTRUM_SUMMARY_BW_DB)
+            hi++;
+
+        int hits = 0;
+        for (int r = 0; r < rows; r++)
+        {
+            const float v = dB[(size_t)r * width + x];
+            if (!std::isnan(v) && v > occupied)
+                hits++;
+        }
+
+        Peak peak;
+        peak.freq = startFreq + ((double)x + 0.5) * hzPerPixel;
+        peak.level_db = level;
+        peak.snr_db = level - m_noiseFloor;
+        peak.bandwidth = (double)(columns[hi] - columns[lo] + 1) * hzPerPixel;
+        peak.occupancy = (float)hits / (float)rows;
+        m_peaks.push_back(peak);
+
+        // A flat top gives one peak
+        k = hi;
+    }
+
+    std::sort(m_peaks.begin(), m_peaks.end(), [](const Peak &a, const Peak &b) {
+        return a.snr_db > b.snr_db;
+    });
+    if (m_peaks.size() > SPECTRUM_SUMMARY_MAX_PEAKS)
+        m_peaks.resize(SPECTRUM_SUMMARY_MAX_PEAKS);
+    std::sort(m_peaks.begin(), m_peaks.end(), [](const Peak &a, const Peak &b) {
+        return a.freq < b.freq;
+    });
+
+    return true;
+}
+
+/**
+ * Coarse description of the summary, used as a key of the analysis cache.
+ * @param freqStep Resolution of the peak frequencies in Hz.
+ *
+ * Levels are rounded to SPECTRUM_SUMMARY_FINGERPRINT_DB and bandwidths to
+ * powers of two, so captures of the same signals under similar conditions
+ * give the same string.
+ */
+QString SpectrumSummary::fingerprint(double freqStep) const
+{
+    QString text = QString("nf%1 occ%2")
+                   .arg(std::lround(m_noiseFloor / SPECTRUM_SUMMARY_FINGERPRINT_DB))
+                   .arg(std::lround(m_occupancy * 10.0f));
+    for (const Peak &peak : m_peaks)
+        text += QString(" %1:%2:%3")
+                .arg(std::llround(peak.freq / freqStep))
+                .arg(std::lround(peak.snr_db / SPECTRUM_SUMMARY_FINGERPRINT_DB))
+                .arg(std::lround(std::log2(std::max(peak.bandwidth, 1.0))));
+    return text;
+}
+
+QJsonObject SpectrumSummary::toJson() const
+{
+    QJsonObject percentiles;
+    for (int k = 0; k < 4; k++)
+        percentiles[QString("p%1").arg(percentileRanks[k])] = round1(m_percentiles[k]);
+
+    QJsonArray peaks;
+    for (const Peak &peak : m_peaks)
+    {
+        peaks.append(QJsonObject{
+            {"freq_hz", std::round(peak.freq)},
+            {"level_db", round1(peak.level_db)},
+            {"snr_db", round1(peak.snr_db)},
+            {"bandwidth_hz", std::round(peak.bandwidth)},
+            {"occupancy", std::round(peak.occupancy * 100.0f) / 100.0}
+        });
+    }
+
+    return QJsonObject{
+        {"start_freq_hz", std::round(m_startFreq)},
+        {"end_freq_hz", std::round(m_startFreq + m_hzPerPixel * m_width)},
+        {"bin_hz", round1(m_hzPerPixel)},
+        {"lines", m_rows},
+        {"duration_s", round1((double)m_spanMs / 1000.0)},
+        {"noise_floor_db", round1(m_noiseFloor)},
+        {"max_db", round1(m_maxDb)},
+        {"percentiles_db", percentiles},
+        {"occupancy", std::round(m_occupancy * 1000.0f) / 1000.0},
+        {"peaks", peaks}
+    };
+}
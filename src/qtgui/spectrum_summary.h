@@ -0,0 +1,71 @@
+#ifndef SPECTRUM_SUMMARY_H
+#define SPECTRUM_SUMMARY_H
+
+#include <cstdint>
+#include <vector>
+#include <QJsonObject>
+#include <QString>
+
+/* A peak must be this far above the noise floor */
+#define SPECTRUM_SUMMARY_PEAK_SNR     10.0f
+
+/* Bandwidth of a peak is measured this far below its level */
+#define SPECTRUM_SUMMARY_BW_DB         6.0f
+
+/* A level this far above the noise floor counts as occupied */
+#define SPECTRUM_SUMMARY_OCCUPIED_DB   6.0f
+
+/* Strongest peaks kept in a summary */
+#define SPECTRUM_SUMMARY_MAX_PEAKS    16
+
+/* Resolution of the levels in a fingerprint */
+#define SPECTRUM_SUMMARY_FINGERPRINT_DB 6.0f
+
+/**
+ * Compact numeric description of a piece of spectrum.
+ *
+ * Computed from waterfall lines in dBFS, for example from
+ * CWaterfallSnapshot::levels(), and sent to Claude as JSON in place of, or
+ * next to, a waterfall image. A few hundred bytes of text describe the
+ * noise floor, the level distribution, the occupancy and the carriers,
+ * where a PNG takes tens of kilobytes of base64.
+ *
+ * The noise floor is the median of the mean spectrum, as in the survey.
+ */
+class SpectrumSummary
+{
+public:
+    struct Peak {
+        double freq;        // absolute frequency in Hz
+        float  level_db;    // mean level
+        float  snr_db;      // level above the noise floor
+        double bandwidth;   // width in Hz SPECTRUM_SUMMARY_BW_DB below the level
+        float  occupancy;   // fraction of lines the peak is occupied in
+    };
+
+    SpectrumSummary();
+
+    bool compute(const float *dB, int width, int rows, double startFreq, double hzPerPixel,
+                 uint64_t spanMs = 0);
+
+    float noiseFloor() const { return m_noiseFloor; }
+    float occupancy() const { return m_occupancy; }
+    const std::vector<Peak> &peaks() const { return m_peaks; }
+
+    QJsonObject toJson() const;
+    QString fingerprint(double freqStep) const;
+
+private:
+    double   m_startFreq;
+    double   m_hzPerPixel;
+    int      m_width;
+    int      m_rows;
+    uint64_t m_spanMs;
+    float    m_noiseFloor;
+    float    m_maxDb;
+    float    m_percentiles[4];  // 10, 50, 90 and 99 %
+    float    m_occupancy;       // fraction of occupied levels
+    std::vector<Peak> m_peaks;
+};
+
+#endif // SPECTRUM_SUMMARY_H
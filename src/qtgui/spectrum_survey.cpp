@@ -0,0 +1,336 @@
+#include "spectrum_survey.h"
+#include "spectrum_levels.h"
+#include "../applications/gqrx/receiver.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// An in place visit is dropped if no frame arrives for this long
+#define SURVEY_FRAME_TIMEOUT_MS 5000
+
+SpectrumSurvey::SpectrumSurvey(receiver *rx, SpectrumCapture *capture, QObject *parent)
+    : QObject(parent)
+    , m_rx(rx)
+    , m_capture(capture)
+    , m_active(-1)
+    , m_sweepJob(-1)
+    , m_frames(0)
+    , m_nextSample(0)
+    , m_center(0.0)
+    , m_rate(0.0)
+    , m_timestamp(0.0)
+    , m_deadline(0)
+{
+    qRegisterMetaType<Visit>("SpectrumSurvey::Visit");
+
+    m_tick.setInterval(1000);
+    connect(&m_tick, &QTimer::timeout, this, &SpectrumSurvey::tick);
+    connect(&m_collectTimer, &QTimer::timeout, this, &SpectrumSurvey::collect);
+    if (m_capture)
+        connect(m_capture, &SpectrumCapture::sweepComplete, this, &SpectrumSurvey::onSweepComplete);
+}
+
+SpectrumSurvey::~SpectrumSurvey()
+{
+    stop();
+}
+
+/** Add a range, due at once. @returns Its index in ranges(). */
+int SpectrumSurvey::addRange(const Range& range)
+{
+    m_ranges.push_back(range);
+    m_state.push_back({0, 0, {}});
+    return (int)m_ranges.size() - 1;
+}
+
+void SpectrumSurvey::clearRanges()
+{
+    const bool running = isRunning();
+    stop();
+    m_ranges.clear();
+    m_state.clear();
+    if (running)
+        m_tick.start();
+}
+
+/**
+ * Append the results to a spectrum file.
+ * @param path File to create or append to, empty to stop writing.
+ */
+bool SpectrumSurvey::setFile(const QString& path)
+{
+    m_file.close();
+    if (path.isEmpty())
+        return true;
+
+    QJsonArray ranges;
+    for (const Range& range : m_ranges) {
+        QJsonObject obj;
+        obj["name"] = range.name;
+        obj["start_freq"] = range.start_freq;
+        obj["end_freq"] = range.end_freq;
+        obj["interval_s"] = range.interval_s;
+        obj["averages"] = range.averages;
+        obj["threshold_db"] = range.threshold_db;
+        ranges.append(obj);
+    }
+
+    QJsonObject meta;
+    meta["type"] = "survey";
+    meta["created"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    meta["ranges"] = ranges;
+    if (!m_file.open(path, meta)) {
+        qDebug() << "SpectrumSurvey: cannot open" << path << m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void SpectrumSurvey::start()
+{
+    if (!m_rx || isRunning())
+        return;
+    m_tick.start();
+    tick();
+}
+
+void SpectrumSurvey::stop()
+{
+    m_tick.stop();
+    m_collectTimer.stop();
+    if (m_sweepJob > 0 && m_capture)
+        m_capture->cancel(m_sweepJob);
+    m_sweepJob = -1;
+    m_active = -1;
+}
+
+/** True if the range lies inside the part of the live spectrum that is kept. */
+bool SpectrumSurvey::fitsInBand(const Range& range) const
+{
+    iq_fft_frame_sptr frame = m_rx->get_iq_fft_frame();
+    if (!frame)
+        return false;
+
+    const double half = frame->sample_rate / 2 * SURVEY_USABLE_FRACTION;
+    return range.start_freq >= frame->center_freq - half &&
+           range.end_freq <= frame->center_freq + half;
+}
+
+/** Start the most overdue range that can be visited now. */
+void SpectrumSurvey::tick()
+{
+    if (m_active >= 0)
+        return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    int best = -1;
+    for (int i = 0; i < (int)m_ranges.size(); i++) {
+        if (m_state[i].next_ms > now)
+            continue;
+        if (!fitsInBand(m_ranges[i]) &&
+            (!m_ranges[i].allow_retune || !m_capture || m_capture->isCapturing()))
+            continue;
+        if (best < 0 || m_state[i].next_ms < m_state[best].next_ms)
+            best = i;
+    }
+
+    if (best >= 0)
+        startVisit(best);
+}
+
+void SpectrumSurvey::startVisit(int index)
+{
+    const Range& range = m_ranges[index];
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    m_active = index;
+    m_state[index].next_ms = now + (qint64)range.interval_s * 1000;
+
+    if (fitsInBand(range)) {
+        iq_fft_frame_sptr frame = m_rx->get_iq_fft_frame();
+        m_sweepJob = -1;
+        m_frames = 0;
+        m_nextSample = 0;
+        m_deadline = now + SURVEY_FRAME_TIMEOUT_MS;
+        m_collectTimer.start(std::max((int)(1000.0 * frame->data.size() / frame->sample_rate), 5));
+        return;
+    }
+
+    SpectrumCapture::SweepConfig config;
+    config.start_freq = range.start_freq;
+    config.end_freq = range.end_freq;
+    config.averages = range.averages;
+    config.settle_ms = 50.0;
+    config.usable_fraction = 0.75;
+    config.fast = true;
+    m_sweepJob = m_capture->startSweep(config);
+    if (m_sweepJob < 0)
+        m_active = -1;
+}
+
+/** Take the next live frame for an in place visit. */
+void SpectrumSurvey::collect()
+{
+    iq_fft_frame_sptr frame = m_rx->get_iq_fft_frame();
+    if (!frame || frame->sample_index < m_nextSample)
+        frame = m_rx->publish_iq_fft_frame();
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (!frame || frame->sample_index < m_nextSample || frame->data.size() < 4) {
+        if (now > m_deadline) {
+            m_collectTimer.stop();
+            m_active = -1;
+        }
+        return;
+    }
+
+    const int size = (int)frame->data.size();
+    if (m_frames > 0 && (frame->center_freq != m_center || frame->sample_rate != m_rate ||
+                         size != (int)m_acc.size())) {
+        // The operator retuned; start over, or give up if it does not fit any more
+        m_frames = 0;
+        if (!fitsInBand(m_ranges[m_active])) {
+            m_collectTimer.stop();
+            m_state[m_active].next_ms = 0;
+            m_active = -1;
+            return;
+        }
+    }
+
+    if (m_frames == 0) {
+        m_center = frame->center_freq;
+        m_rate = frame->sample_rate;
+        m_acc.assign(size, 0.0);
+        m_max.assign(size, 0.0f);
+    }
+    for (int j = 0; j < size; j++) {
+        m_acc[j] += frame->data[j];
+        m_max[j] = std::max(m_max[j], frame->data[j]);
+    }
+    m_nextSample = frame->sample_index + size;
+    m_deadline = now + SURVEY_FRAME_TIMEOUT_MS;
+    m_timestamp = std::chrono::duration<double>(frame->timestamp.time_since_epoch()).count();
+
+    const Range& range = m_ranges[m_active];
+    if (++m_frames < range.averages)
+        return;
+
+    m_collectTimer.stop();
+
+    // Bins of the range, with the DC bin interpolated
+    const double bin_hz = m_rate / size;
+    const double first_freq = m_center - m_rate / 2;
+    const int k0 = std::max((int)std::ceil((range.start_freq - first_freq) / bin_hz), 0);
+    const int k1 = std::min((int)std::floor((range.end_freq - first_freq) / bin_hz) + 1, size);
+    const int dc = size / 2;
+    m_acc[dc] = 0.5 * (m_acc[dc - 1] + m_acc[dc + 1]);
+    m_max[dc] = std::max(m_max[dc - 1], m_max[dc + 1]);
+
+    std::vector<float> power(std::max(k1 - k0, 0));
+    for (int k = k0; k < k1; k++)
+        power[k - k0] = (float)(m_acc[k] / m_frames);
+    const std::vector<float> max_power(m_max.begin() + k0, m_max.begin() + std::max(k1, k0));
+
+    finishVisit(power, max_power, first_freq + k0 * bin_hz, bin_hz, size, 0, m_timestamp);
+}
+
+void SpectrumSurvey::onSweepComplete(const SpectrumCapture::SweepResult& result)
+{
+    if (m_sweepJob < 0 || result.job_id != m_sweepJob)
+        return;
+
+    m_sweepJob = -1;
+    if (!result.success) {
+        m_active = -1;
+        return;
+    }
+
+    finishVisit(*result.power, *result.max_power, result.start_freq, result.bin_hz,
+                result.fft_size, result.steps, result.timestamp);
+}
+
+/**
+ * Update the statistics of the active range, store and emit the visit.
+ * @param steps Steps of the sweep, 0 for a visit from the live frames.
+ */
+void SpectrumSurvey::finishVisit(const std::vector<float>& power, const std::vector<float>& max_power,
+                                 double start_freq, double bin_hz, int fft_size, int steps,
+                                 double timestamp)
+{
+    const int index = m_active;
+    const Range& range = m_ranges[index];
+    State& state = m_state[index];
+    const int bins = (int)power.size();
+
+    m_active = -1;
+    if (bins == 0)
+        return;
+
+    SpectrumLevels avg, max;
+    avg.setFrame(power.data(), bins, 0.0, 0.0, 0, fft_size);
+    max.setFrame(max_power.data(), bins, 0.0, 0.0, 0, fft_size);
+
+    std::vector<float> sorted(avg.dB(), avg.dB() + bins);
+    std::nth_element(sorted.begin(), sorted.begin() + bins / 2, sorted.end());
+    const float floor_db = sorted[bins / 2];
+
+    // Occupancy restarts if the bins of the range change, e.g. with the FFT size
+    if ((int)state.occupied.size() != bins) {
+        state.occupied.assign(bins, 0);
+        state.visits = 0;
+    }
+    state.visits++;
+
+    auto occupancy = std::make_shared<std::vector<float>>(bins);
+    int occupied = 0;
+    for (int k = 0; k < bins; k++) {
+        if (avg.dB()[k] > floor_db + range.threshold_db) {
+            state.occupied[k]++;
+            occupied++;
+        }
+        (*occupancy)[k] = 100.0f * state.occupied[k] / state.visits;
+    }
+
+    Visit visit;
+    visit.range = index;
+    visit.name = range.name;
+    visit.start_freq = start_freq;
+    visit.bin_hz = bin_hz;
+    visit.avg_db = std::make_shared<const std::vector<float>>(avg.dB(), avg.dB() + bins);
+    visit.max_db = std::make_shared<const std::vector<float>>(max.dB(), max.dB() + bins);
+    visit.occupancy = occupancy;
+    visit.noise_floor_db = floor_db;
+    visit.occupied_fraction = (double)occupied / bins;
+    visit.visits = state.visits;
+    visit.swept = steps > 0;
+    visit.timestamp = timestamp;
+
+    if (m_file.isOpen()) {
+        SpectrumRowHeader row;
+        row.bins = (uint32_t)bins;
+        row.fft_size = (uint32_t)fft_size;
+        row.start_freq = start_freq;
+        row.bin_hz = bin_hz;
+        row.timestamp = timestamp;
+        row.sample_index = 0;
+        row.steps = (uint32_t)std::max(steps, 1);
+
+        bool ok = true;
+        row.kind = SpectrumRowHeader::SURVEY_AVG;
+        ok = ok && m_file.append(row, visit.avg_db->data());
+        row.kind = SpectrumRowHeader::SURVEY_MAX;
+        ok = ok && m_file.append(row, visit.max_db->data());
+        row.kind = SpectrumRowHeader::OCCUPANCY;
+        ok = ok && m_file.append(row, occupancy->data());
+        if (!ok) {
+            qDebug() << "SpectrumSurvey: writing failed:" << m_file.errorString();
+            m_file.close();
+        }
+    }
+
+    emit visitComplete(visit);
+}
@@ -0,0 +1,120 @@
+#ifndef SPECTRUM_SURVEY_H
+#define SPECTRUM_SURVEY_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include "spectrum_capture.h"
+#include "spectrum_file.h"
+
+struct iq_fft_frame;
+
+// Part of the receiver bandwidth a range must fit in to be surveyed in place
+#define SURVEY_USABLE_FRACTION 0.9
+
+/**
+ * @brief Unattended band survey on top of SpectrumCapture.
+ *
+ * Each range is visited again after its interval. A visit averages and
+ * max-holds a number of frames and updates the occupancy of every bin:
+ * the share of visits in which the averaged level was more than
+ * threshold_db above the noise floor (the median level) of the visit.
+ *
+ * A range that fits inside the current receiver bandwidth is taken from
+ * the live FFT frames, so the operator's channel is not disturbed. Other
+ * ranges are swept, which retunes the receiver for the duration of the
+ * sweep, and only if the range allows it; otherwise they wait until the
+ * receiver is tuned so that they fit.
+ *
+ * Results are emitted with visitComplete() and, if a file is set, appended
+ * as SURVEY_AVG, SURVEY_MAX and OCCUPANCY rows in the spectrum file format.
+ */
+class SpectrumSurvey : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Range {
+        QString name;
+        double start_freq;      // Hz
+        double end_freq;        // Hz
+        int interval_s;         // time between two visits
+        int averages;           // frames per visit
+        double threshold_db;    // above the noise floor counts as occupied
+        bool allow_retune;      // may sweep if it does not fit the bandwidth
+    };
+
+    struct Visit {
+        int range;                              // index in ranges()
+        QString name;
+        double start_freq;                      // frequency of bin 0
+        double bin_hz;
+        SpectrumCapture::SpectrumBuffer avg_db;
+        SpectrumCapture::SpectrumBuffer max_db;
+        SpectrumCapture::SpectrumBuffer occupancy;  // percent of visits per bin
+        double noise_floor_db;
+        double occupied_fraction;               // of the bins in this visit
+        int visits;
+        bool swept;                             // the receiver was retuned
+        double timestamp;
+    };
+
+    SpectrumSurvey(receiver *rx, SpectrumCapture *capture, QObject *parent = nullptr);
+    ~SpectrumSurvey() override;
+
+    int addRange(const Range& range);
+    void clearRanges();
+    const std::vector<Range>& ranges() const { return m_ranges; }
+
+    bool setFile(const QString& path);
+    void start();
+    void stop();
+    bool isRunning() const { return m_tick.isActive(); }
+
+signals:
+    void visitComplete(const SpectrumSurvey::Visit& visit);
+
+private slots:
+    void tick();
+    void collect();
+    void onSweepComplete(const SpectrumCapture::SweepResult& result);
+
+private:
+    struct State {
+        qint64 next_ms;                 // time of the next visit
+        int visits;
+        std::vector<uint32_t> occupied; // visits each bin was occupied in
+    };
+
+    bool fitsInBand(const Range& range) const;
+    void startVisit(int index);
+    void finishVisit(const std::vector<float>& power, const std::vector<float>& max_power,
+                     double start_freq, double bin_hz, int fft_size, int steps, double timestamp);
+
+    receiver *m_rx;
+    SpectrumCapture *m_capture;
+    std::vector<Range> m_ranges;
+    std::vector<State> m_state;
+    SpectrumFileWriter m_file;
+    QTimer m_tick;
+    QTimer m_collectTimer;
+
+    // Current visit
+    int m_active;                       // range index, -1 if idle
+    int m_sweepJob;                     // sweep of the visit, -1 if in place
+    std::vector<double> m_acc;
+    std::vector<float> m_max;
+    int m_frames;
+    uint64_t m_nextSample;
+    double m_center;
+    double m_rate;
+    double m_timestamp;
+    qint64 m_deadline;
+};
+
+Q_DECLARE_METATYPE(SpectrumSurvey::Visit)
+
+#endif // SPECTRUM_SURVEY_H
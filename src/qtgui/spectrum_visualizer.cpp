@@ -2,20 +2,55 @@
 #include <QDebug>
 #include <QPainter>
 #include <QPainterPath>
-#include <QDateTime>
 #include <QtMath>
+#include <algorithm>
+
+// x comes from the column number, y and color from the level
+static const char *vertexShaderSource = R"(
+    attribute highp float a_index;
+    attribute highp float a_level;
+    uniform highp float u_points;
+    uniform highp float u_min_db;
+    uniform highp float u_max_db;
+    varying lowp float v_intensity;
+    void main() {
+        highp float x = u_points > 1.0 ? a_index / (u_points - 1.0) : 0.5;
+        highp float y = clamp((a_level - u_min_db) / (u_max_db - u_min_db), 0.0, 1.0);
+        v_intensity = y;
+        gl_Position = vec4(x * 2.0 - 1.0, y * 2.0 - 1.0, 0.0, 1.0);
+    }
+)";
+
+static const char *fragmentShaderSource = R"(
+    varying lowp float v_intensity;
+    void main() {
+        lowp vec3 baseColor = vec3(0.4, 0.7, 1.0);
+        gl_FragColor = vec4(mix(baseColor * 0.3, baseColor, v_intensity), 0.9);
+    }
+)";
 
 SpectrumVisualizer::SpectrumVisualizer(QWidget *parent)
     : QOpenGLWidget(parent)
-    , m_scale(2.5f)  // Increased from 1.0f for better peak visibility
-    , m_offset(0.0f)
+    , m_levelsDirty(false)
+    , m_center_freq(0.0)
+    , m_bandwidth(0.0)
+    , m_indexVbo(QOpenGLBuffer::VertexBuffer)
+    , m_levelVbo(QOpenGLBuffer::VertexBuffer)
+    , m_points(0)
+    , m_min_db(SPECTRUM_VISUALIZER_MIN_DB)
+    , m_max_db(SPECTRUM_VISUALIZER_MAX_DB)
     , m_initialized(false)
 {
     setAttribute(Qt::WA_OpaquePaintEvent);
     setAutoFillBackground(false);
 }
 
-SpectrumVisualizer::~SpectrumVisualizer() = default;
+SpectrumVisualizer::~SpectrumVisualizer()
+{
+    makeCurrent();
+    cleanupGL();
+    doneCurrent();
+}
 
 void SpectrumVisualizer::initializeGL()
 {
@@ -24,75 +59,53 @@ void SpectrumVisualizer::initializeGL()
     // Set a nicer background color
     glClearColor(0.16f, 0.16f, 0.18f, 1.0f);  // Slightly bluish dark
     
-    // Initialize shaders with enhanced visuals
-    const char *vertexShaderSource = R"(
-        attribute vec3 vertex;
-        attribute vec3 color;
-        varying vec3 vert_color;
-        varying float v_intensity;
-        uniform mat4 matrix;
-        void main() {
-            gl_Position = matrix * vec4(vertex, 1.0);
-            v_intensity = vertex.y;  // Pass height for intensity
-            vert_color = color;
-        }
-    )";
-    
-    const char *fragmentShaderSource = R"(
-        varying vec3 vert_color;
-        varying float v_intensity;
-        void main() {
-            // Enhanced color calculation
-            vec3 baseColor = vec3(0.4, 0.7, 1.0);  // Brighter blue
-            vec3 finalColor = mix(baseColor * 0.3, baseColor, v_intensity);
-            gl_FragColor = vec4(finalColor, 0.9);
-        }
-    )";
-    
-    m_program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource);
-    m_program.addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource);
-    m_program.link();
-    
-    // Set up vertex buffer
-    m_vbo.create();
-    m_vbo.bind();
-    m_vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
-    
+    if (!m_program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource) ||
+        !m_program.addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource) ||
+        !m_program.link())
+    {
+        qWarning() << "Spectrum shaders failed:" << m_program.log();
+        return;
+    }
+
+    m_indexVbo.create();
+    m_indexVbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_levelVbo.create();
+    m_levelVbo.setUsagePattern(QOpenGLBuffer::StreamDraw);
+
+    m_points = 0;
+    m_levelsDirty = true;
     m_initialized = true;
 }
 
 void SpectrumVisualizer::paintGL()
 {
-    if (!m_initialized)
-        return;
-
     // Clear and prepare OpenGL state
     glClear(GL_COLOR_BUFFER_BIT);
     
-    // Render spectrum data using OpenGL
-    if (!m_data.magnitudes.isEmpty()) {
+    if (m_initialized && !m_levels.empty()) {
+        uploadLevels();
+
         m_program.bind();
-        
-        // Set up transformation matrix (identity for now)
-        QMatrix4x4 matrix;
-        m_program.setUniformValue("matrix", matrix);
-        
-        // Set up vertex attributes
-        m_vbo.bind();
-        int vertexLocation = m_program.attributeLocation("vertex");
-        m_program.enableAttributeArray(vertexLocation);
-        m_program.setAttributeBuffer(vertexLocation, GL_FLOAT, 0, 3, sizeof(QVector3D));
-        
-        int colorLocation = m_program.attributeLocation("color");
-        m_program.enableAttributeArray(colorLocation);
-        m_program.setAttributeBuffer(colorLocation, GL_FLOAT, m_vertices.size() * sizeof(QVector3D), 3, sizeof(QVector3D));
-        
+        m_program.setUniformValue("u_points", (GLfloat)m_points);
+        m_program.setUniformValue("u_min_db", m_min_db);
+        m_program.setUniformValue("u_max_db", m_max_db);
+
+        const int indexLocation = m_program.attributeLocation("a_index");
+        const int levelLocation = m_program.attributeLocation("a_level");
+        m_indexVbo.bind();
+        m_program.enableAttributeArray(indexLocation);
+        m_program.setAttributeBuffer(indexLocation, GL_FLOAT, 0, 1);
+        m_levelVbo.bind();
+        m_program.enableAttributeArray(levelLocation);
+        m_program.setAttributeBuffer(levelLocation, GL_FLOAT, 0, 1);
+
         // Draw the spectrum
-        glDrawArrays(GL_LINE_STRIP, 0, m_vertices.size());
+        glDrawArrays(GL_LINE_STRIP, 0, m_points);
         
         // Clean up
-        m_program.disableAttributeArray(vertexLocation);
-        m_program.disableAttributeArray(colorLocation);
+        m_program.disableAttributeArray(indexLocation);
+        m_program.disableAttributeArray(levelLocation);
+        m_levelVbo.release();
         m_program.release();
     }
     
@@ -107,12 +120,12 @@ void SpectrumVisualizer::paintGL()
     const int height = this->height();
     
     // Vertical grid lines
-    for (int x = 0; x <= width; x += width/10) {
+    for (int x = 0; x <= width; x += std::max(width/10, 1)) {
         painter.drawLine(x, 0, x, height);
     }
     
     // Horizontal grid lines
-    for (int y = 0; y <= height; y += height/8) {
+    for (int y = 0; y <= height; y += std::max(height/8, 1)) {
         painter.drawLine(0, y, width, y);
     }
     
@@ -128,52 +141,68 @@ void SpectrumVisualizer::resizeGL(int w, int h)
     update();  // Request a repaint with new size
 }
 
-void SpectrumVisualizer::updateVertices()
+/**
+ * Stream the newest levels. Called from paintGL() with the context current.
+ *
+ * The level buffer is orphaned before it is written, so the driver can hand
+ * out fresh storage instead of waiting for the previous draw to finish.
+ */
+void SpectrumVisualizer::uploadLevels()
 {
-    if (!m_initialized || m_data.magnitudes.isEmpty())
-        return;
-        
-    const int numPoints = m_data.magnitudes.size();
-    m_vertices.resize(numPoints);
-    m_colors.resize(numPoints);
-    
-    // Convert FFT data to vertices with enhanced scaling
-    for (int i = 0; i < numPoints; ++i) {
-        float x = (float)i / numPoints * 2.0f - 1.0f;
-        float y = m_data.magnitudes[i] * m_scale + m_offset;
-        
-        m_vertices[i] = QVector3D(x, y, 0.0f);
-        
-        // Enhanced color gradient
-        float intensity = (y + 1.0f) / 2.0f;
-        m_colors[i] = QVector3D(0.4f + intensity * 0.6f,  // More blue
-                               0.7f + intensity * 0.3f,  // More vibrant
-                               1.0f);                    // Full blue base
+    const int points = (int)m_levels.size();
+
+    if (points != m_points)
+    {
+        std::vector<float> index(points);
+        for (int i = 0; i < points; i++)
+            index[i] = (float)i;
+        m_indexVbo.bind();
+        m_indexVbo.allocate(index.data(), points * (int)sizeof(float));
+        m_indexVbo.release();
+        m_points = points;
+        m_levelsDirty = true;
     }
-    
-    // Update VBO efficiently
-    m_vbo.bind();
-    m_vbo.allocate(numPoints * sizeof(QVector3D) * 2);
-    m_vbo.write(0, m_vertices.constData(), numPoints * sizeof(QVector3D));
-    m_vbo.write(numPoints * sizeof(QVector3D), m_colors.constData(), 
-                numPoints * sizeof(QVector3D));
+
+    if (!m_levelsDirty)
+        return;
+
+    const int bytes = points * (int)sizeof(float);
+    m_levelVbo.bind();
+    m_levelVbo.allocate(bytes);     // orphan
+    m_levelVbo.write(0, m_levels.data(), bytes);
+    m_levelVbo.release();
+    m_levelsDirty = false;
 }
 
-void SpectrumVisualizer::updateData(const std::vector<float>& fft_data,
-                                   double center_freq,
-                                   double bandwidth,
-                                   double sample_rate)
+void SpectrumVisualizer::cleanupGL()
 {
-    // Update visualization data
-    m_data.magnitudes = QVector<float>(fft_data.begin(), fft_data.end());
-    m_data.center_freq = center_freq;
-    m_data.bandwidth = bandwidth;
-    m_data.sample_rate = sample_rate;
-    m_data.timestamp = QDateTime::currentMSecsSinceEpoch();
-    
-    // Update vertex data
-    updateVertices();
-    
+    m_initialized = false;
+    if (m_indexVbo.isCreated())
+        m_indexVbo.destroy();
+    if (m_levelVbo.isCreated())
+        m_levelVbo.destroy();
+}
+
+/**
+ * Set a new frame.
+ *
+ * The frame is reduced by max to at most one level per pixel column, and
+ * uploaded on the next repaint.
+ */
+void SpectrumVisualizer::updateData(const SpectrumLevels& levels)
+{
+    const int size = levels.size();
+    if (size == 0)
+        return;
+
+    m_center_freq = levels.centerFreq();
+    m_bandwidth = levels.sampleRate();
+
+    const int columns = std::min(size, std::max(qRound(width() * devicePixelRatioF()), 2));
+    m_levels.resize(columns);
+    levels.reduce(columns, m_levels.data());
+    m_levelsDirty = true;
+
     // Request redraw
     update();
 }
@@ -201,7 +230,7 @@ void SpectrumVisualizer::drawLabels(QPainter& painter)
     // Power labels
     for (int i = 0; i <= 8; ++i) {
         int y = height * i / 8;
-        double power = -120 + 120 * (8-i) / 8;
+        double power = m_min_db + (m_max_db - m_min_db) * (8-i) / 8;
         
         QString label = QString::number(power, 'f', 0) + " dB";
         painter.drawText(5, y + 15, label);
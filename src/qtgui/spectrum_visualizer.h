@@ -5,11 +5,22 @@
 #include <QOpenGLFunctions>
 #include <QOpenGLBuffer>
 #include <QOpenGLShaderProgram>
-#include <QVector>
-#include <QVector3D>
 #include <QPainter>
-#include <memory>
-
+#include <vector>
+#include "spectrum_levels.h"
+
+// Range of the power axis in dBFS
+#define SPECTRUM_VISUALIZER_MIN_DB -120.0f
+#define SPECTRUM_VISUALIZER_MAX_DB    0.0f
+
+/**
+ * Spectrum trace of the sigint dock.
+ *
+ * Frames are reduced by max to one level per pixel column before upload,
+ * so the upload does not grow with the FFT size. Only the dB level of each
+ * column is streamed, into an orphaned buffer; x positions come from a
+ * static index buffer and colors are computed in the vertex shader.
+ */
 class SpectrumVisualizer : public QOpenGLWidget, protected QOpenGLFunctions
 {
     Q_OBJECT
@@ -18,10 +29,7 @@ public:
     explicit SpectrumVisualizer(QWidget *parent = nullptr);
     ~SpectrumVisualizer() override;
 
-    void updateData(const std::vector<float>& fft_data, 
-                   double center_freq,
-                   double bandwidth,
-                   double sample_rate);
+    void updateData(const SpectrumLevels& levels);
 
 protected:
     void initializeGL() override;
@@ -29,31 +37,26 @@ protected:
     void resizeGL(int w, int h) override;
 
 private:
-    struct VisualizationData {
-        QVector<float> magnitudes;
-        double center_freq;
-        double bandwidth;
-        double sample_rate;
-        uint64_t timestamp;
-    };
-
-    // Visualization state
-    VisualizationData m_data;
-    QVector<QVector3D> m_vertices;
-    QVector<QVector3D> m_colors;
-    
+    void uploadLevels();
+    void cleanupGL();
+    void drawLabels(QPainter& painter);
+
+    // Level of each column in dBFS, newest frame
+    std::vector<float> m_levels;
+    bool m_levelsDirty;
+    double m_center_freq;
+    double m_bandwidth;
+
     // OpenGL state
-    QOpenGLBuffer m_vbo;
+    QOpenGLBuffer m_indexVbo;   // column numbers, rewritten when the count changes
+    QOpenGLBuffer m_levelVbo;   // streamed levels
     QOpenGLShaderProgram m_program;
-    
+    int m_points;               // columns in the buffers
+
     // View parameters
-    float m_scale;
-    float m_offset;
+    float m_min_db;
+    float m_max_db;
     bool m_initialized;
-
-    // Helper functions
-    void updateVertices();
-    void drawLabels(QPainter& painter);
 };
 
-#endif // SPECTRUM_VISUALIZER_H 
\ No newline at end of file
+#endif // SPECTRUM_VISUALIZER_H
@@ -0,0 +1,253 @@
+#include <cmath>
+#include <QSet>
+#include "tuning_intent.h"
+#include "dockrxopt.h"
+
+// Placeholder mode for "fm", resolved against the frequency
+#define MODE_FM_ANY  -2
+
+static const QSet<QString> commandWords = {
+    "tune", "retune", "go", "goto", "set", "switch", "change", "listen", "qsy",
+    "move", "jump", "freq", "frequency"
+};
+
+static const QSet<QString> fillerWords = {
+    "to", "the", "on", "at", "in", "into", "and", "with", "a", "of", "for", "now",
+    "please", "me", "mode", "radio", "receiver", "demod", "demodulator", "modulation"
+};
+
+static const QSet<QString> passbandWords = {
+    "bandwidth", "bw", "filter", "passband", "width"
+};
+
+TuningIntent::TuningIntent()
+{
+    clear();
+}
+
+void TuningIntent::clear()
+{
+    m_freq = 0;
+    m_mode = -1;
+    m_passband = 0;
+}
+
+/**
+ * Parse a chat message.
+ * @returns true if the whole message is a tuning command, with at least a
+ *          frequency, a mode or a bandwidth.
+ */
+bool TuningIntent::parse(const QString &message)
+{
+    clear();
+
+    const QStringList tokens = tokenize(message);
+    bool command = false;
+    bool expectPassband = false;
+    bool stereo = false;
+
+    for (int i = 0; i < tokens.size(); i++)
+    {
+        const QString &t = tokens[i];
+
+        if (t[0].isDigit())
+        {
+            bool ok;
+            const double value = t.toDouble(&ok);
+            if (!ok || value <= 0.0)
+                return false;
+
+            double scale = 0.0;
+            const bool unit = (i + 1 < tokens.size()) && unitScale(tokens[i + 1], scale);
+            if (unit)
+                i++;
+
+            // "12.5 kHz wide" is a bandwidth as well
+            if (i + 1 < tokens.size() && tokens[i + 1] == "wide")
+            {
+                expectPassband = true;
+                i++;
+            }
+
+            if (expectPassband)
+            {
+                const double hz = value * (unit ? scale : 1.0);
+                if (m_passband > 0 || hz < 1.0 || hz > TUNING_INTENT_MAX_PASSBAND)
+                    return false;
+                m_passband = (int)std::lround(hz);
+                expectPassband = false;
+                continue;
+            }
+
+            // A bare number is only a frequency after a command word, or in "98.1 fm"
+            const bool fm = !unit && (i + 1 < tokens.size()) && tokens[i + 1] == "fm";
+            if (!unit && !command && !fm)
+                return false;
+            if (!unit)
+                scale = (t.contains('.') || value < 100000.0) ? 1.0e6 : 1.0;
+
+            const double hz = value * scale;
+            if (m_freq > 0 || hz < 1.0 || hz > (double)TUNING_INTENT_MAX_FREQ)
+                return false;
+            m_freq = std::llround(hz);
+        }
+        else if (commandWords.contains(t))
+        {
+            command = true;
+        }
+        else if (passbandWords.contains(t))
+        {
+            expectPassband = true;
+        }
+        else if (t == "stereo")
+        {
+            stereo = true;
+        }
+        else if (fillerWords.contains(t))
+        {
+            continue;
+        }
+        else
+        {
+            const int mode = modeIndex(t);
+            if (mode == -1 || (m_mode != -1 && m_mode != mode))
+                return false;
+            m_mode = mode;
+        }
+    }
+
+    // A bandwidth word without a value
+    if (expectPassband)
+        return false;
+
+    if (m_mode == MODE_FM_ANY)
+    {
+        const bool broadcast = stereo || (m_freq >= 87500000 && m_freq <= 108000000);
+        m_mode = broadcast ? DockRxOpt::MODE_WFM_MONO : DockRxOpt::MODE_NFM;
+    }
+    if (stereo)
+    {
+        if (m_mode == DockRxOpt::MODE_WFM_MONO)
+            m_mode = DockRxOpt::MODE_WFM_STEREO;
+        else if (m_mode != DockRxOpt::MODE_WFM_STEREO && m_mode != DockRxOpt::MODE_WFM_STEREO_OIRT)
+            return false;
+    }
+
+    if (!hasFrequency() && !hasMode() && !hasPassband())
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+/** Short description of the command for the chat. */
+QString TuningIntent::describe() const
+{
+    QStringList parts;
+    if (hasFrequency())
+        parts << QString("tuned to %1 MHz").arg((double)m_freq / 1.0e6, 0, 'f', 6);
+    if (hasMode())
+        parts << QString("mode %1").arg(DockRxOpt::GetStringForModulationIndex(m_mode));
+    if (hasPassband())
+        parts << QString("filter %1 kHz").arg((double)m_passband / 1.0e3, 0, 'f', 1);
+
+    QString text = parts.join(", ");
+    if (!text.isEmpty())
+        text[0] = text[0].toUpper();
+    return text;
+}
+
+/*
+ * Split a message into lower case words and numbers. "12.5kHz" gives
+ * "12.5" and "khz", and commas between digits are dropped.
+ */
+QStringList TuningIntent::tokenize(const QString &message)
+{
+    QStringList tokens;
+    const QString text = message.toLower();
+    const int n = text.size();
+
+    for (int i = 0; i < n; )
+    {
+        const QChar c = text[i];
+        if (c.isDigit())
+        {
+            QString number;
+            while (i < n)
+            {
+                const QChar d = text[i];
+                const bool between = (i + 1 < n) && text[i + 1].isDigit();
+                if (d.isDigit())
+                    number += d;
+                else if (d == '.' && between)
+                    number += d;
+                else if (d != ',' || !between)
+                    break;
+                i++;
+            }
+            tokens << number;
+        }
+        else if (c.isLetter() || c == '_')
+        {
+            const int start = i;
+            while (i < n && (text[i].isLetter() || text[i] == '_'))
+                i++;
+            tokens << text.mid(start, i - start);
+        }
+        else
+        {
+            i++;
+        }
+    }
+    return tokens;
+}
+
+/*
+ * Scale of a frequency unit. "m" and "g" are not accepted since "2m" or
+ * "70cm" name amateur bands rather than frequencies.
+ */
+bool TuningIntent::unitScale(const QString &token, double &scale)
+{
+    if (token == "hz")
+        scale = 1.0;
+    else if (token == "khz" || token == "k")
+        scale = 1.0e3;
+    else if (token == "mhz")
+        scale = 1.0e6;
+    else if (token == "ghz")
+        scale = 1.0e9;
+    else
+        return false;
+    return true;
+}
+
+/* Mode for a mode word, MODE_FM_ANY for "fm", or -1. */
+int TuningIntent::modeIndex(const QString &token)
+{
+    if (token == "raw" || token == "iq")
+        return DockRxOpt::MODE_RAW;
+    if (token == "am")
+        return DockRxOpt::MODE_AM;
+    if (token == "sam" || token == "ams")
+        return DockRxOpt::MODE_AM_SYNC;
+    if (token == "lsb")
+        return DockRxOpt::MODE_LSB;
+    if (token == "usb")
+        return DockRxOpt::MODE_USB;
+    if (token == "cwl" || token == "cwr")
+        return DockRxOpt::MODE_CWL;
+    if (token == "cw" || token == "cwu")
+        return DockRxOpt::MODE_CWU;
+    if (token == "nfm" || token == "nbfm")
+        return DockRxOpt::MODE_NFM;
+    if (token == "wfm" || token == "wbfm")
+        return DockRxOpt::MODE_WFM_MONO;
+    if (token == "wfm_st")
+        return DockRxOpt::MODE_WFM_STEREO;
+    if (token == "wfm_st_oirt" || token == "oirt")
+        return DockRxOpt::MODE_WFM_STEREO_OIRT;
+    if (token == "fm")
+        return MODE_FM_ANY;
+    return -1;
+}
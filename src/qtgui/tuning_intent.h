@@ -0,0 +1,54 @@
+#ifndef TUNING_INTENT_H
+#define TUNING_INTENT_H
+
+#include <QString>
+#include <QStringList>
+
+/* Highest frequency accepted in a chat command, in Hz */
+#define TUNING_INTENT_MAX_FREQ      6000000000LL
+
+/* Widest filter accepted in a chat command, in Hz */
+#define TUNING_INTENT_MAX_PASSBAND  500000
+
+/**
+ * Parser for plain tuning commands typed in the sigint chat.
+ *
+ * Commands like "tune to 146.52", "7.074 MHz usb" or "set bandwidth to
+ * 12.5 kHz" are resolved here, without the Python coordinator or an API
+ * call. The grammar is small on purpose: every word of the message must be
+ * a known command word, a frequency, a mode or a bandwidth. Anything else
+ * is left to the coordinator, so only unambiguous commands are handled.
+ *
+ * A frequency without a unit is taken as MHz if it has a decimal point or
+ * is below 100000, else as Hz, and needs a command word ("tune", "go",
+ * ...) before it or "fm" after it. A bandwidth without a unit is in Hz.
+ */
+class TuningIntent
+{
+public:
+    TuningIntent();
+
+    bool parse(const QString &message);
+
+    bool hasFrequency() const { return m_freq > 0; }
+    bool hasMode() const { return m_mode >= 0; }
+    bool hasPassband() const { return m_passband > 0; }
+
+    qint64 frequency() const { return m_freq; }
+    int mode() const { return m_mode; }         // DockRxOpt::rxopt_mode_idx
+    int passband() const { return m_passband; }
+
+    QString describe() const;
+
+private:
+    void clear();
+    static QStringList tokenize(const QString &message);
+    static bool unitScale(const QString &token, double &scale);
+    static int modeIndex(const QString &token);
+
+    qint64 m_freq;
+    int    m_mode;
+    int    m_passband;
+};
+
+#endif // TUNING_INTENT_H
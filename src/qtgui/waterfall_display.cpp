@@ -3,10 +3,54 @@
 #include <QDateTime>
 #include <QtMath>
 #include <QDebug>
+#include <algorithm>
 #include "sigint_logger.h"
 
+// The newest row is at the top. Rows are addressed relative to it; rows
+// that have not been filled yet are drawn black.
+static const char *vertexShaderSource = R"(
+    attribute highp vec2 a_pos;
+    varying highp vec2 v_uv;
+    void main() {
+        v_uv = vec2(a_pos.x * 0.5 + 0.5, 0.5 - a_pos.y * 0.5);
+        gl_Position = vec4(a_pos, 0.0, 1.0);
+    }
+)";
+
+static const char *fragmentShaderSource = R"(
+    uniform sampler2D u_ring;
+    uniform highp float u_head;
+    uniform highp float u_height;
+    uniform highp float u_rows;
+    varying highp vec2 v_uv;
+    void main() {
+        highp float age = floor(v_uv.y * u_height);
+        highp float row = mod(u_head - age + u_height, u_height);
+        lowp vec4 c = texture2D(u_ring, vec2(v_uv.x, (row + 0.5) / u_height));
+        gl_FragColor = age < u_rows ? vec4(c.rgb, 1.0) : vec4(0.0, 0.0, 0.0, 1.0);
+    }
+)";
+
+static const GLfloat quadVertices[] = {
+    -1.0f, -1.0f,
+     1.0f, -1.0f,
+    -1.0f,  1.0f,
+     1.0f,  1.0f
+};
+
 WaterfallDisplay::WaterfallDisplay(QWidget *parent)
     : QOpenGLWidget(parent)
+    , m_levelsMem(MEM_SIGINT_VIEWS)
+    , m_ringWidth(0)
+    , m_ringHeight(1024)  // Adjust based on performance needs
+    , m_head(0)
+    , m_rows(0)
+    , m_ringDirty(true)
+    , m_center_freq(0.0)
+    , m_bandwidth(0.0)
+    , m_quad(QOpenGLBuffer::VertexBuffer)
+    , m_ringTex(0)
+    , m_maxTexSize(WATERFALL_DISPLAY_MAX_WIDTH)
     , m_min_db(-120.0f)
     , m_max_db(-20.0f)
     , m_time_span(10.0f)  // 10 seconds default
@@ -15,115 +59,89 @@ WaterfallDisplay::WaterfallDisplay(QWidget *parent)
     setAttribute(Qt::WA_OpaquePaintEvent);
     setAutoFillBackground(false);
     
-    // Initialize waterfall data
-    m_data.max_history = 1024;  // Adjust based on performance needs
-    m_data.last_update = QDateTime::currentMSecsSinceEpoch();
+    m_colormap.setMap("heat");
+    m_colormap.setRange(m_min_db, m_max_db);
 }
 
-WaterfallDisplay::~WaterfallDisplay() = default;
+WaterfallDisplay::~WaterfallDisplay()
+{
+    makeCurrent();
+    cleanupGL();
+    doneCurrent();
+}
 
 void WaterfallDisplay::initializeGL()
 {
-    SigintLogger::debug("🔧 Initializing WaterfallDisplay OpenGL");
+    SIGINT_LOG(SigintLogger::Debug, SigintLogger::Waterfall, "🔧 Initializing WaterfallDisplay OpenGL");
     
     initializeOpenGLFunctions();
     
     // Log OpenGL context information
-    SigintLogger::debug(QString("  - OpenGL Version: %1")
+    SIGINT_LOG(SigintLogger::Debug, SigintLogger::Waterfall, QString("  - OpenGL Version: %1")
         .arg(QString((const char*)glGetString(GL_VERSION))));
-    SigintLogger::debug(QString("  - GLSL Version: %1")
+    SIGINT_LOG(SigintLogger::Debug, SigintLogger::Waterfall, QString("  - GLSL Version: %1")
         .arg(QString((const char*)glGetString(GL_SHADING_LANGUAGE_VERSION))));
-    SigintLogger::debug(QString("  - Vendor: %1")
+    SIGINT_LOG(SigintLogger::Debug, SigintLogger::Waterfall, QString("  - Vendor: %1")
         .arg(QString((const char*)glGetString(GL_VENDOR))));
-    SigintLogger::debug(QString("  - Renderer: %1")
+    SIGINT_LOG(SigintLogger::Debug, SigintLogger::Waterfall, QString("  - Renderer: %1")
         .arg(QString((const char*)glGetString(GL_RENDERER))));
     
     // Set background color
     glClearColor(0.16f, 0.16f, 0.18f, 1.0f);
-    
-    // Initialize shaders for waterfall rendering
-    const char *vertexShaderSource = R"(
-        attribute vec3 vertex;
-        attribute vec3 color;
-        varying vec3 vert_color;
-        uniform mat4 matrix;
-        void main() {
-            gl_Position = matrix * vec4(vertex, 1.0);
-            vert_color = color;
-        }
-    )";
-    
-    const char *fragmentShaderSource = R"(
-        varying vec3 vert_color;
-        void main() {
-            gl_FragColor = vec4(vert_color, 1.0);
-        }
-    )";
-    
-    m_program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource);
-    m_program.addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource);
-    m_program.link();
-    
-    // Set up vertex buffer
-    m_vbo.create();
-    m_vbo.bind();
-    m_vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
-    
-    // Initialize color map
-    initializeColorMap();
-    
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_maxTexSize);
+
+    if (!m_program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource) ||
+        !m_program.addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource) ||
+        !m_program.link())
+    {
+        SIGINT_LOG(SigintLogger::Warning, SigintLogger::Waterfall, "  ⚠️ Waterfall shaders failed: " + m_program.log());
+        return;
+    }
+
+    m_quad.create();
+    m_quad.bind();
+    m_quad.allocate(quadVertices, sizeof(quadVertices));
+    m_quad.release();
+
+    glGenTextures(1, &m_ringTex);
+
+    QMutexLocker locker(&m_mutex);
+    m_ringDirty = true;
     m_initialized = true;
-    SigintLogger::debug("✅ OpenGL initialization complete");
+    SIGINT_LOG(SigintLogger::Debug, SigintLogger::Waterfall, "✅ OpenGL initialization complete");
 }
 
 void WaterfallDisplay::paintGL()
 {
-    SigintLogger::debug("🎨 Waterfall paintGL called");
-    SigintLogger::debug(QString("  - OpenGL initialized: %1").arg(m_initialized));
-    SigintLogger::debug(QString("  - Current size: %1x%2").arg(width()).arg(height()));
-    
-    if (!m_initialized) {
-        SigintLogger::warning("  ⚠️ OpenGL not initialized!");
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (!m_initialized)
         return;
-    }
-    
+
     QMutexLocker locker(&m_mutex);
     
-    if (m_data.history.empty()) {
-        SigintLogger::debug("  - No data to display");
+    if (m_rows == 0 || m_ringWidth <= 0)
         return;
-    }
-    
-    // Log rendering stats
-    SigintLogger::debug("  - Rendering waterfall with:");
-    SigintLogger::debug(QString("    - History lines: %1").arg(m_data.history.size()));
-    SigintLogger::debug(QString("    - Time span: %1 seconds").arg(m_time_span));
-    SigintLogger::debug(QString("    - dB range: %1 to %2").arg(m_min_db).arg(m_max_db));
-    
-    glClear(GL_COLOR_BUFFER_BIT);
-    
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_ringTex);
+    uploadPending();
+
     m_program.bind();
-    
-    // Set up transformation matrix
-    QMatrix4x4 matrix;
-    m_program.setUniformValue("matrix", matrix);
-    
-    // Draw waterfall data
-    m_vbo.bind();
-    int vertexLocation = m_program.attributeLocation("vertex");
-    m_program.enableAttributeArray(vertexLocation);
-    m_program.setAttributeBuffer(vertexLocation, GL_FLOAT, 0, 3, sizeof(QVector3D));
-    
-    int colorLocation = m_program.attributeLocation("color");
-    m_program.enableAttributeArray(colorLocation);
-    m_program.setAttributeBuffer(colorLocation, GL_FLOAT, m_vertices.size() * sizeof(QVector3D), 
-                                3, sizeof(QVector3D));
-    
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, m_vertices.size());
-    
-    m_program.disableAttributeArray(vertexLocation);
-    m_program.disableAttributeArray(colorLocation);
+    m_program.setUniformValue("u_ring", 0);
+    m_program.setUniformValue("u_head", (GLfloat)m_head);
+    m_program.setUniformValue("u_height", (GLfloat)m_ringHeight);
+    m_program.setUniformValue("u_rows", (GLfloat)m_rows);
+
+    m_quad.bind();
+    const int pos = m_program.attributeLocation("a_pos");
+    m_program.enableAttributeArray(pos);
+    m_program.setAttributeBuffer(pos, GL_FLOAT, 0, 2);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    m_program.disableAttributeArray(pos);
+    m_quad.release();
     m_program.release();
+    glBindTexture(GL_TEXTURE_2D, 0);
     
     // Draw overlay (frequency/time labels)
     QPainter painter(this);
@@ -134,46 +152,48 @@ void WaterfallDisplay::paintGL()
 void WaterfallDisplay::resizeGL(int w, int h)
 {
     glViewport(0, 0, w, h);
-    updateVertices();
 }
 
-void WaterfallDisplay::updateData(const std::vector<float>& fft_data,
-                                 double center_freq,
-                                 double bandwidth,
-                                 double sample_rate)
+/**
+ * Add a row from the current frame.
+ *
+ * Only the new row is converted and queued for upload.
+ */
+void WaterfallDisplay::updateData(const SpectrumLevels& levels)
 {
+    const int size = levels.size();
+    if (size == 0)
+        return;
+
     QMutexLocker locker(&m_mutex);
-    
-    qDebug() << "\n=== 🌊 Waterfall Data Update ===";
-    qDebug() << "  - Data size:" << fft_data.size();
-    qDebug() << "  - Center freq:" << center_freq << "Hz";
-    qDebug() << "  - Bandwidth:" << bandwidth << "Hz";
-    qDebug() << "  - Sample rate:" << sample_rate << "Hz";
-    
-    // Log some sample values
-    if (!fft_data.empty()) {
-        qDebug() << "  - First 5 FFT values:";
-        for (size_t i = 0; i < std::min(size_t(5), fft_data.size()); ++i) {
-            qDebug() << "    [" << i << "]:" << fft_data[i] << "dB";
-        }
-    }
-    
-    // Store the data
-    m_data.history.push_front(fft_data);
-    m_data.center_freq = center_freq;
-    m_data.bandwidth = bandwidth;
-    m_data.sample_rate = sample_rate;
-    m_data.last_update = QDateTime::currentMSecsSinceEpoch();
-    
-    // Maintain history size
-    while (m_data.history.size() > m_data.max_history) {
-        m_data.history.pop_back();
+
+    const int width = std::min({size, WATERFALL_DISPLAY_MAX_WIDTH, (int)m_maxTexSize});
+    if (width != m_ringWidth)
+        resizeRing(width, m_ringHeight);
+
+    m_center_freq = levels.centerFreq();
+    m_bandwidth = levels.sampleRate();
+
+    m_head = (m_head + 1) % m_ringHeight;
+    m_rows = std::min(m_rows + 1, m_ringHeight);
+
+    m_rowDb.resize(width);
+    levels.reduce(width, m_rowDb.data());
+
+    const int32_t base = CColormap::toFixed(WATERFALL_DISPLAY_MIN_DB);
+    uint16_t *dst = &m_levels[(size_t)m_head * m_ringWidth];
+    for (int x = 0; x < width; x++)
+    {
+        const int32_t q = CColormap::toFixed(m_rowDb[x]) - base;
+        dst[x] = (uint16_t)std::min(std::max(q, 0), 65535);
     }
-    
-    qDebug() << "  - History size:" << m_data.history.size() << "/" << m_data.max_history;
-    qDebug() << "  - Last update:" << QDateTime::fromMSecsSinceEpoch(m_data.last_update).toString("yyyy-MM-dd HH:mm:ss.zzz");
-    qDebug() << "=================================\n";
-    
+
+    // A full ring of pending rows is cheaper to upload at once
+    if ((int)m_pendingRows.size() >= m_ringHeight)
+        m_ringDirty = true;
+    else if (!m_ringDirty)
+        m_pendingRows.push_back(m_head);
+
     // Request an update
     update();
 }
@@ -182,16 +202,18 @@ void WaterfallDisplay::setTimeSpan(float seconds)
 {
     QMutexLocker locker(&m_mutex);
     m_time_span = seconds;
-    m_data.max_history = static_cast<size_t>(seconds * 60);  // Assuming 60 updates per second
-    updateVertices();
+    // Assuming 60 updates per second
+    const int rows = std::max(static_cast<int>(seconds * 60), 1);
+    resizeRing(m_ringWidth, std::min(rows, (int)m_maxTexSize));
+    update();
 }
 
 void WaterfallDisplay::setColorMap(const QString& name)
 {
     QMutexLocker locker(&m_mutex);
-    // TODO: Implement different color maps
-    initializeColorMap();
-    updateVertices();
+    m_colormap.setMap(name);
+    m_ringDirty = true;
+    update();
 }
 
 void WaterfallDisplay::setMinMax(float min_db, float max_db)
@@ -199,93 +221,86 @@ void WaterfallDisplay::setMinMax(float min_db, float max_db)
     QMutexLocker locker(&m_mutex);
     m_min_db = min_db;
     m_max_db = max_db;
-    updateVertices();
+    m_colormap.setRange(m_min_db, m_max_db);
+    m_ringDirty = true;
+    update();
 }
 
-void WaterfallDisplay::initializeColorMap()
+/** Reallocate the ring, which clears the history. Called with m_mutex held. */
+void WaterfallDisplay::resizeRing(int width, int height)
 {
-    // Initialize with a basic heat map (black -> blue -> red -> yellow -> white)
-    m_colormap.clear();
-    m_colormap.reserve(256);
-    
-    for (int i = 0; i < 256; ++i) {
-        float t = i / 255.0f;
-        QVector3D color;
-        
-        if (t < 0.25f) {
-            // Black to Blue
-            color = QVector3D(0, 0, t * 4);
-        }
-        else if (t < 0.5f) {
-            // Blue to Red
-            float s = (t - 0.25f) * 4;
-            color = QVector3D(s, 0, 1.0f - s);
-        }
-        else if (t < 0.75f) {
-            // Red to Yellow
-            float s = (t - 0.5f) * 4;
-            color = QVector3D(1.0f, s, 0);
-        }
-        else {
-            // Yellow to White
-            float s = (t - 0.75f) * 4;
-            color = QVector3D(1.0f, 1.0f, s);
-        }
-        
-        m_colormap.append(color);
-    }
+    m_ringWidth = width;
+    m_ringHeight = std::max(height, 1);
+    m_levels.assign((size_t)m_ringWidth * m_ringHeight, 0);
+    m_levelsMem.set((int64_t)(m_levels.capacity() * sizeof(uint16_t)));
+    m_head = 0;
+    m_rows = 0;
+    m_pendingRows.clear();
+    m_ringDirty = true;
 }
 
-QVector3D WaterfallDisplay::getColorForValue(float value) const
+/** Convert a ring row to RGBA with the current colormap and range. */
+void WaterfallDisplay::colorRow(int row, quint8 *rgba) const
 {
-    // Map value from dB range to [0,1]
-    float t = (value - m_min_db) / (m_max_db - m_min_db);
-    t = qBound(0.0f, t, 1.0f);
-    
-    // Map to colormap index
-    int index = static_cast<int>(t * (m_colormap.size() - 1));
-    return m_colormap[index];
+    const int32_t base = CColormap::toFixed(WATERFALL_DISPLAY_MIN_DB);
+    const uint16_t *src = &m_levels[(size_t)row * m_ringWidth];
+    for (int x = 0; x < m_ringWidth; x++)
+    {
+        const QRgb c = m_colormap.rgbFx((int32_t)src[x] + base);
+        rgba[4 * x + 0] = (quint8)qRed(c);
+        rgba[4 * x + 1] = (quint8)qGreen(c);
+        rgba[4 * x + 2] = (quint8)qBlue(c);
+        rgba[4 * x + 3] = 255;
+    }
 }
 
-void WaterfallDisplay::updateVertices()
+/**
+ * Bring the ring texture up to date. The texture must be bound.
+ *
+ * Normally only the rows added since the last frame are uploaded. After a
+ * resize, range or colormap change the whole texture is filled again.
+ */
+void WaterfallDisplay::uploadPending()
 {
-    if (!m_initialized || m_data.history.empty())
-        return;
+    std::vector<quint8> line(4 * (size_t)m_ringWidth);
 
-    const int width = m_data.history.front().size();
-    const int height = m_data.history.size();
-    
-    // Create vertex grid
-    m_vertices.clear();
-    m_colors.clear();
-    m_vertices.reserve(width * height * 2);
-    m_colors.reserve(width * height * 2);
-    
-    for (int y = 0; y < height; ++y) {
-        const auto& row = m_data.history[y];
-        float y_pos = 1.0f - (2.0f * y / height);
-        
-        for (int x = 0; x < width; ++x) {
-            float x_pos = (2.0f * x / width) - 1.0f;
-            float value = row[x];
-            
-            m_vertices.append(QVector3D(x_pos, y_pos, 0));
-            m_colors.append(getColorForValue(value));
-            
-            if (y < height - 1) {
-                float next_y_pos = 1.0f - (2.0f * (y + 1) / height);
-                m_vertices.append(QVector3D(x_pos, next_y_pos, 0));
-                m_colors.append(getColorForValue(m_data.history[y + 1][x]));
-            }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (m_ringDirty)
+    {
+        std::vector<quint8> image(4 * (size_t)m_ringWidth * m_ringHeight);
+        for (int row = 0; row < m_ringHeight; row++)
+            colorRow(row, &image[4 * (size_t)row * m_ringWidth]);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_ringWidth, m_ringHeight, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, image.data());
+        m_ringDirty = false;
+    }
+    else
+    {
+        for (int row : m_pendingRows)
+        {
+            colorRow(row, line.data());
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, m_ringWidth, 1, GL_RGBA,
+                            GL_UNSIGNED_BYTE, line.data());
         }
     }
-    
-    // Update VBO
-    m_vbo.bind();
-    m_vbo.allocate(m_vertices.size() * sizeof(QVector3D) * 2);
-    m_vbo.write(0, m_vertices.constData(), m_vertices.size() * sizeof(QVector3D));
-    m_vbo.write(m_vertices.size() * sizeof(QVector3D), m_colors.constData(),
-                m_colors.size() * sizeof(QVector3D));
+    m_pendingRows.clear();
+}
+
+void WaterfallDisplay::cleanupGL()
+{
+    m_initialized = false;
+
+    if (m_ringTex)
+        glDeleteTextures(1, &m_ringTex);
+    m_ringTex = 0;
+
+    if (m_quad.isCreated())
+        m_quad.destroy();
 }
 
 void WaterfallDisplay::drawLabels(QPainter& painter)
@@ -297,8 +312,8 @@ void WaterfallDisplay::drawLabels(QPainter& painter)
     painter.setFont(QFont("Monospace", 8));
     
     // Frequency labels
-    double startFreq = m_data.center_freq - m_data.bandwidth/2;
-    double endFreq = m_data.center_freq + m_data.bandwidth/2;
+    double startFreq = m_center_freq - m_bandwidth/2;
+    double endFreq = m_center_freq + m_bandwidth/2;
     
     for (int i = 0; i <= 10; ++i) {
         double freq = startFreq + (endFreq - startFreq) * i / 10;
@@ -316,4 +331,4 @@ void WaterfallDisplay::drawLabels(QPainter& painter)
         QString label = QString::number(-time, 'f', 1) + " s";
         painter.drawText(5, y + 15, label);
     }
-} 
\ No newline at end of file
+}
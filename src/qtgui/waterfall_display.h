@@ -5,11 +5,27 @@
 #include <QOpenGLFunctions>
 #include <QOpenGLBuffer>
 #include <QOpenGLShaderProgram>
-#include <QVector>
-#include <QVector3D>
-#include <deque>
 #include <QMutex>
+#include <cstdint>
+#include <vector>
+#include "colormap.h"
+#include "spectrum_levels.h"
+#include "dsp/mem_account.h"
 
+// Widest row kept, wider FFT frames are reduced by max
+#define WATERFALL_DISPLAY_MAX_WIDTH 4096
+
+// Stored levels are CColormap fixed point dB, offset to start here
+#define WATERFALL_DISPLAY_MIN_DB    -200.0f
+
+/**
+ * Waterfall of the sigint dock.
+ *
+ * Rows are kept in a ring texture that receives one new row per update and
+ * is drawn as a single textured quad, so an update costs O(width) no matter
+ * how much history is shown. A CPU copy of the rows as fixed point dB is
+ * only used to recolor the texture when the range or colormap changes.
+ */
 class WaterfallDisplay : public QOpenGLWidget, protected QOpenGLFunctions
 {
     Q_OBJECT
@@ -19,10 +35,7 @@ public:
     ~WaterfallDisplay() override;
 
     // Update with new FFT data
-    void updateData(const std::vector<float>& fft_data,
-                   double center_freq,
-                   double bandwidth,
-                   double sample_rate);
+    void updateData(const SpectrumLevels& levels);
 
     // Configuration
     void setTimeSpan(float seconds);
@@ -35,23 +48,31 @@ protected:
     void resizeGL(int w, int h) override;
 
 private:
-    struct WaterfallData {
-        std::deque<std::vector<float>> history;  // Circular buffer for waterfall history
-        double center_freq;
-        double bandwidth;
-        double sample_rate;
-        uint64_t last_update;
-        size_t max_history;  // Maximum number of history lines to keep
-    };
+    void resizeRing(int width, int height);
+    void colorRow(int row, quint8 *rgba) const;
+    void uploadPending();
+    void cleanupGL();
+    void drawLabels(QPainter& painter);
+
+    // Ring of rows, newest at m_head
+    std::vector<uint16_t> m_levels;     // m_ringHeight * m_ringWidth levels
+    mem_charge m_levelsMem;             // m_levels, MEM_SIGINT_VIEWS
+    int m_ringWidth;
+    int m_ringHeight;
+    int m_head;
+    int m_rows;                         // valid rows
+    std::vector<int> m_pendingRows;     // rows not uploaded yet, oldest first
+    std::vector<float> m_rowDb;         // scratch row for updateData()
+    bool m_ringDirty;                   // texture must be reallocated and filled
+
+    double m_center_freq;
+    double m_bandwidth;
 
-    // Visualization state
-    WaterfallData m_data;
-    QVector<QVector3D> m_vertices;
-    QVector<QVector3D> m_colors;
-    
     // OpenGL state
-    QOpenGLBuffer m_vbo;
+    QOpenGLBuffer m_quad;
     QOpenGLShaderProgram m_program;
+    GLuint m_ringTex;
+    GLint m_maxTexSize;
     
     // View parameters
     float m_min_db;
@@ -61,14 +82,7 @@ private:
     QMutex m_mutex;  // Protect data updates
 
     // Color mapping
-    QVector<QVector3D> m_colormap;
-    void initializeColorMap();
-    QVector3D getColorForValue(float value) const;
-
-    // Helper functions
-    void updateVertices();
-    void updateTexture();
-    void drawLabels(QPainter& painter);
+    CColormap m_colormap;
 };
 
-#endif // WATERFALL_DISPLAY_H 
\ No newline at end of file
+#endif // WATERFALL_DISPLAY_H
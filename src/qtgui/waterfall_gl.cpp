@@ -0,0 +1,290 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cstring>
+#include <QDebug>
+#include "waterfall_gl.h"
+
+static const char *vertexShader =
+    "attribute highp vec2 a_pos;\n"
+    "varying highp vec2 v_uv;\n"
+    "void main()\n"
+    "{\n"
+    "    v_uv = vec2(a_pos.x * 0.5 + 0.5, 0.5 - a_pos.y * 0.5);\n"
+    "    gl_Position = vec4(a_pos, 0.0, 1.0);\n"
+    "}\n";
+
+// The ring texture holds the colormap index in R and a valid flag in A.
+// Rows are addressed relative to the newest line, which is drawn at the top.
+static const char *fragmentShader =
+    "uniform sampler2D u_ring;\n"
+    "uniform sampler2D u_cmap;\n"
+    "uniform highp float u_offset;\n"
+    "uniform highp float u_height;\n"
+    "varying highp vec2 v_uv;\n"
+    "void main()\n"
+    "{\n"
+    "    highp float row = mod(u_offset + floor(v_uv.y * u_height), u_height);\n"
+    "    lowp vec4 t = texture2D(u_ring, vec2(v_uv.x, (row + 0.5) / u_height));\n"
+    "    lowp vec4 c = texture2D(u_cmap, vec2((t.r * 255.0 + 0.5) / 256.0, 0.5));\n"
+    "    gl_FragColor = vec4(c.rgb * t.a, 1.0);\n"
+    "}\n";
+
+static const GLfloat quadVertices[] = {
+    -1.0f, -1.0f,
+     1.0f, -1.0f,
+    -1.0f,  1.0f,
+     1.0f,  1.0f
+};
+
+CWaterfallGL::CWaterfallGL(QWidget *parent) :
+    QOpenGLWidget(parent),
+    m_ready(false),
+    m_ringWidth(0),
+    m_ringHeight(0),
+    m_ringOffset(0),
+    m_ringDirty(true),
+    m_cmapDirty(true),
+    m_cmap(256 * 4, 0),
+    m_pendingLines(0),
+    m_program(nullptr),
+    m_quad(QOpenGLBuffer::VertexBuffer),
+    m_ringTex(0),
+    m_cmapTex(0)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setFocusPolicy(Qt::NoFocus);
+}
+
+CWaterfallGL::~CWaterfallGL()
+{
+    makeCurrent();
+    cleanupGL();
+    doneCurrent();
+}
+
+/**
+ * Set the size of the ring texture in pixels.
+ *
+ * The texture is reallocated on the next repaint, which clears the
+ * waterfall.
+ */
+void CWaterfallGL::resizeRing(int width, int height)
+{
+    if (width == m_ringWidth && height == m_ringHeight)
+        return;
+
+    m_ringWidth = width;
+    m_ringHeight = height;
+    m_ringDirty = true;
+    m_pending.clear();
+    m_pendingLines = 0;
+    update();
+}
+
+/** Set the colormap from the 256 entry CColormap table. */
+void CWaterfallGL::setColormap(const QRgb *colorTbl)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        m_cmap[4 * i + 0] = (quint8)qRed(colorTbl[i]);
+        m_cmap[4 * i + 1] = (quint8)qGreen(colorTbl[i]);
+        m_cmap[4 * i + 2] = (quint8)qBlue(colorTbl[i]);
+        m_cmap[4 * i + 3] = 255;
+    }
+    m_cmapDirty = true;
+    update();
+}
+
+/**
+ * Queue a new waterfall line for upload.
+ * @param line Colormap indices, one per pixel of the ring width.
+ * @param xmin First pixel with data.
+ * @param xmax One past the last pixel with data.
+ *
+ * Pixels outside [xmin, xmax) are drawn black. At most one ring height of
+ * lines is kept between two repaints. The caller schedules the repaint, so
+ * several lines can be uploaded in one frame.
+ */
+void CWaterfallGL::addLine(const quint8 *line, int xmin, int xmax)
+{
+    if (m_ringWidth <= 0 || m_ringHeight <= 0)
+        return;
+
+    const size_t lineBytes = 4 * (size_t)m_ringWidth;
+
+    if (m_pendingLines == m_ringHeight)
+    {
+        m_pending.erase(m_pending.begin(), m_pending.begin() + lineBytes);
+        m_pendingLines--;
+    }
+
+    const size_t start = m_pending.size();
+    m_pending.resize(start + lineBytes, 0);
+    quint8 *dst = &m_pending[start];
+
+    xmin = std::max(xmin, 0);
+    xmax = std::min(xmax, m_ringWidth);
+    for (int x = xmin; x < xmax; x++)
+    {
+        dst[4 * x + 0] = line[x];
+        dst[4 * x + 3] = 255;
+    }
+    m_pendingLines++;
+}
+
+/** Clear the waterfall. */
+void CWaterfallGL::clear()
+{
+    m_ringDirty = true;
+    m_pending.clear();
+    m_pendingLines = 0;
+    update();
+}
+
+void CWaterfallGL::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    m_program = new QOpenGLShaderProgram(this);
+    if (!m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShader) ||
+        !m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShader) ||
+        !m_program->link())
+    {
+        qWarning() << "OpenGL waterfall disabled:" << m_program->log();
+        cleanupGL();
+        emit glFailed();
+        return;
+    }
+
+    m_quad.create();
+    m_quad.bind();
+    m_quad.allocate(quadVertices, sizeof(quadVertices));
+    m_quad.release();
+
+    glGenTextures(1, &m_ringTex);
+    glGenTextures(1, &m_cmapTex);
+
+    m_ringDirty = true;
+    m_cmapDirty = true;
+    m_ready = true;
+}
+
+void CWaterfallGL::paintGL()
+{
+    if (!m_ready)
+        return;
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (m_ringWidth <= 0 || m_ringHeight <= 0)
+        return;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glActiveTexture(GL_TEXTURE0);
+
+    if (m_cmapDirty)
+    {
+        glBindTexture(GL_TEXTURE_2D, m_cmapTex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     m_cmap.data());
+        m_cmapDirty = false;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_ringTex);
+    if (m_ringDirty)
+    {
+        std::vector<quint8> blank(4 * (size_t)m_ringWidth * m_ringHeight, 0);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_ringWidth, m_ringHeight, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, blank.data());
+        m_ringOffset = 0;
+        m_ringDirty = false;
+    }
+
+    uploadPending();
+
+    m_program->bind();
+    m_program->setUniformValue("u_ring", 0);
+    m_program->setUniformValue("u_cmap", 1);
+    m_program->setUniformValue("u_offset", (GLfloat)m_ringOffset);
+    m_program->setUniformValue("u_height", (GLfloat)m_ringHeight);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_cmapTex);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_ringTex);
+
+    m_quad.bind();
+    const int pos = m_program->attributeLocation("a_pos");
+    m_program->enableAttributeArray(pos);
+    m_program->setAttributeBuffer(pos, GL_FLOAT, 0, 2);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    m_program->disableAttributeArray(pos);
+    m_quad.release();
+    m_program->release();
+}
+
+/** Upload queued lines, one texture row each. The ring texture must be bound. */
+void CWaterfallGL::uploadPending()
+{
+    const size_t lineBytes = 4 * (size_t)m_ringWidth;
+
+    for (int i = 0; i < m_pendingLines; i++)
+    {
+        // newest line moves "up", like m_WaterfallOffset in CPlotter
+        m_ringOffset = (m_ringOffset + m_ringHeight - 1) % m_ringHeight;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, m_ringOffset, m_ringWidth, 1, GL_RGBA,
+                        GL_UNSIGNED_BYTE, &m_pending[i * lineBytes]);
+    }
+
+    m_pending.clear();
+    m_pendingLines = 0;
+}
+
+void CWaterfallGL::cleanupGL()
+{
+    m_ready = false;
+
+    if (m_ringTex)
+        glDeleteTextures(1, &m_ringTex);
+    if (m_cmapTex)
+        glDeleteTextures(1, &m_cmapTex);
+    m_ringTex = 0;
+    m_cmapTex = 0;
+
+    if (m_quad.isCreated())
+        m_quad.destroy();
+
+    delete m_program;
+    m_program = nullptr;
+}
@@ -0,0 +1,87 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef WATERFALL_GL_H
+#define WATERFALL_GL_H
+
+#include <vector>
+#include <QColor>
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLWidget>
+
+/**
+ * OpenGL renderer for the CPlotter waterfall.
+ *
+ * The waterfall is kept in a ring texture of colormap indices. Each new line
+ * is uploaded as a single texture row and the colormap lookup is done in the
+ * fragment shader, so the CPU never touches the pixels of old lines.
+ *
+ * The widget is placed over the waterfall area of CPlotter and is
+ * transparent for mouse events. If OpenGL can not be initialized
+ * glFailed() is emitted and CPlotter falls back to QPainter.
+ */
+class CWaterfallGL : public QOpenGLWidget, protected QOpenGLFunctions
+{
+    Q_OBJECT
+
+public:
+    explicit CWaterfallGL(QWidget *parent = nullptr);
+    ~CWaterfallGL() override;
+
+    bool isReady() const { return m_ready; }
+
+    void resizeRing(int width, int height);
+    void setColormap(const QRgb *colorTbl);
+    void addLine(const quint8 *line, int xmin, int xmax);
+    void clear();
+
+signals:
+    void glFailed();
+
+protected:
+    void initializeGL() override;
+    void paintGL() override;
+
+private:
+    void uploadPending();
+    void cleanupGL();
+
+    bool    m_ready;
+    int     m_ringWidth;
+    int     m_ringHeight;
+    int     m_ringOffset;       // texture row of the newest line
+    bool    m_ringDirty;        // texture must be reallocated
+    bool    m_cmapDirty;
+
+    std::vector<quint8>  m_cmap;        // 256 RGBA colormap entries
+    std::vector<quint8>  m_pending;     // RGBA lines not yet uploaded, newest last
+    int                  m_pendingLines;
+
+    QOpenGLShaderProgram *m_program;
+    QOpenGLBuffer         m_quad;
+    GLuint                m_ringTex;
+    GLuint                m_cmapTex;
+};
+
+#endif // WATERFALL_GL_H
@@ -0,0 +1,270 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "waterfall_history.h"
+
+CWaterfallHistory::CWaterfallHistory() :
+    m_capacity(0),
+    m_count(0),
+    m_head(0),
+    m_mem(MEM_WF_HISTORY),
+    m_accFrames(0),
+    m_accSize(0),
+    m_accCenter(0.0),
+    m_accRate(0.0)
+{
+}
+
+/**
+ * Set the number of rows kept.
+ *
+ * The newest rows that fit are preserved, so the history survives a
+ * resize of the waterfall. Storage grows in steps of WF_HISTORY_ROW_CHUNK
+ * rows and is never shrunk, so dragging a window edge does not reallocate
+ * the history for every step. Under the cap of MEM_WF_HISTORY fewer
+ * rows are kept, and storage over the cap is released.
+ */
+void CWaterfallHistory::setCapacity(int rows)
+{
+    const int64_t rowBytes = WF_HISTORY_MAX_BINS * sizeof(uint16_t) + sizeof(Row);
+    rows = std::max(rows, 0);
+    rows = std::min(rows, (int)(m_mem.allowed((int64_t)rows * rowBytes) / rowBytes));
+    if (rows == m_capacity)
+        return;
+
+    // Rotate the ring in place so the oldest row goes first, newest last
+    if (m_count > 0)
+    {
+        const int oldest = (m_head - m_count + 1 + m_capacity) % m_capacity;
+        std::rotate(m_rows.begin(), m_rows.begin() + oldest, m_rows.begin() + m_capacity);
+        std::rotate(m_data.begin(), m_data.begin() + (size_t)oldest * WF_HISTORY_MAX_BINS,
+                    m_data.begin() + (size_t)m_capacity * WF_HISTORY_MAX_BINS);
+    }
+
+    // Keep the newest rows that fit
+    const int keep = std::min(m_count, rows);
+    const int drop = m_count - keep;
+    if (drop > 0)
+    {
+        std::move(m_rows.begin() + drop, m_rows.begin() + m_count, m_rows.begin());
+        memmove(&m_data[0], &m_data[(size_t)drop * WF_HISTORY_MAX_BINS],
+                (size_t)keep * WF_HISTORY_MAX_BINS * sizeof(uint16_t));
+    }
+
+    if (rows > (int)m_rows.size())
+    {
+        int alloc = (rows + WF_HISTORY_ROW_CHUNK - 1) / WF_HISTORY_ROW_CHUNK * WF_HISTORY_ROW_CHUNK;
+        alloc = std::max(rows, (int)(m_mem.allowed((int64_t)alloc * rowBytes) / rowBytes));
+        m_rows.resize(alloc);
+        m_data.resize((size_t)alloc * WF_HISTORY_MAX_BINS);
+    }
+    else if (m_mem.allowed(m_mem.bytes()) < m_mem.bytes())
+    {
+        m_rows.resize(rows);
+        m_rows.shrink_to_fit();
+        m_data.resize((size_t)rows * WF_HISTORY_MAX_BINS);
+        m_data.shrink_to_fit();
+    }
+    m_mem.set((int64_t)m_rows.size() * rowBytes);
+
+    m_capacity = rows;
+    m_count = keep;
+    m_head = keep > 0 ? keep - 1 : std::max(rows - 1, 0);
+}
+
+/** Remove all rows and the partly accumulated line. */
+void CWaterfallHistory::clear()
+{
+    m_count = 0;
+    m_head = std::max(m_capacity - 1, 0);
+    m_accFrames = 0;
+}
+
+/**
+ * Accumulate an FFT frame into the next line.
+ * @param data Linear power, size bins with DC in the middle.
+ * @param size Number of bins.
+ * @param centerFreq Absolute frequency of the DC bin.
+ * @param rate Bandwidth covered by the data.
+ * @param useMax Keep the max of the frames, else the sum for averaging.
+ *
+ * Groups of bins are reduced to one history bin the same way. A frame with
+ * a different size or frequency range restarts the line.
+ */
+void CWaterfallHistory::addFrame(const float *data, int size, double centerFreq,
+                                 double rate, bool useMax)
+{
+    if (size <= 0 || m_capacity == 0)
+        return;
+
+    const int bins = std::min(size, WF_HISTORY_MAX_BINS);
+
+    if (size != m_accSize || centerFreq != m_accCenter || rate != m_accRate)
+    {
+        m_accSize = size;
+        m_accCenter = centerFreq;
+        m_accRate = rate;
+        m_accFrames = 0;
+    }
+    if ((int)m_acc.size() != bins)
+        m_acc.assign(bins, 0.0f);
+
+    const bool first = (m_accFrames == 0);
+    for (int k = 0; k < bins; k++)
+    {
+        const int b0 = (int)((int64_t)k * size / bins);
+        const int b1 = std::max((int)((int64_t)(k + 1) * size / bins), b0 + 1);
+        float v;
+        if (useMax)
+        {
+            v = data[b0];
+            for (int i = b0 + 1; i < b1; i++)
+                v = std::max(v, data[i]);
+        }
+        else
+        {
+            v = 0.0f;
+            for (int i = b0; i < b1; i++)
+                v += data[i];
+            v /= (float)(b1 - b0);
+        }
+
+        if (first)
+            m_acc[k] = v;
+        else if (useMax)
+            m_acc[k] = std::max(m_acc[k], v);
+        else
+            m_acc[k] += v;
+    }
+    m_accFrames++;
+}
+
+/**
+ * Store the accumulated frames as a new row.
+ * @param ms Time of the line in milliseconds since the epoch.
+ * @param useMax The frames were accumulated as max, else as a sum.
+ * @param scale Power scale applied before the dB conversion.
+ * @returns false if no frame has been accumulated.
+ */
+bool CWaterfallHistory::pushLine(uint64_t ms, bool useMax, float scale)
+{
+    if (m_accFrames == 0 || m_capacity == 0)
+        return false;
+
+    m_head = (m_head + 1) % m_capacity;
+    m_count = std::min(m_count + 1, m_capacity);
+
+    const int bins = (int)m_acc.size();
+    Row &row = m_rows[m_head];
+    row.ms = ms;
+    row.binHz = m_accRate / (double)bins;
+    row.startFreq = m_accCenter - m_accRate / 2.0;
+    row.bins = bins;
+
+    if (!useMax)
+        scale /= (float)m_accFrames;
+    const float fmin = std::numeric_limits<float>::min();
+    const int32_t base = CColormap::toFixed(WF_HISTORY_MIN_DB);
+    uint16_t *dst = &m_data[(size_t)m_head * WF_HISTORY_MAX_BINS];
+    for (int k = 0; k < bins; k++)
+    {
+        const float dB = 10.0f * log10f(std::max(m_acc[k] * scale, fmin));
+        const int32_t q = CColormap::toFixed(dB) - base;
+        dst[k] = (uint16_t)std::min(std::max(q, 0), 65535);
+    }
+
+    m_accFrames = 0;
+    return true;
+}
+
+/** Time of a row, age 0 being the newest. */
+uint64_t CWaterfallHistory::rowTime(int age) const
+{
+    if (age < 0 || age >= m_count)
+        return 0;
+    return m_rows[(m_head - age + m_capacity) % m_capacity].ms;
+}
+
+/**
+ * Render a row to stored levels, one per pixel.
+ * @param age Row to render, 0 is the newest.
+ * @param startFreq Absolute frequency of the left edge of pixel 0.
+ * @param hzPerPixel Width of a pixel in Hz.
+ * @param width Number of pixels in out.
+ * @param useMax Show the max of the bins in a pixel, else their average.
+ * @param out Level of each pixel, see levelFixed() (output).
+ * @param xmin First pixel covered by the row (output).
+ * @param xmax One past the last pixel covered by the row (output).
+ * @returns false if the row does not exist or is outside the view.
+ */
+bool CWaterfallHistory::renderRow(int age, double startFreq, double hzPerPixel, int width,
+                                  bool useMax, uint16_t *out, int &xmin, int &xmax) const
+{
+    xmin = xmax = 0;
+    if (age < 0 || age >= m_count || width <= 0 || hzPerPixel <= 0.0)
+        return false;
+
+    const int index = (m_head - age + m_capacity) % m_capacity;
+    const Row &row = m_rows[index];
+    const uint16_t *src = &m_data[(size_t)index * WF_HISTORY_MAX_BINS];
+
+    // Bin position of pixel x is (x * hzPerPixel + offset) / binHz
+    const double binsPerPixel = hzPerPixel / row.binHz;
+    const double offset = (startFreq - row.startFreq) / row.binHz;
+
+    xmin = std::max((int)ceil(-offset / binsPerPixel), 0);
+    xmax = std::min((int)ceil(((double)row.bins - offset) / binsPerPixel), width);
+    if (xmax <= xmin)
+    {
+        xmin = xmax = 0;
+        return false;
+    }
+
+    for (int x = xmin; x < xmax; x++)
+    {
+        const double pos = offset + (double)x * binsPerPixel;
+        const int k0 = std::min(std::max((int)pos, 0), row.bins - 1);
+        const int k1 = std::min(std::max((int)(pos + binsPerPixel), k0 + 1), row.bins);
+
+        uint32_t q;
+        if (useMax)
+        {
+            q = src[k0];
+            for (int k = k0 + 1; k < k1; k++)
+                q = std::max(q, (uint32_t)src[k]);
+        }
+        else
+        {
+            q = 0;
+            for (int k = k0; k < k1; k++)
+                q += src[k];
+            q /= (uint32_t)(k1 - k0);
+        }
+        out[x] = (uint16_t)q;
+    }
+
+    return true;
+}
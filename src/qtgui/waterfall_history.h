@@ -0,0 +1,97 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef WATERFALL_HISTORY_H
+#define WATERFALL_HISTORY_H
+
+#include <cstdint>
+#include <vector>
+#include "colormap.h"
+#include "dsp/mem_account.h"
+
+/* Largest number of bins stored for one waterfall line */
+#define WF_HISTORY_MAX_BINS  8192
+
+/* Row storage is allocated in multiples of this many rows */
+#define WF_HISTORY_ROW_CHUNK 256
+
+/* Stored levels are CColormap fixed point dB, offset to start at WF_HISTORY_MIN_DB */
+#define WF_HISTORY_MIN_DB    -200.0f
+
+/**
+ * Waterfall history of quantized dB rows.
+ *
+ * FFT frames are accumulated (max or average) at up to WF_HISTORY_MAX_BINS
+ * bins and stored as 16 bit fixed point dB values (1/256 dB steps from
+ * WF_HISTORY_MIN_DB), one row per waterfall line, together with the time
+ * of the line and the frequency range it covers. The visible waterfall can
+ * then be rendered again from the history for any span, dB range or
+ * colormap.
+ */
+class CWaterfallHistory
+{
+public:
+    CWaterfallHistory();
+
+    void setCapacity(int rows);
+    int  capacity() const { return m_capacity; }
+    int  rows() const { return m_count; }
+    void clear();
+
+    void addFrame(const float *data, int size, double centerFreq, double rate, bool useMax);
+    bool pushLine(uint64_t ms, bool useMax, float scale = 1.0f);
+
+    uint64_t rowTime(int age) const;
+
+    bool renderRow(int age, double startFreq, double hzPerPixel, int width, bool useMax,
+                   uint16_t *out, int &xmin, int &xmax) const;
+
+    /* CColormap fixed point level of a stored level */
+    static int32_t levelFixed(uint16_t level)
+    {
+        return (int32_t)level + CColormap::toFixed(WF_HISTORY_MIN_DB);
+    }
+
+private:
+    struct Row {
+        uint64_t ms;        // time of the line
+        double   startFreq; // frequency of the first bin
+        double   binHz;     // bin width
+        int      bins;      // number of valid bins
+    };
+
+    int                   m_capacity;
+    int                   m_count;
+    int                   m_head;     // index of the newest row
+    std::vector<Row>      m_rows;
+    std::vector<uint16_t> m_data;     // m_capacity * WF_HISTORY_MAX_BINS levels
+    mem_charge            m_mem;      // m_rows and m_data, MEM_WF_HISTORY
+
+    // Frames accumulated for the next line
+    std::vector<float>    m_acc;
+    int                   m_accFrames;
+    int                   m_accSize;
+    double                m_accCenter;
+    double                m_accRate;
+};
+
+#endif // WATERFALL_HISTORY_H
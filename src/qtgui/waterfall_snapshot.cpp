@@ -0,0 +1,308 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <QBuffer>
+#include "waterfall_snapshot.h"
+
+CWaterfallSnapshot::CWaterfallSnapshot(int rows) :
+    m_lineMs(0),
+    m_lineStart(0)
+{
+    m_history.setCapacity(rows);
+    m_colormap.setRange(-120.0f, 0.0f);
+}
+
+/** Set the number of waterfall lines kept. */
+void CWaterfallSnapshot::setRows(int rows)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_history.setCapacity(rows);
+}
+
+/**
+ * Set the time covered by one waterfall line.
+ * @param ms Frames within this time are combined (max hold), 0 for one line per frame.
+ */
+void CWaterfallSnapshot::setLineInterval(int ms)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lineMs = std::max(ms, 0);
+}
+
+/** Set the dB range shown by the colormap and the spectrum. */
+void CWaterfallSnapshot::setRange(float mindB, float maxdB)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_colormap.setRange(mindB, maxdB);
+}
+
+/** Select a colormap by name, see CColormap::setMap(). */
+bool CWaterfallSnapshot::setColormap(const QString &cmap)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_colormap.setMap(cmap);
+}
+
+void CWaterfallSnapshot::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_history.clear();
+    m_lineStart = 0;
+}
+
+/**
+ * Add an FFT frame.
+ * @param data Linear power, size bins with DC in the middle, not normalized.
+ * @param size Number of bins, also the FFT size for the dBFS scale.
+ * @param centerFreq Absolute frequency of the DC bin.
+ * @param rate Bandwidth covered by the data.
+ * @param ms Time of the frame in milliseconds since the epoch.
+ */
+void CWaterfallSnapshot::addFrame(const float *data, int size, double centerFreq, double rate,
+                                  uint64_t ms)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_history.addFrame(data, size, centerFreq, rate, true);
+    if (m_lineStart == 0)
+        m_lineStart = ms;
+    if (ms >= m_lineStart + (uint64_t)m_lineMs)
+    {
+        m_history.pushLine(ms, true, 1.0f / ((float)size * (float)size));
+        m_lineStart = ms;
+    }
+}
+
+int CWaterfallSnapshot::rows() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_history.rows();
+}
+
+/** Time of the newest line, 0 if there is none. */
+uint64_t CWaterfallSnapshot::lastLineTime() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_history.rowTime(0);
+}
+
+/**
+ * Render an image of the history.
+ * @param startFreq Absolute frequency of the left edge.
+ * @param endFreq Absolute frequency of the right edge.
+ * @param width Width of the image in pixels.
+ * @param rows Number of waterfall lines, 0 for all lines in the history.
+ * @param spectrumHeight Height of the spectrum of the newest line drawn
+ *                       above the waterfall, 0 for waterfall only.
+ * @returns The image, null if there is nothing to render.
+ *
+ * The newest line is at the top of the waterfall. Parts of the range not
+ * covered by the data are black.
+ */
+QImage CWaterfallSnapshot::render(double startFreq, double endFreq, int width, int rows,
+                                  int spectrumHeight) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (rows <= 0)
+        rows = m_history.rows();
+    spectrumHeight = std::max(spectrumHeight, 0);
+    if (width <= 0 || endFreq <= startFreq || rows + spectrumHeight <= 0)
+        return QImage();
+
+    QImage image(width, spectrumHeight + rows, QImage::Format_RGB32);
+    image.fill(Qt::black);
+
+    const double hzPerPixel = (endFreq - startFreq) / (double)width;
+    std::vector<uint16_t> levels(width);
+    int xmin, xmax;
+
+    for (int age = 0; age < std::min(rows, m_history.rows()); age++)
+    {
+        if (!m_history.renderRow(age, startFreq, hzPerPixel, width, true,
+                                 levels.data(), xmin, xmax))
+            continue;
+
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(spectrumHeight + age));
+        for (int x = xmin; x < xmax; x++)
+            line[x] = m_colormap.rgbFx(CWaterfallHistory::levelFixed(levels[x]));
+    }
+
+    // Spectrum of the newest line, filled below the trace in the level color
+    if (spectrumHeight > 0 &&
+        m_history.renderRow(0, startFreq, hzPerPixel, width, true, levels.data(), xmin, xmax))
+    {
+        const int32_t minFx = CColormap::toFixed(m_colormap.minDb());
+        const int32_t rangeFx = std::max(CColormap::toFixed(m_colormap.maxDb()) - minFx, 1);
+        for (int x = xmin; x < xmax; x++)
+        {
+            const int32_t fx = CWaterfallHistory::levelFixed(levels[x]);
+            const int64_t h = (int64_t)(fx - minFx) * spectrumHeight / rangeFx;
+            const int top = spectrumHeight - (int)std::min(std::max(h, (int64_t)0),
+                                                           (int64_t)spectrumHeight);
+            const QRgb color = m_colormap.rgbFx(fx);
+            for (int y = top; y < spectrumHeight; y++)
+                reinterpret_cast<QRgb *>(image.scanLine(y))[x] = color;
+        }
+    }
+
+    return image;
+}
+
+/**
+ * Get the levels of the newest lines instead of an image.
+ * @param startFreq Absolute frequency of the left edge in Hz.
+ * @param endFreq Absolute frequency of the right edge in Hz.
+ * @param width Number of columns.
+ * @param rows Maximum number of lines, 0 for all.
+ * @param dB Levels in dBFS, newest line first, NaN where a line has no data (output).
+ * @param spanMs Time between the oldest and the newest line returned (output).
+ * @returns The number of lines in dB.
+ *
+ * Each column is the max of the bins it covers, as in the images.
+ */
+int CWaterfallSnapshot::levels(double startFreq, double endFreq, int width, int rows,
+                               std::vector<float> &dB, uint64_t &spanMs) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    spanMs = 0;
+    dB.clear();
+    if (width <= 0 || endFreq <= startFreq)
+        return 0;
+    if (rows <= 0 || rows > m_history.rows())
+        rows = m_history.rows();
+
+    const double hzPerPixel = (endFreq - startFreq) / (double)width;
+    const float scale = 1.0f / (float)(1 << COLORMAP_DB_FRAC_BITS);
+    std::vector<uint16_t> levels(width);
+    int xmin, xmax;
+
+    dB.assign((size_t)rows * width, std::numeric_limits<float>::quiet_NaN());
+    for (int age = 0; age < rows; age++)
+    {
+        if (!m_history.renderRow(age, startFreq, hzPerPixel, width, true,
+                                 levels.data(), xmin, xmax))
+            continue;
+
+        float *line = &dB[(size_t)age * width];
+        for (int x = xmin; x < xmax; x++)
+            line[x] = (float)CWaterfallHistory::levelFixed(levels[x]) * scale;
+    }
+
+    if (rows > 0)
+        spanMs = m_history.rowTime(0) - m_history.rowTime(rows - 1);
+    return rows;
+}
+
+/**
+ * Get the levels of the last spanMs of the history on a grid of its own.
+ * @param startFreq Absolute frequency of the left edge in Hz.
+ * @param endFreq Absolute frequency of the right edge in Hz.
+ * @param width Number of columns.
+ * @param rows Number of rows, each covering spanMs / rows.
+ * @param spanMs Time back from the newest line.
+ * @param useMax Each cell is the max of the lines in its time, the mean
+ *               of their dB otherwise.
+ * @param dB Levels in dBFS, newest row first, NaN where no line has data (output).
+ * @param coveredMs Time between the oldest line used and the newest (output).
+ * @returns The number of lines used, 0 if there are none.
+ *
+ * Unlike levels() the grid does not depend on the line rate, so a client
+ * can ask for a fixed time at a fixed size and gets NaN rows for the part
+ * the history does not reach back to.
+ */
+int CWaterfallSnapshot::history(double startFreq, double endFreq, int width, int rows,
+                                uint64_t spanMs, bool useMax, std::vector<float> &dB,
+                                uint64_t &coveredMs) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    coveredMs = 0;
+    dB.clear();
+    if (width <= 0 || rows <= 0 || endFreq <= startFreq || spanMs == 0)
+        return 0;
+
+    const double hzPerPixel = (endFreq - startFreq) / (double)width;
+    const float scale = 1.0f / (float)(1 << COLORMAP_DB_FRAC_BITS);
+    std::vector<uint16_t> levels(width);
+    std::vector<int> counts(useMax ? 0 : (size_t)rows * width, 0);
+    int xmin, xmax;
+    int used = 0;
+
+    dB.assign((size_t)rows * width, std::numeric_limits<float>::quiet_NaN());
+    const uint64_t newest = m_history.rowTime(0);
+    for (int age = 0; age < m_history.rows(); age++)
+    {
+        const uint64_t ms = m_history.rowTime(age);
+        const uint64_t back = newest - ms;
+        if (ms > newest || back >= spanMs)
+            break;
+        if (!m_history.renderRow(age, startFreq, hzPerPixel, width, true,
+                                 levels.data(), xmin, xmax))
+            continue;
+
+        const size_t row = (size_t)(back * (uint64_t)rows / spanMs);
+        float *out = &dB[row * width];
+        for (int x = xmin; x < xmax; x++)
+        {
+            const float level = (float)CWaterfallHistory::levelFixed(levels[x]) * scale;
+            if (useMax)
+                out[x] = std::isnan(out[x]) ? level : std::max(out[x], level);
+            else if (counts[row * width + x]++ == 0)
+                out[x] = level;
+            else
+                out[x] += level;
+        }
+        coveredMs = back;
+        used++;
+    }
+
+    if (!useMax)
+        for (size_t i = 0; i < dB.size(); i++)
+            if (counts[i] > 1)
+                dB[i] /= (float)counts[i];
+
+    return used;
+}
+
+/**
+ * Encode an image in memory.
+ * @param image The image.
+ * @param format Any format supported by QImageWriter, e.g. "PNG" or "JPG".
+ * @param quality Compression quality 0..100, -1 for the default.
+ * @returns The encoded image, empty on failure.
+ */
+QByteArray CWaterfallSnapshot::encode(const QImage &image, const char *format, int quality)
+{
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+
+    if (image.isNull() || !buffer.open(QIODevice::WriteOnly) ||
+        !image.save(&buffer, format, quality))
+        return QByteArray();
+
+    return bytes;
+}
@@ -0,0 +1,77 @@
+/* -*- c++ -*- */
+/*
+ * Gqrx SDR: Software defined radio receiver powered by GNU Radio and Qt
+ *           https://gqrx.dk/
+ *
+ * Copyright 2011-2013 Alexandru Csete OZ9AEC.
+ *
+ * Gqrx is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * Gqrx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Gqrx; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef WATERFALL_SNAPSHOT_H
+#define WATERFALL_SNAPSHOT_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <QByteArray>
+#include <QImage>
+#include "colormap.h"
+#include "waterfall_history.h"
+
+/**
+ * Offscreen waterfall renderer.
+ *
+ * Keeps its own waterfall history, fed straight from FFT frames, and
+ * renders a spectrum and waterfall image of any frequency range into a
+ * QImage. No widget is involved, so snapshots can be taken while the main
+ * window is hidden or without a display at all (QT_QPA_PLATFORM=offscreen).
+ *
+ * Frames can be added and images rendered from different threads.
+ */
+class CWaterfallSnapshot
+{
+public:
+    explicit CWaterfallSnapshot(int rows = 512);
+
+    void setRows(int rows);
+    void setLineInterval(int ms);
+    void setRange(float mindB, float maxdB);
+    bool setColormap(const QString &cmap);
+    void clear();
+
+    void addFrame(const float *data, int size, double centerFreq, double rate, uint64_t ms);
+
+    int      rows() const;
+    uint64_t lastLineTime() const;
+
+    QImage render(double startFreq, double endFreq, int width, int rows = 0,
+                  int spectrumHeight = 0) const;
+    int    levels(double startFreq, double endFreq, int width, int rows,
+                  std::vector<float> &dB, uint64_t &spanMs) const;
+    int    history(double startFreq, double endFreq, int width, int rows, uint64_t spanMs,
+                   bool useMax, std::vector<float> &dB, uint64_t &coveredMs) const;
+
+    static QByteArray encode(const QImage &image, const char *format = "PNG", int quality = -1);
+
+private:
+    mutable std::mutex m_mutex;
+    CWaterfallHistory  m_history;
+    CColormap          m_colormap;
+    int                m_lineMs;    // time per line, 0 for one line per frame
+    uint64_t           m_lineStart; // time of the first frame of the next line
+};
+
+#endif // WATERFALL_SNAPSHOT_H
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "waterfall_tiles.h"
+
+CWaterfallTiles::CWaterfallTiles() :
+    m_centerFreq(0.0),
+    m_rate(0.0),
+    m_lines(0),
+    m_firstMs(0),
+    m_lastMs(0),
+    m_stored(0),
+    m_mem(MEM_WF_TILES)
+{
+    for (int zoom = 0; zoom < WF_TILES_ZOOMS; zoom++)
+    {
+        const int columns = WF_TILES_SIZE << zoom;
+        m_levels[zoom].acc.assign(columns, -std::numeric_limits<float>::infinity());
+        m_levels[zoom].strip.assign((size_t)columns * WF_TILES_SIZE, 0);
+    }
+    m_line.resize(WF_TILES_SIZE << (WF_TILES_ZOOMS - 1));
+    reset();
+}
+
+void CWaterfallTiles::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    reset();
+}
+
+void CWaterfallTiles::reset()
+{
+    for (Level &level : m_levels)
+    {
+        std::fill(level.acc.begin(), level.acc.end(), -std::numeric_limits<float>::infinity());
+        std::fill(level.strip.begin(), level.strip.end(), 0);
+        level.accLines = 0;
+        level.rows = 0;
+        level.first = 0;
+        level.tiles.clear();
+    }
+    m_lines = 0;
+    m_firstMs = 0;
+    m_lastMs = 0;
+    m_stored = 0;
+    account();
+}
+
+/**
+ * Add an FFT frame as a line.
+ * @param data Linear power, size bins with DC in the middle, not normalized.
+ * @param size Number of bins, also the FFT size for the dBFS scale.
+ * @param centerFreq Absolute frequency of the DC bin.
+ * @param rate Bandwidth covered by the data.
+ * @param ms Time of the frame in milliseconds since the epoch.
+ */
+void CWaterfallTiles::addFrame(const float *data, int size, double centerFreq, double rate,
+                               uint64_t ms)
+{
+    if (size <= 0 || rate <= 0.0)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (centerFreq != m_centerFreq || rate != m_rate)
+    {
+        reset();
+        m_centerFreq = centerFreq;
+        m_rate = rate;
+    }
+
+    // Finest zoom, each column the max of its bins
+    const int columns = (int)m_line.size();
+    const float scale = 1.0f / ((float)size * (float)size);
+    for (int c = 0; c < columns; c++)
+    {
+        const int first = (int)((int64_t)c * size / columns);
+        const int last = std::max(first + 1, (int)((int64_t)(c + 1) * size / columns));
+        const float peak = *std::max_element(data + first, data + last);
+        m_line[c] = 10.0f * std::log10(std::max(peak * scale, 1.0e-30f));
+    }
+
+    // Each coarser zoom halves the columns
+    for (int zoom = WF_TILES_ZOOMS - 1; zoom >= 0; zoom--)
+    {
+        Level &level = m_levels[zoom];
+        const int width = WF_TILES_SIZE << zoom;
+        if (zoom < WF_TILES_ZOOMS - 1)
+            for (int c = 0; c < width; c++)
+                m_line[c] = std::max(m_line[2 * c], m_line[2 * c + 1]);
+
+        for (int c = 0; c < width; c++)
+            level.acc[c] = std::max(level.acc[c], m_line[c]);
+        if (++level.accLines >= 1 << (WF_TILES_ZOOMS - 1 - zoom))
+            pushRow(zoom);
+    }
+
+    if (m_lines++ == 0)
+        m_firstMs = ms;
+    m_lastMs = ms;
+}
+
+/* Quantize the accumulated row into the strip, keep the strip when it is full */
+void CWaterfallTiles::pushRow(int zoom)
+{
+    Level &level = m_levels[zoom];
+    const int columns = WF_TILES_SIZE << zoom;
+    const int row = (int)(level.rows % WF_TILES_SIZE);
+    uint8_t *out = &level.strip[(size_t)row * columns];
+    for (int c = 0; c < columns; c++)
+    {
+        const float q = 1.0f + (level.acc[c] - WF_TILES_MIN_DB) * (254.0f / -WF_TILES_MIN_DB);
+        out[c] = (uint8_t)std::min(std::max(std::lround(q), 1L), 255L);
+        level.acc[c] = -std::numeric_limits<float>::infinity();
+    }
+    level.accLines = 0;
+
+    if (++level.rows % WF_TILES_SIZE != 0)
+        return;
+
+    std::vector<QByteArray> tiles;
+    for (int x = 0; x < (1 << zoom); x++)
+    {
+        tiles.push_back(compress(level.strip, columns, x));
+        m_stored += tiles.back().size();
+    }
+    level.tiles.push_back(std::move(tiles));
+    std::fill(level.strip.begin(), level.strip.end(), 0);
+    account();
+
+    // The oldest row of tiles of the zoom goes, also to stay under the cap
+    while (level.tiles.size() > (size_t)WF_TILES_KEEP ||
+           (level.tiles.size() > 1 && m_mem.allowed(m_mem.bytes()) < m_mem.bytes()))
+    {
+        for (const QByteArray &tile : level.tiles.front())
+            m_stored -= tile.size();
+        level.tiles.pop_front();
+        level.first++;
+        account();
+    }
+}
+
+/* Tile x of a strip, as qCompress() makes it */
+QByteArray CWaterfallTiles::compress(const std::vector<uint8_t> &strip, int columns, int x)
+{
+    QByteArray tile(WF_TILES_SIZE * WF_TILES_SIZE, Qt::Uninitialized);
+    for (int row = 0; row < WF_TILES_SIZE; row++)
+        std::copy_n(&strip[(size_t)row * columns + (size_t)x * WF_TILES_SIZE], WF_TILES_SIZE,
+                    tile.data() + row * WF_TILES_SIZE);
+    return qCompress(tile);
+}
+
+void CWaterfallTiles::account()
+{
+    int64_t bytes = m_stored;
+    for (const Level &level : m_levels)
+        bytes += (int64_t)(level.strip.size() + level.acc.size() * sizeof(float));
+    m_mem.set(bytes);
+}
+
+/** Band, lines and the tiles there are, false before the first line. */
+bool CWaterfallTiles::info(Info &info) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_lines == 0)
+        return false;
+    info.startFreq = m_centerFreq - m_rate / 2.0;
+    info.endFreq = m_centerFreq + m_rate / 2.0;
+    info.lines = m_lines;
+    info.firstMs = m_firstMs;
+    info.lastMs = m_lastMs;
+    for (int zoom = 0; zoom < WF_TILES_ZOOMS; zoom++)
+    {
+        info.oldest[zoom] = m_levels[zoom].first;
+        info.newest[zoom] = m_levels[zoom].rows / WF_TILES_SIZE;
+    }
+    return true;
+}
+
+/**
+ * Get a tile.
+ * @param zoom Zoom level, 0 for the whole band in one tile.
+ * @param x Tile from the start of the band, 0 to (1 << zoom) - 1.
+ * @param y Tile in time, see info().
+ * @returns WF_TILES_SIZE rows of WF_TILES_SIZE levels, oldest row first,
+ *          compressed by qCompress(), empty if the tile is not kept.
+ *
+ * The tile being filled has level 0 in the rows that are still to come.
+ */
+QByteArray CWaterfallTiles::tile(int zoom, int x, int64_t y) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (zoom < 0 || zoom >= WF_TILES_ZOOMS || x < 0 || x >= (1 << zoom))
+        return QByteArray();
+
+    const Level &level = m_levels[zoom];
+    if (y == level.rows / WF_TILES_SIZE)
+        return compress(level.strip, WF_TILES_SIZE << zoom, x);
+    if (y < level.first || y >= level.first + (int64_t)level.tiles.size())
+        return QByteArray();
+    return level.tiles[(size_t)(y - level.first)][x];
+}
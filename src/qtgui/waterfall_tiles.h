@@ -0,0 +1,87 @@
+#ifndef WATERFALL_TILES_H
+#define WATERFALL_TILES_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <QByteArray>
+#include "dsp/mem_account.h"
+
+/* Columns and rows of a tile */
+#define WF_TILES_SIZE    256
+
+/* Zoom levels; zoom z has WF_TILES_SIZE << z columns, the finest one line per row */
+#define WF_TILES_ZOOMS   4
+
+/* Complete rows of tiles kept per zoom, fewer under the cap of MEM_WF_TILES */
+#define WF_TILES_KEEP    64
+
+/* dBFS of level 1, level 255 is 0 dBFS and level 0 has no data */
+#define WF_TILES_MIN_DB  -160.0f
+
+/**
+ * Tile pyramid of the waterfall, for remote viewers.
+ *
+ * Each FFT frame is a line. Zoom z covers the band in WF_TILES_SIZE << z
+ * columns, each the max of the bins in it, and each of its rows is the max
+ * of 1 << (WF_TILES_ZOOMS - 1 - z) lines, so every zoom in frequency is
+ * also one in time, as with map tiles. The rows are quantized to 8 bits
+ * and filled in as lines arrive; a full row of tiles is compressed and
+ * kept, up to WF_TILES_KEEP per zoom. Tile y of a zoom holds its rows
+ * y * WF_TILES_SIZE and up, counted from the first line after the last
+ * change of the band, which clears the pyramid.
+ *
+ * A client pans and zooms through the history with tiles of the same size
+ * whatever the FFT size, and serving a complete tile costs no more than a
+ * copy. Frames can be added and tiles taken from different threads.
+ */
+class CWaterfallTiles
+{
+public:
+    struct Info {
+        double   startFreq;     // band of the tiles, Hz
+        double   endFreq;
+        int64_t  lines;         // since the band changed
+        uint64_t firstMs;       // times of the first and the newest line
+        uint64_t lastMs;
+        int64_t  oldest[WF_TILES_ZOOMS];    // y of the oldest tile kept
+        int64_t  newest[WF_TILES_ZOOMS];    // y of the tile being filled
+    };
+
+    CWaterfallTiles();
+
+    void clear();
+    void addFrame(const float *data, int size, double centerFreq, double rate, uint64_t ms);
+
+    bool       info(Info &info) const;
+    QByteArray tile(int zoom, int x, int64_t y) const;
+
+private:
+    struct Level {
+        std::vector<float>   acc;       // max dB of the row being accumulated
+        int                  accLines;
+        std::vector<uint8_t> strip;     // WF_TILES_SIZE rows of all tiles of the zoom
+        int64_t              rows;      // rows completed
+        int64_t              first;     // y of tiles.front()
+        std::deque<std::vector<QByteArray>> tiles;  // compressed, by y then x
+    };
+
+    static QByteArray compress(const std::vector<uint8_t> &strip, int columns, int x);
+    void reset();
+    void pushRow(int zoom);
+    void account();
+
+    mutable std::mutex m_mutex;
+    Level              m_levels[WF_TILES_ZOOMS];
+    std::vector<float> m_line;
+    double             m_centerFreq;
+    double             m_rate;
+    int64_t            m_lines;
+    uint64_t           m_firstMs;
+    uint64_t           m_lastMs;
+    int64_t            m_stored;    // bytes of the compressed tiles
+    mem_charge         m_mem;       // the strips and the tiles, MEM_WF_TILES
+};
+
+#endif // WATERFALL_TILES_H
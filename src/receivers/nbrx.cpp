@@ -28,6 +28,9 @@
 // NB: Remember to adjust filter ranges in MainWindow
 #define PREF_QUAD_RATE  96000.f
 
+// Squelch level at or below which the squelch is open, the lowest in DockRxOpt
+#define SQL_OPEN_LEVEL  -150.0
+
 nbrx_sptr make_nbrx(float quad_rate, float audio_rate)
 {
     return gnuradio::get_initial_sptr(new nbrx(quad_rate, audio_rate));
@@ -38,26 +41,34 @@ nbrx::nbrx(float quad_rate, float audio_rate)
       d_running(false),
       d_quad_rate(quad_rate),
       d_audio_rate(audio_rate),
-      d_demod(NBRX_DEMOD_FM)
+      d_demod(NBRX_DEMOD_FM),
+      d_nb_on{false, false},
+      d_use_nb(false),
+      d_use_sql(false)
 {
     iq_resamp = make_resampler_cc(PREF_QUAD_RATE/d_quad_rate);
 
     nb = make_rx_nb_cc((double)PREF_QUAD_RATE, 3.3, 2.5);
     filter = make_rx_filter((double)PREF_QUAD_RATE, -5000.0, 5000.0, 1000.0);
     agc = make_rx_agc_cc((double)PREF_QUAD_RATE, true, -100, 0, 0, 500, false);
-    sql = gr::analog::simple_squelch_cc::make(-150.0, 0.001);
+    sql = make_rx_squelch_cc(SQL_OPEN_LEVEL, 0.001);
+    sql_fill = make_rx_squelch_fill_ff();
     meter = make_rx_meter_c((double)PREF_QUAD_RATE);
     demod_raw = gr::blocks::complex_to_float::make(1);
     demod_ssb = gr::blocks::complex_to_real::make(1);
-    demod_fm = make_rx_demod_fm(PREF_QUAD_RATE, 5000.0, 75.0e-6);
+    demod_fm = make_rx_demod_fm(PREF_QUAD_RATE, 5000.0, 75.0e-6, true);
     demod_am = make_rx_demod_am(PREF_QUAD_RATE, true);
     demod_amsync = make_rx_demod_amsync(PREF_QUAD_RATE, true, 0.001);
+    demod_sel0 = gr::blocks::selector::make(sizeof(float), d_demod, 0);
+    demod_sel1 = gr::blocks::selector::make(sizeof(float), d_demod, 0);
 
     // Width of rx_filter can be adjusted at run time, so the input buffer (the
     // output buffer of nb) needs to be large enough for the longest history
     // required by the filter (Narrow/Sharp). This setting may not be reliable
-    // for GR prior to v3.10.7.0.
+    // for GR prior to v3.10.7.0. The resampler feeds the filter while the
+    // noise blanker is bypassed.
     nb->set_min_output_buffer(32768);
+    iq_resamp->set_min_output_buffer(32768);
 
     audio_rr0.reset();
     audio_rr1.reset();
@@ -69,27 +80,35 @@ nbrx::nbrx(float quad_rate, float audio_rate)
         audio_rr1 = make_resampler_ff(d_audio_rate/PREF_QUAD_RATE);
     }
 
-    demod = demod_fm;
+    // The noise blanker and squelch start off and are bypassed, see
+    // update_bypass()
     connect(self(), 0, iq_resamp, 0);
-    connect(iq_resamp, 0, nb, 0);
-    connect(nb, 0, filter, 0);
+    connect(iq_resamp, 0, filter, 0);
     connect(filter, 0, meter, 0);
-    connect(filter, 0, sql, 0);
-    connect(sql, 0, agc, 0);
-    connect(agc, 0, demod, 0);
+    connect(filter, 0, agc, 0);
+
+    // All demodulators run and the selectors pass one of them, on input
+    // nbrx_demod, so switching never changes the flow graph. Raw I/Q is
+    // the only one with different left and right channels.
+    gr::basic_block_sptr demods[NBRX_DEMOD_NUM];
+    demods[NBRX_DEMOD_NONE] = demod_raw;
+    demods[NBRX_DEMOD_AM] = demod_am;
+    demods[NBRX_DEMOD_FM] = demod_fm;
+    demods[NBRX_DEMOD_SSB] = demod_ssb;
+    demods[NBRX_DEMOD_AMSYNC] = demod_amsync;
+    for (int i = 0; i < NBRX_DEMOD_NUM; i++)
+    {
+        connect(agc, 0, demods[i], 0);
+        connect(demods[i], 0, demod_sel0, i);
+        connect(demods[i], i == NBRX_DEMOD_NONE ? 1 : 0, demod_sel1, i);
+    }
 
     if (audio_rr0)
     {
-        connect(demod, 0, audio_rr0, 0);
-
         connect(audio_rr0, 0, self(), 0); // left  channel
-        connect(audio_rr0, 0, self(), 1); // right channel
-    }
-    else
-    {
-        connect(demod, 0, self(), 0);
-        connect(demod, 0, self(), 1);
+        connect(audio_rr1, 0, self(), 1); // right channel
     }
+    wire_audio(false, true);
 }
 
 bool nbrx::start()
@@ -133,12 +152,27 @@ float nbrx::get_signal_level()
     return meter->get_level_db();
 }
 
+void nbrx::start_level_probe(double skip_sec, double length_sec)
+{
+    meter->start_probe(skip_sec, length_sec);
+}
+
+bool nbrx::get_level_probe(float &level_db)
+{
+    return meter->get_probe_db(level_db);
+}
+
 void nbrx::set_nb_on(int nbid, bool on)
 {
     if (nbid == 1)
         nb->set_nb1_on(on);
     else if (nbid == 2)
         nb->set_nb2_on(on);
+    else
+        return;
+
+    d_nb_on[nbid - 1] = on;
+    update_bypass(d_nb_on[0] || d_nb_on[1], d_use_sql);
 }
 
 void nbrx::set_nb_threshold(int nbid, float threshold)
@@ -152,6 +186,7 @@ void nbrx::set_nb_threshold(int nbid, float threshold)
 void nbrx::set_sql_level(double level_db)
 {
     sql->set_threshold(level_db);
+    update_bypass(d_use_nb, level_db > SQL_OPEN_LEVEL);
 }
 
 void nbrx::set_sql_alpha(double alpha)
@@ -159,6 +194,97 @@ void nbrx::set_sql_alpha(double alpha)
     sql->set_alpha(alpha);
 }
 
+/*
+ * Take the noise blanker and the squelch out of the chain while they are
+ * off, so that they do not copy every sample. The hierarchy is only
+ * locked when the wiring changes. The meter stays on the filter output and
+ * the AGC stays in, it applies the manual gain when it is off.
+ *
+ * A closed squelch passes no samples, so the AGC and the demodulators idle
+ * and keep their state until it opens. Its flags take the selectors
+ * through sql_fill, which puts the silence back before the resamplers.
+ */
+void nbrx::update_bypass(bool use_nb, bool use_sql)
+{
+    if (use_nb == d_use_nb && use_sql == d_use_sql)
+        return;
+
+    lock();
+    if (use_nb != d_use_nb)
+    {
+        if (use_nb)
+        {
+            disconnect(iq_resamp, 0, filter, 0);
+            connect(iq_resamp, 0, nb, 0);
+            connect(nb, 0, filter, 0);
+        }
+        else
+        {
+            disconnect(iq_resamp, 0, nb, 0);
+            disconnect(nb, 0, filter, 0);
+            connect(iq_resamp, 0, filter, 0);
+        }
+        d_use_nb = use_nb;
+    }
+    if (use_sql != d_use_sql)
+    {
+        if (use_sql)
+        {
+            disconnect(filter, 0, agc, 0);
+            connect(filter, 0, sql, 0);
+            connect(sql, 0, agc, 0);
+            connect(sql, 1, sql_fill, 2);
+        }
+        else
+        {
+            disconnect(filter, 0, sql, 0);
+            disconnect(sql, 0, agc, 0);
+            disconnect(sql, 1, sql_fill, 2);
+            connect(filter, 0, agc, 0);
+        }
+        wire_audio(d_use_sql, false);
+        wire_audio(use_sql, true);
+        d_use_sql = use_sql;
+    }
+    unlock();
+}
+
+/* Connect or disconnect the selectors and the audio output, through sql_fill if gated */
+void nbrx::wire_audio(bool gated, bool on)
+{
+    gr::basic_block_sptr out0 = self();
+    gr::basic_block_sptr out1 = self();
+    int port1 = 1;
+
+    if (audio_rr0)
+    {
+        out0 = audio_rr0;
+        out1 = audio_rr1;
+        port1 = 0;
+    }
+
+    auto wire = [this, on](gr::basic_block_sptr src, int src_port,
+                           gr::basic_block_sptr dst, int dst_port) {
+        if (on)
+            connect(src, src_port, dst, dst_port);
+        else
+            disconnect(src, src_port, dst, dst_port);
+    };
+
+    if (gated)
+    {
+        wire(demod_sel0, 0, sql_fill, 0);
+        wire(demod_sel1, 0, sql_fill, 1);
+        wire(sql_fill, 0, out0, 0);
+        wire(sql_fill, 1, out1, port1);
+    }
+    else
+    {
+        wire(demod_sel0, 0, out0, 0);
+        wire(demod_sel1, 0, out1, port1);
+    }
+}
+
 void nbrx::set_agc_on(bool agc_on)
 {
     agc->set_agc_on(agc_on);
@@ -191,111 +317,18 @@ void nbrx::set_agc_manual_gain(int gain)
 
 void nbrx::set_demod(int rx_demod)
 {
-    nbrx_demod current_demod = d_demod;
-
     /* check if new demodulator selection is valid */
     if ((rx_demod < NBRX_DEMOD_NONE) || (rx_demod >= NBRX_DEMOD_NUM))
         return;
 
-    if (rx_demod == current_demod) {
+    if (rx_demod == d_demod) {
         /* nothing to do */
         return;
     }
 
-    disconnect(agc, 0, demod, 0);
-    if (audio_rr0)
-    {
-        if (current_demod == NBRX_DEMOD_NONE)
-        {
-            disconnect(demod, 0, audio_rr0, 0);
-            disconnect(demod, 1, audio_rr1, 0);
-
-            disconnect(audio_rr0, 0, self(), 0);
-            disconnect(audio_rr1, 0, self(), 1);
-        }
-        else
-        {
-            disconnect(demod, 0, audio_rr0, 0);
-
-            disconnect(audio_rr0, 0, self(), 0);
-            disconnect(audio_rr0, 0, self(), 1);
-        }
-    }
-    else
-    {
-        if (current_demod == NBRX_DEMOD_NONE)
-        {
-            disconnect(demod, 0, self(), 0);
-            disconnect(demod, 1, self(), 1);
-        }
-        else
-        {
-            disconnect(demod, 0, self(), 0);
-            disconnect(demod, 0, self(), 1);
-        }
-    }
-
-    switch (rx_demod) {
-
-    case NBRX_DEMOD_NONE:
-        d_demod = NBRX_DEMOD_NONE;
-        demod = demod_raw;
-        break;
-
-    case NBRX_DEMOD_SSB:
-        d_demod = NBRX_DEMOD_SSB;
-        demod = demod_ssb;
-        break;
-
-    case NBRX_DEMOD_AM:
-        d_demod = NBRX_DEMOD_AM;
-        demod = demod_am;
-        break;
-
-    case NBRX_DEMOD_AMSYNC:
-        d_demod = NBRX_DEMOD_AMSYNC;
-        demod = demod_amsync;
-        break;
-
-    case NBRX_DEMOD_FM:
-    default:
-        d_demod = NBRX_DEMOD_FM;
-        demod = demod_fm;
-        break;
-    }
-
-    connect(agc, 0, demod, 0);
-    if (audio_rr0)
-    {
-        if (d_demod == NBRX_DEMOD_NONE)
-        {
-            connect(demod, 0, audio_rr0, 0);
-            connect(demod, 1, audio_rr1, 0);
-
-            connect(audio_rr0, 0, self(), 0);
-            connect(audio_rr1, 0, self(), 1);
-        }
-        else
-        {
-            connect(demod, 0, audio_rr0, 0);
-
-            connect(audio_rr0, 0, self(), 0);
-            connect(audio_rr0, 0, self(), 1);
-        }
-    }
-    else
-    {
-        if (d_demod == NBRX_DEMOD_NONE)
-        {
-            connect(demod, 0, self(), 0);
-            connect(demod, 1, self(), 1);
-        }
-        else
-        {
-            connect(demod, 0, self(), 0);
-            connect(demod, 0, self(), 1);
-        }
-    }
+    d_demod = (nbrx_demod) rx_demod;
+    demod_sel0->set_input_index(d_demod);
+    demod_sel1->set_input_index(d_demod);
 }
 
 void nbrx::set_fm_maxdev(float maxdev_hz)
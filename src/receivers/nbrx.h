@@ -23,15 +23,16 @@
 #ifndef NBRX_H
 #define NBRX_H
 
-#include <gnuradio/analog/simple_squelch_cc.h>
 #include <gnuradio/basic_block.h>
 #include <gnuradio/blocks/complex_to_float.h>
 #include <gnuradio/blocks/complex_to_real.h>
+#include <gnuradio/blocks/selector.h>
 #include "receivers/receiver_base.h"
 #include "dsp/rx_noise_blanker_cc.h"
 #include "dsp/rx_filter.h"
 #include "dsp/rx_meter.h"
 #include "dsp/rx_agc_xx.h"
+#include "dsp/rx_squelch.h"
 #include "dsp/rx_demod_fm.h"
 #include "dsp/rx_demod_am.h"
 //#include "dsp/resampler_ff.h"
@@ -79,6 +80,8 @@ public:
     void set_cw_offset(double offset);
 
     float get_signal_level();
+    void start_level_probe(double skip_sec, double length_sec);
+    bool get_level_probe(float &level_db);
 
     /* Noise blanker */
     bool has_nb() { return true; }
@@ -121,6 +124,12 @@ private:
     int    d_audio_rate;       /*!< Audio output rate. */
 
     nbrx_demod                d_demod;    /*!< Current demodulator. */
+    bool   d_nb_on[2];         /*!< Whether NB1 and NB2 are on. */
+    bool   d_use_nb;           /*!< Whether the noise blanker is in the chain. */
+    bool   d_use_sql;          /*!< Whether the squelch is in the chain. */
+
+    void update_bypass(bool use_nb, bool use_sql);
+    void wire_audio(bool gated, bool on);
 
     resampler_cc_sptr         iq_resamp;   /*!< Baseband resampler. */
     rx_filter_sptr            filter;  /*!< Non-translating bandpass filter.*/
@@ -128,16 +137,17 @@ private:
     rx_nb_cc_sptr             nb;         /*!< Noise blanker. */
     rx_meter_c_sptr           meter;      /*!< Signal strength. */
     rx_agc_cc_sptr            agc;        /*!< Receiver AGC. */
-    gr::analog::simple_squelch_cc::sptr sql;        /*!< Squelch. */
+    rx_squelch_cc_sptr        sql;        /*!< Squelch. */
+    rx_squelch_fill_ff_sptr   sql_fill;   /*!< Silence of the closed squelch. */
     gr::blocks::complex_to_float::sptr  demod_raw;  /*!< Raw I/Q passthrough. */
     gr::blocks::complex_to_real::sptr   demod_ssb;  /*!< SSB demodulator. */
     rx_demod_fm_sptr          demod_fm;   /*!< FM demodulator. */
     rx_demod_am_sptr          demod_am;   /*!< AM demodulator. */
     rx_demod_amsync_sptr      demod_amsync;   /*!< AM-Sync demodulator. */
+    gr::blocks::selector::sptr demod_sel0; /*!< Picks the demodulator, left. */
+    gr::blocks::selector::sptr demod_sel1; /*!< Picks the demodulator, right. */
     resampler_ff_sptr         audio_rr0;  /*!< Audio resampler. */
     resampler_ff_sptr         audio_rr1;  /*!< Audio resampler. */
-
-    gr::basic_block_sptr      demod;    // dummy pointer used for simplifying reconf
 };
 
 #endif // NBRX_H
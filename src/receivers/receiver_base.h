@@ -61,6 +61,8 @@ public:
     virtual void set_cw_offset(double offset) = 0;
 
     virtual float get_signal_level() = 0;
+    virtual void start_level_probe(double skip_sec, double length_sec) = 0;
+    virtual bool get_level_probe(float &level_db) = 0;
 
     virtual void set_demod(int demod) = 0;
 
@@ -49,6 +49,8 @@ wfmrx::wfmrx(float quad_rate, float audio_rate)
     stereo = make_stereo_demod(PREF_QUAD_RATE, d_audio_rate, true);
     stereo_oirt = make_stereo_demod(PREF_QUAD_RATE, d_audio_rate, true, true);
     mono = make_stereo_demod(PREF_QUAD_RATE, d_audio_rate, false);
+    demod_sel0 = gr::blocks::selector::make(sizeof(float), d_demod, 0);
+    demod_sel1 = gr::blocks::selector::make(sizeof(float), d_demod, 0);
 
     /* create rds blocks but dont connect them */
     rds = make_rx_rds((double)PREF_QUAD_RATE);
@@ -62,9 +64,21 @@ wfmrx::wfmrx(float quad_rate, float audio_rate)
     connect(filter, 0, meter, 0);
     connect(filter, 0, sql, 0);
     connect(sql, 0, demod_fm, 0);
-    connect(demod_fm, 0, mono, 0);
-    connect(mono, 0, self(), 0); // left  channel
-    connect(mono, 1, self(), 1); // right channel
+
+    // All demodulators run and the selectors pass one of them, on input
+    // wfmrx_demod, so switching never changes the flow graph
+    stereo_demod_sptr demods[WFMRX_DEMOD_NUM];
+    demods[WFMRX_DEMOD_MONO] = mono;
+    demods[WFMRX_DEMOD_STEREO] = stereo;
+    demods[WFMRX_DEMOD_STEREO_UKW] = stereo_oirt;
+    for (int i = 0; i < WFMRX_DEMOD_NUM; i++)
+    {
+        connect(demod_fm, 0, demods[i], 0);
+        connect(demods[i], 0, demod_sel0, i);
+        connect(demods[i], 1, demod_sel1, i);
+    }
+    connect(demod_sel0, 0, self(), 0); // left  channel
+    connect(demod_sel1, 0, self(), 1); // right channel
 }
 
 wfmrx::~wfmrx()
@@ -108,6 +122,16 @@ float wfmrx::get_signal_level()
     return meter->get_level_db();
 }
 
+void wfmrx::start_level_probe(double skip_sec, double length_sec)
+{
+    meter->start_probe(skip_sec, length_sec);
+}
+
+bool wfmrx::get_level_probe(float &level_db)
+{
+    return meter->get_probe_db(level_db);
+}
+
 /*
 void nbrx::set_nb_on(int nbid, bool on)
 {
@@ -179,57 +203,9 @@ void wfmrx::set_demod(int demod)
         return;
     }
 
-    /* lock graph while we reconfigure */
-    lock();
-
-    /* disconnect current demodulator */
-    switch (d_demod) {
-
-    case WFMRX_DEMOD_MONO:
-    default:
-        disconnect(demod_fm, 0, mono, 0);
-        disconnect(mono, 0, self(), 0); // left  channel
-        disconnect(mono, 1, self(), 1); // right channel
-        break;
-
-    case WFMRX_DEMOD_STEREO:
-        disconnect(demod_fm, 0, stereo, 0);
-        disconnect(stereo, 0, self(), 0); // left  channel
-        disconnect(stereo, 1, self(), 1); // right channel
-        break;
-
-    case WFMRX_DEMOD_STEREO_UKW:
-        disconnect(demod_fm, 0, stereo_oirt, 0);
-        disconnect(stereo_oirt, 0, self(), 0); // left  channel
-        disconnect(stereo_oirt, 1, self(), 1); // right channel
-        break;
-    }
-
-    switch (demod) {
-
-    case WFMRX_DEMOD_MONO:
-    default:
-        connect(demod_fm, 0, mono, 0);
-        connect(mono, 0, self(), 0); // left  channel
-        connect(mono, 1, self(), 1); // right channel
-        break;
-
-    case WFMRX_DEMOD_STEREO:
-        connect(demod_fm, 0, stereo, 0);
-        connect(stereo, 0, self(), 0); // left  channel
-        connect(stereo, 1, self(), 1); // right channel
-        break;
-
-    case WFMRX_DEMOD_STEREO_UKW:
-        connect(demod_fm, 0, stereo_oirt, 0);
-        connect(stereo_oirt, 0, self(), 0); // left  channel
-        connect(stereo_oirt, 1, self(), 1); // right channel
-        break;
-    }
     d_demod = (wfmrx_demod) demod;
-
-    /* continue processing */
-    unlock();
+    demod_sel0->set_input_index(d_demod);
+    demod_sel1->set_input_index(d_demod);
 }
 
 void wfmrx::set_fm_maxdev(float maxdev_hz)
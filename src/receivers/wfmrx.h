@@ -25,6 +25,7 @@
 #define WFMRX_H
 
 #include <gnuradio/analog/simple_squelch_cc.h>
+#include <gnuradio/blocks/selector.h>
 #include "receivers/receiver_base.h"
 #include "dsp/rx_noise_blanker_cc.h"
 #include "dsp/rx_filter.h"
@@ -75,6 +76,8 @@ public:
     void set_cw_offset(double offset) { (void)offset; }
 
     float get_signal_level();
+    void start_level_probe(double skip_sec, double length_sec);
+    bool get_level_probe(float &level_db);
 
     /* Noise blanker */
     bool has_nb() { return false; }
@@ -124,6 +127,8 @@ private:
     stereo_demod_sptr         stereo;    /*!< FM stereo demodulator. */
     stereo_demod_sptr         stereo_oirt;    /*!< FM stereo oirt demodulator. */
     stereo_demod_sptr         mono;      /*!< FM stereo demodulator OFF. */
+    gr::blocks::selector::sptr demod_sel0; /*!< Picks the demodulator, left. */
+    gr::blocks::selector::sptr demod_sel1; /*!< Picks the demodulator, right. */
 
     rx_rds_sptr               rds;       /*!< RDS decoder */
     rx_rds_store_sptr         rds_store; /*!< RDS decoded messages */
@@ -0,0 +1,314 @@
+/*
+ * Micro-benchmarks of single DSP blocks and of the plotter.
+ *
+ * Each case runs one block or function over synthetic data of the size it
+ * gets in the receiver, repeated until it has run for --seconds, and prints
+ * the items processed per second and the nanoseconds per item. The GNU Radio
+ * blocks run in a flow graph from a vector source into null sinks, the plain
+ * classes are called directly. The numbers are meant for comparing builds
+ * and CPUs, so the cases and their sizes stay the same from one version to
+ * the next.
+ *
+ *   block_bench
+ *   block_bench --seconds 2 agc afsk
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+
+#include <gnuradio/blocks/null_sink.h>
+#include <gnuradio/blocks/vector_source.h>
+#include <gnuradio/top_block.h>
+
+#include "dsp/afsk1200/cafsk12.h"
+#include "dsp/agc_impl.h"
+#include "dsp/downconverter.h"
+#include "dsp/filter/fir_decim.h"
+#include "dsp/rx_fft.h"
+#include "dsp/rx_noise_blanker_cc.h"
+#include "dsp/stereo_demod.h"
+#include "qtgui/bandplan.h"
+#include "qtgui/bookmarks.h"
+#include "qtgui/dxc_spots.h"
+#include "qtgui/plotter.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/* Sizes as in the receiver */
+#define INPUT_RATE      2.4e6
+#define QUAD_RATE       240e3
+#define AUDIO_RATE      48000
+#define FFT_SIZE        8192
+#define AUDIO_BLOCK     4096        // samples of one audio callback
+#define GRAPH_SAMPLES   (1 << 22)   // input of one flow graph run
+
+struct Case
+{
+    const char                     *name;
+    const char                     *unit;
+    std::function<double(double)>   run;    // items processed in about the given seconds
+};
+
+static double elapsed(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/* Repeat fn, which processes items per call, until seconds have passed */
+static double repeat(double seconds, double items, const std::function<void()> &fn,
+                     double &taken)
+{
+    double done = 0.0;
+    Clock::time_point start = Clock::now();
+    do
+    {
+        fn();
+        done += items;
+    } while (elapsed(start) < seconds);
+    taken = elapsed(start);
+    return done;
+}
+
+static std::vector<gr_complex> noise_c(size_t samples)
+{
+    std::vector<gr_complex> out(samples);
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(0.0f, 0.01f);
+    for (size_t i = 0; i < samples; i++)
+        out[i] = gr_complex(noise(rng), noise(rng));
+    return out;
+}
+
+/* Tone with impulses every millisecond, for the noise blanker to find */
+static std::vector<gr_complex> impulses_c(size_t samples, double rate)
+{
+    std::vector<gr_complex> out = noise_c(samples);
+    double phase_inc = 2.0 * M_PI * 10e3 / rate;
+    size_t period = (size_t)(rate / 1000.0);
+    for (size_t i = 0; i < samples; i++)
+    {
+        out[i] += std::polar(0.1f, (float)std::fmod(phase_inc * i, 2.0 * M_PI));
+        if (i % period == 0)
+            out[i] += gr_complex(2.0f, 2.0f);
+    }
+    return out;
+}
+
+/* Stereo multiplex: 1 and 2 kHz in L+R and L-R, the 19 kHz pilot and noise */
+static std::vector<float> mpx(size_t samples, double rate)
+{
+    std::vector<float> out(samples);
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(0.0f, 0.01f);
+    for (size_t i = 0; i < samples; i++)
+    {
+        double t = i / rate;
+        out[i] = 0.4f * std::sin(2.0 * M_PI * 1e3 * t) +
+                 0.2f * std::sin(2.0 * M_PI * 2e3 * t) * std::sin(2.0 * M_PI * 38e3 * t) +
+                 0.1f * std::sin(2.0 * M_PI * 19e3 * t) + noise(rng);
+    }
+    return out;
+}
+
+/* Bell 202 tones with random bits at 1200 baud */
+static std::vector<float> afsk(size_t samples)
+{
+    std::vector<float> out(samples);
+    std::mt19937 rng(1);
+    double phase = 0.0;
+    bool mark = true;
+    for (size_t i = 0; i < samples; i++)
+    {
+        if (i % (FREQ_SAMP / 1200) == 0)
+            mark = rng() & 1;
+        phase += 2.0 * M_PI * (mark ? 1200.0 : 2200.0) / FREQ_SAMP;
+        out[i] = 0.5f * std::sin(phase);
+    }
+    return out;
+}
+
+/* Run the block in a flow graph until seconds have passed, in input samples */
+template <typename T>
+static double runBlock(double seconds, const std::vector<T> &input,
+                       const std::function<gr::basic_block_sptr()> &make,
+                       int outputs, size_t itemsize, double &taken)
+{
+    double done = 0.0;
+    taken = 0.0;
+    do
+    {
+        gr::top_block_sptr tb = gr::make_top_block("bench");
+        auto src = gr::blocks::vector_source<T>::make(input);
+        gr::basic_block_sptr block = make();
+        tb->connect(src, 0, block, 0);
+        for (int i = 0; i < outputs; i++)
+            tb->connect(block, i, gr::blocks::null_sink::make(itemsize), 0);
+
+        Clock::time_point start = Clock::now();
+        tb->run();
+        taken += elapsed(start);
+        done += input.size();
+    } while (taken < seconds);
+    return done;
+}
+
+static std::vector<Case> cases(double &taken)
+{
+    std::vector<Case> list;
+
+    list.push_back({ "agc", "samples", [&](double seconds) {
+        CAgc agc;
+        agc.SetParameters(true, false, -100, 0, 2, 500, AUDIO_RATE);
+        std::vector<gr_complex> in = noise_c(AUDIO_BLOCK);
+        std::vector<gr_complex> out(AUDIO_BLOCK);
+        return repeat(seconds, AUDIO_BLOCK, [&]() {
+            agc.ProcessData(AUDIO_BLOCK, in.data(), out.data());
+        }, taken);
+    } });
+
+    list.push_back({ "afsk", "samples", [&](double seconds) {
+        CAfsk12 afsk12;
+        std::vector<float> in = afsk(AUDIO_BLOCK);
+        std::vector<float> buf(AUDIO_BLOCK);
+        return repeat(seconds, AUDIO_BLOCK, [&]() {
+            std::copy(in.begin(), in.end(), buf.begin());
+            afsk12.demod(buf.data(), AUDIO_BLOCK);
+        }, taken);
+    } });
+
+    list.push_back({ "nb", "samples", [&](double seconds) {
+        std::vector<gr_complex> in = impulses_c(GRAPH_SAMPLES, QUAD_RATE);
+        return runBlock<gr_complex>(seconds, in, []() -> gr::basic_block_sptr {
+            rx_nb_cc_sptr nb = make_rx_nb_cc(QUAD_RATE, 3.3, 2.5);
+            nb->set_nb1_on(true);
+            nb->set_nb2_on(true);
+            return nb;
+        }, 1, sizeof(gr_complex), taken);
+    } });
+
+    static const struct { const char *name; int quality; } decims[] = {
+        { "decim8_sharp",    FIR_DECIM_SHARP },
+        { "decim8_balanced", FIR_DECIM_BALANCED },
+        { "decim8_fast",     FIR_DECIM_FAST },
+    };
+    for (const auto &d : decims)
+    {
+        int quality = d.quality;
+        list.push_back({ d.name, "samples", [&taken, quality](double seconds) {
+            std::vector<gr_complex> in = noise_c(GRAPH_SAMPLES);
+            return runBlock<gr_complex>(seconds, in, [quality]() -> gr::basic_block_sptr {
+                return make_fir_decim_cc(8, quality);
+            }, 1, sizeof(gr_complex), taken);
+        } });
+    }
+
+    list.push_back({ "ddc", "samples", [&](double seconds) {
+        std::vector<gr_complex> in = noise_c(GRAPH_SAMPLES);
+        return runBlock<gr_complex>(seconds, in, []() -> gr::basic_block_sptr {
+            return make_downconverter_cc(10, 100e3, INPUT_RATE);
+        }, 1, sizeof(gr_complex), taken);
+    } });
+
+    list.push_back({ "stereo", "samples", [&](double seconds) {
+        std::vector<float> in = mpx(GRAPH_SAMPLES, QUAD_RATE);
+        return runBlock<float>(seconds, in, []() -> gr::basic_block_sptr {
+            return make_stereo_demod(QUAD_RATE, AUDIO_RATE, true);
+        }, 2, sizeof(float), taken);
+    } });
+
+    // Snapshots of the buffer filled once, below the size of the worker
+    // thread so that the FFT itself is timed
+    list.push_back({ "fft_data", "points", [&](double seconds) {
+        rx_fft_c_sptr fft = make_rx_fft_c(FFT_SIZE, INPUT_RATE);
+        std::vector<gr_complex> in = noise_c(FFT_SIZE * 4);
+        gr::top_block_sptr tb = gr::make_top_block("fill");
+        tb->connect(gr::blocks::vector_source_c::make(in), 0, fft, 0);
+        tb->run();
+        std::vector<float> points(FFT_SIZE);
+        return repeat(seconds, FFT_SIZE, [&]() {
+            fft->get_fft_data(points.data());
+        }, taken);
+    } });
+
+    // New spectrum and a full redraw, as each FFT frame in the GUI
+    list.push_back({ "plotter", "points", [&](double seconds) {
+        CPlotter plotter;
+        plotter.resize(1920, 800);
+        plotter.setSampleRate(INPUT_RATE);
+        plotter.setSpanFreq(INPUT_RATE);
+        plotter.setCenterFreq(100000000);
+        plotter.setRunningState(true);
+        plotter.show();
+        QApplication::processEvents();
+
+        std::vector<float> frame(FFT_SIZE);
+        std::mt19937 rng(1);
+        std::normal_distribution<float> noise(-100.0f, 3.0f);
+        for (float &p : frame)
+            p = noise(rng);
+        return repeat(seconds, FFT_SIZE, [&]() {
+            plotter.setNewFftData(frame.data(), FFT_SIZE);
+            plotter.draw(true);
+        }, taken);
+    } });
+
+    return list;
+}
+
+int main(int argc, char *argv[])
+{
+    // The plotter is drawn without a display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName("block_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Micro-benchmarks of the Aguila DSP blocks and plotter");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"seconds", "Minimum run time of each case.", "s", "1"},
+    });
+    parser.addPositionalArgument("cases", "Cases to run, all without.", "[cases...]");
+    parser.process(app);
+
+    double seconds = std::max(0.01, parser.value("seconds").toDouble());
+    QStringList names = parser.positionalArguments();
+
+    BandPlan::create();
+    Bookmarks::create();
+    DXCSpots::create();
+
+    double taken = 0.0;
+    std::vector<Case> list = cases(taken);
+    std::printf("%-16s %8s %14s %10s %12s %10s\n", "case", "unit", "items", "seconds",
+                "Mitems/s", "ns/item");
+    int run = 0;
+    for (const Case &c : list)
+    {
+        if (!names.isEmpty() && !names.contains(c.name))
+            continue;
+        double items = c.run(seconds);
+        std::printf("%-16s %8s %14.0f %10.3f %12.3f %10.2f\n", c.name, c.unit, items, taken,
+                    taken > 0.0 ? items / taken / 1e6 : 0.0,
+                    items > 0.0 ? taken * 1e9 / items : 0.0);
+        std::fflush(stdout);
+        run++;
+    }
+
+    if (run == 0)
+    {
+        std::fprintf(stderr, "No such case\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,349 @@
+/*
+ * Offline throughput benchmark of the receiver DSP chain.
+ *
+ * Replays IQ recordings (raw complex float, as written by the I/Q tool) or
+ * a synthetic signal through the blocks of the receiver flow graph without
+ * any throttle or audio sink, as fast as the CPU allows. Each block is first
+ * timed on its own from samples held in memory, then every recording runs
+ * through the whole chain, so the tool can also be used for batch runs over
+ * a directory of recordings.
+ *
+ *   dsp_bench --rate 2.4e6 --demod WFM_S --samples 20e6
+ *   dsp_bench --demod NFM --offset 12.5e3 ~/gqrx_*.raw
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QStringList>
+
+#include <gnuradio/blocks/file_source.h>
+#include <gnuradio/blocks/head.h>
+#include <gnuradio/blocks/null_sink.h>
+#include <gnuradio/blocks/vector_sink.h>
+#include <gnuradio/blocks/vector_source.h>
+#include <gnuradio/top_block.h>
+
+#include "dsp/correct_iq_cc.h"
+#include "dsp/downconverter.h"
+#include "dsp/filter/fir_decim.h"
+#include "dsp/rx_fft.h"
+#include "receivers/nbrx.h"
+#include "receivers/wfmrx.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/* Same as the receiver, see receiver.cpp */
+#define TARGET_QUAD_RATE 1e6
+#define AUDIO_RATE       48000
+#define FFT_SIZE         4096
+
+struct Demod
+{
+    const char *name;
+    bool        wfm;
+    int         demod;      // nbrx_demod or wfmrx_demod
+    double      low;        // filter in Hz
+    double      high;
+};
+
+static const Demod demods[] = {
+    { "RAW",    false, nbrx::NBRX_DEMOD_NONE,     -5000.0,  5000.0 },
+    { "AM",     false, nbrx::NBRX_DEMOD_AM,       -5000.0,  5000.0 },
+    { "AMSYNC", false, nbrx::NBRX_DEMOD_AMSYNC,   -5000.0,  5000.0 },
+    { "NFM",    false, nbrx::NBRX_DEMOD_FM,       -5000.0,  5000.0 },
+    { "SSB",    false, nbrx::NBRX_DEMOD_SSB,        100.0,  2800.0 },
+    { "WFM",    true,  wfmrx::WFMRX_DEMOD_MONO,  -80000.0, 80000.0 },
+    { "WFM_S",  true,  wfmrx::WFMRX_DEMOD_STEREO, -80000.0, 80000.0 },
+};
+
+/* Rates along the chain, computed as in the receiver constructor */
+struct ChainRates
+{
+    double       input;
+    unsigned int decim;
+    int          decim_quality;
+    double       decim_rate;
+    unsigned int ddc_decim;
+    double       quad_rate;
+};
+
+static ChainRates chainRates(double input_rate, unsigned int decim, int decim_quality)
+{
+    ChainRates r;
+    r.input = input_rate;
+    r.decim = decim;
+    r.decim_quality = decim_quality;
+    r.decim_rate = input_rate / std::max(1u, decim);
+    r.ddc_decim = std::max(1, (int)(r.decim_rate / TARGET_QUAD_RATE));
+    r.quad_rate = r.decim_rate / r.ddc_decim;
+    return r;
+}
+
+/* I/Q swap block with the DC removal on, as in the receiver */
+static gr::basic_block_sptr makeSwapDc(double rate)
+{
+    iq_swap_cc_sptr swap = make_iq_swap_cc(false);
+    swap->set_sample_rate(rate);
+    swap->set_dc_cancel(true);
+    return swap;
+}
+
+static gr::basic_block_sptr makeDemod(const Demod &d, double quad_rate)
+{
+    receiver_base_cf_sptr rx;
+    if (d.wfm)
+        rx = make_wfmrx(quad_rate, AUDIO_RATE);
+    else
+        rx = make_nbrx(quad_rate, AUDIO_RATE);
+    rx->set_demod(d.demod);
+    rx->set_filter(d.low, d.high, 0.2 * (d.high - d.low));
+    return rx;
+}
+
+/* Null sinks on all outputs, the receiver has audio sinks there */
+static void connectSinks(gr::top_block_sptr tb, gr::basic_block_sptr block,
+                         int outputs, size_t itemsize)
+{
+    for (int i = 0; i < outputs; i++)
+        tb->connect(block, i, gr::blocks::null_sink::make(itemsize), 0);
+}
+
+static double runGraph(gr::top_block_sptr tb)
+{
+    Clock::time_point start = Clock::now();
+    tb->run();
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    return elapsed.count();
+}
+
+/* Run samples through a chain and keep its output in memory */
+static std::vector<gr_complex> capture(const std::vector<gr_complex> &input,
+                                       const std::vector<gr::basic_block_sptr> &chain)
+{
+    gr::top_block_sptr tb = gr::make_top_block("capture");
+    auto src = gr::blocks::vector_source_c::make(input);
+    auto snk = gr::blocks::vector_sink_c::make();
+    gr::basic_block_sptr b = src;
+    for (auto &block : chain)
+    {
+        tb->connect(b, 0, block, 0);
+        b = block;
+    }
+    tb->connect(b, 0, snk, 0);
+    tb->run();
+    return snk->data();
+}
+
+static void printRow(const char *name, double samples, double seconds, double rate)
+{
+    double sps = seconds > 0.0 ? samples / seconds : 0.0;
+    std::printf("%-12s %12.0f %10.3f %12.3f %10.1f\n", name, samples, seconds,
+                sps / 1e6, rate > 0.0 ? sps / rate : 0.0);
+}
+
+/*
+ * Each block from the same input in memory, with its outputs into null
+ * sinks. The rate is in input samples of the block.
+ */
+static void benchBlocks(const std::vector<gr_complex> &input, const ChainRates &r,
+                        const Demod &d)
+{
+    std::vector<gr_complex> baseband = input;
+    if (r.decim >= 2)
+        baseband = capture(input, { make_fir_decim_cc(r.decim, r.decim_quality) });
+    std::vector<gr_complex> channel = capture(baseband, {
+        make_downconverter_cc(r.ddc_decim, 0.0, r.decim_rate) });
+
+    struct Stage
+    {
+        const char                               *name;
+        const std::vector<gr_complex>            *input;
+        double                                    rate;
+        int                                       outputs;
+        size_t                                    itemsize;
+        std::function<gr::basic_block_sptr()>     make;
+    };
+    std::vector<Stage> stages = {
+        { "input_decim", &input, r.input, 1, sizeof(gr_complex),
+          [&]() -> gr::basic_block_sptr {
+              return make_fir_decim_cc(r.decim, r.decim_quality); } },
+        { "iq_swap", &baseband, r.decim_rate, 1, sizeof(gr_complex),
+          []() -> gr::basic_block_sptr { return make_iq_swap_cc(false); } },
+        { "iq_swap_dc", &baseband, r.decim_rate, 1, sizeof(gr_complex),
+          [&]() -> gr::basic_block_sptr { return makeSwapDc(r.decim_rate); } },
+        { "iq_fft", &baseband, r.decim_rate, 0, sizeof(gr_complex),
+          [&]() -> gr::basic_block_sptr { return make_rx_fft_c(FFT_SIZE, r.decim_rate); } },
+        { "ddc", &baseband, r.decim_rate, 1, sizeof(gr_complex),
+          [&]() -> gr::basic_block_sptr {
+              return make_downconverter_cc(r.ddc_decim, 0.0, r.decim_rate); } },
+        { d.wfm ? "wfmrx" : "nbrx", &channel, r.quad_rate, 2, sizeof(float),
+          [&]() -> gr::basic_block_sptr { return makeDemod(d, r.quad_rate); } },
+    };
+
+    for (const Stage &stage : stages)
+    {
+        if (stage.input == &input && r.decim < 2)
+            continue;
+        gr::top_block_sptr tb = gr::make_top_block(stage.name);
+        auto src = gr::blocks::vector_source_c::make(*stage.input);
+        gr::basic_block_sptr block = stage.make();
+        tb->connect(src, 0, block, 0);
+        connectSinks(tb, block, stage.outputs, stage.itemsize);
+        printRow(stage.name, stage.input->size(), runGraph(tb), stage.rate);
+    }
+}
+
+/*
+ * The flow graph of the receiver from source to audio, with the main
+ * spectrum, and the audio outputs into null sinks.
+ */
+static double benchChain(gr::basic_block_sptr src, const ChainRates &r, const Demod &d,
+                         double offset)
+{
+    gr::top_block_sptr tb = gr::make_top_block("chain");
+    gr::basic_block_sptr b = src;
+    if (r.decim >= 2)
+    {
+        gr::basic_block_sptr decim = make_fir_decim_cc(r.decim, r.decim_quality);
+        tb->connect(b, 0, decim, 0);
+        b = decim;
+    }
+    gr::basic_block_sptr swap = makeSwapDc(r.decim_rate);
+    gr::basic_block_sptr fft = make_rx_fft_c(FFT_SIZE, r.decim_rate);
+    gr::basic_block_sptr ddc = make_downconverter_cc(r.ddc_decim, offset, r.decim_rate);
+    gr::basic_block_sptr rx = makeDemod(d, r.quad_rate);
+    tb->connect(b, 0, swap, 0);
+    tb->connect(swap, 0, fft, 0);
+    tb->connect(swap, 0, ddc, 0);
+    tb->connect(ddc, 0, rx, 0);
+    connectSinks(tb, rx, 2, sizeof(float));
+    return runGraph(tb);
+}
+
+/* Tone at the offset in complex Gaussian noise */
+static std::vector<gr_complex> synthetic(size_t samples, double rate, double offset)
+{
+    std::vector<gr_complex> out(samples);
+    std::mt19937 rng(1);
+    std::normal_distribution<float> noise(0.0f, 0.01f);
+    double phase_inc = 2.0 * M_PI * offset / rate;
+    for (size_t i = 0; i < samples; i++)
+        out[i] = std::polar(0.1f, (float)std::fmod(phase_inc * i, 2.0 * M_PI)) +
+                 gr_complex(noise(rng), noise(rng));
+    return out;
+}
+
+/* Sample rate from a name like gqrx_yyyymmdd_hhmmss_freq_samprate_fc.raw */
+static double recordingRate(const QString &path, double fallback)
+{
+    QStringList list = QFileInfo(path).fileName().split('_');
+    bool ok = false;
+    double rate = list.size() >= 5 ? list.at(4).toDouble(&ok) : 0.0;
+    return (ok && rate > 0.0) ? rate : fallback;
+}
+
+/* Up to 'samples' samples from the start of a recording */
+static std::vector<gr_complex> readRecording(const QString &path, size_t samples)
+{
+    gr::top_block_sptr tb = gr::make_top_block("read");
+    auto src = gr::blocks::file_source::make(sizeof(gr_complex), path.toLocal8Bit().constData());
+    auto head = gr::blocks::head::make(sizeof(gr_complex), samples);
+    auto snk = gr::blocks::vector_sink_c::make();
+    tb->connect(src, 0, head, 0);
+    tb->connect(head, 0, snk, 0);
+    tb->run();
+    return snk->data();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("dsp_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Offline throughput benchmark of the Aguila DSP chain");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"rate", "Input sample rate, taken from gqrx style file names otherwise.", "Hz", "2400000"},
+        {"decim", "Input decimation, a power of 2.", "n", "1"},
+        {"decim-quality", "Filter quality of the decimation, sharp, balanced or fast.", "quality", "sharp"},
+        {"demod", "RAW, AM, AMSYNC, NFM, SSB, WFM or WFM_S.", "demod", "NFM"},
+        {"offset", "Offset of the channel and synthetic tone.", "Hz", "0"},
+        {"samples", "Input samples for the per-block runs and the synthetic signal.", "n", "8388608"},
+    });
+    parser.addPositionalArgument("files", "Raw complex float IQ recordings, a synthetic signal is used without.", "[files...]");
+    parser.process(app);
+
+    double default_rate = parser.value("rate").toDouble();
+    unsigned int decim = std::max(1, parser.value("decim").toInt());
+    double offset = parser.value("offset").toDouble();
+    size_t samples = (size_t)std::max(1e4, parser.value("samples").toDouble());
+    const Demod *demod = nullptr;
+    for (const Demod &d : demods)
+        if (parser.value("demod").toUpper() == d.name)
+            demod = &d;
+    QString quality = parser.value("decim-quality");
+    int decim_quality = quality == "fast" ? FIR_DECIM_FAST :
+                        quality == "balanced" ? FIR_DECIM_BALANCED :
+                        quality == "sharp" ? FIR_DECIM_SHARP : -1;
+    if (!demod || default_rate <= 0.0 || (decim & (decim - 1)) != 0 || decim_quality < 0)
+    {
+        std::fprintf(stderr, "Invalid rate, decimation, quality or demodulator\n");
+        return 1;
+    }
+
+    QStringList files = parser.positionalArguments();
+    int runs = files.isEmpty() ? 1 : files.size();
+    int failed = 0;
+    for (int i = 0; i < runs; i++)
+    {
+        QString name = files.isEmpty() ? QString("synthetic") : files.at(i);
+        ChainRates r = chainRates(files.isEmpty() ? default_rate :
+                                  recordingRate(name, default_rate), decim, decim_quality);
+        std::vector<gr_complex> input = files.isEmpty() ?
+                synthetic(samples, r.input, offset) : readRecording(name, samples);
+        if (input.empty())
+        {
+            std::fprintf(stderr, "%s: no samples\n", qPrintable(name));
+            failed++;
+            continue;
+        }
+
+        std::printf("%s: %.0f Hz, decimation %u %s, ddc %u to %.0f Hz, %s\n\n",
+                    qPrintable(name), r.input, r.decim, qPrintable(quality), r.ddc_decim,
+                    r.quad_rate, demod->name);
+        std::printf("%-12s %12s %10s %12s %10s\n", "block", "samples", "seconds", "Msamples/s",
+                    "realtime");
+        benchBlocks(input, r, *demod);
+
+        // The whole recording through the whole chain, streamed from the file
+        double chain_samples;
+        gr::basic_block_sptr src;
+        if (files.isEmpty())
+        {
+            chain_samples = input.size();
+            src = gr::blocks::vector_source_c::make(input);
+        }
+        else
+        {
+            chain_samples = QFileInfo(name).size() / sizeof(gr_complex);
+            src = gr::blocks::file_source::make(sizeof(gr_complex),
+                                                name.toLocal8Bit().constData());
+        }
+        input.clear();
+        input.shrink_to_fit();
+        printRow("chain", chain_samples, benchChain(src, r, *demod, offset), r.input);
+        std::printf("\n");
+    }
+
+    return failed > 0 ? 1 : 0;
+}
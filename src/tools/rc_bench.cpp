@@ -0,0 +1,260 @@
+/*
+ * Latency and throughput benchmark of the remote control.
+ *
+ * Opens a number of connections to a running Aguila and sends a random mix
+ * of f, F, l STRENGTH and M commands on each for a fixed time, then prints
+ * the latency percentiles per command and the total command rate. F and M
+ * set the frequency and mode that were read at the start, so the receiver
+ * keeps its state while the benchmark runs.
+ *
+ *   rc_bench --connections 8 --duration 10 --pipeline 4
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+#include <QByteArray>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTcpSocket>
+
+typedef std::chrono::steady_clock Clock;
+
+/* Time to wait for a reply before the connection counts as failed */
+#define REPLY_TIMEOUT_MS 5000
+
+enum {
+    CMD_GET_FREQ,
+    CMD_SET_FREQ,
+    CMD_GET_LEVEL,
+    CMD_SET_MODE,
+    CMD_COUNT
+};
+
+static const char *cmd_names[CMD_COUNT] = { "f", "F", "l", "M" };
+
+struct ConnectionResult
+{
+    std::vector<double> latency[CMD_COUNT];     // ms
+    long                errors = 0;
+    QString             failure;
+};
+
+/* One line of the reply, skipping notifications. Empty on timeout. */
+static QByteArray readReply(QTcpSocket &socket)
+{
+    for (;;)
+    {
+        while (!socket.canReadLine())
+        {
+            if (!socket.waitForReadyRead(REPLY_TIMEOUT_MS))
+                return QByteArray();
+        }
+        QByteArray line = socket.readLine().trimmed();
+        if (!line.startsWith('!'))
+            return line;
+    }
+}
+
+static bool connectTo(QTcpSocket &socket, const QString &host, quint16 port, QString &failure)
+{
+    socket.connectToHost(host, port);
+    if (!socket.waitForConnected(REPLY_TIMEOUT_MS))
+    {
+        failure = socket.errorString();
+        return false;
+    }
+    socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    return true;
+}
+
+/*
+ * Keep up to 'pipeline' commands in flight on one connection until the end
+ * time, each timed from its write to its reply.
+ */
+static void runConnection(const QString &host, quint16 port, int pipeline,
+                          Clock::time_point end, const std::vector<double> &weights,
+                          const QByteArray commands[CMD_COUNT], unsigned seed,
+                          ConnectionResult &result)
+{
+    QTcpSocket socket;
+    if (!connectTo(socket, host, port, result.failure))
+        return;
+
+    std::mt19937 rng(seed);
+    std::discrete_distribution<int> pick(weights.begin(), weights.end());
+    std::deque<std::pair<int, Clock::time_point>> in_flight;
+
+    for (;;)
+    {
+        bool sending = Clock::now() < end;
+        if (sending)
+        {
+            while ((int)in_flight.size() < pipeline)
+            {
+                int cmd = pick(rng);
+                in_flight.emplace_back(cmd, Clock::now());
+                socket.write(commands[cmd]);
+            }
+            socket.flush();
+        }
+        if (in_flight.empty())
+            break;
+
+        QByteArray reply = readReply(socket);
+        if (reply.isEmpty())
+        {
+            result.failure = QString("no reply to %1").arg(cmd_names[in_flight.front().first]);
+            return;
+        }
+        std::chrono::duration<double, std::milli> elapsed = Clock::now() - in_flight.front().second;
+        result.latency[in_flight.front().first].push_back(elapsed.count());
+        if (reply.startsWith("RPRT") && reply != "RPRT 0")
+            result.errors++;
+        in_flight.pop_front();
+    }
+    socket.write("q\n");
+    socket.waitForBytesWritten(REPLY_TIMEOUT_MS);
+}
+
+/* Nearest rank percentile of sorted values */
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+    size_t rank = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+static void printRow(const char *name, std::vector<double> &values)
+{
+    std::sort(values.begin(), values.end());
+    std::printf("%-8s %10zu %10.3f %10.3f %10.3f\n", name, values.size(),
+                percentile(values, 0.50), percentile(values, 0.99),
+                values.empty() ? 0.0 : values.back());
+}
+
+/* Weights of the form f=4,F=1,l=4,M=1, commands not given are not sent */
+static bool parseMix(const QString &mix, std::vector<double> &weights)
+{
+    weights.assign(CMD_COUNT, 0.0);
+    for (const QString &item : mix.split(',', Qt::SkipEmptyParts))
+    {
+        QStringList parts = item.split('=');
+        bool ok = false;
+        double weight = parts.size() == 2 ? parts[1].toDouble(&ok) : 0.0;
+        int cmd = 0;
+        while (cmd < CMD_COUNT && parts[0] != cmd_names[cmd])
+            cmd++;
+        if (!ok || weight < 0.0 || cmd == CMD_COUNT)
+            return false;
+        weights[cmd] = weight;
+    }
+    return std::any_of(weights.begin(), weights.end(), [](double w) { return w > 0.0; });
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("rc_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Latency and throughput benchmark of the Aguila remote control");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"host", "Address of the remote control.", "host", "127.0.0.1"},
+        {"port", "Port of the remote control.", "port", "7356"},
+        {"connections", "Number of connections.", "n", "4"},
+        {"duration", "Length of the run in seconds.", "s", "10"},
+        {"pipeline", "Commands in flight per connection.", "n", "1"},
+        {"mix", "Weights of the commands.", "mix", "f=4,F=1,l=4,M=1"},
+    });
+    parser.process(app);
+
+    QString host = parser.value("host");
+    quint16 port = parser.value("port").toUShort();
+    int connections = std::max(1, parser.value("connections").toInt());
+    double duration = std::max(0.1, parser.value("duration").toDouble());
+    int pipeline = std::max(1, parser.value("pipeline").toInt());
+    std::vector<double> weights;
+    if (!parseMix(parser.value("mix"), weights))
+    {
+        std::fprintf(stderr, "Invalid command mix: %s\n", qPrintable(parser.value("mix")));
+        return 1;
+    }
+
+    // Current frequency and mode, set again by F and M
+    QTcpSocket socket;
+    QString failure;
+    if (!connectTo(socket, host, port, failure))
+    {
+        std::fprintf(stderr, "Can not connect to %s:%u: %s\n", qPrintable(host), port,
+                     qPrintable(failure));
+        return 1;
+    }
+    socket.write("f\nm\n");
+    QByteArray freq = readReply(socket);
+    QByteArray mode = readReply(socket);
+    QByteArray passband = readReply(socket);
+    socket.write("q\n");
+    socket.waitForBytesWritten(REPLY_TIMEOUT_MS);
+    socket.close();
+    if (freq.isEmpty() || mode.isEmpty() || passband.isEmpty())
+    {
+        std::fprintf(stderr, "No reply to f and m\n");
+        return 1;
+    }
+
+    QByteArray commands[CMD_COUNT];
+    commands[CMD_GET_FREQ] = "f\n";
+    commands[CMD_SET_FREQ] = "F " + freq + "\n";
+    commands[CMD_GET_LEVEL] = "l STRENGTH\n";
+    commands[CMD_SET_MODE] = "M " + mode + " " + passband + "\n";
+
+    std::vector<ConnectionResult> results(connections);
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(
+                                        std::chrono::duration<double>(duration));
+    for (int i = 0; i < connections; i++)
+        threads.emplace_back(runConnection, host, port, pipeline, end, std::cref(weights),
+                             commands, (unsigned)i, std::ref(results[i]));
+    for (auto &thread : threads)
+        thread.join();
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    std::vector<double> all;
+    std::vector<double> per_cmd[CMD_COUNT];
+    long errors = 0;
+    int failed = 0;
+    for (int i = 0; i < connections; i++)
+    {
+        if (!results[i].failure.isEmpty())
+        {
+            std::fprintf(stderr, "Connection %d: %s\n", i, qPrintable(results[i].failure));
+            failed++;
+        }
+        for (int cmd = 0; cmd < CMD_COUNT; cmd++)
+        {
+            const std::vector<double> &values = results[i].latency[cmd];
+            per_cmd[cmd].insert(per_cmd[cmd].end(), values.begin(), values.end());
+            all.insert(all.end(), values.begin(), values.end());
+        }
+        errors += results[i].errors;
+    }
+
+    std::printf("%-8s %10s %10s %10s %10s\n", "command", "count", "p50 ms", "p99 ms", "max ms");
+    for (int cmd = 0; cmd < CMD_COUNT; cmd++)
+        if (weights[cmd] > 0.0)
+            printRow(cmd_names[cmd], per_cmd[cmd]);
+    printRow("all", all);
+    std::printf("\n%.0f commands/s over %d connections with %d in flight, %ld errors\n",
+                all.size() / elapsed.count(), connections, pipeline, errors);
+
+    return (failed > 0 || errors > 0) ? 1 : 0;
+}
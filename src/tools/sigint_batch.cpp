@@ -0,0 +1,566 @@
+/*
+ * Offline run of the signal detector and the modulation classifier over
+ * SigMF recordings, writing the events to the sigint database.
+ *
+ * The recordings are cut into chunks that are processed in parallel, one
+ * worker thread per core. Each chunk is started a warm-up time early so the
+ * noise floor of the detector has settled when the chunk begins, and keeps
+ * running past its end until the signals that started in it are closed, so
+ * an emission is stored once, by the chunk it started in, however the cuts
+ * fall. Closed signals are classified from the samples in their middle,
+ * mixed down and decimated to a few times their bandwidth.
+ *
+ *   sigint_batch --threads 8 ~/recordings
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include "dsp/fft_plan_cache.h"
+#include "dsp/modulation_classifier.h"
+#include "qtgui/signal_detector.h"
+#include "qtgui/spectrum_levels.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/* Samples classified per signal at the decimated rate, as in the sigint dock */
+#define BATCH_CLASSIFY_SAMPLES  32768
+
+/* Upper limit of the samples read for classifying one signal */
+#define BATCH_CLASSIFY_INPUT    (1 << 20)
+
+/* Rate the signals are decimated to for the classifier, in bandwidths */
+#define BATCH_CLASSIFY_OVERSAMPLE 2.5
+
+/* Interval the results are written to the database and progress printed */
+#define BATCH_POLL_MS           500
+
+struct Recording
+{
+    QString      path;
+    std::unique_ptr<QFile> file;
+    const uchar *data = nullptr;
+    qint64       samples = 0;
+    int          bytes = 8;         // per sample, 8 cf32, 4 ci16 or 2 ci8
+    float        scale = 1.0f;      // of the integer formats
+    double       rate = 0.0;
+    double       freq = 0.0;
+    qint64       startMs = 0;       // time of the first sample
+};
+
+struct Chunk
+{
+    int    rec;
+    qint64 start;                   // samples
+    qint64 end;
+};
+
+struct Settings
+{
+    int    fftSize;
+    double frameRate;
+    float  threshold;
+    qint64 warmupMs;
+    bool   classify;
+};
+
+/* Events of the chunks done, emptied by the main thread */
+struct Results
+{
+    std::mutex          mutex;
+    QVector<SignalEvent> events;
+    std::atomic<int>    chunks{0};
+    std::atomic<qint64> samples{0};  // in the chunks done, without the warm-up
+};
+
+/* The data file of a SigMF recording with the metadata next to it */
+static bool openRecording(const QString &path, Recording &rec, QString &error)
+{
+    QString metaPath = path;
+    metaPath.replace(QRegularExpression("\\.sigmf-data$"), ".sigmf-meta");
+    QFile metaFile(metaPath);
+    if (!metaFile.open(QIODevice::ReadOnly))
+    {
+        error = "no metadata " + metaPath;
+        return false;
+    }
+    const QJsonObject meta = QJsonDocument::fromJson(metaFile.readAll()).object();
+    const QJsonObject global = meta["global"].toObject();
+    const QJsonObject capture = meta["captures"].toArray().at(0).toObject();
+
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    const QString endian = "_be";
+#else
+    const QString endian = "_le";
+#endif
+    const QString datatype = global["core:datatype"].toString();
+    if (datatype == "cf32" + endian)
+        rec.bytes = 8;
+    else if (datatype == "ci16" + endian)
+        rec.bytes = 4;
+    else if (datatype == "ci8")
+        rec.bytes = 2;
+    else
+    {
+        error = "unsupported data type " + datatype;
+        return false;
+    }
+    if (global["gqrx:compression"].toString("none") != "none")
+    {
+        error = "compressed";
+        return false;
+    }
+    rec.scale = (float)global["gqrx:full_scale"].toDouble(rec.bytes == 4 ? 32767.0 :
+                                                          rec.bytes == 2 ? 127.0 : 1.0);
+    rec.rate = global["core:sample_rate"].toDouble();
+    rec.freq = capture["core:frequency"].toDouble();
+    if (rec.rate <= 0.0)
+    {
+        error = "no sample rate";
+        return false;
+    }
+
+    rec.path = path;
+    rec.file.reset(new QFile(path));
+    const qint64 size = rec.file->size();
+    rec.samples = size / rec.bytes;
+    if (rec.samples == 0 || !rec.file->open(QIODevice::ReadOnly) ||
+        !(rec.data = rec.file->map(0, size)))
+    {
+        error = "can not map the data " + rec.file->errorString();
+        return false;
+    }
+
+    // Recordings without a time end when the file was last written
+    QDateTime start = QDateTime::fromString(capture["core:datetime"].toString(), Qt::ISODateWithMs);
+    if (!start.isValid())
+        start = QFileInfo(path).lastModified().addMSecs(-qRound64(rec.samples / rec.rate * 1000.0));
+    rec.startMs = start.toMSecsSinceEpoch();
+    return true;
+}
+
+/* Samples as floats, the integer formats divided by their full scale */
+static void convert(const Recording &rec, qint64 index, int count, std::complex<float> *out)
+{
+    const uchar *p = rec.data + index * rec.bytes;
+    const float gain = 1.0f / rec.scale;
+
+    if (rec.bytes == 4)
+    {
+        const int16_t *in = (const int16_t *)p;
+        for (int i = 0; i < count; i++)
+            out[i] = std::complex<float>(in[2 * i], in[2 * i + 1]) * gain;
+    }
+    else if (rec.bytes == 2)
+    {
+        const int8_t *in = (const int8_t *)p;
+        for (int i = 0; i < count; i++)
+            out[i] = std::complex<float>(in[2 * i], in[2 * i + 1]) * gain;
+    }
+    else
+        memcpy(out, p, sizeof(std::complex<float>) * count);
+}
+
+/*
+ * Classify a closed signal from up to BATCH_CLASSIFY_SAMPLES samples in its
+ * middle, mixed down to its center and decimated with a windowed sinc low
+ * pass to BATCH_CLASSIFY_OVERSAMPLE times its bandwidth. Signals that are
+ * narrow for the rate are decimated less, so that BATCH_CLASSIFY_INPUT
+ * samples still make a few classifier FFTs; its channel filter does the rest.
+ */
+static void classifyEvent(const Recording &rec, modulation_classifier &classifier,
+                          SignalEvent &event)
+{
+    const double bandwidth = std::max(event.bandwidth, 1.0);
+    const int decim = std::max(1, std::min((int)(rec.rate / (BATCH_CLASSIFY_OVERSAMPLE * bandwidth)),
+                                           BATCH_CLASSIFY_INPUT / (4 * CLASSIFIER_FFT_SIZE)));
+    const int taps = 8 * decim + 1;
+
+    const qint64 first = (qint64)((event.start_time * 1000.0 - rec.startMs) / 1000.0 * rec.rate);
+    const qint64 last = (qint64)((event.stop_time * 1000.0 - rec.startMs) / 1000.0 * rec.rate);
+    const qint64 span = std::min(last, rec.samples) - std::max<qint64>(first, 0);
+    const qint64 wanted = std::min<qint64>((qint64)BATCH_CLASSIFY_SAMPLES * decim + taps,
+                                           BATCH_CLASSIFY_INPUT);
+    const int count = (int)std::min(span, wanted);
+    if (count < taps + CLASSIFIER_FFT_SIZE * decim)
+        return;
+
+    std::vector<std::complex<float>> in(count);
+    const qint64 start = std::max<qint64>(first, 0) + (span - count) / 2;
+    convert(rec, start, count, in.data());
+
+    const double step = -2.0 * M_PI * (event.center_freq - rec.freq) / rec.rate;
+    for (int i = 0; i < count; i++)
+        in[i] *= std::polar(1.0f, (float)std::remainder(step * (double)(start + i), 2.0 * M_PI));
+
+    std::vector<float> h(taps);
+    const double fc = 0.5 / decim;
+    double sum = 0.0;
+    for (int i = 0; i < taps; i++)
+    {
+        const double t = i - taps / 2;
+        h[i] = (float)((t == 0.0 ? 2.0 * fc : std::sin(2.0 * M_PI * fc * t) / (M_PI * t)) *
+                       (0.54 - 0.46 * std::cos(2.0 * M_PI * i / (taps - 1))));
+        sum += h[i];
+    }
+
+    std::vector<gr_complex> out((count - taps) / decim + 1);
+    for (size_t k = 0; k < out.size(); k++)
+    {
+        std::complex<float> acc = 0.0f;
+        const std::complex<float> *x = &in[k * decim];
+        for (int i = 0; i < taps; i++)
+            acc += x[i] * h[i];
+        out[k] = acc / (float)sum;
+    }
+
+    classifier.set_channel(rec.rate / decim, -bandwidth / 2.0, bandwidth / 2.0);
+    modulation_classifier::result res;
+    if (classifier.classify(out.data(), (unsigned int)out.size(), res))
+        event.classification = QString::fromStdString(modulation_classifier::describe(res));
+}
+
+/*
+ * Run the detector over one chunk. Only the signals starting in the chunk
+ * are kept, the chunk runs on after its end until they are closed, for at
+ * most one more chunk length.
+ */
+static void processChunk(const Recording &rec, const Chunk &chunk, const Settings &settings,
+                         const std::function<qint64()> &allocate, Results &results)
+{
+    const int n = settings.fftSize;
+    const qint64 hop = std::max<qint64>(1, (qint64)(rec.rate / settings.frameRate));
+    const qint64 warmup = (qint64)(settings.warmupMs / 1000.0 * rec.rate);
+    const qint64 limit = std::min(rec.samples, 2 * chunk.end - chunk.start);
+    const double startTime = (rec.startMs + chunk.start / rec.rate * 1000.0) / 1000.0;
+    const double endTime = (rec.startMs + chunk.end / rec.rate * 1000.0) / 1000.0;
+
+    SignalDetector detector;
+    detector.setIdAllocator(allocate);
+    detector.setThreshold(settings.threshold);
+    SpectrumLevels levels;
+    modulation_classifier classifier;
+    std::set<qint64> owned;
+    QVector<SignalEvent> events;
+
+    std::vector<float> window(n);
+    for (int i = 0; i < n; i++)
+        window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / (n - 1));
+    std::vector<float> power(n);
+    fft_plan_cache::fft_c *fft = fft_plan_cache::acquire(n);
+
+    auto keep = [&](const QVector<SignalDetector::Detection> &closed) {
+        for (const SignalDetector::Detection &det : closed)
+        {
+            if (owned.erase(det.event.id) == 0)
+                continue;
+            SignalEvent event = det.event;
+            if (settings.classify)
+                classifyEvent(rec, classifier, event);
+            events.append(event);
+        }
+    };
+
+    uint64_t seq = 0;
+    for (qint64 pos = std::max<qint64>(0, chunk.start - warmup); pos + n <= limit; pos += hop)
+    {
+        if (pos >= chunk.end && owned.empty())
+            break;
+
+        std::complex<float> *in = fft->get_inbuf();
+        convert(rec, pos, n, in);
+        for (int i = 0; i < n; i++)
+            in[i] *= window[i];
+        fft->execute();
+        const std::complex<float> *out = fft->get_outbuf();
+        for (int i = 0; i < n; i++)
+            power[i] = std::norm(out[(i + n / 2) % n]);
+
+        // The Hann window is made up for by scaling the levels as for a
+        // frame of half the size
+        levels.setFrame(power.data(), n, rec.freq, rec.rate, ++seq, n / 2);
+        SignalDetector::Update update;
+        const qint64 timeMs = rec.startMs + qRound64((pos + n / 2) / rec.rate * 1000.0);
+        if (!detector.process(levels.dB(), levels.size(), levels.centerFreq(),
+                              levels.sampleRate(), timeMs, update))
+            continue;
+
+        for (const SignalDetector::Detection &det : update.opened)
+            if (det.event.start_time >= startTime && det.event.start_time < endTime)
+                owned.insert(det.event.id);
+        keep(update.closed);
+    }
+    fft_plan_cache::release(fft, n);
+
+    SignalDetector::Update update;
+    detector.reset(update);
+    keep(update.closed);
+
+    std::lock_guard<std::mutex> lock(results.mutex);
+    results.events += events;
+    results.chunks++;
+    results.samples += chunk.end - chunk.start;
+}
+
+/* The events table of the sigint dock, made if the dock has not run yet */
+static bool openDatabase(QSqlDatabase &db, const QString &path, bool &rtree, QString &error)
+{
+    db = QSqlDatabase::addDatabase("QSQLITE", "sigint_batch");
+    db.setDatabaseName(path);
+    if (!db.open())
+    {
+        error = db.lastError().text();
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.exec("PRAGMA journal_mode = WAL");
+    query.exec("PRAGMA busy_timeout = 5000");
+    if (!query.exec("CREATE TABLE IF NOT EXISTS events ("
+                    "id INTEGER PRIMARY KEY,"
+                    "range TEXT,"
+                    "start_time REAL NOT NULL,"
+                    "stop_time REAL NOT NULL,"
+                    "center_freq REAL NOT NULL,"
+                    "bandwidth REAL NOT NULL,"
+                    "peak_db REAL,"
+                    "classification TEXT"
+                    ")"))
+    {
+        error = query.lastError().text();
+        return false;
+    }
+    rtree = query.exec("CREATE VIRTUAL TABLE IF NOT EXISTS events_rtree USING rtree("
+                       "id, start_time, stop_time, min_freq, max_freq)");
+    if (!rtree)
+        query.exec("CREATE INDEX IF NOT EXISTS events_time ON events (start_time, stop_time)");
+    return true;
+}
+
+/* Ids after the ones in the database, so events of the dock are not replaced */
+static qint64 firstId(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    qint64 id = QDateTime::currentMSecsSinceEpoch();
+    if (query.exec("SELECT MAX(id) FROM events") && query.next())
+        id = std::max(id, query.value(0).toLongLong() + 1);
+    return id;
+}
+
+static bool storeEvents(QSqlDatabase &db, bool rtree, const QVector<SignalEvent> &events,
+                        QString &error)
+{
+    QSqlQuery insert(db);
+    insert.prepare("INSERT OR REPLACE INTO events (id, range, start_time, stop_time, "
+                   "center_freq, bandwidth, peak_db, classification) "
+                   "VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    QSqlQuery index(db);
+    if (rtree)
+        index.prepare("INSERT OR REPLACE INTO events_rtree VALUES (?, ?, ?, ?, ?)");
+
+    db.transaction();
+    for (const SignalEvent &e : events)
+    {
+        insert.addBindValue(e.id);
+        insert.addBindValue(e.range);
+        insert.addBindValue(e.start_time);
+        insert.addBindValue(e.stop_time);
+        insert.addBindValue(e.center_freq);
+        insert.addBindValue(e.bandwidth);
+        insert.addBindValue(e.peak_db);
+        insert.addBindValue(e.classification.isEmpty() ? QVariant() : QVariant(e.classification));
+        bool ok = insert.exec();
+        if (ok && rtree)
+        {
+            index.addBindValue(e.id);
+            index.addBindValue(e.start_time);
+            index.addBindValue(e.stop_time);
+            index.addBindValue(e.center_freq - e.bandwidth / 2);
+            index.addBindValue(e.center_freq + e.bandwidth / 2);
+            ok = index.exec();
+        }
+        if (!ok)
+        {
+            error = insert.lastError().text() + index.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    if (!db.commit())
+    {
+        error = db.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("sigint_batch");
+
+    const QString defaultDb = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) +
+                              "/gqrx/chat_history.db";
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Run the signal detector and classifier over SigMF recordings");
+    parser.addHelpOption();
+    parser.addPositionalArgument("paths", "Recordings, or directories searched for *.sigmf-data.");
+    parser.addOptions({
+        {"db", "Database the events are written to.", "file", defaultDb},
+        {"threads", "Number of worker threads, 0 for one per core.", "n", "0"},
+        {"chunk", "Length of the chunks in seconds.", "s", "60"},
+        {"warmup", "Time a chunk is started early to settle the noise floor, in seconds.", "s", "10"},
+        {"fft", "FFT size.", "n", "4096"},
+        {"fps", "FFT frames per second of recording.", "n", "25"},
+        {"threshold", "Detection threshold over the noise in dB.", "dB",
+         QString::number(SIGNAL_DETECTOR_THRESHOLD_DB)},
+        {"no-classify", "Only detect, do not classify the signals."},
+        {"dry-run", "Print the events instead of storing them."},
+    });
+    parser.process(app);
+
+    Settings settings;
+    settings.fftSize = std::max(64, parser.value("fft").toInt());
+    settings.frameRate = std::max(1.0, parser.value("fps").toDouble());
+    settings.threshold = parser.value("threshold").toFloat();
+    settings.warmupMs = qRound64(std::max(0.0, parser.value("warmup").toDouble()) * 1000.0);
+    settings.classify = !parser.isSet("no-classify");
+    const double chunkSeconds = std::max(1.0, parser.value("chunk").toDouble());
+    int threads = parser.value("threads").toInt();
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    QStringList files;
+    for (const QString &arg : parser.positionalArguments())
+    {
+        if (QFileInfo(arg).isDir())
+        {
+            QDirIterator it(arg, {"*.sigmf-data"}, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext())
+                files << it.next();
+        }
+        else
+            files << arg;
+    }
+    if (files.isEmpty())
+        parser.showHelp(1);
+    files.sort();
+
+    std::vector<Recording> recordings;
+    std::vector<Chunk> chunks;
+    qint64 total = 0;
+    for (const QString &path : files)
+    {
+        Recording rec;
+        QString error;
+        if (!openRecording(path, rec, error))
+        {
+            std::fprintf(stderr, "Skipping %s: %s\n", qPrintable(path), qPrintable(error));
+            continue;
+        }
+        const qint64 length = std::max<qint64>(settings.fftSize, (qint64)(chunkSeconds * rec.rate));
+        for (qint64 start = 0; start < rec.samples; start += length)
+            chunks.push_back({(int)recordings.size(), start, std::min(start + length, rec.samples)});
+        total += rec.samples;
+        recordings.push_back(std::move(rec));
+    }
+    if (chunks.empty())
+        return 1;
+
+    QSqlDatabase db;
+    bool rtree = false;
+    QString error;
+    const bool dryRun = parser.isSet("dry-run");
+    if (!dryRun && !openDatabase(db, parser.value("db"), rtree, error))
+    {
+        std::fprintf(stderr, "Can not open %s: %s\n", qPrintable(parser.value("db")),
+                     qPrintable(error));
+        return 1;
+    }
+
+    double seconds = 0.0;
+    for (const Recording &rec : recordings)
+        seconds += rec.samples / rec.rate;
+    std::printf("%zu recordings, %.0f s in %zu chunks on %d threads\n",
+                recordings.size(), seconds, chunks.size(), threads);
+
+    std::atomic<qint64> nextId(dryRun ? QDateTime::currentMSecsSinceEpoch() : firstId(db));
+    std::function<qint64()> allocate = [&nextId]() { return nextId++; };
+    std::atomic<size_t> next(0);
+    Results results;
+    Clock::time_point start = Clock::now();
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back([&]() {
+            for (size_t c = next++; c < chunks.size(); c = next++)
+                processChunk(recordings[chunks[c].rec], chunks[c], settings, allocate, results);
+        });
+
+    int stored = 0;
+    bool failed = false;
+    for (;;)
+    {
+        const bool done = results.chunks == (int)chunks.size();
+        if (!done)
+            std::this_thread::sleep_for(std::chrono::milliseconds(BATCH_POLL_MS));
+
+        QVector<SignalEvent> events;
+        {
+            std::lock_guard<std::mutex> lock(results.mutex);
+            events.swap(results.events);
+        }
+        if (dryRun)
+        {
+            for (const SignalEvent &e : events)
+                std::printf("%s %.0f Hz %.0f Hz %.1f s %s\n",
+                            qPrintable(QDateTime::fromMSecsSinceEpoch(qRound64(e.start_time * 1000.0))
+                                       .toUTC().toString(Qt::ISODateWithMs)),
+                            e.center_freq, e.bandwidth, e.stop_time - e.start_time,
+                            qPrintable(e.classification));
+        }
+        else if (!events.isEmpty() && !storeEvents(db, rtree, events, error))
+        {
+            std::fprintf(stderr, "Error storing events: %s\n", qPrintable(error));
+            failed = true;
+        }
+        stored += events.size();
+
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        std::fprintf(stderr, "\r%d/%zu chunks, %d events, %.1f%% at %.1fx real time",
+                     results.chunks.load(), chunks.size(), stored,
+                     100.0 * results.samples / total,
+                     seconds * results.samples / total /
+                     std::max(elapsed.count(), 1e-3));
+        if (done)
+            break;
+    }
+    std::fprintf(stderr, "\n");
+
+    for (std::thread &worker : workers)
+        worker.join();
+    return failed ? 1 : 0;
+}